@@ -0,0 +1,343 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "common/alloc.h"
+#include "common/debug_priv.h"
+#include "common/list.h"
+#include "common/util.h"
+#include "cpe_check_cache.h"
+
+/* the files the platform checks usually read, with the host identity */
+static const char *cpe_check_cache_files[] = {
+	"/etc/machine-id",
+	"/etc/os-release",
+	"/usr/lib/os-release",
+	"/etc/redhat-release",
+	"/etc/system-release",
+	"/etc/system-release-cpe",
+	"/etc/debian_version",
+	"/etc/lsb-release",
+	"/var/lib/rpm",
+	"/var/lib/rpm/Packages",
+	"/var/lib/rpm/rpmdb.sqlite",
+	"/usr/lib/sysimage/rpm/rpmdb.sqlite",
+	"/var/lib/dpkg/status",
+	NULL
+};
+
+/* values of the results, the htable needs non-NULL ones */
+static char _cpe_check_cache_true;
+static char _cpe_check_cache_false;
+
+struct cpe_check_content {
+	char *path;                     /* file of the content in the cache directory */
+	struct oscap_htable *results;   /* definition id -> result */
+	bool dirty;
+};
+
+struct cpe_check_cache {
+	char *dir;
+	char *stamp;                    /* the host identity and the stamps of the files */
+	bool recheck;
+	struct oscap_htable *contents;  /* content key -> struct cpe_check_content */
+};
+
+static void cpe_check_content_free(struct cpe_check_content *content)
+{
+	if (content == NULL)
+		return;
+
+	oscap_htable_free(content->results, NULL);
+	oscap_free(content->path);
+	oscap_free(content);
+}
+
+static bool cpe_check_cache_private(const struct stat *st)
+{
+	return (st->st_uid == geteuid() && (st->st_mode & 077) == 0);
+}
+
+static char *cpe_check_cache_stamp(void)
+{
+	const char *root = getenv("OSCAP_PROBE_ROOT");
+	char machine_id[64] = "-", *path, *stamp, *tmp;
+	struct stat st;
+	size_t i;
+	FILE *fp;
+
+	if (root == NULL)
+		root = "";
+
+	path = oscap_sprintf("%s/etc/machine-id", root);
+	if ((fp = fopen(path, "r")) != NULL) {
+		if (fgets(machine_id, sizeof machine_id, fp) == NULL)
+			strcpy(machine_id, "-");
+		machine_id[strcspn(machine_id, " \n")] = '\0';
+		fclose(fp);
+	}
+	oscap_free(path);
+
+	stamp = oscap_sprintf("%s %s", machine_id, *root != '\0' ? root : "/");
+
+	for (i = 0; cpe_check_cache_files[i] != NULL; ++i) {
+		path = oscap_sprintf("%s%s", root, cpe_check_cache_files[i]);
+
+		if (stat(path, &st) == 0)
+			tmp = oscap_sprintf("%s %llu:%llu:%llu:%lld.%09ld:%lld.%09ld", stamp,
+					    (unsigned long long)st.st_dev, (unsigned long long)st.st_ino,
+					    (unsigned long long)st.st_size,
+					    (long long)st.st_mtim.tv_sec, (long)st.st_mtim.tv_nsec,
+					    (long long)st.st_ctim.tv_sec, (long)st.st_ctim.tv_nsec);
+		else
+			tmp = oscap_sprintf("%s -", stamp);
+
+		oscap_free(path);
+		oscap_free(stamp);
+		stamp = tmp;
+	}
+
+	return (stamp);
+}
+
+struct cpe_check_cache *cpe_check_cache_new(void)
+{
+	struct cpe_check_cache *cache;
+	const char *dir, *env;
+	struct stat st;
+
+	dir = getenv(CPE_CHECK_CACHE_ENV);
+	if (dir == NULL || *dir == '\0')
+		return (NULL);
+
+	/* the stamps of the local files say nothing about a remote host */
+	env = getenv("OSCAP_PROBE_SSH");
+	if (env != NULL && *env != '\0') {
+		dW("The applicability cache is not supported with the remote probes, ignoring %s.", CPE_CHECK_CACHE_ENV);
+		return (NULL);
+	}
+
+	/* a forged result would make rules not applicable */
+	if (stat(dir, &st) != 0 || !S_ISDIR(st.st_mode) || !cpe_check_cache_private(&st)) {
+		dW("Not using the applicability cache '%s': it must be a directory "
+		   "owned by the user and not accessible by others.", dir);
+		return (NULL);
+	}
+
+	env = getenv(CPE_CHECK_CACHE_RECHECK_ENV);
+
+	cache = oscap_talloc(struct cpe_check_cache);
+	cache->dir = oscap_strdup(dir);
+	cache->stamp = cpe_check_cache_stamp();
+	cache->recheck = env != NULL && *env != '\0' && strcmp(env, "0") != 0;
+	cache->contents = oscap_htable_new();
+
+	return (cache);
+}
+
+/* FNV-1a */
+char *cpe_check_cache_key(const char *buffer, size_t size)
+{
+	const uint8_t *p = (const uint8_t *)buffer;
+	uint64_t h = 0xcbf29ce484222325ULL;
+	size_t len = size;
+
+	while (len-- > 0) {
+		h ^= *p++;
+		h *= 0x100000001b3ULL;
+	}
+
+	return (oscap_sprintf("%016llx-%llx", (unsigned long long)h, (unsigned long long)size));
+}
+
+static void cpe_check_content_load(struct cpe_check_cache *cache, struct cpe_check_content *content)
+{
+	char line[PATH_MAX + 256], id[256];
+	struct stat st;
+	size_t len;
+	FILE *fp;
+	int res;
+
+	fp = fopen(content->path, "r");
+	if (fp == NULL) {
+		if (errno != ENOENT)
+			dW("Can't read the applicability cache '%s': %s.", content->path, strerror(errno));
+		return;
+	}
+
+	if (fstat(fileno(fp), &st) != 0 || !cpe_check_cache_private(&st)) {
+		dW("Ignoring the applicability cache '%s', it is accessible by others.", content->path);
+		fclose(fp);
+		return;
+	}
+
+	/* the results of another host or of a changed platform are useless */
+	if (fgets(line, sizeof line, fp) == NULL || strncmp(line, "stamp ", 6) != 0
+	    || strcspn(line + 6, "\n") != strlen(cache->stamp) || strncmp(line + 6, cache->stamp, strlen(cache->stamp)) != 0) {
+		dI("The applicability cache '%s' belongs to another state of the host.", content->path);
+		fclose(fp);
+		return;
+	}
+
+	while (fgets(line, sizeof line, fp) != NULL) {
+		len = strlen(line);
+		if (len > 0 && line[len - 1] == '\n')
+			line[--len] = '\0';
+
+		if (sscanf(line, "definition %255s %d", id, &res) != 2 || (res != 0 && res != 1)) {
+			dW("Ignoring a malformed line of the applicability cache '%s'.", content->path);
+			continue;
+		}
+
+		if (oscap_htable_get(content->results, id) == NULL)
+			oscap_htable_add(content->results, id, res ? &_cpe_check_cache_true : &_cpe_check_cache_false);
+	}
+
+	fclose(fp);
+}
+
+static struct cpe_check_content *cpe_check_cache_content(struct cpe_check_cache *cache, const char *key)
+{
+	struct cpe_check_content *content;
+
+	content = oscap_htable_get(cache->contents, key);
+	if (content != NULL)
+		return (content);
+
+	content = oscap_talloc(struct cpe_check_content);
+	content->path = oscap_sprintf("%s/%s.cpe", cache->dir, key);
+	content->results = oscap_htable_new();
+	content->dirty = false;
+
+	if (!cache->recheck)
+		cpe_check_content_load(cache, content);
+
+	oscap_htable_add(cache->contents, key, content);
+
+	return (content);
+}
+
+int cpe_check_cache_get(struct cpe_check_cache *cache, const char *key, const char *definition_id)
+{
+	void *res;
+
+	if (cache == NULL || key == NULL)
+		return (-1);
+
+	res = oscap_htable_get(cpe_check_cache_content(cache, key)->results, definition_id);
+	if (res == NULL)
+		return (-1);
+
+	dI("Applicability of '%s' decided by the cache: %s.", definition_id,
+	   res == &_cpe_check_cache_true ? "true" : "false");
+
+	return (res == &_cpe_check_cache_true);
+}
+
+void cpe_check_cache_put(struct cpe_check_cache *cache, const char *key, const char *definition_id, bool result)
+{
+	struct cpe_check_content *content;
+
+	if (cache == NULL || key == NULL)
+		return;
+
+	content = cpe_check_cache_content(cache, key);
+
+	if (oscap_htable_get(content->results, definition_id) != NULL)
+		return;
+
+	oscap_htable_add(content->results, definition_id, result ? &_cpe_check_cache_true : &_cpe_check_cache_false);
+	content->dirty = true;
+}
+
+static void cpe_check_content_save(struct cpe_check_cache *cache, struct cpe_check_content *content)
+{
+	struct oscap_htable_iterator *it;
+	const char *id;
+	void *res;
+	char *tmp;
+	FILE *fp;
+	int fd;
+
+	tmp = oscap_sprintf("%s/.tmp-XXXXXX", cache->dir);
+
+	/* write a private file and rename it, readers never see a partial one */
+	fd = mkstemp(tmp);
+	if (fd < 0 || (fp = fdopen(fd, "w")) == NULL) {
+		dW("Can't write the applicability cache '%s': %s.", content->path, strerror(errno));
+		if (fd >= 0) {
+			close(fd);
+			unlink(tmp);
+		}
+		oscap_free(tmp);
+		return;
+	}
+
+	fprintf(fp, "stamp %s\n", cache->stamp);
+
+	it = oscap_htable_iterator_new(content->results);
+	while (oscap_htable_iterator_has_more(it)) {
+		oscap_htable_iterator_next_kv(it, &id, &res);
+		fprintf(fp, "definition %s %d\n", id, res == &_cpe_check_cache_true);
+	}
+	oscap_htable_iterator_free(it);
+
+	if (ferror(fp) | (fclose(fp) != 0) || rename(tmp, content->path) != 0) {
+		dW("Can't write the applicability cache '%s': %s.", content->path, strerror(errno));
+		unlink(tmp);
+	}
+
+	oscap_free(tmp);
+}
+
+void cpe_check_cache_free(struct cpe_check_cache *cache)
+{
+	struct oscap_htable_iterator *it;
+	struct cpe_check_content *content;
+	const char *key;
+
+	if (cache == NULL)
+		return;
+
+	it = oscap_htable_iterator_new(cache->contents);
+	while (oscap_htable_iterator_has_more(it)) {
+		oscap_htable_iterator_next_kv(it, &key, (void **)&content);
+		if (content->dirty)
+			cpe_check_content_save(cache, content);
+	}
+	oscap_htable_iterator_free(it);
+
+	oscap_htable_free(cache->contents, (oscap_destruct_func) cpe_check_content_free);
+	oscap_free(cache->stamp);
+	oscap_free(cache->dir);
+	oscap_free(cache);
+}
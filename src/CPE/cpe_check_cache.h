@@ -0,0 +1,62 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef OSCAP_CPE_CPE_CHECK_CACHE_H
+#define OSCAP_CPE_CPE_CHECK_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "common/util.h"
+
+OSCAP_HIDDEN_START;
+
+/*
+ * Applicability cache
+ *
+ * The results of the OVAL definitions of the CPE checks are kept between
+ * the scans in the directory named by OSCAP_CPE_CACHE, one file per CPE
+ * OVAL content, so that the probes aren't started only to find out the
+ * host is still the same platform. The results are reused as long as the
+ * host identity (the machine id and the probed root) and the stat(2)
+ * stamps of the files the platform checks usually read (the os-release
+ * and release files, the package databases) did not change. Only true and
+ * false results are kept. With OSCAP_CPE_CACHE_RECHECK set the cached
+ * results are ignored and replaced by the ones of this scan.
+ */
+#define CPE_CHECK_CACHE_ENV         "OSCAP_CPE_CACHE"
+#define CPE_CHECK_CACHE_RECHECK_ENV "OSCAP_CPE_CACHE_RECHECK"
+
+struct cpe_check_cache;
+
+/* NULL unless OSCAP_CPE_CACHE names a private directory */
+struct cpe_check_cache *cpe_check_cache_new(void);
+/* writes the new results */
+void cpe_check_cache_free(struct cpe_check_cache *cache);
+
+/* the key of a content */
+char *cpe_check_cache_key(const char *buffer, size_t size);
+
+/* 1 or 0 for a kept result of the definition of the content, -1 otherwise */
+int cpe_check_cache_get(struct cpe_check_cache *cache, const char *key, const char *definition_id);
+void cpe_check_cache_put(struct cpe_check_cache *cache, const char *key, const char *definition_id, bool result);
+
+OSCAP_HIDDEN_END;
+
+#endif
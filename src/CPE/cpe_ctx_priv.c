@@ -36,6 +36,7 @@ struct cpe_parser_ctx {
 	xmlTextReaderPtr reader;
 	bool owns_reader;
 	char *schema_version;
+	bool light;
 };
 
 static inline struct cpe_parser_ctx *_cpe_parser_ctx_new()
@@ -82,3 +83,4 @@ bool cpe_parser_ctx_version_gt(struct cpe_parser_ctx *ctx, const char *version)
 
 OSCAP_GETTER(xmlTextReaderPtr, cpe_parser_ctx, reader);
 OSCAP_SETTER_GENERIC(cpe_parser_ctx, const char *, schema_version, oscap_free, oscap_strdup);
+OSCAP_ACCESSOR_SIMPLE(bool, cpe_parser_ctx, light);
@@ -68,6 +68,16 @@ bool cpe_parser_ctx_version_gt(struct cpe_parser_ctx *ctx, const char *version);
  */
 OSCAP_SETTER_HEADER(cpe_parser_ctx, const char *, schema_version);
 
+/**
+ * Sets the light property of the context. A light parser keeps only the
+ * names, the deprecation and the checks of the dictionary items, which is
+ * what the applicability needs, and skips the titles, notes, references,
+ * metadata and CPE 2.3 extensions.
+ * @param light new value
+ */
+bool cpe_parser_ctx_set_light(struct cpe_parser_ctx *ctx, bool light);
+bool cpe_parser_ctx_get_light(const struct cpe_parser_ctx *ctx);
+
 OSCAP_HIDDEN_END;
 
 #endif
@@ -24,6 +24,9 @@
 #include <config.h>
 #endif
 
+#include <stdlib.h>
+#include <sys/stat.h>
+
 #include "common/alloc.h"
 #include "common/_error.h"
 #include "common/list.h"
@@ -32,10 +35,15 @@
 #include "cpe_session_priv.h"
 #include "CPE/public/cpe_dict.h"
 #include "CPE/public/cpe_lang.h"
+#include "CPE/cpedict_priv.h"
 #include "OVAL/public/oval_agent_api.h"
 #include "source/public/oscap_source.h"
 #include "source/oscap_source_priv.h"
 
+/* values of the applicability memo, the htable needs non-NULL ones */
+static char _cpe_session_applicable;
+static char _cpe_session_not_applicable;
+
 static inline bool cpe_session_add_default_cpe(struct cpe_session *session)
 {
 	char* cpe_dict_path = oscap_sprintf("%s/openscap-cpe-dict.xml", oscap_path_to_cpe());
@@ -53,6 +61,10 @@ struct cpe_session *cpe_session_new(void)
 	cpe->lang_models = oscap_list_new();
 	cpe->oval_sessions = oscap_htable_new();
 	cpe->applicable_platforms = oscap_htable_new();
+	cpe->platform_results = oscap_htable_new();
+	cpe->item_results = oscap_htable_new();
+	cpe->check_cache = cpe_check_cache_new();
+	cpe->check_keys = oscap_htable_new();
 	if (!cpe_session_add_default_cpe(cpe)) {
 		oscap_seterr(OSCAP_EFAMILY_XCCDF, "Failed to add default CPE to newly created CPE Session.");
 	}
@@ -74,6 +86,10 @@ void cpe_session_free(struct cpe_session *session)
 		oscap_list_free(session->lang_models, (oscap_destruct_func) cpe_lang_model_free);
 		oscap_htable_free(session->oval_sessions, (oscap_destruct_func) _xccdf_policy_destroy_cpe_oval_session);
 		oscap_htable_free(session->applicable_platforms, NULL);
+		oscap_htable_free(session->platform_results, NULL);
+		oscap_htable_free(session->item_results, NULL);
+		cpe_check_cache_free(session->check_cache);
+		oscap_htable_free(session->check_keys, (oscap_destruct_func) oscap_free);
 		oscap_free(session);
 	}
 }
@@ -118,15 +134,26 @@ struct oval_agent_session *cpe_session_lookup_oval_session(struct cpe_session *c
 	return session;
 }
 
+static void _cpe_session_forget_results(struct cpe_session *session)
+{
+	// a new dictionary or lang model may make other platforms applicable
+	oscap_htable_free(session->platform_results, NULL);
+	oscap_htable_free(session->item_results, NULL);
+	session->platform_results = oscap_htable_new();
+	session->item_results = oscap_htable_new();
+}
+
 bool cpe_session_add_cpe_lang_model_source(struct cpe_session *session, struct oscap_source *source)
 {
 	struct cpe_lang_model *lang_model = cpe_lang_model_import_source(source);
+	_cpe_session_forget_results(session);
 	return oscap_list_add(session->lang_models, lang_model);
 }
 
 bool cpe_session_add_cpe_dict_source(struct cpe_session *session, struct oscap_source *source)
 {
-	struct cpe_dict_model *dict = cpe_dict_model_import_source(source);
+	struct cpe_dict_model *dict = cpe_dict_model_import_source_light(source);
+	_cpe_session_forget_results(session);
 	return oscap_list_add(session->dicts, dict);
 }
 
@@ -148,3 +175,82 @@ void cpe_session_set_cache(struct cpe_session *session, struct oscap_htable *sou
 {
 	session->sources_cache = sources_cache;
 }
+
+static inline int _cpe_session_get_result(struct oscap_htable *results, const char *key)
+{
+	const void *result = key != NULL ? oscap_htable_get(results, key) : NULL;
+	if (result == NULL) {
+		return -1;
+	}
+	return result == &_cpe_session_applicable;
+}
+
+static inline void _cpe_session_set_result(struct oscap_htable *results, const char *key, bool applicable)
+{
+	if (key != NULL) {
+		oscap_htable_add(results, key, applicable ? &_cpe_session_applicable : &_cpe_session_not_applicable);
+	}
+}
+
+int cpe_session_get_platform_result(struct cpe_session *session, const char *platform)
+{
+	return _cpe_session_get_result(session->platform_results, platform);
+}
+
+void cpe_session_set_platform_result(struct cpe_session *session, const char *platform, bool applicable)
+{
+	_cpe_session_set_result(session->platform_results, platform, applicable);
+}
+
+int cpe_session_get_item_result(struct cpe_session *session, const char *item_id)
+{
+	return _cpe_session_get_result(session->item_results, item_id);
+}
+
+void cpe_session_set_item_result(struct cpe_session *session, const char *item_id, bool applicable)
+{
+	_cpe_session_set_result(session->item_results, item_id, applicable);
+}
+
+static const char *_cpe_session_check_key(struct cpe_session *session, const char *prefixed_href)
+{
+	struct oscap_source *source;
+	struct stat st;
+	char *key, *buffer = NULL;
+	size_t size = 0;
+
+	if (session->check_cache == NULL || prefixed_href == NULL)
+		return NULL;
+
+	key = oscap_htable_get(session->check_keys, prefixed_href);
+	if (key != NULL)
+		return *key != '\0' ? key : NULL;
+
+	// the content is hashed once, the same way whether it is a file or a component of a datastream
+	source = _lookup_source_in_cache(session, prefixed_href);
+	if (source != NULL) {
+		if (oscap_source_get_raw_memory(source, &buffer, &size) != 0)
+			buffer = NULL;
+	} else if (stat(prefixed_href, &st) == 0 && S_ISREG(st.st_mode)) {
+		source = oscap_source_new_from_file(prefixed_href);
+		if (oscap_source_get_raw_memory(source, &buffer, &size) != 0)
+			buffer = NULL;
+		oscap_source_free(source);
+	}
+
+	key = buffer != NULL ? cpe_check_cache_key(buffer, size) : oscap_strdup("");
+	free(buffer);
+	oscap_htable_add(session->check_keys, prefixed_href, key);
+
+	return *key != '\0' ? key : NULL;
+}
+
+int cpe_session_get_check_result(struct cpe_session *session, const char *prefixed_href, const char *definition_id)
+{
+	return cpe_check_cache_get(session->check_cache, _cpe_session_check_key(session, prefixed_href), definition_id);
+}
+
+void cpe_session_set_check_result(struct cpe_session *session, const char *prefixed_href, const char *definition_id, bool result)
+{
+	cpe_check_cache_put(session->check_cache, _cpe_session_check_key(session, prefixed_href), definition_id, result);
+}
@@ -29,6 +29,7 @@
 #include "common/public/oscap.h"
 #include "common/util.h"
 #include "OVAL/public/oval_agent_api.h"
+#include "cpe_check_cache.h"
 
 OSCAP_HIDDEN_START;
 
@@ -37,7 +38,11 @@ struct cpe_session {
 	struct oscap_list *lang_models;                 ///< All CPE lang models except the one embedded in XCCDF
 	struct oscap_htable *oval_sessions;             ///< Caches CPE OVAL check results
 	struct oscap_htable *applicable_platforms;
+	struct oscap_htable *platform_results;          ///< Caches applicability decisions [platform -> result]
+	struct oscap_htable *item_results;              ///< Caches applicability decisions [XCCDF item id -> result]
 	struct oscap_htable *sources_cache;             ///< Not owned cache [path -> oscap_source]
+	struct cpe_check_cache *check_cache;            ///< Results of the CPE OVAL checks of the previous scans, see cpe_check_cache.h
+	struct oscap_htable *check_keys;                ///< Keys of the CPE OVAL contents in the check cache [path -> key]
 };
 
 struct cpe_session *cpe_session_new(void);
@@ -48,5 +53,23 @@ bool cpe_session_add_cpe_dict_source(struct cpe_session *session, struct oscap_s
 bool cpe_session_add_cpe_autodetect_source(struct cpe_session *session, struct oscap_source *source);
 void cpe_session_set_cache(struct cpe_session *session, struct oscap_htable *sources_cache);
 
+/*
+ * The memo of applicability decisions. A lookup returns 1 or 0 for a decided
+ * key and -1 otherwise. The decisions are forgotten when a CPE dictionary or
+ * lang model is added to the session.
+ */
+int cpe_session_get_platform_result(struct cpe_session *session, const char *platform);
+void cpe_session_set_platform_result(struct cpe_session *session, const char *platform, bool applicable);
+int cpe_session_get_item_result(struct cpe_session *session, const char *item_id);
+void cpe_session_set_item_result(struct cpe_session *session, const char *item_id, bool applicable);
+
+/*
+ * The results of the definitions of the CPE OVAL content at prefixed_href
+ * kept by the previous scans, see cpe_check_cache.h. A lookup returns 1 or
+ * 0 for a kept result and -1 otherwise.
+ */
+int cpe_session_get_check_result(struct cpe_session *session, const char *prefixed_href, const char *definition_id);
+void cpe_session_set_check_result(struct cpe_session *session, const char *prefixed_href, const char *definition_id, bool result);
+
 OSCAP_HIDDEN_END;
 #endif
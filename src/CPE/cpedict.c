@@ -43,19 +43,23 @@
 #include "common/xmltext_priv.h"
 #include "source/oscap_source_priv.h"
 #include "source/public/oscap_source.h"
+#include <ctype.h>
 #include <string.h>
 
 #define CPE_DICT_SUPPORTED "2.3"
 
-struct cpe_dict_model *cpe_dict_model_import_source(struct oscap_source *source)
+static struct cpe_dict_model *_cpe_dict_model_import_source(struct oscap_source *source, bool light)
 {
-	xmlTextReader *reader = oscap_source_get_xmlTextReader(source);
+	// the light dictionary is read without building the DOM of the source
+	xmlTextReader *reader = light ?
+		oscap_source_get_streaming_xmlTextReader(source) : oscap_source_get_xmlTextReader(source);
 	if (reader == NULL) {
 		return NULL;
 	}
 	struct cpe_dict_model *dict = NULL;
 	struct cpe_parser_ctx *ctx = cpe_parser_ctx_from_reader(reader);
 	if (ctx) {
+		cpe_parser_ctx_set_light(ctx, light);
 		xmlTextReaderNextNode(cpe_parser_ctx_get_reader(ctx));
 		dict = cpe_dict_model_parse(ctx);
 		if (dict != NULL) {
@@ -67,6 +71,16 @@ struct cpe_dict_model *cpe_dict_model_import_source(struct oscap_source *source)
 	return dict;
 }
 
+struct cpe_dict_model *cpe_dict_model_import_source(struct oscap_source *source)
+{
+	return _cpe_dict_model_import_source(source, false);
+}
+
+struct cpe_dict_model *cpe_dict_model_import_source_light(struct oscap_source *source)
+{
+	return _cpe_dict_model_import_source(source, true);
+}
+
 struct cpe_dict_model *cpe_dict_model_import(const char *file)
 {
 	__attribute__nonnull__(file);
@@ -103,34 +117,125 @@ void cpe_dict_model_export(const struct cpe_dict_model *dict, const char *file)
 
 }
 
-bool cpe_name_match_dict(struct cpe_name * cpe, struct cpe_dict_model * dict)
+/* Key of the index, NULL components are empty as in cpe_name_match_one */
+static char *cpe_dict_index_key(const struct cpe_name *name)
 {
-	// FIXME: We could match faster by matching per component and storing all
-	//        cpe_dict items in a big tree where leaves contain cpe_items and
-	//        inner nodes are the components.
+	const char *vendor = cpe_name_get_vendor(name);
+	const char *product = cpe_name_get_product(name);
+	char *key = oscap_sprintf("%d:%s:%s", cpe_name_get_part(name),
+			vendor != NULL ? vendor : "", product != NULL ? product : "");
+
+	// the components are compared case insensitively
+	for (char *c = key; *c != '\0'; ++c)
+		*c = tolower((unsigned char) *c);
+	return key;
+}
 
-	__attribute__nonnull__(cpe);
-	__attribute__nonnull__(dict);
+static bool cpe_name_has_index_key(const struct cpe_name *name)
+{
+	return name != NULL && cpe_name_get_part(name) != CPE_PART_NONE &&
+		cpe_name_get_vendor(name) != NULL && cpe_name_get_product(name) != NULL;
+}
 
-	if (cpe == NULL || dict == NULL)
-		return false;
+static void cpe_dict_index_list_free(struct oscap_list *list)
+{
+	oscap_list_free(list, NULL);
+}
+
+void cpe_dict_model_free_index(struct cpe_dict_model *dict)
+{
+	oscap_htable_free(dict->index, (oscap_destruct_func) cpe_dict_index_list_free);
+	oscap_list_free(dict->index_wildcards, NULL);
+	dict->index = NULL;
+	dict->index_wildcards = NULL;
+}
+
+void cpe_dict_model_build_index(struct cpe_dict_model *dict)
+{
+	if (dict == NULL)
+		return;
+
+	cpe_dict_model_free_index(dict);
+	dict->index_itemcount = oscap_list_get_itemcount(dict->items);
+	// the official dictionary has hundreds of thousands of items, size the table for them
+	dict->index = oscap_htable_new1(strcmp, dict->index_itemcount / 2 + 1);
+	dict->index_wildcards = oscap_list_new();
 
 	struct cpe_item_iterator *items = cpe_dict_model_get_items(dict);
+	while (cpe_item_iterator_has_more(items)) {
+		struct cpe_item *item = cpe_item_iterator_next(items);
+		struct cpe_name *name = cpe_item_get_name(item);
 
+		if (name == NULL)
+			continue;
+
+		char *key = cpe_dict_index_key(name);
+		struct oscap_list *bucket = oscap_htable_get(dict->index, key);
+		if (bucket == NULL) {
+			bucket = oscap_list_new();
+			oscap_htable_add(dict->index, key, bucket);
+		}
+		oscap_list_add(bucket, item);
+		oscap_free(key);
+
+		// a missing component of a dictionary name matches any component
+		if (!cpe_name_has_index_key(name))
+			oscap_list_add(dict->index_wildcards, item);
+	}
+	cpe_item_iterator_free(items);
+}
+
+static void cpe_dict_model_check_index(struct cpe_dict_model *dict)
+{
+	if (dict->index == NULL || dict->index_itemcount != oscap_list_get_itemcount(dict->items))
+		cpe_dict_model_build_index(dict);
+}
+
+/* the items whose name has the same part, vendor and product as the given name */
+static struct oscap_list *cpe_dict_model_lookup(struct cpe_dict_model *dict, const struct cpe_name *cpe)
+{
+	char *key = cpe_dict_index_key(cpe);
+	struct oscap_list *bucket = oscap_htable_get(dict->index, key);
+	oscap_free(key);
+	return bucket;
+}
+
+static bool cpe_dict_items_match(struct oscap_list *items, const struct cpe_name *cpe)
+{
 	bool ret = false;
-	while (cpe_item_iterator_has_more(items)) {
-		struct cpe_item* item = cpe_item_iterator_next(items);
-		struct cpe_name* name = cpe_item_get_name(item);
 
-		if (cpe_name_match_one(name, cpe)) {
+	if (items == NULL)
+		return false;
+
+	struct oscap_iterator *it = oscap_iterator_new(items);
+	while (oscap_iterator_has_more(it)) {
+		struct cpe_item *item = oscap_iterator_next(it);
+
+		if (cpe_name_match_one(cpe_item_get_name(item), cpe)) {
 			ret = true;
 			break;
 		}
 	}
-	cpe_item_iterator_free(items);
+	oscap_iterator_free(it);
 	return ret;
 }
 
+bool cpe_name_match_dict(struct cpe_name * cpe, struct cpe_dict_model * dict)
+{
+	__attribute__nonnull__(cpe);
+	__attribute__nonnull__(dict);
+
+	if (cpe == NULL || dict == NULL)
+		return false;
+
+	cpe_dict_model_check_index(dict);
+
+	// dictionary names with all of part, vendor and product match only
+	// the names with the same ones, the others are tried one by one
+	return cpe_dict_items_match(cpe_dict_model_lookup(dict, cpe), cpe) ||
+		cpe_dict_items_match(dict->index_wildcards, cpe);
+}
+
 bool cpe_name_match_dict_str(const char *cpestr, struct cpe_dict_model * dict)
 {
 	__attribute__nonnull__(cpestr);
@@ -149,24 +254,31 @@ bool cpe_name_match_dict_str(const char *cpestr, struct cpe_dict_model * dict)
 
 bool cpe_name_applicable_dict(struct cpe_name *cpe, struct cpe_dict_model *dict, cpe_check_fn cb, void* usr)
 {
-	// FIXME: We could match faster by matching per component and storing all
-	//        cpe_dict items in a big tree where leaves contain cpe_items and
-	//        inner nodes are the components.
-
 	__attribute__nonnull__(cpe);
 	__attribute__nonnull__(dict);
 
 	if (cpe == NULL || dict == NULL)
 		return false;
 
-	struct cpe_item_iterator *items = cpe_dict_model_get_items(dict);
+	// a name with all of part, vendor and product matches only the dictionary
+	// names with the same ones, a name with a missing component is a pattern
+	// which has to be tried on the whole dictionary
+	struct oscap_iterator *items;
+	if (cpe_name_has_index_key(cpe)) {
+		cpe_dict_model_check_index(dict);
+		struct oscap_list *bucket = cpe_dict_model_lookup(dict, cpe);
+		if (bucket == NULL)
+			return false;
+		items = oscap_iterator_new(bucket);
+	} else
+		items = oscap_iterator_new(dict->items);
 
 	// essentially, we want at least one applicable match so as soon as we find
 	// a match we break and return true
 
 	bool ret = false;
-	while (cpe_item_iterator_has_more(items)) {
-		struct cpe_item* item = cpe_item_iterator_next(items);
+	while (oscap_iterator_has_more(items)) {
+		struct cpe_item* item = oscap_iterator_next(items);
 		struct cpe_name* name = cpe_item_get_name(item);
 
 		if (cpe_name_match_one(cpe, name)) {
@@ -176,7 +288,7 @@ bool cpe_name_applicable_dict(struct cpe_name *cpe, struct cpe_dict_model *dict,
 			}
 		}
 	}
-	cpe_item_iterator_free(items);
+	oscap_iterator_free(items);
 	return ret;
 }
 
@@ -619,6 +619,7 @@ struct cpe_dict_model *cpe_dict_model_parse(struct cpe_parser_ctx *ctx)
 		next_ret = xmlTextReaderNextElementWE(reader, TAG_CPE_LIST_STR);
 	}
 
+	cpe_dict_model_build_index(ret);
 	return ret;
 }
 
@@ -679,6 +680,17 @@ struct cpe_generator *cpe_generator_parse(struct cpe_parser_ctx *ctx)
 
 }
 
+/* children of cpe-item which the light parser skips */
+static bool cpe_item_child_is_detail(const xmlChar *name)
+{
+	return xmlStrcmp(name, TAG_TITLE_STR) == 0 ||
+		xmlStrcmp(name, TAG_NOTES_STR) == 0 ||
+		xmlStrcmp(name, TAG_REFERENCES_STR) == 0 ||
+		xmlStrcmp(name, TAG_REFERENCE_STR) == 0 ||
+		xmlStrcmp(name, TAG_ITEM_METADATA_STR) == 0 ||
+		xmlStrcmp(name, BAD_CAST TAG_CPE23_ITEM_STR) == 0;
+}
+
 struct cpe_item *cpe_item_parse(struct cpe_parser_ctx *ctx)
 {
 	__attribute__nonnull__(ctx);
@@ -743,6 +755,12 @@ struct cpe_item *cpe_item_parse(struct cpe_parser_ctx *ctx)
 				continue;
 			}
 
+			if (cpe_parser_ctx_get_light(ctx) && cpe_item_child_is_detail(xmlTextReaderConstLocalName(reader))) {
+				// jump over the whole element, the applicability doesn't need it
+				xmlTextReaderNext(reader);
+				continue;
+			}
+
 			if (xmlStrcmp(xmlTextReaderConstLocalName(reader), TAG_TITLE_STR) == 0) {
 				oscap_list_add(ret->titles, oscap_text_new_parse(OSCAP_TEXT_TRAITS_PLAIN, reader));
 			} else if (xmlStrcmp(xmlTextReaderConstLocalName(reader), TAG_NOTES_STR) == 0) {
@@ -1324,6 +1342,7 @@ void cpe_dict_model_free(struct cpe_dict_model *dict)
 	if (dict == NULL)
 		return;
 
+	cpe_dict_model_free_index(dict);
 	oscap_list_free(dict->items, (oscap_destruct_func) cpe_item_free);
 	oscap_list_free(dict->vendors, (oscap_destruct_func) cpe_vendor_free);
 	cpe_generator_free(dict->generator);
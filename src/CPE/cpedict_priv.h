@@ -129,8 +129,34 @@ struct cpe_dict_model {		// the main node
 	int base_version;
 	struct cpe_generator *generator;
 	char* origin_file;
+	struct oscap_htable *index;	// part:vendor:product -> list of items, see cpe_dict_model_build_index
+	struct oscap_list *index_wildcards;	// items without part, vendor or product
+	int index_itemcount;		// number of items when the index was built
 };
 
+/**
+ * Import the CPE dictionary for the applicability only. The items keep
+ * their names, deprecation and checks, the rest is not loaded.
+ * Such a dictionary must not be exported.
+ * @param source the dictionary
+ * @returns the dictionary or NULL
+ */
+struct cpe_dict_model *cpe_dict_model_import_source_light(struct oscap_source *source);
+
+/**
+ * Index the dictionary items by their part, vendor and product, so the
+ * matching functions look only at the items which may match.
+ * The index is rebuilt by the matching functions when the items change.
+ * @param dict CPE dictionary
+ */
+void cpe_dict_model_build_index(struct cpe_dict_model *dict);
+
+/**
+ * Free the index of the dictionary items
+ * @param dict CPE dictionary
+ */
+void cpe_dict_model_free_index(struct cpe_dict_model *dict);
+
 /** 
  * @cond INTERNAL
  */
@@ -62,6 +62,18 @@ struct cve_model *cve_model_import(const char *file)
 	return cve;
 }
 
+int cve_model_import_entries(const char *file, cve_entry_fn callback, void *user)
+{
+
+	__attribute__nonnull__(file);
+	__attribute__nonnull__(callback);
+
+	if (file == NULL || callback == NULL)
+		return -1;
+
+	return cve_model_parse_entries_xml(file, callback, user);
+}
+
 /**
  * Public function to export CVE model to OSCAP export target.
  * Function fill the structure _target_ with model that is represented by structure
@@ -33,6 +33,7 @@
 #include <config.h>
 #endif
 
+#include <ctype.h>
 #include <string.h>
 
 #include <libxml/xmlreader.h>
@@ -66,6 +67,12 @@ struct cve_model {
 	char  *pub_date;
 	char  *nvd_xml_version;
 	struct oscap_list *entries;	/* 1-n */
+	struct {
+		struct oscap_htable *ids;	/* CVE ID -> entry */
+		struct oscap_htable *products;	/* part:vendor:product -> list of entries */
+		struct oscap_list *none;	/* empty list for the products without entries */
+		int entrycount;			/* number of entries when the index was built */
+	} index;
 };
     OSCAP_IGETINS_GEN(cve_entry, cve_model, entries, entry)
     OSCAP_ITERATOR_REMOVE_F(cve_entry)
@@ -387,6 +394,148 @@ struct cve_model * cve_model_clone(struct cve_model * old_model)
  * */
 /***************************************************************************/
 
+/***************************************************************************/
+/* Index of the CVE entries
+ */
+
+/* key of the product of the CPE name, the version and the rest don't matter */
+static char *cve_product_key(const char *cpe)
+{
+	struct cpe_name *name = cpe_name_new(cpe);
+	if (name == NULL)
+		return NULL;
+
+	const char *vendor = cpe_name_get_vendor(name);
+	const char *product = cpe_name_get_product(name);
+	char *key = oscap_sprintf("%d:%s:%s", cpe_name_get_part(name),
+			vendor != NULL ? vendor : "", product != NULL ? product : "");
+	cpe_name_free(name);
+
+	// the components are compared case insensitively
+	for (char *c = key; *c != '\0'; ++c)
+		*c = tolower((unsigned char) *c);
+	return key;
+}
+
+static void cve_model_index_product(struct cve_model *model, struct cve_entry *entry, const char *cpe)
+{
+	char *key = cve_product_key(cpe);
+	if (key == NULL)
+		return;
+
+	struct oscap_list *bucket = oscap_htable_get(model->index.products, key);
+	if (bucket == NULL) {
+		bucket = oscap_list_new();
+		oscap_htable_add(model->index.products, key, bucket);
+	}
+	// an entry names a product in several versions, list it once
+	if (oscap_list_get_itemcount(bucket) == 0 || bucket->last->data != entry)
+		oscap_list_add(bucket, entry);
+	oscap_free(key);
+}
+
+static void cve_model_index_testexpr(struct cve_model *model, struct cve_entry *entry, const struct cpe_testexpr *expr)
+{
+	if (expr == NULL)
+		return;
+
+	switch (cpe_testexpr_get_oper(expr) & CPE_LANG_OPER_MASK) {
+	case CPE_LANG_OPER_MATCH: {
+		char *cpe = cpe_name_get_as_str(cpe_testexpr_get_meta_cpe(expr));
+		if (cpe != NULL)
+			cve_model_index_product(model, entry, cpe);
+		oscap_free(cpe);
+		break;
+	}
+	case CPE_LANG_OPER_AND:
+	case CPE_LANG_OPER_OR: {
+		struct cpe_testexpr_iterator *it = cpe_testexpr_get_meta_expr(expr);
+		while (cpe_testexpr_iterator_has_more(it))
+			cve_model_index_testexpr(model, entry, cpe_testexpr_iterator_next(it));
+		cpe_testexpr_iterator_free(it);
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+static void cve_index_list_free(struct oscap_list *list)
+{
+	oscap_list_free(list, NULL);
+}
+
+static void cve_model_free_index(struct cve_model *model)
+{
+	oscap_htable_free(model->index.ids, NULL);
+	oscap_htable_free(model->index.products, (oscap_destruct_func) cve_index_list_free);
+	oscap_list_free(model->index.none, NULL);
+	memset(&model->index, 0, sizeof(model->index));
+}
+
+/* build the index on the first lookup and again when the entries change */
+static void cve_model_check_index(struct cve_model *model)
+{
+	if (model->index.ids != NULL && model->index.entrycount == oscap_list_get_itemcount(model->entries))
+		return;
+
+	cve_model_free_index(model);
+	model->index.entrycount = oscap_list_get_itemcount(model->entries);
+	// NVD yearly feeds hold tens of thousands of entries, size the tables for them
+	model->index.ids = oscap_htable_new1(strcmp, model->index.entrycount / 2 + 1);
+	model->index.products = oscap_htable_new1(strcmp, model->index.entrycount / 2 + 1);
+	model->index.none = oscap_list_new();
+
+	struct oscap_iterator *entries = oscap_iterator_new(model->entries);
+	while (oscap_iterator_has_more(entries)) {
+		struct cve_entry *entry = oscap_iterator_next(entries);
+
+		if (entry->id != NULL)
+			oscap_htable_add(model->index.ids, entry->id, entry);
+
+		struct oscap_iterator *products = oscap_iterator_new(entry->products);
+		while (oscap_iterator_has_more(products)) {
+			struct cve_product *product = oscap_iterator_next(products);
+			if (product->value != NULL)
+				cve_model_index_product(model, entry, product->value);
+		}
+		oscap_iterator_free(products);
+
+		struct oscap_iterator *confs = oscap_iterator_new(entry->configurations);
+		while (oscap_iterator_has_more(confs)) {
+			struct cve_configuration *conf = oscap_iterator_next(confs);
+			cve_model_index_testexpr(model, entry, conf->expr);
+		}
+		oscap_iterator_free(confs);
+	}
+	oscap_iterator_free(entries);
+}
+
+struct cve_entry *cve_model_get_entry_by_id(struct cve_model *cve_model, const char *id)
+{
+	if (cve_model == NULL || id == NULL)
+		return NULL;
+
+	cve_model_check_index(cve_model);
+	return oscap_htable_get(cve_model->index.ids, id);
+}
+
+struct cve_entry_iterator *cve_model_get_entries_by_product(struct cve_model *cve_model, const char *cpe)
+{
+	__attribute__nonnull__(cve_model);
+
+	cve_model_check_index(cve_model);
+
+	struct oscap_list *bucket = NULL;
+	char *key = cpe != NULL ? cve_product_key(cpe) : NULL;
+	if (key != NULL)
+		bucket = oscap_htable_get(cve_model->index.products, key);
+	oscap_free(key);
+
+	return (struct cve_entry_iterator *) oscap_iterator_new(bucket != NULL ? bucket : cve_model->index.none);
+}
+/***************************************************************************/
+
 /***************************************************************************/
 /* Private parsing functions cve_*<structure>*_parse( xmlTextReaderPtr )
  * More info in representive header file.
@@ -421,6 +570,50 @@ struct cve_model *cve_model_parse_xml(const char *file)
 	return ret;
 }
 
+int cve_model_parse_entries_xml(const char *file, cve_entry_fn callback, void *user)
+{
+
+	__attribute__nonnull__(file);
+
+	int ret = 0;
+
+	struct oscap_source *source = oscap_source_new_from_file(file);
+	// the entries are parsed as the file is read, without its DOM
+	xmlTextReader *reader = oscap_source_get_streaming_xmlTextReader(source);
+	if (!reader) {
+		oscap_source_free(source);
+		return -1;
+	}
+
+	if (xmlTextReaderNextNode(reader) == -1 ||
+	    xmlStrcmp(xmlTextReaderConstLocalName(reader), TAG_NVD_STR) ||
+	    xmlTextReaderNodeType(reader) != XML_READER_TYPE_ELEMENT) {
+		oscap_seterr(OSCAP_EFAMILY_OSCAP, "Expected root element '%s' in CVE feed '%s'.", TAG_NVD_STR, file);
+		xmlFreeTextReader(reader);
+		oscap_source_free(source);
+		return -1;
+	}
+
+	/* skip nodes until new element */
+	xmlTextReaderNextElement(reader);
+
+	/* CVE-specification: entry */
+	while (ret == 0 && xmlStrcmp(xmlTextReaderConstLocalName(reader), TAG_CVE_STR) == 0) {
+
+		struct cve_entry *entry = cve_entry_parse(reader);
+		if (entry) {
+			ret = callback(entry, user);
+			cve_entry_free(entry);
+		}
+		if (xmlTextReaderNextElement(reader) == -1)
+			ret = -1;
+	}
+
+	xmlFreeTextReader(reader);
+	oscap_source_free(source);
+	return ret;
+}
+
 struct cve_model *cve_model_parse(xmlTextReaderPtr reader)
 {
 
@@ -774,6 +967,7 @@ void cve_model_free(struct cve_model *cve_model)
 	if (cve_model == NULL)
 		return;
 
+	cve_model_free_index(cve_model);
 	oscap_list_free(cve_model->entries, (oscap_destruct_func) cve_entry_free);
 	oscap_free(cve_model->pub_date);
 	oscap_free(cve_model->nvd_xml_version);
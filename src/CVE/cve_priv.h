@@ -95,6 +95,15 @@ struct cve_model *cve_model_parse_xml(const char *file);
  */
 struct cve_model *cve_model_parse(xmlTextReaderPtr reader);
 
+/**
+ * Parse the CVE entries of the XML file one by one
+ * @param file OSCAP import source
+ * @param callback function called for each entry, the entry is freed after it
+ * @param user user data passed to the callback
+ * @return 0 on success, -1 on error or the non-zero value returned by the callback
+ */
+int cve_model_parse_entries_xml(const char *file, cve_entry_fn callback, void *user);
+
 /**
  * Parse CVE entry
  * @param reader XML Text Reader representing XML model
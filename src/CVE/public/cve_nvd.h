@@ -93,6 +93,27 @@ struct cvss_impact;
  */
 struct cve_entry_iterator *cve_model_get_entries(const struct cve_model *cve_model);
 
+/**
+ * Get the CVE entry with the given ID. The entries are looked up in
+ * an index which is built on the first lookup.
+ * @param cve_model CVE model
+ * @param id CVE ID, e.g. CVE-2016-0001
+ * @memberof cve_model
+ * @return the entry or NULL if there is no such entry
+ */
+struct cve_entry *cve_model_get_entry_by_id(struct cve_model *cve_model, const char *id);
+
+/**
+ * Get an iterator to the CVE entries whose vulnerable software list or
+ * configurations name the product of the given CPE name, regardless of
+ * its version. The entries are looked up in an index which is built
+ * on the first lookup. Don't remove the entries through this iterator.
+ * @param cve_model CVE model
+ * @param cpe CPE name, e.g. cpe:/a:openssl:openssl:1.0.1
+ * @memberof cve_model
+ */
+struct cve_entry_iterator *cve_model_get_entries_by_product(struct cve_model *cve_model, const char *cpe);
+
 /**
  * Get CVE entry ID
  * @param item CVE entry
@@ -672,6 +693,28 @@ void cve_model_export(struct cve_model *cve, const char *file);
  */
 struct cve_model *cve_model_import(const char *file);
 
+/**
+ * Callback for the CVE entries of cve_model_import_entries.
+ * The entry is freed when the callback returns, clone it to keep it.
+ * @param entry parsed CVE entry
+ * @param user user data given to cve_model_import_entries
+ * @return zero to continue with the next entry, non-zero to stop the import
+ */
+typedef int (*cve_entry_fn) (struct cve_entry *entry, void *user);
+
+/**
+ * Parse the specified XML file entry by entry. Unlike cve_model_import the
+ * entries are passed to the callback as soon as they are parsed and the feed
+ * is never held in memory as a whole.
+ * @memberof cve_model
+ * @param file filename
+ * @param callback function called for each CVE entry
+ * @param user user data passed to the callback
+ * @return 0 when all the entries were passed, -1 on error or the non-zero
+ * value of the callback which stopped the import
+ */
+int cve_model_import_entries(const char *file, cve_entry_fn callback, void *user);
+
 /// @memberof cve_model
 const char *cve_model_get_nvd_xml_version(const struct cve_model *item);
 /// @memberof cve_model
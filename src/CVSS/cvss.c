@@ -37,6 +37,8 @@
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
+#include <ctype.h>
+#include <pthread.h>
 
 #include "public/cvss_score.h"
 #include "cvss_priv.h"
@@ -401,14 +403,20 @@ float cvss_impact_base_impact_subscore(const struct cvss_impact* impact)
     return 10.41 * (1.0 - (1.0 - CVSS_W(confidentiality_impact)) * (1.0 - CVSS_W(integrity_impact)) * (1.0 - CVSS_W(availability_impact)));
 }
 
+// base score from its subscores, shared with the packed scoring
+static inline float cvss_base_score_from(float imp_s, float exp_s)
+{
+    float f_imp = (imp_s == 0.0 ? 0.0 : 1.176);
+    return cvss_round((0.6 * imp_s + 0.4 * exp_s - 1.5) * f_imp);
+}
+
 static inline float cvss_impact_base_score_impl(const struct cvss_impact* impact, cvss_score_func impact_score_calculator)
 {
     assert(impact);
     if (!cvss_metrics_is_valid(impact->base_metrics)) return NAN;
     float imp_s = impact_score_calculator(impact);
     float exp_s = cvss_impact_base_exploitability_subscore(impact);
-    float f_imp = (imp_s == 0.0 ? 0.0 : 1.176);
-    return cvss_round((0.6 * imp_s + 0.4 * exp_s - 1.5) * f_imp);
+    return cvss_base_score_from(imp_s, exp_s);
 }
 
 float cvss_impact_base_score(const struct cvss_impact* impact)
@@ -465,6 +473,222 @@ float cvss_impact_environmental_score(const struct cvss_impact* impact)
     return cvss_round((temp_s + (10.0 - temp_s) * CVSS_W(collateral_damage_potential)) * CVSS_W(target_distribution));
 }
 
+/*
+ * Packed vectors
+ *
+ * Every component is a bit field of the packed vector, in the order of
+ * the keys. The base fields form the index of the base score table, the
+ * exploitability and the (adjusted) impact tables are indexed by their
+ * slices of the base fields and the requirements.
+ */
+struct cvss_packtab_entry {
+    enum cvss_key key;
+    unsigned shift;
+    unsigned bits;
+};
+
+static const struct cvss_packtab_entry CVSS_PACKTAB[] = {
+    { CVSS_KEY_access_vector,               10, 2 },
+    { CVSS_KEY_access_complexity,            8, 2 },
+    { CVSS_KEY_authentication,               6, 2 },
+    { CVSS_KEY_confidentiality_impact,       4, 2 },
+    { CVSS_KEY_integrity_impact,             2, 2 },
+    { CVSS_KEY_availability_impact,          0, 2 },
+    { CVSS_KEY_exploitability,              12, 3 },
+    { CVSS_KEY_remediation_level,           15, 3 },
+    { CVSS_KEY_report_confidence,           18, 2 },
+    { CVSS_KEY_collateral_damage_potential, 20, 3 },
+    { CVSS_KEY_target_distribution,         23, 3 },
+    { CVSS_KEY_confidentiality_requirement, 26, 2 },
+    { CVSS_KEY_integrity_requirement,       28, 2 },
+    { CVSS_KEY_availability_requirement,    30, 2 },
+    { CVSS_KEY_NONE, 0, 0 }
+};
+
+#define CVSS_PACKED_FIELD(p, shift, bits) ((unsigned)((p) >> (shift)) & ((1u << (bits)) - 1))
+
+static const struct cvss_packtab_entry *cvss_packtab(enum cvss_key key)
+{
+    const struct cvss_packtab_entry *e;
+    for (e = CVSS_PACKTAB; e->key != CVSS_KEY_NONE; ++e)
+        if (e->key == key)
+            break;
+    return e;
+}
+
+static uint64_t cvss_packed_set(uint64_t packed, enum cvss_key key, unsigned val)
+{
+    const struct cvss_packtab_entry *e = cvss_packtab(key);
+    uint64_t mask = ((uint64_t)1 << e->bits) - 1;
+
+    packed |= (uint64_t)(val & mask) << e->shift;
+    if (CVSS_CATEGORY(key) == CVSS_TEMPORAL)      packed |= CVSS_PACKED_TEMPORAL;
+    if (CVSS_CATEGORY(key) == CVSS_ENVIRONMENTAL) packed |= CVSS_PACKED_ENVIRONMENTAL;
+    return packed;
+}
+
+bool cvss_vector_pack(const char *cvss_vector, uint64_t *packed)
+{
+    const struct cvss_valtab_entry *entry;
+    const char *s, *end;
+    char comp[8];
+    size_t len, i;
+
+    assert(packed != NULL);
+    *packed = 0;
+    if (cvss_vector == NULL) return false;
+
+    s = cvss_vector;
+    end = s + strlen(s);
+
+    // vector in parenthesis
+    if (*s == '(') {
+        if (end == s + 1 || end[-1] != ')') return false;
+        ++s;
+        --end;
+    }
+
+    while (s < end) {
+        for (len = 0; s + len < end && s[len] != '/'; ++len)
+            ;
+        if (len == 0 || len >= sizeof comp) return false;
+        for (i = 0; i < len; ++i)
+            comp[i] = toupper((unsigned char)s[i]);
+        comp[len] = '\0';
+
+        entry = cvss_valtab(0, 0, comp, NULL);
+        if (entry->key == CVSS_KEY_NONE) return false;
+        *packed = cvss_packed_set(*packed, entry->key, entry->value);
+
+        s += len;
+        if (s < end) ++s;
+    }
+
+    return true;
+}
+
+uint64_t cvss_impact_pack(const struct cvss_impact *impact)
+{
+    const struct cvss_packtab_entry *e;
+    const struct cvss_metrics *metrics;
+    uint64_t packed = 0;
+
+    assert(impact != NULL);
+
+    for (e = CVSS_PACKTAB; e->key != CVSS_KEY_NONE; ++e) {
+        metrics = *cvss_impact_metricsptr((struct cvss_impact *) impact, CVSS_CATEGORY(e->key));
+        if (metrics != NULL)
+            packed = cvss_packed_set(packed, e->key, metrics->metrics.ANY[CVSS_KEY_IDX(e->key)]);
+    }
+
+    return packed;
+}
+
+#define CVSS_PACKED_BASE_NUM 4096 // AV, AC, Au, C, I, A
+#define CVSS_PACKED_EXPL_NUM 64   // AV, AC, Au
+#define CVSS_PACKED_TEMP_NUM 256  // E, RL, RC
+#define CVSS_PACKED_ADJ_NUM  4096 // C, I, A, CR, IR, AR
+
+static float cvss_packed_base[CVSS_PACKED_BASE_NUM];
+static float cvss_packed_expl[CVSS_PACKED_EXPL_NUM];
+static float cvss_packed_temp[CVSS_PACKED_TEMP_NUM];
+static float cvss_packed_adj[CVSS_PACKED_ADJ_NUM];
+static float cvss_packed_cdp[8];
+static float cvss_packed_td[8];
+static pthread_once_t cvss_packed_once = PTHREAD_ONCE_INIT;
+
+// weight of the value of the field of the key, NAN if there's no such value
+static float cvss_packed_weight(uint64_t packed, enum cvss_key key)
+{
+    const struct cvss_packtab_entry *e = cvss_packtab(key);
+    const struct cvss_valtab_entry *entry;
+
+    entry = cvss_valtab(key, CVSS_PACKED_FIELD(packed, e->shift, e->bits), NULL, NULL);
+    return entry->key == CVSS_KEY_NONE ? NAN : entry->weight;
+}
+
+#define CVSS_PW(key) cvss_packed_weight(p, CVSS_KEY_##key)
+
+/* The same expressions as the score calculators, so the tables give the very same scores. */
+static void cvss_packed_tables_init(void)
+{
+    uint64_t p;
+    size_t i;
+
+    for (i = 0; i < CVSS_PACKED_BASE_NUM; ++i) {
+        p = i;
+        if (CVSS_PACKED_FIELD(p, 10, 2) == 0 || CVSS_PACKED_FIELD(p, 8, 2) == 0 || CVSS_PACKED_FIELD(p, 6, 2) == 0 ||
+            CVSS_PACKED_FIELD(p, 4, 2) == 0 || CVSS_PACKED_FIELD(p, 2, 2) == 0 || CVSS_PACKED_FIELD(p, 0, 2) == 0) {
+            cvss_packed_base[i] = NAN;
+            continue;
+        }
+        float imp_s = 10.41 * (1.0 - (1.0 - CVSS_PW(confidentiality_impact)) * (1.0 - CVSS_PW(integrity_impact)) * (1.0 - CVSS_PW(availability_impact)));
+        float exp_s = 20 * CVSS_PW(access_vector) * CVSS_PW(access_complexity) * CVSS_PW(authentication);
+        cvss_packed_base[i] = cvss_base_score_from(imp_s, exp_s);
+    }
+
+    for (i = 0; i < CVSS_PACKED_EXPL_NUM; ++i) {
+        p = i << 6;
+        cvss_packed_expl[i] = 20 * CVSS_PW(access_vector) * CVSS_PW(access_complexity) * CVSS_PW(authentication);
+    }
+
+    for (i = 0; i < CVSS_PACKED_TEMP_NUM; ++i) {
+        p = (uint64_t)i << 12;
+        cvss_packed_temp[i] = CVSS_PW(exploitability) * CVSS_PW(remediation_level) * CVSS_PW(report_confidence);
+    }
+
+    // C, I, A in the low six bits, CR, IR, AR in the high ones
+    for (i = 0; i < CVSS_PACKED_ADJ_NUM; ++i) {
+        p = (i & 0x3f) | (uint64_t)(i >> 6) << 26;
+        float c = CVSS_PW(confidentiality_impact) * CVSS_PW(confidentiality_requirement);
+        float ii = CVSS_PW(integrity_impact)      * CVSS_PW(integrity_requirement);
+        float a = CVSS_PW(availability_impact)    * CVSS_PW(availability_requirement);
+        float imp = 10.41 * (1.0 - (1.0 - c) * (1.0 - ii) * (1.0 - a));
+        cvss_packed_adj[i] = imp <= 10.0 ? imp : 10.0;
+    }
+
+    for (i = 0; i < 8; ++i) {
+        p = (uint64_t)i << 20 | (uint64_t)i << 23;
+        cvss_packed_cdp[i] = CVSS_PW(collateral_damage_potential);
+        cvss_packed_td[i] = CVSS_PW(target_distribution);
+    }
+}
+
+static inline float cvss_packed_score(uint64_t p, enum cvss_category category)
+{
+    float base, temp_m, temp_s;
+
+    base = cvss_packed_base[p & 0xfff];
+
+    switch (category) {
+        case CVSS_BASE:
+            return base;
+        case CVSS_TEMPORAL:
+            if (!(p & CVSS_PACKED_TEMPORAL)) return NAN;
+            return cvss_round(base * cvss_packed_temp[(p >> 12) & 0xff]);
+        case CVSS_ENVIRONMENTAL:
+            if (!(p & CVSS_PACKED_ENVIRONMENTAL) || isnan(base)) return NAN;
+            temp_m = p & CVSS_PACKED_TEMPORAL ? cvss_packed_temp[(p >> 12) & 0xff] : NAN;
+            base = cvss_base_score_from(cvss_packed_adj[(p & 0x3f) | ((p >> 20) & 0xfc0)], cvss_packed_expl[(p >> 6) & 0x3f]);
+            temp_s = cvss_round(base * temp_m);
+            if (isnan(temp_s)) return NAN;
+            return cvss_round((temp_s + (10.0 - temp_s) * cvss_packed_cdp[(p >> 20) & 0x7]) * cvss_packed_td[(p >> 23) & 0x7]);
+        default:
+            return NAN;
+    }
+}
+
+void cvss_packed_scores(const uint64_t *packed, size_t count, enum cvss_category category, float *scores)
+{
+    size_t i;
+
+    assert(count == 0 || (packed != NULL && scores != NULL));
+    pthread_once(&cvss_packed_once, cvss_packed_tables_init);
+
+    for (i = 0; i < count; ++i)
+        scores[i] = cvss_packed_score(packed[i], category);
+}
+
 static void cvss_metrics_describe(const struct cvss_metrics *metrics, FILE *f)
 {
     if (metrics == NULL) return;
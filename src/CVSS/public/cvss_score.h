@@ -36,6 +36,7 @@
 #define _CVSSCALC_H_
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <time.h>
 #include <stdio.h>
 
@@ -311,6 +312,50 @@ float cvss_impact_environmental_score(const struct cvss_impact* impact);
 
 /** @} */
 
+/**
+ * @name Packed vectors
+ * A CVSS vector packed in an integer, for scoring large arrays of vectors.
+ *
+ * The low 32 bits hold the values of the components, the flags below
+ * tell whether the vector has temporal or environmental metrics at all.
+ * @{
+ */
+
+/// The packed vector has temporal metrics
+#define CVSS_PACKED_TEMPORAL      ((uint64_t)1 << 32)
+/// The packed vector has environmental metrics
+#define CVSS_PACKED_ENVIRONMENTAL ((uint64_t)1 << 33)
+
+/**
+ * Pack a vector in the format of cvss_impact_new_from_vector().
+ * @param cvss_vector the vector, e.g. "AV:N/AC:L/Au:N/C:P/I:P/A:P"
+ * @param packed the packed vector
+ * @return false if the vector isn't valid
+ */
+bool cvss_vector_pack(const char *cvss_vector, uint64_t *packed);
+
+/**
+ * Pack the metrics of an impact.
+ * @memberof cvss_impact
+ */
+uint64_t cvss_impact_pack(const struct cvss_impact *impact);
+
+/**
+ * Calculate the scores of an array of packed vectors.
+ *
+ * The scores are the same as these of cvss_impact_base_score(),
+ * cvss_impact_temporal_score() and cvss_impact_environmental_score(),
+ * NAN if the vector doesn't have the needed metrics, but they are looked
+ * up in tables computed once.
+ * @param packed the packed vectors
+ * @param count the number of the vectors
+ * @param category CVSS_BASE, CVSS_TEMPORAL or CVSS_ENVIRONMENTAL
+ * @param scores the scores, @a count of them
+ */
+void cvss_packed_scores(const uint64_t *packed, size_t count, enum cvss_category category, float *scores);
+
+/** @} */
+
 /// @memberof cvss_metrics
 struct cvss_metrics *cvss_metrics_new(enum cvss_category category);
 /// @memberof cvss_metrics
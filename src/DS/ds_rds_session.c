@@ -72,7 +72,8 @@ void ds_rds_session_free(struct ds_rds_session *rds_session)
 struct rds_index *ds_rds_session_get_rds_idx(struct ds_rds_session *session)
 {
 	if (session->index == NULL) {
-		xmlTextReader *reader = oscap_source_get_xmlTextReader(session->source);
+		// rds_index_parse copies what it needs, the reports needn't be in memory
+		xmlTextReader *reader = oscap_source_get_streaming_xmlTextReader(session->source);
 		if (reader == NULL) {
 			return NULL;
 		}
@@ -42,6 +42,7 @@
 #include "source/public/oscap_source.h"
 #include "source/xslt_priv.h"
 #include <libgen.h>
+#include <string.h>
 #include <libxml/tree.h>
 
 struct ds_sds_session {
@@ -52,8 +53,13 @@ struct ds_sds_session {
 	const char *datastream_id;              ///< ID of selected datastream
 	const char *checklist_id;               ///< ID of selected checklist
 	struct oscap_htable *component_sources;	///< oscap_source for parsed components
+	struct oscap_htable *components;        ///< ds:component elements of the collection by id
+	struct oscap_htable *component_refs;    ///< ds:component-ref elements of the datastream by id
+	xmlNode *component_refs_datastream;     ///< Datastream the component_refs belong to
 	bool fetch_remote_resources;            ///< Allows loading of external components;
 	download_progress_calllback_t progress;	///< Callback to report progress of download.
+	struct oscap_htable *remote_downloads;  ///< Remote components downloaded in parallel, not yet loaded
+	xmlNode *remote_downloads_datastream;   ///< Datastream the remote_downloads belong to
 };
 
 /**
@@ -85,6 +91,9 @@ void ds_sds_session_free(struct ds_sds_session *sds_session)
 			oscap_acquire_cleanup_dir(&(sds_session->temp_dir));
 		}
 		oscap_htable_free(sds_session->component_sources, (oscap_destruct_func) oscap_source_free);
+		oscap_htable_free0(sds_session->components);
+		oscap_htable_free0(sds_session->component_refs);
+		oscap_acquire_url_downloads_free(sds_session->remote_downloads);
 		oscap_free(sds_session);
 	}
 }
@@ -233,7 +242,7 @@ struct oscap_source *ds_sds_session_select_tailoring(struct ds_sds_session *sess
 
 xmlNode *ds_sds_session_get_selected_datastream(struct ds_sds_session *session)
 {
-	xmlDoc *doc = oscap_source_get_xmlDoc(session->source);
+	xmlDoc *doc = ds_sds_session_get_xmlDoc(session);
 	xmlNode *datastream = ds_sds_lookup_datastream_in_collection(doc, session->datastream_id);
 	if (datastream == NULL) {
 		const char* error = session->datastream_id ?
@@ -247,7 +256,65 @@ xmlNode *ds_sds_session_get_selected_datastream(struct ds_sds_session *session)
 
 xmlDoc *ds_sds_session_get_xmlDoc(struct ds_sds_session *session)
 {
-	return oscap_source_get_xmlDoc(session->source);
+	// the components borrowed by the component sources are missing
+	return oscap_source_peek_xmlDoc(session->source);
+}
+
+struct oscap_source *ds_sds_session_get_source(struct ds_sds_session *session)
+{
+	return session->source;
+}
+
+static void _index_by_id(struct oscap_htable *index, xmlNode *node)
+{
+	char *id = (char *) xmlGetProp(node, BAD_CAST "id");
+	if (id != NULL) {
+		// the first element of an id wins, as with the linear lookups
+		oscap_htable_add(index, id, node);
+		xmlFree(id);
+	}
+}
+
+xmlNode *ds_sds_session_get_component(struct ds_sds_session *session, const char *component_id)
+{
+	if (session->components == NULL) {
+		xmlDoc *doc = ds_sds_session_get_xmlDoc(session);
+		if (doc == NULL)
+			return NULL;
+
+		session->components = oscap_htable_new();
+		for (xmlNode *node = xmlDocGetRootElement(doc)->children; node != NULL; node = node->next) {
+			if (node->type != XML_ELEMENT_NODE)
+				continue;
+			if (strcmp((const char *) node->name, "component") == 0 ||
+			    strcmp((const char *) node->name, "extended-component") == 0)
+				_index_by_id(session->components, node);
+		}
+	}
+	return oscap_htable_get(session->components, component_id);
+}
+
+xmlNode *ds_sds_session_get_component_ref(struct ds_sds_session *session, const char *cref_id)
+{
+	xmlNode *datastream = ds_sds_session_get_selected_datastream(session);
+	if (datastream == NULL)
+		return NULL;
+
+	if (session->component_refs == NULL || session->component_refs_datastream != datastream) {
+		oscap_htable_free0(session->component_refs);
+		session->component_refs = oscap_htable_new();
+		session->component_refs_datastream = datastream;
+
+		for (xmlNode *container = datastream->children; container != NULL; container = container->next) {
+			if (container->type != XML_ELEMENT_NODE)
+				continue;
+			for (xmlNode *node = container->children; node != NULL; node = node->next) {
+				if (node->type == XML_ELEMENT_NODE && strcmp((const char *) node->name, "component-ref") == 0)
+					_index_by_id(session->component_refs, node);
+			}
+		}
+	}
+	return oscap_htable_get(session->component_refs, cref_id);
 }
 
 int ds_sds_session_register_component_source(struct ds_sds_session *session, const char *relative_filepath, struct oscap_source *component)
@@ -285,7 +352,10 @@ int ds_sds_session_register_component_with_dependencies(struct ds_sds_session *s
 	}
 
 	int res = -1;
-	xmlNode *component_ref = containter_get_component_ref_by_id(container, component_id);
+	xmlNode *component_ref = component_id != NULL ? ds_sds_session_get_component_ref(session, component_id) : NULL;
+	if (component_ref == NULL || component_ref->parent != container) {
+		component_ref = containter_get_component_ref_by_id(container, component_id);
+	}
 	if (component_ref != NULL) {
 		if (target_filename == NULL) {
 			res = ds_sds_dump_component_ref(component_ref, session);
@@ -302,6 +372,45 @@ int ds_sds_session_register_component_with_dependencies(struct ds_sds_session *s
 	return res;
 }
 
+char *ds_sds_session_download_remote_component(struct ds_sds_session *session, const char *url, size_t *memory_size)
+{
+	xmlNode *datastream = ds_sds_session_get_selected_datastream(session);
+
+	// the first remote component of the datastream downloads all of them at once
+	if (datastream != NULL && session->remote_downloads_datastream != datastream) {
+		char **urls = oscap_alloc(sizeof(char *));
+		size_t count = 0;
+
+		for (xmlNode *container = datastream->children; container != NULL; container = container->next) {
+			if (container->type != XML_ELEMENT_NODE)
+				continue;
+			for (xmlNode *node = container->children; node != NULL; node = node->next) {
+				if (node->type != XML_ELEMENT_NODE || strcmp((const char *) node->name, "component-ref") != 0)
+					continue;
+
+				char *href = (char *) xmlGetNsProp(node, BAD_CAST "href", BAD_CAST "http://www.w3.org/1999/xlink");
+				if (href != NULL && oscap_acquire_url_is_supported(href)) {
+					href[strcspn(href, "#")] = '\0';
+					urls[count++] = oscap_strdup(href);
+					urls = oscap_realloc(urls, (count + 1) * sizeof(char *));
+				}
+				xmlFree(href);
+			}
+		}
+		urls[count] = NULL;
+
+		oscap_acquire_url_downloads_free(session->remote_downloads);
+		session->remote_downloads = count > 1 ? oscap_acquire_url_download_all((const char **) urls) : NULL;
+		session->remote_downloads_datastream = datastream;
+
+		for (size_t i = 0; i < count; ++i)
+			oscap_free(urls[i]);
+		oscap_free(urls);
+	}
+
+	return oscap_acquire_url_download_take(session->remote_downloads, url, memory_size);
+}
+
 void ds_sds_session_set_remote_resources(struct ds_sds_session *session, bool allowed, download_progress_calllback_t callback)
 {
 	session->fetch_remote_resources = allowed;
@@ -35,12 +35,18 @@ OSCAP_HIDDEN_START;
 
 xmlNode *ds_sds_session_get_selected_datastream(struct ds_sds_session *session);
 xmlDoc *ds_sds_session_get_xmlDoc(struct ds_sds_session *session);
+struct oscap_source *ds_sds_session_get_source(struct ds_sds_session *session);
+/* hash lookups of the ds:component of the collection and the ds:component-ref of the selected datastream */
+xmlNode *ds_sds_session_get_component(struct ds_sds_session *session, const char *component_id);
+xmlNode *ds_sds_session_get_component_ref(struct ds_sds_session *session, const char *cref_id);
 int ds_sds_session_register_component_source(struct ds_sds_session *session, const char *relative_filepath, struct oscap_source *component);
 const char *ds_sds_session_get_target_dir(struct ds_sds_session *session);
 struct oscap_htable *ds_sds_session_get_component_sources(struct ds_sds_session *session);
 const char *ds_sds_session_get_readable_origin(const struct ds_sds_session *session);
 bool ds_sds_session_fetch_remote_resources(struct ds_sds_session *session);
 download_progress_calllback_t ds_sds_session_remote_resources_progress(struct ds_sds_session *session);
+/* download the remote component, all the remote components of the selected datastream are downloaded at once */
+char *ds_sds_session_download_remote_component(struct ds_sds_session *session, const char *url, size_t *memory_size);
 
 void download_progress_empty_calllback(bool warning, const char * format, ...);
 OSCAP_HIDDEN_END;
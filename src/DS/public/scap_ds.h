@@ -208,6 +208,14 @@ const char* ds_stream_index_get_version(struct ds_stream_index* s);
  */
 struct oscap_string_iterator* ds_stream_index_get_checks(struct ds_stream_index* s);
 
+/**
+ * @brief ID of the component of the collection a component-ref points to
+ *
+ * NULL if the component-ref points to an external component.
+ * @memberof ds_stream_index
+ */
+const char *ds_stream_index_get_component_id(struct ds_stream_index *s, const char *component_ref_id);
+
 /**
  * @brief Retrieves iterator over all components inside the <checklists> element.
  *
@@ -271,6 +279,29 @@ struct ds_stream_index_iterator* ds_sds_index_get_streams(struct ds_sds_index* s
  */
 OSCAP_DEPRECATED(struct ds_sds_index *ds_sds_index_import(const char* file));
 
+struct oscap_source;
+
+/**
+ * @brief indexes given source datastream without loading it to memory
+ *
+ * Unlike the index of ds_sds_session, the datastream is read by a streaming
+ * parser, so nothing else but the index is built.
+ *
+ * @memberof ds_sds_index
+ */
+struct ds_sds_index *ds_sds_index_import_source(struct oscap_source *source);
+
+struct ds_benchmark_index;
+
+/**
+ * @brief retrieves the index of the XCCDF Benchmark of a component
+ *
+ * @param component_id ID of the ds:component, see ds_stream_index_get_component_id
+ * @returns NULL if the component doesn't contain a Benchmark
+ * @memberof ds_sds_index
+ */
+struct ds_benchmark_index *ds_sds_index_get_benchmark(struct ds_sds_index *s, const char *component_id);
+
 /**
  * @brief chooses datastream and checklist id combination given the IDs
  *
@@ -318,6 +349,87 @@ bool ds_stream_index_iterator_has_more(struct ds_stream_index_iterator *it);
 /// @memberof ds_stream_index_iterator
 void ds_stream_index_iterator_free(struct ds_stream_index_iterator *it);
 
+/**
+ * @struct ds_profile_index
+ * The ID, the first title and the abstract flag of a Profile.
+ */
+struct ds_profile_index;
+
+/// @memberof ds_profile_index
+const char *ds_profile_index_get_id(const struct ds_profile_index *p);
+/// @memberof ds_profile_index
+const char *ds_profile_index_get_title(const struct ds_profile_index *p);
+/// @memberof ds_profile_index
+bool ds_profile_index_get_abstract(const struct ds_profile_index *p);
+
+/**
+ * @struct ds_profile_index_iterator
+ * @see oscap_iterator
+ */
+struct ds_profile_index_iterator;
+
+/// @memberof ds_profile_index_iterator
+struct ds_profile_index *ds_profile_index_iterator_next(struct ds_profile_index_iterator *it);
+/// @memberof ds_profile_index_iterator
+bool ds_profile_index_iterator_has_more(struct ds_profile_index_iterator *it);
+/// @memberof ds_profile_index_iterator
+void ds_profile_index_iterator_free(struct ds_profile_index_iterator *it);
+
+/**
+ * @struct ds_check_file_index
+ * A check system and a file referenced by the checks of a Benchmark.
+ */
+struct ds_check_file_index;
+
+/// @memberof ds_check_file_index
+const char *ds_check_file_index_get_system(const struct ds_check_file_index *f);
+/// @memberof ds_check_file_index
+const char *ds_check_file_index_get_href(const struct ds_check_file_index *f);
+
+/**
+ * @struct ds_check_file_index_iterator
+ * @see oscap_iterator
+ */
+struct ds_check_file_index_iterator;
+
+/// @memberof ds_check_file_index_iterator
+struct ds_check_file_index *ds_check_file_index_iterator_next(struct ds_check_file_index_iterator *it);
+/// @memberof ds_check_file_index_iterator
+bool ds_check_file_index_iterator_has_more(struct ds_check_file_index_iterator *it);
+/// @memberof ds_check_file_index_iterator
+void ds_check_file_index_iterator_free(struct ds_check_file_index_iterator *it);
+
+/**
+ * @struct ds_benchmark_index
+ *
+ * The metadata of an XCCDF Benchmark inside a component, collected while
+ * the datastream is indexed. It saves loading the Benchmark to tell its
+ * profiles, statuses, TestResults and the files its checks refer to.
+ *
+ * @see ds_sds_index_get_benchmark
+ */
+struct xccdf_status;
+
+/// @memberof ds_benchmark_index
+const char *ds_benchmark_index_get_id(const struct ds_benchmark_index *b);
+/// @memberof ds_benchmark_index
+bool ds_benchmark_index_get_resolved(const struct ds_benchmark_index *b);
+/**
+ * The current status, chosen like xccdf_benchmark_get_status_current does.
+ * @memberof ds_benchmark_index
+ */
+struct xccdf_status *ds_benchmark_index_get_status_current(const struct ds_benchmark_index *b);
+/// @memberof ds_benchmark_index
+struct ds_profile_index_iterator *ds_benchmark_index_get_profiles(const struct ds_benchmark_index *b);
+/**
+ * The distinct check systems and files in the order of xccdf_policy_model_get_systems_and_files.
+ * @memberof ds_benchmark_index
+ */
+struct ds_check_file_index_iterator *ds_benchmark_index_get_check_files(const struct ds_benchmark_index *b);
+/// IDs of the TestResults
+/// @memberof ds_benchmark_index
+struct oscap_string_iterator *ds_benchmark_index_get_test_results(const struct ds_benchmark_index *b);
+
 /**
  * @struct rds_report_request_index
  */
@@ -427,6 +539,66 @@ OSCAP_DEPRECATED(struct rds_index *rds_index_import(const char *file));
 /// @memberof rds_index
 int rds_index_select_report(struct rds_index *s, const char **report_id);
 
+/**
+ * @struct rds_store
+ *
+ * Result DataStreams of many assets merged into one <arf:asset-report-collection>.
+ * The report requests which are the same in several of them, usually the
+ * whole source datastream, are stored once. The results of the rules of
+ * every asset are kept in a compact table, so the assets with a given
+ * result of a rule are found without walking the reports.
+ */
+struct rds_store;
+
+/// @memberof rds_store
+struct rds_store *rds_store_new(void);
+/// @memberof rds_store
+void rds_store_free(struct rds_store *s);
+
+/**
+ * Merge the assets, the reports and the report requests of the given
+ * Result DataStream into the store. Their ids are renumbered, the
+ * relationships and the references among them are updated.
+ * @memberof rds_store
+ * @param s The store
+ * @param rds The Result DataStream, its DOM is built and kept by it
+ * @returns 0 on success, -1 on error
+ */
+int rds_store_add_source(struct rds_store *s, struct oscap_source *rds);
+
+/// @memberof rds_store
+size_t rds_store_get_asset_count(const struct rds_store *s);
+/**
+ * Number of the distinct report requests stored.
+ * @memberof rds_store
+ */
+size_t rds_store_get_report_request_count(const struct rds_store *s);
+
+/**
+ * Get the ids of the assets having the given result of the given rule
+ * in any of their XCCDF TestResults.
+ * @memberof rds_store
+ * @param s The store
+ * @param rule_id The id of the XCCDF Rule
+ * @param result The result, as written in the rule-result, e.g. "fail"
+ * @returns new list of the asset ids, NULL if the result is not known
+ */
+struct oscap_stringlist *rds_store_get_assets_by_rule_result(struct rds_store *s, const char *rule_id, const char *result);
+
+/**
+ * Get the name of the asset, its first FQDN or hostname, its original id
+ * if it has neither.
+ * @memberof rds_store
+ */
+const char *rds_store_get_asset_name(struct rds_store *s, const char *asset_id);
+
+/**
+ * Save the merged Result DataStream.
+ * @memberof rds_store
+ * @returns 0 on success, -1 on error
+ */
+int rds_store_export(struct rds_store *s, const char *file);
+
 /************************************************************/
 /** @} End of DS group */
 
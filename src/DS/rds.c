@@ -222,7 +222,7 @@ xmlNodePtr ds_rds_create_report(xmlDocPtr target_doc, xmlNodePtr reports_node, x
 	return report;
 }
 
-static void ds_rds_add_relationship(xmlDocPtr doc, xmlNodePtr relationships,
+void ds_rds_add_relationship(xmlDocPtr doc, xmlNodePtr relationships,
 		const char* type, const char* subject, const char* ref)
 {
 	xmlNsPtr core_ns = xmlSearchNsByHref(doc, xmlDocGetRootElement(doc), BAD_CAST core_ns_uri);
@@ -756,6 +756,141 @@ struct oscap_source *ds_rds_create_source(struct oscap_source *sds_source, struc
 	return oscap_source_new_from_xmlDoc(rds_doc, target_file);
 }
 
+static void ds_rds_stream_start_element(xmlOutputBufferPtr out, int level, const char *name, const char *id)
+{
+	for (int i = 0; i < level; ++i)
+		xmlOutputBufferWriteString(out, "  ");
+	xmlOutputBufferWriteString(out, "<");
+	xmlOutputBufferWriteString(out, name);
+	if (id != NULL) {
+		xmlOutputBufferWriteString(out, " id=\"");
+		xmlOutputBufferWriteString(out, id);
+		xmlOutputBufferWriteString(out, "\"");
+	}
+	xmlOutputBufferWriteString(out, ">\n");
+}
+
+static void ds_rds_stream_end_element(xmlOutputBufferPtr out, int level, const char *name)
+{
+	for (int i = 0; i < level; ++i)
+		xmlOutputBufferWriteString(out, "  ");
+	xmlOutputBufferWriteString(out, "</");
+	xmlOutputBufferWriteString(out, name);
+	xmlOutputBufferWriteString(out, ">\n");
+}
+
+static void ds_rds_stream_node(xmlOutputBufferPtr out, int level, xmlDocPtr doc, xmlNodePtr node)
+{
+	for (int i = 0; i < level; ++i)
+		xmlOutputBufferWriteString(out, "  ");
+	xmlNodeDumpOutput(out, doc, node, level, 1, "UTF-8");
+	xmlOutputBufferWriteString(out, "\n");
+}
+
+/*
+ * Writes the same document as ds_rds_create_source, but the source data
+ * stream and the OVAL results are dumped straight from their own documents
+ * instead of being copied into the DOM of the collection. Only the small
+ * parts made here (relationships, assets, XCCDF reports with the injected
+ * references) are built as a DOM.
+ */
+int ds_rds_create_stream(struct oscap_source *sds_source, struct oscap_source *xccdf_result_source, struct oscap_htable *oval_result_sources, const char *target_file)
+{
+	xmlDoc *sds_doc = oscap_source_get_xmlDoc(sds_source);
+	if (sds_doc == NULL) {
+		return -1;
+	}
+	xmlDoc *result_file_doc = oscap_source_get_xmlDoc(xccdf_result_source);
+	if (result_file_doc == NULL) {
+		return -1;
+	}
+
+	xmlDocPtr doc = xmlNewDoc(BAD_CAST "1.0");
+	xmlNodePtr root = xmlNewNode(NULL, BAD_CAST "asset-report-collection");
+	xmlDocSetRootElement(doc, root);
+
+	xmlNsPtr arf_ns = xmlNewNs(root, BAD_CAST arf_ns_uri, BAD_CAST "arf");
+	xmlSetNs(root, arf_ns);
+
+	xmlNsPtr core_ns = xmlNewNs(root, BAD_CAST core_ns_uri, BAD_CAST "core");
+	xmlNewNs(root, BAD_CAST ai_ns_uri, BAD_CAST "ai");
+
+	xmlNodePtr relationships = xmlNewNode(core_ns, BAD_CAST "relationships");
+	xmlNewNs(relationships, BAD_CAST arfvocab_ns_uri, BAD_CAST "arfvocab");
+	xmlNewNs(relationships, BAD_CAST arfrel_ns_uri, BAD_CAST "arfrel");
+	xmlAddChild(root, relationships);
+
+	xmlNodePtr assets = xmlNewNode(arf_ns, BAD_CAST "assets");
+	xmlAddChild(root, assets);
+
+	xmlNodePtr reports = xmlNewNode(arf_ns, BAD_CAST "reports");
+	xmlAddChild(root, reports);
+
+	ds_rds_add_xccdf_test_results(doc, reports, result_file_doc,
+			relationships, assets, "collection1");
+
+	xmlOutputBufferPtr out = xmlOutputBufferCreateFilename(target_file, NULL, 0);
+	if (out == NULL) {
+		oscap_seterr(OSCAP_EFAMILY_GLIBC, "Can't open '%s' for writing.", target_file);
+		xmlFreeDoc(doc);
+		return -1;
+	}
+
+	xmlOutputBufferWriteString(out, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+	xmlOutputBufferWriteString(out, "<arf:asset-report-collection xmlns:arf=\"");
+	xmlOutputBufferWriteString(out, arf_ns_uri);
+	xmlOutputBufferWriteString(out, "\" xmlns:core=\"");
+	xmlOutputBufferWriteString(out, core_ns_uri);
+	xmlOutputBufferWriteString(out, "\" xmlns:ai=\"");
+	xmlOutputBufferWriteString(out, ai_ns_uri);
+	xmlOutputBufferWriteString(out, "\">\n");
+
+	ds_rds_stream_node(out, 1, doc, relationships);
+
+	ds_rds_stream_start_element(out, 1, "arf:report-requests", NULL);
+	ds_rds_stream_start_element(out, 2, "arf:report-request", "collection1");
+	ds_rds_stream_start_element(out, 3, "arf:content", NULL);
+	ds_rds_stream_node(out, 4, sds_doc, xmlDocGetRootElement(sds_doc));
+	ds_rds_stream_end_element(out, 3, "arf:content");
+	ds_rds_stream_end_element(out, 2, "arf:report-request");
+	ds_rds_stream_end_element(out, 1, "arf:report-requests");
+
+	ds_rds_stream_node(out, 1, doc, assets);
+
+	ds_rds_stream_start_element(out, 1, "arf:reports", NULL);
+	for (xmlNodePtr report = reports->children; report != NULL; report = report->next) {
+		if (report->type == XML_ELEMENT_NODE)
+			ds_rds_stream_node(out, 2, doc, report);
+	}
+
+	unsigned int oval_report_suffix = 2;
+	struct oscap_htable_iterator *hit = oscap_htable_iterator_new(oval_result_sources);
+	while (oscap_htable_iterator_has_more(hit)) {
+		struct oscap_source *oval_source = oscap_htable_iterator_next_value(hit);
+		xmlDoc *oval_result_doc = oscap_source_get_xmlDoc(oval_source);
+
+		char* report_id = oscap_sprintf("oval%i", oval_report_suffix++);
+		ds_rds_stream_start_element(out, 2, "arf:report", report_id);
+		ds_rds_stream_start_element(out, 3, "arf:content", NULL);
+		ds_rds_stream_node(out, 4, oval_result_doc, xmlDocGetRootElement(oval_result_doc));
+		ds_rds_stream_end_element(out, 3, "arf:content");
+		ds_rds_stream_end_element(out, 2, "arf:report");
+		oscap_free(report_id);
+	}
+	oscap_htable_iterator_free(hit);
+
+	ds_rds_stream_end_element(out, 1, "arf:reports");
+	xmlOutputBufferWriteString(out, "</arf:asset-report-collection>\n");
+
+	xmlFreeDoc(doc);
+
+	if (xmlOutputBufferClose(out) < 0) {
+		oscap_seterr(OSCAP_EFAMILY_XML, "Failed to write '%s'.", target_file);
+		return -1;
+	}
+	return 0;
+}
+
 int ds_rds_create(const char* sds_file, const char* xccdf_result_file, const char** oval_result_files, const char* target_file)
 {
 	struct oscap_source *sds_source = oscap_source_new_from_file(sds_file);
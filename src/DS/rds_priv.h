@@ -38,7 +38,9 @@ xmlNode *ds_rds_lookup_container(xmlDocPtr doc, const char *container_name);
 xmlNode *ds_rds_lookup_component(xmlDocPtr doc, const char *container_name, const char *component_name, const char *id);
 int ds_rds_dump_arf_content(struct ds_rds_session *session, const char *container_name, const char *component_name, const char *content_id);
 struct oscap_source *ds_rds_create_source(struct oscap_source *sds_source, struct oscap_source *xccdf_result_source, struct oscap_htable *oval_result_sources, const char *target_file);
+int ds_rds_create_stream(struct oscap_source *sds_source, struct oscap_source *xccdf_result_source, struct oscap_htable *oval_result_sources, const char *target_file);
 xmlNodePtr ds_rds_create_report(xmlDocPtr target_doc, xmlNodePtr reports_node, xmlDocPtr source_doc, const char* report_id);
+void ds_rds_add_relationship(xmlDocPtr doc, xmlNodePtr relationships, const char* type, const char* subject, const char* ref);
 
 OSCAP_HIDDEN_END;
 #endif
@@ -0,0 +1,620 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libxml/tree.h>
+
+#include "public/scap_ds.h"
+#include "public/oscap_text.h"
+#include "common/_error.h"
+#include "common/alloc.h"
+#include "common/debug_priv.h"
+#include "common/elements.h"
+#include "common/list.h"
+#include "common/util.h"
+#include "rds_priv.h"
+#include "source/oscap_source_priv.h"
+#include "source/public/oscap_source.h"
+
+static const char* arf_ns_uri = "http://scap.nist.gov/schema/asset-reporting-format/1.1";
+static const char* core_ns_uri = "http://scap.nist.gov/schema/reporting-core/1.1";
+static const char* arfvocab_ns_uri = "http://scap.nist.gov/specifications/arf/vocabulary/relationships/1.0#";
+static const char* arfrel_ns_uri = "http://scap.nist.gov/vocabulary/arf/relationships/1.0#";
+static const char* ai_ns_uri = "http://scap.nist.gov/schema/asset-identification/1.1";
+
+/* the containers in the order of the ARF schema */
+enum rds_store_container {
+	RDS_STORE_RELATIONSHIPS,
+	RDS_STORE_REPORT_REQUESTS,
+	RDS_STORE_ASSETS,
+	RDS_STORE_REPORTS,
+	RDS_STORE_CONTAINERS
+};
+
+/* the results of the rule-results, their codes fit in RDS_STORE_RESULT_BITS */
+static const char *rds_store_results[] = {
+	"pass", "fail", "error", "unknown", "notapplicable", "notchecked",
+	"notselected", "informational", "fixed", NULL
+};
+#define RDS_STORE_RESULT_BITS 4
+#define RDS_STORE_RESULT_MASK ((1u << RDS_STORE_RESULT_BITS) - 1)
+
+struct rds_store_request {
+	char *id;
+	xmlNode *content;                  ///< the element inside arf:content
+	struct rds_store_request *next;    ///< next request with the same hash
+};
+
+struct rds_store_asset {
+	char *id;
+	char *name;
+	uint32_t *results;                 ///< rule index << RDS_STORE_RESULT_BITS | result
+	size_t count;
+	size_t size;
+	bool sorted;
+};
+
+struct rds_store {
+	xmlDoc *doc;
+	xmlNode *containers[RDS_STORE_CONTAINERS];
+	struct oscap_list *requests;       ///< rds_store_request
+	struct oscap_htable *request_hashes; ///< hash -> rds_store_request
+	struct oscap_list *assets;         ///< rds_store_asset
+	struct oscap_htable *asset_ids;    ///< id -> rds_store_asset
+	struct oscap_htable *rules;        ///< rule id -> index + 1
+	uint32_t rule_count;
+	unsigned int report_count;
+};
+
+static void rds_store_request_free(struct rds_store_request *r)
+{
+	if (r != NULL) {
+		oscap_free(r->id);
+		oscap_free(r);
+	}
+}
+
+static void rds_store_asset_free(struct rds_store_asset *a)
+{
+	if (a != NULL) {
+		oscap_free(a->id);
+		oscap_free(a->name);
+		oscap_free(a->results);
+		oscap_free(a);
+	}
+}
+
+struct rds_store *rds_store_new(void)
+{
+	struct rds_store *s = oscap_calloc(1, sizeof(struct rds_store));
+
+	s->doc = xmlNewDoc(BAD_CAST "1.0");
+	xmlNode *root = xmlNewNode(NULL, BAD_CAST "asset-report-collection");
+	xmlDocSetRootElement(s->doc, root);
+	xmlSetNs(root, xmlNewNs(root, BAD_CAST arf_ns_uri, BAD_CAST "arf"));
+	xmlNewNs(root, BAD_CAST core_ns_uri, BAD_CAST "core");
+	xmlNewNs(root, BAD_CAST ai_ns_uri, BAD_CAST "ai");
+
+	s->requests = oscap_list_new();
+	s->request_hashes = oscap_htable_new();
+	s->assets = oscap_list_new();
+	s->asset_ids = oscap_htable_new();
+	s->rules = oscap_htable_new();
+	return s;
+}
+
+void rds_store_free(struct rds_store *s)
+{
+	if (s != NULL) {
+		oscap_list_free(s->requests, (oscap_destruct_func) rds_store_request_free);
+		oscap_htable_free0(s->request_hashes);
+		oscap_list_free(s->assets, (oscap_destruct_func) rds_store_asset_free);
+		oscap_htable_free0(s->asset_ids);
+		oscap_htable_free0(s->rules);
+		xmlFreeDoc(s->doc);
+		oscap_free(s);
+	}
+}
+
+size_t rds_store_get_asset_count(const struct rds_store *s)
+{
+	return s->assets->itemcount;
+}
+
+size_t rds_store_get_report_request_count(const struct rds_store *s)
+{
+	return s->requests->itemcount;
+}
+
+/* The containers are made when first needed, the empty ones aren't valid. */
+static xmlNode *_rds_store_container(struct rds_store *s, enum rds_store_container which)
+{
+	static const char *names[] = { "relationships", "report-requests", "assets", "reports" };
+
+	if (s->containers[which] != NULL)
+		return s->containers[which];
+
+	xmlNode *root = xmlDocGetRootElement(s->doc);
+	xmlNode *node;
+	if (which == RDS_STORE_RELATIONSHIPS) {
+		node = xmlNewNode(xmlSearchNsByHref(s->doc, root, BAD_CAST core_ns_uri), BAD_CAST names[which]);
+		xmlNewNs(node, BAD_CAST arfvocab_ns_uri, BAD_CAST "arfvocab");
+		xmlNewNs(node, BAD_CAST arfrel_ns_uri, BAD_CAST "arfrel");
+	} else {
+		node = xmlNewNode(root->ns, BAD_CAST names[which]);
+	}
+
+	int next = which + 1;
+	while (next < RDS_STORE_CONTAINERS && s->containers[next] == NULL)
+		++next;
+	if (next < RDS_STORE_CONTAINERS)
+		xmlAddPrevSibling(s->containers[next], node);
+	else
+		xmlAddChild(root, node);
+
+	s->containers[which] = node;
+	return node;
+}
+
+static xmlNode *_rds_store_clone(struct rds_store *s, xmlDoc *source_doc, xmlNode *node, xmlNode *parent)
+{
+	xmlDOMWrapCtxtPtr wrap_ctxt = xmlDOMWrapNewCtxt();
+	xmlNode *res_node = NULL;
+
+	xmlDOMWrapCloneNode(wrap_ctxt, source_doc, node, &res_node, s->doc, NULL, 1, 0);
+	xmlAddChild(parent, res_node);
+	xmlDOMWrapReconcileNamespaces(wrap_ctxt, res_node, 0);
+	xmlDOMWrapFreeCtxt(wrap_ctxt);
+	return res_node;
+}
+
+static xmlNode *_rds_store_first_child(xmlNode *parent, const char *name)
+{
+	for (xmlNode *child = parent->children; child != NULL; child = child->next) {
+		if (child->type == XML_ELEMENT_NODE && (name == NULL || oscap_streq((const char *) child->name, name)))
+			return child;
+	}
+	return NULL;
+}
+
+static xmlNode *_rds_store_find(xmlNode *node, const char *name)
+{
+	for (xmlNode *child = node->children; child != NULL; child = child->next) {
+		if (child->type != XML_ELEMENT_NODE)
+			continue;
+		if (oscap_streq((const char *) child->name, name))
+			return child;
+		xmlNode *found = _rds_store_find(child, name);
+		if (found != NULL)
+			return found;
+	}
+	return NULL;
+}
+
+static bool _rds_store_is_text(const xmlNode *node)
+{
+	return (node->type == XML_TEXT_NODE || node->type == XML_CDATA_SECTION_NODE) && !xmlIsBlankNode(node);
+}
+
+/* Equality of the parts the hash covers, confirms a match of the hashes. */
+static bool _rds_store_same_node(xmlNode *a, xmlNode *b)
+{
+	if (!oscap_streq((const char *) a->name, (const char *) b->name))
+		return false;
+	if (!oscap_streq(a->ns != NULL ? (const char *) a->ns->href : NULL, b->ns != NULL ? (const char *) b->ns->href : NULL))
+		return false;
+
+	int attrs = 0;
+	for (xmlAttr *attr = a->properties; attr != NULL; attr = attr->next, ++attrs) {
+		xmlChar *va = xmlGetNsProp(a, attr->name, attr->ns != NULL ? attr->ns->href : NULL);
+		xmlChar *vb = xmlGetNsProp(b, attr->name, attr->ns != NULL ? attr->ns->href : NULL);
+		bool same = vb != NULL && oscap_streq((const char *) va, (const char *) vb);
+		xmlFree(va);
+		xmlFree(vb);
+		if (!same)
+			return false;
+	}
+	for (xmlAttr *attr = b->properties; attr != NULL; attr = attr->next)
+		--attrs;
+	if (attrs != 0)
+		return false;
+
+	xmlNode *ca = a->children, *cb = b->children;
+	for (;;) {
+		while (ca != NULL && ca->type != XML_ELEMENT_NODE && !_rds_store_is_text(ca))
+			ca = ca->next;
+		while (cb != NULL && cb->type != XML_ELEMENT_NODE && !_rds_store_is_text(cb))
+			cb = cb->next;
+		if (ca == NULL || cb == NULL)
+			return ca == cb;
+
+		if (ca->type == XML_ELEMENT_NODE) {
+			if (cb->type != XML_ELEMENT_NODE || !_rds_store_same_node(ca, cb))
+				return false;
+		} else if (cb->type == XML_ELEMENT_NODE || !oscap_streq((const char *) ca->content, (const char *) cb->content)) {
+			return false;
+		}
+		ca = ca->next;
+		cb = cb->next;
+	}
+}
+
+static char *_rds_store_hash_key(uint64_t hash)
+{
+	return oscap_sprintf("%016" PRIx64, hash);
+}
+
+/* The id of the stored request with the same content, stores it if there is none. */
+static const char *_rds_store_add_request(struct rds_store *s, xmlDoc *source_doc, xmlNode *request)
+{
+	xmlNode *content = _rds_store_first_child(request, "content");
+	xmlNode *inner = content != NULL ? _rds_store_first_child(content, NULL) : NULL;
+	if (inner == NULL) {
+		oscap_seterr(OSCAP_EFAMILY_XML, "Given ARF report-request has no content.");
+		return NULL;
+	}
+
+	uint64_t hash = oscap_xml_node_hash(inner);
+	char *key = _rds_store_hash_key(hash);
+	struct rds_store_request *first = oscap_htable_get(s->request_hashes, key);
+
+	for (struct rds_store_request *r = first; r != NULL; r = r->next) {
+		if (_rds_store_same_node(r->content, inner)) {
+			oscap_free(key);
+			return r->id;
+		}
+	}
+
+	struct rds_store_request *r = oscap_calloc(1, sizeof(struct rds_store_request));
+	r->id = oscap_sprintf("collection%zu", s->requests->itemcount + 1);
+
+	xmlNode *copy = _rds_store_clone(s, source_doc, request, _rds_store_container(s, RDS_STORE_REPORT_REQUESTS));
+	xmlSetProp(copy, BAD_CAST "id", BAD_CAST r->id);
+	r->content = _rds_store_first_child(_rds_store_first_child(copy, "content"), NULL);
+
+	oscap_list_add(s->requests, r);
+	if (first == NULL) {
+		oscap_htable_add(s->request_hashes, key, r);
+	} else {
+		r->next = first->next;
+		first->next = r;
+	}
+	oscap_free(key);
+	return r->id;
+}
+
+static struct rds_store_asset *_rds_store_add_asset(struct rds_store *s, xmlDoc *source_doc, xmlNode *asset, const char *old_id)
+{
+	struct rds_store_asset *a = oscap_calloc(1, sizeof(struct rds_store_asset));
+	a->id = oscap_sprintf("asset%zu", s->assets->itemcount);
+
+	xmlNode *name = _rds_store_find(asset, "fqdn");
+	if (name == NULL)
+		name = _rds_store_find(asset, "hostname");
+	a->name = name != NULL ? (char *) xmlNodeGetContent(name) : oscap_strdup(old_id);
+
+	xmlNode *copy = _rds_store_clone(s, source_doc, asset, _rds_store_container(s, RDS_STORE_ASSETS));
+	xmlSetProp(copy, BAD_CAST "id", BAD_CAST a->id);
+
+	oscap_list_add(s->assets, a);
+	oscap_htable_add(s->asset_ids, a->id, a);
+	return a;
+}
+
+/* Point the references to the reports and assets of the source to their new ids. */
+static void _rds_store_update_refs(xmlNode *node, struct oscap_htable *report_ids, struct oscap_htable *asset_ids)
+{
+	for (xmlNode *child = node->children; child != NULL; child = child->next) {
+		if (child->type != XML_ELEMENT_NODE)
+			continue;
+
+		xmlChar *href = xmlGetProp(child, BAD_CAST "href");
+		if (href != NULL && href[0] == '#') {
+			const char *new_id = oscap_htable_get(report_ids, (const char *) href + 1);
+			if (new_id != NULL) {
+				char *new_href = oscap_sprintf("#%s", new_id);
+				xmlSetProp(child, BAD_CAST "href", BAD_CAST new_href);
+				oscap_free(new_href);
+			}
+		}
+		xmlFree(href);
+
+		if (oscap_streq((const char *) child->name, "target-id-ref")) {
+			xmlChar *name = xmlGetProp(child, BAD_CAST "name");
+			struct rds_store_asset *a = name != NULL ? oscap_htable_get(asset_ids, (const char *) name) : NULL;
+			if (a != NULL)
+				xmlSetProp(child, BAD_CAST "name", BAD_CAST a->id);
+			xmlFree(name);
+		}
+
+		_rds_store_update_refs(child, report_ids, asset_ids);
+	}
+}
+
+static uint32_t _rds_store_rule_index(struct rds_store *s, const char *rule_id)
+{
+	uintptr_t index = (uintptr_t) oscap_htable_get(s->rules, rule_id);
+
+	if (index == 0) {
+		index = ++s->rule_count;
+		oscap_htable_add(s->rules, rule_id, (void *) index);
+	}
+	return (uint32_t) (index - 1);
+}
+
+static int _rds_store_result_code(const char *result)
+{
+	for (int i = 0; rds_store_results[i] != NULL; ++i) {
+		if (oscap_streq(rds_store_results[i], result))
+			return i;
+	}
+	return -1;
+}
+
+static void _rds_store_add_test_result(struct rds_store *s, struct rds_store_asset *a, xmlNode *test_result)
+{
+	for (xmlNode *rr = test_result->children; rr != NULL; rr = rr->next) {
+		if (rr->type != XML_ELEMENT_NODE || !oscap_streq((const char *) rr->name, "rule-result"))
+			continue;
+
+		xmlNode *result_node = _rds_store_first_child(rr, "result");
+		xmlChar *idref = xmlGetProp(rr, BAD_CAST "idref");
+		xmlChar *result = result_node != NULL ? xmlNodeGetContent(result_node) : NULL;
+		int code = _rds_store_result_code((const char *) result);
+
+		if (idref != NULL && code >= 0) {
+			if (a->count == a->size) {
+				a->size = a->size == 0 ? 64 : a->size * 2;
+				a->results = oscap_realloc(a->results, a->size * sizeof(uint32_t));
+			}
+			a->results[a->count++] = _rds_store_rule_index(s, (const char *) idref) << RDS_STORE_RESULT_BITS | (uint32_t) code;
+			a->sorted = false;
+		}
+		xmlFree(idref);
+		xmlFree(result);
+	}
+}
+
+/* The TestResults of the report, either its root or the children of a Benchmark. */
+static void _rds_store_add_results(struct rds_store *s, struct rds_store_asset *a, xmlNode *report)
+{
+	xmlNode *content = _rds_store_first_child(report, "content");
+	xmlNode *inner = content != NULL ? _rds_store_first_child(content, NULL) : NULL;
+
+	if (inner == NULL)
+		return;
+	if (oscap_streq((const char *) inner->name, "TestResult")) {
+		_rds_store_add_test_result(s, a, inner);
+	} else if (oscap_streq((const char *) inner->name, "Benchmark")) {
+		for (xmlNode *child = inner->children; child != NULL; child = child->next) {
+			if (child->type == XML_ELEMENT_NODE && oscap_streq((const char *) child->name, "TestResult"))
+				_rds_store_add_test_result(s, a, child);
+		}
+	}
+}
+
+int rds_store_add_source(struct rds_store *s, struct oscap_source *rds)
+{
+	xmlDoc *doc = oscap_source_get_xmlDoc(rds);
+	if (doc == NULL)
+		return -1;
+
+	xmlNode *root = xmlDocGetRootElement(doc);
+	if (root == NULL || !oscap_streq((const char *) root->name, "asset-report-collection")) {
+		oscap_seterr(OSCAP_EFAMILY_XML, "Expected <arf:asset-report-collection> at the root of '%s'.",
+				oscap_source_readable_origin(rds));
+		return -1;
+	}
+
+	struct oscap_htable *request_ids = oscap_htable_new();  // old id -> stored id
+	struct oscap_htable *asset_ids = oscap_htable_new();    // old id -> rds_store_asset
+	struct oscap_htable *report_ids = oscap_htable_new();   // old id -> new id
+	struct oscap_htable *report_nodes = oscap_htable_new(); // old id -> copied report
+	int ret = 0;
+
+	xmlNode *containers[RDS_STORE_CONTAINERS] = { NULL };
+	for (xmlNode *child = root->children; child != NULL; child = child->next) {
+		if (child->type != XML_ELEMENT_NODE)
+			continue;
+		if (oscap_streq((const char *) child->name, "relationships"))
+			containers[RDS_STORE_RELATIONSHIPS] = child;
+		else if (oscap_streq((const char *) child->name, "report-requests"))
+			containers[RDS_STORE_REPORT_REQUESTS] = child;
+		else if (oscap_streq((const char *) child->name, "assets"))
+			containers[RDS_STORE_ASSETS] = child;
+		else if (oscap_streq((const char *) child->name, "reports"))
+			containers[RDS_STORE_REPORTS] = child;
+	}
+
+	for (xmlNode *request = containers[RDS_STORE_REPORT_REQUESTS] != NULL ? containers[RDS_STORE_REPORT_REQUESTS]->children : NULL;
+			request != NULL; request = request->next) {
+		if (request->type != XML_ELEMENT_NODE || !oscap_streq((const char *) request->name, "report-request"))
+			continue;
+
+		xmlChar *old_id = xmlGetProp(request, BAD_CAST "id");
+		const char *id = _rds_store_add_request(s, doc, request);
+		if (id == NULL || old_id == NULL)
+			ret = -1;
+		else
+			oscap_htable_add(request_ids, (const char *) old_id, (void *) id);
+		xmlFree(old_id);
+	}
+
+	for (xmlNode *asset = containers[RDS_STORE_ASSETS] != NULL ? containers[RDS_STORE_ASSETS]->children : NULL;
+			asset != NULL; asset = asset->next) {
+		if (asset->type != XML_ELEMENT_NODE || !oscap_streq((const char *) asset->name, "asset"))
+			continue;
+
+		xmlChar *old_id = xmlGetProp(asset, BAD_CAST "id");
+		struct rds_store_asset *a = _rds_store_add_asset(s, doc, asset, (const char *) old_id);
+		if (old_id != NULL)
+			oscap_htable_add(asset_ids, (const char *) old_id, a);
+		xmlFree(old_id);
+	}
+
+	/* all the new ids first, the reports refer to each other */
+	xmlNode *reports = containers[RDS_STORE_REPORTS];
+	for (xmlNode *report = reports != NULL ? reports->children : NULL; report != NULL; report = report->next) {
+		if (report->type != XML_ELEMENT_NODE || !oscap_streq((const char *) report->name, "report"))
+			continue;
+
+		xmlChar *old_id = xmlGetProp(report, BAD_CAST "id");
+		if (old_id != NULL)
+			oscap_htable_add(report_ids, (const char *) old_id, oscap_sprintf("report%u", ++s->report_count));
+		xmlFree(old_id);
+	}
+
+	for (xmlNode *report = reports != NULL ? reports->children : NULL; report != NULL; report = report->next) {
+		if (report->type != XML_ELEMENT_NODE || !oscap_streq((const char *) report->name, "report"))
+			continue;
+
+		xmlChar *old_id = xmlGetProp(report, BAD_CAST "id");
+		const char *new_id = old_id != NULL ? oscap_htable_get(report_ids, (const char *) old_id) : NULL;
+		if (new_id == NULL) {
+			oscap_seterr(OSCAP_EFAMILY_XML, "Given ARF report has no id.");
+			ret = -1;
+		} else {
+			xmlNode *copy = _rds_store_clone(s, doc, report, _rds_store_container(s, RDS_STORE_REPORTS));
+			xmlSetProp(copy, BAD_CAST "id", BAD_CAST new_id);
+			_rds_store_update_refs(copy, report_ids, asset_ids);
+			oscap_htable_add(report_nodes, (const char *) old_id, copy);
+		}
+		xmlFree(old_id);
+	}
+
+	xmlNode *relationships = containers[RDS_STORE_RELATIONSHIPS];
+	for (xmlNode *rel = relationships != NULL ? relationships->children : NULL; rel != NULL; rel = rel->next) {
+		if (rel->type != XML_ELEMENT_NODE || !oscap_streq((const char *) rel->name, "relationship"))
+			continue;
+
+		xmlChar *type = xmlGetProp(rel, BAD_CAST "type");
+		xmlChar *subject = xmlGetProp(rel, BAD_CAST "subject");
+		xmlNode *ref_node = _rds_store_first_child(rel, "ref");
+		xmlChar *ref = ref_node != NULL ? xmlNodeGetContent(ref_node) : NULL;
+		const char *new_subject = subject != NULL ? oscap_htable_get(report_ids, (const char *) subject) : NULL;
+		const char *new_ref = NULL;
+
+		if (type != NULL && ref != NULL && oscap_str_endswith((const char *) type, ":isAbout")) {
+			struct rds_store_asset *a = oscap_htable_get(asset_ids, (const char *) ref);
+			if (a != NULL) {
+				new_ref = a->id;
+				xmlNode *report = oscap_htable_get(report_nodes, (const char *) subject);
+				if (report != NULL)
+					_rds_store_add_results(s, a, report);
+			}
+		} else if (type != NULL && ref != NULL && oscap_str_endswith((const char *) type, ":createdFor")) {
+			new_ref = oscap_htable_get(request_ids, (const char *) ref);
+		}
+
+		if (new_subject != NULL && new_ref != NULL) {
+			ds_rds_add_relationship(s->doc, _rds_store_container(s, RDS_STORE_RELATIONSHIPS),
+					(const char *) type, new_subject, new_ref);
+		} else {
+			dW("Dropping core:relationship/@type='%s' of '%s', its subject or ref is unknown.",
+					(const char *) type, (const char *) subject);
+		}
+
+		xmlFree(type);
+		xmlFree(subject);
+		xmlFree(ref);
+	}
+
+	oscap_htable_free0(request_ids);
+	oscap_htable_free0(asset_ids);
+	oscap_htable_free(report_ids, (oscap_destruct_func) oscap_free);
+	oscap_htable_free0(report_nodes);
+	return ret;
+}
+
+static int _rds_store_cmp_result(const void *a, const void *b)
+{
+	uint32_t ra = *(const uint32_t *) a >> RDS_STORE_RESULT_BITS;
+	uint32_t rb = *(const uint32_t *) b >> RDS_STORE_RESULT_BITS;
+
+	return ra < rb ? -1 : ra > rb;
+}
+
+static bool _rds_store_asset_has(struct rds_store_asset *a, uint32_t rule, uint32_t code)
+{
+	if (!a->sorted) {
+		qsort(a->results, a->count, sizeof(uint32_t), _rds_store_cmp_result);
+		a->sorted = true;
+	}
+
+	/* the first result of the rule, an asset may have several TestResults */
+	size_t lo = 0, hi = a->count;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (a->results[mid] >> RDS_STORE_RESULT_BITS < rule)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	for (; lo < a->count && a->results[lo] >> RDS_STORE_RESULT_BITS == rule; ++lo) {
+		if ((a->results[lo] & RDS_STORE_RESULT_MASK) == code)
+			return true;
+	}
+	return false;
+}
+
+struct oscap_stringlist *rds_store_get_assets_by_rule_result(struct rds_store *s, const char *rule_id, const char *result)
+{
+	int code = _rds_store_result_code(result);
+	if (code < 0) {
+		oscap_seterr(OSCAP_EFAMILY_OSCAP, "Unknown rule result '%s'.", result);
+		return NULL;
+	}
+
+	struct oscap_stringlist *ret = oscap_stringlist_new();
+	uintptr_t index = (uintptr_t) oscap_htable_get(s->rules, rule_id);
+	if (index == 0)
+		return ret;
+
+	struct oscap_iterator *it = oscap_iterator_new(s->assets);
+	while (oscap_iterator_has_more(it)) {
+		struct rds_store_asset *a = oscap_iterator_next(it);
+		if (_rds_store_asset_has(a, (uint32_t) (index - 1), (uint32_t) code))
+			oscap_stringlist_add_string(ret, a->id);
+	}
+	oscap_iterator_free(it);
+	return ret;
+}
+
+const char *rds_store_get_asset_name(struct rds_store *s, const char *asset_id)
+{
+	struct rds_store_asset *a = oscap_htable_get(s->asset_ids, asset_id);
+
+	return a != NULL ? a->name : NULL;
+}
+
+int rds_store_export(struct rds_store *s, const char *file)
+{
+	/* arf:reports is required */
+	_rds_store_container(s, RDS_STORE_REPORTS);
+	return oscap_xml_save_filename(file, s->doc) == 1 ? 0 : -1;
+}
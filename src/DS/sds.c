@@ -242,6 +242,14 @@ static int ds_sds_register_xmlDoc(struct ds_sds_session *session, xmlDoc* doc, x
 	return 0; // TODO: Return value of ds_sds_session_register_component_source(). (commit message)
 }
 
+static int ds_sds_register_xmlNode(struct ds_sds_session *session, xmlNodePtr component_inner_root, const char *relative_filepath)
+{
+	struct oscap_source *component_source = oscap_source_new_from_xmlNode(ds_sds_session_get_source(session), component_inner_root, relative_filepath);
+
+	ds_sds_session_register_component_source(session, relative_filepath, component_source);
+	return 0;
+}
+
 static int ds_sds_register_component(struct ds_sds_session *session, xmlDoc* doc, xmlNodePtr component_inner_root, const char* component_id, const char* target_filename_dirname, const char* relative_filepath)
 {
 	if (component_inner_root == NULL)
@@ -282,8 +290,21 @@ static int ds_sds_dump_local_component(const char* component_id, struct ds_sds_s
 {
 	xmlDoc *doc = ds_sds_session_get_xmlDoc(session);
 
-	xmlNodePtr inner_root = ds_sds_get_component_root_by_id(doc, component_id);
+	xmlNodePtr component = ds_sds_session_get_component(session, component_id);
+	if (component == NULL) {
+		oscap_seterr(OSCAP_EFAMILY_XML, "Component of given id '%s' was not found in the document.", component_id);
+		return -1;
+	}
 
+	// The component may be borrowed by a source registered before
+	oscap_source_reclaim_subtrees(ds_sds_session_get_source(session), component);
+
+	xmlNodePtr inner_root = node_get_child_element(component, NULL);
+
+	if (inner_root != NULL && strcmp((const char*)inner_root->name, "script") != 0) {
+		// The component is borrowed from the data stream, not copied
+		return ds_sds_register_xmlNode(session, inner_root, relative_filepath);
+	}
 	return ds_sds_register_component(session, doc, inner_root, component_id, target_filename_dirname, relative_filepath);
 }
 
@@ -318,7 +339,7 @@ static int ds_dsd_dump_remote_component(const char* url, const char* component_i
 
 	ds_sds_session_remote_resources_progress(session)(false, "Downloading: %s ... ", url);
 
-	char* mem = oscap_acquire_url_download(url, &memory_size);
+	char* mem = ds_sds_session_download_remote_component(session, url, &memory_size);
 	if (mem == NULL) {
 		ds_sds_session_remote_resources_progress(session)(false, "error\n", url);
 		return -1;
@@ -481,7 +502,7 @@ int ds_sds_dump_component_ref_as(const xmlNodePtr component_ref, struct ds_sds_s
 
 			// the pointer arithmetics simply skips the first character which is '#'
 			assert(str_uri[0] == '#');
-			xmlNodePtr cat_component_ref = ds_sds_find_component_ref(ds_sds_session_get_selected_datastream(session), str_uri + 1 * sizeof(char));
+			xmlNodePtr cat_component_ref = ds_sds_session_get_component_ref(session, str_uri + 1 * sizeof(char));
 
 			if (!cat_component_ref)
 			{
@@ -32,6 +32,7 @@
 #include "sds_index_priv.h"
 #include "source/oscap_source_priv.h"
 #include "source/public/oscap_source.h"
+#include "XCCDF/public/xccdf_benchmark.h"
 
 #include <libxml/xmlreader.h>
 #include <string.h>
@@ -48,6 +49,7 @@ struct ds_stream_index
 	struct oscap_stringlist* extended_components;
 
 	struct oscap_htable *component_id_to_component_ref_id;
+	struct oscap_htable *component_ref_id_to_component_id;
 };
 
 struct ds_stream_index* ds_stream_index_new(void)
@@ -64,6 +66,7 @@ struct ds_stream_index* ds_stream_index_new(void)
 	ret->extended_components = oscap_stringlist_new();
 
 	ret->component_id_to_component_ref_id = oscap_htable_new();
+	ret->component_ref_id_to_component_id = oscap_htable_new();
 
 	return ret;
 }
@@ -80,6 +83,7 @@ void ds_stream_index_free(struct ds_stream_index* s)
 	oscap_stringlist_free(s->extended_components);
 
 	oscap_htable_free(s->component_id_to_component_ref_id, (oscap_destruct_func)oscap_free);
+	oscap_htable_free(s->component_ref_id_to_component_id, (oscap_destruct_func)oscap_free);
 
 	oscap_free(s);
 }
@@ -99,6 +103,11 @@ const char* ds_stream_index_get_version(struct ds_stream_index* s)
 	return s->version;
 }
 
+const char *ds_stream_index_get_component_id(struct ds_stream_index *s, const char *component_ref_id)
+{
+	return (const char*)oscap_htable_get(s->component_ref_id_to_component_id, component_ref_id);
+}
+
 struct oscap_string_iterator* ds_stream_index_get_checks(struct ds_stream_index* s)
 {
 	return oscap_iterator_new((struct oscap_list*)s->check_components);
@@ -190,6 +199,13 @@ static struct ds_stream_index* ds_stream_index_parse(xmlTextReaderPtr reader)
 				// this copies the id_attr string
 				oscap_stringlist_add_string(cref_target, (const char*)id_attr);
 
+				// only the components of the collection, not the external ones
+				if (id_attr && href_attr && href_attr[0] == '#') {
+					char *local_id = oscap_strdup((const char*)href_attr + 1);
+					if (!oscap_htable_add(ret->component_ref_id_to_component_id, (const char*)id_attr, local_id))
+						oscap_free(local_id);
+				}
+
 				// because of the leading '#' in the href preceding the component id
 				const char *component_id = (const char*)(href_attr && href_attr[0] ? (href_attr + 1 * sizeof(char)) : NULL);
 				if (!component_id || !oscap_htable_add(ret->component_id_to_component_ref_id, component_id, (char*)id_attr)) {
@@ -212,11 +228,147 @@ static struct ds_stream_index* ds_stream_index_parse(xmlTextReaderPtr reader)
 	return ret;
 }
 
+struct ds_profile_index
+{
+	char *id;
+	char *title;
+	bool abstract;
+};
+
+static void ds_profile_index_free(struct ds_profile_index *p)
+{
+	oscap_free(p->id);
+	oscap_free(p->title);
+	oscap_free(p);
+}
+
+const char *ds_profile_index_get_id(const struct ds_profile_index *p)
+{
+	return p->id;
+}
+
+const char *ds_profile_index_get_title(const struct ds_profile_index *p)
+{
+	return p->title;
+}
+
+bool ds_profile_index_get_abstract(const struct ds_profile_index *p)
+{
+	return p->abstract;
+}
+
+struct ds_check_file_index
+{
+	char *system;
+	char *href;
+};
+
+static void ds_check_file_index_free(struct ds_check_file_index *f)
+{
+	oscap_free(f->system);
+	oscap_free(f->href);
+	oscap_free(f);
+}
+
+static bool ds_check_file_index_equal(struct ds_check_file_index *f1, struct ds_check_file_index *f2)
+{
+	return oscap_streq(f1->system, f2->system) && oscap_streq(f1->href, f2->href);
+}
+
+const char *ds_check_file_index_get_system(const struct ds_check_file_index *f)
+{
+	return f->system;
+}
+
+const char *ds_check_file_index_get_href(const struct ds_check_file_index *f)
+{
+	return f->href;
+}
+
+struct ds_benchmark_index
+{
+	char *id;
+	bool resolved;
+
+	struct oscap_list *statuses;
+	struct oscap_list *profiles;
+	struct oscap_list *check_files;
+	struct oscap_stringlist *test_results;
+};
+
+static struct ds_benchmark_index *ds_benchmark_index_new(void)
+{
+	struct ds_benchmark_index *ret = oscap_calloc(1, sizeof(struct ds_benchmark_index));
+
+	ret->statuses = oscap_list_new();
+	ret->profiles = oscap_list_new();
+	ret->check_files = oscap_list_new();
+	ret->test_results = oscap_stringlist_new();
+
+	return ret;
+}
+
+static void ds_benchmark_index_free(struct ds_benchmark_index *b)
+{
+	if (b != NULL) {
+		oscap_free(b->id);
+		oscap_list_free(b->statuses, (oscap_destruct_func)xccdf_status_free);
+		oscap_list_free(b->profiles, (oscap_destruct_func)ds_profile_index_free);
+		oscap_list_free(b->check_files, (oscap_destruct_func)ds_check_file_index_free);
+		oscap_stringlist_free(b->test_results);
+		oscap_free(b);
+	}
+}
+
+const char *ds_benchmark_index_get_id(const struct ds_benchmark_index *b)
+{
+	return b->id;
+}
+
+bool ds_benchmark_index_get_resolved(const struct ds_benchmark_index *b)
+{
+	return b->resolved;
+}
+
+struct xccdf_status *ds_benchmark_index_get_status_current(const struct ds_benchmark_index *b)
+{
+	// the same choice as xccdf_item_get_current_status
+	time_t maxtime = 0;
+	struct xccdf_status *max_status = NULL;
+	struct xccdf_status *status;
+	const struct oscap_list_item *li = b->statuses->first;
+	while (li) {
+		status = li->data;
+		if (xccdf_status_get_date(status) == 0 || xccdf_status_get_date(status) >= maxtime) {
+			maxtime = xccdf_status_get_date(status);
+			max_status = status;
+		}
+		li = li->next;
+	}
+	return max_status;
+}
+
+struct ds_profile_index_iterator *ds_benchmark_index_get_profiles(const struct ds_benchmark_index *b)
+{
+	return (struct ds_profile_index_iterator*)oscap_iterator_new(b->profiles);
+}
+
+struct ds_check_file_index_iterator *ds_benchmark_index_get_check_files(const struct ds_benchmark_index *b)
+{
+	return (struct ds_check_file_index_iterator*)oscap_iterator_new(b->check_files);
+}
+
+struct oscap_string_iterator *ds_benchmark_index_get_test_results(const struct ds_benchmark_index *b)
+{
+	return oscap_iterator_new((struct oscap_list*)b->test_results);
+}
+
 struct ds_sds_index
 {
 	struct oscap_list *streams;
 
 	struct oscap_htable *benchmark_id_to_component_id;
+	struct oscap_htable *component_id_to_benchmark;
 };
 
 struct ds_sds_index* ds_sds_index_new(void)
@@ -225,6 +377,7 @@ struct ds_sds_index* ds_sds_index_new(void)
 	ret->streams = oscap_list_new();
 
 	ret->benchmark_id_to_component_id = oscap_htable_new();
+	ret->component_id_to_benchmark = oscap_htable_new();
 
 	return ret;
 }
@@ -235,6 +388,7 @@ void ds_sds_index_free(struct ds_sds_index* s)
 		oscap_list_free(s->streams, (oscap_destruct_func)ds_stream_index_free);
 
 		oscap_htable_free(s->benchmark_id_to_component_id, (oscap_destruct_func)oscap_free);
+		oscap_htable_free(s->component_id_to_benchmark, (oscap_destruct_func)ds_benchmark_index_free);
 
 		oscap_free(s);
 	}
@@ -270,7 +424,23 @@ struct ds_stream_index_iterator* ds_sds_index_get_streams(struct ds_sds_index* s
 	return (struct ds_stream_index_iterator*)oscap_iterator_new(s->streams);
 }
 
-static char *ds_sds_component_dig_benchmark_id(xmlTextReaderPtr reader)
+struct ds_benchmark_index *ds_sds_index_get_benchmark(struct ds_sds_index *s, const char *component_id)
+{
+	return (struct ds_benchmark_index *)oscap_htable_get(s->component_id_to_benchmark, component_id);
+}
+
+static bool ds_benchmark_element_is(xmlTextReaderPtr reader, const char *name, const char *namespace)
+{
+	return strcmp((const char*)xmlTextReaderConstLocalName(reader), name) == 0 &&
+		oscap_streq((const char*)xmlTextReaderConstNamespaceUri(reader), namespace);
+}
+
+/*
+ * Besides the id, collects what oscap info shows about the Benchmark, so that
+ * it doesn't need to build the whole model: the statuses, profiles, TestResults
+ * and the check files in the order of xccdf_policy_model_get_systems_and_files.
+ */
+static struct ds_benchmark_index *ds_sds_component_dig_benchmark(xmlTextReaderPtr reader)
 {
 	// sanity check
 	if (xmlTextReaderNodeType(reader) != XML_READER_TYPE_ELEMENT ||
@@ -284,7 +454,14 @@ static char *ds_sds_component_dig_benchmark_id(xmlTextReaderPtr reader)
 		return NULL;
 	}
 
-	char *ret = NULL;
+	struct ds_benchmark_index *ret = NULL;
+	struct ds_profile_index *profile = NULL;
+	char *namespace = NULL;
+	char *check_system = NULL;
+	bool in_test_result = false;
+	bool skipping = false;
+	int bench_depth = 0;
+
 	while (xmlTextReaderRead(reader) == 1)
 	{
 		int node_type = xmlTextReaderNodeType(reader);
@@ -295,22 +472,90 @@ static char *ds_sds_component_dig_benchmark_id(xmlTextReaderPtr reader)
 			// we are done reading
 			break;
 		}
-		else if (node_type == XML_READER_TYPE_ELEMENT &&
-				 strcmp(local_name, "Benchmark") == 0) {
+		else if (node_type != XML_READER_TYPE_ELEMENT || skipping) {
+			// ignore
+		}
+		else if (strcmp(local_name, "Benchmark") == 0) {
 			if (ret) {
 				oscap_seterr(OSCAP_EFAMILY_XML,
 		             "Found 2 Benchmark elements inside a single sds:component element! "
 					 "Please make sure your datastream is valid. Skipping the second Benchmark.");
+				skipping = true;
 			}
 			else {
-				ret = (char*)xmlTextReaderGetAttribute(reader, BAD_CAST "id");
+				char *resolved = (char*)xmlTextReaderGetAttribute(reader, BAD_CAST "resolved");
+
+				ret = ds_benchmark_index_new();
+				ret->id = (char*)xmlTextReaderGetAttribute(reader, BAD_CAST "id");
+				ret->resolved = resolved != NULL && oscap_string_to_enum(OSCAP_BOOL_MAP, resolved);
+				namespace = oscap_strdup((const char*)xmlTextReaderConstNamespaceUri(reader));
+				bench_depth = xmlTextReaderDepth(reader);
+				xmlFree(resolved);
 			}
 		}
-		else {
+		else if (ret == NULL) {
+			// ignore
+		}
+		else if (xmlTextReaderDepth(reader) == bench_depth + 1) {
+			profile = NULL;
+			in_test_result = false;
+
+			if (ds_benchmark_element_is(reader, "status", namespace)) {
+				char *date = (char*)xmlTextReaderGetAttribute(reader, BAD_CAST "date");
+				char *str = oscap_element_string_copy(reader);
+				struct xccdf_status *status = xccdf_status_new_fill(str, date);
+				if (status != NULL)
+					oscap_list_add(ret->statuses, status);
+				oscap_free(str);
+				xmlFree(date);
+			}
+			else if (ds_benchmark_element_is(reader, "Profile", namespace)) {
+				char *abstract = (char*)xmlTextReaderGetAttribute(reader, BAD_CAST "abstract");
+
+				profile = oscap_calloc(1, sizeof(struct ds_profile_index));
+				profile->id = (char*)xmlTextReaderGetAttribute(reader, BAD_CAST "id");
+				profile->abstract = abstract != NULL && oscap_string_to_enum(OSCAP_BOOL_MAP, abstract);
+				oscap_list_add(ret->profiles, profile);
+				xmlFree(abstract);
+			}
+			else if (ds_benchmark_element_is(reader, "TestResult", namespace)) {
+				char *id = (char*)xmlTextReaderGetAttribute(reader, BAD_CAST "id");
+
+				// the checks of the rule-results are not a part of the content
+				in_test_result = true;
+				oscap_stringlist_add_string(ret->test_results, id);
+				xmlFree(id);
+			}
+		}
+		else if (profile != NULL) {
+			if (profile->title == NULL && xmlTextReaderDepth(reader) == bench_depth + 2 &&
+			    ds_benchmark_element_is(reader, "title", namespace))
+				profile->title = oscap_element_string_copy(reader);
+		}
+		else if (in_test_result) {
 			// ignore
 		}
+		else if (ds_benchmark_element_is(reader, "check", namespace)) {
+			// the check-content-refs belong to the last check opened,
+			// the checks of a complex-check have their own
+			oscap_free(check_system);
+			check_system = (char*)xmlTextReaderGetAttribute(reader, BAD_CAST "system");
+		}
+		else if (ds_benchmark_element_is(reader, "check-content-ref", namespace)) {
+			struct ds_check_file_index *file = oscap_calloc(1, sizeof(struct ds_check_file_index));
+
+			file->system = oscap_strdup(check_system);
+			file->href = (char*)xmlTextReaderGetAttribute(reader, BAD_CAST "href");
+			if (oscap_list_contains(ret->check_files, file, (oscap_cmp_func)ds_check_file_index_equal))
+				ds_check_file_index_free(file);
+			else
+				oscap_list_add(ret->check_files, file);
+		}
 	}
 
+	oscap_free(check_system);
+	oscap_free(namespace);
+
 	return ret;
 }
 
@@ -362,12 +607,17 @@ struct ds_sds_index* ds_sds_index_parse(xmlTextReaderPtr reader)
 		}
 		else if (strcmp(name, "component") == 0) {
 			char *component_id = (char*)xmlTextReaderGetAttribute(reader, BAD_CAST "id");
-			char *benchmark_id = ds_sds_component_dig_benchmark_id(reader);
+			struct ds_benchmark_index *benchmark = ds_sds_component_dig_benchmark(reader);
+			const char *benchmark_id = benchmark != NULL ? benchmark->id : NULL;
 
-			if (benchmark_id == NULL) {
+			if (benchmark_id == NULL || component_id == NULL) {
+				ds_benchmark_index_free(benchmark);
 				oscap_free(component_id);
 			}
 			else {
+				if (!oscap_htable_add(ret->component_id_to_benchmark, component_id, benchmark))
+					ds_benchmark_index_free(benchmark);
+
 				if (!oscap_htable_add(ret->benchmark_id_to_component_id, benchmark_id, component_id)) {
 					// This benchmark ID was already in the map, therefore there must be 2 components
 					// with Benchmarks in them that have the same IDs. In this case, all bets are off
@@ -384,8 +634,6 @@ struct ds_sds_index* ds_sds_index_parse(xmlTextReaderPtr reader)
 
 					oscap_free(component_id);
 				}
-
-				oscap_free(benchmark_id);
 			}
 
 			// we are going to free the component_id string later (in ds_sds_index_free)
@@ -424,6 +672,20 @@ struct ds_sds_index *ds_sds_index_import(const char* file)
 	return ret;
 }
 
+struct ds_sds_index *ds_sds_index_import_source(struct oscap_source *source)
+{
+	xmlTextReader *reader = oscap_source_get_streaming_xmlTextReader(source);
+	if (!reader) {
+		return NULL;
+	}
+
+	while (xmlTextReaderRead(reader) == 1 && xmlTextReaderNodeType(reader) != XML_READER_TYPE_ELEMENT);
+	struct ds_sds_index* ret = ds_sds_index_parse(reader);
+	xmlFreeTextReader(reader);
+
+	return ret;
+}
+
 int ds_sds_index_select_checklist(struct ds_sds_index* s,
 		const char** datastream_id, const char** component_id)
 {
@@ -519,3 +781,33 @@ void ds_stream_index_iterator_free(struct ds_stream_index_iterator *it)
 {
 	oscap_iterator_free((struct oscap_iterator*)it);
 }
+
+struct ds_profile_index *ds_profile_index_iterator_next(struct ds_profile_index_iterator *it)
+{
+	return (struct ds_profile_index*)(oscap_iterator_next((struct oscap_iterator*)it));
+}
+
+bool ds_profile_index_iterator_has_more(struct ds_profile_index_iterator *it)
+{
+	return oscap_iterator_has_more((struct oscap_iterator*)it);
+}
+
+void ds_profile_index_iterator_free(struct ds_profile_index_iterator *it)
+{
+	oscap_iterator_free((struct oscap_iterator*)it);
+}
+
+struct ds_check_file_index *ds_check_file_index_iterator_next(struct ds_check_file_index_iterator *it)
+{
+	return (struct ds_check_file_index*)(oscap_iterator_next((struct oscap_iterator*)it));
+}
+
+bool ds_check_file_index_iterator_has_more(struct ds_check_file_index_iterator *it)
+{
+	return oscap_iterator_has_more((struct oscap_iterator*)it);
+}
+
+void ds_check_file_index_iterator_free(struct ds_check_file_index_iterator *it)
+{
+	oscap_iterator_free((struct oscap_iterator*)it);
+}
@@ -43,19 +43,25 @@
 /* Variable definitions
  * */
 
-typedef struct _oval_collection_item_frame {
-	struct _oval_collection_item_frame *next;
-	void *item;
-} _oval_collection_item_frame_t;
-
+/*
+ * The items are kept in arrays. A collection keeps them in the order they
+ * were added, an iterator keeps them as a stack: the next item is the
+ * last one, so an item added to an iterator is returned first.
+ */
 typedef struct oval_collection {
-	struct _oval_collection_item_frame *item_collection_frame;
+	void **items;
+	int count;
+	int alloc;
 } oval_collection_t;
 
 typedef struct oval_iterator {
-	struct _oval_collection_item_frame *item_iterator_frame;
+	void **items;
+	int count;
+	int alloc;
 } oval_iterator_t;
 
+#define OVAL_COLLECTION_MINALLOC 4
+
 static bool debug = true;
 static struct oval_iterator *_debugStack[0];
 static int iterator_count;
@@ -64,13 +70,34 @@ static int iterator_count;
  * */
 /***************************************************************************/
 
+/* make room for one more item */
+static bool _oval_items_grow(void ***items, int count, int *alloc)
+{
+	void **new_items;
+	int new_alloc;
+
+	if (count < *alloc)
+		return true;
+
+	new_alloc = *alloc > 0 ? *alloc * 2 : OVAL_COLLECTION_MINALLOC;
+	new_items = oscap_realloc(*items, sizeof(void *) * new_alloc);
+	if (new_items == NULL)
+		return false;
+
+	*items = new_items;
+	*alloc = new_alloc;
+	return true;
+}
+
 struct oval_collection *oval_collection_new()
 {
 	struct oval_collection *collection = (struct oval_collection *)oscap_alloc(sizeof(oval_collection_t));
 	if (collection == NULL)
 		return NULL;
 
-	collection->item_collection_frame = NULL;
+	collection->items = NULL;
+	collection->count = 0;
+	collection->alloc = 0;
 	return collection;
 }
 
@@ -82,19 +109,15 @@ void oval_collection_free(struct oval_collection *collection)
 void oval_collection_free_items(struct oval_collection *collection, oscap_destruct_func free_func)
 {
 	if (collection) {
-		struct _oval_collection_item_frame *frame = collection->item_collection_frame;
-		while (frame != NULL) {
-			if (free_func != NULL) {
-				void *item = frame->item;
+		if (free_func != NULL) {
+			/* the last added first, as before */
+			for (int i = collection->count - 1; i >= 0; --i) {
+				void *item = collection->items[i];
 				if (item)
 					(*free_func) (item);
-				frame->item = NULL;
 			}
-			struct _oval_collection_item_frame *temp = frame;
-			frame = frame->next;
-			temp->next = NULL;
-			oscap_free(temp);
 		}
+		oscap_free(collection->items);
 		oscap_free(collection);
 	}
 }
@@ -102,20 +125,17 @@ void oval_collection_free_items(struct oval_collection *collection, oscap_destru
 int oval_collection_is_empty(struct oval_collection *collection)
 {
 	__attribute__nonnull__(collection);
-	return collection->item_collection_frame == NULL;
+	return collection->count == 0;
 }
 
 void oval_collection_add(struct oval_collection *collection, void *item)
 {
 	__attribute__nonnull__(collection);
 
-	struct _oval_collection_item_frame *next = oscap_alloc(sizeof(_oval_collection_item_frame_t));
-	if (next == NULL)
+	if (!_oval_items_grow(&collection->items, collection->count, &collection->alloc))
 		return;
 
-	next->next = collection->item_collection_frame;
-	collection->item_collection_frame = next;
-	next->item = item;
+	collection->items[collection->count++] = item;
 }
 
 struct oval_iterator *oval_collection_iterator(struct oval_collection *collection)
@@ -126,25 +146,27 @@ struct oval_iterator *oval_collection_iterator(struct oval_collection *collectio
 	if (iterator == NULL)
 		return NULL;
 
-	if ((iterator_count++) < 0) {
+	if (__sync_fetch_and_add(&iterator_count, 1) < 0) {
 		_debugStack[iterator_count - 1] = iterator;
 		dW("iterator_count: %d.", iterator_count);
 	}
 
-	iterator->item_iterator_frame = NULL;
-	struct _oval_collection_item_frame *collection_frame = collection->item_collection_frame;
+	/* a snapshot; changes of the collection don't affect the iterator */
+	iterator->count = collection->count;
+	iterator->alloc = collection->count;
+	iterator->items = NULL;
 
-	while (collection_frame != NULL) {
-		struct _oval_collection_item_frame *iterator_frame =
-		    (struct _oval_collection_item_frame *)oscap_alloc(sizeof(_oval_collection_item_frame_t));
-		if (iterator_frame == NULL)
+	if (iterator->count > 0) {
+		iterator->items = oscap_alloc(sizeof(void *) * iterator->count);
+		if (iterator->items == NULL) {
+			oscap_free(iterator);
 			return NULL;
+		}
 
-		iterator_frame->next = iterator->item_iterator_frame;
-		iterator_frame->item = collection_frame->item;
-		iterator->item_iterator_frame = iterator_frame;
-		collection_frame = collection_frame->next;
+		for (int i = 0, j = collection->count - 1; j >= 0; ++i, --j)
+			iterator->items[i] = collection->items[j];
 	}
+
 	return iterator;
 }
 
@@ -152,7 +174,7 @@ bool oval_collection_iterator_has_more(struct oval_iterator * iterator)
 {
 	__attribute__nonnull__(iterator);
 
-	return iterator->item_iterator_frame != NULL;
+	return iterator->count > 0;
 }
 
 int oval_collection_iterator_remaining(struct oval_iterator *iterator)
@@ -160,53 +182,30 @@ int oval_collection_iterator_remaining(struct oval_iterator *iterator)
 
 	__attribute__nonnull__(iterator);
 
-	int remaining;
-	struct _oval_collection_item_frame *next = iterator->item_iterator_frame;
-
-	for (remaining = 0; next; remaining++)
-		next = next->next;
-
-	return remaining;
+	return iterator->count;
 }
 
 void *oval_collection_iterator_next(struct oval_iterator *iterator)
 {
 	__attribute__nonnull__(iterator);
 
-	struct _oval_collection_item_frame *oc_next = iterator->item_iterator_frame;
-	void *next;
-
-	if (oc_next == NULL) {
-		next = NULL;
-	} else {
-		next = oc_next->item;
-		iterator->item_iterator_frame = oc_next->next;
-		oc_next->item = NULL;
-		oc_next->next = NULL;
-		oscap_free(oc_next);
-	}
-	return next;
+	if (iterator->count == 0)
+		return NULL;
+
+	return iterator->items[--iterator->count];
 }
 
 void oval_collection_iterator_free(struct oval_iterator *iterator)
 {
 	if (iterator) {		//NOOP if iterator is NULL
-		if ((--iterator_count) < 0) {
+		if (__sync_sub_and_fetch(&iterator_count, 1) < 0) {
 			dW("iterator_count: %d.", iterator_count);
 			if (iterator != _debugStack[iterator_count]) {
 				debug = false;
 			}
 		}
 
-		while (iterator->item_iterator_frame) {
-			struct _oval_collection_item_frame *oc_this;
-			oc_this = iterator->item_iterator_frame;
-			iterator->item_iterator_frame = oc_this->next;
-			oc_this->item = NULL;
-			oc_this->next = NULL;
-			oscap_free(oc_this);
-		}
-		iterator->item_iterator_frame = NULL;
+		oscap_free(iterator->items);
 		oscap_free(iterator);
 	}
 }
@@ -217,11 +216,13 @@ struct oval_iterator *oval_collection_iterator_new()
 	if (iterator == NULL)
 		return NULL;
 
-	if ((iterator_count++) < 0) {
+	if (__sync_fetch_and_add(&iterator_count, 1) < 0) {
 		_debugStack[iterator_count - 1] = iterator;
 		dW("iterator_count: %d.", iterator_count);
 	}
-	iterator->item_iterator_frame = NULL;
+	iterator->items = NULL;
+	iterator->count = 0;
+	iterator->alloc = 0;
 	return iterator;
 }
 
@@ -229,14 +230,10 @@ void oval_collection_iterator_add(struct oval_iterator *iterator, void *item)
 {
 	__attribute__nonnull__(iterator);
 
-	struct _oval_collection_item_frame *newframe =
-	    (struct _oval_collection_item_frame *)oscap_alloc(sizeof(_oval_collection_item_frame_t));
-	if (newframe == NULL)	/* We don't have any information that error occured ! */
-		return;
+	if (!_oval_items_grow(&iterator->items, iterator->count, &iterator->alloc))
+		return;	/* We don't have any information that error occured ! */
 
-	newframe->next = iterator->item_iterator_frame;
-	newframe->item = item;
-	iterator->item_iterator_frame = newframe;
+	iterator->items[iterator->count++] = item;
 }
 
 bool oval_string_iterator_has_more(struct oval_string_iterator * iterator)
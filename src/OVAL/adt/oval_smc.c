@@ -112,7 +112,7 @@ void oval_smc_free(struct oval_smc *map, oscap_destruct_func destructor)
 {
 	if (map == NULL)
 		return;
-	struct oval_iterator *map_it = oval_string_map_values((struct oval_string_map *) map);
+	struct oval_iterator *map_it = oval_string_map_values_unordered((struct oval_string_map *) map);
 	while (oval_collection_iterator_has_more(map_it)) {
 		struct oval_collection *list_col = (struct oval_collection *) oval_collection_iterator_next(map_it);
 		oval_collection_free_items(list_col, destructor);
@@ -192,69 +192,169 @@ void oval_string_map_free_string(struct oval_string_map *map)
 	oval_string_map_free(map, oscap_free);
 }
 #else
-# include <rbt/rbt.h>
+# include <stdint.h>
 # include <assume.h>
 
+/*
+ * The entries are kept in an array in the order they were added, the
+ * open addressing table (linear probing) holds their indexes + 1. The hash
+ * of a key is stored with the entry, so a lookup compares the strings only
+ * when the hashes match and growing the table doesn't rehash anything.
+ * Keys can't be removed.
+ */
+struct oval_string_map_entry {
+	uint32_t hash;
+	char    *key;
+	void    *data;
+};
+
+struct oval_string_map {
+	struct oval_string_map_entry *entries;
+	uint32_t  count;
+	uint32_t  alloc;
+	uint32_t *slots;
+	uint32_t  size; /* a power of two */
+};
+
+#define OVAL_STRING_MAP_INIT_SIZE 16
+
+/* FNV-1a */
+static uint32_t oval_string_map_hash(const char *key)
+{
+	uint32_t h = 2166136261U;
+
+	while (*key != '\0') {
+		h ^= (uint8_t)*key++;
+		h *= 16777619U;
+	}
+
+	return (h);
+}
+
 struct oval_string_map *oval_string_map_new(void)
 {
-	return (struct oval_string_map *)(rbt_str_new());
+	struct oval_string_map *map;
+
+	map = oscap_talloc(struct oval_string_map);
+	map->entries = NULL;
+	map->count = 0;
+	map->alloc = 0;
+	map->slots = oscap_calloc(OVAL_STRING_MAP_INIT_SIZE, sizeof(uint32_t));
+	map->size  = OVAL_STRING_MAP_INIT_SIZE;
+
+	return (map);
 }
 
-void oval_string_map_put(struct oval_string_map *map, const char *key, void *val)
+/* the slot of the key, or the empty slot where it belongs */
+static uint32_t *oval_string_map_slot(struct oval_string_map *map, const char *key, uint32_t hash)
+{
+	uint32_t i, *slot;
+
+	for (i = hash & (map->size - 1);; i = (i + 1) & (map->size - 1)) {
+		slot = map->slots + i;
+
+		if (*slot == 0)
+			return (slot);
+
+		struct oval_string_map_entry *e = map->entries + (*slot - 1);
+		if (e->hash == hash && strcmp(e->key, key) == 0)
+			return (slot);
+	}
+}
+
+/* keep the load factor below 3/4 */
+static void oval_string_map_grow(struct oval_string_map *map)
+{
+	uint32_t i, j;
+
+	if ((map->count + 1) * 4 < map->size * 3)
+		return;
+
+	oscap_free(map->slots);
+	map->size *= 2;
+	map->slots = oscap_calloc(map->size, sizeof(uint32_t));
+
+	for (i = 0; i < map->count; ++i) {
+		for (j = map->entries[i].hash & (map->size - 1); map->slots[j] != 0; j = (j + 1) & (map->size - 1));
+		map->slots[j] = i + 1;
+	}
+}
+
+/* false if the key is already there; the existing value is kept */
+static bool oval_string_map_add(struct oval_string_map *map, const char *key, void *val)
 {
-        char *key_copy;
+	uint32_t hash, *slot;
+	struct oval_string_map_entry *e;
+
+	hash = oval_string_map_hash(key);
+	slot = oval_string_map_slot(map, key, hash);
+
+	if (*slot != 0)
+		return (false);
+
+	if (map->count == map->alloc) {
+		map->alloc = map->alloc > 0 ? map->alloc * 2 : OVAL_STRING_MAP_INIT_SIZE;
+		map->entries = oscap_realloc(map->entries, sizeof(struct oval_string_map_entry) * map->alloc);
+	}
+
+	e = map->entries + map->count;
+	e->hash = hash;
+	e->key  = oscap_strdup(key);
+	e->data = val;
+	*slot = ++map->count;
 
+	oval_string_map_grow(map);
+
+	return (true);
+}
+
+void oval_string_map_put(struct oval_string_map *map, const char *key, void *val)
+{
 	assume_d(map != NULL, /* void */);
 	assume_d(key != NULL, /* void */);
 
-	if (rbt_str_add((rbt_t *)map, key_copy = strdup(key), val) != 0) {
-		dW("rbt_str_add: non-zero return code");
-                oscap_free(key_copy);
-        }
+	if (!oval_string_map_add(map, key, val))
+		dW("oval_string_map_put: the key '%s' is already in the map", key);
 }
 
 void oval_string_map_put_string(struct oval_string_map *map, const char *key, const char *val)
 {
-	char *str = strdup(val), *key_copy;
+	char *str = oscap_strdup(val);
 
 	assume_d(map != NULL, /* void */);
 	assume_d(key != NULL, /* void */);
 
-	if (rbt_str_add((rbt_t *)map, key_copy = strdup(key), str) == 0)
-		return;
-	else {
+	if (!oval_string_map_add(map, key, str))
 		oscap_free(str);
-                oscap_free(key_copy);
-        }
-	return;
 }
 
 void *oval_string_map_get_value(struct oval_string_map *map, const char *key)
 {
-	void *val = NULL;
+	uint32_t *slot;
 
 	assume_d(map != NULL, NULL);
 	assume_d(key != NULL, NULL);
 
-	if (rbt_str_get((rbt_t *)map, key, &val) != 0)
-		return (NULL);
-	else
-		return (val);
-}
+	slot = oval_string_map_slot(map, key, oval_string_map_hash(key));
 
-static void __oval_string_map_node_free(struct rbt_str_node *n, oscap_destruct_func destroy)
-{
-	if (destroy != NULL)
-		destroy(n->data);
-	oscap_free(n->key);
+	return (*slot != 0 ? map->entries[*slot - 1].data : NULL);
 }
 
 void oval_string_map_free(struct oval_string_map *map, oscap_destruct_func destroy)
 {
+	uint32_t i;
+
 	assume_d(map != NULL, /* void */);
-	rbt_str_free_cb2((rbt_t *)map,
-			 (void(*)(struct rbt_str_node *, void *))__oval_string_map_node_free,
-			 (void *)destroy);
+
+	for (i = 0; i < map->count; ++i) {
+		if (destroy != NULL)
+			destroy(map->entries[i].data);
+		oscap_free(map->entries[i].key);
+	}
+
+	oscap_free(map->entries);
+	oscap_free(map->slots);
+	oscap_free(map);
 }
 
 void oval_string_map_free0(struct oval_string_map *map)
@@ -268,66 +368,143 @@ void oval_string_map_free_string(struct oval_string_map *map)
 	oval_string_map_free(map, oscap_free);
 }
 
-static int __oval_iterator_addkey(struct rbt_str_node *n, void *u)
+static int __oval_string_map_entry_cmp(const void *a, const void *b)
 {
-	struct oval_iterator *it = (struct oval_iterator *)u;
-
-	oval_collection_iterator_add(it, (void *)n->key);
-
-	return (0);
+	return strcmp((*(const struct oval_string_map_entry **)a)->key,
+		      (*(const struct oval_string_map_entry **)b)->key);
 }
 
-static int __oval_iterator_addval(struct rbt_str_node *n, void *u)
+/*
+ * The entries sorted by key. The exported documents list the definitions,
+ * items etc. in this order, so the iterators below keep it.
+ */
+static struct oval_string_map_entry **oval_string_map_sorted(struct oval_string_map *map)
 {
-	struct oval_iterator *it = (struct oval_iterator *)u;
+	struct oval_string_map_entry **sorted;
+	uint32_t i;
 
-	oval_collection_iterator_add(it, n->data);
+	if (map->count == 0)
+		return (NULL);
 
-	return (0);
+	sorted = oscap_alloc(sizeof(struct oval_string_map_entry *) * map->count);
+	for (i = 0; i < map->count; ++i)
+		sorted[i] = map->entries + i;
+	qsort(sorted, map->count, sizeof(struct oval_string_map_entry *), __oval_string_map_entry_cmp);
+
+	return (sorted);
 }
 
-static int __oval_collection_addval(struct rbt_str_node *n, void *u)
+/* iterates in the descending order of the keys */
+struct oval_iterator *oval_string_map_keys(struct oval_string_map *map)
 {
-	struct oval_collection *c = (struct oval_collection *)u;
+	struct oval_iterator *it;
+	struct oval_string_map_entry **sorted;
+	uint32_t i;
 
-	oval_collection_add(c, n->data);
+	assume_d(map != NULL, NULL);
 
-	return (0);
+	it = oval_collection_iterator_new();
+	sorted = oval_string_map_sorted(map);
+	for (i = 0; i < map->count; ++i)
+		oval_collection_iterator_add(it, (void *)sorted[i]->key);
+	oscap_free(sorted);
+
+	return (it);
 }
 
-struct oval_iterator *oval_string_map_keys(struct oval_string_map *map)
+/* iterates in the descending order of the keys */
+struct oval_iterator *oval_string_map_values(struct oval_string_map *map)
 {
 	struct oval_iterator *it;
+	struct oval_string_map_entry **sorted;
+	uint32_t i;
 
 	assume_d(map != NULL, NULL);
 
 	it = oval_collection_iterator_new();
-	rbt_str_walk_inorder2((rbt_t *)map, __oval_iterator_addkey, it, 0);
+	sorted = oval_string_map_sorted(map);
+	for (i = 0; i < map->count; ++i)
+		oval_collection_iterator_add(it, sorted[i]->data);
+	oscap_free(sorted);
 
 	return (it);
 }
 
-struct oval_iterator *oval_string_map_values(struct oval_string_map *map)
+/* iterates in no particular order */
+struct oval_iterator *oval_string_map_values_unordered(struct oval_string_map *map)
 {
 	struct oval_iterator *it;
+	uint32_t i;
 
 	assume_d(map != NULL, NULL);
 
 	it = oval_collection_iterator_new();
-	rbt_str_walk_inorder2((rbt_t *)map, __oval_iterator_addval, it, 0);
+	for (i = 0; i < map->count; ++i)
+		oval_collection_iterator_add(it, map->entries[i].data);
 
 	return (it);
 }
 
+/* adds the values in the ascending order of the keys */
 struct oval_collection *oval_string_map_collect_values(struct oval_string_map *map, struct oval_collection *collection)
 {
+	struct oval_string_map_entry **sorted;
+	uint32_t i;
+
 	assume_d(map != NULL, NULL);
 
 	if (collection == NULL)
 		collection = oval_collection_new();
-	rbt_str_walk_inorder2((rbt_t *)map, __oval_collection_addval, collection, 0);
+	sorted = oval_string_map_sorted(map);
+	for (i = 0; i < map->count; ++i)
+		oval_collection_add(collection, sorted[i]->data);
+	oscap_free(sorted);
 
 	return (collection);
 }
 
-#endif /* OVAL_STRINGMAP_LINEAR */
+/*
+ * The entries are never removed or reordered, so the position of a key is
+ * a dense number which stays valid for the lifetime of the map.
+ */
+int oval_string_map_intern(struct oval_string_map *map, const char *key)
+{
+	int index;
+
+	assume_d(map != NULL, -1);
+	assume_d(key != NULL, -1);
+
+	index = oval_string_map_get_index(map, key);
+	if (index < 0) {
+		oval_string_map_add(map, key, NULL);
+		index = map->count - 1;
+	}
+
+	return (index);
+}
+
+int oval_string_map_get_index(struct oval_string_map *map, const char *key)
+{
+	uint32_t *slot;
+
+	assume_d(map != NULL, -1);
+	assume_d(key != NULL, -1);
+
+	slot = oval_string_map_slot(map, key, oval_string_map_hash(key));
+
+	return ((int)*slot - 1);
+}
+
+int oval_string_map_get_count(struct oval_string_map *map)
+{
+	assume_d(map != NULL, 0);
+	return (map->count);
+}
+
+bool oval_string_map_is_empty(struct oval_string_map *map)
+{
+	assume_d(map != NULL, true);
+	return (map->count == 0);
+}
+
+#endif /* OVAL_STRINGMAP_OLD */
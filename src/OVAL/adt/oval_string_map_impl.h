@@ -43,6 +43,16 @@ void oval_string_map_put(struct oval_string_map *, const char *, void *);
 void oval_string_map_put_string(struct oval_string_map *, const char *, const char *);
 struct oval_iterator *oval_string_map_keys(struct oval_string_map *);
 struct oval_iterator *oval_string_map_values(struct oval_string_map *);
+struct oval_iterator *oval_string_map_values_unordered(struct oval_string_map *);
+bool oval_string_map_is_empty(struct oval_string_map *);
+/**
+ * Get the dense number of the key (0, 1, ... in the order the keys were
+ * added), adding the key with a NULL value if it isn't in the map yet.
+ */
+int oval_string_map_intern(struct oval_string_map *, const char *);
+/// Get the dense number of the key or -1 if it isn't in the map.
+int oval_string_map_get_index(struct oval_string_map *, const char *);
+int oval_string_map_get_count(struct oval_string_map *);
 void *oval_string_map_get_value(struct oval_string_map *, const char *);
 void oval_string_map_free(struct oval_string_map *, oscap_destruct_func);
 void oval_string_map_free0(struct oval_string_map *);
@@ -83,6 +83,11 @@ static void _var_collect_var_refs(struct oval_variable *var, struct oval_string_
 	}
 }
 
+void oval_var_collect_var_refs(struct oval_variable *var, struct oval_string_map *vm)
+{
+	_var_collect_var_refs(var, vm);
+}
+
 static void _ent_collect_var_refs(struct oval_entity *ent, struct oval_string_map *vm)
 {
 	oval_entity_varref_type_t vrt;
@@ -32,6 +32,7 @@
 #include <config.h>
 #endif
 
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <assume.h>
@@ -43,6 +44,8 @@
 #include "adt/oval_string_map_impl.h"
 #include "oval_system_characteristics_impl.h"
 #include "oval_probe_impl.h"
+#include "oval_probe_ext.h"
+#include "oval_probe_incr.h"
 #include "results/oval_results_impl.h"
 #include "common/list.h"
 #include "common/util.h"
@@ -60,6 +63,14 @@ struct oval_agent_session {
 	struct oval_syschar_model    * sys_models[2];
 	struct oval_results_model    * res_model;
 	oval_probe_session_t  * psess;
+	unsigned int jobs;
+	bool prefetched;
+	bool pushdown;
+	bool short_circuit;
+	bool release_items;
+	/* the result of all the definitions, see oval_agent_eval_multi_check */
+	bool multi_check_done;
+	xccdf_test_result_type_t multi_check_result;
 };
 
 
@@ -115,6 +126,9 @@ oval_agent_session_t * oval_agent_new_session(struct oval_definition_model *mode
 	oval_syschar_model_set_sysinfo(ag_sess->sys_model, sysinfo);
 	oval_sysinfo_free(sysinfo);
 
+	if (getenv(OVAL_PROBE_PRESTART_ENV) != NULL)
+		oval_probe_session_prestart(ag_sess->psess, model);
+
 	/* one system only */
 	ag_sess->sys_models[0] = ag_sess->sys_model;
 	ag_sess->sys_models[1] = NULL;
@@ -125,6 +139,12 @@ oval_agent_session_t * oval_agent_new_session(struct oval_definition_model *mode
 
 
 	ag_sess->product_name = NULL;
+	ag_sess->jobs = 0;
+	ag_sess->prefetched = false;
+	ag_sess->pushdown = false;
+	ag_sess->short_circuit = false;
+	ag_sess->release_items = false;
+	ag_sess->multi_check_done = false;
 
 	return ag_sess;
 }
@@ -146,6 +166,36 @@ void oval_agent_set_product_name(oval_agent_session_t *ag_sess, char * product_n
 	oval_generator_set_product_name(generator, product_name);
 }
 
+void oval_agent_set_jobs(oval_agent_session_t *ag_sess, unsigned int jobs)
+{
+	ag_sess->jobs = jobs;
+}
+
+void oval_agent_set_state_pushdown(oval_agent_session_t *ag_sess, bool pushdown)
+{
+	/* the filters stay in the objects, they can't be taken back */
+	if (pushdown && !ag_sess->pushdown) {
+		oval_definition_model_optimize_by_state_pushdown(ag_sess->def_model);
+		ag_sess->pushdown = true;
+	}
+}
+
+void oval_agent_set_short_circuit(oval_agent_session_t *ag_sess, bool short_circuit)
+{
+	ag_sess->short_circuit = short_circuit;
+	oval_results_model_set_short_circuit(ag_sess->res_model, short_circuit);
+}
+
+void oval_agent_set_release_items(oval_agent_session_t *ag_sess, bool release)
+{
+	if (release && getenv(OVAL_PROBE_INCR_ENV) != NULL) {
+		dI("Keeping the items of the evaluated tests for %s.", OVAL_PROBE_INCR_ENV);
+		release = false;
+	}
+	ag_sess->release_items = release;
+	oval_results_model_set_release_items(ag_sess->res_model, release);
+}
+
 static struct oval_result_system *_oval_agent_get_first_result_system(oval_agent_session_t *ag_sess)
 {
 	struct oval_results_model *rmodel = oval_agent_get_results_model(ag_sess);
@@ -162,6 +212,15 @@ int oval_agent_eval_definition(oval_agent_session_t *ag_sess, const char *id)
 {
 	int ret;
 	struct oval_result_system *rsystem;
+	struct oval_definition *definition;
+
+	/* send the independent objects to the probes in one go,
+	 * unless they are collected only when the criteria need them */
+	if (!ag_sess->prefetched && !ag_sess->short_circuit) {
+		definition = oval_definition_model_get_definition(ag_sess->def_model, id);
+		if (definition != NULL)
+			oval_probe_prefetch_definition(ag_sess->psess, definition, ag_sess->jobs);
+	}
 
 	rsystem = _oval_agent_get_first_result_system(ag_sess);
 	/* eval */
@@ -207,6 +266,7 @@ struct oval_result_definition * oval_agent_get_result_definition(oval_agent_sess
 
 int oval_agent_reset_session(oval_agent_session_t * ag_sess) {
 	ag_sess->cur_var_model = NULL;
+	ag_sess->multi_check_done = false;
 	oval_definition_model_clear_external_variables(ag_sess->def_model);
 
 	/* We intentionally do not flush out the results model which should
@@ -236,6 +296,49 @@ int oval_agent_reset_session(oval_agent_session_t * ag_sess) {
 	return 0;
 }
 
+int oval_agent_clear_session(oval_agent_session_t *ag_sess)
+{
+	struct oval_syschar_model *sys_model;
+	struct oval_sysinfo *sysinfo;
+	struct oval_generator *generator;
+
+	assume_d(ag_sess != NULL, -1);
+
+	sys_model = oval_syschar_model_new(ag_sess->def_model);
+	sysinfo = oval_syschar_model_get_sysinfo(ag_sess->sys_model);
+	if (sysinfo != NULL)
+		oval_syschar_model_set_sysinfo(sys_model, sysinfo);
+
+	/* unlike oval_probe_session_reinit, the reset keeps the probes
+	 * running and only drops what they cached for this session */
+	if (oval_probe_session_reset(ag_sess->psess, sys_model) != 0) {
+		oval_syschar_model_free(sys_model);
+		return -1;
+	}
+
+	oval_results_model_free(ag_sess->res_model);
+	oval_syschar_model_free(ag_sess->sys_model);
+
+	ag_sess->cur_var_model = NULL;
+	ag_sess->sys_model = sys_model;
+	ag_sess->sys_models[0] = sys_model;
+	ag_sess->res_model = oval_results_model_new_with_probe_session(
+			ag_sess->def_model, ag_sess->sys_models, ag_sess->psess);
+	generator = oval_results_model_get_generator(ag_sess->res_model);
+	oval_generator_set_product_version(generator, oscap_get_version());
+	if (ag_sess->product_name) {
+		oval_generator_set_product_name(generator, ag_sess->product_name);
+		generator = oval_syschar_model_get_generator(sys_model);
+		oval_generator_set_product_name(generator, ag_sess->product_name);
+	}
+	oval_results_model_set_short_circuit(ag_sess->res_model, ag_sess->short_circuit);
+	oval_results_model_set_release_items(ag_sess->res_model, ag_sess->release_items);
+	ag_sess->prefetched = false;
+	ag_sess->multi_check_done = false;
+
+	return 0;
+}
+
 int oval_agent_abort_session(oval_agent_session_t *ag_sess)
 {
 	assume_d(ag_sess != NULL, -1);
@@ -251,6 +354,18 @@ int oval_agent_eval_system(oval_agent_session_t * ag_sess, agent_reporter cb, vo
 	int ret = 0;
 
 	dI("OVAL agent started to evaluate OVAL definitions on your system.");
+	oval_definition_model_load_all(ag_sess->def_model);
+
+	/* all the definitions are going to be evaluated, schedule their objects at once */
+	if (ag_sess->jobs > 0 && !ag_sess->prefetched && !ag_sess->short_circuit) {
+		oval_probe_prefetch_model(ag_sess->psess, ag_sess->def_model, ag_sess->jobs);
+		ag_sess->prefetched = true;
+	}
+
+	/* the package tests of the CVE feeds are evaluated together, ahead of their definitions */
+	if (!ag_sess->short_circuit)
+		oval_result_system_eval_packages(_oval_agent_get_first_result_system(ag_sess));
+
 	oval_def_it = oval_definition_model_get_definitions(ag_sess->def_model);
 	while (oval_definition_iterator_has_more(oval_def_it)) {
 		oval_def = oval_definition_iterator_next(oval_def_it);
@@ -290,6 +405,13 @@ struct oval_results_model * oval_agent_get_results_model(oval_agent_session_t *
 	return ag_sess->res_model;
 }
 
+oval_probe_session_t *oval_agent_get_probe_session(oval_agent_session_t *ag_sess)
+{
+	__attribute__nonnull__(ag_sess);
+
+	return ag_sess->psess;
+}
+
 const char * oval_agent_get_filename(oval_agent_session_t * ag_sess) {
 	__attribute__nonnull__(ag_sess);
 
@@ -393,7 +515,7 @@ static void _oval_agent_resolve_variables_conflict(struct oval_agent_session *se
 	struct oscap_htable_iterator *hit = oscap_htable_iterator_new(dict);
 	struct oval_definition_model *def_model =
 			oval_results_model_get_definition_model(oval_agent_get_results_model(session));
-	while (!conflict && oscap_htable_iterator_has_more(hit)) {
+	while (oscap_htable_iterator_has_more(hit)) {
 		oscap_htable_iterator_next_kv(hit, &var_name, (void*) &value_list);
 		struct oval_variable *variable = oval_definition_model_get_variable(def_model, var_name);
 		if (variable != NULL) {
@@ -409,6 +531,8 @@ static void _oval_agent_resolve_variables_conflict(struct oval_agent_session *se
 				// As per OVAL 5.10.1, the Variable Schema does not allow multisets. Therefore,
 				// we will later create new variable model and export multiple variables docs.
 				conflict = true;
+				// The local variables computed from the previous value are computed again.
+				oval_definition_model_clear_dependent_variables(def_model, variable);
 				// Next, in the results model, there might be already some definitions, tests
 				// states, or objects. These might be dependent on the previous value of the
 				// given variable.
@@ -423,8 +547,10 @@ static void _oval_agent_resolve_variables_conflict(struct oval_agent_session *se
 				// set of tests. These tests might have same @id but differ in @variable_instance
 				// attribute. Further, some of these tests will differ in tested_variable element.
 				struct oval_result_system *r_system = _oval_agent_get_first_result_system(session);
-				if (r_system == NULL)
+				if (r_system == NULL) {
+					oval_value_iterator_free(value_it);
 					continue;
+				}
 
 				struct oval_string_iterator *def_it =
 					oval_definition_model_get_definitions_dependent_on_variable(def_model, variable);
@@ -441,7 +567,9 @@ static void _oval_agent_resolve_variables_conflict(struct oval_agent_session *se
 						int instance = oval_result_definition_get_instance(r_definition);
 						oval_result_definition_set_variable_instance_hint(r_definition, instance + 1);
 						struct oval_definition *definition = oval_result_definition_get_definition(r_definition);
-						oval_probe_hint_definition(session->psess, definition, instance + 1);
+						// Only the collected objects which depend on the variable are
+						// collected again, the others are shared by both instances.
+						oval_probe_hint_definition(session->psess, definition, variable, instance + 1);
 					}
 					else {
 						// TODO: We really need oval_agent_session wide variable_instance attribute
@@ -457,8 +585,12 @@ static void _oval_agent_resolve_variables_conflict(struct oval_agent_session *se
 	oscap_htable_free(dict, (oscap_destruct_func) oscap_stringlist_free);
 
     if (conflict) {
-        /* We have a conflict, clear session and external variables */
-        oval_agent_reset_session(session);
+        /* We have a conflict, start a new variable model. The probe session and
+         * the system characteristics are kept, the hinted objects are collected
+         * again under the new variable_instance and the rest stays shared. */
+        session->cur_var_model = NULL;
+        session->multi_check_done = false;
+        oval_definition_model_clear_external_variables(def_model);
     }
 
     if (!session->cur_var_model) {
@@ -504,7 +636,8 @@ int oval_agent_resolve_variables(struct oval_agent_session * session, struct xcc
 		if (!oval_variable_contains_value(variable, value)) {
 			/* Add variable to variable model */
 			oval_variable_model_add(session->cur_var_model, name, "Unknown", o_type, value);
-			oval_variable_bind_ext_var(variable, session->cur_var_model, name);
+			oval_variable_bind_ext_var(variable, session->cur_var_model,
+					oval_variable_model_get_index(session->cur_var_model, name));
 			dI("Adding external variable %s.", name);
 		} else {
 			/* Skip this variable (we assume it has same values otherwise conflict was detected) */
@@ -524,6 +657,10 @@ oval_agent_eval_multi_check(oval_agent_session_t *sess)
 	// This is special handling of evaluation when the process is driven by XCCDF
 	// and xccdf:check/@multi-check=false. We need extra function for this to apply
 	// the XCCDF Truth Table for AND.
+	//
+	// Every such rule referring to the file gets the same result, unless a
+	// conflicting variable binding starts a new variable instance, so the
+	// definitions are walked for the first rule only.
 	struct oval_definition *oval_def;
 	struct oval_definition_iterator *oval_def_it;
 	const char *id;
@@ -531,6 +668,12 @@ oval_agent_eval_multi_check(oval_agent_session_t *sess)
 	xccdf_test_result_type_t xccdf_result;
 	xccdf_test_result_type_t final_result = 0;
 
+	if (sess->multi_check_done) {
+		dI("Reusing the result of all the definitions of '%s'.", sess->filename);
+		return sess->multi_check_result;
+	}
+
+	oval_definition_model_load_all(sess->def_model);
 	oval_def_it = oval_definition_model_get_definitions(sess->def_model);
 	if (!oval_definition_iterator_has_more(oval_def_it)) {
 		// We are evaluating oval, which has no definitions. We are in state
@@ -552,6 +695,8 @@ oval_agent_eval_multi_check(oval_agent_session_t *sess)
 			xccdf_test_result_resolve_and_operation(final_result, xccdf_result);
 	}
 	oval_definition_iterator_free(oval_def_it);
+	sess->multi_check_done = true;
+	sess->multi_check_result = final_result;
 	return final_result;
 }
 
@@ -586,13 +731,53 @@ xccdf_test_result_type_t oval_agent_eval_rule(struct xccdf_policy *policy, const
         }
 }
 
+/*
+ * Collect the independent objects of the definitions the selected rules refer
+ * to before the first rule is evaluated, with at most the jobs of the session
+ * in flight. Without jobs the objects of each definition are still sent together
+ * when the definition is evaluated.
+ */
+static void _oval_agent_prefetch(struct oval_agent_session *sess, const struct xccdf_policy_prefetch *prefetch)
+{
+	if (strcmp(sess->filename, prefetch->href) || sess->jobs == 0 || sess->prefetched || sess->short_circuit)
+		return;
+
+	if (prefetch->names == NULL) {
+		oval_definition_model_load_all(sess->def_model);
+		oval_probe_prefetch_model(sess->psess, sess->def_model, sess->jobs);
+		sess->prefetched = true;
+		return;
+	}
+
+	struct oval_definition **definitions = NULL;
+	size_t count = 0;
+	struct oscap_string_iterator *name_it = oscap_stringlist_get_strings(prefetch->names);
+	while (oscap_string_iterator_has_more(name_it)) {
+		struct oval_definition *definition = oval_definition_model_get_definition(sess->def_model, oscap_string_iterator_next(name_it));
+		if (definition == NULL)
+			continue;
+		definitions = oscap_realloc(definitions, sizeof(struct oval_definition *) * (count + 1));
+		definitions[count++] = definition;
+	}
+	oscap_string_iterator_free(name_it);
+
+	if (count > 0)
+		oval_probe_prefetch_definitions(sess->psess, definitions, count, sess->jobs);
+	oscap_free(definitions);
+}
+
 static void *
 _oval_agent_list_definitions(void *usr, xccdf_policy_engine_query_t query_type, void *query_data)
 {
 	__attribute__nonnull__(usr);
 	struct oval_agent_session *sess = (struct oval_agent_session *) usr;
+	if (query_type == POLICY_ENGINE_QUERY_PREFETCH) {
+		_oval_agent_prefetch(sess, (const struct xccdf_policy_prefetch *) query_data);
+		return NULL;
+	}
 	if (query_type != POLICY_ENGINE_QUERY_NAMES_FOR_HREF || (query_data != NULL && strcmp(sess->filename, (const char *) query_data)))
 		return NULL;
+	oval_definition_model_load_all(sess->def_model);
 	struct oval_definition_iterator *iterator = oval_definition_model_get_definitions(sess->def_model);
 	struct oscap_stringlist *result = oscap_stringlist_new();
 	struct oval_definition *oval_def;
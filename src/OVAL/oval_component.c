@@ -53,7 +53,7 @@
 #include "common/oscap_string.h"
 #include "oval_glob_to_regex.h"
 #if defined USE_REGEX_PCRE
-#include <pcre.h>
+#include "common/oscap_pcre.h"
 #elif defined USE_REGEX_POSIX
 #include <regex.h>
 #endif
@@ -103,6 +103,10 @@ static oval_syschar_collection_flag_t _flag_agg_map[7][7] = {
 #define _COMP_TYPE(comp) oval_component_type_get_text(oval_component_get_type(comp))
 #define _FLAG_TYPE(flag) oval_syschar_collection_flag_get_text(flag)
 
+/* the limit of the values built from the combinations of the arguments of a function, 0 for none */
+#define OVAL_COMPONENT_COMBINATIONS_ENV "OSCAP_MAX_COMBINATIONS"
+#define OVAL_COMPONENT_COMBINATIONS_MAX 1000000
+
 typedef struct {
 	enum {
 		OVAL_MODE_COMPUTE,
@@ -1555,6 +1559,59 @@ static oval_syschar_collection_flag_t _oval_component_evaluate_END(oval_argu_t *
 	return flag;
 }
 
+/* the number of values a function may produce from the combinations of its arguments */
+static size_t _oval_component_combination_limit(void)
+{
+	const char *env = getenv(OVAL_COMPONENT_COMBINATIONS_ENV);
+	char *end;
+	unsigned long limit;
+
+	if (env == NULL || *env == '\0')
+		return OVAL_COMPONENT_COMBINATIONS_MAX;
+
+	errno = 0;
+	limit = strtoul(env, &end, 10);
+	if (errno != 0 || *end != '\0') {
+		dW("Ignoring the invalid value of %s: '%s'.", OVAL_COMPONENT_COMBINATIONS_ENV, env);
+		return OVAL_COMPONENT_COMBINATIONS_MAX;
+	}
+	return limit;
+}
+
+/* check the size of the cartesian product of the arguments before building it */
+static bool _oval_component_combinations_allowed(struct oval_component *component, const size_t *counts, int len)
+{
+	size_t limit = _oval_component_combination_limit(), total = 1;
+	int idx0;
+
+	if (limit == 0)
+		return true;
+
+	for (idx0 = 0; idx0 < len; idx0++) {
+		if (counts[idx0] != 0 && total > limit / counts[idx0]) {
+			oscap_seterr(OSCAP_EFAMILY_OVAL, "Component %s would produce more than %zu values, "
+				     "the limit can be changed by %s.", _COMP_TYPE(component), limit,
+				     OVAL_COMPONENT_COMBINATIONS_ENV);
+			return false;
+		}
+		total *= counts[idx0];
+	}
+	return true;
+}
+
+/* advance to the next combination, the first argument changes the fastest */
+static bool _oval_component_next_combination(size_t *pos, const size_t *counts, int len)
+{
+	int idx0;
+
+	for (idx0 = 0; idx0 < len; idx0++) {
+		if (++pos[idx0] < counts[idx0])
+			return true;
+		pos[idx0] = 0;
+	}
+	return false;
+}
+
 static oval_syschar_collection_flag_t _oval_component_evaluate_CONCAT(oval_argu_t *argu,
 								      struct oval_component *component,
 								      struct oval_collection *value_collection)
@@ -1572,71 +1629,65 @@ static oval_syschar_collection_flag_t _oval_component_evaluate_CONCAT(oval_argu_
 		flag = _AGG_FLAG(flag, subflag);
 		component_colls[idx0] = subcoll;
 	}
-	bool not_finished = (len_subcomps > 0) && _HAS_VALUES(flag);
-	if (not_finished) {
-		struct oval_value_iterator *values[len_subcomps];
-		/* bool has_some[len_subcomps]; <-- unused variable */
-		not_finished = false;
-		char *texts[len_subcomps];
-		int counts[len_subcomps];
-		int catnum = 1;
+	oval_component_iterator_free(subcomps);
+
+	if (len_subcomps > 0 && _HAS_VALUES(flag)) {
+		/* the texts of the arguments with some values, arguments without values are skipped */
+		char **texts[len_subcomps];
+		size_t *lens[len_subcomps];
+		size_t counts[len_subcomps], pos[len_subcomps];
+		size_t len_cat = 1;
+		int len = 0;
+
 		for (idx0 = 0; idx0 < len_subcomps; idx0++) {
 			struct oval_value_iterator *comp_values =
 			    (struct oval_value_iterator *)oval_collection_iterator(component_colls[idx0]);
-			counts[idx0] = oval_value_iterator_remaining(comp_values);
-			if (counts[idx0]) {
-				/* int dbgnum = catnum; <-- unused variable */
-				catnum = catnum * counts[idx0];
-				values[idx0] = comp_values;
-				texts[idx0] = oval_value_get_text(oval_value_iterator_next(comp_values));
-				not_finished = true;
-			} else {
-				oval_collection_free_items(component_colls[idx0],
-							   (oscap_destruct_func) oval_value_free);
-				component_colls[idx0] = NULL;
-				values[idx0] = NULL;
-				texts[idx0] = NULL;
+			size_t count = oval_value_iterator_remaining(comp_values), max_len = 0, i;
+
+			if (count > 0) {
+				texts[len] = oscap_alloc(count * sizeof(char *));
+				lens[len] = oscap_alloc(count * sizeof(size_t));
+				for (i = 0; i < count; i++) {
+					texts[len][i] = oval_value_get_text(oval_value_iterator_next(comp_values));
+					lens[len][i] = strlen(texts[len][i]);
+					if (lens[len][i] > max_len)
+						max_len = lens[len][i];
+				}
+				counts[len] = count;
+				pos[len] = 0;
+				len_cat += max_len;
+				len++;
 			}
+			oval_value_iterator_free(comp_values);
 		}
-		for (int passnum = 1; passnum - 1 < catnum; passnum++) {
-			int len_cat = 1;
-			for (idx0 = 0; idx0 < len_subcomps; idx0++)
-				if (texts[idx0])
-					len_cat += strlen(texts[idx0]);
-			char concat[len_cat];
-			*concat = '\0';
-			for (idx0 = 0; idx0 < len_subcomps; idx0++)
-				if (texts[idx0])
-					strcat(concat, texts[idx0]);
-			struct oval_value *value = oval_value_new(OVAL_DATATYPE_STRING, concat);
-			oval_collection_add(value_collection, value);
-			bool rotate = true;
-			if (passnum < catnum) {
-				for (idx0 = 0; idx0 < len_subcomps && rotate; idx0++) {
-					if (texts[idx0]) {
-						if (oval_value_iterator_has_more(values[idx0])) {
-							rotate = false;
-						} else {
-							oval_value_iterator_free(values[idx0]);
-							values[idx0] =
-							    (struct oval_value_iterator *)
-							    oval_collection_iterator(component_colls[idx0]);
-						}
-						texts[idx0] =
-						    oval_value_get_text(oval_value_iterator_next(values[idx0]));
-					}
+
+		if (len > 0 && _oval_component_combinations_allowed(component, counts, len)) {
+			char *concat = oscap_alloc(len_cat);
+
+			do {
+				char *end = concat;
+
+				for (idx0 = 0; idx0 < len; idx0++) {
+					memcpy(end, texts[idx0][pos[idx0]], lens[idx0][pos[idx0]]);
+					end += lens[idx0][pos[idx0]];
 				}
-			}
+				*end = '\0';
+				oval_collection_add(value_collection, oval_value_new(OVAL_DATATYPE_STRING, concat));
+			} while (_oval_component_next_combination(pos, counts, len));
+
+			oscap_free(concat);
+		} else if (len > 0) {
+			flag = SYSCHAR_FLAG_ERROR;
 		}
-		for (idx0 = 0; idx0 < len_subcomps; idx0++) {
-			if (counts[idx0]) {
-				oval_value_iterator_free(values[idx0]);
-				oval_collection_free_items(component_colls[idx0],
-							   (oscap_destruct_func) oval_value_free);
-			}
+
+		for (idx0 = 0; idx0 < len; idx0++) {
+			oscap_free(texts[idx0]);
+			oscap_free(lens[idx0]);
 		}
 	}
-	oval_component_iterator_free(subcomps);
+
+	for (idx0 = 0; idx0 < len_subcomps; idx0++)
+		oval_collection_free_items(component_colls[idx0], (oscap_destruct_func) oval_value_free);
 	return flag;
 }
 
@@ -1942,12 +1993,14 @@ static bool _match(const char *pattern, const char *string)
 {
 	bool match = false;
 #if defined USE_REGEX_PCRE
-	pcre *re;
+	oscap_pcre_t *re;
 	const char *error;
 	int erroffset = -1, ovector[60], ovector_len = sizeof (ovector) / sizeof (ovector[0]);
-	re = pcre_compile(pattern, PCRE_UTF8, &error, &erroffset, NULL);
-	match = (pcre_exec(re, NULL, string, strlen(string), 0, 0, ovector, ovector_len) >= 0);
-	pcre_free(re);
+	re = oscap_pcre_get(pattern, PCRE_UTF8, &error, &erroffset);
+	if (re == NULL)
+		return false;
+	match = (oscap_pcre_exec(re, string, strlen(string), 0, 0, ovector, ovector_len) >= 0);
+	oscap_pcre_put(re);
 #elif defined USE_REGEX_POSIX
 	regex_t re;
 	regcomp(&re, pattern, REG_EXTENDED);
@@ -2176,11 +2229,12 @@ static oval_syschar_collection_flag_t _oval_component_evaluate_REGEX_CAPTURE(ova
 	char *pattern;
 #if defined USE_REGEX_PCRE
 	int erroffset = -1;
-	pcre *re = NULL;
+	oscap_pcre_t *re = NULL;
 	const char *error;
 
+	/* the pattern is compiled once per process, not per evaluation */
 	pattern = oval_component_get_regex_pattern(component);
-	re = pcre_compile(pattern, PCRE_UTF8, &error, &erroffset, NULL);
+	re = oscap_pcre_get(pattern, PCRE_UTF8, &error, &erroffset);
 	if (re == NULL) {
 		dE("pcre_compile() failed: \"%s\".", error);
 		return SYSCHAR_FLAG_ERROR;
@@ -2210,7 +2264,7 @@ static oval_syschar_collection_flag_t _oval_component_evaluate_REGEX_CAPTURE(ova
 			for (i = 0; i < ovector_len; ++i)
 				ovector[i] = -1;
 
-			rc = pcre_exec(re, NULL, text, strlen(text), 0, 0, ovector, ovector_len);
+			rc = oscap_pcre_exec(re, text, strlen(text), 0, 0, ovector, ovector_len);
 			if (rc < -1) {
 				dE("pcre_exec() failed: %d.", rc);
 				flag = SYSCHAR_FLAG_ERROR;
@@ -2256,80 +2310,35 @@ static oval_syschar_collection_flag_t _oval_component_evaluate_REGEX_CAPTURE(ova
 	}
 	oval_component_iterator_free(subcomps);
 #if defined USE_REGEX_PCRE
-        pcre_free(re);
+	oscap_pcre_put(re);
 #endif
 	return flag;
 }
 
-struct val_col_lst_s {
-	void *val_col;
-	struct val_col_lst_s *next;
-};
-
-static oval_syschar_collection_flag_t _oval_component_evaluate_ARITHMETIC_rec(struct val_col_lst_s *val_col_lst, double val,
-						    oval_datatype_t datatype, oval_arithmetic_operation_t op,
-						    struct oval_collection *res_val_col)
+/* the value as a number, *is_float is set if it isn't an integer */
+static int _oval_component_arithmetic_operand(struct oval_value *ov, double *val, bool *is_float)
 {
-	struct oval_value_iterator *val_itr;
-
-	if (val_col_lst == NULL) {
-		struct oval_value *ov;
-		char sv[32];
-
-		if (datatype == OVAL_DATATYPE_INTEGER) {
-			snprintf(sv, sizeof (sv), "%ld", (long int) val);
-		} else if (datatype == OVAL_DATATYPE_FLOAT) {
-			snprintf(sv, sizeof (sv), "%f", val);
-		}
-		ov = oval_value_new(datatype, sv);
-		oval_collection_add(res_val_col, ov);
-
-		return SYSCHAR_FLAG_COMPLETE;
-	}
-
-	val_itr = (struct oval_value_iterator *) oval_collection_iterator(val_col_lst->val_col);
-	while (oval_value_iterator_has_more(val_itr)) {
-		struct oval_value *ov;
-		oval_datatype_t dt;
-		double new_val;
-
-		ov = oval_value_iterator_next(val_itr);
-		dt = oval_value_get_datatype(ov);
-		if (dt == OVAL_DATATYPE_STRING) {
-			errno = 0; // Setting errno to 0 as suggested by strtod() manpage, as 0 is used both on success and failure
-			new_val = strtod(oval_value_get_text(ov), NULL);
-			if (errno) {
-				oscap_seterr(OSCAP_EFAMILY_OVAL, "Unexpected content: %s.", oval_value_get_text(ov));
-				oval_value_iterator_free(val_itr);
-				return SYSCHAR_FLAG_ERROR;
-			}
-		} else if (dt == OVAL_DATATYPE_INTEGER) {
-			new_val = (double) oval_value_get_integer(ov);
-		} else if (dt == OVAL_DATATYPE_FLOAT) {
-			new_val = (double) oval_value_get_float(ov);
-		} else {
-			oscap_seterr(OSCAP_EFAMILY_OVAL, "Unexpected value type: %s.", oval_datatype_get_text(dt));
-			oval_value_iterator_free(val_itr);
-			return SYSCHAR_FLAG_ERROR;
-		}
+	oval_datatype_t dt = oval_value_get_datatype(ov);
 
-		if (op == OVAL_ARITHMETIC_ADD) {
-			new_val += val;
-		} else if (op == OVAL_ARITHMETIC_MULTIPLY) {
-			new_val *= val;
-		} else {
-			oscap_seterr(OSCAP_EFAMILY_OVAL, "Unexpected arithmetic operation: %s.", oval_arithmetic_operation_get_text(op));
-			oval_value_iterator_free(val_itr);
-			return SYSCHAR_FLAG_ERROR;
+	if (dt == OVAL_DATATYPE_STRING) {
+		errno = 0; // Setting errno to 0 as suggested by strtod() manpage, as 0 is used both on success and failure
+		*val = strtod(oval_value_get_text(ov), NULL);
+		if (errno) {
+			oscap_seterr(OSCAP_EFAMILY_OVAL, "Unexpected content: %s.", oval_value_get_text(ov));
+			return -1;
 		}
-
-		if (datatype == OVAL_DATATYPE_FLOAT)
-			dt = OVAL_DATATYPE_FLOAT;
-		_oval_component_evaluate_ARITHMETIC_rec(val_col_lst->next, new_val, dt, op, res_val_col);
+		*is_float = (*val != (double) (long int) *val);
+	} else if (dt == OVAL_DATATYPE_INTEGER) {
+		*val = (double) oval_value_get_integer(ov);
+		*is_float = false;
+	} else if (dt == OVAL_DATATYPE_FLOAT) {
+		*val = (double) oval_value_get_float(ov);
+		*is_float = true;
+	} else {
+		oscap_seterr(OSCAP_EFAMILY_OVAL, "Unexpected value type: %s.", oval_datatype_get_text(dt));
+		return -1;
 	}
-	oval_value_iterator_free(val_itr);
-
-	return SYSCHAR_FLAG_COMPLETE;
+	return 0;
 }
 
 static oval_syschar_collection_flag_t _oval_component_evaluate_ARITHMETIC(oval_argu_t *argu,
@@ -2338,9 +2347,8 @@ static oval_syschar_collection_flag_t _oval_component_evaluate_ARITHMETIC(oval_a
 {
 	oval_syschar_collection_flag_t flag = SYSCHAR_FLAG_UNKNOWN;
 	struct oval_component_iterator *subcomps;
-	struct val_col_lst_s *vcl_root, *vcl_elm;
 	oval_arithmetic_operation_t op;
-	struct oval_value_iterator *val_itr;
+	int idx0, len_subcomps;
 
 	op = oval_component_get_arithmetic_operation(component);
 	if (op != OVAL_ARITHMETIC_ADD && op != OVAL_ARITHMETIC_MULTIPLY) {
@@ -2348,59 +2356,76 @@ static oval_syschar_collection_flag_t _oval_component_evaluate_ARITHMETIC(oval_a
 		return SYSCHAR_FLAG_ERROR;
 	}
 
-	vcl_root = NULL;
 	subcomps = oval_component_get_function_components(component);
-	while (oval_component_iterator_has_more(subcomps)) {
-		struct oval_component *subcomp;
-		struct oval_collection *val_col;
+	len_subcomps = oval_component_iterator_remaining(subcomps);
+	if (len_subcomps == 0) {
+		oval_component_iterator_free(subcomps);
+		return flag;
+	}
 
-		subcomp = oval_component_iterator_next(subcomps);
-		val_col = oval_collection_new();
-		// todo: combine flags
-		flag = oval_component_eval_common(argu, subcomp, val_col);
-		vcl_elm = oscap_alloc(sizeof (struct val_col_lst_s));
-		vcl_elm->val_col = val_col;
-		vcl_elm->next = vcl_root;
-		vcl_root = vcl_elm;
+	/* the operands are converted once, the combinations are built one at a time */
+	double *nums[len_subcomps];
+	bool *floats[len_subcomps];
+	size_t counts[len_subcomps], pos[len_subcomps];
+
+	for (idx0 = 0; oval_component_iterator_has_more(subcomps); idx0++) {
+		struct oval_component *subcomp = oval_component_iterator_next(subcomps);
+		struct oval_collection *val_col = oval_collection_new();
+		struct oval_value_iterator *val_itr;
+		size_t i;
+
+		flag = _AGG_FLAG(flag, oval_component_eval_common(argu, subcomp, val_col));
+
+		val_itr = (struct oval_value_iterator *) oval_collection_iterator(val_col);
+		counts[idx0] = oval_value_iterator_remaining(val_itr);
+		pos[idx0] = 0;
+		nums[idx0] = oscap_alloc((counts[idx0] + 1) * sizeof(double));
+		floats[idx0] = oscap_alloc((counts[idx0] + 1) * sizeof(bool));
+		for (i = 0; i < counts[idx0]; i++) {
+			if (_oval_component_arithmetic_operand(oval_value_iterator_next(val_itr),
+							       &nums[idx0][i], &floats[idx0][i]) != 0)
+				flag = SYSCHAR_FLAG_ERROR;
+		}
+		oval_value_iterator_free(val_itr);
+		oval_collection_free_items(val_col, (oscap_destruct_func) oval_value_free);
 	}
 	oval_component_iterator_free(subcomps);
 
-	val_itr = (struct oval_value_iterator *) oval_collection_iterator(vcl_root->val_col);
-	while (oval_value_iterator_has_more(val_itr)) {
-		struct oval_value *ov;
-		oval_datatype_t datatype;
-		double val;
-
-		ov = oval_value_iterator_next(val_itr);
-		datatype = oval_value_get_datatype(ov);
-		if (datatype == OVAL_DATATYPE_STRING) {
-			errno = 0; // Setting errno to 0 as suggested by strtod() manpage, as 0 is used both on success and failure
-			val = strtod(oval_value_get_text(ov), NULL);
-			if (errno) {
-				oscap_seterr(OSCAP_EFAMILY_OVAL, "Unexpected content: %s.", oval_value_get_text(ov));
-				flag = SYSCHAR_FLAG_ERROR;
-				goto cleanup;
-			}
-		} else if (datatype == OVAL_DATATYPE_INTEGER) {
-			val = (double) oval_value_get_integer(ov);
-		} else if (datatype == OVAL_DATATYPE_FLOAT) {
-			val = (double) oval_value_get_float(ov);
+	for (idx0 = 0; idx0 < len_subcomps; idx0++) {
+		if (counts[idx0] == 0)
+			break;
+	}
+
+	if (idx0 == len_subcomps && _HAS_VALUES(flag)) {
+		if (_oval_component_combinations_allowed(component, counts, len_subcomps)) {
+			do {
+				double val = nums[0][pos[0]];
+				bool is_float = floats[0][pos[0]];
+				char sv[32];
+
+				for (idx0 = 1; idx0 < len_subcomps; idx0++) {
+					if (op == OVAL_ARITHMETIC_ADD)
+						val += nums[idx0][pos[idx0]];
+					else
+						val *= nums[idx0][pos[idx0]];
+					is_float = is_float || floats[idx0][pos[idx0]];
+				}
+
+				if (is_float)
+					snprintf(sv, sizeof (sv), "%f", val);
+				else
+					snprintf(sv, sizeof (sv), "%ld", (long int) val);
+				oval_collection_add(value_collection,
+						    oval_value_new(is_float ? OVAL_DATATYPE_FLOAT : OVAL_DATATYPE_INTEGER, sv));
+			} while (_oval_component_next_combination(pos, counts, len_subcomps));
 		} else {
-			oscap_seterr(OSCAP_EFAMILY_OVAL, "Unexpected value type: %s.", oval_datatype_get_text(datatype));
 			flag = SYSCHAR_FLAG_ERROR;
-			goto cleanup;
 		}
-
-		flag = _oval_component_evaluate_ARITHMETIC_rec(vcl_root->next, val, datatype, op, value_collection);
 	}
 
- cleanup:
-	oval_value_iterator_free(val_itr);
-	while (vcl_root != NULL) {
-		oval_collection_free_items(vcl_root->val_col, (oscap_destruct_func) oval_value_free);
-		vcl_elm = vcl_root;
-		vcl_root = vcl_root->next;
-		oscap_free(vcl_elm);
+	for (idx0 = 0; idx0 < len_subcomps; idx0++) {
+		oscap_free(nums[idx0]);
+		oscap_free(floats[idx0]);
 	}
 
 	return flag;
@@ -32,6 +32,7 @@
 #include <config.h>
 #endif
 
+#include <stdint.h>
 #include <string.h>
 #include <time.h>
 
@@ -41,6 +42,7 @@
 #include "adt/oval_string_map_impl.h"
 #include "oval_system_characteristics_impl.h"
 #include "oval_probe_impl.h"
+#include "collectVarRefs_impl.h"
 #include "common/util.h"
 #include "common/debug_priv.h"
 #include "common/_error.h"
@@ -58,8 +60,28 @@ typedef struct oval_definition_model {
 	struct oval_collection *bound_variable_models;
         char *schema;
 	struct oval_string_map *vardef_map;		///< look-up table for efficient @variable_instance processing
+	struct oval_string_map *id_map;			///< interned IDs of the definitions and tests
+	struct oval_definition_model_lazy *lazy;	///< elements not parsed yet, see oval_definition_model_import_source_lazy
 } oval_definition_model_t;
 
+/*
+ * A lazily loaded model keeps the document of its source and an index of
+ * the definitions, tests, objects, states and variables in it. An element
+ * is parsed when its ID is looked up for the first time. The references
+ * found while parsing it only create placeholders; their elements are
+ * queued and parsed in the same call, so a lookup of a definition leaves
+ * the model with everything the definition needs.
+ */
+struct oval_definition_model_lazy {
+	xmlDoc *doc;			///< owned by the source
+	struct oval_string_map *index;	///< ID -> position in nodes
+	xmlNode **nodes;		///< NULL once the element is queued
+	xmlNode **pending;		///< elements queued for parsing
+	int pending_count;
+	int pending_alloc;
+	bool loading;
+};
+
 /* failed   - NULL
  * success  - oval_definition_model
  * */
@@ -78,6 +100,8 @@ struct oval_definition_model *oval_definition_model_new()
 	newmodel->bound_variable_models = NULL;
         newmodel->schema = strdup(OVAL_DEF_SCHEMA_LOCATION);
 	newmodel->vardef_map = NULL;
+	newmodel->id_map = oval_string_map_new();
+	newmodel->lazy = NULL;
 
 	return newmodel;
 }
@@ -108,6 +132,9 @@ struct oval_definition_model *oval_definition_model_clone(struct oval_definition
 	if (newmodel == NULL)
 		return NULL;
 
+	/* the clone doesn't refer to the source document */
+	oval_definition_model_load_all(oldmodel);
+
 	_oval_definition_model_clone
 	    (oldmodel->definition_map, newmodel, (_oval_clone_func) oval_definition_clone);
 	_oval_definition_model_clone
@@ -131,6 +158,13 @@ void oval_definition_model_free(struct oval_definition_model *model)
 		oval_string_map_free(model->variable_map, (oscap_destruct_func) oval_variable_free);
 		if (model->vardef_map != NULL)
 			oval_string_map_free(model->vardef_map, (oscap_destruct_func) oval_string_map_free0);
+		oval_string_map_free(model->id_map, NULL);
+		if (model->lazy != NULL) {
+			oval_string_map_free(model->lazy->index, NULL);
+			oscap_free(model->lazy->nodes);
+			oscap_free(model->lazy->pending);
+			oscap_free(model->lazy);
+		}
 		if (model->bound_variable_models)
 			oval_collection_free_items(model->bound_variable_models,
 					   (oscap_destruct_func) oval_variable_model_free);
@@ -195,6 +229,18 @@ void oval_definition_model_add_definition(struct oval_definition_model *model, s
 	oval_string_map_put(model->definition_map, key, (void *)definition);
 }
 
+int oval_definition_model_intern_id(struct oval_definition_model *model, const char *id)
+{
+	__attribute__nonnull__(model);
+	return oval_string_map_intern(model->id_map, id);
+}
+
+int oval_definition_model_get_id_index(struct oval_definition_model *model, const char *id)
+{
+	__attribute__nonnull__(model);
+	return oval_string_map_get_index(model->id_map, id);
+}
+
 void oval_definition_model_set_schema(struct oval_definition_model *model, const char *version)
 {
 	__attribute__nonnull__(model);
@@ -259,6 +305,209 @@ struct oval_definition_model *oval_definition_model_import_source(struct oscap_s
 	return model;
 }
 
+static void _oval_definition_model_lazy_queue(struct oval_definition_model_lazy *lazy, xmlNode *node)
+{
+	if (lazy->pending_count == lazy->pending_alloc) {
+		lazy->pending_alloc = lazy->pending_alloc > 0 ? lazy->pending_alloc * 2 : 32;
+		lazy->pending = oscap_realloc(lazy->pending, sizeof(xmlNode *) * lazy->pending_alloc);
+	}
+	lazy->pending[lazy->pending_count++] = node;
+}
+
+/*
+ * Copy the queued elements into a small document under copies of their
+ * sections and the root element, so they keep their namespaces, and run the
+ * regular parser over it. Parsing may queue more elements; repeat until
+ * nothing is left.
+ */
+static int _oval_definition_model_lazy_drain(struct oval_definition_model *model)
+{
+	struct oval_definition_model_lazy *lazy = model->lazy;
+	int ret = 0;
+
+	lazy->loading = true;
+
+	while (lazy->pending_count > 0) {
+		xmlNode *sections[8], *copies[8];
+		int section_count = 0, i;
+
+		xmlDoc *doc = xmlNewDoc(BAD_CAST "1.0");
+		xmlNode *root = xmlDocCopyNode(xmlDocGetRootElement(lazy->doc), doc, 2);
+		xmlDocSetRootElement(doc, root);
+
+		for (i = 0; i < lazy->pending_count; ++i) {
+			xmlNode *node = lazy->pending[i], *parent = root;
+
+			if (node->parent != xmlDocGetRootElement(lazy->doc)) {
+				int j;
+
+				for (j = 0; j < section_count && sections[j] != node->parent; ++j);
+				if (j == section_count) {
+					/* more sections than OVAL has; leave the rest for the next round */
+					if (section_count == 8)
+						break;
+					sections[j] = node->parent;
+					copies[j] = xmlAddChild(root, xmlDocCopyNode(node->parent, doc, 2));
+					++section_count;
+				}
+				parent = copies[j];
+			}
+			xmlAddChild(parent, xmlDocCopyNode(node, doc, 1));
+		}
+		lazy->pending_count -= i;
+		memmove(lazy->pending, lazy->pending + i, sizeof(xmlNode *) * lazy->pending_count);
+
+		struct oval_parser_context context;
+		context.reader = xmlReaderWalker(doc);
+		if (context.reader == NULL) {
+			xmlFreeDoc(doc);
+			ret = -1;
+			break;
+		}
+		context.definition_model = model;
+		context.user_data = NULL;
+		while (xmlTextReaderRead(context.reader) == 1
+		       && xmlTextReaderNodeType(context.reader) != XML_READER_TYPE_ELEMENT) ;
+		if (oval_definition_model_parse(context.reader, &context) == -1)
+			ret = -1;
+		xmlFreeTextReader(context.reader);
+		xmlFreeDoc(doc);
+	}
+
+	lazy->loading = false;
+
+	/* the mapping covers the definitions which were there when it was built */
+	if (model->vardef_map != NULL) {
+		oval_string_map_free(model->vardef_map, (oscap_destruct_func) oval_string_map_free0);
+		model->vardef_map = NULL;
+	}
+
+	return ret;
+}
+
+static void _oval_definition_model_lazy_load(struct oval_definition_model *model, const char *id)
+{
+	struct oval_definition_model_lazy *lazy = model->lazy;
+	int index;
+
+	if (id == NULL)
+		return;
+
+	index = oval_string_map_get_index(lazy->index, id);
+	if (index < 0 || lazy->nodes[index] == NULL)
+		return;
+
+	_oval_definition_model_lazy_queue(lazy, lazy->nodes[index]);
+	lazy->nodes[index] = NULL;
+
+	/* references found by the parser are picked up by the running drain */
+	if (lazy->loading)
+		return;
+
+	if (_oval_definition_model_lazy_drain(model) != 0)
+		dW("Failed to parse the OVAL element '%s' and its dependencies.", id);
+}
+
+void oval_definition_model_load_all(struct oval_definition_model *model)
+{
+	struct oval_definition_model_lazy *lazy = model->lazy;
+
+	if (lazy == NULL || lazy->loading)
+		return;
+
+	for (int i = 0; i < oval_string_map_get_count(lazy->index); ++i) {
+		if (lazy->nodes[i] != NULL) {
+			_oval_definition_model_lazy_queue(lazy, lazy->nodes[i]);
+			lazy->nodes[i] = NULL;
+		}
+	}
+
+	if (_oval_definition_model_lazy_drain(model) != 0)
+		dW("Failed to parse some of the OVAL elements.");
+}
+
+static bool _oval_is_oval_element(xmlNode *node, const char *name)
+{
+	return node->type == XML_ELEMENT_NODE && node->ns != NULL
+		&& xmlStrcmp(node->ns->href, OVAL_DEFINITIONS_NAMESPACE) == 0
+		&& (name == NULL || xmlStrcmp(node->name, BAD_CAST name) == 0);
+}
+
+struct oval_definition_model *oval_definition_model_import_source_lazy(struct oscap_source *source)
+{
+	static const char *sections[] = { "definitions", "tests", "objects", "states", "variables", NULL };
+	struct oval_definition_model_lazy *lazy;
+	struct oval_definition_model *model;
+	xmlNode *root, *child, *node;
+	int alloc = 0;
+
+	xmlDoc *doc = oscap_source_get_xmlDoc(source);
+	if (doc == NULL)
+		return NULL;
+
+	root = xmlDocGetRootElement(doc);
+	if (root == NULL || !_oval_is_oval_element(root, "oval_definitions")) {
+		oscap_seterr(OSCAP_EFAMILY_OVAL, "'%s' is not an OVAL definitions document.",
+			     oscap_source_readable_origin(source));
+		return NULL;
+	}
+
+	model = oval_definition_model_new();
+	lazy = oscap_talloc(struct oval_definition_model_lazy);
+	lazy->doc = doc;
+	lazy->index = oval_string_map_new();
+	lazy->nodes = NULL;
+	lazy->pending = NULL;
+	lazy->pending_count = 0;
+	lazy->pending_alloc = 0;
+	lazy->loading = false;
+	model->lazy = lazy;
+
+	for (child = root->children; child != NULL; child = child->next) {
+		int i;
+
+		if (!_oval_is_oval_element(child, NULL))
+			continue;
+
+		for (i = 0; sections[i] != NULL && xmlStrcmp(child->name, BAD_CAST sections[i]) != 0; ++i);
+		if (sections[i] == NULL) {
+			/* the generator etc. are parsed right away */
+			_oval_definition_model_lazy_queue(lazy, child);
+			continue;
+		}
+
+		for (node = child->children; node != NULL; node = node->next) {
+			if (node->type != XML_ELEMENT_NODE)
+				continue;
+
+			char *id = (char *)xmlGetProp(node, BAD_CAST "id");
+			if (id == NULL)
+				continue;
+
+			/* of elements with the same ID, the first one is used */
+			if (oval_string_map_get_index(lazy->index, id) < 0) {
+				int index = oval_string_map_intern(lazy->index, id);
+				if (index >= alloc) {
+					alloc = alloc > 0 ? alloc * 2 : 1024;
+					lazy->nodes = oscap_realloc(lazy->nodes, sizeof(xmlNode *) * alloc);
+				}
+				lazy->nodes[index] = node;
+			}
+			xmlFree(id);
+		}
+	}
+
+	dI("Indexed %d OVAL elements of '%s' for lazy loading.",
+	   oval_string_map_get_count(lazy->index), oscap_source_readable_origin(source));
+
+	if (_oval_definition_model_lazy_drain(model) != 0) {
+		oval_definition_model_free(model);
+		return NULL;
+	}
+
+	return model;
+}
+
 struct oval_definition_model * oval_definition_model_import(const char *file)
 {
 	struct oscap_source *source = oscap_source_new_from_file(file);
@@ -285,6 +534,9 @@ struct oval_definition *oval_definition_model_get_definition(struct oval_definit
 {
 	__attribute__nonnull__(model);
 
+	if (model->lazy != NULL)
+		_oval_definition_model_lazy_load(model, key);
+
 	return (struct oval_definition *)oval_string_map_get_value(model->definition_map, key);
 }
 
@@ -292,6 +544,9 @@ struct oval_test *oval_definition_model_get_test(struct oval_definition_model *m
 {
 	__attribute__nonnull__(model);
 
+	if (model->lazy != NULL)
+		_oval_definition_model_lazy_load(model, key);
+
 	return (struct oval_test *)oval_string_map_get_value(model->test_map, key);
 }
 
@@ -299,6 +554,9 @@ struct oval_object *oval_definition_model_get_object(struct oval_definition_mode
 {
 	__attribute__nonnull__(model);
 
+	if (model->lazy != NULL)
+		_oval_definition_model_lazy_load(model, key);
+
 	return (struct oval_object *)oval_string_map_get_value(model->object_map, key);
 }
 
@@ -306,6 +564,9 @@ struct oval_state *oval_definition_model_get_state(struct oval_definition_model
 {
 	__attribute__nonnull__(model);
 
+	if (model->lazy != NULL)
+		_oval_definition_model_lazy_load(model, key);
+
 	return (struct oval_state *)oval_string_map_get_value(model->state_map, key);
 }
 
@@ -313,13 +574,16 @@ struct oval_variable *oval_definition_model_get_variable(struct oval_definition_
 {
 	__attribute__nonnull__(model);
 
+	if (model->lazy != NULL)
+		_oval_definition_model_lazy_load(model, key);
+
 	return (struct oval_variable *)oval_string_map_get_value(model->variable_map, key);
 }
 
 int oval_definition_model_bind_variable_model(struct oval_definition_model *defmodel,
 					       struct oval_variable_model *varmodel)
 {
-	struct oval_string_iterator *evar_id_itr;
+	int count;
 
 	if (!defmodel->bound_variable_models)
 		defmodel->bound_variable_models = oval_collection_new();
@@ -328,19 +592,16 @@ int oval_definition_model_bind_variable_model(struct oval_definition_model *defm
 
 	/* todo: keep reference count for each variable model if it can be bound to multiple definition models */
 
-	evar_id_itr = oval_variable_model_get_variable_ids(varmodel);
-	while (oval_string_iterator_has_more(evar_id_itr)) {
-		char *evar_id;
+	count = oval_variable_model_get_variable_count(varmodel);
+	for (int i = 0; i < count; ++i) {
 		struct oval_variable *var;
 
-		evar_id = oval_string_iterator_next(evar_id_itr);
-		var = oval_definition_model_get_variable(defmodel, evar_id);
+		var = oval_definition_model_get_variable(defmodel, oval_variable_model_get_id_at(varmodel, i));
 		if (!var)
 			continue;
 
-		oval_variable_bind_ext_var(var, varmodel, evar_id);
+		oval_variable_bind_ext_var(var, varmodel, i);
 	}
-	oval_string_iterator_free(evar_id_itr);
 
 	return 0;
 }
@@ -370,6 +631,29 @@ void oval_definition_model_clear_external_variables(struct oval_definition_model
 	oval_variable_iterator_free(vars_itr);
 }
 
+void oval_definition_model_clear_dependent_variables(struct oval_definition_model *model, struct oval_variable *variable)
+{
+	struct oval_variable_iterator *vars_itr;
+	const char *var_id = oval_variable_get_id(variable);
+
+	vars_itr = oval_definition_model_get_variables(model);
+	while (oval_variable_iterator_has_more(vars_itr)) {
+		struct oval_variable *var;
+		struct oval_string_map *vm;
+
+		var = oval_variable_iterator_next(vars_itr);
+		if (oval_variable_get_type(var) != OVAL_VARIABLE_LOCAL)
+			continue;
+
+		vm = oval_string_map_new();
+		oval_var_collect_var_refs(var, vm);
+		if (oval_string_map_get_value(vm, var_id) != NULL)
+			oval_variable_clear_values(var);
+		oval_string_map_free(vm, NULL);
+	}
+	oval_variable_iterator_free(vars_itr);
+}
+
 struct oval_definition_iterator *oval_definition_model_get_definitions(struct oval_definition_model
 								       *model)
 {
@@ -659,3 +943,189 @@ void oval_definition_model_optimize_by_filter_propagation(struct oval_definition
 
 	oval_string_map_free(processed_obj_map, NULL);
 }
+
+/* count the references of objects, the count is stored in the map as a pointer */
+static void _sp_add_ref(struct oval_string_map *refs, struct oval_object *obj)
+{
+	char *obj_id = oval_object_get_id(obj);
+	intptr_t cnt = (intptr_t) oval_string_map_get_value(refs, obj_id);
+
+	oval_string_map_put(refs, obj_id, (void *) (cnt + 1));
+}
+
+static void _sp_add_set_refs(struct oval_string_map *refs, struct oval_setobject *set)
+{
+	struct oval_setobject_iterator *subset_itr;
+	struct oval_object_iterator *obj_itr;
+
+	if (oval_setobject_get_type(set) == OVAL_SET_AGGREGATE) {
+		subset_itr = oval_setobject_get_subsets(set);
+		while (oval_setobject_iterator_has_more(subset_itr))
+			_sp_add_set_refs(refs, oval_setobject_iterator_next(subset_itr));
+		oval_setobject_iterator_free(subset_itr);
+	} else {
+		obj_itr = oval_setobject_get_objects(set);
+		while (oval_object_iterator_has_more(obj_itr))
+			_sp_add_ref(refs, oval_object_iterator_next(obj_itr));
+		oval_object_iterator_free(obj_itr);
+	}
+}
+
+static void _sp_add_component_refs(struct oval_string_map *refs, struct oval_component *component)
+{
+	struct oval_component_iterator *comp_itr;
+	oval_component_type_t type = oval_component_get_type(component);
+
+	if (type == OVAL_COMPONENT_OBJECTREF) {
+		if (oval_component_get_object(component) != NULL)
+			_sp_add_ref(refs, oval_component_get_object(component));
+	} else if (type > OVAL_COMPONENT_FUNCTION) {
+		comp_itr = oval_component_get_function_components(component);
+		while (oval_component_iterator_has_more(comp_itr))
+			_sp_add_component_refs(refs, oval_component_iterator_next(comp_itr));
+		oval_component_iterator_free(comp_itr);
+	}
+}
+
+static struct oval_string_map *_sp_object_refs(struct oval_definition_model *model)
+{
+	struct oval_string_map *refs = oval_string_map_new();
+	struct oval_test_iterator *test_itr;
+	struct oval_object_iterator *obj_itr;
+	struct oval_variable_iterator *var_itr;
+
+	test_itr = oval_definition_model_get_tests(model);
+	while (oval_test_iterator_has_more(test_itr)) {
+		struct oval_object *obj = oval_test_get_object(oval_test_iterator_next(test_itr));
+
+		if (obj != NULL)
+			_sp_add_ref(refs, obj);
+	}
+	oval_test_iterator_free(test_itr);
+
+	obj_itr = oval_definition_model_get_objects(model);
+	while (oval_object_iterator_has_more(obj_itr)) {
+		struct oval_object_content_iterator *cont_itr;
+
+		cont_itr = oval_object_get_object_contents(oval_object_iterator_next(obj_itr));
+		while (oval_object_content_iterator_has_more(cont_itr)) {
+			struct oval_object_content *cont = oval_object_content_iterator_next(cont_itr);
+
+			if (oval_object_content_get_type(cont) == OVAL_OBJECTCONTENT_SET)
+				_sp_add_set_refs(refs, oval_object_content_get_setobject(cont));
+		}
+		oval_object_content_iterator_free(cont_itr);
+	}
+	oval_object_iterator_free(obj_itr);
+
+	var_itr = oval_definition_model_get_variables(model);
+	while (oval_variable_iterator_has_more(var_itr)) {
+		struct oval_variable *var = oval_variable_iterator_next(var_itr);
+
+		if (oval_variable_get_type(var) == OVAL_VARIABLE_LOCAL
+		    && oval_variable_get_component(var) != NULL)
+			_sp_add_component_refs(refs, oval_variable_get_component(var));
+	}
+	oval_variable_iterator_free(var_itr);
+
+	return refs;
+}
+
+/* the probes compare the items with the state as the library does */
+static bool _sp_state_pushable(struct oval_state *state)
+{
+	struct oval_state_content_iterator *cont_itr;
+	bool pushable = true;
+
+	cont_itr = oval_state_get_contents(state);
+	while (pushable && oval_state_content_iterator_has_more(cont_itr)) {
+		struct oval_state_content *cont = oval_state_content_iterator_next(cont_itr);
+		struct oval_entity *ent = oval_state_content_get_entity(cont);
+
+		pushable = ent != NULL
+			&& oval_state_content_get_check_existence(cont) == OVAL_AT_LEAST_ONE_EXISTS
+			&& oval_entity_get_varref_type(ent) == OVAL_ENTITY_VARREF_NONE
+			&& oval_entity_get_datatype(ent) != OVAL_DATATYPE_RECORD;
+	}
+	oval_state_content_iterator_free(cont_itr);
+
+	return pushable;
+}
+
+/* the objects with a set are evaluated from other objects by the probes */
+static bool _sp_object_pushable(struct oval_object *obj)
+{
+	struct oval_object_content_iterator *cont_itr;
+	bool pushable = true;
+
+	cont_itr = oval_object_get_object_contents(obj);
+	while (pushable && oval_object_content_iterator_has_more(cont_itr))
+		pushable = oval_object_content_get_type(oval_object_content_iterator_next(cont_itr)) != OVAL_OBJECTCONTENT_SET;
+	oval_object_content_iterator_free(cont_itr);
+
+	return pushable;
+}
+
+void oval_definition_model_optimize_by_state_pushdown(struct oval_definition_model *model)
+{
+	struct oval_string_map *refs;
+	struct oval_test_iterator *test_itr;
+
+	refs = _sp_object_refs(model);
+
+	test_itr = oval_definition_model_get_tests(model);
+	while (oval_test_iterator_has_more(test_itr)) {
+		struct oval_test *test = oval_test_iterator_next(test_itr);
+		struct oval_object *obj = oval_test_get_object(test);
+		struct oval_state_iterator *ste_itr;
+		struct oval_state *ste;
+		struct oval_filter *filter;
+		oval_filter_action_t action;
+		oval_check_t check = oval_test_get_check(test);
+		oval_existence_t existence = oval_test_get_existence(test);
+
+		/*
+		 * Only the items which decide the result are collected:
+		 * - all items satisfy the state, any number of them exists:
+		 *   the items which don't satisfy it
+		 * - no item satisfies the state, any number of them exists:
+		 *   the items which satisfy it
+		 * - at least one item satisfies the state, at least one exists:
+		 *   the items which satisfy it
+		 * Without any item left, the object doesn't exist, which gives
+		 * the same result as the evaluation of all the items.
+		 */
+		if (check == OVAL_CHECK_ALL && existence == OVAL_ANY_EXIST)
+			action = OVAL_FILTER_ACTION_EXCLUDE;
+		else if (check == OVAL_CHECK_NONE_SATISFY && existence == OVAL_ANY_EXIST)
+			action = OVAL_FILTER_ACTION_INCLUDE;
+		else if (check == OVAL_CHECK_AT_LEAST_ONE && existence == OVAL_AT_LEAST_ONE_EXISTS)
+			action = OVAL_FILTER_ACTION_INCLUDE;
+		else
+			continue;
+
+		if (obj == NULL || oval_object_get_pushdown_filter(obj) != NULL
+		    || (intptr_t) oval_string_map_get_value(refs, oval_object_get_id(obj)) != 1
+		    || !_sp_object_pushable(obj))
+			continue;
+
+		ste_itr = oval_test_get_states(test);
+		ste = oval_state_iterator_has_more(ste_itr) ? oval_state_iterator_next(ste_itr) : NULL;
+		if (ste == NULL || oval_state_iterator_has_more(ste_itr) || !_sp_state_pushable(ste)) {
+			oval_state_iterator_free(ste_itr);
+			continue;
+		}
+		oval_state_iterator_free(ste_itr);
+
+		dI("Items of object '%s' are filtered by state '%s' of test '%s' during the collection.",
+		   oval_object_get_id(obj), oval_state_get_id(ste), oval_test_get_id(test));
+
+		filter = oval_filter_new(model);
+		oval_filter_set_state(filter, ste);
+		oval_filter_set_filter_action(filter, action);
+		oval_object_set_pushdown_filter(obj, filter);
+	}
+	oval_test_iterator_free(test_itr);
+
+	oval_string_map_free(refs, NULL);
+}
@@ -54,6 +54,7 @@
 typedef struct oval_definition {
 	struct oval_definition_model *model;
 	char *id;
+	int id_index;				///< see oval_definition_model_intern_id
 	int version;
 	oval_definition_class_t class;
 	int deprecated;
@@ -78,6 +79,13 @@ char *oval_definition_get_id(struct oval_definition *definition)
 	return ((struct oval_definition *)definition)->id;
 }
 
+int oval_definition_get_id_index(struct oval_definition *definition)
+{
+	__attribute__nonnull__(definition);
+
+	return definition->id_index;
+}
+
 int oval_definition_get_version(struct oval_definition *definition)
 {
 	__attribute__nonnull__(definition);
@@ -156,6 +164,7 @@ struct oval_definition *oval_definition_new(struct oval_definition_model *model,
         assume_r(definition != NULL, /* return */ NULL);
 
 	definition->id = oscap_strdup(id);
+	definition->id_index = oval_definition_model_intern_id(model, id);
 	definition->version = 0;
 	definition->class = OVAL_CLASS_UNKNOWN;
 	definition->deprecated = 0;
@@ -73,6 +73,7 @@ int oval_affected_parse_tag(xmlTextReaderPtr reader, struct oval_parser_context
 char *oval_test_get_state_names(struct oval_test *test);
 int oval_test_parse_tag(xmlTextReaderPtr reader, struct oval_parser_context *context, void *);
 xmlNode *oval_test_to_dom(struct oval_test *, xmlDoc *, xmlNode *);
+int oval_test_get_id_index(struct oval_test *);
 
 typedef void (*oval_criteria_consumer) (struct oval_criteria_node *, void *);
 xmlNode *oval_criteria_node_to_dom(struct oval_criteria_node *, xmlDoc *, xmlNode *);
@@ -83,12 +84,16 @@ int oval_reference_parse_tag(xmlTextReaderPtr, struct oval_parser_context *, ova
 
 int oval_definition_parse_tag(xmlTextReaderPtr reader, struct oval_parser_context *context, void *);
 xmlNode *oval_definition_to_dom(struct oval_definition *, xmlDoc *, xmlNode *);
+int oval_definition_get_id_index(struct oval_definition *);
 
 int oval_object_parse_tag(xmlTextReaderPtr reader, struct oval_parser_context *context, void *);
 xmlNode *oval_object_to_dom(struct oval_object *, xmlDoc *, xmlNode *);
 struct oval_object *oval_object_clone2(struct oval_definition_model *, struct oval_object *, char *);
 struct oval_object *oval_object_create_internal(struct oval_object *, char *);
 struct oval_object *oval_object_get_base_obj(struct oval_object *);
+/* filter added by oval_definition_model_optimize_by_state_pushdown, the object owns it */
+struct oval_filter *oval_object_get_pushdown_filter(struct oval_object *);
+void oval_object_set_pushdown_filter(struct oval_object *, struct oval_filter *);
 
 OSCAP_DEPRECATED(oval_version_t oval_state_get_schema_version(const struct oval_state *state));
 oval_schema_version_t oval_state_get_platform_schema_version(const struct oval_state *state);
@@ -157,10 +162,22 @@ void oval_message_to_dom(struct oval_message *, xmlDoc *, xmlNode *);
 /* generator */
 int oval_generator_parse_tag(xmlTextReader *, struct oval_parser_context *, void *user);
 xmlNode *oval_generator_to_dom(struct oval_generator *, xmlDocPtr, xmlNode *);
+/* platform -> schema version */
+struct oscap_htable_iterator *oval_generator_get_platform_schema_versions(struct oval_generator *);
+/* the XML of the other elements, e.g. vendor */
+const char *oval_generator_get_anyxml(struct oval_generator *);
+void oval_generator_set_anyxml(struct oval_generator *, const char *anyxml);
 
 /* definition_model */
 xmlNode *oval_definition_model_to_dom(struct oval_definition_model *definition_model, xmlDocPtr doc, xmlNode * parent);
 void oval_definition_model_optimize_by_filter_propagation(struct oval_definition_model *);
+/*
+ * Send the state of a test along with its object to the probe, as a filter,
+ * so that only the items which decide the result are collected. It's done
+ * for the objects which aren't referenced by anything else than the test,
+ * and only for the checks where the result doesn't change.
+ */
+void oval_definition_model_optimize_by_state_pushdown(struct oval_definition_model *);
 
 struct oval_definition *oval_definition_model_get_new_definition(struct oval_definition_model *, const char *);
 struct oval_test       *oval_definition_model_get_new_test(struct oval_definition_model *, const char *);
@@ -172,6 +189,16 @@ void oval_definition_model_add_test(struct oval_definition_model *, struct oval_
 void oval_definition_model_add_object(struct oval_definition_model *, struct oval_object *);
 void oval_definition_model_add_state(struct oval_definition_model *, struct oval_state *);
 void oval_definition_model_add_variable(struct oval_definition_model *, struct oval_variable *);
+/**
+ * Map the ID of a definition or test to a small dense number, which stays
+ * the same for the lifetime of the model. The results use these numbers to
+ * index arrays instead of looking the IDs up in string maps.
+ */
+int oval_definition_model_intern_id(struct oval_definition_model *, const char *id);
+/// Get the number of an interned ID or -1 if the ID isn't known to the model.
+int oval_definition_model_get_id_index(struct oval_definition_model *, const char *id);
+/// Parse the elements of a lazily loaded model which haven't been needed yet.
+void oval_definition_model_load_all(struct oval_definition_model *);
 
 const char * oval_definition_model_get_schema(struct oval_definition_model * model);
 void oval_definition_model_set_schema(struct oval_definition_model *model, const char *version);
@@ -181,10 +208,25 @@ oval_schema_version_t oval_definition_model_get_platform_schema_version(struct o
 
 struct oval_string_map *oval_definition_model_build_vardef_mapping(struct oval_definition_model *model);
 struct oval_string_iterator *oval_definition_model_get_definitions_dependent_on_variable(struct oval_definition_model *model, struct oval_variable *variable);
+/* forget the values of the local variables computed from the variable */
+void oval_definition_model_clear_dependent_variables(struct oval_definition_model *model, struct oval_variable *variable);
 
 /* variable model */
-struct oval_collection *oval_variable_model_get_values_ref(struct oval_variable_model *, char *);
-int oval_variable_bind_ext_var(struct oval_variable *, struct oval_variable_model *, char *);
+/* the dense index of a variable of the model (0, 1, ... in the order of parsing) or -1 */
+int oval_variable_model_get_index(struct oval_variable_model *, const char *);
+int oval_variable_model_get_variable_count(struct oval_variable_model *);
+const char *oval_variable_model_get_id_at(struct oval_variable_model *, int);
+/**
+ * The values of the variable at the index as an array of texts, all of the
+ * returned datatype. The array is valid until a value is added to the model.
+ * @return the number of the values
+ */
+int oval_variable_model_get_texts_at(struct oval_variable_model *, int, const char *const **, oval_datatype_t *);
+/* the values as oval_value objects, built on the first call */
+struct oval_collection *oval_variable_model_get_values_at(struct oval_variable_model *, int);
+int oval_variable_bind_ext_var(struct oval_variable *, struct oval_variable_model *, int);
+/* see oval_variable_model_get_texts_at, -1 if the variable isn't an external one bound to a model */
+int oval_variable_get_value_texts(struct oval_variable *, const char *const **, oval_datatype_t *);
 bool oval_variable_contains_value(struct oval_variable *variable, const char* o_value_text);
 
 //Synthetic object subtype for probing system info.
@@ -201,6 +201,29 @@ struct oval_result_directives *oval_directives_model_get_new_classdir(struct ova
 }
 
 
+static bool oval_result_directives_is_thin(struct oval_result_directives *directives)
+{
+	for (int i = 0; i < NUMBER_OF_RESULTS; i++) {
+		if (directives->directive[i].reported
+		    && directives->directive[i].content == OVAL_DIRECTIVE_CONTENT_FULL)
+			return false;
+	}
+	return true;
+}
+
+bool oval_directives_model_is_thin(struct oval_directives_model *model)
+{
+	if (!oval_result_directives_is_thin(model->def_directives))
+		return false;
+
+	for (int i = 0; i < NUMBER_OF_CLASSES; i++) {
+		if (model->class_directives[i] != NULL
+		    && !oval_result_directives_is_thin(model->class_directives[i]))
+			return false;
+	}
+	return true;
+}
+
 struct oval_result_directives *oval_result_directives_new(void)
 {
 	struct oval_result_directives *directives = (struct oval_result_directives *)
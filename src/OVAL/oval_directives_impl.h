@@ -41,6 +41,8 @@ OSCAP_HIDDEN_START;
 int oval_result_directives_parse_tag(xmlTextReaderPtr, struct oval_parser_context *, void *);
 int oval_result_directives_to_dom(struct oval_result_directives *, xmlDoc *, xmlNode *);
 xmlNode *oval_directives_model_to_dom(struct oval_directives_model *, xmlDocPtr, xmlNode *);
+/* whether no reported result type asks for the full content (criteria and tests) */
+bool oval_directives_model_is_thin(struct oval_directives_model *);
 
 OSCAP_HIDDEN_END;
 
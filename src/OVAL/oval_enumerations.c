@@ -46,11 +46,10 @@ const char _invalid[] = "**INVALID**";
 
 static int oval_enumeration_attr(xmlTextReaderPtr reader, char *attname, const struct oscap_string_map *map, int defval)
 {
-	char *attrstr = (char *)xmlTextReaderGetAttribute(reader, BAD_CAST attname);
+	const char *attrstr = oval_parser_attribute_get(reader, attname);
 	if (attrstr == NULL)
 		return defval;
 	int ret = oscap_string_to_enum(map, attrstr);
-	oscap_free(attrstr);
 	return ret == OVAL_ENUMERATION_INVALID ? defval : ret;
 }
 
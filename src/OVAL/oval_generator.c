@@ -118,6 +118,22 @@ char *oval_generator_get_timestamp(struct oval_generator *generator)
 	return generator->timestamp;
 }
 
+struct oscap_htable_iterator *oval_generator_get_platform_schema_versions(struct oval_generator *generator)
+{
+	return oscap_htable_iterator_new(generator->platform_schema_versions);
+}
+
+const char *oval_generator_get_anyxml(struct oval_generator *generator)
+{
+	return generator->anyxml;
+}
+
+void oval_generator_set_anyxml(struct oval_generator *generator, const char *anyxml)
+{
+	oscap_free(generator->anyxml);
+	generator->anyxml = oscap_strdup(anyxml);
+}
+
 const char *oval_generator_get_platform_schema_version (struct oval_generator *generator, const char *platform)
 {
 	char *platform_schema_version = oscap_htable_get(generator->platform_schema_versions, platform);
@@ -47,6 +47,7 @@ typedef struct oval_object {
 	struct oval_definition_model *model;
 	oval_subtype_t subtype;
 	struct oval_object *base_obj_ref;
+	struct oval_filter *pushdown_filter; /* not a part of the definition, see oval_object_get_pushdown_filter() */
 	struct oval_collection *notes;
 	char *comment;
 	char *id;
@@ -183,6 +184,7 @@ struct oval_object *oval_object_new(struct oval_definition_model *model, const c
 	object->id = oscap_strdup(id);
 	object->subtype = OVAL_SUBTYPE_UNKNOWN;
 	object->base_obj_ref = NULL;
+	object->pushdown_filter = NULL;
 	object->deprecated = 0;
 	object->version = 0;
 	object->behaviors = oval_collection_new();
@@ -252,6 +254,8 @@ void oval_object_free(struct oval_object *object)
 	oval_collection_free_items(object->behaviors, (oscap_destruct_func) oval_behavior_free);
 	oval_collection_free_items(object->notes, (oscap_destruct_func) oscap_free);
 	oval_collection_free_items(object->object_content, (oscap_destruct_func) oval_object_content_free);
+	if (object->pushdown_filter != NULL)
+		oval_filter_free(object->pushdown_filter);
 
 	object->comment = NULL;
 	object->id = NULL;
@@ -485,3 +489,15 @@ struct oval_object *oval_object_get_base_obj(struct oval_object *obj)
 {
 	return obj->base_obj_ref;
 }
+
+struct oval_filter *oval_object_get_pushdown_filter(struct oval_object *obj)
+{
+	return obj->pushdown_filter;
+}
+
+void oval_object_set_pushdown_filter(struct oval_object *obj, struct oval_filter *filter)
+{
+	if (obj->pushdown_filter != NULL)
+		oval_filter_free(obj->pushdown_filter);
+	obj->pushdown_filter = filter;
+}
@@ -219,9 +219,20 @@ int oval_parser_skip_tag(xmlTextReaderPtr reader, struct oval_parser_context *co
 }
 
 
+const char *oval_parser_attribute_get(xmlTextReaderPtr reader, const char *attname)
+{
+	const char *value;
+
+	if (xmlTextReaderMoveToAttribute(reader, BAD_CAST attname) != 1)
+		return NULL;
+	value = (const char *)xmlTextReaderConstValue(reader);
+	xmlTextReaderMoveToElement(reader);
+	return value;
+}
+
 int oval_parser_boolean_attribute(xmlTextReaderPtr reader, char *attname, int defval)
 {
-	char *string = (char *)xmlTextReaderGetAttribute(reader, BAD_CAST attname);
+	const char *string = oval_parser_attribute_get(reader, attname);
 	int booval;
 	if (string == NULL)
 		booval = defval;
@@ -230,20 +241,17 @@ int oval_parser_boolean_attribute(xmlTextReaderPtr reader, char *attname, int de
 			booval = (*string == '1');
 		else
 			booval = (strcmp(string, "true") == 0);
-		oscap_free(string);
 	}
 	return booval;
 }
 
 int oval_parser_int_attribute(xmlTextReaderPtr reader, char *attname, int defval)
 {
-	char *string = (char *)xmlTextReaderGetAttribute(reader, BAD_CAST attname);
+	const char *string = oval_parser_attribute_get(reader, attname);
 	int value;
 	if (string == NULL)
 		value = defval;
-	else {
+	else
 		value = atoi(string);
-		oscap_free(string);
-	}
 	return value;
 }
@@ -56,6 +56,11 @@ int oval_definition_model_parse(xmlTextReaderPtr, struct oval_parser_context *);
 int oval_syschar_model_parse(xmlTextReaderPtr, struct oval_parser_context *);
 int oval_results_model_parse(xmlTextReaderPtr , struct oval_parser_context *);
 
+/*
+ * The value of the attribute of the current element without a copy, it
+ * is valid until the reader reads on.
+ */
+const char *oval_parser_attribute_get(xmlTextReaderPtr reader, const char *attname);
 int oval_parser_boolean_attribute(xmlTextReaderPtr reader, char *attname, int defval);
 int oval_parser_int_attribute(xmlTextReaderPtr reader, char *attname, int defval);
 
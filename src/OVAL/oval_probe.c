@@ -25,6 +25,7 @@
 #endif
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
@@ -37,6 +38,7 @@
 #include "oval_system_characteristics.h"
 #include "common/_error.h"
 #include "common/assume.h"
+#include "common/alloc.h"
 
 #include "oval_probe_impl.h"
 #include "oval_system_characteristics_impl.h"
@@ -206,12 +208,18 @@ static void _syschar_add_bindings(struct oval_syschar *sc, struct oval_string_ma
 		struct oval_variable *var;
 		struct oval_value_iterator *val_itr;
 		struct oval_variable_binding *binding;
+		const char *const *texts;
+		int count;
 
 		var = oval_collection_iterator_next(var_itr);
 		binding = oval_variable_binding_new(var, NULL);
 
-		val_itr = oval_variable_get_values(var);
-		while (oval_value_iterator_has_more(val_itr)) {
+		count = oval_variable_get_value_texts(var, &texts, NULL);
+		for (int i = 0; i < count; ++i)
+			oval_variable_binding_add_value(binding, oscap_strdup(texts[i]));
+
+		val_itr = (count < 0) ? oval_variable_get_values(var) : NULL;
+		while (val_itr != NULL && oval_value_iterator_has_more(val_itr)) {
 			struct oval_value *val;
 			char *txt;
 
@@ -220,7 +228,8 @@ static void _syschar_add_bindings(struct oval_syschar *sc, struct oval_string_ma
 			txt = oscap_strdup(txt);
 			oval_variable_binding_add_value(binding, txt);
 		}
-		oval_value_iterator_free(val_itr);
+		if (val_itr != NULL)
+			oval_value_iterator_free(val_itr);
 
 		oval_syschar_add_variable_binding(sc, binding);
 	}
@@ -260,11 +269,19 @@ int oval_probe_query_object(oval_probe_session_t *psess, struct oval_object *obj
 			dI("System characteristics for %s_object '%s' already exist, flag: %s.", type_name, oid, flag_text);
 
 			if (sc_flg != SYSCHAR_FLAG_UNKNOWN || (flags & OVAL_PDFLAG_NOREPLY)) {
+				if (!(flags & OVAL_PDFLAG_NOREPLY))
+					oval_probe_stats_hit(psess->stats, object);
 				if (out_syschar)
 					*out_syschar = sysc;
 				return 0;
 			}
 		}
+	} else if ((sysc = oval_probe_incr_reuse(psess->incr, model, object)) != NULL) {
+		if (!(flags & OVAL_PDFLAG_NOREPLY))
+			oval_probe_stats_hit(psess->stats, object);
+		if (out_syschar)
+			*out_syschar = sysc;
+		return 0;
 	} else {
 		dI("Creating new syschar for %s_object '%s'.", type_name, oid);
 		sysc = oval_syschar_new(model, object);
@@ -299,14 +316,50 @@ int oval_probe_query_object(oval_probe_session_t *psess, struct oval_object *obj
 	return 0;
 }
 
+/*
+ * The system information collected by the sysinfo probe is the same for
+ * all the sessions of the process (e.g. the agents of the OVAL files of
+ * an XCCDF session and of the CPE dictionaries), so it's queried once and
+ * every session gets a copy.
+ */
+static struct oval_sysinfo *__sysinfo = NULL;
+#if defined(OSCAP_THREAD_SAFE)
+static pthread_mutex_t __sysinfo_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static struct oval_sysinfo *oval_probe_sysinfo_cached(struct oval_syschar_model *model)
+{
+	struct oval_sysinfo *sysinf = NULL;
+
+#if defined(OSCAP_THREAD_SAFE)
+	pthread_mutex_lock(&__sysinfo_lock);
+#endif
+	if (__sysinfo != NULL)
+		sysinf = oval_sysinfo_clone(model, __sysinfo);
+#if defined(OSCAP_THREAD_SAFE)
+	pthread_mutex_unlock(&__sysinfo_lock);
+#endif
+	return sysinf;
+}
+
+static void oval_probe_sysinfo_cache(struct oval_sysinfo *sysinf)
+{
+#if defined(OSCAP_THREAD_SAFE)
+	pthread_mutex_lock(&__sysinfo_lock);
+#endif
+	if (__sysinfo == NULL)
+		__sysinfo = oval_sysinfo_clone(NULL, sysinf);
+#if defined(OSCAP_THREAD_SAFE)
+	pthread_mutex_unlock(&__sysinfo_lock);
+#endif
+}
+
 int oval_probe_query_sysinfo(oval_probe_session_t *sess, struct oval_sysinfo **out_sysinfo)
 {
 	struct oval_sysinfo *sysinf;
         oval_ph_t *ph;
 	int ret;
 
-	dI("Querying system information.");
-
         ph = oval_probe_handler_get(sess->ph, OVAL_SUBTYPE_SYSINFO);
 
         if (ph == NULL) {
@@ -319,18 +372,305 @@ int oval_probe_query_sysinfo(oval_probe_session_t *sess, struct oval_sysinfo **o
 		return(-1);
         }
 
+	/* only the information of the sysinfo probe is shared, not that of custom handlers */
+	if (ph->func == &oval_probe_sys_handler
+	    && (sysinf = oval_probe_sysinfo_cached(sess->sys_model)) != NULL) {
+		dI("Reusing the system information.");
+		*out_sysinfo = sysinf;
+		return(0);
+	}
+
+	dI("Querying system information.");
+
         sysinf = NULL;
 
 	ret = ph->func(OVAL_SUBTYPE_SYSINFO, ph->uptr, PROBE_HANDLER_ACT_EVAL, NULL, &sysinf, 0);
 	if (ret != 0)
 		return(ret);
 
+	if (ph->func == &oval_probe_sys_handler && sysinf != NULL)
+		oval_probe_sysinfo_cache(sysinf);
+
 	*out_sysinfo = sysinf;
 	return(0);
 }
 
 static int oval_probe_query_criteria(oval_probe_session_t *sess, struct oval_criteria_node *cnode);
 
+/*
+ * Objects which don't reference any variables or other objects can be
+ * evaluated in any order. They are sent to the probes together before
+ * the criteria of a definition are walked, so the probes work on them in
+ * parallel while the library waits for the replies. The rest is left to
+ * oval_probe_query_object, which resolves the dependencies first.
+ */
+static bool oval_probe_prefetch_object_ok(oval_probe_session_t *sess, struct oval_object *object)
+{
+	struct oval_object_content_iterator *cont_itr;
+	struct oval_string_map *vm;
+	oval_ph_t *ph;
+	bool ret = true;
+
+	ph = oval_probe_handler_get(sess->ph, oval_object_get_subtype(object));
+
+	if (ph == NULL || ph->func != &oval_probe_ext_handler)
+		return false;
+
+	cont_itr = oval_object_get_object_contents(object);
+	while (ret && oval_object_content_iterator_has_more(cont_itr)) {
+		struct oval_object_content *cont = oval_object_content_iterator_next(cont_itr);
+
+		if (oval_object_content_get_type(cont) == OVAL_OBJECTCONTENT_SET)
+			ret = false;
+	}
+	oval_object_content_iterator_free(cont_itr);
+
+	if (!ret)
+		return false;
+
+	vm = oval_string_map_new();
+	oval_obj_collect_var_refs(object, vm);
+	ret = oval_string_map_is_empty(vm);
+	oval_string_map_free(vm, NULL);
+
+	return ret;
+}
+
+struct oval_probe_prefetch {
+	struct oval_string_map *seen;
+	struct oval_syschar   **sys;
+	size_t                  count;
+};
+
+static void oval_probe_prefetch_criteria(oval_probe_session_t *sess, struct oval_criteria_node *cnode, struct oval_probe_prefetch *pf)
+{
+	switch (oval_criteria_node_get_type(cnode)) {
+	case OVAL_NODETYPE_CRITERION:{
+		struct oval_test *test = oval_criteria_node_get_test(cnode);
+		struct oval_object *object;
+		const char *oid;
+
+		if (test == NULL)
+			return;
+		object = oval_test_get_object(test);
+		if (object == NULL || oval_test_get_subtype(test) != oval_object_get_subtype(object))
+			return;
+
+		oid = oval_object_get_id(object);
+		if (oval_string_map_get_value(pf->seen, oid) != NULL)
+			return;
+		oval_string_map_put(pf->seen, oid, object);
+
+		if (oval_syschar_model_get_syschar(sess->sys_model, oid) != NULL)
+			return;
+		if (oval_probe_incr_reuse(sess->incr, sess->sys_model, object) != NULL)
+			return;
+		if (!oval_probe_prefetch_object_ok(sess, object))
+			return;
+
+		pf->sys = oscap_realloc(pf->sys, sizeof(struct oval_syschar *) * (pf->count + 1));
+		pf->sys[pf->count++] = oval_syschar_new(sess->sys_model, object);
+		return;
+	}
+	case OVAL_NODETYPE_CRITERIA:{
+		struct oval_criteria_node_iterator *cnode_it = oval_criteria_node_get_subnodes(cnode);
+		if (cnode_it == NULL)
+			return;
+		while (oval_criteria_node_iterator_has_more(cnode_it))
+			oval_probe_prefetch_criteria(sess, oval_criteria_node_iterator_next(cnode_it), pf);
+		oval_criteria_node_iterator_free(cnode_it);
+		return;
+	}
+	case OVAL_NODETYPE_EXTENDDEF:{
+		struct oval_definition *oval_def = oval_criteria_node_get_definition(cnode);
+		struct oval_criteria_node *criteria;
+		const char *def_id;
+
+		if (oval_def == NULL)
+			return;
+		def_id = oval_definition_get_id(oval_def);
+		if (oval_string_map_get_value(pf->seen, def_id) != NULL)
+			return;
+		oval_string_map_put(pf->seen, def_id, oval_def);
+
+		criteria = oval_definition_get_criteria(oval_def);
+		if (criteria != NULL)
+			oval_probe_prefetch_criteria(sess, criteria, pf);
+		return;
+	}
+	case OVAL_NODETYPE_UNKNOWN:
+		break;
+	}
+}
+
+static void oval_probe_prefetch_init(struct oval_probe_prefetch *pf)
+{
+	pf->seen  = oval_string_map_new();
+	pf->sys   = NULL;
+	pf->count = 0;
+}
+
+static void oval_probe_prefetch_add(oval_probe_session_t *sess, struct oval_definition *definition, struct oval_probe_prefetch *pf)
+{
+	struct oval_criteria_node *cnode;
+	const char *def_id;
+
+	def_id = oval_definition_get_id(definition);
+	if (oval_string_map_get_value(pf->seen, def_id) != NULL)
+		return;
+	oval_string_map_put(pf->seen, def_id, definition);
+
+	cnode = oval_definition_get_criteria(definition);
+	if (cnode != NULL)
+		oval_probe_prefetch_criteria(sess, cnode, pf);
+}
+
+static void oval_probe_prefetch_free(struct oval_probe_prefetch *pf)
+{
+	oscap_free(pf->sys);
+	oval_string_map_free(pf->seen, NULL);
+}
+
+/*
+ * Reorder the syschars so that the probe types take turns. The batch is
+ * sent in this order, so with a limit on the number of requests in flight
+ * every probe gets some work before the first one is given more.
+ */
+static void oval_probe_prefetch_interleave(struct oval_probe_prefetch *pf)
+{
+	struct oval_syschar **out;
+	oval_subtype_t *types;
+	size_t *next;
+	size_t i, t, n, ntypes;
+
+	if (pf->count < 2)
+		return;
+
+	out   = oscap_alloc(sizeof(struct oval_syschar *) * pf->count);
+	types = oscap_alloc(sizeof(oval_subtype_t) * pf->count);
+	next  = oscap_calloc(pf->count, sizeof(size_t));
+
+	for (ntypes = 0, i = 0; i < pf->count; ++i) {
+		oval_subtype_t type = oval_object_get_subtype(oval_syschar_get_object(pf->sys[i]));
+
+		for (t = 0; t < ntypes; ++t)
+			if (types[t] == type)
+				break;
+		if (t == ntypes)
+			types[ntypes++] = type;
+	}
+
+	for (n = 0; n < pf->count;) {
+		for (t = 0; t < ntypes; ++t) {
+			/* next[t] is where to look for the next object of types[t] */
+			for (i = next[t]; i < pf->count; ++i) {
+				if (oval_object_get_subtype(oval_syschar_get_object(pf->sys[i])) == types[t])
+					break;
+			}
+			if (i < pf->count)
+				out[n++] = pf->sys[i];
+			next[t] = i + 1;
+		}
+	}
+
+	oscap_free(pf->sys);
+	oscap_free(types);
+	oscap_free(next);
+	pf->sys = out;
+}
+
+void oval_probe_prefetch_definition(oval_probe_session_t *sess, struct oval_definition *definition, unsigned int jobs)
+{
+	struct oval_probe_prefetch pf;
+
+	oval_probe_prefetch_init(&pf);
+	oval_probe_prefetch_add(sess, definition, &pf);
+
+	dD("Prefetching %zu objects of definition '%s'.", pf.count, oval_definition_get_id(definition));
+
+	if (pf.count > 0) {
+		if (jobs > 0)
+			oval_probe_prefetch_interleave(&pf);
+		oval_probe_ext_eval_batch(sess->pext, pf.sys, pf.count, jobs);
+	}
+
+	oval_probe_prefetch_free(&pf);
+}
+
+void oval_probe_prefetch_model(oval_probe_session_t *sess, struct oval_definition_model *model, unsigned int jobs)
+{
+	struct oval_definition_iterator *def_it;
+	struct oval_probe_prefetch pf;
+
+	oval_probe_prefetch_init(&pf);
+
+	def_it = oval_definition_model_get_definitions(model);
+	while (oval_definition_iterator_has_more(def_it))
+		oval_probe_prefetch_add(sess, oval_definition_iterator_next(def_it), &pf);
+	oval_definition_iterator_free(def_it);
+
+	dI("Scheduling %zu independent objects, %u at a time.", pf.count, jobs);
+
+	if (pf.count > 0) {
+		oval_probe_prefetch_interleave(&pf);
+		oval_probe_ext_eval_batch(sess->pext, pf.sys, pf.count, jobs);
+	}
+
+	oval_probe_prefetch_free(&pf);
+}
+
+void oval_probe_prefetch_definitions(oval_probe_session_t *sess, struct oval_definition **definitions, size_t count, unsigned int jobs)
+{
+	struct oval_probe_prefetch pf;
+	size_t i;
+
+	oval_probe_prefetch_init(&pf);
+
+	for (i = 0; i < count; ++i)
+		oval_probe_prefetch_add(sess, definitions[i], &pf);
+
+	dI("Scheduling %zu independent objects of %zu definitions, %u at a time.", pf.count, count, jobs);
+
+	if (pf.count > 0) {
+		oval_probe_prefetch_interleave(&pf);
+		oval_probe_ext_eval_batch(sess->pext, pf.sys, pf.count, jobs);
+	}
+
+	oval_probe_prefetch_free(&pf);
+}
+
+void oval_probe_session_prestart(oval_probe_session_t *sess, struct oval_definition_model *model)
+{
+	struct oval_object_iterator *obj_it;
+	oval_subtype_t *types = NULL, type;
+	size_t count = 0, i;
+	oval_ph_t *ph;
+
+	obj_it = oval_definition_model_get_objects(model);
+	while (oval_object_iterator_has_more(obj_it)) {
+		type = oval_object_get_subtype(oval_object_iterator_next(obj_it));
+		ph   = oval_probe_handler_get(sess->ph, type);
+
+		if (ph == NULL || ph->func != &oval_probe_ext_handler)
+			continue;
+
+		/* there are a few types in a model */
+		for (i = 0; i < count && types[i] != type; ++i)
+			;
+
+		if (i == count) {
+			types = oscap_realloc(types, sizeof(oval_subtype_t) * (count + 1));
+			types[count++] = type;
+		}
+	}
+	oval_object_iterator_free(obj_it);
+
+	if (count > 0)
+		oval_probe_ext_prestart(sess->pext, types, count);
+
+	oscap_free(types);
+}
+
 int oval_probe_query_definition(oval_probe_session_t *sess, const char *id) {
 
 	struct oval_syschar_model * syschar_model;
@@ -350,6 +690,7 @@ int oval_probe_query_definition(oval_probe_session_t *sess, const char *id) {
 	if (cnode == NULL)
 		return -1;
 
+	oval_probe_prefetch_definition(sess, definition, 0);
 	ret = oval_probe_query_criteria(sess, cnode);
 
 	return ret;
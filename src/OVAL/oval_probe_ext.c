@@ -28,6 +28,7 @@
 #include <string.h>
 #include <errno.h>
 #include <limits.h>
+#include <inttypes.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -39,9 +40,12 @@
 #include "common/util.h"
 #include "common/bfind.h"
 #include "common/debug_priv.h"
+#include "common/oscap_trace.h"
 #include "probes/public/probe-api.h"
+#include "adt/oval_string_map_impl.h"
 #include "oval_probe_ext.h"
 #include "oval_sexp.h"
+#include "oval_probe_stats.h"
 #include "oval_probe_meta.h"
 
 #define __ERRBUF_SIZE 128
@@ -52,8 +56,368 @@
 
 static oval_pdtbl_t *oval_pdtbl_new(void);
 static void          oval_pdtbl_free(oval_pdtbl_t *table);
+static void          oval_pdtbl_clear(oval_pdtbl_t *table);
 static int           oval_pdtbl_add(oval_pdtbl_t *table, oval_subtype_t type, int sd, const char *uri);
 static oval_pd_t    *oval_pdtbl_get(oval_pdtbl_t *table, oval_subtype_t type);
+static void          oval_pd_replies_flush(oval_pd_t *pd);
+static void          oval_pd_stream_del(oval_pd_t *pd, struct oval_sexp_stream *stream);
+
+static int oval_probe_cmd_init(SEAP_CTX_t *ctx);
+
+/*
+ * oval_pdpool_
+ *
+ * The probes are shared by all the sessions of the process, so they are
+ * started once and keep their caches warm for the next session: a table
+ * of the probe descriptors is created by the first session and freed with
+ * the last one. The probes read the root (OSCAP_PROBE_ROOT) and the remote
+ * host they were started with, so the sessions share a table only if both
+ * are the same. The probes cache the objects and the states of a session
+ * under keys in the namespace of the session (see oval_cache_key_to_sexp),
+ * which is how the commands of the probes find the session back.
+ */
+struct oval_pdpool_tbl {
+        char           *root;   /**< OSCAP_PROBE_ROOT of the probes, NULL if unset */
+        char           *remote; /**< see oval_pext.remote */
+        oval_pdtbl_t   *pdtbl;
+        size_t          refs;   /**< sessions using the table */
+        struct oval_pdpool_tbl *next;
+};
+
+static struct {
+        pthread_mutex_t lock;
+        struct oval_pdpool_tbl *tbls;
+        oval_pext_t   **pexts; /**< sessions by their namespace - 1, NULL when freed */
+        unsigned int    count;
+} __pdpool = { PTHREAD_MUTEX_INITIALIZER, NULL, NULL, 0 };
+
+/* namespaces aren't reused, the probes may still cache keys of a freed session */
+static void oval_pdpool_register(oval_pext_t *pext)
+{
+        pthread_mutex_lock(&__pdpool.lock);
+        __pdpool.pexts = oscap_realloc(__pdpool.pexts, sizeof(oval_pext_t *) * (__pdpool.count + 1));
+        __pdpool.pexts[__pdpool.count++] = pext;
+        pext->ns = __pdpool.count;
+        pthread_mutex_unlock(&__pdpool.lock);
+}
+
+static void oval_pdpool_unregister(oval_pext_t *pext)
+{
+        pthread_mutex_lock(&__pdpool.lock);
+        __pdpool.pexts[pext->ns - 1] = NULL;
+        pthread_mutex_unlock(&__pdpool.lock);
+}
+
+static oval_pdtbl_t *oval_pdpool_get(oval_pext_t *pext)
+{
+        struct oval_pdpool_tbl *tbl;
+        oval_pdtbl_t *pdtbl;
+        const char *root;
+
+        root = getenv("OSCAP_PROBE_ROOT");
+
+        pthread_mutex_lock(&__pdpool.lock);
+
+        for (tbl = __pdpool.tbls; tbl != NULL; tbl = tbl->next) {
+                if (oscap_streq(tbl->root, root) && oscap_streq(tbl->remote, pext->remote))
+                        break;
+        }
+
+        if (tbl == NULL) {
+                pdtbl = oval_pdtbl_new();
+
+                if (oval_probe_cmd_init(pdtbl->ctx) != 0) {
+                        oval_pdtbl_free(pdtbl);
+                        pthread_mutex_unlock(&__pdpool.lock);
+                        return (NULL);
+                }
+
+                tbl = oscap_talloc(struct oval_pdpool_tbl);
+                tbl->root   = oscap_strdup(root);
+                tbl->remote = oscap_strdup(pext->remote);
+                tbl->pdtbl  = pdtbl;
+                tbl->refs   = 0;
+                tbl->next   = __pdpool.tbls;
+                __pdpool.tbls = tbl;
+        }
+
+        ++tbl->refs;
+        pdtbl = tbl->pdtbl;
+
+        pthread_mutex_unlock(&__pdpool.lock);
+
+        return (pdtbl);
+}
+
+/* the probes used by the other sessions drop the results of the session */
+static void oval_pdpool_put(oval_pext_t *pext)
+{
+        struct oval_pdpool_tbl *tbl, **prev;
+        size_t i;
+
+        pthread_mutex_lock(&__pdpool.lock);
+
+        for (prev = &__pdpool.tbls; (tbl = *prev) != NULL; prev = &tbl->next) {
+                if (tbl->pdtbl == pext->pdtbl)
+                        break;
+        }
+
+        if (tbl == NULL) {
+                dE("The probes of the session aren't in the pool.");
+        } else if (--tbl->refs == 0) {
+                *prev = tbl->next;
+                oval_pdtbl_free(tbl->pdtbl);
+                oscap_free(tbl->root);
+                oscap_free(tbl->remote);
+                oscap_free(tbl);
+        } else {
+                for (i = 0; i < tbl->pdtbl->count; ++i)
+                        oval_probe_ext_reset(tbl->pdtbl->ctx, tbl->pdtbl->memb[i], pext);
+        }
+
+        pext->pdtbl = NULL;
+        pthread_mutex_unlock(&__pdpool.lock);
+}
+
+/* the session of the key of an object or a state cached by the probes */
+static oval_pext_t *oval_pdpool_pext(const SEXP_t *key)
+{
+        char buf[128], *k = buf, *ns_str;
+        unsigned long ns = 1;
+        oval_pext_t *pext = NULL;
+
+        if (SEXP_string_cstr_r(key, k, sizeof buf) == (size_t)-1)
+                k = SEXP_string_cstr(key);
+
+        if (k != NULL && (ns_str = strrchr(k, '@')) != NULL)
+                ns = strtoul(ns_str + 1, NULL, 10);
+
+        if (k != buf)
+                oscap_free(k);
+
+        pthread_mutex_lock(&__pdpool.lock);
+        if (ns > 0 && ns <= __pdpool.count)
+                pext = __pdpool.pexts[ns - 1];
+        pthread_mutex_unlock(&__pdpool.lock);
+
+        if (pext == NULL)
+                dE("No session for the namespace %lu.", ns);
+
+        return (pext);
+}
+
+/*
+ * The entities of the items of an object which the content reads
+ */
+struct oval_proj {
+        bool all;                      /**< any entity may be read */
+        struct oval_string_map *names; /**< names of the entities */
+        SEXP_t *list;                  /**< the same names, sent with the object */
+};
+
+static void oval_proj_free(struct oval_proj *proj)
+{
+        oval_string_map_free(proj->names, NULL);
+        SEXP_free(proj->list);
+        oscap_free(proj);
+}
+
+static struct oval_proj *oval_proj_get(struct oval_string_map *map, struct oval_object *object)
+{
+        struct oval_proj *proj;
+        char *id;
+
+        id   = oval_object_get_id(object);
+        proj = oval_string_map_get_value(map, id);
+
+        if (proj == NULL) {
+                proj = oscap_talloc(struct oval_proj);
+                proj->all   = false;
+                proj->names = oval_string_map_new();
+                proj->list  = SEXP_list_new(NULL);
+                oval_string_map_put(map, id, proj);
+        }
+
+        return (proj);
+}
+
+static void oval_proj_add(struct oval_proj *proj, char *name)
+{
+        SEXP_t *s_name;
+
+        if (name == NULL) {
+                proj->all = true;
+                return;
+        }
+        if (oval_string_map_get_value(proj->names, name) != NULL)
+                return;
+
+        oval_string_map_put(proj->names, name, proj);
+        SEXP_list_add(proj->list, s_name = SEXP_string_new(name, strlen(name)));
+        SEXP_free(s_name);
+}
+
+static void oval_proj_add_state(struct oval_proj *proj, struct oval_state *state)
+{
+        struct oval_state_content_iterator *cont_it;
+
+        if (state == NULL)
+                return;
+
+        cont_it = oval_state_get_contents(state);
+        while (oval_state_content_iterator_has_more(cont_it))
+                oval_proj_add(proj, oval_entity_get_name(oval_state_content_get_entity(oval_state_content_iterator_next(cont_it))));
+        oval_state_content_iterator_free(cont_it);
+}
+
+/* the items of the members of a set are read as the items of the set object */
+static void oval_proj_add_set(struct oval_string_map *map, struct oval_setobject *set)
+{
+        struct oval_setobject_iterator *subset_it;
+        struct oval_object_iterator *obj_it;
+
+        switch (oval_setobject_get_type(set)) {
+        case OVAL_SET_AGGREGATE:
+                subset_it = oval_setobject_get_subsets(set);
+                while (oval_setobject_iterator_has_more(subset_it))
+                        oval_proj_add_set(map, oval_setobject_iterator_next(subset_it));
+                oval_setobject_iterator_free(subset_it);
+                break;
+        case OVAL_SET_COLLECTIVE:
+                obj_it = oval_setobject_get_objects(set);
+                while (oval_object_iterator_has_more(obj_it))
+                        oval_proj_get(map, oval_object_iterator_next(obj_it))->all = true;
+                oval_object_iterator_free(obj_it);
+                break;
+        default:
+                break;
+        }
+}
+
+static void oval_proj_add_component(struct oval_string_map *map, struct oval_component *component)
+{
+        struct oval_component_iterator *cmp_it;
+        struct oval_object *object;
+
+        if (component == NULL)
+                return;
+
+        switch (oval_component_get_type(component)) {
+        case OVAL_COMPONENT_OBJECTREF:
+                object = oval_component_get_object(component);
+                if (object != NULL)
+                        oval_proj_add(oval_proj_get(map, object), oval_component_get_item_field(component));
+                break;
+        case OVAL_FUNCTION_ARITHMETIC:
+        case OVAL_FUNCTION_BEGIN:
+        case OVAL_FUNCTION_CONCAT:
+        case OVAL_FUNCTION_END:
+        case OVAL_FUNCTION_ESCAPE_REGEX:
+        case OVAL_FUNCTION_REGEX_CAPTURE:
+        case OVAL_FUNCTION_SPLIT:
+        case OVAL_FUNCTION_SUBSTRING:
+        case OVAL_FUNCTION_TIMEDIF:
+        case OVAL_FUNCTION_UNIQUE:
+        case OVAL_FUNCTION_COUNT:
+        case OVAL_FUNCTION_GLOB_TO_REGEX:
+                cmp_it = oval_component_get_function_components(component);
+                while (oval_component_iterator_has_more(cmp_it))
+                        oval_proj_add_component(map, oval_component_iterator_next(cmp_it));
+                oval_component_iterator_free(cmp_it);
+                break;
+        default:
+                break;
+        }
+}
+
+static struct oval_string_map *oval_proj_build(struct oval_definition_model *model)
+{
+        struct oval_string_map *map;
+        struct oval_test_iterator *tst_it;
+        struct oval_object_iterator *obj_it;
+        struct oval_variable_iterator *var_it;
+        struct oval_object_content_iterator *cont_it;
+        struct oval_state_iterator *ste_it;
+
+        map = oval_string_map_new();
+
+        if (model == NULL)
+                return (map);
+
+        tst_it = oval_definition_model_get_tests(model);
+        while (oval_test_iterator_has_more(tst_it)) {
+                struct oval_test *test = oval_test_iterator_next(tst_it);
+                struct oval_object *object = oval_test_get_object(test);
+                struct oval_proj *proj;
+
+                if (object == NULL)
+                        continue;
+
+                proj   = oval_proj_get(map, object);
+                ste_it = oval_test_get_states(test);
+                while (oval_state_iterator_has_more(ste_it))
+                        oval_proj_add_state(proj, oval_state_iterator_next(ste_it));
+                oval_state_iterator_free(ste_it);
+        }
+        oval_test_iterator_free(tst_it);
+
+        obj_it = oval_definition_model_get_objects(model);
+        while (oval_object_iterator_has_more(obj_it)) {
+                struct oval_object *object = oval_object_iterator_next(obj_it);
+
+                cont_it = oval_object_get_object_contents(object);
+                while (oval_object_content_iterator_has_more(cont_it)) {
+                        struct oval_object_content *content = oval_object_content_iterator_next(cont_it);
+
+                        switch (oval_object_content_get_type(content)) {
+                        case OVAL_OBJECTCONTENT_FILTER:
+                                oval_proj_add_state(oval_proj_get(map, object),
+                                                    oval_filter_get_state(oval_object_content_get_filter(content)));
+                                break;
+                        case OVAL_OBJECTCONTENT_SET:
+                                oval_proj_add_set(map, oval_object_content_get_setobject(content));
+                                break;
+                        default:
+                                break;
+                        }
+                }
+                oval_object_content_iterator_free(cont_it);
+        }
+        oval_object_iterator_free(obj_it);
+
+        var_it = oval_definition_model_get_variables(model);
+        while (oval_variable_iterator_has_more(var_it)) {
+                struct oval_variable *variable = oval_variable_iterator_next(var_it);
+
+                if (oval_variable_get_type(variable) == OVAL_VARIABLE_LOCAL)
+                        oval_proj_add_component(map, oval_variable_get_component(variable));
+        }
+        oval_variable_iterator_free(var_it);
+
+        return (map);
+}
+
+SEXP_t *oval_probe_ext_projection(oval_pext_t *pext, struct oval_object *object)
+{
+        struct oval_proj *proj;
+        SEXP_t *list = NULL;
+
+        if (!pext->project)
+                return (NULL);
+
+        pthread_mutex_lock(&pext->lock);
+
+        if (pext->proj == NULL)
+                pext->proj = oval_proj_build(oval_syschar_model_get_definition_model(*pext->model));
+
+        proj = oval_string_map_get_value(pext->proj, oval_object_get_id(object));
+        if (proj != NULL && !proj->all)
+                list = SEXP_ref(proj->list);
+
+        pthread_mutex_unlock(&pext->lock);
+
+        return (list);
+}
 
 /*
  * oval_pext_
@@ -75,13 +439,34 @@ oval_pext_t *oval_pext_new(void)
         if (pext->probe_dir == NULL)
                 pext->probe_dir = OVAL_PROBE_DIR;
 
+        pext->remote = getenv(OVAL_PROBE_SSH_ENV);
+        if (pext->remote != NULL && *pext->remote == '\0')
+                pext->remote = NULL;
+
         pext->pdtbl     = NULL;
         pext->pdsc      = NULL;
         pext->pdsc_cnt  = 0;
+        pext->content   = oval_string_map_new();
+        pext->project   = getenv(OVAL_PROBE_PROJECTION_ENV) != NULL;
+        pext->proj      = NULL;
+
+        oval_pdpool_register(pext);
 
         return(pext);
 }
 
+/*
+ * The probes of a remote host are started by ssh from the same directory
+ * on the remote host, the objects are still evaluated here.
+ */
+static size_t oval_pext_probe_uri(oval_pext_t *pext, oval_pdsc_t *probe_dsc, char *uri, size_t urisize)
+{
+        if (pext->remote != NULL)
+                return snprintf(uri, urisize, "ssh://%s%s/%s", pext->remote, pext->probe_dir, probe_dsc->file);
+
+        return snprintf(uri, urisize, "%s://%s/%s", OVAL_PROBE_SCHEME, pext->probe_dir, probe_dsc->file);
+}
+
 void oval_pext_free(oval_pext_t *pext)
 {
         if (!pext->do_init) {
@@ -89,13 +474,72 @@ void oval_pext_free(oval_pext_t *pext)
 		oscap_free(pext->pdsc);
 		pext->pdsc     = NULL;
 		pext->pdsc_cnt = 0;
-                oval_pdtbl_free(pext->pdtbl);
+                oval_pdpool_put(pext);
         }
 
+        oval_pdpool_unregister(pext);
+        oval_string_map_free(pext->content, NULL);
+        if (pext->proj != NULL)
+                oval_string_map_free(pext->proj, (oscap_destruct_func)oval_proj_free);
         pthread_mutex_destroy(&pext->lock);
         oscap_free(pext);
 }
 
+bool oval_probe_ext_content_reuse(oval_pext_t *pext, const char *key, struct oval_syschar *syschar)
+{
+	struct oval_syschar *src;
+	struct oval_sysitem_iterator *items;
+	struct oval_message_iterator *msgs;
+
+	if (key == NULL)
+		return false;
+
+	pthread_mutex_lock(&pext->lock);
+	src = oval_string_map_get_value(pext->content, key);
+	pthread_mutex_unlock(&pext->lock);
+
+	/* the items of the source may have been released */
+	if (src == NULL || src == syschar || oval_syschar_get_flag(src) == SYSCHAR_FLAG_UNKNOWN)
+		return false;
+
+	dI("Object '%s' has the same content as '%s', reusing its items.",
+	   oval_syschar_get_id(syschar), oval_syschar_get_id(src));
+
+	/* the items are owned by the model */
+	items = oval_syschar_get_sysitem(src);
+	while (oval_sysitem_iterator_has_more(items))
+		oval_syschar_add_sysitem(syschar, oval_sysitem_iterator_next(items));
+	oval_sysitem_iterator_free(items);
+
+	msgs = oval_syschar_get_messages(src);
+	while (oval_message_iterator_has_more(msgs))
+		oval_syschar_add_message(syschar, oval_message_clone(oval_message_iterator_next(msgs)));
+	oval_message_iterator_free(msgs);
+
+	oval_syschar_set_flag(syschar, oval_syschar_get_flag(src));
+	oval_probe_stats_shared(pext->stats, oval_syschar_get_object(syschar));
+
+	return true;
+}
+
+void oval_probe_ext_content_add(oval_pext_t *pext, const char *key, struct oval_syschar *syschar)
+{
+	oval_syschar_collection_flag_t flag;
+
+	if (key == NULL)
+		return;
+
+	/* a failure may be temporary, e.g. a probe crashed */
+	flag = oval_syschar_get_flag(syschar);
+	if (flag == SYSCHAR_FLAG_UNKNOWN || flag == SYSCHAR_FLAG_ERROR)
+		return;
+
+	pthread_mutex_lock(&pext->lock);
+	if (oval_string_map_get_value(pext->content, key) == NULL)
+		oval_string_map_put(pext->content, key, syschar);
+	pthread_mutex_unlock(&pext->lock);
+}
+
 /*
  * oval_pdtbl_
  */
@@ -111,17 +555,28 @@ static oval_pdtbl_t *oval_pdtbl_new(void)
 	return (p_tbl);
 }
 
-static void oval_pdtbl_free(oval_pdtbl_t *tbl)
+/* close all the probes, they are started again when used */
+static void oval_pdtbl_clear(oval_pdtbl_t *tbl)
 {
         register size_t i;
 
         for (i = 0; i < tbl->count; ++i) {
                 SEAP_close(tbl->ctx, tbl->memb[i]->sd);
+                oval_pd_replies_flush(tbl->memb[i]);
+                while (tbl->memb[i]->streams != NULL)
+                        oval_pd_stream_del(tbl->memb[i], NULL);
                 oscap_free(tbl->memb[i]->uri);
 		oscap_free(tbl->memb[i]);
         }
 
         oscap_free(tbl->memb);
+        tbl->memb  = NULL;
+        tbl->count = 0;
+}
+
+static void oval_pdtbl_free(oval_pdtbl_t *tbl)
+{
+        oval_pdtbl_clear(tbl);
         SEAP_CTX_free(tbl->ctx);
         oscap_free(tbl);
 
@@ -142,6 +597,38 @@ static int oval_pdtbl_typecmp(oval_subtype_t *a, oval_pd_t **b)
         return (*a - (*b)->subtype);
 }
 
+/* the timeout of the objects of the type, see OVAL_PROBE_TIMEOUT_ENV */
+static uint32_t oval_pd_timeout(oval_subtype_t type)
+{
+	const char *tok, *eq;
+	char name[64];
+	uint32_t timeout = 0;
+	size_t len;
+
+	tok = getenv(OVAL_PROBE_TIMEOUT_ENV);
+
+	while (tok != NULL && *tok != '\0') {
+		len = strcspn(tok, ",");
+		eq  = memchr(tok, '=', len);
+
+		if (eq == NULL) {
+			timeout = (uint32_t)strtoul(tok, NULL, 10);
+		} else if ((size_t)(eq - tok) < sizeof name) {
+			memcpy(name, tok, eq - tok);
+			name[eq - tok] = '\0';
+
+			if (oval_str_to_subtype(name) == type)
+				return ((uint32_t)strtoul(eq + 1, NULL, 10));
+		}
+
+		tok += len;
+		if (*tok == ',')
+			++tok;
+	}
+
+	return (timeout);
+}
+
 static int oval_pdtbl_add(oval_pdtbl_t *tbl, oval_subtype_t type, int sd, const char *uri)
 {
 	oval_pd_t *pd;
@@ -153,6 +640,11 @@ static int oval_pdtbl_add(oval_pdtbl_t *tbl, oval_subtype_t type, int sd, const
 	pd->subtype = type;
 	pd->sd      = sd;
 	pd->uri     = strdup(uri);
+	pd->replies = NULL;
+	pd->streams = NULL;
+	pd->gen     = 0;
+	pd->timeout = oval_pd_timeout(type);
+	pd->streaming = false;
 
 	tbl->memb = oscap_realloc(tbl->memb, sizeof(oval_pd_t *) * (++tbl->count));
 
@@ -176,26 +668,229 @@ static oval_pd_t *oval_pdtbl_get(oval_pdtbl_t * tbl, oval_subtype_t type)
 	return (pdp == NULL ? NULL : *pdp);
 }
 
+/*
+ * oval_pd_
+ *
+ * More than one request may be outstanding on a probe descriptor, so the
+ * replies are matched to the requests by their reply-id attribute. A reply
+ * which belongs to a different request than the one being waited for is
+ * kept in the descriptor until its request is collected.
+ */
+struct oval_pdreply {
+	SEAP_msgid_t         id;
+	SEAP_msg_t          *msg;
+	struct oval_pdreply *next;
+};
+
+static void oval_pd_replies_flush(oval_pd_t *pd)
+{
+	struct oval_pdreply *r;
+
+	while ((r = pd->replies) != NULL) {
+		pd->replies = r->next;
+		SEAP_msg_free(r->msg);
+		oscap_free(r);
+	}
+}
+
+static SEAP_msg_t *oval_pd_reply_take(oval_pd_t *pd, SEAP_msgid_t id)
+{
+	struct oval_pdreply **rp, *r;
+	SEAP_msg_t *msg;
+
+	for (rp = &pd->replies; *rp != NULL; rp = &(*rp)->next) {
+		if ((*rp)->id == id) {
+			r   = *rp;
+			msg = r->msg;
+			*rp = r->next;
+			oscap_free(r);
+
+			return (msg);
+		}
+	}
+
+	return (NULL);
+}
+
+static void oval_pd_reply_put(oval_pd_t *pd, SEAP_msgid_t id, SEAP_msg_t *msg)
+{
+	struct oval_pdreply *r;
+
+	r = oscap_talloc(struct oval_pdreply);
+	r->id   = id;
+	r->msg  = msg;
+	r->next = pd->replies;
+	pd->replies = r;
+}
+
+/*
+ * The items of a reply are converted while the reply is being received if
+ * a stream was added for its request. The streams are matched by the id
+ * of the request and the generation of the connection it was sent on,
+ * message ids start from zero again on a new connection.
+ */
+struct oval_pdstream {
+	SEAP_msgid_t             id;
+	uint32_t                 gen;
+	struct oval_sexp_stream *stream;
+	struct oval_pdstream    *next;
+};
+
+static int oval_pd_stream_item(SEAP_msgid_t reply_id, SEXP_t *item, void *arg)
+{
+	oval_pd_t *pd = (oval_pd_t *)arg;
+	struct oval_pdstream *s;
+
+	for (s = pd->streams; s != NULL; s = s->next) {
+		if (s->id == reply_id && s->gen == pd->gen) {
+			oval_sexp_stream_add(s->stream, item);
+			return (1);
+		}
+	}
+
+	return (0);
+}
+
+static void oval_pd_stream_add(oval_pd_t *pd, SEAP_msgid_t id, struct oval_sexp_stream *stream)
+{
+	struct oval_pdstream *s;
+
+	s = oscap_talloc(struct oval_pdstream);
+	s->id     = id;
+	s->gen    = pd->gen;
+	s->stream = stream;
+	s->next   = pd->streams;
+	pd->streams = s;
+}
+
+/* remove `stream', or the first one if NULL */
+static void oval_pd_stream_del(oval_pd_t *pd, struct oval_sexp_stream *stream)
+{
+	struct oval_pdstream **sp, *s;
+
+	for (sp = &pd->streams; *sp != NULL; sp = &(*sp)->next) {
+		if (stream == NULL || (*sp)->stream == stream) {
+			s   = *sp;
+			*sp = s->next;
+			oscap_free(s);
+
+			return;
+		}
+	}
+}
+
+static int oval_pd_connect(SEAP_CTX_t *ctx, oval_pd_t *pd)
+{
+	/* the items of a collected object, see probe_cobj_new */
+	static const uint32_t items_path[] = { 3 };
+
+	struct oscap_trace_span span;
+
+	oval_pd_replies_flush(pd);
+	oscap_trace_begin(&span, "probe_connect");
+	pd->sd = SEAP_connect(ctx, pd->uri, 0);
+	oscap_trace_end(&span, pd->uri);
+	++pd->gen;
+
+	if (pd->sd < 0) {
+		pd->sd = -1;
+		return (-1);
+	}
+
+	pd->streaming = SEAP_msgstream_set(ctx, pd->sd, items_path, 1, &oval_pd_stream_item, pd) == 0;
+
+	if (!pd->streaming)
+		dW("Can't set up streaming of replies on sd=%d: %u, %s.", pd->sd, errno, strerror(errno));
+
+	return (0);
+}
+
+/*
+ * Wait for the reply to the message `id'. If the probe reported an error
+ * for the message, -1 is returned, errno is set to ECANCELED and the error
+ * is stored at `*out_err'.
+ */
+static int oval_pd_recv(SEAP_CTX_t *ctx, oval_pd_t *pd, SEAP_msgid_t id, SEAP_msg_t **out_msg, SEAP_err_t **out_err)
+{
+	SEAP_msg_t *msg;
+	SEXP_t     *rid;
+	uint64_t    rid_u;
+
+	*out_msg = NULL;
+	*out_err = NULL;
+
+	for (;;) {
+		if ((*out_msg = oval_pd_reply_take(pd, id)) != NULL)
+			return (0);
+
+		switch (SEAP_recverr_byid(ctx, pd->sd, out_err, id)) {
+		case 0:
+			errno = ECANCELED;
+			return (-1);
+		case -1:
+			return (-1);
+		}
+
+		msg = NULL;
+
+		if (SEAP_recvmsg(ctx, pd->sd, &msg) != 0) {
+			/*
+			 * An error packet was queued by SEAP_recvmsg. It's
+			 * checked against `id' at the beginning of the loop.
+			 */
+			if (errno == ECANCELED)
+				continue;
+
+			return (-1);
+		}
+
+		rid = SEAP_msgattr_get(msg, "reply-id");
+
+		if (rid == NULL || !SEXP_numberp(rid)) {
+			dW("Dropping a message without a reply-id from sd=%d", pd->sd);
+			SEXP_free(rid);
+			SEAP_msg_free(msg);
+			continue;
+		}
+
+		rid_u = SEXP_number_getu_64(rid);
+		SEXP_free(rid);
+
+		/* the items of a chunk were converted as it was received */
+		if (SEAP_msgattr_exists(msg, "chunk")) {
+			dD("Dropping a chunk of the reply to msg #%"PRIu64" on sd=%d", rid_u, pd->sd);
+			SEAP_msg_free(msg);
+			continue;
+		}
+
+		if (rid_u == (uint64_t)id) {
+			*out_msg = msg;
+			return (0);
+		}
+
+		dD("Keeping reply to msg #%"PRIu64" on sd=%d", rid_u, pd->sd);
+		oval_pd_reply_put(pd, (SEAP_msgid_t)rid_u, msg);
+	}
+}
+
 /*
  * oval_probe_cmd_
  */
 static SEXP_t *oval_probe_cmd_obj_eval(SEXP_t *sexp, void *arg);
 static SEXP_t *oval_probe_cmd_ste_fetch(SEXP_t *sexp, void *arg);
-static int     oval_probe_cmd_init(oval_pext_t *pext);
 
-static int oval_probe_cmd_init(oval_pext_t *pext)
+/* the session of each command is found by the namespace of the ids */
+static int oval_probe_cmd_init(SEAP_CTX_t *ctx)
 {
-        assume_d (pext != NULL, -1);
+        assume_d (ctx != NULL, -1);
 
-	if (SEAP_cmd_register(pext->pdtbl->ctx, PROBECMD_OBJ_EVAL, SEAP_CMDREG_USEARG,
-                              &oval_probe_cmd_obj_eval, (void *)pext) != 0)
+	if (SEAP_cmd_register(ctx, PROBECMD_OBJ_EVAL, 0, &oval_probe_cmd_obj_eval) != 0)
         {
 		dE("Can't register command: %s: errno=%u, %s.", "obj_eval", errno, strerror(errno));
 		return (-1);
 	}
 
-	if (SEAP_cmd_register(pext->pdtbl->ctx, PROBECMD_STE_FETCH, SEAP_CMDREG_USEARG,
-			      &oval_probe_cmd_ste_fetch, (void *)pext) != 0) {
+	if (SEAP_cmd_register(ctx, PROBECMD_STE_FETCH, 0, &oval_probe_cmd_ste_fetch) != 0) {
 		dE("Can't register command: %s: errno=%u, %s.", "ste_fetch", errno, strerror(errno));
 
 		/* FIXME: unregister the first command */
@@ -206,25 +901,36 @@ static int oval_probe_cmd_init(oval_pext_t *pext)
 	return (0);
 }
 
-static SEXP_t *oval_probe_cmd_obj_eval(SEXP_t *sexp, void *arg)
+/* the id of the object or state cached by the probes under the key, see oval_cache_key_to_sexp */
+static char *oval_probe_ext_cache_id(const SEXP_t *key)
 {
+	char *id, *instance;
+
+	id = SEXP_string_cstr(key);
+	if (id != NULL && (instance = strpbrk(id, "#@")) != NULL)
+		*instance = '\0';
+	return id;
+}
+
+static SEXP_t *oval_probe_cmd_obj_eval1(SEXP_t *sexp)
+{
+	oval_pext_t *pext;
 	char *id_str;
 	struct oval_definition_model *defs;
 	struct oval_object  *obj;
 	struct oval_syschar *res;
-	oval_pext_t *pext = (oval_pext_t *) arg;
 	SEXP_t *ret, *ret_code;
 	int r;
 
-        assume_d (sexp != NULL, NULL);
-        assume_d (arg  != NULL, NULL);
-
 	if (!SEXP_stringp(sexp)) {
 		dE("Invalid argument: type=%s.", SEXP_strtype(sexp));
 		return (NULL);
 	}
 
-	id_str = SEXP_string_cstr(sexp);
+	if ((pext = oval_pdpool_pext(sexp)) == NULL)
+		return (NULL);
+
+	id_str = oval_probe_ext_cache_id(sexp);
 	defs   = oval_syschar_model_get_definition_model(*(pext->model));
 	obj    = oval_definition_model_get_object(defs, id_str);
 	ret    = SEXP_list_new (sexp, NULL);
@@ -264,23 +970,60 @@ static SEXP_t *oval_probe_cmd_obj_eval(SEXP_t *sexp, void *arg)
 	return (ret);
 }
 
+/*
+ * The argument is the id of an object or a list of ids evaluated in one
+ * round-trip. The reply is (id flag) or a list of those in the order of
+ * the ids.
+ */
+static SEXP_t *oval_probe_cmd_obj_eval(SEXP_t *sexp, void *arg)
+{
+	SEXP_t *id, *res, *res_list;
+
+        assume_d (sexp != NULL, NULL);
+
+	if (!SEXP_listp(sexp))
+		return oval_probe_cmd_obj_eval1(sexp);
+
+	res_list = SEXP_list_new(NULL);
+
+	SEXP_list_foreach(id, sexp) {
+		if ((res = oval_probe_cmd_obj_eval1(id)) == NULL) {
+			SEXP_list_free(res_list);
+			SEXP_free(id);
+
+			return (NULL);
+		}
+
+		SEXP_list_add(res_list, res);
+		SEXP_free(res);
+	}
+
+	return (res_list);
+}
+
 static SEXP_t *oval_probe_cmd_ste_fetch(SEXP_t *sexp, void *arg)
 {
 	SEXP_t *id, *ste_list, *ste_sexp;
 	char *id_str;
 	struct oval_state *ste;
 	struct oval_definition_model *definition_model;
-	oval_pext_t *pext = (oval_pext_t *)arg;
+	oval_pext_t *pext;
 	int ret;
 
         assume_d (sexp != NULL, NULL);
-        assume_d (arg  != NULL, NULL);
 
 	ste_list = SEXP_list_new(NULL);
 
 	SEXP_list_foreach(id, sexp) {
 		if (SEXP_stringp(id)) {
-			id_str = SEXP_string_cstr(id);
+			if ((pext = oval_pdpool_pext(id)) == NULL) {
+				SEXP_list_free(ste_list);
+				SEXP_free(id);
+
+				return (NULL);
+			}
+
+			id_str = oval_probe_ext_cache_id(id);
 			definition_model = oval_syschar_model_get_definition_model(*(pext->model));
 			ste = oval_definition_model_get_state(definition_model, id_str);
 
@@ -293,7 +1036,7 @@ static SEXP_t *oval_probe_cmd_ste_fetch(SEXP_t *sexp, void *arg)
 				return (NULL);
 			}
 
-			ret = oval_state_to_sexp(pext->sess_ptr, ste, &ste_sexp);
+			ret = oval_state_to_sexp(pext->sess_ptr, ste, id, &ste_sexp);
 			if (ret !=0) {
 				dE("Failed to convert OVAL state to SEXP, id: %s.",
 					       id_str);
@@ -359,28 +1102,17 @@ static inline const char *_probe_strerror(uint32_t error_code)
 	return codemsg;
 }
 
-static inline int _handle_SEAP_receive_failure(SEAP_CTX_t *ctx, oval_pd_t *pd, SEAP_msg_t *s_omsg, int flags)
+static inline int _handle_SEAP_receive_failure(SEAP_CTX_t *ctx, oval_pd_t *pd, SEAP_msg_t *s_omsg, SEAP_err_t *err, int flags)
 {
 	protect_errno {
 		dW("Can't receive message: %u, %s.", errno, strerror(errno));
 	}
 
 	if (errno == ECANCELED) {
-		SEAP_err_t *err = NULL;
-
-		switch(SEAP_recverr_byid(ctx, pd->sd, &err,
-					 SEAP_msg_id(s_omsg)))
-		{
-		case  0:
-			break;
-		case  1: /* no error found */
-			dE("Internal error: An error was signaled on sd=%d but the error queue is empty.");
+		if (err == NULL) {
+			dE("Internal error: An error was signaled on sd=%d but no error was received.", pd->sd);
 			oscap_seterr(OSCAP_EFAMILY_OVAL, "SEAP_recverr_byid: internal error: empty error queue.");
 			return (-1);
-		case -1: /* internal error */
-			dE("Internal error: SEAP_recverr_byid returned -1");
-			oscap_seterr(OSCAP_EFAMILY_OVAL, "SEAP_recverr_byid: internal error.");
-			return (-1);
 		}
 
 		/*
@@ -427,14 +1159,21 @@ static inline int _handle_SEAP_receive_failure(SEAP_CTX_t *ctx, oval_pd_t *pd, S
 	}
 
 	pd->sd = -1;
+	oval_pd_replies_flush(pd);
 	return (-1);
 }
 
-static int oval_probe_comm(SEAP_CTX_t *ctx, oval_pd_t *pd, const SEXP_t *s_iobj, int flags, SEXP_t **out_sexp)
+/*
+ * If `stream' isn't NULL the items of the reply are converted by it while
+ * the reply is being received.
+ */
+static int _oval_probe_comm(SEAP_CTX_t *ctx, oval_pd_t *pd, const SEXP_t *s_iobj, int flags,
+			    struct oval_sexp_stream *stream, SEXP_t **out_sexp)
 {
 	int retry, ret;
 
 	SEAP_msg_t *s_imsg, *s_omsg;
+	SEAP_err_t *s_err;
 	SEXP_t *s_oobj;
 
 	assume_d (pd != NULL, -1);
@@ -447,9 +1186,7 @@ static int oval_probe_comm(SEAP_CTX_t *ctx, oval_pd_t *pd, const SEXP_t *s_iobj,
 		 * by the probe context handling functions.
 		 */
 		if (pd->sd == -1) {
-			pd->sd = SEAP_connect(ctx, pd->uri, 0);
-
-			if (pd->sd < 0) {
+			if (oval_pd_connect(ctx, pd) != 0) {
                                 protect_errno {
                                         dW("Can't connect: %u, %s.", errno, strerror(errno));
                                 }
@@ -490,6 +1227,28 @@ static int oval_probe_comm(SEAP_CTX_t *ctx, oval_pd_t *pd, const SEXP_t *s_iobj,
 			}
 		}
 
+		/* the items are sent in chunks as they are collected, see probe/chunk.h */
+		if (stream != NULL && pd->streaming && !(flags & OVAL_PDFLAG_NOREPLY)
+		    && SEAP_msgattr_set(s_omsg, "chunked", NULL) != 0) {
+			SEAP_msg_free(s_omsg);
+			oscap_seterr(OSCAP_EFAMILY_OVAL, "OVAL_EPROBEUNKNOWN");
+			return (-1);
+		}
+
+		/* the probe stops the collection at the deadline */
+		if (pd->timeout > 0) {
+			SEXP_t *s_timeout = SEXP_number_newu_32(pd->timeout);
+
+			ret = SEAP_msgattr_set(s_omsg, "timeout", s_timeout);
+			SEXP_free(s_timeout);
+
+			if (ret != 0) {
+				SEAP_msg_free(s_omsg);
+				oscap_seterr(OSCAP_EFAMILY_OVAL, "OVAL_EPROBEUNKNOWN");
+				return (-1);
+			}
+		}
+
 		dD("Sending message.");
 
 		ret = SEAP_sendmsg(ctx, pd->sd, s_omsg);
@@ -551,13 +1310,22 @@ static int oval_probe_comm(SEAP_CTX_t *ctx, oval_pd_t *pd, const SEXP_t *s_iobj,
 
 		dD("Waiting for reply.");
 
+		if (stream != NULL)
+			oval_pd_stream_add(pd, SEAP_msg_id(s_omsg), stream);
+
 		/* recv_retry: */
-		s_imsg = NULL;
+		ret = oval_pd_recv(ctx, pd, SEAP_msg_id(s_omsg), &s_imsg, &s_err);
+
+		if (stream != NULL)
+			oval_pd_stream_del(pd, stream);
 
-		ret = SEAP_recvmsg(ctx, pd->sd, &s_imsg);
 		if (ret != 0) {
 			protect_errno {
-				ret = _handle_SEAP_receive_failure(ctx, pd, s_omsg, flags);
+				/* the items of a lost reply */
+				if (stream != NULL)
+					oval_sexp_stream_reset(stream);
+
+				ret = _handle_SEAP_receive_failure(ctx, pd, s_omsg, s_err, flags);
 				SEAP_msg_free(s_imsg);
 				SEAP_msg_free(s_omsg);
 			}
@@ -596,6 +1364,28 @@ static int oval_probe_comm(SEAP_CTX_t *ctx, oval_pd_t *pd, const SEXP_t *s_iobj,
 	return (0);
 }
 
+static int oval_probe_comm(SEAP_CTX_t *ctx, oval_pd_t *pd, const SEXP_t *s_iobj, int flags,
+			   struct oval_sexp_stream *stream, SEXP_t **out_sexp)
+{
+	struct oscap_trace_span span;
+	char id[128] = "";
+	int ret;
+
+	oscap_trace_begin(&span, "oval_probe_comm");
+	ret = _oval_probe_comm(ctx, pd, s_iobj, flags, stream, out_sexp);
+
+	if (span.name != NULL) {
+		SEXP_t *s_id = probe_obj_getattrval(s_iobj, "id");
+
+		if (s_id != NULL)
+			SEXP_string_cstr_r(s_id, id, sizeof id);
+		SEXP_free(s_id);
+	}
+	oscap_trace_end(&span, id);
+
+	return (ret);
+}
+
 static int oval_pdsc_typecmp(oval_subtype_t *a, oval_pdsc_t *b)
 {
         return (*a - b->type);
@@ -637,7 +1427,7 @@ static int oval_probe_sys_eval(SEAP_CTX_t *ctx, oval_pd_t *pd, struct oval_sysch
                 SEXP_free (r0);
         }
 
-        ret = oval_probe_comm(ctx, pd, s_obj, 0, &r0);
+        ret = oval_probe_comm(ctx, pd, s_obj, 0, NULL, &r0);
         SEXP_free(s_obj);
 
 	if (ret != 0)
@@ -774,10 +1564,8 @@ int oval_probe_sys_handler(oval_subtype_t type, void *ptr, int act, ...)
         {
                 char         probe_uri[PATH_MAX + 1];
                 size_t       probe_urilen;
-                char        *probe_dir;
                 oval_pdsc_t *probe_dsc;
 
-                probe_dir = pext->probe_dir;
                 probe_dsc = oval_pdsc_lookup(pext->pdsc, pext->pdsc_cnt, type);
 
 		if (probe_dsc == NULL) {
@@ -787,21 +1575,26 @@ int oval_probe_sys_handler(oval_subtype_t type, void *ptr, int act, ...)
 			break;
 		}
 
-                probe_urilen = snprintf(probe_uri, sizeof probe_uri,
-                                        "%s://%s/%s", OVAL_PROBE_SCHEME, probe_dir, probe_dsc->file);
+                probe_urilen = oval_pext_probe_uri(pext, probe_dsc, probe_uri, sizeof probe_uri);
 
                 if (probe_urilen >= sizeof probe_uri) {
                         oscap_seterr (OSCAP_EFAMILY_GLIBC, "probe URI too long");
 
                         ret = -1;
                 } else {
-                        dI("Starting probe on URI '%s'.", probe_uri);
+                        pthread_mutex_lock(&__pdpool.lock);
+
+                        if (oval_pdtbl_get(pext->pdtbl, type) == NULL) {
+                                dI("Starting probe on URI '%s'.", probe_uri);
 
-                        if (oval_pdtbl_add(pext->pdtbl, type, -1, probe_uri) != 0) {
-                                oscap_seterr (OSCAP_EFAMILY_OVAL, "%s probe not supported", probe_dsc->name);
+                                if (oval_pdtbl_add(pext->pdtbl, type, -1, probe_uri) != 0) {
+                                        oscap_seterr (OSCAP_EFAMILY_OVAL, "%s probe not supported", probe_dsc->name);
 
-                                ret = -1;
+                                        ret = -1;
+                                }
                         }
+
+                        pthread_mutex_unlock(&__pdpool.lock);
                 }
                 break;
         }
@@ -817,6 +1610,105 @@ int oval_probe_sys_handler(oval_subtype_t type, void *ptr, int act, ...)
         return(ret);
 }
 
+/*
+ * Find the probe descriptor for the object of `sys', creating it when the
+ * probe is used for the first time. Returns 1 if the object isn't supported
+ * (the syschar is flagged accordingly) and -1 on error.
+ */
+/* 1 if there is no probe for the type */
+static int oval_probe_ext_typepd(oval_pext_t *pext, oval_subtype_t type, oval_pd_t **out_pd)
+{
+	oval_pd_t *pd;
+
+	/* the table is shared with the other sessions */
+	pthread_mutex_lock(&__pdpool.lock);
+	pd  = oval_pdtbl_get(pext->pdtbl, type);
+	pthread_mutex_unlock(&__pdpool.lock);
+
+	if (pd == NULL) {
+		char         probe_uri[PATH_MAX + 1];
+		size_t       probe_urilen;
+		oval_pdsc_t *probe_dsc;
+
+		probe_dsc = oval_pdsc_lookup(pext->pdsc, pext->pdsc_cnt, type);
+
+		if (probe_dsc == NULL)
+			return (1);
+
+		probe_urilen = oval_pext_probe_uri(pext, probe_dsc, probe_uri, sizeof probe_uri);
+
+		if (probe_urilen >= sizeof probe_uri) {
+			oscap_seterr (OSCAP_EFAMILY_GLIBC, "probe URI too long");
+			return (-1);
+		}
+
+		pthread_mutex_lock(&__pdpool.lock);
+
+		/* another session may have added it meanwhile */
+		if (oval_pdtbl_get(pext->pdtbl, type) == NULL) {
+			dI("Starting probe on URI '%s'.", probe_uri);
+
+			if (oval_pdtbl_add(pext->pdtbl, type, -1, probe_uri) != 0) {
+				pthread_mutex_unlock(&__pdpool.lock);
+				return (1);
+			}
+		}
+
+		pd = oval_pdtbl_get(pext->pdtbl, type);
+		pthread_mutex_unlock(&__pdpool.lock);
+
+		if (pd == NULL) {
+			oscap_seterr (OSCAP_EFAMILY_OVAL, "internal error");
+			return (-1);
+		}
+	}
+
+	*out_pd = pd;
+	return (0);
+}
+
+static int oval_probe_ext_getpd(oval_pext_t *pext, struct oval_syschar *sys, oval_pd_t **out_pd)
+{
+	int ret;
+
+	ret = oval_probe_ext_typepd(pext, oval_object_get_subtype(oval_syschar_get_object(sys)), out_pd);
+
+	if (ret == 1) {
+		oval_syschar_add_new_message(sys, "OVAL object not supported", OVAL_MESSAGE_LEVEL_WARNING);
+		oval_syschar_set_flag(sys, SYSCHAR_FLAG_NOT_COLLECTED);
+	}
+
+	return (ret);
+}
+
+/*
+ * The probes initialize themselves (probe_init) as soon as they are
+ * executed, so the ones started here get ready in parallel, while the
+ * library goes on with the content.
+ */
+void oval_probe_ext_prestart(oval_pext_t *pext, const oval_subtype_t types[], size_t count)
+{
+	oval_pd_t *pd;
+	size_t i, started = 0;
+
+	if (pext->do_init && oval_probe_ext_init(pext) != 0)
+		return;
+
+	for (i = 0; i < count; ++i) {
+		if (oval_probe_ext_typepd(pext, types[i], &pd) != 0 || pd->sd != -1)
+			continue;
+
+		if (oval_pd_connect(pext->pdtbl->ctx, pd) != 0) {
+			dW("Can't start the %s probe: %u, %s.", oval_subtype_to_str(types[i]), errno, strerror(errno));
+			continue;
+		}
+
+		++started;
+	}
+
+	dI("Started %zu of %zu probes in advance.", started, count);
+}
+
 int oval_probe_ext_handler(oval_subtype_t type, void *ptr, int act, ...)
 {
         int          ret = 0;
@@ -829,57 +1721,17 @@ int oval_probe_ext_handler(oval_subtype_t type, void *ptr, int act, ...)
         switch(act) {
         case PROBE_HANDLER_ACT_EVAL:
         {
-		struct oval_object *obj;
 		struct oval_syschar *sys;
 		int flags;
 
 		sys = va_arg(ap, struct oval_syschar *);
 		flags = va_arg(ap, int);
-		obj = oval_syschar_get_object(sys);
-                pd = oval_pdtbl_get(pext->pdtbl, oval_object_get_subtype(obj));
-
-                if (pd == NULL) {
-                        char         probe_uri[PATH_MAX + 1];
-                        size_t       probe_urilen;
-                        char        *probe_dir;
-                        oval_pdsc_t *probe_dsc;
-
-                        probe_dir = pext->probe_dir;
-                        probe_dsc = oval_pdsc_lookup(pext->pdsc, pext->pdsc_cnt, oval_object_get_subtype(obj));
-
-			if (probe_dsc == NULL) {
-				oval_syschar_add_new_message(sys, "OVAL object not supported", OVAL_MESSAGE_LEVEL_WARNING);
-				oval_syschar_set_flag(sys, SYSCHAR_FLAG_NOT_COLLECTED);
-				va_end(ap);
-				return (1);
-			}
-
-                        probe_urilen = snprintf(probe_uri, sizeof probe_uri,
-                                                "%s://%s/%s", OVAL_PROBE_SCHEME, probe_dir, probe_dsc->file);
-
-                        if (probe_urilen >= sizeof probe_uri) {
-                                oscap_seterr (OSCAP_EFAMILY_GLIBC, "probe URI too long");
-				va_end(ap);
-                                return (-1);
-                        }
-
-                        dI("Starting probe on URI '%s'.", probe_uri);
+		ret = oval_probe_ext_getpd(pext, sys, &pd);
 
-                        if (oval_pdtbl_add(pext->pdtbl, oval_object_get_subtype(obj), -1, probe_uri) != 0) {
-				oval_syschar_add_new_message(sys, "OVAL object not supported", OVAL_MESSAGE_LEVEL_WARNING);
-				oval_syschar_set_flag(sys, SYSCHAR_FLAG_NOT_COLLECTED);
-				va_end(ap);
-                                return (1);
-			}
-
-			pd = oval_pdtbl_get(pext->pdtbl, oval_object_get_subtype(obj));
-
-                        if (pd == NULL) {
-                                oscap_seterr (OSCAP_EFAMILY_OVAL, "internal error");
-				va_end(ap);
-                                return (-1);
-                        }
-                }
+		if (ret != 0) {
+			va_end(ap);
+			return (ret);
+		}
 
 		ret = oval_probe_ext_eval(pext->pdtbl->ctx, pd, pext, sys, flags);
 
@@ -888,16 +1740,10 @@ int oval_probe_ext_handler(oval_subtype_t type, void *ptr, int act, ...)
 
 		if (ret < 0 && errno == ECONNABORTED) {
 			if (!(flags & OVAL_PDFLAG_SLAVE)) {
-				if (!pext->do_init) {
-					oval_pdtbl_free(pext->pdtbl);
-				}
-
-				pext->do_init  = true;
-				pext->pdtbl    = NULL;
-				pext->pdsc     = NULL;
-				pext->pdsc_cnt = 0;
-
-				oval_probe_ext_init(pext);
+				/* the table is shared, its probes are started again when used */
+				pthread_mutex_lock(&__pdpool.lock);
+				oval_pdtbl_clear(pext->pdtbl);
+				pthread_mutex_unlock(&__pdpool.lock);
 
 				errno = ECONNABORTED;
 			}
@@ -915,36 +1761,49 @@ int oval_probe_ext_handler(oval_subtype_t type, void *ptr, int act, ...)
 	case PROBE_HANDLER_ACT_ABORT:
         {
                 if (type == OVAL_SUBTYPE_ALL) {
+			if (act == PROBE_HANDLER_ACT_RESET) {
+				/* the syschars go away with the items of the model */
+				pthread_mutex_lock(&pext->lock);
+				oval_string_map_free(pext->content, NULL);
+				pext->content = oval_string_map_new();
+				if (pext->proj != NULL) {
+					oval_string_map_free(pext->proj, (oscap_destruct_func)oval_proj_free);
+					pext->proj = NULL;
+				}
+				pthread_mutex_unlock(&pext->lock);
+			}
+
                         /*
                          * Iterate thru probe descriptor table and execute the reset operation
                          * for each probe descriptor.
                          */
+			pthread_mutex_lock(&__pdpool.lock);
+
                         for (size_t i = 0; i < pext->pdtbl->count; ++i) {
                                 pd  = pext->pdtbl->memb[i];
 
-				if (pd == NULL) {
-					va_end(ap);
-					return(0);
-				}
+				if (pd == NULL)
+					break;
 
 				if (act == PROBE_HANDLER_ACT_RESET)
 					ret = oval_probe_ext_reset(pext->pdtbl->ctx, pd, pext);
 				else
 					ret = oval_probe_ext_abort(pext->pdtbl->ctx, pd, pext);
 
-				if (ret != 0) {
-					va_end(ap);
-					return (ret);
-				}
+				if (ret != 0)
+					break;
                         }
 
+			pthread_mutex_unlock(&__pdpool.lock);
 			va_end(ap);
-                        return(0);
+                        return(ret);
                 } else {
                         /*
                          * Reset only the probe of specified subtype.
                          */
+			pthread_mutex_lock(&__pdpool.lock);
                         pd = oval_pdtbl_get(pext->pdtbl, type);
+			pthread_mutex_unlock(&__pdpool.lock);
 
 			va_end(ap);
                         if (pd == NULL) 
@@ -986,7 +1845,8 @@ int oval_probe_ext_init(oval_pext_t *pext)
                         goto _ret;
 		}
 
-		if (chdir(pext->probe_dir) != 0) {
+		/* the probes of a remote host can't be looked at, all of them are assumed */
+		if (pext->remote == NULL && chdir(pext->probe_dir) != 0) {
 			dE("Can't chdir to \"%s\"", pext->probe_dir);
                         ret = -1;
                         goto _ret;
@@ -1002,12 +1862,12 @@ int oval_probe_ext_init(oval_pext_t *pext)
                                 continue;
                         }
 
-			if (stat(OSCAP_GSYM(__probe_meta)[i].pname, &st) != 0) {
+			if (pext->remote != NULL) {
+				dD("remote: %s", OSCAP_GSYM(__probe_meta)[i].stype);
+			} else if (stat(OSCAP_GSYM(__probe_meta)[i].pname, &st) != 0) {
 				dD("skipped: %s (stat failed, errno=%d)", OSCAP_GSYM(__probe_meta)[i].stype, errno);
 				continue;
-			}
-
-			if (!S_ISREG(st.st_mode)) {
+			} else if (!S_ISREG(st.st_mode)) {
 				dD("skipped: %s (not a regular file)", OSCAP_GSYM(__probe_meta)[i].stype);
 				continue;
 			}
@@ -1026,7 +1886,7 @@ int oval_probe_ext_init(oval_pext_t *pext)
 		qsort(pext->pdsc, pext->pdsc_cnt, sizeof(oval_pdsc_t),
 		      (int(*)(const void *, const void *))oval_pdsc_cmp);
 
-		if (chdir(curdir) != 0) {
+		if (pext->remote == NULL && chdir(curdir) != 0) {
 			dE("Can't chdir back to \"%s\"", curdir);
 			oscap_free(pext->pdsc);
 			pext->pdsc_cnt = 0;
@@ -1034,12 +1894,14 @@ int oval_probe_ext_init(oval_pext_t *pext)
                         goto _ret;
 		}
 
-                pext->pdtbl = oval_pdtbl_new();
-
-                if (oval_probe_cmd_init(pext) != 0)
+                if ((pext->pdtbl = oval_pdpool_get(pext)) == NULL) {
+			oscap_free(pext->pdsc);
+			pext->pdsc     = NULL;
+			pext->pdsc_cnt = 0;
                         ret = -1;
-                else
+                } else {
                         pext->do_init = false;
+                }
         }
 _ret:
         pthread_mutex_unlock(&pext->lock);
@@ -1051,8 +1913,14 @@ int oval_probe_ext_eval(SEAP_CTX_t *ctx, oval_pd_t *pd, oval_pext_t *pext, struc
 {
         SEXP_t *s_obj, *s_sys;
 	struct oval_object *object;
+	struct oval_sexp_stream *stream;
+	struct timespec start;
+	size_t items, bytes;
+	char *key = NULL;
 	int ret;
 
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
 	if (syschar == NULL) {
 		oscap_seterr(OSCAP_EFAMILY_OVAL, "Internal error: syschar == NULL");
 		return (-1);
@@ -1064,10 +1932,25 @@ int oval_probe_ext_eval(SEAP_CTX_t *ctx, oval_pd_t *pd, oval_pext_t *pext, struc
 	if (ret != 0)
 		return (1);
 
-	ret = oval_probe_comm(ctx, pd, s_obj, flags, &s_sys);
+	/* the probes cache the replies to themselves under the id */
+	if (!(flags & OVAL_PDFLAG_NOREPLY)) {
+		key = oval_object_sexp_key(s_obj);
+		if (oval_probe_ext_content_reuse(pext, key, syschar)) {
+			oscap_free(key);
+			SEXP_free(s_obj);
+			return (0);
+		}
+	}
+
+	stream = (flags & OVAL_PDFLAG_NOREPLY) ? NULL : oval_sexp_stream_new(syschar, s_obj);
+	ret = oval_probe_comm(ctx, pd, s_obj, flags, stream, &s_sys);
 	SEXP_free(s_obj);
 
 	if (ret != 0) {
+		protect_errno {
+			oval_sexp_stream_free(stream);
+			oscap_free(key);
+		}
 		switch (errno) {
 		case ECONNABORTED:
 			dI("Closing sd=%d (pd=%p) after abort", pd->sd, pd);
@@ -1094,15 +1977,242 @@ int oval_probe_ext_eval(SEAP_CTX_t *ctx, oval_pd_t *pd, oval_pext_t *pext, struc
         /*
 	 * Convert the received S-exp to OVAL system characteristic.
 	 */
-	ret = oval_sexp_to_sysch(s_sys, syschar);
+	ret = oval_sexp_stream_to_sysch(stream, s_sys);
+	oval_sexp_stream_get_stats(stream, &items, &bytes);
+	oval_probe_stats_collected(pext->stats, object, oval_probe_stats_elapsed(&start), items, bytes);
+	oval_sexp_stream_free(stream);
 	SEXP_free(s_sys);
 
+	if (ret == 0)
+		oval_probe_ext_content_add(pext, key, syschar);
+	oscap_free(key);
+
 	return (ret);
 }
 
+/*
+ * A request sent by oval_probe_ext_eval_batch and not collected yet
+ */
+struct oval_pdreq {
+	struct oval_syschar *sys;
+	oval_pd_t  *pd;
+	uint32_t    gen;
+	SEAP_msg_t *msg;
+	struct oval_sexp_stream *stream;
+	struct timespec start;
+	char       *key;   /**< see oval_object_sexp_key */
+};
+
+/*
+ * An object of the batch with the same content as a request sent before
+ */
+struct oval_pddup {
+	struct oval_syschar *sys;
+	char *key;
+};
+
+static void oval_probe_ext_collect(oval_pext_t *pext, SEAP_CTX_t *ctx, struct oval_pdreq *req)
+{
+	SEAP_msg_t *s_imsg;
+	SEAP_err_t *s_err;
+	SEXP_t     *s_sys;
+	size_t      items, bytes;
+
+	/*
+	 * The connection was closed (and maybe reestablished) since the
+	 * request was sent; the reply won't come.
+	 */
+	if (req->pd->sd == -1 || req->pd->gen != req->gen)
+		goto out;
+
+	if (oval_pd_recv(ctx, req->pd, SEAP_msg_id(req->msg), &s_imsg, &s_err) != 0) {
+		if (errno == ECANCELED) {
+			dI("Probe at sd=%d reported an error for msg #%u", req->pd->sd, (unsigned int)SEAP_msg_id(req->msg));
+			SEAP_error_free(s_err);
+		} else {
+			dW("Can't receive a reply from sd=%d: %u, %s.", req->pd->sd, errno, strerror(errno));
+			SEAP_close(ctx, req->pd->sd);
+			req->pd->sd = -1;
+			oval_pd_replies_flush(req->pd);
+		}
+
+		goto out;
+	}
+
+	s_sys = SEAP_msg_get(s_imsg);
+	SEAP_msg_free(s_imsg);
+
+	if (oval_sexp_stream_to_sysch(req->stream, s_sys) != 0)
+		dW("Can't convert the reply to msg #%u", (unsigned int)SEAP_msg_id(req->msg));
+	else
+		oval_probe_ext_content_add(pext, req->key, req->sys);
+
+	oval_sexp_stream_get_stats(req->stream, &items, &bytes);
+	oval_probe_stats_collected(pext->stats, oval_syschar_get_object(req->sys),
+				   oval_probe_stats_elapsed(&req->start), items, bytes);
+
+	SEXP_free(s_sys);
+out:
+	oval_pd_stream_del(req->pd, req->stream);
+	oval_sexp_stream_free(req->stream);
+	SEAP_msg_free(req->msg);
+	oscap_free(req->key);
+	req->msg    = NULL;
+	req->stream = NULL;
+	req->key    = NULL;
+}
+
+void oval_probe_ext_eval_batch(oval_pext_t *pext, struct oval_syschar *sys[], size_t count, size_t limit)
+{
+	struct oval_pdreq *req;
+	struct oval_pddup *dup;
+	struct oval_string_map *sent;
+	SEAP_CTX_t *ctx;
+	size_t i, j, n, first, inflight, total, ndup;
+
+	if (count < 2)
+		return;
+
+	if (pext->do_init && oval_probe_ext_init(pext) != 0)
+		return;
+
+	ctx  = pext->pdtbl->ctx;
+	req  = oscap_alloc(sizeof(struct oval_pdreq) * count);
+	dup  = oscap_alloc(sizeof(struct oval_pddup) * count);
+	sent = oval_string_map_new(); /* keys of the requests */
+
+	for (n = 0, ndup = 0, first = 0, total = 0, i = 0; i < count; ++i) {
+		struct oval_object *object;
+		oval_pd_t  *pd;
+		SEAP_msg_t *s_omsg;
+		SEXP_t     *s_obj;
+		char       *key;
+
+		if (oval_probe_ext_getpd(pext, sys[i], &pd) != 0)
+			continue;
+
+		if (pd->sd == -1 && oval_pd_connect(ctx, pd) != 0)
+			continue;
+
+		object = oval_syschar_get_object(sys[i]);
+
+		if (oval_object_to_sexp(pext->sess_ptr, oval_subtype_to_str(oval_object_get_subtype(object)),
+					sys[i], &s_obj) != 0)
+			continue;
+
+		/* the same content was collected before or is on its way */
+		key = oval_object_sexp_key(s_obj);
+		if (oval_probe_ext_content_reuse(pext, key, sys[i])) {
+			oscap_free(key);
+			SEXP_free(s_obj);
+			continue;
+		}
+		if (key != NULL && oval_string_map_get_value(sent, key) != NULL) {
+			dup[ndup].sys = sys[i];
+			dup[ndup].key = key;
+			++ndup;
+			SEXP_free(s_obj);
+			continue;
+		}
+
+		/*
+		 * Don't overrun the probe; wait for the oldest reply once
+		 * there is too much in flight.
+		 */
+		while (first < n && req[first].msg == NULL)
+			++first;
+
+		for (inflight = 0, j = first; j < n; ++j)
+			if (req[j].msg != NULL && req[j].pd == pd)
+				++inflight;
+
+		for (j = first; j < n && inflight >= OVAL_PROBE_PIPELINE_DEPTH; ++j) {
+			if (req[j].msg != NULL && req[j].pd == pd) {
+				oval_probe_ext_collect(pext, ctx, &req[j]);
+				--inflight;
+				--total;
+			}
+		}
+
+		/* the same for all the probes together */
+		for (j = first; j < n && limit > 0 && total >= limit; ++j) {
+			if (req[j].msg != NULL) {
+				oval_probe_ext_collect(pext, ctx, &req[j]);
+				--total;
+			}
+		}
+
+		if (pd->sd == -1) {
+			oscap_free(key);
+			SEXP_free(s_obj);
+			continue;
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &req[n].start);
+		s_omsg = SEAP_msg_new();
+		SEAP_msg_set(s_omsg, s_obj);
+		req[n].stream = oval_sexp_stream_new(sys[i], s_obj);
+		SEXP_free(s_obj);
+
+		if (pd->streaming)
+			SEAP_msgattr_set(s_omsg, "chunked", NULL);
+
+		/* as for the objects sent one at a time */
+		if (pd->timeout > 0) {
+			SEXP_t *s_timeout = SEXP_number_newu_32(pd->timeout);
+
+			SEAP_msgattr_set(s_omsg, "timeout", s_timeout);
+			SEXP_free(s_timeout);
+		}
+
+		if (SEAP_sendmsg(ctx, pd->sd, s_omsg) != 0) {
+			dW("Can't send message: %u, %s.", errno, strerror(errno));
+			oval_sexp_stream_free(req[n].stream);
+			SEAP_msg_free(s_omsg);
+			oscap_free(key);
+			continue;
+		}
+
+		oval_pd_stream_add(pd, SEAP_msg_id(s_omsg), req[n].stream);
+
+		if (key != NULL)
+			oval_string_map_put(sent, key, sys[i]);
+
+		req[n].sys = sys[i];
+		req[n].pd  = pd;
+		req[n].gen = pd->gen;
+		req[n].msg = s_omsg;
+		req[n].key = key;
+		++n;
+		++total;
+	}
+
+	dI("%zu of %zu objects sent to the probes (%zu with the same content), collecting the results",
+	   n, count, ndup);
+
+	for (i = 0; i < n; ++i)
+		if (req[i].msg != NULL)
+			oval_probe_ext_collect(pext, ctx, &req[i]);
+
+	/* if the request failed, the duplicate is left for oval_probe_query_object */
+	for (i = 0; i < ndup; ++i) {
+		oval_probe_ext_content_reuse(pext, dup[i].key, dup[i].sys);
+		oscap_free(dup[i].key);
+	}
+
+	oval_string_map_free(sent, NULL);
+	oscap_free(dup);
+	oscap_free(req);
+}
+
+/* the probes drop only the results in the namespace of the session */
 int oval_probe_ext_reset(SEAP_CTX_t *ctx, oval_pd_t *pd, oval_pext_t *pext)
 {
-        SEAP_cmd_exec(ctx, pd->sd, SEAP_EXEC_RECV, PROBECMD_RESET, NULL, SEAP_CMDTYPE_SYNC, NULL, NULL);
+        SEXP_t *ns;
+
+        ns = SEXP_number_newu(pext->ns);
+        SEAP_cmd_exec(ctx, pd->sd, SEAP_EXEC_RECV, PROBECMD_RESET, ns, SEAP_CMDTYPE_SYNC, NULL, NULL);
+        SEXP_free(ns);
 
         return (0);
 }
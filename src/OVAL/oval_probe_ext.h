@@ -29,10 +29,18 @@
 #include "oval_system_characteristics_impl.h"
 #include "common/util.h"
 
+struct oval_pdreply;
+struct oval_pdstream;
+
 typedef struct {
 	oval_subtype_t subtype;
 	int sd;
 	char *uri;
+	struct oval_pdreply *replies; /**< replies received while waiting for a different one */
+	struct oval_pdstream *streams; /**< requests whose reply items are converted as they arrive */
+	uint32_t gen;                 /**< incremented on every (re)connect */
+	uint32_t timeout;             /**< seconds the probe may collect an object for, 0 if unlimited */
+	bool     streaming;           /**< the items are converted as they arrive, chunks may be asked for */
 } oval_pd_t;
 
 typedef struct {
@@ -49,6 +57,21 @@ struct oval_pdsc {
 
 typedef struct oval_pdsc oval_pdsc_t;
 
+/* [user@]host[:port] whose probes collect the objects instead of the local ones */
+#define OVAL_PROBE_SSH_ENV "OSCAP_PROBE_SSH"
+
+/* if set, the probes needed by the content are started when it's loaded */
+#define OVAL_PROBE_PRESTART_ENV "OSCAP_PROBE_PRESTART"
+
+/* if set, the objects tell the probes which entities of the items are read */
+#define OVAL_PROBE_PROJECTION_ENV "OSCAP_PROBE_PROJECTION"
+
+/*
+ * <seconds>[,<type>=<seconds>...], how long a probe may collect an object,
+ * by default and for the listed object types, e.g. "60,file=600"
+ */
+#define OVAL_PROBE_TIMEOUT_ENV "OSCAP_PROBE_TIMEOUT"
+
 struct oval_pext {
         pthread_mutex_t lock;
         bool            do_init;
@@ -58,9 +81,15 @@ struct oval_pext {
         size_t        pdsc_cnt;
         oval_pdtbl_t *pdtbl;
         char         *probe_dir;
+        char         *remote;   /**< [user@]host[:port] running the probes, NULL if local */
 
+        unsigned int ns;        /**< namespace of the keys of the session in the caches of the probes */
         void *sess_ptr;
         struct oval_syschar_model **model;
+        struct oval_probe_stats_tbl *stats;
+        struct oval_string_map *content; /**< key of the content of an object -> syschar which collected it */
+        bool project;                    /**< see OVAL_PROBE_PROJECTION_ENV */
+        struct oval_string_map *proj;    /**< object id -> entities read from its items, built on demand */
 };
 
 typedef struct oval_pext oval_pext_t;
@@ -69,6 +98,52 @@ oval_pext_t *oval_pext_new(void);
 void oval_pext_free(oval_pext_t *pext);
 int oval_probe_ext_init(oval_pext_t *pext);
 int oval_probe_ext_eval(SEAP_CTX_t *ctx, oval_pd_t *pd, oval_pext_t *pext, struct oval_syschar *syschar, int flags);
+
+/**
+ * Maximal number of requests sent to one probe before waiting for a reply
+ */
+#define OVAL_PROBE_PIPELINE_DEPTH 32
+
+/**
+ * Send the objects of all the syschars to the probes without waiting for
+ * each reply and collect the results as they arrive. Objects which fail to
+ * be evaluated this way are left with the SYSCHAR_FLAG_UNKNOWN flag, so the
+ * caller can query them again one by one to get a proper error report.
+ * The objects must not depend on other objects (variables, sets).
+ * If limit isn't zero, at most limit requests are in flight in total,
+ * regardless of the number of probes they were sent to.
+ */
+void oval_probe_ext_eval_batch(oval_pext_t *pext, struct oval_syschar *sys[], size_t count, size_t limit);
+
+/**
+ * Start the probes of the types (if not running yet) without waiting
+ * for them, see oval_probe_session_prestart.
+ */
+void oval_probe_ext_prestart(oval_pext_t *pext, const oval_subtype_t types[], size_t count);
+
+/**
+ * The objects with the same content (see oval_object_sexp_key), e.g. the
+ * copies of an object in the OVAL files of several rules, are collected
+ * once per session. If an object with the key was collected, its flag,
+ * messages and items are copied to the syschar and true is returned.
+ */
+bool oval_probe_ext_content_reuse(oval_pext_t *pext, const char *key, struct oval_syschar *syschar);
+
+/**
+ * Remember that the syschar has the items of the objects with the key,
+ * unless its collection failed.
+ */
+void oval_probe_ext_content_add(oval_pext_t *pext, const char *key, struct oval_syschar *syschar);
+
+/**
+ * Get the names of the entities of the items of the object which are read
+ * by the states of the tests and of the filters of the content and by the
+ * object components of its variables. Returns NULL if the projection is
+ * disabled, or if any entity may be read, e.g. because the object is a
+ * member of a set object or isn't referenced by the content at all.
+ */
+SEXP_t *oval_probe_ext_projection(oval_pext_t *pext, struct oval_object *object);
+
 int oval_probe_ext_reset(SEAP_CTX_t *ctx, oval_pd_t *pd, oval_pext_t *pext);
 int oval_probe_ext_abort(SEAP_CTX_t *ctx, oval_pd_t *pd, oval_pext_t *pext);
 
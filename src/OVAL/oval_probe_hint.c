@@ -24,36 +24,75 @@
 #include <config.h>
 #endif
 
+#include <stdbool.h>
+
 #include "public/oval_definitions.h"
 #include "public/oval_system_characteristics.h"
 #include "oval_system_characteristics_impl.h"
 #include "oval_probe_impl.h"
 #include "_oval_probe_session.h"
+#include "collectVarRefs_impl.h"
+#include "adt/oval_string_map_impl.h"
+
+struct _oval_probe_hint {
+	oval_probe_session_t *sess;
+	const char *variable_id;	///< NULL to hint all the objects
+	int variable_instance_hint;
+	struct oval_string_map *seen;	///< ids of the objects, states and variables already walked
+};
 
-static int _oval_probe_hint_criteria(oval_probe_session_t *sess, struct oval_criteria_node *cnode, int variable_instance_hint);
-static int _oval_probe_hint_object(oval_probe_session_t *psess, struct oval_object *object, int variable_instance_hint);
+static int _oval_probe_hint_criteria(struct _oval_probe_hint *ctx, struct oval_criteria_node *cnode);
+static void _oval_probe_hint_object(struct _oval_probe_hint *ctx, struct oval_object *object);
+static void _oval_probe_hint_state(struct _oval_probe_hint *ctx, struct oval_state *state);
+static void _oval_probe_hint_variable(struct _oval_probe_hint *ctx, struct oval_variable *variable);
 
 /**
- * Finds all the oval_syschars (collected objects) assigned with a given definition
- * and sets the variable_instance_hint attribute thereof. That is to mark these
- * collected objects with the hint that a new round of collection might be needed
- * when these objects are again probed by @ref oval_probe_query_object. That is
- * usefull when a new variable instance is injected into the oval_agent_session.
+ * Finds all the oval_syschars (collected objects) of a given definition which
+ * depend on a given variable and sets the variable_instance_hint attribute thereof.
+ * That is to mark these collected objects with the hint that a new round of
+ * collection is needed when these objects are again probed by
+ * @ref oval_probe_query_object. That is usefull when a new variable instance is
+ * injected into the oval_agent_session. The objects are looked up in the tests of
+ * the definition, in their states, and in the sets, filters and object components
+ * these refer to. The objects which do not depend on the variable are kept, so the
+ * instances share them.
+ * @param variable the variable with a new instance, NULL to hint all the objects
  * @param variable_instance_hint new hint to set
  * @returns 0 on success; -1 on error; 1 on warning
  */
-int oval_probe_hint_definition(oval_probe_session_t *sess, struct oval_definition *definition, int variable_instance_hint)
+int oval_probe_hint_definition(oval_probe_session_t *sess, struct oval_definition *definition,
+			       struct oval_variable *variable, int variable_instance_hint)
 {
+	struct _oval_probe_hint ctx;
+	struct oval_criteria_node *cnode;
+	int ret;
+
 	if (definition == NULL)
 		return -1;
-	struct oval_criteria_node *cnode = oval_definition_get_criteria(definition);
+	cnode = oval_definition_get_criteria(definition);
 	if (cnode == NULL)
 		return -1;
 
-	return _oval_probe_hint_criteria(sess, cnode, variable_instance_hint);
+	ctx.sess = sess;
+	ctx.variable_id = variable != NULL ? oval_variable_get_id(variable) : NULL;
+	ctx.variable_instance_hint = variable_instance_hint;
+	ctx.seen = oval_string_map_new();
+
+	ret = _oval_probe_hint_criteria(&ctx, cnode);
+
+	oval_string_map_free(ctx.seen, NULL);
+	return ret;
 }
 
-int _oval_probe_hint_criteria(oval_probe_session_t *sess, struct oval_criteria_node *cnode, int variable_instance_hint)
+static bool _oval_probe_hint_seen(struct _oval_probe_hint *ctx, char *id)
+{
+	if (oval_string_map_get_value(ctx->seen, id) != NULL)
+		return true;
+	oval_string_map_put(ctx->seen, id, ctx);
+	return false;
+}
+
+static int _oval_probe_hint_criteria(struct _oval_probe_hint *ctx, struct oval_criteria_node *cnode)
 {
 	switch (oval_criteria_node_get_type(cnode)) {
 	case OVAL_NODETYPE_CRITERION:{
@@ -61,10 +100,13 @@ int _oval_probe_hint_criteria(oval_probe_session_t *sess, struct oval_criteria_n
 		if (test == NULL)
 			return 0;
 		struct oval_object *object = oval_test_get_object(test);
-		if (object == NULL)
-			return 0;
-		// TODO: Do we need to similarly hint all the object refereced like: test->state->variable->object?
-		return _oval_probe_hint_object(sess, object, variable_instance_hint);
+		if (object != NULL)
+			_oval_probe_hint_object(ctx, object);
+		struct oval_state_iterator *ste_it = oval_test_get_states(test);
+		while (oval_state_iterator_has_more(ste_it))
+			_oval_probe_hint_state(ctx, oval_state_iterator_next(ste_it));
+		oval_state_iterator_free(ste_it);
+		return 0;
 	}
 	case OVAL_NODETYPE_CRITERIA:{
 		struct oval_criteria_node_iterator *cnode_it = oval_criteria_node_get_subnodes(cnode);
@@ -73,14 +115,16 @@ int _oval_probe_hint_criteria(oval_probe_session_t *sess, struct oval_criteria_n
 		int ret = 0;
 		while (ret == 0 && oval_criteria_node_iterator_has_more(cnode_it)) {
 			struct oval_criteria_node *node = oval_criteria_node_iterator_next(cnode_it);
-			ret = _oval_probe_hint_criteria(sess, node, variable_instance_hint);
+			ret = _oval_probe_hint_criteria(ctx, node);
 		}
 		oval_criteria_node_iterator_free(cnode_it);
 		return ret;
 	}
 	case OVAL_NODETYPE_EXTENDDEF:{
 		struct oval_definition *oval_def = oval_criteria_node_get_definition(cnode);
-		return oval_probe_hint_definition(sess, oval_def, variable_instance_hint);
+		if (oval_def == NULL || oval_definition_get_criteria(oval_def) == NULL)
+			return -1;
+		return _oval_probe_hint_criteria(ctx, oval_definition_get_criteria(oval_def));
 	}
 	case OVAL_NODETYPE_UNKNOWN:{
 		assert(false);
@@ -90,12 +134,146 @@ int _oval_probe_hint_criteria(oval_probe_session_t *sess, struct oval_criteria_n
 	return -1;
 }
 
-int _oval_probe_hint_object(oval_probe_session_t *psess, struct oval_object *object, int variable_instance_hint)
+static void _oval_probe_hint_entity(struct _oval_probe_hint *ctx, struct oval_entity *entity)
+{
+	oval_entity_varref_type_t vrt = oval_entity_get_varref_type(entity);
+
+	if (vrt == OVAL_ENTITY_VARREF_ATTRIBUTE || vrt == OVAL_ENTITY_VARREF_ELEMENT)
+		_oval_probe_hint_variable(ctx, oval_entity_get_variable(entity));
+}
+
+static void _oval_probe_hint_component(struct _oval_probe_hint *ctx, struct oval_component *component)
+{
+	struct oval_component_iterator *cmp_it;
+
+	if (component == NULL)
+		return;
+
+	switch (oval_component_get_type(component)) {
+	case OVAL_COMPONENT_OBJECTREF:
+		_oval_probe_hint_object(ctx, oval_component_get_object(component));
+		break;
+	case OVAL_COMPONENT_VARREF:
+		_oval_probe_hint_variable(ctx, oval_component_get_variable(component));
+		break;
+	case OVAL_FUNCTION_ARITHMETIC:
+	case OVAL_FUNCTION_BEGIN:
+	case OVAL_FUNCTION_CONCAT:
+	case OVAL_FUNCTION_END:
+	case OVAL_FUNCTION_ESCAPE_REGEX:
+	case OVAL_FUNCTION_REGEX_CAPTURE:
+	case OVAL_FUNCTION_SPLIT:
+	case OVAL_FUNCTION_SUBSTRING:
+	case OVAL_FUNCTION_TIMEDIF:
+		cmp_it = oval_component_get_function_components(component);
+		while (oval_component_iterator_has_more(cmp_it))
+			_oval_probe_hint_component(ctx, oval_component_iterator_next(cmp_it));
+		oval_component_iterator_free(cmp_it);
+		break;
+	default:
+		break;
+	}
+}
+
+static void _oval_probe_hint_variable(struct _oval_probe_hint *ctx, struct oval_variable *variable)
+{
+	if (variable == NULL || _oval_probe_hint_seen(ctx, oval_variable_get_id(variable)))
+		return;
+	if (oval_variable_get_type(variable) == OVAL_VARIABLE_LOCAL)
+		_oval_probe_hint_component(ctx, oval_variable_get_component(variable));
+}
+
+static void _oval_probe_hint_state(struct _oval_probe_hint *ctx, struct oval_state *state)
 {
-	const char *oid = oval_object_get_id(object);
-	struct oval_syschar *syschar = oval_syschar_model_get_syschar(psess->sys_model, oid);
-	if (syschar != NULL) {
-		oval_syschar_set_variable_instance_hint(syschar, variable_instance_hint);
+	struct oval_state_content_iterator *cont_it;
+
+	if (state == NULL || _oval_probe_hint_seen(ctx, oval_state_get_id(state)))
+		return;
+
+	cont_it = oval_state_get_contents(state);
+	while (oval_state_content_iterator_has_more(cont_it))
+		_oval_probe_hint_entity(ctx, oval_state_content_get_entity(oval_state_content_iterator_next(cont_it)));
+	oval_state_content_iterator_free(cont_it);
+}
+
+static void _oval_probe_hint_set(struct _oval_probe_hint *ctx, struct oval_setobject *set)
+{
+	struct oval_setobject_iterator *subset_it;
+	struct oval_object_iterator *obj_it;
+	struct oval_filter_iterator *fil_it;
+
+	switch (oval_setobject_get_type(set)) {
+	case OVAL_SET_AGGREGATE:
+		subset_it = oval_setobject_get_subsets(set);
+		while (oval_setobject_iterator_has_more(subset_it))
+			_oval_probe_hint_set(ctx, oval_setobject_iterator_next(subset_it));
+		oval_setobject_iterator_free(subset_it);
+		break;
+	case OVAL_SET_COLLECTIVE:
+		obj_it = oval_setobject_get_objects(set);
+		while (oval_object_iterator_has_more(obj_it))
+			_oval_probe_hint_object(ctx, oval_object_iterator_next(obj_it));
+		oval_object_iterator_free(obj_it);
+		fil_it = oval_setobject_get_filters(set);
+		while (oval_filter_iterator_has_more(fil_it))
+			_oval_probe_hint_state(ctx, oval_filter_get_state(oval_filter_iterator_next(fil_it)));
+		oval_filter_iterator_free(fil_it);
+		break;
+	default:
+		break;
+	}
+}
+
+static bool _oval_probe_hint_depends(struct _oval_probe_hint *ctx, struct oval_object *object)
+{
+	struct oval_string_map *vm;
+	bool depends;
+
+	if (ctx->variable_id == NULL)
+		return true;
+
+	vm = oval_string_map_new();
+	oval_obj_collect_var_refs(object, vm);
+	depends = oval_string_map_get_value(vm, ctx->variable_id) != NULL;
+	oval_string_map_free(vm, NULL);
+
+	return depends;
+}
+
+static void _oval_probe_hint_object(struct _oval_probe_hint *ctx, struct oval_object *object)
+{
+	struct oval_object_content_iterator *cont_it;
+	struct oval_syschar *syschar;
+	char *oid;
+
+	if (object == NULL)
+		return;
+	oid = oval_object_get_id(object);
+	if (_oval_probe_hint_seen(ctx, oid))
+		return;
+
+	syschar = oval_syschar_model_get_syschar(ctx->sess->sys_model, oid);
+	if (syschar != NULL && _oval_probe_hint_depends(ctx, object))
+		oval_syschar_set_variable_instance_hint(syschar, ctx->variable_instance_hint);
+
+	/* the objects this one is collected from */
+	cont_it = oval_object_get_object_contents(object);
+	while (oval_object_content_iterator_has_more(cont_it)) {
+		struct oval_object_content *cont = oval_object_content_iterator_next(cont_it);
+
+		switch (oval_object_content_get_type(cont)) {
+		case OVAL_OBJECTCONTENT_ENTITY:
+			_oval_probe_hint_entity(ctx, oval_object_content_get_entity(cont));
+			break;
+		case OVAL_OBJECTCONTENT_SET:
+			_oval_probe_hint_set(ctx, oval_object_content_get_setobject(cont));
+			break;
+		case OVAL_OBJECTCONTENT_FILTER:
+			_oval_probe_hint_state(ctx, oval_filter_get_state(oval_object_content_get_filter(cont)));
+			break;
+		default:
+			break;
+		}
 	}
-	return 0;
+	oval_object_content_iterator_free(cont_it);
 }
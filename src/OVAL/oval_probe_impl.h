@@ -47,7 +47,11 @@
 
 OSCAP_HIDDEN_START;
 
-#define OVAL_PROBE_SCHEME "pipe"
+#if defined(HAVE_MEMFD_CREATE) && defined(HAVE_EVENTFD) && defined(HAVE_ATOMIC_BUILTINS)
+# define OVAL_PROBE_SCHEME "shm"
+#else
+# define OVAL_PROBE_SCHEME "pipe"
+#endif
 
 #ifndef OVAL_PROBE_DIR
 # define OVAL_PROBE_DIR    "/usr/libexec/openscap"
@@ -57,6 +61,43 @@ OSCAP_HIDDEN_START;
 
 int oval_probe_query_test(oval_probe_session_t *sess, struct oval_test *test);
 
+/**
+ * Evaluate the independent objects of a definition (and the definitions
+ * it extends) before its tests are queried one by one. If jobs isn't zero,
+ * at most jobs queries are in flight at once.
+ */
+void oval_probe_prefetch_definition(oval_probe_session_t *sess, struct oval_definition *definition, unsigned int jobs);
+
+/**
+ * Evaluate the independent objects of all the definitions in the model,
+ * with at most jobs queries in flight at once. The objects are handed out
+ * to the probe types in turns, so all the probes are kept busy. Objects
+ * which depend on variables or other objects are left to be evaluated
+ * on demand, once the objects they depend on are known.
+ */
+void oval_probe_prefetch_model(oval_probe_session_t *sess, struct oval_definition_model *model, unsigned int jobs);
+
+/**
+ * Evaluate the independent objects of the definitions (and of the
+ * definitions they extend) like oval_probe_prefetch_model does for all
+ * the definitions of the model.
+ */
+void oval_probe_prefetch_definitions(oval_probe_session_t *sess, struct oval_definition **definitions, size_t count, unsigned int jobs);
+
+/**
+ * Mean wall time in seconds of the collection of an object of the type,
+ * measured in this session and the previous ones (see OSCAP_PROBE_STATS),
+ * or -1 if no such object was collected yet.
+ */
+double oval_probe_session_get_cost(oval_probe_session_t *sess, oval_subtype_t type);
+
+/**
+ * Start the external probes of all the object types of the model at once,
+ * so that they initialize in parallel instead of on the first query of
+ * each type. See OSCAP_PROBE_PRESTART.
+ */
+void oval_probe_session_prestart(oval_probe_session_t *sess, struct oval_definition_model *model);
+
 OSCAP_HIDDEN_END;
 
 extern probe_ncache_t *OSCAP_GSYM(ncache);
@@ -70,7 +111,8 @@ void oval_probe_tblinit(void);
 const char *oval_subtype_to_str(oval_subtype_t subtype);
 oval_subtype_t oval_str_to_subtype(const char *str);
 
-int oval_probe_hint_definition(oval_probe_session_t *sess, struct oval_definition *definition, int variable_instance_hint);
+int oval_probe_hint_definition(oval_probe_session_t *sess, struct oval_definition *definition,
+			       struct oval_variable *variable, int variable_instance_hint);
 
 #endif /* OVAL_PROBE_IMPL_H */
 /// @}
@@ -0,0 +1,596 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "common/alloc.h"
+#include "common/debug_priv.h"
+#include "common/_error.h"
+#include "oscap_source.h"
+#include "adt/oval_collection_impl.h"
+#include "adt/oval_string_map_impl.h"
+#include "oval_system_characteristics_impl.h"
+#include "collectVarRefs_impl.h"
+#include "oval_probe_ext.h"
+#include "oval_probe_incr.h"
+
+struct oval_probe_stamp {
+	char *path;
+	bool exists;
+	unsigned long long dev, ino, size;
+	long long mtime_sec, mtime_nsec;
+	long long ctime_sec, ctime_nsec;
+};
+
+struct oval_probe_stamps {
+	int version; /**< version of the object */
+	struct oval_probe_stamp *stamps;
+	size_t count;
+};
+
+struct oval_probe_incr {
+	struct oval_definition_model *def_model;
+	char *content;                    /**< generator of the definitions, the state of other contents is ignored */
+	char *stamps_path;
+	char *model_path;
+	struct oval_string_map *objects;  /**< object id -> struct oval_probe_stamps of the previous evaluation */
+	struct oval_syschar_model *prev;  /**< imported on the first reuse */
+	bool prev_failed;
+	time_t start;                     /**< inputs changed since the start may not be collected yet */
+};
+
+/* the databases the package objects are read from */
+static const char *oval_probe_incr_pkgdb[] = {
+	"/var/lib/rpm",
+	"/var/lib/rpm/Packages",
+	"/var/lib/rpm/rpmdb.sqlite",
+	"/usr/lib/sysimage/rpm/rpmdb.sqlite",
+	"/var/lib/dpkg/status",
+	NULL
+};
+
+static void oval_probe_stamps_free(struct oval_probe_stamps *stamps)
+{
+	size_t i;
+
+	if (stamps == NULL)
+		return;
+
+	for (i = 0; i < stamps->count; ++i)
+		oscap_free(stamps->stamps[i].path);
+	oscap_free(stamps->stamps);
+	oscap_free(stamps);
+}
+
+static void oval_probe_stamp_take(struct oval_probe_stamp *stamp, const char *path)
+{
+	const char *root = getenv("OSCAP_PROBE_ROOT");
+	struct stat st;
+	char *full;
+	int ret;
+
+	memset(stamp, 0, sizeof *stamp);
+
+	if (root != NULL && *root != '\0') {
+		full = oscap_sprintf("%s%s", root, path);
+		ret = stat(full, &st);
+		oscap_free(full);
+	} else {
+		ret = stat(path, &st);
+	}
+
+	if (ret == 0) {
+		stamp->exists = true;
+		stamp->dev = st.st_dev;
+		stamp->ino = st.st_ino;
+		stamp->size = st.st_size;
+		stamp->mtime_sec = st.st_mtim.tv_sec;
+		stamp->mtime_nsec = st.st_mtim.tv_nsec;
+		stamp->ctime_sec = st.st_ctim.tv_sec;
+		stamp->ctime_nsec = st.st_ctim.tv_nsec;
+	}
+}
+
+static bool oval_probe_stamp_eq(const struct oval_probe_stamp *a, const struct oval_probe_stamp *b)
+{
+	if (a->exists != b->exists)
+		return false;
+	if (!a->exists)
+		return true;
+	return a->dev == b->dev && a->ino == b->ino && a->size == b->size
+		&& a->mtime_sec == b->mtime_sec && a->mtime_nsec == b->mtime_nsec
+		&& a->ctime_sec == b->ctime_sec && a->ctime_nsec == b->ctime_nsec;
+}
+
+static inline const char *_oval_probe_incr_str(const char *str)
+{
+	return str != NULL ? str : "-";
+}
+
+static uint32_t oval_probe_incr_hash(const char *str)
+{
+	uint32_t h = 2166136261U;
+
+	while (*str != '\0') {
+		h ^= (unsigned char) *str++;
+		h *= 16777619U;
+	}
+	return h;
+}
+
+static void oval_probe_incr_load(struct oval_probe_incr *incr)
+{
+	struct oval_probe_stamps *stamps = NULL;
+	struct oval_probe_stamp stamp;
+	char line[PATH_MAX + 256], id[256];
+	int version, exists, off;
+	size_t len;
+	FILE *fp;
+
+	fp = fopen(incr->stamps_path, "r");
+	if (fp == NULL) {
+		if (errno != ENOENT)
+			dW("Can't read the incremental collection state '%s': %s.", incr->stamps_path, strerror(errno));
+		return;
+	}
+
+	/* the state of another content or generation of the content is useless */
+	if (fgets(line, sizeof line, fp) == NULL || strncmp(line, "content ", 8) != 0
+	    || strcspn(line + 8, "\n") != strlen(incr->content) || strncmp(line + 8, incr->content, strlen(incr->content)) != 0) {
+		dI("The incremental collection state '%s' belongs to another content.", incr->stamps_path);
+		fclose(fp);
+		return;
+	}
+
+	while (fgets(line, sizeof line, fp) != NULL) {
+		len = strlen(line);
+		if (len > 0 && line[len - 1] == '\n')
+			line[--len] = '\0';
+
+		if (sscanf(line, "object %255s %d", id, &version) == 2) {
+			stamps = NULL;
+			if (oval_string_map_get_value(incr->objects, id) != NULL) {
+				dW("Object '%s' is twice in the incremental collection state '%s'.", id, incr->stamps_path);
+				continue;
+			}
+			stamps = oscap_talloc(struct oval_probe_stamps);
+			stamps->version = version;
+			stamps->stamps = NULL;
+			stamps->count = 0;
+			oval_string_map_put(incr->objects, id, stamps);
+			continue;
+		}
+
+		memset(&stamp, 0, sizeof stamp);
+		if (stamps == NULL || sscanf(line, "stamp %d %llu %llu %llu %lld %lld %lld %lld %n", &exists,
+					     &stamp.dev, &stamp.ino, &stamp.size, &stamp.mtime_sec, &stamp.mtime_nsec,
+					     &stamp.ctime_sec, &stamp.ctime_nsec, &off) < 8 || line[off] != '/') {
+			dW("Ignoring a malformed line of the incremental collection state '%s'.", incr->stamps_path);
+			continue;
+		}
+		stamp.exists = exists != 0;
+		stamp.path = oscap_strdup(line + off);
+
+		stamps->stamps = oscap_realloc(stamps->stamps, sizeof(struct oval_probe_stamp) * (stamps->count + 1));
+		stamps->stamps[stamps->count++] = stamp;
+	}
+
+	fclose(fp);
+}
+
+struct oval_probe_incr *oval_probe_incr_new(struct oval_definition_model *model)
+{
+	struct oval_probe_incr *incr;
+	struct oval_generator *generator;
+	const char *dir, *remote;
+	uint32_t h;
+
+	dir = getenv(OVAL_PROBE_INCR_ENV);
+	if (dir == NULL || *dir == '\0' || model == NULL)
+		return NULL;
+
+	/* the stamps of the local files say nothing about a remote host */
+	remote = getenv(OVAL_PROBE_SSH_ENV);
+	if (remote != NULL && *remote != '\0') {
+		dW("Incremental collection is not supported with the remote probes, ignoring %s.", OVAL_PROBE_INCR_ENV);
+		return NULL;
+	}
+
+	generator = oval_definition_model_get_generator(model);
+
+	incr = oscap_talloc(struct oval_probe_incr);
+	incr->def_model = model;
+	incr->content = oscap_sprintf("%s %s %s",
+				      _oval_probe_incr_str(oval_generator_get_product_name(generator)),
+				      _oval_probe_incr_str(oval_generator_get_core_schema_version(generator)),
+				      _oval_probe_incr_str(oval_generator_get_timestamp(generator)));
+	h = oval_probe_incr_hash(incr->content);
+	incr->stamps_path = oscap_sprintf("%s/%08x.stamps", dir, h);
+	incr->model_path = oscap_sprintf("%s/%08x.xml", dir, h);
+	incr->objects = oval_string_map_new();
+	incr->prev = NULL;
+	incr->prev_failed = false;
+	incr->start = time(NULL);
+
+	oval_probe_incr_load(incr);
+
+	return incr;
+}
+
+void oval_probe_incr_free(struct oval_probe_incr *incr)
+{
+	if (incr == NULL)
+		return;
+
+	oval_string_map_free(incr->objects, (oscap_destruct_func) oval_probe_stamps_free);
+	oval_syschar_model_free(incr->prev);
+	oscap_free(incr->content);
+	oscap_free(incr->stamps_path);
+	oscap_free(incr->model_path);
+	oscap_free(incr);
+}
+
+/* the directories aren't walked and the paths don't depend on variables */
+static bool oval_probe_incr_fixed_paths(struct oval_object *object, struct oval_string_map *paths)
+{
+	struct oval_behavior_iterator *bhv_itr;
+	struct oval_object_content_iterator *cont_itr;
+	bool ret = true, found = false;
+
+	bhv_itr = oval_object_get_behaviors(object);
+	while (ret && oval_behavior_iterator_has_more(bhv_itr)) {
+		struct oval_behavior *bhv = oval_behavior_iterator_next(bhv_itr);
+
+		if (oscap_streq(oval_behavior_get_key(bhv), "recurse_direction")
+		    && !oscap_streq(oval_behavior_get_value(bhv), "none"))
+			ret = false;
+	}
+	oval_behavior_iterator_free(bhv_itr);
+
+	cont_itr = oval_object_get_object_contents(object);
+	while (ret && oval_object_content_iterator_has_more(cont_itr)) {
+		struct oval_object_content *cont = oval_object_content_iterator_next(cont_itr);
+		struct oval_entity *entity;
+		struct oval_value *value;
+		const char *name, *text;
+
+		if (oval_object_content_get_type(cont) != OVAL_OBJECTCONTENT_ENTITY)
+			continue;
+
+		entity = oval_object_content_get_entity(cont);
+		name = oval_entity_get_name(entity);
+		if (!oscap_streq(name, "path") && !oscap_streq(name, "filepath"))
+			continue;
+
+		value = oval_entity_get_value(entity);
+		text = value != NULL ? oval_value_get_text(value) : NULL;
+		if (oval_entity_get_operation(entity) != OVAL_OPERATION_EQUALS
+		    || oval_entity_get_varref_type(entity) != OVAL_ENTITY_VARREF_NONE
+		    || text == NULL || text[0] != '/') {
+			ret = false;
+			break;
+		}
+
+		oval_string_map_intern(paths, text);
+		if (oscap_streq(name, "filepath")) {
+			/* a new file appears in the directory */
+			char *dir = oscap_strdup(text);
+			char *slash = strrchr(dir, '/');
+
+			slash[slash == dir ? 1 : 0] = '\0';
+			oval_string_map_intern(paths, dir);
+			oscap_free(dir);
+		}
+		found = true;
+	}
+	oval_object_content_iterator_free(cont_itr);
+
+	return ret && found;
+}
+
+static void oval_probe_incr_item_paths(struct oval_syschar *sysc, struct oval_string_map *paths)
+{
+	struct oval_sysitem_iterator *item_itr;
+
+	item_itr = oval_syschar_get_sysitem(sysc);
+	while (oval_sysitem_iterator_has_more(item_itr)) {
+		struct oval_sysitem *item = oval_sysitem_iterator_next(item_itr);
+		struct oval_sysent_iterator *ent_itr;
+		const char *path = NULL, *filename = NULL;
+
+		ent_itr = oval_sysitem_get_sysents(item);
+		while (oval_sysent_iterator_has_more(ent_itr)) {
+			struct oval_sysent *ent = oval_sysent_iterator_next(ent_itr);
+			const char *name = oval_sysent_get_name(ent);
+
+			if (oscap_streq(name, "filepath"))
+				oval_string_map_intern(paths, oval_sysent_get_value(ent));
+			else if (oscap_streq(name, "path"))
+				path = oval_sysent_get_value(ent);
+			else if (oscap_streq(name, "filename"))
+				filename = oval_sysent_get_value(ent);
+		}
+		oval_sysent_iterator_free(ent_itr);
+
+		if (path != NULL && filename != NULL && filename[0] != '\0') {
+			char *filepath = oscap_sprintf("%s/%s", path, filename);
+
+			oval_string_map_intern(paths, filepath);
+			oscap_free(filepath);
+		} else if (path != NULL) {
+			oval_string_map_intern(paths, path);
+		}
+	}
+	oval_sysitem_iterator_free(item_itr);
+}
+
+/*
+ * The paths whose stat(2) tells whether the object could have changed,
+ * false if it isn't known.
+ */
+static bool oval_probe_incr_inputs(struct oval_object *object, struct oval_syschar *sysc, struct oval_string_map *paths)
+{
+	struct oval_object_content_iterator *cont_itr;
+	struct oval_string_map *vm;
+	bool ret = true;
+	int i;
+
+	cont_itr = oval_object_get_object_contents(object);
+	while (ret && oval_object_content_iterator_has_more(cont_itr)) {
+		if (oval_object_content_get_type(oval_object_content_iterator_next(cont_itr)) == OVAL_OBJECTCONTENT_SET)
+			ret = false;
+	}
+	oval_object_content_iterator_free(cont_itr);
+
+	if (!ret)
+		return false;
+
+	vm = oval_string_map_new();
+	oval_obj_collect_var_refs(object, vm);
+	ret = oval_string_map_is_empty(vm);
+	oval_string_map_free(vm, NULL);
+
+	if (!ret)
+		return false;
+
+	switch ((int) oval_object_get_subtype(object)) {
+	case OVAL_LINUX_RPM_INFO:
+	case OVAL_LINUX_DPKG_INFO:
+		for (i = 0; oval_probe_incr_pkgdb[i] != NULL; ++i)
+			oval_string_map_intern(paths, oval_probe_incr_pkgdb[i]);
+		return true;
+	case OVAL_UNIX_FILE:
+	case OVAL_UNIX_FILEEXTENDEDATTRIBUTE:
+	case OVAL_INDEPENDENT_FILE_MD5:
+	case OVAL_INDEPENDENT_FILE_HASH:
+	case OVAL_INDEPENDENT_FILE_HASH58:
+	case OVAL_INDEPENDENT_TEXT_FILE_CONTENT:
+	case OVAL_INDEPENDENT_TEXT_FILE_CONTENT_54:
+	case OVAL_INDEPENDENT_XML_FILE_CONTENT:
+		if (!oval_probe_incr_fixed_paths(object, paths))
+			return false;
+		if (sysc != NULL)
+			oval_probe_incr_item_paths(sysc, paths);
+		return true;
+	default:
+		return false;
+	}
+}
+
+struct oval_syschar *oval_probe_incr_reuse(struct oval_probe_incr *incr, struct oval_syschar_model *model,
+					   struct oval_object *object)
+{
+	struct oval_probe_stamps *stamps;
+	struct oval_probe_stamp now;
+	struct oval_syschar *prev_sysc;
+	struct oval_string_map *paths;
+	const char *oid;
+	size_t i;
+	bool ok;
+
+	if (incr == NULL)
+		return NULL;
+
+	oid = oval_object_get_id(object);
+	stamps = oval_string_map_get_value(incr->objects, oid);
+	if (stamps == NULL || stamps->version != oval_object_get_version(object))
+		return NULL;
+
+	paths = oval_string_map_new();
+	ok = oval_probe_incr_inputs(object, NULL, paths);
+	oval_string_map_free(paths, NULL);
+	if (!ok)
+		return NULL;
+
+	for (i = 0; i < stamps->count; ++i) {
+		oval_probe_stamp_take(&now, stamps->stamps[i].path);
+		if (!oval_probe_stamp_eq(&now, &stamps->stamps[i])) {
+			dI("Object '%s' has to be collected again, '%s' changed.", oid, stamps->stamps[i].path);
+			return NULL;
+		}
+	}
+
+	if (incr->prev == NULL && !incr->prev_failed) {
+		struct oscap_source *source = oscap_source_new_from_file(incr->model_path);
+		int ret;
+
+		incr->prev = oval_syschar_model_new(incr->def_model);
+		ret = oval_syschar_model_import_source(incr->prev, source);
+		oscap_source_free(source);
+		if (ret != 0) {
+			dW("Can't import the system characteristics of the previous evaluation '%s', "
+			   "all the objects are collected.", incr->model_path);
+			oscap_clearerr();
+			oval_syschar_model_free(incr->prev);
+			incr->prev = NULL;
+			incr->prev_failed = true;
+		}
+	}
+	if (incr->prev == NULL)
+		return NULL;
+
+	prev_sysc = oval_syschar_model_get_syschar(incr->prev, oid);
+	if (prev_sysc == NULL)
+		return NULL;
+
+	dI("Reusing the system characteristics of object '%s', its inputs didn't change.", oid);
+	return oval_syschar_clone(model, prev_sysc);
+}
+
+/* the stamps of the inputs, NULL if some of them changed during the evaluation */
+static struct oval_probe_stamps *oval_probe_incr_stamp(struct oval_probe_incr *incr, struct oval_object *object,
+						       struct oval_syschar *sysc)
+{
+	struct oval_probe_stamps *stamps;
+	struct oval_string_map *paths;
+	struct oval_iterator *keys;
+
+	paths = oval_string_map_new();
+	if (!oval_probe_incr_inputs(object, sysc, paths)) {
+		oval_string_map_free(paths, NULL);
+		return NULL;
+	}
+
+	stamps = oscap_talloc(struct oval_probe_stamps);
+	stamps->version = oval_object_get_version(object);
+	stamps->stamps = oscap_calloc(oval_string_map_get_count(paths) + 1, sizeof(struct oval_probe_stamp));
+	stamps->count = 0;
+
+	keys = oval_string_map_keys(paths);
+	while (oval_collection_iterator_has_more(keys)) {
+		struct oval_probe_stamp *stamp = &stamps->stamps[stamps->count++];
+		const char *path = oval_collection_iterator_next(keys);
+
+		oval_probe_stamp_take(stamp, path);
+		stamp->path = oscap_strdup(path);
+
+		/* timestamps are coarse, the whole second of the start counts */
+		if (stamp->exists && (stamp->mtime_sec >= incr->start || stamp->ctime_sec >= incr->start)) {
+			oval_collection_iterator_free(keys);
+			oval_string_map_free(paths, NULL);
+			oval_probe_stamps_free(stamps);
+			return NULL;
+		}
+	}
+	oval_collection_iterator_free(keys);
+	oval_string_map_free(paths, NULL);
+
+	return stamps;
+}
+
+int oval_probe_incr_save(struct oval_probe_incr *incr, struct oval_syschar_model *model)
+{
+	struct oval_syschar_iterator *sysc_itr;
+	char *stamps_tmp, *model_tmp;
+	size_t i, saved = 0;
+	FILE *fp;
+	int ret = 0;
+
+	if (incr == NULL || model == NULL)
+		return 0;
+
+	stamps_tmp = oscap_sprintf("%s.tmp", incr->stamps_path);
+	model_tmp = oscap_sprintf("%s.tmp", incr->model_path);
+
+	fp = fopen(stamps_tmp, "w");
+	if (fp == NULL) {
+		dW("Can't write the incremental collection state '%s': %s.", stamps_tmp, strerror(errno));
+		ret = -1;
+		goto cleanup;
+	}
+
+	fprintf(fp, "content %s\n", incr->content);
+
+	sysc_itr = oval_syschar_model_get_syschars(model);
+	while (oval_syschar_iterator_has_more(sysc_itr)) {
+		struct oval_syschar *sysc = oval_syschar_iterator_next(sysc_itr);
+		struct oval_object *object = oval_syschar_get_object(sysc);
+		struct oval_probe_stamps *stamps;
+
+		switch (oval_syschar_get_flag(sysc)) {
+		case SYSCHAR_FLAG_COMPLETE:
+		case SYSCHAR_FLAG_DOES_NOT_EXIST:
+			break;
+		default:
+			continue;
+		}
+		if (object == NULL || oval_syschar_get_variable_instance(sysc) != 1)
+			continue;
+
+		stamps = oval_probe_incr_stamp(incr, object, sysc);
+		if (stamps == NULL)
+			continue;
+
+		fprintf(fp, "object %s %d\n", oval_object_get_id(object), stamps->version);
+		for (i = 0; i < stamps->count; ++i) {
+			const struct oval_probe_stamp *s = &stamps->stamps[i];
+
+			fprintf(fp, "stamp %d %llu %llu %llu %lld %lld %lld %lld %s\n", s->exists ? 1 : 0,
+				s->dev, s->ino, s->size, s->mtime_sec, s->mtime_nsec, s->ctime_sec, s->ctime_nsec, s->path);
+		}
+		oval_probe_stamps_free(stamps);
+		++saved;
+	}
+	oval_syschar_iterator_free(sysc_itr);
+
+	if (fclose(fp) != 0) {
+		dW("Can't write the incremental collection state '%s': %s.", stamps_tmp, strerror(errno));
+		ret = -1;
+		goto cleanup;
+	}
+
+	if (oval_syschar_model_export(model, model_tmp) < 0) {
+		dW("Can't write the system characteristics for the incremental collection '%s'.", model_tmp);
+		ret = -1;
+		goto cleanup;
+	}
+
+	/* the model first: old stamps which still match describe the new model as well,
+	 * new stamps with the old model wouldn't */
+	if (rename(model_tmp, incr->model_path) != 0 || rename(stamps_tmp, incr->stamps_path) != 0) {
+		dW("Can't write the incremental collection state '%s': %s.", incr->stamps_path, strerror(errno));
+		ret = -1;
+		goto cleanup;
+	}
+
+	dI("Kept the system characteristics of %zu objects for the incremental collection.", saved);
+
+cleanup:
+	if (ret != 0) {
+		unlink(stamps_tmp);
+		unlink(model_tmp);
+	}
+	oscap_free(stamps_tmp);
+	oscap_free(model_tmp);
+	return ret;
+}
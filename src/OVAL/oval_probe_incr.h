@@ -0,0 +1,57 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef OVAL_PROBE_INCR_H
+#define OVAL_PROBE_INCR_H
+
+#include "public/oval_definitions.h"
+#include "public/oval_system_characteristics.h"
+#include "common/util.h"
+
+OSCAP_HIDDEN_START;
+
+/* directory with the system characteristics of the previous evaluations */
+#define OVAL_PROBE_INCR_ENV "OSCAP_INCREMENTAL"
+
+/*
+ * Incremental collection. The system characteristics of the objects whose
+ * inputs can be told unchanged are kept between the evaluations together
+ * with the stat(2) stamps of the inputs: the files and directories of the
+ * file objects with a fixed path, the package databases of the package
+ * objects. If all the stamps of an object match, its system characteristics
+ * are copied from the previous evaluation instead of being collected again.
+ * The other objects (processes, network, recursive or pattern paths,
+ * variables) are always collected.
+ */
+struct oval_probe_incr;
+
+/* NULL unless OSCAP_INCREMENTAL names a directory */
+struct oval_probe_incr *oval_probe_incr_new(struct oval_definition_model *model);
+void oval_probe_incr_free(struct oval_probe_incr *incr);
+
+/* copy the system characteristics of an unchanged object to the model, NULL if it has to be collected */
+struct oval_syschar *oval_probe_incr_reuse(struct oval_probe_incr *incr, struct oval_syschar_model *model,
+					   struct oval_object *object);
+
+/* stamp the inputs of the collected objects and keep the model for the next evaluation */
+int oval_probe_incr_save(struct oval_probe_incr *incr, struct oval_syschar_model *model);
+
+OSCAP_HIDDEN_END;
+
+#endif /* OVAL_PROBE_INCR_H */
@@ -0,0 +1,245 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "common/_error.h"
+#include "common/assume.h"
+#include "common/debug_priv.h"
+#include "probes/probe/probe.h"
+#include "oval_probe_lib.h"
+#include "oval_sexp.h"
+#include "oval_probe_stats.h"
+
+static const oval_probe_lib_t __probe_lib[] = {
+        { (oval_subtype_t)OVAL_INDEPENDENT_FAMILY, &oval_probe_lib_family_main }
+};
+
+#define __PROBE_LIB_COUNT (sizeof __probe_lib / sizeof __probe_lib[0])
+
+#if !defined(HAVE_ATOMIC_BUILTINS)
+static pthread_mutex_t __item_id_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+static uint32_t __item_id = 0;
+
+static const oval_probe_lib_t *oval_probe_lib_lookup(oval_subtype_t type)
+{
+        size_t i;
+
+        for (i = 0; i < __PROBE_LIB_COUNT; ++i)
+                if (__probe_lib[i].type == type)
+                        return (&__probe_lib[i]);
+
+        return (NULL);
+}
+
+bool oval_probe_lib_enabled(void)
+{
+        char *env;
+
+        env = getenv(OVAL_PROBE_LIB_ENV);
+
+        if (env == NULL || strcmp(env, "0") == 0)
+                return (false);
+        if (getenv("OSCAP_PROBE_ROOT") != NULL) {
+                dI("Offline mode, not using in-process probes");
+                return (false);
+        }
+
+        return (true);
+}
+
+bool oval_probe_lib_supported(oval_subtype_t type)
+{
+        return (oval_probe_lib_lookup(type) != NULL);
+}
+
+/*
+ * Items collected in-process don't go through the item cache, they just
+ * get a unique ID like the cached items do and are added to the collected
+ * object.
+ */
+int oval_probe_lib_item_collect(probe_ctx *ctx, SEXP_t *item)
+{
+        SEXP_t  *name_ref, *prev_id;
+        SEXP_t   uniq_id;
+        uint32_t local_id;
+
+        assume_d(ctx != NULL, -1);
+        assume_d(ctx->probe_out != NULL, -1);
+        assume_d(item != NULL, -1);
+
+        if (probe_filter_item(ctx->filters, item)) {
+                SEXP_free(item);
+                return (1);
+        }
+
+#if defined(HAVE_ATOMIC_BUILTINS)
+        local_id = __sync_add_and_fetch(&__item_id, 1);
+#else
+        pthread_mutex_lock(&__item_id_lock);
+        local_id = ++__item_id;
+        pthread_mutex_unlock(&__item_id_lock);
+#endif
+        SEXP_string_newf_r(&uniq_id, "1%05u%u", getpid(), local_id);
+
+        name_ref = SEXP_listref_first(item);
+        prev_id  = SEXP_list_replace(name_ref, 3, &uniq_id);
+
+        SEXP_free(prev_id);
+        SEXP_free_r(&uniq_id);
+        SEXP_free(name_ref);
+
+        probe_cobj_add_item(ctx->probe_out, item);
+        SEXP_free(item);
+
+        return (0);
+}
+
+int oval_probe_lib_setoption(int option, ...)
+{
+        /* The options only affect the probe runtime, which isn't used here */
+        return (0);
+}
+
+static int oval_probe_lib_eval(oval_pext_t *pext, const oval_probe_lib_t *lib,
+                               struct oval_syschar *syschar, int flags)
+{
+        struct probe_ctx pctx;
+        struct oval_object *object;
+        struct oval_sysitem_iterator *items;
+        struct timespec start;
+        SEXP_t *s_obj, *s_cobj, *mask;
+        size_t bytes, count;
+        char *key = NULL;
+        int ret;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        object = oval_syschar_get_object(syschar);
+        ret = oval_object_to_sexp(pext->sess_ptr, oval_subtype_to_str(oval_object_get_subtype(object)), syschar, &s_obj);
+
+        if (ret != 0)
+                return (1);
+
+        if (!(flags & OVAL_PDFLAG_NOREPLY)) {
+                key = oval_object_sexp_key(s_obj);
+                if (oval_probe_ext_content_reuse(pext, key, syschar)) {
+                        oscap_free(key);
+                        SEXP_free(s_obj);
+                        return (0);
+                }
+        }
+
+        mask   = probe_obj_getmask(s_obj);
+        s_cobj = probe_cobj_new(SYSCHAR_FLAG_UNKNOWN, NULL, NULL, mask);
+        SEXP_free(mask);
+
+        pctx.probe_in  = s_obj;
+        pctx.probe_out = s_cobj;
+        pctx.filters   = NULL;
+        pctx.icache    = NULL;
+
+        ret = lib->probe_main(&pctx, NULL);
+        SEXP_free(s_obj);
+
+        if (ret != 0) {
+                oscap_seterr(OSCAP_EFAMILY_OVAL, "In-process probe (%s) reported an error: %d",
+                             oval_subtype_to_str(lib->type), ret);
+                SEXP_free(s_cobj);
+                oscap_free(key);
+                return (-1);
+        }
+
+        if (flags & OVAL_PDFLAG_NOREPLY) {
+                SEXP_free(s_cobj);
+                return (0);
+        }
+
+        probe_cobj_compute_flag(s_cobj);
+        bytes = SEXP_sizeof(s_cobj);
+        ret = oval_sexp_to_sysch(s_cobj, syschar);
+        SEXP_free(s_cobj);
+
+        items = oval_syschar_get_sysitem(syschar);
+        for (count = 0; oval_sysitem_iterator_has_more(items); ++count)
+                oval_sysitem_iterator_next(items);
+        oval_sysitem_iterator_free(items);
+
+        oval_probe_stats_collected(pext->stats, object, oval_probe_stats_elapsed(&start), count, bytes);
+
+        if (ret == 0)
+                oval_probe_ext_content_add(pext, key, syschar);
+        oscap_free(key);
+
+        return (ret);
+}
+
+int oval_probe_lib_handler(oval_subtype_t type, void *ptr, int act, ...)
+{
+        int          ret = 0;
+        va_list      ap;
+        oval_pext_t *pext = (oval_pext_t *)ptr;
+
+        va_start(ap, act);
+
+        switch(act) {
+        case PROBE_HANDLER_ACT_EVAL:
+        {
+                const oval_probe_lib_t *lib;
+                struct oval_syschar *sys;
+                int flags;
+
+                sys   = va_arg(ap, struct oval_syschar *);
+                flags = va_arg(ap, int);
+                lib   = oval_probe_lib_lookup(oval_object_get_subtype(oval_syschar_get_object(sys)));
+
+                if (lib == NULL) {
+                        oscap_seterr(OSCAP_EFAMILY_OVAL, "internal error");
+                        ret = -1;
+                        break;
+                }
+
+                ret = oval_probe_lib_eval(pext, lib, sys, flags);
+                break;
+        }
+        case PROBE_HANDLER_ACT_OPEN:
+        case PROBE_HANDLER_ACT_INIT:
+        case PROBE_HANDLER_ACT_RESET:
+        case PROBE_HANDLER_ACT_ABORT:
+        case PROBE_HANDLER_ACT_FREE:
+        case PROBE_HANDLER_ACT_CLOSE:
+                /* nothing is kept between the evaluations */
+                break;
+        default:
+                errno = EINVAL;
+                ret = -1;
+        }
+
+        va_end(ap);
+        return (ret);
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef OVAL_PROBE_LIB_H
+#define OVAL_PROBE_LIB_H
+
+#include <stdbool.h>
+#include "oval_probe_ext.h"
+#include "probes/public/probe-api.h"
+#include "common/util.h"
+
+OSCAP_HIDDEN_START;
+
+/*
+ * In-process probes
+ *
+ * Probe implementations which don't need the probe runtime (item cache,
+ * worker threads, SEAP commands) can be compiled into the library. Their
+ * probe_main function is then called directly from the session's handler
+ * table instead of starting the probe executable. The sources are shared
+ * with the probe executables; the wrappers rename the entry points and
+ * route the runtime calls to the functions below.
+ *
+ * The mode is enabled by setting OSCAP_PROBE_INPROCESS in the environment.
+ * It is never used for offline scans, because the probe can't chroot into
+ * OSCAP_PROBE_ROOT without affecting the whole process.
+ */
+#define OVAL_PROBE_LIB_ENV "OSCAP_PROBE_INPROCESS"
+
+typedef struct {
+        oval_subtype_t type;
+        int (*probe_main)(probe_ctx *, void *);
+} oval_probe_lib_t;
+
+/**
+ * Check whether the in-process mode was requested and can be used.
+ */
+bool oval_probe_lib_enabled(void);
+
+/**
+ * Check whether there is an in-process implementation of the given probe.
+ */
+bool oval_probe_lib_supported(oval_subtype_t type);
+
+int oval_probe_lib_handler(oval_subtype_t type, void *ptr, int act, ...);
+
+/* runtime replacements used by the wrapped probe sources */
+int oval_probe_lib_item_collect(probe_ctx *ctx, SEXP_t *item);
+int oval_probe_lib_setoption(int option, ...);
+
+/* probe entry points */
+void *oval_probe_lib_family_init(void);
+int   oval_probe_lib_family_main(probe_ctx *ctx, void *arg);
+
+OSCAP_HIDDEN_END;
+
+#endif /* OVAL_PROBE_LIB_H */
@@ -0,0 +1,34 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * The family probe compiled into the library, see oval_probe_lib.h
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "oval_probe_lib.h"
+
+#define probe_init         oval_probe_lib_family_init
+#define probe_main         oval_probe_lib_family_main
+#define probe_item_collect oval_probe_lib_item_collect
+#define probe_setoption    oval_probe_lib_setoption
+
+#include "probes/independent/family.c"
@@ -47,6 +47,7 @@
 #include "_oval_probe_handler.h"
 #include "oval_probe_impl.h"
 #include "oval_probe_ext.h"
+#include "oval_probe_lib.h"
 #include "oval_probe_meta.h"
 
 #if defined(OSCAP_THREAD_SAFE)
@@ -121,6 +122,8 @@ static void __init_once(void)
 static void oval_probe_session_init(oval_probe_session_t *sess, struct oval_syschar_model *model)
 {
         void *handler_arg;
+        oval_probe_handler_t *handler;
+        bool inprocess;
         register size_t i;
 
         sess->ph = oval_phtbl_new();
@@ -129,20 +132,27 @@ static void oval_probe_session_init(oval_probe_session_t *sess, struct oval_sysc
         sess->pext = oval_pext_new();
         sess->pext->model    = &sess->sys_model;
         sess->pext->sess_ptr = sess;
+        sess->pext->stats    = sess->stats;
 
         __init_once();
 
         dD("__probe_meta_count = %zu", OSCAP_GSYM(__probe_meta_count));
 
+        inprocess = oval_probe_lib_enabled();
+
         for (i = 0; i < OSCAP_GSYM(__probe_meta_count); ++i) {
                 handler_arg = NULL;
+                handler     = OSCAP_GSYM(__probe_meta)[i].handler;
 
                 if (OSCAP_GSYM(__probe_meta)[i].flags & OVAL_PROBEMETA_EXTERNAL)
                         handler_arg = sess->pext;
 
+                if (inprocess && oval_probe_lib_supported(OSCAP_GSYM(__probe_meta)[i].otype))
+                        handler = &oval_probe_lib_handler;
+
                 oval_probe_handler_set(sess->ph,
 				       OSCAP_GSYM(__probe_meta)[i].otype,
-				       OSCAP_GSYM(__probe_meta)[i].handler, handler_arg);
+				       handler, handler_arg);
         }
 
         oval_probe_handler_set(sess->ph, OVAL_SUBTYPE_ALL, oval_probe_ext_handler, sess->pext); /* special case for reset */
@@ -151,6 +161,8 @@ static void oval_probe_session_init(oval_probe_session_t *sess, struct oval_sysc
 oval_probe_session_t *oval_probe_session_new(struct oval_syschar_model *model)
 {
         oval_probe_session_t *sess = oscap_talloc(oval_probe_session_t);
+        sess->stats = oval_probe_stats_tbl_new();
+        sess->incr = oval_probe_incr_new(oval_syschar_model_get_definition_model(model));
         oval_probe_session_init(sess, model);
         return sess;
 }
@@ -176,6 +188,12 @@ void oval_probe_session_reinit(oval_probe_session_t *sess, struct oval_syschar_m
 void oval_probe_session_destroy(oval_probe_session_t *sess)
 {
 	oval_probe_session_free(sess);
+	if (sess != NULL) {
+		oval_probe_stats_save(sess->stats);
+		oval_probe_stats_tbl_free(sess->stats);
+		oval_probe_incr_save(sess->incr, sess->sys_model);
+		oval_probe_incr_free(sess->incr);
+	}
 	oscap_free(sess);
 }
 
@@ -232,3 +250,23 @@ struct oval_syschar_model *oval_probe_session_getmodel(oval_probe_session_t *ses
 }
 
 /// @}
+
+int oval_probe_session_get_type_stats(oval_probe_session_t *sess, oval_subtype_t type, struct oval_probe_stats *stats)
+{
+	return oval_probe_stats_get_type(sess->stats, type, stats);
+}
+
+int oval_probe_session_get_object_stats(oval_probe_session_t *sess, const char *object_id, struct oval_probe_stats *stats)
+{
+	return oval_probe_stats_get_object(sess->stats, object_id, stats);
+}
+
+void oval_probe_session_print_stats(oval_probe_session_t *sess, FILE *out)
+{
+	oval_probe_stats_print(sess->stats, out);
+}
+
+double oval_probe_session_get_cost(oval_probe_session_t *sess, oval_subtype_t type)
+{
+	return oval_probe_stats_cost(sess->stats, type);
+}
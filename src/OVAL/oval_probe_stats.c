@@ -0,0 +1,330 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "common/alloc.h"
+#include "common/debug_priv.h"
+#include "adt/oval_collection_impl.h"
+#include "adt/oval_string_map_impl.h"
+#include "public/oval_definitions.h"
+#include "oval_probe_impl.h"
+#include "oval_probe_stats.h"
+
+#define OVAL_PROBE_STATS_TOP 10
+
+struct oval_probe_stats_tbl {
+	pthread_mutex_t lock;
+	struct oval_string_map *types;   /**< probe type name -> struct oval_probe_stats */
+	struct oval_string_map *objects; /**< object id -> struct oval_probe_stats */
+	struct oval_string_map *history; /**< probe type name -> struct oval_probe_stats */
+};
+
+static struct oval_probe_stats *_stats_get(struct oval_string_map *map, const char *key)
+{
+	struct oval_probe_stats *stats = oval_string_map_get_value(map, key);
+
+	if (stats == NULL) {
+		stats = oscap_calloc(1, sizeof(struct oval_probe_stats));
+		oval_string_map_put(map, key, stats);
+	}
+	return stats;
+}
+
+static void _stats_add(struct oval_probe_stats *dst, const struct oval_probe_stats *src)
+{
+	dst->objects += src->objects;
+	dst->cache_hits += src->cache_hits;
+	dst->shared += src->shared;
+	dst->items += src->items;
+	dst->bytes += src->bytes;
+	dst->time += src->time;
+}
+
+static void oval_probe_stats_load(struct oval_probe_stats_tbl *tbl)
+{
+	struct oval_probe_stats stats;
+	const char *path;
+	char line[256], name[128];
+	FILE *fp;
+
+	path = getenv(OVAL_PROBE_STATS_ENV);
+	if (path == NULL || *path == '\0')
+		return;
+
+	fp = fopen(path, "r");
+	if (fp == NULL) {
+		if (errno != ENOENT)
+			dW("Can't read the probe statistics '%s': %s.", path, strerror(errno));
+		return;
+	}
+
+	while (fgets(line, sizeof line, fp) != NULL) {
+		if (line[0] == '#')
+			continue;
+
+		memset(&stats, 0, sizeof stats);
+		if (sscanf(line, "%127s %lu %lu %lu %llu %lf", name, &stats.objects, &stats.cache_hits,
+			   &stats.items, &stats.bytes, &stats.time) != 6) {
+			dW("Ignoring a malformed line of the probe statistics '%s'.", path);
+			continue;
+		}
+		_stats_add(_stats_get(tbl->history, name), &stats);
+	}
+
+	fclose(fp);
+}
+
+struct oval_probe_stats_tbl *oval_probe_stats_tbl_new(void)
+{
+	struct oval_probe_stats_tbl *tbl;
+
+	tbl = oscap_talloc(struct oval_probe_stats_tbl);
+	pthread_mutex_init(&tbl->lock, NULL);
+	tbl->types = oval_string_map_new();
+	tbl->objects = oval_string_map_new();
+	tbl->history = oval_string_map_new();
+
+	oval_probe_stats_load(tbl);
+
+	return tbl;
+}
+
+void oval_probe_stats_tbl_free(struct oval_probe_stats_tbl *tbl)
+{
+	if (tbl == NULL)
+		return;
+
+	oval_string_map_free(tbl->types, (oscap_destruct_func) oscap_free);
+	oval_string_map_free(tbl->objects, (oscap_destruct_func) oscap_free);
+	oval_string_map_free(tbl->history, (oscap_destruct_func) oscap_free);
+	pthread_mutex_destroy(&tbl->lock);
+	oscap_free(tbl);
+}
+
+void oval_probe_stats_collected(struct oval_probe_stats_tbl *tbl, struct oval_object *object,
+				double seconds, size_t items, size_t bytes)
+{
+	struct oval_probe_stats stats;
+
+	memset(&stats, 0, sizeof stats);
+	stats.objects = 1;
+	stats.items = items;
+	stats.bytes = bytes;
+	stats.time = seconds;
+
+	pthread_mutex_lock(&tbl->lock);
+	_stats_add(_stats_get(tbl->types, oval_subtype_to_str(oval_object_get_subtype(object))), &stats);
+	_stats_add(_stats_get(tbl->objects, oval_object_get_id(object)), &stats);
+	pthread_mutex_unlock(&tbl->lock);
+}
+
+void oval_probe_stats_hit(struct oval_probe_stats_tbl *tbl, struct oval_object *object)
+{
+	pthread_mutex_lock(&tbl->lock);
+	_stats_get(tbl->types, oval_subtype_to_str(oval_object_get_subtype(object)))->cache_hits++;
+	_stats_get(tbl->objects, oval_object_get_id(object))->cache_hits++;
+	pthread_mutex_unlock(&tbl->lock);
+}
+
+void oval_probe_stats_shared(struct oval_probe_stats_tbl *tbl, struct oval_object *object)
+{
+	pthread_mutex_lock(&tbl->lock);
+	_stats_get(tbl->types, oval_subtype_to_str(oval_object_get_subtype(object)))->shared++;
+	_stats_get(tbl->objects, oval_object_get_id(object))->shared++;
+	pthread_mutex_unlock(&tbl->lock);
+}
+
+static int _stats_copy(struct oval_probe_stats_tbl *tbl, struct oval_string_map *map, const char *key,
+		       struct oval_probe_stats *stats)
+{
+	struct oval_probe_stats *found;
+
+	if (key == NULL)
+		return -1;
+
+	pthread_mutex_lock(&tbl->lock);
+	found = oval_string_map_get_value(map, key);
+	if (found != NULL)
+		*stats = *found;
+	pthread_mutex_unlock(&tbl->lock);
+
+	return found != NULL ? 0 : -1;
+}
+
+int oval_probe_stats_get_type(struct oval_probe_stats_tbl *tbl, oval_subtype_t type, struct oval_probe_stats *stats)
+{
+	return _stats_copy(tbl, tbl->types, oval_subtype_to_str(type), stats);
+}
+
+int oval_probe_stats_get_object(struct oval_probe_stats_tbl *tbl, const char *object_id, struct oval_probe_stats *stats)
+{
+	return _stats_copy(tbl, tbl->objects, object_id, stats);
+}
+
+double oval_probe_stats_cost(struct oval_probe_stats_tbl *tbl, oval_subtype_t type)
+{
+	struct oval_probe_stats total, *stats;
+	const char *name = oval_subtype_to_str(type);
+
+	if (name == NULL)
+		return -1;
+
+	memset(&total, 0, sizeof total);
+
+	pthread_mutex_lock(&tbl->lock);
+	if ((stats = oval_string_map_get_value(tbl->history, name)) != NULL)
+		_stats_add(&total, stats);
+	if ((stats = oval_string_map_get_value(tbl->types, name)) != NULL)
+		_stats_add(&total, stats);
+	pthread_mutex_unlock(&tbl->lock);
+
+	return total.objects > 0 ? total.time / total.objects : -1;
+}
+
+struct _stats_entry {
+	const char *key;
+	const struct oval_probe_stats *stats;
+};
+
+static int _stats_entry_timecmp(const void *a, const void *b)
+{
+	const struct _stats_entry *ea = a, *eb = b;
+
+	if (ea->stats->time != eb->stats->time)
+		return ea->stats->time > eb->stats->time ? -1 : 1;
+	return strcmp(ea->key, eb->key);
+}
+
+/* the entries of the map, the most expensive first */
+static struct _stats_entry *_stats_entries(struct oval_string_map *map, size_t *count)
+{
+	struct oval_iterator *keys;
+	struct _stats_entry *entries;
+	size_t n = 0;
+
+	entries = oscap_alloc(sizeof(struct _stats_entry) * (oval_string_map_get_count(map) + 1));
+
+	keys = oval_string_map_keys(map);
+	while (oval_collection_iterator_has_more(keys)) {
+		entries[n].key = oval_collection_iterator_next(keys);
+		entries[n].stats = oval_string_map_get_value(map, entries[n].key);
+		++n;
+	}
+	oval_collection_iterator_free(keys);
+
+	qsort(entries, n, sizeof(struct _stats_entry), _stats_entry_timecmp);
+	*count = n;
+	return entries;
+}
+
+static void _stats_print_entry(FILE *out, const char *key, const struct oval_probe_stats *stats)
+{
+	fprintf(out, "%-40s %8lu %8lu %8lu %10lu %12llu %10.3f\n", key, stats->objects, stats->cache_hits,
+		stats->shared, stats->items, stats->bytes, stats->time);
+}
+
+void oval_probe_stats_print(struct oval_probe_stats_tbl *tbl, FILE *out)
+{
+	struct _stats_entry *entries;
+	size_t i, count;
+
+	pthread_mutex_lock(&tbl->lock);
+
+	fprintf(out, "%-40s %8s %8s %8s %10s %12s %10s\n", "Probe", "Objects", "Reused", "Shared", "Items", "Bytes", "Time [s]");
+	entries = _stats_entries(tbl->types, &count);
+	for (i = 0; i < count; ++i)
+		_stats_print_entry(out, entries[i].key, entries[i].stats);
+	oscap_free(entries);
+
+	fprintf(out, "\n%-40s %8s %8s %8s %10s %12s %10s\n", "Object", "Objects", "Reused", "Shared", "Items", "Bytes", "Time [s]");
+	entries = _stats_entries(tbl->objects, &count);
+	for (i = 0; i < count && i < OVAL_PROBE_STATS_TOP; ++i)
+		_stats_print_entry(out, entries[i].key, entries[i].stats);
+	if (count > OVAL_PROBE_STATS_TOP)
+		fprintf(out, "(%zu more objects)\n", count - OVAL_PROBE_STATS_TOP);
+	oscap_free(entries);
+
+	pthread_mutex_unlock(&tbl->lock);
+}
+
+int oval_probe_stats_save(struct oval_probe_stats_tbl *tbl)
+{
+	struct oval_iterator *keys;
+	const char *path;
+	char *tmp_path;
+	FILE *fp;
+	int ret = 0;
+
+	path = getenv(OVAL_PROBE_STATS_ENV);
+	if (path == NULL || *path == '\0')
+		return 0;
+
+	tmp_path = oscap_sprintf("%s.tmp", path);
+	fp = fopen(tmp_path, "w");
+	if (fp == NULL) {
+		dW("Can't write the probe statistics '%s': %s.", tmp_path, strerror(errno));
+		oscap_free(tmp_path);
+		return -1;
+	}
+
+	pthread_mutex_lock(&tbl->lock);
+
+	/* the history becomes the totals of all the evaluations */
+	keys = oval_string_map_keys(tbl->types);
+	while (oval_collection_iterator_has_more(keys)) {
+		const char *name = oval_collection_iterator_next(keys);
+		_stats_add(_stats_get(tbl->history, name), oval_string_map_get_value(tbl->types, name));
+	}
+	oval_collection_iterator_free(keys);
+	oval_string_map_free(tbl->types, (oscap_destruct_func) oscap_free);
+	tbl->types = oval_string_map_new();
+
+	fprintf(fp, "# probe objects reused items bytes seconds\n");
+	keys = oval_string_map_keys(tbl->history);
+	while (oval_collection_iterator_has_more(keys)) {
+		const char *name = oval_collection_iterator_next(keys);
+		const struct oval_probe_stats *stats = oval_string_map_get_value(tbl->history, name);
+
+		fprintf(fp, "%s %lu %lu %lu %llu %f\n", name, stats->objects, stats->cache_hits,
+			stats->items, stats->bytes, stats->time);
+	}
+	oval_collection_iterator_free(keys);
+
+	pthread_mutex_unlock(&tbl->lock);
+
+	if (fclose(fp) != 0 || rename(tmp_path, path) != 0) {
+		dW("Can't write the probe statistics '%s': %s.", path, strerror(errno));
+		unlink(tmp_path);
+		ret = -1;
+	}
+
+	oscap_free(tmp_path);
+	return ret;
+}
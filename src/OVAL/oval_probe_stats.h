@@ -0,0 +1,73 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef OVAL_PROBE_STATS_H
+#define OVAL_PROBE_STATS_H
+
+#include <stdio.h>
+#include <time.h>
+#include "public/oval_probe_session.h"
+#include "common/util.h"
+
+OSCAP_HIDDEN_START;
+
+/* path of the file with the statistics of the previous evaluations */
+#define OVAL_PROBE_STATS_ENV "OSCAP_PROBE_STATS"
+
+/*
+ * Statistics of the objects collected by a probe session, per object and
+ * per probe type. The totals of the probe types are added to the history
+ * file when the session is destroyed, so the next evaluations can order
+ * the objects by their measured cost.
+ */
+struct oval_probe_stats_tbl;
+
+struct oval_probe_stats_tbl *oval_probe_stats_tbl_new(void);
+void oval_probe_stats_tbl_free(struct oval_probe_stats_tbl *tbl);
+
+/* a collection of the object took `seconds' and returned `items' in `bytes' */
+void oval_probe_stats_collected(struct oval_probe_stats_tbl *tbl, struct oval_object *object,
+				double seconds, size_t items, size_t bytes);
+/* the object was queried again and its system characteristics were reused */
+void oval_probe_stats_hit(struct oval_probe_stats_tbl *tbl, struct oval_object *object);
+/* the items of another object with the same content were copied to the object */
+void oval_probe_stats_shared(struct oval_probe_stats_tbl *tbl, struct oval_object *object);
+
+int oval_probe_stats_get_type(struct oval_probe_stats_tbl *tbl, oval_subtype_t type, struct oval_probe_stats *stats);
+int oval_probe_stats_get_object(struct oval_probe_stats_tbl *tbl, const char *object_id, struct oval_probe_stats *stats);
+
+/* mean wall time of an object of the type in the history and this session, -1 if unknown */
+double oval_probe_stats_cost(struct oval_probe_stats_tbl *tbl, oval_subtype_t type);
+
+void oval_probe_stats_print(struct oval_probe_stats_tbl *tbl, FILE *out);
+
+/* the history is loaded by oval_probe_stats_tbl_new and saved by oval_probe_stats_save */
+int oval_probe_stats_save(struct oval_probe_stats_tbl *tbl);
+
+static inline double oval_probe_stats_elapsed(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+OSCAP_HIDDEN_END;
+
+#endif /* OVAL_PROBE_STATS_H */
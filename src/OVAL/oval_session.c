@@ -24,9 +24,16 @@
 #include <config.h>
 #endif
 
+#include <errno.h>
+#include <fcntl.h>
 #include <libgen.h>
+#include <poll.h>
+#include <stdio.h>
+#include <time.h>
 #include <unistd.h>
 #include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
 #include <linux/limits.h>
 
 #include "common/alloc.h"
@@ -34,9 +41,11 @@
 #include "common/util.h"
 #include "common/_error.h"
 #include "common/oscapxml.h"
+#include "source/oscap_source_priv.h"
 #include "source/xslt_priv.h"
 #include "public/oval_agent_api.h"
 #include "public/oval_session.h"
+#include "oval_directives_impl.h"
 #include "../DS/public/ds_sds_session.h"
 #include "oscap_source.h"
 
@@ -46,6 +55,8 @@ static const char *oval_results_report = "oval-results-report.xsl";
 struct oval_session {
 	/* Main source assigned with the main file (SDS or OVAL) */
 	struct oscap_source *source;
+	/* the dictionary of libxml2 shared by the documents of the session */
+	xmlDict *xml_dict;
 	struct oval_definition_model *def_model;
 	struct oval_variable_model *var_model;
 	struct oval_results_model *res_model;
@@ -66,6 +77,8 @@ struct oval_session {
 	struct {
 		const char *results;
 		const char *report;
+		const char *delta;
+		const char *delta_baseline;
 	} export;
 
 	struct {
@@ -78,6 +91,9 @@ struct oval_session {
 	bool full_validation;
 	bool fetch_remote_resources;
 	download_progress_calllback_t progress;
+	unsigned int jobs;
+	bool state_pushdown;
+	bool short_circuit;
 };
 
 struct oval_session *oval_session_new(const char *filename)
@@ -87,7 +103,9 @@ struct oval_session *oval_session_new(const char *filename)
 
 	session = (struct oval_session *) oscap_calloc(1, sizeof(struct oval_session));
 
+	session->xml_dict = xmlDictCreate();
 	session->source = oscap_source_new_from_file(filename);
+	oscap_source_set_xml_dict(session->source, session->xml_dict);
 	if ((scap_type = oscap_source_get_scap_type(session->source)) == OSCAP_DOCUMENT_UNKNOWN) {
 		oval_session_free(session);
 		return NULL;
@@ -112,10 +130,12 @@ void oval_session_set_variables(struct oval_session *session, const char *filena
 
 	oscap_source_free(session->oval.variables);
 
-	if (filename != NULL)
+	if (filename != NULL) {
 		session->oval.variables = oscap_source_new_from_file(filename);
-	else
+		oscap_source_set_xml_dict(session->oval.variables, session->xml_dict);
+	} else {
 		session->oval.variables = NULL;	/* reset */
+	}
 }
 
 void oval_session_set_directives(struct oval_session *session, const char *filename)
@@ -124,10 +144,12 @@ void oval_session_set_directives(struct oval_session *session, const char *filen
 
 	oscap_source_free(session->oval.directives);
 
-	if (filename != NULL)
+	if (filename != NULL) {
 		session->oval.directives = oscap_source_new_from_file(filename);
-	else
+		oscap_source_set_xml_dict(session->oval.directives, session->xml_dict);
+	} else {
 		session->oval.directives = NULL;
+	}
 }
 
 void oval_session_set_validation(struct oval_session *session, bool validate, bool full_validation)
@@ -162,6 +184,16 @@ void oval_session_set_results_export(struct oval_session *session, const char *f
 	session->export.results = oscap_strdup(filename);
 }
 
+void oval_session_set_results_delta_export(struct oval_session *session, const char *baseline, const char *filename)
+{
+	__attribute__nonnull__(session);
+
+	oscap_free(session->export.delta_baseline);
+	oscap_free(session->export.delta);
+	session->export.delta_baseline = oscap_strdup(baseline);
+	session->export.delta = oscap_strdup(filename);
+}
+
 void oval_session_set_report_export(struct oval_session *session, const char *filename)
 {
 	__attribute__nonnull__(session);
@@ -300,11 +332,32 @@ int oval_session_load(struct oval_session *session)
 	return ret;
 }
 
+/* the exported results, if any, don't report the tests and their items */
+static bool oval_session_thin_results(struct oval_session *session)
+{
+	struct oval_directives_model *dir_model;
+	bool thin;
+
+	if (!session->export.results && !session->export.report && !session->export.delta)
+		return true;
+
+	if (session->oval.directives == NULL)
+		return false;
+
+	dir_model = oval_directives_model_new();
+	thin = oval_directives_model_import_source(dir_model, session->oval.directives) == 0
+		&& oval_directives_model_is_thin(dir_model);
+	oval_directives_model_free(dir_model);
+
+	return thin;
+}
+
 static int oval_session_setup_agent(struct oval_session *session)
 {
 	__attribute__nonnull__(session);
 
 	char *path_clone;
+	bool thin;
 
 	path_clone = oscap_strdup(oscap_source_readable_origin(session->oval.definitions));
 	if (path_clone == NULL) {
@@ -324,6 +377,20 @@ static int oval_session_setup_agent(struct oval_session *session)
 	oscap_free(path_clone);
 
 	oval_agent_set_product_name(session->sess, (char *)oscap_productname);
+	oval_agent_set_jobs(session->sess, session->jobs);
+	oval_agent_set_state_pushdown(session->sess, session->state_pushdown);
+
+	/* the skipped tests can't be reported by the full content of the results */
+	thin = oval_session_thin_results(session);
+	if (session->short_circuit && !thin) {
+		if (session->oval.directives == NULL)
+			dW("The results would contain the tests which aren't evaluated, evaluating the criteria completely.");
+		else
+			dW("The OVAL Directives ask for the full results, evaluating the criteria completely.");
+	}
+	oval_agent_set_short_circuit(session->sess, session->short_circuit && thin);
+	/* and nothing reads the items of the tests once they're evaluated */
+	oval_agent_set_release_items(session->sess, thin);
 	return 0;
 }
 
@@ -386,6 +453,196 @@ int oval_session_evaluate(struct oval_session *session, char *probe_root, agent_
 	return 0;
 }
 
+/*
+ * The evaluation of one target in a child of oval_session_evaluate_roots(),
+ * its errors are written to fd for the parent.
+ */
+static int oval_session_evaluate_root(struct oval_session *session, const char *root, const char *results, int fd)
+{
+	char *err;
+	size_t len, off;
+	ssize_t n;
+
+	/* the report and the delta would be written by all the targets */
+	oscap_free(session->export.results);
+	oscap_free(session->export.report);
+	oscap_free(session->export.delta);
+	session->export.results = oscap_strdup(results);
+	session->export.report  = NULL;
+	session->export.delta   = NULL;
+
+	if (oval_session_evaluate(session, (char *)root, NULL, NULL) == 0
+	    && oval_session_export(session) == 0 && !oscap_err())
+		return 0;
+
+	err = oscap_err_get_full_error();
+	if (err == NULL)
+		return 1;
+
+	dE("Evaluation of '%s' failed: %s", root, err);
+	len = strlen(err);
+	for (off = 0; off < len; off += n) {
+		n = write(fd, err + off, len - off);
+		if (n < 0 && errno == EINTR)
+			n = 0;
+		else if (n < 0)
+			break;
+	}
+	free(err);
+	return 1;
+}
+
+/* a running child of oval_session_evaluate_roots() */
+struct oval_session_child {
+	pid_t pid;
+	int fd;           /* the read end of the errors of the child */
+	char *err;
+	size_t err_len;
+};
+
+/* read what the child wrote, returns false once it closed its end */
+static bool oval_session_child_read(struct oval_session_child *child)
+{
+	char buf[512];
+	ssize_t n;
+
+	n = read(child->fd, buf, sizeof buf);
+	if (n < 0 && errno == EINTR)
+		return true;
+	if (n <= 0)
+		return false;
+
+	child->err = oscap_realloc(child->err, child->err_len + n + 1);
+	memcpy(child->err + child->err_len, buf, n);
+	child->err_len += n;
+	child->err[child->err_len] = '\0';
+	return true;
+}
+
+int oval_session_evaluate_roots(struct oval_session *session, const char **roots, const char **results,
+		size_t count, unsigned int jobs, int *statuses)
+{
+	__attribute__nonnull__(session);
+
+	struct oval_session_child *children;
+	struct pollfd *pfds;
+	size_t next = 0, running = 0, i, j;
+	int fds[2], status, ret = 0;
+	pid_t pid;
+
+	if (session->def_model == NULL) {
+		oscap_seterr(OSCAP_EFAMILY_OVAL, "No OVAL Definitions are loaded.");
+		return 1;
+	}
+
+	/* the children would share the probes of the session */
+	if (session->sess != NULL) {
+		oscap_seterr(OSCAP_EFAMILY_OVAL, "The OVAL session was already evaluated.");
+		return 1;
+	}
+
+	if (jobs == 0)
+		jobs = 1;
+	if (jobs > count)
+		jobs = count;
+
+	children = oscap_calloc(count, sizeof(struct oval_session_child));
+	pfds = oscap_calloc(jobs, sizeof(struct pollfd));
+
+	/* the children would write out what's buffered again */
+	fflush(stdout);
+	fflush(stderr);
+
+	while (next < count || running > 0) {
+		while (next < count && running < jobs) {
+			/* the probes don't keep the write end open, only the child does */
+			if (pipe2(fds, O_CLOEXEC) != 0) {
+				oscap_seterr(OSCAP_EFAMILY_GLIBC, "Can't start the evaluation of '%s': %s",
+						roots[next], strerror(errno));
+				statuses[next++] = 1;
+				ret = 1;
+				continue;
+			}
+
+			pid = fork();
+
+			if (pid < 0) {
+				oscap_seterr(OSCAP_EFAMILY_GLIBC, "Can't start the evaluation of '%s': %s",
+						roots[next], strerror(errno));
+				close(fds[0]);
+				close(fds[1]);
+				statuses[next++] = 1;
+				ret = 1;
+				continue;
+			}
+
+			if (pid == 0) {
+				close(fds[0]);
+				_exit(oval_session_evaluate_root(session, roots[next],
+						results != NULL ? results[next] : NULL, fds[1]));
+			}
+
+			close(fds[1]);
+			dI("Evaluating '%s' in process %ld.", roots[next], (long)pid);
+			children[next].pid = pid;
+			children[next].fd = fds[0];
+			next++;
+			running++;
+		}
+
+		if (running == 0)
+			break;
+
+		/*
+		 * Wait for the own children only, the caller may have others:
+		 * a child closes its pipe when it exits.
+		 */
+		for (i = 0, j = 0; i < next; ++i) {
+			if (children[i].pid <= 0)
+				continue;
+			pfds[j].fd = children[i].fd;
+			pfds[j].events = POLLIN;
+			pfds[j].revents = 0;
+			j++;
+		}
+
+		if (poll(pfds, j, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			/* waitpid() below blocks on the children one after the other */
+			for (j = 0; j < running; ++j)
+				pfds[j].revents = POLLHUP;
+		}
+
+		for (i = 0, j = 0; i < next; ++i) {
+			if (children[i].pid <= 0)
+				continue;
+			if (pfds[j++].revents == 0 || oval_session_child_read(&children[i]))
+				continue;
+
+			close(children[i].fd);
+			do
+				pid = waitpid(children[i].pid, &status, 0);
+			while (pid < 0 && errno == EINTR);
+
+			statuses[i] = pid == children[i].pid && WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : 1;
+			if (statuses[i] != 0) {
+				oscap_seterr(OSCAP_EFAMILY_OVAL, "Evaluation of '%s' failed: %s", roots[i],
+						children[i].err != NULL ? children[i].err : "unknown error");
+				ret = 1;
+			}
+
+			oscap_free(children[i].err);
+			children[i].pid = 0;
+			running--;
+		}
+	}
+
+	oscap_free(pfds);
+	oscap_free(children);
+	return ret;
+}
+
 int oval_session_export(struct oval_session *session)
 {
 	__attribute__nonnull__(session);
@@ -407,7 +664,7 @@ int oval_session_export(struct oval_session *session)
 
 	/* Get OVAL Results if evaluation or analyse has been done and apply
 	 * directives to them */
-	if (session->res_model && (session->export.results || session->export.report)) {
+	if (session->res_model && (session->export.results || session->export.report || session->export.delta)) {
 		oval_results_model_set_export_system_characteristics(session->res_model, session->export_sys_chars);
 		result = oval_results_model_export_source(session->res_model, dir_model, NULL);
 		filename = session->export.results;
@@ -425,6 +682,11 @@ int oval_session_export(struct oval_session *session)
 			goto cleanup;
 	}
 
+	if (session->export.delta && result) {	/* changes since the baseline */
+		if (oscap_source_save_delta_as(result, session->export.delta_baseline, session->export.delta) != 0)
+			goto cleanup;
+	}
+
 	if (session->export.report && result) {	/* export to HTML */
 		char pwd[PATH_MAX];
 
@@ -464,6 +726,34 @@ void oval_session_set_remote_resources(struct oval_session *session, bool allowe
 	session->progress = callback;
 }
 
+void oval_session_set_jobs(struct oval_session *session, unsigned int jobs)
+{
+	session->jobs = jobs;
+}
+
+void oval_session_set_state_pushdown(struct oval_session *session, bool pushdown)
+{
+	session->state_pushdown = pushdown;
+}
+
+void oval_session_set_short_circuit(struct oval_session *session, bool short_circuit)
+{
+	session->short_circuit = short_circuit;
+}
+
+int oval_session_print_probe_stats(struct oval_session *session, FILE *out)
+{
+	__attribute__nonnull__(session);
+
+	if (session->sess == NULL) {
+		oscap_seterr(OSCAP_EFAMILY_OVAL, "No evaluation was done in the session.");
+		return 1;
+	}
+
+	oval_probe_session_print_stats(oval_agent_get_probe_session(session->sess), out);
+	return 0;
+}
+
 void oval_session_free(struct oval_session *session)
 {
 	if (session == NULL)
@@ -476,10 +766,14 @@ void oval_session_free(struct oval_session *session)
 	oscap_free(session->component_id);
 	oscap_free(session->export.results);
 	oscap_free(session->export.report);
+	oscap_free(session->export.delta);
+	oscap_free(session->export.delta_baseline);
 	if (session->sess)
 		oval_agent_destroy_session(session->sess);
 	if (session->def_model)
 		oval_definition_model_free(session->def_model);
 	ds_sds_session_free(session->sds_session);
+	if (session->xml_dict != NULL)
+		xmlDictFree(session->xml_dict);
 	oscap_free(session);
 }
@@ -43,21 +43,33 @@
 #include <assert.h>
 
 #include "oval_probe_impl.h"
+#include "_oval_probe_session.h"
 #include "oval_sexp.h"
 #include "probes/public/probe-api.h"
+#include "probes/probe/spill.h"
 #include "oval_definitions_impl.h"
 #include "oval_system_characteristics_impl.h"
 #include "adt/oval_string_map_impl.h"
 #include "common/debug_priv.h"
+#include "common/oscap_trace.h"
 #include "common/_error.h"
 #include "public/oval_version.h"
 #include "public/oval_schema_version.h"
 
+/* the memory of the system characteristics, see oscap_memory_report */
+#undef OSCAP_MEMORY_TAG
+#define OSCAP_MEMORY_TAG OSCAP_MEMORY_SYSCHAR
+
 
 SEXP_t *oval_value_to_sexp(struct oval_value *val, oval_datatype_t dtype)
+{
+	return oval_text_to_sexp(oval_value_get_text(val), dtype);
+}
+
+/* the conversions of oval_value_get_float() etc. without the oval_value */
+SEXP_t *oval_text_to_sexp(const char *text, oval_datatype_t dtype)
 {
 	SEXP_t *val_sexp = NULL;
-        char   *val_rptr = NULL;
 
 	switch (dtype) {
 	case OVAL_DATATYPE_EVR_STRING:
@@ -66,20 +78,22 @@ SEXP_t *oval_value_to_sexp(struct oval_value *val, oval_datatype_t dtype)
 	case OVAL_DATATYPE_IPV6ADDR:
 	case OVAL_DATATYPE_STRING:
 	case OVAL_DATATYPE_VERSION:
-                val_rptr = oval_value_get_text (val);
-                if (val_rptr != NULL) {
-                        val_sexp = SEXP_string_newf("%s", val_rptr);
+                if (text != NULL) {
+                        val_sexp = SEXP_string_new(text, strlen(text));
                 }
 
 		break;
 	case OVAL_DATATYPE_FLOAT:
-		val_sexp = SEXP_number_newf(oval_value_get_float(val));
+		if (text != NULL)
+			val_sexp = SEXP_number_newf(strtof(text, NULL));
 		break;
 	case OVAL_DATATYPE_INTEGER:
-		val_sexp = SEXP_number_newi_64(oval_value_get_integer(val));
+		if (text != NULL)
+			val_sexp = SEXP_number_newi_64(strtoll(text, NULL, 10));
 		break;
 	case OVAL_DATATYPE_BOOLEAN:
-		val_sexp = SEXP_number_newb(oval_value_get_boolean(val));
+		if (text != NULL)
+			val_sexp = SEXP_number_newb(strcmp(text, "false") != 0 && strcmp(text, "0") != 0);
 		break;
 	case OVAL_DATATYPE_BINARY:
 	case OVAL_DATATYPE_FILESET_REVISION:
@@ -104,14 +118,14 @@ static SEXP_t *oval_entity_to_sexp(struct oval_entity *ent)
 	oval_datatype_t datatype;
 	oval_entity_varref_type_t vr_type;
 
-	elm_name = SEXP_list_new(r0 = SEXP_string_newf("%s", oval_entity_get_name(ent)),
+	elm_name = SEXP_list_new(r0 = probe_ncache_ref(OSCAP_GSYM(ncache), oval_entity_get_name(ent)),
 				 /* operation */
-				 r1 = SEXP_string_new(":operation", 10),
+				 r1 = probe_ncache_attr_ref(OSCAP_GSYM(ncache), "operation"),
 				 r2 = SEXP_number_newu_32(oval_entity_get_operation(ent)), NULL);
 	SEXP_vfree(r0, r1, r2, NULL);
 
         if (oval_entity_get_mask(ent)) {
-            SEXP_list_add(elm_name, r0 = SEXP_string_new("mask", 4));
+            SEXP_list_add(elm_name, r0 = probe_ncache_ref(OSCAP_GSYM(ncache), "mask"));
             SEXP_free(r0);
         }
 
@@ -126,7 +140,7 @@ static SEXP_t *oval_entity_to_sexp(struct oval_entity *ent)
 		struct oval_variable *var;
 
 		var = oval_entity_get_variable(ent);
-		SEXP_list_add(elm_name, r0 = SEXP_string_new(":var_ref", 8));
+		SEXP_list_add(elm_name, r0 = probe_ncache_attr_ref(OSCAP_GSYM(ncache), "var_ref"));
 		SEXP_list_add(elm_name, r1 = SEXP_string_newf("%s", oval_variable_get_id(var)));
 		SEXP_list_add(elm, elm_name);
 		SEXP_vfree(r0, r1, elm_name, NULL);
@@ -153,14 +167,45 @@ static SEXP_t *oval_entity_to_sexp(struct oval_entity *ent)
 	return (elm);
 }
 
+/*
+ * The texts of the values of the variable: the array of the variable model
+ * for the bound external variables, which creates no oval_value objects, a
+ * copy of the pointers to be freed by the caller for the other ones.
+ */
+static int oval_variable_texts(struct oval_variable *var, const char *const **texts, const char ***copy)
+{
+	struct oval_value_iterator *vit;
+	int count, alloc = 0;
+
+	*copy = NULL;
+	count = oval_variable_get_value_texts(var, texts, NULL);
+	if (count >= 0)
+		return count;
+
+	count = 0;
+	vit = oval_variable_get_values(var);
+	while (oval_value_iterator_has_more(vit)) {
+		if (count == alloc) {
+			alloc = alloc ? 2 * alloc : 8;
+			*copy = oscap_realloc(*copy, alloc * sizeof(char *));
+		}
+		(*copy)[count++] = oval_value_get_text(oval_value_iterator_next(vit));
+	}
+	oval_value_iterator_free(vit);
+
+	*texts = (const char *const *) *copy;
+	return count;
+}
+
 static int oval_varref_attr_to_sexp(void *sess, struct oval_entity *entity, struct oval_syschar *syschar, SEXP_t **out_sexp)
 {
 	unsigned int val_cnt = 0;
 	SEXP_t *val_lst, *val_sexp, *varref, *id_sexp, *val_cnt_sexp;
 	oval_datatype_t dt;
 	struct oval_variable *var;
-	struct oval_value_iterator *vit;
-	struct oval_value *val;
+	const char *const *texts = NULL;
+	const char **copy = NULL;
+	int count, i;
 	oval_syschar_collection_flag_t flag;
 	char msg[100];
 	int ret = 0;
@@ -175,10 +220,10 @@ static int oval_varref_attr_to_sexp(void *sess, struct oval_entity *entity, stru
 	switch (flag) {
 	case SYSCHAR_FLAG_COMPLETE:
 	case SYSCHAR_FLAG_INCOMPLETE:
-		vit = oval_variable_get_values(var);
-		if (oval_value_iterator_has_more(vit))
+		count = oval_variable_texts(var, &texts, &copy);
+		if (count > 0)
 			break;
-		oval_value_iterator_free(vit);
+		oscap_free(copy);
 		/* fall through */
 	case SYSCHAR_FLAG_DOES_NOT_EXIST:
 		snprintf(msg, sizeof(msg), "Referenced variable has no values (%s).", oval_variable_get_id(var));
@@ -197,17 +242,15 @@ static int oval_varref_attr_to_sexp(void *sess, struct oval_entity *entity, stru
 	}
 
 	val_lst = SEXP_list_new(NULL);
+	dt = oval_entity_get_datatype(entity);
 
-	while (oval_value_iterator_has_more(vit)) {
-		val = oval_value_iterator_next(vit);
-
-		dt = oval_entity_get_datatype(entity);
-		val_sexp = oval_value_to_sexp(val, dt);
+	for (i = 0; i < count; ++i) {
+		val_sexp = oval_text_to_sexp(texts[i], dt);
 		if (val_sexp == NULL) {
 			oval_syschar_add_new_message(syschar, "Failed to convert variable value.", OVAL_MESSAGE_LEVEL_ERROR);
 			oval_syschar_set_flag(syschar, SYSCHAR_FLAG_ERROR);
 			SEXP_free(val_lst);
-			oval_value_iterator_free(vit);
+			oscap_free(copy);
 			return -1;
 		}
 
@@ -215,7 +258,7 @@ static int oval_varref_attr_to_sexp(void *sess, struct oval_entity *entity, stru
 		SEXP_free(val_sexp);
 		++val_cnt;
 	}
-	oval_value_iterator_free(vit);
+	oscap_free(copy);
 
 	id_sexp = SEXP_string_newf("%s", oval_variable_get_id(var));
 	val_cnt_sexp = SEXP_number_newu(val_cnt);
@@ -233,7 +276,9 @@ static int oval_varref_attr_to_sexp(void *sess, struct oval_entity *entity, stru
 static int oval_varref_elm_to_sexp(void *sess, struct oval_variable *var, oval_datatype_t dt, SEXP_t **out_sexp, struct oval_syschar *syschar)
 {
 	SEXP_t *val_lst;
-	struct oval_value_iterator *val_itr;
+	const char *const *texts;
+	const char **copy;
+	int count, i;
 	oval_syschar_collection_flag_t flag;
 
 	if (oval_probe_query_variable(sess, var) != 0)
@@ -258,31 +303,55 @@ static int oval_varref_elm_to_sexp(void *sess, struct oval_variable *var, oval_d
 
 	val_lst = SEXP_list_new(NULL);
 
-	val_itr = oval_variable_get_values(var);
-	while (oval_value_iterator_has_more(val_itr)) {
-		struct oval_value *val;
+	count = oval_variable_texts(var, &texts, &copy);
+	for (i = 0; i < count; ++i) {
 		SEXP_t *vs;
 
-		val = oval_value_iterator_next(val_itr);
-		vs = oval_value_to_sexp(val, dt);
+		vs = oval_text_to_sexp(texts[i], dt);
 		if (vs == NULL) {
 			oscap_seterr(OSCAP_EFAMILY_OVAL, "Failed to convert OVAL value to SEXP: "
                                        "datatype: %s, text: %s.", oval_datatype_get_text(dt),
-                                       oval_value_get_text(val));
-			oval_value_iterator_free(val_itr);
+                                       texts[i]);
+			oscap_free(copy);
 			SEXP_free(val_lst);
 			return -1;
 		}
 		SEXP_list_add(val_lst, vs);
 		SEXP_free(vs);
 	}
-	oval_value_iterator_free(val_itr);
+	oscap_free(copy);
 
 	*out_sexp = val_lst;
 	return 0;
 }
 
-static SEXP_t *oval_filter_to_sexp(struct oval_filter *filter)
+/*
+ * The probes cache the objects and states by their ids. The ones sent for
+ * another variable instance are told apart by the instance, so the probes
+ * keep the results of the previous instance for the objects shared by both.
+ * The probes are shared by the sessions of the process, the ids of every
+ * session but the first one are suffixed by the namespace of the session.
+ */
+static SEXP_t *oval_cache_key_to_sexp(const char *id, int variable_instance, unsigned int ns)
+{
+	if (variable_instance > 1) {
+		if (ns > 1)
+			return SEXP_string_newf("%s#%d@%u", id, variable_instance, ns);
+		return SEXP_string_newf("%s#%d", id, variable_instance);
+	}
+	if (ns > 1)
+		return SEXP_string_newf("%s@%u", id, ns);
+	return SEXP_string_newf("%s", id);
+}
+
+static unsigned int oval_session_ns(void *sess)
+{
+	oval_probe_session_t *psess = (oval_probe_session_t *)sess;
+
+	return (psess != NULL && psess->pext != NULL ? psess->pext->ns : 1);
+}
+
+static SEXP_t *oval_filter_to_sexp(struct oval_filter *filter, int variable_instance, unsigned int ns)
 {
 	SEXP_t *elm, *attr, *r0, *r1;
 	oval_filter_action_t act;
@@ -295,13 +364,14 @@ static SEXP_t *oval_filter_to_sexp(struct oval_filter *filter)
 	attr = probe_attr_creat("action", r0 = SEXP_number_newu(act), NULL);
 	elm = probe_ent_creat1("filter",
 			       attr,
-			       r1 = SEXP_string_newf("%s", ste_id));
+			       r1 = oval_cache_key_to_sexp(ste_id, variable_instance, ns));
 	SEXP_vfree(attr, r0, r1, NULL);
 
 	return (elm);
 }
 
-static SEXP_t *oval_set_to_sexp(struct oval_setobject *set)
+static SEXP_t *oval_set_to_sexp(struct oval_setobject *set, struct oval_syschar_model *model, int variable_instance,
+			       unsigned int ns)
 {
 	SEXP_t *elm, *elm_name;
 	SEXP_t *r0, *r1, *r2;
@@ -327,7 +397,7 @@ static SEXP_t *oval_set_to_sexp(struct oval_setobject *set)
 
 			while (oval_setobject_iterator_has_more(sit)) {
 				subset = oval_setobject_iterator_next(sit);
-				SEXP_list_add(elm, r0 = oval_set_to_sexp(subset));
+				SEXP_list_add(elm, r0 = oval_set_to_sexp(subset, model, variable_instance, ns));
 				SEXP_free(r0);
 			}
 
@@ -342,10 +412,18 @@ static SEXP_t *oval_set_to_sexp(struct oval_setobject *set)
 
 			oit = oval_setobject_get_objects(set);
 			while (oval_object_iterator_has_more(oit)) {
+				struct oval_syschar *member;
+				int member_instance = 1;
+
 				obj = oval_object_iterator_next(oit);
 
+				/* the instance the member is (or is going to be) collected for */
+				member = oval_syschar_model_get_syschar(model, oval_object_get_id(obj));
+				if (member != NULL)
+					member_instance = oval_syschar_get_variable_instance_hint(member);
+
 				subelm = SEXP_list_new(r0 = SEXP_string_new("obj_ref", 7),
-						       r1 = SEXP_string_newf("%s", oval_object_get_id(obj)), NULL);
+						       r1 = oval_cache_key_to_sexp(oval_object_get_id(obj), member_instance, ns), NULL);
 				SEXP_free(r0);
 				SEXP_free(r1);
 
@@ -360,7 +438,7 @@ static SEXP_t *oval_set_to_sexp(struct oval_setobject *set)
 				struct oval_filter *fil;
 
 				fil = oval_filter_iterator_next(fit);
-				subelm = oval_filter_to_sexp(fil);
+				subelm = oval_filter_to_sexp(fil, variable_instance, ns);
 				SEXP_list_add(elm, subelm);
 				SEXP_free(subelm);
 			}
@@ -390,7 +468,7 @@ static SEXP_t *oval_behaviors_to_sexp(struct oval_behavior_iterator *bit)
 		attr_name = oval_behavior_get_key(behavior);
 		attr_val = oval_behavior_get_value(behavior);
 
-		SEXP_list_add(elm_name, r0 = SEXP_string_newf(":%s", attr_name));
+		SEXP_list_add(elm_name, r0 = probe_ncache_attr_ref(OSCAP_GSYM(ncache), attr_name));
 		SEXP_free(r0);
 
 		if (attr_val != NULL) {
@@ -410,7 +488,7 @@ int oval_object_to_sexp(void *sess, const char *typestr, struct oval_syschar *sy
 	unsigned int ent_cnt, varref_cnt;
 	int ret;
 	SEXP_t *obj_sexp, *elm, *varrefs, *ent_lst, *lst, *stmp;
-	SEXP_t *r0, *r1, *r2, *obj_attr, sm0, sm1;
+	SEXP_t *r0, *r1, *r2, *obj_attr, sm1;
 
 	struct oval_object *object;
 	struct oval_object_content_iterator *cit;
@@ -421,8 +499,11 @@ int oval_object_to_sexp(void *sess, const char *typestr, struct oval_syschar *sy
 	const char *obj_over;
 	char obj_name[128];
 	const char *obj_id;
+	int obj_inst;
+	unsigned int ns;
 
 	object = oval_syschar_get_object(syschar);
+	ns     = oval_session_ns(sess);
 
 	/*
 	 * Object name & attributes (id)
@@ -435,17 +516,25 @@ int oval_object_to_sexp(void *sess, const char *typestr, struct oval_syschar *sy
 
 	obj_over = oval_schema_version_to_cstr(oval_object_get_platform_schema_version(object));
 	obj_id   = oval_object_get_id(object);
-	obj_attr = probe_attr_creat("id", SEXP_string_new_r(&sm0, obj_id, strlen(obj_id)),
+	obj_inst = oval_syschar_get_variable_instance(syschar);
+	obj_attr = probe_attr_creat("id", r0 = oval_cache_key_to_sexp(obj_id, obj_inst, ns),
 	                            "oval_version", SEXP_string_new_r(&sm1, obj_over, strlen(obj_over)),
 	                            NULL);
 	oscap_free(obj_over);
 
 	obj_sexp = probe_obj_new(obj_name, obj_attr);
 
-	SEXP_free_r(&sm0);
+	SEXP_free(r0);
 	SEXP_free_r(&sm1);
 	SEXP_free(obj_attr);
 
+	/* the probes may skip the lookups of the other entities */
+	if (sess != NULL && ((oval_probe_session_t *)sess)->pext != NULL
+	    && (r0 = oval_probe_ext_projection(((oval_probe_session_t *)sess)->pext, object)) != NULL) {
+		probe_item_attr_add(obj_sexp, "entities", r0);
+		SEXP_free(r0);
+	}
+
 	/*
 	 * Object content
 	 */
@@ -531,7 +620,8 @@ int oval_object_to_sexp(void *sess, const char *typestr, struct oval_syschar *sy
 			break;
 
 		case OVAL_OBJECTCONTENT_SET:
-			elm = oval_set_to_sexp(oval_object_content_get_setobject(content));
+			elm = oval_set_to_sexp(oval_object_content_get_setobject(content),
+					       oval_syschar_get_model(syschar), obj_inst, ns);
 			break;
 
 		case OVAL_OBJECTCONTENT_FILTER: {
@@ -542,7 +632,7 @@ int oval_object_to_sexp(void *sess, const char *typestr, struct oval_syschar *sy
 			const char *action_text = oval_filter_action_get_text(action);
 			dI("Object '%s' has a filter that %ss items conforming to state '%s'.",
 					obj_id, action_text, ste_id);
-			elm = oval_filter_to_sexp(filter);
+			elm = oval_filter_to_sexp(filter, obj_inst, ns);
 			}
 			break;
 
@@ -564,6 +654,12 @@ int oval_object_to_sexp(void *sess, const char *typestr, struct oval_syschar *sy
 		SEXP_free(elm);
 	}
 
+	if (oval_object_get_pushdown_filter(object) != NULL) {
+		elm = oval_filter_to_sexp(oval_object_get_pushdown_filter(object), obj_inst, ns);
+		SEXP_list_add(ent_lst, elm);
+		SEXP_free(elm);
+	}
+
 	if (varrefs != NULL) {
 		// todo: SEXP_list_push()
 		stmp = SEXP_list_new(r0 = SEXP_string_new("varrefs", 7),
@@ -599,6 +695,63 @@ int oval_object_to_sexp(void *sess, const char *typestr, struct oval_syschar *sy
 	return (0);
 }
 
+static uint64_t oval_sexp_hash(uint64_t h, const uint8_t *buf, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; ++i) {
+		h ^= buf[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+char *oval_object_sexp_key(const SEXP_t *s_obj)
+{
+	SEXP_t *head, *elm, *skip;
+	strbuf_t *sb;
+	uint8_t *buf;
+	uint64_t h;
+	size_t len;
+	uint32_t i;
+
+	/* the objects not sent to the probes are cheap */
+	if ((skip = probe_obj_getattrval(s_obj, "skip_eval")) != NULL) {
+		SEXP_free(skip);
+		return NULL;
+	}
+
+	sb = strbuf_new(SEAP_STRBUF_MAX);
+
+	/* the name and the attributes but the id */
+	head = SEXP_list_first(s_obj);
+	for (i = 1; (elm = SEXP_list_nth(head, i)) != NULL; ++i) {
+		if (SEXP_strcmp(elm, ":id") == 0)
+			++i;
+		else
+			SEXP_sbprintf_t(elm, sb);
+		SEXP_free(elm);
+	}
+	SEXP_free(head);
+
+	/* the entities with the values of the variables, the filters, sets and behaviors */
+	for (i = 2; (elm = SEXP_list_nth(s_obj, i)) != NULL; ++i) {
+		strbuf_addc(sb, ' ');
+		SEXP_sbprintf_t(elm, sb);
+		SEXP_free(elm);
+	}
+
+	len = strbuf_length(sb);
+	buf = oscap_alloc(len + 1);
+	strbuf_copy(sb, buf, len);
+	strbuf_free(sb);
+
+	h = oval_sexp_hash(14695981039346656037ULL, buf, len);
+	oscap_free(buf);
+
+	return oscap_sprintf("%016" PRIx64 "-%zu", h, len);
+}
+
 static SEXP_t *oval_record_field_STATE_to_sexp(struct oval_record_field *rf)
 {
 	struct oval_entity *rf_ent;
@@ -663,10 +816,10 @@ static struct oval_record_field *oval_record_field_ITEM_from_sexp(SEXP_t *sexp)
 	return rf;
 }
 
-int oval_state_to_sexp(void *sess, struct oval_state *state, SEXP_t **out_sexp)
+int oval_state_to_sexp(void *sess, struct oval_state *state, const SEXP_t *key, SEXP_t **out_sexp)
 {
 	SEXP_t *ste, *ste_name, *ste_ent;
-	SEXP_t *r0, *r1, *r2, *r3, *r4;
+	SEXP_t *r0, *r1, *r3, *r4;
 	char buffer[128];
 	size_t buflen;
 	const char *subtype_name;
@@ -684,13 +837,13 @@ int oval_state_to_sexp(void *sess, struct oval_state *state, SEXP_t **out_sexp)
 
 	ste_name = SEXP_list_new(r0 = SEXP_string_new(buffer, buflen),
 				 r1 = SEXP_string_new(":id", 3),
-				 r2 = SEXP_string_newf("%s", oval_state_get_id(state)),
+				 (SEXP_t *)key,
 				 r3 = SEXP_string_new(":operator", 9),
 				 r4 = SEXP_number_newu(oval_state_get_operator(state)),
 				 NULL);
 
 	ste = SEXP_list_new(ste_name, NULL);
-	SEXP_vfree(r0, r1, r2, r3, r4, ste_name, NULL);
+	SEXP_vfree(r0, r1, r3, r4, ste_name, NULL);
 
 	contents = oval_state_get_contents(state);
 	while (oval_state_content_iterator_has_more(contents)) {
@@ -792,14 +945,17 @@ static struct oval_message *oval_sexp_to_msg(const SEXP_t *msg)
 
 static struct oval_sysent *oval_sexp_to_sysent(struct oval_syschar_model *model, struct oval_sysitem *item, SEXP_t * sexp, struct oval_string_map *mask_map)
 {
-	char *key;
+	char key[128];
 	oval_syschar_status_t status;
 	oval_datatype_t dt;
 	struct oval_sysent *ent;
+	size_t key_len;
 
-	key = probe_ent_getname(sexp);
-	if (!key)
+	key_len = probe_ent_getname_r(sexp, key, sizeof key);
+	if (key_len == 0 || key_len >= sizeof key - 1) {
+		dE("Invalid or too long entity name.");
 		return NULL;
+	}
 
 	if (strcmp("message", key) == 0 && item != NULL) {
 	    struct oval_message *msg;
@@ -830,7 +986,8 @@ static struct oval_sysent *oval_sexp_to_sysent(struct oval_syschar_model *model,
 	dt = probe_ent_getdatatype(sexp);
 
 	ent = oval_sysent_new(model);
-	oval_sysent_set_name(ent, key);
+	/* the entities of all the items share a few names */
+	oval_sysent_set_shared_name(ent, oval_syschar_model_intern_name(model, key));
 	oval_sysent_set_status(ent, status);
 	oval_sysent_set_datatype(ent, dt);
 	if (mask_map == NULL || oval_string_map_get_value(mask_map, key) == NULL)
@@ -854,6 +1011,7 @@ static struct oval_sysent *oval_sexp_to_sysent(struct oval_syschar_model *model,
 		SEXP_free(srfs);
 	} else {
 		char val[64], *valp = val;
+		const char *shared;
 		SEXP_t *sval;
 		SEXP_numtype_t sndt;
 
@@ -904,9 +1062,19 @@ static struct oval_sysent *oval_sexp_to_sysent(struct oval_syschar_model *model,
 			break;
 		}
 
-		oval_sysent_set_value(ent, valp);
-		if (valp != val)
-			oscap_free(valp);
+		/*
+		 * The values repeated by many items are kept once, the string
+		 * copied out of the S-expression is kept as is otherwise.
+		 */
+		if (valp != NULL && (shared = oval_syschar_model_intern_value(model, key, valp)) != NULL) {
+			oval_sysent_set_shared_value(ent, shared);
+			if (valp != val)
+				oscap_free(valp);
+		} else if (valp == val) {
+			oval_sysent_set_value(ent, valp);
+		} else {
+			oval_sysent_take_value(ent, valp);
+		}
                 SEXP_free(sval);
 	}
 
@@ -927,7 +1095,7 @@ static struct oval_sysitem *oval_sexp_to_sysitem(struct oval_syschar_model *mode
 
 	sysitem = oval_syschar_model_get_sysitem(model, id);
 
-	if (sysitem) {
+	if (sysitem != NULL && !oval_sysitem_is_released(sysitem)) {
                 oscap_free(id);
 		return sysitem;
         }
@@ -959,14 +1127,17 @@ static struct oval_sysitem *oval_sexp_to_sysitem(struct oval_syschar_model *mode
 
 	int status = probe_ent_getstatus(sexp);
 
-	sysitem = oval_sysitem_new(model, id);
+	/* the item was released, see oval_syschar_release */
+	if (sysitem != NULL)
+		oval_sysitem_restore(sysitem);
+	else
+		sysitem = oval_sysitem_new(model, id);
 	oval_sysitem_set_status(sysitem, status);
 	oval_sysitem_set_subtype(sysitem, type);
 
-	for (int i = 2; (sub = SEXP_list_nth(sexp, i)) != NULL; ++i) {
-	    if ((sysent = oval_sexp_to_sysent(model, sysitem, sub, mask_map)) != NULL)
-		    oval_sysitem_add_sysent(sysitem, sysent);
-		SEXP_free(sub);
+	SEXP_sublist_foreach(sub, sexp, 2, SEXP_LIST_END) {
+		if ((sysent = oval_sexp_to_sysent(model, sysitem, sub, mask_map)) != NULL)
+			oval_sysitem_add_sysent(sysitem, sysent);
 	}
 
  cleanup:
@@ -975,16 +1146,144 @@ static struct oval_sysitem *oval_sexp_to_sysitem(struct oval_syschar_model *mode
 	return sysitem;
 }
 
-int oval_sexp_to_sysch(const SEXP_t *cobj, struct oval_syschar *syschar)
+/*
+ * Items converted before the rest of the reply is received. They are
+ * attached to the syschar only when the whole reply is converted.
+ */
+struct oval_sexp_stream {
+	struct oval_syschar     *syschar;
+	struct oval_string_map  *mask_map;
+	struct oval_sysitem    **items;
+	size_t                   count;
+	size_t                   alloc;
+	size_t                   attached; /**< items attached to the syschar */
+	size_t                   bytes;    /**< size of the received S-expressions */
+};
+
+static struct oval_sexp_stream *oval_sexp_stream_init(struct oval_syschar *syschar, SEXP_t *mask)
+{
+	struct oval_sexp_stream *stream;
+
+	stream = oscap_talloc(struct oval_sexp_stream);
+	stream->syschar  = syschar;
+	stream->mask_map = NULL;
+	stream->items    = NULL;
+	stream->count    = 0;
+	stream->alloc    = 0;
+	stream->attached = 0;
+	stream->bytes    = 0;
+
+	if (mask != NULL) {
+		SEXP_t *mask_entname;
+		char mask_entname_cstr[128];
+
+		stream->mask_map = oval_string_map_new();
+		SEXP_list_foreach(mask_entname, mask) {
+			SEXP_string_cstr_r(mask_entname, mask_entname_cstr, sizeof mask_entname_cstr);
+			oval_string_map_put_string(stream->mask_map, mask_entname_cstr, mask_entname_cstr);
+		}
+	}
+
+	return (stream);
+}
+
+struct oval_sexp_stream *oval_sexp_stream_new(struct oval_syschar *syschar, SEXP_t *s_obj)
+{
+	struct oval_sexp_stream *stream;
+	SEXP_t *mask;
+
+	/* the probe copies the mask of the object to the collected object */
+	mask   = probe_obj_getmask(s_obj);
+	stream = oval_sexp_stream_init(syschar, mask);
+	SEXP_free(mask);
+
+	return (stream);
+}
+
+void oval_sexp_stream_add(struct oval_sexp_stream *stream, SEXP_t *item)
+{
+	struct oval_sysitem *sysitem;
+
+	stream->bytes += SEXP_sizeof(item);
+	sysitem = oval_sexp_to_sysitem(oval_syschar_get_model(stream->syschar), item, stream->mask_map);
+
+	if (sysitem == NULL)
+		return;
+
+	if (stream->count == stream->alloc) {
+		stream->alloc = stream->alloc > 0 ? stream->alloc * 2 : 32;
+		stream->items = oscap_realloc(stream->items, sizeof(struct oval_sysitem *) * stream->alloc);
+	}
+
+	stream->items[stream->count++] = sysitem;
+}
+
+void oval_sexp_stream_reset(struct oval_sexp_stream *stream)
+{
+	stream->count = 0;
+}
+
+void oval_sexp_stream_free(struct oval_sexp_stream *stream)
+{
+	if (stream == NULL)
+		return;
+	if (stream->mask_map != NULL)
+		oval_string_map_free_string(stream->mask_map);
+
+	oscap_free(stream->items);
+	oscap_free(stream);
+}
+
+static void oval_sexp_stream_attach(struct oval_sexp_stream *stream, struct oval_string_map *itm_id_map,
+				    struct oval_sysitem *sysitem)
+{
+	char *itm_id;
+
+	itm_id = oval_sysitem_get_id(sysitem);
+	if (oval_string_map_get_value(itm_id_map, itm_id) == NULL) {
+		oval_string_map_put(itm_id_map, itm_id, itm_id);
+		oval_syschar_add_sysitem(stream->syschar, sysitem);
+		stream->attached++;
+	}
+}
+
+void oval_sexp_stream_get_stats(struct oval_sexp_stream *stream, size_t *items, size_t *bytes)
+{
+	*items = stream->attached;
+	*bytes = stream->bytes;
+}
+
+struct oval_sexp_spill_ctx {
+	struct oval_sexp_stream *stream;
+	struct oval_string_map  *itm_id_map;
+};
+
+static void oval_sexp_stream_spilled(SEXP_t *item, void *arg)
+{
+	struct oval_sexp_spill_ctx *ctx = arg;
+	struct oval_sysitem *sysitem;
+
+	ctx->stream->bytes += SEXP_sizeof(item);
+	sysitem = oval_sexp_to_sysitem(oval_syschar_get_model(ctx->stream->syschar), item, ctx->stream->mask_map);
+	if (sysitem != NULL)
+		oval_sexp_stream_attach(ctx->stream, ctx->itm_id_map, sysitem);
+}
+
+int oval_sexp_stream_to_sysch(struct oval_sexp_stream *stream, const SEXP_t *cobj)
 {
 	oval_syschar_collection_flag_t flag;
-	SEXP_t *messages, *msg, *items, *item, *mask;
-	struct oval_syschar_model *model;
+	SEXP_t *messages, *msg, *items, *item;
+	struct oval_syschar *syschar = stream->syschar;
 	struct oval_string_map *itm_id_map;
-        struct oval_string_map *item_mask_map;
+	struct oscap_trace_span span;
+	char *spill;
+	size_t i;
 
 	_A(cobj != NULL);
 
+	oscap_trace_begin(&span, "oval_sexp_to_sysch");
+
+	stream->bytes += SEXP_sizeof(cobj);
 	flag = probe_cobj_get_flag(cobj);
 	oval_syschar_set_flag(syschar, flag);
 
@@ -999,42 +1298,57 @@ int oval_sexp_to_sysch(const SEXP_t *cobj, struct oval_syschar *syschar)
 	SEXP_free(messages);
 
 	itm_id_map = oval_string_map_new();
-	model = oval_syschar_get_model(syschar);
-	items = probe_cobj_get_items(cobj);
 
-        mask = probe_cobj_get_mask(cobj);
-        if (mask != NULL) {
-            SEXP_t *mask_entname;
-            char mask_entname_cstr[128];
-            item_mask_map = oval_string_map_new();
-            SEXP_list_foreach(mask_entname, mask) {
-                SEXP_string_cstr_r(mask_entname, mask_entname_cstr, sizeof mask_entname_cstr);
-                oval_string_map_put_string(item_mask_map, mask_entname_cstr, mask_entname_cstr);
-            }
-            SEXP_free(mask);
-        } else
-            item_mask_map = NULL;
+	/* the streamed items come first in the reply */
+	for (i = 0; i < stream->count; ++i)
+		oval_sexp_stream_attach(stream, itm_id_map, stream->items[i]);
+
+	stream->count = 0;
+	items = probe_cobj_get_items(cobj);
 
 	SEXP_list_foreach(item, items) {
 		struct oval_sysitem *sysitem;
 
-		sysitem = oval_sexp_to_sysitem(model, item, item_mask_map);
-		if (sysitem != NULL) {
-			char *itm_id;
+		sysitem = oval_sexp_to_sysitem(oval_syschar_get_model(syschar), item, stream->mask_map);
+		if (sysitem != NULL)
+			oval_sexp_stream_attach(stream, itm_id_map, sysitem);
+	}
+	SEXP_free(items);
 
-			itm_id = oval_sysitem_get_id(sysitem);
-			if (oval_string_map_get_value(itm_id_map, itm_id) == NULL) {
-				oval_string_map_put(itm_id_map, itm_id, itm_id);
-				oval_syschar_add_sysitem(syschar, sysitem);
-			}
+	/* the items spilled by the probe follow the ones in the reply */
+	spill = probe_cobj_get_spill(cobj);
+	if (spill != NULL) {
+		struct oval_sexp_spill_ctx ctx = { stream, itm_id_map };
+
+		if (probe_spill_read(spill, &oval_sexp_stream_spilled, &ctx) < 0) {
+			oscap_seterr(OSCAP_EFAMILY_OVAL, "Can't read the items spilled by the probe from '%s'.", spill);
+			oval_syschar_set_flag(syschar, SYSCHAR_FLAG_INCOMPLETE);
 		}
+		oscap_free(spill);
 	}
-	SEXP_free(items);
+
 	oval_string_map_free(itm_id_map, NULL);
-        if (item_mask_map != NULL)
-            oval_string_map_free_string(item_mask_map);
+	oscap_trace_end(&span, oval_object_get_id(oval_syschar_get_object(syschar)));
 
 	return 0;
 }
 
+int oval_sexp_to_sysch(const SEXP_t *cobj, struct oval_syschar *syschar)
+{
+	struct oval_sexp_stream *stream;
+	SEXP_t *mask;
+	int ret;
+
+	_A(cobj != NULL);
+
+	mask   = probe_cobj_get_mask(cobj);
+	stream = oval_sexp_stream_init(syschar, mask);
+	SEXP_free(mask);
+
+	ret = oval_sexp_stream_to_sysch(stream, cobj);
+	oval_sexp_stream_free(stream);
+
+	return (ret);
+}
+
 /// @}
@@ -44,14 +44,40 @@ OSCAP_HIDDEN_START;
  * OVAL -> S-exp
  */
 SEXP_t *oval_value_to_sexp(struct oval_value *val, oval_datatype_t dtype);
+SEXP_t *oval_text_to_sexp(const char *text, oval_datatype_t dtype);
 
 int oval_object_to_sexp(void *sess, const char *typestr, struct oval_syschar *syschar, SEXP_t **out_sexp);
-int oval_state_to_sexp(void *sess, struct oval_state *state, SEXP_t **out_sexp);
+/*
+ * The hash of the content of an object made by oval_object_to_sexp, i.e.
+ * of everything but its id, with the values of the variables. The probes
+ * collect the same items for the objects with the same key. NULL if the
+ * object isn't sent to a probe.
+ */
+char *oval_object_sexp_key(const SEXP_t *s_obj);
+/* `key' is the id the probe cached the state under, see oval_probe_cmd_ste_fetch */
+int oval_state_to_sexp(void *sess, struct oval_state *state, const SEXP_t *key, SEXP_t **out_sexp);
 
 /*
  * S-exp -> OVAL
  */
 int oval_sexp_to_sysch(const SEXP_t *cobj, struct oval_syschar *syschar);
+
+/*
+ * Conversion of the items of a reply as they are received (see
+ * SEAP_msgstream_set). oval_sexp_stream_to_sysch converts the rest of
+ * the reply and attaches the streamed items to the syschar, if the reply
+ * is lost the streamed items are dropped by oval_sexp_stream_reset.
+ * `s_obj' is the object sent to the probe.
+ */
+struct oval_sexp_stream;
+
+struct oval_sexp_stream *oval_sexp_stream_new(struct oval_syschar *syschar, SEXP_t *s_obj);
+void oval_sexp_stream_add(struct oval_sexp_stream *stream, SEXP_t *item);
+void oval_sexp_stream_reset(struct oval_sexp_stream *stream);
+int  oval_sexp_stream_to_sysch(struct oval_sexp_stream *stream, const SEXP_t *cobj);
+void oval_sexp_stream_free(struct oval_sexp_stream *stream);
+/* the number of items attached to the syschar and the size of the reply */
+void oval_sexp_stream_get_stats(struct oval_sexp_stream *stream, size_t *items, size_t *bytes);
 OSCAP_HIDDEN_END;
 
 #endif				/* OVAL_SEXP_H */
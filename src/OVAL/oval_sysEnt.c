@@ -40,11 +40,17 @@
 #include "adt/oval_collection_impl.h"
 #include "oval_parser_impl.h"
 #include "oval_definitions_impl.h"
+#include "results/oval_cmp_evr_string_impl.h"
+#include "results/oval_cmp_ip_address_impl.h"
 
 #include "common/util.h"
 #include "common/debug_priv.h"
 #include "common/elements.h"
 
+/* the memory of the system characteristics, see oscap_memory_report */
+#undef OSCAP_MEMORY_TAG
+#define OSCAP_MEMORY_TAG OSCAP_MEMORY_SYSCHAR
+
 typedef struct oval_sysent {
 	struct oval_syschar_model *model;
 	char *name;
@@ -53,6 +59,10 @@ typedef struct oval_sysent {
 	int mask;
 	oval_datatype_t datatype;
 	oval_syschar_status_t status;
+	struct oval_evr *evr;			///< parts of the value if it is an EVR string
+	struct oval_ipaddr *ipaddr;		///< the value parsed if it is an IP address
+	bool shared_name;			///< the name is interned by the model and not freed here
+	bool shared_value;			///< the value is interned by the model and not freed here
 } oval_sysent_t;
 
 struct oval_sysent *oval_sysent_new(struct oval_syschar_model *model)
@@ -67,17 +77,47 @@ struct oval_sysent *oval_sysent_new(struct oval_syschar_model *model)
 	sysent->status = SYSCHAR_STATUS_UNKNOWN;
 	sysent->datatype = OVAL_DATATYPE_UNKNOWN;
 	sysent->mask = 0;
+	sysent->evr = NULL;
+	sysent->ipaddr = NULL;
+	sysent->shared_name = false;
+	sysent->shared_value = false;
 	sysent->model = model;
 	return sysent;
 }
 
+/* EVR strings and addresses are compared with many states, they are parsed only once */
+static void _oval_sysent_update_evr(struct oval_sysent *sysent)
+{
+	if ((sysent->datatype == OVAL_DATATYPE_EVR_STRING || sysent->datatype == OVAL_DATATYPE_DEBIAN_EVR_STRING)
+	    && sysent->value != NULL) {
+		if (sysent->evr == NULL)
+			sysent->evr = oscap_alloc(sizeof(struct oval_evr));
+		oval_evr_parse(sysent->value, sysent->evr);
+	} else {
+		oscap_free(sysent->evr);
+		sysent->evr = NULL;
+	}
+
+	if ((sysent->datatype == OVAL_DATATYPE_IPV4ADDR || sysent->datatype == OVAL_DATATYPE_IPV6ADDR)
+	    && sysent->value != NULL) {
+		if (sysent->ipaddr == NULL)
+			sysent->ipaddr = oscap_alloc(sizeof(struct oval_ipaddr));
+		sysent->ipaddr->af = sysent->datatype == OVAL_DATATYPE_IPV4ADDR ? AF_INET : AF_INET6;
+		/* an invalid address is reported by the comparison of the text */
+		if (oval_ipaddr_parse(sysent->ipaddr->af, sysent->value, &sysent->ipaddr->mask, &sysent->ipaddr->addr) == 0)
+			return;
+	}
+	oscap_free(sysent->ipaddr);
+	sysent->ipaddr = NULL;
+}
+
 struct oval_sysent *oval_sysent_clone(struct oval_syschar_model *new_model, struct oval_sysent *old_item)
 {
 	struct oval_sysent *new_item = oval_sysent_new(new_model);
 
 	char *old_value = oval_sysent_get_value(old_item);
 	if (old_value) {
-		oval_sysent_set_value(new_item, oscap_strdup(old_value));
+		oval_sysent_take_value(new_item, oscap_strdup(old_value));
 	}
 
 	char *old_name = oval_sysent_get_name(old_item);
@@ -97,12 +137,14 @@ void oval_sysent_free(struct oval_sysent *sysent)
 	if (sysent == NULL)
 		return;
 
-	if (sysent->name != NULL)
+	if (sysent->name != NULL && !sysent->shared_name)
 		oscap_free(sysent->name);
-	if (sysent->value != NULL)
+	if (sysent->value != NULL && !sysent->shared_value)
 		oscap_free(sysent->value);
 	if (sysent->record_fields)
 		oval_collection_free_items(sysent->record_fields, (oscap_destruct_func) oval_record_field_free);
+	oscap_free(sysent->evr);
+	oscap_free(sysent->ipaddr);
 
 	sysent->name = NULL;
 	sysent->value = NULL;
@@ -164,6 +206,20 @@ oval_datatype_t oval_sysent_get_datatype(struct oval_sysent * sysent)
 	return sysent->datatype;
 }
 
+const struct oval_evr *oval_sysent_get_evr(struct oval_sysent *sysent)
+{
+	__attribute__nonnull__(sysent);
+
+	return sysent->evr;
+}
+
+const struct oval_ipaddr *oval_sysent_get_ipaddr(struct oval_sysent *sysent)
+{
+	__attribute__nonnull__(sysent);
+
+	return sysent->ipaddr;
+}
+
 int oval_sysent_get_mask(struct oval_sysent *sysent)
 {
 	__attribute__nonnull__(sysent);
@@ -174,9 +230,19 @@ int oval_sysent_get_mask(struct oval_sysent *sysent)
 void oval_sysent_set_name(struct oval_sysent *sysent, char *name)
 {
 	__attribute__nonnull__(sysent);
-	if (sysent->name != NULL)
+	if (sysent->name != NULL && !sysent->shared_name)
 		oscap_free(sysent->name);
 	sysent->name = name;
+	sysent->shared_name = false;
+}
+
+void oval_sysent_set_shared_name(struct oval_sysent *sysent, const char *name)
+{
+	__attribute__nonnull__(sysent);
+	if (sysent->name != NULL && !sysent->shared_name)
+		oscap_free(sysent->name);
+	sysent->name = (char *) name;
+	sysent->shared_name = true;
 }
 
 void oval_sysent_set_status(struct oval_sysent *sysent, oval_syschar_status_t status)
@@ -189,6 +255,7 @@ void oval_sysent_set_datatype(struct oval_sysent *sysent, oval_datatype_t dataty
 {
 	__attribute__nonnull__(sysent);
 	sysent->datatype = datatype;
+	_oval_sysent_update_evr(sysent);
 }
 
 void oval_sysent_set_mask(struct oval_sysent *sysent, int mask)
@@ -200,9 +267,37 @@ void oval_sysent_set_mask(struct oval_sysent *sysent, int mask)
 void oval_sysent_set_value(struct oval_sysent *sysent, char *value)
 {
 	__attribute__nonnull__(sysent);
-	if (sysent->value != NULL)
+	if (sysent->value != NULL && !sysent->shared_value)
 		oscap_free(sysent->value);
 	sysent->value = oscap_strdup(value);
+	sysent->shared_value = false;
+	_oval_sysent_update_evr(sysent);
+}
+
+void oval_sysent_take_value(struct oval_sysent *sysent, char *value)
+{
+	__attribute__nonnull__(sysent);
+	if (sysent->value != NULL && !sysent->shared_value)
+		oscap_free(sysent->value);
+	sysent->value = value;
+	sysent->shared_value = false;
+	_oval_sysent_update_evr(sysent);
+}
+
+void oval_sysent_set_shared_value(struct oval_sysent *sysent, const char *value)
+{
+	__attribute__nonnull__(sysent);
+	if (sysent->value != NULL && !sysent->shared_value)
+		oscap_free(sysent->value);
+	sysent->value = (char *) value;
+	sysent->shared_value = true;
+	_oval_sysent_update_evr(sysent);
+}
+
+bool oval_sysent_has_shared_value(struct oval_sysent *sysent)
+{
+	__attribute__nonnull__(sysent);
+	return sysent->shared_value;
 }
 
 void oval_sysent_add_record_field(struct oval_sysent *sysent, struct oval_record_field *rf)
@@ -42,6 +42,10 @@
 #include "common/debug_priv.h"
 #include "common/elements.h"
 
+/* the memory of the system characteristics, see oscap_memory_report */
+#undef OSCAP_MEMORY_TAG
+#define OSCAP_MEMORY_TAG OSCAP_MEMORY_SYSCHAR
+
 typedef struct oval_sysint {
 	struct oval_syschar_model *model;
 	char *name;
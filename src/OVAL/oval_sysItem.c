@@ -42,6 +42,10 @@
 #include "common/util.h"
 #include "common/debug_priv.h"
 
+/* the memory of the system characteristics, see oscap_memory_report */
+#undef OSCAP_MEMORY_TAG
+#define OSCAP_MEMORY_TAG OSCAP_MEMORY_SYSCHAR
+
 typedef struct oval_sysitem {
 	//oval_family_enum family;
 	struct oval_syschar_model *model;
@@ -50,6 +54,9 @@ typedef struct oval_sysitem {
 	struct oval_collection *messages;
 	struct oval_collection *sysents;
 	oval_syschar_status_t status;
+	bool pending;				///< The item is still to be parsed from a lazily imported model
+	unsigned int refs;			///< Number of the syschars which list the item
+	bool released;				///< The entities were freed, see oval_sysitem_unref
 } oval_sysitem_t;				///< Represents a single <*_item> element
 
 struct oval_sysitem *oval_sysitem_new(struct oval_syschar_model *model, const char *id)
@@ -67,6 +74,9 @@ struct oval_sysitem *oval_sysitem_new(struct oval_syschar_model *model, const ch
 	sysitem->messages = oval_collection_new();
 	sysitem->sysents = oval_collection_new();
 	sysitem->model = model;
+	sysitem->pending = false;
+	sysitem->refs = 0;
+	sysitem->released = false;
 
 	oval_syschar_model_add_sysitem(model, sysitem);
 
@@ -133,9 +143,51 @@ void oval_sysitem_iterator_free(struct oval_sysitem_iterator
 	oval_collection_iterator_free((struct oval_iterator *)oc_sysitem);
 }
 
+void oval_sysitem_ref(struct oval_sysitem *sysitem)
+{
+	__atomic_add_fetch(&sysitem->refs, 1, __ATOMIC_RELAXED);
+}
+
+void oval_sysitem_unref(struct oval_sysitem *sysitem)
+{
+	if (__atomic_sub_fetch(&sysitem->refs, 1, __ATOMIC_ACQ_REL) != 0 || sysitem->pending)
+		return;
+
+	/* the id and the status stay, the results of the tests refer to them */
+	oval_collection_free_items(sysitem->messages, (oscap_destruct_func) oval_message_free);
+	oval_collection_free_items(sysitem->sysents, (oscap_destruct_func) oval_sysent_free);
+	sysitem->messages = oval_collection_new();
+	sysitem->sysents = oval_collection_new();
+	sysitem->released = true;
+}
+
+bool oval_sysitem_is_released(struct oval_sysitem *sysitem)
+{
+	return sysitem->released;
+}
+
+void oval_sysitem_restore(struct oval_sysitem *sysitem)
+{
+	sysitem->released = false;
+}
+
+void oval_sysitem_set_pending(struct oval_sysitem *sysitem)
+{
+	sysitem->pending = true;
+}
+
+static void _oval_sysitem_load(struct oval_sysitem *sysitem)
+{
+	if (sysitem->pending) {
+		sysitem->pending = false;
+		oval_syschar_model_load_sysitem(sysitem->model, sysitem);
+	}
+}
+
 oval_subtype_t oval_sysitem_get_subtype(struct oval_sysitem *sysitem)
 {
 	__attribute__nonnull__(sysitem);
+	_oval_sysitem_load(sysitem);
 
 	return sysitem->subtype;
 }
@@ -155,6 +207,7 @@ char *oval_sysitem_get_id(struct oval_sysitem *item)
 struct oval_message_iterator *oval_sysitem_get_messages(struct oval_sysitem *item)
 {
 	__attribute__nonnull__(item);
+	_oval_sysitem_load(item);
 	return (struct oval_message_iterator *)oval_collection_iterator(item->messages);
 }
 
@@ -167,6 +220,7 @@ void oval_sysitem_add_message(struct oval_sysitem *item, struct oval_message *me
 struct oval_sysent_iterator *oval_sysitem_get_sysents(struct oval_sysitem *sysitem)
 {
 	__attribute__nonnull__(sysitem);
+	_oval_sysitem_load(sysitem);
 	return (struct oval_sysent_iterator *)oval_collection_iterator(sysitem->sysents);
 }
 
@@ -179,6 +233,7 @@ void oval_sysitem_add_sysent(struct oval_sysitem *sysitem, struct oval_sysent *s
 oval_syschar_status_t oval_sysitem_get_status(struct oval_sysitem *data)
 {
 	__attribute__nonnull__(data);
+	_oval_sysitem_load(data);
 
 	return data->status;
 }
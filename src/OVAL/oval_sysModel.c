@@ -32,8 +32,14 @@
 #include <config.h>
 #endif
 
+#include <ctype.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "oval_definitions_impl.h"
 #include "oval_agent_api_impl.h"
@@ -47,9 +53,17 @@
 #include "common/debug_priv.h"
 #include "common/_error.h"
 #include "common/elements.h"
+#include "common/oscap_buffer.h"
 #include "oscap_source.h"
 #include "source/oscap_source_priv.h"
 
+/* the memory of the system characteristics, see oscap_memory_report */
+#undef OSCAP_MEMORY_TAG
+#define OSCAP_MEMORY_TAG OSCAP_MEMORY_SYSCHAR
+
+
+struct oval_sysent_dict;
+static void oval_sysent_dict_free(struct oval_sysent_dict *dict);
 
 typedef struct oval_syschar_model {
 	struct oval_generator *generator;
@@ -58,8 +72,47 @@ typedef struct oval_syschar_model {
 	struct oval_smc *syschar_map;				///< Represents objects within <collected_objects> element
 	struct oval_string_map *sysitem_map;			///< Represents items within <system_data> element
         char *schema;
+	struct oval_syschar_model_lazy *lazy;			///< Items still to be parsed, see oval_syschar_model_import_source_lazy
+	struct oval_string_map *names;				///< Interned names of the item entities
+	struct oval_string_map *values;				///< Entity name -> struct oval_sysent_dict
 } oval_syschar_model_t;						///< Represents <oval_system_characteristics> element
 
+/*
+ * Lazy import
+ *
+ * The items in <system_data> make up most of a system characteristics
+ * document. A lazily imported model parses everything else and only
+ * remembers where each item is in the mapped file. An item is parsed when
+ * it is used for the first time, together with the start tags of the root
+ * and <system_data>, which declare the namespaces it needs.
+ */
+struct oval_syschar_model_lazy {
+	char *map;
+	size_t size;
+	struct oval_string_map *index;		///< item id -> position in items
+	struct {
+		size_t start;
+		size_t end;
+	} *items, root, data;			///< byte ranges of the items and of the start tags
+	int items_count;
+	int items_alloc;
+	char *root_name;
+	char *data_name;
+};
+
+static void _oval_syschar_model_lazy_free(struct oval_syschar_model_lazy *lazy)
+{
+	if (lazy == NULL)
+		return;
+
+	munmap(lazy->map, lazy->size);
+	oval_string_map_free(lazy->index, NULL);
+	oscap_free(lazy->items);
+	oscap_free(lazy->root_name);
+	oscap_free(lazy->data_name);
+	oscap_free(lazy);
+}
+
 
 /* failed   - NULL
  * success  - oval_syschar_model
@@ -79,6 +132,9 @@ struct oval_syschar_model *oval_syschar_model_new(struct oval_definition_model *
 	newmodel->syschar_map = oval_smc_new();
 	newmodel->sysitem_map = oval_string_map_new();
         newmodel->schema = oscap_strdup(OVAL_SYS_SCHEMA_LOCATION);
+	newmodel->lazy = NULL;
+	newmodel->names = NULL;
+	newmodel->values = NULL;
 
 	/* check possible allocation problems */
 	if ((newmodel->syschar_map == NULL) || (newmodel->sysitem_map == NULL) ) {
@@ -143,6 +199,12 @@ void oval_syschar_model_free(struct oval_syschar_model *model)
 			oval_string_map_free(model->sysitem_map, (oscap_destruct_func) oval_sysitem_free);
 		oscap_free(model->schema);
 		oval_generator_free(model->generator);
+		_oval_syschar_model_lazy_free(model->lazy);
+		/* after the items, whose entities may share the names and values */
+		if (model->names)
+			oval_string_map_free(model->names, (oscap_destruct_func) oscap_free);
+		if (model->values)
+			oval_string_map_free(model->values, (oscap_destruct_func) oval_sysent_dict_free);
 		oscap_free(model);
 	}
 }
@@ -155,6 +217,77 @@ void oval_syschar_model_reset(struct oval_syschar_model *model)
                 oval_string_map_free(model->sysitem_map, (oscap_destruct_func) oval_sysitem_free);
         model->syschar_map = oval_smc_new();
         model->sysitem_map = oval_string_map_new();
+	_oval_syschar_model_lazy_free(model->lazy);
+	model->lazy = NULL;
+	if (model->values)
+		oval_string_map_free(model->values, (oscap_destruct_func) oval_sysent_dict_free);
+	model->values = NULL;
+}
+
+/*
+ * The distinct values of the entities with one name. The first values
+ * decide whether they repeat enough to be worth interning.
+ */
+#define OVAL_SYSENT_DICT_SAMPLE 256
+
+struct oval_sysent_dict {
+	struct oval_string_map *values;
+	size_t count;		///< distinct values
+	size_t seen;		///< values interned
+	bool off;		///< the values don't repeat
+};
+
+static void oval_sysent_dict_free(struct oval_sysent_dict *dict)
+{
+	oval_string_map_free(dict->values, (oscap_destruct_func) oscap_free);
+	oscap_free(dict);
+}
+
+const char *oval_syschar_model_intern_value(struct oval_syschar_model *model, const char *name, const char *value)
+{
+	struct oval_sysent_dict *dict;
+	char *interned;
+
+	if (model->values == NULL)
+		model->values = oval_string_map_new();
+
+	dict = oval_string_map_get_value(model->values, name);
+	if (dict == NULL) {
+		dict = oscap_calloc(1, sizeof(struct oval_sysent_dict));
+		dict->values = oval_string_map_new();
+		oval_string_map_put(model->values, name, dict);
+	}
+	if (dict->off)
+		return NULL;
+
+	interned = oval_string_map_get_value(dict->values, value);
+	if (interned == NULL) {
+		if (dict->seen >= OVAL_SYSENT_DICT_SAMPLE && dict->count * 2 > dict->seen) {
+			dD("Not interning the values of '%s', %zu of %zu are different.", name, dict->count, dict->seen);
+			dict->off = true;
+			return NULL;
+		}
+		interned = oscap_strdup(value);
+		oval_string_map_put(dict->values, interned, interned);
+		++dict->count;
+	}
+	++dict->seen;
+	return interned;
+}
+
+const char *oval_syschar_model_intern_name(struct oval_syschar_model *model, const char *name)
+{
+	char *interned;
+
+	if (model->names == NULL)
+		model->names = oval_string_map_new();
+
+	interned = oval_string_map_get_value(model->names, name);
+	if (interned == NULL) {
+		interned = oscap_strdup(name);
+		oval_string_map_put(model->names, interned, interned);
+	}
+	return interned;
 }
 
 struct oval_generator *oval_syschar_model_get_generator(struct oval_syschar_model *model)
@@ -231,6 +364,10 @@ void oval_syschar_model_add_sysitem(struct oval_syschar_model *model, struct ova
 int oval_syschar_model_import_source(struct oval_syschar_model *model, struct oscap_source *source)
 {
 	int ret = 0;
+	const char *path = oscap_source_get_filepath(source);
+	if (path != NULL && oval_syschar_model_is_binary(path))
+		return oval_syschar_model_import_binary(model, path);
+
 	/* setup context */
         struct oval_parser_context context;
         context.reader = oscap_source_get_xmlTextReader(source);
@@ -262,6 +399,317 @@ int oval_syschar_model_import_source(struct oval_syschar_model *model, struct os
 	return ret;
 }
 
+bool oval_syschar_model_is_lazy(struct oval_syschar_model *model)
+{
+	return model->lazy != NULL;
+}
+
+static const char *_oval_lazy_skip(const char *p, const char *end, const char *terminator)
+{
+	size_t len = strlen(terminator);
+
+	for (; p + len <= end; ++p) {
+		if (memcmp(p, terminator, len) == 0)
+			return p + len;
+	}
+	return NULL;
+}
+
+/* the end of the tag which starts at p, quoted attribute values can contain '>' */
+static const char *_oval_lazy_tag_end(const char *p, const char *end)
+{
+	char quote = 0;
+
+	for (; p < end; ++p) {
+		if (quote) {
+			if (*p == quote)
+				quote = 0;
+		} else if (*p == '"' || *p == '\'') {
+			quote = *p;
+		} else if (*p == '>') {
+			return p + 1;
+		}
+	}
+	return NULL;
+}
+
+static size_t _oval_lazy_name_len(const char *p, const char *end)
+{
+	const char *name = p;
+
+	while (p < end && !isspace((unsigned char)*p) && *p != '/' && *p != '>')
+		++p;
+	return p - name;
+}
+
+static bool _oval_lazy_is_local_name(const char *name, size_t len, const char *local)
+{
+	const char *colon = memchr(name, ':', len);
+
+	if (colon != NULL) {
+		len -= colon + 1 - name;
+		name = colon + 1;
+	}
+	return len == strlen(local) && memcmp(name, local, len) == 0;
+}
+
+/* the value of the id attribute of the start tag, -1 if it can't be read as is */
+static int _oval_lazy_get_id(const char *tag, const char *end, char **id)
+{
+	const char *p = tag + 1;
+
+	*id = NULL;
+	p += _oval_lazy_name_len(p, end);
+	for (;;) {
+		while (p < end && isspace((unsigned char)*p))
+			++p;
+		if (p >= end || *p == '/' || *p == '>')
+			return 0;
+
+		const char *name = p;
+		while (p < end && *p != '=' && !isspace((unsigned char)*p))
+			++p;
+		size_t name_len = p - name;
+		while (p < end && isspace((unsigned char)*p))
+			++p;
+		if (p >= end || *p != '=')
+			return -1;
+		++p;
+		while (p < end && isspace((unsigned char)*p))
+			++p;
+		if (p >= end || (*p != '"' && *p != '\''))
+			return -1;
+
+		const char *value = p + 1;
+		const char *value_end = memchr(value, *p, end - value);
+		if (value_end == NULL)
+			return -1;
+		p = value_end + 1;
+
+		if (name_len == 2 && memcmp(name, "id", 2) == 0) {
+			if (memchr(value, '&', value_end - value) != NULL)
+				return -1;
+			*id = strndup(value, value_end - value);
+			return 0;
+		}
+	}
+}
+
+static int _oval_lazy_add_item(struct oval_syschar_model_lazy *lazy, const char *tag, const char *tag_end, const char *end)
+{
+	char *id;
+
+	if (_oval_lazy_get_id(tag, tag_end, &id) != 0)
+		return -1;
+	if (id == NULL)
+		return 0;
+
+	/* the first item with the id wins, like with the parser */
+	if (oval_string_map_get_index(lazy->index, id) < 0) {
+		int i = oval_string_map_intern(lazy->index, id);
+		if (i >= lazy->items_alloc) {
+			lazy->items_alloc = lazy->items_alloc ? 2 * lazy->items_alloc : 64;
+			lazy->items = oscap_realloc(lazy->items, lazy->items_alloc * sizeof(*lazy->items));
+		}
+		lazy->items[i].start = tag - lazy->map;
+		lazy->items[i].end = end - lazy->map;
+		lazy->items_count = i + 1;
+	}
+	oscap_free(id);
+	return 0;
+}
+
+/*
+ * Find the items without parsing them. Returns -1 if the document uses
+ * anything this simple scanner doesn't understand, e.g. a DTD.
+ */
+static int _oval_syschar_model_lazy_index(struct oval_syschar_model_lazy *lazy)
+{
+	const char *p = lazy->map, *end = lazy->map + lazy->size;
+	const char *item = NULL, *item_end = NULL;
+	bool in_data = false;
+	int depth = 0;
+
+	while (p != NULL && (p = memchr(p, '<', end - p)) != NULL) {
+		const char *tag = p;
+
+		if (end - p >= 4 && memcmp(p, "<!--", 4) == 0) {
+			p = _oval_lazy_skip(p + 4, end, "-->");
+		} else if (end - p >= 9 && memcmp(p, "<![CDATA[", 9) == 0) {
+			p = _oval_lazy_skip(p + 9, end, "]]>");
+		} else if (end - p >= 2 && p[1] == '?') {
+			p = _oval_lazy_skip(p + 2, end, "?>");
+		} else if (end - p >= 2 && p[1] == '!') {
+			/* an internal subset may declare entities */
+			p = _oval_lazy_tag_end(p, end);
+			if (p == NULL || memchr(tag, '[', p - tag) != NULL)
+				return -1;
+		} else if (end - p >= 2 && p[1] == '/') {
+			p = _oval_lazy_tag_end(p, end);
+			if (p == NULL || --depth < 0)
+				return -1;
+			if (in_data && depth == 2) {
+				if (_oval_lazy_add_item(lazy, item, item_end, p) != 0)
+					return -1;
+			} else if (in_data && depth == 1) {
+				in_data = false;
+			}
+		} else {
+			p = _oval_lazy_tag_end(p, end);
+			if (p == NULL)
+				return -1;
+
+			bool empty = p[-2] == '/';
+			size_t name_len = _oval_lazy_name_len(tag + 1, end);
+
+			if (depth == 0) {
+				lazy->root.start = tag - lazy->map;
+				lazy->root.end = p - lazy->map;
+				lazy->root_name = strndup(tag + 1, name_len);
+			} else if (depth == 1 && !empty && _oval_lazy_is_local_name(tag + 1, name_len, "system_data")) {
+				if (lazy->data_name != NULL)
+					return -1;
+				lazy->data.start = tag - lazy->map;
+				lazy->data.end = p - lazy->map;
+				lazy->data_name = strndup(tag + 1, name_len);
+				in_data = true;
+			} else if (depth == 2 && in_data) {
+				item = tag;
+				item_end = p;
+				if (empty && _oval_lazy_add_item(lazy, item, item_end, p) != 0)
+					return -1;
+			}
+			if (!empty)
+				++depth;
+		}
+	}
+
+	return (p == NULL && depth == 0) ? 0 : -1;
+}
+
+void oval_syschar_model_load_sysitem(struct oval_syschar_model *model, struct oval_sysitem *sysitem)
+{
+	struct oval_syschar_model_lazy *lazy = model->lazy;
+	if (lazy == NULL)
+		return;
+
+	int i = oval_string_map_get_index(lazy->index, oval_sysitem_get_id(sysitem));
+	if (i < 0)
+		return;
+
+	struct oscap_buffer *buffer = oscap_buffer_new();
+	oscap_buffer_append_binary_data(buffer, lazy->map + lazy->root.start, lazy->root.end - lazy->root.start);
+	oscap_buffer_append_binary_data(buffer, lazy->map + lazy->data.start, lazy->data.end - lazy->data.start);
+	oscap_buffer_append_binary_data(buffer, lazy->map + lazy->items[i].start, lazy->items[i].end - lazy->items[i].start);
+	oscap_buffer_append_string(buffer, "</");
+	oscap_buffer_append_string(buffer, lazy->data_name);
+	oscap_buffer_append_string(buffer, "></");
+	oscap_buffer_append_string(buffer, lazy->root_name);
+	oscap_buffer_append_string(buffer, ">");
+
+	struct oval_parser_context context = {
+		.definition_model = model->definition_model,
+		.syschar_model = model,
+	};
+	context.reader = xmlReaderForMemory(oscap_buffer_get_raw(buffer), oscap_buffer_get_length(buffer), NULL, "UTF-8", 0);
+	if (context.reader == NULL) {
+		oscap_buffer_free(buffer);
+		return;
+	}
+
+	while (xmlTextReaderRead(context.reader) == 1) {
+		if (xmlTextReaderNodeType(context.reader) == XML_READER_TYPE_ELEMENT && xmlTextReaderDepth(context.reader) == 2) {
+			if (oval_sysitem_parse_tag(context.reader, &context, NULL) != 0)
+				dW("Failed to parse the system item '%s'.", oval_sysitem_get_id(sysitem));
+			break;
+		}
+	}
+
+	xmlFreeTextReader(context.reader);
+	oscap_buffer_free(buffer);
+}
+
+static void _oval_syschar_model_set_pending(struct oval_syschar_model *model)
+{
+	struct oval_iterator *sysitems = oval_string_map_values_unordered(model->sysitem_map);
+	while (oval_collection_iterator_has_more(sysitems)) {
+		struct oval_sysitem *sysitem = oval_collection_iterator_next(sysitems);
+		if (oval_string_map_get_index(model->lazy->index, oval_sysitem_get_id(sysitem)) >= 0)
+			oval_sysitem_set_pending(sysitem);
+	}
+	oval_collection_iterator_free(sysitems);
+}
+
+int oval_syschar_model_import_source_lazy(struct oval_syschar_model *model, struct oscap_source *source)
+{
+	__attribute__nonnull__(model);
+
+	const char *path = oscap_source_get_filepath(source);
+	if (path == NULL || model->lazy != NULL || oval_syschar_model_is_binary(path))
+		return oval_syschar_model_import_source(model, source);
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return oval_syschar_model_import_source(model, source);
+
+	struct stat st;
+	void *map = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 && st.st_size <= INT_MAX)
+		map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return oval_syschar_model_import_source(model, source);
+
+	struct oval_syschar_model_lazy *lazy = oscap_calloc(1, sizeof(struct oval_syschar_model_lazy));
+	lazy->map = map;
+	lazy->size = st.st_size;
+	lazy->index = oval_string_map_new();
+
+	/* the scanner reads plain UTF-8 XML only, anything else is imported at once */
+	xmlTextReaderPtr reader = NULL;
+	if (_oval_syschar_model_lazy_index(lazy) == 0 && lazy->root_name != NULL)
+		reader = xmlReaderForMemory(map, st.st_size, path, NULL, 0);
+	if (reader != NULL && xmlTextReaderRead(reader) == 1) {
+		const xmlChar *encoding = xmlTextReaderConstEncoding(reader);
+		if (encoding != NULL && xmlStrcasecmp(encoding, BAD_CAST "UTF-8") != 0) {
+			xmlFreeTextReader(reader);
+			reader = NULL;
+		}
+	}
+	if (reader == NULL) {
+		dI("Can't import '%s' lazily, parsing all of it.", path);
+		_oval_syschar_model_lazy_free(lazy);
+		return oval_syschar_model_import_source(model, source);
+	}
+
+	model->lazy = lazy;
+
+	struct oval_parser_context context = {
+		.definition_model = model->definition_model,
+		.syschar_model = model,
+		.reader = reader,
+	};
+
+	int ret;
+	char *tagname = (char *)xmlTextReaderLocalName(reader);
+	char *namespace = (char *)xmlTextReaderNamespaceUri(reader);
+	if (namespace != NULL && strcmp((const char *)OVAL_SYSCHAR_NAMESPACE, namespace) == 0
+	    && strcmp(tagname, OVAL_ROOT_ELM_SYSCHARS) == 0) {
+		ret = oval_syschar_model_parse(reader, &context);
+	} else {
+		oscap_seterr(OSCAP_EFAMILY_OSCAP, "Missing \"oval_system_characteristics\" element");
+		dE("Unprocessed tag: <%s:%s>.", namespace, tagname);
+		ret = -1;
+	}
+	oscap_free(tagname);
+	oscap_free(namespace);
+	xmlFreeTextReader(reader);
+
+	_oval_syschar_model_set_pending(model);
+	dI("Indexed %d system items of '%s'.", lazy->items_count, path);
+	return ret;
+}
+
 /* -1 error; 0 OK; 1 warning */
 int oval_syschar_model_import(struct oval_syschar_model *model, const char *file)
 {
@@ -317,7 +765,8 @@ struct oval_sysitem *oval_syschar_model_get_new_sysitem(struct oval_syschar_mode
 }
 
 xmlNode *oval_syschar_model_to_dom(struct oval_syschar_model * syschar_model, xmlDocPtr doc, xmlNode * parent, 
-			           oval_syschar_resolver resolver, void *user_arg, bool export_syschar)
+			           oval_syschar_resolver resolver, void *user_arg, bool export_syschar,
+				   struct xml_stream *stream)
 {
 
 	xmlNodePtr root_node = NULL;
@@ -347,8 +796,10 @@ xmlNode *oval_syschar_model_to_dom(struct oval_syschar_model * syschar_model, xm
 
         /* Report sysinfo */
 	oval_sysinfo_to_dom(oval_syschar_model_get_sysinfo(syschar_model), doc, root_node);
+	xml_stream_flush(stream, root_node);
 
 	if (!export_syschar) {
+		xml_stream_end(stream, root_node);
 		return root_node;
 	}
 
@@ -377,6 +828,7 @@ xmlNode *oval_syschar_model_to_dom(struct oval_syschar_model * syschar_model, xm
 			    || oval_object_get_base_obj(object)) /* Skip internal objects */
 				continue;
 			oval_syschar_to_dom(syschar, doc, tag_objects);
+			xml_stream_flush(stream, tag_objects);
 			struct oval_sysitem_iterator *sysitems = oval_syschar_get_sysitem(syschar);
 			while (oval_sysitem_iterator_has_more(sysitems)) {
 				struct oval_sysitem *sysitem = oval_sysitem_iterator_next(sysitems);
@@ -384,6 +836,7 @@ xmlNode *oval_syschar_model_to_dom(struct oval_syschar_model * syschar_model, xm
 			}
 			oval_sysitem_iterator_free(sysitems);
 		}
+		xml_stream_end(stream, tag_objects);
 	}
 	oval_smc_free0(resolved_smc);
 	oval_syschar_iterator_free(syschars);
@@ -395,10 +848,13 @@ xmlNode *oval_syschar_model_to_dom(struct oval_syschar_model * syschar_model, xm
 			struct oval_sysitem *sysitem = (struct oval_sysitem *)
 			    oval_collection_iterator_next(sysitems);
 			oval_sysitem_to_dom(sysitem, doc, tag_items);
+			xml_stream_flush(stream, tag_items);
 		}
+		xml_stream_end(stream, tag_items);
 	}
 	oval_collection_iterator_free(sysitems);
 	oval_string_map_free(sysitem_map, NULL);
+	xml_stream_end(stream, root_node);
 
 	return root_node;
 }
@@ -410,13 +866,11 @@ int oval_syschar_model_export(struct oval_syschar_model *model, const char *file
 
 	LIBXML_TEST_VERSION;
 
-	xmlDocPtr doc = xmlNewDoc(BAD_CAST "1.0");
-	if (doc == NULL) {
-		oscap_setxmlerr(xmlGetLastError());
+	struct xml_stream *stream = xml_stream_new(file);
+	if (stream == NULL)
 		return -1;
-	}
 
-	oval_syschar_model_to_dom(model, doc, NULL, NULL, NULL, true);
-	return oscap_xml_save_filename_free(file, doc);
+	oval_syschar_model_to_dom(model, xml_stream_get_doc(stream), NULL, NULL, NULL, true, stream);
+	return xml_stream_close(stream);
 }
 
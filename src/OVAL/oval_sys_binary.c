@@ -0,0 +1,887 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Binary system characteristics
+ *
+ * The file starts with the magic and the version of the format, followed
+ * by the generator, the system information, the collected objects and the
+ * items, in the order of the XML document. The numbers are LEB128 varints.
+ *
+ * A string is a varint code: 0 is NULL, 1 a literal, 2 a literal which is
+ * added to the string table, 3 a decimal integer written as a zigzag
+ * varint and n > 3 the string n - 4 of the table. A literal is its length,
+ * its bytes and a NUL, so the strings of the table are used in place in
+ * the mapped file. The names and the values of the entities which repeat
+ * go into the table, like oval_syschar_model_intern_value() keeps them in
+ * the model; the values of an entity which turn out to be mostly different
+ * are written as literals.
+ *
+ * The entities of the items of a kind have the same names, datatypes,
+ * masks and statuses, their "shape". An item refers to its shape, which is
+ * written once, and only lists the values of the entities.
+ *
+ * The other XML elements of the generator, such as vendor, are kept as
+ * their XML text. The system information keeps no other XML elements.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "oval_definitions_impl.h"
+#include "oval_agent_api_impl.h"
+#include "adt/oval_string_map_impl.h"
+#include "oval_system_characteristics_impl.h"
+#include "common/util.h"
+#include "common/list.h"
+#include "common/debug_priv.h"
+#include "common/_error.h"
+
+/* the memory of the system characteristics, see oscap_memory_report */
+#undef OSCAP_MEMORY_TAG
+#define OSCAP_MEMORY_TAG OSCAP_MEMORY_SYSCHAR
+
+#define OVAL_SYSBIN_MAGIC      "OSCAP-SC"
+#define OVAL_SYSBIN_MAGIC_LEN  8
+#define OVAL_SYSBIN_VERSION    2
+#define OVAL_SYSBIN_SAMPLE     256  /* values of an entity seen before the table is given up */
+
+#define OVAL_SYSBIN_NULL       0
+#define OVAL_SYSBIN_LITERAL    1
+#define OVAL_SYSBIN_NEW        2
+#define OVAL_SYSBIN_INTEGER    3
+#define OVAL_SYSBIN_TABLE      4
+
+#define OVAL_SYSBIN_OBJECT     'O'
+#define OVAL_SYSBIN_ITEM       'I'
+#define OVAL_SYSBIN_END        'E'
+
+bool oval_syschar_model_is_binary(const char *file)
+{
+	char magic[OVAL_SYSBIN_MAGIC_LEN];
+	bool ret = false;
+	int fd;
+
+	if (file == NULL || (fd = open(file, O_RDONLY)) < 0)
+		return false;
+	if (read(fd, magic, sizeof magic) == sizeof magic)
+		ret = memcmp(magic, OVAL_SYSBIN_MAGIC, sizeof magic) == 0;
+	close(fd);
+
+	return ret;
+}
+
+/* the decimal integers which are written back the same */
+static bool _oval_sysbin_integer(const char *s, int64_t *num)
+{
+	const char *d = *s == '-' ? s + 1 : s;
+	size_t len = strlen(d);
+
+	if (len == 0 || len > 18 || strspn(d, "0123456789") != len)
+		return false;
+	if (d[0] == '0' && (len > 1 || d != s))
+		return false;
+
+	*num = strtoll(s, NULL, 10);
+	return true;
+}
+
+/*
+ * Export
+ */
+
+struct oval_sysbin_column {
+	size_t seen;
+	size_t count;
+	bool off;
+};
+
+struct oval_sysbin_writer {
+	FILE *fp;
+	struct oval_string_map *strings;	///< string -> index in the table + 1
+	size_t strings_count;
+	struct oval_string_map *columns;	///< entity name -> struct oval_sysbin_column
+	struct oval_string_map *shapes;		///< shape key -> index + 1
+	size_t shapes_count;
+};
+
+static void _oval_sysbin_put_num(struct oval_sysbin_writer *w, uint64_t num)
+{
+	do {
+		unsigned char byte = num & 0x7f;
+
+		num >>= 7;
+		putc(num != 0 ? byte | 0x80 : byte, w->fp);
+	} while (num != 0);
+}
+
+static void _oval_sysbin_put_literal(struct oval_sysbin_writer *w, uint64_t code, const char *s)
+{
+	size_t len = strlen(s);
+
+	_oval_sysbin_put_num(w, code);
+	_oval_sysbin_put_num(w, len);
+	fwrite(s, 1, len + 1, w->fp);
+}
+
+/* the column of the values of an entity, NULL for the strings always kept in the table */
+static void _oval_sysbin_put_str(struct oval_sysbin_writer *w, const char *s, const char *column)
+{
+	struct oval_sysbin_column *col = NULL;
+	uintptr_t index;
+	int64_t num;
+
+	if (s == NULL) {
+		_oval_sysbin_put_num(w, OVAL_SYSBIN_NULL);
+		return;
+	}
+	if (_oval_sysbin_integer(s, &num)) {
+		_oval_sysbin_put_num(w, OVAL_SYSBIN_INTEGER);
+		_oval_sysbin_put_num(w, ((uint64_t)num << 1) ^ (uint64_t)(num >> 63));
+		return;
+	}
+
+	index = (uintptr_t) oval_string_map_get_value(w->strings, s);
+	if (index != 0) {
+		_oval_sysbin_put_num(w, OVAL_SYSBIN_TABLE + index - 1);
+		return;
+	}
+
+	if (column != NULL) {
+		col = oval_string_map_get_value(w->columns, column);
+		if (col == NULL) {
+			col = oscap_calloc(1, sizeof(struct oval_sysbin_column));
+			oval_string_map_put(w->columns, column, col);
+		}
+		if (!col->off && col->seen >= OVAL_SYSBIN_SAMPLE && col->count * 2 > col->seen) {
+			dD("Not keeping the values of '%s', %zu of %zu are different.", column, col->count, col->seen);
+			col->off = true;
+		}
+		col->seen++;
+		if (col->off) {
+			_oval_sysbin_put_literal(w, OVAL_SYSBIN_LITERAL, s);
+			return;
+		}
+		col->count++;
+	}
+
+	oval_string_map_put(w->strings, s, (void *)(uintptr_t)++w->strings_count);
+	_oval_sysbin_put_literal(w, OVAL_SYSBIN_NEW, s);
+}
+
+static void _oval_sysbin_put_messages(struct oval_sysbin_writer *w, struct oval_message_iterator *messages)
+{
+	struct oscap_list *list = oscap_list_new();
+	struct oscap_iterator *it;
+
+	while (oval_message_iterator_has_more(messages))
+		oscap_list_add(list, oval_message_iterator_next(messages));
+	oval_message_iterator_free(messages);
+
+	_oval_sysbin_put_num(w, oscap_list_get_itemcount(list));
+	it = oscap_iterator_new(list);
+	while (oscap_iterator_has_more(it)) {
+		struct oval_message *message = oscap_iterator_next(it);
+
+		_oval_sysbin_put_num(w, oval_message_get_level(message));
+		_oval_sysbin_put_str(w, oval_message_get_text(message), "message");
+	}
+	oscap_iterator_free(it);
+	oscap_list_free0(list);
+}
+
+static void _oval_sysbin_put_syschar(struct oval_sysbin_writer *w, struct oval_syschar *syschar)
+{
+	struct oval_object *object = oval_syschar_get_object(syschar);
+	struct oval_variable_binding_iterator *bindings;
+	struct oval_sysitem_iterator *sysitems;
+	struct oscap_list *list;
+	struct oscap_iterator *it;
+
+	putc(OVAL_SYSBIN_OBJECT, w->fp);
+	_oval_sysbin_put_str(w, oval_object_get_id(object), "object");
+	_oval_sysbin_put_num(w, oval_object_get_version(object));
+	_oval_sysbin_put_num(w, oval_syschar_get_flag(syschar));
+	_oval_sysbin_put_num(w, oval_syschar_get_variable_instance(syschar));
+	_oval_sysbin_put_messages(w, oval_syschar_get_messages(syschar));
+
+	list = oscap_list_new();
+	bindings = oval_syschar_get_variable_bindings(syschar);
+	while (oval_variable_binding_iterator_has_more(bindings))
+		oscap_list_add(list, oval_variable_binding_iterator_next(bindings));
+	oval_variable_binding_iterator_free(bindings);
+
+	_oval_sysbin_put_num(w, oscap_list_get_itemcount(list));
+	it = oscap_iterator_new(list);
+	while (oscap_iterator_has_more(it)) {
+		struct oval_variable_binding *binding = oscap_iterator_next(it);
+		struct oval_string_iterator *values = oval_variable_binding_get_values(binding);
+		struct oscap_list *vlist = oscap_list_new();
+		struct oscap_iterator *vit;
+
+		_oval_sysbin_put_str(w, oval_variable_get_id(oval_variable_binding_get_variable(binding)), NULL);
+		while (oval_string_iterator_has_more(values))
+			oscap_list_add(vlist, oval_string_iterator_next(values));
+		oval_string_iterator_free(values);
+
+		_oval_sysbin_put_num(w, oscap_list_get_itemcount(vlist));
+		vit = oscap_iterator_new(vlist);
+		while (oscap_iterator_has_more(vit))
+			_oval_sysbin_put_str(w, oscap_iterator_next(vit), "variable_value");
+		oscap_iterator_free(vit);
+		oscap_list_free0(vlist);
+	}
+	oscap_iterator_free(it);
+	oscap_list_free0(list);
+
+	list = oscap_list_new();
+	sysitems = oval_syschar_get_sysitem(syschar);
+	while (oval_sysitem_iterator_has_more(sysitems))
+		oscap_list_add(list, oval_sysitem_iterator_next(sysitems));
+	oval_sysitem_iterator_free(sysitems);
+
+	_oval_sysbin_put_num(w, oscap_list_get_itemcount(list));
+	it = oscap_iterator_new(list);
+	while (oscap_iterator_has_more(it))
+		_oval_sysbin_put_str(w, oval_sysitem_get_id(oscap_iterator_next(it)), NULL);
+	oscap_iterator_free(it);
+	oscap_list_free0(list);
+}
+
+static void _oval_sysbin_put_sysitem(struct oval_sysbin_writer *w, struct oval_sysitem *sysitem)
+{
+	struct oval_sysent_iterator *sysents;
+	struct oscap_list *list;
+	struct oscap_iterator *it;
+	char *key = NULL, *name;
+	size_t key_len = 0, len;
+	uintptr_t shape;
+
+	putc(OVAL_SYSBIN_ITEM, w->fp);
+	_oval_sysbin_put_str(w, oval_sysitem_get_id(sysitem), NULL);
+	_oval_sysbin_put_num(w, oval_sysitem_get_subtype(sysitem));
+	_oval_sysbin_put_num(w, oval_sysitem_get_status(sysitem));
+	_oval_sysbin_put_messages(w, oval_sysitem_get_messages(sysitem));
+
+	list = oscap_list_new();
+	sysents = oval_sysitem_get_sysents(sysitem);
+	while (oval_sysent_iterator_has_more(sysents))
+		oscap_list_add(list, oval_sysent_iterator_next(sysents));
+	oval_sysent_iterator_free(sysents);
+
+	/* the shape is the names, datatypes, masks and statuses of the entities */
+	it = oscap_iterator_new(list);
+	while (oscap_iterator_has_more(it)) {
+		struct oval_sysent *sysent = oscap_iterator_next(it);
+
+		name = oval_sysent_get_name(sysent);
+		len = strlen(name != NULL ? name : "") + 32;
+		key = oscap_realloc(key, key_len + len);
+		key_len += snprintf(key + key_len, len, "%s\x1f%d\x1f%d\x1f%d\x1e", name != NULL ? name : "",
+				oval_sysent_get_datatype(sysent), oval_sysent_get_mask(sysent) ? 1 : 0,
+				oval_sysent_get_status(sysent));
+	}
+	oscap_iterator_free(it);
+
+	shape = (uintptr_t) oval_string_map_get_value(w->shapes, key != NULL ? key : "");
+	if (shape != 0) {
+		_oval_sysbin_put_num(w, shape);
+	} else {
+		oval_string_map_put(w->shapes, key != NULL ? key : "", (void *)(uintptr_t)++w->shapes_count);
+		_oval_sysbin_put_num(w, 0);
+		_oval_sysbin_put_num(w, oscap_list_get_itemcount(list));
+		it = oscap_iterator_new(list);
+		while (oscap_iterator_has_more(it)) {
+			struct oval_sysent *sysent = oscap_iterator_next(it);
+
+			_oval_sysbin_put_str(w, oval_sysent_get_name(sysent), NULL);
+			_oval_sysbin_put_num(w, oval_sysent_get_datatype(sysent));
+			_oval_sysbin_put_num(w, oval_sysent_get_mask(sysent) ? 1 : 0);
+			_oval_sysbin_put_num(w, oval_sysent_get_status(sysent));
+		}
+		oscap_iterator_free(it);
+	}
+	oscap_free(key);
+
+	it = oscap_iterator_new(list);
+	while (oscap_iterator_has_more(it)) {
+		struct oval_sysent *sysent = oscap_iterator_next(it);
+
+		name = oval_sysent_get_name(sysent);
+		if (oval_sysent_get_datatype(sysent) == OVAL_DATATYPE_RECORD) {
+			struct oval_record_field_iterator *fields = oval_sysent_get_record_fields(sysent);
+			struct oscap_list *flist = oscap_list_new();
+			struct oscap_iterator *fit;
+
+			while (oval_record_field_iterator_has_more(fields))
+				oscap_list_add(flist, oval_record_field_iterator_next(fields));
+			oval_record_field_iterator_free(fields);
+
+			_oval_sysbin_put_num(w, oscap_list_get_itemcount(flist));
+			fit = oscap_iterator_new(flist);
+			while (oscap_iterator_has_more(fit)) {
+				struct oval_record_field *rf = oscap_iterator_next(fit);
+
+				_oval_sysbin_put_str(w, oval_record_field_get_name(rf), NULL);
+				_oval_sysbin_put_str(w, oval_record_field_get_value(rf), oval_record_field_get_name(rf));
+				_oval_sysbin_put_num(w, oval_record_field_get_datatype(rf));
+				_oval_sysbin_put_num(w, oval_record_field_get_mask(rf) ? 1 : 0);
+				_oval_sysbin_put_num(w, oval_record_field_get_status(rf));
+			}
+			oscap_iterator_free(fit);
+			oscap_list_free0(flist);
+		} else {
+			_oval_sysbin_put_str(w, oval_sysent_get_value(sysent), name != NULL ? name : "");
+		}
+	}
+	oscap_iterator_free(it);
+	oscap_list_free0(list);
+}
+
+static void _oval_sysbin_put_header(struct oval_sysbin_writer *w, struct oval_syschar_model *model)
+{
+	struct oval_generator *generator = oval_syschar_model_get_generator(model);
+	struct oval_sysinfo *sysinfo = oval_syschar_model_get_sysinfo(model);
+	struct oscap_htable_iterator *versions;
+	struct oval_sysint_iterator *interfaces;
+	struct oscap_list *list;
+	struct oscap_iterator *it;
+
+	fwrite(OVAL_SYSBIN_MAGIC, 1, OVAL_SYSBIN_MAGIC_LEN, w->fp);
+	_oval_sysbin_put_num(w, OVAL_SYSBIN_VERSION);
+
+	_oval_sysbin_put_str(w, oval_generator_get_product_name(generator), NULL);
+	_oval_sysbin_put_str(w, oval_generator_get_product_version(generator), NULL);
+	_oval_sysbin_put_str(w, oval_generator_get_core_schema_version(generator), NULL);
+	_oval_sysbin_put_str(w, oval_generator_get_timestamp(generator), NULL);
+	_oval_sysbin_put_str(w, oval_generator_get_anyxml(generator), NULL);
+
+	list = oscap_list_new();
+	versions = oval_generator_get_platform_schema_versions(generator);
+	while (oscap_htable_iterator_has_more(versions)) {
+		const char *platform;
+
+		oscap_htable_iterator_next_kv(versions, &platform, NULL);
+		oscap_list_add(list, (void *) platform);
+	}
+	oscap_htable_iterator_free(versions);
+
+	_oval_sysbin_put_num(w, oscap_list_get_itemcount(list));
+	it = oscap_iterator_new(list);
+	while (oscap_iterator_has_more(it)) {
+		const char *platform = oscap_iterator_next(it);
+
+		_oval_sysbin_put_str(w, platform, NULL);
+		_oval_sysbin_put_str(w, oval_generator_get_platform_schema_version(generator, platform), NULL);
+	}
+	oscap_iterator_free(it);
+	oscap_list_free0(list);
+
+	_oval_sysbin_put_num(w, sysinfo != NULL ? 1 : 0);
+	if (sysinfo == NULL)
+		return;
+
+	_oval_sysbin_put_str(w, oval_sysinfo_get_os_name(sysinfo), NULL);
+	_oval_sysbin_put_str(w, oval_sysinfo_get_os_version(sysinfo), NULL);
+	_oval_sysbin_put_str(w, oval_sysinfo_get_os_architecture(sysinfo), NULL);
+	_oval_sysbin_put_str(w, oval_sysinfo_get_primary_host_name(sysinfo), NULL);
+
+	list = oscap_list_new();
+	interfaces = oval_sysinfo_get_interfaces(sysinfo);
+	while (oval_sysint_iterator_has_more(interfaces))
+		oscap_list_add(list, oval_sysint_iterator_next(interfaces));
+	oval_sysint_iterator_free(interfaces);
+
+	_oval_sysbin_put_num(w, oscap_list_get_itemcount(list));
+	it = oscap_iterator_new(list);
+	while (oscap_iterator_has_more(it)) {
+		struct oval_sysint *sysint = oscap_iterator_next(it);
+
+		_oval_sysbin_put_str(w, oval_sysint_get_name(sysint), NULL);
+		_oval_sysbin_put_str(w, oval_sysint_get_ip_address(sysint), NULL);
+		_oval_sysbin_put_str(w, oval_sysint_get_mac_address(sysint), NULL);
+	}
+	oscap_iterator_free(it);
+	oscap_list_free0(list);
+}
+
+int oval_syschar_model_export_binary(struct oval_syschar_model *model, const char *file)
+{
+	__attribute__nonnull__(model);
+
+	struct oval_sysbin_writer w;
+	struct oval_string_map *sysitem_map;
+	struct oval_syschar_iterator *syschars;
+	struct oval_iterator *sysitems;
+	int ret = 0;
+
+	w.fp = fopen(file, "w");
+	if (w.fp == NULL) {
+		oscap_seterr(OSCAP_EFAMILY_GLIBC, "Can't open '%s': %s", file, strerror(errno));
+		return -1;
+	}
+	w.strings = oval_string_map_new();
+	w.strings_count = 0;
+	w.columns = oval_string_map_new();
+	w.shapes = oval_string_map_new();
+	w.shapes_count = 0;
+
+	_oval_sysbin_put_header(&w, model);
+
+	/* the same objects and items as oval_syschar_model_to_dom() */
+	sysitem_map = oval_string_map_new();
+	syschars = oval_syschar_model_get_syschars(model);
+	while (oval_syschar_iterator_has_more(syschars)) {
+		struct oval_syschar *syschar = oval_syschar_iterator_next(syschars);
+		struct oval_sysitem_iterator *items;
+
+		if (oval_syschar_get_flag(syschar) == SYSCHAR_FLAG_UNKNOWN
+		    || oval_object_get_base_obj(oval_syschar_get_object(syschar)))
+			continue;
+		_oval_sysbin_put_syschar(&w, syschar);
+
+		items = oval_syschar_get_sysitem(syschar);
+		while (oval_sysitem_iterator_has_more(items)) {
+			struct oval_sysitem *sysitem = oval_sysitem_iterator_next(items);
+
+			if (oval_string_map_get_value(sysitem_map, oval_sysitem_get_id(sysitem)) == NULL)
+				oval_string_map_put(sysitem_map, oval_sysitem_get_id(sysitem), sysitem);
+		}
+		oval_sysitem_iterator_free(items);
+	}
+	oval_syschar_iterator_free(syschars);
+
+	sysitems = oval_string_map_values(sysitem_map);
+	while (oval_collection_iterator_has_more(sysitems))
+		_oval_sysbin_put_sysitem(&w, oval_collection_iterator_next(sysitems));
+	oval_collection_iterator_free(sysitems);
+	oval_string_map_free(sysitem_map, NULL);
+
+	putc(OVAL_SYSBIN_END, w.fp);
+
+	if (ferror(w.fp) | fclose(w.fp)) {
+		oscap_seterr(OSCAP_EFAMILY_GLIBC, "Can't write '%s': %s", file, strerror(errno));
+		ret = -1;
+	}
+
+	oval_string_map_free(w.strings, NULL);
+	oval_string_map_free(w.columns, (oscap_destruct_func) oscap_free);
+	oval_string_map_free(w.shapes, NULL);
+	return ret;
+}
+
+/*
+ * Import
+ */
+
+struct oval_sysbin_field {
+	const char *name;
+	oval_datatype_t datatype;
+	int mask;
+	oval_syschar_status_t status;
+};
+
+struct oval_sysbin_shape {
+	struct oval_sysbin_field *fields;
+	size_t count;
+};
+
+struct oval_sysbin_reader {
+	const unsigned char *p;
+	const unsigned char *end;
+	const char **strings;
+	size_t strings_count;
+	size_t strings_alloc;
+	struct oval_sysbin_shape *shapes;
+	size_t shapes_count;
+	size_t shapes_alloc;
+	char num[24];				///< the text of the last integer
+	bool error;
+	struct oval_syschar_model *model;
+};
+
+static uint64_t _oval_sysbin_get_num(struct oval_sysbin_reader *r)
+{
+	uint64_t num = 0;
+	int shift;
+
+	for (shift = 0; r->p < r->end && shift < 64; shift += 7) {
+		unsigned char byte = *r->p++;
+
+		num |= (uint64_t)(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0)
+			return num;
+	}
+
+	r->error = true;
+	return 0;
+}
+
+/* an integer is only valid until the next string is read */
+static const char *_oval_sysbin_get_str(struct oval_sysbin_reader *r)
+{
+	uint64_t code, len, num;
+	const char *s;
+
+	code = _oval_sysbin_get_num(r);
+	if (r->error)
+		return NULL;
+
+	switch (code) {
+	case OVAL_SYSBIN_NULL:
+		return NULL;
+	case OVAL_SYSBIN_INTEGER:
+		num = _oval_sysbin_get_num(r);
+		snprintf(r->num, sizeof r->num, "%" PRId64, (int64_t)(num >> 1) ^ -(int64_t)(num & 1));
+		return r->num;
+	case OVAL_SYSBIN_LITERAL:
+	case OVAL_SYSBIN_NEW:
+		len = _oval_sysbin_get_num(r);
+		if (r->error || len >= (uint64_t)(r->end - r->p) || r->p[len] != '\0') {
+			r->error = true;
+			return NULL;
+		}
+		s = (const char *) r->p;
+		r->p += len + 1;
+
+		if (code == OVAL_SYSBIN_NEW) {
+			if (r->strings_count == r->strings_alloc) {
+				r->strings_alloc = r->strings_alloc > 0 ? r->strings_alloc * 2 : 1024;
+				r->strings = oscap_realloc(r->strings, r->strings_alloc * sizeof(char *));
+			}
+			r->strings[r->strings_count++] = s;
+		}
+		return s;
+	default:
+		if (code - OVAL_SYSBIN_TABLE >= r->strings_count) {
+			r->error = true;
+			return NULL;
+		}
+		return r->strings[code - OVAL_SYSBIN_TABLE];
+	}
+}
+
+static char *_oval_sysbin_get_strdup(struct oval_sysbin_reader *r)
+{
+	return oscap_strdup(_oval_sysbin_get_str(r));
+}
+
+/* the number of the elements which follow, at least a byte each */
+static size_t _oval_sysbin_get_count(struct oval_sysbin_reader *r)
+{
+	uint64_t count = _oval_sysbin_get_num(r);
+
+	if (count > (uint64_t)(r->end - r->p)) {
+		r->error = true;
+		return 0;
+	}
+	return (size_t) count;
+}
+
+static void _oval_sysbin_get_messages(struct oval_sysbin_reader *r, struct oval_syschar *syschar, struct oval_sysitem *sysitem)
+{
+	size_t count = _oval_sysbin_get_count(r);
+
+	while (count-- > 0 && !r->error) {
+		struct oval_message *message = oval_message_new();
+
+		oval_message_set_level(message, (oval_message_level_t) _oval_sysbin_get_num(r));
+		oval_message_set_text(message, (char *) _oval_sysbin_get_str(r));
+		if (syschar != NULL)
+			oval_syschar_add_message(syschar, message);
+		else
+			oval_sysitem_add_message(sysitem, message);
+	}
+}
+
+static void _oval_sysbin_get_syschar(struct oval_sysbin_reader *r)
+{
+	struct oval_definition_model *def_model = oval_syschar_model_get_definition_model(r->model);
+	struct oval_object *object;
+	struct oval_syschar *syschar;
+	const char *id;
+	size_t count, values;
+	int instance, version;
+
+	id = _oval_sysbin_get_str(r);
+	if (id == NULL) {
+		r->error = true;
+		return;
+	}
+	object = oval_definition_model_get_new_object(def_model, id);
+	version = (int) _oval_sysbin_get_num(r);
+	/* the version of an object which isn't in the definitions */
+	if (oval_object_get_version(object) == 0)
+		oval_object_set_version(object, version);
+
+	syschar = oval_syschar_model_get_new_syschar(r->model, object);
+	oval_syschar_set_flag(syschar, (oval_syschar_collection_flag_t) _oval_sysbin_get_num(r));
+	instance = (int) _oval_sysbin_get_num(r);
+	oval_syschar_set_variable_instance(syschar, instance);
+	oval_syschar_set_variable_instance_hint(syschar, instance);
+	_oval_sysbin_get_messages(r, syschar, NULL);
+
+	count = _oval_sysbin_get_count(r);
+	while (count-- > 0 && !r->error) {
+		struct oval_variable *variable;
+		struct oval_variable_binding *binding;
+
+		id = _oval_sysbin_get_str(r);
+		if (id == NULL) {
+			r->error = true;
+			return;
+		}
+		variable = oval_definition_model_get_new_variable(def_model, id, OVAL_VARIABLE_UNKNOWN);
+		binding = oval_variable_binding_new(variable, NULL);
+
+		values = _oval_sysbin_get_count(r);
+		while (values-- > 0 && !r->error) {
+			char *value = _oval_sysbin_get_strdup(r);
+
+			if (value != NULL)
+				oval_variable_binding_add_value(binding, value);
+		}
+		oval_syschar_add_variable_binding(syschar, binding);
+	}
+
+	count = _oval_sysbin_get_count(r);
+	while (count-- > 0 && !r->error) {
+		id = _oval_sysbin_get_str(r);
+		if (id == NULL) {
+			r->error = true;
+			return;
+		}
+		oval_syschar_add_sysitem(syschar, oval_syschar_model_get_new_sysitem(r->model, id));
+	}
+}
+
+static struct oval_sysbin_shape *_oval_sysbin_get_shape(struct oval_sysbin_reader *r)
+{
+	struct oval_sysbin_shape *shape;
+	uint64_t index;
+	size_t i;
+
+	index = _oval_sysbin_get_num(r);
+	if (index > 0) {
+		if (index > r->shapes_count) {
+			r->error = true;
+			return NULL;
+		}
+		return &r->shapes[index - 1];
+	}
+
+	if (r->shapes_count == r->shapes_alloc) {
+		r->shapes_alloc = r->shapes_alloc > 0 ? r->shapes_alloc * 2 : 64;
+		r->shapes = oscap_realloc(r->shapes, r->shapes_alloc * sizeof(struct oval_sysbin_shape));
+	}
+	shape = &r->shapes[r->shapes_count++];
+	shape->count = _oval_sysbin_get_count(r);
+	shape->fields = oscap_calloc(shape->count + 1, sizeof(struct oval_sysbin_field));
+
+	for (i = 0; i < shape->count && !r->error; ++i) {
+		const char *name = _oval_sysbin_get_str(r);
+
+		shape->fields[i].name = oval_syschar_model_intern_name(r->model, name != NULL ? name : "");
+		shape->fields[i].datatype = (oval_datatype_t) _oval_sysbin_get_num(r);
+		shape->fields[i].mask = (int) _oval_sysbin_get_num(r);
+		shape->fields[i].status = (oval_syschar_status_t) _oval_sysbin_get_num(r);
+	}
+
+	return shape;
+}
+
+static void _oval_sysbin_get_sysitem(struct oval_sysbin_reader *r)
+{
+	struct oval_sysbin_shape *shape;
+	struct oval_sysitem *sysitem;
+	const char *id, *value, *shared;
+	size_t i, count;
+
+	id = _oval_sysbin_get_str(r);
+	if (id == NULL) {
+		r->error = true;
+		return;
+	}
+	sysitem = oval_syschar_model_get_new_sysitem(r->model, id);
+	oval_sysitem_set_subtype(sysitem, (oval_subtype_t) _oval_sysbin_get_num(r));
+	oval_sysitem_set_status(sysitem, (oval_syschar_status_t) _oval_sysbin_get_num(r));
+	_oval_sysbin_get_messages(r, NULL, sysitem);
+
+	shape = _oval_sysbin_get_shape(r);
+	if (shape == NULL)
+		return;
+
+	for (i = 0; i < shape->count && !r->error; ++i) {
+		const struct oval_sysbin_field *field = &shape->fields[i];
+		struct oval_sysent *sysent = oval_sysent_new(r->model);
+
+		oval_sysent_set_shared_name(sysent, field->name);
+		oval_sysent_set_datatype(sysent, field->datatype);
+		oval_sysent_set_mask(sysent, field->mask);
+		oval_sysent_set_status(sysent, field->status);
+
+		if (field->datatype == OVAL_DATATYPE_RECORD) {
+			count = _oval_sysbin_get_count(r);
+			while (count-- > 0 && !r->error) {
+				struct oval_record_field *rf = oval_record_field_new(OVAL_RECORD_FIELD_ITEM);
+
+				oval_record_field_set_name(rf, (char *) _oval_sysbin_get_str(r));
+				oval_record_field_set_value(rf, (char *) _oval_sysbin_get_str(r));
+				oval_record_field_set_datatype(rf, (oval_datatype_t) _oval_sysbin_get_num(r));
+				oval_record_field_set_mask(rf, (int) _oval_sysbin_get_num(r));
+				oval_record_field_set_status(rf, (oval_syschar_status_t) _oval_sysbin_get_num(r));
+				oval_sysent_add_record_field(sysent, rf);
+			}
+		} else {
+			value = _oval_sysbin_get_str(r);
+			/* the values repeated by many items are kept once, as by the probes */
+			if (value != NULL && (shared = oval_syschar_model_intern_value(r->model, field->name, value)) != NULL)
+				oval_sysent_set_shared_value(sysent, shared);
+			else if (value != NULL)
+				oval_sysent_set_value(sysent, (char *) value);
+		}
+
+		oval_sysitem_add_sysent(sysitem, sysent);
+	}
+}
+
+static void _oval_sysbin_get_header(struct oval_sysbin_reader *r)
+{
+	struct oval_generator *generator = oval_syschar_model_get_generator(r->model);
+	struct oval_sysinfo *sysinfo;
+	size_t count;
+	char *platform;
+
+	oval_generator_set_product_name(generator, _oval_sysbin_get_str(r));
+	oval_generator_set_product_version(generator, _oval_sysbin_get_str(r));
+	oval_generator_set_core_schema_version(generator, _oval_sysbin_get_str(r));
+	oval_generator_set_timestamp(generator, _oval_sysbin_get_str(r));
+	oval_generator_set_anyxml(generator, _oval_sysbin_get_str(r));
+
+	count = _oval_sysbin_get_count(r);
+	while (count-- > 0 && !r->error) {
+		platform = _oval_sysbin_get_strdup(r);
+		if (platform != NULL)
+			oval_generator_add_platform_schema_version(generator, platform, _oval_sysbin_get_str(r));
+		oscap_free(platform);
+	}
+
+	if (_oval_sysbin_get_num(r) == 0 || r->error)
+		return;
+
+	sysinfo = oval_sysinfo_new(r->model);
+	oval_sysinfo_set_os_name(sysinfo, (char *) _oval_sysbin_get_str(r));
+	oval_sysinfo_set_os_version(sysinfo, (char *) _oval_sysbin_get_str(r));
+	oval_sysinfo_set_os_architecture(sysinfo, (char *) _oval_sysbin_get_str(r));
+	oval_sysinfo_set_primary_host_name(sysinfo, (char *) _oval_sysbin_get_str(r));
+
+	count = _oval_sysbin_get_count(r);
+	while (count-- > 0 && !r->error) {
+		struct oval_sysint *sysint = oval_sysint_new(r->model);
+
+		oval_sysint_set_name(sysint, (char *) _oval_sysbin_get_str(r));
+		oval_sysint_set_ip_address(sysint, (char *) _oval_sysbin_get_str(r));
+		oval_sysint_set_mac_address(sysint, (char *) _oval_sysbin_get_str(r));
+		oval_sysinfo_add_interface(sysinfo, sysint);
+		oval_sysint_free(sysint);
+	}
+
+	oval_syschar_model_set_sysinfo(r->model, sysinfo);
+	oval_sysinfo_free(sysinfo);
+}
+
+int oval_syschar_model_import_binary(struct oval_syschar_model *model, const char *file)
+{
+	__attribute__nonnull__(model);
+
+	struct oval_sysbin_reader r;
+	struct stat st;
+	void *map;
+	size_t i;
+	int fd, tag = 0;
+
+	fd = open(file, O_RDONLY);
+	if (fd < 0) {
+		oscap_seterr(OSCAP_EFAMILY_GLIBC, "Can't open '%s': %s", file, strerror(errno));
+		return -1;
+	}
+	if (fstat(fd, &st) != 0 || st.st_size < OVAL_SYSBIN_MAGIC_LEN + 1) {
+		oscap_seterr(OSCAP_EFAMILY_OVAL, "'%s' is not a binary system characteristics file.", file);
+		close(fd);
+		return -1;
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		oscap_seterr(OSCAP_EFAMILY_GLIBC, "Can't map '%s': %s", file, strerror(errno));
+		return -1;
+	}
+	madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+	memset(&r, 0, sizeof r);
+	r.p = map;
+	r.end = r.p + st.st_size;
+	r.model = model;
+
+	if (memcmp(r.p, OVAL_SYSBIN_MAGIC, OVAL_SYSBIN_MAGIC_LEN) != 0) {
+		r.error = true;
+	} else {
+		r.p += OVAL_SYSBIN_MAGIC_LEN;
+		if (_oval_sysbin_get_num(&r) != OVAL_SYSBIN_VERSION)
+			r.error = true;
+	}
+
+	if (!r.error)
+		_oval_sysbin_get_header(&r);
+
+	while (!r.error && r.p < r.end) {
+		tag = *r.p++;
+		if (tag == OVAL_SYSBIN_OBJECT)
+			_oval_sysbin_get_syschar(&r);
+		else if (tag == OVAL_SYSBIN_ITEM)
+			_oval_sysbin_get_sysitem(&r);
+		else
+			break;
+	}
+
+	if (tag != OVAL_SYSBIN_END)
+		r.error = true;
+
+	for (i = 0; i < r.shapes_count; ++i)
+		oscap_free(r.shapes[i].fields);
+	oscap_free(r.shapes);
+	oscap_free(r.strings);
+	munmap(map, st.st_size);
+
+	if (r.error) {
+		oscap_seterr(OSCAP_EFAMILY_OVAL, "Invalid or truncated binary system characteristics file '%s'.", file);
+		return -1;
+	}
+	return 0;
+}
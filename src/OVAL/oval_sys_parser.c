@@ -46,6 +46,10 @@
 #include "common/debug_priv.h"
 #include "common/_error.h"
 
+/* the memory of the system characteristics, see oscap_memory_report */
+#undef OSCAP_MEMORY_TAG
+#define OSCAP_MEMORY_TAG OSCAP_MEMORY_SYSCHAR
+
 int oval_syschar_model_parse(xmlTextReaderPtr reader, struct oval_parser_context *context)
 {
 	int depth = xmlTextReaderDepth(reader);
@@ -67,7 +71,11 @@ int oval_syschar_model_parse(xmlTextReaderPtr reader, struct oval_parser_context
 			} else if (is_ovalsys && (strcmp(tagname, "collected_objects") == 0)) {
 				ret = oval_parser_parse_tag(reader, context, &oval_syschar_parse_tag, NULL);
 			} else if (is_ovalsys && (strcmp(tagname, "system_data") == 0)) {
-				ret = oval_parser_parse_tag(reader, context, &oval_sysitem_parse_tag, NULL);
+				/* the items of a lazily imported model are parsed when they are used */
+				if (oval_syschar_model_is_lazy(context->syschar_model))
+					ret = oval_parser_skip_tag(reader, context);
+				else
+					ret = oval_parser_parse_tag(reader, context, &oval_sysitem_parse_tag, NULL);
 			} else {
 				dW("Unprocessed tag: <%s:%s>.", namespace, tagname);
 				oval_parser_skip_tag(reader, context);
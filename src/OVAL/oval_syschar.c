@@ -40,11 +40,16 @@
 #include "adt/oval_collection_impl.h"
 #include "oval_agent_api_impl.h"
 #include "oval_definitions_impl.h"
+#include "oval_parser_impl.h"
 
 #include "common/assume.h"
 #include "common/util.h"
 #include "common/debug_priv.h"
 
+/* the memory of the system characteristics, see oscap_memory_report */
+#undef OSCAP_MEMORY_TAG
+#define OSCAP_MEMORY_TAG OSCAP_MEMORY_SYSCHAR
+
 typedef struct oval_syschar {
 	struct oval_syschar_model *model;
 	oval_syschar_collection_flag_t flag;
@@ -133,6 +138,25 @@ void oval_syschar_add_sysitem(struct oval_syschar *syschar, struct oval_sysitem
 	__attribute__nonnull__(syschar);
 
 	oval_collection_add(syschar->sysitem, sysitem);
+	oval_sysitem_ref(sysitem);
+}
+
+void oval_syschar_release(struct oval_syschar *syschar)
+{
+	struct oval_sysitem_iterator *items;
+
+	items = oval_syschar_get_sysitem(syschar);
+	while (oval_sysitem_iterator_has_more(items))
+		oval_sysitem_unref(oval_sysitem_iterator_next(items));
+	oval_sysitem_iterator_free(items);
+
+	oval_collection_free_items(syschar->messages, (oscap_destruct_func) oval_message_free);
+	oval_collection_free_items(syschar->sysitem, NULL);
+	oval_collection_free_items(syschar->variable_bindings, (oscap_destruct_func) oval_variable_binding_free);
+	syschar->messages = oval_collection_new();
+	syschar->sysitem = oval_collection_new();
+	syschar->variable_bindings = oval_collection_new();
+	syschar->flag = SYSCHAR_FLAG_UNKNOWN;
 }
 
 void oval_syschar_add_variable_binding(struct oval_syschar *syschar, struct oval_variable_binding *binding) {
@@ -269,9 +293,8 @@ static int _oval_syschar_parse_subtag(xmlTextReaderPtr reader, struct oval_parse
 		return_code = oval_variable_binding_parse_tag
 		    (reader, context, &_oval_syschar_parse_subtag_consume_variable_binding, &ctx);
 	} else if (strcmp("reference", tagname) == 0) {
-		char *itemid = (char *)xmlTextReaderGetAttribute(reader, BAD_CAST "item_ref");
+		const char *itemid = oval_parser_attribute_get(reader, "item_ref");
 		struct oval_sysitem *sysitem = oval_syschar_model_get_new_sysitem(context->syschar_model, itemid);
-		oscap_free(itemid);
 		oval_syschar_add_sysitem(syschar, sysitem);
 	}
 
@@ -298,6 +321,9 @@ int oval_syschar_parse_tag(xmlTextReaderPtr reader, struct oval_parser_context *
 		char *object_id = (char *)xmlTextReaderGetAttribute(reader, BAD_CAST "id");
 		struct oval_object *object = oval_definition_model_get_new_object(context->definition_model, object_id);
 		oscap_free(object_id);
+		/* keep the version of an object which isn't in the definitions, to write it back */
+		if (oval_object_get_version(object) == 0)
+			oval_object_set_version(object, oval_parser_int_attribute(reader, "version", 0));
 
 		oval_syschar_t *syschar = oval_syschar_model_get_new_syschar(context->syschar_model, object);
 		char *flag = (char *)xmlTextReaderGetAttribute(reader, BAD_CAST "flag");
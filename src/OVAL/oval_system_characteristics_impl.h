@@ -35,6 +35,7 @@
 #include "oval_parser_impl.h"
 #include "adt/oval_smc_impl.h"
 #include "../common/util.h"
+#include "../common/xml_stream.h"
 
 OSCAP_HIDDEN_START;
 
@@ -50,6 +51,16 @@ int oval_sysinfo_parse_tag(xmlTextReaderPtr reader, struct oval_parser_context *
 /* sysitem */
 void oval_sysitem_to_dom(struct oval_sysitem *, xmlDoc *, xmlNode *);
 int oval_sysitem_parse_tag(xmlTextReaderPtr, struct oval_parser_context *, void *usr);
+void oval_sysitem_set_pending(struct oval_sysitem *sysitem);
+/*
+ * The number of syschars which list the item. Once the last one releases it
+ * (see oval_syschar_release), its entities and messages are freed; the item
+ * stays in the model and is filled again if it's collected again.
+ */
+void oval_sysitem_ref(struct oval_sysitem *sysitem);
+void oval_sysitem_unref(struct oval_sysitem *sysitem);
+bool oval_sysitem_is_released(struct oval_sysitem *sysitem);
+void oval_sysitem_restore(struct oval_sysitem *sysitem);
 
 /* syschar */
 void oval_syschar_to_dom(struct oval_syschar *, xmlDoc *, xmlNode *);
@@ -57,22 +68,51 @@ int oval_syschar_parse_tag(xmlTextReaderPtr, struct oval_parser_context *context
 oval_syschar_collection_flag_t oval_syschar_flag_parse(xmlTextReaderPtr, char *, oval_syschar_collection_flag_t);
 oval_syschar_status_t oval_syschar_status_parse(xmlTextReaderPtr, char *, oval_syschar_status_t);
 struct oval_syschar_model *oval_syschar_get_model(struct oval_syschar *syschar);
+/*
+ * Drop the items, messages and variable bindings of a collected object
+ * whose items won't be read anymore. Its flag is set back to unknown, so
+ * the object is collected again if it's queried again.
+ */
+void oval_syschar_release(struct oval_syschar *syschar);
 
 /* sysent */
 typedef void (*oval_sysent_consumer) (struct oval_sysent *, void *client);
 int oval_sysent_parse_tag(xmlTextReaderPtr, struct oval_parser_context *, oval_sysent_consumer, void *);
 void oval_sysent_to_dom(struct oval_sysent *sysent, xmlDoc * doc, xmlNode * tag_parent);
 void oval_sysent_to_print(struct oval_sysent *, char *, int);
+struct oval_evr;
+const struct oval_evr *oval_sysent_get_evr(struct oval_sysent *sysent);
+struct oval_ipaddr;
+/* the value parsed by oval_ipaddr_parse, NULL if it isn't a valid address */
+const struct oval_ipaddr *oval_sysent_get_ipaddr(struct oval_sysent *sysent);
+/* the name must outlive the entity, see oval_syschar_model_intern_name */
+void oval_sysent_set_shared_name(struct oval_sysent *sysent, const char *name);
+/* the value must outlive the entity, see oval_syschar_model_intern_value */
+void oval_sysent_set_shared_value(struct oval_sysent *sysent, const char *value);
+/* the value is interned, so the same pointer is the same value for the life of the model */
+bool oval_sysent_has_shared_value(struct oval_sysent *sysent);
+/* takes the ownership of the value instead of copying it */
+void oval_sysent_take_value(struct oval_sysent *sysent, char *value);
 
 /* syschar_model */
 typedef bool oval_syschar_resolver(struct oval_syschar *, void *);
-xmlNode *oval_syschar_model_to_dom(struct oval_syschar_model *, xmlDocPtr, xmlNode *, oval_syschar_resolver, void *, bool);
+xmlNode *oval_syschar_model_to_dom(struct oval_syschar_model *, xmlDocPtr, xmlNode *, oval_syschar_resolver, void *, bool, struct xml_stream *);
 void oval_syschar_model_reset(struct oval_syschar_model *model);
 
 struct oval_syschar *oval_syschar_model_get_new_syschar(struct oval_syschar_model *, struct oval_object *);
 struct oval_sysitem *oval_syschar_model_get_new_sysitem(struct oval_syschar_model *, const char *id);
 void oval_syschar_model_add_syschar(struct oval_syschar_model *model, struct oval_syschar *syschar);
 void oval_syschar_model_add_sysitem(struct oval_syschar_model *model, struct oval_sysitem *sysitem);
+bool oval_syschar_model_is_lazy(struct oval_syschar_model *model);
+void oval_syschar_model_load_sysitem(struct oval_syschar_model *model, struct oval_sysitem *sysitem);
+/* a copy of the name which is kept as long as the model, shared by the entities of its items */
+const char *oval_syschar_model_intern_name(struct oval_syschar_model *model, const char *name);
+/*
+ * The same for the values of the entities with the name, e.g. the owners,
+ * types and paths of the files. NULL once the values of the entities with
+ * the name turn out to be mostly different, e.g. sizes or inodes.
+ */
+const char *oval_syschar_model_intern_value(struct oval_syschar_model *model, const char *name, const char *value);
 
 void oval_syschar_model_set_schema(struct oval_syschar_model *model, const char * schema);
 const char * oval_syschar_model_get_schema(struct oval_syschar_model * model);
@@ -51,6 +51,7 @@ typedef struct oval_test {
 	struct oval_collection *notes;
 	char *comment;
 	char *id;
+	int id_index;				///< see oval_definition_model_intern_id
 	int deprecated;
 	int version;
 	oval_existence_t existence;
@@ -112,6 +113,13 @@ char *oval_test_get_id(struct oval_test *test)
 	return test->id;
 }
 
+int oval_test_get_id_index(struct oval_test *test)
+{
+	__attribute__nonnull__(test);
+
+	return test->id_index;
+}
+
 bool oval_test_get_deprecated(struct oval_test * test)
 {
 	__attribute__nonnull__(test);
@@ -205,6 +213,7 @@ struct oval_test *oval_test_new(struct oval_definition_model *model, const char
 	test->subtype = OVAL_SUBTYPE_UNKNOWN;
 	test->comment = NULL;
 	test->id = oscap_strdup(id);
+	test->id_index = oval_definition_model_intern_id(model, id);
 	test->object = NULL;
 	test->states = oval_collection_new();
 	test->notes = oval_collection_new();
@@ -356,22 +365,18 @@ static int _oval_test_parse_tag(xmlTextReaderPtr reader, struct oval_parser_cont
 	if ((strcmp(tagname, "notes") == 0)) {
 		return_code = oval_parser_parse_tag(reader, context, &_oval_test_parse_notes, test);
 	} else if ((strcmp(tagname, "object") == 0)) {
-		char *object_ref = (char *)xmlTextReaderGetAttribute(reader, BAD_CAST "object_ref");
+		const char *object_ref = oval_parser_attribute_get(reader, "object_ref");
 		if (object_ref != NULL) {
 			struct oval_definition_model *model = context->definition_model;
 			struct oval_object *object = oval_definition_model_get_new_object(model, object_ref);
-			oscap_free(object_ref);
-			object_ref = NULL;
 			oval_test_set_object(test, object);
 		}
 	} else if ((strcmp(tagname, "state") == 0)) {
-		char *state_ref = (char *)xmlTextReaderGetAttribute(reader, BAD_CAST "state_ref");
+		const char *state_ref = oval_parser_attribute_get(reader, "state_ref");
 		if (state_ref != NULL) {
 			struct oval_definition_model *model = context->definition_model;
 			struct oval_state *state = oval_definition_model_get_new_state(model, state_ref);
 			oval_test_add_state(test, state);
-			oscap_free(state_ref);
-			state_ref = NULL;
 		}
 	} else {
 		dW("Skipping tag <%s>.", tagname);
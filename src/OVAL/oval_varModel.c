@@ -33,6 +33,7 @@
 
 #include <string.h>
 #include <time.h>
+#include <pthread.h>
 
 #include "oval_definitions_impl.h"
 #include "oval_agent_api_impl.h"
@@ -46,16 +47,30 @@
 #include "oscap_source.h"
 #include "source/oscap_source_priv.h"
 
+/*
+ * The values of a variable are kept as an array of texts, all of them of
+ * the datatype of the variable. The probes and the state comparisons read
+ * the array, the oval_value objects are built only when the public API
+ * asks for them.
+ */
 typedef struct _oval_variable_model_frame {
 	char *id;
 	char *comment;
-	struct oval_collection *values;
 	oval_datatype_t datatype;
+	char **texts;
+	int count;
+	int alloc;
+	struct oval_collection *values;
 } _oval_variable_model_frame_t;
 
 typedef struct oval_variable_model {
 	struct oval_generator *generator;
+	/* the dense index of the id of a variable is the index of its frame */
 	struct oval_string_map *varmap;
+	_oval_variable_model_frame_t **frames;
+	int frames_alloc;
+	/* guards the building of the oval_value objects of the frames */
+	pthread_mutex_t lock;
 } oval_variable_model_t;
 
 static _oval_variable_model_frame_t *_oval_variable_model_frame_new(char *id, const char *comm, oval_datatype_t datatype);
@@ -78,10 +93,64 @@ static _oval_variable_model_frame_t *_oval_variable_model_frame_new(char *id, co
 	frame->id = oscap_strdup(id);
 	frame->comment = oscap_strdup(comm);
 	frame->datatype = datatype;
-	frame->values = oval_collection_new();
+	frame->texts = NULL;
+	frame->count = 0;
+	frame->alloc = 0;
+	frame->values = NULL;
 	return frame;
 }
 
+static void _oval_variable_model_frame_add_value(_oval_variable_model_frame_t *frame, const char *text)
+{
+	if (frame->count == frame->alloc) {
+		frame->alloc = frame->alloc ? 2 * frame->alloc : 8;
+		frame->texts = oscap_realloc(frame->texts, frame->alloc * sizeof(char *));
+	}
+	frame->texts[frame->count++] = oscap_strdup(text);
+	if (frame->values != NULL)
+		oval_collection_add(frame->values, oval_value_new(frame->datatype, (char *) text));
+}
+
+static _oval_variable_model_frame_t *_oval_variable_model_get_frame(struct oval_variable_model *model, const char *varid)
+{
+	int index = oval_string_map_get_index(model->varmap, varid);
+	return (index < 0) ? NULL : model->frames[index];
+}
+
+static _oval_variable_model_frame_t *_oval_variable_model_add_frame(struct oval_variable_model *model,
+		char *varid, const char *comm, oval_datatype_t datatype)
+{
+	int index = oval_string_map_intern(model->varmap, varid);
+
+	if (index >= model->frames_alloc) {
+		int alloc = model->frames_alloc ? 2 * model->frames_alloc : 16;
+
+		while (alloc <= index)
+			alloc *= 2;
+		model->frames = oscap_realloc(model->frames, alloc * sizeof(_oval_variable_model_frame_t *));
+		memset(model->frames + model->frames_alloc, 0, (alloc - model->frames_alloc) * sizeof(_oval_variable_model_frame_t *));
+		model->frames_alloc = alloc;
+	}
+	model->frames[index] = _oval_variable_model_frame_new(varid, comm, datatype);
+	return model->frames[index];
+}
+
+/* the oval_value objects of the frame, built on the first request */
+static struct oval_collection *_oval_variable_model_frame_get_values(struct oval_variable_model *model,
+		_oval_variable_model_frame_t *frame)
+{
+	pthread_mutex_lock(&model->lock);
+	if (frame->values == NULL) {
+		struct oval_collection *values = oval_collection_new();
+
+		for (int i = 0; i < frame->count; ++i)
+			oval_collection_add(values, oval_value_new(frame->datatype, frame->texts[i]));
+		frame->values = values;
+	}
+	pthread_mutex_unlock(&model->lock);
+	return frame->values;
+}
+
 bool oval_variable_model_iterator_has_more(struct oval_variable_model_iterator *itr)
 {
 	return oval_collection_iterator_has_more((struct oval_iterator *) itr);
@@ -104,8 +173,13 @@ static void _oval_variable_model_frame_free(_oval_variable_model_frame_t * frame
 			oscap_free(frame->id);
 		if (frame->comment)
 			oscap_free(frame->comment);
-		oval_collection_free_items(frame->values, (oscap_destruct_func) oval_value_free);
+		for (int i = 0; i < frame->count; ++i)
+			oscap_free(frame->texts[i]);
+		oscap_free(frame->texts);
+		if (frame->values)
+			oval_collection_free_items(frame->values, (oscap_destruct_func) oval_value_free);
 		frame->id = NULL;
+		frame->texts = NULL;
 		frame->comment = NULL;
 		frame->values = NULL;
 		frame->datatype = 0;
@@ -120,36 +194,39 @@ struct oval_variable_model *oval_variable_model_new()
 		return NULL;
 	model->generator = oval_generator_new();
 	model->varmap = oval_string_map_new();
+	model->frames = NULL;
+	model->frames_alloc = 0;
+	pthread_mutex_init(&model->lock, NULL);
 	return model;
 }
 
 struct oval_variable_model *oval_variable_model_clone(struct oval_variable_model *old_model)
 {
 	struct oval_variable_model *new_model = oval_variable_model_new();
-	struct oval_string_iterator *old_varids = oval_variable_model_get_variable_ids(old_model);
-	while (oval_string_iterator_has_more(old_varids)) {
-		char *varid = oval_string_iterator_next(old_varids);
-		oval_datatype_t datatype = oval_variable_model_get_datatype(old_model, varid);
-		struct oval_value_iterator *values = oval_variable_model_get_values(old_model, varid);
-		const char *comm = oval_variable_model_get_comment(old_model, varid);
-		while (oval_value_iterator_has_more(values)) {
-			struct oval_value *ov;
-			char *text;
-
-			ov = oval_value_iterator_next(values);
-			text = oval_value_get_text(ov);
-			oval_variable_model_add(new_model, varid, comm, datatype, text);
-		}
-		oval_value_iterator_free(values);
-	} oval_string_iterator_free(old_varids);
+	int count = oval_string_map_get_count(old_model->varmap);
+
+	for (int i = 0; i < count; ++i) {
+		_oval_variable_model_frame_t *old_frame = old_model->frames[i];
+		_oval_variable_model_frame_t *frame;
+
+		frame = _oval_variable_model_add_frame(new_model, old_frame->id, old_frame->comment, old_frame->datatype);
+		for (int j = 0; j < old_frame->count; ++j)
+			_oval_variable_model_frame_add_value(frame, old_frame->texts[j]);
+	}
 	return new_model;
 }
 
 void oval_variable_model_free(struct oval_variable_model *model)
 {
 	if (model) {
-		oval_string_map_free(model->varmap, (oscap_destruct_func) _oval_variable_model_frame_free);
+		int count = oval_string_map_get_count(model->varmap);
+
+		for (int i = 0; i < count; ++i)
+			_oval_variable_model_frame_free(model->frames[i]);
+		oscap_free(model->frames);
+		oval_string_map_free0(model->varmap);
 		model->varmap = NULL;
+		pthread_mutex_destroy(&model->lock);
 		oval_generator_free(model->generator);
 		oscap_free(model);
 	}
@@ -169,16 +246,14 @@ void oval_variable_model_set_generator(struct oval_variable_model *model, struct
 void oval_variable_model_add(struct oval_variable_model *model, char *varid, const char *comm,
 			     oval_datatype_t datatype, char *value)
 {
-	struct oval_value *ov;
+	_oval_variable_model_frame_t *frame;
 
-	struct _oval_variable_model_frame *frame =
-	    (struct _oval_variable_model_frame *)oval_string_map_get_value(model->varmap, varid);
-	if (frame == NULL) {
-		frame = _oval_variable_model_frame_new(varid, comm, datatype);
-		oval_string_map_put(model->varmap, varid, frame);
-	}
-	ov = oval_value_new(datatype, value);
-	oval_collection_add(frame->values, ov);
+	pthread_mutex_lock(&model->lock);
+	frame = _oval_variable_model_get_frame(model, varid);
+	if (frame == NULL)
+		frame = _oval_variable_model_add_frame(model, varid, comm, datatype);
+	pthread_mutex_unlock(&model->lock);
+	_oval_variable_model_frame_add_value(frame, value);
 }
 
 #define NAMESPACE_VARIABLES "http://oval.mitre.org/XMLSchema/oval-variables-5"
@@ -190,12 +265,9 @@ static int _oval_variable_model_parse_variable_values
 	int return_code;
 	bool is_variable_ns = oscap_strcmp(NAMESPACE_VARIABLES, namespace) == 0;
 	if (is_variable_ns && oscap_strcmp("value", tagname) == 0) {
-		struct oval_value *ov;
-
 		return_code = xmlTextReaderRead(reader);
 		char *value = (char *)xmlTextReaderValue(reader);
-		ov = oval_value_new(frame->datatype, value);
-		oval_collection_add(frame->values, ov);
+		_oval_variable_model_frame_add_value(frame, value);
 		oscap_free(value);
 	} else {
 		dW("Unprocessed tag: <%s:%s>.", namespace, tagname);
@@ -212,22 +284,22 @@ static int _oval_variable_model_parse_variable
 	char *id = (char *)xmlTextReaderGetAttribute(reader, BAD_CAST "id");
 	char *comm = (char *)xmlTextReaderGetAttribute(reader, BAD_CAST "comment");
 	oval_datatype_t datatype = oval_datatype_parse(reader, "datatype", OVAL_DATATYPE_STRING);
-	_oval_variable_model_frame_t *frame = oval_string_map_get_value(model->varmap, id);
-	int return_code = 1;
-	if (frame) {
-		if (frame->datatype != datatype) {
-			dW("Unmatched variable datatypes: %s:%s.",
-				      oval_datatype_get_text(frame->datatype), oval_datatype_get_text(datatype));
-			oval_parser_skip_tag(reader, context);
-			return_code = 0;
-		}
+	_oval_variable_model_frame_t *frame = _oval_variable_model_get_frame(model, id);
+	int return_code;
+	if (frame == NULL) {
+		frame = _oval_variable_model_add_frame(model, id, comm, datatype);
+	} else if (frame->datatype != datatype) {
+		dW("Unmatched variable datatypes: %s:%s.",
+			      oval_datatype_get_text(frame->datatype), oval_datatype_get_text(datatype));
 		frame = NULL;
+	}
+	if (frame != NULL) {
+		return_code =
+		    oval_parser_parse_tag(reader, context, (oval_xml_tag_parser) _oval_variable_model_parse_variable_values, frame);
 	} else {
-		frame = _oval_variable_model_frame_new(id, comm, datatype);
-		oval_string_map_put(model->varmap, id, frame);
+		oval_parser_skip_tag(reader, context);
+		return_code = 0;
 	}
-	return_code =
-	    oval_parser_parse_tag(reader, context, (oval_xml_tag_parser) _oval_variable_model_parse_variable_values, frame);
 	oscap_free(id);
 	oscap_free(comm);
 	return return_code;
@@ -357,24 +429,15 @@ static xmlNode *oval_variable_model_to_dom(struct oval_variable_model * variable
 	struct oval_string_iterator *varids = oval_variable_model_get_variable_ids(variable_model);
 	while (oval_string_iterator_has_more(varids)) {
 		char *varid = oval_string_iterator_next(varids);
-		oval_datatype_t datatype = oval_variable_model_get_datatype(variable_model, varid);
-		const char *comm = oval_variable_model_get_comment(variable_model, varid);
+		_oval_variable_model_frame_t *frame = _oval_variable_model_get_frame(variable_model, varid);
 
                 xmlNode *variable = xmlNewTextChild(variables, ns_variables, BAD_CAST "variable", NULL);
                 xmlNewProp(variable, BAD_CAST "id", BAD_CAST varid);
-                xmlNewProp(variable, BAD_CAST "datatype", BAD_CAST oval_datatype_get_text(datatype));
-                xmlNewProp(variable, BAD_CAST "comment", BAD_CAST comm);
-
-		struct oval_value_iterator *value_itr = oval_variable_model_get_values(variable_model, varid);
-		while (oval_value_iterator_has_more(value_itr)) {
-			struct oval_value *value;
-			char *text;
-
-			value = oval_value_iterator_next(value_itr);
-			text = oval_value_get_text(value);
-			xmlNewTextChild(variable, ns_variables, BAD_CAST "value", BAD_CAST text);
-		}
-                oval_value_iterator_free(value_itr);
+                xmlNewProp(variable, BAD_CAST "datatype", BAD_CAST oval_datatype_get_text(frame->datatype));
+                xmlNewProp(variable, BAD_CAST "comment", BAD_CAST frame->comment);
+
+		for (int i = 0; i < frame->count; ++i)
+			xmlNewTextChild(variable, ns_variables, BAD_CAST "value", BAD_CAST frame->texts[i]);
 	}
         oval_string_iterator_free(varids);
 
@@ -401,15 +464,7 @@ int oval_variable_model_export(struct oval_variable_model *model, const char *fi
 bool oval_variable_model_has_variable(struct oval_variable_model *model, const char * id)
 {
         __attribute__nonnull__(model);
-        struct oval_string_iterator * str_it = (struct oval_string_iterator *)oval_string_map_keys(model->varmap);
-        while (oval_string_iterator_has_more(str_it)) {
-            if (!oscap_strcmp(oval_string_iterator_next(str_it), id)) {
-                oval_string_iterator_free(str_it);
-                return true;
-            }
-        }
-        oval_string_iterator_free(str_it);
-        return false;
+        return id != NULL && oval_string_map_get_index(model->varmap, id) >= 0;
 }
 
 struct oval_string_iterator *oval_variable_model_get_variable_ids(struct oval_variable_model *model)
@@ -421,28 +476,52 @@ oval_datatype_t oval_variable_model_get_datatype(struct oval_variable_model *mod
 {
 
 	__attribute__nonnull__(model);
-	_oval_variable_model_frame_t *frame = oval_string_map_get_value(model->varmap, varid);
+	_oval_variable_model_frame_t *frame = _oval_variable_model_get_frame(model, varid);
 	return (frame) ? frame->datatype : OVAL_DATATYPE_UNKNOWN;
 }
 
 const char *oval_variable_model_get_comment(struct oval_variable_model *model, char *varid)
 {
 	__attribute__nonnull__(model);
-	_oval_variable_model_frame_t *frame = oval_string_map_get_value(model->varmap, varid);
+	_oval_variable_model_frame_t *frame = _oval_variable_model_get_frame(model, varid);
 	return (frame) ? frame->comment : NULL;
 }
 
 struct oval_value_iterator *oval_variable_model_get_values(struct oval_variable_model *model, char *varid)
 {
 	__attribute__nonnull__(model);
-	_oval_variable_model_frame_t *frame = oval_string_map_get_value(model->varmap, varid);
-	return (frame) ? (struct oval_value_iterator *) oval_collection_iterator(frame->values) : NULL;
+	_oval_variable_model_frame_t *frame = _oval_variable_model_get_frame(model, varid);
+	return (frame) ? (struct oval_value_iterator *)
+		oval_collection_iterator(_oval_variable_model_frame_get_values(model, frame)) : NULL;
 }
 
-struct oval_collection *oval_variable_model_get_values_ref(struct oval_variable_model *model, char *varid)
+int oval_variable_model_get_index(struct oval_variable_model *model, const char *varid)
 {
-	_oval_variable_model_frame_t *frame;
+	return oval_string_map_get_index(model->varmap, varid);
+}
 
-	frame = oval_string_map_get_value(model->varmap, varid);
-	return (frame) ? frame->values : NULL;
+int oval_variable_model_get_variable_count(struct oval_variable_model *model)
+{
+	return oval_string_map_get_count(model->varmap);
+}
+
+const char *oval_variable_model_get_id_at(struct oval_variable_model *model, int index)
+{
+	return model->frames[index]->id;
+}
+
+int oval_variable_model_get_texts_at(struct oval_variable_model *model, int index,
+				     const char *const **texts, oval_datatype_t *datatype)
+{
+	_oval_variable_model_frame_t *frame = model->frames[index];
+
+	*texts = (const char *const *) frame->texts;
+	if (datatype != NULL)
+		*datatype = frame->datatype;
+	return frame->count;
+}
+
+struct oval_collection *oval_variable_model_get_values_at(struct oval_variable_model *model, int index)
+{
+	return _oval_variable_model_frame_get_values(model, model->frames[index]);
 }
@@ -69,7 +69,9 @@ typedef struct {
 	VAR_BASE;
 	struct oval_collection *possible_values;
 	struct oval_collection *possible_restrictions;
-	struct oval_collection *values_ref;
+	/* the bound variable model and the index of the variable in it */
+	struct oval_variable_model *varmodel;
+	int varmodel_index;
 } oval_variable_EXTERNAL_t;
 
 typedef struct {
@@ -248,7 +250,7 @@ struct oval_value_iterator *oval_variable_get_values(struct oval_variable *varia
 	case OVAL_VARIABLE_EXTERNAL: {
 		oval_variable_EXTERNAL_t *var = (oval_variable_EXTERNAL_t *) variable;
 
-		values = var->values_ref;
+		values = (var->varmodel) ? oval_variable_model_get_values_at(var->varmodel, var->varmodel_index) : NULL;
 		break;
 	}
 	case OVAL_VARIABLE_CONSTANT: {
@@ -296,6 +298,17 @@ bool oval_variable_contains_value(struct oval_variable *variable, const char* o_
 {
 	if (variable == NULL)
 		return false;
+
+	const char *const *texts;
+	int count = oval_variable_get_value_texts(variable, &texts, NULL);
+	if (count >= 0) {
+		for (int i = 0; i < count; ++i) {
+			if (oscap_streq(texts[i], o_value_text))
+				return true;
+		}
+		return false;
+	}
+
 	struct oval_value_iterator *value_it = oval_variable_get_values(variable);
 	bool found = false;
 	while (!found && oval_value_iterator_has_more(value_it)) {
@@ -466,7 +479,8 @@ struct oval_variable *oval_variable_new(struct oval_definition_model *model, con
 			evar = (oval_variable_EXTERNAL_t *) variable;
 			evar->possible_values = oval_collection_new();
 			evar->possible_restrictions = oval_collection_new();
-			evar->values_ref = NULL;
+			evar->varmodel = NULL;
+			evar->varmodel_index = -1;
 			evar->flag = SYSCHAR_FLAG_NOT_COLLECTED;
 		}
 		break;
@@ -575,7 +589,8 @@ struct oval_variable *oval_variable_clone(struct oval_definition_model *new_mode
 			}
 			oval_collection_iterator_free(old_pr_itr);
 
-			evar->values_ref = old_evar->values_ref;
+			evar->varmodel = old_evar->varmodel;
+			evar->varmodel_index = old_evar->varmodel_index;
 
 			break;
 		}
@@ -634,7 +649,7 @@ void oval_variable_free(struct oval_variable *variable)
 			evar = (oval_variable_EXTERNAL_t *) variable;
 			oval_collection_free_items(evar->possible_values, (oscap_destruct_func) oval_variable_possible_value_free);
 			oval_collection_free_items(evar->possible_restrictions, (oscap_destruct_func) oval_variable_possible_restriction_free);
-			evar->values_ref = NULL;
+			evar->varmodel = NULL;
 
 			break;
 		}
@@ -686,7 +701,8 @@ void oval_variable_set_type(struct oval_variable *variable, oval_variable_type_t
 		oval_variable_EXTERNAL_t *evar;
 
 		evar = (oval_variable_EXTERNAL_t *) variable;
-		evar->values_ref = NULL;
+		evar->varmodel = NULL;
+		evar->varmodel_index = -1;
 		evar->possible_values = oval_collection_new();
 		evar->possible_restrictions = oval_collection_new();
 		evar->flag = SYSCHAR_FLAG_NOT_COLLECTED;
@@ -765,7 +781,7 @@ void oval_variable_clear_values(struct oval_variable *variable)
 {
 	__attribute__nonnull__(variable);
 
-	if (variable->type != OVAL_VARIABLE_CONSTANT && variable->type != OVAL_VARIABLE_EXTERNAL) {
+	if (variable->type == OVAL_VARIABLE_UNKNOWN) {
 		dW("Wrong variable type for this operation: %d.", variable->type);
 		return;
         }
@@ -787,20 +803,32 @@ void oval_variable_clear_values(struct oval_variable *variable)
 		oval_variable_EXTERNAL_t *evar;
 
 		evar = (oval_variable_EXTERNAL_t *) variable;
-		evar->values_ref = NULL;
+		evar->varmodel = NULL;
+		evar->varmodel_index = -1;
 		evar->flag = SYSCHAR_FLAG_NOT_COLLECTED;
 
 		break;
 	}
+	case OVAL_VARIABLE_LOCAL: {
+		oval_variable_LOCAL_t *lvar;
+
+		/* the values are computed again on the next query */
+		lvar = (oval_variable_LOCAL_t *) variable;
+		if (lvar->values) {
+			oval_collection_free_items(lvar->values, (oscap_destruct_func) oval_value_free);
+			lvar->values = NULL;
+		}
+		lvar->flag = SYSCHAR_FLAG_UNKNOWN;
+
+		break;
+	}
 	default:
 		break;
 	}
 }
 
-static int oval_value_satisfies_possible_restriction(struct oval_value *value, struct oval_variable_possible_restriction *pr)
+static int oval_value_satisfies_possible_restriction(const char *text, oval_datatype_t datatype, struct oval_variable_possible_restriction *pr)
 {
-	oval_datatype_t datatype = oval_value_get_datatype(value);
-	char *text = oval_value_get_text(value);
 	oval_operator_t operator = pr->operator;
 	struct oresults results;
 	ores_clear(&results);
@@ -814,19 +842,20 @@ static int oval_value_satisfies_possible_restriction(struct oval_value *value, s
 	return (ores_get_result_byopr(&results, operator) == OVAL_RESULT_TRUE);
 }
 
-static int oval_variable_validate_ext_var(oval_variable_EXTERNAL_t *var, struct oval_collection *oval_values)
+static int oval_variable_validate_ext_var(oval_variable_EXTERNAL_t *var, struct oval_variable_model *varmod, int index)
 {
-	if (oval_values == NULL)
+	if (index < 0)
 		return 1;
 
 	int retval = 0;
 	if (!oval_collection_is_empty(var->possible_values) ||
 		!oval_collection_is_empty(var->possible_restrictions)) {
 		/* Check that the value of variable is allowed */
-		struct oval_iterator *values = oval_collection_iterator(oval_values);
-		while (!retval && oval_collection_iterator_has_more(values)) {
-			struct oval_value *value = oval_collection_iterator_next(values);
-			const char *text = oval_value_get_text(value);
+		const char *const *texts;
+		oval_datatype_t datatype;
+		int count = oval_variable_model_get_texts_at(varmod, index, &texts, &datatype);
+		for (int i = 0; !retval && i < count; ++i) {
+			const char *text = texts[i];
 			int found = 0;
 			struct oval_iterator *possible_values = oval_collection_iterator(var->possible_values);
 			while(!found && oval_collection_iterator_has_more(possible_values)) {
@@ -840,7 +869,7 @@ static int oval_variable_validate_ext_var(oval_variable_EXTERNAL_t *var, struct
 			struct oval_iterator *possible_restrictions = oval_collection_iterator(var->possible_restrictions);
 			while(!found && oval_collection_iterator_has_more(possible_restrictions)) {
 				struct oval_variable_possible_restriction *pr = oval_collection_iterator_next(possible_restrictions);
-				if (oval_value_satisfies_possible_restriction(value, pr)) {
+				if (oval_value_satisfies_possible_restriction(text, datatype, pr)) {
 					found = 1;
 				}
 			}
@@ -849,12 +878,11 @@ static int oval_variable_validate_ext_var(oval_variable_EXTERNAL_t *var, struct
 				retval = 1;
 			}
 		}
-		oval_collection_iterator_free(values);
 	}
 	return retval;
 }
 
-int oval_variable_bind_ext_var(struct oval_variable *var, struct oval_variable_model *varmod, char *extvar_id)
+int oval_variable_bind_ext_var(struct oval_variable *var, struct oval_variable_model *varmod, int index)
 {
 	oval_variable_EXTERNAL_t *evar;
 
@@ -864,17 +892,31 @@ int oval_variable_bind_ext_var(struct oval_variable *var, struct oval_variable_m
 	}
 
 	evar = (oval_variable_EXTERNAL_t *) var;
-	struct oval_collection *values_ref = oval_variable_model_get_values_ref(varmod, extvar_id);
-	if (oval_variable_validate_ext_var(evar, values_ref)) {
+	if (oval_variable_validate_ext_var(evar, varmod, index)) {
 		evar->flag = SYSCHAR_FLAG_DOES_NOT_EXIST;
 		return 1;
 	} else {
-		evar->values_ref = values_ref;
+		evar->varmodel = varmod;
+		evar->varmodel_index = index;
 		evar->flag = SYSCHAR_FLAG_COMPLETE;
 		return 0;
 	}
 }
 
+int oval_variable_get_value_texts(struct oval_variable *variable, const char *const **texts, oval_datatype_t *datatype)
+{
+	oval_variable_EXTERNAL_t *evar;
+
+	if (variable->type != OVAL_VARIABLE_EXTERNAL)
+		return -1;
+
+	evar = (oval_variable_EXTERNAL_t *) variable;
+	if (evar->varmodel == NULL)
+		return -1;
+
+	return oval_variable_model_get_texts_at(evar->varmodel, evar->varmodel_index, texts, datatype);
+}
+
 void oval_variable_set_component(struct oval_variable *variable, struct oval_component *component)
 {
 	__attribute__nonnull__(variable);
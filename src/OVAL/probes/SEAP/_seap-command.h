@@ -26,6 +26,7 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
 #if defined(SEAP_THREAD_SAFE)
 # include <pthread.h>
 #endif
@@ -107,12 +108,31 @@ typedef uint8_t SEAP_cflags_t;
 /* Backends */
 #include "seap-command-backendT.h"
 
-typedef struct {
+typedef struct SEAP_cmdjob {
         SEAP_CTX_t *ctx;
         int         sd;
-        SEAP_cmd_t *cmd;
+        SEAP_cmd_t  cmd;  /* owns cmd.args */
+        struct SEAP_cmdjob *next;
 } SEAP_cmdjob_t;
 
+/*
+ * The workers executing the commands of a context with SEAP_CFLG_THREAD.
+ * The jobs wait in the order of arrival; a job is taken by the first idle
+ * worker unless another worker runs a job of the same descriptor, so the
+ * commands of a descriptor are executed one at a time and in order, and
+ * those of different descriptors in parallel.
+ */
+typedef struct {
+        pthread_mutex_t lock;
+        pthread_cond_t  cond;   /* a job is ready or the pool is stopping */
+        pthread_t      *thread;
+        int            *busy;   /* the descriptor served by each worker or -1 */
+        unsigned int    count;
+        SEAP_cmdjob_t  *head;
+        SEAP_cmdjob_t  *tail;
+        bool            stop;
+} SEAP_cmdpool_t;
+
 SEAP_cmdjob_t *SEAP_cmdjob_new (void);
 void SEAP_cmdjob_free (SEAP_cmdjob_t *j);
 
@@ -63,6 +63,7 @@ extern const SEAP_schemefn_t __schtbl[];
 #define SEAP_IO_EVANY   0x08
 
 #define SEAP_RECVBUF_SIZE 4*4096
+#define SEAP_RECVBUF_MAX  (256 * 1024) /* reads of the rest of a large frame */
 #define SEAP_SENDBUF_SIZE 4*4096
 
 SEAP_scheme_t SEAP_scheme_search (const SEAP_schemefn_t fntable[], const char *sch, size_t schlen);
@@ -83,6 +84,14 @@ SEAP_scheme_t SEAP_scheme_search (const SEAP_schemefn_t fntable[], const char *s
 #include "sch_pipe.h"
 #define SCH_PIPE    3
 
+/* shared memory */
+#include "sch_shm.h"
+#define SCH_SHM     4
+
+/* remote probes over ssh */
+#include "sch_ssh.h"
+#define SCH_SSH     5
+
 #define SCH_NONE    255
 
 OSCAP_HIDDEN_END;
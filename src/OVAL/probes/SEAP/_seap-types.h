@@ -42,6 +42,7 @@ struct SEAP_CTX {
         SEAP_desctable_t *sd_table;
         SEAP_cmdtbl_t *cmd_c_table;
         SEAP_cflags_t  cflags;
+        SEAP_cmdpool_t *cmdpool;
 
         uint16_t recv_timeout;
         uint16_t send_timeout;
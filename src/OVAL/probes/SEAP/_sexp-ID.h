@@ -2,10 +2,17 @@
 #define _SEXP_ID_H
 
 #include "public/sexp-ID.h"
+#include "_sexp-value.h"
 
 typedef struct {
 	SEXP_ID_t hash;
 	int       part;
 } __IDres_pair;
 
+/*
+ * Update the cached ID accumulator of a list value after `memb' was
+ * appended to it. Does nothing if the list ID isn't tracked.
+ */
+void SEXP_ID_list_append(SEXP_val_t *v_dsc, const SEXP_t *memb);
+
 #endif /* _SEXP_ID_H */
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#pragma once
+#ifndef _SEXP_BINARY_H
+#define _SEXP_BINARY_H
+
+#include <stdint.h>
+#include "public/sexp-output.h"
+#include "public/sexp-parser.h"
+#include "../../../common/util.h"
+
+OSCAP_HIDDEN_START;
+
+/*
+ * Binary wire format
+ *
+ * A frame starts with SEXP_BINARY_MAGIC followed by the length of the
+ * payload (32 bits, big endian). The payload is one encoded S-exp:
+ *
+ *   value    := [datatype] (number | string | list)
+ *   datatype := TAG_DATATYPE varint(length) name
+ *   number   := TAG_FALSE | TAG_TRUE
+ *             | TAG_UINT varint(n) | TAG_NINT varint(-(n + 1))
+ *             | TAG_DOUBLE 8 bytes (IEEE 754, big endian)
+ *   string   := TAG_STRING varint(length) bytes
+ *   list     := TAG_LIST varint(count) value*
+ *
+ * Integers are decoded into the smallest number type which can hold
+ * the value, exactly as the text parser does.
+ *
+ * The magic byte can't start a textual S-exp, so the receiver can tell
+ * the two formats apart by looking at the first byte of a frame.
+ */
+#define SEXP_BINARY_MAGIC 0xb5
+#define SEXP_BINARY_HDRSZ 5
+#define SEXP_BINARY_MAXDEPTH 1024
+
+/*
+ * Incremental decoding
+ *
+ * The decoder reads the frame payload from [cur, end). If the payload
+ * isn't all there, `left' is the number of bytes still to come and
+ * fill() is called whenever the decoder needs more than what's in the
+ * buffer. It has to make at least `need' bytes available at cur (it may
+ * move the buffer and update cur, end and left) or return -1.
+ *
+ * If emit isn't NULL it's called with every decoded member of a list
+ * which is less than SEXP_BINARY_EMITDEPTH levels deep, before the
+ * member is added to the list. list[i] are the enclosing lists, still
+ * being decoded, index[i] is the position (1-based) of the next level
+ * in list[i] and count[i] the number of members of list[i]. If emit
+ * returns 1 the member was consumed and isn't added to the list.
+ */
+#define SEXP_BINARY_EMITDEPTH 8
+
+typedef struct SEXP_bdec SEXP_bdec_t;
+
+struct SEXP_bdec {
+        const uint8_t *cur;
+        const uint8_t *end;
+        size_t         left;
+
+        int  (*fill) (SEXP_bdec_t *dec, size_t need);
+        int  (*emit) (SEXP_bdec_t *dec, SEXP_t *memb, unsigned int depth);
+        void  *arg;
+
+        SEXP_t  *list[SEXP_BINARY_EMITDEPTH];
+        uint32_t index[SEXP_BINARY_EMITDEPTH];
+        uint32_t count[SEXP_BINARY_EMITDEPTH];
+};
+
+/**
+ * Decode the payload of a frame, the header has to be consumed by the
+ * caller. All of the payload is consumed on success.
+ * @return NULL and errno set to EILSEQ if the payload isn't valid or
+ *         fill failed
+ */
+SEXP_t *SEXP_binary_decode (SEXP_bdec_t *dec);
+
+OSCAP_HIDDEN_END;
+
+#endif /* _SEXP_BINARY_H */
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#pragma once
+#ifndef _SEXP_SLAB_H
+#define _SEXP_SLAB_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "../../../common/util.h"
+#include "public/sexp-slab.h"
+
+OSCAP_HIDDEN_START;
+
+/*
+ * Size-class allocator for S-exp values and list blocks
+ *
+ * Blocks of up to SEXP_SLAB_MAXSIZE bytes are carved from pages and kept
+ * on per-thread free lists, one list per SEXP_SLAB_ALIGN sized class.
+ * A thread exchanges SEXP_SLAB_BATCH blocks at a time with the global
+ * lists when its own list runs empty or grows too long (not inside an
+ * allocation scope, see sexp-slab.h), and hands all of them over when it
+ * exits. Pages are never returned to the system.
+ * Larger blocks, and all blocks if SEXP_SLAB_DISABLE is set in the
+ * environment (e.g. for valgrind), are allocated with sm_memalign.
+ *
+ * The caller has to pass the size of the block to SEXP_slab_free, it's
+ * not stored anywhere.
+ */
+#define SEXP_SLAB_ALIGN   16
+#define SEXP_SLAB_MAXSIZE 512
+#define SEXP_SLAB_BATCH   64
+
+/**
+ * Allocate a block aligned to SEXP_SLAB_ALIGN bytes.
+ * @return NULL if out of memory
+ */
+void *SEXP_slab_alloc (size_t size);
+void  SEXP_slab_free (void *ptr, size_t size);
+
+OSCAP_HIDDEN_END;
+
+#endif /* _SEXP_SLAB_H */
@@ -44,19 +44,68 @@ typedef struct {
         size_t   size;
 } __attribute__ ((packed)) SEXP_valhdr_t;
 
+/*
+ * imm holds the header and the number of an immediate value, which has no
+ * memory of its own; hdr and mem point into it. The descriptor must not be
+ * copied.
+ */
 typedef struct {
         uintptr_t      ptr;
         SEXP_valhdr_t *hdr;
         void          *mem;
         SEXP_valtype_t type;
+        struct {
+                SEXP_valhdr_t hdr;
+                uint8_t       mem[sizeof (uint64_t) + sizeof (SEXP_numtype_t)];
+        } imm;
 } SEXP_val_t;
 
-#define SEXP_VALP_ALIGN (4 > sizeof(void *) ? 4 : sizeof(void *))
-#define SEXP_VALP_MASK  (UINTPTR_MAX << 2)
+#define SEXP_VALP_ALIGN 16 /* values come from SEXP_slab_alloc */
+#define SEXP_VALP_MASK  (UINTPTR_MAX << 4)
 #define SEXP_VALT_MASK  3
+#define SEXP_VALF_BORROWED  4 /* the value's bytes belong to another value */
+#define SEXP_VALF_IMMEDIATE 8 /* the value is stored in the pointer */
 #define SEXP_VALP_HDR(p) ((SEXP_valhdr_t *)(((uintptr_t)(p)) & SEXP_VALP_MASK))
 
+/*
+ * Integers and booleans which fit into the upper bits of the pointer are
+ * stored there, with the number type in the second byte, instead of being
+ * allocated:
+ *
+ *   | n (sign extended) | SEXP_numtype_t | 0000 | 1 | 0 | NUMBER |
+ *   63                16 15             8 7    4  3   2  1      0
+ *
+ * An immediate value isn't reference counted, incref/decref don't change
+ * it and it's never freed. SEXP_val_dsc decodes it into the descriptor,
+ * so it's read like an allocated one.
+ */
+#define SEXP_VALI_SHIFT 16
+#define SEXP_VALI_MAX   (INTPTR_MAX >> SEXP_VALI_SHIFT)
+#define SEXP_VALI_MIN   (INTPTR_MIN >> SEXP_VALI_SHIFT)
+#define SEXP_VALP_IMMEDIATE(p) (((uintptr_t)(p)) & SEXP_VALF_IMMEDIATE)
+
+/*
+ * A borrowed string value stores the location of its bytes instead of the
+ * bytes, hdr->size is the length of the string. SEXP_val_dsc points mem at
+ * the bytes, so the value is read like any other string. The owner (never
+ * a borrowed value itself) is referenced until the borrowed value is freed.
+ */
+struct SEXP_val_borrowed {
+        const void *mem;
+        uintptr_t   owner;
+};
+
 int       SEXP_val_new (SEXP_val_t *dst, size_t vmemsize, SEXP_valtype_t type);
+int       SEXP_val_new_borrowed (SEXP_val_t *dst, uintptr_t owner, const void *mem, size_t size);
+
+/**
+ * Create an integer or boolean value of type t (not SEXP_NUM_DOUBLE). n is
+ * converted to the type, i.e. an unsigned 64-bit number may be passed as
+ * a negative one. Only values which don't fit into the pointer are
+ * allocated.
+ */
+int       SEXP_val_new_number (SEXP_val_t *dst, SEXP_numtype_t t, int64_t n);
+void      SEXP_val_free (SEXP_val_t *dsc);
 void      SEXP_val_dsc (SEXP_val_t *dst, uintptr_t ptr);
 uintptr_t SEXP_val_ptr (SEXP_val_t *dsc);
 
@@ -87,6 +136,8 @@ SEXP_DEFNUM(u64, uint64_t);
 struct SEXP_val_list {
         void    *b_addr;
         uint16_t offset;
+        uint64_t id; /* cached ID accumulator (SEXP_ID_track), 0 if none */
+        uint32_t length; /* number of members */
 } __attribute__ ((packed));
 
 #define SEXP_LCASTP(p) ((struct SEXP_val_list *)(p))
@@ -117,8 +168,10 @@ void      SEXP_rawval_lblk_free (uintptr_t lblkp, void (*func) (SEXP_t *));
 void      SEXP_rawval_lblk_free1 (uintptr_t lblkp, void (*func) (SEXP_t *));
 
 #define SEXP_LBLK_ALIGN (16 > sizeof(void *) ? 16 : sizeof(void *))
+#define SEXP_LBLK_SIZE(sz) (sizeof (struct SEXP_val_lblk) + sizeof (SEXP_t) * ((size_t)1 << (sz)))
 #define SEXP_LBLKP_MASK (UINTPTR_MAX << 4)
 #define SEXP_LBLKS_MASK 0x0f
+#define SEXP_LBLKS_MAX  15 /* blocks of a growing list stop doubling at 2^15 members */
 
 #define SEXP_VALP_LBLK(valp) ((struct SEXP_val_lblk *)((uintptr_t)(valp) & SEXP_LBLKP_MASK))
 
@@ -335,3 +335,21 @@ const uint8_t *spb_direct (spb_t *spb, spb_size_t start, spb_size_t size)
 
         return (NULL);
 }
+
+const uint8_t *spb_direct_run (spb_t *spb, spb_size_t start, size_t *size)
+{
+        uint32_t b_idx;
+        size_t   l_off;
+
+        b_idx = spb_bindex (spb, start);
+
+        if (b_idx < spb->btotal) {
+                l_off = (size_t)(b_idx > 0 ? start - spb->buffer[b_idx - 1].gend - 1 : start);
+                *size = (size_t)(spb->buffer[b_idx].gend - start + 1);
+                return ((const uint8_t *)(spb->buffer[b_idx].base) + l_off);
+        }
+
+        errno = ERANGE;
+
+        return (NULL);
+}
@@ -168,4 +168,14 @@ spb_size_t spb_drop_head (spb_t *spb, spb_size_t size, spb_flags_t flags);
 uint8_t spb_octet (spb_t *spb, spb_size_t idx);
 const uint8_t *spb_direct (spb_t *spb, spb_size_t start, spb_size_t size);
 
+/**
+ * Get the address of the octet at index `start' and the number of
+ * octets from there to the end of the buffer that contains it.
+ * @param spb sparse buffer
+ * @param start index of the octet
+ * @param size where to store the number of octets
+ * @return NULL if `start' is out of range
+ */
+const uint8_t *spb_direct_run (spb_t *spb, spb_size_t start, size_t *size);
+
 #endif /* SPB_H */
@@ -32,6 +32,7 @@
 #include <sys/types.h>
 #include <limits.h>
 #include <sys/uio.h>
+#include <sys/socket.h>
 #include <unistd.h>
 
 #include "common/debug_priv.h"
@@ -276,66 +277,81 @@ size_t strbuf_fwrite (FILE *fp, strbuf_t *buf)
         return (size);
 }
 
-ssize_t strbuf_write (strbuf_t *buf, int fd)
+/*
+ * Write the blocks of the buffer using as few system calls as possible:
+ * up to IOV_MAX blocks are passed to one writev (or sendmsg, for sockets)
+ * and a partial write resumes where it stopped.
+ */
+static ssize_t __strbuf_writev (strbuf_t *buf, int fd, int sock, int flags)
 {
         struct strblk *cur;
+        struct iovec   iov[IOV_MAX];
+        struct msghdr  msg;
+        size_t  off;   /* bytes of `cur' already written */
         ssize_t rsize, wsize;
+        int     ioc;
 
-        struct iovec  *iov;
-        int            ioc; /* helper/index */
-	int            iot; /* total number of buffers */
-	int            iow; /* total number of buffer that will be passed to the next writev */
-
-	rsize = 0;
-	iov   = NULL;
+        rsize = 0;
+        off   = 0;
         cur   = buf->beg;
-	iot   = (buf->size / buf->blkmax) + 1;
-
-	dD("total I/O vectors = %d", iot);
-
-	while (iot > 0) {
-		/*
-		 * Prepare I/O vector
-		 */
-		if (iot > IOV_MAX) {
-			dD("iot (%d) > IOV_MAX (%d)", iot, IOV_MAX);
-			iow  = IOV_MAX;
-			iot -= IOV_MAX;
-		} else {
-			dD("iot (%d) < IOV_MAX (%d)", iot, IOV_MAX);
-			iow  = iot;
-			iot  = 0;
-		}
-
-		iov = realloc (iov, sizeof (struct iovec) * iow);
-		ioc = 0;
-
-		while (cur != NULL && ioc < iow) {
-			iov[ioc].iov_base = cur->data;
-			iov[ioc].iov_len  = cur->size;
-
-			++ioc;
-			cur = cur->next;
-		}
-
-		dD("ioc = %d", ioc);
-
-		/*
-		 * Write
-		 */
-		wsize = writev (fd, iov, ioc);
-
-		if (wsize < 0) {
-			dE("writev(%d, %p, %d) failed: %u, %s.", fd, iov, ioc, errno, strerror (errno));
-                        free(iov);
-			return (-1);
-		}
-
-		rsize += wsize;
-	}
-
-        free (iov);
+
+        while (cur != NULL && cur->size == 0)
+                cur = cur->next;
+
+        while (cur != NULL) {
+                struct strblk *blk = cur;
+                size_t boff = off;
+
+                for (ioc = 0; blk != NULL && ioc < IOV_MAX; blk = blk->next) {
+                        if (blk->size == boff)
+                                continue;
+
+                        iov[ioc].iov_base = blk->data + boff;
+                        iov[ioc].iov_len  = blk->size - boff;
+                        ++ioc;
+                        boff = 0;
+                }
+
+                if (sock) {
+                        memset (&msg, 0, sizeof msg);
+                        msg.msg_iov    = iov;
+                        msg.msg_iovlen = ioc;
+                        wsize = sendmsg (fd, &msg, flags);
+                } else
+                        wsize = writev (fd, iov, ioc);
+
+                if (wsize < 0) {
+                        if (errno == EINTR)
+                                continue;
+
+                        dE("writev(%d, %p, %d) failed: %u, %s.", fd, iov, ioc, errno, strerror (errno));
+                        return (-1);
+                }
+
+                rsize += wsize;
+
+                /* skip what was written */
+                while (cur != NULL && (size_t)wsize >= cur->size - off) {
+                        wsize -= cur->size - off;
+                        off    = 0;
+                        cur    = cur->next;
+                }
+
+                if (cur != NULL)
+                        off += (size_t)wsize;
+        }
+
 	dD("total bytes written: %zu", (size_t)rsize);
 
         return (rsize);
 }
+
+ssize_t strbuf_write (strbuf_t *buf, int fd)
+{
+        return __strbuf_writev (buf, fd, 0, 0);
+}
+
+ssize_t strbuf_send (strbuf_t *buf, int sd, int flags)
+{
+        return __strbuf_writev (buf, sd, 1, flags);
+}
@@ -154,82 +154,24 @@ size_t xbase64_decode (const char *data, size_t size, uint8_t **buffer) {
 
 #if defined(WANT_BASE64)
 static const char b64_enc_alphabet[64] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-static const char b64_dec_alphabet[75] = {
-        /* 0 */ 52,
-        /* 1 */ 53,
-        /* 2 */ 54,
-        /* 3 */ 55,
-        /* 4 */ 56,
-        /* 5 */ 57,
-        /* 6 */ 58,
-        /* 7 */ 59,
-        /* 8 */ 60,
-        /* 9 */ 61,
-        /* : */ 0,
-        /* ; */ 0,
-        /* < */ 0,
-        /* = */ 0,
-        /* > */ 0,
-        /* ? */ 0,
-        /* @ */ 0,
-        /* A */ 0,
-        /* B */ 1,
-        /* C */ 2,
-        /* D */ 3,
-        /* E */ 4,
-        /* F */ 5,
-        /* G */ 6,
-        /* H */ 7,
-        /* I */ 8,
-        /* J */ 9,
-        /* K */ 10,
-        /* L */ 11,
-        /* M */ 12,
-        /* N */ 13,
-        /* O */ 14,
-        /* P */ 15,
-        /* Q */ 16,
-        /* R */ 17,
-        /* S */ 18,
-        /* T */ 19,
-        /* U */ 20,
-        /* V */ 21,
-        /* W */ 22,
-        /* X */ 23,
-        /* Y */ 24,
-        /* Z */ 25,
-        /* [ */ 0,
-        /* \ */ 0,
-        /* ] */ 0,
-        /* ^ */ 0,
-        /* _ */ 0,
-        /* ` */ 0,
-        /* a */ 26,
-        /* b */ 27,
-        /* c */ 28,
-        /* d */ 29,
-        /* e */ 30,
-        /* f */ 31,
-        /* g */ 32,
-        /* h */ 33,
-        /* i */ 34,
-        /* j */ 35,
-        /* k */ 36,
-        /* l */ 37,
-        /* m */ 38,
-        /* n */ 39,
-        /* o */ 40,
-        /* p */ 41,
-        /* q */ 42,
-        /* r */ 43,
-        /* s */ 44,
-        /* t */ 45,
-        /* u */ 46,
-        /* v */ 47,
-        /* w */ 48,
-        /* x */ 49,
-        /* y */ 50,
-        /* z */ 51
+/* the value of every octet in the alphabet, -1 for the other octets */
+static const int8_t b64_dec_table[256] = {
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1, -1, 63,
+        52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1, -1,
+        -1,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+        15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, -1,
+        -1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+        41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
 };
 
 #define B(n) (*(in+(n)))
@@ -258,26 +200,6 @@ static inline void __b64_enc1 (const uint8_t in, char out[4]) {
 }
 #undef  B
 
-#define B(n) ((*(in+(n)) - 48) % 75)
-static inline void __b64_dec4 (const char in[4], uint8_t out[3]) {
-        out[0] =   b64_dec_alphabet[B(0)]         << 2  | ((b64_dec_alphabet[B(1)] & 0x30) >> 4);
-        out[1] = ((b64_dec_alphabet[B(1)] & 0x0f) << 4) | ((b64_dec_alphabet[B(2)] & 0x3c) >> 2);
-        out[2] = ((b64_dec_alphabet[B(2)] & 0x03) << 6) |   b64_dec_alphabet[B(3)];
-        return;
-}
-
-static inline void __b64_dec3 (const char in[3], uint8_t out[2]) {
-        out[0] =   b64_dec_alphabet[B(0)]         << 2  | ((b64_dec_alphabet[B(1)] & 0x30) >> 4);
-        out[1] = ((b64_dec_alphabet[B(1)] & 0x0f) << 4) | ((b64_dec_alphabet[B(2)] & 0x3c) >> 2);
-        return;
-}
-
-static inline void __b64_dec2 (const char in[2], uint8_t out[1]) {
-        out[0] = ((b64_dec_alphabet[B(0)] & 0x03) << 6) |   b64_dec_alphabet[B(1)];
-        return;
-}
-#undef B
-
 size_t base64_encode (const uint8_t *data, size_t size, char **buffer) {
         register uint8_t    d = size % 3;
         register size_t  i, s = size - d;
@@ -303,44 +225,87 @@ size_t base64_encode (const uint8_t *data, size_t size, char **buffer) {
         return (i * 4);
 }
 
-size_t base64_decode (const char *data, size_t size, uint8_t **buffer) {
-        register size_t  i, s = size;
-        register uint8_t d = 0;
+size_t base64_decoded_size (const char *data, size_t size) {
+        size_t s = size;
 
-        d = size % 4;
+        /* the padding is optional */
+        if (s >= 4 && s % 4 == 0 && data[s - 1] == BASE64_PADDING_CHAR)
+                s -= (data[s - 2] == BASE64_PADDING_CHAR) ? 2 : 1;
 
-        if (d == 0) {
-                if (*(data + s - 1) == BASE64_PADDING_CHAR) {
-                        if (*(data + s - 2) == BASE64_PADDING_CHAR) {
-                                d = 2;
-                        } else {
-                                d = 1;
-                        }
+        if (s % 4 == 1)
+                return (0);
 
-                        s -= 4;
-                }
-        } else {
-                if (d == 1) {
-                        *buffer = NULL;
-                        return 0;
-                }
+        return (s / 4 * 3 + (s % 4 != 0 ? s % 4 - 1 : 0));
+}
+
+size_t base64_decode_to (const char *data, size_t size, uint8_t *out) {
+        const uint8_t *in = (const uint8_t *)data;
+        size_t  i, o, n;
+        int32_t v;
+
+        if ((n = base64_decoded_size (data, size)) == 0)
+                return (0);
+
+        /*
+         * A quad of valid octets is a non-negative 24-bit value, one
+         * octet out of the alphabet makes the value negative.
+         */
+        for (i = 0, o = 0; o + 3 <= n; i += 4, o += 3) {
+                v = (int32_t)b64_dec_table[in[i]]     * (1 << 18) |
+                    (int32_t)b64_dec_table[in[i + 1]] * (1 << 12) |
+                    (int32_t)b64_dec_table[in[i + 2]] * (1 << 6)  |
+                    (int32_t)b64_dec_table[in[i + 3]];
+
+                if (v < 0)
+                        return (0);
+
+                out[o]     = (uint8_t)(v >> 16);
+                out[o + 1] = (uint8_t)(v >> 8);
+                out[o + 2] = (uint8_t)v;
         }
 
-        *buffer = sm_alloc (sizeof (uint8_t) * ((s/4 * 3) + d));
+        switch (n - o) {
+        case 2:
+                v = (int32_t)b64_dec_table[in[i]]     * (1 << 18) |
+                    (int32_t)b64_dec_table[in[i + 1]] * (1 << 12) |
+                    (int32_t)b64_dec_table[in[i + 2]] * (1 << 6);
 
-        for (i = 0; i < s/4; ++i) {
-                __b64_dec4 (data + (i * 4), (*buffer) + (i * 3));
+                if (v < 0)
+                        return (0);
+
+                out[o]     = (uint8_t)(v >> 16);
+                out[o + 1] = (uint8_t)(v >> 8);
+                break;
+        case 1:
+                v = (int32_t)b64_dec_table[in[i]]     * (1 << 18) |
+                    (int32_t)b64_dec_table[in[i + 1]] * (1 << 12);
+
+                if (v < 0)
+                        return (0);
+
+                out[o] = (uint8_t)(v >> 16);
+                break;
         }
 
-        switch (d) {
-        case 2:
-                __b64_dec2 (data + (i * 4), (*buffer) + (i * 3));
-                return (i * 3) + 1;
-         case 1:
-                __b64_dec3 (data + (i * 4), (*buffer) + (i * 3));
-                return (i * 3) + 2;
-         default:
-                return (i * 3);
+        return (n);
+}
+
+size_t base64_decode (const char *data, size_t size, uint8_t **buffer) {
+        size_t n;
+
+        if ((n = base64_decoded_size (data, size)) == 0) {
+                *buffer = NULL;
+                return (0);
+        }
+
+        *buffer = sm_alloc (sizeof (uint8_t) * n);
+
+        if (base64_decode_to (data, size, *buffer) != n) {
+                sm_free (*buffer);
+                *buffer = NULL;
+                return (0);
         }
+
+        return (n);
 }
 #endif /* WANT_BASE64 */
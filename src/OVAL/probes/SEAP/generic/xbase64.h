@@ -47,6 +47,17 @@ size_t xbase64_decode (const char *, size_t, uint8_t **);
 size_t base64_encode (const uint8_t *, size_t, char **);
 size_t base64_decode (const char *, size_t, uint8_t **);
 
+/*
+ * The number of octets the text decodes to, 0 if its length isn't valid.
+ */
+size_t base64_decoded_size (const char *, size_t);
+
+/*
+ * Decode into a buffer of base64_decoded_size() octets. Returns the number
+ * of octets, 0 if the text isn't valid.
+ */
+size_t base64_decode_to (const char *, size_t, uint8_t *);
+
 # endif /* BASE64_H */
 #endif /* WANT_BASE64 */
 
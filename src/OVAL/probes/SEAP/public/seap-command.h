@@ -49,6 +49,12 @@ typedef uint8_t  SEAP_cmdtype_t;
 int SEAP_cmd_register   (SEAP_CTX_t *ctx, SEAP_cmdcode_t code, uint32_t flags, SEAP_cmdfn_t func, ...);
 int SEAP_cmd_unregister (SEAP_CTX_t *ctx, SEAP_cmdcode_t code);
 
+/*
+ * Execute the received commands by `workers' threads, 0 executes
+ * them in the receiving thread.
+ */
+int SEAP_cmdpool_set (SEAP_CTX_t *ctx, unsigned int workers);
+
 #define SEAP_EXEC_LOCAL  0x01
 #define SEAP_EXEC_LONLY  0x02
 #define SEAP_EXEC_GFIRST 0x04
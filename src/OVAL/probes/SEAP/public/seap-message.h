@@ -41,6 +41,23 @@ typedef uint32_t SEAP_msgid_t;
 typedef struct SEAP_msg  SEAP_msg_t;
 typedef struct SEAP_attr SEAP_attr_t;
 
+/*
+ * Streaming of large replies
+ *
+ * The members of the list found in the data of a reply by following a
+ * path (1-based positions, at most SEAP_MSGSTREAM_MAXDEPTH levels deep)
+ * are passed to the callback as soon as each of them is received, while
+ * the rest of the reply is still arriving. If the callback returns 1
+ * the member is left out of the reply returned by SEAP_recvmsg. The
+ * member is freed after the callback returns, SEXP_ref it to keep it.
+ * The callback is called with the read lock of the descriptor held, so
+ * it must not receive from the same descriptor. Only replies in the
+ * binary format are streamed.
+ */
+#define SEAP_MSGSTREAM_MAXDEPTH 4
+
+typedef int (*SEAP_msgstream_fn) (SEAP_msgid_t reply_id, SEXP_t *memb, void *arg);
+
 SEAP_msg_t *SEAP_msg_new (void);
 SEAP_msg_t *SEAP_msg_clone (SEAP_msg_t *msg);
 void        SEAP_msg_free (SEAP_msg_t *msg);
@@ -62,6 +62,7 @@ int     SEAP_close (SEAP_CTX_t *ctx, int sd);
 
 int SEAP_openfd (SEAP_CTX_t *ctx, int fd, uint32_t flags);
 int SEAP_openfd2 (SEAP_CTX_t *ctx, int ifd, int ofd, uint32_t flags);
+int SEAP_openshm (SEAP_CTX_t *ctx, int fd, uint32_t flags);
 
 SEAP_msg_t *SEAP_msg_new (void);
 void        SEAP_msg_free (SEAP_msg_t *msg);
@@ -85,6 +86,14 @@ int SEAP_recverr_byid (SEAP_CTX_t *ctx, int sd, SEAP_err_t **err, SEAP_msgid_t i
 
 int SEAP_replyerr (SEAP_CTX_t *ctx, int sd, SEAP_msg_t *rep_msg, uint32_t e);
 
+/*
+ * Pass the members of the list at `path' in the data of binary replies
+ * to `fn' as they arrive, see SEAP_msgstream_fn. A NULL `fn' turns
+ * streaming off.
+ */
+int SEAP_msgstream_set (SEAP_CTX_t *ctx, int sd, const uint32_t *path, size_t depth,
+                        SEAP_msgstream_fn fn, void *arg);
+
 #ifdef __cplusplus
 }
 #endif
@@ -33,4 +33,14 @@ typedef uint64_t SEXP_ID_t;
 SEXP_ID_t SEXP_ID_v(const SEXP_t *s);
 SEXP_ID_t SEXP_ID_v2(const SEXP_t *s);
 
+/**
+ * Track the ID of a list incrementally. The ID accumulator is computed
+ * now, stored in the list value and updated by every SEXP_list_add, so
+ * that SEXP_ID_v doesn't have to traverse the whole list again. Any other
+ * in-place modification of the list (including taking a reference to a
+ * member using the SEXP_listref_* functions) drops the cached value.
+ * @return 0 on success, -1 if `list' isn't a list
+ */
+int SEXP_ID_track(SEXP_t *list);
+
 #endif /* SEXP_ID_H */
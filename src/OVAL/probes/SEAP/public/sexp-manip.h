@@ -234,6 +234,19 @@ SEXP_t *SEXP_string_new  (const void *string, size_t strlen) __attribute__ ((non
  */
 SEXP_t *SEXP_string_newf (const char *format, ...) __attribute__ ((format (printf, 1, 2), nonnull (1)));
 
+/**
+ * Create a new sexp object from a substring of a string sexp object.
+ * The new object shares the bytes with the parent object instead of
+ * copying them (unless the substring is shorter than a pointer pair),
+ * the parent's value stays allocated while the new object exists.
+ * @param parent the string sexp object
+ * @param beg the offset of the first character of the substring
+ * @param len the length of the substring in bytes
+ * @return the new object, or NULL if parent isn't a string (EINVAL) or
+ *         the substring isn't inside it (ERANGE)
+ */
+SEXP_t *SEXP_string_new_sub (const SEXP_t *parent, size_t beg, size_t len);
+
 /**
  * Free the specified sexp object.
  * @param s_exp the object to be freed
@@ -297,7 +310,7 @@ char  *SEXP_string_cstrp (const SEXP_t *s_exp);
  * Get a C substring from a sexp object.
  * @param s_sexp the queried sexp object
  * @param beg the position of the fisrt character of the substring
- * @param len the length of the substring
+ * @param len the length of the substring, 0 means up to the end of the string
  */
 char *SEXP_string_subcstr (const SEXP_t *s_exp, size_t beg, size_t len);
 
@@ -532,6 +545,12 @@ bool SEXP_eq (const SEXP_t *a, const SEXP_t *b);
  */
 int SEXP_refcmp(const SEXP_t *a, const SEXP_t *b);
 
+/**
+ * Hash the reference pointer. References which are equal
+ * according to SEXP_refcmp have the same hash.
+ */
+size_t SEXP_refhash(const SEXP_t *s_exp);
+
 bool SEXP_deepcmp(const SEXP_t *a, const SEXP_t *b);
 
 #ifdef __COVERITY__
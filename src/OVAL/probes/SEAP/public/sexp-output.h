@@ -39,6 +39,12 @@ size_t SEXP_fprintfa (FILE *fp, const SEXP_t *s_exp);
 
 int SEXP_sbprintf_t (SEXP_t *s_exp, strbuf_t *sb);
 
+/**
+ * Append `s_exp' encoded as one binary frame to `sb'.
+ * @return 0 on success, -1 on failure
+ */
+int SEXP_sbprintf_b (SEXP_t *s_exp, strbuf_t *sb);
+
 #ifdef __cplusplus
 }
 #endif
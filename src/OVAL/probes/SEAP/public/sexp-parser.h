@@ -29,6 +29,7 @@ extern "C" {
 #endif
 
 #include <stddef.h>
+#include <sys/types.h>
 #include <sexp-types.h>
 
 typedef struct SEXP_psetup SEXP_psetup_t;
@@ -55,6 +56,22 @@ SEXP_t *SEXP_parse (const SEXP_psetup_t *psetup, char *buffer, size_t buflen, SE
 
 bool SEXP_pstate_errorp(SEXP_pstate_t *pstate);
 
+/**
+ * Get the length of the binary frame starting at `buf'.
+ * @return the frame length including the header, 0 if more data
+ *         is needed to tell or -1 if `buf' doesn't start a binary frame
+ */
+ssize_t SEXP_binary_framelen (const void *buf, size_t len);
+
+/**
+ * Decode one complete binary frame.
+ * @param buf the frame, including the header
+ * @param len length of the frame as returned by SEXP_binary_framelen()
+ * @return the decoded S-exp or NULL if the frame is malformed (errno is
+ *         set to EILSEQ)
+ */
+SEXP_t *SEXP_parse_binary (const void *buf, size_t len);
+
 #ifdef __cplusplus
 }
 #endif
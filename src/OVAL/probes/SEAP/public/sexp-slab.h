@@ -0,0 +1,65 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#pragma once
+#ifndef SEXP_SLAB_H
+#define SEXP_SLAB_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Allocation scopes
+ *
+ * S-exp values and list blocks are allocated from per-thread free lists.
+ * Normally a thread gives a batch of blocks back to the shared lists as
+ * soon as its own list grows long. Inside a scope it keeps every block it
+ * frees, so the temporary values of one request are recycled without
+ * touching the shared lists. When the outermost scope ends, the blocks
+ * above the normal per-thread limit are returned in one pass.
+ *
+ * Values allocated inside a scope are ordinary values: they may outlive
+ * the scope and may be freed by another thread.
+ */
+void SEXP_slab_scope_begin (void);
+void SEXP_slab_scope_end (void);
+
+struct SEXP_slab_stats {
+        uint64_t allocs;   /**< blocks allocated from the free lists */
+        uint64_t frees;    /**< blocks returned to the free lists */
+        uint64_t fallback; /**< blocks allocated with sm_memalign */
+        uint64_t refills;  /**< batches moved from the global lists to a thread */
+        uint64_t flushes;  /**< batches moved from a thread to the global lists */
+        uint64_t pages;    /**< pages allocated */
+};
+
+/**
+ * Get the allocation counters. The counts of a running thread are added
+ * when it exchanges a batch with the global lists, so they lag behind.
+ */
+void SEXP_slab_stats (struct SEXP_slab_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SEXP_SLAB_H */
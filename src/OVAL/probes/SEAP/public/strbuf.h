@@ -67,6 +67,7 @@ char *strbuf_copy (strbuf_t *buf, void *dst, size_t len);
 
 size_t strbuf_fwrite (FILE *fp, strbuf_t *buf);
 ssize_t strbuf_write  (strbuf_t *buf, int fd);
+ssize_t strbuf_send   (strbuf_t *buf, int sd, int flags); /* sendmsg(2) flags */
 
 #ifdef __cplusplus
 }
@@ -36,10 +36,15 @@
 #include <sys/socket.h>
 #include <sys/select.h>
 #include <sys/types.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <poll.h>
+#include <pthread.h>
 #include <signal.h>
 #include <fcntl.h>
 #include <common/assume.h>
 #include <common/_error.h>
+#include <common/debug_priv.h>
 #include <errno.h>
 
 #include "generic/common.h"
@@ -55,6 +60,7 @@
 extern char **environ;
 
 #define MAX_WHITESPACE_CNT 64
+#define SCH_PIPE_SOCKBUF   (1024 * 1024)
 
 #ifndef PATH_MAX
 # define PATH_MAX 1024
@@ -65,7 +71,7 @@ extern char **environ;
 # endif
 #endif /* PATH_MAX */
 
-static char *get_exec_path (const char *uri, uint32_t flags)
+char *sch_pipe_execpath (const char *uri, uint32_t flags)
 {
         char  *path;
         size_t ulen;
@@ -160,7 +166,7 @@ fail:
         return (NULL);
 }
 
-static int check_child (pid_t pid, int waitf)
+int sch_pipe_check_child (pid_t pid, int waitf)
 {
         int status = -1;
 
@@ -184,9 +190,303 @@ static int check_child (pid_t pid, int waitf)
         return (1);
 }
 
+/* see linux/ioprio.h */
+#define SCH_PIPE_IOPRIO_WHO_PROCESS 1
+#define SCH_PIPE_IOPRIO_CLASS_SHIFT 13
+#define SCH_PIPE_IOPRIO_CLASS_BE    2
+#define SCH_PIPE_IOPRIO_CLASS_IDLE  3
+
+void sch_pipe_prio_get (sch_pipe_prio_t *prio)
+{
+        const char *str;
+        char *end;
+        long  val;
+
+        prio->nice   = 0;
+        prio->ioprio = -1;
+
+        if ((str = getenv (SCH_PIPE_NICE_ENV)) != NULL && *str != '\0') {
+                val = strtol (str, &end, 10);
+
+                if (*end == '\0' && val >= -20 && val <= 19)
+                        prio->nice = (int)val;
+                else
+                        dW("Invalid value of " SCH_PIPE_NICE_ENV ": '%s'.", str);
+        }
+
+        if ((str = getenv (SCH_PIPE_IONICE_ENV)) != NULL && *str != '\0') {
+                if (strcmp (str, "idle") == 0) {
+                        prio->ioprio = SCH_PIPE_IOPRIO_CLASS_IDLE << SCH_PIPE_IOPRIO_CLASS_SHIFT;
+                } else {
+                        val = strtol (str, &end, 10);
+
+                        if (*end == '\0' && val >= 0 && val <= 7)
+                                prio->ioprio = SCH_PIPE_IOPRIO_CLASS_BE << SCH_PIPE_IOPRIO_CLASS_SHIFT | (int)val;
+                        else
+                                dW("Invalid value of " SCH_PIPE_IONICE_ENV ": '%s'.", str);
+                }
+        }
+}
+
+void sch_pipe_prio_set (const sch_pipe_prio_t *prio)
+{
+        /* a probe at the default priority is better than no probe */
+        if (prio->nice != 0)
+                (void) setpriority (PRIO_PROCESS, 0, prio->nice);
+#if defined(SYS_ioprio_set)
+        if (prio->ioprio >= 0)
+                (void) syscall (SYS_ioprio_set, SCH_PIPE_IOPRIO_WHO_PROCESS, 0, prio->ioprio);
+#endif
+}
+
+/*
+ * The zygote of a probe executable is the executable started with
+ * SCH_PIPE_ZYGOTE_ARG: loaded and linked, it forks a probe for every
+ * socket sent over its control socket and replies with the PID of the
+ * probe. The zygote inherits the environment of the time it's started
+ * at, which is what the probes read their settings from; it's replaced
+ * when the environment changes.
+ */
+typedef struct sch_pipe_zygote {
+        char    *execpath;
+        uint64_t envhash;
+        int      ctl;
+        pid_t    pid;
+        struct sch_pipe_zygote *next;
+} sch_pipe_zygote_t;
+
+static sch_pipe_zygote_t *sch_pipe_zygotes = NULL;
+#if defined(SEAP_THREAD_SAFE)
+static pthread_mutex_t sch_pipe_zygote_mtx = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+bool sch_pipe_zygote_enabled (void)
+{
+        const char *str = getenv (SCH_PIPE_ZYGOTE_ENV);
+
+        return (str != NULL && strcmp (str, "1") == 0);
+}
+
+static uint64_t sch_pipe_envhash (void)
+{
+        uint64_t h = UINT64_C(14695981039346656037);
+        const char *c;
+        char **e;
+
+        for (e = environ; e != NULL && *e != NULL; ++e) {
+                for (c = *e; ; ++c) {
+                        h ^= (uint8_t)*c;
+                        h *= UINT64_C(1099511628211);
+
+                        if (*c == '\0')
+                                break;
+                }
+        }
+
+        return (h);
+}
+
+static void sch_pipe_zygote_free (sch_pipe_zygote_t *z)
+{
+        /* the probes it forked are not affected */
+        close (z->ctl);
+        kill (z->pid, SIGTERM);
+        (void) waitpid (z->pid, NULL, 0);
+
+        sm_free (z->execpath);
+        sm_free (z);
+}
+
+static sch_pipe_zygote_t *sch_pipe_zygote_start (const char *execpath, uint64_t envhash)
+{
+        sch_pipe_zygote_t *z;
+        sch_pipe_prio_t prio;
+        pid_t pid;
+        int   ctl[2];
+
+        if (socketpair (AF_UNIX, SOCK_SEQPACKET, 0, ctl) < 0)
+                return (NULL);
+
+        /* neither the probes nor anything else started later inherit it */
+        fcntl (ctl[0], F_SETFD, FD_CLOEXEC);
+        fcntl (ctl[1], F_SETFD, FD_CLOEXEC);
+
+        /* the forked probes inherit the priority */
+        sch_pipe_prio_get (&prio);
+
+        switch (pid = fork ()) {
+        case -1:
+                protect_errno {
+                        close (ctl[0]);
+                        close (ctl[1]);
+                }
+                return (NULL);
+        case  0:
+                if (dup2 (ctl[1], STDIN_FILENO) != STDIN_FILENO)
+                        _exit (errno);
+                sch_pipe_prio_set (&prio);
+                execl (execpath, execpath, SCH_PIPE_ZYGOTE_ARG, NULL);
+                _exit (errno);
+        }
+
+        close (ctl[1]);
+
+        z = sm_talloc (sch_pipe_zygote_t);
+        z->execpath = sm_alloc (strlen (execpath) + 1);
+        strcpy (z->execpath, execpath);
+        z->envhash  = envhash;
+        z->ctl      = ctl[0];
+        z->pid      = pid;
+        z->next     = NULL;
+
+        dI("Started the zygote of %s, PID=%ld.", execpath, (long)pid);
+
+        return (z);
+}
+
+static pid_t sch_pipe_zygote_fork (sch_pipe_zygote_t *z, const int *fds, int nfds)
+{
+        struct msghdr   msg;
+        struct iovec    iov;
+        struct cmsghdr *cmsg;
+        union {
+                struct cmsghdr h;
+                char buf[CMSG_SPACE(sizeof(int) * SCH_PIPE_ZYGOTE_MAXFDS)];
+        } cbuf;
+        char    c = 'F';
+        int32_t reply;
+        ssize_t ret;
+
+        if (nfds < 1 || nfds > SCH_PIPE_ZYGOTE_MAXFDS) {
+                errno = EINVAL;
+                return (-1);
+        }
+
+        memset (&msg, 0, sizeof msg);
+        memset (&cbuf, 0, sizeof cbuf);
+        iov.iov_base = &c;
+        iov.iov_len  = 1;
+        msg.msg_iov  = &iov;
+        msg.msg_iovlen     = 1;
+        msg.msg_control    = cbuf.buf;
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * nfds);
+
+        cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type  = SCM_RIGHTS;
+        cmsg->cmsg_len   = CMSG_LEN(sizeof(int) * nfds);
+        memcpy (CMSG_DATA(cmsg), fds, sizeof(int) * nfds);
+
+        do {
+                ret = sendmsg (z->ctl, &msg, MSG_NOSIGNAL);
+        } while (ret < 0 && errno == EINTR);
+
+        if (ret != 1)
+                return (-1);
+
+        do {
+                ret = recv (z->ctl, &reply, sizeof reply, 0);
+        } while (ret < 0 && errno == EINTR);
+
+        if (ret != sizeof reply) {
+                errno = ECONNRESET;
+                return (-1);
+        }
+        if (reply <= 0) {
+                errno = -reply;
+                return (-1);
+        }
+
+        return ((pid_t)reply);
+}
+
+pid_t sch_pipe_zygote_spawn (const char *execpath, const int *fds, int nfds)
+{
+        sch_pipe_zygote_t *z, **zp;
+        uint64_t envhash;
+        pid_t pid = -1;
+
+        envhash = sch_pipe_envhash ();
+#if defined(SEAP_THREAD_SAFE)
+        if (pthread_mutex_lock (&sch_pipe_zygote_mtx) != 0)
+                return (-1);
+#endif
+        for (zp = &sch_pipe_zygotes; (z = *zp) != NULL; zp = &z->next) {
+                if (strcmp (z->execpath, execpath) == 0)
+                        break;
+        }
+
+        if (z != NULL && z->envhash != envhash) {
+                *zp = z->next;
+                sch_pipe_zygote_free (z);
+                z = NULL;
+        }
+
+        if (z == NULL) {
+                if ((z = sch_pipe_zygote_start (execpath, envhash)) == NULL)
+                        goto unlock;
+
+                z->next = sch_pipe_zygotes;
+                sch_pipe_zygotes = z;
+                zp = &sch_pipe_zygotes;
+        }
+
+        if ((pid = sch_pipe_zygote_fork (z, fds, nfds)) < 0) {
+                dW("The zygote of %s failed: %s.", execpath, strerror (errno));
+                *zp = z->next;
+                sch_pipe_zygote_free (z);
+        }
+unlock:
+#if defined(SEAP_THREAD_SAFE)
+        pthread_mutex_unlock (&sch_pipe_zygote_mtx);
+#endif
+        return (pid);
+}
+
+/*
+ * The probes forked by a zygote are not our children; a dead one is seen
+ * on its socket.
+ */
+static int sch_pipe_check_probe (const sch_pipedata_t *data, int waitf)
+{
+        if (data->zygote)
+                return (0);
+
+        return sch_pipe_check_child (data->pid, waitf);
+}
+
+int sch_pipe_wait_eof (int fd, int timeout)
+{
+        struct pollfd pfd;
+        char buf[4096];
+        ssize_t ret;
+
+        pfd.fd     = fd;
+        pfd.events = POLLIN;
+
+        for (;;) {
+                switch (poll (&pfd, 1, timeout)) {
+                case -1:
+                        if (errno == EINTR)
+                                continue;
+                        return (-1);
+                case  0:
+                        return (-1);
+                }
+
+                ret = read (fd, buf, sizeof buf);
+
+                if (ret == 0)
+                        return (0);
+                if (ret < 0 && errno != EINTR && errno != EAGAIN)
+                        return (0);
+        }
+}
+
 int sch_pipe_connect (SEAP_desc_t *desc, const char *uri, uint32_t flags)
 {
         sch_pipedata_t *data;
+        sch_pipe_prio_t prio;
         pid_t pid;
         int   pfd[2] = { -1, -1 };
 
@@ -195,7 +495,8 @@ int sch_pipe_connect (SEAP_desc_t *desc, const char *uri, uint32_t flags)
         assume_r (desc->scheme_data == NULL, -1, errno = EALREADY;);
 
         data = (sch_pipedata_t *) sm_talloc (sch_pipedata_t);
-        data->execpath = get_exec_path (uri, flags);
+        data->zygote   = false;
+        data->execpath = sch_pipe_execpath (uri, flags);
 
         if (data->execpath == NULL) {
                 errno = EINVAL;
@@ -212,6 +513,34 @@ int sch_pipe_connect (SEAP_desc_t *desc, const char *uri, uint32_t flags)
         if (socketpair (AF_UNIX, SOCK_STREAM, 0, pfd) < 0)
                 goto fail1;
 
+        /*
+         * Large replies are written and read in big chunks; let them
+         * fit into the socket buffers. The kernel may cap the size.
+         */
+        {
+                int bufsz = SCH_PIPE_SOCKBUF;
+
+                setsockopt (pfd[0], SOL_SOCKET, SO_RCVBUF, &bufsz, sizeof bufsz);
+                setsockopt (pfd[0], SOL_SOCKET, SO_SNDBUF, &bufsz, sizeof bufsz);
+                setsockopt (pfd[1], SOL_SOCKET, SO_RCVBUF, &bufsz, sizeof bufsz);
+                setsockopt (pfd[1], SOL_SOCKET, SO_SNDBUF, &bufsz, sizeof bufsz);
+        }
+
+        if (sch_pipe_zygote_enabled () &&
+            (pid = sch_pipe_zygote_spawn (data->execpath, &pfd[1], 1)) > 0)
+        {
+                close (pfd[1]);
+
+                data->pfd    = pfd[0];
+                data->pid    = pid;
+                data->zygote = true;
+                desc->scheme_data = (void *)data;
+
+                return (0);
+        }
+
+        sch_pipe_prio_get (&prio);
+
         switch (pid = fork ()) {
         case -1: /* error */
                 goto fail1;
@@ -225,6 +554,7 @@ int sch_pipe_connect (SEAP_desc_t *desc, const char *uri, uint32_t flags)
                         _exit (errno);
                 if (dup2 (pfd[1], STDOUT_FILENO) != STDOUT_FILENO)
                         _exit (errno);
+                sch_pipe_prio_set (&prio);
                 execl (data->execpath, data->execpath, NULL);
                 _exit (errno);
         default: /* parent */
@@ -233,7 +563,7 @@ int sch_pipe_connect (SEAP_desc_t *desc, const char *uri, uint32_t flags)
                 data->pfd = pfd[0];
                 data->pid = pid;
 
-                if (check_child (data->pid, 0) != 0)
+                if (sch_pipe_check_child (data->pid, 0) != 0)
                         goto fail2;
         }
 
@@ -265,6 +595,10 @@ int sch_pipe_openfd2 (SEAP_desc_t *desc, int ifd, int ofd, uint32_t flags)
         return (-1);
 }
 
+/*
+ * The state of the probe is checked only when the connection fails, not
+ * before every read and write; the socket reports a dead probe anyway.
+ */
 ssize_t sch_pipe_recv (SEAP_desc_t *desc, void *buf, size_t len, uint32_t flags)
 {
         sch_pipedata_t *data;
@@ -277,19 +611,20 @@ ssize_t sch_pipe_recv (SEAP_desc_t *desc, void *buf, size_t len, uint32_t flags)
 
         assume_r (data != NULL, -1, errno = EBADF;);
 
-        if (check_child (data->pid, 0) == 0) {
-                if ((ret = read (data->pfd, buf, len)) == 0)
-			if (check_child(data->pid, 0))
-				return (-1);
+        do {
+                ret = read (data->pfd, buf, len);
+        } while (ret < 0 && errno == EINTR);
 
-		return (ret);
-        } else
+        if (ret <= 0 && sch_pipe_check_probe (data, 0) != 0)
                 return (-1);
+
+        return (ret);
 }
 
 ssize_t sch_pipe_send (SEAP_desc_t *desc, void *buf, size_t len, uint32_t flags)
 {
         sch_pipedata_t *data;
+        ssize_t         ret;
 
         assume_d (desc != NULL, -1, errno = EFAULT;);
         assume_d (buf  != NULL, -1, errno = EFAULT;);
@@ -298,15 +633,23 @@ ssize_t sch_pipe_send (SEAP_desc_t *desc, void *buf, size_t len, uint32_t flags)
 
         assume_r (data != NULL, -1, errno = EBADF;);
 
-        if (check_child (data->pid, 0) == 0)
-                return write (data->pfd, buf, len);
-        else
-                return (-1);
+        /* no SIGPIPE if the probe is gone */
+        ret = send (data->pfd, buf, len, MSG_NOSIGNAL);
+
+        if (ret < 0) {
+                protect_errno {
+                        sch_pipe_check_probe (data, 0);
+                }
+        }
+
+        return (ret);
 }
 
 ssize_t sch_pipe_sendsexp (SEAP_desc_t *desc, SEXP_t *sexp, uint32_t flags)
 {
         sch_pipedata_t *data;
+        ssize_t   ret;
+        strbuf_t *sb;
 
         assume_d (desc != NULL, -1, errno = EFAULT;);
         assume_d (sexp != NULL, -1, errno = EFAULT;);
@@ -315,24 +658,20 @@ ssize_t sch_pipe_sendsexp (SEAP_desc_t *desc, SEXP_t *sexp, uint32_t flags)
 
         assume_r (data != NULL, -1, errno = EBADF;);
 
-        if (check_child (data->pid, 0) != 0)
-                return (-1);
-        else {
-                ssize_t ret;
-		strbuf_t *sb;
-
-                ret = 0;
-                sb  = strbuf_new (SEAP_STRBUF_MAX);
+        ret = 0;
+        sb  = strbuf_new (SEAP_STRBUF_MAX);
 
-                if (SEXP_sbprintf_t (sexp, sb) != 0)
-                        ret = -1;
-                else
-                        ret = strbuf_write (sb, data->pfd);
+        if (SEAP_DESC_SBPRINT(desc, sexp, sb) != 0)
+                ret = -1;
+        else if ((ret = strbuf_send (sb, data->pfd, MSG_NOSIGNAL)) < 0) {
+                protect_errno {
+                        sch_pipe_check_probe (data, 0);
+                }
+        }
 
-                strbuf_free (sb);
+        strbuf_free (sb);
 
-                return (ret);
-        }
+        return (ret);
 }
 
 int sch_pipe_close (SEAP_desc_t *desc, uint32_t flags)
@@ -346,10 +685,23 @@ int sch_pipe_close (SEAP_desc_t *desc, uint32_t flags)
 
         assume_r (data != NULL, -1, errno = EBADF;);
 
+        if (data->zygote) {
+                /* a closed socket means the PID may be reused already */
+                if (sch_pipe_wait_eof (data->pfd, 0) == 0)
+                        goto clean;
+
+                kill (data->pid, SIGTERM);
+
+                if (sch_pipe_wait_eof (data->pfd, 3000) != 0)
+                        kill (data->pid, SIGKILL);
+
+                goto clean;
+        }
+
         kill (data->pid, SIGTERM);
 
         for (try = 0; try < 3; ++try) {
-                switch (check_child (data->pid, 1)) {
+                switch (sch_pipe_check_child (data->pid, 1)) {
                 case  0:
                         kill (data->pid, SIGTERM);
                         break;
@@ -365,7 +717,7 @@ int sch_pipe_close (SEAP_desc_t *desc, uint32_t flags)
          */
         kill (data->pid, SIGKILL);
 
-        switch (check_child (data->pid, 0)) {
+        switch (sch_pipe_check_child (data->pid, 0)) {
         case  1:
                 break;
         default:
@@ -392,7 +744,7 @@ int sch_pipe_select (SEAP_desc_t *desc, int ev, uint16_t timeout, uint32_t flags
 
         assume_r (data != NULL, -1, errno = EBADF;);
 
-        if (check_child (data->pid, 0) == 0) {
+        if (sch_pipe_check_probe (data, 0) == 0) {
                 fd_set *wptr, *rptr;
                 fd_set  fset;
                 struct timeval *tv_ptr, tv;
@@ -26,16 +26,56 @@
 
 #include <sys/types.h>
 #include <unistd.h>
+#include <stdbool.h>
 #include "../../../common/util.h"
 
 OSCAP_HIDDEN_START;
 
+/*
+ * The scheduling priority of the started probes: OSCAP_PROBE_NICE is the
+ * nice value, OSCAP_PROBE_IONICE either "idle" or the best-effort I/O
+ * priority level 0-7.
+ */
+#define SCH_PIPE_NICE_ENV   "OSCAP_PROBE_NICE"
+#define SCH_PIPE_IONICE_ENV "OSCAP_PROBE_IONICE"
+/*
+ * Set to 1 to fork the probes from a zygote, one per probe executable,
+ * instead of starting them anew for every connection.
+ */
+#define SCH_PIPE_ZYGOTE_ENV "OSCAP_PROBE_ZYGOTE"
+/* see probe/zygote.h */
+#define SCH_PIPE_ZYGOTE_ARG    "--zygote"
+#define SCH_PIPE_ZYGOTE_MAXFDS 6
+
+typedef struct {
+        int nice;   /* 0 if not changed */
+        int ioprio; /* the ioprio_set() value, -1 if not changed */
+} sch_pipe_prio_t;
+
 typedef struct {
         int   pfd;
         pid_t pid;
         char *execpath;
+        bool  zygote; /* forked by a zygote, not our child */
 } sch_pipedata_t;
 
+/* also used by the shm scheme, which starts probes the same way */
+char *sch_pipe_execpath (const char *uri, uint32_t flags);
+int   sch_pipe_check_child (pid_t pid, int waitf);
+/* read the priority before fork(), set it in the child before exec() */
+void  sch_pipe_prio_get (sch_pipe_prio_t *prio);
+void  sch_pipe_prio_set (const sch_pipe_prio_t *prio);
+/*
+ * Fork a probe of `execpath' from its zygote, start the zygote first if
+ * needed. The probe is connected to fds[0]; the shm scheme passes the
+ * descriptors of its region and eventfds too. Returns the PID of the
+ * probe, -1 if the probe has to be started the usual way.
+ */
+bool  sch_pipe_zygote_enabled (void);
+pid_t sch_pipe_zygote_spawn (const char *execpath, const int *fds, int nfds);
+/* wait up to `timeout' ms until the probe closes its socket */
+int   sch_pipe_wait_eof (int fd, int timeout);
+
 int sch_pipe_connect (SEAP_desc_t *desc, const char *uri, uint32_t flags);
 int sch_pipe_openfd (SEAP_desc_t *desc, int fd, uint32_t flags);
 int sch_pipe_openfd2 (SEAP_desc_t *desc, int ifd, int ofd, uint32_t flags);
@@ -0,0 +1,696 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <common/assume.h>
+#include "generic/common.h"
+#include "public/sm_alloc.h"
+#include "public/strbuf.h"
+#include "_sexp-types.h"
+#include "_seap-types.h"
+#include "_sexp-output.h"
+#include "_seap-scheme.h"
+#include "sch_pipe.h"
+#include "sch_shm.h"
+#include "seap-descriptor.h"
+
+#if defined(SEAP_SCHEME_SHM)
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+
+extern char **environ;
+
+#define DATA(ptr) ((sch_shmdata_t *)(ptr))
+
+static sch_shmdata_t *sch_shm_data_new (void)
+{
+        sch_shmdata_t *data;
+        int i;
+
+        data = sm_talloc (sch_shmdata_t);
+        data->region   = NULL;
+        data->memfd    = -1;
+        data->sfd      = -1;
+        data->pid      = -1;
+        data->zygote   = false;
+        data->execpath = NULL;
+
+        for (i = 0; i < SCH_SHM_EVCOUNT; ++i)
+                data->ev[i] = -1;
+
+        return (data);
+}
+
+static void sch_shm_data_free (sch_shmdata_t *data)
+{
+        int i;
+
+        if (data->region != NULL)
+                munmap (data->region, sizeof (sch_shmregion_t));
+        if (data->memfd != -1)
+                close (data->memfd);
+        if (data->sfd != -1)
+                close (data->sfd);
+
+        for (i = 0; i < SCH_SHM_EVCOUNT; ++i)
+                if (data->ev[i] != -1)
+                        close (data->ev[i]);
+
+        if (data->execpath != NULL)
+                sm_free (data->execpath);
+
+        sm_free (data);
+}
+
+/* assign the rings and eventfds according to the side we are on */
+static void sch_shm_data_setup (sch_shmdata_t *data, int child)
+{
+        if (!child) {
+                data->out       = &data->region->ring[0];
+                data->out_data  = data->ev[SCH_SHM_EV0DATA];
+                data->out_space = data->ev[SCH_SHM_EV0SPACE];
+                data->in        = &data->region->ring[1];
+                data->in_data   = data->ev[SCH_SHM_EV1DATA];
+                data->in_space  = data->ev[SCH_SHM_EV1SPACE];
+        } else {
+                data->out       = &data->region->ring[1];
+                data->out_data  = data->ev[SCH_SHM_EV1DATA];
+                data->out_space = data->ev[SCH_SHM_EV1SPACE];
+                data->in        = &data->region->ring[0];
+                data->in_data   = data->ev[SCH_SHM_EV0DATA];
+                data->in_space  = data->ev[SCH_SHM_EV0SPACE];
+        }
+}
+
+static void sch_shm_signal (int evfd)
+{
+        uint64_t one = 1;
+
+        if (write (evfd, &one, sizeof one) != sizeof one && errno != EAGAIN)
+                dI("eventfd write failed: %d, %s.", errno, strerror (errno));
+}
+
+/*
+ * Wait until `evfd' is signaled. Returns 1 if it was, 2 if the peer went
+ * away, 0 on timeout and -1 on error. The eventfd counter is reset, so the
+ * caller has to recheck the ring state after this function returns.
+ */
+static int sch_shm_wait (sch_shmdata_t *data, int evfd, int timeout_ms)
+{
+        struct pollfd pfd[2];
+        uint64_t      cnt;
+        char          junk[64];
+
+        pfd[0].fd     = evfd;
+        pfd[0].events = POLLIN;
+        pfd[1].fd     = data->sfd;
+        pfd[1].events = POLLIN;
+
+        for (;;) {
+                switch (poll (pfd, 2, timeout_ms)) {
+                case -1:
+                        if (errno == EINTR)
+                                continue;
+                        return (-1);
+                case 0:
+                        return (0);
+                }
+
+                if (pfd[0].revents & POLLIN) {
+                        if (read (evfd, &cnt, sizeof cnt) < 0 && errno != EAGAIN)
+                                return (-1);
+                        return (1);
+                }
+
+                if (pfd[1].revents & (POLLIN|POLLHUP|POLLERR)) {
+                        /*
+                         * Nothing is supposed to be sent over the socket;
+                         * drop any stray output and report a hangup.
+                         */
+                        switch (recv (data->sfd, junk, sizeof junk, MSG_DONTWAIT)) {
+                        case 0:
+                                return (2);
+                        case -1:
+                                if (errno == EAGAIN || errno == EINTR)
+                                        continue;
+                                return (2);
+                        default:
+                                continue;
+                        }
+                }
+        }
+}
+
+static int sch_shm_peer_alive (sch_shmdata_t *data)
+{
+        /* a probe forked by a zygote isn't our child, it's seen on the socket */
+        if (data->pid != -1 && !data->zygote)
+                return (sch_pipe_check_child (data->pid, 0) == 0);
+
+        return (1);
+}
+
+static size_t sch_shm_ring_avail (sch_shmring_t *ring)
+{
+        uint64_t head = ring->head;
+
+        __sync_synchronize ();
+
+        return (size_t)(head - ring->tail);
+}
+
+static size_t sch_shm_ring_space (sch_shmring_t *ring)
+{
+        uint64_t tail = ring->tail;
+
+        __sync_synchronize ();
+
+        return (size_t)(SCH_SHM_RINGSIZE - (ring->head - tail));
+}
+
+static ssize_t sch_shm_write (sch_shmdata_t *data, const void *buf, size_t len)
+{
+        sch_shmring_t *ring = data->out;
+        const uint8_t *src  = (const uint8_t *)buf;
+        size_t         left = len;
+
+        while (left > 0) {
+                size_t space, n, off, first;
+
+                while ((space = sch_shm_ring_space (ring)) == 0) {
+                        switch (sch_shm_wait (data, data->out_space, -1)) {
+                        case 1:
+                                continue;
+                        case 2:
+                                errno = EPIPE;
+                                /* FALLTHROUGH */
+                        default:
+                                return (-1);
+                        }
+                }
+
+                n     = left < space ? left : space;
+                off   = (size_t)(ring->head % SCH_SHM_RINGSIZE);
+                first = SCH_SHM_RINGSIZE - off;
+
+                if (first > n)
+                        first = n;
+
+                memcpy (ring->data + off, src, first);
+                memcpy (ring->data, src + first, n - first);
+
+                __sync_synchronize ();
+                ring->head += n;
+
+                sch_shm_signal (data->out_data);
+
+                src  += n;
+                left -= n;
+        }
+
+        return ((ssize_t)len);
+}
+
+int sch_shm_connect (SEAP_desc_t *desc, const char *uri, uint32_t flags)
+{
+        sch_shmdata_t *data;
+        struct stat    st;
+        char           envbuf[128];
+        char         **envp;
+        size_t         envc;
+        int            sfd[2] = { -1, -1 };
+        int            i;
+        pid_t          pid;
+        sch_pipe_prio_t prio;
+
+        assume_r (desc != NULL, -1, errno = EFAULT;);
+        assume_r (uri  != NULL, -1, errno = EFAULT;);
+        assume_r (desc->scheme_data == NULL, -1, errno = EALREADY;);
+
+        data = sch_shm_data_new ();
+        data->execpath = sch_pipe_execpath (uri, flags);
+
+        if (data->execpath == NULL) {
+                errno = EINVAL;
+                goto fail;
+        }
+
+        if (stat (data->execpath, &st) != 0)
+                goto fail;
+        if (!S_ISREG(st.st_mode)) {
+                errno = EINVAL;
+                goto fail;
+        }
+
+        if ((data->memfd = memfd_create ("seap-shm", MFD_CLOEXEC)) < 0)
+                goto fail;
+        if (ftruncate (data->memfd, sizeof (sch_shmregion_t)) != 0)
+                goto fail;
+
+        data->region = mmap (NULL, sizeof (sch_shmregion_t), PROT_READ|PROT_WRITE,
+                             MAP_SHARED, data->memfd, 0);
+
+        if (data->region == MAP_FAILED) {
+                data->region = NULL;
+                goto fail;
+        }
+
+        for (i = 0; i < SCH_SHM_EVCOUNT; ++i)
+                if ((data->ev[i] = eventfd (0, EFD_NONBLOCK|EFD_CLOEXEC)) < 0)
+                        goto fail;
+
+        if (socketpair (AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0, sfd) < 0)
+                goto fail;
+
+        if (sch_pipe_zygote_enabled ()) {
+                int fds[2 + SCH_SHM_EVCOUNT];
+
+                fds[0] = sfd[1];
+                fds[1] = data->memfd;
+                memcpy (fds + 2, data->ev, sizeof data->ev);
+
+                if ((pid = sch_pipe_zygote_spawn (data->execpath, fds, 2 + SCH_SHM_EVCOUNT)) > 0) {
+                        close (sfd[1]);
+
+                        data->sfd    = sfd[0];
+                        data->pid    = pid;
+                        data->zygote = true;
+
+                        sch_shm_data_setup (data, 0);
+                        desc->scheme_data = (void *)data;
+
+                        return (0);
+                }
+        }
+
+        snprintf (envbuf, sizeof envbuf, SCH_SHM_ENV "=%d:%d:%d:%d:%d",
+                  data->memfd, data->ev[0], data->ev[1], data->ev[2], data->ev[3]);
+
+        /* prepare the environment before forking, the child may only exec */
+        for (envc = 0; environ[envc] != NULL; ++envc);
+
+        envp = sm_alloc (sizeof (char *) * (envc + 2));
+        memcpy (envp, environ, sizeof (char *) * envc);
+        envp[envc]     = envbuf;
+        envp[envc + 1] = NULL;
+
+        sch_pipe_prio_get (&prio);
+
+        switch (pid = fork ()) {
+        case -1:
+                protect_errno {
+                        sm_free (envp);
+                        close (sfd[0]);
+                        close (sfd[1]);
+                }
+                goto fail;
+        case  0: /* child */
+                close (sfd[0]);
+
+                if (dup2 (sfd[1], STDIN_FILENO) != STDIN_FILENO)
+                        _exit (errno);
+                if (dup2 (sfd[1], STDOUT_FILENO) != STDOUT_FILENO)
+                        _exit (errno);
+
+                /* pass the region and the eventfds to the probe */
+                fcntl (data->memfd, F_SETFD, 0);
+
+                for (i = 0; i < SCH_SHM_EVCOUNT; ++i)
+                        fcntl (data->ev[i], F_SETFD, 0);
+
+                sch_pipe_prio_set (&prio);
+                execle (data->execpath, data->execpath, NULL, envp);
+                _exit (errno);
+        default: /* parent */
+                sm_free (envp);
+                close (sfd[1]);
+
+                data->sfd = sfd[0];
+                data->pid = pid;
+        }
+
+        sch_shm_data_setup (data, 0);
+
+        if (sch_pipe_check_child (data->pid, 0) != 0)
+                goto fail;
+
+        desc->scheme_data = (void *)data;
+
+        return (0);
+fail:
+        protect_errno {
+                sch_shm_data_free (data);
+        }
+        return (-1);
+}
+
+int sch_shm_openfd (SEAP_desc_t *desc, int fd, uint32_t flags)
+{
+        sch_shmdata_t *data;
+        const char    *env;
+        int            i;
+
+        assume_r (desc != NULL, -1, errno = EFAULT;);
+        assume_r (desc->scheme_data == NULL, -1, errno = EALREADY;);
+
+        env = getenv (SCH_SHM_ENV);
+
+        if (env == NULL) {
+                errno = ENOENT;
+                return (-1);
+        }
+
+        data = sch_shm_data_new ();
+
+        if (sscanf (env, "%d:%d:%d:%d:%d", &data->memfd,
+                    &data->ev[0], &data->ev[1], &data->ev[2], &data->ev[3]) != 5)
+        {
+                dI("Invalid %s value: %s", SCH_SHM_ENV, env);
+                data->memfd = -1;
+
+                for (i = 0; i < SCH_SHM_EVCOUNT; ++i)
+                        data->ev[i] = -1;
+
+                sch_shm_data_free (data);
+                errno = EINVAL;
+                return (-1);
+        }
+
+        /* don't pass the descriptors on to programs started by the probe */
+        unsetenv (SCH_SHM_ENV);
+        fcntl (data->memfd, F_SETFD, FD_CLOEXEC);
+
+        for (i = 0; i < SCH_SHM_EVCOUNT; ++i)
+                fcntl (data->ev[i], F_SETFD, FD_CLOEXEC);
+
+        data->region = mmap (NULL, sizeof (sch_shmregion_t), PROT_READ|PROT_WRITE,
+                             MAP_SHARED, data->memfd, 0);
+
+        if (data->region == MAP_FAILED) {
+                data->region = NULL;
+                protect_errno {
+                        sch_shm_data_free (data);
+                }
+                return (-1);
+        }
+
+        data->sfd = fd;
+        sch_shm_data_setup (data, 1);
+        desc->scheme_data = (void *)data;
+
+        return (0);
+}
+
+int sch_shm_openfd2 (SEAP_desc_t *desc, int ifd, int ofd, uint32_t flags)
+{
+        errno = EOPNOTSUPP;
+        return (-1);
+}
+
+ssize_t sch_shm_recv (SEAP_desc_t *desc, void *buf, size_t len, uint32_t flags)
+{
+        sch_shmdata_t *data;
+        sch_shmring_t *ring;
+        size_t avail, off, first;
+
+        assume_d (desc != NULL, -1, errno = EFAULT;);
+        assume_d (buf  != NULL, -1, errno = EFAULT;);
+
+        data = DATA(desc->scheme_data);
+
+        assume_r (data != NULL, -1, errno = EBADF;);
+
+        ring = data->in;
+
+        while ((avail = sch_shm_ring_avail (ring)) == 0) {
+                switch (sch_shm_wait (data, data->in_data, -1)) {
+                case 1:
+                        continue;
+                case 2:
+                        /* EOF; data written before the hangup was consumed */
+                        if (sch_shm_ring_avail (ring) > 0)
+                                continue;
+                        if (!sch_shm_peer_alive (data))
+                                return (-1);
+                        return (0);
+                default:
+                        return (-1);
+                }
+        }
+
+        if (len > avail)
+                len = avail;
+
+        off   = (size_t)(ring->tail % SCH_SHM_RINGSIZE);
+        first = SCH_SHM_RINGSIZE - off;
+
+        if (first > len)
+                first = len;
+
+        memcpy (buf, ring->data + off, first);
+        memcpy ((uint8_t *)buf + first, ring->data, len - first);
+
+        __sync_synchronize ();
+        ring->tail += len;
+
+        sch_shm_signal (data->in_space);
+
+        return ((ssize_t)len);
+}
+
+ssize_t sch_shm_send (SEAP_desc_t *desc, void *buf, size_t len, uint32_t flags)
+{
+        sch_shmdata_t *data;
+
+        assume_d (desc != NULL, -1, errno = EFAULT;);
+        assume_d (buf  != NULL, -1, errno = EFAULT;);
+
+        data = DATA(desc->scheme_data);
+
+        assume_r (data != NULL, -1, errno = EBADF;);
+
+        if (!sch_shm_peer_alive (data))
+                return (-1);
+
+        return sch_shm_write (data, buf, len);
+}
+
+ssize_t sch_shm_sendsexp (SEAP_desc_t *desc, SEXP_t *sexp, uint32_t flags)
+{
+        sch_shmdata_t *data;
+        strbuf_t      *sb;
+        struct strblk *blk;
+        ssize_t        ret;
+
+        assume_d (desc != NULL, -1, errno = EFAULT;);
+        assume_d (sexp != NULL, -1, errno = EFAULT;);
+
+        data = DATA(desc->scheme_data);
+
+        assume_r (data != NULL, -1, errno = EBADF;);
+
+        if (!sch_shm_peer_alive (data))
+                return (-1);
+
+        sb = strbuf_new (SEAP_STRBUF_MAX);
+
+        if (SEAP_DESC_SBPRINT(desc, sexp, sb) != 0) {
+                strbuf_free (sb);
+                return (-1);
+        }
+
+        ret = 0;
+
+        for (blk = sb->beg; blk != NULL; blk = blk->next) {
+                if (blk->size == 0)
+                        continue;
+                if (sch_shm_write (data, blk->data, blk->size) < 0) {
+                        ret = -1;
+                        break;
+                }
+
+                ret += blk->size;
+        }
+
+        protect_errno {
+                strbuf_free (sb);
+        }
+
+        return (ret);
+}
+
+int sch_shm_close (SEAP_desc_t *desc, uint32_t flags)
+{
+        sch_shmdata_t *data;
+        int try;
+
+        assume_d (desc != NULL, -1, errno = EFAULT;);
+
+        data = DATA(desc->scheme_data);
+
+        assume_r (data != NULL, -1, errno = EBADF;);
+
+        if (data->zygote) {
+                /* a closed socket means the PID may be reused already */
+                if (sch_pipe_wait_eof (data->sfd, 0) != 0) {
+                        kill (data->pid, SIGTERM);
+
+                        if (sch_pipe_wait_eof (data->sfd, 3000) != 0)
+                                kill (data->pid, SIGKILL);
+                }
+        } else if (data->pid != -1) {
+                kill (data->pid, SIGTERM);
+
+                for (try = 0; try < 3; ++try) {
+                        switch (sch_pipe_check_child (data->pid, 1)) {
+                        case  0:
+                                kill (data->pid, SIGTERM);
+                                break;
+                        case -1:
+                                return (-1);
+                        case  1:
+                                goto clean;
+                        }
+                }
+
+                kill (data->pid, SIGKILL);
+
+                if (sch_pipe_check_child (data->pid, 0) != 1)
+                        return (-1);
+        } else
+                data->sfd = -1; /* owned by the caller */
+clean:
+        sch_shm_data_free (data);
+        desc->scheme_data = NULL;
+
+        return (0);
+}
+
+int sch_shm_select (SEAP_desc_t *desc, int ev, uint16_t timeout, uint32_t flags)
+{
+        sch_shmdata_t *data;
+        int evfd;
+
+        assume_d (desc != NULL, -1, errno = EFAULT;);
+
+        data = DATA(desc->scheme_data);
+
+        assume_r (data != NULL, -1, errno = EBADF;);
+
+        if (!sch_shm_peer_alive (data))
+                return (-1);
+
+        switch (ev) {
+        case SEAP_IO_EVREAD:
+                evfd = data->in_data;
+                break;
+        case SEAP_IO_EVWRITE:
+                evfd = data->out_space;
+                break;
+        default:
+                abort ();
+        }
+
+        for (;;) {
+                if (ev == SEAP_IO_EVREAD ?
+                    sch_shm_ring_avail (data->in) > 0 :
+                    sch_shm_ring_space (data->out) > 0)
+                        return (0);
+
+                switch (sch_shm_wait (data, evfd, timeout > 0 ? (int)timeout * 1000 : -1)) {
+                case 1:
+                        continue;
+                case 2:
+                        /* let recv/send report the hangup */
+                        return (0);
+                case 0:
+                        errno = ETIMEDOUT;
+                        /* FALLTHROUGH */
+                default:
+                        return (-1);
+                }
+        }
+}
+
+#else /* SEAP_SCHEME_SHM */
+
+int sch_shm_connect (SEAP_desc_t *desc, const char *uri, uint32_t flags)
+{
+        errno = EOPNOTSUPP;
+        return (-1);
+}
+
+int sch_shm_openfd (SEAP_desc_t *desc, int fd, uint32_t flags)
+{
+        errno = EOPNOTSUPP;
+        return (-1);
+}
+
+int sch_shm_openfd2 (SEAP_desc_t *desc, int ifd, int ofd, uint32_t flags)
+{
+        errno = EOPNOTSUPP;
+        return (-1);
+}
+
+ssize_t sch_shm_recv (SEAP_desc_t *desc, void *buf, size_t len, uint32_t flags)
+{
+        errno = EOPNOTSUPP;
+        return (-1);
+}
+
+ssize_t sch_shm_send (SEAP_desc_t *desc, void *buf, size_t len, uint32_t flags)
+{
+        errno = EOPNOTSUPP;
+        return (-1);
+}
+
+ssize_t sch_shm_sendsexp (SEAP_desc_t *desc, SEXP_t *sexp, uint32_t flags)
+{
+        errno = EOPNOTSUPP;
+        return (-1);
+}
+
+int sch_shm_close (SEAP_desc_t *desc, uint32_t flags)
+{
+        errno = EOPNOTSUPP;
+        return (-1);
+}
+
+int sch_shm_select (SEAP_desc_t *desc, int ev, uint16_t timeout, uint32_t flags)
+{
+        errno = EOPNOTSUPP;
+        return (-1);
+}
+
+#endif /* SEAP_SCHEME_SHM */
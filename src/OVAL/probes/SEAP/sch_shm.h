@@ -0,0 +1,98 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#pragma once
+#ifndef SCH_SHM_H
+#define SCH_SHM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include "../../../common/util.h"
+
+OSCAP_HIDDEN_START;
+
+#if defined(HAVE_MEMFD_CREATE) && defined(HAVE_EVENTFD) && defined(HAVE_ATOMIC_BUILTINS)
+# define SEAP_SCHEME_SHM 1
+#endif
+
+/*
+ * The shm scheme starts a probe like the pipe scheme does, but the data
+ * is exchanged through two ring buffers in a memfd-backed shared memory
+ * region. Eventfds are used to signal that data was written to a ring
+ * or that space was freed in it. The socket which is connected to the
+ * probe's standard input and output only serves to detect that the peer
+ * went away.
+ *
+ * The child side learns about the region and the eventfds from the
+ * SCH_SHM_ENV environment variable and opens the descriptor with
+ * SEAP_openshm().
+ */
+#define SCH_SHM_RINGSIZE (1 << 20)
+#define SCH_SHM_ENV      "SEAP_SHM_FDS"
+
+typedef struct {
+        volatile uint64_t head; /* total number of bytes written */
+        uint8_t           __pad0[64 - sizeof(uint64_t)];
+        volatile uint64_t tail; /* total number of bytes read */
+        uint8_t           __pad1[64 - sizeof(uint64_t)];
+        uint8_t           data[SCH_SHM_RINGSIZE];
+} sch_shmring_t;
+
+/* [0]: parent -> child, [1]: child -> parent */
+typedef struct {
+        sch_shmring_t ring[2];
+} sch_shmregion_t;
+
+/* eventfd indexes */
+#define SCH_SHM_EV0DATA  0
+#define SCH_SHM_EV0SPACE 1
+#define SCH_SHM_EV1DATA  2
+#define SCH_SHM_EV1SPACE 3
+#define SCH_SHM_EVCOUNT  4
+
+typedef struct {
+        sch_shmregion_t *region;
+        sch_shmring_t   *in;
+        sch_shmring_t   *out;
+        int    memfd;
+        int    ev[SCH_SHM_EVCOUNT];
+        int    in_data;   /* signaled by the peer after writing to `in' */
+        int    in_space;  /* signaled by us after reading from `in' */
+        int    out_data;  /* signaled by us after writing to `out' */
+        int    out_space; /* signaled by the peer after reading from `out' */
+        int    sfd;       /* peer liveness socket */
+        pid_t  pid;       /* probe PID or -1 on the probe side */
+        bool   zygote;    /* forked by a zygote, not our child */
+        char  *execpath;
+} sch_shmdata_t;
+
+int sch_shm_connect (SEAP_desc_t *desc, const char *uri, uint32_t flags);
+int sch_shm_openfd (SEAP_desc_t *desc, int fd, uint32_t flags);
+int sch_shm_openfd2 (SEAP_desc_t *desc, int ifd, int ofd, uint32_t flags);
+ssize_t sch_shm_recv (SEAP_desc_t *desc, void *buf, size_t len, uint32_t flags);
+ssize_t sch_shm_send (SEAP_desc_t *desc, void *buf, size_t len, uint32_t flags);
+ssize_t sch_shm_sendsexp (SEAP_desc_t *desc, SEXP_t *sexp, uint32_t flags);
+int sch_shm_close (SEAP_desc_t *desc, uint32_t flags);
+int sch_shm_select (SEAP_desc_t *desc, int ev, uint16_t timeout, uint32_t flags);
+
+OSCAP_HIDDEN_END;
+
+#endif /* SCH_SHM_H */
@@ -0,0 +1,184 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <common/assume.h>
+#include "generic/common.h"
+#include "public/sm_alloc.h"
+#include "_sexp-types.h"
+#include "_seap-types.h"
+#include "_seap-scheme.h"
+#include "sch_pipe.h"
+#include "sch_ssh.h"
+#include "seap-descriptor.h"
+
+#define SCH_SSH_SOCKBUF (1024 * 1024)
+
+/* split //user@host[:port]/path into its parts */
+static int sch_ssh_parse_uri (const char *uri, char **dest, char **port, char **path)
+{
+        const char *p, *colon;
+
+        if (strncmp (uri, "//", 2) != 0)
+                return (-1);
+
+        uri += 2;
+        p = strchr (uri, '/');
+
+        if (p == NULL || p == uri)
+                return (-1);
+
+        colon = memchr (uri, ':', p - uri);
+
+        if (colon != NULL) {
+                if (colon + 1 == p || strspn (colon + 1, "0123456789") != (size_t)(p - colon - 1))
+                        return (-1);
+
+                *dest = sm_alloc (colon - uri + 1);
+                memcpy (*dest, uri, colon - uri);
+                (*dest)[colon - uri] = '\0';
+
+                *port = sm_alloc (p - colon);
+                memcpy (*port, colon + 1, p - colon - 1);
+                (*port)[p - colon - 1] = '\0';
+        } else {
+                *dest = sm_alloc (p - uri + 1);
+                memcpy (*dest, uri, p - uri);
+                (*dest)[p - uri] = '\0';
+                *port = NULL;
+        }
+
+        *path = strdup (p);
+
+        return (0);
+}
+
+int sch_ssh_connect (SEAP_desc_t *desc, const char *uri, uint32_t flags)
+{
+        sch_pipedata_t *data;
+        char  *dest, *port, *path;
+        pid_t  pid;
+        int    pfd[2] = { -1, -1 };
+
+        assume_r (desc != NULL, -1, errno = EFAULT;);
+        assume_r (uri  != NULL, -1, errno = EFAULT;);
+        assume_r (desc->scheme_data == NULL, -1, errno = EALREADY;);
+
+        if (sch_ssh_parse_uri (uri, &dest, &port, &path) != 0) {
+                errno = EINVAL;
+                return (-1);
+        }
+
+        data = (sch_pipedata_t *) sm_talloc (sch_pipedata_t);
+        data->zygote   = false;
+        data->execpath = sm_alloc (strlen (path) + 1);
+        strcpy (data->execpath, path);
+        free (path);
+
+        if (socketpair (AF_UNIX, SOCK_STREAM, 0, pfd) < 0)
+                goto fail;
+
+        {
+                int bufsz = SCH_SSH_SOCKBUF;
+
+                setsockopt (pfd[0], SOL_SOCKET, SO_RCVBUF, &bufsz, sizeof bufsz);
+                setsockopt (pfd[0], SOL_SOCKET, SO_SNDBUF, &bufsz, sizeof bufsz);
+        }
+
+        switch (pid = fork ()) {
+        case -1: /* error */
+                protect_errno {
+                        close (pfd[0]);
+                        close (pfd[1]);
+                }
+                goto fail;
+        case  0: /* child */
+        {
+                /*
+                 * The first probe becomes the master connection, the others
+                 * reuse it while it lasts, and it lasts a while after the
+                 * last probe so that the next evaluation reuses it too.
+                 */
+                const char *argv[] = {
+                        "ssh", "-T", "-q",
+                        "-o", "BatchMode=yes",
+                        "-o", "Compression=yes",
+                        "-o", "ControlMaster=auto",
+                        "-o", "ControlPath=~/.ssh/oscap-probe-%C",
+                        "-o", "ControlPersist=60",
+                        NULL, NULL, NULL, NULL, NULL, NULL
+                };
+                int argc = 13;
+
+                if (port != NULL) {
+                        argv[argc++] = "-p";
+                        argv[argc++] = port;
+                }
+                argv[argc++] = "--";
+                argv[argc++] = dest;
+                argv[argc++] = data->execpath;
+
+                close (pfd[0]);
+
+                if (dup2 (pfd[1], STDIN_FILENO) != STDIN_FILENO)
+                        _exit (errno);
+                if (dup2 (pfd[1], STDOUT_FILENO) != STDOUT_FILENO)
+                        _exit (errno);
+                execvp (argv[0], (char * const *)argv);
+                _exit (errno);
+        }
+        default: /* parent */
+                close (pfd[1]);
+
+                data->pfd = pfd[0];
+                data->pid = pid;
+
+                if (sch_pipe_check_child (data->pid, 0) != 0) {
+                        protect_errno {
+                                close (data->pfd);
+                        }
+                        goto fail;
+                }
+        }
+
+        sm_free (dest);
+        sm_free (port);
+
+        desc->scheme_data = (void *)data;
+
+        return (0);
+fail:
+        protect_errno {
+                sm_free (dest);
+                sm_free (port);
+                sm_free (data->execpath);
+                sm_free (data);
+        }
+        return (-1);
+}
@@ -0,0 +1,40 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#pragma once
+#ifndef SCH_SSH_H
+#define SCH_SSH_H
+
+#include <stdint.h>
+#include "../../../common/util.h"
+
+OSCAP_HIDDEN_START;
+
+/*
+ * The ssh scheme starts the probe on a remote host: ssh://user@host[:port]/path
+ * runs ssh with the probe at the absolute path as the remote command, and the
+ * probe talks to us through the standard input and output of ssh. Everything
+ * else is done by the pipe scheme functions, the scheme data is the same.
+ * The connections of the probes are multiplexed over one master connection.
+ */
+int sch_ssh_connect (SEAP_desc_t *desc, const char *uri, uint32_t flags);
+
+OSCAP_HIDDEN_END;
+
+#endif /* SCH_SSH_H */
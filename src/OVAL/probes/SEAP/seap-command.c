@@ -506,8 +506,9 @@ SEAP_cmdjob_t *SEAP_cmdjob_new (void)
         SEAP_cmdjob_t *j;
 
         j = sm_talloc (SEAP_cmdjob_t);
-        j->ctx = NULL;
-        j->sd  = -1;
+        j->ctx  = NULL;
+        j->sd   = -1;
+        j->next = NULL;
 
         return (j);
 }
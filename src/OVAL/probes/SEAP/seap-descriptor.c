@@ -70,12 +70,16 @@ int SEAP_desc_add (SEAP_desctable_t *sd_table, SEXP_pstate_t *pstate,
                 sd_dsc->scheme  = scheme;
                 sd_dsc->scheme_data = scheme_data;
                 sd_dsc->ostate  = NULL;
+                sd_dsc->fmt_out = SEXP_FMT_CANONICAL;
                 sd_dsc->next_cid = 0;
                 sd_dsc->cmd_c_table = SEAP_cmdtbl_new ();
                 sd_dsc->cmd_w_table = SEAP_cmdtbl_new ();
 		sd_dsc->msg_queue = NULL;
 		sd_dsc->err_queue = rbt_i32_new();
 		sd_dsc->cmd_queue = NULL;
+		sd_dsc->stream_fn = NULL;
+		sd_dsc->stream_arg = NULL;
+		sd_dsc->stream_depth = 0;
 
 		SEAP_packetq_init(&sd_dsc->pck_queue);
 
@@ -33,6 +33,7 @@
 #include "_seap-packetq.h"
 #include "_sexp-parser.h"
 #include "_sexp-output.h"
+#include "_sexp-binary.h"
 #include "_seap-command.h"
 #include "public/seap-scheme.h"
 #include "public/seap-message.h"
@@ -49,6 +50,7 @@ typedef struct {
         SEAP_msgid_t   next_id;
         SEXP_ostate_t *ostate; /* Output state */
         SEXP_pstate_t *pstate; /* Parser state */
+        SEXP_format_t  fmt_out; /* Output wire format (canonical or binary) */
         SEAP_scheme_t  scheme; /* Protocol/Scheme used for this descriptor */
         void          *scheme_data; /* Protocol/Scheme related data */
 
@@ -64,6 +66,12 @@ typedef struct {
         SEAP_cmdid_t   next_cid;
         SEAP_cmdtbl_t *cmd_c_table; /* Local SEAP commands */
         SEAP_cmdtbl_t *cmd_w_table; /* Waiting SEAP commands */
+
+        /* Streamed members of binary replies, see SEAP_msgstream_set */
+        SEAP_msgstream_fn stream_fn;
+        void             *stream_arg;
+        uint32_t          stream_path[SEAP_MSGSTREAM_MAXDEPTH];
+        size_t            stream_depth;
 } SEAP_desc_t;
 
 #define SEAP_DESC_FDIN  0x00000001
@@ -132,6 +140,12 @@ static inline int SEAP_desc_unlock (pthread_mutex_t *m)
 #define DESC_WLOCK(d)    SEAP_desc_lock (&((d)->w_lock))
 #define DESC_WUNLOCK(d)  SEAP_desc_unlock (&((d)->w_lock))
 
+/* serialize `sexp' into `sb' using the output format of the descriptor */
+#define SEAP_DESC_SBPRINT(d, sexp, sb)                  \
+        ((d)->fmt_out == SEXP_FMT_BINARY ?              \
+         SEXP_sbprintf_b((sexp), (sb)) :            \
+         SEXP_sbprintf_t((sexp), (sb)))
+
 SEAP_msgid_t SEAP_desc_genmsgid (SEAP_desctable_t *sd_table, int sd);
 SEAP_cmdid_t SEAP_desc_gencmdid (SEAP_desctable_t *sd_table, int sd);
 
@@ -24,6 +24,7 @@
 #include <config.h>
 #endif
 
+#include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
@@ -589,6 +590,264 @@ static SEXP_t *SEAP_packet2sexp (SEAP_packet_t *packet)
         return (sexp);
 }
 
+/*
+ * State of a binary frame which is decoded while it's being received
+ */
+struct SEAP_bframe {
+        SEAP_CTX_t   *ctx;
+        SEAP_desc_t  *dsc;
+        uint8_t      *buf;
+        size_t        cap;
+        int           err;      /* errno of a failed receive */
+        SEXP_t       *msg;      /* the packet reply_id was looked up in */
+        bool          msg_ok;
+        SEAP_msgid_t  reply_id;
+};
+
+/* the reply-id attribute of a packet which is still being decoded */
+static int SEAP_packet_replyid (SEXP_t *sexp, SEAP_msgid_t *id)
+{
+        SEXP_t *name, *val;
+        uint32_t n, i;
+        int ret = -1;
+
+        name = SEXP_list_first (sexp);
+
+        if (name == NULL)
+                return (-1);
+        if (SEXP_strcmp (name, SEAP_SYM_MSG) != 0) {
+                SEXP_free (name);
+                return (-1);
+        }
+
+        SEXP_free (name);
+        n = SEXP_list_length (sexp);
+
+        for (i = 2; i < n && ret != 0; ) {
+                name = SEXP_list_nth (sexp, i);
+
+                if (SEXP_strcmp (name, ":reply-id") == 0) {
+                        val = SEXP_list_nth (sexp, i + 1);
+#if SEAP_MSGID_BITS == 64
+                        *id = SEXP_number_getu_64 (val);
+#else
+                        *id = SEXP_number_getu_32 (val);
+#endif
+                        ret = SEXP_numberp (val) ? 0 : -1;
+                        SEXP_free (val);
+                }
+
+                /* an attribute without a value, e.g. "chunk", is just its name */
+                i += SEXP_string_nth (name, 1) == ':' ? 2 : 1;
+                SEXP_free (name);
+        }
+
+        return (ret);
+}
+
+/*
+ * Receive at least `need' bytes of the current frame. Nothing is read
+ * past the end of the frame, so the next frame starts a new receive.
+ */
+static int SEAP_packet_fill (SEXP_bdec_t *dec, size_t need)
+{
+        struct SEAP_bframe *bf = dec->arg;
+        size_t  have, want, room;
+        ssize_t rlen;
+
+        have = (size_t)(dec->end - dec->cur);
+        memmove (bf->buf, dec->cur, have);
+
+        /* leave room for more than needed, but not more than the frame */
+        room = have + dec->left < SEAP_RECVBUF_MAX ? have + dec->left : SEAP_RECVBUF_MAX;
+
+        if (room < need)
+                room = need;
+        if (room > bf->cap) {
+                bf->buf = sm_realloc (bf->buf, room);
+                bf->cap = room;
+        }
+
+        dec->cur = bf->buf;
+        dec->end = bf->buf + have;
+
+        while (have < need) {
+                if (SCH_SELECT(bf->dsc->scheme, bf->dsc, SEAP_IO_EVREAD, bf->ctx->recv_timeout, 0) != 0)
+                        goto fail;
+
+                want = bf->cap - have;
+
+                if (want > dec->left)
+                        want = dec->left;
+
+                rlen = SCH_RECV(bf->dsc->scheme, bf->dsc, bf->buf + have, want, 0);
+
+                if (rlen <= 0) {
+                        if (rlen == 0) {
+                                dI("FAIL: incomplete binary frame received");
+                                errno = ENETRESET;
+                        }
+                        goto fail;
+                }
+
+                have      += (size_t)rlen;
+                dec->left -= (size_t)rlen;
+                dec->end   = bf->buf + have;
+        }
+
+        return (0);
+fail:
+        bf->err = errno;
+        return (-1);
+}
+
+/*
+ * Pass the members of the streamed list to the callback of the
+ * descriptor. They are at depth stream_depth + 2: the packet is at
+ * depth 0 and its data, the last member of the packet, at depth 1.
+ */
+static int SEAP_packet_emit (SEXP_bdec_t *dec, SEXP_t *memb, unsigned int depth)
+{
+        struct SEAP_bframe *bf = dec->arg;
+        SEAP_desc_t *dsc = bf->dsc;
+        size_t i;
+
+        if (depth != dsc->stream_depth + 2 || dec->index[0] != dec->count[0])
+                return (0);
+
+        for (i = 0; i < dsc->stream_depth; ++i)
+                if (dec->index[i + 1] != dsc->stream_path[i])
+                        return (0);
+
+        if (bf->msg != dec->list[0]) {
+                bf->msg    = dec->list[0];
+                bf->msg_ok = SEAP_packet_replyid (bf->msg, &bf->reply_id) == 0;
+        }
+
+        if (!bf->msg_ok)
+                return (0);
+
+        return (dsc->stream_fn (bf->reply_id, memb, dsc->stream_arg) == 1 ? 1 : 0);
+}
+
+/*
+ * Receive binary frames. `buf' holds the first `len' bytes received and
+ * has room for `cap' bytes; it is freed by this function. The read lock
+ * of the descriptor has to be held by the caller. Receiving stops at the
+ * first frame boundary, the decoded frames are returned in a list, just
+ * like SEXP_parse() does for the text format.
+ *
+ * A frame which isn't complete is decoded while the rest of it arrives,
+ * so that the members of a streamed reply can be handed over (and freed)
+ * before the whole reply is in memory.
+ */
+static int SEAP_packet_recv_binary (SEAP_CTX_t *ctx, SEAP_desc_t *dsc,
+                                    uint8_t *buf, size_t len, size_t cap, SEXP_t **sexp_buffer)
+{
+        struct SEAP_bframe bf;
+        SEXP_bdec_t dec;
+        SEXP_t *frames, *frame;
+        size_t  off, flen;
+        ssize_t hlen, rlen;
+
+        frames = SEXP_list_new (NULL);
+        off    = 0;
+
+        memset (&bf, 0, sizeof bf);
+        bf.ctx = ctx;
+        bf.dsc = dsc;
+
+        for (;;) {
+                hlen = SEXP_binary_framelen (buf + off, len - off);
+
+                if (hlen < 0) {
+                        errno = EILSEQ;
+                        goto fail;
+                }
+
+                if (hlen == 0) {
+                        if (off == len)
+                                break;
+
+                        /* not even the header is complete */
+                        memmove (buf, buf + off, len - off);
+                        len -= off;
+                        off  = 0;
+
+                        if (SCH_SELECT(dsc->scheme, dsc, SEAP_IO_EVREAD, ctx->recv_timeout, 0) != 0)
+                                goto fail;
+
+                        rlen = SCH_RECV(dsc->scheme, dsc, buf + len, SEXP_BINARY_HDRSZ - len, 0);
+
+                        if (rlen <= 0) {
+                                if (rlen == 0) {
+                                        dI("FAIL: incomplete binary frame received");
+                                        errno = ENETRESET;
+                                }
+                                goto fail;
+                        }
+
+                        len += (size_t)rlen;
+                        continue;
+                }
+
+                flen = (size_t)hlen;
+
+                memset (&dec, 0, sizeof dec);
+                dec.cur  = buf + off + SEXP_BINARY_HDRSZ;
+                dec.end  = buf + off + (flen < len - off ? flen : len - off);
+                dec.left = flen - (size_t)(dec.end - (buf + off));
+                dec.arg  = &bf;
+
+                if (dec.left > 0) {
+                        /* the fill callback moves the data to the beginning */
+                        bf.buf  = buf;
+                        bf.cap  = cap;
+                        dec.fill = &SEAP_packet_fill;
+                }
+                if (dsc->stream_fn != NULL)
+                        dec.emit = &SEAP_packet_emit;
+
+                bf.err = 0;
+                bf.msg = NULL;
+
+                frame = SEXP_binary_decode (&dec);
+
+                if (dec.fill != NULL) {
+                        buf = bf.buf;
+                        cap = bf.cap;
+                }
+
+                if (frame == NULL) {
+                        dI("Invalid binary S-exp frame: length=%zu", flen);
+
+                        if (bf.err != 0)
+                                errno = bf.err;
+
+                        goto fail;
+                }
+
+                SEXP_list_add (frames, frame);
+                SEXP_free (frame);
+
+                if (dec.fill != NULL)
+                        break; /* the frame ended with the last byte received */
+
+                off += flen;
+        }
+
+        sm_free (buf);
+        *sexp_buffer = frames;
+
+        return (0);
+fail:
+        protect_errno {
+                sm_free (buf);
+                SEXP_free (frames);
+        }
+        return (-1);
+}
+
 int SEAP_packet_recv (SEAP_CTX_t *ctx, int sd, SEAP_packet_t **packet)
 {
         SEAP_desc_t *dsc;
@@ -713,6 +972,29 @@ eloop_exit:
 
                 _A(data_length > 0);
 
+                if (pstate == NULL && ((uint8_t *)data_buffer)[0] == SEXP_BINARY_MAGIC) {
+                        SEXP_psetup_free (psetup);
+
+                        if (SEAP_packet_recv_binary (ctx, dsc, data_buffer, (size_t)data_length,
+                                                     data_buflen, &sexp_buffer) != 0)
+                        {
+                                protect_errno {
+                                        dI("FAIL: binary recv failed: dsc=%p, errno=%u, %s.",
+                                           dsc, errno, strerror (errno));
+                                        DESC_RUNLOCK(dsc);
+                                }
+                                return (-1);
+                        }
+
+                        DESC_RUNLOCK(dsc);
+
+                        /* the peer speaks binary, answer in kind unless disabled */
+                        if (ctx->fmt_out == SEXP_FMT_BINARY)
+                                dsc->fmt_out = SEXP_FMT_BINARY;
+
+                        goto packets;
+                }
+
                 if (data_buflen != (size_t)(data_length)) {
                         data_buffer = sm_realloc (data_buffer, data_length);
 			data_buflen = data_length;
@@ -770,6 +1052,7 @@ eloop_exit:
         }
 
         SEXP_psetup_free (psetup);
+packets:
 	SEXP_VALIDATE(sexp_buffer);
 	(*packet) = NULL;
 
@@ -51,6 +51,16 @@ const SEAP_schemefn_t __schtbl[] = {
           sch_pipe_connect, sch_pipe_openfd,
           sch_pipe_openfd2, sch_pipe_recv,
           sch_pipe_send, sch_pipe_close,
+          sch_pipe_sendsexp, sch_pipe_select },
+        { "shm",     /* Like pipe, but the data goes through shared memory */
+          sch_shm_connect, sch_shm_openfd,
+          sch_shm_openfd2, sch_shm_recv,
+          sch_shm_send, sch_shm_close,
+          sch_shm_sendsexp, sch_shm_select },
+        { "ssh",     /* Like pipe, but the probe runs on a remote host */
+          sch_ssh_connect, sch_pipe_openfd,
+          sch_pipe_openfd2, sch_pipe_recv,
+          sch_pipe_send, sch_pipe_close,
           sch_pipe_sendsexp, sch_pipe_select }
 };
 
@@ -51,7 +51,15 @@ static void SEAP_CTX_initdefault (SEAP_CTX_t *ctx)
         ctx->parser  = NULL /* PARSER(label) */;
         ctx->pflags  = SEXP_PFLAG_EOFOK;
         ctx->fmt_in  = SEXP_FMT_CANONICAL;
-        ctx->fmt_out = SEXP_FMT_CANONICAL;
+        ctx->fmt_out = SEXP_FMT_BINARY;
+
+        /*
+         * The binary wire format can be turned off for debugging. Both
+         * formats are always accepted on input.
+         */
+        if (getenv("SEAP_WIRE_FORMAT") != NULL &&
+            strcmp(getenv("SEAP_WIRE_FORMAT"), "text") == 0)
+                ctx->fmt_out = SEXP_FMT_CANONICAL;
 
         /* Initialize descriptor table */
         ctx->sd_table    = SEAP_desctable_new();
@@ -60,6 +68,7 @@ static void SEAP_CTX_initdefault (SEAP_CTX_t *ctx)
         ctx->recv_timeout = 5;
         ctx->send_timeout = 5;
         ctx->cflags       = 0;
+        ctx->cmdpool      = NULL;
 
         return;
 }
@@ -84,6 +93,7 @@ void SEAP_CTX_init (SEAP_CTX_t *ctx)
 void SEAP_CTX_free (SEAP_CTX_t *ctx)
 {
         _A(ctx != NULL);
+        (void) SEAP_cmdpool_set(ctx, 0);
         SEAP_desctable_free(ctx->sd_table);
         SEAP_cmdtbl_free (ctx->cmd_c_table);
         sm_free (ctx);
@@ -127,6 +137,14 @@ int SEAP_connect (SEAP_CTX_t *ctx, const char *uri, uint32_t flags)
                 return(-1);
         }
 
+        /*
+         * The connecting side offers the binary format by using it right
+         * away. The other side switches to it when the first binary frame
+         * arrives (see SEAP_packet_recv), so that a peer which doesn't
+         * support it keeps talking text.
+         */
+        dsc->fmt_out = ctx->fmt_out;
+
         if (SCH_CONNECT(scheme, dsc, uri + schstr_len + 1, flags) != 0) {
                 dI("FAIL: errno=%u, %s.", errno, strerror (errno));
                 SEAP_desc_del(ctx->sd_table, sd);
@@ -176,6 +194,38 @@ int SEAP_openfd2 (SEAP_CTX_t *ctx, int ifd, int ofd, uint32_t flags)
         return (sd);
 }
 
+/*
+ * Open the probe side of a descriptor created by the shm scheme. `fd' is
+ * the socket the probe was started with, the shared memory region and the
+ * eventfds are passed in the environment.
+ */
+int SEAP_openshm (SEAP_CTX_t *ctx, int fd, uint32_t flags)
+{
+        SEAP_desc_t *dsc;
+        int sd;
+
+        sd = SEAP_desc_add (ctx->sd_table, NULL, SCH_SHM, NULL);
+
+        if (sd < 0) {
+                dI("Can't create/add new SEAP descriptor");
+                return (-1);
+        }
+
+        dsc = SEAP_desc_get (ctx->sd_table, sd);
+
+        if (dsc == NULL) {
+                errno = ESRCH;
+                return(-1);
+        }
+
+        if (SCH_OPENFD(SCH_SHM, dsc, fd, flags) != 0) {
+                dI("FAIL: errno=%u, %s.", errno, strerror (errno));
+                return (-1);
+        }
+
+        return (sd);
+}
+
 int SEAP_recvsexp (SEAP_CTX_t *ctx, int sd, SEXP_t **sexp)
 {
         SEAP_msg_t *msg = NULL;
@@ -233,83 +283,218 @@ static int __SEAP_cmdexec_reply (SEAP_CTX_t *ctx, int sd, SEAP_cmd_t *cmd)
         return (0);
 }
 
-static void *__SEAP_cmdexec_worker (void *arg)
+static void __SEAP_cmdjob_exec (SEAP_cmdjob_t *job)
+{
+        (void)__SEAP_cmdexec_reply (job->ctx, job->sd, &job->cmd);
+
+        if (job->cmd.args != NULL)
+                SEXP_free(job->cmd.args);
+
+        SEAP_cmdjob_free (job);
+}
+
+/* the first waiting job whose descriptor isn't served by a worker */
+static SEAP_cmdjob_t *__SEAP_cmdpool_take (SEAP_cmdpool_t *pool)
 {
-        SEAP_cmdjob_t *job = (SEAP_cmdjob_t *)arg;
+        SEAP_cmdjob_t *job, *prev = NULL;
+        unsigned int   i;
+
+        for (job = pool->head; job != NULL; prev = job, job = job->next) {
+                for (i = 0; i < pool->count; ++i)
+                        if (pool->busy[i] == job->sd)
+                                break;
+                if (i < pool->count)
+                        continue;
+
+                if (prev == NULL)
+                        pool->head = job->next;
+                else
+                        prev->next = job->next;
+                if (pool->tail == job)
+                        pool->tail = prev;
+
+                job->next = NULL;
+                return (job);
+        }
+
+        return (NULL);
+}
+
+static void *__SEAP_cmdpool_worker (void *arg)
+{
+        SEAP_cmdpool_t *pool = (SEAP_cmdpool_t *)arg;
+        SEAP_cmdjob_t  *job;
+        unsigned int    self;
 
-        _A(job != NULL);
-        _A(job->cmd != NULL);
 #if defined(HAVE_PTHREAD_SETNAME_NP)
 	pthread_setname_np(pthread_self(), "command_worker");
 #endif
+        pthread_mutex_lock (&pool->lock);
 
-        if (job->cmd->flags & SEAP_CMDFLAG_REPLY) {
-                (void) SEAP_cmd_exec (job->ctx, job->sd, SEAP_EXEC_WQUEUE,
-                                      job->cmd->rid, job->cmd->args,
-                                      SEAP_CMDCLASS_USR, NULL, NULL);
-        } else {
-                (void)__SEAP_cmdexec_reply (job->ctx, job->sd, job->cmd);
+        for (self = 0; self < pool->count; ++self)
+                if (pthread_equal (pool->thread[self], pthread_self ()))
+                        break;
+
+        for (;;) {
+                job = __SEAP_cmdpool_take (pool);
+
+                if (job == NULL) {
+                        if (pool->stop && pool->head == NULL)
+                                break;
+
+                        pthread_cond_wait (&pool->cond, &pool->lock);
+                        continue;
+                }
+
+                pool->busy[self] = job->sd;
+                pthread_mutex_unlock (&pool->lock);
+
+                __SEAP_cmdjob_exec (job);
+
+                pthread_mutex_lock (&pool->lock);
+                pool->busy[self] = -1;
+                /* the next job of the descriptor may be taken now */
+                pthread_cond_broadcast (&pool->cond);
         }
 
+        pthread_mutex_unlock (&pool->lock);
+
         return (NULL);
 }
 
-int __SEAP_recvmsg_process_cmd (SEAP_CTX_t *ctx, int sd, SEAP_cmd_t *cmd)
+int SEAP_cmdpool_set (SEAP_CTX_t *ctx, unsigned int workers)
 {
+        SEAP_cmdpool_t *pool;
+        unsigned int    i;
+
         _A(ctx != NULL);
-        _A(cmd != NULL);
 
-        if (ctx->cflags & SEAP_CFLG_THREAD) {
-                /*
-                 *  Create a new thread for processing this command
-                 */
-                pthread_t      th;
-                pthread_attr_t th_attrs;
+        if (ctx->cmdpool != NULL) {
+                pool = ctx->cmdpool;
+
+                /* the waiting jobs are executed before the workers exit */
+                pthread_mutex_lock (&pool->lock);
+                pool->stop = true;
+                pthread_cond_broadcast (&pool->cond);
+                pthread_mutex_unlock (&pool->lock);
+
+                for (i = 0; i < pool->count; ++i)
+                        pthread_join (pool->thread[i], NULL);
+
+                ctx->cflags &= ~SEAP_CFLG_THREAD;
+                ctx->cmdpool = NULL;
 
-                SEAP_cmdjob_t *job;
+                pthread_cond_destroy (&pool->cond);
+                pthread_mutex_destroy (&pool->lock);
+                sm_free (pool->thread);
+                sm_free (pool->busy);
+                sm_free (pool);
+        }
+
+        if (workers == 0)
+                return (0);
+
+        pool = sm_talloc (SEAP_cmdpool_t);
+        pool->thread = sm_alloc (sizeof (pthread_t) * workers);
+        pool->busy   = sm_alloc (sizeof (int) * workers);
+        pool->count  = 0;
+        pool->head   = NULL;
+        pool->tail   = NULL;
+        pool->stop   = false;
+
+        pthread_mutex_init (&pool->lock, NULL);
+        pthread_cond_init (&pool->cond, NULL);
 
-                /* Initialize thread stuff */
-                pthread_attr_init (&th_attrs);
-                pthread_attr_setdetachstate (&th_attrs, PTHREAD_CREATE_DETACHED);
+        /* the workers look up their slot under the lock */
+        pthread_mutex_lock (&pool->lock);
 
-                /* Prepare the job */
-                job = SEAP_cmdjob_new ();
-                job->ctx = ctx;
-                job->sd  = sd;
-                job->cmd = cmd;
+        for (i = 0; i < workers; ++i) {
+                pool->busy[i] = -1;
 
-                /* Create the worker */
-                if (pthread_create (&th, &th_attrs,
-                                    &__SEAP_cmdexec_worker, (void *)job) != 0)
+                if (pthread_create (&pool->thread[i], NULL,
+                                    &__SEAP_cmdpool_worker, (void *)pool) != 0)
                 {
                         dI("Can't create worker thread: %u, %s.", errno, strerror (errno));
-                        SEAP_cmdjob_free (job);
-                        pthread_attr_destroy (&th_attrs);
-
-                        return (-1);
+                        break;
                 }
 
-                pthread_attr_destroy (&th_attrs);
-        } else {
-                if (cmd->flags & SEAP_CMDFLAG_REPLY) {
-                        (void) SEAP_cmd_exec (ctx, sd, SEAP_EXEC_WQUEUE,
-                                              cmd->rid, cmd->args,
-                                              SEAP_CMDCLASS_USR, NULL, NULL);
-                } else {
-                        int ret;
+                ++pool->count;
+        }
 
-                        ret = __SEAP_cmdexec_reply (ctx, sd, cmd);
+        pthread_mutex_unlock (&pool->lock);
 
-                        if (cmd->args != NULL)
-                                SEXP_free(cmd->args);
+        ctx->cmdpool = pool;
 
-                        return (ret);
-                }
+        if (pool->count == 0) {
+                (void) SEAP_cmdpool_set (ctx, 0);
+                return (-1);
         }
 
+        ctx->cflags |= SEAP_CFLG_THREAD;
+
         return (0);
 }
 
+int __SEAP_recvmsg_process_cmd (SEAP_CTX_t *ctx, int sd, SEAP_cmd_t *cmd)
+{
+        int ret;
+
+        _A(ctx != NULL);
+        _A(cmd != NULL);
+
+        if (cmd->flags & SEAP_CMDFLAG_REPLY) {
+                (void) SEAP_cmd_exec (ctx, sd, SEAP_EXEC_WQUEUE,
+                                      cmd->rid, cmd->args,
+                                      SEAP_CMDCLASS_USR, NULL, NULL);
+                return (0);
+        }
+
+        if (ctx->cflags & SEAP_CFLG_THREAD) {
+                SEAP_cmdpool_t *pool = ctx->cmdpool;
+                SEAP_cmdjob_t  *job;
+                unsigned int    i;
+
+                pthread_mutex_lock (&pool->lock);
+
+                /*
+                 * A command received by the worker serving the same
+                 * descriptor is a callback of the command being executed
+                 * and would wait for it forever in the queue.
+                 */
+                for (i = 0; i < pool->count; ++i)
+                        if (pool->busy[i] == sd &&
+                            pthread_equal (pool->thread[i], pthread_self ()))
+                                break;
+
+                if (i == pool->count) {
+                        job = SEAP_cmdjob_new ();
+                        job->ctx = ctx;
+                        job->sd  = sd;
+                        job->cmd = *cmd;
+
+                        if (pool->tail == NULL)
+                                pool->head = job;
+                        else
+                                pool->tail->next = job;
+                        pool->tail = job;
+
+                        pthread_cond_signal (&pool->cond);
+                        pthread_mutex_unlock (&pool->lock);
+
+                        return (0);
+                }
+
+                pthread_mutex_unlock (&pool->lock);
+        }
+
+        ret = __SEAP_cmdexec_reply (ctx, sd, cmd);
+
+        if (cmd->args != NULL)
+                SEXP_free(cmd->args);
+
+        return (ret);
+}
+
 static int __SEAP_recvmsg_process_err (SEAP_CTX_t *ctx, int sd, SEAP_err_t *err)
 {
 	SEAP_desc_t *sd_desc;
@@ -575,6 +760,39 @@ int SEAP_recverr_byid (SEAP_CTX_t *ctx, int sd, SEAP_err_t **err, SEAP_msgid_t i
         return (0);
 }
 
+int SEAP_msgstream_set (SEAP_CTX_t *ctx, int sd, const uint32_t *path, size_t depth,
+                        SEAP_msgstream_fn fn, void *arg)
+{
+        SEAP_desc_t *dsc;
+
+        if (depth > SEAP_MSGSTREAM_MAXDEPTH || (depth > 0 && path == NULL)) {
+                errno = EINVAL;
+                return (-1);
+        }
+
+        dsc = SEAP_desc_get (ctx->sd_table, sd);
+
+        if (dsc == NULL) {
+                errno = EBADF;
+                return (-1);
+        }
+
+        /* not while a reply is being received */
+        if (DESC_RLOCK (dsc) != 1)
+                return (-1);
+
+        dsc->stream_fn    = fn;
+        dsc->stream_arg   = arg;
+        dsc->stream_depth = fn != NULL ? depth : 0;
+
+        if (fn != NULL && depth > 0)
+                memcpy (dsc->stream_path, path, sizeof (uint32_t) * depth);
+
+        DESC_RUNLOCK (dsc);
+
+        return (0);
+}
+
 SEXP_t *SEAP_read (SEAP_CTX_t *ctx, int sd)
 {
         errno = EOPNOTSUPP;
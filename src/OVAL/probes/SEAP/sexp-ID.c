@@ -61,12 +61,75 @@ static SEXP_ID_t SEXP_ID_hash(void *buf, size_t len, SEXP_ID_t seed, int part)
         return (resbuf[part]);
 }
 
+/*
+ * The ID of a list is computed from the IDs of its members. The members
+ * are folded into an accumulator which doesn't depend on anything else
+ * than the preceding members, so the accumulator can be updated when a
+ * member is appended to the list (see SEXP_ID_track) and the final ID is
+ * computed from it in constant time.
+ */
+static SEXP_ID_t SEXP_ID_mix(SEXP_ID_t h)
+{
+        h ^= h >> 33;
+        h *= UINT64_C(0xff51afd7ed558ccd);
+        h ^= h >> 33;
+        h *= UINT64_C(0xc4ceb9fe1a85ec53);
+        h ^= h >> 33;
+
+        return (h);
+}
+
+static SEXP_ID_t SEXP_ID_combine(SEXP_ID_t acc, SEXP_ID_t memb_id)
+{
+        acc ^= memb_id + UINT64_C(0x9e3779b97f4a7c15) + (acc << 6) + (acc >> 2);
+        acc  = SEXP_ID_mix(acc);
+
+        /* 0 is reserved for "not cached" */
+        return (acc != 0 ? acc : 1);
+}
+
+static SEXP_ID_t SEXP_ID_list_seed(int part)
+{
+        return (part == 0 ? UINT64_C(0xAD30917100C0FFEE) : UINT64_C(0xAD309171FFC0FFEE));
+}
+
+static SEXP_ID_t SEXP_ID_list_final(SEXP_ID_t acc, int part)
+{
+        return SEXP_ID_mix(acc ^ SEXP_ID_list_seed(part));
+}
+
+static SEXP_ID_t SEXP_ID_compute(const SEXP_t *sexp, int part);
+
 static int SEXP_ID_v_callback(const SEXP_t *sexp, __IDres_pair *pair)
+{
+        pair->hash = SEXP_ID_combine(pair->hash, SEXP_ID_compute(sexp, pair->part));
+        return (0);
+}
+
+static SEXP_ID_t SEXP_ID_list_acc(SEXP_val_t *v_dsc, int part)
+{
+        __IDres_pair pair;
+
+        /* only IDs of the first kind are cached */
+        if (part == 0 && SEXP_LCASTP(v_dsc->mem)->id != 0)
+                return (SEXP_LCASTP(v_dsc->mem)->id);
+
+        pair.hash = SEXP_ID_list_seed(part);
+        pair.part = part;
+
+        SEXP_rawval_lblk_cb ((uintptr_t)SEXP_LCASTP(v_dsc->mem)->b_addr,
+                             (int (*)(SEXP_t *, void *)) SEXP_ID_v_callback,
+                             (void *) &pair,
+                             SEXP_LCASTP(v_dsc->mem)->offset + 1);
+
+        return (pair.hash);
+}
+
+static SEXP_ID_t SEXP_ID_compute(const SEXP_t *sexp, int part)
 {
         SEXP_val_t v_dsc;
 
-        assume_d(sexp != NULL, -1);
-        assume_d(pair != NULL, -1);
+        assume_d(sexp != NULL, 0);
 
         /*
          * Fill v_dsc with metainformation
@@ -76,22 +139,11 @@ static int SEXP_ID_v_callback(const SEXP_t *sexp, __IDres_pair *pair)
         switch (v_dsc.type) {
         case SEXP_VALTYPE_NUMBER:
         case SEXP_VALTYPE_STRING:
-                pair->hash = SEXP_ID_hash(v_dsc.mem, v_dsc.hdr->size, pair->hash, pair->part);
-                break;
+                return SEXP_ID_hash(v_dsc.mem, v_dsc.hdr->size, v_dsc.type, part);
         case SEXP_VALTYPE_LIST:
-        {
-                SEXP_rawval_lblk_cb ((uintptr_t)SEXP_LCASTP(v_dsc.mem)->b_addr,
-                                     (int (*)(SEXP_t *, void *)) SEXP_ID_v_callback,
-                                     (void *) pair,
-                                     SEXP_LCASTP(v_dsc.mem)->offset + 1);
-
-                pair->hash = SEXP_ID_hash(&pair->hash, 1,
-					  pair->hash + SEXP_LCASTP(v_dsc.mem)->offset, pair->part);
-                break;
-        }
+                return SEXP_ID_list_final(SEXP_ID_list_acc(&v_dsc, part), part);
         case SEXP_VALTYPE_EMPTY:
-                pair->hash = SEXP_ID_hash(&pair->hash, 1, pair->hash, pair->part);
-                break;
+                return SEXP_ID_mix(SEXP_ID_list_seed(part) + SEXP_VALTYPE_EMPTY);
         default:
                 /* Unknown S-exp value type */
                 abort ();
@@ -102,26 +154,40 @@ static int SEXP_ID_v_callback(const SEXP_t *sexp, __IDres_pair *pair)
 
 SEXP_ID_t SEXP_ID_v(const SEXP_t *s)
 {
-	__IDres_pair pair;
-
-        pair.hash = 0xAD30917100C0FFEE;
-	pair.part = 0;
-
-        SEXP_ID_v_callback(s, &pair);
-
-        return (pair.hash);
+        return SEXP_ID_compute(s, 0);
 }
 
 SEXP_ID_t SEXP_ID_v2(const SEXP_t *s)
 {
-	__IDres_pair pair;
+        return SEXP_ID_compute(s, 1);
+}
 
-        pair.hash = 0xAD309171FFC0FFEE;
-	pair.part = 1;
+int SEXP_ID_track(SEXP_t *list)
+{
+        SEXP_val_t v_dsc;
 
-        SEXP_ID_v_callback(s, &pair);
+        if (list == NULL) {
+                errno = EFAULT;
+                return (-1);
+        }
 
-        return (pair.hash);
+        SEXP_val_dsc(&v_dsc, list->s_valp);
+
+        if (v_dsc.type != SEXP_VALTYPE_LIST) {
+                errno = EINVAL;
+                return (-1);
+        }
+
+        SEXP_LCASTP(v_dsc.mem)->id = SEXP_ID_list_acc(&v_dsc, 0);
+
+        return (0);
+}
+
+void SEXP_ID_list_append(SEXP_val_t *v_dsc, const SEXP_t *memb)
+{
+        if (SEXP_LCASTP(v_dsc->mem)->id != 0)
+                SEXP_LCASTP(v_dsc->mem)->id = SEXP_ID_combine(SEXP_LCASTP(v_dsc->mem)->id,
+                                                              SEXP_ID_compute(memb, 0));
 }
 
 /// @}
@@ -0,0 +1,512 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+
+#include "common/debug_priv.h"
+#include "public/sm_alloc.h"
+#include "public/sexp-manip.h"
+#include "_sexp-types.h"
+#include "_sexp-value.h"
+#include "_sexp-datatype.h"
+#include "_sexp-rawptr.h"
+#include "_sexp-binary.h"
+
+#define SEXP_BIN_FALSE    0x01
+#define SEXP_BIN_TRUE     0x02
+#define SEXP_BIN_UINT     0x03
+#define SEXP_BIN_NINT     0x04
+#define SEXP_BIN_DOUBLE   0x05
+#define SEXP_BIN_STRING   0x06
+#define SEXP_BIN_LIST     0x07
+#define SEXP_BIN_DATATYPE 0x08
+
+/*
+ * Encoder
+ */
+
+static int SEXP_binary_addvarint(strbuf_t *sb, uint64_t n)
+{
+        char buffer[10];
+        size_t i = 0;
+
+        while (n >= 0x80) {
+                buffer[i++] = (char)((n & 0x7f) | 0x80);
+                n >>= 7;
+        }
+
+        buffer[i++] = (char)n;
+
+        return strbuf_add(sb, buffer, i);
+}
+
+static int SEXP_binary_addtag(strbuf_t *sb, uint8_t tag, uint64_t n)
+{
+        if (strbuf_addc(sb, (char)tag) != 0)
+                return (-1);
+
+        return SEXP_binary_addvarint(sb, n);
+}
+
+static int SEXP_binary_addint(strbuf_t *sb, int64_t n)
+{
+        if (n < 0)
+                return SEXP_binary_addtag(sb, SEXP_BIN_NINT, (uint64_t)(-(n + 1)));
+        else
+                return SEXP_binary_addtag(sb, SEXP_BIN_UINT, (uint64_t)n);
+}
+
+static int SEXP_binary_addnum(strbuf_t *sb, SEXP_val_t *v_dsc)
+{
+        switch (SEXP_NTYPEP(v_dsc->hdr->size, v_dsc->mem)) {
+        case SEXP_NUM_BOOL:
+                return strbuf_addc(sb, SEXP_NCASTP(b, v_dsc->mem)->n ?
+                                   SEXP_BIN_TRUE : SEXP_BIN_FALSE);
+        case SEXP_NUM_INT8:
+                return SEXP_binary_addint(sb, SEXP_NCASTP(i8, v_dsc->mem)->n);
+        case SEXP_NUM_UINT8:
+                return SEXP_binary_addtag(sb, SEXP_BIN_UINT, SEXP_NCASTP(u8, v_dsc->mem)->n);
+        case SEXP_NUM_INT16:
+                return SEXP_binary_addint(sb, SEXP_NCASTP(i16, v_dsc->mem)->n);
+        case SEXP_NUM_UINT16:
+                return SEXP_binary_addtag(sb, SEXP_BIN_UINT, SEXP_NCASTP(u16, v_dsc->mem)->n);
+        case SEXP_NUM_INT32:
+                return SEXP_binary_addint(sb, SEXP_NCASTP(i32, v_dsc->mem)->n);
+        case SEXP_NUM_UINT32:
+                return SEXP_binary_addtag(sb, SEXP_BIN_UINT, SEXP_NCASTP(u32, v_dsc->mem)->n);
+        case SEXP_NUM_INT64:
+                return SEXP_binary_addint(sb, SEXP_NCASTP(i64, v_dsc->mem)->n);
+        case SEXP_NUM_UINT64:
+                return SEXP_binary_addtag(sb, SEXP_BIN_UINT, SEXP_NCASTP(u64, v_dsc->mem)->n);
+        case SEXP_NUM_DOUBLE:
+        {
+                double   f = SEXP_NCASTP(f, v_dsc->mem)->n;
+                uint64_t u;
+                char     buffer[1 + sizeof u];
+                int      i;
+
+                memcpy(&u, &f, sizeof u);
+                buffer[0] = SEXP_BIN_DOUBLE;
+
+                for (i = sizeof u; i > 0; --i) {
+                        buffer[i] = (char)(u & 0xff);
+                        u >>= 8;
+                }
+
+                return strbuf_add(sb, buffer, sizeof buffer);
+        }
+        }
+
+        errno = EINVAL;
+        return (-1);
+}
+
+static int SEXP_binary_add(SEXP_t *s_exp, void *arg)
+{
+        strbuf_t  *sb = (strbuf_t *)arg;
+        SEXP_val_t v_dsc;
+
+        if (SEXP_rawptr_mask(s_exp->s_type, SEXP_DATATYPEPTR_MASK) != NULL) {
+                const char *name = SEXP_datatype_name(s_exp->s_type);
+                size_t      len  = strlen(name);
+
+                if (SEXP_binary_addtag(sb, SEXP_BIN_DATATYPE, len) != 0 ||
+                    strbuf_add(sb, name, len) != 0)
+                        return (-1);
+        }
+
+        SEXP_val_dsc(&v_dsc, s_exp->s_valp);
+
+        switch (v_dsc.type) {
+        case SEXP_VALTYPE_NUMBER:
+                return SEXP_binary_addnum(sb, &v_dsc);
+        case SEXP_VALTYPE_STRING:
+                if (SEXP_binary_addtag(sb, SEXP_BIN_STRING, v_dsc.hdr->size) != 0)
+                        return (-1);
+
+                return strbuf_add(sb, (const char *)v_dsc.mem, v_dsc.hdr->size);
+        case SEXP_VALTYPE_LIST:
+                if (SEXP_binary_addtag(sb, SEXP_BIN_LIST,
+                                       SEXP_rawval_list_length(SEXP_LCASTP(v_dsc.mem))) != 0)
+                        return (-1);
+
+                return SEXP_rawval_lblk_cb((uintptr_t)SEXP_LCASTP(v_dsc.mem)->b_addr,
+                                           &SEXP_binary_add, sb,
+                                           SEXP_LCASTP(v_dsc.mem)->offset + 1);
+        }
+
+        errno = EINVAL;
+        return (-1);
+}
+
+/* overwrite `len' bytes at offset `off' of `sb' */
+static void SEXP_binary_sbpatch(strbuf_t *sb, size_t off, const char *data, size_t len)
+{
+        struct strblk *blk = sb->beg;
+
+        while (off >= blk->size) {
+                off -= blk->size;
+                blk  = blk->next;
+        }
+
+        while (len > 0) {
+                size_t n = blk->size - off;
+
+                if (n > len)
+                        n = len;
+
+                memcpy(blk->data + off, data, n);
+
+                data += n;
+                len  -= n;
+                off   = 0;
+                blk   = blk->next;
+        }
+}
+
+int SEXP_sbprintf_b(SEXP_t *s_exp, strbuf_t *sb)
+{
+        char   hdr[SEXP_BINARY_HDRSZ];
+        size_t off, len;
+
+        off = strbuf_size(sb);
+        memset(hdr, 0, sizeof hdr);
+
+        if (strbuf_add(sb, hdr, sizeof hdr) != 0)
+                return (-1);
+        if (SEXP_binary_add(s_exp, sb) != 0)
+                return (-1);
+
+        len = strbuf_size(sb) - off - SEXP_BINARY_HDRSZ;
+
+        if (len > UINT32_MAX) {
+                errno = EFBIG;
+                return (-1);
+        }
+
+        hdr[0] = (char)SEXP_BINARY_MAGIC;
+        hdr[1] = (char)((len >> 24) & 0xff);
+        hdr[2] = (char)((len >> 16) & 0xff);
+        hdr[3] = (char)((len >>  8) & 0xff);
+        hdr[4] = (char)( len        & 0xff);
+
+        SEXP_binary_sbpatch(sb, off, hdr, sizeof hdr);
+
+        return (0);
+}
+
+/*
+ * Decoder
+ */
+
+/* make n bytes available at dec->cur */
+static int SEXP_binary_need(SEXP_bdec_t *dec, size_t n)
+{
+        if ((size_t)(dec->end - dec->cur) >= n)
+                return (0);
+        if (dec->fill == NULL || n > (size_t)(dec->end - dec->cur) + dec->left)
+                return (-1);
+
+        return dec->fill(dec, n);
+}
+
+/* the number of payload bytes not decoded yet */
+static size_t SEXP_binary_avail(SEXP_bdec_t *dec)
+{
+        return (size_t)(dec->end - dec->cur) + dec->left;
+}
+
+static int SEXP_binary_getvarint(SEXP_bdec_t *dec, uint64_t *n)
+{
+        uint64_t v = 0;
+        unsigned int shift;
+
+        for (shift = 0; shift < 64; shift += 7) {
+                if (SEXP_binary_need(dec, 1) != 0)
+                        return (-1);
+
+                v |= (uint64_t)(*dec->cur & 0x7f) << shift;
+
+                if ((*dec->cur++ & 0x80) == 0) {
+                        *n = v;
+                        return (0);
+                }
+        }
+
+        return (-1);
+}
+
+static SEXP_t *SEXP_binary_uint(uint64_t n)
+{
+        if (n > UINT16_MAX) {
+                if (n > UINT32_MAX)
+                        return SEXP_number_newu_64(n);
+                else
+                        return SEXP_number_newu_32((uint32_t)n);
+        } else {
+                if (n > UINT8_MAX)
+                        return SEXP_number_newu_16((uint16_t)n);
+                else
+                        return SEXP_number_newu_8((uint8_t)n);
+        }
+}
+
+static SEXP_t *SEXP_binary_nint(uint64_t n)
+{
+        int64_t i;
+
+        if (n > INT64_MAX)
+                return (NULL);
+
+        i = -(int64_t)n - 1;
+
+        if (i < INT16_MIN) {
+                if (i < INT32_MIN)
+                        return SEXP_number_newi_64(i);
+                else
+                        return SEXP_number_newi_32((int32_t)i);
+        } else {
+                if (i < INT8_MIN)
+                        return SEXP_number_newi_16((int16_t)i);
+                else
+                        return SEXP_number_newi_8((int8_t)i);
+        }
+}
+
+/*
+ * The text format prints a double by %g and the parser reads it back as
+ * an integer when it has no fraction and no exponent. Decode to the same
+ * S-exp, so that the probes give the same items whatever the format.
+ */
+static SEXP_t *SEXP_binary_double(double f)
+{
+        char buffer[64];
+        int  len, neg;
+
+        len = snprintf(buffer, sizeof buffer, "%g", f);
+
+        if (len <= 0 || (size_t)len >= sizeof buffer)
+                return SEXP_number_newf(f);
+
+        neg = (buffer[0] == '-');
+
+        if (len > neg && strspn(buffer + neg, "0123456789") == (size_t)(len - neg)) {
+                if (neg) {
+                        int64_t i = strtoll(buffer, NULL, 10);
+
+                        return (i == 0 ? SEXP_number_newi_8(0) :
+                                SEXP_binary_nint((uint64_t)(-(i + 1))));
+                }
+
+                return SEXP_binary_uint(strtoull(buffer, NULL, 10));
+        }
+
+        /* inf and nan aren't valid in the text format, keep them */
+        if (!isfinite(f))
+                return SEXP_number_newf(f);
+
+        return SEXP_number_newf(strtod(buffer, NULL));
+}
+
+static SEXP_t *SEXP_binary_get(SEXP_bdec_t *dec, unsigned int depth)
+{
+        SEXP_t  *s_exp, *memb;
+        uint64_t n;
+        char    *name, name_static[128];
+
+        if (depth > SEXP_BINARY_MAXDEPTH || SEXP_binary_need(dec, 1) != 0)
+                return (NULL);
+
+        switch (*dec->cur++) {
+        case SEXP_BIN_FALSE:
+                return SEXP_number_newb(false);
+        case SEXP_BIN_TRUE:
+                return SEXP_number_newb(true);
+        case SEXP_BIN_UINT:
+                if (SEXP_binary_getvarint(dec, &n) != 0)
+                        return (NULL);
+
+                return SEXP_binary_uint(n);
+        case SEXP_BIN_NINT:
+                if (SEXP_binary_getvarint(dec, &n) != 0)
+                        return (NULL);
+
+                return SEXP_binary_nint(n);
+        case SEXP_BIN_DOUBLE:
+        {
+                double f;
+                int    i;
+
+                if (SEXP_binary_need(dec, sizeof n) != 0)
+                        return (NULL);
+
+                for (n = 0, i = 0; i < (int)sizeof n; ++i)
+                        n = (n << 8) | *dec->cur++;
+
+                memcpy(&f, &n, sizeof f);
+
+                return SEXP_binary_double(f);
+        }
+        case SEXP_BIN_STRING:
+                if (SEXP_binary_getvarint(dec, &n) != 0 ||
+                    n > (uint64_t)SEXP_binary_avail(dec) ||
+                    SEXP_binary_need(dec, (size_t)n) != 0)
+                        return (NULL);
+
+                s_exp = SEXP_string_new(dec->cur, (size_t)n);
+                dec->cur += n;
+
+                return (s_exp);
+        case SEXP_BIN_LIST:
+        {
+                uint32_t i;
+
+                /* every member takes at least one byte */
+                if (SEXP_binary_getvarint(dec, &n) != 0 ||
+                    n > (uint64_t)SEXP_binary_avail(dec) || n > UINT32_MAX)
+                        return (NULL);
+
+                s_exp = SEXP_list_new(NULL);
+
+                if (depth < SEXP_BINARY_EMITDEPTH - 1) {
+                        dec->list[depth]  = s_exp;
+                        dec->count[depth] = (uint32_t)n;
+                }
+
+                for (i = 1; i <= n; ++i) {
+                        if (depth < SEXP_BINARY_EMITDEPTH - 1)
+                                dec->index[depth] = i;
+
+                        memb = SEXP_binary_get(dec, depth + 1);
+
+                        if (memb == NULL) {
+                                SEXP_free(s_exp);
+                                return (NULL);
+                        }
+
+                        if (dec->emit != NULL && depth < SEXP_BINARY_EMITDEPTH - 1 &&
+                            dec->emit(dec, memb, depth + 1) == 1)
+                        {
+                                SEXP_free(memb);
+                                continue;
+                        }
+
+                        SEXP_list_add(s_exp, memb);
+                        SEXP_free(memb);
+                }
+
+                return (s_exp);
+        }
+        case SEXP_BIN_DATATYPE:
+                if (SEXP_binary_getvarint(dec, &n) != 0 ||
+                    n > (uint64_t)SEXP_binary_avail(dec) ||
+                    SEXP_binary_need(dec, (size_t)n) != 0)
+                        return (NULL);
+
+                if (n < sizeof name_static)
+                        name = name_static;
+                else
+                        name = sm_alloc(sizeof(char) * (n + 1));
+
+                memcpy(name, dec->cur, n);
+                name[n] = '\0';
+                dec->cur += n;
+
+                s_exp = SEXP_binary_get(dec, depth + 1);
+
+                if (s_exp != NULL && SEXP_datatype_set(s_exp, name) != 0) {
+                        SEXP_free(s_exp);
+                        s_exp = NULL;
+                }
+
+                if (name != name_static)
+                        sm_free(name);
+
+                return (s_exp);
+        }
+
+        return (NULL);
+}
+
+ssize_t SEXP_binary_framelen(const void *buf, size_t len)
+{
+        const uint8_t *hdr = (const uint8_t *)buf;
+
+        if (len < 1)
+                return (0);
+        if (hdr[0] != SEXP_BINARY_MAGIC)
+                return (-1);
+        if (len < SEXP_BINARY_HDRSZ)
+                return (0);
+
+        return (ssize_t)(SEXP_BINARY_HDRSZ +
+                         (((size_t)hdr[1] << 24) |
+                          ((size_t)hdr[2] << 16) |
+                          ((size_t)hdr[3] <<  8) |
+                          ((size_t)hdr[4])));
+}
+
+SEXP_t *SEXP_binary_decode(SEXP_bdec_t *dec)
+{
+        SEXP_t *s_exp;
+
+        s_exp = SEXP_binary_get(dec, 0);
+
+        if (s_exp == NULL || dec->cur != dec->end || dec->left != 0) {
+                SEXP_free(s_exp);
+                errno = EILSEQ;
+                return (NULL);
+        }
+
+        return (s_exp);
+}
+
+SEXP_t *SEXP_parse_binary(const void *buf, size_t len)
+{
+        SEXP_bdec_t dec;
+        SEXP_t     *s_exp;
+
+        if (len < SEXP_BINARY_HDRSZ || SEXP_binary_framelen(buf, len) != (ssize_t)len) {
+                errno = EILSEQ;
+                return (NULL);
+        }
+
+        memset(&dec, 0, sizeof dec);
+        dec.cur = (const uint8_t *)buf + SEXP_BINARY_HDRSZ;
+        dec.end = (const uint8_t *)buf + len;
+
+        s_exp = SEXP_binary_decode(&dec);
+
+        if (s_exp == NULL) {
+                dI("Invalid binary S-exp frame: length=%zu, offset=%zu",
+                   len, (size_t)(dec.cur - (const uint8_t *)buf));
+                errno = EILSEQ;
+                return (NULL);
+        }
+
+        return (s_exp);
+}
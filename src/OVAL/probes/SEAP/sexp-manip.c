@@ -46,6 +46,7 @@
 #include "_sexp-value.h"
 #include "_sexp-manip.h"
 #include "_sexp-rawptr.h"
+#include "_sexp-ID.h"
 #include "public/sexp-manip.h"
 #include "public/sexp-manip_r.h"
 
@@ -105,16 +106,12 @@ SEXP_t *SEXP_number_newi_8  (int8_t n)
         SEXP_t    *s_exp;
         SEXP_val_t v_dsc;
 
-        if (SEXP_val_new (&v_dsc, sizeof (SEXP_numtype_t) + sizeof (int8_t),
-                          SEXP_VALTYPE_NUMBER) != 0)
+        if (SEXP_val_new_number (&v_dsc, SEXP_NUM_INT8, (int64_t)n) != 0)
         {
                 /* TODO: handle this */
                 return (NULL);
         }
 
-        SEXP_NCASTP(i8,v_dsc.mem)->t = SEXP_NUM_INT8;
-        SEXP_NCASTP(i8,v_dsc.mem)->n = n;
-
         s_exp = SEXP_new ();
         s_exp->s_type = NULL;
         s_exp->s_valp = v_dsc.ptr;
@@ -127,16 +124,12 @@ SEXP_t *SEXP_number_newu_8  (uint8_t n)
         SEXP_t    *s_exp;
         SEXP_val_t v_dsc;
 
-        if (SEXP_val_new (&v_dsc, sizeof (SEXP_numtype_t) + sizeof (uint8_t),
-                          SEXP_VALTYPE_NUMBER) != 0)
+        if (SEXP_val_new_number (&v_dsc, SEXP_NUM_UINT8, (int64_t)n) != 0)
         {
                 /* TODO: handle this */
                 return (NULL);
         }
 
-        SEXP_NCASTP(u8,v_dsc.mem)->t = SEXP_NUM_UINT8;
-        SEXP_NCASTP(u8,v_dsc.mem)->n = n;
-
         s_exp = SEXP_new ();
         s_exp->s_type = NULL;
         s_exp->s_valp = v_dsc.ptr;
@@ -181,16 +174,12 @@ SEXP_t *SEXP_number_newi_16 (int16_t n)
         SEXP_t    *s_exp;
         SEXP_val_t v_dsc;
 
-        if (SEXP_val_new (&v_dsc, sizeof (SEXP_numtype_t) + sizeof (int16_t),
-                          SEXP_VALTYPE_NUMBER) != 0)
+        if (SEXP_val_new_number (&v_dsc, SEXP_NUM_INT16, (int64_t)n) != 0)
         {
                 /* TODO: handle this */
                 return (NULL);
         }
 
-        SEXP_NCASTP(i16,v_dsc.mem)->t = SEXP_NUM_INT16;
-        SEXP_NCASTP(i16,v_dsc.mem)->n = n;
-
         s_exp = SEXP_new ();
         s_exp->s_type = NULL;
         s_exp->s_valp = v_dsc.ptr;
@@ -203,16 +192,12 @@ SEXP_t *SEXP_number_newu_16 (uint16_t n)
         SEXP_t    *s_exp;
         SEXP_val_t v_dsc;
 
-        if (SEXP_val_new (&v_dsc, sizeof (SEXP_numtype_t) + sizeof (uint16_t),
-                          SEXP_VALTYPE_NUMBER) != 0)
+        if (SEXP_val_new_number (&v_dsc, SEXP_NUM_UINT16, (int64_t)n) != 0)
         {
                 /* TODO: handle this */
                 return (NULL);
         }
 
-        SEXP_NCASTP(u16,v_dsc.mem)->t = SEXP_NUM_UINT16;
-        SEXP_NCASTP(u16,v_dsc.mem)->n = n;
-
         s_exp = SEXP_new ();
         s_exp->s_type = NULL;
         s_exp->s_valp = v_dsc.ptr;
@@ -358,16 +343,12 @@ SEXP_t *SEXP_number_newi_64 (int64_t n)
         SEXP_t    *s_exp;
         SEXP_val_t v_dsc;
 
-        if (SEXP_val_new (&v_dsc, sizeof (SEXP_numtype_t) + sizeof (int64_t),
-                          SEXP_VALTYPE_NUMBER) != 0)
+        if (SEXP_val_new_number (&v_dsc, SEXP_NUM_INT64, (int64_t)n) != 0)
         {
                 /* TODO: handle this */
                 return (NULL);
         }
 
-        SEXP_NCASTP(i64,v_dsc.mem)->t = SEXP_NUM_INT64;
-        SEXP_NCASTP(i64,v_dsc.mem)->n = n;
-
         s_exp = SEXP_new ();
         s_exp->s_type = NULL;
         s_exp->s_valp = v_dsc.ptr;
@@ -622,6 +603,49 @@ SEXP_t *SEXP_string_newf (const char *format, ...)
         return (sexp);
 }
 
+SEXP_t *SEXP_string_new_sub (const SEXP_t *parent, size_t beg, size_t len)
+{
+        SEXP_val_t p_dsc, v_dsc;
+        uintptr_t  owner;
+        SEXP_t    *sexp;
+
+        if (parent == NULL) {
+                errno = EFAULT;
+                return (NULL);
+        }
+
+        SEXP_VALIDATE(parent);
+        SEXP_val_dsc (&p_dsc, parent->s_valp);
+
+        if (p_dsc.type != SEXP_VALTYPE_STRING) {
+                errno = EINVAL;
+                return (NULL);
+        }
+
+        if (beg > p_dsc.hdr->size || len > p_dsc.hdr->size - beg) {
+                errno = ERANGE;
+                return (NULL);
+        }
+
+        if (len <= sizeof (struct SEXP_val_borrowed))
+                return SEXP_string_new ((uint8_t *)p_dsc.mem + beg, len);
+
+        /* borrow from the value which owns the bytes */
+        if (p_dsc.ptr & SEXP_VALF_BORROWED)
+                owner = ((struct SEXP_val_borrowed *)((uint8_t *)p_dsc.hdr + sizeof (SEXP_valhdr_t)))->owner;
+        else
+                owner = p_dsc.ptr;
+
+        if (SEXP_val_new_borrowed (&v_dsc, owner, (uint8_t *)p_dsc.mem + beg, len) != 0)
+                return (NULL);
+
+        sexp = SEXP_new ();
+        sexp->s_type = NULL;
+        sexp->s_valp = v_dsc.ptr;
+
+        return (sexp);
+}
+
 void SEXP_string_free (SEXP_t *s_exp)
 {
         SEXP_VALIDATE(s_exp);
@@ -842,11 +866,10 @@ char *SEXP_string_subcstr (const SEXP_t *s_exp, size_t beg, size_t len)
 
         s_len -= beg;
 
-        if (s_len > len)
+        if (len > 0 && s_len > len)
                 s_len = len;
 
         if (s_len > 0) {
-                s_len = v_dsc.hdr->size / sizeof (char);
                 s_str = sm_alloc (sizeof (char) * (s_len + 1));
 
                 memcpy (s_str, ((char *) v_dsc.mem) + beg, sizeof (char) * s_len);
@@ -873,8 +896,8 @@ char *SEXP_string_cstrp (const SEXP_t *s_exp)
 
 int SEXP_string_cmp (const SEXP_t *str_a, const SEXP_t *str_b)
 {
-        char *a, *b;
-        int   c;
+        SEXP_val_t a_dsc, b_dsc;
+        int        c;
 
         if (str_a == NULL || str_b == NULL) {
                 errno = EFAULT;
@@ -884,15 +907,25 @@ int SEXP_string_cmp (const SEXP_t *str_a, const SEXP_t *str_b)
         SEXP_VALIDATE(str_a);
         SEXP_VALIDATE(str_b);
 
-        a = SEXP_string_cstr (str_a);
-        b = SEXP_string_cstr (str_b);
+        /* shared (e.g. interned) strings */
+        if (str_a->s_valp == str_b->s_valp)
+                return (0);
+
+        SEXP_val_dsc (&a_dsc, str_a->s_valp);
+        SEXP_val_dsc (&b_dsc, str_b->s_valp);
+
+        if (a_dsc.type != SEXP_VALTYPE_STRING || b_dsc.type != SEXP_VALTYPE_STRING) {
+                errno = EINVAL;
+                return (-1);
+        }
 
-        c = strcmp (a, b);
+        c = memcmp (a_dsc.mem, b_dsc.mem,
+                    a_dsc.hdr->size < b_dsc.hdr->size ? a_dsc.hdr->size : b_dsc.hdr->size);
 
-        sm_free (a);
-        sm_free (b);
+        if (c != 0)
+                return (c);
 
-        return (c);
+        return ((a_dsc.hdr->size > b_dsc.hdr->size) - (a_dsc.hdr->size < b_dsc.hdr->size));
 }
 
 bool SEXP_string_getb (const SEXP_t *s_exp)
@@ -1027,6 +1060,9 @@ SEXP_t *SEXP_listref_first (SEXP_t *list)
         s_exp = SEXP_rawval_lblk_nth ((uintptr_t)SEXP_LCASTP(v_dsc.mem)->b_addr,
                                       SEXP_LCASTP(v_dsc.mem)->offset + 1);
 
+        /* the member may be modified using the reference */
+        SEXP_LCASTP(v_dsc.mem)->id = 0;
+
         return (s_exp == NULL ? NULL : SEXP_softref (s_exp));
 }
 
@@ -1106,6 +1142,7 @@ SEXP_t *SEXP_list_replace (SEXP_t *list, uint32_t n, const SEXP_t *n_val)
 
         _A(n > 0);
 
+        SEXP_LCASTP(v_dsc.mem)->id     = 0;
         SEXP_LCASTP(v_dsc.mem)->b_addr = (void *) SEXP_rawval_lblk_replace ((uintptr_t)SEXP_LCASTP(v_dsc.mem)->b_addr,
                                                                             SEXP_LCASTP(v_dsc.mem)->offset + n,
                                                                             n_val, &o_val);
@@ -1175,6 +1212,9 @@ SEXP_t *SEXP_listref_nth (SEXP_t *list, uint32_t n)
         if (s_exp != NULL)
                 SEXP_VALIDATE(s_exp);
 #endif
+        /* the member may be modified using the reference */
+        SEXP_LCASTP(v_dsc.mem)->id = 0;
+
         return (s_exp == NULL ? NULL : SEXP_softref (s_exp));
 }
 
@@ -1227,6 +1267,10 @@ SEXP_t *SEXP_list_add (SEXP_t *list, const SEXP_t *s_exp)
                 SEXP_LCASTP(v_dsc.mem)->b_addr = (void *)SEXP_rawval_lblk_add ((uintptr_t)SEXP_LCASTP(v_dsc.mem)->b_addr, s_exp);
         }
 
+        ++SEXP_LCASTP(v_dsc.mem)->length;
+
+        SEXP_ID_list_append (&v_dsc, s_exp);
+
         return (list);
 }
 
@@ -1291,14 +1335,17 @@ SEXP_t *SEXP_list_pop (SEXP_t *list)
         }
 
         lblk = SEXP_VALP_LBLK(SEXP_LCASTP(v_dsc.mem)->b_addr);
+        SEXP_LCASTP(v_dsc.mem)->id = 0;
 
         if (lblk != NULL) {
+                --SEXP_LCASTP(v_dsc.mem)->length;
+
+                /* the block is released once all of its members were popped */
                 if (++SEXP_LCASTP(v_dsc.mem)->offset == lblk->real) {
                         SEXP_LCASTP(v_dsc.mem)->offset = 0;
                         SEXP_LCASTP(v_dsc.mem)->b_addr = SEXP_VALP_LBLK(lblk->nxsz);
+                        SEXP_rawval_lblk_free1 ((uintptr_t)lblk, SEXP_free_lmemb);
                 }
-
-                SEXP_rawval_lblk_free1 ((uintptr_t)lblk, SEXP_free_lmemb);
         }
 
 #if !defined(NDEBUG)
@@ -1389,6 +1436,7 @@ SEXP_t *SEXP_list_sort(SEXP_t *list, int(*compare)(const SEXP_t *, const SEXP_t
          * TODO: check reference counts and make copies of list
          * blocks if needed
          */
+        SEXP_LCASTP(v_dsc.mem)->id = 0;
 
         /*
          * PASS #1: Sort each block and build the iterator array
@@ -1638,16 +1686,16 @@ SEXP_t *SEXP_unref (SEXP_t *s_exp_o)
 
                         switch (v_dsc.type) {
                         case SEXP_VALTYPE_STRING:
-                                sm_free (v_dsc.hdr);
+                                SEXP_val_free (&v_dsc);
                                 break;
                         case SEXP_VALTYPE_NUMBER:
-                                sm_free (v_dsc.hdr);
+                                SEXP_val_free (&v_dsc);
                                 break;
                         case SEXP_VALTYPE_LIST:
                                 if (SEXP_LCASTP(v_dsc.mem)->b_addr != NULL)
                                         SEXP_rawval_lblk_free ((uintptr_t)SEXP_LCASTP(v_dsc.mem)->b_addr, SEXP_free_lmemb);
 
-                                sm_free (v_dsc.hdr);
+                                SEXP_val_free (&v_dsc);
                                 break;
                         default:
                                 abort ();
@@ -1743,12 +1791,26 @@ int SEXP_refcmp(const SEXP_t *a, const SEXP_t *b)
         return (0);
 }
 
+size_t SEXP_refhash(const SEXP_t *s_exp)
+{
+        uint64_t h = (uint64_t)s_exp->s_valp;
+
+        /* the low bits are zero because of the alignment, mix them with the rest */
+        h ^= h >> 33;
+        h *= UINT64_C(0xff51afd7ed558ccd);
+        h ^= h >> 33;
+
+        return ((size_t)h);
+}
+
 bool SEXP_deepcmp(const SEXP_t *a, const SEXP_t *b)
 {
         SEXP_valtype_t type;
 
         if (a == NULL || b == NULL)
                 return (a == b);
+        if (a->s_valp == b->s_valp)
+                return (true);
         if ((type = SEXP_typeof(a)) != SEXP_typeof(b))
                 return (false);
         if (!SEXP_listp(a)) {
@@ -1833,16 +1895,16 @@ static void SEXP_free_lmemb (SEXP_t *s_exp)
                 if (SEXP_rawval_decref (s_exp->s_valp)) {
                         switch (v_dsc.type) {
                         case SEXP_VALTYPE_STRING:
-                                sm_free (v_dsc.hdr);
+                                SEXP_val_free (&v_dsc);
                                 break;
                         case SEXP_VALTYPE_NUMBER:
-                                sm_free (v_dsc.hdr);
+                                SEXP_val_free (&v_dsc);
                                 break;
                         case SEXP_VALTYPE_LIST:
                                 if (SEXP_LCASTP(v_dsc.mem)->b_addr != NULL)
                                         SEXP_rawval_lblk_free ((uintptr_t)SEXP_LCASTP(v_dsc.mem)->b_addr, SEXP_free_lmemb);
 
-                                sm_free (v_dsc.hdr);
+                                SEXP_val_free (&v_dsc);
                                 break;
                         default:
                                 abort ();
@@ -2038,6 +2100,9 @@ static int __SEXP_sizeof_lmemb (const SEXP_t *s_exp, size_t *sz)
                 ret = SEXP_rawval_lblk_cb ((uintptr_t)SEXP_LCASTP(v_dsc.mem)->b_addr, (int(*)(SEXP_t *, void *))__SEXP_sizeof_lmemb, sz, 1);
         }
         case SEXP_VALTYPE_NUMBER:
+                if (SEXP_VALP_IMMEDIATE(v_dsc.ptr))
+                        break;
+                /* FALLTHROUGH */
         case SEXP_VALTYPE_STRING:
                 (*sz) += sizeof (SEXP_valhdr_t) + v_dsc.hdr->size;
                 break;
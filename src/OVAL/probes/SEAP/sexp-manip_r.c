@@ -57,16 +57,12 @@ SEXP_t *SEXP_number_newi_32_r(SEXP_t *sexp_mem, int32_t n)
                 return (NULL);
         }
 
-        if (SEXP_val_new (&v_dsc, sizeof (SEXP_numtype_t) + sizeof (int32_t),
-                          SEXP_VALTYPE_NUMBER) != 0)
+        if (SEXP_val_new_number (&v_dsc, SEXP_NUM_INT32, (int64_t)n) != 0)
         {
                 /* TODO: handle this */
                 return (NULL);
         }
 
-        SEXP_NCASTP(i32,v_dsc.mem)->t = SEXP_NUM_INT32;
-        SEXP_NCASTP(i32,v_dsc.mem)->n = n;
-
         SEXP_init(sexp_mem);
         sexp_mem->s_type = NULL;
         sexp_mem->s_valp = v_dsc.ptr;
@@ -83,16 +79,12 @@ SEXP_t *SEXP_number_newu_32_r(SEXP_t *sexp_mem, uint32_t n)
                 return (NULL);
         }
 
-        if (SEXP_val_new (&v_dsc, sizeof (SEXP_numtype_t) + sizeof (uint32_t),
-                          SEXP_VALTYPE_NUMBER) != 0)
+        if (SEXP_val_new_number (&v_dsc, SEXP_NUM_UINT32, (int64_t)n) != 0)
         {
                 /* TODO: handle this */
                 return (NULL);
         }
 
-        SEXP_NCASTP(u32,v_dsc.mem)->t = SEXP_NUM_UINT32;
-        SEXP_NCASTP(u32,v_dsc.mem)->n = n;
-
         SEXP_init(sexp_mem);
         sexp_mem->s_type = NULL;
         sexp_mem->s_valp = v_dsc.ptr;
@@ -109,16 +101,12 @@ SEXP_t *SEXP_number_newu_64_r(SEXP_t *sexp_mem, uint64_t n)
                 return (NULL);
         }
 
-        if (SEXP_val_new (&v_dsc, sizeof (SEXP_numtype_t) + sizeof (uint64_t),
-                          SEXP_VALTYPE_NUMBER) != 0)
+        if (SEXP_val_new_number (&v_dsc, SEXP_NUM_UINT64, (int64_t)n) != 0)
         {
                 /* TODO: handle this */
                 return (NULL);
         }
 
-        SEXP_NCASTP(u64,v_dsc.mem)->t = SEXP_NUM_UINT64;
-        SEXP_NCASTP(u64,v_dsc.mem)->n = n;
-
         SEXP_init(sexp_mem);
         sexp_mem->s_type = NULL;
         sexp_mem->s_valp = v_dsc.ptr;
@@ -135,16 +123,12 @@ SEXP_t *SEXP_number_newi_64_r(SEXP_t *sexp_mem, int64_t n)
                 return (NULL);
         }
 
-        if (SEXP_val_new (&v_dsc, sizeof (SEXP_numtype_t) + sizeof (int64_t),
-                          SEXP_VALTYPE_NUMBER) != 0)
+        if (SEXP_val_new_number (&v_dsc, SEXP_NUM_INT64, (int64_t)n) != 0)
         {
                 /* TODO: handle this */
                 return (NULL);
         }
 
-        SEXP_NCASTP(i64,v_dsc.mem)->t = SEXP_NUM_INT64;
-        SEXP_NCASTP(i64,v_dsc.mem)->n = n;
-
         SEXP_init(sexp_mem);
         sexp_mem->s_type = NULL;
         sexp_mem->s_valp = v_dsc.ptr;
@@ -187,16 +171,12 @@ SEXP_t *SEXP_number_newb_r(SEXP_t *sexp_mem, bool n)
                 return (NULL);
         }
 
-        if (SEXP_val_new (&v_dsc, sizeof (SEXP_numtype_t) + sizeof (bool),
-                          SEXP_VALTYPE_NUMBER) != 0)
+        if (SEXP_val_new_number (&v_dsc, SEXP_NUM_BOOL, (int64_t)n) != 0)
         {
                 /* TODO: handle this */
                 return (NULL);
         }
 
-        SEXP_NCASTP(b,v_dsc.mem)->t = SEXP_NUM_BOOL;
-        SEXP_NCASTP(b,v_dsc.mem)->n = n;
-
         SEXP_init(sexp_mem);
         sexp_mem->s_type = NULL;
         sexp_mem->s_valp = v_dsc.ptr;
@@ -293,13 +273,16 @@ SEXP_t *SEXP_list_new_rv (SEXP_t *sexp_mem, SEXP_t *memb, va_list alist)
                 s_ptr[++s_cur] = va_arg (alist, SEXP_t *);
         }
 
-        if (SEXP_val_new (&v_dsc, sizeof (void *) + sizeof (uint16_t),
+        if (SEXP_val_new (&v_dsc, sizeof (struct SEXP_val_list),
                           SEXP_VALTYPE_LIST) != 0)
         {
                 /* TODO: handle this */
                 return (NULL);
         }
 
+        SEXP_LCASTP(v_dsc.mem)->id = 0;
+        SEXP_LCASTP(v_dsc.mem)->length = (uint32_t)s_cur;
+
         if (s_cur > 0) {
                 for (b_exp = 0; (size_t)(1 << b_exp) < s_cur; ++b_exp);
 
@@ -362,13 +345,17 @@ SEXP_t *SEXP_list_rest_r (SEXP_t *rest, const SEXP_t *list)
                 return (NULL);
         }
 
-        if (SEXP_val_new (&v_dsc_r, sizeof (void *) + sizeof (uint16_t),
+        if (SEXP_val_new (&v_dsc_r, sizeof (struct SEXP_val_list),
                           SEXP_VALTYPE_LIST) != 0)
         {
                 /* TODO: handle this */
                 return (NULL);
         }
 
+        SEXP_LCASTP(v_dsc_r.mem)->id = 0;
+        SEXP_LCASTP(v_dsc_r.mem)->length = SEXP_LCASTP(v_dsc_o.mem)->length > 0 ?
+                SEXP_LCASTP(v_dsc_o.mem)->length - 1 : 0;
+
         SEXP_LCASTP(v_dsc_r.mem)->offset = SEXP_LCASTP(v_dsc_o.mem)->offset + 1;
         SEXP_LCASTP(v_dsc_r.mem)->b_addr = SEXP_LCASTP(v_dsc_o.mem)->b_addr;
 
@@ -423,16 +410,16 @@ void __SEXP_free_r (SEXP_t *s_exp, const char *file, uint32_t line, const char *
                 if (SEXP_rawval_decref (s_exp->s_valp)) {
                         switch (v_dsc.type) {
                         case SEXP_VALTYPE_STRING:
-                                sm_free (v_dsc.hdr);
+                                SEXP_val_free (&v_dsc);
                                 break;
                         case SEXP_VALTYPE_NUMBER:
-                                sm_free (v_dsc.hdr);
+                                SEXP_val_free (&v_dsc);
                                 break;
                         case SEXP_VALTYPE_LIST:
                                 if (SEXP_LCASTP(v_dsc.mem)->b_addr != NULL)
                                         SEXP_rawval_lblk_free ((uintptr_t)SEXP_LCASTP(v_dsc.mem)->b_addr, SEXP_free_r);
 
-                                sm_free (v_dsc.hdr);
+                                SEXP_val_free (&v_dsc);
                                 break;
                         default:
                                 abort ();
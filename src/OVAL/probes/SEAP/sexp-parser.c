@@ -29,6 +29,11 @@
 #include <string.h>
 #include <ctype.h>
 #include <errno.h>
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#elif defined(__ARM_NEON)
+# include <arm_neon.h>
+#endif
 
 #include "common/assume.h"
 #include "generic/common.h"
@@ -119,7 +124,7 @@ void SEXP_pstate_free (SEXP_pstate_t *pstate)
                                 SEXP_val_t v_dsc;
 
                                 SEXP_val_dsc (&v_dsc, pstate->v_bool[i]);
-                                sm_free (v_dsc.hdr);
+                                SEXP_val_free (&v_dsc);
                         }
                 }
         }
@@ -237,6 +242,105 @@ static inline bool isnextexp (int c)
         return (false);
 }
 
+/*
+ * Vector scans of the atoms. The string atoms are mostly paths, the octets
+ * which end them are looked for 16 at a time in the part of the atom that
+ * is in one buffer of the sparse buffer; the tail of the buffer and the
+ * following buffers are left to the octet by octet loops. The vector
+ * instructions are the ones every target of the architecture has, so no
+ * runtime detection is needed.
+ */
+#if defined(__SSE2__)
+# define SEXP_VSCAN 1
+typedef __m128i SEXP_vec_t;
+
+# define SEXP_vload(p)   _mm_loadu_si128 ((const __m128i *)(p))
+# define SEXP_veq(v, c)  _mm_cmpeq_epi8 ((v), _mm_set1_epi8 ((char)(c)))
+# define SEXP_vor(a, b)  _mm_or_si128 ((a), (b))
+
+/* index of the first matching octet, 16 if there's none */
+static inline size_t SEXP_vfirst (SEXP_vec_t m)
+{
+        int b = _mm_movemask_epi8 (m);
+
+        return (b != 0 ? (size_t)__builtin_ctz (b) : 16);
+}
+#elif defined(__ARM_NEON)
+# define SEXP_VSCAN 1
+typedef uint8x16_t SEXP_vec_t;
+
+# define SEXP_vload(p)   vld1q_u8 ((const uint8_t *)(p))
+# define SEXP_veq(v, c)  vceqq_u8 ((v), vdupq_n_u8 ((uint8_t)(c)))
+# define SEXP_vor(a, b)  vorrq_u8 ((a), (b))
+
+/* index of the first matching octet, 16 if there's none */
+static inline size_t SEXP_vfirst (SEXP_vec_t m)
+{
+        /* a nibble per octet */
+        uint64_t b = vget_lane_u64 (vreinterpret_u64_u8 (vshrn_n_u16 (vreinterpretq_u16_u8 (m), 4)), 0);
+
+        return (b != 0 ? (size_t)(__builtin_ctzll (b) >> 2) : 16);
+}
+#endif
+
+/*
+ * The number of octets at `p' before the first one for which isnextexp()
+ * is true, `len' if there's none.
+ */
+static size_t SEXP_span_atom (const uint8_t *p, size_t len)
+{
+        size_t i = 0;
+#if defined(SEXP_VSCAN)
+        static const uint8_t delim[] = {
+                '\n', '\t', '\r', '\a', ' ', '"', '#', '\'', '(', ')', '[', ']', '|', '{', '}'
+        };
+
+        for (; i + 16 <= len; i += 16) {
+                SEXP_vec_t v, m;
+                size_t     f, k;
+
+                v = SEXP_vload (p + i);
+                m = SEXP_veq (v, delim[0]);
+
+                for (k = 1; k < sizeof delim; ++k)
+                        m = SEXP_vor (m, SEXP_veq (v, delim[k]));
+
+                if ((f = SEXP_vfirst (m)) < 16)
+                        return (i + f);
+        }
+#endif
+        for (; i < len; ++i)
+                if (isnextexp (p[i]))
+                        break;
+
+        return (i);
+}
+
+/*
+ * The number of octets at `p' before the first backslash or double quote,
+ * `len' if there's none.
+ */
+static size_t SEXP_span_dq (const uint8_t *p, size_t len)
+{
+        size_t i = 0;
+#if defined(SEXP_VSCAN)
+        for (; i + 16 <= len; i += 16) {
+                SEXP_vec_t v;
+                size_t     f;
+
+                v = SEXP_vload (p + i);
+
+                if ((f = SEXP_vfirst (SEXP_vor (SEXP_veq (v, '\\'), SEXP_veq (v, '"')))) < 16)
+                        return (i + f);
+        }
+#endif
+        for (; i < len; ++i)
+                if (p[i] == '\\' || p[i] == '"')
+                        break;
+
+        return (i);
+}
+
 /**
  * The S-expression parser
  * @param psetup parser settings (this argument is ignored is *pstate != NULL)
@@ -387,6 +491,8 @@ SEXP_t *SEXP_parse (const SEXP_psetup_t *psetup, char *buffer, size_t buflen, SE
 #define SEXP_LABELNUM_CHAR        65
 #define SEXP_LABELNUM_CHAR_FIXED  129
 #define SEXP_LABELNUM_NUMBER      48
+#define SEXP_LABELNUM_DQUOTE      34
+#define SEXP_LABELNUM_SQUOTE      39
 #define SEXP_LABELNUM_DTYPE       91
 #define SEXP_LABELNUM_DTYPE_FIXED 130
 #define SEXP_LABELNUM_B64S        124
@@ -437,6 +543,9 @@ SEXP_t *SEXP_parse (const SEXP_psetup_t *psetup, char *buffer, size_t buflen, SE
         state->p_sexp  = NULL;
         e_dsc.sp_data  = state->sp_data;
         e_dsc.sp_free  = state->sp_free;
+        /* the subparser owns its data now, see the state update below */
+        state->sp_data = NULL;
+        state->sp_free = NULL;
 
         for(int i = 0; i < SEXP_PFUNC_COUNT; ++i) {
                 e_dsc.sp_shptr[i]  = state->sp_shptr[i];
@@ -528,10 +637,14 @@ SEXP_t *SEXP_parse (const SEXP_psetup_t *psetup, char *buffer, size_t buflen, SE
                 }
                 /* NOTREACHED */
         L_DQUOTE:
+                e_dsc.p_label = SEXP_LABELNUM_DQUOTE;
+
                 if ((ret_p = psetup->p_funcp[SEXP_PFUNC_UL_STRING_DQ](&e_dsc)) != SEXP_PRET_SUCCESS)
                         break;
                 goto L_SEXP_ADD;
         L_SQUOTE:
+                e_dsc.p_label = SEXP_LABELNUM_SQUOTE;
+
                 if ((ret_p = psetup->p_funcp[SEXP_PFUNC_UL_STRING_SQ](&e_dsc)) != SEXP_PRET_SUCCESS)
                         break;
                 goto L_SEXP_ADD;
@@ -845,6 +958,7 @@ SEXP_t *SEXP_parse (const SEXP_psetup_t *psetup, char *buffer, size_t buflen, SE
 
                 if (e_dsc.p_explen > 0) {
                         SEXP_val_t v_dsc;
+                        SEXP_numtype_t t;
 
                         switch (e_dsc.p_numclass) {
                         case SEXP_NUMCLASS_INT: {
@@ -860,50 +974,18 @@ SEXP_t *SEXP_parse (const SEXP_psetup_t *psetup, char *buffer, size_t buflen, SE
                                         goto L_NUMBER_invalid;
                                 }
 
-                                if (number < INT16_MIN) {
-                                        if (number < INT32_MIN) {
-                                                /* 64 */
-                                                if (SEXP_val_new (&v_dsc, sizeof (struct SEXP_val_num_i64),
-                                                                  SEXP_VALTYPE_NUMBER) != 0)
-                                                {
-                                                        /* TODO: handle this */
-                                                        abort ();
-                                                }
-                                                SEXP_NCASTP(i64,v_dsc.mem)->n = (int64_t)number;
-                                                SEXP_NCASTP(i64,v_dsc.mem)->t = SEXP_NUM_INT64;
-                                        } else {
-                                                /* 32 */
-                                                if (SEXP_val_new (&v_dsc, sizeof (struct SEXP_val_num_i32),
-                                                                  SEXP_VALTYPE_NUMBER) != 0)
-                                                {
-                                                        /* TODO: handle this */
-                                                        abort ();
-                                                }
-                                                SEXP_NCASTP(i32,v_dsc.mem)->n = (int32_t)number;
-                                                SEXP_NCASTP(i32,v_dsc.mem)->t = SEXP_NUM_INT32;
-                                        }
-                                } else {
-                                        if (number < INT8_MIN) {
-                                                /* 16 */
-                                                if (SEXP_val_new (&v_dsc, sizeof (struct SEXP_val_num_i16),
-                                                                  SEXP_VALTYPE_NUMBER) != 0)
-                                                {
-                                                        /* TODO: handle this */
-                                                        abort ();
-                                                }
-                                                SEXP_NCASTP(i16,v_dsc.mem)->n = (int16_t)number;
-                                                SEXP_NCASTP(i16,v_dsc.mem)->t = SEXP_NUM_INT16;
-                                        } else {
-                                                /* 8 */
-                                                if (SEXP_val_new (&v_dsc, sizeof (struct SEXP_val_num_i8),
-                                                                  SEXP_VALTYPE_NUMBER) != 0)
-                                                {
-                                                        /* TODO: handle this */
-                                                        abort ();
-                                                }
-                                                SEXP_NCASTP(i8,v_dsc.mem)->n = (int8_t)number;
-                                                SEXP_NCASTP(i8,v_dsc.mem)->t = SEXP_NUM_INT8;
-                                        }
+                                if (number < INT32_MIN)
+                                        t = SEXP_NUM_INT64;
+                                else if (number < INT16_MIN)
+                                        t = SEXP_NUM_INT32;
+                                else if (number < INT8_MIN)
+                                        t = SEXP_NUM_INT16;
+                                else
+                                        t = SEXP_NUM_INT8;
+
+                                if (SEXP_val_new_number (&v_dsc, t, number) != 0) {
+                                        /* TODO: handle this */
+                                        abort ();
                                 }
                         }       break;
                         case SEXP_NUMCLASS_UINT: {
@@ -919,50 +1001,18 @@ SEXP_t *SEXP_parse (const SEXP_psetup_t *psetup, char *buffer, size_t buflen, SE
                                         goto L_NUMBER_invalid;
                                 }
 
-                                if (number > UINT16_MAX) {
-                                        if (number > UINT32_MAX) {
-                                                /* 64 */
-                                                if (SEXP_val_new (&v_dsc, sizeof (struct SEXP_val_num_u64),
-                                                                  SEXP_VALTYPE_NUMBER) != 0)
-                                                {
-                                                        /* TODO: handle this */
-                                                        abort ();
-                                                }
-                                                SEXP_NCASTP(u64,v_dsc.mem)->n = (uint64_t)number;
-                                                SEXP_NCASTP(u64,v_dsc.mem)->t = SEXP_NUM_UINT64;
-                                        } else {
-                                                /* 32 */
-                                                if (SEXP_val_new (&v_dsc, sizeof (struct SEXP_val_num_u32),
-                                                                  SEXP_VALTYPE_NUMBER) != 0)
-                                                {
-                                                        /* TODO: handle this */
-                                                        abort ();
-                                                }
-                                                SEXP_NCASTP(u32,v_dsc.mem)->n = (uint32_t)number;
-                                                SEXP_NCASTP(u32,v_dsc.mem)->t = SEXP_NUM_UINT32;
-                                        }
-                                } else {
-                                        if (number > UINT8_MAX) {
-                                                /* 16 */
-                                                if (SEXP_val_new (&v_dsc, sizeof (struct SEXP_val_num_u16),
-                                                                  SEXP_VALTYPE_NUMBER) != 0)
-                                                {
-                                                        /* TODO: handle this */
-                                                        abort ();
-                                                }
-                                                SEXP_NCASTP(u16,v_dsc.mem)->n = (uint16_t)number;
-                                                SEXP_NCASTP(u16,v_dsc.mem)->t = SEXP_NUM_UINT16;
-                                        } else {
-                                                /* 8 */
-                                                if (SEXP_val_new (&v_dsc, sizeof (struct SEXP_val_num_u8),
-                                                                  SEXP_VALTYPE_NUMBER) != 0)
-                                                {
-                                                        /* TODO: handle this */
-                                                        abort ();
-                                                }
-                                                SEXP_NCASTP(u8,v_dsc.mem)->n = (uint8_t)number;
-                                                SEXP_NCASTP(u8,v_dsc.mem)->t = SEXP_NUM_UINT8;
-                                        }
+                                if (number > UINT32_MAX)
+                                        t = SEXP_NUM_UINT64;
+                                else if (number > UINT16_MAX)
+                                        t = SEXP_NUM_UINT32;
+                                else if (number > UINT8_MAX)
+                                        t = SEXP_NUM_UINT16;
+                                else
+                                        t = SEXP_NUM_UINT8;
+
+                                if (SEXP_val_new_number (&v_dsc, t, (int64_t)number) != 0) {
+                                        /* TODO: handle this */
+                                        abort ();
                                 }
                         }       break;
                         case SEXP_NUMCLASS_FLT:
@@ -1275,12 +1325,16 @@ SKIP_LOOP:
 
                 return (NULL);
         case SEXP_PRET_EINVAL:
+                state->sp_data = e_dsc.sp_data;
+                state->sp_free = e_dsc.sp_free;
 		state->p_error = SEXP_PRET_EINVAL;
                 /*
                  * The parser encoutered an invalid sequence of octets
                  */
                 return (NULL);
         case SEXP_PRET_EUNDEF:
+                state->sp_data = e_dsc.sp_data;
+                state->sp_free = e_dsc.sp_free;
 		state->p_error = SEXP_PRET_EUNDEF;
                 /*
                  * Undefined error (i.e. we don't know how to handle the error
@@ -1304,6 +1358,8 @@ __PARSE_RT SEXP_parse_ul_string_si (__PARSE_PT(dsc))
         spb_size_t itb;
         register spb_size_t cnt;
         register uint8_t    oct;
+        const uint8_t *run;
+        size_t run_len;
 
         assume_d (dsc != NULL, SEXP_PRET_EUNDEF);
         assume_d (dsc->p_buffer != NULL, SEXP_PRET_EUNDEF);
@@ -1321,6 +1377,17 @@ __PARSE_RT SEXP_parse_ul_string_si (__PARSE_PT(dsc))
                 cnt = 0;
         }
 
+        /* skip the part of the atom in the current buffer at once */
+        if ((run = spb_direct_run (dsc->p_buffer, itb, &run_len)) != NULL) {
+                size_t n = SEXP_span_atom (run, run_len);
+
+                itb += n;
+                cnt += n;
+
+                if (n < run_len)
+                        goto found;
+        }
+
         spb_iterate (dsc->p_buffer, itb, oct,
                      if (isnextexp (oct))
                              goto found;
@@ -1405,6 +1472,8 @@ __PARSE_RT SEXP_parse_ul_string_dq (__PARSE_PT(dsc))
 {
         spb_size_t itb;
         strbuf_t  *strbuf;
+        const uint8_t *run;
+        size_t run_len;
 
         register spb_size_t noesc_s, noesc_l;
         register bool       esc = false;
@@ -1444,7 +1513,11 @@ __PARSE_RT SEXP_parse_ul_string_dq (__PARSE_PT(dsc))
         noesc_s = 0;
         noesc_l = 0;
 
-        spb_iterate (dsc->p_buffer, itb, oct,
+        /* the octets up to the first escape or the closing quote are copied as they are */
+        if ((run = spb_direct_run (dsc->p_buffer, itb, &run_len)) != NULL)
+                noesc_l = SEXP_span_dq (run, run_len);
+
+        spb_iterate (dsc->p_buffer, itb + noesc_l, oct,
                      /* Use branch prediction? */
                      if (__predict(!esc, 1)) {
                              switch (oct) {
@@ -1570,6 +1643,8 @@ __PARSE_RT SEXP_parse_ul_string_sq (__PARSE_PT(dsc))
         spb_size_t itb;
         register spb_size_t cnt;
         register uint8_t    oct;
+        const uint8_t *run, *end;
+        size_t run_len;
 
         assume_d (dsc != NULL, SEXP_PRET_EUNDEF);
         assume_d (dsc->p_buffer != NULL, SEXP_PRET_EUNDEF);
@@ -1583,6 +1658,16 @@ __PARSE_RT SEXP_parse_ul_string_sq (__PARSE_PT(dsc))
                 cnt = 0;
         }
 
+        if ((run = spb_direct_run (dsc->p_buffer, itb, &run_len)) != NULL) {
+                if ((end = memchr (run, '\'', run_len)) != NULL) {
+                        cnt += (spb_size_t)(end - run);
+                        goto found;
+                }
+
+                itb += run_len;
+                cnt += run_len;
+        }
+
         spb_iterate (dsc->p_buffer, itb, oct,
                      if (oct == '\'')
                              goto found;
@@ -1691,7 +1776,6 @@ found:
                 SEXP_val_t v_dsc;
                 char    *b_enc, _b_enc[1024];
                 bool     b_encfree;
-                uint8_t *b_dec;
                 size_t   b_declen;
 
                 b_enc = (char *)spb_direct (dsc->p_buffer, dsc->p_bufoff + 1, dsc->p_explen - 2);
@@ -1713,32 +1797,33 @@ found:
                 } else
                         b_encfree = false;
 
-                b_dec    = NULL;
-                b_declen = base64_decode (b_enc, dsc->p_explen - 2, &b_dec);
+                b_declen = base64_decoded_size (b_enc, dsc->p_explen - 2);
 
                 if (b_declen == 0) {
                         if (b_encfree)
                                 sm_free (b_enc);
 
-                        if (b_dec != NULL)
-                                sm_free (b_dec);
-
                         return (SEXP_PRET_EINVAL);
                 }
 
                 if (SEXP_val_new (&v_dsc, sizeof (char) * b_declen,
                                   SEXP_VALTYPE_STRING) != 0)
                 {
-                        sm_free (b_dec);
-
                         if (b_encfree)
                                 sm_free (b_enc);
 
                         return (SEXP_PRET_EUNDEF);
                 }
 
-                memcpy (v_dsc.mem, b_dec, sizeof (char) * b_declen);
-                sm_free (b_dec);
+                /* decode right into the value */
+                if (base64_decode_to (b_enc, dsc->p_explen - 2, v_dsc.mem) != b_declen) {
+                        SEXP_val_free (&v_dsc);
+
+                        if (b_encfree)
+                                sm_free (b_enc);
+
+                        return (SEXP_PRET_EINVAL);
+                }
 
                 if (b_encfree)
                         sm_free (b_enc);
@@ -1754,7 +1839,6 @@ __PARSE_RT SEXP_parse_kl_string_b64 (__PARSE_PT(dsc))
         SEXP_val_t v_dsc;
         char    *b_enc, _b_enc[1024];
         bool     b_encfree;
-        uint8_t *b_dec;
         size_t   b_declen;
 
         assume_d (dsc != NULL, SEXP_PRET_EUNDEF);
@@ -1779,32 +1863,33 @@ __PARSE_RT SEXP_parse_kl_string_b64 (__PARSE_PT(dsc))
         } else
                 b_encfree = false;
 
-        b_dec    = NULL;
-        b_declen = base64_decode (b_enc, dsc->p_explen, &b_dec);
+        b_declen = base64_decoded_size (b_enc, dsc->p_explen);
 
         if (b_declen == 0) {
                 if (b_encfree)
                         sm_free (b_enc);
 
-                if (b_dec != NULL)
-                        sm_free (b_dec);
-
                 return (SEXP_PRET_EINVAL);
         }
 
         if (SEXP_val_new (&v_dsc, sizeof (char) * b_declen,
                           SEXP_VALTYPE_STRING) != 0)
         {
-                sm_free (b_dec);
-
                 if (b_encfree)
                         sm_free (b_enc);
 
                 return (SEXP_PRET_EUNDEF);
         }
 
-        memcpy (v_dsc.mem, b_dec, sizeof (char) * b_declen);
-        sm_free (b_dec);
+        /* decode right into the value */
+        if (base64_decode_to (b_enc, dsc->p_explen, v_dsc.mem) != b_declen) {
+                SEXP_val_free (&v_dsc);
+
+                if (b_encfree)
+                        sm_free (b_enc);
+
+                return (SEXP_PRET_EINVAL);
+        }
 
         if (b_encfree)
                 sm_free (b_enc);
@@ -1938,14 +2023,9 @@ __PARSE_RT SEXP_parse_bool (__PARSE_PT(dsc), bool val)
         assume_d ((false & 1) == 0, SEXP_PRET_EUNDEF);
 
         if (dsc->v_bool[val & 1] == 0) {
-                if (SEXP_val_new (&v_dsc, sizeof (SEXP_numtype_t) + sizeof (bool),
-                                  SEXP_VALTYPE_NUMBER) != 0)
-                {
+                if (SEXP_val_new_number (&v_dsc, SEXP_NUM_BOOL, val) != 0)
                         return (SEXP_PRET_EUNDEF);
-                }
 
-                SEXP_NCASTP(b,v_dsc.mem)->t = SEXP_NUM_BOOL;
-                SEXP_NCASTP(b,v_dsc.mem)->n = val;
                 dsc->v_bool[val & 1] = SEXP_val_ptr (&v_dsc);
         }
 
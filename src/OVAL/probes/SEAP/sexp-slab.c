@@ -0,0 +1,312 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "_sexp-slab.h"
+#include "public/sm_alloc.h"
+
+#define SEXP_SLAB_CLASSES  (SEXP_SLAB_MAXSIZE / SEXP_SLAB_ALIGN)
+#define SEXP_SLAB_PAGESIZE (64 * 1024)
+#define SEXP_SLAB_TMAX     (2 * SEXP_SLAB_BATCH) /* longest per-thread free list */
+
+#define SEXP_SLAB_CLASS(size) (((size) - 1) / SEXP_SLAB_ALIGN)
+
+struct slab_block {
+        struct slab_block *next;
+};
+
+struct slab_list {
+        struct slab_block *head;
+        uint32_t           count;
+};
+
+struct slab_tcache {
+        struct slab_list list[SEXP_SLAB_CLASSES];
+        uint64_t         allocs;
+        uint64_t         frees;
+        uint32_t         scope; /* allocation scope depth */
+};
+
+static struct {
+        pthread_mutex_t  lock;
+        struct slab_list list[SEXP_SLAB_CLASSES];
+        uint8_t         *page;     /* the page blocks are carved from */
+        size_t           page_off;
+        struct SEXP_slab_stats stats;
+} g_slab = {
+        .lock = PTHREAD_MUTEX_INITIALIZER
+};
+
+static pthread_once_t g_slab_once = PTHREAD_ONCE_INIT;
+static pthread_key_t  g_slab_key;
+static bool           g_slab_enabled = false;
+
+static void slab_move (struct slab_list *dst, struct slab_list *src, uint32_t n)
+{
+        struct slab_block *b;
+
+        while (n-- > 0 && src->head != NULL) {
+                b = src->head;
+                src->head = b->next;
+                --src->count;
+
+                b->next = dst->head;
+                dst->head = b;
+                ++dst->count;
+        }
+}
+
+/* the global lock is held */
+static void slab_merge_stats (struct slab_tcache *tc)
+{
+        g_slab.stats.allocs += tc->allocs;
+        g_slab.stats.frees  += tc->frees;
+        tc->allocs = 0;
+        tc->frees  = 0;
+}
+
+static void slab_tcache_free (void *arg)
+{
+        struct slab_tcache *tc = arg;
+        size_t i;
+
+        pthread_mutex_lock (&g_slab.lock);
+
+        for (i = 0; i < SEXP_SLAB_CLASSES; ++i)
+                slab_move (&g_slab.list[i], &tc->list[i], tc->list[i].count);
+
+        slab_merge_stats (tc);
+        pthread_mutex_unlock (&g_slab.lock);
+
+        sm_free (tc);
+}
+
+static void slab_init (void)
+{
+        if (getenv ("SEXP_SLAB_DISABLE") != NULL)
+                return;
+        if (pthread_key_create (&g_slab_key, &slab_tcache_free) != 0)
+                return;
+
+        g_slab_enabled = true;
+}
+
+static struct slab_tcache *slab_tcache (void)
+{
+        struct slab_tcache *tc;
+
+        tc = pthread_getspecific (g_slab_key);
+
+        if (tc == NULL) {
+                tc = sm_calloc (1, sizeof (struct slab_tcache));
+
+                if (tc == NULL)
+                        return (NULL);
+
+                if (pthread_setspecific (g_slab_key, tc) != 0) {
+                        sm_free (tc);
+                        return (NULL);
+                }
+        }
+
+        return (tc);
+}
+
+/* carve a batch of new blocks from the current page; the global lock is held */
+static int slab_grow (size_t cls)
+{
+        size_t bsize = (cls + 1) * SEXP_SLAB_ALIGN;
+        struct slab_block *b;
+        uint32_t n;
+
+        for (n = 0; n < SEXP_SLAB_BATCH; ++n) {
+                if (g_slab.page == NULL || g_slab.page_off + bsize > SEXP_SLAB_PAGESIZE) {
+                        void *page;
+
+                        if (sm_memalign (&page, SEXP_SLAB_ALIGN, SEXP_SLAB_PAGESIZE) != 0)
+                                return (n > 0 ? 0 : -1);
+
+                        g_slab.page     = page;
+                        g_slab.page_off = 0;
+                        ++g_slab.stats.pages;
+                }
+
+                b = (struct slab_block *)(g_slab.page + g_slab.page_off);
+                g_slab.page_off += bsize;
+
+                b->next = g_slab.list[cls].head;
+                g_slab.list[cls].head = b;
+                ++g_slab.list[cls].count;
+        }
+
+        return (0);
+}
+
+/*
+ * A small block allocated here ends up on the free lists, so it's given
+ * the full size of its class.
+ */
+static void *slab_fallback (size_t size)
+{
+        void *ptr;
+
+        if (g_slab_enabled && size > 0 && size <= SEXP_SLAB_MAXSIZE)
+                size = (SEXP_SLAB_CLASS(size) + 1) * SEXP_SLAB_ALIGN;
+
+        if (sm_memalign (&ptr, SEXP_SLAB_ALIGN, size) != 0)
+                return (NULL);
+
+        return (ptr);
+}
+
+void *SEXP_slab_alloc (size_t size)
+{
+        struct slab_tcache *tc;
+        struct slab_list   *list;
+        struct slab_block  *b;
+
+        pthread_once (&g_slab_once, &slab_init);
+
+        if (!g_slab_enabled || size == 0 || size > SEXP_SLAB_MAXSIZE
+            || (tc = slab_tcache ()) == NULL)
+        {
+                if (g_slab_enabled) {
+                        pthread_mutex_lock (&g_slab.lock);
+                        ++g_slab.stats.fallback;
+                        pthread_mutex_unlock (&g_slab.lock);
+                }
+
+                return slab_fallback (size);
+        }
+
+        list = &tc->list[SEXP_SLAB_CLASS(size)];
+
+        if (list->head == NULL) {
+                size_t cls = SEXP_SLAB_CLASS(size);
+
+                pthread_mutex_lock (&g_slab.lock);
+
+                if (g_slab.list[cls].count < SEXP_SLAB_BATCH && slab_grow (cls) != 0) {
+                        pthread_mutex_unlock (&g_slab.lock);
+                        return (NULL);
+                }
+
+                slab_move (list, &g_slab.list[cls], SEXP_SLAB_BATCH);
+                ++g_slab.stats.refills;
+                slab_merge_stats (tc);
+                pthread_mutex_unlock (&g_slab.lock);
+        }
+
+        b = list->head;
+        list->head = b->next;
+        --list->count;
+        ++tc->allocs;
+
+        return (b);
+}
+
+void SEXP_slab_free (void *ptr, size_t size)
+{
+        struct slab_tcache *tc;
+        struct slab_list   *list;
+        struct slab_block  *b = ptr;
+
+        if (ptr == NULL)
+                return;
+        /* SEXP_slab_alloc was called before, so g_slab_enabled is initialized */
+        if (!g_slab_enabled || size == 0 || size > SEXP_SLAB_MAXSIZE) {
+                sm_free (ptr);
+                return;
+        }
+
+        if ((tc = slab_tcache ()) == NULL) {
+                size_t cls = SEXP_SLAB_CLASS(size);
+
+                /* no thread cache, return the block to the global list */
+                pthread_mutex_lock (&g_slab.lock);
+                b->next = g_slab.list[cls].head;
+                g_slab.list[cls].head = b;
+                ++g_slab.list[cls].count;
+                ++g_slab.stats.frees;
+                pthread_mutex_unlock (&g_slab.lock);
+                return;
+        }
+
+        list = &tc->list[SEXP_SLAB_CLASS(size)];
+
+        b->next = list->head;
+        list->head = b;
+        ++list->count;
+        ++tc->frees;
+
+        if (list->count > SEXP_SLAB_TMAX && tc->scope == 0) {
+                pthread_mutex_lock (&g_slab.lock);
+                slab_move (&g_slab.list[SEXP_SLAB_CLASS(size)], list, SEXP_SLAB_BATCH);
+                ++g_slab.stats.flushes;
+                slab_merge_stats (tc);
+                pthread_mutex_unlock (&g_slab.lock);
+        }
+}
+
+void SEXP_slab_scope_begin (void)
+{
+        struct slab_tcache *tc;
+
+        pthread_once (&g_slab_once, &slab_init);
+
+        if (g_slab_enabled && (tc = slab_tcache ()) != NULL)
+                ++tc->scope;
+}
+
+void SEXP_slab_scope_end (void)
+{
+        struct slab_tcache *tc;
+        size_t i;
+
+        if (!g_slab_enabled || (tc = pthread_getspecific (g_slab_key)) == NULL
+            || tc->scope == 0 || --tc->scope > 0)
+                return;
+
+        pthread_mutex_lock (&g_slab.lock);
+
+        for (i = 0; i < SEXP_SLAB_CLASSES; ++i) {
+                if (tc->list[i].count > SEXP_SLAB_TMAX) {
+                        slab_move (&g_slab.list[i], &tc->list[i], tc->list[i].count - SEXP_SLAB_TMAX);
+                        ++g_slab.stats.flushes;
+                }
+        }
+
+        slab_merge_stats (tc);
+        pthread_mutex_unlock (&g_slab.lock);
+}
+
+void SEXP_slab_stats (struct SEXP_slab_stats *stats)
+{
+        pthread_mutex_lock (&g_slab.lock);
+        memcpy (stats, &g_slab.stats, sizeof (struct SEXP_slab_stats));
+        pthread_mutex_unlock (&g_slab.lock);
+}
@@ -29,17 +29,17 @@
 
 #include "_sexp-atomic.h"
 #include "_sexp-value.h"
+#include "_sexp-slab.h"
 #include "public/sm_alloc.h"
 
 int SEXP_val_new (SEXP_val_t *dst, size_t vmemsize, SEXP_type_t type)
 {
         void *s_val;
 
-        if (sm_memalign (&s_val, SEXP_VALP_ALIGN,
-                         sizeof (SEXP_valhdr_t) + vmemsize) != 0)
-        {
+        s_val = SEXP_slab_alloc (sizeof (SEXP_valhdr_t) + vmemsize);
+
+        if (s_val == NULL)
                 return (-1);
-        }
 
         SEXP_val_dsc (dst, (uintptr_t) s_val);
 
@@ -54,17 +54,151 @@ int SEXP_val_new (SEXP_val_t *dst, size_t vmemsize, SEXP_type_t type)
         return (0);
 }
 
+int SEXP_val_new_borrowed (SEXP_val_t *dst, uintptr_t owner, const void *mem, size_t size)
+{
+        struct SEXP_val_borrowed *b;
+        void *s_val;
+
+        s_val = SEXP_slab_alloc (sizeof (SEXP_valhdr_t) + sizeof (struct SEXP_val_borrowed));
+
+        if (s_val == NULL)
+                return (-1);
+
+        b = (struct SEXP_val_borrowed *)((uint8_t *)s_val + sizeof (SEXP_valhdr_t));
+        b->mem   = mem;
+        b->owner = SEXP_rawval_incref (owner);
+
+        ((SEXP_valhdr_t *)s_val)->refs = 1;
+        ((SEXP_valhdr_t *)s_val)->size = size;
+
+        SEXP_val_dsc (dst, (uintptr_t)s_val | SEXP_VALF_BORROWED | SEXP_VALTYPE_STRING);
+
+        return (0);
+}
+
+static size_t SEXP_val_num_size (SEXP_numtype_t t)
+{
+        switch (t) {
+        case SEXP_NUM_BOOL:
+                return sizeof (struct SEXP_val_num_b);
+        case SEXP_NUM_INT8:
+        case SEXP_NUM_UINT8:
+                return sizeof (struct SEXP_val_num_u8);
+        case SEXP_NUM_INT16:
+        case SEXP_NUM_UINT16:
+                return sizeof (struct SEXP_val_num_u16);
+        case SEXP_NUM_INT32:
+        case SEXP_NUM_UINT32:
+                return sizeof (struct SEXP_val_num_u32);
+        case SEXP_NUM_INT64:
+        case SEXP_NUM_UINT64:
+                return sizeof (struct SEXP_val_num_u64);
+        default:
+                abort ();
+        }
+
+        return (0);
+}
+
+static void SEXP_val_num_store (void *mem, SEXP_numtype_t t, int64_t n)
+{
+        switch (t) {
+        case SEXP_NUM_BOOL:
+                SEXP_NCASTP(b,mem)->n = (n != 0);
+                SEXP_NCASTP(b,mem)->t = t;
+                break;
+        case SEXP_NUM_INT8:
+        case SEXP_NUM_UINT8:
+                SEXP_NCASTP(u8,mem)->n = (uint8_t)n;
+                SEXP_NCASTP(u8,mem)->t = t;
+                break;
+        case SEXP_NUM_INT16:
+        case SEXP_NUM_UINT16:
+                SEXP_NCASTP(u16,mem)->n = (uint16_t)n;
+                SEXP_NCASTP(u16,mem)->t = t;
+                break;
+        case SEXP_NUM_INT32:
+        case SEXP_NUM_UINT32:
+                SEXP_NCASTP(u32,mem)->n = (uint32_t)n;
+                SEXP_NCASTP(u32,mem)->t = t;
+                break;
+        case SEXP_NUM_INT64:
+        case SEXP_NUM_UINT64:
+                SEXP_NCASTP(u64,mem)->n = (uint64_t)n;
+                SEXP_NCASTP(u64,mem)->t = t;
+                break;
+        default:
+                abort ();
+        }
+}
+
+int SEXP_val_new_number (SEXP_val_t *dst, SEXP_numtype_t t, int64_t n)
+{
+        if (n >= SEXP_VALI_MIN && n <= SEXP_VALI_MAX) {
+                SEXP_val_dsc (dst, ((uintptr_t)(intptr_t)n << SEXP_VALI_SHIFT)
+                              | ((uintptr_t)t << 8) | SEXP_VALF_IMMEDIATE | SEXP_VALTYPE_NUMBER);
+                return (0);
+        }
+
+        if (SEXP_val_new (dst, SEXP_val_num_size (t), SEXP_VALTYPE_NUMBER) != 0)
+                return (-1);
+
+        SEXP_val_num_store (dst->mem, t, n);
+
+        return (0);
+}
+
+void SEXP_val_free (SEXP_val_t *dsc)
+{
+        if (dsc->ptr & SEXP_VALF_IMMEDIATE)
+                return;
+
+        if (dsc->ptr & SEXP_VALF_BORROWED) {
+                struct SEXP_val_borrowed *b;
+
+                b = (struct SEXP_val_borrowed *)((uint8_t *)dsc->hdr + sizeof (SEXP_valhdr_t));
+
+                if (SEXP_rawval_decref (b->owner)) {
+                        SEXP_val_t o_dsc;
+
+                        SEXP_val_dsc (&o_dsc, b->owner);
+                        SEXP_val_free (&o_dsc);
+                }
+
+                SEXP_slab_free (dsc->hdr, sizeof (SEXP_valhdr_t) + sizeof (struct SEXP_val_borrowed));
+                return;
+        }
+
+        SEXP_slab_free (dsc->hdr, sizeof (SEXP_valhdr_t) + dsc->hdr->size);
+}
+
 void SEXP_val_dsc (SEXP_val_t *dst, uintptr_t ptr)
 {
+        if (ptr & SEXP_VALF_IMMEDIATE) {
+                SEXP_numtype_t t = (ptr >> 8) & 0xff;
+
+                dst->ptr  = ptr;
+                dst->hdr  = &dst->imm.hdr;
+                dst->mem  = dst->imm.mem;
+                dst->type = SEXP_VALTYPE_NUMBER;
+                dst->hdr->refs = 1;
+                dst->hdr->size = SEXP_val_num_size (t);
+                SEXP_val_num_store (dst->mem, t, (int64_t)((intptr_t)ptr >> SEXP_VALI_SHIFT));
+                return;
+        }
+
         dst->ptr  = ptr;
         dst->hdr  = (SEXP_valhdr_t *)(ptr & SEXP_VALP_MASK);
         dst->mem  = (void *)(((uint8_t *)(dst->hdr)) + sizeof (SEXP_valhdr_t));
         dst->type = ptr & SEXP_VALT_MASK;
+
+        if (ptr & SEXP_VALF_BORROWED)
+                dst->mem = (void *)((struct SEXP_val_borrowed *)dst->mem)->mem;
 }
 
 uintptr_t SEXP_val_ptr (SEXP_val_t *dsc)
 {
-        return ((dsc->ptr & SEXP_VALP_MASK) | (dsc->type & SEXP_VALT_MASK));
+        return ((dsc->ptr & ~(uintptr_t)SEXP_VALT_MASK) | (dsc->type & SEXP_VALT_MASK));
 }
 
 /*
@@ -74,6 +208,9 @@ uintptr_t SEXP_val_ptr (SEXP_val_t *dsc)
  */
 uintptr_t SEXP_rawval_incref (uintptr_t valp)
 {
+        if (SEXP_VALP_IMMEDIATE(valp))
+                return (valp);
+
         return SEXP_atomic_inc_u32 (&(SEXP_VALP_HDR(valp)->refs)) > 0 ? valp : (uintptr_t) NULL;
 }
 
@@ -84,6 +221,9 @@ uintptr_t SEXP_rawval_incref (uintptr_t valp)
  */
 int SEXP_rawval_decref (uintptr_t valp)
 {
+        if (SEXP_VALP_IMMEDIATE(valp))
+                return (0);
+
         return (SEXP_atomic_dec_u32 (&(SEXP_VALP_HDR(valp)->refs)) == 0);
 }
 
@@ -94,18 +234,7 @@ SEXP_numtype_t SEXP_rawval_number_type (SEXP_val_t *dsc)
 
 size_t SEXP_rawval_list_length (struct SEXP_val_list *list)
 {
-        size_t length;
-        register struct SEXP_val_lblk *lblk;
-
-        length = 0;
-        lblk   = SEXP_VALP_LBLK(list->b_addr);
-
-        while (lblk != NULL) {
-                length += lblk->real;
-                lblk    = SEXP_VALP_LBLK(lblk->nxsz);
-        }
-
-        return (length - list->offset);
+        return (list->length);
 }
 
 uintptr_t SEXP_rawval_lblk_new (uint8_t sz)
@@ -114,8 +243,9 @@ uintptr_t SEXP_rawval_lblk_new (uint8_t sz)
 
         _A(sz < 16);
 
-        if (sm_memalign ((void **)(void *)&lblk, SEXP_LBLK_ALIGN,
-                         sizeof (uintptr_t) + (2 * sizeof (uint16_t)) + (sizeof (SEXP_t) * (1 << sz))) != 0) {
+        lblk = SEXP_slab_alloc (SEXP_LBLK_SIZE(sz));
+
+        if (lblk == NULL) {
                 /* TODO: handle this */
                 abort ();
                 return ((uintptr_t) NULL);
@@ -262,7 +392,7 @@ uintptr_t SEXP_rawval_lblk_add1 (uintptr_t lblkp, const SEXP_t *s_exp)
                 uintptr_t new_lb;
 
 		new_sz = lblk->nxsz & SEXP_LBLKS_MASK;
-		new_sz = new_sz == 15 ? 6 : new_sz + 1;
+		new_sz = new_sz < SEXP_LBLKS_MAX ? new_sz + 1 : SEXP_LBLKS_MAX;
 
                 new_lb     = SEXP_rawval_lblk_new (new_sz);
                 lblk->nxsz = (new_lb & SEXP_LBLKP_MASK) | (lblk->nxsz & SEXP_LBLKS_MASK);
@@ -436,7 +566,7 @@ uintptr_t SEXP_rawval_list_copy (uintptr_t s_valp)
 {
         SEXP_val_t v_dsc_o, v_dsc_c;
 
-        if (SEXP_val_new (&v_dsc_c, sizeof (void *) + sizeof (uint16_t),
+        if (SEXP_val_new (&v_dsc_c, sizeof (struct SEXP_val_list),
                           SEXP_VALTYPE_LIST) != 0)
         {
                 /* TODO: handle this */
@@ -448,6 +578,8 @@ uintptr_t SEXP_rawval_list_copy (uintptr_t s_valp)
         SEXP_LCASTP(v_dsc_c.mem)->b_addr = (void *) SEXP_rawval_lblk_copy ((uintptr_t)SEXP_LCASTP(v_dsc_o.mem)->b_addr,
                                                                            (uintptr_t)SEXP_LCASTP(v_dsc_o.mem)->offset);
         SEXP_LCASTP(v_dsc_c.mem)->offset = 0;
+        SEXP_LCASTP(v_dsc_c.mem)->id     = SEXP_LCASTP(v_dsc_o.mem)->id;
+        SEXP_LCASTP(v_dsc_c.mem)->length = SEXP_LCASTP(v_dsc_o.mem)->length;
 
         return (SEXP_val_ptr (&v_dsc_c));
 }
@@ -490,7 +622,10 @@ uintptr_t SEXP_rawval_lblk_copy (uintptr_t lblkp, uint16_t n_skip)
                  * allocate new block
                  */
                 if (lb_new->real >= (1 << (cur_sz))) {
-                        lb_next = SEXP_rawval_lblk_new (++cur_sz);
+                        if (cur_sz < SEXP_LBLKS_MAX)
+                                ++cur_sz;
+
+                        lb_next = SEXP_rawval_lblk_new (cur_sz);
                         lb_new->nxsz = (lb_next & SEXP_LBLKP_MASK) | (lb_new->nxsz & SEXP_LBLKS_MASK);
                         lb_new  = SEXP_VALP_LBLK(lb_next);
                         off_n   = 0;
@@ -529,7 +664,7 @@ void SEXP_rawval_lblk_free (uintptr_t lblkp, void (*func) (SEXP_t *))
                         func (lblk->memb + lblk->real);
                 }
 
-                sm_free (lblk);
+                SEXP_slab_free (lblk, SEXP_LBLK_SIZE(lblk->nxsz & SEXP_LBLKS_MASK));
 
                 if (next != NULL)
                         SEXP_rawval_lblk_free ((uintptr_t)next, func);
@@ -550,7 +685,7 @@ void SEXP_rawval_lblk_free1 (uintptr_t lblkp, void (*func) (SEXP_t *))
                         func (lblk->memb + lblk->real);
                 }
 
-                sm_free (lblk);
+                SEXP_slab_free (lblk, SEXP_LBLK_SIZE(lblk->nxsz & SEXP_LBLKS_MASK));
         }
 
         return;
@@ -560,6 +695,10 @@ uintptr_t SEXP_rawval_copy(uintptr_t s_valp)
 {
 	uintptr_t uptr;
 	SEXP_val_t v_dsc;
+
+	if (SEXP_VALP_IMMEDIATE(s_valp))
+		return s_valp;
+
 	SEXP_val_dsc(&v_dsc, s_valp);
 
 	if (v_dsc.type != SEXP_VALTYPE_LIST) {
@@ -28,6 +28,16 @@
 #include <errno.h>
 
 #include "public/sm_alloc.h"
+#include "common/alloc.h"
+
+/* the S-exp values are counted as a subsystem, see oscap_memory_report */
+#define SM_COUNT_ALLOC(m) \
+        do { if (__oscap_memory_accounting) __oscap_memory_count_alloc(OSCAP_MEMORY_SEXP, (m)); } while (0)
+#define SM_COUNT_REALLOC(o, m) \
+        do { if (__oscap_memory_accounting && (m) != NULL) __oscap_memory_count_realloc(OSCAP_MEMORY_SEXP, (o), (m)); } while (0)
+#define SM_COUNT_FREE(p) \
+        do { if (__oscap_memory_accounting) __oscap_memory_count_free(OSCAP_MEMORY_SEXP, (p)); } while (0)
+#define SM_OLD_SIZE(p) (__oscap_memory_accounting ? __oscap_memory_size(p) : 0)
 
 #if defined(NDEBUG)
 /*
@@ -41,6 +51,7 @@ void *sm_alloc (size_t s)
         _A(s > 0);
 #endif
         m = malloc (s);
+        SM_COUNT_ALLOC(m);
 #if defined(SEAP_MALLOC_EXIT)
         if (m == NULL)
                 exit (ENOMEM);
@@ -56,6 +67,7 @@ void *sm_calloc (size_t n, size_t s)
         _A(s > 0);
 #endif
         m = calloc (n, s);
+        SM_COUNT_ALLOC(m);
 #if defined(SEAP_MALLOC_EXIT)
         if (m == NULL)
                 exit (ENOMEM);
@@ -66,8 +78,10 @@ void *sm_calloc (size_t n, size_t s)
 void *sm_realloc (void *p, size_t s)
 {
         void *m;
+        size_t o = SM_OLD_SIZE(p);
 
         m = realloc (p, s);
+        SM_COUNT_REALLOC(o, m);
 #if defined(SEAP_MALLOC_EXIT)
         if (m == NULL && s > 0)
                 exit (ENOMEM);
@@ -78,8 +92,10 @@ void *sm_realloc (void *p, size_t s)
 void *sm_reallocf (void *p, size_t s)
 {
         void *m;
+        size_t o = SM_OLD_SIZE(p);
 
         m = realloc (p, s);
+        SM_COUNT_REALLOC(o, m);
         if (m == NULL && s > 0) {
                 sm_free (p);
 #if defined(SEAP_MALLOC_EXIT)
@@ -96,6 +112,8 @@ int sm_memalign (void **p, size_t a, size_t s)
         _A(p != NULL);
 
         ret = posix_memalign (p, a, s);
+        if (ret == 0)
+                SM_COUNT_ALLOC(*p);
 
 #if defined(SEAP_MALLOC_EXIT)
         if (ret != 0)
@@ -109,8 +127,10 @@ void sm_free (void *p)
 #if defined(SEAP_MALLOC_STRICT)
         _A(p != NULL);
 #endif
-        if (p != NULL)
+        if (p != NULL) {
+                SM_COUNT_FREE(p);
                 free (p);
+        }
         return;
 }
 
@@ -126,6 +146,7 @@ void *__sm_alloc_dbg (size_t s, const char *func, size_t line)
         _A(s > 0);
 #endif
         m = malloc (s);
+        SM_COUNT_ALLOC(m);
 #if defined(SEAP_MALLOC_EXIT)
         if (m == NULL) {
                 dI("FAIL: size=%zu", s);
@@ -146,6 +167,7 @@ void *__sm_calloc_dbg (size_t n, size_t s, const char *f, size_t l)
         _A(s > 0);
 #endif
         m = calloc (n, s);
+        SM_COUNT_ALLOC(m);
 #if defined(SEAP_MALLOC_EXIT)
         if (m == NULL) {
                 dI("FAIL: nmemb=%zu, size=%zu, total=%zu",
@@ -163,7 +185,10 @@ void *__sm_calloc_dbg (size_t n, size_t s, const char *f, size_t l)
 void *__sm_realloc_dbg (void *p, size_t s, const char *f, size_t l)
 {
         void *m;
+        size_t o = SM_OLD_SIZE(p);
+
         m = realloc (p, s);
+        SM_COUNT_REALLOC(o, m);
 #if defined(SEAP_MALLOC_EXIT)
         if (m == NULL && s > 0) {
                 dI("FAIL: old=%p, size=%zu", p, s);
@@ -179,7 +204,10 @@ void *__sm_realloc_dbg (void *p, size_t s, const char *f, size_t l)
 void *__sm_reallocf_dbg (void *p, size_t s, const char *f, size_t l)
 {
         void *m;
+        size_t o = SM_OLD_SIZE(p);
+
         m = realloc (p, s);
+        SM_COUNT_REALLOC(o, m);
         if (m == NULL && s > 0) {
                 dI("FAIL: old=%p, size=%zu", p, s);
                 sm_free (p);
@@ -201,6 +229,8 @@ int __sm_memalign_dbg (void **p, size_t a, size_t s, const char *f, size_t l)
         _A(p != NULL);
 
         ret = posix_memalign (p, a, s);
+        if (ret == 0)
+                SM_COUNT_ALLOC(*p);
 
 #if defined(SEAP_MALLOC_EXIT)
         if (ret != 0) {
@@ -219,8 +249,10 @@ void __sm_free_dbg (void *p, const char *f, size_t l)
 #if defined(SEAP_VERBOSE_DEBUG)
         dI("ptr=%p", p);
 #endif
-        if (p != NULL)
+        if (p != NULL) {
+                SM_COUNT_FREE(p);
                 free (p);
+        }
         return;
 }
 #endif
@@ -48,6 +48,25 @@ struct id_desc_t {
 	int item_id_ctr;	///< id counter
 };
 
+/*
+ * Index the entities of the object for the lookups of probe_obj_getent
+ * in this thread, until probe_obj_index_detach is called.
+ */
+void probe_obj_index_attach(const SEXP_t *obj);
+void probe_obj_index_detach(void);
+
+/*
+ * Set the deadline of the collection of the object in this thread to
+ * `timeout' seconds from now, 0 for none, until probe_deadline_detach is
+ * called. It returns whether probe_ctx_expired reported the deadline.
+ */
+void probe_deadline_attach(uint32_t timeout);
+bool probe_deadline_detach(void);
+
+/* the deadline in milliseconds of CLOCK_MONOTONIC, 0 if there's none */
+uint64_t probe_deadline_get(void);
+uint64_t probe_deadline_now(void);
+
 #define SEAP_LOCK pthread_mutex_lock (&globals.seap_lock)
 #define SEAP_UNLOCK pthread_mutex_unlock (&globals.seap_lock)
 
@@ -27,9 +27,15 @@
 #include <stdarg.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 #include <assume.h>
 #include <errno.h>
+#include <ratelimit.h>
 
 #include "crapi.h"
 #include "digest.h"
@@ -64,114 +70,164 @@ int crapi_digest_fd (int fd, crapi_alg_t alg, void *dst, size_t *size)
         return (-1);
 }
 
-int crapi_mdigest_fd (int fd, int num, ... /* crapi_alg_t alg, void *dst, size_t *size, ...*/)
+static int digest_ctbl_set (struct digest_ctbl_t *ctbl, crapi_alg_t alg)
 {
-        register int i;
-        va_list ap;
-        struct digest_ctbl_t ctbl[num];
+        switch (alg) {
+        case CRAPI_DIGEST_MD5:
+                ctbl->init   = &crapi_md5_init;
+                ctbl->update = &crapi_md5_update;
+                ctbl->fini   = &crapi_md5_fini;
+                ctbl->free   = &crapi_md5_free;
+                break;
+        case CRAPI_DIGEST_SHA1:
+                ctbl->init   = &crapi_sha1_init;
+                ctbl->update = &crapi_sha1_update;
+                ctbl->fini   = &crapi_sha1_fini;
+                ctbl->free   = &crapi_sha1_free;
+                break;
+        case CRAPI_DIGEST_SHA224:
+                ctbl->init   = &crapi_sha224_init;
+                ctbl->update = &crapi_sha224_update;
+                ctbl->fini   = &crapi_sha224_fini;
+                ctbl->free   = &crapi_sha224_free;
+                break;
+        case CRAPI_DIGEST_SHA256:
+                ctbl->init   = &crapi_sha256_init;
+                ctbl->update = &crapi_sha256_update;
+                ctbl->fini   = &crapi_sha256_fini;
+                ctbl->free   = &crapi_sha256_free;
+                break;
+        case CRAPI_DIGEST_SHA384:
+                ctbl->init   = &crapi_sha384_init;
+                ctbl->update = &crapi_sha384_update;
+                ctbl->fini   = &crapi_sha384_fini;
+                ctbl->free   = &crapi_sha384_free;
+                break;
+        case CRAPI_DIGEST_SHA512:
+                ctbl->init   = &crapi_sha512_init;
+                ctbl->update = &crapi_sha512_update;
+                ctbl->fini   = &crapi_sha512_fini;
+                ctbl->free   = &crapi_sha512_free;
+                break;
+        case CRAPI_DIGEST_RMD160:
+                ctbl->init   = &crapi_rmd160_init;
+                ctbl->update = &crapi_rmd160_update;
+                ctbl->fini   = &crapi_rmd160_fini;
+                ctbl->free   = &crapi_rmd160_free;
+                break;
+        default:
+                return (-1);
+        }
 
-        crapi_alg_t alg;
-        void       *dst;
-        size_t     *size;
+        return (0);
+}
 
-        uint8_t fd_buf[CRAPI_IO_BUFSZ];
-        ssize_t ret;
+static int digest_ctbl_update (struct digest_ctbl_t *ctbl, int num, void *buf, size_t len)
+{
+        register int i;
 
-        assume_r (num > 0, -1, errno = EINVAL;);
-        assume_r (fd  > 0, -1, errno = EINVAL;);
+        for (i = 0; i < num; ++i) {
+                if (ctbl[i].ctx == NULL)
+                        continue;
+                if (ctbl[i].update (ctbl[i].ctx, buf, len) != 0)
+                        return (-1);
+        }
 
-        for (i = 0; i < num; ++i)
-                ctbl[i].ctx = NULL;
+        return (0);
+}
 
-        va_start (ap, num);
+/*
+ * Feed the whole content of the file to all the contexts. Large regular
+ * files are mapped and fed in CRAPI_MMAP_CHUNK blocks (the NSS update
+ * function takes an unsigned int length), everything else is read in
+ * CRAPI_MDIGEST_BUFSZ blocks. Every block is taken from the read rate
+ * of the probe first.
+ */
+static int digest_ctbl_update_fd (struct digest_ctbl_t *ctbl, int num, int fd)
+{
+        struct stat st;
+        uint8_t *buf;
+        ssize_t  ret;
+        int      err = 0;
 
-        for (i = 0; i < num; ++i) {
-                alg  = va_arg (ap, crapi_alg_t);
-                dst  = va_arg (ap, void *);
-                size = va_arg (ap, size_t *);
-
-                switch (alg) {
-                case CRAPI_DIGEST_MD5:
-                        ctbl[i].init   = &crapi_md5_init;
-                        ctbl[i].update = &crapi_md5_update;
-                        ctbl[i].fini   = &crapi_md5_fini;
-                        ctbl[i].free   = &crapi_md5_free;
-                        break;
-                case CRAPI_DIGEST_SHA1:
-                        ctbl[i].init   = &crapi_sha1_init;
-                        ctbl[i].update = &crapi_sha1_update;
-                        ctbl[i].fini   = &crapi_sha1_fini;
-                        ctbl[i].free   = &crapi_sha1_free;
-                        break;
-                case CRAPI_DIGEST_SHA224:
-                        ctbl[i].init   = &crapi_sha224_init;
-                        ctbl[i].update = &crapi_sha224_update;
-                        ctbl[i].fini   = &crapi_sha224_fini;
-                        ctbl[i].free   = &crapi_sha224_free;
-                        break;
-                case CRAPI_DIGEST_SHA256:
-                        ctbl[i].init   = &crapi_sha256_init;
-                        ctbl[i].update = &crapi_sha256_update;
-                        ctbl[i].fini   = &crapi_sha256_fini;
-                        ctbl[i].free   = &crapi_sha256_free;
-                        break;
-                case CRAPI_DIGEST_SHA384:
-                        ctbl[i].init   = &crapi_sha384_init;
-                        ctbl[i].update = &crapi_sha384_update;
-                        ctbl[i].fini   = &crapi_sha384_fini;
-                        ctbl[i].free   = &crapi_sha384_free;
-                        break;
-                case CRAPI_DIGEST_SHA512:
-                        ctbl[i].init   = &crapi_sha512_init;
-                        ctbl[i].update = &crapi_sha512_update;
-                        ctbl[i].fini   = &crapi_sha512_fini;
-                        ctbl[i].free   = &crapi_sha512_free;
-                        break;
-                case CRAPI_DIGEST_RMD160:
-                        ctbl[i].init   = &crapi_rmd160_init;
-                        ctbl[i].update = &crapi_rmd160_update;
-                        ctbl[i].fini   = &crapi_rmd160_fini;
-                        ctbl[i].free   = &crapi_rmd160_free;
-                        break;
-                default:
-                        va_end (ap);
-                        goto fail;
-                }
+        if (fstat (fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size >= CRAPI_MMAP_MIN
+            && (uintmax_t)st.st_size <= SIZE_MAX)
+        {
+                size_t len = (size_t)st.st_size, off;
 
-                if ((ctbl[i].ctx = ctbl[i].init (dst, size)) == NULL)
-			*size = 0;
-        }
+                buf = mmap (NULL, len, PROT_READ, MAP_SHARED, fd, 0);
 
-        va_end (ap);
+                if (buf != MAP_FAILED) {
+                        (void) madvise (buf, len, MADV_SEQUENTIAL);
+
+                        for (off = 0; off < len && err == 0; off += CRAPI_MMAP_CHUNK) {
+                                size_t n = len - off < CRAPI_MMAP_CHUNK ? len - off : CRAPI_MMAP_CHUNK;
 
-        while ((ret = read (fd, fd_buf, sizeof fd_buf)) == sizeof fd_buf) {
-#pragma omp parallel for
-                for (i = 0; i < num; ++i) {
-			if (ctbl[i].ctx == NULL)
-				continue;
-                        if (ctbl[i].update (ctbl[i].ctx, fd_buf, sizeof fd_buf) != 0) {
-                                goto fail;
+                                oscap_ratelimit_take (OSCAP_RATELIMIT_READ, n);
+                                err = digest_ctbl_update (ctbl, num, buf + off, n);
                         }
+                        munmap (buf, len);
+
+                        if (err != 0)
+                                return (-1);
+                        /*
+                         * The file may have grown since fstat(), continue
+                         * reading after the mapped part.
+                         */
+                        if (lseek (fd, (off_t)len, SEEK_SET) == (off_t)-1)
+                                return (-1);
                 }
         }
 
-        switch (ret) {
-        case 0:
-                break;
-        case -1:
-                goto fail;
-        default:
-                assume_r (ret > 0, -1, goto fail;);
+#if defined(POSIX_FADV_SEQUENTIAL)
+        (void) posix_fadvise (fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        buf = malloc (CRAPI_MDIGEST_BUFSZ);
 
-                for (i = 0; i < num; ++i) {
-			if (ctbl[i].ctx == NULL)
-				continue;
-                        if (ctbl[i].update (ctbl[i].ctx, fd_buf, (size_t)ret) != 0) {
-                                goto fail;
-                        }
+        if (buf == NULL)
+                return (-1);
+
+        for (;;) {
+                oscap_ratelimit_take (OSCAP_RATELIMIT_READ, CRAPI_MDIGEST_BUFSZ);
+                ret = read (fd, buf, CRAPI_MDIGEST_BUFSZ);
+
+                if (ret == 0)
+                        break;
+                if (ret < 0) {
+                        if (errno == EINTR)
+                                continue;
+                        err = -1;
+                        break;
                 }
+                if ((err = digest_ctbl_update (ctbl, num, buf, (size_t)ret)) != 0)
+                        break;
+        }
+
+        free (buf);
+        return (err);
+}
+
+int crapi_mdigest_fdv (int fd, int num, const crapi_alg_t alg[], void *dst[], size_t *size[])
+{
+        register int i;
+        struct digest_ctbl_t ctbl[num];
+
+        assume_r (num > 0, -1, errno = EINVAL;);
+        assume_r (fd  > 0, -1, errno = EINVAL;);
+
+        for (i = 0; i < num; ++i)
+                ctbl[i].ctx = NULL;
+
+        for (i = 0; i < num; ++i) {
+                if (digest_ctbl_set (&ctbl[i], alg[i]) != 0)
+                        goto fail;
+                if ((ctbl[i].ctx = ctbl[i].init (dst[i], size[i])) == NULL)
+                        *size[i] = 0;
         }
 
+        if (digest_ctbl_update_fd (ctbl, num, fd) != 0)
+                goto fail;
+
         for (i = 0; i < num; ++i) {
 		if (ctbl[i].ctx == NULL)
 			continue;
@@ -186,3 +242,27 @@ fail:
 
         return (-1);
 }
+
+int crapi_mdigest_fd (int fd, int num, ... /* crapi_alg_t alg, void *dst, size_t *size, ...*/)
+{
+        register int i;
+        va_list ap;
+
+        assume_r (num > 0, -1, errno = EINVAL;);
+
+        crapi_alg_t alg[num];
+        void       *dst[num];
+        size_t     *size[num];
+
+        va_start (ap, num);
+
+        for (i = 0; i < num; ++i) {
+                alg[i]  = va_arg (ap, crapi_alg_t);
+                dst[i]  = va_arg (ap, void *);
+                size[i] = va_arg (ap, size_t *);
+        }
+
+        va_end (ap);
+
+        return crapi_mdigest_fdv (fd, num, alg, dst, size);
+}
@@ -53,6 +53,24 @@ struct digest_ctbl_t {
         void  (*free)  (void *);
 };
 
+/*
+ * Files of at least CRAPI_MMAP_MIN bytes are mapped into memory,
+ * others are read in CRAPI_MDIGEST_BUFSZ blocks.
+ */
+#define CRAPI_MMAP_MIN      (64 * 1024)
+#define CRAPI_MMAP_CHUNK    (1024 * 1024)
+#define CRAPI_MDIGEST_BUFSZ (128 * 1024)
+
+/**
+ * Compute several digests of the content of the file, reading it only once.
+ * The init function of an algorithm may fail, in that case the size of its
+ * digest is set to 0 and the other digests are still computed.
+ */
 int crapi_mdigest_fd (int fd, int num, ... /*crapi_alg_t alg, void *dst, size_t *size, ...*/);
 
+/**
+ * Same as crapi_mdigest_fd(), with the arguments in arrays.
+ */
+int crapi_mdigest_fdv (int fd, int num, const crapi_alg_t alg[], void *dst[], size_t *size[]);
+
 #endif /* CRAPI_DIGEST_H */
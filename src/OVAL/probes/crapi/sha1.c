@@ -34,6 +34,7 @@
 #include <alloc.h>
 #include "crapi.h"
 #include "sha1.h"
+#include "shaext.h"
 
 #if defined(HAVE_NSS3)
 #include <sechash.h>
@@ -42,6 +43,7 @@
 
 struct crapi_sha1_ctx {
         HASHContext *ctx;
+        struct crapi_shaext_ctx *ext;
         void        *dst;
         size_t      *size;
 };
@@ -50,10 +52,16 @@ void *crapi_sha1_init (void *dst, void *size)
 {
         struct crapi_sha1_ctx *ctx = oscap_talloc (struct crapi_sha1_ctx);
 
-        ctx->ctx  = HASH_Create (HASH_AlgSHA1);
         ctx->dst  = dst;
         ctx->size = size;
 
+        if ((ctx->ext = crapi_shaext_new (CRAPI_DIGEST_SHA1)) != NULL) {
+                ctx->ctx = NULL;
+                return (ctx);
+        }
+
+        ctx->ctx  = HASH_Create (HASH_AlgSHA1);
+
         if (ctx->ctx != NULL) {
                 HASH_Begin (ctx->ctx);
         } else {
@@ -67,7 +75,12 @@ void *crapi_sha1_init (void *dst, void *size)
 int crapi_sha1_update (void *ctxp, void *bptr, size_t blen)
 {
         struct crapi_sha1_ctx *ctx = (struct crapi_sha1_ctx *)ctxp;
-        
+
+        if (ctx->ext != NULL) {
+                crapi_shaext_update (ctx->ext, bptr, blen);
+                return (0);
+        }
+
         HASH_Update (ctx->ctx, (const unsigned char *)bptr, (unsigned int)blen);
         return (0);
 }
@@ -76,6 +89,13 @@ int crapi_sha1_fini (void *ctxp)
 {
         struct crapi_sha1_ctx *ctx = (struct crapi_sha1_ctx *)ctxp;
 
+        if (ctx->ext != NULL) {
+                int ret = crapi_shaext_fini (ctx->ext, ctx->dst, ctx->size);
+
+                oscap_free (ctx);
+                return (ret);
+        }
+
         HASH_End (ctx->ctx, ctx->dst, (unsigned int *)ctx->size, *ctx->size);
         HASH_Destroy (ctx->ctx);
         oscap_free (ctx);
@@ -87,7 +107,10 @@ void crapi_sha1_free (void *ctxp)
 {
         struct crapi_sha1_ctx *ctx = (struct crapi_sha1_ctx *)ctxp;
 
-        HASH_Destroy (ctx->ctx);
+        if (ctx->ext != NULL)
+                crapi_shaext_free (ctx->ext);
+        else
+                HASH_Destroy (ctx->ctx);
         oscap_free (ctx);
         
         return;
@@ -99,6 +122,7 @@ void crapi_sha1_free (void *ctxp)
 
 struct crapi_sha1_ctx {
         gcry_md_hd_t ctx;
+        struct crapi_shaext_ctx *ext;
         void        *dst;
         void        *size;
 };
@@ -107,6 +131,12 @@ void *crapi_sha1_init (void *dst, void *size)
 {
         struct crapi_sha1_ctx *ctx = oscap_talloc (struct crapi_sha1_ctx);
 
+        if ((ctx->ext = crapi_shaext_new (CRAPI_DIGEST_SHA1)) != NULL) {
+                ctx->dst  = dst;
+                ctx->size = size;
+                return (ctx);
+        }
+
         if (gcry_md_open (&ctx->ctx, GCRY_MD_SHA1, 0) != 0) {
 		oscap_free(ctx);
 		return NULL;
@@ -122,6 +152,11 @@ int crapi_sha1_update (void *ctxp, void *bptr, size_t blen)
 {
         struct crapi_sha1_ctx *ctx = (struct crapi_sha1_ctx *)ctxp;
 
+        if (ctx->ext != NULL) {
+                crapi_shaext_update (ctx->ext, bptr, blen);
+                return (0);
+        }
+
         gcry_md_write (ctx->ctx, (const void *)bptr, blen);
         return (0);
 }
@@ -131,6 +166,13 @@ int crapi_sha1_fini (void *ctxp)
         struct crapi_sha1_ctx *ctx = (struct crapi_sha1_ctx *)ctxp;
         void *buffer;
 
+        if (ctx->ext != NULL) {
+                int ret = crapi_shaext_fini (ctx->ext, ctx->dst, ctx->size);
+
+                oscap_free (ctx);
+                return (ret);
+        }
+
         gcry_md_final (ctx->ctx);
         buffer = (void *)gcry_md_read (ctx->ctx, GCRY_MD_SHA1);
         memcpy (ctx->dst, buffer, gcry_md_get_algo_dlen (GCRY_MD_SHA1));
@@ -144,7 +186,10 @@ void crapi_sha1_free (void *ctxp)
 {
         struct crapi_sha1_ctx *ctx = (struct crapi_sha1_ctx *)ctxp;
 
-        gcry_md_close (ctx->ctx);
+        if (ctx->ext != NULL)
+                crapi_shaext_free (ctx->ext);
+        else
+                gcry_md_close (ctx->ctx);
         oscap_free(ctx);
 
         return;
@@ -162,6 +207,9 @@ int crapi_sha1_fd (int fd, void *dst, size_t *size)
         assume_r (size != NULL, -1, errno = EFAULT;);
         assume_r (dst != NULL, -1, errno = EFAULT;);
         assume_r (*size >= CRAPI_SHA1DST_LEN, -1, errno = ENOBUFS;);
+
+        if (crapi_shaext_supported (CRAPI_DIGEST_SHA1))
+                return crapi_shaext_fd (CRAPI_DIGEST_SHA1, fd, dst, size);
         
         if (fstat (fd, &st) != 0)
                 return (-1);
@@ -34,6 +34,7 @@
 
 #include "crapi.h"
 #include "sha2.h"
+#include "shaext.h"
 
 #if defined(HAVE_NSS3)
 #include <sechash.h>
@@ -95,99 +96,177 @@ static int crapi_sha2_fd (HASH_HashType algo, int fd, void *dst, size_t *size)
         return (0);
 }
 
+struct crapi_sha2_ctx {
+        HASHContext *ctx;
+        struct crapi_shaext_ctx *ext;
+        void        *dst;
+        size_t      *size;
+};
+
+static void *crapi_sha2_init (void *dst, void *size, HASH_HashType algo, crapi_alg_t alg)
+{
+        struct crapi_sha2_ctx *ctx = oscap_talloc (struct crapi_sha2_ctx);
+
+        ctx->dst  = dst;
+        ctx->size = size;
+
+        if ((ctx->ext = crapi_shaext_new (alg)) != NULL) {
+                ctx->ctx = NULL;
+                return (ctx);
+        }
+
+        ctx->ctx = HASH_Create (algo);
+
+        if (ctx->ctx != NULL) {
+                HASH_Begin (ctx->ctx);
+        } else {
+                oscap_free (ctx);
+                ctx = NULL;
+        }
+
+        return (ctx);
+}
+
+static int crapi_sha2_update (void *ctxp, void *bptr, size_t blen)
+{
+        struct crapi_sha2_ctx *ctx = (struct crapi_sha2_ctx *)ctxp;
+
+        if (ctx->ext != NULL) {
+                crapi_shaext_update (ctx->ext, bptr, blen);
+                return (0);
+        }
+
+        HASH_Update (ctx->ctx, (const unsigned char *)bptr, (unsigned int)blen);
+        return (0);
+}
+
+static int crapi_sha2_fini (void *ctxp)
+{
+        struct crapi_sha2_ctx *ctx = (struct crapi_sha2_ctx *)ctxp;
+        int ret = 0;
+
+        if (ctx->ext != NULL) {
+                ret = crapi_shaext_fini (ctx->ext, ctx->dst, ctx->size);
+        } else {
+                HASH_End (ctx->ctx, ctx->dst, (unsigned int *)ctx->size, *ctx->size);
+                HASH_Destroy (ctx->ctx);
+        }
+
+        oscap_free (ctx);
+
+        return (ret);
+}
+
+static void crapi_sha2_free (void *ctxp)
+{
+        struct crapi_sha2_ctx *ctx = (struct crapi_sha2_ctx *)ctxp;
+
+        if (ctx->ext != NULL)
+                crapi_shaext_free (ctx->ext);
+        else
+                HASH_Destroy (ctx->ctx);
+        oscap_free (ctx);
+}
+
 void *crapi_sha224_init (void *dst, void *size)
 {
-        return (NULL);
+        return crapi_sha2_init (dst, size, HASH_AlgSHA224, CRAPI_DIGEST_SHA224);
 }
 
 int crapi_sha224_update (void *ctxp, void *bptr, size_t blen)
 {
-        return (-1);
+        return crapi_sha2_update (ctxp, bptr, blen);
 }
 
 int crapi_sha224_fini (void *ctxp)
 {
-        return (-1);
+        return crapi_sha2_fini (ctxp);
 }
 
 void crapi_sha224_free (void *ctxp)
 {
-        return;
+        crapi_sha2_free (ctxp);
 }
 
 int crapi_sha224_fd (int fd, void *dst, size_t *size)
 {
-        return (-1);
+        if (crapi_shaext_supported (CRAPI_DIGEST_SHA224))
+                return crapi_shaext_fd (CRAPI_DIGEST_SHA224, fd, dst, size);
+
+        return crapi_sha2_fd (HASH_AlgSHA224, fd, dst, size);
 }
 
 void *crapi_sha256_init (void *dst, void *size)
 {
-        return (NULL);
+        return crapi_sha2_init (dst, size, HASH_AlgSHA256, CRAPI_DIGEST_SHA256);
 }
 
 int crapi_sha256_update (void *ctxp, void *bptr, size_t blen)
 {
-        return (-1);
+        return crapi_sha2_update (ctxp, bptr, blen);
 }
 
 int crapi_sha256_fini (void *ctxp)
 {
-        return (-1);
+        return crapi_sha2_fini (ctxp);
 }
 
 void crapi_sha256_free (void *ctxp)
 {
-        return;
+        crapi_sha2_free (ctxp);
 }
 
 int crapi_sha256_fd (int fd, void *dst, size_t *size)
 {
+        if (crapi_shaext_supported (CRAPI_DIGEST_SHA256))
+                return crapi_shaext_fd (CRAPI_DIGEST_SHA256, fd, dst, size);
+
         return crapi_sha2_fd (HASH_AlgSHA256, fd, dst, size);
 }
 
 void *crapi_sha384_init (void *dst, void *size)
 {
-        return (NULL);
+        return crapi_sha2_init (dst, size, HASH_AlgSHA384, CRAPI_DIGEST_SHA384);
 }
 
 int crapi_sha384_update (void *ctxp, void *bptr, size_t blen)
 {
-        return (-1);
+        return crapi_sha2_update (ctxp, bptr, blen);
 }
 
 int crapi_sha384_fini (void *ctxp)
 {
-        return (-1);
+        return crapi_sha2_fini (ctxp);
 }
 
 void crapi_sha384_free (void *ctxp)
 {
-        return;
+        crapi_sha2_free (ctxp);
 }
 
 int crapi_sha384_fd (int fd, void *dst, size_t *size)
 {
-        return (-1);
+        return crapi_sha2_fd (HASH_AlgSHA384, fd, dst, size);
 }
 
 void *crapi_sha512_init (void *dst, void *size)
 {
-        return (NULL);
+        return crapi_sha2_init (dst, size, HASH_AlgSHA512, CRAPI_DIGEST_SHA512);
 }
 
 int crapi_sha512_update (void *ctxp, void *bptr, size_t blen)
 {
-        return (-1);
+        return crapi_sha2_update (ctxp, bptr, blen);
 }
 
 int crapi_sha512_fini (void *ctxp)
 {
-        return (-1);
+        return crapi_sha2_fini (ctxp);
 }
 
 void crapi_sha512_free (void *ctxp)
 {
-        return;
+        crapi_sha2_free (ctxp);
 }
 
 int crapi_sha512_fd (int fd, void *dst, size_t *size)
@@ -258,14 +337,21 @@ static int crapi_sha2_fd (int algo, int fd, void *dst, size_t *size)
 
 struct crapi_sha2_ctx {
         gcry_md_hd_t ctx;
+        struct crapi_shaext_ctx *ext;
         void        *dst;
         void        *size;
 };
 
-static void *crapi_sha2_init(void *dst, void *size, int alg)
+static void *crapi_sha2_init(void *dst, void *size, int alg, crapi_alg_t crapi_alg)
 {
         struct crapi_sha2_ctx *ctx = oscap_talloc (struct crapi_sha2_ctx);
 
+        if ((ctx->ext = crapi_shaext_new (crapi_alg)) != NULL) {
+                ctx->dst  = dst;
+                ctx->size = size;
+                return (ctx);
+        }
+
         if (gcry_md_open (&ctx->ctx, alg, 0) != 0) {
 		oscap_free(ctx);
 		return NULL;
@@ -281,6 +367,11 @@ static int crapi_sha2_update (void *ctxp, void *bptr, size_t blen)
 {
         struct crapi_sha2_ctx *ctx = (struct crapi_sha2_ctx *)ctxp;
 
+        if (ctx->ext != NULL) {
+                crapi_shaext_update (ctx->ext, bptr, blen);
+                return (0);
+        }
+
         gcry_md_write (ctx->ctx, (const void *)bptr, blen);
         return (0);
 }
@@ -290,6 +381,13 @@ static int crapi_sha2_fini (void *ctxp, int alg)
         struct crapi_sha2_ctx *ctx = (struct crapi_sha2_ctx *)ctxp;
         void *buffer;
 
+        if (ctx->ext != NULL) {
+                int ret = crapi_shaext_fini (ctx->ext, ctx->dst, ctx->size);
+
+                oscap_free (ctx);
+                return (ret);
+        }
+
         gcry_md_final (ctx->ctx);
         buffer = (void *)gcry_md_read (ctx->ctx, alg);
         memcpy (ctx->dst, buffer, gcry_md_get_algo_dlen (alg));
@@ -301,12 +399,18 @@ static int crapi_sha2_fini (void *ctxp, int alg)
 
 static void crapi_sha2_free (void *ctxp)
 {
-        return;
+        struct crapi_sha2_ctx *ctx = (struct crapi_sha2_ctx *)ctxp;
+
+        if (ctx->ext != NULL)
+                crapi_shaext_free (ctx->ext);
+        else
+                gcry_md_close (ctx->ctx);
+        oscap_free (ctx);
 }
 
 void *crapi_sha224_init (void *dst, void *size)
 {
-        return crapi_sha2_init(dst, size, GCRY_MD_SHA224);
+        return crapi_sha2_init(dst, size, GCRY_MD_SHA224, CRAPI_DIGEST_SHA224);
 }
 
 int crapi_sha224_update (void *ctxp, void *bptr, size_t blen)
@@ -326,12 +430,15 @@ void crapi_sha224_free (void *ctxp)
 
 int crapi_sha224_fd (int fd, void *dst, size_t *size)
 {
-        return crapi_sha2_fd (GCRY_MD_SHA256, fd, dst, size);
+        if (crapi_shaext_supported (CRAPI_DIGEST_SHA224))
+                return crapi_shaext_fd (CRAPI_DIGEST_SHA224, fd, dst, size);
+
+        return crapi_sha2_fd (GCRY_MD_SHA224, fd, dst, size);
 }
 
 void *crapi_sha256_init (void *dst, void *size)
 {
-        return crapi_sha2_init(dst, size, GCRY_MD_SHA256);
+        return crapi_sha2_init(dst, size, GCRY_MD_SHA256, CRAPI_DIGEST_SHA256);
 }
 
 int crapi_sha256_update (void *ctxp, void *bptr, size_t blen)
@@ -351,12 +458,15 @@ void crapi_sha256_free (void *ctxp)
 
 int crapi_sha256_fd (int fd, void *dst, size_t *size)
 {
+        if (crapi_shaext_supported (CRAPI_DIGEST_SHA256))
+                return crapi_shaext_fd (CRAPI_DIGEST_SHA256, fd, dst, size);
+
         return crapi_sha2_fd (GCRY_MD_SHA256, fd, dst, size);
 }
 
 void *crapi_sha384_init (void *dst, void *size)
 {
-        return crapi_sha2_init(dst, size, GCRY_MD_SHA384);
+        return crapi_sha2_init(dst, size, GCRY_MD_SHA384, CRAPI_DIGEST_SHA384);
 }
 
 int crapi_sha384_update (void *ctxp, void *bptr, size_t blen)
@@ -381,7 +491,7 @@ int crapi_sha384_fd (int fd, void *dst, size_t *size)
 
 void *crapi_sha512_init (void *dst, void *size)
 {
-        return crapi_sha2_init(dst, size, GCRY_MD_SHA512);
+        return crapi_sha2_init(dst, size, GCRY_MD_SHA512, CRAPI_DIGEST_SHA512);
 }
 
 int crapi_sha512_update (void *ctxp, void *bptr, size_t blen)
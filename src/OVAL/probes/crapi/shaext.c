@@ -0,0 +1,396 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <assume.h>
+#include <errno.h>
+#include <alloc.h>
+#include "crapi.h"
+#include "shaext.h"
+
+#if defined(HAVE_NSS3)
+# include <pk11pub.h>
+#elif defined(HAVE_GCRYPT)
+# include <gcrypt.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+# define CRAPI_SHAEXT_X86 1
+# include <cpuid.h>
+# include <immintrin.h>
+#endif
+
+typedef void (*crapi_shaext_blocks_t)(uint32_t *h, const uint8_t *data, size_t nblocks);
+
+struct crapi_shaext_ctx {
+        uint32_t h[8];
+        uint8_t  buf[64];
+        size_t   buflen;
+        uint64_t total;
+        size_t   dstlen;
+        crapi_shaext_blocks_t blocks;
+};
+
+static const uint32_t sha1_iv[5] = {
+        0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0
+};
+
+static const uint32_t sha224_iv[8] = {
+        0xc1059ed8, 0x367cd507, 0x3070dd17, 0xf70e5939,
+        0xffc00b31, 0x68581511, 0x64f98fa7, 0xbefa4fa4
+};
+
+static const uint32_t sha256_iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+static const uint32_t sha256_k[64] __attribute__((aligned(16))) = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#if defined(CRAPI_SHAEXT_X86)
+/*
+ * SHA-1 and SHA-256 using the x86 SHA extensions. The message schedule is
+ * computed four words at a time, w[g & 3] holds words 4g .. 4g+3.
+ */
+#define SHA1_ROUNDS4(g, f)                                                      \
+        do {                                                                    \
+                if ((g) >= 4)                                                   \
+                        w[(g) & 3] = _mm_sha1msg2_epu32(                        \
+                                _mm_xor_si128(_mm_sha1msg1_epu32(w[(g) & 3], w[((g) + 1) & 3]), \
+                                              w[((g) + 2) & 3]),                \
+                                w[((g) + 3) & 3]);                              \
+                else                                                            \
+                        w[(g) & 3] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16 * (g))), bswap); \
+                if ((g) == 0)                                                   \
+                        e = _mm_add_epi32(e, w[0]);                             \
+                else                                                            \
+                        e = _mm_sha1nexte_epu32(prev, w[(g) & 3]);              \
+                prev = abcd;                                                    \
+                abcd = _mm_sha1rnds4_epu32(abcd, e, (f));                       \
+        } while (0)
+
+__attribute__((target("sha,sse4.1,ssse3")))
+static void sha1_blocks_x86 (uint32_t *h, const uint8_t *data, size_t nblocks)
+{
+        const __m128i bswap = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+        __m128i abcd, abcd_save, e, e_save, prev, w[4];
+
+        abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)h), 0x1b);
+        e    = _mm_set_epi32((int)h[4], 0, 0, 0);
+
+        for (; nblocks > 0; --nblocks, data += 64) {
+                abcd_save = abcd;
+                e_save    = e;
+
+                SHA1_ROUNDS4( 0, 0); SHA1_ROUNDS4( 1, 0); SHA1_ROUNDS4( 2, 0);
+                SHA1_ROUNDS4( 3, 0); SHA1_ROUNDS4( 4, 0);
+                SHA1_ROUNDS4( 5, 1); SHA1_ROUNDS4( 6, 1); SHA1_ROUNDS4( 7, 1);
+                SHA1_ROUNDS4( 8, 1); SHA1_ROUNDS4( 9, 1);
+                SHA1_ROUNDS4(10, 2); SHA1_ROUNDS4(11, 2); SHA1_ROUNDS4(12, 2);
+                SHA1_ROUNDS4(13, 2); SHA1_ROUNDS4(14, 2);
+                SHA1_ROUNDS4(15, 3); SHA1_ROUNDS4(16, 3); SHA1_ROUNDS4(17, 3);
+                SHA1_ROUNDS4(18, 3); SHA1_ROUNDS4(19, 3);
+
+                e    = _mm_sha1nexte_epu32(prev, e_save);
+                abcd = _mm_add_epi32(abcd, abcd_save);
+        }
+
+        _mm_storeu_si128((__m128i *)h, _mm_shuffle_epi32(abcd, 0x1b));
+        h[4] = (uint32_t)_mm_extract_epi32(e, 3);
+}
+
+#undef SHA1_ROUNDS4
+
+#define SHA256_ROUNDS4(g)                                                       \
+        do {                                                                    \
+                if ((g) >= 4) {                                                 \
+                        t = _mm_sha256msg1_epu32(w[(g) & 3], w[((g) + 1) & 3]); \
+                        t = _mm_add_epi32(t, _mm_alignr_epi8(w[((g) + 3) & 3], w[((g) + 2) & 3], 4)); \
+                        w[(g) & 3] = _mm_sha256msg2_epu32(t, w[((g) + 3) & 3]); \
+                } else                                                          \
+                        w[(g) & 3] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16 * (g))), bswap); \
+                t  = _mm_add_epi32(w[(g) & 3], _mm_load_si128((const __m128i *)&sha256_k[4 * (g)])); \
+                s1 = _mm_sha256rnds2_epu32(s1, s0, t);                          \
+                t  = _mm_shuffle_epi32(t, 0x0e);                                \
+                s0 = _mm_sha256rnds2_epu32(s0, s1, t);                          \
+        } while (0)
+
+__attribute__((target("sha,sse4.1,ssse3")))
+static void sha256_blocks_x86 (uint32_t *h, const uint8_t *data, size_t nblocks)
+{
+        const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+        __m128i s0, s1, s0_save, s1_save, t, w[4];
+
+        /* h is ABCD EFGH, the instructions want ABEF CDGH */
+        t  = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&h[0]), 0xb1);
+        s1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&h[4]), 0x1b);
+        s0 = _mm_alignr_epi8(t, s1, 8);
+        s1 = _mm_blend_epi16(s1, t, 0xf0);
+
+        for (; nblocks > 0; --nblocks, data += 64) {
+                s0_save = s0;
+                s1_save = s1;
+
+                SHA256_ROUNDS4( 0); SHA256_ROUNDS4( 1); SHA256_ROUNDS4( 2); SHA256_ROUNDS4( 3);
+                SHA256_ROUNDS4( 4); SHA256_ROUNDS4( 5); SHA256_ROUNDS4( 6); SHA256_ROUNDS4( 7);
+                SHA256_ROUNDS4( 8); SHA256_ROUNDS4( 9); SHA256_ROUNDS4(10); SHA256_ROUNDS4(11);
+                SHA256_ROUNDS4(12); SHA256_ROUNDS4(13); SHA256_ROUNDS4(14); SHA256_ROUNDS4(15);
+
+                s0 = _mm_add_epi32(s0, s0_save);
+                s1 = _mm_add_epi32(s1, s1_save);
+        }
+
+        t  = _mm_shuffle_epi32(s0, 0x1b);
+        s1 = _mm_shuffle_epi32(s1, 0xb1);
+        _mm_storeu_si128((__m128i *)&h[0], _mm_blend_epi16(t, s1, 0xf0));
+        _mm_storeu_si128((__m128i *)&h[4], _mm_alignr_epi8(s1, t, 8));
+}
+
+#undef SHA256_ROUNDS4
+
+static bool crapi_shaext_cpu (void)
+{
+        unsigned int eax, ebx, ecx, edx;
+
+        /* SSSE3 and SSE4.1 are needed along with SHA */
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+                return (false);
+        if (!(ecx & bit_SSSE3) || !(ecx & bit_SSE4_1))
+                return (false);
+        if (__get_cpuid_max(0, NULL) < 7)
+                return (false);
+
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+
+        return ((ebx & (1 << 29)) != 0);
+}
+#endif
+
+static pthread_once_t crapi_shaext_once = PTHREAD_ONCE_INIT;
+static bool crapi_shaext_enabled = false;
+
+static void crapi_shaext_check (void)
+{
+#if defined(CRAPI_SHAEXT_X86)
+        if (getenv ("CRAPI_SHAEXT_DISABLE") != NULL)
+                return;
+        /*
+         * In FIPS mode the digests have to come from the validated
+         * library.
+         */
+# if defined(HAVE_NSS3)
+        if (PK11_IsFIPS ())
+                return;
+# elif defined(HAVE_GCRYPT)
+        if (gcry_fips_mode_active ())
+                return;
+# endif
+        crapi_shaext_enabled = crapi_shaext_cpu ();
+#endif
+}
+
+static crapi_shaext_blocks_t crapi_shaext_blocks (crapi_alg_t alg)
+{
+        pthread_once (&crapi_shaext_once, &crapi_shaext_check);
+
+        if (!crapi_shaext_enabled)
+                return (NULL);
+
+        switch (alg) {
+#if defined(CRAPI_SHAEXT_X86)
+        case CRAPI_DIGEST_SHA1:
+                return (&sha1_blocks_x86);
+        case CRAPI_DIGEST_SHA224:
+        case CRAPI_DIGEST_SHA256:
+                return (&sha256_blocks_x86);
+#endif
+        default:
+                return (NULL);
+        }
+}
+
+bool crapi_shaext_supported (crapi_alg_t alg)
+{
+        return (crapi_shaext_blocks (alg) != NULL);
+}
+
+struct crapi_shaext_ctx *crapi_shaext_new (crapi_alg_t alg)
+{
+        struct crapi_shaext_ctx *ctx;
+        crapi_shaext_blocks_t blocks;
+
+        if ((blocks = crapi_shaext_blocks (alg)) == NULL)
+                return (NULL);
+
+        ctx = oscap_talloc (struct crapi_shaext_ctx);
+        ctx->buflen = 0;
+        ctx->total  = 0;
+        ctx->blocks = blocks;
+
+        switch (alg) {
+        case CRAPI_DIGEST_SHA1:
+                memcpy (ctx->h, sha1_iv, sizeof sha1_iv);
+                ctx->dstlen = 20;
+                break;
+        case CRAPI_DIGEST_SHA224:
+                memcpy (ctx->h, sha224_iv, sizeof sha224_iv);
+                ctx->dstlen = 28;
+                break;
+        default:
+                memcpy (ctx->h, sha256_iv, sizeof sha256_iv);
+                ctx->dstlen = 32;
+                break;
+        }
+
+        return (ctx);
+}
+
+void crapi_shaext_update (struct crapi_shaext_ctx *ctx, const void *bptr, size_t blen)
+{
+        const uint8_t *p = (const uint8_t *)bptr;
+        size_t n;
+
+        ctx->total += blen;
+
+        if (ctx->buflen > 0) {
+                n = sizeof ctx->buf - ctx->buflen;
+                n = blen < n ? blen : n;
+
+                memcpy (ctx->buf + ctx->buflen, p, n);
+                ctx->buflen += n;
+                p    += n;
+                blen -= n;
+
+                if (ctx->buflen < sizeof ctx->buf)
+                        return;
+
+                ctx->blocks (ctx->h, ctx->buf, 1);
+                ctx->buflen = 0;
+        }
+
+        if (blen >= 64) {
+                ctx->blocks (ctx->h, p, blen / 64);
+                p    += blen & ~(size_t)63;
+                blen &= 63;
+        }
+
+        if (blen > 0) {
+                memcpy (ctx->buf, p, blen);
+                ctx->buflen = blen;
+        }
+}
+
+int crapi_shaext_fini (struct crapi_shaext_ctx *ctx, void *dst, size_t *size)
+{
+        uint8_t *d = (uint8_t *)dst;
+        uint64_t bits = ctx->total * 8;
+        size_t   i;
+
+        if (*size < ctx->dstlen) {
+                crapi_shaext_free (ctx);
+                errno = ENOBUFS;
+                return (-1);
+        }
+
+        ctx->buf[ctx->buflen++] = 0x80;
+
+        if (ctx->buflen > 56) {
+                memset (ctx->buf + ctx->buflen, 0, sizeof ctx->buf - ctx->buflen);
+                ctx->blocks (ctx->h, ctx->buf, 1);
+                ctx->buflen = 0;
+        }
+
+        memset (ctx->buf + ctx->buflen, 0, 56 - ctx->buflen);
+
+        for (i = 0; i < 8; ++i)
+                ctx->buf[63 - i] = (uint8_t)(bits >> (8 * i));
+
+        ctx->blocks (ctx->h, ctx->buf, 1);
+
+        for (i = 0; i < ctx->dstlen; ++i)
+                d[i] = (uint8_t)(ctx->h[i / 4] >> (24 - 8 * (i % 4)));
+
+        *size = ctx->dstlen;
+        crapi_shaext_free (ctx);
+
+        return (0);
+}
+
+void crapi_shaext_free (struct crapi_shaext_ctx *ctx)
+{
+        oscap_free (ctx);
+}
+
+int crapi_shaext_fd (crapi_alg_t alg, int fd, void *dst, size_t *size)
+{
+        struct crapi_shaext_ctx *ctx;
+        uint8_t *buf;
+        ssize_t  ret;
+
+        assume_r (size != NULL, -1, errno = EFAULT;);
+        assume_r (dst != NULL, -1, errno = EFAULT;);
+
+        if ((ctx = crapi_shaext_new (alg)) == NULL) {
+                errno = ENOTSUP;
+                return (-1);
+        }
+
+        if ((buf = malloc (CRAPI_MDIGEST_BUFSZ)) == NULL) {
+                crapi_shaext_free (ctx);
+                return (-1);
+        }
+
+        for (;;) {
+                ret = read (fd, buf, CRAPI_MDIGEST_BUFSZ);
+
+                if (ret == 0)
+                        break;
+                if (ret < 0) {
+                        if (errno == EINTR)
+                                continue;
+                        free (buf);
+                        crapi_shaext_free (ctx);
+                        return (-1);
+                }
+
+                crapi_shaext_update (ctx, buf, (size_t)ret);
+        }
+
+        free (buf);
+
+        return crapi_shaext_fini (ctx, dst, size);
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#pragma once
+#ifndef CRAPI_SHAEXT_H
+#define CRAPI_SHAEXT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "digest.h"
+
+/*
+ * SHA-1, SHA-224 and SHA-256 computed with the x86 SHA extensions. The sha1.c
+ * and sha2.c contexts use these instead of the crypto library when the CPU
+ * supports them,
+ * the library isn't in FIPS mode and CRAPI_SHAEXT_DISABLE isn't set in the
+ * environment.
+ */
+struct crapi_shaext_ctx;
+
+/**
+ * Check whether the algorithm can be computed using the CPU instructions.
+ * The result of the CPU check is cached, so this is cheap to call per file.
+ */
+bool crapi_shaext_supported (crapi_alg_t alg);
+
+/**
+ * Allocate a new context, or return NULL if the algorithm is not supported.
+ */
+struct crapi_shaext_ctx *crapi_shaext_new (crapi_alg_t alg);
+void   crapi_shaext_update (struct crapi_shaext_ctx *ctx, const void *bptr, size_t blen);
+
+/**
+ * Store the digest in dst, its length in *size, and free the context.
+ */
+int    crapi_shaext_fini (struct crapi_shaext_ctx *ctx, void *dst, size_t *size);
+void   crapi_shaext_free (struct crapi_shaext_ctx *ctx);
+
+int crapi_shaext_fd (crapi_alg_t alg, int fd, void *dst, size_t *size);
+
+#endif /* CRAPI_SHAEXT_H */
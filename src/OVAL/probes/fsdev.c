@@ -40,10 +40,13 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <errno.h>
+#include <pthread.h>
 
 #if defined(__linux__)
 # include <mntent.h>
 # include <unistd.h>
+# include <fcntl.h>
+# include <poll.h>
 #elif defined(__SVR4) && defined(__sun)
 # include <sys/mnttab.h>
 # include <sys/mntent.h>
@@ -58,14 +61,6 @@
 
 #include "fsdev.h"
 
-/**
- * Compare two dev_t variables.
- */
-static int fsdev_cmp(const void *a, const void *b)
-{
-	return memcmp(a, b, sizeof(dev_t));
-}
-
 /**
  * Compare two strings.
  */
@@ -186,7 +181,10 @@ static fsdev_t *__fsdev_init(fsdev_t * lfs, const char **fs, size_t fs_cnt)
 		if (stat(ment->mnt_dir, &st) != 0)
 			continue;
 		if (i >= lfs->cnt) {
-			lfs->cnt += DEVID_ARRAY_ADD;
+			if (lfs->cnt == UINT16_MAX)
+				break;
+			/* container hosts may have thousands of mounts */
+			lfs->cnt = lfs->cnt < UINT16_MAX / 2 ? lfs->cnt * 2 : UINT16_MAX;
 			lfs->ids = realloc(lfs->ids, sizeof(dev_t) * lfs->cnt);
 		}
 		memcpy(&(lfs->ids[i++]), &st.st_dev, sizeof(dev_t));
@@ -304,20 +302,135 @@ static fsdev_t *__fsdev_init(fsdev_t * lfs, const char **fs, size_t fs_cnt)
 }
 #endif
 
-fsdev_t *fsdev_init(const char **fs, size_t fs_cnt)
+static inline size_t fsdev_hash(dev_t id)
+{
+	return (size_t)(((uint64_t)id * 0x9e3779b97f4a7c15ULL) >> 32);
+}
+
+/**
+ * Build the hash table of the device ids.
+ */
+static int fsdev_table(fsdev_t * lfs)
+{
+	size_t size, i, j;
+
+	for (size = 8; size < (size_t)lfs->cnt * 2; size *= 2)
+		;
+
+	lfs->tab = calloc(size, sizeof(dev_t));
+
+	if (lfs->tab == NULL)
+		return (-1);
+
+	lfs->mask = size - 1;
+	lfs->zero = false;
+
+	for (i = 0; i < lfs->cnt; ++i) {
+		if (lfs->ids[i] == 0) {
+			lfs->zero = true;
+			continue;
+		}
+
+		for (j = fsdev_hash(lfs->ids[i]) & lfs->mask; lfs->tab[j] != 0 && lfs->tab[j] != lfs->ids[i]; )
+			j = (j + 1) & lfs->mask;
+
+		lfs->tab[j] = lfs->ids[i];
+	}
+
+	return (0);
+}
+
+static fsdev_t *fsdev_new(const char **fs, size_t fs_cnt)
 {
 	fsdev_t *lfs;
+	int e;
 
 	lfs = malloc(sizeof(fsdev_t));
 
 	if (lfs == NULL)
 		return (NULL);
 
+	lfs->tab  = NULL;
+	lfs->refs = 1;
+
 	if (__fsdev_init(lfs, fs, fs_cnt) == NULL)
 		return (NULL);
 
-        if (lfs->ids != NULL && lfs->cnt > 1)
-                qsort(lfs->ids, lfs->cnt, sizeof(dev_t), fsdev_cmp);
+	if (fsdev_table(lfs) != 0) {
+		e = errno;
+		free(lfs->ids);
+		free(lfs);
+		errno = e;
+		return (NULL);
+	}
+
+	return (lfs);
+}
+
+static pthread_mutex_t __fsdev_lock = PTHREAD_MUTEX_INITIALIZER;
+static fsdev_t *__fsdev_local = NULL;
+
+#if defined(__linux__)
+#define FSDEV_MOUNTINFO "/proc/self/mountinfo"
+
+static int __fsdev_mountinfo = -1;
+
+/**
+ * Check whether the mount table changed since the last call. The kernel
+ * signals the changes with POLLPRI on the mountinfo file. If the file
+ * can't be opened, e.g. in a chroot without /proc, the table is always
+ * considered changed.
+ */
+static bool fsdev_mounts_changed(void)
+{
+	struct pollfd pfd;
+
+	if (__fsdev_mountinfo != -1) {
+		pfd.fd = __fsdev_mountinfo;
+		pfd.events = POLLPRI;
+		pfd.revents = 0;
+
+		if (poll(&pfd, 1, 0) <= 0 || !(pfd.revents & (POLLPRI | POLLERR)))
+			return (false);
+
+		/* the event is cleared by opening the file again */
+		close(__fsdev_mountinfo);
+	}
+
+	__fsdev_mountinfo = open(FSDEV_MOUNTINFO, O_RDONLY | O_CLOEXEC);
+
+	return (true);
+}
+#else
+static bool fsdev_mounts_changed(void)
+{
+	return (true);
+}
+#endif
+
+fsdev_t *fsdev_init(const char **fs, size_t fs_cnt)
+{
+	fsdev_t *lfs;
+
+	if (fs != NULL)
+		return fsdev_new(fs, fs_cnt);
+
+	pthread_mutex_lock(&__fsdev_lock);
+
+	if (fsdev_mounts_changed() || __fsdev_local == NULL) {
+		if ((lfs = fsdev_new(NULL, 0)) == NULL) {
+			pthread_mutex_unlock(&__fsdev_lock);
+			return (NULL);
+		}
+
+		fsdev_free(__fsdev_local);
+		__fsdev_local = lfs;
+	}
+
+	lfs = __fsdev_local;
+	__atomic_add_fetch(&lfs->refs, 1, __ATOMIC_RELAXED);
+
+	pthread_mutex_unlock(&__fsdev_lock);
 
 	return (lfs);
 }
@@ -376,6 +489,9 @@ fsdev_t *fsdev_strinit(const char *fs_names)
 void fsdev_free(fsdev_t * lfs)
 {
 	if (lfs != NULL) {
+		if (__atomic_sub_fetch(&lfs->refs, 1, __ATOMIC_ACQ_REL) > 0)
+			return;
+		free(lfs->tab);
 		free(lfs->ids);
 		free(lfs);
 	}
@@ -384,25 +500,20 @@ void fsdev_free(fsdev_t * lfs)
 
 int fsdev_search(fsdev_t * lfs, void *id)
 {
-	uint16_t w, s;
-	int cmp;
+	dev_t dev;
+	size_t i;
 
 	if (!lfs)
 		return 1;
 
-	w = lfs->cnt;
-	s = 0;
+	memcpy(&dev, id, sizeof(dev_t));
 
-	while (w > 0) {
-		cmp = fsdev_cmp(id, &(lfs->ids[s + w / 2]));
-		if (cmp > 0) {
-			s += w / 2 + 1;
-			w = w - w / 2 - 1;
-		} else if (cmp < 0) {
-			w = w / 2;
-		} else {
+	if (dev == 0)
+		return (lfs->zero ? 1 : 0);
+
+	for (i = fsdev_hash(dev) & lfs->mask; lfs->tab[i] != 0; i = (i + 1) & lfs->mask) {
+		if (lfs->tab[i] == dev)
 			return (1);
-		}
 	}
 
 	return (0);
@@ -56,41 +56,27 @@
 #include "probe/entcmp.h"
 #include "alloc.h"
 #include "common/debug_priv.h"
-
-#define BUFFER_SIZE 256
+#include "oval_proctab.h"
 
 extern char **environ;
 
 static int read_environment(SEXP_t *pid_ent, SEXP_t *name_ent, probe_ctx *ctx)
 {
-	int err = 1, pid, fd;
-	bool empty;
-	size_t env_name_size;
+	int err = 1, pid, env_err;
+	size_t env_name_size, env_len, proc_i;
 	SEXP_t *env_name, *env_value, *item, *pid_sexp;
-	DIR *d;
-	struct dirent *d_entry;
-	char *buffer, env_file[256], *null_char;
-	ssize_t buffer_used;
-	size_t buffer_size;
-
-	d = opendir("/proc");
-	if (d == NULL) {
-		dE("Can't read /proc: errno=%d, %s.", errno, strerror (errno));
+	const struct oval_proctab *proctab;
+	const char *env, *env_end, *eq_char, *null_char;
+
+	proctab = oval_proctab_get();
+	if (proctab == NULL) {
 		return PROBE_EACCESS;
 	}
 
-	if ((buffer = oscap_realloc(NULL, BUFFER_SIZE)) == NULL) {
-		dE("Can't allocate memory");
-		closedir(d);
-		return PROBE_EFAULT;
-	}
-	buffer_size = BUFFER_SIZE;
+	for (proc_i = 0; proc_i < proctab->count; ++proc_i) {
+		struct oval_proc *proc = proctab->procs[proc_i];
 
-	while ((d_entry = readdir(d))) {
-		if (strspn(d_entry->d_name, "0123456789") != strlen(d_entry->d_name))
-			continue;
-
-		pid = atoi(d_entry->d_name);
+		pid = oval_proc_pid(proc);
 		pid_sexp = SEXP_number_newi_32(pid);
 
 		if (probe_entobj_cmp(pid_ent, pid_sexp) != OVAL_RESULT_TRUE) {
@@ -99,10 +85,8 @@ static int read_environment(SEXP_t *pid_ent, SEXP_t *name_ent, probe_ctx *ctx)
 		}
 		SEXP_free(pid_sexp);
 
-		sprintf(env_file, "/proc/%d/environ", pid);
-
-		if ((fd = open(env_file, O_RDONLY)) == -1) {
-			dE("Can't open \"%s\": errno=%d, %s.", env_file, errno, strerror (errno));
+		if ((env = oval_proc_environ(proc, &env_len, &env_err)) == NULL) {
+			dE("Can't open \"/proc/%d/environ\": errno=%d, %s.", pid, env_err, strerror (env_err));
 			item = probe_item_create(
 					OVAL_INDEPENDENT_ENVIRONMENT_VARIABLE58, NULL,
 					"pid", OVAL_DATATYPE_INTEGER, (int64_t)pid,
@@ -111,76 +95,43 @@ static int read_environment(SEXP_t *pid_ent, SEXP_t *name_ent, probe_ctx *ctx)
 
 			probe_item_setstatus(item, SYSCHAR_STATUS_ERROR);
 			probe_item_add_msg(item, OVAL_MESSAGE_LEVEL_ERROR,
-					   "Can't open \"%s\": errno=%d, %s.", env_file, errno, strerror (errno));
+					   "Can't open \"/proc/%d/environ\": errno=%d, %s.", pid, env_err, strerror (env_err));
 			probe_item_collect(ctx, item);
 			continue;
 		}
 
-		empty = true;
-
-		if ((buffer_used = read(fd, buffer, buffer_size - 1)) > 0) {
-			empty = false;
-		}
-
-		while (! empty) {
-			while (! (null_char = memchr(buffer, 0, buffer_used))) {
-				ssize_t s;
-				if ((size_t)buffer_used >= buffer_size) {
-					buffer_size += BUFFER_SIZE;
-					buffer = oscap_realloc(buffer, buffer_size);
-					if (buffer == NULL) {
-						dE("Can't allocate memory");
-						exit(ENOMEM);
-					}
-
-				}
-				s = read(fd, buffer + buffer_used, buffer_size - buffer_used);
-				if (s <= 0) {
-					empty = true;
-					buffer[buffer_used++] = 0;
-				}
-				else {
-					buffer_used += s;
-				}
+		/* "name=value" strings separated by '\0' */
+		for (env_end = env + env_len; env < env_end; env = null_char + 1) {
+			null_char = memchr(env, 0, env_end - env);
+			if (null_char == NULL)
+				null_char = env_end;
+
+			eq_char = memchr(env, '=', null_char - env);
+			if (eq_char == NULL) {
+				/* strange but possible:
+				 * $ strings /proc/1218/environ
+				 /dev/input/event0 /dev/input/event1 /dev/input/event4 /dev/input/event3
+				*/
+				continue;
 			}
 
-			do {
-				char *eq_char = strchr(buffer, '=');
-				if (eq_char == NULL) {
-					/* strange but possible:
-					 * $ strings /proc/1218/environ
- 					/dev/input/event0 /dev/input/event1 /dev/input/event4 /dev/input/event3
-					*/
-					buffer_used -= null_char + 1 - buffer;
-					memmove(buffer, null_char + 1, buffer_used);
-					continue;
-				}
-
-				env_name_size =  eq_char - buffer;
-				env_name = SEXP_string_new(buffer, env_name_size);
-				env_value = SEXP_string_newf("%s", buffer + env_name_size + 1);
-				if (probe_entobj_cmp(name_ent, env_name) == OVAL_RESULT_TRUE) {
-					item = probe_item_create(
-						OVAL_INDEPENDENT_ENVIRONMENT_VARIABLE58, NULL,
-						"pid", OVAL_DATATYPE_INTEGER, (int64_t)pid,
-						"name",  OVAL_DATATYPE_SEXP, env_name,
-						"value", OVAL_DATATYPE_SEXP, env_value,
-					      NULL);
-					probe_item_collect(ctx, item);
-					err = 0;
-				}
-				SEXP_free(env_name);
-				SEXP_free(env_value);
-
-				buffer_used -= null_char + 1 - buffer;
-				memmove(buffer, null_char + 1, buffer_used);
-			} while ((null_char = memchr(buffer, 0, buffer_used)));
+			env_name_size =  eq_char - env;
+			env_name = SEXP_string_new(env, env_name_size);
+			env_value = SEXP_string_new(eq_char + 1, null_char - eq_char - 1);
+			if (probe_entobj_cmp(name_ent, env_name) == OVAL_RESULT_TRUE) {
+				item = probe_item_create(
+					OVAL_INDEPENDENT_ENVIRONMENT_VARIABLE58, NULL,
+					"pid", OVAL_DATATYPE_INTEGER, (int64_t)pid,
+					"name",  OVAL_DATATYPE_SEXP, env_name,
+					"value", OVAL_DATATYPE_SEXP, env_value,
+				      NULL);
+				probe_item_collect(ctx, item);
+				err = 0;
+			}
+			SEXP_free(env_name);
+			SEXP_free(env_value);
 		}
-
-		close(fd);
 	}
-	closedir(d);
-	oscap_free(buffer);
 	if (err) {
 		SEXP_t *msg = probe_msg_creatf(OVAL_MESSAGE_LEVEL_ERROR,
 				"Can't find process with requested PID.");
@@ -189,6 +140,7 @@ static int read_environment(SEXP_t *pid_ent, SEXP_t *name_ent, probe_ctx *ctx)
 		err = 0;
 	}
 
+	oval_proctab_put(proctab);
 	return err;
 }
 
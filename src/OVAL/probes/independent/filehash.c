@@ -263,6 +263,7 @@ int probe_main (probe_ctx *ctx, void *mutex)
         }
 
 	if ((ofts = oval_fts_open(path, filename, filepath, behaviors, probe_ctx_getresult(ctx))) != NULL) {
+		oval_fts_set_prefetch(ofts);
 		while ((ofts_ent = oval_fts_read(ofts)) != NULL) {
 			filehash_cb(ofts_ent->path, ofts_ent->file, ctx, over);
 			oval_ftsent_free(ofts_ent);
@@ -51,8 +51,12 @@
 
 #include "common/debug_priv.h"
 #include "oval_fts.h"
+#include "oval_hash_cache.h"
 #include "util.h"
 #include "probe/entcmp.h"
+#if defined(HAVE_RPM_FILE_DIGEST)
+#include "../unix/linux/rpm-file-digest.h"
+#endif
 
 #define FILE_SEPARATOR '/'
 
@@ -103,14 +107,14 @@ static int mem2hex (uint8_t *mem, size_t mlen, char *str, size_t slen)
 	return (0);
 }
 
-static int filehash58_cb (const char *p, const char *f, const char *h, probe_ctx *ctx)
+static int filehash58_cb (const char *p, const char *f, int num, const char *h[], probe_ctx *ctx)
 {
 	SEXP_t *itm;
 
 	char   pbuf[PATH_MAX+1];
 	size_t plen, flen;
 
-	int fd;
+	int fd, i;
 
 	if (f == NULL)
 		return (0);
@@ -140,61 +144,105 @@ static int filehash58_cb (const char *p, const char *f, const char *h, probe_ctx
 	fd = open (pbuf, O_RDONLY);
 
 	if (fd < 0) {
-		strerror_r (errno, pbuf, PATH_MAX);
-		pbuf[PATH_MAX] = '\0';
-
-		itm = probe_item_create (OVAL_INDEPENDENT_FILE_HASH58, NULL,
-					"filepath", OVAL_DATATYPE_STRING, pbuf,
-					"path",     OVAL_DATATYPE_STRING, p,
-					"filename", OVAL_DATATYPE_STRING, f,
-					"hash_type",OVAL_DATATYPE_STRING, h,
-					NULL);
-		probe_item_add_msg(itm, OVAL_MESSAGE_LEVEL_ERROR,
-			"Can't open \"%s\": errno=%d, %s.", pbuf, errno, strerror (errno));
-		probe_item_setstatus(itm, SYSCHAR_STATUS_ERROR);
+		int e = errno;
+
+		for (i = 0; i < num; ++i) {
+			itm = probe_item_create (OVAL_INDEPENDENT_FILE_HASH58, NULL,
+						"filepath", OVAL_DATATYPE_STRING, pbuf,
+						"path",     OVAL_DATATYPE_STRING, p,
+						"filename", OVAL_DATATYPE_STRING, f,
+						"hash_type",OVAL_DATATYPE_STRING, h[i],
+						NULL);
+			probe_item_add_msg(itm, OVAL_MESSAGE_LEVEL_ERROR,
+				"Can't open \"%s\": errno=%d, %s.", pbuf, e, strerror (e));
+			probe_item_setstatus(itm, SYSCHAR_STATUS_ERROR);
+			probe_item_collect(ctx, itm);
+		}
 	} else {
-		uint8_t hash_dst[1025];
-		size_t  hash_dstlen = sizeof hash_dst;
-		char    hash_str[2051];
+		uint8_t     hash_dst[num][64];
+		size_t      hash_dstlen[num];
+		crapi_alg_t hash_type[num];
+		char        hash_str[(64 * 2) + 1];
+		/* the hash values which are not in the hash cache */
+		void       *comp_dstp[num];
+		size_t     *comp_dstlenp[num];
+		crapi_alg_t comp_type[num];
+		int         comp = 0;
+		struct stat st, st_after;
+		bool        regular, cacheable;
+#if defined(HAVE_RPM_FILE_DIGEST)
+		bool        trusted;
+#endif
+
+		regular   = fstat (fd, &st) == 0 && S_ISREG (st.st_mode);
+		cacheable = regular && oval_hash_cache_enabled();
+#if defined(HAVE_RPM_FILE_DIGEST)
+		trusted   = regular && rpm_file_digest_enabled();
+#endif
 
-		crapi_alg_t hash_type;
+		for (i = 0; i < num; ++i) {
+			hash_type[i]    = oscap_string_to_enum(CRAPI_ALG_MAP, h[i]);
+			hash_dstlen[i]  = oscap_string_to_enum(CRAPI_ALG_MAP_SIZE, h[i]);
 
-		hash_type = oscap_string_to_enum(CRAPI_ALG_MAP, h);
-		hash_dstlen = oscap_string_to_enum(CRAPI_ALG_MAP_SIZE, h);
+			if (cacheable && oval_hash_cache_get (&st, hash_type[i], hash_dst[i], &hash_dstlen[i]))
+				continue;
+#if defined(HAVE_RPM_FILE_DIGEST)
+			/* an unmodified package file, the digest from the rpm database */
+			if (trusted && rpm_file_digest_get (pbuf, &st, hash_type[i], hash_dst[i], &hash_dstlen[i]))
+				continue;
+#endif
+
+			comp_type[comp]    = hash_type[i];
+			comp_dstp[comp]    = hash_dst[i];
+			comp_dstlenp[comp] = &hash_dstlen[i];
+			++comp;
+		}
 
 		/*
-		 * Compute hash value
+		 * Compute all the remaining hash values in one pass over the file
 		 */
-		if (crapi_mdigest_fd (fd, 1, hash_type, hash_dst, &hash_dstlen) != 0) {
-			close (fd);
-			return (-1);
+		if (comp > 0) {
+			if (crapi_mdigest_fdv (fd, comp, comp_type, comp_dstp, comp_dstlenp) != 0) {
+				close (fd);
+				return (-1);
+			}
+
+			/* don't store the values if the file changed while it was read */
+			if (cacheable && fstat (fd, &st_after) == 0
+			    && !oval_hash_cache_stat_changed (&st, &st_after))
+			{
+				for (i = 0; i < comp; ++i)
+					oval_hash_cache_put (&st, comp_type[i], comp_dstp[i], *comp_dstlenp[i]);
+			}
 		}
 
 		close (fd);
 
-		hash_str[0] = '\0';
-		mem2hex (hash_dst, hash_dstlen, hash_str, sizeof hash_str);
+		for (i = 0; i < num; ++i) {
+			hash_str[0] = '\0';
+			mem2hex (hash_dst[i], hash_dstlen[i], hash_str, sizeof hash_str);
+
+			/*
+			 * Create and add the item
+			 */
+			itm = probe_item_create(OVAL_INDEPENDENT_FILE_HASH58, NULL,
+						"filepath", OVAL_DATATYPE_STRING, pbuf,
+						"path",     OVAL_DATATYPE_STRING, p,
+						"filename", OVAL_DATATYPE_STRING, f,
+						"hash_type",OVAL_DATATYPE_STRING, h[i],
+						"hash",     OVAL_DATATYPE_STRING, hash_str,
+						NULL);
+
+			if (hash_dstlen[i] == 0) {
+				probe_item_add_msg(itm, OVAL_MESSAGE_LEVEL_ERROR,
+						   "Unable to compute %s hash value of \"%s\".", h[i], pbuf);
+				probe_item_setstatus(itm, SYSCHAR_STATUS_ERROR);
+			}
 
-		/*
-		 * Create and add the item
-		 */
-		itm = probe_item_create(OVAL_INDEPENDENT_FILE_HASH58, NULL,
-					"filepath", OVAL_DATATYPE_STRING, pbuf,
-					"path",     OVAL_DATATYPE_STRING, p,
-					"filename", OVAL_DATATYPE_STRING, f,
-					"hash_type",OVAL_DATATYPE_STRING, h,
-					"hash",     OVAL_DATATYPE_STRING, hash_str,
-					NULL);
-
-		if (hash_dstlen == 0) {
-			probe_item_add_msg(itm, OVAL_MESSAGE_LEVEL_ERROR,
-					   "Unable to compute %s hash value of \"%s\".", h, pbuf);
-			probe_item_setstatus(itm, SYSCHAR_STATUS_ERROR);
+			probe_item_collect(ctx, itm);
 		}
 	}
 
-	probe_item_collect(ctx, itm);
-
 	return (0);
 }
 
@@ -229,6 +277,9 @@ void probe_fini (void *arg)
 	 * Destroy mutex.
 	 */
 	(void) pthread_mutex_destroy (&__filehash58_probe_mutex);
+#if defined(HAVE_RPM_FILE_DIGEST)
+	rpm_file_digest_fini ();
+#endif
 
 	return;
 }
@@ -238,6 +289,9 @@ int probe_main(probe_ctx *ctx, void *mutex)
 	SEXP_t *probe_in;
 	SEXP_t *path, *filename, *behaviors, *filepath, *hash_type;
 	char hash_type_str[128];
+	const struct oscap_string_map *p;
+	const char *hash_types[sizeof CRAPI_ALG_MAP / sizeof CRAPI_ALG_MAP[0]];
+	int hash_count = 0;
 	int err = 0;
 
 	OVAL_FTS    *ofts;
@@ -281,19 +335,24 @@ int probe_main(probe_ctx *ctx, void *mutex)
 		goto cleanup;
 	}
 
-	if ((ofts = oval_fts_open(path, filename, filepath, behaviors, probe_ctx_getresult(ctx))) != NULL) {
+	/*
+	 * Find the hash types to compare with the entity, think "not satisfy".
+	 * They don't depend on the file, so do it only once.
+	 */
+	for (p = CRAPI_ALG_MAP; p->value != CRAPI_INVALID; ++p) {
+		SEXP_t *crapi_hash_type_sexp = SEXP_string_new(p->string, strlen(p->string));
+
+		if (probe_entobj_cmp(hash_type, crapi_hash_type_sexp) == OVAL_RESULT_TRUE)
+			hash_types[hash_count++] = p->string;
+
+		SEXP_free(crapi_hash_type_sexp);
+	}
+
+	if (hash_count > 0 &&
+	    (ofts = oval_fts_open(path, filename, filepath, behaviors, probe_ctx_getresult(ctx))) != NULL) {
+		oval_fts_set_prefetch(ofts);
 		while ((ofts_ent = oval_fts_read(ofts)) != NULL) {
-			/* find hash types to compare with entity, think "not satisfy" */
-			const struct oscap_string_map *p = CRAPI_ALG_MAP;
-			while (p->value != CRAPI_INVALID) {
-				SEXP_t *crapi_hash_type_sexp = SEXP_string_new(p->string, strlen(p->string));
-				if (probe_entobj_cmp(hash_type, crapi_hash_type_sexp) == OVAL_RESULT_TRUE) {
-					filehash58_cb(ofts_ent->path, ofts_ent->file, p->string, ctx);
-				}
-
-				SEXP_free(crapi_hash_type_sexp);
-				p++;
-			}
+			filehash58_cb(ofts_ent->path, ofts_ent->file, hash_count, hash_types, ctx);
 			oval_ftsent_free(ofts_ent);
 		}
 
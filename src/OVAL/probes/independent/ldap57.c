@@ -31,35 +31,386 @@
 #endif
 
 #include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
 #include <ldap.h>
 
 #include "probe-api.h"
+#include "common/alloc.h"
 #include "common/assume.h"
 #include "common/debug_priv.h"
 
-#if defined(PROBE_LDAP_MUTEX)
-# include <pthread.h>
-static pthread_mutex_t __ldap57_probe_mutex;
+/* entries per page of the paged results (RFC 2696) */
+#define LDAP57_PAGE_SIZE 256
+
+/*
+ * Connections kept for the lifetime of the probe, so that the objects
+ * querying the same server don't connect and bind again. A handle is
+ * used by one thread at a time, the threads which find all the handles
+ * to the URI busy open another one.
+ */
+struct ldap57_conn {
+        char *uri;
+        LDAP *ldp;
+        bool  busy;
+        struct ldap57_conn *next;
+};
+
+struct ldap57_pool {
+        pthread_mutex_t     lock;
+        struct ldap57_conn *conns;
+};
 
 void *probe_init(void)
 {
-        if (pthread_mutex_init(&__ldap57_probe_mutex, NULL) != 0) {
+        struct ldap57_pool *pool;
+
+        pool = oscap_calloc(1, sizeof(struct ldap57_pool));
+
+        if (pthread_mutex_init(&pool->lock, NULL) != 0) {
+                oscap_free(pool);
                 return (NULL);
         }
 
-        return (&__ldap57_probe_mutex);
+        return (pool);
+}
+
+static void ldap57_conn_free(struct ldap57_conn *conn)
+{
+        ldap_unbind_ext_s(conn->ldp, NULL, NULL);
+        oscap_free(conn->uri);
+        oscap_free(conn);
 }
 
 void probe_fini(void *arg)
 {
-        pthread_mutex_detroy(&__ldap57_probe_mutex);
+        struct ldap57_pool *pool = (struct ldap57_pool *)arg;
+        struct ldap57_conn *conn;
+
+        if (pool == NULL)
+                return;
+
+        while ((conn = pool->conns) != NULL) {
+                pool->conns = conn->next;
+                ldap57_conn_free(conn);
+        }
+
+        pthread_mutex_destroy(&pool->lock);
+        oscap_free(pool);
 }
-#endif
 
-int probe_main(probe_ctx *ctx, void *mutex)
+static struct ldap57_conn *ldap57_conn_get(struct ldap57_pool *pool, const char *uri)
+{
+        struct ldap57_conn *conn;
+        struct berval       cred = { 0, NULL };
+        int version = LDAP_VERSION3;
+        LDAP *ldp = NULL;
+
+        pthread_mutex_lock(&pool->lock);
+
+        for (conn = pool->conns; conn != NULL; conn = conn->next) {
+                if (!conn->busy && strcmp(conn->uri, uri) == 0) {
+                        conn->busy = true;
+                        break;
+                }
+        }
+
+        pthread_mutex_unlock(&pool->lock);
+
+        if (conn != NULL)
+                return (conn);
+
+        if (ldap_initialize(&ldp, uri) != LDAP_SUCCESS)
+                return (NULL);
+
+        /* the paged results control needs LDAPv3 */
+        ldap_set_option(ldp, LDAP_OPT_PROTOCOL_VERSION, &version);
+
+        /* anonymous bind, once per connection */
+        if (ldap_sasl_bind_s(ldp, NULL, LDAP_SASL_SIMPLE, &cred, NULL, NULL, NULL) != LDAP_SUCCESS) {
+                dE("Can't bind to %s", uri);
+                ldap_unbind_ext_s(ldp, NULL, NULL);
+                return (NULL);
+        }
+
+        conn = oscap_calloc(1, sizeof(struct ldap57_conn));
+        conn->uri  = oscap_strdup(uri);
+        conn->ldp  = ldp;
+        conn->busy = true;
+
+        pthread_mutex_lock(&pool->lock);
+        conn->next  = pool->conns;
+        pool->conns = conn;
+        pthread_mutex_unlock(&pool->lock);
+
+        return (conn);
+}
+
+/* return the connection to the pool, or close it if it's broken */
+static void ldap57_conn_put(struct ldap57_pool *pool, struct ldap57_conn *conn, bool broken)
 {
-        LDAP        *ldp;
-        LDAPMessage *ldpres, *entry;
+        struct ldap57_conn **link;
+
+        pthread_mutex_lock(&pool->lock);
+
+        if (broken) {
+                for (link = &pool->conns; *link != NULL; link = &(*link)->next) {
+                        if (*link == conn) {
+                                *link = conn->next;
+                                break;
+                        }
+                }
+        } else
+                conn->busy = false;
+
+        pthread_mutex_unlock(&pool->lock);
+
+        if (broken)
+                ldap57_conn_free(conn);
+}
+
+/*
+ * Collect the attributes of an entry. Returns 2 if the collected
+ * object is full.
+ */
+static int ldap57_collect_entry(probe_ctx *ctx, LDAP *ldp, LDAPMessage *entry,
+                                const char *suffix, const char *relative_dn)
+{
+        BerElement *berelm = NULL;
+        SEXP_t     *item;
+        char       *attr;
+        int         ret = 0;
+
+        attr = ldap_first_attribute(ldp, entry, &berelm);
+
+        /* XXX: pattern match filter */
+
+        while (attr != NULL) {
+                SEXP_t   *se_value = NULL;
+                ber_tag_t bertag   = LBER_DEFAULT;
+                ber_len_t berlen   = 0;
+                Sockbuf  *berbuf   = NULL;
+                SEXP_t    se_tmp_mem;
+
+                berbuf = ber_sockbuf_alloc();
+
+                /*
+                 * Prepare the value (record) entity. Collect only
+                 * primitive (i.e. simple) types.
+                 */
+                se_value = probe_ent_creat1("value", NULL, NULL);
+                probe_ent_setdatatype(se_value, OVAL_DATATYPE_RECORD);
+
+                /*
+                 * XXX: does ber_get_next() return LBER_ERROR after the last value?
+                 */
+                while ((bertag = ber_get_next(berbuf, &berlen, berelm)) != LBER_ERROR) {
+                        SEXP_t *field = NULL;
+                        oval_datatype_t field_type = OVAL_DATATYPE_UNKNOWN;
+
+                        switch(bertag & LBER_ENCODING_MASK) {
+                        case LBER_PRIMITIVE:
+                                dI("Found primitive value, bertag = %u", bertag);
+						break;
+                        case LBER_CONSTRUCTED:
+                                dW("Don't know how to handle LBER_CONSTRUCTED values");
+						/* FALLTHROUGH */
+                        default:
+                                dW("Skipping attribute value, bertag = %u", bertag);
+                                continue;
+                        }
+
+                        assume_d(bertag & LBER_PRIMITIVE, NULL);
+
+                        switch(bertag & LBER_BIG_TAG_MASK) {
+                        case LBER_BOOLEAN:
+                        {       /* LDAPTYPE_BOOLEAN */
+                                ber_int_t val = -1;
+
+                                if (ber_get_boolean(berelm, &val) == LBER_ERROR) {
+                                        dW("ber_get_boolean: LBER_ERROR");
+                                        /* XXX: set error status on field */
+                                        continue;
+                                }
+
+                                assume_d(val != -1, NULL);
+                                field = probe_ent_creat1("field", NULL, SEXP_number_newb_r(&se_tmp_mem, (bool)val));
+                                field_type = OVAL_DATATYPE_BOOLEAN;
+                                SEXP_free_r(&se_tmp_mem);
+                        }       break;
+                        case LBER_INTEGER:
+                        {       /* LDAPTYPE_INTEGER */
+                                ber_int_t val = -1;
+
+                                if (ber_get_int(berelm, &val) == LBER_ERROR) {
+                                        dW("ber_get_int: LBER_ERROR");
+                                        /* XXX: set error status on field */
+                                        continue;
+                                }
+
+                                field = probe_ent_creat1("field", NULL, SEXP_number_newi_r(&se_tmp_mem, (int)val));
+                                field_type = OVAL_DATATYPE_INTEGER;
+                                SEXP_free_r(&se_tmp_mem);
+                        }       break;
+                        case LBER_BITSTRING:
+                                /* LDAPTYPE_BIT_STRING */
+                                dW("LBER_BITSTRING: not implemented");
+                                continue;
+                        case LBER_OCTETSTRING:
+                        {       /*
+                                 * LDAPTYPE_PRINTABLE_STRING
+                                 * LDAPTYPE_NUMERIC_STRING
+                                 * LDAPTYPE_DN_STRING
+                                 * LDAPTYPE_BINARY (?)
+                                 */
+                                char *val = NULL;
+
+                                if (ber_get_stringa(berelm, &val) == LBER_ERROR) {
+                                        dW("ber_get_stringa: LBER_ERROR");
+                                        /* XXX: set error status on field */
+                                        continue;
+                                }
+
+                                assume_d(val != NULL, NULL);
+                                field = probe_ent_creat1("field", NULL, SEXP_string_new_r(&se_tmp_mem, val, strlen(val)));
+                                field_type = OVAL_DATATYPE_STRING;
+                                SEXP_free_r(&se_tmp_mem);
+                                ber_memfree(val);
+                        }       break;
+                        case LBER_NULL:
+                                /* XXX: no equivalent LDAPTYPE_? or empty */
+                                dI("LBER_NULL: skipped");
+                                continue;
+                        case LBER_ENUMERATED:
+                                /* XXX: no equivalent LDAPTYPE_? */
+                                dW("Don't know how to handle LBER_ENUMERATED type");
+                                continue;
+                        default:
+                                dW("Unknown attribute value type, bertag = %u", bertag);
+                                continue;
+                        }
+
+                        if (field != NULL) {
+                                assume_d(field_type != OVAL_DATATYPE_UNKNOWN, NULL);
+
+                                probe_ent_setdatatype(field, field_type);
+                                probe_ent_attr_add(field, "name", SEXP_string_new_r(&se_tmp_mem, attr, strlen(attr)));
+                                SEXP_list_add(se_value, field);
+                                SEXP_free_r(&se_tmp_mem);
+                                SEXP_free(field);
+                        }
+                }
+
+                ber_sockbuf_free(berbuf);
+
+                /*
+                 * Create the item
+                 */
+                item = probe_item_create(OVAL_INDEPENDENT_LDAP57, NULL,
+                                         "suffix",       OVAL_DATATYPE_STRING, suffix,
+                                         "relative_dn",  OVAL_DATATYPE_STRING, relative_dn, /* XXX: pattern match */
+                                         "attribute",    OVAL_DATATYPE_STRING, attr,
+                                         "object_class", OVAL_DATATYPE_STRING, "",
+                                         "ldaptype",     OVAL_DATATYPE_STRING, "",
+                                         NULL);
+
+                SEXP_list_add(item, se_value);
+                SEXP_free(se_value);
+
+                ldap_memfree(attr);
+
+                if (probe_item_collect(ctx, item) == 2) {
+                        ret = 2;
+                        break;
+                }
+
+                attr = ldap_next_attribute(ldp, entry, berelm);
+        }
+
+        ber_free(berelm, 0);
+
+        return (ret);
+
+
+}
+
+/*
+ * Search page by page and collect the entries of each page before the
+ * next one is requested, so at most a page of entries is held at once.
+ * Servers which don't support paging return all the entries in the first
+ * page, as the control isn't critical. Returns the result code of the
+ * search, `collected' is the number of the entries collected.
+ */
+static int ldap57_search(probe_ctx *ctx, LDAP *ldp, const char *base, int scope, char **attrs,
+                         const char *suffix, const char *relative_dn, size_t *collected)
+{
+        struct berval *cookie = NULL;
+        LDAPControl   *page_ctrl, *sctrls[2], **rctrls, *resp_ctrl;
+        LDAPMessage   *ldpres, *entry;
+        ber_int_t      total;
+        bool           full = false;
+        int            rc, err;
+
+        *collected = 0;
+
+        do {
+                rc = ldap_create_page_control(ldp, LDAP57_PAGE_SIZE, cookie, 0, &page_ctrl);
+
+                if (rc != LDAP_SUCCESS)
+                        break;
+
+                sctrls[0] = page_ctrl;
+                sctrls[1] = NULL;
+                ldpres    = NULL;
+
+                rc = ldap_search_ext_s(ldp, base, scope, NULL, attrs, 0,
+                                       sctrls, NULL /* clientctrls */, NULL /* timeout */,
+                                       0, &ldpres);
+                ldap_control_free(page_ctrl);
+
+                if (rc != LDAP_SUCCESS) {
+                        ldap_msgfree(ldpres);
+                        break;
+                }
+
+                for (entry = ldap_first_entry(ldp, ldpres); entry != NULL && !full; entry = ldap_next_entry(ldp, entry)) {
+                        full = ldap57_collect_entry(ctx, ldp, entry, suffix, relative_dn) == 2;
+                        ++(*collected);
+                }
+
+                rctrls = NULL;
+                rc = ldap_parse_result(ldp, ldpres, &err, NULL, NULL, NULL, &rctrls, 1 /* free ldpres */);
+
+                if (rc == LDAP_SUCCESS)
+                        rc = err;
+
+                ber_bvfree(cookie);
+                cookie = NULL;
+
+                if (rc == LDAP_SUCCESS && rctrls != NULL &&
+                    (resp_ctrl = ldap_control_find(LDAP_CONTROL_PAGEDRESULTS, rctrls, NULL)) != NULL)
+                {
+                        struct berval next = { 0, NULL };
+
+                        if (ldap_parse_pageresponse_control(ldp, resp_ctrl, &total, &next) == LDAP_SUCCESS &&
+                            next.bv_len > 0)
+                                cookie = ber_bvdup(&next);
+
+                        ber_memfree(next.bv_val);
+                }
+
+                ldap_controls_free(rctrls);
+        } while (rc == LDAP_SUCCESS && cookie != NULL && !full);
+
+        ber_bvfree(cookie);
+
+        return (rc);
+}
+
+int probe_main(probe_ctx *ctx, void *arg)
+{
+        struct ldap57_pool *pool = (struct ldap57_pool *)arg;
+        struct ldap57_conn *conn;
 
         SEXP_t *se_ldap_behaviors = NULL, *se_relative_dn = NULL;
         SEXP_t *se_suffix = NULL, *se_attribute = NULL;
@@ -69,18 +420,17 @@ int probe_main(probe_ctx *ctx, void *mutex)
 
         char *relative_dn = NULL;
         char *suffix = NULL, *xattribute = NULL;
-        char *uri_list, *uri, *uri_save, *attr;
+        char *uri_list, *uri, *uri_save;
 
-        int   scope;
+        int   scope, rc;
+        size_t collected;
         char  base[2048];
         char *attrs[3];
 
         bool a_pattern_match = false, rdn_pattern_match = false;
 
         /* runtime */
-#if defined(PROBE_LDAP_MUTEX)
-        assume_r(mutex != NULL, PROBE_EINIT);
-#endif
+        assume_r(pool != NULL, PROBE_EINIT);
         probe_in = probe_ctx_getobject(ctx);
         se_ldap_behaviors = probe_obj_getent(probe_in, "behaviors", 1);
 
@@ -199,190 +549,35 @@ int probe_main(probe_ctx *ctx, void *mutex)
         /*
          * Query each URI
          */
-        for (;;) {
-                char *entry_dn = NULL;
-
-                if ((uri = strtok_r(uri_list, " ,", &uri_save)) == NULL)
-                        break;
-
-                ldp = NULL;
-
-                if (ldap_initialize(&ldp, uri) != LDAP_SUCCESS)
+        for (uri = strtok_r(uri_list, " ,", &uri_save); uri != NULL;
+             uri = strtok_r(NULL, " ,", &uri_save))
+        {
+                if ((conn = ldap57_conn_get(pool, uri)) == NULL)
                         continue;
 
-                if (ldap_search_ext_s(ldp, base, scope, NULL, attrs, 0,
-                                      NULL /* serverctrls */,
-                                      NULL /* clientctrls */,
-                                      NULL /* timeout */,
-                                      0, &ldpres) != LDAP_SUCCESS)
-                {
-                        item = probe_item_creat("ldap57_item", NULL, NULL);
-
-                        probe_item_setstatus(item, SYSCHAR_STATUS_ERROR);
-                        probe_item_collect(ctx, item);
-
-                        dE("ldap_search_ext_s failed");
-                        goto fail0;
-                }
-
-                entry    = ldap_first_entry(ldp, ldpres);
-                entry_dn = ldap_get_dn(ldp, entry);
+                rc = ldap57_search(ctx, conn->ldp, base, scope, attrs, suffix, relative_dn, &collected);
 
-                while (entry != NULL) {
-                        BerElement *berelm = NULL;
+                if ((rc == LDAP_SERVER_DOWN || rc == LDAP_CONNECT_ERROR) && collected == 0) {
+                        /* the kept connection was closed by the server, reconnect once */
+                        ldap57_conn_put(pool, conn, true);
 
-                        attr = ldap_first_attribute(ldp, entry, &berelm);
-
-                        /* XXX: pattern match filter */
-
-                        while (attr != NULL) {
-                                SEXP_t   *se_value = NULL;
-                                ber_tag_t bertag   = LBER_DEFAULT;
-                                ber_len_t berlen   = 0;
-                                Sockbuf  *berbuf   = NULL;
-                                SEXP_t    se_tmp_mem;
-
-                                berbuf = ber_sockbuf_alloc();
-
-                                /*
-                                 * Prepare the value (record) entity. Collect only
-                                 * primitive (i.e. simple) types.
-                                 */
-                                se_value = probe_ent_creat1("value", NULL, NULL);
-                                probe_ent_setdatatype(se_value, OVAL_DATATYPE_RECORD);
+                        if ((conn = ldap57_conn_get(pool, uri)) == NULL)
+                                continue;
 
-                                /*
-                                 * XXX: does ber_get_next() return LBER_ERROR after the last value?
-                                 */
-                                while ((bertag = ber_get_next(berbuf, &berlen, berelm)) != LBER_ERROR) {
-                                        SEXP_t *field = NULL;
-                                        oval_datatype_t field_type = OVAL_DATATYPE_UNKNOWN;
-
-                                        switch(bertag & LBER_ENCODING_MASK) {
-                                        case LBER_PRIMITIVE:
-                                                dI("Found primitive value, bertag = %u", bertag);
-						break;
-                                        case LBER_CONSTRUCTED:
-                                                dW("Don't know how to handle LBER_CONSTRUCTED values");
-						/* FALLTHROUGH */
-                                        default:
-                                                dW("Skipping attribute value, bertag = %u", bertag);
-                                                continue;
-                                        }
-
-                                        assume_d(bertag & LBER_PRIMITIVE, NULL);
-
-                                        switch(bertag & LBER_BIG_TAG_MASK) {
-                                        case LBER_BOOLEAN:
-                                        {       /* LDAPTYPE_BOOLEAN */
-                                                ber_int_t val = -1;
-
-                                                if (ber_get_boolean(berelm, &val) == LBER_ERROR) {
-                                                        dW("ber_get_boolean: LBER_ERROR");
-                                                        /* XXX: set error status on field */
-                                                        continue;
-                                                }
-
-                                                assume_d(val != -1, NULL);
-                                                field = probe_ent_creat1("field", NULL, SEXP_number_newb_r(&se_tmp_mem, (bool)val));
-                                                field_type = OVAL_DATATYPE_BOOLEAN;
-                                                SEXP_free_r(&se_tmp_mem);
-                                        }       break;
-                                        case LBER_INTEGER:
-                                        {       /* LDAPTYPE_INTEGER */
-                                                ber_int_t val = -1;
-
-                                                if (ber_get_int(berelm, &val) == LBER_ERROR) {
-                                                        dW("ber_get_int: LBER_ERROR");
-                                                        /* XXX: set error status on field */
-                                                        continue;
-                                                }
-
-                                                field = probe_ent_creat1("field", NULL, SEXP_number_newi_r(&se_tmp_mem, (int)val));
-                                                field_type = OVAL_DATATYPE_INTEGER;
-                                                SEXP_free_r(&se_tmp_mem);
-                                        }       break;
-                                        case LBER_BITSTRING:
-                                                /* LDAPTYPE_BIT_STRING */
-                                                dW("LBER_BITSTRING: not implemented");
-                                                continue;
-                                        case LBER_OCTETSTRING:
-                                        {       /*
-                                                 * LDAPTYPE_PRINTABLE_STRING
-                                                 * LDAPTYPE_NUMERIC_STRING
-                                                 * LDAPTYPE_DN_STRING
-                                                 * LDAPTYPE_BINARY (?)
-                                                 */
-                                                char *val = NULL;
-
-                                                if (ber_get_stringa(berelm, &val) == LBER_ERROR) {
-                                                        dW("ber_get_stringa: LBER_ERROR");
-                                                        /* XXX: set error status on field */
-                                                        continue;
-                                                }
-
-                                                assume_d(val != NULL, NULL);
-                                                field = probe_ent_creat1("field", NULL, SEXP_string_new_r(&se_tmp_mem, val, strlen(val)));
-                                                field_type = OVAL_DATATYPE_STRING;
-                                                SEXP_free_r(&se_tmp_mem);
-                                                ber_memfree(val);
-                                        }       break;
-                                        case LBER_NULL:
-                                                /* XXX: no equivalent LDAPTYPE_? or empty */
-                                                dI("LBER_NULL: skipped");
-                                                continue;
-                                        case LBER_ENUMERATED:
-                                                /* XXX: no equivalent LDAPTYPE_? */
-                                                dW("Don't know how to handle LBER_ENUMERATED type");
-                                                continue;
-                                        default:
-                                                dW("Unknown attribute value type, bertag = %u", bertag);
-                                                continue;
-                                        }
-
-                                        if (field != NULL) {
-                                                assume_d(field_type != OVAL_DATATYPE_UNKNOWN, NULL);
-
-                                                probe_ent_setdatatype(field, field_type);
-                                                probe_ent_attr_add(field, "name", SEXP_string_new_r(&se_tmp_mem, attr, strlen(attr)));
-                                                SEXP_list_add(se_value, field);
-                                                SEXP_free_r(&se_tmp_mem);
-                                                SEXP_free(field);
-                                        }
-                                }
-
-                                ber_sockbuf_free(berbuf);
-
-                                /*
-                                 * Create the item
-                                 */
-                                item = probe_item_create(OVAL_INDEPENDENT_LDAP57, NULL,
-                                                         "suffix",       OVAL_DATATYPE_STRING, suffix,
-                                                         "relative_dn",  OVAL_DATATYPE_STRING, relative_dn, /* XXX: pattern match */
-                                                         "attribute",    OVAL_DATATYPE_STRING, attr,
-                                                         "object_class", OVAL_DATATYPE_STRING, "",
-                                                         "ldaptype",     OVAL_DATATYPE_STRING, "",
-                                                         NULL);
-
-                                SEXP_list_add(item, se_value);
-                                SEXP_free(se_value);
+                        rc = ldap57_search(ctx, conn->ldp, base, scope, attrs, suffix, relative_dn, &collected);
+                }
 
-                                probe_item_collect(ctx, item);
+                ldap57_conn_put(pool, conn, rc == LDAP_SERVER_DOWN || rc == LDAP_CONNECT_ERROR);
 
-                                attr = ldap_next_attribute(ldp, entry, berelm);
-                        }
+                if (rc != LDAP_SUCCESS) {
+                        item = probe_item_creat("ldap57_item", NULL, NULL);
 
-                        ber_free(berelm, 0);
-                        ldap_memfree(entry_dn);
+                        probe_item_setstatus(item, SYSCHAR_STATUS_ERROR);
+                        probe_item_collect(ctx, item);
 
-                        entry    = ldap_next_entry(ldp, entry);
-                        entry_dn = ldap_get_dn(ldp, entry);
+                        dE("ldap_search_ext_s failed: %s", ldap_err2string(rc));
+                        break;
                 }
-
-                /*
-                 * Close the LDAP connection and free resources
-                 */
-                ldap_unbind_ext_s(ldp, NULL, NULL);
         }
 
         ldap_memfree(uri_list);
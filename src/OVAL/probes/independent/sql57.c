@@ -41,21 +41,22 @@
 #include <common/bfind.h>
 #include <time.h>
 #include <errno.h>
+#include <pthread.h>
 #include <opendbx/api.h>
 
 #ifndef SQLPROBE_DEFAULT_CONNTIMEOUT
 # define SQLPROBE_DEFAULT_CONNTIMEOUT 30
 #endif
 
-void *probe_init(void)
-{
-	return (NULL);
-}
+/* maximum number of idle connections kept for later objects */
+#ifndef SQLPROBE_POOL_MAX
+# define SQLPROBE_POOL_MAX 8
+#endif
 
-void probe_fini(void *arg)
-{
-	return;
-}
+/* number of rows fetched from the server at a time */
+#ifndef SQLPROBE_FETCH_CHUNK
+# define SQLPROBE_FETCH_CHUNK 64
+#endif
 
 typedef struct {
 	char *o_engine; /* object engine  */
@@ -253,197 +254,355 @@ __fail:
 	return (-1);
 }
 
-static int dbSQL_eval(const char *engine, const char *version,
-                      const char *conn, const char *sql, probe_ctx *ctx)
+/*
+ * Idle connections, keyed by the engine and the connection string. An
+ * object takes a matching connection out of the pool and puts it back
+ * when its query is done, so that the content which runs many queries
+ * against the same database connects only once.
+ */
+typedef struct dbConn {
+	char          *engine;
+	char          *conn;
+	odbx_t        *dbh;
+	struct dbConn *next;
+} dbConn_t;
+
+static pthread_mutex_t g_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static dbConn_t *g_pool = NULL;
+static size_t    g_pool_count = 0;
+
+static void dbConn_close(odbx_t *dbh)
+{
+	odbx_unbind(dbh);
+
+	if (odbx_finish(dbh) != ODBX_ERR_SUCCESS)
+		dE("odbx_finish failed");
+}
+
+static void dbConn_free(dbConn_t *c)
+{
+	dbConn_close(c->dbh);
+	__clearmem(c->conn, strlen(c->conn));
+	oscap_free(c->conn);
+	oscap_free(c->engine);
+	oscap_free(c);
+}
+
+static odbx_t *dbConn_get(const char *engine, const char *conn)
+{
+	dbConn_t *c, **cp;
+	odbx_t   *dbh = NULL;
+
+	pthread_mutex_lock(&g_pool_lock);
+
+	for (cp = &g_pool; (c = *cp) != NULL; cp = &c->next) {
+		if (strcmp(c->engine, engine) == 0 && strcmp(c->conn, conn) == 0) {
+			*cp = c->next;
+			--g_pool_count;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&g_pool_lock);
+
+	if (c != NULL) {
+		dbh = c->dbh;
+		__clearmem(c->conn, strlen(c->conn));
+		oscap_free(c->conn);
+		oscap_free(c->engine);
+		oscap_free(c);
+	}
+
+	return (dbh);
+}
+
+static void dbConn_put(const char *engine, const char *conn, odbx_t *dbh)
+{
+	dbConn_t *c;
+
+	c = oscap_talloc(dbConn_t);
+	c->engine = strdup(engine);
+	c->conn   = strdup(conn);
+	c->dbh    = dbh;
+
+	pthread_mutex_lock(&g_pool_lock);
+
+	if (g_pool_count < SQLPROBE_POOL_MAX && c->engine != NULL && c->conn != NULL) {
+		c->next = g_pool;
+		g_pool  = c;
+		++g_pool_count;
+		c = NULL;
+	}
+
+	pthread_mutex_unlock(&g_pool_lock);
+
+	if (c != NULL) {
+		if (c->conn != NULL)
+			__clearmem(c->conn, strlen(c->conn));
+		oscap_free(c->conn);
+		oscap_free(c->engine);
+		oscap_free(c);
+		dbConn_close(dbh);
+	}
+}
+
+void *probe_init(void)
+{
+	return (NULL);
+}
+
+void probe_fini(void *arg)
 {
-	int err = -1;
+	dbConn_t *c;
+
+	while ((c = g_pool) != NULL) {
+		g_pool = c->next;
+		dbConn_free(c);
+	}
+
+	g_pool_count = 0;
+	return;
+}
+
+/*
+ * Connect to the database. Returns NULL on failure; *err is 0 if the
+ * failure was reported in the collected object.
+ */
+static odbx_t *dbConn_open(const char *engine, const char *conn, probe_ctx *ctx, int *err)
+{
+	odbx_t        *sql_dbh = NULL; /* handle */
+	dbEngineMap_t *sql_dbe; /* engine */
 	dbURIInfo_t uriInfo = { .host = NULL,
 				.port = 0,
 				.user = NULL,
 				.pass = NULL,
 				.db   = NULL};
 
+	*err = -1;
+
 	/*
 	 * parse the connection string
 	 */
 	if (dbURIInfo_parse(&uriInfo, conn) != 0) {
 		dE("Malformed connection string: %s", conn);
 		goto __exit;
-	} else {
-		int            sql_err = 0;
-		odbx_t        *sql_dbh = NULL; /* handle */
-		dbEngineMap_t *sql_dbe; /* engine */
-		odbx_result_t *sql_dbr; /* result */
-		SEXP_t        *item;
+	}
 
-		sql_dbe = oscap_bfind (engine_map, ENGINE_MAP_COUNT, sizeof(dbEngineMap_t), (char *)engine,
-				       (int(*)(void *, void *))&engine_cmp);
+	sql_dbe = oscap_bfind (engine_map, ENGINE_MAP_COUNT, sizeof(dbEngineMap_t), (char *)engine,
+			       (int(*)(void *, void *))&engine_cmp);
+
+	if (sql_dbe == NULL) {
+		SEXP_t *msg = probe_msg_creatf(OVAL_MESSAGE_LEVEL_ERROR,
+			"DB engine not found: %s", engine);
+		probe_cobj_add_msg(probe_ctx_getresult(ctx), msg);
+		SEXP_free(msg);
+		probe_cobj_set_flag(probe_ctx_getresult(ctx), SYSCHAR_FLAG_ERROR);
+		*err = 0;
+		dE("DB engine not found: %s", engine);
+		goto __exit;
+	}
 
-		if (sql_dbe == NULL) {
-			SEXP_t *msg = probe_msg_creatf(OVAL_MESSAGE_LEVEL_ERROR,
-				"DB engine not found: %s", engine);
-			probe_cobj_add_msg(probe_ctx_getresult(ctx), msg);
-			SEXP_free(msg);
-			probe_cobj_set_flag(probe_ctx_getresult(ctx), SYSCHAR_FLAG_ERROR);
-			err = 0;
-			dE("DB engine not found: %s", engine);
-			goto __exit;
-		}
+	if (sql_dbe->b_engine == NULL) {
+		SEXP_t *msg = probe_msg_creatf(OVAL_MESSAGE_LEVEL_ERROR,
+			"DB engine not supported: %s", engine);
+		probe_cobj_add_msg(probe_ctx_getresult(ctx), msg);
+		SEXP_free(msg);
+		probe_cobj_set_flag(probe_ctx_getresult(ctx), SYSCHAR_FLAG_ERROR);
+		*err = 0;
+		dE("DB engine not supported: %s", engine);
+		goto __exit;
+	}
 
-		if (sql_dbe->b_engine == NULL) {
+	int odbx_res = odbx_init (&sql_dbh, sql_dbe->b_engine,
+			uriInfo.host, uriInfo.port);
+	if (odbx_res != ODBX_ERR_SUCCESS) {
+		const char *error_msg = odbx_error(NULL, odbx_res);
+		dE("odbx_init failed: e=%s, h=%s:%s msg=%s",
+			sql_dbe->b_engine, uriInfo.host, uriInfo.port,
+			error_msg != NULL ? error_msg : "(none)");
+		if (odbx_res == -ODBX_ERR_NOTEXIST) {
 			SEXP_t *msg = probe_msg_creatf(OVAL_MESSAGE_LEVEL_ERROR,
-				"DB engine not supported: %s", engine);
+				"odbx_init failed. Please install the opendbx %s backend", engine);
 			probe_cobj_add_msg(probe_ctx_getresult(ctx), msg);
 			SEXP_free(msg);
 			probe_cobj_set_flag(probe_ctx_getresult(ctx), SYSCHAR_FLAG_ERROR);
-			err = 0;
-			dE("DB engine not supported: %s", engine);
-			goto __exit;
+			*err = 0;
+			fprintf(stderr, "Could not connect to the database. "
+				"Please install the opendbx %s backend.\n",
+				sql_dbe->b_engine);
 		}
+		sql_dbh = NULL;
+		goto __exit;
+	}
 
-		int odbx_res = odbx_init (&sql_dbh, sql_dbe->b_engine,
-				uriInfo.host, uriInfo.port);
-		if (odbx_res != ODBX_ERR_SUCCESS) {
-			const char *error_msg = odbx_error(NULL, odbx_res);
-			dE("odbx_init failed: e=%s, h=%s:%s msg=%s",
-				sql_dbe->b_engine, uriInfo.host, uriInfo.port,
-				error_msg != NULL ? error_msg : "(none)");
-			if (odbx_res == -ODBX_ERR_NOTEXIST) {
-				SEXP_t *msg = probe_msg_creatf(OVAL_MESSAGE_LEVEL_ERROR,
-					"odbx_init failed. Please install the opendbx %s backend", engine);
-				probe_cobj_add_msg(probe_ctx_getresult(ctx), msg);
-				SEXP_free(msg);
-				probe_cobj_set_flag(probe_ctx_getresult(ctx), SYSCHAR_FLAG_ERROR);
-				err = 0;
-				fprintf(stderr, "Could not connect to the database. "
-					"Please install the opendbx %s backend.\n",
-					sql_dbe->b_engine);
-			}
-			goto __exit;
+	/* set options */
+	odbx_res = odbx_bind(sql_dbh, uriInfo.db, uriInfo.user, uriInfo.pass, ODBX_BIND_SIMPLE);
+	if (odbx_res != ODBX_ERR_SUCCESS)
+	{
+		const char *error_msg = odbx_error(sql_dbh, odbx_res);
+		SEXP_t *msg = probe_msg_creatf(OVAL_MESSAGE_LEVEL_ERROR,
+			"odbx_bind failed. Could not connect to the database '%s': %s",
+			uriInfo.db, error_msg != NULL ? error_msg : "(none)");
+		probe_cobj_add_msg(probe_ctx_getresult(ctx), msg);
+		SEXP_free(msg);
+		probe_cobj_set_flag(probe_ctx_getresult(ctx), SYSCHAR_FLAG_ERROR);
+		*err = 0;
+		dE("odbx_bind failed: db=%s, u=%s, p=%s",
+		   uriInfo.db, uriInfo.user, uriInfo.pass);
+		odbx_finish(sql_dbh);
+		sql_dbh = NULL;
+		goto __exit;
+	}
+
+__exit:
+	dbURIInfo_clear(&uriInfo);
+	return (sql_dbh);
+}
+
+static SEXP_t *dbSQL_row(odbx_result_t *sql_dbr)
+{
+	SEXP_t se_tmp_mem, *field, *result;
+	const char *col_val, *col_name;
+	oval_datatype_t col_type;
+	unsigned int ci;
+
+	result = probe_ent_creat1("result", NULL, NULL);
+	probe_ent_setdatatype(result, OVAL_DATATYPE_RECORD);
+
+	for (ci = 0; ci < odbx_column_count(sql_dbr); ++ci) {
+		col_val  = odbx_field_value (sql_dbr, ci);
+		col_name = odbx_column_name (sql_dbr, ci);
+		col_type = OVAL_DATATYPE_UNKNOWN;
+		field    = NULL;
+
+		dI("Column type: %d.", odbx_column_type(sql_dbr, ci));
+		switch(odbx_column_type(sql_dbr, ci)) {
+		case ODBX_TYPE_BOOLEAN:
+			break;
+		case ODBX_TYPE_INTEGER:
+		case ODBX_TYPE_SMALLINT: {
+			char *end = NULL;
+			int   val = strtol(col_val, &end, 10);
+
+			if (val == 0 && (end == col_val))
+				dE("strtol(%s) failed", col_val);
+
+			field    = probe_ent_creat1(col_name, NULL, SEXP_number_newi_r(&se_tmp_mem, val));
+			col_type = OVAL_DATATYPE_INTEGER;
+			SEXP_free_r(&se_tmp_mem);
+
+		}       break;
+		case ODBX_TYPE_REAL:
+		case ODBX_TYPE_DOUBLE:
+		case ODBX_TYPE_FLOAT: {
+			char  *end = NULL;
+			double val = strtod(col_val, &end);
+
+			if (val == 0 && (end == col_val))
+				dE("strtod(%s) failed", col_val);
+
+			field    = probe_ent_creat1(col_name, NULL, SEXP_number_newf_r(&se_tmp_mem, val));
+			col_type = OVAL_DATATYPE_FLOAT;
+			SEXP_free_r(&se_tmp_mem);
+
+		}       break;
+		case ODBX_TYPE_CHAR:
+		case ODBX_TYPE_NCHAR:
+		case ODBX_TYPE_VARCHAR:
+		case ODBX_TYPE_CLOB:
+			field    = probe_ent_creat1(col_name, NULL, SEXP_string_new_r(&se_tmp_mem, col_val, strlen(col_val)));
+			col_type = OVAL_DATATYPE_STRING;
+			SEXP_free_r(&se_tmp_mem);
+			break;
+		case ODBX_TYPE_TIMESTAMP:
+			break;
+		default:
+			dW("Unsupported ODBX type: %d.", odbx_column_type(sql_dbr, ci));
+			break;
 		}
 
-		/* set options */
-		odbx_res = odbx_bind(sql_dbh, uriInfo.db, uriInfo.user, uriInfo.pass, ODBX_BIND_SIMPLE);
-		if (odbx_res != ODBX_ERR_SUCCESS)
-		{
-			const char *error_msg = odbx_error(sql_dbh, odbx_res);
-			SEXP_t *msg = probe_msg_creatf(OVAL_MESSAGE_LEVEL_ERROR,
-				"odbx_bind failed. Could not connect to the database '%s': %s",
-				uriInfo.db, error_msg != NULL ? error_msg : "(none)");
-			probe_cobj_add_msg(probe_ctx_getresult(ctx), msg);
-			SEXP_free(msg);
-			probe_cobj_set_flag(probe_ctx_getresult(ctx), SYSCHAR_FLAG_ERROR);
-			err = 0;
-			dE("odbx_bind failed: db=%s, u=%s, p=%s",
-			   uriInfo.db, uriInfo.user, uriInfo.pass);
-			odbx_finish(sql_dbh);
-			goto __exit;
+		if (field != NULL) {
+			probe_ent_setdatatype(field, col_type);
+
+			SEXP_list_add(result, field);
+			SEXP_free(field);
 		}
+	}
 
-		if (odbx_query(sql_dbh, sql, strlen (sql)) != ODBX_ERR_SUCCESS) {
-			dE("odbx_query failed: q=%s", sql);
-			odbx_finish(sql_dbh);
-
-			goto __exit;
-		} else {
-			sql_dbr = NULL;
-                        item    = probe_item_create(OVAL_INDEPENDENT_SQL57, NULL,
-                                                    "engine",            OVAL_DATATYPE_STRING, engine,
-                                                    "version",           OVAL_DATATYPE_STRING, version,
-                                                    "connection_string", OVAL_DATATYPE_STRING, conn,
-                                                    "sql",               OVAL_DATATYPE_STRING, sql,
-                                                    NULL);
-
-			while ((sql_err = odbx_result (sql_dbh, &sql_dbr, NULL, 0)) == ODBX_RES_ROWS) {
-				while (odbx_row_fetch(sql_dbr) == ODBX_ROW_NEXT) {
-                                        SEXP_t se_tmp_mem, *field, *result;
-                                        const char *col_val, *col_name;
-                                        oval_datatype_t col_type;
-                                        unsigned int ci;
-
-                                        result = probe_ent_creat1("result", NULL, NULL);
-                                        probe_ent_setdatatype(result, OVAL_DATATYPE_RECORD);
-
-                                        for (ci = 0; ci < odbx_column_count(sql_dbr); ++ci) {
-                                                col_val  = odbx_field_value (sql_dbr, ci);
-                                                col_name = odbx_column_name (sql_dbr, ci);
-                                                col_type = OVAL_DATATYPE_UNKNOWN;
-                                                field    = NULL;
-
-						dI("Column type: %d.", odbx_column_type(sql_dbr, ci));
-                                                switch(odbx_column_type(sql_dbr, ci)) {
-                                                case ODBX_TYPE_BOOLEAN:
-                                                        break;
-                                                case ODBX_TYPE_INTEGER:
-                                                case ODBX_TYPE_SMALLINT: {
-                                                        char *end = NULL;
-                                                        int   val = strtol(col_val, &end, 10);
-
-                                                        if (val == 0 && (end == col_val))
-                                                                dE("strtol(%s) failed", col_val);
-
-							field    = probe_ent_creat1(col_name, NULL, SEXP_number_newi_r(&se_tmp_mem, val));
-                                                        col_type = OVAL_DATATYPE_INTEGER;
-                                                        SEXP_free_r(&se_tmp_mem);
-
-                                                }       break;
-                                                case ODBX_TYPE_REAL:
-                                                case ODBX_TYPE_DOUBLE:
-                                                case ODBX_TYPE_FLOAT: {
-                                                        char  *end = NULL;
-                                                        double val = strtod(col_val, &end);
-
-                                                        if (val == 0 && (end == col_val))
-                                                                dE("strtod(%s) failed", col_val);
-
-							field    = probe_ent_creat1(col_name, NULL, SEXP_number_newf_r(&se_tmp_mem, val));
-                                                        col_type = OVAL_DATATYPE_FLOAT;
-                                                        SEXP_free_r(&se_tmp_mem);
-
-                                                }       break;
-                                                case ODBX_TYPE_CHAR:
-                                                case ODBX_TYPE_NCHAR:
-                                                case ODBX_TYPE_VARCHAR:
-						case ODBX_TYPE_CLOB:
-                                                        field    = probe_ent_creat1(col_name, NULL, SEXP_string_new_r(&se_tmp_mem, col_val, strlen(col_val)));
-                                                        col_type = OVAL_DATATYPE_STRING;
-                                                        SEXP_free_r(&se_tmp_mem);
-                                                        break;
-                                                case ODBX_TYPE_TIMESTAMP:
-                                                        break;
-						default:
-							dW("Unsupported ODBX type: %d.", odbx_column_type(sql_dbr, ci));
-							break;
-                                                }
-
-                                                if (field != NULL) {
-                                                        probe_ent_setdatatype(field, col_type);
-
-                                                        SEXP_list_add(result, field);
-                                                        SEXP_free(field);
-                                                }
-                                        }
-
-                                        SEXP_list_add(item, result);
-                                        SEXP_free(result);
-				}
-
-				odbx_result_finish(sql_dbr);
-			}
+	return (result);
+}
 
-                        probe_item_collect(ctx, item);
+static int dbSQL_eval(const char *engine, const char *version,
+                      const char *conn, const char *sql, probe_ctx *ctx)
+{
+	int            err = -1;
+	int            sql_err = 0;
+	bool           pooled;
+	odbx_t        *sql_dbh; /* handle */
+	odbx_result_t *sql_dbr; /* result */
+	SEXP_t        *item, *result;
+
+	sql_dbh = dbConn_get(engine, conn);
+	pooled  = sql_dbh != NULL;
+
+	if (sql_dbh == NULL && (sql_dbh = dbConn_open(engine, conn, ctx, &err)) == NULL)
+		return (err);
+
+	/* a pooled connection may have been closed by the server meanwhile */
+	while (odbx_query(sql_dbh, sql, strlen (sql)) != ODBX_ERR_SUCCESS) {
+		dbConn_close(sql_dbh);
+
+		if (!pooled) {
+			dE("odbx_query failed: q=%s", sql);
+			return (-1);
 		}
 
-		if (odbx_finish(sql_dbh) != ODBX_ERR_SUCCESS) {
-			dE("odbx_finish failed");
-			goto __exit;
+		dI("odbx_query failed on a pooled connection, reconnecting");
+		pooled = false;
+
+		if ((sql_dbh = dbConn_open(engine, conn, ctx, &err)) == NULL)
+			return (err);
+	}
+
+	item = probe_item_create(OVAL_INDEPENDENT_SQL57, NULL,
+				 "engine",            OVAL_DATATYPE_STRING, engine,
+				 "version",           OVAL_DATATYPE_STRING, version,
+				 "connection_string", OVAL_DATATYPE_STRING, conn,
+				 "sql",               OVAL_DATATYPE_STRING, sql,
+				 NULL);
+
+	/*
+	 * Fetch the rows in chunks and add each one to the item as it
+	 * arrives. All of the results have to be read before the
+	 * connection can be used for another query.
+	 */
+	for (;;) {
+		sql_dbr = NULL;
+		sql_err = odbx_result (sql_dbh, &sql_dbr, NULL, SQLPROBE_FETCH_CHUNK);
+
+		if (sql_err == ODBX_RES_ROWS) {
+			while (odbx_row_fetch(sql_dbr) == ODBX_ROW_NEXT) {
+				result = dbSQL_row(sql_dbr);
+				SEXP_list_add(item, result);
+				SEXP_free(result);
+			}
+		} else if (sql_err != ODBX_RES_NOROWS) {
+			break;
 		}
+
+		odbx_result_finish(sql_dbr);
 	}
 
-	err = 0;
-__exit:
-	dbURIInfo_clear(&uriInfo);
-	return (err);
+	probe_item_collect(ctx, item);
+
+	if (sql_err == ODBX_RES_DONE) {
+		dbConn_put(engine, conn, sql_dbh);
+	} else {
+		dE("odbx_result failed: %s", odbx_error(sql_dbh, sql_err));
+		dbConn_close(sql_dbh);
+	}
+
+	return (0);
 }
 
 int probe_main(probe_ctx *ctx, void *arg)
@@ -384,6 +384,7 @@ int probe_main(probe_ctx *ctx, void *arg)
 	pfd.ctx = ctx;
 
 	if ((ofts = oval_fts_open(path_ent, filename_ent, filepath_ent, behaviors_ent, probe_ctx_getresult(ctx))) != NULL) {
+		oval_fts_set_prefetch(ofts);
 		while ((ofts_ent = oval_fts_read(ofts)) != NULL) {
 			if (ofts_ent->fts_info == FTS_F
 			    || ofts_ent->fts_info == FTS_SL) {
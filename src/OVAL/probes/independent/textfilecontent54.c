@@ -36,15 +36,21 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
 #include <string.h>
+#include <ctype.h>
 #include <errno.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <limits.h>
+#include <pthread.h>
+#if defined(HAVE_SYS_MMAN_H)
+#include <sys/mman.h>
+#endif
 #if defined USE_REGEX_PCRE
-#include <pcre.h>
+#include "common/oscap_pcre.h"
 #elif defined USE_REGEX_POSIX
 #include <regex.h>
 #endif
@@ -63,11 +69,16 @@
 
 oval_schema_version_t over;
 
+/*
+ * The matched text and the subexpressions are returned as pairs of offsets
+ * into str, [beg, end), and turned into S-exps by create_item.
+ */
+#define TFC54_SUBSTRS_MAX 40
+
 #if defined USE_REGEX_PCRE
-static int get_substrings(char *str, int *ofs, pcre *re, int want_substrs, char ***substrings) {
+static int get_substrings(char *str, int str_len, int *ofs, oscap_pcre_t *re, int want_substrs, int *substrs) {
 	int i, ret, rc;
 	int ovector[60], ovector_len = sizeof (ovector) / sizeof (ovector[0]);
-	char **substrs;
 
 	// todo: max match count check
 
@@ -75,13 +86,13 @@ static int get_substrings(char *str, int *ofs, pcre *re, int want_substrs, char
 		ovector[i] = -1;
 
 #if defined(__SVR4) && defined(__sun)
-	rc = pcre_exec(re, NULL, str, strlen(str), *ofs, PCRE_NO_UTF8_CHECK, ovector, ovector_len);
+	rc = oscap_pcre_exec(re, str, str_len, *ofs, PCRE_NO_UTF8_CHECK, ovector, ovector_len);
 #else
-	rc = pcre_exec(re, NULL, str, strlen(str), *ofs, 0, ovector, ovector_len);
+	rc = oscap_pcre_exec(re, str, str_len, *ofs, 0, ovector, ovector_len);
 #endif
 
 	if (rc < -1) {
-		dE("Function pcre_exec() failed to match a regular expression with return code %d on string '%s'.", rc, str);
+		dE("Function pcre_exec() failed to match a regular expression with return code %d.", rc);
 		return rc;
 	} else if (rc == -1) {
 		/* no match */
@@ -102,33 +113,25 @@ static int get_substrings(char *str, int *ofs, pcre *re, int want_substrs, char
 		rc = ovector_len / 3;
 	}
 
-	substrs = oscap_alloc(rc * sizeof (char *));
-	for (i = 0; i < rc; ++i) {
-		int len;
-		char *buf;
-
+	for (i = 0; i < rc && ret < TFC54_SUBSTRS_MAX; ++i) {
 		if (ovector[2 * i] == -1)
 			continue;
-		len = ovector[2 * i + 1] - ovector[2 * i];
-		buf = oscap_alloc(len + 1);
-		memcpy(buf, str + ovector[2 * i], len);
-		buf[len] = '\0';
-		substrs[ret] = buf;
+		substrs[2 * ret]     = ovector[2 * i];
+		substrs[2 * ret + 1] = ovector[2 * i + 1];
 		++ret;
 	}
 
-	*substrings = substrs;
-
 	return ret;
 }
 #elif defined USE_REGEX_POSIX
-static int get_substrings(char *str, int *ofs, regex_t *re, int want_substrs, char ***substrings) {
-	int i, ret, rc;
-	regmatch_t pmatch[40];
+static int get_substrings(char *str, int str_len, int *ofs, regex_t *re, int want_substrs, int *substrs) {
+	int i, ret, rc, base;
+	regmatch_t pmatch[TFC54_SUBSTRS_MAX];
 	int pmatch_len = sizeof (pmatch) / sizeof (pmatch[0]);
-	char **substrs;
 
-	rc = regexec(re, str + *ofs, pmatch_len, pmatch, 0);
+	(void)str_len;
+	base = *ofs;
+	rc = regexec(re, str + base, pmatch_len, pmatch, 0);
 	if (rc == REG_NOMATCH) {
 		/* no match */
 		return 0;
@@ -141,36 +144,27 @@ static int get_substrings(char *str, int *ofs, regex_t *re, int want_substrs, ch
 		return 1;
 	}
 
+	/* the offsets are relative to where regexec started */
 	ret = 0;
-	substrs = oscap_alloc(pmatch_len * sizeof (char *));
 	for (i = 0; i < pmatch_len; ++i) {
-		int len;
-		char *buf;
-
 		if (pmatch[i].rm_so == -1)
 			continue;
-		len = pmatch[i].rm_eo - pmatch[i].rm_so;
-		buf = oscap_alloc(len + 1);
-		memcpy(buf, str + pmatch[i].rm_so, len);
-		buf[len] = '\0';
-		substrs[ret] = buf;
+		substrs[2 * ret]     = base + pmatch[i].rm_so;
+		substrs[2 * ret + 1] = base + pmatch[i].rm_eo;
 		++ret;
 	}
 
-	*substrings = substrs;
-
 	return ret;
 }
 #endif
 
 static SEXP_t *create_item(const char *path, const char *filename, char *pattern,
-			   int instance, char **substrs, int substr_cnt)
+			   int instance, const char *buf, const int *substrs, int substr_cnt)
 {
 	int i;
 	SEXP_t *item;
 	SEXP_t *r0;
-	SEXP_t *se_instance, *se_filepath;
-	char *text;
+	SEXP_t *se_instance, *se_filepath, *se_text;
 
         if (strlen(path) + strlen(filename) + 1 > PATH_MAX) {
                 dE("path+filename too long");
@@ -178,10 +172,9 @@ static SEXP_t *create_item(const char *path, const char *filename, char *pattern
         }
 
 	if (oval_schema_version_cmp(over, OVAL_SCHEMA_VERSION(5.4)) < 0) {
-		pattern = text = NULL;
+		pattern = NULL;
 		se_instance = NULL;
 	} else {
-		text = substrs[0];
 		se_instance = SEXP_number_newu_64((int64_t) instance);
 	}
 	if (oval_schema_version_cmp(over, OVAL_SCHEMA_VERSION(5.6)) < 0) {
@@ -190,6 +183,8 @@ static SEXP_t *create_item(const char *path, const char *filename, char *pattern
 		se_filepath = SEXP_string_newf("%s%c%s", path, FILE_SEPARATOR, filename);
 	}
 
+	se_text = SEXP_string_new(buf + substrs[0], substrs[1] - substrs[0]);
+
         item = probe_item_create(OVAL_INDEPENDENT_TEXT_FILE_CONTENT, NULL,
                                  "filepath", OVAL_DATATYPE_SEXP, se_filepath,
                                  "path",     OVAL_DATATYPE_STRING, path,
@@ -197,35 +192,413 @@ static SEXP_t *create_item(const char *path, const char *filename, char *pattern
                                  "pattern",  OVAL_DATATYPE_STRING, pattern,
                                  "instance", OVAL_DATATYPE_SEXP, se_instance,
                                  "line",     OVAL_DATATYPE_STRING, pattern,
-                                 "text",     OVAL_DATATYPE_STRING, substrs[0],
+                                 "text",     OVAL_DATATYPE_SEXP, se_text,
                                  NULL);
 
+	/*
+	 * Subexpressions are usually inside the matched text and share its
+	 * value, the others (e.g. from a lookbehind) are copied.
+	 */
 	for (i = 1; i < substr_cnt; ++i) {
-                probe_item_ent_add (item, "subexpression", NULL, r0 = SEXP_string_new (substrs[i], strlen (substrs[i])));
+		int beg = substrs[2 * i], end = substrs[2 * i + 1];
+
+		if (beg >= substrs[0] && end <= substrs[1])
+			r0 = SEXP_string_new_sub(se_text, beg - substrs[0], end - beg);
+		else
+			r0 = SEXP_string_new(buf + beg, end - beg);
+
+                probe_item_ent_add (item, "subexpression", NULL, r0);
                 SEXP_free (r0);
 	}
 
+	SEXP_free(se_text);
+
 	return item;
 }
 
 struct pfdata {
 	char *pattern;
+	char *prefix;      /* literal text each match starts with, may be NULL */
+	size_t prefix_len;
 	int re_opts;
 	SEXP_t *instance_ent;
+	bool subexprs;     /* the subexpressions are read by the content */
         probe_ctx *ctx;
 #if defined USE_REGEX_PCRE
-	pcre *compiled_regex;
+	oscap_pcre_t *compiled_regex;
 #elif defined USE_REGEX_POSIX
 	regex_t *compiled_regex;
 #endif
 };
 
+/*
+ * Regular files of this size or larger are mapped into memory instead of
+ * being read. The PCRE matcher works on a buffer of a given length, the
+ * POSIX one needs the buffer to be terminated, so it always reads.
+ */
+#if defined(HAVE_SYS_MMAN_H) && defined(USE_REGEX_PCRE)
+# define TFC54_MMAP_MIN (64 * 1024)
+#endif
+
+/*
+ * Extract the literal text which every match of the pattern has to start
+ * with. Files which don't contain it can be skipped without running the
+ * regular expression. The extraction is conservative: it stops at the
+ * first character with a special meaning, at the first non-ASCII byte,
+ * drops the last character if it's quantified and gives up on patterns
+ * with alternatives.
+ */
+static char *pattern_literal_prefix(const char *pattern, size_t *prefix_len)
+{
+	const char *p;
+	char *prefix;
+	size_t n, last;
+
+	if (strchr(pattern, '|') != NULL)
+		return NULL;
+
+	p = pattern;
+	if (*p == '^')
+		++p;
+
+	prefix = oscap_alloc(strlen(p) + 1);
+	n = 0;
+
+	while (*p != '\0') {
+		last = n;
+
+		if ((unsigned char)*p >= 0x80)
+			break;
+		if (*p == '\\') {
+			/* \d, \w, \Q, ... aren't literals, escaped punctuation is */
+			if (p[1] == '\0' || (unsigned char)p[1] >= 0x80 || isalnum((unsigned char)p[1]))
+				break;
+			prefix[n++] = p[1];
+			p += 2;
+		} else if (strchr(".[]()^$*+?{}", *p) != NULL) {
+			break;
+		} else {
+			prefix[n++] = *p++;
+		}
+
+		/* the character can occur zero times */
+		if (*p == '*' || *p == '?' || *p == '{') {
+			n = last;
+			break;
+		}
+	}
+
+	if (n == 0) {
+		oscap_free(prefix);
+		return NULL;
+	}
+
+	prefix[n] = '\0';
+	*prefix_len = n;
+
+	return prefix;
+}
+
+static bool buffer_contains(const char *buf, size_t buf_len, const char *str, size_t str_len)
+{
+	const char *p, *end;
+
+	p   = buf;
+	end = buf + buf_len;
+
+	while ((size_t)(end - p) >= str_len) {
+		p = memchr(p, str[0], (end - p) - str_len + 1);
+		if (p == NULL)
+			return false;
+		if (memcmp(p, str, str_len) == 0)
+			return true;
+		++p;
+	}
+
+	return false;
+}
+
+/*
+ * Read the whole file into a buffer which grows geometrically. This is
+ * used for files which can't be mapped, such as procfs files, whose size
+ * isn't known in advance. The buffer is always terminated.
+ */
+static ssize_t read_file(int fd, const struct stat *st, char **buffer)
+{
+	char   *buf;
+	size_t  buf_size, buf_used;
+	ssize_t ret;
+
+	buf_size = st->st_size > 0 ? (size_t)st->st_size + 1 : 4096;
+	buf_used = 0;
+	buf = oscap_alloc(buf_size);
+
+	for (;;) {
+		if (buf_used == buf_size - 1) {
+			buf_size *= 2;
+			buf = oscap_realloc(buf, buf_size);
+		}
+
+		ret = read(fd, buf + buf_used, buf_size - 1 - buf_used);
+
+		if (ret == -1) {
+			if (errno == EINTR)
+				continue;
+			oscap_free(buf);
+			return (-1);
+		}
+		if (ret == 0)
+			break;
+
+		buf_used += ret;
+	}
+
+	buf[buf_used] = '\0';
+	*buffer = buf;
+
+	return (buf_used);
+}
+
+/*
+ * SSG content has many objects against the same few files, such as
+ * /etc/ssh/sshd_config or /etc/login.defs. The objects evaluated
+ * concurrently or one after another share the content of the file: it is
+ * read once, as long as the file has the same device, inode, size and
+ * times, and each object matches its pattern against the shared buffer.
+ * Larger files and the files of unknown size aren't shared.
+ */
+#define TFC54_FCACHE_FILE  (1024 * 1024)     /* larger files aren't kept */
+#define TFC54_FCACHE_TOTAL (8 * 1024 * 1024) /* of the kept files */
+
+struct tfc54_file {
+	char   *path;
+	dev_t   dev;
+	ino_t   ino;
+	off_t   size;
+	time_t  mtime;
+	time_t  ctime;
+	char   *buf;
+	size_t  buf_len;   /* the matched part, up to the first NUL byte */
+	bool    mapped;
+	const char *failed; /* the call which failed or NULL */
+	int     error;      /* and its errno */
+	bool    ready;
+	bool    cached;
+	unsigned int refs;
+	struct tfc54_file *next;
+};
+
+static pthread_mutex_t __fcache_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  __fcache_cond = PTHREAD_COND_INITIALIZER;
+static struct tfc54_file *__fcache = NULL; /* most recently used first */
+
+static struct tfc54_file *tfc54_file_new(const char *path, const struct stat *st)
+{
+	struct tfc54_file *f;
+
+	f = oscap_calloc(1, sizeof(struct tfc54_file));
+	f->path  = oscap_strdup(path);
+	f->dev   = st->st_dev;
+	f->ino   = st->st_ino;
+	f->size  = st->st_size;
+	f->mtime = st->st_mtime;
+	f->ctime = st->st_ctime;
+	f->refs  = 1;
+
+	return (f);
+}
+
+static bool tfc54_file_same(const struct tfc54_file *f, const struct stat *st)
+{
+	return (f->dev == st->st_dev && f->ino == st->st_ino && f->size == st->st_size &&
+		f->mtime == st->st_mtime && f->ctime == st->st_ctime);
+}
+
+static void tfc54_file_load(struct tfc54_file *f)
+{
+	int fd;
+	char *nul;
+
+	fd = open(f->path, O_RDONLY);
+	if (fd == -1) {
+		f->failed = "open";
+		f->error  = errno;
+		return;
+	}
+
+#if defined(TFC54_MMAP_MIN)
+	if (f->size >= TFC54_MMAP_MIN) {
+		f->buf = mmap(NULL, f->size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		if (f->buf == MAP_FAILED) {
+			dD("mmap(%s): %s, reading the file instead.", f->path, strerror(errno));
+			f->buf = NULL;
+		} else {
+			(void)madvise(f->buf, f->size, MADV_SEQUENTIAL);
+			f->buf_len = f->size;
+			f->mapped  = true;
+		}
+	}
+#endif
+	if (f->buf == NULL) {
+		struct stat st;
+		ssize_t r;
+
+		st.st_size = f->size;
+		if ((r = read_file(fd, &st, &f->buf)) == -1) {
+			f->failed = "read";
+			f->error  = errno;
+			close(fd);
+			return;
+		}
+		f->buf_len = r;
+	}
+
+	close(fd);
+
+	/* the content was always matched as a string, up to the first NUL byte */
+	nul = memchr(f->buf, '\0', f->buf_len);
+	if (nul != NULL)
+		f->buf_len = nul - f->buf;
+}
+
+static void tfc54_file_free(struct tfc54_file *f)
+{
+#if defined(TFC54_MMAP_MIN)
+	if (f->mapped)
+		munmap(f->buf, f->size);
+	else
+#endif
+		oscap_free(f->buf);
+	oscap_free(f->path);
+	oscap_free(f);
+}
+
+/* Drop the least recently used unreferenced files over the limit. */
+static void tfc54_fcache_trim(void)
+{
+	struct tfc54_file *f, **fp;
+	size_t total = 0;
+
+	for (fp = &__fcache; (f = *fp) != NULL; ) {
+		if (total + f->size > TFC54_FCACHE_TOTAL && f->refs == 0) {
+			*fp = f->next;
+			tfc54_file_free(f);
+			continue;
+		}
+		total += f->size;
+		fp = &f->next;
+	}
+}
+
+/*
+ * Get the loaded content of the file at `path' which stat() described
+ * by `st'. The failure of the load is recorded in the returned file.
+ */
+static struct tfc54_file *tfc54_file_get(const char *path, const struct stat *st)
+{
+	struct tfc54_file *f, **fp;
+	int state;
+
+	if (st->st_size <= 0 || st->st_size > TFC54_FCACHE_FILE) {
+		f = tfc54_file_new(path, st);
+		tfc54_file_load(f);
+		return (f);
+	}
+
+	/* the waiting threads depend on the one loading the file */
+	pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &state);
+	pthread_mutex_lock(&__fcache_lock);
+
+	for (fp = &__fcache; (f = *fp) != NULL; fp = &f->next) {
+		if (strcmp(f->path, path) == 0)
+			break;
+	}
+
+	if (f != NULL) {
+		*fp = f->next;
+
+		if (tfc54_file_same(f, st)) {
+			f->next  = __fcache;
+			__fcache = f;
+			++f->refs;
+
+			while (!f->ready)
+				pthread_cond_wait(&__fcache_cond, &__fcache_lock);
+
+			pthread_mutex_unlock(&__fcache_lock);
+			pthread_setcancelstate(state, NULL);
+
+			return (f);
+		}
+
+		/* the file was changed, the current users keep the old content */
+		f->cached = false;
+		if (f->refs == 0)
+			tfc54_file_free(f);
+	}
+
+	f = tfc54_file_new(path, st);
+	f->cached = true;
+	f->next   = __fcache;
+	__fcache  = f;
+	tfc54_fcache_trim();
+
+	pthread_mutex_unlock(&__fcache_lock);
+
+	tfc54_file_load(f);
+
+	pthread_mutex_lock(&__fcache_lock);
+
+	f->ready = true;
+	pthread_cond_broadcast(&__fcache_cond);
+
+	/* a failed load is reported to the waiting objects only */
+	if (f->failed != NULL) {
+		for (fp = &__fcache; *fp != NULL; fp = &(*fp)->next) {
+			if (*fp == f) {
+				*fp = f->next;
+				f->cached = false;
+				break;
+			}
+		}
+	}
+
+	pthread_mutex_unlock(&__fcache_lock);
+	pthread_setcancelstate(state, NULL);
+
+	return (f);
+}
+
+static void tfc54_file_put(struct tfc54_file *f)
+{
+	int state;
+	bool drop;
+
+	if (!f->ready) {
+		/* not shared */
+		tfc54_file_free(f);
+		return;
+	}
+
+	pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &state);
+	pthread_mutex_lock(&__fcache_lock);
+	drop = (--f->refs == 0 && !f->cached);
+	pthread_mutex_unlock(&__fcache_lock);
+	pthread_setcancelstate(state, NULL);
+
+	if (drop)
+		tfc54_file_free(f);
+}
+
 static int process_file(const char *path, const char *file, void *arg)
 {
 	struct pfdata *pfd = (struct pfdata *) arg;
-	int ret = 0, path_len, file_len, cur_inst = 0, fd = -1, substr_cnt,
-		buf_size = 0, buf_used = 0, ofs = 0, buf_inc = 4096;
-	char *whole_path = NULL, *buf = NULL;
+	int ret = 0, path_len, file_len, cur_inst = 0, substr_cnt,
+		buf_len, ofs = 0;
+	char *whole_path = NULL, *buf;
+	size_t buf_size;
+	struct tfc54_file *content = NULL;
 	SEXP_t *next_inst = NULL;
 	struct stat st;
 
@@ -259,41 +632,31 @@ static int process_file(const char *path, const char *file, void *arg)
 	if (!S_ISREG(st.st_mode))
 		goto cleanup;
 
-	fd = open(whole_path, O_RDONLY);
-	if (fd == -1) {
-		SEXP_t *msg;
-
-		msg = probe_msg_creatf(OVAL_MESSAGE_LEVEL_ERROR, "open(): '%s' %s.", whole_path, strerror(errno));
-		probe_cobj_add_msg(probe_ctx_getresult(pfd->ctx), msg);
-		SEXP_free(msg);
+	content = tfc54_file_get(whole_path, &st);
+	if (content->failed != NULL) {
+		probe_cobj_add_msgf(probe_ctx_getresult(pfd->ctx), OVAL_MESSAGE_LEVEL_ERROR,
+				    "%s(): '%s' %s.", content->failed, whole_path, strerror(content->error));
 		probe_cobj_set_flag(probe_ctx_getresult(pfd->ctx), SYSCHAR_FLAG_ERROR);
-		ret = -1;
+		ret = strcmp(content->failed, "open") == 0 ? -1 : -2;
 		goto cleanup;
 	}
 
-	do {
-		buf_size += buf_inc;
-		buf = oscap_realloc(buf, buf_size);
-		ret = read(fd, buf + buf_used, buf_inc);
-		if (ret == -1) {
-			SEXP_t *msg;
-
-			msg = probe_msg_creatf(OVAL_MESSAGE_LEVEL_ERROR, "read(): '%s' %s.", whole_path, strerror(errno));
-			probe_cobj_add_msg(probe_ctx_getresult(pfd->ctx), msg);
-			SEXP_free(msg);
-			probe_cobj_set_flag(probe_ctx_getresult(pfd->ctx), SYSCHAR_FLAG_ERROR);
-			ret = -2;
-			goto cleanup;
-		}
-		buf_used += ret;
-	} while (ret == buf_inc);
+	buf      = content->buf;
+	buf_size = content->buf_len;
+	if (buf_size > INT_MAX) {
+		dW("File '%s' is too large, matching only its first %d bytes.", whole_path, INT_MAX);
+		buf_size = INT_MAX;
+	}
+	buf_len = buf_size;
 
-	if (buf_used == buf_size)
-		buf = realloc(buf, ++buf_size);
-	buf[buf_used++] = '\0';
+	if (pfd->prefix != NULL && !buffer_contains(buf, buf_len, pfd->prefix, pfd->prefix_len)) {
+		dD("'%s' doesn't contain '%s', skipping.", whole_path, pfd->prefix);
+		ret = 0;
+		goto cleanup;
+	}
 
 	do {
-		char **substrs;
+		int substrs[2 * TFC54_SUBSTRS_MAX];
 		int want_instance;
 
 		next_inst = SEXP_number_newi_32(cur_inst + 1);
@@ -304,15 +667,12 @@ static int process_file(const char *path, const char *file, void *arg)
 			want_instance = 0;
 
 		SEXP_free(next_inst);
-		substr_cnt = get_substrings(buf, &ofs, pfd->compiled_regex, want_instance, &substrs);
+		substr_cnt = get_substrings(buf, buf_len, &ofs, pfd->compiled_regex, want_instance, substrs);
 
 		if (substr_cnt < 0) {
-			SEXP_t *msg;
-			msg = probe_msg_creatf(OVAL_MESSAGE_LEVEL_ERROR,
+			probe_cobj_add_msgf(probe_ctx_getresult(pfd->ctx), OVAL_MESSAGE_LEVEL_ERROR,
 				"Regular expression pattern match failed in file %s with error %d.",
 				whole_path, substr_cnt);
-			probe_cobj_add_msg(probe_ctx_getresult(pfd->ctx), msg);
-			SEXP_free(msg);
 			probe_cobj_set_flag(probe_ctx_getresult(pfd->ctx), SYSCHAR_FLAG_ERROR);
 			ret = -3;
 			goto cleanup;
@@ -322,25 +682,19 @@ static int process_file(const char *path, const char *file, void *arg)
 			++cur_inst;
 
 			if (want_instance) {
-				int k;
 				SEXP_t *item;
 
-				item = create_item(path, file, pfd->pattern,
-						   cur_inst, substrs, substr_cnt);
+				item = create_item(path, file, pfd->pattern, cur_inst, buf, substrs,
+						   pfd->subexprs ? substr_cnt : 1);
 
                                 probe_item_collect(pfd->ctx, item);
-
-				for (k = 0; k < substr_cnt; ++k)
-					oscap_free(substrs[k]);
-				oscap_free(substrs);
 			}
 		}
-	} while (substr_cnt > 0 && ofs < buf_used);
+	} while (substr_cnt > 0 && ofs <= buf_len && !probe_ctx_expired(pfd->ctx));
 
  cleanup:
-	if (fd != -1)
-		close(fd);
-	oscap_free(buf);
+	if (content != NULL)
+		tfc54_file_put(content);
 	if (whole_path != NULL)
 		oscap_free(whole_path);
 
@@ -353,6 +707,23 @@ void *probe_init(void)
   return NULL;
 }
 
+void probe_fini(void *arg)
+{
+	struct tfc54_file *f;
+
+	(void)arg;
+
+	pthread_mutex_lock(&__fcache_lock);
+	while ((f = __fcache) != NULL) {
+		__fcache = f->next;
+		if (f->refs == 0)
+			tfc54_file_free(f);
+		else
+			f->cached = false;
+	}
+	pthread_mutex_unlock(&__fcache_lock);
+}
+
 int probe_main(probe_ctx *ctx, void *arg)
 {
 	SEXP_t *path_ent, *file_ent, *inst_ent, *bh_ent, *patt_ent, *filepath_ent, *probe_in;
@@ -427,6 +798,7 @@ int probe_main(probe_ctx *ctx, void *arg)
 	probe_tfc54behaviors_canonicalize(&bh_ent);
 
 	pfd.instance_ent = inst_ent;
+	pfd.subexprs     = probe_obj_entity_wanted(probe_in, "subexpression");
         pfd.ctx          = ctx;
 #if defined USE_REGEX_PCRE
 	pfd.re_opts = PCRE_UTF8;
@@ -452,8 +824,8 @@ int probe_main(probe_ctx *ctx, void *arg)
 			pfd.re_opts |= PCRE_DOTALL;
 	}
 
-	pfd.compiled_regex = pcre_compile(pfd.pattern, pfd.re_opts, &error,
-					  &errorffset, NULL);
+	pfd.compiled_regex = oscap_pcre_get(pfd.pattern, pfd.re_opts, &error,
+					    &errorffset);
 	if (pfd.compiled_regex == NULL) {
 		SEXP_t *msg;
 
@@ -463,6 +835,9 @@ int probe_main(probe_ctx *ctx, void *arg)
 		probe_cobj_set_flag(probe_ctx_getresult(pfd.ctx), SYSCHAR_FLAG_ERROR);
 		goto cleanup;
 	}
+
+	if (!(pfd.re_opts & PCRE_CASELESS))
+		pfd.prefix = pattern_literal_prefix(pfd.pattern, &pfd.prefix_len);
 #elif defined USE_REGEX_POSIX
 	pfd.re_opts = REG_EXTENDED | REG_NEWLINE;
 	r0 = probe_ent_getattrval(bh_ent, "ignore_case");
@@ -482,8 +857,12 @@ int probe_main(probe_ctx *ctx, void *arg)
 		probe_cobj_set_flag(probe_ctx_getresult(pfd.ctx), SYSCHAR_FLAG_ERROR);
 		goto cleanup;
 	}
+
+	if (!(pfd.re_opts & REG_ICASE))
+		pfd.prefix = pattern_literal_prefix(pfd.pattern, &pfd.prefix_len);
 #endif
 	if ((ofts = oval_fts_open(path_ent, file_ent, filepath_ent, bh_ent, probe_ctx_getresult(ctx))) != NULL) {
+		oval_fts_set_prefetch(ofts);
 		while ((ofts_ent = oval_fts_read(ofts)) != NULL) {
 			if (ofts_ent->fts_info == FTS_F
 			    || ofts_ent->fts_info == FTS_SL) {
@@ -504,9 +883,10 @@ int probe_main(probe_ctx *ctx, void *arg)
         SEXP_free(filepath_ent);
 	if (pfd.pattern != NULL)
 		oscap_free(pfd.pattern);
+	if (pfd.prefix != NULL)
+		oscap_free(pfd.prefix);
 #if defined USE_REGEX_PCRE
-	if (pfd.compiled_regex != NULL)
-		pcre_free(pfd.compiled_regex);
+	oscap_pcre_put(pfd.compiled_regex);
 #elif defined USE_REGEX_POSIX
 	regfree(&_re);
 #endif
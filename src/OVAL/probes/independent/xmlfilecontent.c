@@ -56,6 +56,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
+#include <pthread.h>
+#include <sys/stat.h>
 
 #include <libxml/tree.h>
 #include <libxml/parser.h>
@@ -74,9 +76,206 @@
 struct pfdata {
 	SEXP_t *filename_ent;
 	char *xpath;
+	xmlXPathCompExpr *xpath_comp;
         probe_ctx *ctx;
 };
 
+/*
+ * Parsed documents and compiled XPath expressions of the recent objects,
+ * most recently used first. Several objects often query the same large
+ * file. A thread takes an entry out of its list while using it and puts
+ * it back afterwards, so entries are never shared between threads; a
+ * thread which doesn't find an entry parses or compiles its own.
+ */
+#define XMLFC_DOC_CACHE_MAX   8
+#define XMLFC_DOC_CACHE_BYTES (128 * 1024 * 1024)
+#define XMLFC_XPATH_CACHE_MAX 32
+
+struct xmlfc_doc {
+	char *path;
+	struct stat st;
+	xmlDoc *doc;
+	struct xmlfc_doc *next;
+};
+
+struct xmlfc_xpath {
+	char *xpath;
+	xmlXPathCompExpr *comp;
+	struct xmlfc_xpath *next;
+};
+
+static pthread_mutex_t g_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct xmlfc_doc *g_docs = NULL;
+static struct xmlfc_xpath *g_xpaths = NULL;
+
+static void xmlfc_doc_free(struct xmlfc_doc *d)
+{
+	xmlFreeDoc(d->doc);
+	free(d->path);
+	free(d);
+}
+
+static bool xmlfc_stat_equal(const struct stat *a, const struct stat *b)
+{
+	return (a->st_dev == b->st_dev && a->st_ino == b->st_ino
+		&& a->st_size == b->st_size
+		&& a->st_mtim.tv_sec == b->st_mtim.tv_sec
+		&& a->st_mtim.tv_nsec == b->st_mtim.tv_nsec
+		&& a->st_ctim.tv_sec == b->st_ctim.tv_sec
+		&& a->st_ctim.tv_nsec == b->st_ctim.tv_nsec);
+}
+
+/*
+ * Get the parsed document, from the cache if the file didn't change
+ * since it was parsed. *cacheable is false if the file changed while it
+ * was being parsed.
+ */
+static xmlDoc *xmlfc_doc_get(const char *path, struct stat *st, bool *cacheable)
+{
+	struct xmlfc_doc *d, **dp;
+	struct stat st2;
+	xmlDoc *doc = NULL;
+
+	*cacheable = false;
+
+	if (stat(path, st) != 0)
+		return xmlParseFile(path);
+
+	pthread_mutex_lock(&g_cache_lock);
+	for (dp = &g_docs; (d = *dp) != NULL; dp = &d->next) {
+		if (strcmp(d->path, path) != 0)
+			continue;
+
+		*dp = d->next;
+
+		if (xmlfc_stat_equal(&d->st, st)) {
+			doc = d->doc;
+			d->doc = NULL;
+		}
+		break;
+	}
+	pthread_mutex_unlock(&g_cache_lock);
+
+	if (d != NULL) {
+		if (doc != NULL) {
+			free(d->path);
+			free(d);
+			*cacheable = true;
+			dI("Using the cached document of '%s'.", path);
+			return doc;
+		}
+		xmlfc_doc_free(d);
+	}
+
+	doc = xmlParseFile(path);
+	*cacheable = doc != NULL && stat(path, &st2) == 0 && xmlfc_stat_equal(st, &st2);
+
+	return doc;
+}
+
+/* return the document to the cache, or free it */
+static void xmlfc_doc_put(const char *path, const struct stat *st, xmlDoc *doc, bool cacheable)
+{
+	struct xmlfc_doc *d, **dp;
+	size_t count = 0;
+	off_t bytes = 0;
+
+	if (doc == NULL)
+		return;
+
+	if (!cacheable || st->st_size > XMLFC_DOC_CACHE_BYTES
+	    || (d = malloc(sizeof *d)) == NULL) {
+		xmlFreeDoc(doc);
+		return;
+	}
+
+	if ((d->path = strdup(path)) == NULL) {
+		free(d);
+		xmlFreeDoc(doc);
+		return;
+	}
+
+	d->st = *st;
+	d->doc = doc;
+
+	pthread_mutex_lock(&g_cache_lock);
+	d->next = g_docs;
+	g_docs = d;
+
+	/* drop an older copy of the same file and the least recently used ones */
+	for (dp = &g_docs->next; (d = *dp) != NULL;) {
+		if (strcmp(d->path, path) == 0
+		    || count + 1 >= XMLFC_DOC_CACHE_MAX
+		    || bytes + st->st_size + d->st.st_size > XMLFC_DOC_CACHE_BYTES) {
+			*dp = d->next;
+			xmlfc_doc_free(d);
+			continue;
+		}
+		++count;
+		bytes += d->st.st_size;
+		dp = &d->next;
+	}
+	pthread_mutex_unlock(&g_cache_lock);
+}
+
+static xmlXPathCompExpr *xmlfc_xpath_get(const char *xpath)
+{
+	struct xmlfc_xpath *x, **xp;
+	xmlXPathCompExpr *comp = NULL;
+
+	pthread_mutex_lock(&g_cache_lock);
+	for (xp = &g_xpaths; (x = *xp) != NULL; xp = &x->next) {
+		if (strcmp(x->xpath, xpath) == 0) {
+			*xp = x->next;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&g_cache_lock);
+
+	if (x != NULL) {
+		comp = x->comp;
+		free(x->xpath);
+		free(x);
+		return comp;
+	}
+
+	return xmlXPathCompile(BAD_CAST xpath);
+}
+
+static void xmlfc_xpath_put(const char *xpath, xmlXPathCompExpr *comp)
+{
+	struct xmlfc_xpath *x, **xp;
+	size_t count = 0;
+
+	if (comp == NULL)
+		return;
+
+	if ((x = malloc(sizeof *x)) == NULL || (x->xpath = strdup(xpath)) == NULL) {
+		free(x);
+		xmlXPathFreeCompExpr(comp);
+		return;
+	}
+
+	x->comp = comp;
+
+	pthread_mutex_lock(&g_cache_lock);
+	x->next = g_xpaths;
+	g_xpaths = x;
+
+	for (xp = &g_xpaths->next; (x = *xp) != NULL;) {
+		if (strcmp(x->xpath, xpath) == 0 || count + 1 >= XMLFC_XPATH_CACHE_MAX) {
+			*xp = x->next;
+			xmlXPathFreeCompExpr(x->comp);
+			free(x->xpath);
+			free(x);
+			continue;
+		}
+		++count;
+		xp = &x->next;
+	}
+	pthread_mutex_unlock(&g_cache_lock);
+}
+
 static void dummy_err_func(void * ctx, const char * msg, ...)
 {
 }
@@ -94,7 +293,22 @@ void *probe_init(void)
 
 void probe_fini(void *arg)
 {
+	struct xmlfc_doc *d;
+	struct xmlfc_xpath *x;
+
         (void)arg;
+
+	while ((d = g_docs) != NULL) {
+		g_docs = d->next;
+		xmlfc_doc_free(d);
+	}
+	while ((x = g_xpaths) != NULL) {
+		g_xpaths = x->next;
+		xmlXPathFreeCompExpr(x->comp);
+		free(x->xpath);
+		free(x);
+	}
+
 	/* deinit libxml */
 	xmlCleanupParser();
 }
@@ -110,6 +324,8 @@ static int process_file(const char *path, const char *filename, void *arg)
 	SEXP_t *item = NULL;
         SEXP_t *r0;
         char filepath[PATH_MAX+1];
+	struct stat doc_st;
+	bool doc_cacheable = false;
 
 	if (filename == NULL)
 		goto cleanup;
@@ -129,7 +345,7 @@ static int process_file(const char *path, const char *filename, void *arg)
 
 	/* evaluate xpath */
 
-	doc = xmlParseFile(whole_path);
+	doc = xmlfc_doc_get(whole_path, &doc_st, &doc_cacheable);
 	if (doc == NULL) {
                 SEXP_t *msg;
                 msg = probe_msg_creatf(OVAL_MESSAGE_LEVEL_ERROR, "Can't parse '%s'.", whole_path);
@@ -153,7 +369,8 @@ static int process_file(const char *path, const char *filename, void *arg)
 		goto cleanup;
 	}
 
-	xpath_obj = xmlXPathEvalExpression(BAD_CAST pfd->xpath, xpath_ctx);
+	if (pfd->xpath_comp != NULL)
+		xpath_obj = xmlXPathCompiledEval(pfd->xpath_comp, xpath_ctx);
 	if (xpath_obj == NULL) {
                 SEXP_t *msg;
                 msg = probe_msg_creatf(OVAL_MESSAGE_LEVEL_ERROR, "xmlXPathEvalExpression() error");
@@ -263,7 +480,7 @@ static int process_file(const char *path, const char *filename, void *arg)
 	if (xpath_ctx != NULL)
 		xmlXPathFreeContext(xpath_ctx);
 	if (doc != NULL)
-		xmlFreeDoc(doc);
+		xmlfc_doc_put(whole_path, &doc_st, doc, doc_cacheable);
 	if (whole_path != NULL)
 		free(whole_path);
 
@@ -315,8 +532,10 @@ int probe_main(probe_ctx *ctx, void *arg)
 
 	pfd.filename_ent = filename_ent;
         pfd.ctx = ctx;
+	pfd.xpath_comp = pfd.xpath != NULL ? xmlfc_xpath_get(pfd.xpath) : NULL;
 
 	if ((ofts = oval_fts_open(path_ent, filename_ent, filepath_ent, behaviors_ent, probe_ctx_getresult(ctx))) != NULL) {
+		oval_fts_set_prefetch(ofts);
 		while ((ofts_ent = oval_fts_read(ofts)) != NULL) {
 			process_file(ofts_ent->path, ofts_ent->file, &pfd);
 			oval_ftsent_free(ofts_ent);
@@ -325,6 +544,8 @@ int probe_main(probe_ctx *ctx, void *arg)
 		oval_fts_close(ofts);
 	}
 
+	if (pfd.xpath_comp != NULL)
+		xmlfc_xpath_put(pfd.xpath, pfd.xpath_comp);
         oscap_free(pfd.xpath);
         SEXP_free (path_ent);
         SEXP_free (filename_ent);
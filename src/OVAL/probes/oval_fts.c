@@ -27,6 +27,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -35,13 +36,17 @@
 #include <assume.h>
 #include <pcre.h>
 #include <libgen.h>
+#include <pthread.h>
 
 #include "fsdev.h"
 #include "_probe-api.h"
 #include "probe/entcmp.h"
 #include "alloc.h"
 #include "debug_priv.h"
+#include "ratelimit.h"
 #include "oval_fts.h"
+#include "oval_fts_cache.h"
+#include "oval_fts_prefetch.h"
 #if defined(__SVR4) && defined(__sun)
 #include "fts_sun.h"
 #include <sys/mntent.h>
@@ -93,24 +98,26 @@ static int pathlen_from_ftse(int fts_pathlen, int fts_namelen)
 	return pathlen;
 }
 
-static OVAL_FTSENT *OVAL_FTSENT_new(OVAL_FTS *ofts, FTSENT *fts_ent)
+static OVAL_FTSENT *OVAL_FTSENT_new1(OVAL_FTS *ofts, const char *path, int pathlen,
+				     int namelen, unsigned int info)
 {
 	OVAL_FTSENT *ofts_ent;
 
 	ofts_ent = oscap_talloc(OVAL_FTSENT);
 
-	ofts_ent->fts_info = fts_ent->fts_info;
+	ofts_ent->fts_info = info;
+	ofts_ent->st_valid = false;
 	if (ofts->ofts_sfilename || ofts->ofts_sfilepath) {
-		ofts_ent->path_len = pathlen_from_ftse(fts_ent->fts_pathlen, fts_ent->fts_namelen);
+		ofts_ent->path_len = pathlen_from_ftse(pathlen, namelen);
 		ofts_ent->path = oscap_alloc(ofts_ent->path_len + 1);
-		strncpy(ofts_ent->path, fts_ent->fts_path, ofts_ent->path_len);
+		strncpy(ofts_ent->path, path, ofts_ent->path_len);
 		ofts_ent->path[ofts_ent->path_len] = '\0';
 
-		ofts_ent->file_len = fts_ent->fts_namelen;
-		ofts_ent->file = strdup(fts_ent->fts_name);
+		ofts_ent->file_len = namelen;
+		ofts_ent->file = strdup(path + pathlen - namelen);
 	} else {
-		ofts_ent->path_len = fts_ent->fts_pathlen;
-		ofts_ent->path = strdup(fts_ent->fts_path);
+		ofts_ent->path_len = pathlen;
+		ofts_ent->path = strdup(path);
 
 		ofts_ent->file_len = -1;
 		ofts_ent->file = NULL;
@@ -122,6 +129,50 @@ static OVAL_FTSENT *OVAL_FTSENT_new(OVAL_FTS *ofts, FTSENT *fts_ent)
 	return (ofts_ent);
 }
 
+/*
+ * fts_number is set on entries which are followed. fts reports them again
+ * with the stat data of the target, which must not be mistaken for the
+ * lstat data of the entry itself.
+ */
+#define OVAL_FTS_FOLLOWED 1
+
+static void oval_fts_follow(FTS *fts, FTSENT *fts_ent)
+{
+	fts_ent->fts_number = OVAL_FTS_FOLLOWED;
+	fts_set(fts, fts_ent, FTS_FOLLOW);
+}
+
+static OVAL_FTSENT *OVAL_FTSENT_new(OVAL_FTS *ofts, FTSENT *fts_ent)
+{
+	OVAL_FTSENT *ofts_ent;
+
+	ofts_ent = OVAL_FTSENT_new1(ofts, fts_ent->fts_path, fts_ent->fts_pathlen,
+				    fts_ent->fts_namelen, fts_ent->fts_info);
+
+	/*
+	 * With FTS_PHYSICAL, fts has already lstat'ed everything below the
+	 * roots while reading the directories. The roots themselves are
+	 * stat'ed because of FTS_COMFOLLOW.
+	 */
+	switch (fts_ent->fts_info) {
+	case FTS_D:
+	case FTS_DNR:
+	case FTS_F:
+	case FTS_SL:
+	case FTS_SLNONE:
+	case FTS_DEFAULT:
+		if (fts_ent->fts_level > FTS_ROOTLEVEL
+		    && fts_ent->fts_number != OVAL_FTS_FOLLOWED
+		    && fts_ent->fts_statp != NULL) {
+			memcpy(&ofts_ent->st, fts_ent->fts_statp, sizeof ofts_ent->st);
+			ofts_ent->st_valid = true;
+		}
+		break;
+	}
+
+	return (ofts_ent);
+}
+
 static void OVAL_FTSENT_free(OVAL_FTSENT *ofts_ent)
 {
 	oscap_free(ofts_ent->path);
@@ -130,6 +181,27 @@ static void OVAL_FTSENT_free(OVAL_FTSENT *ofts_ent)
 	return;
 }
 
+static unsigned int oval_fts_walk_threads(void)
+{
+	const char *env;
+	unsigned long n;
+	char *end;
+
+	env = getenv(OVAL_FTS_THREADS_ENV);
+
+	if (env == NULL || *env == '\0')
+		return (0);
+
+	n = strtoul(env, &end, 10);
+
+	if (*end != '\0') {
+		dW("Invalid value of %s: '%s', using a single thread.", OVAL_FTS_THREADS_ENV, env);
+		return (0);
+	}
+
+	return (n > OVAL_FTS_THREADS_MAX ? OVAL_FTS_THREADS_MAX : (unsigned int)n);
+}
+
 #if defined(__SVR4) && defined(__sun)
 #ifndef MNTTYPE_SMB
 #define MNTTYPE_SMB	"smb"
@@ -366,19 +438,19 @@ static char *extract_fixed_path_prefix(char *path)
 
 static int badpartial_check_slash(const char *pattern)
 {
-	pcre *regex;
+	oscap_pcre_t *regex;
 	const char *errptr = NULL;
 	int errofs = 0, fb, ret;
 
-	regex = pcre_compile(pattern + 1 /* skip '^' */, 0, &errptr, &errofs, NULL);
+	regex = oscap_pcre_get(pattern + 1 /* skip '^' */, 0, &errptr, &errofs);
 	if (regex == NULL) {
 		dE("Failed to validate the pattern: pcre_compile(): "
 		   "error: '%s', error offset: %d, pattern: '%s'.\n",
 		   errofs, errptr, pattern);
 		return -1;
 	}
-	ret = pcre_fullinfo(regex, NULL, PCRE_INFO_FIRSTBYTE, &fb);
-	pcre_free(regex);
+	ret = pcre_fullinfo(regex->re, regex->extra, PCRE_INFO_FIRSTBYTE, &fb);
+	oscap_pcre_put(regex);
 	regex = NULL;
 	if (ret != 0) {
 		dE("Failed to validate the pattern: pcre_fullinfo(): "
@@ -398,7 +470,7 @@ static int badpartial_check_slash(const char *pattern)
 #define TEST_PATH1 "/"
 #define TEST_PATH2 "x"
 
-static int badpartial_transform_pattern(char *pattern, pcre **regex_out)
+static int badpartial_transform_pattern(char *pattern, oscap_pcre_t **regex_out)
 {
 	/*
 	  PCREPARTIAL(3)
@@ -423,7 +495,7 @@ static int badpartial_transform_pattern(char *pattern, pcre **regex_out)
 	const char *errptr = NULL;
 	char *s, *brkt_mark;
 	bool bracketed = false, found_regex = false;
-	pcre *regex;
+	oscap_pcre_t *regex;
 
 	/* The processing bellow builds upon the assumption that
 	   the pattern has been validated by pcre_compile() */
@@ -473,7 +545,7 @@ static int badpartial_transform_pattern(char *pattern, pcre **regex_out)
 	else
 		*s = '\0';
 
-	regex = pcre_compile(pattern, 0, &errptr, &errofs, NULL);
+	regex = oscap_pcre_get(pattern, 0, &errptr, &errofs);
 	if (regex == NULL) {
 		dW("Nonfatal failure: can't transform the pattern for partial "
 		   "match optimization, error: '%s', error offset: %d, "
@@ -481,10 +553,10 @@ static int badpartial_transform_pattern(char *pattern, pcre **regex_out)
 		return -1;
 	}
 
-	ret = pcre_exec(regex, NULL, test_path1, strlen(test_path1), 0,
+	ret = oscap_pcre_exec(regex, test_path1, strlen(test_path1), 0,
 		PCRE_PARTIAL, NULL, 0);
 	if (ret != PCRE_ERROR_PARTIAL && ret < 0) {
-		pcre_free(regex);
+		oscap_pcre_put(regex);
 		dW("Nonfatal failure: can't transform the pattern for partial "
 		   "match optimization, pcre_exec() return code: %d, pattern: "
 		   "'%s'.", ret, pattern);
@@ -500,14 +572,14 @@ static int badpartial_transform_pattern(char *pattern, pcre **regex_out)
 /* Verify that the path is usable and try to craft a regex to speed up
    the filesystem traversal. If the path to match is ill-designed, an
    ugly heuristic is employed to obtain something meaningfull. */
-static int process_pattern_match(const char *path, pcre **regex_out)
+static int process_pattern_match(const char *path, oscap_pcre_t **regex_out)
 {
 	int ret, errofs = 0;
 	char *pattern;
 	const char *test_path1 = TEST_PATH1;
 	//const char *test_path2 = TEST_PATH2;
 	const char *errptr = NULL;
-	pcre *regex;
+	oscap_pcre_t *regex;
 
 	if (path[0] != '^') {
 		/* Matching has to have a fixed starting point and thus
@@ -525,7 +597,7 @@ static int process_pattern_match(const char *path, pcre **regex_out)
 		pattern = strdup(path);
 	}
 
-	regex = pcre_compile(pattern, 0, &errptr, &errofs, NULL);
+	regex = oscap_pcre_get(pattern, 0, &errptr, &errofs);
 	if (regex == NULL) {
 		dE("Failed to validate the pattern: pcre_compile(): "
 		   "error offset: %d, error: '%s', pattern: '%s'.\n",
@@ -533,7 +605,7 @@ static int process_pattern_match(const char *path, pcre **regex_out)
 		free(pattern);
 		return -1;
 	}
-	ret = pcre_exec(regex, NULL, test_path1, strlen(test_path1), 0,
+	ret = oscap_pcre_exec(regex, test_path1, strlen(test_path1), 0,
 		PCRE_PARTIAL, NULL, 0);
 
 	switch (ret) {
@@ -549,14 +621,14 @@ static int process_pattern_match(const char *path, pcre **regex_out)
 
 		dI("pcre_exec() returned PCRE_ERROR_PARTIAL for pattern '%s' "
 		   "and test path '%s'.\n", pattern, test_path1);
-		ret = pcre_exec(regex, NULL, test_path2, strlen(test_path2),
+		ret = oscap_pcre_exec(regex, test_path2, strlen(test_path2),
 			0, PCRE_PARTIAL, NULL, 0);
 		if (ret == PCRE_ERROR_PARTIAL || ret >= 0) {
 			dE("Failed to validate the pattern: test path '%s' "
 			   "matched by pattern '%s' - the pattern is too "
 			   "general, i.e. inefficient. This could take a "
 			   "lifetime to complete.\n", test_path2, pattern);
-			pcre_free(regex);
+			oscap_pcre_put(regex);
 			free(pattern);
 			return -2;
 		}
@@ -566,7 +638,7 @@ static int process_pattern_match(const char *path, pcre **regex_out)
 		dI("pcre_exec() returned PCRE_ERROR_BADPARTIAL for pattern "
 		   "'%s' and a test path '%s'. Falling back to "
 		   "pcre_fullinfo().\n", pattern, test_path1);
-		pcre_free(regex);
+		oscap_pcre_put(regex);
 		regex = NULL;
 
 		/* Fallback to first byte check to determin if
@@ -590,7 +662,7 @@ static int process_pattern_match(const char *path, pcre **regex_out)
 		   "PCRE_ERROR_NOMATCH for pattern '%s' and a test path '%s'. "
 		   "This indicates the pattern doesn't match a leading '/'.\n",
 		   pattern, test_path1);
-		pcre_free(regex);
+		oscap_pcre_put(regex);
 		free(pattern);
 		return -2;
 	default:
@@ -604,14 +676,14 @@ static int process_pattern_match(const char *path, pcre **regex_out)
 			   their OVAL definitions that use ".*" as
 			   'path' and then uncomment this.
 
-			ret = pcre_exec(regex, NULL, test_path2, strlen(test_path2),
+			ret = oscap_pcre_exec(regex, test_path2, strlen(test_path2),
 					0, PCRE_PARTIAL, NULL, 0);
 			if (ret == PCRE_ERROR_PARTIAL || ret >= 0) {
 				dE("Failed to validate the pattern: test path '%s' "
 				   "matched by pattern '%s' - the pattern is too "
 				   "general, i.e. inefficient. This could take a "
 				   "lifetime to complete.\n", test_path2, pattern);
-				pcre_free(regex);
+				oscap_pcre_put(regex);
 				free(pattern);
 				return -2;
 			}
@@ -622,7 +694,7 @@ static int process_pattern_match(const char *path, pcre **regex_out)
 		dE("Failed to validate the pattern: pcre_exec() return "
 		   "code: %d, pattern '%s', test path '%s'.\n", ret,
 		   pattern, test_path1);
-		pcre_free(regex);
+		oscap_pcre_put(regex);
 		free(pattern);
 		return -1;
 	}
@@ -665,7 +737,7 @@ OVAL_FTS *oval_fts_open(SEXP_t *path, SEXP_t *filename, SEXP_t *filepath, SEXP_t
 
 	uint32_t path_op;
 	bool nilfilename = false;
-	pcre *regex = NULL;
+	oscap_pcre_t *regex = NULL;
 	struct stat st;
 
 	assume_d((path == NULL && filename == NULL && filepath != NULL)
@@ -814,6 +886,7 @@ OVAL_FTS *oval_fts_open(SEXP_t *path, SEXP_t *filename, SEXP_t *filepath, SEXP_t
 			   errno, strerror(errno));
 		}
 		free((void *) paths[0]);
+		oscap_pcre_put(regex);
 		return NULL;
 	}
 
@@ -829,17 +902,13 @@ OVAL_FTS *oval_fts_open(SEXP_t *path, SEXP_t *filename, SEXP_t *filepath, SEXP_t
 	if (ofts->ofts_match_path_fts == NULL || errno != 0) {
 		dE("fts_open() failed, errno: %d \"%s\".", errno, strerror(errno));
 		OVAL_FTS_free(ofts);
+		oscap_pcre_put(regex);
 		return (NULL);
 	}
 
 	ofts->ofts_recurse_path_fts_opts = rec_fts_options;
 	ofts->ofts_path_op = path_op;
-	if (regex != NULL) {
-		const char *errptr = NULL;
-
-		ofts->ofts_path_regex = regex;
-		ofts->ofts_path_regex_extra = pcre_study(regex, 0, &errptr);
-	}
+	ofts->ofts_path_regex = regex;
 
 	if (filesystem == OVAL_RECURSE_FS_LOCAL) {
 #if   defined(__SVR4) && defined(__sun)
@@ -869,16 +938,22 @@ OVAL_FTS *oval_fts_open(SEXP_t *path, SEXP_t *filename, SEXP_t *filepath, SEXP_t
 
 	ofts->recurse = recurse;
 	ofts->filesystem = filesystem;
+	ofts->ofts_walk_threads = oval_fts_walk_threads();
+	ofts->ofts_cache = oval_fts_cache_enabled();
 
 	if (path) { /* filepath == NULL */
 		ofts->ofts_spath = SEXP_ref(path); /* path entity */
-		if (!nilfilename)
+		ofts->ofts_spath_cmp = probe_entobj_new(path);
+		if (!nilfilename) {
 			ofts->ofts_sfilename = SEXP_ref(filename); /* filename entity */
+			ofts->ofts_sfilename_cmp = probe_entobj_new(filename);
+		}
 
 		ofts->max_depth = max_depth;
 		ofts->direction = direction;
 	} else { /* filepath != NULL */
 		ofts->ofts_sfilepath = SEXP_ref(filepath);
+		ofts->ofts_sfilepath_cmp = probe_entobj_new(filepath);
 	}
 
 #if defined(__SVR4) && defined(__sun)
@@ -911,16 +986,103 @@ static inline int _oval_fts_is_local(OVAL_FTS *ofts, FTSENT *fts_ent) {
 #endif
 }
 
+/* walks with the same key visit the same entries */
+static char *oval_fts_cache_key(OVAL_FTS *ofts, const char *path)
+{
+	return oscap_sprintf("%d:%d:%d:%d:%lu:%s", ofts->max_depth, ofts->recurse,
+			     ofts->filesystem, ofts->ofts_recurse_path_fts_opts,
+			     ofts->filesystem == OVAL_RECURSE_FS_DEFINED ?
+			     (unsigned long)ofts->ofts_recurse_path_devid : 0UL, path);
+}
+
+#define OVAL_FTS_REC_COLLECT 0x01 /* report the entry */
+#define OVAL_FTS_REC_SKIP    0x02 /* don't descend into the entry */
+#define OVAL_FTS_REC_FOLLOW  0x04 /* follow the symlink */
+#define OVAL_FTS_REC_ERROR   0x08 /* the filename comparison failed */
+
+/*
+ * Decide what to do with an entry met during the downward recursion. The
+ * level is the depth of the entry below the matched path, which differs
+ * from fts_level in the subtrees walked by the parallel walker.
+ */
+static int oval_fts_recurse_down_check(OVAL_FTS *ofts, FTSENT *fts_ent, int level, bool collect_dirs)
+{
+	int act = 0;
+
+	/* collect matching target */
+	if (collect_dirs) {
+		if (fts_ent->fts_info == FTS_D
+		    && (ofts->max_depth == -1 || level <= ofts->max_depth))
+			act |= OVAL_FTS_REC_COLLECT;
+	} else if (fts_ent->fts_info != FTS_D) {
+		switch (probe_entobj_match_str(ofts->ofts_sfilename_cmp, fts_ent->fts_name)) {
+		case OVAL_RESULT_TRUE:
+			act |= OVAL_FTS_REC_COLLECT;
+			break;
+		case OVAL_RESULT_ERROR:
+			act |= OVAL_FTS_REC_ERROR;
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (level > 0) { /* don't skip fts root */
+		/* limit recursion depth */
+		if (ofts->direction == OVAL_RECURSE_DIRECTION_NONE
+		    || (ofts->max_depth != -1 && level > ofts->max_depth))
+			return (act | OVAL_FTS_REC_SKIP);
+
+		/* limit recursion only to selected file types */
+		switch (fts_ent->fts_info) {
+		case FTS_D:
+			if (!(ofts->recurse & OVAL_RECURSE_DIRS))
+				return (act | OVAL_FTS_REC_SKIP);
+			break;
+		case FTS_SL:
+			if (!(ofts->recurse & OVAL_RECURSE_SYMLINKS))
+				return (act | OVAL_FTS_REC_SKIP);
+			act |= OVAL_FTS_REC_FOLLOW;
+			break;
+		default:
+			return (act);
+		}
+	}
+	if (_oval_fts_is_local(ofts, fts_ent))
+		return (act | OVAL_FTS_REC_SKIP);
+	/* don't recurse beyond the initial filesystem */
+	if (ofts->filesystem == OVAL_RECURSE_FS_DEFINED
+	    && (fts_ent->fts_info == FTS_D || fts_ent->fts_info == FTS_SL)
+	    && ofts->ofts_recurse_path_devid != fts_ent->fts_statp->st_dev)
+		return (act | OVAL_FTS_REC_SKIP);
+
+	return (act);
+}
+
+/*
+ * fts_read() within the deadline and the stat rate of the probe, errno is
+ * 0 if NULL is returned at the end of the walk
+ */
+static FTSENT *oval_fts_fts_read(FTS *fts)
+{
+	if (probe_ctx_expired(NULL)) {
+		errno = ETIMEDOUT;
+		return (NULL);
+	}
+	oscap_ratelimit_take(OSCAP_RATELIMIT_STAT, 1);
+	return fts_read(fts);
+}
+
 /* find the first matching path or filepath */
 static FTSENT *oval_fts_read_match_path(OVAL_FTS *ofts)
 {
 	FTSENT *fts_ent = NULL;
-	SEXP_t *stmp;
 	oval_result_t ores;
 
 	/* iterate until a match is found or all elements have been traversed */
 	for (;;) {
-		fts_ent = fts_read(ofts->ofts_match_path_fts);
+		/* past the deadline of the object, as if all were traversed */
+		fts_ent = oval_fts_fts_read(ofts->ofts_match_path_fts);
 		if (fts_ent == NULL)
 			return NULL;
 		switch (fts_ent->fts_info) {
@@ -943,7 +1105,7 @@ static FTSENT *oval_fts_read_match_path(OVAL_FTS *ofts)
 #if defined(OSCAP_FTS_DEBUG)
 			dI("Only the target of a symlink gets reported, skipping '%s'.", fts_ent->fts_path, fts_ent->fts_name);
 #endif
-			fts_set(ofts->ofts_match_path_fts, fts_ent, FTS_FOLLOW);
+			oval_fts_follow(ofts->ofts_match_path_fts, fts_ent);
 			continue;
 		}
 		if (_oval_fts_is_local(ofts, fts_ent)) {
@@ -963,7 +1125,7 @@ static FTSENT *oval_fts_read_match_path(OVAL_FTS *ofts)
 		if (ofts->ofts_path_regex != NULL && fts_ent->fts_info == FTS_D) {
 			int ret, svec[3];
 
-			ret = pcre_exec(ofts->ofts_path_regex, ofts->ofts_path_regex_extra,
+			ret = oscap_pcre_exec(ofts->ofts_path_regex,
 					fts_ent->fts_path, fts_ent->fts_pathlen, 0, PCRE_PARTIAL,
 					svec, sizeof(svec) / sizeof(svec[0]));
 			if (ret < 0) {
@@ -986,14 +1148,12 @@ static FTSENT *oval_fts_read_match_path(OVAL_FTS *ofts)
 		    || (!ofts->ofts_sfilepath && fts_ent->fts_info != FTS_D))
 			continue;
 
-		stmp = SEXP_string_newf("%s", fts_ent->fts_path);
 		if (ofts->ofts_sfilepath)
 			/* try to match filepath */
-			ores = probe_entobj_cmp(ofts->ofts_sfilepath, stmp);
+			ores = probe_entobj_match_str(ofts->ofts_sfilepath_cmp, fts_ent->fts_path);
 		else
 			/* try to match path */
-			ores = probe_entobj_cmp(ofts->ofts_spath, stmp);
-		SEXP_free(stmp);
+			ores = probe_entobj_match_str(ofts->ofts_spath_cmp, fts_ent->fts_path);
 
 		if (ores == OVAL_RESULT_TRUE)
 			break;
@@ -1062,17 +1222,39 @@ static FTSENT *oval_fts_read_recurse_path(OVAL_FTS *ofts)
 				}
 				return (NULL);
 			}
+
+			if (ofts->ofts_cache && ofts->direction == OVAL_RECURSE_DIRECTION_DOWN) {
+				char *key = oval_fts_cache_key(ofts, paths[0]);
+
+				ofts->ofts_cache_rec = oval_fts_cache_record(key);
+				oscap_free(key);
+			}
 		}
 
 		/* iterate until a match is found or all elements have been traversed */
 		while (out_fts_ent == NULL) {
 			FTSENT *fts_ent;
+			int act;
 
-			fts_ent = fts_read(ofts->ofts_recurse_path_fts);
+			fts_ent = oval_fts_fts_read(ofts->ofts_recurse_path_fts);
 			if (fts_ent == NULL) {
+				int err = errno;
+
 				fts_close(ofts->ofts_recurse_path_fts);
 				ofts->ofts_recurse_path_fts = NULL;
 
+				/*
+				 * the walk is complete, keep it for the next objects,
+				 * unless it was cut short by the deadline or an error
+				 */
+				if (ofts->ofts_cache_rec != NULL) {
+					if (err == 0)
+						oval_fts_cache_record_commit(ofts->ofts_cache_rec);
+					else
+						oval_fts_cache_record_discard(ofts->ofts_cache_rec);
+					ofts->ofts_cache_rec = NULL;
+				}
+
 				return NULL;
 			}
 
@@ -1092,72 +1274,24 @@ static FTSENT *oval_fts_read_recurse_path(OVAL_FTS *ofts)
 			   fts_ent->fts_name, fts_ent->fts_namelen, fts_ent->fts_info);
 #endif
 
-			/* collect matching target */
-			if (collect_dirs) {
-				if (fts_ent->fts_info == FTS_D
-				    && (ofts->max_depth == -1 || fts_ent->fts_level <= ofts->max_depth))
-					out_fts_ent = fts_ent;
-			} else {
-				if (fts_ent->fts_info != FTS_D) {
-					SEXP_t *stmp;
-
-					stmp = SEXP_string_newf("%s", fts_ent->fts_name);
-					oval_result_t result = probe_entobj_cmp(ofts->ofts_sfilename, stmp);
-					switch (result){
-						case OVAL_RESULT_TRUE:
-							out_fts_ent = fts_ent;
-							break;
-
-						case OVAL_RESULT_ERROR:
-							probe_cobj_set_flag(ofts->result, SYSCHAR_FLAG_ERROR);
-							break;
-
-						default:
-							break;
-					}
-
-					SEXP_free(stmp);
-				}
+			if (ofts->ofts_cache_rec != NULL
+			    && oval_fts_cache_record_add(ofts->ofts_cache_rec, fts_ent, fts_ent->fts_level) != 0) {
+				dI("The walk of '%s' is too large to be cached.",
+				   ofts->ofts_match_path_fts_ent->fts_path);
+				oval_fts_cache_record_discard(ofts->ofts_cache_rec);
+				ofts->ofts_cache_rec = NULL;
 			}
 
-			if (fts_ent->fts_level > 0) { /* don't skip fts root */
-				/* limit recursion depth */
-				if (ofts->direction == OVAL_RECURSE_DIRECTION_NONE
-				    || (ofts->max_depth != -1 && fts_ent->fts_level > ofts->max_depth)) {
-					fts_set(ofts->ofts_recurse_path_fts, fts_ent, FTS_SKIP);
-					continue;
-				}
+			act = oval_fts_recurse_down_check(ofts, fts_ent, fts_ent->fts_level, collect_dirs);
 
-				/* limit recursion only to selected file types */
-				switch (fts_ent->fts_info) {
-				case FTS_D:
-					if (!(ofts->recurse & OVAL_RECURSE_DIRS)) {
-						fts_set(ofts->ofts_recurse_path_fts, fts_ent, FTS_SKIP);
-						continue;
-					}
-					break;
-				case FTS_SL:
-					if (!(ofts->recurse & OVAL_RECURSE_SYMLINKS)) {
-						fts_set(ofts->ofts_recurse_path_fts, fts_ent, FTS_SKIP);
-						continue;
-					}
-					fts_set(ofts->ofts_recurse_path_fts, fts_ent, FTS_FOLLOW);
-					break;
-				default:
-					continue;
-				}
-			}
-			if (_oval_fts_is_local(ofts, fts_ent)) {
-				fts_set(ofts->ofts_recurse_path_fts, fts_ent, FTS_SKIP);
-				continue;
-			}
-			/* don't recurse beyond the initial filesystem */
-			if (ofts->filesystem == OVAL_RECURSE_FS_DEFINED
-			    && (fts_ent->fts_info == FTS_D || fts_ent->fts_info == FTS_SL)
-			    && ofts->ofts_recurse_path_devid != fts_ent->fts_statp->st_dev) {
+			if (act & OVAL_FTS_REC_ERROR)
+				probe_cobj_set_flag(ofts->result, SYSCHAR_FLAG_ERROR);
+			if (act & OVAL_FTS_REC_COLLECT)
+				out_fts_ent = fts_ent;
+			if (act & OVAL_FTS_REC_SKIP)
 				fts_set(ofts->ofts_recurse_path_fts, fts_ent, FTS_SKIP);
-				continue;
-			}
+			else if (act & OVAL_FTS_REC_FOLLOW)
+				oval_fts_follow(ofts->ofts_recurse_path_fts, fts_ent);
 		}
 
 		break;
@@ -1203,7 +1337,7 @@ static FTSENT *oval_fts_read_recurse_path(OVAL_FTS *ofts)
 			while (out_fts_ent == NULL) {
 				FTSENT *fts_ent;
 
-				fts_ent = fts_read(ofts->ofts_recurse_path_fts);
+				fts_ent = oval_fts_fts_read(ofts->ofts_recurse_path_fts);
 				if (fts_ent == NULL)
 					break;
 
@@ -1242,17 +1376,13 @@ static FTSENT *oval_fts_read_recurse_path(OVAL_FTS *ofts)
 					}
 				} else {
 					if (fts_ent->fts_info != FTS_D) {
-						SEXP_t *stmp;
-
-						stmp = SEXP_string_newf("%s", fts_ent->fts_name);
-						if (probe_entobj_cmp(ofts->ofts_sfilename, stmp) == OVAL_RESULT_TRUE)
+						if (probe_entobj_match_str(ofts->ofts_sfilename_cmp, fts_ent->fts_name) == OVAL_RESULT_TRUE)
 							out_fts_ent = fts_ent;
-						SEXP_free(stmp);
 					}
 				}
 
 				if (fts_ent->fts_info == FTS_SL)
-					fts_set(ofts->ofts_recurse_path_fts, fts_ent, FTS_FOLLOW);
+					oval_fts_follow(ofts->ofts_recurse_path_fts, fts_ent);
 				/* limit recursion only to fts root */
 				else if (fts_ent->fts_level > 0)
 					fts_set(ofts->ofts_recurse_path_fts, fts_ent, FTS_SKIP);
@@ -1282,16 +1412,456 @@ static FTSENT *oval_fts_read_recurse_path(OVAL_FTS *ofts)
 	return out_fts_ent;
 }
 
-OVAL_FTSENT *oval_fts_read(OVAL_FTS *ofts)
+/*
+ * Parallel downward recursion
+ *
+ * The subtree below a matched path is walked by a pool of threads, each
+ * running its own fts over a part of the tree. A thread which is about to
+ * descend into a directory while other threads are idle queues the
+ * directory as a new task instead. The entries are checked with the same
+ * rules as in oval_fts_read_recurse_path() and queued for oval_fts_read(),
+ * only their order differs.
+ */
+#define OVAL_FTS_WALK_QUEUE_MAX 4096
+
+struct oval_fts_devino {
+	dev_t dev;
+	ino_t ino;
+};
+
+struct oval_fts_task {
+	struct oval_fts_task *next;
+	char *path;
+	int level;                    /* depth of the path below the matched path */
+	size_t anc_count;
+	struct oval_fts_devino *anc;  /* directories above the path, for cycle detection */
+};
+
+struct oval_fts_walk {
+	OVAL_FTS *ofts;
+	bool collect_dirs;
+	uint64_t deadline;            /* of the object, see probe_ctx_expired() */
+
+	pthread_mutex_t lock;
+	pthread_cond_t work_cond;     /* a task was queued or the walk ended */
+	pthread_cond_t ent_cond;      /* an entry was queued or the walk ended */
+	pthread_cond_t room_cond;     /* an entry was taken from the queue */
+
+	struct oval_fts_task *tasks;
+	size_t task_count;
+	unsigned int idle;            /* threads waiting for a task */
+	unsigned int busy;            /* threads walking a subtree */
+
+	OVAL_FTSENT *ents[OVAL_FTS_WALK_QUEUE_MAX];
+	size_t ent_head;
+	size_t ent_count;
+
+	bool error;
+	bool abort;
+	bool done;
+
+	unsigned int nthreads;
+	pthread_t *threads;
+};
+
+static void oval_fts_task_free(struct oval_fts_task *task)
+{
+	free(task->path);
+	if (task->anc != NULL)
+		oscap_free(task->anc);
+	oscap_free(task);
+}
+
+static bool oval_fts_task_cycle(struct oval_fts_task *task, FTSENT *fts_ent)
+{
+	size_t i;
+
+	for (i = 0; i < task->anc_count; ++i)
+		if (task->anc[i].dev == fts_ent->fts_statp->st_dev
+		    && task->anc[i].ino == fts_ent->fts_statp->st_ino)
+			return (true);
+
+	return (false);
+}
+
+static struct oval_fts_task *oval_fts_task_new(struct oval_fts_task *parent, FTSENT *fts_ent)
 {
+	struct oval_fts_task *task;
+	FTSENT *p;
+	size_t n;
+
+	task = oscap_talloc(struct oval_fts_task);
+	task->next = NULL;
+	task->path = strdup(fts_ent->fts_path);
+	task->level = parent->level + fts_ent->fts_level;
+	task->anc_count = parent->anc_count + fts_ent->fts_level + 1;
+	task->anc = oscap_alloc(task->anc_count * sizeof(struct oval_fts_devino));
+
+	if (parent->anc_count > 0)
+		memcpy(task->anc, parent->anc, parent->anc_count * sizeof(struct oval_fts_devino));
+
+	n = parent->anc_count;
+
+	for (p = fts_ent; p != NULL && p->fts_level >= FTS_ROOTLEVEL; p = p->fts_parent) {
+		task->anc[n].dev = p->fts_statp->st_dev;
+		task->anc[n].ino = p->fts_statp->st_ino;
+		++n;
+	}
+
+	task->anc_count = n;
+	return (task);
+}
+
+/*
+ * Hand the directory over to an idle thread. Returns 1 if it was queued,
+ * 0 if the caller should descend into it itself and -1 if the walk was
+ * aborted.
+ */
+static int oval_fts_walk_share(struct oval_fts_walk *walk, struct oval_fts_task *task, FTSENT *fts_ent)
+{
+	int ret = 0;
+
+	pthread_mutex_lock(&walk->lock);
+
+	if (walk->abort) {
+		ret = -1;
+	} else if (walk->idle > walk->task_count) {
+		struct oval_fts_task *sub;
+
+		sub = oval_fts_task_new(task, fts_ent);
+		sub->next = walk->tasks;
+		walk->tasks = sub;
+		walk->task_count++;
+
+		pthread_cond_signal(&walk->work_cond);
+		ret = 1;
+	}
+
+	pthread_mutex_unlock(&walk->lock);
+	return (ret);
+}
+
+static int oval_fts_walk_emit(struct oval_fts_walk *walk, FTSENT *fts_ent)
+{
+	OVAL_FTSENT *ofts_ent;
+
+	ofts_ent = OVAL_FTSENT_new(walk->ofts, fts_ent);
+
+	pthread_mutex_lock(&walk->lock);
+
+	while (walk->ent_count == OVAL_FTS_WALK_QUEUE_MAX && !walk->abort)
+		pthread_cond_wait(&walk->room_cond, &walk->lock);
+
+	if (walk->abort) {
+		pthread_mutex_unlock(&walk->lock);
+		OVAL_FTSENT_free(ofts_ent);
+		return (-1);
+	}
+
+	walk->ents[(walk->ent_head + walk->ent_count) % OVAL_FTS_WALK_QUEUE_MAX] = ofts_ent;
+	walk->ent_count++;
+
+	pthread_cond_signal(&walk->ent_cond);
+	pthread_mutex_unlock(&walk->lock);
+
+	return (0);
+}
+
+static void oval_fts_walk_subtree(struct oval_fts_walk *walk, struct oval_fts_task *task)
+{
+	OVAL_FTS *ofts = walk->ofts;
+	char * const paths[2] = { task->path, NULL };
+	FTS *fts;
 	FTSENT *fts_ent;
 
-#if defined(OSCAP_FTS_DEBUG)
-	dI("ofts: %p.", ofts);
-#endif
+	/* reset errno as fts_open() doesn't do it itself. */
+	errno = 0;
+	fts = fts_open(paths, ofts->ofts_recurse_path_fts_opts, NULL);
+
+	if (fts == NULL || errno != 0) {
+		dE("fts_open() failed, errno: %d \"%s\", path: \"%s\".",
+		   errno, strerror(errno), task->path);
+		if (fts != NULL)
+			fts_close(fts);
+		return;
+	}
 
-	if (ofts == NULL)
-		return NULL;
+	while ((walk->deadline == 0 || probe_deadline_now() < walk->deadline)
+	       && (fts_ent = fts_read(fts)) != NULL) {
+		int act;
+
+		oscap_ratelimit_take(OSCAP_RATELIMIT_STAT, 1);
+
+		switch (fts_ent->fts_info) {
+		case FTS_DP:
+			continue;
+		case FTS_DC:
+			dW("Filesystem tree cycle detected at '%s'.", fts_ent->fts_path);
+			fts_set(fts, fts_ent, FTS_SKIP);
+			continue;
+		}
+
+		if (fts_ent->fts_level == FTS_ROOTLEVEL && task->level > 0) {
+			/* already checked by the thread which queued the task */
+			continue;
+		}
+
+		if (fts_ent->fts_info == FTS_D && oval_fts_task_cycle(task, fts_ent)) {
+			dW("Filesystem tree cycle detected at '%s'.", fts_ent->fts_path);
+			fts_set(fts, fts_ent, FTS_SKIP);
+			continue;
+		}
+
+		act = oval_fts_recurse_down_check(ofts, fts_ent, task->level + fts_ent->fts_level,
+						  walk->collect_dirs);
+
+		if (act & OVAL_FTS_REC_ERROR) {
+			pthread_mutex_lock(&walk->lock);
+			walk->error = true;
+			pthread_mutex_unlock(&walk->lock);
+		}
+		if (act & OVAL_FTS_REC_COLLECT) {
+			if (oval_fts_walk_emit(walk, fts_ent) != 0)
+				break;
+		}
+		if (act & OVAL_FTS_REC_SKIP) {
+			fts_set(fts, fts_ent, FTS_SKIP);
+		} else if (act & OVAL_FTS_REC_FOLLOW) {
+			oval_fts_follow(fts, fts_ent);
+		} else if (fts_ent->fts_info == FTS_D && fts_ent->fts_level > FTS_ROOTLEVEL) {
+			int ret = oval_fts_walk_share(walk, task, fts_ent);
+
+			if (ret < 0)
+				break;
+			if (ret > 0)
+				fts_set(fts, fts_ent, FTS_SKIP);
+		}
+	}
+
+	fts_close(fts);
+}
+
+static void *oval_fts_walk_worker(void *arg)
+{
+	struct oval_fts_walk *walk = (struct oval_fts_walk *)arg;
+	struct oval_fts_task *task;
+
+	pthread_mutex_lock(&walk->lock);
+
+	for (;;) {
+		while (walk->tasks == NULL && walk->busy > 0 && !walk->abort) {
+			walk->idle++;
+			pthread_cond_wait(&walk->work_cond, &walk->lock);
+			walk->idle--;
+		}
+
+		if (walk->abort || walk->tasks == NULL)
+			break;
+
+		task = walk->tasks;
+		walk->tasks = task->next;
+		walk->task_count--;
+		walk->busy++;
+
+		pthread_mutex_unlock(&walk->lock);
+		oval_fts_walk_subtree(walk, task);
+		oval_fts_task_free(task);
+		pthread_mutex_lock(&walk->lock);
+
+		walk->busy--;
+	}
+
+	/* nothing left to walk, wake up the others and the consumer */
+	walk->done = true;
+	pthread_cond_broadcast(&walk->work_cond);
+	pthread_cond_broadcast(&walk->ent_cond);
+	pthread_mutex_unlock(&walk->lock);
+
+	return (NULL);
+}
+
+static void oval_fts_walk_free(struct oval_fts_walk *walk)
+{
+	unsigned int i;
+
+	pthread_mutex_lock(&walk->lock);
+	walk->abort = true;
+	pthread_cond_broadcast(&walk->work_cond);
+	pthread_cond_broadcast(&walk->room_cond);
+	pthread_mutex_unlock(&walk->lock);
+
+	for (i = 0; i < walk->nthreads; ++i)
+		pthread_join(walk->threads[i], NULL);
+
+	while (walk->tasks != NULL) {
+		struct oval_fts_task *task = walk->tasks;
+
+		walk->tasks = task->next;
+		oval_fts_task_free(task);
+	}
+
+	for (; walk->ent_count > 0; walk->ent_count--) {
+		OVAL_FTSENT_free(walk->ents[walk->ent_head]);
+		walk->ent_head = (walk->ent_head + 1) % OVAL_FTS_WALK_QUEUE_MAX;
+	}
+
+	pthread_cond_destroy(&walk->room_cond);
+	pthread_cond_destroy(&walk->ent_cond);
+	pthread_cond_destroy(&walk->work_cond);
+	pthread_mutex_destroy(&walk->lock);
+
+	oscap_free(walk->threads);
+	oscap_free(walk);
+}
+
+static struct oval_fts_walk *oval_fts_walk_new(OVAL_FTS *ofts, const char *path)
+{
+	struct oval_fts_walk *walk;
+	struct oval_fts_task *root;
+	unsigned int i;
+
+	walk = oscap_talloc(struct oval_fts_walk);
+	memset(walk, 0, sizeof(*walk));
+
+	walk->ofts = ofts;
+	/* the condition below is correct because ofts_sfilepath is NULL here */
+	walk->collect_dirs = (ofts->ofts_sfilename == NULL);
+	/* the deadline is attached to the thread of the probe */
+	walk->deadline = probe_deadline_get();
+
+	pthread_mutex_init(&walk->lock, NULL);
+	pthread_cond_init(&walk->work_cond, NULL);
+	pthread_cond_init(&walk->ent_cond, NULL);
+	pthread_cond_init(&walk->room_cond, NULL);
+
+	root = oscap_talloc(struct oval_fts_task);
+	memset(root, 0, sizeof(*root));
+	root->path = strdup(path);
+
+	walk->tasks = root;
+	walk->task_count = 1;
+	walk->threads = oscap_alloc(ofts->ofts_walk_threads * sizeof(pthread_t));
+
+	for (i = 0; i < ofts->ofts_walk_threads; ++i) {
+		int err = pthread_create(&walk->threads[i], NULL, oval_fts_walk_worker, walk);
+
+		if (err != 0) {
+			dE("Can't start a directory walker thread: %s.", strerror(err));
+			break;
+		}
+		walk->nthreads++;
+	}
+
+	if (walk->nthreads == 0) {
+		oval_fts_walk_free(walk);
+		return (NULL);
+	}
+
+	dI("Walking '%s' with %u threads.", path, walk->nthreads);
+	return (walk);
+}
+
+/* get the next entry found by the walker threads */
+static OVAL_FTSENT *oval_fts_read_walk(OVAL_FTS *ofts)
+{
+	struct oval_fts_walk *walk;
+	OVAL_FTSENT *ofts_ent = NULL;
+	bool error;
+
+	if (ofts->ofts_walk == NULL) {
+		ofts->ofts_walk = oval_fts_walk_new(ofts, ofts->ofts_match_path_fts_ent->fts_path);
+		if (ofts->ofts_walk == NULL)
+			return (NULL);
+	}
+
+	walk = ofts->ofts_walk;
+	pthread_mutex_lock(&walk->lock);
+
+	while (walk->ent_count == 0 && !walk->done)
+		pthread_cond_wait(&walk->ent_cond, &walk->lock);
+
+	if (walk->ent_count > 0) {
+		ofts_ent = walk->ents[walk->ent_head];
+		walk->ent_head = (walk->ent_head + 1) % OVAL_FTS_WALK_QUEUE_MAX;
+		walk->ent_count--;
+		pthread_cond_signal(&walk->room_cond);
+	}
+
+	error = walk->error;
+	walk->error = false;
+	pthread_mutex_unlock(&walk->lock);
+
+	if (error)
+		probe_cobj_set_flag(ofts->result, SYSCHAR_FLAG_ERROR);
+
+	if (ofts_ent == NULL) {
+		oval_fts_walk_free(walk);
+		ofts->ofts_walk = NULL;
+	}
+
+	return (ofts_ent);
+}
+
+/*
+ * Start replaying a cached walk of the matched path if there is a valid
+ * one.
+ */
+static bool oval_fts_replay_start(OVAL_FTS *ofts)
+{
+	char *key;
+
+	if (!ofts->ofts_cache || ofts->direction != OVAL_RECURSE_DIRECTION_DOWN
+	    || ofts->ofts_recurse_path_fts != NULL || ofts->ofts_walk != NULL)
+		return (false);
+
+	key = oval_fts_cache_key(ofts, ofts->ofts_match_path_fts_ent->fts_path);
+	ofts->ofts_cache_walk = oval_fts_cache_get(key);
+	ofts->ofts_cache_pos = 0;
+	oscap_free(key);
+
+	if (ofts->ofts_cache_walk == NULL)
+		return (false);
+
+	dI("Replaying the cached walk of '%s'.", ofts->ofts_match_path_fts_ent->fts_path);
+	return (true);
+}
+
+/* get the next matching entry of the cached walk */
+static OVAL_FTSENT *oval_fts_read_replay(OVAL_FTS *ofts)
+{
+	/* the condition below is correct because ofts_sfilepath is NULL here */
+	bool collect_dirs = (ofts->ofts_sfilename == NULL);
+	const oval_fts_cache_ent_t *ent;
+
+	while (!probe_ctx_expired(NULL)
+	       && (ent = oval_fts_cache_ent(ofts->ofts_cache_walk, ofts->ofts_cache_pos)) != NULL) {
+		ofts->ofts_cache_pos++;
+
+		if (collect_dirs) {
+			if (ent->info == FTS_D
+			    && (ofts->max_depth == -1 || ent->level <= ofts->max_depth))
+				return OVAL_FTSENT_new1(ofts, ent->path, ent->path_len, ent->name_len, ent->info);
+		} else if (ent->info != FTS_D) {
+			oval_result_t result;
+
+			result = probe_entobj_match_str(ofts->ofts_sfilename_cmp, ent->path + ent->path_len - ent->name_len);
+
+			if (result == OVAL_RESULT_TRUE)
+				return OVAL_FTSENT_new1(ofts, ent->path, ent->path_len, ent->name_len, ent->info);
+			if (result == OVAL_RESULT_ERROR)
+				probe_cobj_set_flag(ofts->result, SYSCHAR_FLAG_ERROR);
+		}
+	}
+
+	oval_fts_cache_put(ofts->ofts_cache_walk);
+	ofts->ofts_cache_walk = NULL;
+
+	return (NULL);
+}
+
+static OVAL_FTSENT *oval_fts_read_next(OVAL_FTS *ofts)
+{
+	FTSENT *fts_ent;
 
 	for (;;) {
 		if (ofts->ofts_match_path_fts_ent == NULL) {
@@ -1304,6 +1874,29 @@ OVAL_FTSENT *oval_fts_read(OVAL_FTS *ofts)
 			fts_ent = ofts->ofts_match_path_fts_ent;
 			ofts->ofts_match_path_fts_ent = NULL;
 			break;
+		} else if (ofts->ofts_cache_walk != NULL || oval_fts_replay_start(ofts)) {
+			OVAL_FTSENT *ofts_ent;
+
+			ofts_ent = oval_fts_read_replay(ofts);
+			if (ofts_ent != NULL)
+				return (ofts_ent);
+
+			ofts->ofts_match_path_fts_ent = NULL;
+
+			if (ofts->ofts_path_op == OVAL_OPERATION_EQUALS)
+				return (NULL);
+		} else if (ofts->ofts_walk_threads > 1
+			   && ofts->direction == OVAL_RECURSE_DIRECTION_DOWN) {
+			OVAL_FTSENT *ofts_ent;
+
+			ofts_ent = oval_fts_read_walk(ofts);
+			if (ofts_ent != NULL)
+				return (ofts_ent);
+
+			ofts->ofts_match_path_fts_ent = NULL;
+
+			if (ofts->ofts_path_op == OVAL_OPERATION_EQUALS)
+				return (NULL);
 		} else {
 			fts_ent = oval_fts_read_recurse_path(ofts);
 			if (fts_ent != NULL)
@@ -1321,6 +1914,71 @@ OVAL_FTSENT *oval_fts_read(OVAL_FTS *ofts)
 	return OVAL_FTSENT_new(ofts, fts_ent);
 }
 
+void oval_fts_set_prefetch(OVAL_FTS *ofts)
+{
+	unsigned int depth;
+
+	if (ofts == NULL || ofts->ofts_ahead != NULL)
+		return;
+
+	depth = oval_fts_prefetch_depth();
+
+	if (depth == 0)
+		return;
+
+	ofts->ofts_ahead = oscap_alloc(sizeof(void *) * depth);
+	ofts->ofts_ahead_max = depth;
+}
+
+/*
+ * Keep ofts_ahead_max entries read ahead of the probe and let the
+ * regular files among them be read by the pool in the meantime.
+ */
+static OVAL_FTSENT *oval_fts_read_ahead(OVAL_FTS *ofts)
+{
+	OVAL_FTSENT *ofts_ent;
+
+	while (!ofts->ofts_ahead_end && ofts->ofts_ahead_count < ofts->ofts_ahead_max) {
+		ofts_ent = oval_fts_read_next(ofts);
+
+		if (ofts_ent == NULL) {
+			ofts->ofts_ahead_end = true;
+			break;
+		}
+
+		if (ofts_ent->fts_info == FTS_F && ofts_ent->file != NULL)
+			oval_fts_prefetch(ofts_ent->path, ofts_ent->path_len,
+					  ofts_ent->file, ofts_ent->file_len);
+
+		ofts->ofts_ahead[(ofts->ofts_ahead_head + ofts->ofts_ahead_count) % ofts->ofts_ahead_max] = ofts_ent;
+		ofts->ofts_ahead_count++;
+	}
+
+	if (ofts->ofts_ahead_count == 0)
+		return (NULL);
+
+	ofts_ent = ofts->ofts_ahead[ofts->ofts_ahead_head];
+	ofts->ofts_ahead_head = (ofts->ofts_ahead_head + 1) % ofts->ofts_ahead_max;
+	ofts->ofts_ahead_count--;
+
+	return (ofts_ent);
+}
+
+OVAL_FTSENT *oval_fts_read(OVAL_FTS *ofts)
+{
+#if defined(OSCAP_FTS_DEBUG)
+	dI("ofts: %p.", ofts);
+#endif
+
+	if (ofts == NULL)
+		return NULL;
+
+	if (ofts->ofts_ahead != NULL)
+		return oval_fts_read_ahead(ofts);
+
+	return oval_fts_read_next(ofts);
+}
+
 void oval_ftsent_free(OVAL_FTSENT *ofts_ent)
 {
 	OVAL_FTSENT_free(ofts_ent);
@@ -1328,13 +1986,25 @@ void oval_ftsent_free(OVAL_FTSENT *ofts_ent)
 
 int oval_fts_close(OVAL_FTS *ofts)
 {
+	if (ofts->ofts_ahead != NULL) {
+		/* the entries the probe didn't get to */
+		while (ofts->ofts_ahead_count > 0) {
+			OVAL_FTSENT_free(ofts->ofts_ahead[ofts->ofts_ahead_head]);
+			ofts->ofts_ahead_head = (ofts->ofts_ahead_head + 1) % ofts->ofts_ahead_max;
+			ofts->ofts_ahead_count--;
+		}
+		oscap_free(ofts->ofts_ahead);
+	}
+	if (ofts->ofts_walk != NULL)
+		oval_fts_walk_free(ofts->ofts_walk);
+	if (ofts->ofts_cache_walk != NULL)
+		oval_fts_cache_put(ofts->ofts_cache_walk);
+	if (ofts->ofts_cache_rec != NULL)
+		oval_fts_cache_record_discard(ofts->ofts_cache_rec);
 	if (ofts->ofts_recurse_path_pthcpy != NULL)
 		oscap_free(ofts->ofts_recurse_path_pthcpy);
 
-	if (ofts->ofts_path_regex)
-		pcre_free(ofts->ofts_path_regex);
-	if (ofts->ofts_path_regex_extra)
-		pcre_free(ofts->ofts_path_regex_extra);
+	oscap_pcre_put(ofts->ofts_path_regex);
 
 	if (ofts->ofts_spath != NULL)
 		SEXP_free(ofts->ofts_spath);
@@ -1342,6 +2012,9 @@ int oval_fts_close(OVAL_FTS *ofts)
 		SEXP_free(ofts->ofts_sfilename);
 	if (ofts->ofts_sfilepath != NULL)
 		SEXP_free(ofts->ofts_sfilepath);
+	probe_entobj_free(ofts->ofts_spath_cmp);
+	probe_entobj_free(ofts->ofts_sfilename_cmp);
+	probe_entobj_free(ofts->ofts_sfilepath_cmp);
 
 	fsdev_free(ofts->localdevs);
 
@@ -22,13 +22,16 @@
 #ifndef OVAL_FTS_H
 #define OVAL_FTS_H
 
+#include <stdbool.h>
+#include <sys/stat.h>
 #include <sexp.h>
 #if defined(__SVR4) && defined(__sun)
 #include "fts_sun.h"
 #else
 #include <fts.h>
 #endif
-#include <pcre.h>
+#include "common/oscap_pcre.h"
+#include "probe/entcmp.h"
 #include "fsdev.h"
 
 #define ENT_GET_AREF(ent, dst, attr_name, mandatory)			\
@@ -64,6 +67,18 @@
 		}						\
 	} while (0)
 
+/*
+ * Number of threads used to walk the tree below each matched path with
+ * recurse_direction "down". The walk is single-threaded if the variable
+ * isn't set or is lower than 2. Entries are reported in no particular
+ * order when more threads are used.
+ */
+#define OVAL_FTS_THREADS_ENV "OSCAP_FTS_THREADS"
+#define OVAL_FTS_THREADS_MAX 64
+
+struct oval_fts_walk;
+struct oval_fts_cache_walk;
+
 typedef struct {
 	/* oval_fts_read_match_path() state */
 	FTS *ofts_match_path_fts;
@@ -75,14 +90,31 @@ typedef struct {
 	char *ofts_recurse_path_pthcpy;
 	char *ofts_recurse_path_curpth;
 	dev_t ofts_recurse_path_devid;
-
-	pcre       *ofts_path_regex;
-	pcre_extra *ofts_path_regex_extra;
+	/* parallel walk state */
+	struct oval_fts_walk *ofts_walk;
+	unsigned int ofts_walk_threads;
+	/* walk cache state, see oval_fts_cache.h */
+	struct oval_fts_cache_walk *ofts_cache_walk; /* walk being replayed */
+	size_t ofts_cache_pos;
+	struct oval_fts_cache_walk *ofts_cache_rec;  /* walk being recorded */
+	bool ofts_cache;
+	/* read ahead state, see oval_fts_prefetch.h */
+	void **ofts_ahead;             /* ring of the OVAL_FTSENTs read ahead */
+	size_t ofts_ahead_head;
+	size_t ofts_ahead_count;
+	size_t ofts_ahead_max;
+	bool ofts_ahead_end;
+
+	oscap_pcre_t *ofts_path_regex;
 	uint32_t ofts_path_op;
 
 	SEXP_t *ofts_spath;
 	SEXP_t *ofts_sfilename;
 	SEXP_t *ofts_sfilepath;
+	/* the entities above prepared for matching every walked file */
+	probe_entobj_t *ofts_spath_cmp;
+	probe_entobj_t *ofts_sfilename_cmp;
+	probe_entobj_t *ofts_sfilepath_cmp;
 	SEXP_t *result;
 
 	int max_depth;
@@ -114,6 +146,8 @@ typedef struct {
 	char *path;
 	size_t path_len;
 	unsigned int fts_info;
+	struct stat st;  /* lstat data of the entry, if st_valid */
+	bool st_valid;
 } OVAL_FTSENT;
 
 /*
@@ -122,6 +156,8 @@ typedef struct {
 OVAL_FTS    *oval_fts_open(SEXP_t *path, SEXP_t *filename, SEXP_t *filepath, SEXP_t *behaviors, SEXP_t* result);
 OVAL_FTSENT *oval_fts_read(OVAL_FTS *ofts);
 int          oval_fts_close(OVAL_FTS *ofts);
+/* called by the probes which read the content of the walked files */
+void         oval_fts_set_prefetch(OVAL_FTS *ofts);
 
 void oval_ftsent_free(OVAL_FTSENT *ofts_ent);
 
@@ -0,0 +1,246 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "common/alloc.h"
+#include "common/list.h"
+#include "common/debug_priv.h"
+#include "oval_fts_cache.h"
+
+struct oval_fts_cache_walk {
+	oval_fts_cache_walk_t *next; /* next younger walk in the cache */
+	char *key;
+	oval_fts_cache_ent_t *ents;
+	size_t count;
+	size_t size;
+	unsigned int refs;
+	bool stored;
+};
+
+static pthread_mutex_t __cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct oscap_htable *__cache = NULL;
+static oval_fts_cache_walk_t *__cache_oldest = NULL;
+static size_t __cache_ents = 0;
+
+bool oval_fts_cache_enabled(void)
+{
+	const char *env;
+
+	env = getenv(OVAL_FTS_CACHE_ENV);
+
+	return (env == NULL || strcmp(env, "0") != 0);
+}
+
+static void oval_fts_cache_walk_free(oval_fts_cache_walk_t *walk)
+{
+	size_t i;
+
+	for (i = 0; i < walk->count; ++i)
+		free(walk->ents[i].path);
+
+	if (walk->ents != NULL)
+		oscap_free(walk->ents);
+
+	oscap_free(walk->key);
+	oscap_free(walk);
+}
+
+/* must be called with the lock held */
+static void oval_fts_cache_unlink(oval_fts_cache_walk_t *walk)
+{
+	oval_fts_cache_walk_t **p;
+
+	for (p = &__cache_oldest; *p != NULL; p = &(*p)->next) {
+		if (*p == walk) {
+			*p = walk->next;
+			break;
+		}
+	}
+
+	oscap_htable_detach(__cache, walk->key);
+	__cache_ents -= walk->count;
+	walk->stored = false;
+	walk->next = NULL;
+
+	if (walk->refs == 0)
+		oval_fts_cache_walk_free(walk);
+}
+
+static bool oval_fts_cache_valid(const oval_fts_cache_walk_t *walk)
+{
+	struct stat st;
+	size_t i;
+
+	for (i = 0; i < walk->count; ++i) {
+		const oval_fts_cache_ent_t *ent = &walk->ents[i];
+
+		if (ent->info != FTS_D)
+			continue;
+		/* directories reached through a symlink were recorded with
+		   the target's stat data */
+		if (stat(ent->path, &st) != 0)
+			return (false);
+		if (st.st_dev != ent->dev || st.st_ino != ent->ino
+		    || st.st_mtim.tv_sec != ent->mtime.tv_sec
+		    || st.st_mtim.tv_nsec != ent->mtime.tv_nsec) {
+			dI("Directory '%s' changed since it was cached.", ent->path);
+			return (false);
+		}
+	}
+
+	return (true);
+}
+
+oval_fts_cache_walk_t *oval_fts_cache_get(const char *key)
+{
+	oval_fts_cache_walk_t *walk = NULL;
+
+	pthread_mutex_lock(&__cache_lock);
+
+	if (__cache != NULL)
+		walk = oscap_htable_get(__cache, key);
+	if (walk != NULL)
+		walk->refs++;
+
+	pthread_mutex_unlock(&__cache_lock);
+
+	if (walk == NULL)
+		return (NULL);
+
+	if (!oval_fts_cache_valid(walk)) {
+		pthread_mutex_lock(&__cache_lock);
+		if (walk->stored)
+			oval_fts_cache_unlink(walk);
+		pthread_mutex_unlock(&__cache_lock);
+
+		oval_fts_cache_put(walk);
+		return (NULL);
+	}
+
+	return (walk);
+}
+
+void oval_fts_cache_put(oval_fts_cache_walk_t *walk)
+{
+	bool unused;
+
+	pthread_mutex_lock(&__cache_lock);
+	unused = (--walk->refs == 0 && !walk->stored);
+	pthread_mutex_unlock(&__cache_lock);
+
+	if (unused)
+		oval_fts_cache_walk_free(walk);
+}
+
+size_t oval_fts_cache_count(const oval_fts_cache_walk_t *walk)
+{
+	return (walk->count);
+}
+
+const oval_fts_cache_ent_t *oval_fts_cache_ent(const oval_fts_cache_walk_t *walk, size_t i)
+{
+	return (i < walk->count ? &walk->ents[i] : NULL);
+}
+
+oval_fts_cache_walk_t *oval_fts_cache_record(const char *key)
+{
+	oval_fts_cache_walk_t *walk;
+
+	walk = oscap_talloc(oval_fts_cache_walk_t);
+	memset(walk, 0, sizeof(*walk));
+	walk->key = oscap_strdup(key);
+
+	return (walk);
+}
+
+int oval_fts_cache_record_add(oval_fts_cache_walk_t *walk, FTSENT *fts_ent, int level)
+{
+	oval_fts_cache_ent_t *ent;
+
+	if (walk->count == OVAL_FTS_CACHE_MAX)
+		return (-1);
+
+	if (walk->count == walk->size) {
+		walk->size = walk->size == 0 ? 64 : walk->size * 2;
+		walk->ents = oscap_realloc(walk->ents, walk->size * sizeof(oval_fts_cache_ent_t));
+	}
+
+	ent = &walk->ents[walk->count++];
+	ent->path = strdup(fts_ent->fts_path);
+	ent->path_len = fts_ent->fts_pathlen;
+	ent->name_len = fts_ent->fts_namelen;
+	ent->info = fts_ent->fts_info;
+	ent->level = level;
+
+	if (fts_ent->fts_info == FTS_D) {
+		ent->mtime = fts_ent->fts_statp->st_mtim;
+		ent->dev = fts_ent->fts_statp->st_dev;
+		ent->ino = fts_ent->fts_statp->st_ino;
+	} else {
+		memset(&ent->mtime, 0, sizeof ent->mtime);
+		ent->dev = 0;
+		ent->ino = 0;
+	}
+
+	return (0);
+}
+
+void oval_fts_cache_record_commit(oval_fts_cache_walk_t *walk)
+{
+	oval_fts_cache_walk_t **p;
+
+	pthread_mutex_lock(&__cache_lock);
+
+	if (__cache == NULL)
+		__cache = oscap_htable_new();
+
+	if (oscap_htable_get(__cache, walk->key) != NULL) {
+		/* recorded by another thread in the meantime */
+		pthread_mutex_unlock(&__cache_lock);
+		oval_fts_cache_walk_free(walk);
+		return;
+	}
+
+	/* make room by dropping the oldest walks */
+	while (__cache_oldest != NULL && __cache_ents + walk->count > OVAL_FTS_CACHE_MAX)
+		oval_fts_cache_unlink(__cache_oldest);
+
+	oscap_htable_add(__cache, walk->key, walk);
+	__cache_ents += walk->count;
+	walk->stored = true;
+
+	for (p = &__cache_oldest; *p != NULL; p = &(*p)->next)
+		;
+	*p = walk;
+
+	dI("Cached %zu entries of walk '%s'.", walk->count, walk->key);
+	pthread_mutex_unlock(&__cache_lock);
+}
+
+void oval_fts_cache_record_discard(oval_fts_cache_walk_t *walk)
+{
+	oval_fts_cache_walk_free(walk);
+}
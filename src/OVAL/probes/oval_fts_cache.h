@@ -0,0 +1,108 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef OVAL_FTS_CACHE_H
+#define OVAL_FTS_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#if defined(__SVR4) && defined(__sun)
+#include "fts_sun.h"
+#else
+#include <fts.h>
+#endif
+#include "common/util.h"
+
+OSCAP_HIDDEN_START;
+
+/*
+ * Cache of downward walks
+ *
+ * Objects in the same content often walk the same trees with different
+ * filename patterns. The entries met during a complete downward walk are
+ * recorded together with the modification times of the directories, and
+ * a later walk of the same tree with the same behaviors replays them
+ * instead of reading the directories again. A walk is replayed only if
+ * none of its directories changed since it was recorded.
+ *
+ * The cache lives as long as the process, i.e. for one scan, and is
+ * bounded by OVAL_FTS_CACHE_MAX entries in total. Setting OSCAP_FTS_CACHE
+ * to 0 in the environment disables it.
+ */
+#define OVAL_FTS_CACHE_ENV "OSCAP_FTS_CACHE"
+#define OVAL_FTS_CACHE_MAX (256 * 1024)
+
+typedef struct {
+	char *path;
+	unsigned short path_len; /* fts_pathlen */
+	unsigned short name_len; /* fts_namelen */
+	unsigned short info;     /* fts_info */
+	int level;               /* depth below the walked path */
+	/* identity of a directory, to check it didn't change */
+	struct timespec mtime;
+	dev_t dev;
+	ino_t ino;
+} oval_fts_cache_ent_t;
+
+typedef struct oval_fts_cache_walk oval_fts_cache_walk_t;
+
+/**
+ * Check whether the cache can be used in this process.
+ */
+bool oval_fts_cache_enabled(void);
+
+/**
+ * Find a recorded walk and check that it's still valid.
+ * @return a reference to the walk or NULL; release it by oval_fts_cache_put()
+ */
+oval_fts_cache_walk_t *oval_fts_cache_get(const char *key);
+void oval_fts_cache_put(oval_fts_cache_walk_t *walk);
+
+size_t oval_fts_cache_count(const oval_fts_cache_walk_t *walk);
+const oval_fts_cache_ent_t *oval_fts_cache_ent(const oval_fts_cache_walk_t *walk, size_t i);
+
+/**
+ * Start recording a walk.
+ */
+oval_fts_cache_walk_t *oval_fts_cache_record(const char *key);
+
+/**
+ * Record an entry at the given level below the walked path.
+ * @return 0 on success, -1 if the walk is too large to be cached, in
+ *         which case the recording must be discarded
+ */
+int oval_fts_cache_record_add(oval_fts_cache_walk_t *walk, FTSENT *fts_ent, int level);
+
+/**
+ * Store a complete recording in the cache. The walk can't be used by the
+ * caller afterwards.
+ */
+void oval_fts_cache_record_commit(oval_fts_cache_walk_t *walk);
+
+/**
+ * Discard an incomplete recording.
+ */
+void oval_fts_cache_record_discard(oval_fts_cache_walk_t *walk);
+
+OSCAP_HIDDEN_END;
+
+#endif /* OVAL_FTS_CACHE_H */
@@ -0,0 +1,187 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "common/alloc.h"
+#include "common/debug_priv.h"
+#include "common/ratelimit.h"
+#include "oval_fts_prefetch.h"
+
+static struct {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;       /* a path was queued */
+	char *queue[OVAL_FTS_PREFETCH_MAX];
+	size_t head;
+	size_t count;
+	unsigned int depth;
+} __prefetch = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER
+};
+
+static pthread_once_t __prefetch_once = PTHREAD_ONCE_INIT;
+
+static void oval_fts_prefetch_file(const char *path)
+{
+	struct stat st;
+	int fd;
+
+	/* O_NONBLOCK: don't wait for the writer of a FIFO the stat was racing with */
+	fd = open(path, O_RDONLY | O_NONBLOCK | O_NOCTTY | O_CLOEXEC);
+
+	if (fd < 0)
+		return;
+
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+#if defined(POSIX_FADV_WILLNEED)
+		(void) posix_fadvise(fd, 0, st.st_size < OVAL_FTS_PREFETCH_BYTES ? st.st_size : OVAL_FTS_PREFETCH_BYTES,
+				     POSIX_FADV_WILLNEED);
+#endif
+	}
+
+	close(fd);
+}
+
+static void *oval_fts_prefetch_thread(void *arg)
+{
+	char *path;
+
+	for (;;) {
+		pthread_mutex_lock(&__prefetch.lock);
+
+		while (__prefetch.count == 0)
+			pthread_cond_wait(&__prefetch.cond, &__prefetch.lock);
+
+		path = __prefetch.queue[__prefetch.head];
+		__prefetch.head = (__prefetch.head + 1) % OVAL_FTS_PREFETCH_MAX;
+		__prefetch.count--;
+
+		pthread_mutex_unlock(&__prefetch.lock);
+
+		oval_fts_prefetch_file(path);
+		free(path);
+	}
+
+	return (NULL);
+}
+
+static void oval_fts_prefetch_setup(void)
+{
+	const char *env;
+	unsigned long depth;
+	unsigned int i, threads;
+	pthread_attr_t attr;
+	pthread_t tid;
+	char *end;
+	int err;
+
+	env = getenv(OVAL_FTS_PREFETCH_ENV);
+
+	if (env == NULL || *env == '\0')
+		return;
+
+	depth = strtoul(env, &end, 10);
+
+	if (*end != '\0') {
+		dW("Invalid value of %s: '%s', the files are not read ahead.", OVAL_FTS_PREFETCH_ENV, env);
+		return;
+	}
+
+	if (depth == 0)
+		return;
+
+	env = getenv(OSCAP_RATELIMIT_READ_ENV);
+
+	if (env != NULL && *env != '\0') {
+		dI("The read rate is limited, the files are not read ahead.");
+		return;
+	}
+
+	if (depth > OVAL_FTS_PREFETCH_MAX)
+		depth = OVAL_FTS_PREFETCH_MAX;
+
+	threads = depth < OVAL_FTS_PREFETCH_THREADS ? (unsigned int)depth : OVAL_FTS_PREFETCH_THREADS;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+	/* the threads live as long as the probe */
+	for (i = 0; i < threads; ++i) {
+		if ((err = pthread_create(&tid, &attr, &oval_fts_prefetch_thread, NULL)) != 0) {
+			dW("Can't start a read ahead thread: %s.", strerror(err));
+			break;
+		}
+	}
+
+	pthread_attr_destroy(&attr);
+
+	if (i > 0)
+		__prefetch.depth = (unsigned int)depth;
+
+	dI("Reading %u files ahead with %u threads.", __prefetch.depth, i);
+}
+
+unsigned int oval_fts_prefetch_depth(void)
+{
+	pthread_once(&__prefetch_once, &oval_fts_prefetch_setup);
+	return (__prefetch.depth);
+}
+
+void oval_fts_prefetch(const char *path, size_t path_len, const char *file, size_t file_len)
+{
+	char *full;
+
+	if (oval_fts_prefetch_depth() == 0)
+		return;
+
+	full = malloc(path_len + file_len + 2);
+
+	if (full == NULL)
+		return;
+
+	memcpy(full, path, path_len);
+	full[path_len] = '/';
+	memcpy(full + path_len + 1, file, file_len);
+	full[path_len + file_len + 1] = '\0';
+
+	pthread_mutex_lock(&__prefetch.lock);
+
+	if (__prefetch.count < OVAL_FTS_PREFETCH_MAX) {
+		__prefetch.queue[(__prefetch.head + __prefetch.count) % OVAL_FTS_PREFETCH_MAX] = full;
+		__prefetch.count++;
+		full = NULL;
+		pthread_cond_signal(&__prefetch.cond);
+	}
+
+	pthread_mutex_unlock(&__prefetch.lock);
+
+	/* the probe reads the file by itself */
+	free(full);
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef OVAL_FTS_PREFETCH_H
+#define OVAL_FTS_PREFETCH_H
+
+#include <stddef.h>
+#include "common/util.h"
+
+OSCAP_HIDDEN_START;
+
+/*
+ * Read ahead of the walked files
+ *
+ * The probes which read the content of the files open and read them one
+ * at a time, so on high-latency storage the walk waits for one request at
+ * a time. If OSCAP_FTS_PREFETCH is set to N, oval_fts_read() of the walks
+ * of these probes runs N entries ahead of the probe and hands the regular
+ * files to a pool of threads, which open them and ask the kernel to read
+ * their first OVAL_FTS_PREFETCH_BYTES (POSIX_FADV_WILLNEED). The probe then
+ * finds the data in the page cache. Without the variable, or if no thread
+ * can be started, the files are read only by the probe, as before.
+ *
+ * The read ahead is disabled if the read rate of the probe is limited,
+ * see common/ratelimit.h.
+ */
+#define OVAL_FTS_PREFETCH_ENV     "OSCAP_FTS_PREFETCH"
+#define OVAL_FTS_PREFETCH_MAX     1024
+#define OVAL_FTS_PREFETCH_THREADS 16
+#define OVAL_FTS_PREFETCH_BYTES   (1024 * 1024)
+
+/* the number of entries to read ahead, 0 if disabled */
+unsigned int oval_fts_prefetch_depth(void);
+
+/* queue the file `path'/`file' for the pool, dropped if the pool is behind */
+void oval_fts_prefetch(const char *path, size_t path_len, const char *file, size_t file_len);
+
+OSCAP_HIDDEN_END;
+
+#endif /* OVAL_FTS_PREFETCH_H */
@@ -0,0 +1,298 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+
+#include "common/debug_priv.h"
+#include "oval_hash_cache.h"
+
+#define OVAL_HASH_CACHE_MAGIC   "OSCAPHC"
+#define OVAL_HASH_CACHE_VERSION 1
+#define OVAL_HASH_CACHE_WAYS    4
+
+struct oval_hash_cache_hdr {
+	char     magic[8];
+	uint32_t version;
+	uint32_t slots;
+	uint32_t slot_size;
+	uint8_t  pad[44];
+};
+
+/*
+ * check is a hash of the other members, 0 means an empty slot. Writers
+ * clear it before changing the slot, so a reader which finds it doesn't
+ * match the content skips the slot.
+ */
+struct oval_hash_cache_slot {
+	uint64_t check;
+	uint64_t dev;
+	uint64_t ino;
+	uint64_t size;
+	int64_t  mtime_ns;
+	int64_t  ctime_ns;
+	uint32_t alg;
+	uint32_t len;
+	uint8_t  digest[OVAL_HASH_CACHE_DSTMAX];
+};
+
+static pthread_once_t __cache_once = PTHREAD_ONCE_INIT;
+static struct oval_hash_cache_slot *__cache_slots = NULL;
+
+static int oval_hash_cache_setup(int fd, size_t len)
+{
+	struct oval_hash_cache_hdr hdr, cur;
+
+	memset(&hdr, 0, sizeof hdr);
+	memcpy(hdr.magic, OVAL_HASH_CACHE_MAGIC, sizeof hdr.magic);
+	hdr.version   = OVAL_HASH_CACHE_VERSION;
+	hdr.slots     = OVAL_HASH_CACHE_SLOTS;
+	hdr.slot_size = sizeof(struct oval_hash_cache_slot);
+
+	if (pread(fd, &cur, sizeof cur, 0) == sizeof cur
+	    && memcmp(&cur, &hdr, sizeof hdr) == 0)
+		return (0);
+
+	/* new file, or one written by a different version; start empty */
+	if (ftruncate(fd, 0) != 0 || ftruncate(fd, (off_t)len) != 0)
+		return (-1);
+	if (pwrite(fd, &hdr, sizeof hdr, 0) != sizeof hdr)
+		return (-1);
+
+	return (0);
+}
+
+static void oval_hash_cache_open(void)
+{
+	const char *path;
+	struct stat st;
+	size_t len;
+	void *map;
+	int fd;
+
+	path = getenv(OVAL_HASH_CACHE_ENV);
+
+	if (path == NULL || *path == '\0')
+		return;
+
+	fd = open(path, O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0600);
+
+	if (fd < 0) {
+		dW("Can't open the hash cache '%s': %s.", path, strerror(errno));
+		return;
+	}
+
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)
+	    || st.st_uid != geteuid() || (st.st_mode & 077) != 0) {
+		dW("Not using the hash cache '%s': it must be a regular file "
+		   "owned by the user and not accessible by others.", path);
+		close(fd);
+		return;
+	}
+
+	len = sizeof(struct oval_hash_cache_hdr)
+	      + OVAL_HASH_CACHE_SLOTS * sizeof(struct oval_hash_cache_slot);
+
+	if (flock(fd, LOCK_EX) != 0 || oval_hash_cache_setup(fd, len) != 0) {
+		dW("Can't initialize the hash cache '%s': %s.", path, strerror(errno));
+		close(fd);
+		return;
+	}
+
+	flock(fd, LOCK_UN);
+
+	map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (map == MAP_FAILED) {
+		dW("Can't map the hash cache '%s': %s.", path, strerror(errno));
+		return;
+	}
+
+	__cache_slots = (struct oval_hash_cache_slot *)((uint8_t *)map + sizeof(struct oval_hash_cache_hdr));
+	dI("Using the hash cache '%s'.", path);
+}
+
+void oval_hash_cache_init(void)
+{
+	pthread_once(&__cache_once, &oval_hash_cache_open);
+}
+
+bool oval_hash_cache_enabled(void)
+{
+	oval_hash_cache_init();
+	return (__cache_slots != NULL);
+}
+
+/* FNV-1a */
+static uint64_t oval_hash_cache_hash(const void *data, size_t len)
+{
+	const uint8_t *p = (const uint8_t *)data;
+	uint64_t h = 0xcbf29ce484222325ULL;
+
+	while (len-- > 0) {
+		h ^= *p++;
+		h *= 0x100000001b3ULL;
+	}
+
+	return (h);
+}
+
+static uint64_t oval_hash_cache_check(const struct oval_hash_cache_slot *slot)
+{
+	uint64_t h;
+
+	h = oval_hash_cache_hash(&slot->dev, sizeof *slot - offsetof(struct oval_hash_cache_slot, dev));
+
+	return (h != 0 ? h : 1);
+}
+
+static void oval_hash_cache_key(struct oval_hash_cache_slot *key, const struct stat *st, int alg)
+{
+	memset(key, 0, sizeof *key);
+	key->dev      = (uint64_t)st->st_dev;
+	key->ino      = (uint64_t)st->st_ino;
+	key->size     = (uint64_t)st->st_size;
+	key->mtime_ns = (int64_t)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+	key->ctime_ns = (int64_t)st->st_ctim.tv_sec * 1000000000 + st->st_ctim.tv_nsec;
+	key->alg      = (uint32_t)alg;
+}
+
+static bool oval_hash_cache_match(const struct oval_hash_cache_slot *a, const struct oval_hash_cache_slot *b)
+{
+	return (a->dev == b->dev && a->ino == b->ino && a->size == b->size
+		&& a->mtime_ns == b->mtime_ns && a->ctime_ns == b->ctime_ns
+		&& a->alg == b->alg);
+}
+
+static struct oval_hash_cache_slot *oval_hash_cache_bucket(const struct oval_hash_cache_slot *key, uint64_t *h)
+{
+	*h = oval_hash_cache_hash(&key->dev, offsetof(struct oval_hash_cache_slot, len)
+				  - offsetof(struct oval_hash_cache_slot, dev));
+
+	return (__cache_slots + (*h % (OVAL_HASH_CACHE_SLOTS / OVAL_HASH_CACHE_WAYS)) * OVAL_HASH_CACHE_WAYS);
+}
+
+/* copy a slot which isn't being written, or return false */
+static bool oval_hash_cache_read(struct oval_hash_cache_slot *slot, struct oval_hash_cache_slot *copy)
+{
+	uint64_t check;
+
+	check = __atomic_load_n(&slot->check, __ATOMIC_ACQUIRE);
+
+	if (check == 0)
+		return (false);
+
+	memcpy(copy, slot, sizeof *copy);
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+	return (__atomic_load_n(&slot->check, __ATOMIC_RELAXED) == check
+		&& oval_hash_cache_check(copy) == check);
+}
+
+bool oval_hash_cache_get(const struct stat *st, int alg, void *dst, size_t *size)
+{
+	struct oval_hash_cache_slot key, copy, *bucket;
+	uint64_t h;
+	int i;
+
+	if (!oval_hash_cache_enabled())
+		return (false);
+
+	oval_hash_cache_key(&key, st, alg);
+	bucket = oval_hash_cache_bucket(&key, &h);
+
+	for (i = 0; i < OVAL_HASH_CACHE_WAYS; ++i) {
+		if (!oval_hash_cache_read(&bucket[i], &copy))
+			continue;
+		if (!oval_hash_cache_match(&copy, &key))
+			continue;
+		if (copy.len > *size || copy.len > OVAL_HASH_CACHE_DSTMAX)
+			return (false);
+
+		memcpy(dst, copy.digest, copy.len);
+		*size = copy.len;
+
+		return (true);
+	}
+
+	return (false);
+}
+
+void oval_hash_cache_put(const struct stat *st, int alg, const void *dst, size_t size)
+{
+	struct oval_hash_cache_slot key, copy, *bucket, *slot = NULL;
+	uint64_t h;
+	int i;
+
+	if (size == 0 || size > OVAL_HASH_CACHE_DSTMAX || !oval_hash_cache_enabled())
+		return;
+
+	oval_hash_cache_key(&key, st, alg);
+	bucket = oval_hash_cache_bucket(&key, &h);
+
+	/* the slot with the same key, an empty one, or a pseudo-random one */
+	for (i = 0; i < OVAL_HASH_CACHE_WAYS; ++i) {
+		if (!oval_hash_cache_read(&bucket[i], &copy)) {
+			if (slot == NULL)
+				slot = &bucket[i];
+			continue;
+		}
+		if (oval_hash_cache_match(&copy, &key)) {
+			slot = &bucket[i];
+			break;
+		}
+	}
+
+	if (slot == NULL)
+		slot = &bucket[(h >> 32) % OVAL_HASH_CACHE_WAYS];
+
+	key.len = (uint32_t)size;
+	memcpy(key.digest, dst, size);
+	key.check = oval_hash_cache_check(&key);
+
+	__atomic_store_n(&slot->check, 0, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	memcpy((uint8_t *)slot + offsetof(struct oval_hash_cache_slot, dev),
+	       (uint8_t *)&key + offsetof(struct oval_hash_cache_slot, dev),
+	       sizeof key - offsetof(struct oval_hash_cache_slot, dev));
+	__atomic_store_n(&slot->check, key.check, __ATOMIC_RELEASE);
+}
+
+bool oval_hash_cache_stat_changed(const struct stat *a, const struct stat *b)
+{
+	return (a->st_dev != b->st_dev || a->st_ino != b->st_ino
+		|| a->st_size != b->st_size
+		|| a->st_mtim.tv_sec != b->st_mtim.tv_sec
+		|| a->st_mtim.tv_nsec != b->st_mtim.tv_nsec
+		|| a->st_ctim.tv_sec != b->st_ctim.tv_sec
+		|| a->st_ctim.tv_nsec != b->st_ctim.tv_nsec);
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef OVAL_HASH_CACHE_H
+#define OVAL_HASH_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/stat.h>
+
+/*
+ * Persistent cache of file digests
+ *
+ * Digests computed by the probes are stored in the file named by the
+ * OSCAP_HASH_CACHE environment variable, keyed by the device, inode, size,
+ * mtime and ctime of the file and by the algorithm. A later scan which
+ * finds a file with the same key reuses the stored digest instead of
+ * reading the file. The ctime can't be set back from user space, so a
+ * file modified in place doesn't match its old entry even if its mtime
+ * was restored.
+ *
+ * The cache is off unless OSCAP_HASH_CACHE is set, and "oscap ... eval
+ * --no-hash-cache" turns it off for a strict audit. The file has a fixed
+ * number of slots (OVAL_HASH_CACHE_SLOTS); a new digest may replace an
+ * older one which maps to the same slots. Several probe processes may use
+ * the file at the same time, a slot which is being written is treated as
+ * empty. The file must be owned by the user and not accessible by others,
+ * otherwise the cache is not used.
+ */
+#define OVAL_HASH_CACHE_ENV   "OSCAP_HASH_CACHE"
+#define OVAL_HASH_CACHE_SLOTS (128 * 1024)
+#define OVAL_HASH_CACHE_DSTMAX 64
+
+/**
+ * Open the cache file, if enabled. Called by the probe before it changes its
+ * root directory, otherwise the first get/put opens it.
+ */
+void oval_hash_cache_init(void);
+bool oval_hash_cache_enabled(void);
+
+/**
+ * Look up the digest of the file with the stat data st.
+ * @param alg the crapi_alg_t of the digest
+ * @param size the size of dst on input, the length of the digest on output
+ * @return true if found
+ */
+bool oval_hash_cache_get(const struct stat *st, int alg, void *dst, size_t *size);
+
+/**
+ * Store the digest of the file with the stat data st. The stat data
+ * should be taken before the file was read, and the digest not stored if
+ * they changed meanwhile.
+ */
+void oval_hash_cache_put(const struct stat *st, int alg, const void *dst, size_t size);
+
+/**
+ * Check whether the stat data of a file changed in a way which
+ * invalidates its digest.
+ */
+bool oval_hash_cache_stat_changed(const struct stat *a, const struct stat *b);
+
+#endif /* OVAL_HASH_CACHE_H */
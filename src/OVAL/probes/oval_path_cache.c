@@ -0,0 +1,312 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "common/alloc.h"
+#include "common/list.h"
+#include "common/debug_priv.h"
+#include "oval_path_cache.h"
+
+#define OVAL_PATH_LINKS_MAX 40 /* MAXSYMLINKS of Linux */
+
+struct oval_path_cache_ent {
+	struct timespec ctime;
+	char *value;
+};
+
+static pthread_mutex_t __path_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct oscap_htable *__path_cache = NULL;
+static size_t __path_count = 0;
+
+static void oval_path_cache_key(char *key, size_t size, char kind, const struct stat *st)
+{
+	snprintf(key, size, "%c%llx:%llx", kind,
+		 (unsigned long long)st->st_dev, (unsigned long long)st->st_ino);
+}
+
+/* a copy of the cached value, NULL if there is none or it's stale */
+static char *oval_path_cache_get(const char *key, const struct stat *st)
+{
+	struct oval_path_cache_ent *ent = NULL;
+	char *value = NULL;
+
+	pthread_mutex_lock(&__path_lock);
+
+	if (__path_cache != NULL)
+		ent = oscap_htable_get(__path_cache, key);
+	if (ent != NULL
+	    && ent->ctime.tv_sec == st->st_ctim.tv_sec
+	    && ent->ctime.tv_nsec == st->st_ctim.tv_nsec)
+		value = strdup(ent->value);
+
+	pthread_mutex_unlock(&__path_lock);
+
+	return (value);
+}
+
+static void oval_path_cache_set(const char *key, const struct stat *st, const char *value)
+{
+	struct oval_path_cache_ent *ent = NULL;
+
+	pthread_mutex_lock(&__path_lock);
+
+	if (__path_cache == NULL)
+		__path_cache = oscap_htable_new();
+	if (__path_cache != NULL)
+		ent = oscap_htable_get(__path_cache, key);
+
+	if (ent != NULL) {
+		free(ent->value);
+	} else if (__path_cache != NULL && __path_count < OVAL_PATH_CACHE_MAX) {
+		ent = oscap_talloc(struct oval_path_cache_ent);
+
+		if (oscap_htable_add(__path_cache, key, ent))
+			__path_count++;
+		else {
+			oscap_free(ent);
+			ent = NULL;
+		}
+	}
+
+	if (ent != NULL) {
+		ent->ctime = st->st_ctim;
+		ent->value = strdup(value);
+	}
+
+	pthread_mutex_unlock(&__path_lock);
+}
+
+static char *oval_path_join(const char *dir, const char *name)
+{
+	size_t dir_len, name_len;
+	char *path;
+
+	dir_len  = strcmp(dir, "/") == 0 ? 0 : strlen(dir);
+	name_len = strlen(name);
+	path = malloc(dir_len + name_len + 2);
+
+	if (path == NULL)
+		return (NULL);
+
+	memcpy(path, dir, dir_len);
+	path[dir_len] = '/';
+	memcpy(path + dir_len + 1, name, name_len + 1);
+
+	return (path);
+}
+
+static char *oval_realpath_r(const char *path, int *links);
+
+static char *oval_path_dir(const char *dir, int *links)
+{
+	char key[64], *canon;
+	struct stat st;
+
+	if (stat(dir, &st) != 0)
+		return (NULL);
+
+	if (!S_ISDIR(st.st_mode)) {
+		errno = ENOTDIR;
+		return (NULL);
+	}
+
+	oval_path_cache_key(key, sizeof key, 'd', &st);
+	canon = oval_path_cache_get(key, &st);
+
+	if (canon != NULL)
+		return (canon);
+
+	canon = oval_realpath_r(dir, links);
+
+	if (canon != NULL)
+		oval_path_cache_set(key, &st, canon);
+
+	return (canon);
+}
+
+static char *oval_path_link(const char *path, const struct stat *st)
+{
+	char key[64], *target;
+	size_t size;
+	ssize_t len;
+
+	oval_path_cache_key(key, sizeof key, 'l', st);
+	target = oval_path_cache_get(key, st);
+
+	if (target != NULL)
+		return (target);
+
+	size = st->st_size > 0 ? (size_t)st->st_size + 1 : PATH_MAX;
+
+	for (;;) {
+		target = malloc(size);
+
+		if (target == NULL)
+			return (NULL);
+
+		len = readlink(path, target, size);
+
+		if (len < 0) {
+			free(target);
+			return (NULL);
+		}
+		if ((size_t)len < size)
+			break;
+
+		free(target);
+		size *= 2;
+	}
+
+	target[len] = '\0';
+
+	/*
+	 * The links of procfs, e.g. /proc/self, have no size and their target
+	 * depends on who reads them, only the ordinary ones are kept.
+	 */
+	if (st->st_size == len)
+		oval_path_cache_set(key, st, target);
+
+	return (target);
+}
+
+static char *oval_realpath_r(const char *path, int *links)
+{
+	char *abs = NULL, *dir = NULL, *canon = NULL, *full = NULL, *target = NULL, *next;
+	const char *name, *slash;
+	struct stat st;
+	size_t len;
+	int err;
+
+	len = strlen(path);
+
+	if (len == 0) {
+		errno = ENOENT;
+		return (NULL);
+	}
+
+	/* the trailing slashes and dots, leave them to realpath() */
+	slash = strrchr(path, '/');
+	name  = slash != NULL ? slash + 1 : path;
+
+	if (*name == '\0' || strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+		return (realpath(path, NULL));
+
+	if (path[0] != '/') {
+		char *cwd = getcwd(NULL, 0);
+
+		if (cwd == NULL)
+			return (NULL);
+
+		abs = oval_path_join(cwd, path);
+		free(cwd);
+
+		if (abs == NULL)
+			return (NULL);
+
+		path  = abs;
+		slash = strrchr(path, '/');
+		name  = slash + 1;
+	}
+
+	dir = slash == path ? strdup("/") : strndup(path, (size_t)(slash - path));
+
+	if (dir == NULL)
+		goto fail;
+
+	canon = oval_path_dir(dir, links);
+
+	if (canon == NULL)
+		goto fail;
+
+	full = oval_path_join(canon, name);
+
+	if (full == NULL || lstat(full, &st) != 0)
+		goto fail;
+
+	if (!S_ISLNK(st.st_mode)) {
+		free(canon);
+		free(dir);
+		free(abs);
+		return (full);
+	}
+
+	if (++*links > OVAL_PATH_LINKS_MAX) {
+		errno = ELOOP;
+		goto fail;
+	}
+
+	target = oval_path_link(full, &st);
+
+	if (target == NULL)
+		goto fail;
+
+	if (target[0] == '/') {
+		next = oval_realpath_r(target, links);
+	} else {
+		char *rel = oval_path_join(canon, target);
+
+		if (rel == NULL)
+			goto fail;
+
+		next = oval_realpath_r(rel, links);
+		err  = errno;
+		free(rel);
+		errno = err;
+	}
+
+	err = errno;
+	free(target);
+	free(full);
+	free(canon);
+	free(dir);
+	free(abs);
+	errno = err;
+
+	return (next);
+fail:
+	err = errno;
+	free(target);
+	free(full);
+	free(canon);
+	free(dir);
+	free(abs);
+	errno = err;
+
+	return (NULL);
+}
+
+char *oval_realpath(const char *path)
+{
+	int links = 0;
+
+	return (oval_realpath_r(path, &links));
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef OVAL_PATH_CACHE_H
+#define OVAL_PATH_CACHE_H
+
+#include "common/util.h"
+
+OSCAP_HIDDEN_START;
+
+/*
+ * Cache of resolved paths
+ *
+ * realpath() resolves a path component by component, an lstat() for each
+ * and a readlink() for every symlink met, so link chains through the same
+ * directories, e.g. /etc/alternatives and /usr/lib64, are resolved again
+ * for every link. The canonical paths of the directories and the targets
+ * of the symlinks are kept here, keyed by their device and inode numbers,
+ * so that a path costs a stat() of its directory and an lstat() of every
+ * link in its chain.
+ *
+ * The entries are checked against the change time of their inode. The
+ * cache lives as long as the probe process and is bounded by
+ * OVAL_PATH_CACHE_MAX entries. A directory reachable through several bind
+ * mounts resolves to the path it was first resolved to.
+ */
+#define OVAL_PATH_CACHE_MAX (64 * 1024)
+
+/**
+ * Resolve a path like realpath(path, NULL).
+ * @return the canonical absolute path, free it by free(), or NULL and
+ *         errno set
+ */
+char *oval_realpath(const char *path);
+
+OSCAP_HIDDEN_END;
+
+#endif /* OVAL_PATH_CACHE_H */
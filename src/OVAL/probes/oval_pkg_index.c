@@ -0,0 +1,225 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "common/debug_priv.h"
+#include "oval_pkg_index.h"
+
+#define OVAL_PKG_INDEX_MAGIC   "OSCAPPKGIDX"
+#define OVAL_PKG_INDEX_VERSION 1
+
+static pthread_once_t __index_once = PTHREAD_ONCE_INIT;
+static int __index_dir = -1;
+
+static void oval_pkg_index_opendir(void)
+{
+	const char *path;
+	struct stat st;
+	int fd;
+
+	path = getenv(OVAL_PKG_INDEX_ENV);
+
+	if (path == NULL || *path == '\0')
+		return;
+
+	fd = open(path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+
+	if (fd < 0) {
+		dW("Can't open the package index directory '%s': %s.", path, strerror(errno));
+		return;
+	}
+
+	if (fstat(fd, &st) != 0 || st.st_uid != geteuid() || (st.st_mode & 077) != 0) {
+		dW("Not using the package index directory '%s': it must be owned by the user "
+		   "and not accessible by others.", path);
+		close(fd);
+		return;
+	}
+
+	__index_dir = fd;
+}
+
+void oval_pkg_index_init(void)
+{
+	pthread_once(&__index_once, oval_pkg_index_opendir);
+}
+
+bool oval_pkg_index_enabled(void)
+{
+	oval_pkg_index_init();
+	return (__index_dir != -1);
+}
+
+/* FNV-1a */
+static uint64_t oval_pkg_index_hash(uint64_t h, const void *data, size_t len)
+{
+	const uint8_t *p = (const uint8_t *)data;
+
+	while (len-- > 0) {
+		h ^= *p++;
+		h *= 0x100000001b3ULL;
+	}
+
+	return (h);
+}
+
+int oval_pkg_index_stamp(const char *dbdir, char *stamp)
+{
+	DIR *dir;
+	struct dirent *d;
+	struct stat st;
+	uint64_t sum, h;
+	int fd;
+
+	fd = open(dbdir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+	if (fd < 0 || fstat(fd, &st) != 0 || (dir = fdopendir(fd)) == NULL) {
+		if (fd >= 0)
+			close(fd);
+		return (-1);
+	}
+
+	sum = (uint64_t)st.st_dev;
+
+	/* the files are combined independently of the readdir order */
+	while ((d = readdir(dir)) != NULL) {
+		if (fstatat(fd, d->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0 || !S_ISREG(st.st_mode))
+			continue;
+
+		h = oval_pkg_index_hash(0xcbf29ce484222325ULL, d->d_name, strlen(d->d_name));
+		h = oval_pkg_index_hash(h, &st.st_ino, sizeof st.st_ino);
+		h = oval_pkg_index_hash(h, &st.st_size, sizeof st.st_size);
+		h = oval_pkg_index_hash(h, &st.st_mtim, sizeof st.st_mtim);
+		sum += h;
+	}
+
+	closedir(dir);
+	snprintf(stamp, OVAL_PKG_INDEX_STAMPLEN, "%016llx", (unsigned long long)sum);
+
+	return (0);
+}
+
+/* the index files of different root directories don't replace each other */
+static void oval_pkg_index_filename(const char *name, char *buf, size_t size)
+{
+	const char *root;
+	uint64_t h;
+
+	root = getenv("OSCAP_PROBE_ROOT");
+
+	if (root == NULL || *root == '\0')
+		root = "/";
+
+	h = oval_pkg_index_hash(0xcbf29ce484222325ULL, root, strlen(root));
+	snprintf(buf, size, "%s-%016llx.idx", name, (unsigned long long)h);
+}
+
+FILE *oval_pkg_index_open(const char *name, const char *stamp)
+{
+	char filename[PATH_MAX], line[128], expected[128];
+	FILE *fp;
+	int fd;
+
+	if (!oval_pkg_index_enabled())
+		return (NULL);
+
+	oval_pkg_index_filename(name, filename, sizeof filename);
+	fd = openat(__index_dir, filename, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+
+	if (fd < 0)
+		return (NULL);
+
+	if ((fp = fdopen(fd, "r")) == NULL) {
+		close(fd);
+		return (NULL);
+	}
+
+	snprintf(expected, sizeof expected, "%s %d %s\n", OVAL_PKG_INDEX_MAGIC, OVAL_PKG_INDEX_VERSION, stamp);
+
+	if (fgets(line, sizeof line, fp) == NULL || strcmp(line, expected) != 0) {
+		dI("The package index '%s' is out of date.", filename);
+		fclose(fp);
+		return (NULL);
+	}
+
+	dI("Using the package index '%s'.", filename);
+	return (fp);
+}
+
+int oval_pkg_index_save(const char *name, const char *stamp,
+			int (*write_fn)(FILE *fp, void *arg), void *arg)
+{
+	char filename[PATH_MAX], tmpname[PATH_MAX];
+	FILE *fp;
+	int fd, ret;
+
+	if (!oval_pkg_index_enabled())
+		return (0);
+
+	oval_pkg_index_filename(name, filename, sizeof filename);
+	ret = snprintf(tmpname, sizeof tmpname, "%s.%ld", filename, (long)getpid());
+
+	if (ret < 0 || (size_t)ret >= sizeof tmpname) {
+		dW("Can't write the package index '%s': %s.", filename, strerror(ENAMETOOLONG));
+		return (-1);
+	}
+
+	fd = openat(__index_dir, tmpname, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+
+	if (fd < 0) {
+		dW("Can't write the package index '%s': %s.", tmpname, strerror(errno));
+		return (-1);
+	}
+
+	if ((fp = fdopen(fd, "w")) == NULL) {
+		close(fd);
+		unlinkat(__index_dir, tmpname, 0);
+		return (-1);
+	}
+
+	fprintf(fp, "%s %d %s\n", OVAL_PKG_INDEX_MAGIC, OVAL_PKG_INDEX_VERSION, stamp);
+	ret = write_fn(fp, arg);
+
+	if (fclose(fp) != 0)
+		ret = -1;
+
+	if (ret == 0 && renameat(__index_dir, tmpname, __index_dir, filename) != 0)
+		ret = -1;
+
+	if (ret != 0) {
+		dW("Can't write the package index '%s'.", filename);
+		unlinkat(__index_dir, tmpname, 0);
+	}
+
+	return (ret);
+}
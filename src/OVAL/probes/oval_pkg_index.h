@@ -0,0 +1,75 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef OVAL_PKG_INDEX_H
+#define OVAL_PKG_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+ * Shared index of installed packages
+ *
+ * A package probe which has read the package database of the scanned
+ * system stores the data it needs in a text file in the directory named
+ * by the OSCAP_PACKAGE_INDEX environment variable. The probes of later
+ * scans of the same root directory read that file instead of opening the
+ * package database, as long as the database is unchanged: the file
+ * starts with a stamp of the device, inode, size and mtime of the files
+ * of the database directory, and an index with a different stamp is
+ * ignored and written again.
+ *
+ * The index is off unless OSCAP_PACKAGE_INDEX is set. The directory must
+ * be owned by the user and not accessible by others, otherwise it is not
+ * used. The files are replaced atomically, so several probes may use the
+ * directory at the same time.
+ */
+#define OVAL_PKG_INDEX_ENV      "OSCAP_PACKAGE_INDEX"
+#define OVAL_PKG_INDEX_STAMPLEN 17
+
+/**
+ * Open the index directory, if enabled. Called by the probe before it
+ * changes its root directory.
+ */
+void oval_pkg_index_init(void);
+bool oval_pkg_index_enabled(void);
+
+/**
+ * Compute the stamp of the package database in the directory dbdir.
+ * @param stamp buffer of OVAL_PKG_INDEX_STAMPLEN bytes
+ * @return 0 on success, -1 if the directory can't be read
+ */
+int oval_pkg_index_stamp(const char *dbdir, char *stamp);
+
+/**
+ * Open the index `name' of the scanned root directory for reading.
+ * @return the stream positioned after the stamp line, or NULL if there
+ *         is no index with that stamp
+ */
+FILE *oval_pkg_index_open(const char *name, const char *stamp);
+
+/**
+ * Store the index `name' of the scanned root directory. write_fn writes
+ * the records after the stamp line and returns 0 on success.
+ */
+int oval_pkg_index_save(const char *name, const char *stamp,
+			int (*write_fn)(FILE *fp, void *arg), void *arg);
+
+#endif /* OVAL_PKG_INDEX_H */
@@ -0,0 +1,436 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "common/debug_priv.h"
+#include "oval_proctab.h"
+
+#define OVAL_PROC_STAT    0x01
+#define OVAL_PROC_STATUS  0x02
+#define OVAL_PROC_CMDLINE 0x04
+#define OVAL_PROC_ENVIRON 0x08
+#define OVAL_PROC_FD      0x10
+
+struct oval_proc {
+	pid_t pid;
+	unsigned int loaded; /* OVAL_PROC_* files read so far */
+
+	bool stat_ok;
+	struct oval_proc_stat stat;
+
+	bool uids_ok;
+	int ruid;
+	int euid;
+
+	char *cmdline;
+	size_t cmdline_len;
+
+	char *environ;
+	size_t environ_len;
+	int environ_err;
+
+	unsigned long *sockets;
+	size_t sockets_count;
+	int sockets_err;
+};
+
+static pthread_mutex_t __proctab_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct oval_proctab *__proctab = NULL;
+static bool __proctab_failed = false; /* /proc isn't read again until a reset */
+
+static struct oval_proctab *oval_proctab_read(void)
+{
+	struct oval_proctab *tab;
+	struct oval_proc *proc;
+	struct dirent *ent;
+	size_t alloc = 0;
+	DIR *d;
+	long pid;
+	char *end;
+
+	d = opendir("/proc");
+	if (d == NULL) {
+		dE("Can't read /proc: errno=%d, %s.", errno, strerror(errno));
+		return (NULL);
+	}
+
+	tab = calloc(1, sizeof *tab);
+	if (tab == NULL) {
+		closedir(d);
+		return (NULL);
+	}
+
+	while ((ent = readdir(d)) != NULL) {
+		if (*ent->d_name < '0' || *ent->d_name > '9')
+			continue;
+
+		errno = 0;
+		pid = strtol(ent->d_name, &end, 10);
+		if (errno != 0 || *end != '\0')
+			continue;
+
+		if (tab->count == alloc) {
+			struct oval_proc **procs;
+
+			alloc = alloc > 0 ? alloc * 2 : 512;
+			procs = realloc(tab->procs, alloc * sizeof(struct oval_proc *));
+			if (procs == NULL)
+				break;
+			tab->procs = procs;
+		}
+
+		proc = calloc(1, sizeof *proc);
+		if (proc == NULL)
+			break;
+
+		proc->pid = (pid_t)pid;
+		tab->procs[tab->count++] = proc;
+	}
+
+	closedir(d);
+	dI("Process table snapshot: %zu processes.", tab->count);
+	return (tab);
+}
+
+static void oval_proctab_free(struct oval_proctab *tab)
+{
+	struct oval_proc *proc;
+	size_t i;
+
+	for (i = 0; i < tab->count; ++i) {
+		proc = tab->procs[i];
+		free(proc->cmdline);
+		free(proc->environ);
+		free(proc->sockets);
+		free(proc);
+	}
+
+	free(tab->procs);
+	free(tab);
+}
+
+const struct oval_proctab *oval_proctab_get(void)
+{
+	struct oval_proctab *tab;
+
+	pthread_mutex_lock(&__proctab_lock);
+
+	if (__proctab == NULL && !__proctab_failed) {
+		__proctab = oval_proctab_read();
+		__proctab_failed = __proctab == NULL;
+	}
+	if ((tab = __proctab) != NULL)
+		++tab->refs;
+
+	pthread_mutex_unlock(&__proctab_lock);
+
+	return (tab);
+}
+
+void oval_proctab_put(const struct oval_proctab *tab)
+{
+	struct oval_proctab *t = (struct oval_proctab *)tab;
+
+	if (t == NULL)
+		return;
+
+	pthread_mutex_lock(&__proctab_lock);
+
+	/* a snapshot dropped by oval_proctab_reset goes with its last user */
+	if (--t->refs == 0 && t != __proctab)
+		oval_proctab_free(t);
+
+	pthread_mutex_unlock(&__proctab_lock);
+}
+
+void oval_proctab_reset(void)
+{
+	pthread_mutex_lock(&__proctab_lock);
+
+	if (__proctab != NULL && __proctab->refs == 0)
+		oval_proctab_free(__proctab);
+	__proctab = NULL;
+	__proctab_failed = false;
+
+	pthread_mutex_unlock(&__proctab_lock);
+}
+
+pid_t oval_proc_pid(const struct oval_proc *proc)
+{
+	return (proc->pid);
+}
+
+/* read a whole file, NULL if it can't be opened or read */
+static char *oval_proc_slurp(pid_t pid, const char *name, size_t *len, int *err)
+{
+	char path[64], *buf = NULL, *tmp;
+	size_t size = 0, used = 0;
+	ssize_t n;
+	int fd;
+
+	*len = 0;
+	snprintf(path, sizeof path, "/proc/%d/%s", (int)pid, name);
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		if (err != NULL)
+			*err = errno;
+		return (NULL);
+	}
+
+	for (;;) {
+		if (used + 1 >= size) {
+			size = size > 0 ? size * 2 : 1024;
+			tmp = realloc(buf, size);
+			if (tmp == NULL)
+				goto fail;
+			buf = tmp;
+		}
+
+		n = read(fd, buf + used, size - used - 1);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			goto fail;
+		}
+		if (n == 0)
+			break;
+		used += (size_t)n;
+	}
+
+	close(fd);
+	buf[used] = '\0';
+	*len = used;
+
+	return (buf);
+fail:
+	if (err != NULL)
+		*err = errno;
+	close(fd);
+	free(buf);
+
+	return (NULL);
+}
+
+static void oval_proc_read_stat(struct oval_proc *proc)
+{
+	char path[64], buf[512], *open_paren, *close_paren;
+	struct oval_proc_stat *st = &proc->stat;
+	unsigned long dummy_ul;
+	long dummy_l;
+	unsigned int flags;
+	int fd, len, tpgid;
+	size_t comm_len;
+
+	snprintf(path, sizeof path, "/proc/%d/stat", (int)proc->pid);
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return;
+	len = read(fd, buf, sizeof buf - 1);
+	close(fd);
+	if (len < 40)
+		return;
+	buf[len] = '\0';
+
+	open_paren = strchr(buf, '(');
+	close_paren = strrchr(buf, ')');
+	if (open_paren == NULL || close_paren == NULL || close_paren < open_paren)
+		return;
+
+	comm_len = close_paren - open_paren - 1;
+	if (comm_len > sizeof st->comm - 1)
+		comm_len = sizeof st->comm - 1;
+	memset(st->comm, 0, sizeof st->comm);
+	memcpy(st->comm, open_paren + 1, comm_len);
+
+	if (sscanf(close_paren + 2, "%c %d %d %d %d %d "
+		   "%u %lu %lu %lu %lu "
+		   "%lu %lu %ld %ld %ld "
+		   "%ld %ld %ld %llu",
+		   &st->state, &st->ppid, &st->pgrp, &st->session, &st->tty_nr, &tpgid,
+		   &flags, &dummy_ul, &dummy_ul, &dummy_ul, &dummy_ul,
+		   &st->utime, &st->stime, &dummy_l, &dummy_l, &st->priority,
+		   &dummy_l, &dummy_l, &dummy_l, &st->start_time) < 2)
+		return;
+
+	proc->stat_ok = true;
+}
+
+static void oval_proc_read_status(struct oval_proc *proc)
+{
+	char path[64], buf[256];
+	FILE *sf;
+
+	snprintf(path, sizeof path, "/proc/%d/status", (int)proc->pid);
+	sf = fopen(path, "rt");
+	if (sf == NULL)
+		return;
+
+	while (fgets(buf, sizeof buf, sf)) {
+		if (memcmp(buf, "Uid:", 4) == 0) {
+			if (sscanf(buf, "Uid: %d %d", &proc->ruid, &proc->euid) == 2)
+				proc->uids_ok = true;
+			break;
+		}
+	}
+
+	fclose(sf);
+}
+
+static void oval_proc_read_fd(struct oval_proc *proc)
+{
+	char path[64], ln[64 + 1 + 256], line[256], *s, *e;
+	struct dirent *ent;
+	unsigned long inode, *sockets;
+	size_t alloc = 0;
+	int lnlen;
+	DIR *f;
+
+	snprintf(path, sizeof path, "/proc/%d/fd", (int)proc->pid);
+	f = opendir(path);
+	if (f == NULL) {
+		proc->sockets_err = errno;
+		return;
+	}
+
+	while ((ent = readdir(f)) != NULL) {
+		if (ent->d_name[0] == '.')
+			continue;
+		snprintf(ln, sizeof ln, "%s/%s", path, ent->d_name);
+		if ((lnlen = readlink(ln, line, sizeof(line) - 1)) < 0)
+			continue;
+		line[lnlen] = '\0';
+
+		if (memcmp(line, "socket:", 7) == 0) {
+			/* Type 1 sockets */
+			s = strchr(line + 7, '[');
+			if (s == NULL)
+				continue;
+			s++;
+			e = strchr(s, ']');
+			if (e == NULL)
+				continue;
+			*e = '\0';
+		} else if (memcmp(line, "[0000]:", 7) == 0) {
+			/* Type 2 sockets */
+			s = line + 8;
+		} else
+			continue;
+
+		errno = 0;
+		inode = strtoul(s, NULL, 10);
+		if (errno)
+			continue;
+
+		if (proc->sockets_count == alloc) {
+			alloc = alloc > 0 ? alloc * 2 : 8;
+			sockets = realloc(proc->sockets, alloc * sizeof(unsigned long));
+			if (sockets == NULL)
+				break;
+			proc->sockets = sockets;
+		}
+		proc->sockets[proc->sockets_count++] = inode;
+	}
+
+	closedir(f);
+}
+
+/* read the file(s) of the process, once */
+static void oval_proc_load(struct oval_proc *proc, unsigned int what)
+{
+	pthread_mutex_lock(&__proctab_lock);
+
+	if ((proc->loaded & what) == 0) {
+		switch (what) {
+		case OVAL_PROC_STAT:
+			oval_proc_read_stat(proc);
+			break;
+		case OVAL_PROC_STATUS:
+			oval_proc_read_status(proc);
+			break;
+		case OVAL_PROC_CMDLINE:
+			proc->cmdline = oval_proc_slurp(proc->pid, "cmdline", &proc->cmdline_len, NULL);
+			break;
+		case OVAL_PROC_ENVIRON:
+			proc->environ = oval_proc_slurp(proc->pid, "environ", &proc->environ_len, &proc->environ_err);
+			break;
+		case OVAL_PROC_FD:
+			oval_proc_read_fd(proc);
+			break;
+		}
+		proc->loaded |= what;
+	}
+
+	pthread_mutex_unlock(&__proctab_lock);
+}
+
+const struct oval_proc_stat *oval_proc_stat(struct oval_proc *proc)
+{
+	oval_proc_load(proc, OVAL_PROC_STAT);
+	return (proc->stat_ok ? &proc->stat : NULL);
+}
+
+int oval_proc_uids(struct oval_proc *proc, int *ruid, int *euid)
+{
+	oval_proc_load(proc, OVAL_PROC_STATUS);
+
+	if (!proc->uids_ok)
+		return (-1);
+
+	*ruid = proc->ruid;
+	*euid = proc->euid;
+
+	return (0);
+}
+
+const char *oval_proc_cmdline(struct oval_proc *proc, size_t *len)
+{
+	oval_proc_load(proc, OVAL_PROC_CMDLINE);
+	*len = proc->cmdline_len;
+	return (proc->cmdline_len > 0 ? proc->cmdline : NULL);
+}
+
+const char *oval_proc_environ(struct oval_proc *proc, size_t *len, int *err)
+{
+	oval_proc_load(proc, OVAL_PROC_ENVIRON);
+	*len = proc->environ_len;
+	*err = proc->environ_err;
+	return (proc->environ);
+}
+
+const unsigned long *oval_proc_sockets(struct oval_proc *proc, size_t *count, int *err)
+{
+	oval_proc_load(proc, OVAL_PROC_FD);
+	*count = proc->sockets_count;
+	if (err != NULL)
+		*err = proc->sockets_err;
+	return (proc->sockets);
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef OVAL_PROCTAB_H
+#define OVAL_PROCTAB_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+/*
+ * Snapshot of the process table
+ *
+ * The process probes (process58, environmentvariable58,
+ * inetlisteningservers, iflisteners) used to list /proc and read the files of every
+ * process again for each object. The list of processes is now read once,
+ * the first time a probe asks for it, and kept until the probe is reset,
+ * i.e. for one scan. The files of a process are read when a
+ * probe first asks for the data they hold and kept with the process, so
+ * later objects are served from memory. All functions may be called from
+ * several threads.
+ *
+ * The files are parsed in the format of the Linux /proc; elsewhere the
+ * processes are listed but their data is reported as unavailable.
+ */
+
+/* fields of /proc/<pid>/stat */
+struct oval_proc_stat {
+	char comm[16];
+	char state;
+	int ppid;
+	int pgrp;
+	int session;
+	int tty_nr;
+	unsigned long utime;
+	unsigned long stime;
+	long priority;
+	unsigned long long start_time;
+};
+
+struct oval_proc;
+
+struct oval_proctab {
+	struct oval_proc **procs;
+	size_t count;
+	size_t refs; /* callers of oval_proctab_get which haven't put it yet */
+};
+
+/**
+ * Get the snapshot, reading /proc on the first call after a reset.
+ * The snapshot has to be released by oval_proctab_put.
+ * @return NULL if /proc can't be read
+ */
+const struct oval_proctab *oval_proctab_get(void);
+
+/**
+ * Release the snapshot got by oval_proctab_get.
+ */
+void oval_proctab_put(const struct oval_proctab *tab);
+
+/**
+ * Drop the snapshot, the next oval_proctab_get reads /proc again. The
+ * snapshot is freed when the callers still using it put it.
+ */
+void oval_proctab_reset(void);
+
+pid_t oval_proc_pid(const struct oval_proc *proc);
+
+/**
+ * @return the parsed stat file, or NULL if the process is gone
+ */
+const struct oval_proc_stat *oval_proc_stat(struct oval_proc *proc);
+
+/**
+ * Get the real and effective user IDs from the status file.
+ * @return 0 on success, -1 if the process is gone
+ */
+int oval_proc_uids(struct oval_proc *proc, int *ruid, int *euid);
+
+/**
+ * Get the raw content of the cmdline file, the arguments separated by
+ * NUL bytes.
+ * @return NULL if the file is empty or can't be read
+ */
+const char *oval_proc_cmdline(struct oval_proc *proc, size_t *len);
+
+/**
+ * Get the raw content of the environ file, "name=value" strings separated
+ * by NUL bytes.
+ * @param err set to the errno value of the failed open, or 0
+ * @return NULL if the file can't be read, otherwise the content which may
+ *         be empty
+ */
+const char *oval_proc_environ(struct oval_proc *proc, size_t *len, int *err);
+
+/**
+ * Get the inodes of the sockets the process has open, from the fd
+ * directory.
+ * @param err if not NULL, set to the errno value of the failed open of
+ *        the directory, or 0
+ * @return the array of inodes, NULL if there are none
+ */
+const unsigned long *oval_proc_sockets(struct oval_proc *proc, size_t *count, int *err);
+
+#endif /* OVAL_PROCTAB_H */
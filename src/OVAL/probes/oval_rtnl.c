@@ -0,0 +1,414 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "common/debug_priv.h"
+#include "oval_rtnl.h"
+
+#if defined(__linux__)
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/if_addr.h>
+#include <linux/if_link.h>
+
+static pthread_mutex_t __rtnl_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct oval_rtnl *__rtnl = NULL;
+static bool __rtnl_failed = false; /* not dumped again until a reset */
+
+/* grow an array to hold one more element, false if out of memory */
+static bool oval_rtnl_grow(void **array, size_t count, size_t *alloc, size_t size)
+{
+	void *tmp;
+
+	if (count < *alloc)
+		return (true);
+
+	*alloc = *alloc > 0 ? *alloc * 2 : 16;
+	tmp = realloc(*array, *alloc * size);
+	if (tmp == NULL)
+		return (false);
+	*array = tmp;
+
+	return (true);
+}
+
+static void oval_rtnl_copy(unsigned char *dst, size_t dst_size, const struct rtattr *rta)
+{
+	size_t len = RTA_PAYLOAD(rta);
+
+	memcpy(dst, RTA_DATA(rta), len < dst_size ? len : dst_size);
+}
+
+static int oval_rtnl_link_msg(struct oval_rtnl *rtnl, size_t *alloc, struct nlmsghdr *nh)
+{
+	struct ifinfomsg *ifi = NLMSG_DATA(nh);
+	struct oval_rtnl_link *link;
+	struct rtattr *rta;
+	int len;
+
+	if (!oval_rtnl_grow((void **)&rtnl->links, rtnl->links_count, alloc, sizeof *link))
+		return (-1);
+
+	link = &rtnl->links[rtnl->links_count];
+	memset(link, 0, sizeof *link);
+	link->index = ifi->ifi_index;
+	link->flags = ifi->ifi_flags;
+	link->type  = ifi->ifi_type;
+
+	len = IFLA_PAYLOAD(nh);
+	for (rta = IFLA_RTA(ifi); RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+		switch (rta->rta_type) {
+		case IFLA_IFNAME:
+			strncpy(link->name, RTA_DATA(rta), sizeof link->name - 1);
+			break;
+		case IFLA_ADDRESS:
+			link->hwaddr_len = RTA_PAYLOAD(rta) < sizeof link->hwaddr ?
+				RTA_PAYLOAD(rta) : sizeof link->hwaddr;
+			memcpy(link->hwaddr, RTA_DATA(rta), link->hwaddr_len);
+			break;
+		}
+	}
+
+	++rtnl->links_count;
+	return (0);
+}
+
+static int oval_rtnl_addr_msg(struct oval_rtnl *rtnl, size_t *alloc, struct nlmsghdr *nh)
+{
+	struct ifaddrmsg *ifa = NLMSG_DATA(nh);
+	struct oval_rtnl_addr *addr;
+	struct rtattr *rta, *local = NULL, *address = NULL;
+	int len;
+
+	if (ifa->ifa_family != AF_INET && ifa->ifa_family != AF_INET6)
+		return (0);
+	if (!oval_rtnl_grow((void **)&rtnl->addrs, rtnl->addrs_count, alloc, sizeof *addr))
+		return (-1);
+
+	addr = &rtnl->addrs[rtnl->addrs_count];
+	memset(addr, 0, sizeof *addr);
+	addr->index     = (int)ifa->ifa_index;
+	addr->family    = ifa->ifa_family;
+	addr->prefixlen = ifa->ifa_prefixlen;
+
+	len = IFA_PAYLOAD(nh);
+	for (rta = IFA_RTA(ifa); RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+		switch (rta->rta_type) {
+		case IFA_LOCAL:
+			local = rta;
+			break;
+		case IFA_ADDRESS:
+			address = rta;
+			break;
+		case IFA_BROADCAST:
+			addr->has_broadcast = true;
+			oval_rtnl_copy(addr->broadcast, sizeof addr->broadcast, rta);
+			break;
+		case IFA_LABEL:
+			strncpy(addr->label, RTA_DATA(rta), sizeof addr->label - 1);
+			break;
+		}
+	}
+
+	/* same as getifaddrs(): the local end of a point-to-point link */
+	if (local != NULL)
+		oval_rtnl_copy(addr->addr, sizeof addr->addr, local);
+	else if (address != NULL)
+		oval_rtnl_copy(addr->addr, sizeof addr->addr, address);
+	else
+		return (0);
+
+	++rtnl->addrs_count;
+	return (0);
+}
+
+/* like /proc/net/route, use the first hop of a multipath route */
+static void oval_rtnl_nexthop(struct oval_rtnl_route *route, const struct rtattr *mp)
+{
+	struct rtnexthop *rtnh = RTA_DATA(mp);
+	struct rtattr *rta;
+	int len;
+
+	if (RTA_PAYLOAD(mp) < sizeof *rtnh || rtnh->rtnh_len < sizeof *rtnh
+	    || rtnh->rtnh_len > RTA_PAYLOAD(mp))
+		return;
+
+	route->oif = rtnh->rtnh_ifindex;
+
+	len = rtnh->rtnh_len - RTNH_LENGTH(0);
+	for (rta = RTNH_DATA(rtnh); RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+		if (rta->rta_type == RTA_GATEWAY) {
+			route->has_gateway = true;
+			oval_rtnl_copy(route->gateway, sizeof route->gateway, rta);
+		}
+	}
+}
+
+static int oval_rtnl_route_msg(struct oval_rtnl *rtnl, size_t *alloc, struct nlmsghdr *nh)
+{
+	struct rtmsg *rtm = NLMSG_DATA(nh);
+	struct oval_rtnl_route *route;
+	struct rtattr *rta;
+	int len;
+
+	if (rtm->rtm_family != AF_INET && rtm->rtm_family != AF_INET6)
+		return (0);
+	if (!oval_rtnl_grow((void **)&rtnl->routes, rtnl->routes_count, alloc, sizeof *route))
+		return (-1);
+
+	route = &rtnl->routes[rtnl->routes_count];
+	memset(route, 0, sizeof *route);
+	route->family   = rtm->rtm_family;
+	route->dst_len  = rtm->rtm_dst_len;
+	route->type     = rtm->rtm_type;
+	route->protocol = rtm->rtm_protocol;
+	route->table    = rtm->rtm_table;
+	route->flags    = rtm->rtm_flags;
+
+	len = RTM_PAYLOAD(nh);
+	for (rta = RTM_RTA(rtm); RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+		switch (rta->rta_type) {
+		case RTA_DST:
+			oval_rtnl_copy(route->dst, sizeof route->dst, rta);
+			break;
+		case RTA_GATEWAY:
+			route->has_gateway = true;
+			oval_rtnl_copy(route->gateway, sizeof route->gateway, rta);
+			break;
+		case RTA_OIF:
+			if (RTA_PAYLOAD(rta) >= sizeof(int))
+				memcpy(&route->oif, RTA_DATA(rta), sizeof(int));
+			break;
+		case RTA_MULTIPATH:
+			oval_rtnl_nexthop(route, rta);
+			break;
+		case RTA_TABLE:
+			if (RTA_PAYLOAD(rta) >= sizeof(uint32_t))
+				memcpy(&route->table, RTA_DATA(rta), sizeof(uint32_t));
+			break;
+		}
+	}
+
+	++rtnl->routes_count;
+	return (0);
+}
+
+/* send one dump request and parse all of the replies */
+static int oval_rtnl_dump(int fd, int type, struct oval_rtnl *rtnl, size_t *alloc)
+{
+	struct {
+		struct nlmsghdr nh;
+		struct rtgenmsg g;
+	} req;
+	struct sockaddr_nl sa;
+	struct nlmsghdr *nh;
+	static char buf[32768];
+	ssize_t len;
+	int ret;
+
+	memset(&req, 0, sizeof req);
+	req.nh.nlmsg_len   = NLMSG_LENGTH(sizeof req.g);
+	req.nh.nlmsg_type  = type;
+	req.nh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+	req.nh.nlmsg_seq   = (uint32_t)type;
+	req.g.rtgen_family = AF_UNSPEC;
+
+	memset(&sa, 0, sizeof sa);
+	sa.nl_family = AF_NETLINK;
+
+	if (sendto(fd, &req, req.nh.nlmsg_len, 0, (struct sockaddr *)&sa, sizeof sa) < 0)
+		return (-1);
+
+	for (;;) {
+		len = recv(fd, buf, sizeof buf, 0);
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			return (-1);
+		}
+		if (len == 0)
+			return (-1);
+
+		for (nh = (struct nlmsghdr *)buf; NLMSG_OK(nh, len); nh = NLMSG_NEXT(nh, len)) {
+			if (nh->nlmsg_seq != (uint32_t)type)
+				continue;
+
+			switch (nh->nlmsg_type) {
+			case NLMSG_DONE:
+				return (0);
+			case NLMSG_ERROR:
+				errno = -((struct nlmsgerr *)NLMSG_DATA(nh))->error;
+				return (-1);
+			case RTM_NEWLINK:
+				ret = oval_rtnl_link_msg(rtnl, alloc, nh);
+				break;
+			case RTM_NEWADDR:
+				ret = oval_rtnl_addr_msg(rtnl, alloc, nh);
+				break;
+			case RTM_NEWROUTE:
+				ret = oval_rtnl_route_msg(rtnl, alloc, nh);
+				break;
+			default:
+				ret = 0;
+			}
+
+			if (ret != 0)
+				return (-1);
+		}
+	}
+}
+
+static void oval_rtnl_free(struct oval_rtnl *rtnl)
+{
+	free(rtnl->links);
+	free(rtnl->addrs);
+	free(rtnl->routes);
+	free(rtnl);
+}
+
+static struct oval_rtnl *oval_rtnl_read(void)
+{
+	struct oval_rtnl *rtnl;
+	size_t links_alloc = 0, addrs_alloc = 0, routes_alloc = 0;
+	size_t i;
+	int fd;
+
+	fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+	if (fd < 0) {
+		dW("Can't open a netlink socket: errno=%d, %s.", errno, strerror(errno));
+		return (NULL);
+	}
+
+	rtnl = calloc(1, sizeof *rtnl);
+	if (rtnl == NULL) {
+		close(fd);
+		return (NULL);
+	}
+
+	if (oval_rtnl_dump(fd, RTM_GETLINK, rtnl, &links_alloc) != 0
+	    || oval_rtnl_dump(fd, RTM_GETADDR, rtnl, &addrs_alloc) != 0
+	    || oval_rtnl_dump(fd, RTM_GETROUTE, rtnl, &routes_alloc) != 0) {
+		dW("Netlink dump failed: errno=%d, %s.", errno, strerror(errno));
+		close(fd);
+		oval_rtnl_free(rtnl);
+		return (NULL);
+	}
+
+	close(fd);
+
+	/* addresses without a label (IPv6) are named after their link */
+	for (i = 0; i < rtnl->addrs_count; ++i) {
+		const struct oval_rtnl_link *link;
+
+		if (rtnl->addrs[i].label[0] != '\0')
+			continue;
+		link = oval_rtnl_link(rtnl, rtnl->addrs[i].index);
+		if (link != NULL)
+			strcpy(rtnl->addrs[i].label, link->name);
+	}
+
+	dI("Netlink snapshot: %zu links, %zu addresses, %zu routes.",
+	   rtnl->links_count, rtnl->addrs_count, rtnl->routes_count);
+	return (rtnl);
+}
+
+const struct oval_rtnl *oval_rtnl_get(void)
+{
+	struct oval_rtnl *rtnl;
+
+	pthread_mutex_lock(&__rtnl_lock);
+
+	if (__rtnl == NULL && !__rtnl_failed) {
+		__rtnl = oval_rtnl_read();
+		__rtnl_failed = __rtnl == NULL;
+	}
+	if ((rtnl = __rtnl) != NULL)
+		++rtnl->refs;
+
+	pthread_mutex_unlock(&__rtnl_lock);
+
+	return (rtnl);
+}
+
+void oval_rtnl_put(const struct oval_rtnl *rtnl)
+{
+	struct oval_rtnl *r = (struct oval_rtnl *)rtnl;
+
+	if (r == NULL)
+		return;
+
+	pthread_mutex_lock(&__rtnl_lock);
+
+	/* a snapshot dropped by oval_rtnl_reset goes with its last user */
+	if (--r->refs == 0 && r != __rtnl)
+		oval_rtnl_free(r);
+
+	pthread_mutex_unlock(&__rtnl_lock);
+}
+
+void oval_rtnl_reset(void)
+{
+	pthread_mutex_lock(&__rtnl_lock);
+
+	if (__rtnl != NULL && __rtnl->refs == 0)
+		oval_rtnl_free(__rtnl);
+	__rtnl = NULL;
+	__rtnl_failed = false;
+
+	pthread_mutex_unlock(&__rtnl_lock);
+}
+
+#else
+
+const struct oval_rtnl *oval_rtnl_get(void)
+{
+	return (NULL);
+}
+
+void oval_rtnl_put(const struct oval_rtnl *rtnl)
+{
+}
+
+void oval_rtnl_reset(void)
+{
+}
+
+#endif /* __linux__ */
+
+const struct oval_rtnl_link *oval_rtnl_link(const struct oval_rtnl *rtnl, int index)
+{
+	size_t i;
+
+	for (i = 0; i < rtnl->links_count; ++i) {
+		if (rtnl->links[i].index == index)
+			return (&rtnl->links[i]);
+	}
+
+	return (NULL);
+}
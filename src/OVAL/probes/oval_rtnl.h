@@ -0,0 +1,107 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef OVAL_RTNL_H
+#define OVAL_RTNL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Snapshot of the network configuration
+ *
+ * The links, addresses and routes of the system are dumped with one
+ * RTM_GETLINK, RTM_GETADDR and RTM_GETROUTE request each, the first time
+ * a probe asks for them, and kept until the probe is reset. The
+ * interface and routingtable probes read them from here instead of doing
+ * an ioctl per interface or parsing /proc/net. Only available on Linux,
+ * oval_rtnl_get() returns NULL elsewhere or if the dump fails, and the
+ * probes fall back to the old way.
+ */
+
+#define OVAL_RTNL_NAMELEN 16 /* IFNAMSIZ */
+
+struct oval_rtnl_link {
+	int index;
+	char name[OVAL_RTNL_NAMELEN];
+	unsigned int flags;     /* IFF_* */
+	unsigned short type;    /* ARPHRD_* */
+	unsigned char hwaddr[32];
+	size_t hwaddr_len;
+};
+
+struct oval_rtnl_addr {
+	int index;              /* of the link */
+	char label[OVAL_RTNL_NAMELEN]; /* IFA_LABEL, or the name of the link */
+	unsigned char family;
+	unsigned char prefixlen;
+	unsigned char addr[16]; /* IFA_LOCAL, or IFA_ADDRESS */
+	bool has_broadcast;
+	unsigned char broadcast[16];
+};
+
+struct oval_rtnl_route {
+	unsigned char family;
+	unsigned char dst_len;
+	unsigned char type;     /* RTN_* */
+	unsigned char protocol; /* RTPROT_* */
+	uint32_t table;
+	uint32_t flags;         /* RTM_F_* */
+	unsigned char dst[16];
+	bool has_gateway;
+	unsigned char gateway[16];
+	int oif;                /* index of the output link, 0 if none */
+};
+
+struct oval_rtnl {
+	struct oval_rtnl_link *links;
+	size_t links_count;
+	struct oval_rtnl_addr *addrs;
+	size_t addrs_count;
+	struct oval_rtnl_route *routes;
+	size_t routes_count;
+	size_t refs; /* callers of oval_rtnl_get which haven't put it yet */
+};
+
+/**
+ * Get the snapshot, dumping it on the first call after a reset.
+ * The snapshot has to be released by oval_rtnl_put.
+ * @return NULL if netlink is not available
+ */
+const struct oval_rtnl *oval_rtnl_get(void);
+
+/**
+ * Release the snapshot got by oval_rtnl_get.
+ */
+void oval_rtnl_put(const struct oval_rtnl *rtnl);
+
+/**
+ * Drop the snapshot, the next oval_rtnl_get dumps it again. The snapshot
+ * is freed when the callers still using it put it.
+ */
+void oval_rtnl_reset(void);
+
+/**
+ * Find a link by its index.
+ * @return NULL if there is no such link
+ */
+const struct oval_rtnl_link *oval_rtnl_link(const struct oval_rtnl *rtnl, int index);
+
+#endif /* OVAL_RTNL_H */
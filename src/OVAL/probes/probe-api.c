@@ -36,6 +36,7 @@
 #include <stdarg.h>
 #include <string.h>
 #include <errno.h>
+#include <time.h>
 #include <arpa/inet.h> /* inet_pton() in probe_ent_from_cstr() */
 #include <netinet/in.h>
 
@@ -122,6 +123,12 @@ SEXP_t *probe_item_new(const char *name, SEXP_t * attrs)
 	itm = probe_obj_new(name, attrs);
 	SEXP_vfree(sid, attrs, NULL);
 
+	/*
+	 * Items are hashed by the icache worker; let entities added to
+	 * the item update the ID so that the item isn't traversed again.
+	 */
+	SEXP_ID_track(itm);
+
 	return itm;
 }
 
@@ -137,9 +144,9 @@ SEXP_t *probe_item_attr_add(SEXP_t * item, const char *name, SEXP_t * val)
 		 * Just add the new to the list.
 		 */
 		if (val == NULL)
-			ns = SEXP_string_new(name, strlen(name));
+			ns = probe_ncache_ref(OSCAP_GSYM(ncache), name);
 		else
-			ns = SEXP_string_newf(":%s", name);
+			ns = probe_ncache_attr_ref(OSCAP_GSYM(ncache), name);
 
 		SEXP_list_add(n_ref, ns);
 		SEXP_free(ns);
@@ -156,9 +163,9 @@ SEXP_t *probe_item_attr_add(SEXP_t * item, const char *name, SEXP_t * val)
 		SEXP_t *nl;
 
 		if (val == NULL)
-			ns = SEXP_string_new(name, strlen(name));
+			ns = probe_ncache_ref(OSCAP_GSYM(ncache), name);
 		else
-			ns = SEXP_string_newf(":%s", name);
+			ns = probe_ncache_attr_ref(OSCAP_GSYM(ncache), name);
 
 		nl = SEXP_list_new(n_ref, ns, val, NULL);
 
@@ -218,10 +225,157 @@ void probe_item_resetidctr(struct id_desc_t *id_desc)
 	id_desc->item_id_ctr = 1;
 }
 
+/*
+ * Index of the entities of an object or an item: the name of every entity
+ * and its member of the list, so that a lookup compares C strings instead
+ * of walking the list and comparing S-exp strings.
+ */
+#define PROBE_ENT_INDEX_MAX     64 /* objects with more entities are walked */
+#define PROBE_ENT_INDEX_NAMEMAX 56
+
+struct probe_ent_index {
+	const SEXP_t *obj;    /* NULL if nothing is indexed */
+	uint32_t      length; /* of the list of the object when indexed */
+	uint32_t      count;
+	struct {
+		char    name[PROBE_ENT_INDEX_NAMEMAX];
+		SEXP_t *ent; /* member of the list, not a reference */
+	} ents[PROBE_ENT_INDEX_MAX];
+};
+
+static int probe_ent_index_build(struct probe_ent_index *idx, const SEXP_t *obj)
+{
+	SEXP_list_it *it;
+	SEXP_t *ent, *ent_name;
+	int ret = 0;
+
+	idx->obj   = NULL;
+	idx->count = 0;
+
+	if ((it = SEXP_list_it_new(obj)) == NULL)
+		return (-1);
+
+	/* skip the name of the object */
+	SEXP_list_it_next(it);
+
+	while (ret == 0 && (ent = SEXP_list_it_next(it)) != NULL) {
+		ent_name = SEXP_list_first(ent);
+
+		if (SEXP_listp(ent_name)) {
+			SEXP_t *nr;
+
+			nr = SEXP_list_first(ent_name);
+			SEXP_free(ent_name);
+			ent_name = nr;
+		}
+
+		if (SEXP_stringp(ent_name)) {
+			/* longer names are looked up by the walk too */
+			if (idx->count == PROBE_ENT_INDEX_MAX
+			    || SEXP_string_cstr_r(ent_name, idx->ents[idx->count].name,
+						  PROBE_ENT_INDEX_NAMEMAX) == (size_t)-1) {
+				ret = -1;
+			} else {
+				idx->ents[idx->count].ent = ent;
+				++idx->count;
+			}
+		}
+
+		SEXP_free(ent_name);
+	}
+
+	SEXP_list_it_free(it);
+
+	if (ret == 0) {
+		idx->obj    = obj;
+		idx->length = SEXP_list_length(obj);
+	}
+
+	return (ret);
+}
+
+static SEXP_t *probe_ent_index_get(const struct probe_ent_index *idx, const char *name, uint32_t n)
+{
+	uint32_t i;
+
+	for (i = 0; i < idx->count; ++i) {
+		if (strcmp(idx->ents[i].name, name) == 0 && (--n == 0))
+			return (SEXP_ref(idx->ents[i].ent));
+	}
+
+	return (NULL);
+}
+
+/* the input object of the probe_main running in this thread */
+static __thread struct probe_ent_index __obj_index;
+
+void probe_obj_index_attach(const SEXP_t *obj)
+{
+	if (obj == NULL || probe_ent_index_build(&__obj_index, obj) != 0)
+		__obj_index.obj = NULL;
+}
+
+void probe_obj_index_detach(void)
+{
+	__obj_index.obj = NULL;
+}
+
+/* the deadline of the object collected in this thread */
+static __thread uint64_t __deadline;
+static __thread bool     __deadline_hit;
+
+uint64_t probe_deadline_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+void probe_deadline_attach(uint32_t timeout)
+{
+	__deadline     = timeout > 0 ? probe_deadline_now() + (uint64_t)timeout * 1000 : 0;
+	__deadline_hit = false;
+}
+
+bool probe_deadline_detach(void)
+{
+	bool hit = __deadline_hit;
+
+	__deadline     = 0;
+	__deadline_hit = false;
+
+	return (hit);
+}
+
+uint64_t probe_deadline_get(void)
+{
+	return (__deadline);
+}
+
+bool probe_ctx_expired(probe_ctx *ctx)
+{
+	if (__deadline == 0)
+		return (false);
+	if (!__deadline_hit && probe_deadline_now() < __deadline)
+		return (false);
+
+	__deadline_hit = true;
+	return (true);
+}
+
 bool probe_item_filtered(const SEXP_t *item, const SEXP_t *filters)
 {
 	bool filtered = false;
 	SEXP_t *filter, *ste;
+	struct probe_ent_index idx;
+	bool indexed;
+
+	if (SEXP_list_length(filters) == 0)
+		return (false);
+
+	/* every element of every filter looks up the entities of the item */
+	indexed = probe_ent_index_build(&idx, item) == 0;
 
 	SEXP_list_foreach(filter, filters) {
 		SEXP_t *felm, *ste_res, *r0;
@@ -245,7 +399,10 @@ bool probe_item_filtered(const SEXP_t *item, const SEXP_t *filters)
 			elm_name = probe_ent_getname(felm);
 
 			for (i = 1;; ++i) {
-				ielm = probe_obj_getent(item, elm_name, i);
+				if (indexed)
+					ielm = probe_ent_index_get(&idx, elm_name, i);
+				else
+					ielm = probe_obj_getent(item, elm_name, i);
 
 				if (ielm == NULL)
 					break;
@@ -311,11 +468,11 @@ SEXP_t *probe_attr_creat(const char *name, const SEXP_t * val, ...)
 
 	while (name != NULL) {
 		if (val == NULL) {
-			ns = SEXP_string_new(name, strlen(name));
+			ns = probe_ncache_ref(OSCAP_GSYM(ncache), name);
 			SEXP_list_add(list, ns);
 			SEXP_free(ns);
 		} else {
-			ns = SEXP_string_newf(":%s", name);
+			ns = probe_ncache_attr_ref(OSCAP_GSYM(ncache), name);
 			SEXP_list_add(list, ns);
 			SEXP_list_add(list, val);
 			SEXP_free(ns);
@@ -330,6 +487,29 @@ SEXP_t *probe_attr_creat(const char *name, const SEXP_t * val, ...)
 	return (list);
 }
 
+/*
+ * Build the attribute key ":<name>" in buf, or on the heap if it doesn't
+ * fit. The result has to be freed with probe_attrkey_free.
+ */
+static char *probe_attrkey(char *buf, size_t size, const char *name)
+{
+	size_t len = strlen(name);
+
+	if (len + 2 > size)
+		return oscap_sprintf(":%s", name);
+
+	buf[0] = ':';
+	memcpy(buf + 1, name, len + 1);
+
+	return (buf);
+}
+
+static void probe_attrkey_free(char *key, char *buf)
+{
+	if (key != buf)
+		oscap_free(key);
+}
+
 /*
  * objects
  */
@@ -409,6 +589,10 @@ SEXP_t *probe_obj_getent(const SEXP_t * obj, const char *name, uint32_t n)
 	_A(name != NULL);
 	_A(n > 0);
 
+	/* the object could have been changed since it was indexed only by adding or removing entities */
+	if (__obj_index.obj == obj && __obj_index.length == SEXP_list_length(obj))
+		return (probe_ent_index_get(&__obj_index, name, n));
+
 	ent = NULL;
 	objents = SEXP_list_rest(obj);
 
@@ -509,21 +693,19 @@ SEXP_t *probe_obj_getattrval(const SEXP_t * obj, const char *name)
 	if (SEXP_listp(obj_name)) {
 		uint32_t i;
 		SEXP_t *attr;
-		char *name_buf = NULL;
+		char buf[PROBE_NCACHE_ATTR_MAX], *key;
 
 		i = 2;
+		key = probe_attrkey(buf, sizeof buf, name);
 
 		while ((attr = SEXP_list_nth(obj_name, i)) != NULL) {
 			if (SEXP_stringp(attr)) {
 				if (SEXP_string_nth(attr, 1) == ':') {
-					if (name_buf == NULL) {
-						name_buf = oscap_sprintf(":%s", name);
-					}
-					if (SEXP_strcmp(attr, name_buf) == 0) {
+					if (SEXP_strcmp(attr, key) == 0) {
 						SEXP_t *val;
 
 						val = SEXP_list_nth(obj_name, i + 1);
-						oscap_free(name_buf);
+						probe_attrkey_free(key, buf);
 						SEXP_free(attr);
 						SEXP_free(obj_name);
 
@@ -538,7 +720,7 @@ SEXP_t *probe_obj_getattrval(const SEXP_t * obj, const char *name)
 
 			SEXP_free(attr);
 		}
-		oscap_free(name_buf);
+		probe_attrkey_free(key, buf);
 	}
 
 	SEXP_free(obj_name);
@@ -554,18 +736,16 @@ bool probe_obj_attrexists(const SEXP_t * obj, const char *name)
 	if (SEXP_listp(obj_name)) {
 		uint32_t i;
 		SEXP_t *attr;
-		char *name_buf = NULL;
+		char buf[PROBE_NCACHE_ATTR_MAX], *key;
 
 		i = 2;
+		key = probe_attrkey(buf, sizeof buf, name);
 
 		while ((attr = SEXP_list_nth(obj_name, i)) != NULL) {
 			if (SEXP_stringp(attr)) {
 				if (SEXP_string_nth(attr, 1) == ':') {
-					if (name_buf == NULL) {
-						name_buf = oscap_sprintf(":%s", name);
-					}
-					if (SEXP_strcmp(attr, name_buf) == 0) {
-						oscap_free(name_buf);
+					if (SEXP_strcmp(attr, key) == 0) {
+						probe_attrkey_free(key, buf);
 						SEXP_free(attr);
 						SEXP_free(obj_name);
 
@@ -574,7 +754,7 @@ bool probe_obj_attrexists(const SEXP_t * obj, const char *name)
 					++i;
 				} else {
 					if (SEXP_strcmp(attr, name) == 0) {
-						oscap_free(name_buf);
+						probe_attrkey_free(key, buf);
                                         SEXP_free(attr);
                                         SEXP_free(obj_name);
                                         return true;
@@ -585,7 +765,7 @@ bool probe_obj_attrexists(const SEXP_t * obj, const char *name)
 
 			SEXP_free(attr);
 		}
-		oscap_free(name_buf);
+		probe_attrkey_free(key, buf);
 	}
 
 	SEXP_free(obj_name);
@@ -633,17 +813,85 @@ SEXP_t *probe_cobj_new(oval_syschar_collection_flag_t flag, SEXP_t *msg_list, SE
 	return cobj;
 }
 
+/*
+ * A probe walking many files may report the same error for each of them.
+ * The repeated messages of an object are kept once and those beyond the
+ * first PROBE_COBJ_MSG_MAX are dropped, the drop is noted by one more.
+ */
+#define PROBE_COBJ_MSG_MAX 100
+
+static bool probe_cobj_has_msg(const SEXP_t *msgs, const SEXP_t *msg)
+{
+	SEXP_t *m;
+	bool found = false;
+
+	SEXP_list_foreach(m, msgs) {
+		if (SEXP_deepcmp(m, msg)) {
+			found = true;
+			SEXP_free(m);
+			break;
+		}
+	}
+	return found;
+}
+
 int probe_cobj_add_msg(SEXP_t *cobj, const SEXP_t *msg)
 {
 	SEXP_t *lst;
+	size_t count;
 
 	lst = SEXP_listref_nth(cobj, 2);
-	SEXP_list_add(lst, msg);
+	count = SEXP_list_length(lst);
+
+	if (count <= PROBE_COBJ_MSG_MAX && !probe_cobj_has_msg(lst, msg)) {
+		if (count < PROBE_COBJ_MSG_MAX) {
+			SEXP_list_add(lst, msg);
+		} else {
+			SEXP_t *note = probe_msg_creatf(OVAL_MESSAGE_LEVEL_WARNING,
+				"More than %d messages, the further ones are dropped.", PROBE_COBJ_MSG_MAX);
+			SEXP_list_add(lst, note);
+			SEXP_free(note);
+		}
+	}
 	SEXP_free(lst);
 
 	return 0;
 }
 
+int probe_cobj_add_msgf(SEXP_t *cobj, oval_message_level_t level, const char *fmt, ...)
+{
+	va_list alist;
+	int len;
+	char *cstr;
+	SEXP_t *lst, *lvl, *str, *msg;
+	size_t count;
+
+	/* the message isn't formatted at all once the object has too many */
+	lst = SEXP_listref_nth(cobj, 2);
+	count = SEXP_list_length(lst);
+	SEXP_free(lst);
+	if (count > PROBE_COBJ_MSG_MAX)
+		return 0;
+
+	va_start(alist, fmt);
+	len = vasprintf(&cstr, fmt, alist);
+	va_end(alist);
+	if (len < 0)
+		return -1;
+
+	dI("%s", cstr);
+	str = SEXP_string_new(cstr, len);
+	oscap_free(cstr);
+	lvl = SEXP_number_newu(level);
+	msg = SEXP_list_new(lvl, str, NULL);
+	SEXP_vfree(lvl, str, NULL);
+
+	probe_cobj_add_msg(cobj, msg);
+	SEXP_free(msg);
+
+	return 0;
+}
+
 SEXP_t *probe_cobj_get_msgs(const SEXP_t *cobj)
 {
 	return SEXP_list_nth(cobj, 2);
@@ -703,6 +951,34 @@ oval_syschar_collection_flag_t probe_cobj_get_flag(const SEXP_t *cobj)
 	return flag;
 }
 
+int probe_cobj_set_spill(SEXP_t *cobj, const char *name)
+{
+	SEXP_t *sname;
+
+	/* (flag msgs items mask spill) */
+	if (SEXP_list_length(cobj) != 4)
+		return -1;
+
+	sname = SEXP_string_newf("%s", name);
+	SEXP_list_add(cobj, sname);
+	SEXP_free(sname);
+
+	return 0;
+}
+
+char *probe_cobj_get_spill(const SEXP_t *cobj)
+{
+	SEXP_t *sname;
+	char *name = NULL;
+
+	sname = SEXP_list_nth(cobj, 5);
+	if (sname != NULL && SEXP_stringp(sname))
+		name = SEXP_string_cstr(sname);
+	SEXP_free(sname);
+
+	return name;
+}
+
 oval_syschar_collection_flag_t probe_cobj_combine_flags(oval_syschar_collection_flag_t f1,
 							oval_syschar_collection_flag_t f2,
 							oval_setobject_operation_t op)
@@ -1069,31 +1345,26 @@ SEXP_t *probe_ent_getattrval(const SEXP_t * ent, const char *name)
 	if (SEXP_listp(attrs)) {
 		SEXP_t *attr;
 		uint32_t i;
+		char buf[PROBE_NCACHE_ATTR_MAX], *key;
 
 		i = 2;
+		key = probe_attrkey(buf, sizeof buf, name);
 
 		while ((attr = SEXP_list_nth(attrs, i)) != NULL) {
 			if (SEXP_stringp(attr)) {
-				char attr_name[32 + 1];
-				size_t attr_nlen;
-
-				attr_nlen = SEXP_string_cstr_r(attr, attr_name, sizeof attr_name);
-
-				if (attr_nlen > 2) {
-					if (attr_name[0] == ':') {
-						if (strcmp(attr_name + 1, name) == 0) {
-							SEXP_free(attr);
-							attr = SEXP_list_nth(attrs, i + 1);
-							SEXP_free(attrs);
-							return attr;
-						}
-					}
+				if (SEXP_strcmp(attr, key) == 0) {
+					SEXP_free(attr);
+					attr = SEXP_list_nth(attrs, i + 1);
+					probe_attrkey_free(key, buf);
+					SEXP_free(attrs);
+					return attr;
 				}
 			}
 
                         SEXP_free(attr);
 			++i;
 		}
+		probe_attrkey_free(key, buf);
 	}
 
 	SEXP_free(attrs);
@@ -1554,6 +1825,207 @@ SEXP_t *probe_item_create(oval_subtype_t item_subtype, probe_elmatr_t *item_attr
         return (item);
 }
 
+struct probe_itemtpl_ent {
+	SEXP_t         *name;
+	oval_datatype_t type;
+};
+
+struct probe_itemtpl {
+	SEXP_t *name;    /* the name of the items */
+	SEXP_t *id_attr; /* ":id" */
+	SEXP_t *id;      /* the space for the ID generated by the icache worker */
+	size_t  count;
+	struct probe_itemtpl_ent ent[];
+};
+
+probe_itemtpl_t *probe_itemtpl_new(oval_subtype_t item_subtype, ...)
+{
+	va_list ap;
+	probe_itemtpl_t *tpl;
+	const char *subtype_name, *value_name;
+	char item_name[64];
+	size_t count, i;
+
+	subtype_name = oval_subtype_to_str(item_subtype);
+
+	if (subtype_name == NULL) {
+		dE("Invalid/Unknown subtype: %d", (int)item_subtype);
+		return (NULL);
+	}
+
+	if (snprintf(item_name, sizeof item_name, "%s_item", subtype_name) >= (int)sizeof item_name) {
+		dE("item name too long: no buffer space available");
+		return (NULL);
+	}
+
+	va_start(ap, item_subtype);
+
+	for (count = 0; va_arg(ap, const char *) != NULL; ++count)
+		(void)va_arg(ap, oval_datatype_t);
+
+	va_end(ap);
+
+	tpl = oscap_alloc(sizeof(probe_itemtpl_t) + sizeof(struct probe_itemtpl_ent) * count);
+	tpl->name    = probe_ncache_ref(OSCAP_GSYM(ncache), item_name);
+	tpl->id_attr = probe_ncache_attr_ref(OSCAP_GSYM(ncache), "id");
+	tpl->id      = SEXP_string_new("", 0);
+	tpl->count   = count;
+
+	va_start(ap, item_subtype);
+
+	for (i = 0; i < count; ++i) {
+		value_name = va_arg(ap, const char *);
+
+		tpl->ent[i].name = probe_ncache_ref(OSCAP_GSYM(ncache), value_name);
+		tpl->ent[i].type = va_arg(ap, oval_datatype_t);
+
+		if (tpl->ent[i].type == OVAL_DATATYPE_BINARY || tpl->ent[i].type == OVAL_DATATYPE_UNKNOWN) {
+			dE("Unknown or unsupported OVAL datatype: %d, '%s', name: '%s'.",
+			   tpl->ent[i].type, oval_datatype_get_text(tpl->ent[i].type), value_name);
+			tpl->count = i + 1;
+			probe_itemtpl_free(tpl);
+			va_end(ap);
+			return (NULL);
+		}
+	}
+
+	va_end(ap);
+
+	return (tpl);
+}
+
+void probe_itemtpl_free(probe_itemtpl_t *tpl)
+{
+	size_t i;
+
+	if (tpl == NULL)
+		return;
+
+	for (i = 0; i < tpl->count; ++i)
+		SEXP_free(tpl->ent[i].name);
+
+	SEXP_vfree(tpl->name, tpl->id_attr, tpl->id, NULL);
+	oscap_free(tpl);
+}
+
+/* add an entity with the value, the value is consumed if `free_value' */
+static int probe_itemtpl_add(SEXP_t *item, const struct probe_itemtpl_ent *ent,
+                             oval_datatype_t type, SEXP_t *value, bool free_value)
+{
+	SEXP_t *entity, entity_mem;
+
+	entity = SEXP_list_new_r(&entity_mem, ent->name, value, NULL);
+
+	if (probe_ent_setdatatype(entity, type) != 0) {
+		SEXP_free_r(&entity_mem);
+
+		if (free_value)
+			SEXP_free_r(value);
+
+		return (-1);
+	}
+
+	SEXP_list_add(item, entity);
+	SEXP_free_r(&entity_mem);
+
+	if (free_value)
+		SEXP_free_r(value);
+
+	return (0);
+}
+
+SEXP_t *probe_itemtpl_item(const probe_itemtpl_t *tpl, ...)
+{
+	va_list ap;
+	SEXP_t *item, *head, *value_sexp, value_sexp_mem;
+	const struct probe_itemtpl_ent *ent;
+	oval_datatype_t value_type;
+	char *value_str, **value_stra;
+	size_t i;
+	int ret;
+
+	/*
+	 * The same structure as the items of probe_item_new, only with the
+	 * names already looked up.
+	 */
+	head = SEXP_list_new(tpl->name, tpl->id_attr, tpl->id, NULL);
+	item = SEXP_list_new(head, NULL);
+	SEXP_free(head);
+	SEXP_ID_track(item);
+
+	va_start(ap, tpl);
+
+	for (i = 0; i < tpl->count; ++i) {
+		ent = &tpl->ent[i];
+		value_type = ent->type;
+		ret = 0;
+
+		switch (value_type) {
+		case OVAL_DATATYPE_STRING:
+		case OVAL_DATATYPE_EVR_STRING:
+		case OVAL_DATATYPE_DEBIAN_EVR_STRING:
+		case OVAL_DATATYPE_FILESET_REVISION:
+		case OVAL_DATATYPE_IOS_VERSION:
+		case OVAL_DATATYPE_IPV4ADDR:
+		case OVAL_DATATYPE_IPV6ADDR:
+		case OVAL_DATATYPE_VERSION:
+			value_str = va_arg(ap, char *);
+
+			if (value_str == NULL)
+				break;
+
+			value_sexp = SEXP_string_new_r(&value_sexp_mem, value_str, strlen(value_str));
+			ret = probe_itemtpl_add(item, ent, value_type, value_sexp, true);
+			break;
+		case OVAL_DATATYPE_STRING_M:
+			value_stra = va_arg(ap, char **);
+
+			for (; value_stra != NULL && *value_stra != NULL && ret == 0; ++value_stra) {
+				value_sexp = SEXP_string_new_r(&value_sexp_mem, *value_stra, strlen(*value_stra));
+				ret = probe_itemtpl_add(item, ent, OVAL_DATATYPE_STRING, value_sexp, true);
+			}
+			break;
+		case OVAL_DATATYPE_BOOLEAN:
+			value_sexp = SEXP_number_newb_r(&value_sexp_mem, (bool)va_arg(ap, int));
+			ret = probe_itemtpl_add(item, ent, value_type, value_sexp, true);
+			break;
+		case OVAL_DATATYPE_INTEGER:
+			value_sexp = SEXP_number_newi_64_r(&value_sexp_mem, va_arg(ap, int64_t));
+			ret = probe_itemtpl_add(item, ent, value_type, value_sexp, true);
+			break;
+		case OVAL_DATATYPE_FLOAT:
+			value_sexp = SEXP_number_newf_r(&value_sexp_mem, va_arg(ap, double));
+			ret = probe_itemtpl_add(item, ent, value_type, value_sexp, true);
+			break;
+		case OVAL_DATATYPE_SEXP:
+			value_sexp = va_arg(ap, SEXP_t *);
+
+			if (value_sexp == NULL)
+				break;
+
+			ret = probe_itemtpl_add(item, ent, _sexp_val_getdatatype(value_sexp), value_sexp, false);
+			break;
+		case OVAL_DATATYPE_RECORD:
+			value_sexp = va_arg(ap, SEXP_t *);
+			SEXP_list_add(item, value_sexp);
+			break;
+		default:
+			/* rejected by probe_itemtpl_new */
+			ret = -1;
+		}
+
+		if (ret != 0) {
+			SEXP_free(item);
+			va_end(ap);
+			return (NULL);
+		}
+	}
+
+	va_end(ap);
+
+	return (item);
+}
+
 oval_operation_t probe_ent_getoperation(SEXP_t *entity, oval_operation_t default_op)
 {
         oval_operation_t ret;
@@ -1779,4 +2251,25 @@ SEXP_t *probe_obj_getmask(SEXP_t *obj)
     return (mask);
 }
 
+bool probe_obj_entity_wanted(const SEXP_t *obj, const char *name)
+{
+	SEXP_t *names, *s_name;
+	uint32_t i;
+	bool wanted;
+
+	if ((names = probe_obj_getattrval(obj, "entities")) == NULL)
+		return true;
+
+	wanted = false;
+
+	for (i = 1; !wanted && (s_name = SEXP_list_nth(names, i)) != NULL; ++i) {
+		wanted = SEXP_strcmp(s_name, name) == 0;
+		SEXP_free(s_name);
+	}
+
+	SEXP_free(names);
+
+	return (wanted);
+}
+
 /// @}
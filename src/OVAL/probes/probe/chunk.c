@@ -0,0 +1,152 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <errno.h>
+#include <string.h>
+#include <pthread.h>
+#include <sexp.h>
+#include <seap.h>
+
+#include "common/alloc.h"
+#include "common/debug_priv.h"
+#include "probe-api.h"
+
+#include "chunk.h"
+
+struct probe_chunk {
+        SEAP_CTX_t *ctx;
+        int         sd;
+        SEAP_msg_t *req;
+        size_t      count;  /**< items sent */
+        size_t      chunks; /**< chunks sent */
+        oval_syschar_collection_flag_t flag; /**< of the items sent */
+        bool        failed; /**< a chunk couldn't be sent, keep the rest */
+};
+
+probe_chunk_t *probe_chunk_new(SEAP_CTX_t *ctx, int sd, SEAP_msg_t *req)
+{
+        probe_chunk_t *chunk;
+
+        if (!SEAP_msgattr_exists(req, "chunked") || SEAP_msgattr_exists(req, "no-reply"))
+                return (NULL);
+
+        chunk = oscap_talloc(probe_chunk_t);
+        chunk->ctx    = ctx;
+        chunk->sd     = sd;
+        chunk->req    = req;
+        chunk->count  = 0;
+        chunk->chunks = 0;
+        chunk->flag   = SYSCHAR_FLAG_UNKNOWN;
+        chunk->failed = false;
+
+        return (chunk);
+}
+
+int probe_chunk_flush(probe_chunk_t *chunk, probe_icache_t *icache, SEXP_t *cobj, size_t count)
+{
+        oval_syschar_collection_flag_t flag;
+        SEXP_t *items, *body, *empty, *old;
+        SEAP_msg_t *msg;
+        size_t n;
+        int ret, state;
+
+        if (chunk == NULL || chunk->failed || count < PROBE_CHUNK_ITEMS)
+                return (0);
+
+        /* the probe may run with asynchronous cancelation, see probe_worker_main */
+        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &state);
+
+        /* the icache thread appends the items to the object */
+        if (probe_icache_nop(icache) != 0) {
+                pthread_setcancelstate(state, NULL);
+                return (-1);
+        }
+
+        items = probe_cobj_get_items(cobj);
+        n = SEXP_list_length(items);
+        body = probe_cobj_new(SYSCHAR_FLAG_UNKNOWN, NULL, items, NULL);
+        flag = probe_cobj_compute_flag(body);
+
+        msg = SEAP_msg_new();
+        SEAP_msg_set(msg, body);
+
+        if (SEAP_msgattr_set(msg, "chunk", NULL) != 0)
+                ret = -1;
+        else
+                ret = SEAP_reply(chunk->ctx, chunk->sd, msg, chunk->req);
+
+        SEAP_msg_free(msg);
+        SEXP_free(body);
+        SEXP_free(items);
+
+        if (ret != 0) {
+                dW("Can't send a chunk of %zu items: %s.", n, strerror(errno));
+                chunk->failed = true;
+                pthread_setcancelstate(state, NULL);
+                return (-1);
+        }
+
+        /* (flag msgs items mask) */
+        empty = SEXP_list_new(NULL);
+        old = SEXP_list_replace(cobj, 3, empty);
+        SEXP_free(old);
+        SEXP_free(empty);
+
+        chunk->flag = chunk->chunks == 0 ? flag :
+                probe_cobj_combine_flags(chunk->flag, flag, OVAL_SET_OPERATION_UNION);
+        chunk->count += n;
+        chunk->chunks++;
+        pthread_setcancelstate(state, NULL);
+
+        return (0);
+}
+
+size_t probe_chunk_count(const probe_chunk_t *chunk)
+{
+        return (chunk != NULL ? chunk->count : 0);
+}
+
+void probe_chunk_finish(probe_chunk_t *chunk, SEXP_t *cobj)
+{
+        oval_syschar_collection_flag_t flag;
+
+        if (chunk == NULL || chunk->chunks == 0)
+                return;
+
+        dI("%zu items sent in %zu chunks.", chunk->count, chunk->chunks);
+
+        if (probe_cobj_get_flag(cobj) != SYSCHAR_FLAG_UNKNOWN)
+                return;
+
+        /* no items left means no change, not "does not exist" */
+        flag = probe_cobj_compute_flag(cobj);
+        probe_cobj_set_flag(cobj, probe_cobj_combine_flags(chunk->flag, flag, OVAL_SET_OPERATION_UNION));
+}
+
+void probe_chunk_free(probe_chunk_t *chunk)
+{
+        oscap_free(chunk);
+}
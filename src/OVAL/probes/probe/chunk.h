@@ -0,0 +1,65 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef CHUNK_H
+#define CHUNK_H
+
+#include <stddef.h>
+#include <sexp.h>
+#include <seap.h>
+#include "icache.h"
+
+/*
+ * Chunked replies
+ *
+ * If the request has the "chunked" attribute, the items collected so far
+ * are sent to the library in a chunk whenever PROBE_CHUNK_ITEMS of them
+ * are deduplicated, instead of all of them in the reply. A chunk is a
+ * message with the "chunk" attribute and the reply-id of the request; its
+ * body is a collected object with just the items. The reply comes last
+ * with the flag of the whole object, the messages and the rest of the
+ * items. The library converts the items of the chunks as they arrive
+ * (see SEAP_msgstream_set), so it asks for chunks only if it does.
+ */
+#define PROBE_CHUNK_ITEMS 1024
+
+typedef struct probe_chunk probe_chunk_t;
+
+/* NULL if the library didn't ask for chunks */
+probe_chunk_t *probe_chunk_new(SEAP_CTX_t *ctx, int sd, SEAP_msg_t *req);
+
+/*
+ * Send the items of the collected object in a chunk, if there are at
+ * least PROBE_CHUNK_ITEMS of them by `count'. Returns 0 on success or if
+ * there was nothing to send, -1 if the items were kept in the object.
+ */
+int probe_chunk_flush(probe_chunk_t *chunk, probe_icache_t *icache, SEXP_t *cobj, size_t count);
+
+/* number of items sent in chunks */
+size_t probe_chunk_count(const probe_chunk_t *chunk);
+
+/*
+ * Compute the flag of the collected object from both the sent items and
+ * those left in the object, unless it was set by the probe.
+ */
+void probe_chunk_finish(probe_chunk_t *chunk, SEXP_t *cobj);
+
+void probe_chunk_free(probe_chunk_t *chunk);
+
+#endif /* CHUNK_H */
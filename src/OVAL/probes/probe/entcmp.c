@@ -33,6 +33,9 @@
 
 #include <sexp.h>
 #include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
 #include <errno.h>
@@ -49,6 +52,7 @@
 #include "../../results/oval_cmp_basic_impl.h"
 #include "../../results/oval_cmp_evr_string_impl.h"
 #include "../../results/oval_cmp_ip_address_impl.h"
+#include "common/alloc.h"
 
 oval_result_t probe_ent_cmp_binary(SEXP_t * val1, SEXP_t * val2, oval_operation_t op)
 {
@@ -450,10 +454,6 @@ oval_result_t probe_entobj_cmp(SEXP_t * ent_obj, SEXP_t * val)
 	return ores;
 }
 
-struct _oresults {
-	int true_cnt, false_cnt, unknown_cnt, error_cnt, noteval_cnt, notappl_cnt;
-};
-
 static int results_parser(SEXP_t * res_lst, struct _oresults *ores)
 {
 	oval_result_t r;
@@ -490,18 +490,10 @@ static int results_parser(SEXP_t * res_lst, struct _oresults *ores)
 	return 0;
 }
 
-// todo: already implemented elsewhere; consolidate
-oval_result_t probe_ent_result_bychk(SEXP_t * res_lst, oval_check_t check)
+oval_result_t probe_ent_results_bychk(const struct _oresults *counts, oval_check_t check)
 {
 	oval_result_t result = OVAL_RESULT_UNKNOWN;
-	struct _oresults ores;
-
-	if (SEXP_list_length(res_lst) == 0)
-		return OVAL_RESULT_UNKNOWN;
-
-	if (results_parser(res_lst, &ores) != 0) {
-		return OVAL_RESULT_ERROR;
-	}
+	struct _oresults ores = *counts;
 
 	if (ores.notappl_cnt > 0 &&
 	    ores.noteval_cnt == 0 &&
@@ -579,10 +571,24 @@ oval_result_t probe_ent_result_bychk(SEXP_t * res_lst, oval_check_t check)
 	return result;
 }
 
+// todo: already implemented elsewhere; consolidate
+oval_result_t probe_ent_result_bychk(SEXP_t * res_lst, oval_check_t check)
+{
+	struct _oresults ores;
+
+	if (SEXP_list_length(res_lst) == 0)
+		return OVAL_RESULT_UNKNOWN;
+
+	if (results_parser(res_lst, &ores) != 0) {
+		return OVAL_RESULT_ERROR;
+	}
+
+	return probe_ent_results_bychk(&ores, check);
+}
+
 // todo: already implemented elsewhere; consolidate
 oval_result_t probe_ent_result_byopr(SEXP_t * res_lst, oval_operator_t operator)
 {
-	oval_result_t result = OVAL_RESULT_UNKNOWN;
 	struct _oresults ores;
 
 	if (SEXP_list_length(res_lst) == 0)
@@ -592,6 +598,14 @@ oval_result_t probe_ent_result_byopr(SEXP_t * res_lst, oval_operator_t operator)
 		return OVAL_RESULT_ERROR;
 	}
 
+	return probe_ent_results_byopr(&ores, operator);
+}
+
+oval_result_t probe_ent_results_byopr(const struct _oresults *counts, oval_operator_t operator)
+{
+	oval_result_t result = OVAL_RESULT_UNKNOWN;
+	struct _oresults ores = *counts;
+
 	if (ores.notappl_cnt > 0 &&
 	    ores.noteval_cnt == 0 &&
 	    ores.false_cnt == 0 && ores.error_cnt == 0 && ores.unknown_cnt == 0 && ores.true_cnt == 0)
@@ -680,4 +694,428 @@ oval_result_t probe_ent_result_byopr(SEXP_t * res_lst, oval_operator_t operator)
 	return result;
 }
 
+struct probe_entobj_val {
+	SEXP_t      *sexp;   /**< the value as received */
+	SEXP_type_t  type;
+	char        *str;    /**< the string value, NULL for numbers */
+	bool         parsed; /**< whether the prepared value below is valid */
+	union {
+		int64_t integer;
+		double real;
+		int boolean;
+		struct oval_evr evr; /**< the parts point into str */
+		struct {
+			int *fields;
+			int count;
+		} version;
+		struct {
+			uint32_t mask;
+			struct in6_addr addr; /**< or struct in_addr */
+		} ipaddr;
+		struct oval_regex *regex;
+	} u;
+};
+
+struct probe_entobj {
+	oval_datatype_t          datatype;
+	oval_operation_t         operation;
+	oval_check_t             var_check;
+	bool                     is_var;
+	bool                     error;   /**< a value without var_ref must be single */
+	bool                     textual; /**< the values are compared as C strings */
+	bool                     prepared; /**< all the values were prepared */
+	struct probe_entobj_val *vals;
+	size_t                   count;
+	char                   **sorted;  /**< the string values of an equals var_ref, sorted */
+};
+
+static int probe_entobj_strcmp(const void *a, const void *b)
+{
+	return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+static void probe_entobj_val_prepare(probe_entobj_t *entobj, struct probe_entobj_val *ev)
+{
+	ev->type = SEXP_typeof(ev->sexp);
+
+	if (SEXP_numberp(ev->sexp)) {
+		switch (entobj->datatype) {
+		case OVAL_DATATYPE_INTEGER:
+			ev->u.integer = SEXP_number_geti_64(ev->sexp);
+			ev->parsed = true;
+			break;
+		case OVAL_DATATYPE_FLOAT:
+			ev->u.real = SEXP_number_getf(ev->sexp);
+			ev->parsed = true;
+			break;
+		case OVAL_DATATYPE_BOOLEAN:
+			ev->u.boolean = SEXP_number_geti_32(ev->sexp);
+			ev->parsed = true;
+			break;
+		default:
+			break;
+		}
+		return;
+	}
+
+	if (!SEXP_stringp(ev->sexp) || !entobj->textual)
+		return;
+
+	ev->str = SEXP_string_cstr(ev->sexp);
+	if (ev->str == NULL)
+		return;
+
+	switch (entobj->datatype) {
+	case OVAL_DATATYPE_STRING:
+		if (entobj->operation == OVAL_OPERATION_PATTERN_MATCH) {
+			ev->u.regex = oval_regex_new(ev->str);
+			ev->parsed = ev->u.regex != NULL;
+		} else {
+			ev->parsed = true;
+		}
+		break;
+	case OVAL_DATATYPE_BINARY:
+		ev->parsed = true;
+		break;
+	case OVAL_DATATYPE_EVR_STRING:
+	case OVAL_DATATYPE_DEBIAN_EVR_STRING:
+		oval_evr_parse(ev->str, &ev->u.evr);
+		ev->parsed = true;
+		break;
+	case OVAL_DATATYPE_VERSION:
+		ev->u.version.fields = oval_versiontype_parse(ev->str, &ev->u.version.count);
+		ev->parsed = true;
+		break;
+	case OVAL_DATATYPE_IPV4ADDR:
+	case OVAL_DATATYPE_IPV6ADDR:
+		ev->parsed = oval_ipaddr_parse(entobj->datatype == OVAL_DATATYPE_IPV4ADDR ? AF_INET : AF_INET6,
+					       ev->str, &ev->u.ipaddr.mask, &ev->u.ipaddr.addr) == 0;
+		break;
+	default:
+		break;
+	}
+}
+
+probe_entobj_t *probe_entobj_new(SEXP_t *ent_obj)
+{
+	probe_entobj_t *entobj;
+	SEXP_t *vals, *val, *stmp;
+	size_t i;
+
+	entobj = oscap_calloc(1, sizeof(probe_entobj_t));
+
+	vals = NULL;
+	entobj->count = probe_ent_getvals(ent_obj, &vals);
+	entobj->is_var = probe_ent_attrexists(ent_obj, "var_ref");
+	entobj->error = !entobj->is_var && entobj->count != 1;
+	entobj->datatype = probe_ent_getdatatype(ent_obj);
+
+	stmp = probe_ent_getattrval(ent_obj, "operation");
+	entobj->operation = stmp == NULL ? OVAL_OPERATION_EQUALS : SEXP_number_geti_32(stmp);
+	SEXP_free(stmp);
+
+	stmp = probe_ent_getattrval(ent_obj, "var_check");
+	entobj->var_check = stmp == NULL ? OVAL_CHECK_ALL : SEXP_number_geti_32(stmp);
+	SEXP_free(stmp);
+
+	switch (entobj->datatype) {
+	case OVAL_DATATYPE_DEBIAN_EVR_STRING:
+		dW("Using RPM algorithm to compare epoch, version and release.");
+		/* FALLTHROUGH */
+	case OVAL_DATATYPE_STRING:
+	case OVAL_DATATYPE_BINARY:
+	case OVAL_DATATYPE_EVR_STRING:
+	case OVAL_DATATYPE_VERSION:
+	case OVAL_DATATYPE_IPV4ADDR:
+	case OVAL_DATATYPE_IPV6ADDR:
+		entobj->textual = true;
+		break;
+	default:
+		break;
+	}
+
+	entobj->vals = oscap_calloc(entobj->count + 1, sizeof(struct probe_entobj_val));
+	entobj->prepared = true;
+	i = 0;
+	SEXP_list_foreach(val, vals) {
+		if (i == entobj->count) {
+			SEXP_free(val);
+			break;
+		}
+		entobj->vals[i].sexp = SEXP_ref(val);
+		probe_entobj_val_prepare(entobj, &entobj->vals[i]);
+		entobj->prepared = entobj->prepared && entobj->vals[i].parsed;
+		++i;
+	}
+	entobj->count = i;
+	SEXP_free(vals);
+
+	/* the values of a variable are looked up instead of compared one by one */
+	if (entobj->prepared && entobj->is_var && entobj->count > 1
+	    && entobj->datatype == OVAL_DATATYPE_STRING && entobj->operation == OVAL_OPERATION_EQUALS) {
+		entobj->sorted = oscap_alloc(entobj->count * sizeof(char *));
+		for (i = 0; i < entobj->count; ++i)
+			entobj->sorted[i] = entobj->vals[i].str;
+		qsort(entobj->sorted, entobj->count, sizeof(char *), probe_entobj_strcmp);
+	}
+
+	return entobj;
+}
+
+void probe_entobj_free(probe_entobj_t *entobj)
+{
+	size_t i;
+
+	if (entobj == NULL)
+		return;
+
+	for (i = 0; i < entobj->count; ++i) {
+		struct probe_entobj_val *ev = &entobj->vals[i];
+
+		if (ev->parsed && ev->str != NULL) {
+			if (entobj->datatype == OVAL_DATATYPE_STRING && entobj->operation == OVAL_OPERATION_PATTERN_MATCH)
+				oval_regex_free(ev->u.regex);
+			else if (entobj->datatype == OVAL_DATATYPE_VERSION)
+				oscap_free(ev->u.version.fields);
+		}
+		oscap_free(ev->str);
+		SEXP_free(ev->sexp);
+	}
+	oscap_free(entobj->vals);
+	oscap_free(entobj->sorted);
+	oscap_free(entobj);
+}
+
+static oval_result_t probe_entobj_val_cmp(probe_entobj_t *entobj, struct probe_entobj_val *ev, SEXP_t *val, const char *str)
+{
+	oval_operation_t op = entobj->operation;
+
+	if (!ev->parsed || (entobj->textual && str == NULL))
+		return probe_ent_cmp_single(ev->sexp, entobj->datatype, val, op);
+
+	switch (entobj->datatype) {
+	case OVAL_DATATYPE_STRING:
+		if (op == OVAL_OPERATION_PATTERN_MATCH)
+			return oval_regex_match(ev->u.regex, str);
+		return oval_string_cmp(ev->str, str, op);
+	case OVAL_DATATYPE_BINARY:
+		return oval_binary_cmp(ev->str, str, op);
+	case OVAL_DATATYPE_EVR_STRING:
+	case OVAL_DATATYPE_DEBIAN_EVR_STRING: {
+		struct oval_evr sys_evr;
+
+		oval_evr_parse(str, &sys_evr);
+		return oval_evr_string_cmp_parsed(&ev->u.evr, &sys_evr, op);
+	}
+	case OVAL_DATATYPE_VERSION:
+		return oval_versiontype_cmp_parsed(ev->u.version.fields, ev->u.version.count, str, op);
+	case OVAL_DATATYPE_IPV4ADDR:
+	case OVAL_DATATYPE_IPV6ADDR:
+		return oval_ipaddr_cmp_parsed(entobj->datatype == OVAL_DATATYPE_IPV4ADDR ? AF_INET : AF_INET6,
+					      &ev->u.ipaddr.addr, ev->u.ipaddr.mask, str, op);
+	case OVAL_DATATYPE_INTEGER:
+		return oval_int_cmp(ev->u.integer, SEXP_number_geti_64(val), op);
+	case OVAL_DATATYPE_FLOAT:
+		return oval_float_cmp(ev->u.real, SEXP_number_getf(val), op);
+	case OVAL_DATATYPE_BOOLEAN:
+		return oval_boolean_cmp(ev->u.boolean, SEXP_number_geti_32(val), op);
+	default:
+		return probe_ent_cmp_single(ev->sexp, entobj->datatype, val, op);
+	}
+}
+
+void probe_ent_results_add(struct _oresults *ores, oval_result_t res)
+{
+	switch (res) {
+	case OVAL_RESULT_TRUE:
+		++(ores->true_cnt);
+		break;
+	case OVAL_RESULT_FALSE:
+		++(ores->false_cnt);
+		break;
+	case OVAL_RESULT_UNKNOWN:
+		++(ores->unknown_cnt);
+		break;
+	case OVAL_RESULT_NOT_EVALUATED:
+		++(ores->noteval_cnt);
+		break;
+	case OVAL_RESULT_NOT_APPLICABLE:
+		++(ores->notappl_cnt);
+		break;
+	default:
+		++(ores->error_cnt);
+		break;
+	}
+}
+
+/* val may be NULL if the value is the string str */
+static oval_result_t probe_entobj_match_raw(probe_entobj_t *entobj, SEXP_t *val, const char *str)
+{
+	SEXP_type_t type = val != NULL ? SEXP_typeof(val) : SEXP_TYPE_STRING;
+	oval_result_t ores = OVAL_RESULT_ERROR;
+	struct _oresults counts;
+	size_t i;
+
+	if (entobj->count == 0)
+		return OVAL_RESULT_FALSE;
+	if (entobj->error)
+		return OVAL_RESULT_ERROR;
+
+	memset(&counts, 0, sizeof counts);
+
+	if (entobj->sorted != NULL && str != NULL && type == SEXP_TYPE_STRING) {
+		size_t lo = 0, hi = entobj->count;
+
+		/* the first value not less than str, then all the equal ones */
+		while (lo < hi) {
+			size_t mid = lo + (hi - lo) / 2;
+
+			if (strcmp(entobj->sorted[mid], str) < 0)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		while (lo < entobj->count && strcmp(entobj->sorted[lo], str) == 0) {
+			++counts.true_cnt;
+			++lo;
+		}
+		counts.false_cnt = entobj->count - counts.true_cnt;
+	} else {
+		for (i = 0; i < entobj->count; ++i) {
+			if (entobj->vals[i].type != type) {
+				dI("Types of values to compare don't match: val1: %d, val2: %d",
+				   entobj->vals[i].type, type);
+				return OVAL_RESULT_ERROR;
+			}
+			ores = probe_entobj_val_cmp(entobj, &entobj->vals[i], val, str);
+			probe_ent_results_add(&counts, ores);
+		}
+	}
+
+	if (entobj->is_var)
+		ores = probe_ent_results_bychk(&counts, entobj->var_check);
+
+	return ores;
+}
+
+/* val may be NULL if the value is the string str */
+static oval_result_t probe_entobj_match_val(probe_entobj_t *entobj, SEXP_t *val, const char *str)
+{
+	oval_result_t ores;
+
+	ores = probe_entobj_match_raw(entobj, val, str);
+
+	if (ores == OVAL_RESULT_NOT_EVALUATED)
+		return OVAL_RESULT_FALSE;
+	return ores;
+}
+
+/* raw keeps the not evaluated result, as probe_ent_cmp does */
+static oval_result_t probe_entobj_match_sexp(probe_entobj_t *entobj, SEXP_t *val, bool raw)
+{
+	char buf[256], *str = NULL;
+	oval_result_t ores;
+
+	if (entobj->textual && SEXP_stringp(val)) {
+		size_t len = SEXP_string_length(val);
+
+		str = len < sizeof buf ? buf : oscap_alloc(len + 1);
+		SEXP_string_cstr_r(val, str, len + 1);
+	}
+
+	if (raw)
+		ores = probe_entobj_match_raw(entobj, val, str);
+	else
+		ores = probe_entobj_match_val(entobj, val, str);
+
+	if (str != buf)
+		oscap_free(str);
+	return ores;
+}
+
+oval_result_t probe_entobj_match(probe_entobj_t *entobj, SEXP_t *val)
+{
+	return probe_entobj_match_sexp(entobj, val, false);
+}
+
+oval_result_t probe_entobj_match_str(probe_entobj_t *entobj, const char *str)
+{
+	SEXP_t *val;
+	oval_result_t ores;
+
+	if (entobj->prepared && entobj->textual)
+		return probe_entobj_match_val(entobj, NULL, str);
+
+	val = SEXP_string_new(str, strlen(str));
+	ores = probe_entobj_match(entobj, val);
+	SEXP_free(val);
+
+	return ores;
+}
+
+
+struct probe_entste {
+	SEXP_t         *ent;    /**< the state entity */
+	probe_entobj_t *entobj; /**< the values prepared, NULL for records */
+};
+
+probe_entste_t *probe_entste_new(SEXP_t *ent_ste)
+{
+	probe_entste_t *entste;
+
+	entste = oscap_talloc(probe_entste_t);
+	entste->ent = SEXP_ref(ent_ste);
+
+	/* records require special handling */
+	if (probe_ent_getdatatype(ent_ste) == OVAL_DATATYPE_RECORD)
+		entste->entobj = NULL;
+	else
+		entste->entobj = probe_entobj_new(ent_ste);
+
+	return entste;
+}
+
+oval_result_t probe_entste_match(probe_entste_t *entste, SEXP_t *ent_itm)
+{
+	oval_result_t ores;
+	SEXP_t *val;
+
+	if (entste->entobj == NULL)
+		return probe_entste_cmp(entste->ent, ent_itm);
+
+	switch (probe_ent_getstatus(ent_itm)) {
+	case SYSCHAR_STATUS_DOES_NOT_EXIST:
+		return OVAL_RESULT_FALSE;
+	case SYSCHAR_STATUS_ERROR:
+	case SYSCHAR_STATUS_NOT_COLLECTED:
+		return OVAL_RESULT_ERROR;
+	default:
+		break;
+	}
+
+	if (entste->entobj->datatype != probe_ent_getdatatype(ent_itm)
+	    || entste->entobj->count == 0)
+		return OVAL_RESULT_ERROR;
+
+	if ((val = probe_ent_getval(ent_itm)) == NULL)
+		return OVAL_RESULT_ERROR;
+
+	ores = probe_entobj_match_sexp(entste->entobj, val, true);
+	SEXP_free(val);
+
+	if (ores == OVAL_RESULT_NOT_EVALUATED)
+		return OVAL_RESULT_ERROR;
+	return ores;
+}
+
+void probe_entste_free(probe_entste_t *entste)
+{
+	if (entste == NULL)
+		return;
+
+	probe_entobj_free(entste->entobj);
+	SEXP_free(entste->ent);
+	oscap_free(entste);
+}
+
 /// @}
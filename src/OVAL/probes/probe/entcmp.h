@@ -35,6 +35,30 @@
 #include "oval_definitions.h"
 #include "oval_results.h"
 
+/**
+ * Counts of the results of comparisons, the results vector without the vector.
+ */
+struct _oresults {
+	int true_cnt, false_cnt, unknown_cnt, error_cnt, noteval_cnt, notappl_cnt;
+};
+
+/**
+ * Count a result.
+ * @param ores the counts
+ * @param res the result
+ */
+void probe_ent_results_add(struct _oresults *ores, oval_result_t res);
+
+/**
+ * Compute the overall result from the counts, see probe_ent_result_bychk.
+ */
+oval_result_t probe_ent_results_bychk(const struct _oresults *ores, oval_check_t check);
+
+/**
+ * Compute the overall result from the counts, see probe_ent_result_byopr.
+ */
+oval_result_t probe_ent_results_byopr(const struct _oresults *ores, oval_operator_t operator);
+
 /**
  * Compute the overall result.
  * Compute the overall result from a results vector and a check enumeration parameter.
@@ -60,6 +84,38 @@ oval_result_t probe_ent_result_byopr(SEXP_t * res_lst, oval_operator_t operator)
  */
 oval_result_t probe_entobj_cmp(SEXP_t * ent_obj, SEXP_t * val);
 
+/**
+ * Object entity prepared for the comparison with many values.
+ * The operation, var_check and datatype are read once, the values are
+ * converted to their type and the patterns compiled. The values of a
+ * string var_ref with the equals operation are looked up in a sorted
+ * array instead of being compared one by one.
+ */
+typedef struct probe_entobj probe_entobj_t;
+
+/**
+ * Prepare an object entity.
+ * @param ent_obj object entity
+ */
+probe_entobj_t *probe_entobj_new(SEXP_t *ent_obj);
+
+/**
+ * Compare the prepared object entity with a value, see probe_entobj_cmp.
+ * @param entobj prepared object entity
+ * @param val raw value
+ */
+oval_result_t probe_entobj_match(probe_entobj_t *entobj, SEXP_t *val);
+
+/**
+ * Compare the prepared object entity with a string value, without
+ * creating an S-expression for it.
+ * @param entobj prepared object entity
+ * @param str the value
+ */
+oval_result_t probe_entobj_match_str(probe_entobj_t *entobj, const char *str);
+
+void probe_entobj_free(probe_entobj_t *entobj);
+
 /**
  * Compare state entity's content with a item entity's value.
  * The result depends on the operation attribute,
@@ -69,6 +125,27 @@ oval_result_t probe_entobj_cmp(SEXP_t * ent_obj, SEXP_t * val);
  */
 oval_result_t probe_entste_cmp(SEXP_t * ent_ste, SEXP_t * ent_itm);
 
+/**
+ * State entity prepared for the comparison with many item entities, the
+ * values of the state are prepared as those of an object entity.
+ */
+typedef struct probe_entste probe_entste_t;
+
+/**
+ * Prepare a state entity.
+ * @param ent_ste state entity
+ */
+probe_entste_t *probe_entste_new(SEXP_t *ent_ste);
+
+/**
+ * Compare the prepared state entity with an item entity, see probe_entste_cmp.
+ * @param entste prepared state entity
+ * @param ent_itm item entity
+ */
+oval_result_t probe_entste_match(probe_entste_t *entste, SEXP_t *ent_itm);
+
+void probe_entste_free(probe_entste_t *entste);
+
 /**
  * Compare two binary values.
  * The operation to use is specified by the operation enumeration value.
@@ -0,0 +1,346 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <sexp.h>
+#include "probe-api.h"
+#include "common/alloc.h"
+#include "common/list.h"
+#include "entcmp.h"
+#include "filter.h"
+
+struct probe_filter_ent {
+	probe_entste_t *entste; /**< state entity */
+	char           *name;
+	oval_check_t    check;  /**< entity_check */
+};
+
+/*
+ * A compiled state, shared by the filters of all the objects referencing
+ * the state and freed with the last reference.
+ */
+struct probe_filter_ste {
+	oval_operator_t          operator;
+	struct probe_filter_ent *ents;
+	size_t                   count;
+	int                      refs;
+};
+
+struct probe_filter_act {
+	oval_filter_action_t     action;
+	struct probe_filter_ste *fste;
+};
+
+struct probe_filter_cmp {
+	const struct probe_filter_ent *fent; /**< NULL in free slots */
+	SEXP_t                        *ient; /**< item entity, the reference keeps its address from being reused */
+	oval_result_t                  result;
+};
+
+struct probe_filter {
+	struct probe_filter_act *acts;
+	size_t                   count;
+	bool                     memoize;
+	struct probe_filter_cmp *cmps; /**< open addressing table of compared entities */
+	size_t                   cmps_size;
+	size_t                   cmps_count;
+};
+
+/* compiled states by their ids */
+static struct oscap_htable *__filter_stes = NULL;
+static pthread_mutex_t __filter_stes_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct probe_filter_ste *probe_filter_ste_new(const SEXP_t *ste)
+{
+	struct probe_filter_ste *fste;
+	SEXP_t *felm, *r0;
+
+	fste = oscap_talloc(struct probe_filter_ste);
+	fste->refs = 1;
+
+	r0 = probe_ent_getattrval(ste, "operator");
+	fste->operator = r0 == NULL ? OVAL_OPERATOR_AND : SEXP_number_geti_32(r0);
+	SEXP_free(r0);
+
+	fste->ents = oscap_calloc(SEXP_list_length(ste), sizeof(struct probe_filter_ent));
+	fste->count = 0;
+
+	SEXP_sublist_foreach(felm, ste, 2, SEXP_LIST_END) {
+		struct probe_filter_ent *fent = &fste->ents[fste->count++];
+
+		fent->entste = probe_entste_new(felm);
+		fent->name = probe_ent_getname(felm);
+
+		r0 = probe_ent_getattrval(felm, "entity_check");
+		fent->check = r0 == NULL ? OVAL_CHECK_ALL : SEXP_number_geti_32(r0);
+		SEXP_free(r0);
+	}
+
+	return (fste);
+}
+
+static void probe_filter_ste_free(void *ptr)
+{
+	struct probe_filter_ste *fste = ptr;
+	size_t i;
+
+	if (__atomic_sub_fetch(&fste->refs, 1, __ATOMIC_ACQ_REL) > 0)
+		return;
+
+	for (i = 0; i < fste->count; ++i) {
+		probe_entste_free(fste->ents[i].entste);
+		oscap_free(fste->ents[i].name);
+	}
+	oscap_free(fste->ents);
+	oscap_free(fste);
+}
+
+/* the compiled state of the id, compiled by the first object referencing it */
+static struct probe_filter_ste *probe_filter_ste_get(const SEXP_t *ste)
+{
+	struct probe_filter_ste *fste = NULL, *cached;
+	SEXP_t *r0;
+	char *id;
+
+	r0 = probe_ent_getattrval(ste, "id");
+	id = r0 == NULL ? NULL : SEXP_string_cstr(r0);
+	SEXP_free(r0);
+
+	if (id == NULL)
+		return probe_filter_ste_new(ste);
+
+	pthread_mutex_lock(&__filter_stes_lock);
+	if (__filter_stes != NULL && (fste = oscap_htable_get(__filter_stes, id)) != NULL)
+		__atomic_add_fetch(&fste->refs, 1, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&__filter_stes_lock);
+
+	if (fste != NULL)
+		goto out;
+
+	/* compiled without the lock, the state of a concurrent worker wins */
+	fste = probe_filter_ste_new(ste);
+
+	pthread_mutex_lock(&__filter_stes_lock);
+	if (__filter_stes == NULL)
+		__filter_stes = oscap_htable_new();
+
+	if ((cached = oscap_htable_get(__filter_stes, id)) != NULL) {
+		probe_filter_ste_free(fste);
+		fste = cached;
+	} else {
+		oscap_htable_add(__filter_stes, id, fste);
+	}
+	__atomic_add_fetch(&fste->refs, 1, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&__filter_stes_lock);
+out:
+	oscap_free(id);
+
+	return (fste);
+}
+
+void probe_filter_cache_free(void)
+{
+	pthread_mutex_lock(&__filter_stes_lock);
+	oscap_htable_free(__filter_stes, &probe_filter_ste_free);
+	__filter_stes = NULL;
+	pthread_mutex_unlock(&__filter_stes_lock);
+}
+
+probe_filter_t *probe_filter_new(const SEXP_t *filters, bool memoize)
+{
+	probe_filter_t *filter;
+	SEXP_t *f, *ste, *r0;
+	size_t count;
+
+	count = SEXP_list_length(filters);
+	if (count == 0)
+		return (NULL);
+
+	filter = oscap_talloc(probe_filter_t);
+	filter->acts = oscap_calloc(count, sizeof(struct probe_filter_act));
+	filter->count = 0;
+	filter->memoize = memoize;
+	filter->cmps = NULL;
+	filter->cmps_size = 0;
+	filter->cmps_count = 0;
+
+	SEXP_list_foreach(f, filters) {
+		struct probe_filter_act *fact = &filter->acts[filter->count++];
+
+		r0 = SEXP_list_first(f);
+		fact->action = SEXP_number_getu(r0);
+		SEXP_free(r0);
+
+		ste = SEXP_list_nth(f, 2);
+		fact->fste = probe_filter_ste_get(ste);
+		SEXP_free(ste);
+	}
+
+	return (filter);
+}
+
+void probe_filter_free(probe_filter_t *filter)
+{
+	size_t i;
+
+	if (filter == NULL)
+		return;
+
+	for (i = 0; i < filter->count; ++i)
+		probe_filter_ste_free(filter->acts[i].fste);
+	oscap_free(filter->acts);
+
+	for (i = 0; i < filter->cmps_size; ++i) {
+		if (filter->cmps[i].fent != NULL)
+			SEXP_free(filter->cmps[i].ient);
+	}
+	oscap_free(filter->cmps);
+	oscap_free(filter);
+}
+
+static size_t probe_filter_cmp_slot(struct probe_filter_cmp *cmps, size_t size,
+                                    const struct probe_filter_ent *fent, const SEXP_t *ient)
+{
+	size_t i;
+
+	i = (SEXP_refhash(ient) ^ ((uintptr_t)fent * 31)) & (size - 1);
+
+	while (cmps[i].fent != NULL && (cmps[i].fent != fent || !SEXP_eq(cmps[i].ient, ient)))
+		i = (i + 1) & (size - 1);
+
+	return (i);
+}
+
+static void probe_filter_cmp_grow(probe_filter_t *filter)
+{
+	struct probe_filter_cmp *cmps;
+	size_t i, size;
+
+	size = filter->cmps_size > 0 ? filter->cmps_size * 2 : 256;
+	cmps = oscap_calloc(size, sizeof(struct probe_filter_cmp));
+
+	for (i = 0; i < filter->cmps_size; ++i) {
+		if (filter->cmps[i].fent != NULL)
+			cmps[probe_filter_cmp_slot(cmps, size, filter->cmps[i].fent, filter->cmps[i].ient)] = filter->cmps[i];
+	}
+
+	oscap_free(filter->cmps);
+	filter->cmps = cmps;
+	filter->cmps_size = size;
+}
+
+static oval_result_t probe_filter_entcmp(probe_filter_t *filter, const struct probe_filter_ent *fent, SEXP_t *ient)
+{
+	struct probe_filter_cmp *cmp;
+
+	if (!filter->memoize)
+		return probe_entste_match(fent->entste, ient);
+
+	if (filter->cmps_count >= filter->cmps_size / 2)
+		probe_filter_cmp_grow(filter);
+
+	cmp = &filter->cmps[probe_filter_cmp_slot(filter->cmps, filter->cmps_size, fent, ient)];
+
+	if (cmp->fent == NULL) {
+		cmp->fent = fent;
+		cmp->ient = SEXP_ref(ient);
+		cmp->result = probe_entste_match(fent->entste, ient);
+		++filter->cmps_count;
+	}
+
+	return (cmp->result);
+}
+
+static oval_result_t probe_filter_ste_eval(probe_filter_t *filter, const struct probe_filter_ste *fste, const SEXP_t *item)
+{
+	SEXP_t *ielm, *iname, *r0;
+	struct _oresults elm_res[fste->count > 0 ? fste->count : 1], ste_res;
+	bool matched[fste->count > 0 ? fste->count : 1];
+	oval_result_t ores;
+	size_t j;
+
+	if (fste->count == 0)
+		return (OVAL_RESULT_UNKNOWN);
+
+	memset(elm_res, 0, sizeof elm_res);
+	memset(matched, 0, sizeof matched);
+
+	/* one pass over the item entities for all the entities of the state */
+	SEXP_sublist_foreach(ielm, item, 2, SEXP_LIST_END) {
+		iname = SEXP_list_first(ielm);
+
+		if (SEXP_listp(iname)) {
+			r0 = SEXP_list_first(iname);
+			SEXP_free(iname);
+			iname = r0;
+		}
+
+		if (SEXP_stringp(iname)) {
+			for (j = 0; j < fste->count; ++j) {
+				if (SEXP_strcmp(iname, fste->ents[j].name) != 0)
+					continue;
+
+				ores = probe_filter_entcmp(filter, &fste->ents[j], ielm);
+				probe_ent_results_add(&elm_res[j], ores);
+				matched[j] = true;
+			}
+		}
+
+		SEXP_free(iname);
+	}
+
+	memset(&ste_res, 0, sizeof ste_res);
+
+	for (j = 0; j < fste->count; ++j) {
+		if (matched[j])
+			ores = probe_ent_results_bychk(&elm_res[j], fste->ents[j].check);
+		else
+			ores = OVAL_RESULT_FALSE;
+
+		probe_ent_results_add(&ste_res, ores);
+	}
+
+	return probe_ent_results_byopr(&ste_res, fste->operator);
+}
+
+bool probe_filter_item(probe_filter_t *filter, const SEXP_t *item)
+{
+	oval_result_t ores;
+	size_t i;
+
+	if (filter == NULL)
+		return (false);
+
+	for (i = 0; i < filter->count; ++i) {
+		ores = probe_filter_ste_eval(filter, filter->acts[i].fste, item);
+
+		if ((ores == OVAL_RESULT_TRUE && filter->acts[i].action == OVAL_FILTER_ACTION_EXCLUDE)
+		    || (ores == OVAL_RESULT_FALSE && filter->acts[i].action == OVAL_FILTER_ACTION_INCLUDE))
+			return (true);
+	}
+
+	return (false);
+}
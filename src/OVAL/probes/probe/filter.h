@@ -0,0 +1,56 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef PROBE_FILTER_H
+#define PROBE_FILTER_H
+
+#include <stdbool.h>
+#include <sexp.h>
+
+/*
+ * Object filters prepared for the evaluation of many items: the actions,
+ * operators, entity names and checks of the filter states are read once.
+ * If memoizing, the result of each comparison of a state entity with an
+ * item entity is kept, so the items shared by the subsets of a set (or
+ * by other items) aren't compared twice. The states are compiled once
+ * per id and shared by the filters of all the objects.
+ */
+typedef struct probe_filter probe_filter_t;
+
+/**
+ * Prepare filters for the evaluation.
+ * @param filters list of (action state) pairs
+ * @param memoize whether to keep the results of the entity comparisons
+ * @return the prepared filters or NULL if the list is empty
+ */
+probe_filter_t *probe_filter_new(const SEXP_t *filters, bool memoize);
+
+/**
+ * Check whether the item is filtered out, see probe_item_filtered.
+ */
+bool probe_filter_item(probe_filter_t *filter, const SEXP_t *item);
+
+void probe_filter_free(probe_filter_t *filter);
+
+/**
+ * Drop the compiled states, the filters keep those they use.
+ */
+void probe_filter_cache_free(void);
+
+#endif /* PROBE_FILTER_H */
@@ -30,6 +30,8 @@
 #include <string.h>
 #include <inttypes.h>
 #include <stdlib.h>
+#include <sched.h>
+#include <time.h>
 
 #include "../SEAP/generic/rbt/rbt.h"
 #include "probe-api.h"
@@ -85,11 +87,133 @@ static void probe_icache_item_setID(SEXP_t *item, SEXP_ID_t item_ID)
         return;
 }
 
-static int icache_lookup(rbt_t *tree, int64_t item_id, probe_iqpair_t *pair) {
+#if defined(PROBE_ICACHE_RBT)
+static int icache_index_init(probe_icache_t *cache)
+{
+        cache->tree = rbt_i64_new();
+        return (cache->tree != NULL ? 0 : -1);
+}
+
+static probe_citem_t *icache_index_get(probe_icache_t *cache, SEXP_ID_t item_id)
+{
+        probe_citem_t *cached = NULL;
+
+        if (rbt_i64_get(cache->tree, (int64_t)item_id, (void **)&cached) != 0)
+                return (NULL);
+
+        return (cached);
+}
+
+static int icache_index_add(probe_icache_t *cache, SEXP_ID_t item_id, probe_citem_t *cached)
+{
+        return rbt_i64_add(cache->tree, (int64_t)item_id, (void **)cached, NULL);
+}
+
+static void probe_icache_free_citem(probe_citem_t *ci);
+
+static void probe_icache_free_node(struct rbt_i64_node *n)
+{
+        probe_icache_free_citem((probe_citem_t *)n->data);
+}
+
+static void icache_index_free(probe_icache_t *cache)
+{
+        if (cache->tree != NULL)
+                rbt_i64_free_cb(cache->tree, &probe_icache_free_node);
+}
+#else
+/*
+ * Open addressing (linear probing) hash table. The item IDs are already
+ * well distributed hashes, so the low bits of the ID are used directly
+ * as the initial slot index.
+ */
+static int icache_index_init(probe_icache_t *cache)
+{
+        cache->table_size = PROBE_ICACHE_TABLE_INITSIZE;
+        cache->table_used = 0;
+        cache->table = calloc(cache->table_size, sizeof(probe_icache_slot_t));
+
+        return (cache->table != NULL ? 0 : -1);
+}
+
+static probe_citem_t *icache_index_get(probe_icache_t *cache, SEXP_ID_t item_id)
+{
+        size_t mask = cache->table_size - 1;
+        size_t i = (size_t)(item_id ^ (item_id >> 32)) & mask;
+
+        while (cache->table[i].citem != NULL) {
+                if (cache->table[i].id == item_id)
+                        return (cache->table[i].citem);
+                i = (i + 1) & mask;
+        }
+
+        return (NULL);
+}
+
+static void icache_index_insert(probe_icache_slot_t *table, size_t size,
+                                SEXP_ID_t item_id, probe_citem_t *cached)
+{
+        size_t mask = size - 1;
+        size_t i = (size_t)(item_id ^ (item_id >> 32)) & mask;
+
+        while (table[i].citem != NULL)
+                i = (i + 1) & mask;
+
+        table[i].id    = item_id;
+        table[i].citem = cached;
+}
+
+static int icache_index_add(probe_icache_t *cache, SEXP_ID_t item_id, probe_citem_t *cached)
+{
+        /* keep the load factor below 3/4 */
+        if ((cache->table_used + 1) * 4 > cache->table_size * 3) {
+                probe_icache_slot_t *table;
+                size_t i, size = cache->table_size * 2;
+
+                table = calloc(size, sizeof(probe_icache_slot_t));
+
+                if (table == NULL)
+                        return (-1);
+
+                for (i = 0; i < cache->table_size; ++i) {
+                        if (cache->table[i].citem != NULL)
+                                icache_index_insert(table, size, cache->table[i].id, cache->table[i].citem);
+                }
+
+                free(cache->table);
+                cache->table = table;
+                cache->table_size = size;
+        }
+
+        icache_index_insert(cache->table, cache->table_size, item_id, cached);
+        ++cache->table_used;
+
+        return (0);
+}
+
+static void probe_icache_free_citem(probe_citem_t *ci);
+
+static void icache_index_free(probe_icache_t *cache)
+{
+        size_t i;
+
+        if (cache->table == NULL)
+                return;
+
+        for (i = 0; i < cache->table_size; ++i) {
+                if (cache->table[i].citem != NULL)
+                        probe_icache_free_citem(cache->table[i].citem);
+        }
+
+        free(cache->table);
+}
+#endif /* PROBE_ICACHE_RBT */
 
-	probe_citem_t *cached = NULL;
+static int icache_lookup(probe_icache_t *cache, SEXP_ID_t item_id, probe_iqpair_t *pair) {
 
-	if (rbt_i64_get(tree, item_id, (void**)&cached) != 0) {
+	probe_citem_t *cached;
+
+	if ((cached = icache_index_get(cache, item_id)) == NULL) {
 		return -1;
 	}
 
@@ -121,6 +245,8 @@ static int icache_lookup(rbt_t *tree, int64_t item_id, probe_iqpair_t *pair) {
 		* Cache MISS
 		*/
 		dI("cache MISS");
+		++cache->stats.misses;
+		++cache->stats.collisions;
 
 		cached->item = oscap_realloc(cached->item, sizeof(SEXP_t *) * ++cached->count);
 		cached->item[cached->count - 1] = pair->p.item;
@@ -132,24 +258,28 @@ static int icache_lookup(rbt_t *tree, int64_t item_id, probe_iqpair_t *pair) {
 		* Cache HIT
 		*/
 		dI("cache HIT #2 -> real HIT");
+		++cache->stats.hits;
+
 		SEXP_free(pair->p.item);
 		pair->p.item = cached->item[i];
 	}
 	return 0;
 }
 
-static void icache_add_to_tree(rbt_t *tree, int64_t item_id, probe_iqpair_t *pair) {
+static void icache_add_to_index(probe_icache_t *cache, SEXP_ID_t item_id, probe_iqpair_t *pair) {
 
 	probe_citem_t *cached = oscap_talloc(probe_citem_t);
 	cached->item = oscap_talloc(SEXP_t *);
 	cached->item[0] = pair->p.item;
 	cached->count = 1;
 
+	++cache->stats.misses;
+
 	/* Assign an unique item ID */
 	probe_icache_item_setID(pair->p.item, item_id);
 
-	if (rbt_i64_add(tree, (int64_t)item_id, (void **)cached, NULL) != 0) {
-		dE("Can't add item (k=%"PRIi64" to the cache (%p)", item_id, tree);
+	if (icache_index_add(cache, item_id, cached) != 0) {
+		dE("Can't add item (k=%"PRIu64" to the cache (%p)", item_id, cache);
 
 		oscap_free(cached->item);
 		oscap_free(cached);
@@ -159,25 +289,182 @@ static void icache_add_to_tree(rbt_t *tree, int64_t item_id, probe_iqpair_t *pai
 	}
 }
 
-static void *probe_icache_worker(void *arg)
+/*
+ * Lock-free MPSC queue (D. Vyukov's intrusive node based queue). Producers
+ * only exchange the head pointer and link the previous head to the new node,
+ * the worker thread is the only consumer and owns the tail pointer.
+ */
+static void probe_iqueue_push(probe_icache_t *cache, probe_iqnode_t *node)
 {
-        probe_icache_t *cache = (probe_icache_t *)(arg);
-        probe_iqpair_t *pair, pair_mem;
-        SEXP_ID_t       item_ID;
+        probe_iqnode_t *prev;
 
-        assume_d(cache != NULL, NULL);
+        node->next = NULL;
+#if defined(HAVE_ATOMIC_BUILTINS)
+        prev = __sync_lock_test_and_set(&cache->queue_head, node);
+        __sync_synchronize();
+        prev->next = node;
+#else
+        pthread_mutex_lock(&cache->queue_push_mutex);
+        prev = cache->queue_head;
+        cache->queue_head = node;
+        prev->next = node;
+        pthread_mutex_unlock(&cache->queue_push_mutex);
+#endif
+}
 
-#if defined(HAVE_PTHREAD_SETNAME_NP)
-	pthread_setname_np(pthread_self(), "icache_worker");
+static bool probe_iqueue_empty(probe_icache_t *cache)
+{
+        probe_iqnode_t *tail = cache->queue_tail;
+
+#if defined(HAVE_ATOMIC_BUILTINS)
+        __sync_synchronize();
 #endif
+        return (tail == &cache->queue_stub &&
+                tail->next == NULL && cache->queue_head == tail);
+}
+
+/*
+ * Returns the next node or NULL if the queue is empty or a producer is
+ * in the middle of a push (the node will be available shortly).
+ */
+static probe_iqnode_t *probe_iqueue_pop(probe_icache_t *cache)
+{
+        probe_iqnode_t *tail = cache->queue_tail;
+        probe_iqnode_t *next = tail->next;
+
+        if (tail == &cache->queue_stub) {
+                if (next == NULL)
+                        return (NULL);
+
+                cache->queue_tail = next;
+                tail = next;
+                next = next->next;
+        }
+
+        if (next != NULL) {
+                cache->queue_tail = next;
+                return (tail);
+        }
+
+        if (tail != cache->queue_head)
+                return (NULL);
+
+        probe_iqueue_push(cache, &cache->queue_stub);
+
+        if ((next = tail->next) != NULL) {
+                cache->queue_tail = next;
+                return (tail);
+        }
+
+        return (NULL);
+}
+
+/*
+ * Wake up the worker if it's waiting for new items. The full barrier in
+ * probe_iqueue_push() guarantees that either the worker sees the new node
+ * or we see the `queue_sleep' flag set.
+ */
+static int probe_iqueue_notify(probe_icache_t *cache)
+{
+        if (cache->queue_sleep == 0)
+                return (0);
 
         if (pthread_mutex_lock(&cache->queue_mutex) != 0) {
                 dE("An error ocured while locking the queue mutex: %u, %s",
                    errno, strerror(errno));
-                return (NULL);
+                return (-1);
         }
 
-	pair = &pair_mem;
+        cache->queue_sleep = 0;
+
+        if (pthread_cond_signal(&cache->queue_notempty) != 0) {
+                dE("An error ocured while signaling the `notempty' condition: %u, %s",
+                   errno, strerror(errno));
+                pthread_mutex_unlock(&cache->queue_mutex);
+                return (-1);
+        }
+
+        if (pthread_mutex_unlock(&cache->queue_mutex) != 0) {
+                dE("An error ocured while unlocking the queue mutex: %u, %s",
+                   errno, strerror(errno));
+                abort();
+        }
+
+        return (0);
+}
+
+static void probe_icache_sync_done(probe_icache_t *cache, probe_icache_sync_t *sync)
+{
+        if (pthread_mutex_lock(&cache->queue_mutex) != 0) {
+                dE("An error ocured while locking the queue mutex: %u, %s",
+                   errno, strerror(errno));
+                abort();
+        }
+
+        sync->done = true;
+
+        if (pthread_cond_signal(&sync->cond) != 0) {
+                dE("An error ocured while signaling NOP condition: %u, %s",
+                   errno, strerror(errno));
+                abort();
+        }
+
+        if (pthread_mutex_unlock(&cache->queue_mutex) != 0) {
+                dE("An error ocured while unlocking the queue mutex: %u, %s",
+                   errno, strerror(errno));
+                abort();
+        }
+}
+
+static void probe_icache_handle(probe_icache_t *cache, probe_iqpair_t *pair)
+{
+        SEXP_ID_t item_ID;
+
+        if (pair->cobj == NULL) {
+                /*
+                 * Handle NOP case (synchronization)
+                 */
+                assume_d(pair->p.sync != NULL, /* void */);
+
+                dD("Handling NOP");
+                probe_icache_sync_done(cache, pair->p.sync);
+                return;
+        }
+
+        dD("Handling cache request");
+
+        /*
+         * Compute item ID
+         */
+        dD("pair address: %"PRIu64, (uint64_t) pair);
+        dD("item address: %"PRIu64, (uint64_t) pair->p.item);
+        item_ID = SEXP_ID_v(pair->p.item);
+        dD("item ID=%"PRIu64"", item_ID);
+
+        if (icache_lookup(cache, item_ID, pair) != 0) {
+                /*
+                 * Cache MISS
+                 */
+                dI("cache MISS");
+                icache_add_to_index(cache, item_ID, pair);
+        }
+
+        if (probe_cobj_add_item(pair->cobj, pair->p.item) != 0) {
+                dW("An error ocured while adding the item to the collected object");
+        }
+}
+
+static void *probe_icache_worker(void *arg)
+{
+        probe_icache_t *cache = (probe_icache_t *)(arg);
+        probe_iqnode_t *node;
+        size_t          batch;
+
+        assume_d(cache != NULL, NULL);
+
+#if defined(HAVE_PTHREAD_SETNAME_NP)
+	pthread_setname_np(pthread_self(), "icache_worker");
+#endif
         dD("icache worker ready");
 
         switch (errno = pthread_barrier_wait(&OSCAP_GSYM(th_barrier)))
@@ -188,93 +475,52 @@ static void *probe_icache_worker(void *arg)
         default:
 	        dE("pthread_barrier_wait: %d, %s.",
 	           errno, strerror(errno));
-	        pthread_mutex_unlock(&cache->queue_mutex);
 	        return (NULL);
         }
 
-        while(pthread_cond_wait(&cache->queue_notempty, &cache->queue_mutex) == 0) {
-                assume_d(cache->queue_cnt > 0, NULL);
-        do {
-                dI("Extracting item from the cache queue: cnt=%"PRIu16", beg=%"PRIu16"", cache->queue_cnt, cache->queue_beg);
+        for (;;) {
                 /*
-                 * Extract an item from the queue and update queue beg, end & cnt
+                 * Handle all the queued items in one batch
                  */
-                pair_mem = cache->queue[cache->queue_beg];
-#ifndef NDEBUG
-		memset(cache->queue + cache->queue_beg, 0, sizeof(probe_iqpair_t));
-#endif
-                --cache->queue_cnt;
-		++cache->queue_beg;
-
-		if (cache->queue_beg == cache->queue_max)
-			cache->queue_beg = 0;
-
-		assume_d(cache->queue_cnt == 0 ?
-			 cache->queue_end == cache->queue_beg :
-			 cache->queue_end != cache->queue_beg, NULL);
-
+                for (batch = 0; (node = probe_iqueue_pop(cache)) != NULL; ++batch) {
+                        probe_icache_handle(cache, &node->pair);
+                        oscap_free(node);
+                }
 
-                dD("Signaling `notfull'");
+                if (batch > 0)
+                        dI("Handled a batch of %zu queued item(s)", batch);
 
-                if (pthread_cond_signal(&cache->queue_notfull) != 0) {
-                        dE("An error ocured while signaling the `notfull' condition: %u, %s",
-                           errno, strerror(errno));
-                        abort();
+                if (!probe_iqueue_empty(cache)) {
+                        /* a producer is in the middle of a push */
+                        sched_yield();
+                        continue;
                 }
-                /*
-                 * Release the mutex
-                 */
-                if (pthread_mutex_unlock(&cache->queue_mutex) != 0) {
-                        dE("An error ocured while unlocking the queue mutex: %u, %s",
+
+                if (pthread_mutex_lock(&cache->queue_mutex) != 0) {
+                        dE("An error ocured while locking the queue mutex: %u, %s",
                            errno, strerror(errno));
                         abort();
                 }
 
-                if (pair->cobj == NULL) {
-                        /*
-                         * Handle NOP case (synchronization)
-                         */
-                        assume_d(pair->p.cond != NULL, NULL);
-
-                        dD("Handling NOP");
-
-                        if (pthread_cond_signal(pair->p.cond) != 0) {
-                                dE("An error ocured while signaling NOP condition: %u, %s",
+                cache->queue_sleep = 1;
+#if defined(HAVE_ATOMIC_BUILTINS)
+                __sync_synchronize();
+#endif
+                while (cache->queue_sleep != 0 && probe_iqueue_empty(cache)) {
+                        if (pthread_cond_wait(&cache->queue_notempty, &cache->queue_mutex) != 0) {
+                                dE("An error ocured while waiting for the `notempty' queue condition: %u, %s",
                                    errno, strerror(errno));
                                 abort();
                         }
-                } else {
-
-                        dD("Handling cache request");
-
-                        /*
-                         * Compute item ID
-                         */
-			dD("pair address: %"PRIu64, (uint64_t) pair);
-			dD("item address: %"PRIu64, (uint64_t) pair->p.item);
-                        item_ID = SEXP_ID_v(pair->p.item);
-                        dD("item ID=%"PRIu64"", item_ID);
-
-                        if (icache_lookup(cache->tree, item_ID, pair) != 0) {
-                                /*
-                                 * Cache MISS
-                                 */
-                                dI("cache MISS");
-                                icache_add_to_tree(cache->tree, item_ID, pair);
-                        }
-
-                        if (probe_cobj_add_item(pair->cobj, pair->p.item) != 0) {
-                            dW("An error ocured while adding the item to the collected object");
-                        }
                 }
 
-                if (pthread_mutex_lock(&cache->queue_mutex) != 0) {
-                        dE("An error ocured while re-locking the queue mutex: %u, %s",
+                cache->queue_sleep = 0;
+
+                if (pthread_mutex_unlock(&cache->queue_mutex) != 0) {
+                        dE("An error ocured while unlocking the queue mutex: %u, %s",
                            errno, strerror(errno));
                         abort();
                 }
-
-                } while (cache->queue_cnt > 0);
         }
 
         return (NULL);
@@ -285,26 +531,32 @@ probe_icache_t *probe_icache_new(void)
         probe_icache_t *cache;
 
         cache = oscap_talloc(probe_icache_t);
-        cache->tree = rbt_i64_new();
+        memset(&cache->stats, 0, sizeof cache->stats);
+
+        if (icache_index_init(cache) != 0) {
+                dE("Can't initialize the icache index");
+                oscap_free(cache);
+                return (NULL);
+        }
 
         if (pthread_mutex_init(&cache->queue_mutex, NULL) != 0) {
                 dE("Can't initialize icache mutex: %u, %s", errno, strerror(errno));
                 goto fail;
         }
 
-        cache->queue_beg = 0;
-        cache->queue_end = 0;
-        cache->queue_cnt = 0;
-        cache->queue_max = PROBE_IQUEUE_CAPACITY;
-
-        if (pthread_cond_init(&cache->queue_notempty, NULL) != 0) {
-                dE("Can't initialize icache queue condition variable (notempty): %u, %s",
-                   errno, strerror(errno));
+#if !defined(HAVE_ATOMIC_BUILTINS)
+        if (pthread_mutex_init(&cache->queue_push_mutex, NULL) != 0) {
+                dE("Can't initialize icache push mutex: %u, %s", errno, strerror(errno));
                 goto fail;
         }
+#endif
+        cache->queue_stub.next = NULL;
+        cache->queue_head  = &cache->queue_stub;
+        cache->queue_tail  = &cache->queue_stub;
+        cache->queue_sleep = 0;
 
-        if (pthread_cond_init(&cache->queue_notfull, NULL) != 0) {
-                dE("Can't initialize icache queue condition variable (notfull): %u, %s",
+        if (pthread_cond_init(&cache->queue_notempty, NULL) != 0) {
+                dE("Can't initialize icache queue condition variable (notempty): %u, %s",
                    errno, strerror(errno));
                 goto fail;
         }
@@ -318,130 +570,76 @@ probe_icache_t *probe_icache_new(void)
 
         return (cache);
 fail:
-        if (cache->tree != NULL)
-                rbt_i64_free(cache->tree);
+        icache_index_free(cache);
 
         pthread_mutex_destroy(&cache->queue_mutex);
+#if !defined(HAVE_ATOMIC_BUILTINS)
+        pthread_mutex_destroy(&cache->queue_push_mutex);
+#endif
         pthread_cond_destroy(&cache->queue_notempty);
         oscap_free(cache);
 
         return (NULL);
 }
 
-static int __probe_icache_add_nolock(probe_icache_t *cache, SEXP_t *cobj, SEXP_t *item, pthread_cond_t *cond)
-{
-        assume_d((cond == NULL) ^ (item == NULL), -1);
-retry:
-        if (cache->queue_cnt < cache->queue_max) {
-                cache->queue[cache->queue_end].cobj = cobj;
-
-                if (item != NULL) {
-			assume_d(cobj != NULL, -1);
-                        cache->queue[cache->queue_end].p.item = item;
-                } else {
-			assume_d(item == NULL && cobj == NULL, -1);
-                        cache->queue[cache->queue_end].p.cond = cond;
-		}
-
-                ++cache->queue_cnt;
-		++cache->queue_end;
-
-                if (cache->queue_end == cache->queue_max)
-                        cache->queue_end = 0;
-        } else {
-                /*
-                 * The queue is full, we have to wait
-                 */
-                if (pthread_cond_wait(&cache->queue_notfull, &cache->queue_mutex) == 0)
-                        goto retry;
-                else {
-                        dE("An error ocured while waiting for the `notfull' queue condition: %u, %s",
-                           errno, strerror(errno));
-                        return (-1);
-                }
-        }
-
-        return (0);
-}
-
 int probe_icache_add(probe_icache_t *cache, SEXP_t *cobj, SEXP_t *item)
 {
-        int ret;
+        probe_iqnode_t *node;
 
         if (cache == NULL || cobj == NULL || item == NULL)
                 return (-1); /* XXX: EFAULT */
 
-        if (pthread_mutex_lock(&cache->queue_mutex) != 0) {
-                dE("An error ocured while locking the queue mutex: %u, %s",
-                   errno, strerror(errno));
-                return (-1);
-        }
-
-        ret = __probe_icache_add_nolock(cache, cobj, item, NULL);
-
-        if (pthread_cond_signal(&cache->queue_notempty) != 0) {
-                dE("An error ocured while signaling the `notempty' condition: %u, %s",
-                   errno, strerror(errno));
-                return (-1);
-        }
-
-        if (pthread_mutex_unlock(&cache->queue_mutex) != 0) {
-                dE("An error ocured while unlocking the queue mutex: %u, %s",
-                   errno, strerror(errno));
-                abort();
-        }
+        node = oscap_talloc(probe_iqnode_t);
+        node->pair.cobj   = cobj;
+        node->pair.p.item = item;
 
-        if (ret != 0)
-                return (-1);
+        probe_iqueue_push(cache, node);
 
-        return (0);
+        return probe_iqueue_notify(cache);
 }
 
 int probe_icache_nop(probe_icache_t *cache)
 {
-        pthread_cond_t cond;
+        probe_icache_sync_t sync;
+        probe_iqnode_t     *node;
 
         dD("NOP");
 
-        if (pthread_mutex_lock(&cache->queue_mutex) != 0) {
-                dE("An error ocured while locking the queue mutex: %u, %s",
-                   errno, strerror(errno));
-                return (-1);
-        }
-
-        if (pthread_cond_init(&cond, NULL) != 0) {
+        if (pthread_cond_init(&sync.cond, NULL) != 0) {
                 dE("Can't initialize icache queue condition variable (NOP): %u, %s",
                    errno, strerror(errno));
                 return (-1);
         }
 
-        if (__probe_icache_add_nolock(cache, NULL, NULL, &cond) != 0) {
-                if (pthread_mutex_unlock(&cache->queue_mutex) != 0) {
-                        dE("An error ocured while unlocking the queue mutex: %u, %s",
-                           errno, strerror(errno));
-                        abort();
-                }
+        sync.done = false;
 
-                pthread_cond_destroy(&cond);
-                return (-1);
-        }
+        node = oscap_talloc(probe_iqnode_t);
+        node->pair.cobj   = NULL;
+        node->pair.p.sync = &sync;
 
-        dD("Signaling `notempty'");
+        probe_iqueue_push(cache, node);
 
-        if (pthread_cond_signal(&cache->queue_notempty) != 0) {
-                dE("An error ocured while signaling the `notempty' condition: %u, %s",
-                   errno, strerror(errno));
+        dD("Signaling `notempty'");
 
-                pthread_cond_destroy(&cond);
-                return (-1);
+        if (probe_iqueue_notify(cache) != 0) {
+                /* the node is still queued and refers to `sync' */
+                abort();
         }
 
         dD("Waiting for icache worker to handle the NOP");
 
-        if (pthread_cond_wait(&cond, &cache->queue_mutex) != 0) {
-                dE("An error ocured while waiting for the `NOP' queue condition: %u, %s",
+        if (pthread_mutex_lock(&cache->queue_mutex) != 0) {
+                dE("An error ocured while locking the queue mutex: %u, %s",
                    errno, strerror(errno));
-                return (-1);
+                abort();
+        }
+
+        while (!sync.done) {
+                if (pthread_cond_wait(&sync.cond, &cache->queue_mutex) != 0) {
+                        dE("An error ocured while waiting for the `NOP' queue condition: %u, %s",
+                           errno, strerror(errno));
+                        abort();
+                }
         }
 
         dD("Sync");
@@ -452,7 +650,7 @@ int probe_icache_nop(probe_icache_t *cache)
                 abort();
         }
 
-        pthread_cond_destroy(&cond);
+        pthread_cond_destroy(&sync.cond);
 
         return (0);
 }
@@ -460,44 +658,207 @@ int probe_icache_nop(probe_icache_t *cache)
 #define PROBE_RESULT_MEMCHECK_CTRESHOLD  32768  /* item count */
 #define PROBE_RESULT_MEMCHECK_MINFREEMEM 512    /* MiB */
 #define PROBE_RESULT_MEMCHECK_MAXRATIO   0.8   /* max. memory usage ratio - used/total */
+#define PROBE_RESULT_MEMCHECK_PERIOD_MS  100    /* sampling period of the monitor thread */
+
+/* environment variables overriding the limits above */
+#define PROBE_RESULT_MEMCHECK_CTRESHOLD_ENV  "OSCAP_PROBE_MEMORY_CHECK_ITEMS"
+#define PROBE_RESULT_MEMCHECK_MINFREEMEM_ENV "OSCAP_PROBE_MEMORY_MIN_FREE"
+#define PROBE_RESULT_MEMCHECK_MAXRATIO_ENV   "OSCAP_PROBE_MEMORY_MAX_RATIO"
+
+static struct {
+	size_t ctreshold;
+	size_t minfreemem;
+	double maxratio;
+} __memcheck_limits;
+
+static pthread_once_t __memcheck_limits_once  = PTHREAD_ONCE_INIT;
+static pthread_once_t __memcheck_monitor_once = PTHREAD_ONCE_INIT;
+static bool __memcheck_monitor = false;
+/* the result of the last sample, see probe_cobj_memcheck */
+static int  __memcheck_state = 0;
+
+static void probe_cobj_memcheck_limits(void)
+{
+	const char *env;
+
+	__memcheck_limits.ctreshold  = PROBE_RESULT_MEMCHECK_CTRESHOLD;
+	__memcheck_limits.minfreemem = PROBE_RESULT_MEMCHECK_MINFREEMEM;
+	__memcheck_limits.maxratio   = PROBE_RESULT_MEMCHECK_MAXRATIO;
+
+	if ((env = getenv(PROBE_RESULT_MEMCHECK_CTRESHOLD_ENV)) != NULL && *env != '\0')
+		__memcheck_limits.ctreshold = strtoul(env, NULL, 10);
+	if ((env = getenv(PROBE_RESULT_MEMCHECK_MINFREEMEM_ENV)) != NULL && *env != '\0')
+		__memcheck_limits.minfreemem = strtoul(env, NULL, 10);
+	if ((env = getenv(PROBE_RESULT_MEMCHECK_MAXRATIO_ENV)) != NULL && *env != '\0')
+		__memcheck_limits.maxratio = strtod(env, NULL);
+
+	dI("Memory limits: items=%zu, min. free=%zu MiB, max. ratio=%f",
+	   __memcheck_limits.ctreshold, __memcheck_limits.minfreemem, __memcheck_limits.maxratio);
+}
+
+/*
+ * The limits are relative to the memory of the system, or to the memory
+ * limit of the cgroup of the probe if that is lower. Returns 1 if one of
+ * them is reached and -1 if the memory usage can't be read.
+ */
+static int probe_cobj_memcheck_sample(void)
+{
+	struct proc_memusage mu_proc;
+	struct sys_memusage  mu_sys;
+	struct cgroup_memusage mu_cg;
+	size_t total, realfree;
+	double c_ratio;
+
+	if (oscap_proc_memusage (&mu_proc) != 0)
+		return (-1);
+
+	if (oscap_sys_memusage (&mu_sys) != 0)
+		return (-1);
+
+	total    = mu_sys.mu_total;
+	realfree = mu_sys.mu_realfree;
+
+	if (oscap_cgroup_memusage(&mu_cg) == 0 && mu_cg.mu_limit < total) {
+		total    = mu_cg.mu_limit;
+		realfree = mu_cg.mu_limit > mu_cg.mu_usage ? mu_cg.mu_limit - mu_cg.mu_usage : 0;
+		if (realfree > mu_sys.mu_realfree)
+			realfree = mu_sys.mu_realfree;
+	}
+
+	c_ratio = (double)mu_proc.mu_rss/(double)(total);
+
+	if (c_ratio > __memcheck_limits.maxratio) {
+		dW("Memory usage ratio limit reached! limit=%f, current=%f",
+		   __memcheck_limits.maxratio, c_ratio);
+		return (1);
+	}
+
+	if ((realfree / 1024) < __memcheck_limits.minfreemem) {
+		dW("Minimum free memory limit reached! limit=%zu, current=%zu",
+		   __memcheck_limits.minfreemem, realfree / 1024);
+		return (1);
+	}
+
+	return (0);
+}
+
+static void *probe_cobj_memcheck_monitor(void *arg)
+{
+	struct timespec period;
+
+	period.tv_sec  = PROBE_RESULT_MEMCHECK_PERIOD_MS / 1000;
+	period.tv_nsec = (PROBE_RESULT_MEMCHECK_PERIOD_MS % 1000) * 1000000L;
+
+	for (;;) {
+		nanosleep(&period, NULL);
+		__atomic_store_n(&__memcheck_state, probe_cobj_memcheck_sample(), __ATOMIC_RELAXED);
+	}
+
+	return (NULL);
+}
+
+static void probe_cobj_memcheck_start(void)
+{
+	pthread_attr_t attr;
+	pthread_t thread;
+
+	__atomic_store_n(&__memcheck_state, probe_cobj_memcheck_sample(), __ATOMIC_RELAXED);
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+	if (pthread_create(&thread, &attr, &probe_cobj_memcheck_monitor, NULL) == 0)
+		__atomic_store_n(&__memcheck_monitor, true, __ATOMIC_RELEASE);
+	else
+		dW("Can't start the memory monitor thread, the memory usage is read for every item.");
+
+	pthread_attr_destroy(&attr);
+}
 
 /**
  * Returns 0 if the memory constraints are not reached. Otherwise, 1 is returned.
  * In case of an error, -1 is returned.
+ *
+ * The memory usage is sampled by a monitor thread, started when the first
+ * collected object reaches the item count threshold, so checking an item
+ * costs an atomic load.
  */
 static int probe_cobj_memcheck(size_t item_cnt)
 {
-	if (item_cnt > PROBE_RESULT_MEMCHECK_CTRESHOLD) {
-		struct proc_memusage mu_proc;
-		struct sys_memusage  mu_sys;
-		double c_ratio;
+	int state;
 
-		if (oscap_proc_memusage (&mu_proc) != 0)
-			return (-1);
+	pthread_once(&__memcheck_limits_once, &probe_cobj_memcheck_limits);
 
-		if (oscap_sys_memusage (&mu_sys) != 0)
-			return (-1);
+	if (item_cnt > __memcheck_limits.ctreshold) {
+		pthread_once(&__memcheck_monitor_once, &probe_cobj_memcheck_start);
 
-		c_ratio = (double)mu_proc.mu_rss/(double)(mu_sys.mu_total);
+		if (__atomic_load_n(&__memcheck_monitor, __ATOMIC_ACQUIRE))
+			state = __atomic_load_n(&__memcheck_state, __ATOMIC_RELAXED);
+		else
+			state = probe_cobj_memcheck_sample();
 
-		if (c_ratio > PROBE_RESULT_MEMCHECK_MAXRATIO) {
-			dW("Memory usage ratio limit reached! limit=%f, current=%f",
-			   PROBE_RESULT_MEMCHECK_MAXRATIO, c_ratio);
+		if (state == 1)
 			errno = ENOMEM;
-			return (1);
-		}
 
-		if ((mu_sys.mu_realfree / 1024) < PROBE_RESULT_MEMCHECK_MINFREEMEM) {
-			dW("Minimum free memory limit reached! limit=%zu, current=%zu",
-			   PROBE_RESULT_MEMCHECK_MINFREEMEM, mu_sys.mu_realfree / 1024);
-			errno = ENOMEM;
-			return (1);
-		}
+		return (state);
 	}
 
 	return (0);
 }
 
+static int probe_cobj_set_incomplete(struct probe_ctx *ctx)
+{
+	/*
+	 * Don't set the message again if the collected object is
+	 * already flagged as incomplete.
+	 */
+	if (probe_cobj_get_flag(ctx->probe_out) != SYSCHAR_FLAG_INCOMPLETE) {
+		SEXP_t *msg;
+		/*
+		 * Sync with the icache thread before modifying the
+		 * collected object.
+		 */
+		if (probe_icache_nop(ctx->icache) != 0)
+			return -1;
+
+		msg = probe_msg_creat(OVAL_MESSAGE_LEVEL_WARNING,
+		                      "Object is incomplete due to memory constraints.");
+
+		probe_cobj_add_msg(ctx->probe_out, msg);
+		probe_cobj_set_flag(ctx->probe_out, SYSCHAR_FLAG_INCOMPLETE);
+
+		SEXP_free(msg);
+	}
+
+	return 0;
+}
+
+/*
+ * Write the item to the spill file instead of the collected object. The
+ * item gets an ID but it's not deduplicated by the item cache.
+ */
+static int probe_item_spill(struct probe_ctx *ctx, SEXP_t *item)
+{
+	int ret = 0;
+
+	if (ctx->filters != NULL && probe_filter_item(ctx->filters, item)) {
+		SEXP_free(item);
+		return (1);
+	}
+
+	probe_icache_item_setID(item, SEXP_ID_v(item));
+
+	if (probe_spill_add(ctx->spill, item) != 0) {
+		/* the spilled items are lost, fall back to an incomplete object */
+		probe_spill_free(ctx->spill);
+		ctx->spill = NULL;
+		ret = probe_cobj_set_incomplete(ctx) != 0 ? -1 : 2;
+	}
+
+	SEXP_free(item);
+	return (ret);
+}
+
 /**
  * Collect an item
  * This function adds an item the collected object assosiated
@@ -507,7 +868,10 @@ static int probe_cobj_memcheck(size_t item_cnt)
  * 0 ... the item was succesfully added to the collected object
  * 1 ... the item was filtered out
  * 2 ... the item was not added because of memory constraints
- *       and the collected object was flagged as incomplete
+ *       and the collected object was flagged as incomplete;
+ *       if spilling is enabled (see spill.h), the item is written
+ *       to the spill file instead and 0 is returned; with chunked
+ *       replies (see chunk.h) the limits are not reached
  *-1 ... unexpected/internal error
  *
  * The caller must not free the item, it's freed automatically
@@ -522,38 +886,34 @@ int probe_item_collect(struct probe_ctx *ctx, SEXP_t *item)
 	assume_d(ctx->probe_out != NULL, -1);
 	assume_d(item != NULL, -1);
 
+	/* the worker flags the collected object as incomplete */
+	if (probe_ctx_expired(ctx)) {
+		SEXP_free(item);
+		return 2;
+	}
+
+	/*
+	 * Once an item was spilled, the following ones are spilled too
+	 * so that the memory usage stays flat.
+	 */
+	if (probe_spill_count(ctx->spill) > 0)
+		return probe_item_spill(ctx, item);
+
 	cobj_content = SEXP_listref_nth(ctx->probe_out, 3);
 	cobj_itemcnt = SEXP_list_length(cobj_content);
 	SEXP_free(cobj_content);
 
 	if (probe_cobj_memcheck(cobj_itemcnt) != 0) {
+		if (ctx->spill != NULL)
+			return probe_item_spill(ctx, item);
 
-		/*
-		 * Don't set the message again if the collected object is
-		 * already flagged as incomplete.
-		 */
-		if (probe_cobj_get_flag(ctx->probe_out) != SYSCHAR_FLAG_INCOMPLETE) {
-			SEXP_t *msg;
-			/*
-			 * Sync with the icache thread before modifying the
-			 * collected object.
-			 */
-			if (probe_icache_nop(ctx->icache) != 0)
-				return -1;
-
-			msg = probe_msg_creat(OVAL_MESSAGE_LEVEL_WARNING,
-			                      "Object is incomplete due to memory constraints.");
-
-			probe_cobj_add_msg(ctx->probe_out, msg);
-			probe_cobj_set_flag(ctx->probe_out, SYSCHAR_FLAG_INCOMPLETE);
-
-			SEXP_free(msg);
-		}
+		if (probe_cobj_set_incomplete(ctx) != 0)
+			return -1;
 
 		return 2;
 	}
 
-        if (ctx->filters != NULL && probe_item_filtered(item, ctx->filters)) {
+        if (ctx->filters != NULL && probe_filter_item(ctx->filters, item)) {
                 SEXP_free(item);
 		return (1);
         }
@@ -564,13 +924,14 @@ int probe_item_collect(struct probe_ctx *ctx, SEXP_t *item)
                 return (-1);
         }
 
+	/* the items stay in the object if the chunk can't be sent */
+	probe_chunk_flush(ctx->chunk, ctx->icache, ctx->probe_out, cobj_itemcnt + 1);
+
         return (0);
 }
 
-static void probe_icache_free_node(struct rbt_i64_node *n)
+static void probe_icache_free_citem(probe_citem_t *ci)
 {
-        probe_citem_t *ci = (probe_citem_t *)n->data;
-
 	for ( ; ci->count > 0 ; --ci->count ) {
 		SEXP_free(ci->item[ci->count - 1]);
 	}
@@ -580,17 +941,40 @@ static void probe_icache_free_node(struct rbt_i64_node *n)
         return;
 }
 
+void probe_icache_stats(probe_icache_t *cache, probe_icache_stats_t *stats)
+{
+        /* sync with the icache worker, it's the only writer */
+        if (probe_icache_nop(cache) != 0)
+                dW("Can't synchronize with the icache worker");
+
+        *stats = cache->stats;
+}
+
 void probe_icache_free(probe_icache_t *cache)
 {
         void *ret = NULL;
+        probe_iqnode_t *node;
 
         pthread_cancel(cache->thid);
         pthread_join(cache->thid, &ret);
+
+        /* drop items which weren't handled by the worker */
+        while ((node = probe_iqueue_pop(cache)) != NULL) {
+                if (node->pair.cobj != NULL)
+                        SEXP_free(node->pair.p.item);
+                oscap_free(node);
+        }
+
         pthread_mutex_destroy(&cache->queue_mutex);
+#if !defined(HAVE_ATOMIC_BUILTINS)
+        pthread_mutex_destroy(&cache->queue_push_mutex);
+#endif
         pthread_cond_destroy(&cache->queue_notempty);
-        pthread_cond_destroy(&cache->queue_notfull);
 
-        rbt_i64_free_cb(cache->tree, &probe_icache_free_node);
+        dI("icache stats: hits=%"PRIu64", misses=%"PRIu64", collisions=%"PRIu64,
+           cache->stats.hits, cache->stats.misses, cache->stats.collisions);
+
+        icache_index_free(cache);
         oscap_free(cache);
         return;
 }
@@ -23,44 +23,90 @@
 #define ICACHE_H
 
 #include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
 #include <sexp.h>
 #include "../SEAP/generic/rbt/rbt.h"
 
-#ifndef PROBE_IQUEUE_CAPACITY
-#define PROBE_IQUEUE_CAPACITY 1024
-#endif
+typedef struct {
+        pthread_cond_t cond;
+        bool           done;
+} probe_icache_sync_t;
 
 typedef struct {
         SEXP_t *cobj;
         union {
-                SEXP_t         *item;
-                pthread_cond_t *cond;
+                SEXP_t              *item;
+                probe_icache_sync_t *sync;
         } p;
 } probe_iqpair_t;
 
+/*
+ * Node of the intrusive multi-producer/single-consumer item queue. The
+ * queue is a singly linked list: producers append using an atomic exchange
+ * of the head pointer, the icache worker consumes from the tail.
+ */
+typedef struct probe_iqnode {
+        struct probe_iqnode *volatile next;
+        probe_iqpair_t                pair;
+} probe_iqnode_t;
+
 typedef struct {
-        rbt_t    *tree; /* XXX: rewrite to extensible or linear hashing */
+        SEXP_t  **item;
+        uint16_t  count;
+} probe_citem_t;
+
+/*
+ * The item index is an open addressing hash table by default. The red-black
+ * tree index can be selected at compile time by defining PROBE_ICACHE_RBT.
+ */
+#ifndef PROBE_ICACHE_TABLE_INITSIZE
+#define PROBE_ICACHE_TABLE_INITSIZE 1024 /* must be a power of 2 */
+#endif
+
+typedef struct {
+        SEXP_ID_t      id;
+        probe_citem_t *citem; /**< NULL if the slot is empty */
+} probe_icache_slot_t;
+
+typedef struct {
+        uint64_t hits;       /**< items replaced by an already cached item */
+        uint64_t misses;     /**< items added to the cache */
+        uint64_t collisions; /**< misses with an ID of a different cached item */
+} probe_icache_stats_t;
+
+typedef struct {
+#if defined(PROBE_ICACHE_RBT)
+        rbt_t    *tree;
+#else
+        probe_icache_slot_t *table;
+        size_t               table_size;
+        size_t               table_used;
+#endif
+        probe_icache_stats_t stats;
         pthread_t thid;
 
+        probe_iqnode_t *volatile queue_head; /**< last pushed node (producers) */
+        probe_iqnode_t          *queue_tail; /**< next node to consume (worker) */
+        probe_iqnode_t           queue_stub;
+#if !defined(HAVE_ATOMIC_BUILTINS)
+        pthread_mutex_t          queue_push_mutex;
+#endif
+        volatile uint32_t        queue_sleep; /**< the worker waits for `notempty' */
+
         pthread_mutex_t queue_mutex;
         pthread_cond_t  queue_notempty;
-        pthread_cond_t  queue_notfull;
-
-        probe_iqpair_t  queue[PROBE_IQUEUE_CAPACITY];
-        uint16_t        queue_beg;
-        uint16_t        queue_end;
-        uint16_t        queue_cnt;
-        uint16_t        queue_max;
 } probe_icache_t;
 
-typedef struct {
-        SEXP_t  **item;
-        uint16_t  count;
-} probe_citem_t;
-
 probe_icache_t *probe_icache_new(void);
 int probe_icache_add(probe_icache_t *cache, SEXP_t *cobj, SEXP_t *item);
 int probe_icache_nop(probe_icache_t *cache);
+
+/**
+ * Get the item deduplication statistics. The function synchronizes with
+ * the icache worker, i.e. all items queued so far are accounted for.
+ */
+void probe_icache_stats(probe_icache_t *cache, probe_icache_stats_t *stats);
 void probe_icache_free(probe_icache_t *cache);
 
 #endif /* ICACHE_H */
@@ -34,18 +34,19 @@
 #include "../SEAP/generic/rbt/rbt.h"
 #include "probe.h"
 #include "worker.h"
+#include "wpool.h"
 #include "rcache.h"
 #include "input_handler.h"
 
 /*
  * The input handler waits for incomming eval requests and either returns
- * a result immediately if it is found in the result cache or spawns a new
- * worker thread which takes care of evaluating the request, caching the
- * result and sending it to the requestee.
+ * a result immediately if it is found in the result cache or hands the
+ * request over to a thread from the worker pool which takes care of
+ * evaluating the request, caching the result and sending it to the
+ * requestee.
  */
 void *probe_input_handler(void *arg)
 {
-        pthread_attr_t pth_attr;
         probe_t       *probe = (probe_t *)arg;
 
         int probe_ret, cstate; /* XXX */
@@ -61,16 +62,6 @@ void *probe_input_handler(void *arg)
 
         TH_CANCEL_OFF;
 
-        if (pthread_attr_init(&pth_attr))
-                return (NULL);
-
-        if (pthread_attr_setdetachstate(&pth_attr, PTHREAD_CREATE_JOINABLE)) {
-                pthread_attr_destroy(&pth_attr);
-                return (NULL);
-        }
-
-        pthread_cleanup_push((void(*)(void *))pthread_attr_destroy, (void *)&pth_attr);
-        
         switch (errno = pthread_barrier_wait(&OSCAP_GSYM(th_barrier)))
         {
         case 0:
@@ -130,6 +121,15 @@ void *probe_input_handler(void *arg)
 			else {
 				probe_out = probe_rcache_sexp_get(probe->rcache, oid);
 
+				if (probe_out == NULL && PROBE_RCACHE_SNAPSHOT_ENABLED()) {
+					/* a result of an earlier scan */
+					probe_out = probe_rcache_snapshot_get(probe_in);
+
+					if (probe_out != NULL
+					    && probe_rcache_sexp_add(probe->rcache, oid, probe_out) != 0)
+						dW("Can't add a snapshot result to the result cache.");
+				}
+
 				if (probe_out == NULL) { /* cache miss */
 					SEXP_t *skip_flag, *obj_mask;
 
@@ -154,16 +154,34 @@ void *probe_input_handler(void *arg)
 	                                        SEXP_free(skip_flag);
 	                                        SEXP_free(obj_mask);
 					} else {
-						probe_pwpair_t *pair;
+						probe_pwpair_t  *pair;
+						probe_wthread_t *wth;
 
 	                                        SEXP_free(oid);
 						SEXP_free(skip_flag);
 						SEXP_free(obj_mask);
 
+						/*
+						 * Reserve a worker thread first; its thread ID has to be
+						 * known before the worker is published in the tree of
+						 * workers because the signal handler uses it for canceling.
+						 */
+						wth = probe_wpool_reserve(probe->wpool);
+
+						if (wth == NULL) {
+							dE("Cannot reserve a worker thread.");
+
+							probe_ret = PROBE_EUNKNOWN;
+							probe_out = NULL;
+
+							goto __error_reply;
+						}
+
 	                                        pair = oscap_talloc(probe_pwpair_t);
 						pair->probe = probe;
 						pair->pth   = probe_worker_new();
 						pair->pth->sid = SEAP_msg_id(seap_request);
+						pair->pth->tid = wth->tid;
 						pair->pth->msg = seap_request;
 						pair->pth->msg_handler = &probe_worker;
 
@@ -177,28 +195,13 @@ void *probe_input_handler(void *arg)
 							   "(ID=%u) " // TODO: 64b IDs
 							   "which is already being evaluated by an other thread.", pair->pth->sid);
 
+							probe_wpool_release(wth);
 							oscap_free(pair->pth);
 							oscap_free(pair);
 							SEAP_msg_free(seap_request);
 						} else {
 							/* OK */
-
-							if (pthread_create(&pair->pth->tid, &pth_attr, &probe_worker_runfn, pair))
-							{
-								dE("Cannot start a new worker thread: %d, %s.", errno, strerror(errno));
-
-								if (rbt_i32_del(probe->workers, pair->pth->sid, NULL) != 0)
-									dE("rbt_i32_del: failed to remove worker thread (ID=%u)", pair->pth->sid);
-
-								SEAP_msg_free(pair->pth->msg);
-								oscap_free(pair->pth);
-								oscap_free(pair);
-
-								probe_ret = PROBE_EUNKNOWN;
-								probe_out = NULL;
-
-								goto __error_reply;
-							}
+							probe_wpool_submit(wth, pair);
 						}
 
 						seap_request = NULL;
@@ -254,6 +257,5 @@ void *probe_input_handler(void *arg)
 		SEAP_msg_free(seap_request);
 	} /* main loop */
 
-        pthread_cleanup_pop(1);
         return (NULL);
 }
@@ -38,11 +38,20 @@
 #include "ncache.h"
 #include "rcache.h"
 #include "icache.h"
+#include "spill.h"
+#include "filter.h"
 #include "worker.h"
+#include "wpool.h"
 #include "signal_handler.h"
 #include "input_handler.h"
 #include "probe-api.h"
 #include "option.h"
+#include "zygote.h"
+#include "OVAL/probes/oval_hash_cache.h"
+#include "OVAL/probes/oval_pkg_index.h"
+#include "OVAL/probes/oval_proctab.h"
+#include "OVAL/probes/oval_rtnl.h"
+#include "common/oscap_trace.h"
 #include <oscap_debug.h>
 #include "debug_priv.h"
 static int fail(int err, const char *who, int line)
@@ -53,11 +62,14 @@ static int fail(int err, const char *who, int line)
 
 void  *OSCAP_GSYM(probe_arg)          = NULL;
 bool   OSCAP_GSYM(varref_handling)    = true;
+bool   OSCAP_GSYM(varref_vector)      = false;
 char **OSCAP_GSYM(no_varref_ents)     = NULL;
 size_t OSCAP_GSYM(no_varref_ents_cnt) = 0;
 probe_offline_flags OSCAP_GSYM(offline_mode) = PROBE_OFFLINE_NONE;
 probe_offline_flags OSCAP_GSYM(offline_mode_supported) = PROBE_OFFLINE_NONE;
 int OSCAP_GSYM(offline_mode_cobjflag) = SYSCHAR_FLAG_NOT_APPLICABLE;
+uint32_t OSCAP_GSYM(worker_pool_size) = 0;
+bool OSCAP_GSYM(rcache_snapshot) = false;
 
 pthread_barrier_t OSCAP_GSYM(th_barrier);
 
@@ -68,14 +80,31 @@ static int probe_optecmp(char **a, char **b)
 	return strcmp(*a, *b);
 }
 
+/*
+ * The probe is shared by the sessions of the library, `arg0' is the
+ * namespace of the session whose results are dropped. Without it, the
+ * caches are reset. Either way the next scan reads the processes and
+ * the network configuration of the system again.
+ */
 static SEXP_t *probe_reset(SEXP_t *arg0, void *arg1)
 {
         probe_t *probe = (probe_t *)arg1;
+
+        oval_proctab_reset();
+        oval_rtnl_reset();
+
+        if (arg0 != NULL && SEXP_numberp(arg0)) {
+                probe_rcache_drop_ns(probe->rcache, SEXP_number_getu(arg0));
+                probe_filter_cache_free();
+
+                return(NULL);
+        }
         /*
          * FIXME: implement main loop locking & worker waiting
          */
 	probe_rcache_free(probe->rcache);
         probe_ncache_free(probe->ncache);
+	probe_filter_cache_free();
 
         probe->rcache = probe_rcache_new();
         probe->ncache = probe_ncache_new();
@@ -119,6 +148,14 @@ static int probe_opthandler_varref(int option, int op, va_list args)
 
 static int probe_opthandler_rcache(int option, int op, va_list args)
 {
+	if (op == PROBE_OPTION_SET) {
+		OSCAP_GSYM(rcache_snapshot) = va_arg(args, int) != 0;
+	} else if (op == PROBE_OPTION_GET) {
+		int *o_snapshot = va_arg(args, int *);
+
+		if (o_snapshot != NULL)
+			*o_snapshot = OSCAP_GSYM(rcache_snapshot);
+	}
 	return (0);
 }
 
@@ -161,6 +198,37 @@ static int probe_opthandler_offlinemode(int option, int op, va_list args)
 	return 0;
 }
 
+static int probe_opthandler_wpoolsize(int option, int op, va_list args)
+{
+	if (op == PROBE_OPTION_SET) {
+		int o_size = va_arg(args, int);
+
+		if (o_size < 0)
+			return -1;
+
+		OSCAP_GSYM(worker_pool_size) = (uint32_t)o_size;
+	} else if (op == PROBE_OPTION_GET) {
+		int *o_size = va_arg(args, int *);
+
+		if (o_size != NULL)
+			*o_size = (int)OSCAP_GSYM(worker_pool_size);
+	}
+	return 0;
+}
+
+static int probe_opthandler_varref_vector(int option, int op, va_list args)
+{
+	if (op == PROBE_OPTION_SET) {
+		OSCAP_GSYM(varref_vector) = va_arg(args, int) != 0;
+	} else if (op == PROBE_OPTION_GET) {
+		int *o_vector = va_arg(args, int *);
+
+		if (o_vector != NULL)
+			*o_vector = OSCAP_GSYM(varref_vector);
+	}
+	return 0;
+}
+
 // Dummy pthread routine
 static void * dummy_routine(void *dummy_param)
 {
@@ -184,6 +252,13 @@ int main(int argc, char *argv[])
 	probe_t        probe;
 	char *rootdir = NULL;
 
+	/*
+	 * Started as a zygote, the probe continues here only in the forked
+	 * probes.
+	 */
+	if (argc > 1 && strcmp(argv[1], PROBE_ZYGOTE_ARG) == 0)
+		probe_zygote();
+
 	/* Turn on verbose mode */
 	char *verbosity_level = getenv("OSCAP_PROBE_VERBOSITY_LEVEL");
 	char *verbose_log_file = getenv("OSCAP_PROBE_VERBOSE_LOG_FILE");
@@ -223,12 +298,19 @@ int main(int argc, char *argv[])
 	 * Initialize SEAP stuff
 	 */
 	probe.SEAP_ctx = SEAP_CTX_new();
-	probe.sd       = SEAP_openfd2(probe.SEAP_ctx, STDIN_FILENO, STDOUT_FILENO, 0);
+	if (getenv("SEAP_SHM_FDS") != NULL) {
+		probe.sd = SEAP_openshm(probe.SEAP_ctx, STDIN_FILENO, 0);
 
-	if (probe.sd < 0)
-		fail(errno, "SEAP_openfd2", __LINE__ - 3);
+		if (probe.sd < 0)
+			fail(errno, "SEAP_openshm", __LINE__ - 3);
+	} else {
+		probe.sd = SEAP_openfd2(probe.SEAP_ctx, STDIN_FILENO, STDOUT_FILENO, 0);
 
-	if (SEAP_cmd_register(probe.SEAP_ctx, PROBECMD_RESET, 0, &probe_reset) != 0)
+		if (probe.sd < 0)
+			fail(errno, "SEAP_openfd2", __LINE__ - 3);
+	}
+
+	if (SEAP_cmd_register(probe.SEAP_ctx, PROBECMD_RESET, SEAP_CMDREG_USEARG, &probe_reset, &probe) != 0)
 		fail(errno, "SEAP_cmd_register", __LINE__ - 1);
 
 	/*
@@ -243,7 +325,7 @@ int main(int argc, char *argv[])
 	/*
 	 * Initialize probe option handlers
 	 */
-#define PROBE_OPTION_INITCOUNT 3
+#define PROBE_OPTION_INITCOUNT 5
 
 	probe.option = oscap_alloc(sizeof(probe_option_t) * PROBE_OPTION_INITCOUNT);
 	probe.optcnt = PROBE_OPTION_INITCOUNT;
@@ -254,6 +336,10 @@ int main(int argc, char *argv[])
 	probe.option[1].handler = &probe_opthandler_rcache;
 	probe.option[2].option  = PROBEOPT_OFFLINE_MODE_SUPPORTED;
 	probe.option[2].handler = &probe_opthandler_offlinemode;
+	probe.option[3].option  = PROBEOPT_WORKER_POOL_SIZE;
+	probe.option[3].handler = &probe_opthandler_wpoolsize;
+	probe.option[4].option  = PROBEOPT_VARREF_VECTOR;
+	probe.option[4].handler = &probe_opthandler_varref_vector;
 
 	OSCAP_GSYM(probe_optdef) = probe.option;
 	OSCAP_GSYM(probe_optdef_count) = probe.optcnt;
@@ -273,6 +359,17 @@ int main(int argc, char *argv[])
 
 	probe_offline_mode();
 
+	/*
+	 * The hash cache file, the package index and the result cache
+	 * directories belong to the scanning system, open them before
+	 * changing the root directory.
+	 */
+	oval_hash_cache_init();
+	oval_pkg_index_init();
+	probe_rcache_snapshot_open(probe.name);
+	probe_spill_open(probe.name);
+	oscap_trace_init();
+
 	/*
 	 * Setup offline mode(s)
 	 */
@@ -317,6 +414,16 @@ int main(int argc, char *argv[])
         probe.workers   = rbt_i32_new();
         probe.probe_arg = probe_init();
 
+	/*
+	 * Create the worker pool. The size may be set by probe_init() using
+	 * the PROBEOPT_WORKER_POOL_SIZE option, 0 means the number of CPUs.
+	 */
+	probe.max_threads = OSCAP_GSYM(worker_pool_size);
+	probe.wpool = probe_wpool_new(probe.max_threads);
+
+	if (probe.wpool == NULL)
+		fail(errno, "probe_wpool_new", __LINE__ - 3);
+
 	pthread_attr_init(&th_attr);
 
 	if (pthread_create(&probe.th_input, &th_attr, &probe_input_handler, &probe))
@@ -352,10 +459,14 @@ int main(int argc, char *argv[])
 	/*
 	 * Cleanup
 	 */
+	probe_wpool_free(probe.wpool);
         probe_fini(probe.probe_arg);
 
 	probe_ncache_free(probe.ncache);
 	probe_rcache_free(probe.rcache);
+	probe_filter_cache_free();
+	probe_rcache_snapshot_close();
+	probe_spill_close();
         probe_icache_free(probe.icache);
 
         rbt_i32_free(probe.workers);
@@ -25,156 +25,190 @@
 #endif
 
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <pthread.h>
 #include <sexp.h>
 
 #include "common/alloc.h"
-#include "common/bfind.h"
 #include "common/assume.h"
 
 #include "ncache.h"
 
-/**
- * Lock cache for reading.
- * @param c element name cache
- * @param r return value on failure
- */
-#define PROBE_NCACHE_RLOCK(c,r)                                      \
-        do {                                                    \
-                if (pthread_rwlock_rdlock (&(c)->lock) != 0)    \
-                        return (r);                             \
-        } while (0)
+struct probe_ncache_ent {
+        uint32_t hash;
+        SEXP_t  *name;
+};
 
-/**
- * Unlock cache which was previously locked for reading.
- * @param c element name cache
- * @return this function calls abort(3) if it is unable to
- *         unlock the cache so as to prevent a deadlock.
- */
-#define PROBE_NCACHE_RUNLOCK(c)                                      \
-        do {                                                    \
-                if (pthread_rwlock_unlock (&(c)->lock) != 0)    \
-                        abort ();                               \
-        } while (0)
+struct probe_ncache_tbl {
+        size_t size; /**< number of slots, a power of two */
+        size_t real; /**< number of used slots */
+        struct probe_ncache_tbl  *prev; /**< replaced table */
+        struct probe_ncache_ent **ent;  /**< slots */
+};
 
-/**
- * Lock cache for writing.
- * @param c element name cache
- * @param r return value on failure
- */
-#define PROBE_NCACHE_WLOCK(c,r)                                      \
-        do {                                                    \
-                if (pthread_rwlock_wrlock (&(c)->lock) != 0)    \
-                        return (r);                             \
-        } while (0)
+/* FNV-1a */
+static uint32_t probe_ncache_hash (const char *name)
+{
+        uint32_t h = 2166136261U;
+
+        while (*name != '\0') {
+                h ^= (uint8_t)*name++;
+                h *= 16777619U;
+        }
+
+        return (h);
+}
+
+static struct probe_ncache_tbl *probe_ncache_tbl_new (size_t size)
+{
+        struct probe_ncache_tbl *tbl;
+
+        tbl = oscap_talloc (struct probe_ncache_tbl);
+        tbl->ent  = oscap_calloc (size, sizeof (struct probe_ncache_ent *));
+        tbl->size = size;
+        tbl->real = 0;
+        tbl->prev = NULL;
+
+        return (tbl);
+}
 
 /**
- * Unlock cache which was previously locked for writing.
- * @param c element name cache
- * @return this function calls abort(3) if it is unable to
- *         unlock the cache so as to prevent a deadlock.
+ * Put an entry into an empty slot. The writer lock is held.
  */
-#define PROBE_NCACHE_WUNLOCK(c) PROBE_NCACHE_RUNLOCK(c)
+static void probe_ncache_tbl_put (struct probe_ncache_tbl *tbl, struct probe_ncache_ent *ent)
+{
+        size_t i;
+
+        for (i = ent->hash & (tbl->size - 1); tbl->ent[i] != NULL; i = (i + 1) & (tbl->size - 1));
+
+        __atomic_store_n (&tbl->ent[i], ent, __ATOMIC_RELEASE);
+        ++tbl->real;
+}
 
 probe_ncache_t *probe_ncache_new (void)
 {
         probe_ncache_t *cache;
         cache = oscap_talloc (probe_ncache_t);
 
-        if (pthread_rwlock_init (&cache->lock, NULL) != 0) {
+        if (pthread_mutex_init (&cache->lock, NULL) != 0) {
                 oscap_free (cache);
                 return (NULL);
         }
 
-        cache->name = oscap_calloc (PROBE_NCACHE_INIT_SIZE, sizeof (SEXP_t *));
-        cache->size = PROBE_NCACHE_INIT_SIZE;
-        cache->real = 0;
+        cache->tbl = probe_ncache_tbl_new (PROBE_NCACHE_INIT_SIZE);
 
         return (cache);
 }
 
 void probe_ncache_free (probe_ncache_t *cache)
 {
+        struct probe_ncache_tbl *tbl, *prev;
         size_t i;
 
         assume_d (cache != NULL, /* void */);
 
-        for (i = 0; i < cache->real; ++i)
-                if (cache->name[i] != NULL)
-                        SEXP_free (cache->name[i]);
+        tbl = cache->tbl;
+
+        for (i = 0; i < tbl->size; ++i) {
+                if (tbl->ent[i] != NULL) {
+                        SEXP_free (tbl->ent[i]->name);
+                        oscap_free (tbl->ent[i]);
+                }
+        }
+
+        /* the entries are shared with the replaced tables */
+        for (; tbl != NULL; tbl = prev) {
+                prev = tbl->prev;
+                oscap_free (tbl->ent);
+                oscap_free (tbl);
+        }
 
-        oscap_free (cache->name);
-        pthread_rwlock_destroy (&cache->lock);
+        pthread_mutex_destroy (&cache->lock);
         oscap_free (cache);
 
         return;
 }
 
-static int probe_ncache_cmp1 (const char *name, const SEXP_t **sexp)
+static SEXP_t *probe_ncache_find (struct probe_ncache_tbl *tbl, const char *name, uint32_t hash)
 {
-        return ((-1) * SEXP_strcmp (*sexp, name));
-}
+        struct probe_ncache_ent *ent;
+        size_t i;
 
-static int probe_ncache_cmp2 (const SEXP_t **a, const SEXP_t **b)
-{
-        return SEXP_string_cmp (*a, *b);
+        for (i = hash & (tbl->size - 1);; i = (i + 1) & (tbl->size - 1)) {
+                ent = __atomic_load_n (&tbl->ent[i], __ATOMIC_ACQUIRE);
+
+                if (ent == NULL)
+                        return (NULL);
+                if (ent->hash == hash && SEXP_strcmp (ent->name, name) == 0)
+                        return SEXP_ref (ent->name);
+        }
 }
 
 SEXP_t *probe_ncache_add (probe_ncache_t *cache, const char *name)
 {
+        struct probe_ncache_tbl *tbl;
+        struct probe_ncache_ent *ent;
+        uint32_t hash;
         SEXP_t *ref;
 
         assume_d (cache != NULL, NULL);
         assume_d (name  != NULL, NULL);
 
-        ref = SEXP_string_new (name, strlen (name));
+        hash = probe_ncache_hash (name);
 
-        if (ref == NULL)
+        if (pthread_mutex_lock (&cache->lock) != 0)
                 return (NULL);
 
-        PROBE_NCACHE_WLOCK(cache, NULL);
+        tbl = cache->tbl;
+
+        /* another thread might have added the name */
+        if ((ref = probe_ncache_find (tbl, name, hash)) != NULL)
+                goto out;
 
-        if (cache->size <= cache->real) {
-                cache->size += PROBE_NCACHE_ADD_SIZE;
-                cache->name  = oscap_realloc (cache->name, sizeof (SEXP_t *) * cache->size);
+        ent = oscap_talloc (struct probe_ncache_ent);
+        ent->hash = hash;
+        ent->name = SEXP_string_new (name, strlen (name));
+
+        if (ent->name == NULL) {
+                oscap_free (ent);
+                goto out;
         }
 
-        assume_d (cache->name != NULL, NULL);
-        assume_d (cache->size > cache->real, NULL);
+        /* keep the load factor below 1/2 so that a lookup ends at an empty slot */
+        if ((tbl->real + 1) * 2 > tbl->size) {
+                struct probe_ncache_tbl *new_tbl;
+                size_t i;
+
+                new_tbl = probe_ncache_tbl_new (tbl->size * 2);
+
+                for (i = 0; i < tbl->size; ++i)
+                        if (tbl->ent[i] != NULL)
+                                probe_ncache_tbl_put (new_tbl, tbl->ent[i]);
 
-        cache->name[cache->real] = ref;
-        ++cache->real;
+                new_tbl->prev = tbl;
+                tbl = new_tbl;
+        }
 
-        ref = SEXP_ref (ref);
-        qsort (cache->name, cache->real, sizeof (SEXP_t *), (int (*)(const void *, const void *)) &probe_ncache_cmp2);
+        probe_ncache_tbl_put (tbl, ent);
+        __atomic_store_n (&cache->tbl, tbl, __ATOMIC_RELEASE);
 
-        PROBE_NCACHE_WUNLOCK(cache);
+        ref = SEXP_ref (ent->name);
+out:
+        if (pthread_mutex_unlock (&cache->lock) != 0)
+                abort ();
 
         return (ref);
 }
 
 SEXP_t *probe_ncache_get (probe_ncache_t *cache, const char *name)
 {
-        SEXP_t **ref = NULL;
-
         assume_d (cache != NULL, NULL);
         assume_d (name  != NULL, NULL);
 
-        PROBE_NCACHE_RLOCK(cache, NULL);
-
-        if (cache->real > 0) {
-                ref = (SEXP_t **)oscap_bfind (cache->name, cache->real, sizeof (SEXP_t *),
-                                              (void *)name, (int (*)(void *, void *))&probe_ncache_cmp1);
-
-                if (ref != NULL)
-                        ref = (SEXP_t **)SEXP_ref (*ref);
-        }
-
-        PROBE_NCACHE_RUNLOCK(cache);
-
-        return ((SEXP_t *)(ref));
+        return probe_ncache_find (__atomic_load_n (&cache->tbl, __ATOMIC_ACQUIRE),
+                                  name, probe_ncache_hash (name));
 }
 
 SEXP_t *probe_ncache_ref (probe_ncache_t *cache, const char *name)
@@ -193,3 +227,21 @@ SEXP_t *probe_ncache_ref (probe_ncache_t *cache, const char *name)
 
         return (ref);
 }
+
+SEXP_t *probe_ncache_attr_ref (probe_ncache_t *cache, const char *name)
+{
+        char   key[PROBE_NCACHE_ATTR_MAX];
+        size_t len;
+
+        assume_d (name != NULL, NULL);
+
+        len = strlen (name);
+
+        if (len + 2 > sizeof key)
+                return SEXP_string_newf (":%s", name);
+
+        key[0] = ':';
+        memcpy (key + 1, name, len + 1);
+
+        return probe_ncache_ref (cache, key);
+}
@@ -26,18 +26,22 @@
 #include <pthread.h>
 #include <sexp.h>
 
-#define PROBE_NCACHE_INIT_SIZE 24
-#define PROBE_NCACHE_ADD_SIZE  8
+#define PROBE_NCACHE_INIT_SIZE 64 /* initial number of hash table slots, a power of two */
+#define PROBE_NCACHE_ATTR_MAX  64 /* longest attribute key built on the stack */
+
+struct probe_ncache_tbl;
 
 /**
- * Element name cache structure. This structure contains an array
- * of cached string S-exps representing the names of elements.
+ * Element name cache structure. The cached string S-exps representing
+ * the names of elements are kept in an open addressing hash table which
+ * is read without locking: names are only added, a slot is published
+ * with an atomic store and a full table is replaced by a larger copy.
+ * Replaced tables stay allocated until the cache is freed, as a reader
+ * may still be using them.
  */
 typedef struct {
-        pthread_rwlock_t lock; /**< pthread read-write lock */
-        SEXP_t **name; /**< array of S-exp refs */
-        size_t   real; /**< number of cached names */
-        size_t   size; /**< pre-allocated size */
+        pthread_mutex_t lock; /**< serializes writers */
+        struct probe_ncache_tbl *tbl; /**< current table */
 } probe_ncache_t;
 
 /**
@@ -87,4 +91,15 @@ SEXP_t *probe_ncache_get (probe_ncache_t *cache, const char *name);
  */
 SEXP_t *probe_ncache_ref (probe_ncache_t *cache, const char *name);
 
+/**
+ * Get a reference to the cached S-exp object representing the
+ * attribute key ":<name>". The object is created and cached if
+ * it's not found in the cache. Items built with these keys share
+ * the key strings and compare them by pointer in SEXP_string_cmp.
+ * @param cache element name cache
+ * @param name attribute name without the colon
+ * @return S-exp reference to the key string
+ */
+SEXP_t *probe_ncache_attr_ref (probe_ncache_t *cache, const char *name);
+
 #endif /* PROBE_NCACHE_H */
@@ -2,8 +2,10 @@
 #define OSCAP_PROBE_OPTION_H
 
 #define PROBEOPT_VARREF_HANDLING 0
-#define PROBEOPT_RESULT_CACHING  1
+#define PROBEOPT_RESULT_CACHING  1 /* bool: reuse results of earlier scans, see rcache.h */
 #define PROBEOPT_OFFLINE_MODE_SUPPORTED 2
+#define PROBEOPT_WORKER_POOL_SIZE 3
+#define PROBEOPT_VARREF_VECTOR   4 /* bool: probe_main() gets all values of var_ref entities at once */
 
 #define PROBE_OPTION_SET 0
 #define PROBE_OPTION_GET 1
@@ -37,3 +37,31 @@ SEXP_t *probe_ctx_getresult(probe_ctx *ctx)
 {
         return (ctx->probe_out);
 }
+
+int probe_ctx_getentvals(probe_ctx *ctx, const char *name, SEXP_t **res)
+{
+	SEXP_t *ent, *val;
+	int cnt;
+
+	ent = probe_obj_getent(ctx->probe_in, name, 1);
+
+	if (ent == NULL)
+		return (-1);
+
+	if (probe_ent_attrexists(ent, "val_idx")) {
+		/* only the value of the current combination of variable values */
+		val = probe_ent_getval(ent);
+		cnt = 1;
+
+		if (res != NULL)
+			*res = SEXP_list_new(val, NULL);
+
+		SEXP_free(val);
+	} else {
+		cnt = probe_ent_getvals(ent, res);
+	}
+
+	SEXP_free(ent);
+
+	return (cnt);
+}
@@ -26,12 +26,16 @@
 #include <unistd.h>
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
 #include <stdarg.h>
 #include <pthread.h>
 #include <seap.h>
 #include "ncache.h"
 #include "rcache.h"
 #include "icache.h"
+#include "spill.h"
+#include "chunk.h"
+#include "filter.h"
 #include "probe-common.h"
 #include "option.h"
 #include "common/util.h"
@@ -53,6 +57,7 @@ typedef struct {
 	pthread_t th_signal;
 
         rbt_t    *workers;
+        struct probe_wpool *wpool; /**< worker thread pool */
         uint32_t  max_threads;
         uint32_t  max_chdepth;
 
@@ -67,8 +72,10 @@ typedef struct {
 struct probe_ctx {
         SEXP_t         *probe_in;  /**< S-exp representation of the input object */
         SEXP_t         *probe_out; /**< collected object */
-        SEXP_t         *filters;   /**< object filters (OVAL 5.8 and higher) */
+        probe_filter_t *filters;   /**< object filters (OVAL 5.8 and higher) */
         probe_icache_t *icache;    /**< item cache */
+        probe_spill_t  *spill;     /**< items over the memory limits, NULL if they are dropped */
+        probe_chunk_t  *chunk;     /**< items sent before the reply, NULL if they aren't */
 };
 
 typedef enum {
@@ -83,5 +90,13 @@ extern pthread_barrier_t OSCAP_GSYM(th_barrier);
 extern probe_offline_flags OSCAP_GSYM(offline_mode);
 extern probe_offline_flags OSCAP_GSYM(offline_mode_supported);
 extern int OSCAP_GSYM(offline_mode_cobjflag);
+extern bool OSCAP_GSYM(rcache_snapshot);
+
+/*
+ * Collected objects are stored in and reused from the on-disk snapshot
+ * (see rcache.h) only if the probe enabled it and scans the local system.
+ */
+#define PROBE_RCACHE_SNAPSHOT_ENABLED() \
+	(OSCAP_GSYM(rcache_snapshot) && OSCAP_GSYM(offline_mode) == PROBE_OFFLINE_NONE)
 
 #endif /* PROBE_H */
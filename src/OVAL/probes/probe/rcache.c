@@ -25,14 +25,55 @@
 #endif
 
 #include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
 #include <sexp.h>
 
 #include "common/alloc.h"
 #include "common/assume.h"
+#include "common/debug_priv.h"
+#include "common/memusage.h"
 #include "../SEAP/generic/rbt/rbt.h"
 
 #include "rcache.h"
 
+struct probe_rcache_ent {
+        char    *key;
+        SEXP_t  *sexp;
+        size_t   size;
+        struct probe_rcache_ent *prev; /* more recently used */
+        struct probe_rcache_ent *next; /* less recently used */
+};
+
+static size_t probe_rcache_maxsize(void)
+{
+        struct sys_memusage mu_sys;
+        const char *env;
+        size_t size;
+
+        env = getenv(PROBE_RCACHE_MAXSIZE_ENV);
+
+        if (env != NULL && *env != '\0')
+                return ((size_t)strtoul(env, NULL, 10) * 1024 * 1024);
+
+        if (oscap_sys_memusage(&mu_sys) != 0)
+                return (PROBE_RCACHE_MAXSIZE_MIN);
+
+        /* mu_total is in KiB */
+        size = (size_t)(mu_sys.mu_total * 1024 * PROBE_RCACHE_MAXSIZE_RATIO);
+
+        return (size > PROBE_RCACHE_MAXSIZE_MIN ? size : PROBE_RCACHE_MAXSIZE_MIN);
+}
+
 probe_rcache_t *probe_rcache_new(void)
 {
 	probe_rcache_t *cache;
@@ -40,40 +81,152 @@ probe_rcache_t *probe_rcache_new(void)
 	cache = oscap_talloc(probe_rcache_t);
 	cache->tree = rbt_str_new();
 
+        if (pthread_mutex_init(&cache->lock, NULL) != 0) {
+                rbt_str_free(cache->tree);
+                oscap_free(cache);
+                return (NULL);
+        }
+
+        cache->lru_first = NULL;
+        cache->lru_last  = NULL;
+        cache->size      = 0;
+        cache->max_size  = probe_rcache_maxsize();
+        cache->memcheck  = 0;
+
 	return (cache);
 }
 
 static void probe_rcache_free_node(struct rbt_str_node *n)
 {
-        oscap_free(n->key);
-        SEXP_free(n->data);
+        struct probe_rcache_ent *ent = n->data;
+
+        SEXP_free(ent->sexp);
+        oscap_free(ent->key);
+        oscap_free(ent);
 }
 
 void probe_rcache_free(probe_rcache_t *cache)
 {
         rbt_str_free_cb(cache->tree, &probe_rcache_free_node);
+        pthread_mutex_destroy(&cache->lock);
 	oscap_free(cache);
 	return;
 }
 
+/* the cache lock is held */
+static void probe_rcache_lru_unlink(probe_rcache_t *cache, struct probe_rcache_ent *ent)
+{
+        if (ent->prev != NULL)
+                ent->prev->next = ent->next;
+        else
+                cache->lru_first = ent->next;
+
+        if (ent->next != NULL)
+                ent->next->prev = ent->prev;
+        else
+                cache->lru_last = ent->prev;
+}
+
+/* the cache lock is held */
+static void probe_rcache_lru_push(probe_rcache_t *cache, struct probe_rcache_ent *ent)
+{
+        ent->prev = NULL;
+        ent->next = cache->lru_first;
+
+        if (cache->lru_first != NULL)
+                cache->lru_first->prev = ent;
+        else
+                cache->lru_last = ent;
+
+        cache->lru_first = ent;
+}
+
+/*
+ * Evict the least recently used entries until the size is at most
+ * max_size. The most recently used entry is kept so that a result which
+ * was just added can be fetched by the worker which asked for it.
+ * The cache lock is held.
+ */
+static void probe_rcache_evict(probe_rcache_t *cache, size_t max_size)
+{
+        struct probe_rcache_ent *ent;
+
+        while (cache->size > max_size && cache->lru_last != cache->lru_first) {
+                ent = cache->lru_last;
+
+                probe_rcache_lru_unlink(cache, ent);
+                rbt_str_del(cache->tree, ent->key, NULL);
+                cache->size -= ent->size;
+
+                dD("Evicted \"%s\" (%zu bytes) from the result cache.", ent->key, ent->size);
+
+                SEXP_free(ent->sexp);
+                oscap_free(ent->key);
+                oscap_free(ent);
+        }
+}
+
+/* the cache lock is held */
+static void probe_rcache_memcheck(probe_rcache_t *cache)
+{
+        struct proc_memusage mu_proc;
+        struct sys_memusage  mu_sys;
+        double ratio;
+
+        if (cache->size < cache->memcheck + PROBE_RCACHE_MEMCHECK_STEP)
+                return;
+
+        cache->memcheck = cache->size;
+
+        if (oscap_proc_memusage(&mu_proc) != 0 || oscap_sys_memusage(&mu_sys) != 0)
+                return;
+
+        ratio = (double)mu_proc.mu_rss / (double)mu_sys.mu_total;
+
+        if (ratio > PROBE_RCACHE_MEMCHECK_MAXRATIO) {
+                dW("Memory usage ratio limit reached! limit=%f, current=%f; shrinking the result cache (%zu bytes).",
+                   PROBE_RCACHE_MEMCHECK_MAXRATIO, ratio, cache->size);
+                probe_rcache_evict(cache, cache->size / 2);
+                cache->memcheck = cache->size;
+        }
+}
+
 int probe_rcache_sexp_add(probe_rcache_t *cache, const SEXP_t *id, SEXP_t *item)
 {
-        SEXP_t *r;
-        char   *k;
+        struct probe_rcache_ent *ent;
 
 	assume_d(cache != NULL, -1);
 	assume_d(id    != NULL, -1);
 	assume_d(item  != NULL, -1);
 
-        k = SEXP_string_cstr(id);
-        r = SEXP_ref(item);
+        ent = oscap_talloc(struct probe_rcache_ent);
+        ent->key  = SEXP_string_cstr(id);
+        ent->sexp = SEXP_ref(item);
+        ent->size = SEXP_sizeof(item) + strlen(ent->key) + sizeof(struct probe_rcache_ent);
 
-        if (rbt_str_add(cache->tree, k, (void *)r) != 0) {
-                SEXP_free(r);
-                oscap_free(k);
+        if (pthread_mutex_lock(&cache->lock) != 0) {
+                SEXP_free(ent->sexp);
+                oscap_free(ent->key);
+                oscap_free(ent);
+                return (-1);
+        }
+
+        if (rbt_str_add(cache->tree, ent->key, (void *)ent) != 0) {
+                pthread_mutex_unlock(&cache->lock);
+                SEXP_free(ent->sexp);
+                oscap_free(ent->key);
+                oscap_free(ent);
                 return (-1);
         }
 
+        probe_rcache_lru_push(cache, ent);
+        cache->size += ent->size;
+
+        probe_rcache_evict(cache, cache->max_size);
+        probe_rcache_memcheck(cache);
+
+        pthread_mutex_unlock(&cache->lock);
+
 	return (0);
 }
 
@@ -95,7 +248,7 @@ int probe_rcache_cstr_del(probe_rcache_t *cache, const char *id)
 SEXP_t *probe_rcache_sexp_get(probe_rcache_t *cache, const SEXP_t * id)
 {
         char    b[128], *k = b;
-        SEXP_t *r = NULL;
+        SEXP_t *r;
 
         if (SEXP_string_cstr_r(id, k, sizeof b) == ((size_t)-1))
                 k = SEXP_string_cstr(id);
@@ -103,19 +256,303 @@ SEXP_t *probe_rcache_sexp_get(probe_rcache_t *cache, const SEXP_t * id)
         if (k == NULL)
                 return(NULL);
 
-        rbt_str_get(cache->tree, k, (void *)&r);
+        r = probe_rcache_cstr_get(cache, k);
 
         if (k != b)
                 oscap_free(k);
 
-        return (r != NULL ? SEXP_ref(r) : NULL);
+        return (r);
 }
 
 SEXP_t *probe_rcache_cstr_get(probe_rcache_t *cache, const char *k)
 {
+        struct probe_rcache_ent *ent = NULL;
         SEXP_t *r = NULL;
 
-        rbt_str_get(cache->tree, k, (void *)&r);
+        if (pthread_mutex_lock(&cache->lock) != 0)
+                return (NULL);
+
+        if (rbt_str_get(cache->tree, k, (void *)&ent) == 0 && ent != NULL) {
+                probe_rcache_lru_unlink(cache, ent);
+                probe_rcache_lru_push(cache, ent);
+                r = SEXP_ref(ent->sexp);
+        }
+
+        pthread_mutex_unlock(&cache->lock);
+
+        return (r);
+}
+
+static unsigned int probe_rcache_key_ns(const char *key)
+{
+        const char *ns;
+
+        ns = strrchr(key, '@');
+
+        return (ns == NULL ? 1 : (unsigned int)strtoul(ns + 1, NULL, 10));
+}
+
+void probe_rcache_drop_ns(probe_rcache_t *cache, unsigned int ns)
+{
+        struct probe_rcache_ent *ent, *next;
+        size_t count = 0;
+
+        if (pthread_mutex_lock(&cache->lock) != 0)
+                return;
+
+        for (ent = cache->lru_first; ent != NULL; ent = next) {
+                next = ent->next;
+
+                if (probe_rcache_key_ns(ent->key) != ns)
+                        continue;
+
+                probe_rcache_lru_unlink(cache, ent);
+                rbt_str_del(cache->tree, ent->key, NULL);
+                cache->size -= ent->size;
+
+                SEXP_free(ent->sexp);
+                oscap_free(ent->key);
+                oscap_free(ent);
+                ++count;
+        }
+
+        cache->memcheck = cache->size;
+        pthread_mutex_unlock(&cache->lock);
+
+        dI("Dropped %zu entries of the namespace %u from the result cache.", count, ns);
+}
+
+static int __snapshot_dir = -1;
+static char *__snapshot_name = NULL;
+static time_t __snapshot_ttl = PROBE_RCACHE_SNAPSHOT_TTL;
+static char __snapshot_boot[64] = ""; /* results of a previous boot are not reused */
+
+static void probe_rcache_snapshot_bootid(void)
+{
+        FILE *fp;
+
+        fp = fopen("/proc/sys/kernel/random/boot_id", "r");
+
+        if (fp == NULL)
+                return;
+
+        if (fgets(__snapshot_boot, sizeof __snapshot_boot, fp) == NULL)
+                __snapshot_boot[0] = '\0';
+
+        fclose(fp);
+}
+
+void probe_rcache_snapshot_open(const char *name)
+{
+        const char *path, *ttl;
+        struct stat st;
+        int fd;
+
+        path = getenv(PROBE_RCACHE_SNAPSHOT_ENV);
+
+        if (path == NULL || *path == '\0' || __snapshot_dir != -1)
+                return;
+
+        fd = open(path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+
+        if (fd < 0) {
+                dW("Can't open the result cache directory '%s': %s.", path, strerror(errno));
+                return;
+        }
+
+        if (fstat(fd, &st) != 0 || st.st_uid != geteuid() || (st.st_mode & 077) != 0) {
+                dW("Not using the result cache directory '%s': it must be owned by the user "
+                   "and not accessible by others.", path);
+                close(fd);
+                return;
+        }
+
+        ttl = getenv(PROBE_RCACHE_SNAPSHOT_TTL_ENV);
+
+        if (ttl != NULL && *ttl != '\0')
+                __snapshot_ttl = (time_t)strtol(ttl, NULL, 10);
+
+        __snapshot_dir  = fd;
+        __snapshot_name = strdup(name);
+        probe_rcache_snapshot_bootid();
+
+        dI("Using the result cache directory '%s', ttl=%ld.", path, (long)__snapshot_ttl);
+}
+
+void probe_rcache_snapshot_close(void)
+{
+        if (__snapshot_dir != -1) {
+                close(__snapshot_dir);
+                __snapshot_dir = -1;
+        }
+
+        free(__snapshot_name);
+        __snapshot_name = NULL;
+}
+
+/* FNV-1a */
+static uint64_t probe_rcache_snapshot_hash(uint64_t h, const void *data, size_t len)
+{
+        const uint8_t *p = (const uint8_t *)data;
+
+        while (len-- > 0) {
+                h ^= *p++;
+                h *= 0x100000001b3ULL;
+        }
+
+        return (h);
+}
+
+/*
+ * Encode the object and build the name of its snapshot file. The file
+ * contains the encoded object followed by the encoded collected object,
+ * the object is compared on lookup so that a hash collision doesn't
+ * return a wrong result. The boot ID is hashed too.
+ */
+static strbuf_t *probe_rcache_snapshot_key(const SEXP_t *obj, char *path, size_t size)
+{
+        strbuf_t *sb;
+        char *enc;
+        size_t len;
+
+        sb = strbuf_new(SEAP_STRBUF_MAX);
+
+        if (SEXP_sbprintf_b((SEXP_t *)obj, sb) != 0) {
+                strbuf_free(sb);
+                return (NULL);
+        }
+
+        len = strbuf_length(sb);
+        enc = oscap_alloc(len);
+        strbuf_copy(sb, enc, len);
+        snprintf(path, size, "%s-%016llx.sexp", __snapshot_name,
+                 (unsigned long long)probe_rcache_snapshot_hash(
+                         probe_rcache_snapshot_hash(0xcbf29ce484222325ULL, __snapshot_boot, strlen(__snapshot_boot)),
+                         enc, len));
+        oscap_free(enc);
+
+        return (sb);
+}
+
+static ssize_t probe_rcache_snapshot_read(int fd, char *buf, size_t len)
+{
+        size_t off = 0;
+        ssize_t r;
+
+        while (off < len) {
+                r = read(fd, buf + off, len - off);
+
+                if (r < 0 && errno == EINTR)
+                        continue;
+                if (r <= 0)
+                        break;
+
+                off += (size_t)r;
+        }
+
+        return ((ssize_t)off);
+}
+
+SEXP_t *probe_rcache_snapshot_get(const SEXP_t *obj)
+{
+        char path[PATH_MAX], *buf = NULL, *enc = NULL;
+        SEXP_t *cobj = NULL;
+        strbuf_t *sb;
+        struct stat st;
+        size_t len;
+        ssize_t flen;
+        int fd;
+
+        if (__snapshot_dir == -1 || obj == NULL)
+                return (NULL);
+        if ((sb = probe_rcache_snapshot_key(obj, path, sizeof path)) == NULL)
+                return (NULL);
+
+        fd = openat(__snapshot_dir, path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+
+        if (fd < 0)
+                goto out;
+
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)
+            || st.st_mtime + __snapshot_ttl < time(NULL))
+                goto out;
+
+        len = strbuf_length(sb);
+
+        if ((size_t)st.st_size <= len)
+                goto out;
+
+        buf = oscap_alloc((size_t)st.st_size);
+        enc = oscap_alloc(len);
+        strbuf_copy(sb, enc, len);
+
+        if (probe_rcache_snapshot_read(fd, buf, (size_t)st.st_size) != st.st_size)
+                goto out;
+        if (memcmp(buf, enc, len) != 0)
+                goto out;
+
+        flen = SEXP_binary_framelen(buf + len, (size_t)st.st_size - len);
+
+        if (flen <= 0 || (size_t)flen != (size_t)st.st_size - len)
+                goto out;
+
+        cobj = SEXP_parse_binary(buf + len, (size_t)flen);
+out:
+        if (fd >= 0)
+                close(fd);
+
+        oscap_free(buf);
+        oscap_free(enc);
+        strbuf_free(sb);
+
+        return (cobj);
+}
+
+int probe_rcache_snapshot_put(const SEXP_t *obj, const SEXP_t *cobj)
+{
+        char path[PATH_MAX], temp[PATH_MAX];
+        strbuf_t *sb;
+        int fd, len, ret = -1;
+
+        if (__snapshot_dir == -1 || obj == NULL || cobj == NULL)
+                return (0);
+        if ((sb = probe_rcache_snapshot_key(obj, path, sizeof path)) == NULL)
+                return (-1);
+        if (SEXP_sbprintf_b((SEXP_t *)cobj, sb) != 0)
+                goto out;
+
+        /* write a temporary file and rename it so that readers never see a partial file */
+        len = snprintf(temp, sizeof temp, ".%s.%ld.%lx", path, (long)getpid(), (unsigned long)pthread_self());
+
+        if (len < 0 || (size_t)len >= sizeof temp) {
+                errno = ENAMETOOLONG;
+                goto out;
+        }
+
+        fd = openat(__snapshot_dir, temp, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+
+        if (fd < 0)
+                goto out;
+
+        if (strbuf_write(sb, fd) != (ssize_t)strbuf_length(sb)) {
+                close(fd);
+                unlinkat(__snapshot_dir, temp, 0);
+                goto out;
+        }
+
+        close(fd);
+
+        if (renameat(__snapshot_dir, temp, __snapshot_dir, path) != 0) {
+                unlinkat(__snapshot_dir, temp, 0);
+                goto out;
+        }
+
+        ret = 0;
+out:
+        if (ret != 0)
+                dW("Can't store the collected object in the result cache: %s.", strerror(errno));
+
+        strbuf_free(sb);
 
-        return (r != NULL ? SEXP_ref(r) : NULL);
+        return (ret);
 }
@@ -23,14 +23,37 @@
 #define RCACHE_H
 
 #include <stddef.h>
+#include <pthread.h>
 #include <sexp.h>
 #include "../SEAP/generic/rbt/rbt.h"
 
+/*
+ * The cache holds at most PROBE_RCACHE_MAXSIZE_RATIO of the system memory
+ * (or OSCAP_PROBE_RCACHE_MAXSIZE MiB) of S-exps, as estimated by SEXP_sizeof,
+ * and evicts the least recently used ones to stay below that. Every
+ * PROBE_RCACHE_MEMCHECK_STEP bytes added, the resident size of the process
+ * is checked too; if it's above PROBE_RCACHE_MEMCHECK_MAXRATIO of the
+ * system memory, the cache is shrunk to half of its size.
+ */
+#define PROBE_RCACHE_MAXSIZE_ENV        "OSCAP_PROBE_RCACHE_MAXSIZE"
+#define PROBE_RCACHE_MAXSIZE_RATIO      0.125
+#define PROBE_RCACHE_MAXSIZE_MIN        (16 * 1024 * 1024)
+#define PROBE_RCACHE_MEMCHECK_STEP      (16 * 1024 * 1024)
+#define PROBE_RCACHE_MEMCHECK_MAXRATIO  0.5
+
+struct probe_rcache_ent;
+
 /**
  * Probe cache structure.
  */
 typedef struct {
         rbt_t *tree; /**< red-black tree used to store the items */
+        pthread_mutex_t lock; /**< protects the LRU list and the sizes */
+        struct probe_rcache_ent *lru_first; /**< most recently used entry */
+        struct probe_rcache_ent *lru_last;  /**< least recently used entry */
+        size_t size;     /**< estimated size of the cached S-exps */
+        size_t max_size; /**< size limit */
+        size_t memcheck; /**< size at the last process memory check */
 } probe_rcache_t;
 
 /**
@@ -105,4 +128,50 @@ SEXP_t *probe_rcache_sexp_get(probe_rcache_t *cache, const SEXP_t *id);
  */
 SEXP_t *probe_rcache_cstr_get(probe_rcache_t *cache, const char *id);
 
+/**
+ * Delete the S-exps cached for a session of the library. The ids of the
+ * session `ns' are suffixed by "@ns", except for the first one.
+ * @param cache probe cache
+ * @param ns namespace of the session
+ */
+void probe_rcache_drop_ns(probe_rcache_t *cache, unsigned int ns);
+
+/*
+ * On-disk snapshot of collected objects
+ *
+ * If OSCAP_PROBE_RCACHE_DIR names a directory owned by the user and not
+ * accessible by others, collected objects of the probes which enabled the
+ * PROBEOPT_RESULT_CACHING option are stored there, keyed by the probe name
+ * and by the content of the object (including resolved variables). A later
+ * scan which evaluates the same object within OSCAP_PROBE_RCACHE_TTL seconds
+ * (PROBE_RCACHE_SNAPSHOT_TTL by default) and since the same boot reuses the
+ * stored result. Only
+ * probes whose results don't change between scans (e.g. rpminfo, uname)
+ * should enable it.
+ */
+#define PROBE_RCACHE_SNAPSHOT_ENV     "OSCAP_PROBE_RCACHE_DIR"
+#define PROBE_RCACHE_SNAPSHOT_TTL_ENV "OSCAP_PROBE_RCACHE_TTL"
+#define PROBE_RCACHE_SNAPSHOT_TTL     3600
+
+/**
+ * Open the snapshot directory, if enabled. Called by the probe before it
+ * changes its root directory.
+ * @param name probe name used in the snapshot file names
+ */
+void probe_rcache_snapshot_open(const char *name);
+void probe_rcache_snapshot_close(void);
+
+/**
+ * Get the collected object for the object obj from the snapshot.
+ * @return the collected object or NULL if not found or expired
+ */
+SEXP_t *probe_rcache_snapshot_get(const SEXP_t *obj);
+
+/**
+ * Store the collected object cobj of the object obj in the snapshot.
+ * @retval 0 on success or if the snapshot is not enabled
+ * @retval -1 on failure
+ */
+int probe_rcache_snapshot_put(const SEXP_t *obj, const SEXP_t *cobj);
+
 #endif /* PROBE_RCACHE_H */
@@ -0,0 +1,285 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sexp.h>
+
+#include "common/alloc.h"
+#include "common/debug_priv.h"
+#include "probe-api.h"
+
+#include "spill.h"
+
+#define PROBE_SPILL_HDRSZ 5 /* magic and length of a binary frame */
+
+struct probe_spill {
+        FILE    *fp;
+        char     name[NAME_MAX + 1];
+        size_t   count;
+        bool     stored; /**< the name was stored in a collected object */
+};
+
+static int __spill_dir = -1;
+static char *__spill_name = NULL;
+static uint32_t __spill_next = 0;
+
+static int probe_spill_dir(void)
+{
+        const char *path;
+        struct stat st;
+        int fd;
+
+        path = getenv(PROBE_SPILL_ENV);
+
+        if (path == NULL || *path == '\0')
+                return (-1);
+
+        fd = open(path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+
+        if (fd < 0) {
+                dW("Can't open the spill directory '%s': %s.", path, strerror(errno));
+                return (-1);
+        }
+
+        if (fstat(fd, &st) != 0 || st.st_uid != geteuid() || (st.st_mode & 077) != 0) {
+                dW("Not using the spill directory '%s': it must be owned by the user "
+                   "and not accessible by others.", path);
+                close(fd);
+                return (-1);
+        }
+
+        return (fd);
+}
+
+void probe_spill_open(const char *name)
+{
+        if (__spill_dir != -1)
+                return;
+        if ((__spill_dir = probe_spill_dir()) == -1)
+                return;
+
+        __spill_name = strdup(name);
+        dI("Spilling large collected objects to '%s'.", getenv(PROBE_SPILL_ENV));
+}
+
+void probe_spill_close(void)
+{
+        if (__spill_dir != -1) {
+                close(__spill_dir);
+                __spill_dir = -1;
+        }
+
+        free(__spill_name);
+        __spill_name = NULL;
+}
+
+probe_spill_t *probe_spill_new(void)
+{
+        probe_spill_t *spill;
+
+        if (__spill_dir == -1)
+                return (NULL);
+
+        spill = oscap_talloc(probe_spill_t);
+        spill->fp      = NULL;
+        spill->name[0] = '\0';
+        spill->count   = 0;
+        spill->stored  = false;
+
+        return (spill);
+}
+
+static int probe_spill_create(probe_spill_t *spill)
+{
+        int fd;
+
+        snprintf(spill->name, sizeof spill->name, "%s-%ld-%u.spill", __spill_name, (long)getpid(),
+                 __atomic_fetch_add(&__spill_next, 1, __ATOMIC_RELAXED));
+
+        fd = openat(__spill_dir, spill->name, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+
+        if (fd < 0)
+                goto fail;
+
+        if ((spill->fp = fdopen(fd, "w")) == NULL) {
+                close(fd);
+                unlinkat(__spill_dir, spill->name, 0);
+                goto fail;
+        }
+
+        dI("Spilling the items of a collected object to '%s'.", spill->name);
+
+        return (0);
+fail:
+        dE("Can't create the spill file '%s': %s.", spill->name, strerror(errno));
+        spill->name[0] = '\0';
+
+        return (-1);
+}
+
+int probe_spill_add(probe_spill_t *spill, const SEXP_t *item)
+{
+        strbuf_t *sb;
+        int ret = -1;
+
+        if (spill->fp == NULL && probe_spill_create(spill) != 0)
+                return (-1);
+
+        sb = strbuf_new(SEAP_STRBUF_MAX);
+
+        if (SEXP_sbprintf_b((SEXP_t *)item, sb) != 0)
+                goto out;
+
+        if (strbuf_fwrite(spill->fp, sb) != strbuf_length(sb)) {
+                dE("Can't write to the spill file '%s': %s.", spill->name, strerror(errno));
+                goto out;
+        }
+
+        ++spill->count;
+        ret = 0;
+out:
+        strbuf_free(sb);
+
+        return (ret);
+}
+
+size_t probe_spill_count(const probe_spill_t *spill)
+{
+        return (spill == NULL ? 0 : spill->count);
+}
+
+int probe_spill_finish(probe_spill_t *spill, SEXP_t *cobj)
+{
+        int ret;
+
+        if (spill == NULL || spill->fp == NULL)
+                return (0);
+
+        ret = fclose(spill->fp);
+        spill->fp = NULL;
+
+        if (ret != 0) {
+                dE("Can't write to the spill file '%s': %s.", spill->name, strerror(errno));
+                return (-1);
+        }
+
+        if (probe_cobj_set_spill(cobj, spill->name) != 0)
+                return (-1);
+
+        spill->stored = true;
+        dI("%zu items spilled to '%s'.", spill->count, spill->name);
+
+        return (0);
+}
+
+void probe_spill_free(probe_spill_t *spill)
+{
+        if (spill == NULL)
+                return;
+
+        if (spill->fp != NULL)
+                fclose(spill->fp);
+        if (spill->name[0] != '\0' && !spill->stored)
+                unlinkat(__spill_dir, spill->name, 0);
+
+        oscap_free(spill);
+}
+
+ssize_t probe_spill_read(const char *name, void (*fn)(SEXP_t *item, void *arg), void *arg)
+{
+        uint8_t hdr[PROBE_SPILL_HDRSZ], *buf = NULL;
+        size_t bufsz = 0, flen;
+        ssize_t count = 0, r;
+        SEXP_t *item;
+        FILE *fp = NULL;
+        int dir, fd;
+
+        /* the name comes from the probe, don't let it point out of the directory */
+        if (name == NULL || *name == '\0' || *name == '.' || strchr(name, '/') != NULL) {
+                dE("Invalid spill file name.");
+                return (-1);
+        }
+
+        if ((dir = probe_spill_dir()) == -1)
+                return (-1);
+
+        fd = openat(dir, name, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+
+        if (fd < 0 || (fp = fdopen(fd, "r")) == NULL) {
+                dE("Can't open the spill file '%s': %s.", name, strerror(errno));
+                if (fd >= 0)
+                        close(fd);
+                close(dir);
+                return (-1);
+        }
+
+        while (fread(hdr, 1, sizeof hdr, fp) == sizeof hdr) {
+                r = SEXP_binary_framelen(hdr, sizeof hdr);
+
+                if (r < (ssize_t)sizeof hdr)
+                        goto fail;
+
+                flen = (size_t)r;
+
+                if (flen > bufsz) {
+                        bufsz = flen;
+                        buf = oscap_realloc(buf, bufsz);
+                }
+
+                memcpy(buf, hdr, sizeof hdr);
+
+                if (fread(buf + sizeof hdr, 1, flen - sizeof hdr, fp) != flen - sizeof hdr)
+                        goto fail;
+                if ((item = SEXP_parse_binary(buf, flen)) == NULL)
+                        goto fail;
+
+                fn(item, arg);
+                SEXP_free(item);
+                ++count;
+        }
+
+        if (ferror(fp) || !feof(fp))
+                goto fail;
+out:
+        fclose(fp);
+        unlinkat(dir, name, 0);
+        close(dir);
+        oscap_free(buf);
+
+        return (count);
+fail:
+        dE("The spill file '%s' is truncated or malformed.", name);
+        count = -1;
+        goto out;
+}
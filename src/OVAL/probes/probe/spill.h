@@ -0,0 +1,66 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef SPILL_H
+#define SPILL_H
+
+#include <stddef.h>
+#include <sexp.h>
+
+/*
+ * Spilling of large collected objects
+ *
+ * If OSCAP_PROBE_SPILL names a directory owned by the user and not
+ * accessible by others, the items collected after the memory limits of
+ * the probe are reached (see probe_item_collect) are not kept in the
+ * collected object. They are appended as binary S-exp frames to a file
+ * in that directory and the name of the file is stored in the collected
+ * object instead. The library reads the items back from the file while
+ * converting the reply and removes it.
+ */
+#define PROBE_SPILL_ENV "OSCAP_PROBE_SPILL"
+
+typedef struct probe_spill probe_spill_t;
+
+/* open the directory, before the probe changes its root directory */
+void probe_spill_open(const char *name);
+void probe_spill_close(void);
+
+/* NULL if spilling is not enabled, the file is created by the first probe_spill_add */
+probe_spill_t *probe_spill_new(void);
+
+/* append the item to the file, 0 on success and -1 on failure */
+int probe_spill_add(probe_spill_t *spill, const SEXP_t *item);
+
+/* number of items in the file */
+size_t probe_spill_count(const probe_spill_t *spill);
+
+/* store the name of the file in the collected object, if any item was added */
+int probe_spill_finish(probe_spill_t *spill, SEXP_t *cobj);
+
+/* remove the file unless probe_spill_finish stored it in a collected object */
+void probe_spill_free(probe_spill_t *spill);
+
+/*
+ * Call `fn' for every item of the spill file named by the collected object
+ * and remove the file. Returns the number of items or -1 on failure.
+ */
+ssize_t probe_spill_read(const char *name, void (*fn)(SEXP_t *item, void *arg), void *arg);
+
+#endif /* SPILL_H */
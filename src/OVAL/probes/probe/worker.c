@@ -31,13 +31,16 @@
 #include <errno.h>
 
 #include "probe-api.h"
+#include "../_probe-api.h"
 #include "common/debug_priv.h"
+#include "common/oscap_trace.h"
 #include "common/assume.h"
 #include "entcmp.h"
 
 #include "worker.h"
 
 extern bool  OSCAP_GSYM(varref_handling);
+extern bool  OSCAP_GSYM(varref_vector);
 extern void *OSCAP_GSYM(probe_arg);
 
 void *probe_worker_runfn(void *arg)
@@ -45,15 +48,31 @@ void *probe_worker_runfn(void *arg)
 	probe_pwpair_t *pair = (probe_pwpair_t *)arg;
 
 	SEXP_t *probe_res, *obj, *oid;
+	char   *spill;
 	int     probe_ret;
+	struct oscap_trace_span span;
 
-#if defined(HAVE_PTHREAD_SETNAME_NP)
-	pthread_setname_np(pthread_self(), "probe_worker");
-#endif
 	dD("handling SEAP message ID %u", pair->pth->sid);
+	/*
+	 * The temporary values of the request are recycled within this
+	 * thread until the reply is sent.
+	 */
+	SEXP_slab_scope_begin();
 	//
 	probe_ret = -1;
+	oscap_trace_begin(&span, "probe_worker");
 	probe_res = pair->pth->msg_handler(pair->probe, pair->pth->msg, &probe_ret);
+
+	if (span.name != NULL) {
+		char id[128] = "";
+
+		obj = SEAP_msg_get(pair->pth->msg);
+		oid = probe_obj_getattrval(obj, "id");
+		if (oid != NULL)
+			SEXP_string_cstr_r(oid, id, sizeof id);
+		SEXP_vfree(obj, oid, NULL);
+		oscap_trace_end(&span, id);
+	}
 	//
 	dD("handler result = %p, return code = %d", probe_res, probe_ret);
 
@@ -69,27 +88,35 @@ void *probe_worker_runfn(void *arg)
                 SEAP_msg_free(pair->pth->msg);
                 SEXP_free(probe_res);
                 oscap_free(pair);
+                SEXP_slab_scope_end();
 
                 return (NULL);
 	} else {
-                SEXP_t *items;
-
 		dD("probe thread deleted");
 
 		obj = SEAP_msg_get(pair->pth->msg);
 		oid = probe_obj_getattrval(obj, "id");
-                items = probe_cobj_get_items(probe_res);
 
-                if (items != NULL) {
-                        SEXP_list_sort(items, SEXP_refcmp);
-                        SEXP_free(items);
-                }
+		/*
+		 * The spill file of a collected object is removed by the
+		 * library once read, so such an object can't be reused.
+		 */
+		spill = probe_res != NULL ? probe_cobj_get_spill(probe_res) : NULL;
 
-		if (probe_rcache_sexp_add(pair->probe->rcache, oid, probe_res) != 0) {
-			/* TODO */
-			abort();
+		/* nor an object whose items were sent in chunks, see chunk.h */
+		if (spill == NULL && !SEAP_msgattr_exists(pair->pth->msg, "chunks-sent")) {
+			if (probe_rcache_sexp_add(pair->probe->rcache, oid, probe_res) != 0) {
+				/* TODO */
+				abort();
+			}
+
+			if (PROBE_RCACHE_SNAPSHOT_ENABLED()
+			    && probe_cobj_get_flag(probe_res) != SYSCHAR_FLAG_ERROR)
+				probe_rcache_snapshot_put(obj, probe_res);
 		}
 
+		oscap_free(spill);
+
 		SEXP_vfree(obj, oid, NULL);
 	}
 
@@ -132,7 +159,7 @@ void *probe_worker_runfn(void *arg)
         SEAP_msg_free(pair->pth->msg);
         oscap_free(pair->pth);
 	oscap_free(pair);
-	pthread_detach(pthread_self());
+	SEXP_slab_scope_end();
 
 	return (NULL);
 }
@@ -163,7 +190,12 @@ struct probe_varref_ctx_ent {
 
 static void probe_varref_destroy_ctx(struct probe_varref_ctx *ctx);
 
-static int probe_varref_create_ctx(const SEXP_t *probe_in, SEXP_t *varrefs, struct probe_varref_ctx **octx)
+/*
+ * Replace the var_ref entities of the object with entities that carry the values
+ * of the referenced variables. Unless the probe handles all the values at once
+ * (vector), a `val_idx' attribute selects the value of the current combination.
+ */
+static int probe_varref_create_ctx(const SEXP_t *probe_in, SEXP_t *varrefs, bool vector, struct probe_varref_ctx **octx)
 {
 	unsigned int i, ent_cnt, val_cnt;
 	SEXP_t *ent_name, *ent, *varref, *val_lst;
@@ -194,11 +226,16 @@ static int probe_varref_create_ctx(const SEXP_t *probe_in, SEXP_t *varrefs, stru
 		r1 = SEXP_list_first(r0);
 		r2 = SEXP_list_first(r1);
 
-		r3 = SEXP_list_new(r2, vidx_name, vidx_val, NULL);
 		SEXP_free(r0);
-		r0 = SEXP_list_rest(r1);
-		ent_name = SEXP_list_join(r3, r0);
-		SEXP_vfree(r0, r1, r2, r3, NULL);
+		if (vector) {
+			ent_name = SEXP_ref(r1);
+			SEXP_vfree(r1, r2, NULL);
+		} else {
+			r3 = SEXP_list_new(r2, vidx_name, vidx_val, NULL);
+			r0 = SEXP_list_rest(r1);
+			ent_name = SEXP_list_join(r3, r0);
+			SEXP_vfree(r0, r1, r2, r3, NULL);
+		}
 
 		SEXP_sublist_foreach(varref, varrefs, 4, SEXP_LIST_END) {
 			r0 = SEXP_list_first(varref);
@@ -314,7 +351,7 @@ static int probe_varref_iterate_ctx(struct probe_varref_ctx *ctx)
  */
 static SEXP_t *probe_ste_fetch(probe_t *probe, SEXP_t *id_list)
 {
-	SEXP_t *res, *ste, *id;
+	SEXP_t *res, *ste, *id, *r0 = NULL;
 	uint32_t i_len, r_len;
 
 	i_len = SEXP_list_length(id_list);
@@ -338,7 +375,9 @@ static SEXP_t *probe_ste_fetch(probe_t *probe, SEXP_t *id_list)
 		_A(id != NULL);
 		_A(ste != NULL);
 
-		if (probe_rcache_sexp_add(probe->rcache, id, ste) != 0) {
+		/* a concurrent worker may have fetched the state too */
+		if (probe_rcache_sexp_add(probe->rcache, id, ste) != 0
+		    && (r0 = probe_rcache_sexp_get(probe->rcache, id)) == NULL) {
 
 			SEXP_free(res);
 			SEXP_free(ste);
@@ -347,8 +386,10 @@ static SEXP_t *probe_ste_fetch(probe_t *probe, SEXP_t *id_list)
 			return (NULL);
 		}
 
+		SEXP_free(r0);
 		SEXP_free(ste);
 		SEXP_free(id);
+		r0 = NULL;
 	}
 
 	return (res);
@@ -379,15 +420,128 @@ static SEXP_t *probe_obj_eval(probe_t *probe, SEXP_t *id)
 	return probe_rcache_sexp_get(probe->rcache, id);
 }
 
-static SEXP_t *probe_prepare_filters(probe_t *probe, SEXP_t *obj)
+/**
+ * Evaluate the OVAL objects identified by the ids in one round-trip,
+ * see probe_obj_eval. The results are left in the probe cache.
+ * @param id_list list of the ids of the objects
+ * @return 0 on success, -1 on failure
+ */
+static int probe_obj_eval_list(probe_t *probe, SEXP_t *id_list)
 {
-	SEXP_t *filters;
+	SEXP_t *res;
+	uint32_t i_len;
+	int ret;
+
+	i_len = SEXP_list_length(id_list);
+
+	if (i_len == 0)
+		return (0);
+
+	res = SEAP_cmd_exec(probe->SEAP_ctx, probe->sd, 0, PROBECMD_OBJ_EVAL, id_list, SEAP_CMDTYPE_SYNC, NULL, NULL);
+	ret = SEXP_list_length(res) == i_len ? 0 : -1;
+	SEXP_free(res);
+
+	return (ret);
+}
+
+/* add the id to the list unless it's already there */
+static void probe_id_list_add(SEXP_t *id_list, SEXP_t *id)
+{
+	SEXP_t *lid;
+
+	SEXP_list_foreach(lid, id_list) {
+		if (SEXP_string_cmp(lid, id) == 0) {
+			SEXP_free(lid);
+			return;
+		}
+	}
+
+	SEXP_list_add(id_list, id);
+}
+
+/*
+ * Collect the ids of the objects and of the states referenced by the set
+ * and its subsets which aren't in the probe cache.
+ */
+static void probe_set_missing(probe_t *probe, SEXP_t *set, SEXP_t *obj_ids, SEXP_t *ste_ids, size_t depth)
+{
+	SEXP_t *member, *id, *cached, *id_list;
+	char member_name[24];
+
+	if (depth > MAX_EVAL_DEPTH)
+		return;
+
+	SEXP_sublist_foreach(member, set, 2, 1000) {
+		if (probe_ent_getname_r(member, member_name, sizeof member_name) == 0)
+			continue;
+
+		if (strcmp("set", member_name) == 0) {
+			probe_set_missing(probe, member, obj_ids, ste_ids, depth + 1);
+			continue;
+		} else if (strcmp("obj_ref", member_name) == 0) {
+			id_list = obj_ids;
+		} else if (strcmp("filter", member_name) == 0) {
+			id_list = ste_ids;
+		} else {
+			continue;
+		}
+
+		if ((id = probe_ent_getval(member)) == NULL)
+			continue;
+
+		if ((cached = probe_rcache_sexp_get(probe->rcache, id)) == NULL)
+			probe_id_list_add(id_list, id);
+
+		SEXP_free(cached);
+		SEXP_free(id);
+	}
+}
+
+/*
+ * Fetch the objects and the states of the whole set with two round-trips
+ * instead of one for every object and every subset. Failures are left to
+ * be reported by the evaluation of the set.
+ */
+static void probe_set_prefetch(probe_t *probe, SEXP_t *set)
+{
+	SEXP_t *obj_ids, *ste_ids, *res;
+
+	obj_ids = SEXP_list_new(NULL);
+	ste_ids = SEXP_list_new(NULL);
+
+	probe_set_missing(probe, set, obj_ids, ste_ids, 0);
+
+	if (probe_obj_eval_list(probe, obj_ids) != 0)
+		dW("Failed to evaluate the objects of a set in one request.");
+
+	res = probe_ste_fetch(probe, ste_ids);
+	SEXP_vfree(obj_ids, ste_ids, res, NULL);
+}
+
+static probe_filter_t *probe_prepare_filters(probe_t *probe, SEXP_t *obj)
+{
+	SEXP_t *filters, *ste_ids, *fetched, *of, *ste, *ste_id;
+	probe_filter_t *filter;
 	int i;
 
 	filters = SEXP_list_new(NULL);
+	ste_ids = SEXP_list_new(NULL);
+
+	/* the states which aren't cached are fetched in one request */
+	for (i = 1; (of = probe_obj_getent(obj, "filter", i)) != NULL; ++i) {
+		if ((ste_id = probe_ent_getval(of)) != NULL) {
+			if ((ste = probe_rcache_sexp_get(probe->rcache, ste_id)) == NULL)
+				probe_id_list_add(ste_ids, ste_id);
+			SEXP_vfree(ste_id, ste, NULL);
+		}
+		SEXP_free(of);
+	}
+
+	fetched = probe_ste_fetch(probe, ste_ids);
+	SEXP_vfree(ste_ids, fetched, NULL);
 
 	for (i = 1; ; ++i) {
-		SEXP_t *of, *f, *ste, *ste_id, *act;
+		SEXP_t *f, *act;
 
 		of = probe_obj_getent(obj, "filter", i);
 
@@ -414,11 +568,73 @@ static SEXP_t *probe_prepare_filters(probe_t *probe, SEXP_t *obj)
 		SEXP_vfree(act, ste, f, NULL);
 	}
 
-	return filters;
+	/*
+	 * The items are new (and mostly distinct), the results of the
+	 * entity comparisons wouldn't be reused.
+	 */
+	filter = probe_filter_new(filters, false);
+	SEXP_free(filters);
+
+	return filter;
+}
+
+/*
+ * Set of items. The items are shared by the item cache, so equal items
+ * are the same S-exp values and the set is keyed by the value references.
+ */
+struct probe_itemset {
+	SEXP_t **items;
+	size_t   size;
+};
+
+static void probe_itemset_init(struct probe_itemset *set, size_t count)
+{
+	set->size = 16;
+	while (set->size < 2 * count)
+		set->size *= 2;
+	set->items = oscap_calloc(set->size, sizeof(SEXP_t *));
+}
+
+static void probe_itemset_free(struct probe_itemset *set)
+{
+	oscap_free(set->items);
+}
+
+static SEXP_t **probe_itemset_slot(const struct probe_itemset *set, const SEXP_t *item)
+{
+	size_t i = SEXP_refhash(item) & (set->size - 1);
+
+	while (set->items[i] != NULL && !SEXP_eq(set->items[i], item))
+		i = (i + 1) & (set->size - 1);
+
+	return &set->items[i];
+}
+
+/*
+ * The item isn't referenced by the set, it has to stay in its list
+ * while the set is used. The set isn't resized, its size has to be
+ * at least twice the number of added items.
+ * @return true if the item was added, false if it was in the set already
+ */
+static bool probe_itemset_add(struct probe_itemset *set, SEXP_t *item)
+{
+	SEXP_t **slot = probe_itemset_slot(set, item);
+
+	if (*slot != NULL)
+		return false;
+
+	*slot = item;
+	return true;
+}
+
+static bool probe_itemset_has(const struct probe_itemset *set, const SEXP_t *item)
+{
+	return *probe_itemset_slot(set, item) != NULL;
 }
 
 /**
- * Combine two collections of items using an operation.
+ * Combine two collections of items using an operation. The items of
+ * the first collection come first in the result, in their order.
  * @param cobj1 item collection
  * @param cobj2 item collection
  * @param op operation
@@ -427,9 +643,9 @@ static SEXP_t *probe_prepare_filters(probe_t *probe, SEXP_t *obj)
 static SEXP_t *probe_set_combine(SEXP_t *cobj0, SEXP_t *cobj1, oval_setobject_operation_t op)
 {
         SEXP_t *set0, *set1, *res_cobj, *cobj0_mask, *cobj1_mask, *res_mask;
-        register int cmp;
-        register SEXP_t *item0, *item1, *res;
-        register SEXP_list_it *sit0, *sit1;
+        SEXP_t *item, *res;
+        SEXP_list_it *sit;
+        struct probe_itemset seen;
 	oval_syschar_collection_flag_t res_flag;
 
 	if (cobj0 == NULL)
@@ -448,78 +664,41 @@ static SEXP_t *probe_set_combine(SEXP_t *cobj0, SEXP_t *cobj1, oval_setobject_op
                                             probe_cobj_get_flag(cobj1), op);
         res_mask = SEXP_list_join(cobj0_mask, cobj1_mask);
 
-        /* prepare iterators & first items */
-        sit0  = SEXP_list_it_new(set0);
-        sit1  = SEXP_list_it_new(set1);
-        item0 = SEXP_list_it_next(sit0);
-        item1 = SEXP_list_it_next(sit1);
-
         /* perform the set operation */
         switch(op) {
         case OVAL_SET_OPERATION_UNION:
-                while (item0 != NULL && item1 != NULL) {
-                        cmp = SEXP_refcmp(item0, item1);
-
-                        if (cmp < 0) {
-                                SEXP_list_add(res, item0);
-                                item0 = SEXP_list_it_next(sit0);
-                        } else if (cmp > 0) {
-                                SEXP_list_add(res, item1);
-                                item1 = SEXP_list_it_next(sit1);
-                        } else {
-                                SEXP_list_add(res, item0);
-                                item0 = SEXP_list_it_next(sit0);
-                                item1 = SEXP_list_it_next(sit1);
-                        }
-                }
+                probe_itemset_init(&seen, SEXP_list_length(set0) + SEXP_list_length(set1));
 
-                if (item0 != NULL) {
-                        do {
-                                SEXP_list_add(res, item0);
-                        } while((item0 = SEXP_list_it_next(sit0)) != NULL);
-                } else if (item1 != NULL) {
-                        do {
-                                SEXP_list_add(res, item1);
-                        } while((item1 = SEXP_list_it_next(sit1)) != NULL);
+                sit = SEXP_list_it_new(set0);
+                while ((item = SEXP_list_it_next(sit)) != NULL) {
+                        if (probe_itemset_add(&seen, item))
+                                SEXP_list_add(res, item);
                 }
+                SEXP_list_it_free(sit);
 
-                break;
-        case OVAL_SET_OPERATION_INTERSECTION:
-                while (item0 != NULL && item1 != NULL) {
-                        cmp = SEXP_refcmp(item0, item1);
-
-                        if (cmp < 0)
-                                item0 = SEXP_list_it_next(sit0);
-                        else if (cmp > 0)
-                                item1 = SEXP_list_it_next(sit1);
-                        else {
-                                SEXP_list_add(res, item0);
-                                item0 = SEXP_list_it_next(sit0);
-                                item1 = SEXP_list_it_next(sit1);
-                        }
+                sit = SEXP_list_it_new(set1);
+                while ((item = SEXP_list_it_next(sit)) != NULL) {
+                        if (probe_itemset_add(&seen, item))
+                                SEXP_list_add(res, item);
                 }
+                SEXP_list_it_free(sit);
 
                 break;
+        case OVAL_SET_OPERATION_INTERSECTION:
         case OVAL_SET_OPERATION_COMPLEMENT:
-                while (item0 != NULL && item1 != NULL) {
-                        cmp = SEXP_refcmp(item0, item1);
-
-                        if (cmp < 0) {
-                                SEXP_list_add(res, item0);
-                                item0 = SEXP_list_it_next(sit0);
-                        } else if (cmp > 0) {
-                                item1 = SEXP_list_it_next(sit1);
-                        } else {
-                                item0 = SEXP_list_it_next(sit0);
-                                item1 = SEXP_list_it_next(sit1);
-                        }
-                }
+                probe_itemset_init(&seen, SEXP_list_length(set1));
+
+                sit = SEXP_list_it_new(set1);
+                while ((item = SEXP_list_it_next(sit)) != NULL)
+                        probe_itemset_add(&seen, item);
+                SEXP_list_it_free(sit);
 
-                if (item0 != NULL) {
-                        do {
-                                SEXP_list_add(res, item0);
-                        } while((item0 = SEXP_list_it_next(sit0)) != NULL);
+                sit = SEXP_list_it_new(set0);
+                while ((item = SEXP_list_it_next(sit)) != NULL) {
+                        if (probe_itemset_has(&seen, item) == (op == OVAL_SET_OPERATION_INTERSECTION))
+                                SEXP_list_add(res, item);
                 }
+                SEXP_list_it_free(sit);
 
                 break;
         default:
@@ -527,8 +706,7 @@ static SEXP_t *probe_set_combine(SEXP_t *cobj0, SEXP_t *cobj1, oval_setobject_op
                 abort();
         }
 
-        SEXP_list_it_free(sit0);
-        SEXP_list_it_free(sit1);
+        probe_itemset_free(&seen);
 
 	/*
 	 * If the collected information is complete but all the items are
@@ -550,10 +728,10 @@ static SEXP_t *probe_set_combine(SEXP_t *cobj0, SEXP_t *cobj1, oval_setobject_op
 /**
  * Apply a set of filters to a collected object.
  * @param cobj item collection
- * @param filter set (list) of filters
+ * @param filter prepared filters
  * @return collection of items without items that match any of the filters in the input set
  */
-static SEXP_t *probe_set_apply_filters(SEXP_t *cobj, SEXP_t *filters)
+static SEXP_t *probe_set_apply_filters(SEXP_t *cobj, probe_filter_t *filter)
 {
 	SEXP_t *result_items, *items, *item, *mask;
 	oval_syschar_status_t item_status;
@@ -587,7 +765,7 @@ static SEXP_t *probe_set_apply_filters(SEXP_t *cobj, SEXP_t *filters)
 			break;
 		}
 
-		if (!probe_item_filtered(item, filters)) {
+		if (!probe_filter_item(filter, item)) {
 			SEXP_list_add(result_items, item);
 		}
 	}
@@ -617,6 +795,7 @@ static SEXP_t *probe_set_apply_filters(SEXP_t *cobj, SEXP_t *filters)
 static SEXP_t *probe_set_eval(probe_t *probe, SEXP_t *set, size_t depth)
 {
 	SEXP_t *filters_u, *filters_a, *filters_req;
+	probe_filter_t *filter = NULL;
 
 	SEXP_t *s_subset[2];
 	size_t s_subset_i;
@@ -818,8 +997,11 @@ static SEXP_t *probe_set_eval(probe_t *probe, SEXP_t *set, size_t depth)
 	_A((s_subset_i > 0 && o_subset_i == 0) || (s_subset_i == 0 && o_subset_i > 0));
 
 	if (o_subset_i > 0) {
+		/* the items of both objects are compared with the same states */
+		filter = probe_filter_new(filters_a, true);
+
 		for (s_subset_i = 0; s_subset_i < o_subset_i; ++s_subset_i) {
-			s_subset[s_subset_i] = probe_set_apply_filters(o_subset[s_subset_i], filters_a);
+			s_subset[s_subset_i] = probe_set_apply_filters(o_subset[s_subset_i], filter);
 
 #ifndef NDEBUG
 			if (s_subset[s_subset_i] == NULL) {
@@ -832,6 +1014,9 @@ static SEXP_t *probe_set_eval(probe_t *probe, SEXP_t *set, size_t depth)
 			SEXP_free(o_subset[s_subset_i]);
                         o_subset[s_subset_i] = NULL;
 		}
+
+		probe_filter_free(filter);
+		filter = NULL;
 	}
 
 #ifndef NDEBUG
@@ -881,6 +1066,7 @@ static SEXP_t *probe_set_eval(probe_t *probe, SEXP_t *set, size_t depth)
 	SEXP_free(filters_a);
 	SEXP_free(filters_req);
 	SEXP_free(result);
+	probe_filter_free(filter);
 
         r1 = SEXP_list_new(Omsg, NULL);
 	result = probe_cobj_new(SYSCHAR_FLAG_ERROR, r1, NULL, NULL);
@@ -888,6 +1074,93 @@ static SEXP_t *probe_set_eval(probe_t *probe, SEXP_t *set, size_t depth)
 	return result;
 }
 
+/*
+ * Set the flag of the collected object whose items were sent in chunks and
+ * note on the request that the object can't be cached.
+ */
+static void probe_worker_chunk_finish(struct probe_ctx *ctx, SEAP_msg_t *msg_in)
+{
+	if (ctx->chunk == NULL)
+		return;
+
+	probe_chunk_finish(ctx->chunk, ctx->probe_out);
+
+	if (probe_chunk_count(ctx->chunk) > 0
+	    && SEAP_msgattr_set(msg_in, "chunks-sent", NULL) != 0)
+		dW("Can't mark the request as chunked.");
+
+	probe_chunk_free(ctx->chunk);
+	ctx->chunk = NULL;
+}
+
+/*
+ * Store the name of the spill file in the collected object. The object is
+ * incomplete if the items couldn't be spilled.
+ */
+static void probe_worker_spill_finish(struct probe_ctx *ctx)
+{
+	if (ctx->spill == NULL)
+		return;
+
+	if (probe_spill_finish(ctx->spill, ctx->probe_out) != 0
+	    && probe_cobj_get_flag(ctx->probe_out) != SYSCHAR_FLAG_INCOMPLETE) {
+		SEXP_t *msg;
+
+		msg = probe_msg_creat(OVAL_MESSAGE_LEVEL_WARNING,
+				      "Object is incomplete, the items over the memory limits couldn't be stored.");
+		probe_cobj_add_msg(ctx->probe_out, msg);
+		probe_cobj_set_flag(ctx->probe_out, SYSCHAR_FLAG_INCOMPLETE);
+		SEXP_free(msg);
+	}
+
+	probe_spill_free(ctx->spill);
+	ctx->spill = NULL;
+}
+
+/*
+ * Flag the collected object as incomplete if the probe stopped the
+ * collection at the deadline of the request.
+ */
+static void probe_worker_deadline_finish(SEXP_t *cobj, uint32_t timeout)
+{
+	SEXP_t *msg;
+
+	if (!probe_deadline_detach())
+		return;
+
+	if (probe_cobj_get_flag(cobj) == SYSCHAR_FLAG_ERROR)
+		return;
+
+	msg = probe_msg_creatf(OVAL_MESSAGE_LEVEL_WARNING,
+			       "Object is incomplete, its collection was stopped after %u seconds.", timeout);
+	probe_cobj_add_msg(cobj, msg);
+	probe_cobj_set_flag(cobj, SYSCHAR_FLAG_INCOMPLETE);
+	SEXP_free(msg);
+}
+
+/*
+ * Run the main function of the probe with the entities of its input object
+ * indexed for probe_obj_getent. With `async' the thread can be canceled at
+ * any point of the main function, to prevent the code in it to defer the
+ * cancelation for too long.
+ */
+static int probe_worker_main(probe_t *probe, struct probe_ctx *pctx, bool async)
+{
+	int ret, oldstate;
+
+	probe_obj_index_attach(pctx->probe_in);
+
+	if (async)
+		pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldstate);
+	ret = probe_main(pctx, probe->probe_arg);
+	if (async)
+		pthread_setcanceltype(PTHREAD_CANCEL_DEFERRED, &oldstate);
+
+	probe_obj_index_detach();
+
+	return (ret);
+}
+
 /**
  * Worker thread function. This functions handles the evalution of objects and sets.
  * @param msg_in SEAP message with the request which contains the object to be evaluated
@@ -895,7 +1168,8 @@ static SEXP_t *probe_set_eval(probe_t *probe, SEXP_t *set, size_t depth)
  */
 SEXP_t *probe_worker(probe_t *probe, SEAP_msg_t *msg_in, int *ret)
 {
-	SEXP_t *probe_in, *probe_out, *set;
+	SEXP_t *probe_in, *probe_out, *set, *s_timeout;
+	uint32_t timeout;
 
 	if (msg_in == NULL) {
 		*ret = PROBE_EINVAL;
@@ -912,8 +1186,16 @@ SEXP_t *probe_worker(probe_t *probe, SEAP_msg_t *msg_in, int *ret)
 
 	set = probe_obj_getent(probe_in, "set", 1);
 
+	/* seconds the object may be collected for, see OSCAP_PROBE_TIMEOUT */
+	timeout = 0;
+	if ((s_timeout = SEAP_msgattr_get(msg_in, "timeout")) != NULL) {
+		timeout = SEXP_number_getu_32(s_timeout);
+		SEXP_free(s_timeout);
+	}
+
 	if (set != NULL) {
 		/* set object */
+		probe_set_prefetch(probe, set);
 		probe_out = probe_set_eval(probe, set, 0);
 		SEXP_free(set);
 		// todo: in case of an internal error set probe_ret accordingly
@@ -923,8 +1205,15 @@ SEXP_t *probe_worker(probe_t *probe, SEAP_msg_t *msg_in, int *ret)
 		SEXP_t *varrefs, *mask;
 
 		/* simple object */
+		probe_deadline_attach(timeout);
                 pctx.icache  = probe->icache;
 		pctx.filters = probe_prepare_filters(probe, probe_in);
+		/*
+		 * Results of no-reply requests are the members of set objects,
+		 * they are read from the result cache and can't be spilled.
+		 */
+		pctx.spill   = NULL;
+		pctx.chunk   = NULL;
                 mask = probe_obj_getmask(probe_in);
 
 		if (OSCAP_GSYM(varref_handling))
@@ -941,23 +1230,23 @@ SEXP_t *probe_worker(probe_t *probe, SEAP_msg_t *msg_in, int *ret)
 			
                         pctx.probe_in  = probe_in;
                         pctx.probe_out = probe_out;
+			pctx.chunk = probe_chunk_new(probe->SEAP_ctx, probe->sd, msg_in);
+			if (pctx.chunk == NULL && !SEAP_msgattr_exists(msg_in, "no-reply"))
+				pctx.spill = probe_spill_new();
 
                         /*
-                         * Run the main function of the probe implementation. Set thread
-			 * cancelation type to ASYNC to prevent the code in probe_main to
-			 * defer the cancelation for too long.
+                         * Run the main function of the probe implementation
                          */
-			int __unused_oldstate;
-			pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &__unused_oldstate);
-			*ret = probe_main(&pctx, probe->probe_arg);
-			pthread_setcanceltype(PTHREAD_CANCEL_DEFERRED, &__unused_oldstate);
+			*ret = probe_worker_main(probe, &pctx, true);
 
                         /*
                          * Synchronize
                          */
                         probe_icache_nop(probe->icache);
 
+			probe_worker_chunk_finish(&pctx, msg_in);
 			probe_cobj_compute_flag(probe_out);
+			probe_worker_spill_finish(&pctx);
 		} else {
 			/*
 			 * there are variable references in the object.
@@ -967,45 +1256,70 @@ SEXP_t *probe_worker(probe_t *probe, SEAP_msg_t *msg_in, int *ret)
 
 			dD("handling varrefs in object");
 
-			if (probe_varref_create_ctx(probe_in, varrefs, &ctx) != 0) {
-				SEXP_vfree(varrefs, pctx.filters, probe_in, mask, NULL);
+			if (probe_varref_create_ctx(probe_in, varrefs, OSCAP_GSYM(varref_vector), &ctx) != 0) {
+				SEXP_vfree(varrefs, probe_in, mask, NULL);
+				probe_filter_free(pctx.filters);
+				probe_deadline_detach();
 				*ret = PROBE_EUNKNOWN;
 				return (NULL);
 			}
 
 			SEXP_free(varrefs);
 
-			do {
-				SEXP_t *cobj, *r0;
-                                /*
-                                 * Prepare the collected object
-                                 */
-				cobj = probe_cobj_new(SYSCHAR_FLAG_UNKNOWN, NULL, NULL, mask);
-
-                                pctx.probe_in  = ctx->pi2;
-                                pctx.probe_out = cobj;
-                                /*
-                                 * Run the main function of the probe implementation
-                                 */
-				*ret = probe_main(&pctx, probe->probe_arg);
-
-                                /*
-                                 * Synchronize
-                                 */
-                                probe_icache_nop(probe->icache);
-
-				probe_cobj_compute_flag(cobj);
-				r0 = probe_out;
-				probe_out = probe_set_combine(r0, cobj, OVAL_SET_OPERATION_UNION);
-				SEXP_vfree(cobj, r0, NULL);
-			} while (*ret == 0
-				 && probe_varref_iterate_ctx(ctx));
+			if (OSCAP_GSYM(varref_vector)) {
+				/*
+				 * The probe collects the items for all the values
+				 * of the variables in one run.
+				 */
+				probe_out = probe_cobj_new(SYSCHAR_FLAG_UNKNOWN, NULL, NULL, mask);
+
+				pctx.probe_in  = ctx->pi2;
+				pctx.probe_out = probe_out;
+				pctx.chunk = probe_chunk_new(probe->SEAP_ctx, probe->sd, msg_in);
+				if (pctx.chunk == NULL && !SEAP_msgattr_exists(msg_in, "no-reply"))
+					pctx.spill = probe_spill_new();
+
+				*ret = probe_worker_main(probe, &pctx, false);
+				probe_icache_nop(probe->icache);
+
+				probe_worker_chunk_finish(&pctx, msg_in);
+				probe_cobj_compute_flag(probe_out);
+				probe_worker_spill_finish(&pctx);
+			} else {
+				do {
+					SEXP_t *cobj, *r0;
+					/*
+					 * Prepare the collected object
+					 */
+					cobj = probe_cobj_new(SYSCHAR_FLAG_UNKNOWN, NULL, NULL, mask);
+
+					pctx.probe_in  = ctx->pi2;
+					pctx.probe_out = cobj;
+					/*
+					 * Run the main function of the probe implementation
+					 */
+					*ret = probe_worker_main(probe, &pctx, false);
+
+					/*
+					 * Synchronize
+					 */
+					probe_icache_nop(probe->icache);
+
+					probe_cobj_compute_flag(cobj);
+					r0 = probe_out;
+					probe_out = probe_set_combine(r0, cobj, OVAL_SET_OPERATION_UNION);
+					SEXP_vfree(cobj, r0, NULL);
+				} while (*ret == 0
+					 && !probe_ctx_expired(&pctx)
+					 && probe_varref_iterate_ctx(ctx));
+			}
 
 			SEXP_free(mask);
 			probe_varref_destroy_ctx(ctx);
 		}
 
-                SEXP_free(pctx.filters);
+		probe_worker_deadline_finish(probe_out, timeout);
+                probe_filter_free(pctx.filters);
 	}
 
 	SEXP_free(probe_in);
@@ -0,0 +1,291 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "common/alloc.h"
+#include "common/debug_priv.h"
+#include "wpool.h"
+
+/*
+ * The worker pool replaces the thread-per-request model of the input
+ * handler. Every thread has its own condition variable and job slot, so
+ * the input handler knows the thread ID before the job is published in
+ * the probe->workers tree and the signal handler can cancel and join the
+ * thread exactly as it did with the per-request threads.
+ */
+
+probe_wpool_t *probe_wpool_new(uint32_t size)
+{
+        probe_wpool_t *pool;
+
+        if (size == 0) {
+                long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+
+                size = ncpu > 0 ? (uint32_t)ncpu : 1;
+        }
+
+        if (size > PROBE_WORKER_DEFAULT_MAX_THREADS)
+                size = PROBE_WORKER_DEFAULT_MAX_THREADS;
+
+        pool = oscap_talloc(probe_wpool_t);
+
+        if (pthread_mutex_init(&pool->lock, NULL) != 0) {
+                oscap_free(pool);
+                return (NULL);
+        }
+
+        pool->idle     = NULL;
+        pool->size     = size;
+        pool->nthreads = 0;
+        pool->ntransient = 0;
+        pool->shutdown = false;
+
+        dD("worker pool size: %u", size);
+
+        return (pool);
+}
+
+static void probe_wthread_destroy(probe_wthread_t *th)
+{
+        pthread_cond_destroy(&th->cond);
+        oscap_free(th);
+}
+
+/* cancellation cleanup; called with th->pool->lock held */
+static void probe_wthread_cancel_locked(void *arg)
+{
+        probe_wthread_t *th = (probe_wthread_t *)arg;
+        probe_wpool_t   *pool = th->pool;
+        probe_wthread_t **pp;
+
+        /*
+         * A cancellation request may be acted upon while the thread
+         * waits in the idle list for the next job.
+         */
+        for (pp = &pool->idle; *pp != NULL; pp = &(*pp)->next) {
+                if (*pp == th) {
+                        *pp = th->next;
+                        break;
+                }
+        }
+
+        if (th->transient)
+                --pool->ntransient;
+        else
+                --pool->nthreads;
+
+        pthread_mutex_unlock(&pool->lock);
+        probe_wthread_destroy(th);
+}
+
+/* cancellation cleanup; called while running a job */
+static void probe_wthread_cancel(void *arg)
+{
+        probe_wthread_t *th = (probe_wthread_t *)arg;
+
+        pthread_mutex_lock(&th->pool->lock);
+        probe_wthread_cancel_locked(th);
+}
+
+static void *probe_wthread_main(void *arg)
+{
+        probe_wthread_t *th   = (probe_wthread_t *)arg;
+        probe_wpool_t   *pool = th->pool;
+        probe_pwpair_t  *pair;
+        bool detach = false;
+
+#if defined(HAVE_PTHREAD_SETNAME_NP)
+        pthread_setname_np(pthread_self(), "probe_worker");
+#endif
+        for (;;) {
+                pthread_mutex_lock(&pool->lock);
+                pthread_cleanup_push(probe_wthread_cancel_locked, th);
+
+                while (th->job == NULL && !th->quit && !pool->shutdown)
+                        pthread_cond_wait(&th->cond, &pool->lock);
+
+                pthread_cleanup_pop(0);
+
+                if ((pair = th->job) == NULL) {
+                        /* released reservation or pool shutdown */
+                        detach = th->transient;
+                        break;
+                }
+
+                pthread_mutex_unlock(&pool->lock);
+
+                pthread_cleanup_push(probe_wthread_cancel, th);
+                probe_worker_runfn(pair);
+                pthread_cleanup_pop(0);
+
+                pthread_mutex_lock(&pool->lock);
+                th->job = NULL;
+
+                if (th->transient || pool->shutdown) {
+                        detach = true;
+                        break;
+                }
+
+                th->next   = pool->idle;
+                pool->idle = th;
+
+                pthread_mutex_unlock(&pool->lock);
+        }
+
+        if (th->transient)
+                --pool->ntransient;
+        else
+                --pool->nthreads;
+
+        pthread_mutex_unlock(&pool->lock);
+        probe_wthread_destroy(th);
+
+        if (detach)
+                pthread_detach(pthread_self());
+
+        return (NULL);
+}
+
+probe_wthread_t *probe_wpool_reserve(probe_wpool_t *pool)
+{
+        probe_wthread_t *th;
+
+        pthread_mutex_lock(&pool->lock);
+
+        if (pool->shutdown) {
+                pthread_mutex_unlock(&pool->lock);
+                return (NULL);
+        }
+
+        if (pool->idle != NULL) {
+                th = pool->idle;
+                pool->idle = th->next;
+                th->next = NULL;
+
+                pthread_mutex_unlock(&pool->lock);
+                return (th);
+        }
+
+        th = oscap_talloc(probe_wthread_t);
+        th->job  = NULL;
+        th->quit = false;
+        th->pool = pool;
+        th->next = NULL;
+        th->transient = pool->nthreads >= pool->size;
+
+        if (pthread_cond_init(&th->cond, NULL) != 0) {
+                pthread_mutex_unlock(&pool->lock);
+                oscap_free(th);
+                return (NULL);
+        }
+
+        if ((errno = pthread_create(&th->tid, NULL, &probe_wthread_main, th)) != 0) {
+                dE("Cannot start a new worker thread: %d, %s.", errno, strerror(errno));
+                pthread_mutex_unlock(&pool->lock);
+                probe_wthread_destroy(th);
+                return (NULL);
+        }
+
+        if (th->transient) {
+                dD("worker pool exhausted (%u threads), starting a transient thread", pool->nthreads);
+                ++pool->ntransient;
+        } else
+                ++pool->nthreads;
+
+        pthread_mutex_unlock(&pool->lock);
+
+        return (th);
+}
+
+void probe_wpool_submit(probe_wthread_t *th, probe_pwpair_t *job)
+{
+        pthread_mutex_lock(&th->pool->lock);
+        th->job = job;
+        pthread_cond_signal(&th->cond);
+        pthread_mutex_unlock(&th->pool->lock);
+}
+
+void probe_wpool_release(probe_wthread_t *th)
+{
+        probe_wpool_t *pool = th->pool;
+
+        pthread_mutex_lock(&pool->lock);
+
+        if (th->transient) {
+                th->quit = true;
+                pthread_cond_signal(&th->cond);
+        } else {
+                th->next   = pool->idle;
+                pool->idle = th;
+        }
+
+        pthread_mutex_unlock(&pool->lock);
+}
+
+void probe_wpool_free(probe_wpool_t *pool)
+{
+        probe_wthread_t *th;
+        pthread_t *tids;
+        uint32_t i, n;
+
+        if (pool == NULL)
+                return;
+
+        pthread_mutex_lock(&pool->lock);
+
+        pool->shutdown = true;
+        tids = oscap_alloc(sizeof(pthread_t) * (pool->nthreads + 1));
+        n    = 0;
+
+        for (th = pool->idle; th != NULL; th = th->next) {
+                tids[n++] = th->tid;
+                pthread_cond_signal(&th->cond);
+        }
+
+        pool->idle = NULL;
+        pthread_mutex_unlock(&pool->lock);
+
+        for (i = 0; i < n; ++i) {
+                if ((errno = pthread_join(tids[i], NULL)) != 0)
+                        dE("pthread_join: %d, %s.", errno, strerror(errno));
+        }
+
+        oscap_free(tids);
+
+        pthread_mutex_lock(&pool->lock);
+        n = pool->nthreads + pool->ntransient;
+        pthread_mutex_unlock(&pool->lock);
+
+        if (n > 0) {
+                /* busy threads still reference the pool */
+                dW("%u worker thread(s) still running, leaking the worker pool", n);
+                return;
+        }
+
+        pthread_mutex_destroy(&pool->lock);
+        oscap_free(pool);
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef WPOOL_H
+#define WPOOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "worker.h"
+
+typedef struct probe_wpool probe_wpool_t;
+
+/**
+ * A worker thread owned by the pool. A thread is either idle (linked
+ * in the pool's idle list), reserved for a job that is about to be
+ * submitted, or busy running a job.
+ */
+typedef struct probe_wthread {
+        pthread_t             tid;
+        pthread_cond_t        cond;      /**< signaled when a job is submitted */
+        probe_pwpair_t       *job;       /**< job to run, NULL if none */
+        bool                  transient; /**< exit after the job instead of going idle */
+        bool                  quit;      /**< reservation released, exit */
+        probe_wpool_t        *pool;
+        struct probe_wthread *next;      /**< idle list link */
+} probe_wthread_t;
+
+struct probe_wpool {
+        pthread_mutex_t  lock;
+        probe_wthread_t *idle;     /**< stack of idle threads, most recently used first */
+        uint32_t         size;     /**< maximal number of persistent threads */
+        uint32_t         nthreads; /**< number of persistent threads alive */
+        uint32_t         ntransient; /**< number of transient threads alive */
+        bool             shutdown;
+};
+
+/**
+ * Create a new worker pool.
+ * @param size maximal number of threads kept alive by the pool; if 0,
+ *             the number of online CPUs is used
+ */
+probe_wpool_t *probe_wpool_new(uint32_t size);
+
+/**
+ * Reserve a thread for running a job. An idle thread is reused if there
+ * is one. Otherwise a new thread is started; if the pool is already full,
+ * the new thread is transient and exits after running its job, so that
+ * nested (set) evaluations can never starve the pool. The thread ID of the
+ * returned thread is valid and may be published (e.g. in probe->workers)
+ * before the job is submitted.
+ * @return reserved thread or NULL on failure
+ */
+probe_wthread_t *probe_wpool_reserve(probe_wpool_t *pool);
+
+/**
+ * Run `job' in a thread returned by probe_wpool_reserve().
+ */
+void probe_wpool_submit(probe_wthread_t *th, probe_pwpair_t *job);
+
+/**
+ * Return a reserved thread which won't be used to the pool.
+ */
+void probe_wpool_release(probe_wthread_t *th);
+
+/**
+ * Stop and join all idle threads and free the pool. Threads which are
+ * still busy (e.g. because their cancellation timed out) are left alone
+ * and the pool memory is leaked in that case.
+ */
+void probe_wpool_free(probe_wpool_t *pool);
+
+#endif /* WPOOL_H */
@@ -0,0 +1,194 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <seap.h>
+
+#include "common/debug_priv.h"
+#include "../SEAP/seap-descriptor.h"
+#include "../SEAP/sch_shm.h"
+#include "zygote.h"
+
+/*
+ * The zygote is a probe executable that stopped before the probe
+ * initialization: it's loaded and linked, and it forks a probe for every
+ * socket the library sends it over the control socket. The fork is much
+ * cheaper than the exec of the probe. No thread runs at the time of the
+ * fork; the probe starts its threads itself.
+ */
+
+static void *zygote_dummy_routine(void *arg)
+{
+	return (NULL);
+}
+
+/* load the libraries of pthread_cancel once, for all the probes */
+static void zygote_preload(void)
+{
+	pthread_t t;
+
+	if (pthread_create(&t, NULL, zygote_dummy_routine, NULL) == 0) {
+		pthread_cancel(t);
+		pthread_join(t, NULL);
+	}
+}
+
+/*
+ * The zygote outlives the connections of the library it inherited the
+ * descriptors of; holding them would keep the sockets of the other
+ * probes open.
+ */
+static void zygote_close_fds(void)
+{
+	DIR *dir;
+	struct dirent *ent;
+	long fd, max;
+
+	if ((dir = opendir("/proc/self/fd")) != NULL) {
+		while ((ent = readdir(dir)) != NULL) {
+			fd = strtol(ent->d_name, NULL, 10);
+
+			if (fd > STDERR_FILENO && fd != dirfd(dir))
+				close((int)fd);
+		}
+		closedir(dir);
+		return;
+	}
+
+	max = sysconf(_SC_OPEN_MAX);
+
+	if (max < 0 || max > 65536)
+		max = 65536;
+
+	for (fd = STDERR_FILENO + 1; fd < max; ++fd)
+		close((int)fd);
+}
+
+/*
+ * Receive the socket of the next probe and the other descriptors of its
+ * connection, returns their number, -1 when the library is gone.
+ */
+static int zygote_recv_fds(int ctl, int fds[PROBE_ZYGOTE_MAXFDS])
+{
+	struct msghdr   msg;
+	struct iovec    iov;
+	struct cmsghdr *cmsg;
+	union {
+		struct cmsghdr h;
+		char buf[CMSG_SPACE(sizeof(int) * PROBE_ZYGOTE_MAXFDS)];
+	} cbuf;
+	char    c;
+	ssize_t ret;
+	int     nfds = 0;
+
+	memset(&msg, 0, sizeof msg);
+	iov.iov_base = &c;
+	iov.iov_len  = 1;
+	msg.msg_iov  = &iov;
+	msg.msg_iovlen     = 1;
+	msg.msg_control    = cbuf.buf;
+	msg.msg_controllen = sizeof cbuf.buf;
+
+	do {
+		ret = recvmsg(ctl, &msg, 0);
+	} while (ret < 0 && errno == EINTR);
+
+	if (ret <= 0)
+		return (-1);
+
+	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+		if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+			nfds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+			memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * nfds);
+		}
+	}
+
+	return (nfds);
+}
+
+/* the descriptors of the shm scheme, see sch_shm_openfd() */
+static int zygote_shm_setenv(const int *fds, int nfds)
+{
+	char env[128];
+
+	if (nfds != 1 + SCH_SHM_EVCOUNT)
+		return (-1);
+
+	snprintf(env, sizeof env, "%d:%d:%d:%d:%d", fds[0], fds[1], fds[2], fds[3], fds[4]);
+
+	return setenv(SCH_SHM_ENV, env, 1);
+}
+
+void probe_zygote(void)
+{
+	const int ctl = STDIN_FILENO;
+	int32_t reply;
+	pid_t pid;
+	int   fds[PROBE_ZYGOTE_MAXFDS];
+	int   nfds, i;
+
+	zygote_close_fds();
+	zygote_preload();
+
+	/* the probes are reaped by the kernel, they aren't waited for */
+	signal(SIGCHLD, SIG_IGN);
+
+	while ((nfds = zygote_recv_fds(ctl, fds)) >= 0) {
+		if (nfds == 0) {
+			reply = -EBADF;
+		} else if ((pid = fork()) == 0) {
+			signal(SIGCHLD, SIG_DFL);
+
+			/* replaces the control socket */
+			if (dup2(fds[0], STDIN_FILENO) != STDIN_FILENO)
+				_exit(errno);
+			if (dup2(fds[0], STDOUT_FILENO) != STDOUT_FILENO)
+				_exit(errno);
+			close(fds[0]);
+
+			if (nfds > 1 && zygote_shm_setenv(fds + 1, nfds - 1) != 0)
+				_exit(EINVAL);
+			return;
+		} else {
+			reply = pid < 0 ? -errno : (int32_t)pid;
+		}
+
+		for (i = 0; i < nfds; ++i)
+			close(fds[i]);
+
+		if (send(ctl, &reply, sizeof reply, MSG_NOSIGNAL) != sizeof reply)
+			break;
+	}
+
+	exit(0);
+}
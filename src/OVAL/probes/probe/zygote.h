@@ -0,0 +1,35 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef ZYGOTE_H
+#define ZYGOTE_H
+
+/* the argument the library starts a probe executable as a zygote with */
+#define PROBE_ZYGOTE_ARG "--zygote"
+/* the socket of the probe and the descriptors of the shm scheme */
+#define PROBE_ZYGOTE_MAXFDS 6
+
+/**
+ * Serve as the zygote of the probe executable. Returns only in a forked
+ * probe, whose standard input and output are connected to the library.
+ * The zygote itself exits when the library closes the control socket,
+ * the standard input of the zygote.
+ */
+void probe_zygote(void);
+
+#endif /* ZYGOTE_H */
@@ -32,6 +32,7 @@
 #ifndef FSDEV_H
 #define FSDEV_H
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <sys/stat.h>
@@ -40,13 +41,19 @@
  * Filesystem device structure.
  */
 typedef struct {
-	dev_t *ids;   /**< Sorted array of device ids   */
+	dev_t *ids;   /**< Array of device ids          */
 	uint16_t cnt; /**< Number of items in the array */
+	dev_t *tab;   /**< Open addressing table of the ids, 0 marks free slots */
+	size_t mask;  /**< Size of the table minus one  */
+	bool zero;    /**< Whether the id 0 is in the array */
+	int refs;
 } fsdev_t;
 
 /**
  * Initialize the fsdev_t structure from an array of filesystem
- * names.
+ * names. The structure of the local filesystems (fs == NULL) is a
+ * snapshot of the mount table shared by the callers and taken again
+ * only when the mount table changes.
  */
 fsdev_t *fsdev_init(const char **fs, size_t fs_cnt);
 
@@ -276,7 +276,24 @@ size_t probe_obj_getname_r(const SEXP_t * obj, char *buffer, size_t buflen);
  */
 
 SEXP_t *probe_cobj_new(oval_syschar_collection_flag_t flag, SEXP_t *msg_list, SEXP_t *item_list, SEXP_t *mask_list);
+/**
+ * Add a message to a collected object. A message the object has already
+ * is not added again and only the first hundred messages are kept, the
+ * drop of the further ones is noted by one more message.
+ * @param cobj the collected object
+ * @param msg the message, see probe_msg_creat
+ */
 int probe_cobj_add_msg(SEXP_t *cobj, const SEXP_t *msg);
+/**
+ * Format a message and add it to a collected object like probe_cobj_add_msg.
+ * The message is not formatted if the object has dropped messages already,
+ * so it's cheap to report an error of every file of a walk.
+ * @param cobj the collected object
+ * @param level the level of the message
+ * @param fmt printf-like format string that produces the text of the message
+ * @param ... arguments for the format
+ */
+int probe_cobj_add_msgf(SEXP_t *cobj, oval_message_level_t level, const char *fmt, ...) __attribute__((format(printf, 3, 4), nonnull(3)));
 SEXP_t *probe_cobj_get_msgs(const SEXP_t *cobj);
 SEXP_t *probe_cobj_get_mask(const SEXP_t *cobj);
 int probe_cobj_add_item(SEXP_t *cobj, const SEXP_t *item);
@@ -287,6 +304,9 @@ oval_syschar_collection_flag_t probe_cobj_combine_flags(oval_syschar_collection_
 							oval_syschar_collection_flag_t f2,
 							oval_setobject_operation_t op);
 oval_syschar_collection_flag_t probe_cobj_compute_flag(SEXP_t *cobj);
+/* name of the file with the items spilled by the probe, see probe/spill.h */
+int probe_cobj_set_spill(SEXP_t *cobj, const char *name);
+char *probe_cobj_get_spill(const SEXP_t *cobj);
 
 /*
  * messages
@@ -465,8 +485,8 @@ void probe_tfc54behaviors_canonicalize(SEXP_t **behaviors);
 #define PROBE_EUNKNOWN 255	/**< Unknown/Unexpected error */
 
 #define PROBECMD_STE_FETCH 1 /**< State fetch command code */
-#define PROBECMD_OBJ_EVAL  2 /**< Object eval command code */
-#define PROBECMD_RESET     3 /**< Reset command code */
+#define PROBECMD_OBJ_EVAL  2 /**< Object eval command code, takes an id or a list of ids */
+#define PROBECMD_RESET     3 /**< Reset command code, takes the namespace of a session or nothing */
 
 
 void probe_offline_mode(void);
@@ -506,6 +526,29 @@ SEXP_t *probe_ctx_getobject(probe_ctx *ctx);
  */
 SEXP_t *probe_ctx_getresult(probe_ctx *ctx);
 
+/**
+ * Get the values of an entity of the input object. An entity which
+ * refers to a variable has all the values of the variable if the probe
+ * has set the PROBEOPT_VARREF_VECTOR option, otherwise just the value
+ * of the currently evaluated combination of variable values. This way
+ * the probe can collect the items for all the values in one run.
+ * @param ctx probe context
+ * @param name name of the entity
+ * @param res the list of values (may be NULL)
+ * @return the number of values or -1 if the entity doesn't exist
+ */
+int probe_ctx_getentvals(probe_ctx *ctx, const char *name, SEXP_t **res);
+
+/**
+ * Check whether the deadline of the collection of the object passed
+ * (OSCAP_PROBE_TIMEOUT). The probes check it in the loops which may run
+ * for long without collecting items, probe_item_collect checks it for
+ * every item. Once it returns true, the probe should stop and return; the
+ * collected object is then flagged as incomplete.
+ * @param ctx probe context
+ */
+bool probe_ctx_expired(probe_ctx *ctx);
+
 typedef struct {
         oval_datatype_t type;
         void           *value;
@@ -513,6 +556,32 @@ typedef struct {
 
 SEXP_t *probe_item_create(oval_subtype_t item_subtype, probe_elmatr_t *item_attributes[], ...);
 
+/**
+ * Compiled item template. A probe which creates many items of one subtype
+ * compiles the names and the datatypes of their entities once and then only
+ * passes the values. The template is immutable and may be shared by the
+ * worker threads.
+ */
+typedef struct probe_itemtpl probe_itemtpl_t;
+
+/**
+ * Compile an item template.
+ * @param item_subtype the subtype of the items
+ * @param ... NULL terminated list of entity name and oval_datatype_t pairs,
+ * in the order in which probe_itemtpl_item takes the values
+ */
+probe_itemtpl_t *probe_itemtpl_new(oval_subtype_t item_subtype, ...);
+void probe_itemtpl_free(probe_itemtpl_t *tpl);
+
+/**
+ * Create an item from a template.
+ * @param tpl the template
+ * @param ... one value per entity of the template, the values are passed
+ * the same way as to probe_item_create, e.g. a NULL string or S-exp skips
+ * the entity
+ */
+SEXP_t *probe_itemtpl_item(const probe_itemtpl_t *tpl, ...);
+
 #define PROBE_ENT_AREF(ent, dst, attr_name, invalid_exp)		\
 	do {								\
 		if (((dst) = probe_ent_getattrval(ent, attr_name)) == NULL) { \
@@ -581,4 +650,14 @@ oval_schema_version_t probe_obj_get_platform_schema_version(const SEXP_t *obj);
  */
 SEXP_t *probe_obj_getmask(SEXP_t *obj);
 
+/**
+ * Check whether an entity of the items of the object is read by the content.
+ * If not, the probe may skip its lookup and report it as not collected.
+ * @param obj the queried object
+ * @param name the name of the item entity
+ * @returns true unless the object lists the entities which are read
+ * (OSCAP_PROBE_PROJECTION) and the entity isn't one of them
+ */
+bool probe_obj_entity_wanted(const SEXP_t *obj, const char *name);
+
 /// @}
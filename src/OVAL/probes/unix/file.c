@@ -39,6 +39,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <fcntl.h>
 #include <pthread.h>
 #include <errno.h>
 #include <limits.h>
@@ -90,6 +92,7 @@ static SEXP_t *gr_true   = NULL, *gr_false  = NULL, *gr_t_reg  = NULL;
 static SEXP_t *gr_t_dir  = NULL, *gr_t_lnk  = NULL, *gr_t_blk  = NULL;
 static SEXP_t *gr_t_fifo = NULL, *gr_t_sock = NULL, *gr_t_char = NULL;
 static SEXP_t  gr_lastpath;
+static probe_itemtpl_t *g_item_tpl = NULL;
 #if defined(OS_SOLARIS)
 static SEXP_t *gr_t_door = NULL, *gr_t_port = NULL;
 #endif
@@ -118,6 +121,7 @@ static SEXP_t *se_filetype (mode_t mode)
 struct cbargs {
         probe_ctx *ctx;
 	int     error;
+	bool    acl;  /* has_extended_acl is read by the content */
 };
 
 static rbt_t   *g_ID_cache     = NULL;
@@ -267,7 +271,55 @@ static SEXP_t *has_extended_acl(const char *path)
 #endif
 }
 
-static int file_cb (const char *p, const char *f, void *ptr)
+#if defined(HAVE_STATX) && defined(STATX_BASIC_STATS)
+/* attributes used by file_cb() */
+#define FILE_STATX_MASK (STATX_TYPE | STATX_MODE | STATX_UID | STATX_GID | \
+			 STATX_ATIME | STATX_CTIME | STATX_MTIME | STATX_SIZE)
+
+/*
+ * lstat() replacement which asks only for the attributes reported in the
+ * item, so that filesystems which have to fetch the rest separately (e.g.
+ * network ones) don't do so needlessly.
+ */
+static int file_lstat(const char *path, struct stat *st)
+{
+	struct statx stx;
+
+	if (statx(AT_FDCWD, path, AT_SYMLINK_NOFOLLOW, FILE_STATX_MASK, &stx) != 0) {
+		if (errno == ENOSYS)
+			return lstat(path, st);
+		return (-1);
+	}
+
+	if ((stx.stx_mask & FILE_STATX_MASK) != FILE_STATX_MASK)
+		return lstat(path, st);
+
+	memset(st, 0, sizeof(*st));
+	st->st_dev   = makedev(stx.stx_dev_major, stx.stx_dev_minor);
+	st->st_ino   = stx.stx_ino;
+	st->st_mode  = stx.stx_mode;
+	st->st_nlink = stx.stx_nlink;
+	st->st_uid   = stx.stx_uid;
+	st->st_gid   = stx.stx_gid;
+	st->st_size  = stx.stx_size;
+	st->st_atim.tv_sec  = stx.stx_atime.tv_sec;
+	st->st_atim.tv_nsec = stx.stx_atime.tv_nsec;
+	st->st_ctim.tv_sec  = stx.stx_ctime.tv_sec;
+	st->st_ctim.tv_nsec = stx.stx_ctime.tv_nsec;
+	st->st_mtim.tv_sec  = stx.stx_mtime.tv_sec;
+	st->st_mtim.tv_nsec = stx.stx_mtime.tv_nsec;
+
+	return (0);
+}
+#else
+# define file_lstat lstat
+#endif
+
+/*
+ * The stat data are taken from `cached' if it's not NULL, i.e. if the
+ * directory walk already lstat'ed the file.
+ */
+static int file_cb (const char *p, const char *f, const struct stat *cached, void *ptr)
 {
         char path_buffer[PATH_MAX];
         SEXP_t *item;
@@ -282,13 +334,17 @@ static int file_cb (const char *p, const char *f, void *ptr)
 		st_path = path_buffer;
 	}
 
-        if (lstat (st_path, &st) == -1) {
+	if (cached != NULL)
+		memcpy(&st, cached, sizeof st);
+
+        if (cached == NULL && file_lstat (st_path, &st) == -1) {
                 dI("lstat failed when processing %s: errno=%u, %s.", st_path, errno, strerror (errno));
 		return strncmp(st_path, "/proc", 4) == 0 ? 0 : -1;
         } else {
                 SEXP_t *se_usr_id, *se_grp_id;
                 SEXP_t  se_atime_mem, se_ctime_mem, se_mtime_mem, se_size_mem;
 		SEXP_t *se_filepath, *se_acl;
+		oval_syschar_status_t acl_status = SYSCHAR_STATUS_DOES_NOT_EXIST;
 
 		if (oval_schema_version_cmp(over, OVAL_SCHEMA_VERSION(5.6)) < 0
 		    || f == NULL) {
@@ -310,38 +366,40 @@ static int file_cb (const char *p, const char *f, void *ptr)
 
 		if (oval_schema_version_cmp(over, OVAL_SCHEMA_VERSION(5.7)) < 0) {
 			se_acl = NULL;
+		} else if (!args->acl) {
+			se_acl = NULL;
+			acl_status = SYSCHAR_STATUS_NOT_COLLECTED;
 		} else {
 			se_acl = has_extended_acl(st_path);
 		}
 
-                item = probe_item_create(OVAL_UNIX_FILE, NULL,
-                                         "filepath", OVAL_DATATYPE_SEXP, se_filepath,
-                                         "path",     OVAL_DATATYPE_SEXP,  &gr_lastpath,
-                                         "filename", OVAL_DATATYPE_STRING, f == NULL ? "" : f,
-                                         "type",     OVAL_DATATYPE_SEXP, se_filetype(st.st_mode),
-                                         "group_id", OVAL_DATATYPE_SEXP, se_grp_id,
-                                         "user_id",  OVAL_DATATYPE_SEXP, se_usr_id,
-                                         "a_time",   OVAL_DATATYPE_SEXP, get_atime(&st, &se_atime_mem),
-                                         "c_time",   OVAL_DATATYPE_SEXP, get_ctime(&st, &se_ctime_mem),
-                                         "m_time",   OVAL_DATATYPE_SEXP, get_mtime(&st, &se_mtime_mem),
-                                         "size",     OVAL_DATATYPE_SEXP, get_size(&st, &se_size_mem),
-                                         "suid",     OVAL_DATATYPE_SEXP, MODEP(&st, S_ISUID),
-                                         "sgid",     OVAL_DATATYPE_SEXP, MODEP(&st, S_ISGID),
-                                         "sticky",   OVAL_DATATYPE_SEXP, MODEP(&st, S_ISVTX),
-                                         "uread",    OVAL_DATATYPE_SEXP, MODEP(&st, S_IRUSR),
-                                         "uwrite",   OVAL_DATATYPE_SEXP, MODEP(&st, S_IWUSR),
-                                         "uexec",    OVAL_DATATYPE_SEXP, MODEP(&st, S_IXUSR),
-                                         "gread",    OVAL_DATATYPE_SEXP, MODEP(&st, S_IRGRP),
-                                         "gwrite",   OVAL_DATATYPE_SEXP, MODEP(&st, S_IWGRP),
-                                         "gexec",    OVAL_DATATYPE_SEXP, MODEP(&st, S_IXGRP),
-                                         "oread",    OVAL_DATATYPE_SEXP, MODEP(&st, S_IROTH),
-                                         "owrite",   OVAL_DATATYPE_SEXP, MODEP(&st, S_IWOTH),
-                                         "oexec",    OVAL_DATATYPE_SEXP, MODEP(&st, S_IXOTH),
-					 "has_extended_acl", OVAL_DATATYPE_SEXP, se_acl,
-                                         NULL);
+                item = probe_itemtpl_item(g_item_tpl,
+                                          se_filepath,
+                                          &gr_lastpath,
+                                          f == NULL ? "" : f,
+                                          se_filetype(st.st_mode),
+                                          se_grp_id,
+                                          se_usr_id,
+                                          get_atime(&st, &se_atime_mem),
+                                          get_ctime(&st, &se_ctime_mem),
+                                          get_mtime(&st, &se_mtime_mem),
+                                          get_size(&st, &se_size_mem),
+                                          MODEP(&st, S_ISUID),
+                                          MODEP(&st, S_ISGID),
+                                          MODEP(&st, S_ISVTX),
+                                          MODEP(&st, S_IRUSR),
+                                          MODEP(&st, S_IWUSR),
+                                          MODEP(&st, S_IXUSR),
+                                          MODEP(&st, S_IRGRP),
+                                          MODEP(&st, S_IWGRP),
+                                          MODEP(&st, S_IXGRP),
+                                          MODEP(&st, S_IROTH),
+                                          MODEP(&st, S_IWOTH),
+                                          MODEP(&st, S_IXOTH),
+                                          se_acl);
 		if (se_acl == NULL) {
 			probe_item_ent_add(item, "has_extended_acl", NULL, gr_true);
-			probe_itement_setstatus(item, "has_extended_acl", 1, SYSCHAR_STATUS_DOES_NOT_EXIST);
+			probe_itement_setstatus(item, "has_extended_acl", 1, acl_status);
 		}
 
                 SEXP_free(se_grp_id);
@@ -404,6 +462,36 @@ void *probe_init (void)
 
 	SEXP_init(&gr_lastpath);
 
+	/*
+	 * Compile the entities of the items, in the order of the values
+	 * passed to probe_itemtpl_item() in file_cb().
+	 */
+	g_item_tpl = probe_itemtpl_new(OVAL_UNIX_FILE,
+	                               "filepath", OVAL_DATATYPE_SEXP,
+	                               "path",     OVAL_DATATYPE_SEXP,
+	                               "filename", OVAL_DATATYPE_STRING,
+	                               "type",     OVAL_DATATYPE_SEXP,
+	                               "group_id", OVAL_DATATYPE_SEXP,
+	                               "user_id",  OVAL_DATATYPE_SEXP,
+	                               "a_time",   OVAL_DATATYPE_SEXP,
+	                               "c_time",   OVAL_DATATYPE_SEXP,
+	                               "m_time",   OVAL_DATATYPE_SEXP,
+	                               "size",     OVAL_DATATYPE_SEXP,
+	                               "suid",     OVAL_DATATYPE_SEXP,
+	                               "sgid",     OVAL_DATATYPE_SEXP,
+	                               "sticky",   OVAL_DATATYPE_SEXP,
+	                               "uread",    OVAL_DATATYPE_SEXP,
+	                               "uwrite",   OVAL_DATATYPE_SEXP,
+	                               "uexec",    OVAL_DATATYPE_SEXP,
+	                               "gread",    OVAL_DATATYPE_SEXP,
+	                               "gwrite",   OVAL_DATATYPE_SEXP,
+	                               "gexec",    OVAL_DATATYPE_SEXP,
+	                               "oread",    OVAL_DATATYPE_SEXP,
+	                               "owrite",   OVAL_DATATYPE_SEXP,
+	                               "oexec",    OVAL_DATATYPE_SEXP,
+	                               "has_extended_acl", OVAL_DATATYPE_SEXP,
+	                               NULL);
+
 	/*
 	 * Initialize ID cache
 	 */
@@ -440,6 +528,8 @@ void probe_fini (void *arg)
 	if (!SEXP_emptyp(&gr_lastpath))
 		SEXP_free_r(&gr_lastpath);
 
+	probe_itemtpl_free(g_item_tpl);
+
 	/*
 	 * Free ID cache
 	 */
@@ -503,10 +593,12 @@ int probe_main (probe_ctx *ctx, void *mutex)
 
         cbargs.ctx     = ctx;
 	cbargs.error   = 0;
+	cbargs.acl     = probe_obj_entity_wanted(probe_in, "has_extended_acl");
 
 	if ((ofts = oval_fts_open(path, filename, filepath, behaviors, probe_ctx_getresult(ctx))) != NULL) {
 		while ((ofts_ent = oval_fts_read(ofts)) != NULL) {
-			if (file_cb(ofts_ent->path, ofts_ent->file, &cbargs) != 0) {
+			if (file_cb(ofts_ent->path, ofts_ent->file,
+				    ofts_ent->st_valid ? &ofts_ent->st : NULL, &cbargs) != 0) {
 				oval_ftsent_free(ofts_ent);
 				break;
 			}
@@ -77,22 +77,74 @@
 
 SEXP_t gr_lastpath;
 
+#define XATTR_BUFSIZE 1024 /* initial size of the buffers of the names and values */
+#define XATTR_NODEVS  16   /* devices remembered to not support extended attributes */
+
 struct cbargs {
         probe_ctx *ctx;
 	int        error;
         SEXP_t    *attr_ent;
+	char      *names;      /**< buffer of the list of names, reused by the files */
+	size_t     names_size;
+	char      *value;      /**< buffer of a value */
+	size_t     value_size;
+	dev_t      nodevs[XATTR_NODEVS];
+	size_t     nodevs_cnt;
 };
 
-static int file_cb (const char *p, const char *f, void *ptr)
+/*
+ * Read the list of the names (name == NULL) or the value of an extended
+ * attribute into the buffer, growing it to the size reported by the
+ * kernel if it's too small. The read data is followed by one free byte.
+ */
+static ssize_t xattr_get(const char *path, const char *name, char **buf, size_t *size)
+{
+	ssize_t len;
+
+	for (;;) {
+		if (name == NULL)
+			len = llistxattr(path, *buf, *size - 1);
+		else
+			len = lgetxattr(path, name, *buf, *size - 1);
+
+		if (len >= 0 || errno != ERANGE)
+			return (len);
+
+		/* changed since the size was read, ask again */
+		if (name == NULL)
+			len = llistxattr(path, NULL, 0);
+		else
+			len = lgetxattr(path, name, NULL, 0);
+
+		if (len < 0)
+			return (len);
+
+		*size = (size_t)len + 1 > *size * 2 ? (size_t)len + 1 : *size * 2;
+		*buf  = oscap_realloc(*buf, *size);
+	}
+}
+
+/* whether the device was found to not support extended attributes */
+static bool xattr_nodev(const struct cbargs *args, dev_t dev)
+{
+	size_t i;
+
+	for (i = 0; i < args->nodevs_cnt; ++i) {
+		if (args->nodevs[i] == dev)
+			return (true);
+	}
+
+	return (false);
+}
+
+static int file_cb (const char *p, const char *f, const struct stat *st, struct cbargs *args)
 {
         char path_buffer[PATH_MAX];
         SEXP_t *item, xattr_name;
-        struct cbargs *args = (struct cbargs *) ptr;
-        const char *st_path;
+        const char *st_path, *name;
 
-        ssize_t xattr_count = -1;
-        char   *xattr_buf = NULL;
-        size_t  xattr_buflen = 0, i;
+        ssize_t names_len, value_len;
+        size_t  i;
 
 	if (f == NULL) {
 		st_path = p;
@@ -101,34 +153,24 @@ static int file_cb (const char *p, const char *f, void *ptr)
 		st_path = path_buffer;
 	}
 
-        SEXP_init(&xattr_name);
-
-	do {
-		/* estimate the size of the buffer */
-		xattr_count = llistxattr(st_path, NULL, 0);
+	if (st != NULL && xattr_nodev(args, st->st_dev))
+		return (0);
 
-		if (xattr_count == 0)
-				return (0);
+	names_len = xattr_get(st_path, NULL, &args->names, &args->names_size);
 
-		if (xattr_count < 0) {
-				dI("FAIL: llistxattr(%s, %p, %zu): errno=%u, %s.", errno, strerror(errno));
-				return 0;
+	if (names_len < 0) {
+		if (errno == ENOTSUP && st != NULL) {
+			/* don't list the attributes of the other files of the filesystem */
+			if (args->nodevs_cnt < XATTR_NODEVS)
+				args->nodevs[args->nodevs_cnt++] = st->st_dev;
+		} else {
+			dI("FAIL: llistxattr(%s): errno=%u, %s.", st_path, errno, strerror(errno));
 		}
+		return (0);
+	}
 
-		/* allocate space for xattr names */
-		xattr_buflen = xattr_count;
-		xattr_buf    = oscap_realloc(xattr_buf, sizeof(char) * xattr_buflen);
-
-		/* fill the buffer */
-		xattr_count = llistxattr(st_path, xattr_buf, xattr_buflen);
-
-		/* check & retry if needed */
-	} while (errno == ERANGE);
-
-        if (xattr_count < 0) {
-                dI("FAIL: llistxattr(%s, %p, %zu): errno=%u, %s.", errno, strerror(errno));
-                oscap_free(xattr_buf);
-        }
+	if (names_len == 0)
+		return (0);
 
         /* update lastpath if needed */
         if (!SEXP_emptyp(&gr_lastpath)) {
@@ -139,67 +181,43 @@ static int file_cb (const char *p, const char *f, void *ptr)
         } else
                 SEXP_string_new_r(&gr_lastpath, p, strlen(p));
 
-        i = 0;
-        /* collect */
-        do {
-                SEXP_string_new_r(&xattr_name, xattr_buf + i, strlen(xattr_buf +i));
-
-                if (probe_entobj_cmp(args->attr_ent, &xattr_name) == OVAL_RESULT_TRUE) {
-                        ssize_t xattr_vallen = -1;
-                        char   *xattr_val = NULL;
+        SEXP_init(&xattr_name);
+	args->names[names_len] = '\0';
 
-                        xattr_vallen = lgetxattr(st_path, xattr_buf + i, NULL, 0);
-                retry_value:
-                        if (xattr_vallen >= 0) {
-				// Check possible buffer overflow
-				if (sizeof(char) * (xattr_vallen + 1) <= sizeof(char) * xattr_vallen) {
-					dE("Attribute is too long.");
-					abort();
-				}
+        /* collect, the names are separated by '\0' */
+	for (i = 0; i < (size_t)names_len; i += strlen(name) + 1) {
+		name = args->names + i;
 
-				// Allocate buffer, '+1' is for trailing '\0'
- 				xattr_val    = oscap_realloc(xattr_val, sizeof(char) * (xattr_vallen + 1));
+		if (*name == '\0')
+			continue;
 
-				// we don't want to override space for '\0' by call of 'lgetxattr'
-				// we pass only 'xattr_vallen' instead of 'xattr_vallen + 1'
-                                xattr_vallen = lgetxattr(st_path, xattr_buf + i, xattr_val, xattr_vallen);
+                SEXP_string_new_r(&xattr_name, name, strlen(name));
 
-                                if (xattr_vallen < 0 || errno == ERANGE)
-                                        goto retry_value;
+                if (probe_entobj_cmp(args->attr_ent, &xattr_name) == OVAL_RESULT_TRUE) {
+			value_len = xattr_get(st_path, name, &args->value, &args->value_size);
 
-				xattr_val[xattr_vallen] = '\0';
+                        if (value_len >= 0) {
+				args->value[value_len] = '\0';
 
                                 item = probe_item_create(OVAL_UNIX_FILEEXTENDEDATTRIBUTE, NULL,
                                                          "filepath", OVAL_DATATYPE_STRING, f == NULL ? NULL : st_path,
                                                          "path",     OVAL_DATATYPE_SEXP,  &gr_lastpath,
                                                          "filename", OVAL_DATATYPE_STRING, f == NULL ? "" : f,
                                                          "attribute_name", OVAL_DATATYPE_SEXP,   &xattr_name,
-                                                         "value",          OVAL_DATATYPE_STRING, xattr_val,
+                                                         "value",          OVAL_DATATYPE_STRING, args->value,
                                                          NULL);
-
-                                oscap_free(xattr_val);
                         } else {
-                                dI("FAIL: lgetxattr(%s, %s, NULL, 0): errno=%u, %s.", errno, strerror(errno));
+                                dI("FAIL: lgetxattr(%s, %s): errno=%u, %s.", st_path, name, errno, strerror(errno));
 
                                 item = probe_item_create(OVAL_UNIX_FILEEXTENDEDATTRIBUTE, NULL, NULL);
                                 probe_item_setstatus(item, SYSCHAR_STATUS_ERROR);
-
-                                if (xattr_val != NULL)
-                                        oscap_free(xattr_val);
                         }
 
                         probe_item_collect(args->ctx, item); /* XXX: handle ENOMEM */
                 }
 
                 SEXP_free_r(&xattr_name);
-
-                /* skip to next name */
-                while (i < xattr_buflen && xattr_buf[i] != '\0')
-                        ++i;
-		++i;
-        } while (xattr_buf + i < xattr_buf + xattr_buflen - 1);
-
-        oscap_free(xattr_buf);
+        }
 
         return (0);
 }
@@ -295,18 +313,26 @@ int probe_main (probe_ctx *ctx, void *mutex)
                 return PROBE_EFATAL;
         }
 
-        cbargs.ctx      = ctx;
-	cbargs.error    = 0;
-        cbargs.attr_ent = attribute_;
+        cbargs.ctx        = ctx;
+	cbargs.error      = 0;
+        cbargs.attr_ent   = attribute_;
+	cbargs.names_size = XATTR_BUFSIZE;
+	cbargs.names      = oscap_alloc(cbargs.names_size);
+	cbargs.value_size = XATTR_BUFSIZE;
+	cbargs.value      = oscap_alloc(cbargs.value_size);
+	cbargs.nodevs_cnt = 0;
 
 	if ((ofts = oval_fts_open(path, filename, filepath, behaviors, probe_ctx_getresult(ctx))) != NULL) {
 		while ((ofts_ent = oval_fts_read(ofts)) != NULL) {
-			file_cb(ofts_ent->path, ofts_ent->file, &cbargs);
+			file_cb(ofts_ent->path, ofts_ent->file, ofts_ent->st_valid ? &ofts_ent->st : NULL, &cbargs);
 			oval_ftsent_free(ofts_ent);
 		}
 		oval_fts_close(ofts);
 	}
 
+	oscap_free(cbargs.names);
+	oscap_free(cbargs.value);
+
 	err = 0;
 
 	SEXP_free(path);
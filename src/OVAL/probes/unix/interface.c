@@ -72,137 +72,215 @@
 #include <net/if_arp.h>
 #include <arpa/inet.h>
 
-static int fd=-1;
+#include "oval_rtnl.h"
 
-static void get_l2_info(const struct ifaddrs *ifa, char **mp, char **tp)
+/* the objects of a probe may be collected concurrently, the buffers are the caller's */
+#define IF_FLAGS_MAX 17
+#define IF_MAC_LEN   20
+
+static const char *get_type(unsigned short type)
+{
+	switch (type) {
+	case ARPHRD_ETHER:
+		return "ARPHRD_ETHER";
+	case ARPHRD_FDDI:
+		return "ARPHRD_FDDI";
+	case ARPHRD_LOOPBACK:
+		return "ARPHRD_LOOPBACK";
+	case ARPHRD_PPP:
+		return "ARPHRD_PPP";
+	case ARPHRD_PRONET:
+		return "ARPHRD_PRONET";
+	case ARPHRD_SLIP:
+		return "ARPHRD_SLIP";
+	case ARPHRD_VOID:
+		return "ARPHRD_VOID";
+	}
+	return "";
+}
+
+static void format_mac(const unsigned char *mac, char *mac_buf, size_t size)
+{
+	snprintf(mac_buf, size, "%02X:%02X:%02X:%02X:%02X:%02X",
+		mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+}
+
+static void get_l2_info(int fd, const struct ifaddrs *ifa, char *mac_buf, size_t size, char **tp)
 {
 	struct ifreq ifr;
 	unsigned char mac[6];
-	static char mac_buf[20];
 
-	*mp = mac_buf;
 	*tp = "";
 
 	memset(&ifr, 0, sizeof(struct ifreq));
 	strcpy(ifr.ifr_name, ifa->ifa_name);
 	if (ioctl(fd, SIOCGIFHWADDR, &ifr) >= 0) {
 		memcpy(mac, ifr.ifr_hwaddr.sa_data, sizeof(mac));
-		snprintf(mac_buf, sizeof(mac_buf),
-			"%02X:%02X:%02X:%02X:%02X:%02X",
-			mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
-		switch (ifr.ifr_hwaddr.sa_family) {
-		case ARPHRD_ETHER:
-			*tp = "ARPHRD_ETHER";
-			break;
-		case ARPHRD_FDDI:
-			*tp = "ARPHRD_FDDI";
-			break;
-		case ARPHRD_LOOPBACK:
-			*tp = "ARPHRD_LOOPBACK";
-			break;
-		case ARPHRD_PPP:
-			*tp = "ARPHRD_PPP";
-			break;
-		case ARPHRD_PRONET:
-			*tp = "ARPHRD_PRONET";
-			break;
-		case ARPHRD_SLIP:
-			*tp = "ARPHRD_SLIP";
-			break;
-		case ARPHRD_VOID:
-			*tp = "ARPHRD_VOID";
-			break;
-		}
+		format_mac(mac, mac_buf, size);
+		*tp = (char *)get_type(ifr.ifr_hwaddr.sa_family);
 	} else
 		mac_buf[0] = 0;
 }
 
 
-static void get_flags(const struct ifaddrs *ifa, char ***fp) {
-	static char *flags_buf[17];
+static void get_flags(unsigned int ifa_flags, char *flags_buf[IF_FLAGS_MAX]) {
 	int i = 0;
 
-	*fp = flags_buf;
+	/* follow values from net/if.h */
+	if (ifa_flags & IFF_UP) {
+		flags_buf[i] = "UP";
+		i++;
+	}
+	if (ifa_flags & IFF_BROADCAST) {
+		flags_buf[i] = "BROADCAST";
+		i++;
+	}
+	if (ifa_flags & IFF_DEBUG) {
+		flags_buf[i] = "DEBUG";
+		i++;
+	}
+	if (ifa_flags & IFF_LOOPBACK) {
+		flags_buf[i] = "LOOPBACK";
+		i++;
+	}
+	if (ifa_flags & IFF_POINTOPOINT) {
+		flags_buf[i] = "POINTOPOINT";
+		i++;
+	}
+	if (ifa_flags & IFF_NOTRAILERS) {
+		flags_buf[i] = "NOTRAILERS";
+		i++;
+	}
+	if (ifa_flags & IFF_RUNNING) {
+		flags_buf[i] = "RUNNING";
+		i++;
+	}
+	if (ifa_flags & IFF_NOARP) {
+		flags_buf[i] = "NOAPP";
+		i++;
+	}
+	if (ifa_flags & IFF_PROMISC) {
+		flags_buf[i] = "PROMISC";
+		i++;
+	}
+	if (ifa_flags & IFF_ALLMULTI) {
+		flags_buf[i] = "ALLMULTI";
+		i++;
+	}
+	if (ifa_flags & IFF_MASTER) {
+		flags_buf[i] = "MASTER";
+		i++;
+	}
+	if (ifa_flags & IFF_SLAVE) {
+		flags_buf[i] = "SLAVE";
+		i++;
+	}
+	if (ifa_flags & IFF_MULTICAST) {
+		flags_buf[i] = "MULTICAST";
+		i++;
+	}
+	if (ifa_flags & IFF_PORTSEL) {
+		flags_buf[i] = "PORTSEL";
+		i++;
+	}
+	if (ifa_flags & IFF_AUTOMEDIA) {
+		flags_buf[i] = "AUTOMEDIA";
+		i++;
+	}
+	if (ifa_flags & IFF_DYNAMIC) {
+		flags_buf[i] = "DYNAMIC";
+		i++;
+	}
+	flags_buf[i] = NULL;
 
-	if (ifa != NULL) {
-		/* follow values from net/if.h */
-		if (ifa->ifa_flags & IFF_UP) {
-			flags_buf[i] = "UP";
-			i++;
-		}
-		if (ifa->ifa_flags & IFF_BROADCAST) {
-			flags_buf[i] = "BROADCAST";
-			i++;
-		}
-		if (ifa->ifa_flags & IFF_DEBUG) {
-			flags_buf[i] = "DEBUG";
-			i++;
-		}
-		if (ifa->ifa_flags & IFF_LOOPBACK) {
-			flags_buf[i] = "LOOPBACK";
-			i++;
-		}
-		if (ifa->ifa_flags & IFF_POINTOPOINT) {
-			flags_buf[i] = "POINTOPOINT";
-			i++;
-		}
-		if (ifa->ifa_flags & IFF_NOTRAILERS) {
-			flags_buf[i] = "NOTRAILERS";
-			i++;
-		}
-		if (ifa->ifa_flags & IFF_RUNNING) {
-			flags_buf[i] = "RUNNING";
-			i++;
-		}
-		if (ifa->ifa_flags & IFF_NOARP) {
-			flags_buf[i] = "NOAPP";
-			i++;
-		}
-		if (ifa->ifa_flags & IFF_PROMISC) {
-			flags_buf[i] = "PROMISC";
-			i++;
-		}
-		if (ifa->ifa_flags & IFF_ALLMULTI) {
-			flags_buf[i] = "ALLMULTI";
-			i++;
-		}
-		if (ifa->ifa_flags & IFF_MASTER) {
-			flags_buf[i] = "MASTER";
-			i++;
-		}
-		if (ifa->ifa_flags & IFF_SLAVE) {
-			flags_buf[i] = "SLAVE";
-			i++;
-		}
-		if (ifa->ifa_flags & IFF_MULTICAST) {
-			flags_buf[i] = "MULTICAST";
-			i++;
-		}
-		if (ifa->ifa_flags & IFF_PORTSEL) {
-			flags_buf[i] = "PORTSEL";
-			i++;
-		}
-		if (ifa->ifa_flags & IFF_AUTOMEDIA) {
-			flags_buf[i] = "AUTOMEDIA";
-			i++;
+}
+
+/* same items as below, from the netlink snapshot */
+static int get_ifs_rtnl(const struct oval_rtnl *rtnl, SEXP_t *name_ent, probe_ctx *ctx, oval_schema_version_t over)
+{
+	const struct oval_rtnl_link *link;
+	const struct oval_rtnl_addr *addr;
+	char host[NI_MAXHOST], broad[NI_MAXHOST], mask[NI_MAXHOST], mac[IF_MAC_LEN], *flags[IF_FLAGS_MAX];
+	unsigned char hwaddr[6];
+	oval_datatype_t address_type;
+	SEXP_t *item, *sname;
+	bool include_type, use_ipstring;
+	size_t i;
+
+	include_type = oval_schema_version_cmp(over, OVAL_SCHEMA_VERSION(5.6)) >= 0;
+	use_ipstring = oval_schema_version_cmp(over, OVAL_SCHEMA_VERSION(5.8)) >= 0;
+
+	for (i = 0; i < rtnl->addrs_count; ++i) {
+		addr = &rtnl->addrs[i];
+		link = oval_rtnl_link(rtnl, addr->index);
+		if (link == NULL)
+			continue;
+
+		sname = SEXP_string_newf("%s", addr->label);
+		if (probe_entobj_cmp(name_ent, sname) != OVAL_RESULT_TRUE) {
+			SEXP_free(sname);
+			continue;
 		}
-		if (ifa->ifa_flags & IFF_DYNAMIC) {
-			flags_buf[i] = "DYNAMIC";
-			i++;
+		SEXP_free(sname);
+
+		/* SIOCGIFHWADDR returns the first 6 bytes, zeros if there are none */
+		memset(hwaddr, 0, sizeof(hwaddr));
+		memcpy(hwaddr, link->hwaddr, link->hwaddr_len < sizeof(hwaddr) ? link->hwaddr_len : sizeof(hwaddr));
+		format_mac(hwaddr, mac, sizeof(mac));
+		get_flags(link->flags, flags);
+
+		inet_ntop(addr->family, addr->addr, host, NI_MAXHOST);
+		*broad = '\0';
+		*mask = '\0';
+
+		if (addr->family == AF_INET) {
+			struct in_addr netmask;
+
+			address_type = use_ipstring ? OVAL_DATATYPE_IPV4ADDR : OVAL_DATATYPE_STRING;
+			netmask.s_addr = addr->prefixlen == 0 ? 0 : htonl(0xffffffffu << (32 - addr->prefixlen));
+			inet_ntop(AF_INET, &netmask, mask, NI_MAXHOST);
+
+			if (link->flags & IFF_BROADCAST && addr->has_broadcast)
+				inet_ntop(AF_INET, addr->broadcast, broad, NI_MAXHOST);
+		} else {
+			size_t len = strlen(host);
+
+			address_type = use_ipstring ? OVAL_DATATYPE_IPV6ADDR : OVAL_DATATYPE_STRING;
+			snprintf(host + len, NI_MAXHOST - len, "/%d", addr->prefixlen);
 		}
+
+		item = probe_item_create(OVAL_UNIX_INTERFACE, NULL,
+					 "name",           OVAL_DATATYPE_STRING, addr->label,
+					 "type",           OVAL_DATATYPE_STRING, include_type ? get_type(link->type) : NULL,
+					 "hardware_addr",  OVAL_DATATYPE_STRING, mac,
+					 "inet_addr",      address_type, host,
+					 "broadcast_addr", address_type, broad,
+					 "netmask",        address_type, mask,
+					 "flag",           OVAL_DATATYPE_STRING_M, flags,
+					 NULL);
+
+		probe_item_collect(ctx, item);
 	}
-	flags_buf[i] = NULL;
 
+	return 0;
 }
 
 static int get_ifs(SEXP_t *name_ent, probe_ctx *ctx, oval_schema_version_t over)
 {
 	struct ifaddrs *ifaddr, *ifa;
-	int family, rc=1;
-	char host[NI_MAXHOST], broad[NI_MAXHOST], mask[NI_MAXHOST], *mac, *type, **flags;
+	int family, fd, rc=1;
+	char host[NI_MAXHOST], broad[NI_MAXHOST], mask[NI_MAXHOST], mac[IF_MAC_LEN], *type, *flags[IF_FLAGS_MAX];
 	oval_datatype_t address_type;
 	SEXP_t *item;
 	bool include_type, use_ipstring;
+	const struct oval_rtnl *rtnl;
+
+	rtnl = oval_rtnl_get();
+	if (rtnl != NULL) {
+		rc = get_ifs_rtnl(rtnl, name_ent, ctx, over);
+		oval_rtnl_put(rtnl);
+		return rc;
+	}
 
 	if (getifaddrs(&ifaddr) == -1) {
 		SEXP_t *msg;
@@ -249,8 +327,8 @@ static int get_ifs(SEXP_t *name_ent, probe_ctx *ctx, oval_schema_version_t over)
 		}
 		SEXP_free(sname);
 
-		get_l2_info(ifa, &mac, &type);
-		get_flags(ifa, &flags);
+		get_l2_info(fd, ifa, mac, sizeof(mac), &type);
+		get_flags(ifa->ifa_flags, flags);
 
 /* The inet_addr entity is the IP address of the specific interface.
  * Note that the IP address can be IPv4 or IPv6. If the IP address is an IPv6 address,
@@ -5,7 +5,11 @@
 #include <cstdio>
 #include <cstring>
 #include <iostream>
+#include <fstream>
+#include <map>
+#include <string>
 #include <stdlib.h>
+#include <sys/stat.h>
 
 #include <apt-pkg/init.h>
 #include <apt-pkg/error.h>
@@ -20,10 +24,136 @@ using namespace std;
 static int _init_done = 0;
 static pkgCache *cgCache = NULL;
 
-static int opencache (void) {
-        if (pkgInitConfig (*_config) == false) return 0;
-        if (pkgInitSystem (*_config, _system) == false) return 0;
+/*
+ * Installed packages read from the dpkg status file, keyed by name. The
+ * file is read again when its inode, size or mtime changes, so every
+ * object of a scan is served from memory. The APT cache is only opened
+ * if the status file can't be read.
+ */
+struct dpkginfo_pkg {
+        string arch;
+        string epoch;
+        string release;
+        string version;
+        string evr;
+};
+
+static map<string, dpkginfo_pkg> dpkgIndex;
+static string dpkgStatusPath;
+static string dpkgNativeArch;
+static struct stat dpkgStatusStat;
+static bool dpkgIndexValid = false;
+
+/* split epoch, version and release */
+static void split_evr (const string &evr, dpkginfo_pkg &pkg)
+{
+        string::size_type version_start = 0, version_stop;
+        string::size_type pos;
+
+        pos = evr.find_first_of(":");
+        if (pos != string::npos) {
+                pkg.epoch = evr.substr(0, pos);
+                version_start = pos+1;
+        } else
+        {
+		    pkg.epoch = "0";
+        }
+
+        pos = evr.find_first_of("-");
+        if (pos != string::npos) {
+                pkg.version = evr.substr(version_start, pos-version_start);
+                version_stop = pos+1;
+                pkg.release = evr.substr(version_stop, evr.length()-version_stop);
+                pkg.evr = pkg.epoch + ":" + pkg.version + "-" + pkg.release;
+
+
+        } else { /* no release number, probably a native package */
+                pkg.version = evr.substr(version_start, evr.length()-version_start);
+                pkg.release = "";
+                pkg.evr = pkg.epoch + ":" + pkg.version;
+        }
+}
+
+static void index_add (const string &name, const string &status,
+                       const string &arch, const string &version)
+{
+        string::size_type pos;
+        string state;
+
+        if (name.empty() || version.empty())
+                return;
+
+        /* "want flag state", packages which aren't unpacked have no version */
+        pos = status.find_last_of(" ");
+        state = (pos == string::npos) ? status : status.substr(pos + 1);
+        if (state == "not-installed" || state == "config-files")
+                return;
+
+        /* with multiarch, prefer the native (or arch independent) package */
+        map<string, dpkginfo_pkg>::iterator it = dpkgIndex.find(name);
+        if (it != dpkgIndex.end() &&
+            (it->second.arch == dpkgNativeArch || it->second.arch == "all"))
+                return;
+
+        dpkginfo_pkg &pkg = dpkgIndex[name];
+        pkg.arch = arch;
+        split_evr(version, pkg);
+}
+
+static int load_status (void)
+{
+        string line, name, status, arch, version;
+        struct stat st;
+
+        if (stat(dpkgStatusPath.c_str(), &st) != 0)
+                return -1;
+
+        if (dpkgIndexValid &&
+            st.st_ino == dpkgStatusStat.st_ino &&
+            st.st_size == dpkgStatusStat.st_size &&
+            st.st_mtime == dpkgStatusStat.st_mtime)
+                return 0;
+
+        ifstream in(dpkgStatusPath.c_str());
+        if (!in)
+                return -1;
+
+        dpkgIndex.clear();
+
+        while (getline(in, line)) {
+                if (line.empty()) {
+                        index_add(name, status, arch, version);
+                        name.clear(); status.clear(); arch.clear(); version.clear();
+                        continue;
+                }
+                /* continuation lines of multi-line fields */
+                if (line[0] == ' ' || line[0] == '\t')
+                        continue;
+
+                if (line.compare(0, 9, "Package: ") == 0)
+                        name = line.substr(9);
+                else if (line.compare(0, 8, "Status: ") == 0)
+                        status = line.substr(8);
+                else if (line.compare(0, 14, "Architecture: ") == 0)
+                        arch = line.substr(14);
+                else if (line.compare(0, 9, "Version: ") == 0)
+                        version = line.substr(9);
+        }
+        index_add(name, status, arch, version);
 
+        if (in.bad()) {
+                dpkgIndex.clear();
+                dpkgIndexValid = false;
+                return -1;
+        }
+
+        dpkgStatusStat = st;
+        dpkgIndexValid = true;
+
+        return 0;
+}
+
+static int opencache (void) {
         FileFd *fd = new FileFd (_config->FindFile ("Dir::Cache::pkgcache"),
                         FileFd::ReadOnly);
 
@@ -43,10 +173,14 @@ static int opencache (void) {
         return 1;
 }
 
-struct dpkginfo_reply_t * dpkginfo_get_by_name(const char *name, int *err)
+static struct dpkginfo_reply_t * dpkginfo_get_by_name_apt(const char *name, int *err)
 {
+        if (cgCache == NULL && opencache() != 1) {
+                if (err) *err = -1;
+                return NULL;
+        }
+
         pkgCache &cache = *cgCache;
-        pkgRecords Recs (cache);
         struct dpkginfo_reply_t *reply = NULL;
 
         // Locate the package
@@ -64,46 +198,45 @@ struct dpkginfo_reply_t * dpkginfo_get_by_name(const char *name, int *err)
                 if (err) *err = 0;
                 return NULL;
         }
-        pkgRecords::Parser &P = Recs.Lookup(V1.FileList());
+        dpkginfo_pkg pkg;
+        split_evr(V1.VerStr(), pkg);
 
-        /* split epoch, version and release */
-        string evr = V1.VerStr();
-        string epoch, version, release;
-        string::size_type version_start = 0, version_stop;
-        string::size_type pos;
-        string evr_str;
+        reply = new(struct dpkginfo_reply_t);
+        memset(reply, 0, sizeof(struct dpkginfo_reply_t));
+        reply->name = strdup(Pkg.Name());
+        reply->arch = strdup(V1.Arch());
+        reply->epoch = strdup(pkg.epoch.c_str());
+        reply->release = strdup(pkg.release.c_str());
+        reply->version = strdup(pkg.version.c_str());
+        reply->evr = strdup(pkg.evr.c_str());
 
-        pos = evr.find_first_of(":");
-        if (pos != string::npos) {
-                epoch = evr.substr(0, pos);
-                version_start = pos+1;
-        } else
-        {
-		    epoch = "0";
-        }
+        return reply;
+}
 
-        pos = evr.find_first_of("-");
-        if (pos != string::npos) {
-                version = evr.substr(version_start, pos-version_start);
-                version_stop = pos+1;
-                release = evr.substr(version_stop, evr.length()-version_stop);
-                evr_str = epoch + ":" + version + "-" + release;
+struct dpkginfo_reply_t * dpkginfo_get_by_name(const char *name, int *err)
+{
+        struct dpkginfo_reply_t *reply = NULL;
 
+        if (load_status() != 0)
+                return dpkginfo_get_by_name_apt(name, err);
 
-        } else { /* no release number, probably a native package */
-                version = evr.substr(version_start, evr.length()-version_start);
-                release = "";
-                evr_str = epoch + ":" + version;
+        map<string, dpkginfo_pkg>::const_iterator it = dpkgIndex.find(name);
+        if (it == dpkgIndex.end()) {
+                /* not found or not installed, clear error flag */
+                if (err) *err = 0;
+                return NULL;
         }
 
+        const dpkginfo_pkg &pkg = it->second;
+
         reply = new(struct dpkginfo_reply_t);
         memset(reply, 0, sizeof(struct dpkginfo_reply_t));
-        reply->name = strdup(Pkg.Name());
-        reply->arch = strdup(V1.Arch());
-        reply->epoch = strdup(epoch.c_str());
-        reply->release = strdup(release.c_str());
-        reply->version = strdup(version.c_str());
-        reply->evr = strdup(evr_str.c_str());
+        reply->name = strdup(name);
+        reply->arch = strdup(pkg.arch.c_str());
+        reply->epoch = strdup(pkg.epoch.c_str());
+        reply->release = strdup(pkg.release.c_str());
+        reply->version = strdup(pkg.version.c_str());
+        reply->evr = strdup(pkg.evr.c_str());
 
         return reply;
 }
@@ -112,16 +245,31 @@ void * dpkginfo_free_reply(struct dpkginfo_reply_t *reply)
 {
         if (reply) {
                 free(reply->name);
+                free(reply->arch);
+                free(reply->epoch);
+                free(reply->release);
+                free(reply->version);
+                free(reply->evr);
                 delete reply;
         }
+
+        return NULL;
 }
 
 int dpkginfo_init()
 {
-        if (_init_done == 0)
-                if (opencache() != 1) {
+        if (_init_done == 0) {
+                if (pkgInitConfig (*_config) == false) return -1;
+                if (pkgInitSystem (*_config, _system) == false) return -1;
+
+                dpkgStatusPath = _config->FindFile ("Dir::State::status");
+                dpkgNativeArch = _config->Find ("APT::Architecture");
+
+                if (load_status() != 0 && opencache() != 1)
                         return -1;
-                }
+
+                _init_done = 1;
+        }
 
         return 0;
 }
@@ -130,6 +278,8 @@ int dpkginfo_fini()
 {
         delete cgCache;
         cgCache = NULL;
+        dpkgIndex.clear();
+        dpkgIndexValid = false;
 
         return 0;
 }
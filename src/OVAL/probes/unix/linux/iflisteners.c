@@ -60,6 +60,7 @@
 #include "alloc.h"
 #include "util.h"
 #include "common/debug_priv.h"
+#include "oval_proctab.h"
 
 #include "iflisteners-proto.h"
 
@@ -77,230 +78,116 @@ struct result_info {
 typedef struct _lnode {
   pid_t pid;            // process ID
   uid_t uid;            // effective user ID
-  char *cmd;            // command run by user
+  const char *cmd;      // command run by user, owned by the process table
   unsigned long inode;  // inode of socket
-  struct _lnode* next;  // Next node pointer
 } lnode;
 
-/* This is the linked list head. Only data elements go here. */
+/* Socket owners sorted by inode, built from the process table for an object */
 typedef struct {
-  lnode *head;          // List head
-  lnode *cur;           // Pointer to current node
-} llist;
+  const struct oval_proctab *proctab; // holds the commands of the nodes
+  lnode *nodes;
+  size_t count;
+} inode_index;
 
 struct interface_t {
   char interface_name[255];
   char hw_address[255];
 };
 
-/* Local data */
-static int perm_warn = 0;
-
-/* Function prototypes */
-static inline lnode *list_get_cur(llist *l) { return l->cur; }
-static void list_create(llist *l);
-static void list_append(llist *l, lnode *node);
-static void list_clear(llist* l);
-static lnode *list_find_inode(llist *l, unsigned long i);
-
-
-static void list_create(llist *l)
+static int lnode_cmp(const void *a, const void *b)
 {
-	l->head = NULL;
-	l->cur = NULL;
-}
+	const lnode *na = a, *nb = b;
 
-static void list_append(llist *l, lnode *node)
-{
-	lnode* newnode;
-
-	if (node == NULL || l == NULL)
-		return;
-
-	newnode = malloc(sizeof(lnode));
-	if (newnode == NULL)
-		return;
-
-	newnode->pid = node->pid;
-	newnode->uid = node->uid;
-	newnode->inode = node->inode;
-	// Take custody of the memory
-	newnode->cmd = node->cmd;
-	newnode->next = NULL;
-
-	// if we are at top, fix this up
-	if (l->head == NULL)
-		l->head = newnode;
-	else	// Otherwise add pointer to newnode
-		l->cur->next = newnode;
-
-	// make newnode current
-	l->cur = newnode;
+	return (na->inode > nb->inode) - (na->inode < nb->inode);
 }
 
-static void list_clear(llist* l)
+static lnode *index_find_inode(inode_index *idx, unsigned long i)
 {
-	lnode* nextnode;
-	register lnode* cur;
-
-	cur = l->head;
-	while (cur) {
-		nextnode=cur->next;
-		free(cur->cmd);
-		free(cur);
-		cur=nextnode;
-	}
-	l->head = NULL;
-	l->cur = NULL;
-}
+	lnode key;
 
-static lnode *list_find_inode(llist *l, unsigned long i)
-{
-        register lnode* cur;
-
-	cur = l->head;	/* start at the beginning */
-	while (cur) {
-		if (cur->inode == i) {
-			l->cur = cur;
-			return cur;
-		} else
-			cur = cur->next;
-	}
-	return NULL;
+	key.inode = i;
+	return bsearch(&key, idx->nodes, idx->count, sizeof(lnode), lnode_cmp);
 }
 
-static int collect_process_info(llist *l)
+static int collect_process_info(inode_index *idx)
 {
-	DIR *d, *f;
-	struct dirent *ent;
+	const struct oval_proctab *proctab;
+	size_t proc_i, sock_i, sock_count, alloc = 0;
+	int perm_warn = 0;
 
-	d = opendir("/proc");
-	if (d == NULL)
+	proctab = oval_proctab_get();
+	if (proctab == NULL)
 		return 1;
-
-	while (( ent = readdir(d) )) {
-		FILE *sf;
-		int pid, ppid;
-		char buf[100];
-		char *tmp, cmd[16], state, *text = NULL;
-		int fd, len, euid = 0;
-
-		// Skip non-process dir entries
-		if(*ent->d_name<'0' || *ent->d_name>'9')
-			continue;
-		errno = 0;
-		pid = strtol(ent->d_name, NULL, 10);
-		if (errno)
+	idx->proctab = proctab;
+
+	for (proc_i = 0; proc_i < proctab->count; ++proc_i) {
+		struct oval_proc *proc = proctab->procs[proc_i];
+		const struct oval_proc_stat *st;
+		const unsigned long *sockets;
+		int pid, ruid, euid = 0, fd_err;
+
+		pid = oval_proc_pid(proc);
+
+		// Get the inodes each process has open, the stat file is read
+		// only for the processes with sockets
+		sockets = oval_proc_sockets(proc, &sock_count, &fd_err);
+		if (fd_err == EACCES) {
+			/* Need DAC_OVERRIDE permission */
+			perm_warn = 1;
+		}
+		if (sock_count == 0) {
+			// Process might have ended or something - ignore it
 			continue;
+		}
 
 		// Parse up the stat file for the proc
-		snprintf(buf, 32, "/proc/%d/stat", pid);
-		fd = open(buf, O_RDONLY, 0);
-		if (fd < 0)
-			continue;
-		len = read(fd, buf, sizeof buf - 1);
-		close(fd);
-		if (len < 40)
-			continue;
-		buf[len] = 0;
-		tmp = strrchr(buf, ')');
-		if (tmp)
-			*tmp = 0;
-		else
+		st = oval_proc_stat(proc);
+		if (st == NULL)
 			continue;
-		memset(cmd, 0, sizeof(cmd));
-		sscanf(buf, "%d (%15c", &ppid, cmd);
-		sscanf(tmp+2, "%c %d", &state, &ppid);
 
 		// Skip kthreads
-		if (pid == 2 || ppid == 2)
+		if (pid == 2 || st->ppid == 2)
 			continue;
 
 		// Get the effective uid
-		snprintf(buf, 32, "/proc/%d/status", pid);
-		sf = fopen(buf, "rt");
-		if (sf) {
-			int line = 0;
-			__fsetlocking(sf, FSETLOCKING_BYCALLER);
-			while (fgets(buf, sizeof(buf), sf)) {
-				if (line == 0) {
-					line++;
-					continue;
-				}
-				if (memcmp(buf, "Uid:", 4) == 0) {
-					int id;
-					sscanf(buf, "Uid: %d %d",
-						&id, &euid);
-					break;
-				}
-			}
-			fclose(sf);
-		}
+		oval_proc_uids(proc, &ruid, &euid);
+
+		// We make one entry for each socket inode
+		for (sock_i = 0; sock_i < sock_count; ++sock_i) {
+			lnode *node;
 
-		// Now lets get the inodes each process has open
-		snprintf(buf, 32, "/proc/%d/fd", pid);
-		f = opendir(buf);
-		if (f == NULL) {
-			if (errno == EACCES && perm_warn == 0) {
-				/* Need DAC_OVERRIDE permission */
-				perm_warn = 1;
+			if (idx->count == alloc) {
+				lnode *nodes;
+
+				alloc = alloc > 0 ? alloc * 2 : 256;
+				nodes = realloc(idx->nodes, alloc * sizeof(lnode));
+				if (nodes == NULL)
+					return 1;
+				idx->nodes = nodes;
 			}
-			// Process might have ended or something - ignore it
-			free(text);
-			continue;
-		}
-		// For each file in the fd dir...
-		while (( ent = readdir(f) )) {
-			char line[256], ln[256], *s, *e;
-			unsigned long inode;
-			lnode node;
-			int lnlen;
-
-			if (ent->d_name[0] == '.')
-				continue;
-			snprintf(ln, 256, "%s/%s", buf, ent->d_name);
-			if ((lnlen = readlink(ln, line, sizeof(line)-1)) < 0)
-				continue;
-			line[lnlen] = 0;
-
-			// Only look at the socket entries
-			if (memcmp(line, "socket:", 7) == 0) {
-				// Type 1 sockets
-				s = strchr(line+7, '[');
-				if (s == NULL)
-					continue;
-				s++;
-				e = strchr(s, ']');
-				if (e == NULL)
-					continue;
-				*e = 0;
-			} else if (memcmp(line, "[0000]:", 7) == 0) {
-				// Type 2 sockets
-				s = line + 8;
-			} else
-				continue;
-			errno = 0;
-			inode = strtoul(s, NULL, 10);
-			if (errno)
-				continue;
-			node.pid = pid;
-			node.uid = euid;
-			node.cmd = strdup(cmd);
-			node.inode = inode;
-			// We make one entry for each socket inode
-			list_append(l, &node);
+
+			node = &idx->nodes[idx->count++];
+			node->pid = pid;
+			node->uid = euid;
+			node->cmd = st->comm;
+			node->inode = sockets[sock_i];
 		}
-		closedir(f);
-		free(text);
 	}
-	closedir(d);
-	return 0;
+
+	// Sockets shared by several processes keep the first owner found
+	qsort(idx->nodes, idx->count, sizeof(lnode), lnode_cmp);
+	return perm_warn;
 }
 
-static void report_finding(struct result_info *res, llist *l, probe_ctx *ctx, oval_schema_version_t over)
+static void index_free(inode_index *idx)
+{
+	free(idx->nodes);
+	oval_proctab_put(idx->proctab);
+}
+
+static void report_finding(struct result_info *res, lnode *n, probe_ctx *ctx, oval_schema_version_t over)
 {
         SEXP_t *item, *user_id;
-	lnode *n = list_get_cur(l);
 
 	if (oval_schema_version_cmp(over, OVAL_SCHEMA_VERSION(5.10)) < 0)
 		user_id = SEXP_string_newf("%d", n->uid);
@@ -370,7 +257,7 @@ static int get_interface(const int ent_ifindex, struct interface_t *interface) {
 	return 0;
 }
 
-static int read_packet(llist *l, probe_ctx *ctx, oval_schema_version_t over)
+static int read_packet(inode_index *l, probe_ctx *ctx, oval_schema_version_t over)
 {
 	int line = 0;
 	FILE *f;
@@ -381,6 +268,7 @@ static int read_packet(llist *l, probe_ctx *ctx, oval_schema_version_t over)
 	unsigned long inode;
 	unsigned rmem, uid, proto_num;
 	struct interface_t interface;
+	lnode *n;
 
 
 	f = fopen("/proc/net/packet", "rt");
@@ -401,7 +289,8 @@ static int read_packet(llist *l, probe_ctx *ctx, oval_schema_version_t over)
 			"%p %d %d %04x %d %d %u %u %lu\n",
 			&s, &refcnt, &sk_type, &proto_num, &ifindex, &running, &rmem, &uid, &inode
 		);
-		if (list_find_inode(l, inode) && get_interface(ifindex, &interface)) {
+		n = index_find_inode(l, inode);
+		if (n != NULL && get_interface(ifindex, &interface)) {
 			struct result_info r;
 			SEXP_t *r0;
 			dI("Have interface_name: %s, hw_address: %s",
@@ -417,7 +306,7 @@ static int read_packet(llist *l, probe_ctx *ctx, oval_schema_version_t over)
 			r.interface_name = interface.interface_name;
 			r.protocol = oscap_enum_to_string(ProtocolType, proto_num);
 			r.hw_address = interface.hw_address;
-			report_finding(&r, l, ctx, over);
+			report_finding(&r, n, ctx, over);
 		}
 	}
 	fclose(f);
@@ -428,8 +317,8 @@ int probe_main(probe_ctx *ctx, void *arg)
 {
         SEXP_t *object;
 	int err;
-	llist ll;
 	oval_schema_version_t over;
+	inode_index idx = { NULL, NULL, 0 };
 
         object = probe_ctx_getobject(ctx);
         over   = probe_obj_get_platform_schema_version(object);
@@ -441,8 +330,7 @@ int probe_main(probe_ctx *ctx, void *arg)
 	}
 
 	// Now start collecting the info
-	list_create(&ll);
-	if (collect_process_info(&ll) || perm_warn) {
+	if (collect_process_info(&idx) != 0) {
 		SEXP_t *msg;
 
 		msg = probe_msg_creat(OVAL_MESSAGE_LEVEL_ERROR, "Permission error.");
@@ -454,12 +342,11 @@ int probe_main(probe_ctx *ctx, void *arg)
 		goto cleanup;
 	}
 
-	read_packet(&ll, ctx, over);
-
-	list_clear(&ll);
+	read_packet(&idx, ctx, over);
 
 	err = 0;
  cleanup:
+	index_free(&idx);
 	SEXP_vfree(interface_name_ent, NULL);
 
 	return err;
@@ -57,14 +57,22 @@
 #include <dirent.h>
 #include <fcntl.h>
 #include <netdb.h>
+#include <unistd.h>
 #include <arpa/inet.h>
 #include <regex.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/sock_diag.h>
+#include <linux/inet_diag.h>
 
 #include "seap.h"
 #include "probe-api.h"
 #include "probe/entcmp.h"
 #include "alloc.h"
 #include "common/debug_priv.h"
+#include "oval_proctab.h"
 
 /* This structure contains the information OVAL is asking or requesting */
 struct server_info {
@@ -87,238 +95,124 @@ struct result_info {
 typedef struct _lnode {
   pid_t pid;            // process ID
   uid_t uid;            // effective user ID
-  char *cmd;            // command run by user
+  const char *cmd;      // command run by user, owned by the process table
   unsigned long inode;  // inode of socket
-  struct _lnode* next;  // Next node pointer
 } lnode;
 
-/* This is the linked list head. Only data elements go here. */
+/* Socket owners sorted by inode, built from the process table for an object */
 typedef struct {
-  lnode *head;          // List head
-  lnode *cur;           // Pointer to current node
-} llist;
+  const struct oval_proctab *proctab; // holds the commands of the nodes
+  lnode *nodes;
+  size_t count;
+} inode_index;
 
-/* Local data */
-static struct server_info req;
-
-/* Function prototypes */
-static inline lnode *list_get_cur(llist *l) { return l->cur; }
-static void list_create(llist *l);
-static void list_append(llist *l, lnode *node);
-static void list_clear(llist* l);
-static lnode *list_find_inode(llist *l, unsigned long i);
-
-
-static void list_create(llist *l)
+static int lnode_cmp(const void *a, const void *b)
 {
-	l->head = NULL;
-	l->cur = NULL;
-}
+	const lnode *na = a, *nb = b;
 
-static void list_append(llist *l, lnode *node)
-{
-	lnode* newnode;
-
-	if (node == NULL || l == NULL)
-		return;
-
-	newnode = malloc(sizeof(lnode));
-	if (newnode == NULL)
-		return;
-
-	newnode->pid = node->pid;
-	newnode->uid = node->uid;
-	newnode->inode = node->inode;
-	// Take custody of the memory
-	newnode->cmd = node->cmd;
-	newnode->next = NULL;
-
-	// if we are at top, fix this up
-	if (l->head == NULL)
-		l->head = newnode;
-	else	// Otherwise add pointer to newnode
-		l->cur->next = newnode;
-
-	// make newnode current
-	l->cur = newnode;
+	return (na->inode > nb->inode) - (na->inode < nb->inode);
 }
 
-static void list_clear(llist* l)
+static lnode *index_find_inode(inode_index *idx, unsigned long i)
 {
-	lnode* nextnode;
-	register lnode* cur;
-
-	cur = l->head;
-	while (cur) {
-		nextnode=cur->next;
-		free(cur->cmd);
-		free(cur);
-		cur=nextnode;
-	}
-	l->head = NULL;
-	l->cur = NULL;
-}
+	lnode key;
 
-static lnode *list_find_inode(llist *l, unsigned long i)
-{
-        register lnode* cur;
-
-       	cur = l->head;	/* start at the beginning */
-	while (cur) {
-		if (cur->inode == i) {
-			l->cur = cur;
-			return cur;
-		} else
-			cur = cur->next;
-	}
-	return NULL;
+	key.inode = i;
+	return bsearch(&key, idx->nodes, idx->count, sizeof(lnode), lnode_cmp);
 }
 
-static int collect_process_info(llist *l)
+static int collect_process_info(inode_index *idx)
 {
-	DIR *d, *f;
-	struct dirent *ent;
+	const struct oval_proctab *proctab;
+	size_t proc_i, sock_i, sock_count, alloc = 0;
 
-	d = opendir("/proc");
-	if (d == NULL)
+	proctab = oval_proctab_get();
+	if (proctab == NULL)
 		return 1;
+	idx->proctab = proctab;
 
-	while (( ent = readdir(d) )) {
-		FILE *sf;
-		int pid, ppid;
-		char buf[100];
-		char *tmp, cmd[16], state, *text = NULL;
-		int fd, len, euid = 0;
+	for (proc_i = 0; proc_i < proctab->count; ++proc_i) {
+		struct oval_proc *proc = proctab->procs[proc_i];
+		const struct oval_proc_stat *st;
+		const unsigned long *sockets;
+		int pid, ruid, euid = 0;
 
-		// Skip non-process dir entries
-		if(*ent->d_name<'0' || *ent->d_name>'9')
-			continue;
-		errno = 0;
-		pid = strtol(ent->d_name, NULL, 10);
-		if (errno)
+		pid = oval_proc_pid(proc);
+
+		// Get the inodes each process has open, the stat file is read
+		// only for the processes with sockets
+		sockets = oval_proc_sockets(proc, &sock_count, NULL);
+		if (sock_count == 0) {
+			// No sockets, process might have ended or we don't have access - ignore it
 			continue;
+		}
 
 		// Parse up the stat file for the proc
-		snprintf(buf, 32, "/proc/%d/stat", pid);
-		fd = open(buf, O_RDONLY, 0);
-		if (fd < 0)
-			continue;
-		len = read(fd, buf, sizeof buf - 1);
-		close(fd);
-		if (len < 40)
-			continue;
-		buf[len] = 0;
-		tmp = strrchr(buf, ')');
-		if (tmp)
-			*tmp = 0;
-		else
+		st = oval_proc_stat(proc);
+		if (st == NULL)
 			continue;
-		memset(cmd, 0, sizeof(cmd));
-		sscanf(buf, "%d (%15c", &ppid, cmd);
-		sscanf(tmp+2, "%c %d", &state, &ppid);
 
 		// Skip kthreads
-		if (pid == 2 || ppid == 2)
+		if (pid == 2 || st->ppid == 2)
 			continue;
 
 		// Get the effective uid
-		snprintf(buf, 32, "/proc/%d/status", pid);
-		sf = fopen(buf, "rt");
-		if (sf) {
-			int line = 0;
-			__fsetlocking(sf, FSETLOCKING_BYCALLER);
-			while (fgets(buf, sizeof(buf), sf)) {
-				if (line == 0) {
-					line++;
-					continue;
-				}
-				if (memcmp(buf, "Uid:", 4) == 0) {
-					int id;
-					sscanf(buf, "Uid: %d %d",
-						&id, &euid);
-					break;
-				}
+		oval_proc_uids(proc, &ruid, &euid);
+
+		// We make one entry for each socket inode
+		for (sock_i = 0; sock_i < sock_count; ++sock_i) {
+			lnode *node;
+
+			if (idx->count == alloc) {
+				lnode *nodes;
+
+				alloc = alloc > 0 ? alloc * 2 : 256;
+				nodes = realloc(idx->nodes, alloc * sizeof(lnode));
+				if (nodes == NULL)
+					return 1;
+				idx->nodes = nodes;
 			}
-			fclose(sf);
-		}
 
-		// Now lets get the inodes each process has open
-		snprintf(buf, 32, "/proc/%d/fd", pid);
-		f = opendir(buf);
-		if (f == NULL) {
-			// Process might have ended or we don;t have access - ignore it
-			free(text);
-			continue;
-		}
-		// For each file in the fd dir...
-		while (( ent = readdir(f) )) {
-			char line[256], ln[256], *s, *e;
-			unsigned long inode;
-			lnode node;
-			int lnlen;
-
-			if (ent->d_name[0] == '.')
-				continue;
-			snprintf(ln, 256, "%s/%s", buf, ent->d_name);
-			if ((lnlen = readlink(ln, line, sizeof(line)-1)) < 0)
-				continue;
-			line[lnlen] = 0;
-
-			// Only look at the socket entries
-			if (memcmp(line, "socket:", 7) == 0) {
-				// Type 1 sockets
-				s = strchr(line+7, '[');
-				if (s == NULL)
-					continue;
-				s++;
-				e = strchr(s, ']');
-				if (e == NULL)
-					continue;
-				*e = 0;
-			} else if (memcmp(line, "[0000]:", 7) == 0) {
-				// Type 2 sockets
-				s = line + 8;
-			} else
-				continue;
-			errno = 0;
-			inode = strtoul(s, NULL, 10);
-			if (errno)
-				continue;
-			node.pid = pid;
-			node.uid = euid;
-			node.cmd = strdup(cmd);
-			node.inode = inode;
-			// We make one entry for each socket inode
-			list_append(l, &node);
+			node = &idx->nodes[idx->count++];
+			node->pid = pid;
+			node->uid = euid;
+			node->cmd = st->comm;
+			node->inode = sockets[sock_i];
 		}
-		closedir(f);
-		free(text);
 	}
-	closedir(d);
+
+	// Sockets shared by several processes keep the first owner found
+	qsort(idx->nodes, idx->count, sizeof(lnode), lnode_cmp);
 	return 0;
 }
 
-static int eval_data(const char *type, const char *local_address,
-	unsigned int local_port)
+static void index_free(inode_index *idx)
+{
+	free(idx->nodes);
+	oval_proctab_put(idx->proctab);
+}
+
+static int eval_data(const struct server_info *req, const char *type,
+	const char *local_address, unsigned int local_port)
 {
 	SEXP_t *r0;
 
 	r0 = SEXP_string_newf("%s", type);
-	if (probe_entobj_cmp(req.protocol_ent, r0) != OVAL_RESULT_TRUE) {
+	if (probe_entobj_cmp(req->protocol_ent, r0) != OVAL_RESULT_TRUE) {
 		SEXP_free(r0);
 		return 0;
 	}
 	SEXP_free(r0);
 
 	r0 = SEXP_string_newf("%s", local_address);
-	if (probe_entobj_cmp(req.local_address_ent, r0) != OVAL_RESULT_TRUE) {
+	if (probe_entobj_cmp(req->local_address_ent, r0) != OVAL_RESULT_TRUE) {
 		SEXP_free(r0);
 		return 0;
 	}
 	SEXP_free(r0);
 
 	r0 = SEXP_number_newu_32(local_port);
-	if (probe_entobj_cmp(req.local_port_ent, r0) != OVAL_RESULT_TRUE) {
+	if (probe_entobj_cmp(req->local_port_ent, r0) != OVAL_RESULT_TRUE) {
 		SEXP_free(r0);
 		return 0;
 	}
@@ -327,15 +221,10 @@ static int eval_data(const char *type, const char *local_address,
 	return 1;
 }
 
-static void report_finding(struct result_info *res, llist *l, probe_ctx *ctx)
+static void report_finding(struct result_info *res, lnode *n, probe_ctx *ctx)
 {
         SEXP_t *item;
         SEXP_t se_lport_mem, se_rport_mem, se_lfull_mem, se_ffull_mem, *se_uid_mem = NULL;
-	lnode *n = NULL;
-
-	if (l) {
-		n = list_get_cur(l);
-	}
 
 	if (n) {
                 item = probe_item_create(OVAL_LINUX_INET_LISTENING_SERVER, NULL,
@@ -391,7 +280,8 @@ static void addr_convert(const char *src, char *dest, int size)
 }
 
 
-static int read_tcp(const char *proc, const char *type, llist *l, probe_ctx *ctx)
+static int read_tcp(const struct server_info *req, const char *proc, const char *type,
+		    inode_index *l, probe_ctx *ctx)
 {
 	int line = 0;
 	FILE *f;
@@ -421,29 +311,29 @@ static int read_tcp(const char *proc, const char *type, llist *l, probe_ctx *ctx
 			&state, &txq, &rxq, &timer_run, &time_len, &retr,
 			&uid, &timeout, &inode, more);
 
+		if (state != TCP_LISTEN)
+			continue;
+
 		char src[NI_MAXHOST], dest[NI_MAXHOST];
 		addr_convert(local_addr, src, NI_MAXHOST);
 		addr_convert(rem_addr, dest, NI_MAXHOST);
 		dI("Have tcp port: %s:%u", src, local_port);
-		if (eval_data(type, src, local_port)) {
+		if (eval_data(req, type, src, local_port)) {
 			struct result_info r;
 			r.proto = type;
 			r.laddr = src;
 			r.lport = local_port;
 			r.raddr = dest;
 			r.rport = rem_port;
-			if (list_find_inode(l, inode)) {
-				report_finding(&r, l, ctx);
-			} else {
-				report_finding(&r, NULL, ctx);
-			}
+			report_finding(&r, index_find_inode(l, inode), ctx);
 		}
 	}
 	fclose(f);
 	return 0;
 }
 
-static int read_udp(const char *proc, const char *type, llist *l, probe_ctx *ctx)
+static int read_udp(const struct server_info *req, const char *proc, const char *type,
+		    inode_index *l, probe_ctx *ctx)
 {
 	int line = 0;
 	FILE *f;
@@ -476,25 +366,22 @@ static int read_udp(const char *proc, const char *type, llist *l, probe_ctx *ctx
 		addr_convert(local_addr, src, NI_MAXHOST);
 		addr_convert(rem_addr, dest, NI_MAXHOST);
 		dI("Have udp port: %s:%u", src, local_port);
-		if (eval_data(type, src, local_port)) {
+		if (eval_data(req, type, src, local_port)) {
 			struct result_info r;
 			r.proto = type;
 			r.laddr = src;
 			r.lport = local_port;
 			r.raddr = dest;
 			r.rport = rem_port;
-			if (list_find_inode(l, inode)) {
-				report_finding(&r, l, ctx);
-			} else {
-				report_finding(&r, NULL, ctx);
-			}
+			report_finding(&r, index_find_inode(l, inode), ctx);
 		}
 	}
 	fclose(f);
 	return 0;
 }
 
-static int read_raw(const char *proc, const char *type, llist *l, probe_ctx *ctx)
+static int read_raw(const struct server_info *req, const char *proc, const char *type,
+		    inode_index *l, probe_ctx *ctx)
 {
 	int line = 0;
 	FILE *f;
@@ -527,29 +414,160 @@ static int read_raw(const char *proc, const char *type, llist *l, probe_ctx *ctx
 		addr_convert(local_addr, src, NI_MAXHOST);
 		addr_convert(rem_addr, dest, NI_MAXHOST);
 		dI("Have raw port: %s:%u", src, local_port);
-		if (eval_data(type, src, local_port)) {
+		if (eval_data(req, type, src, local_port)) {
 			struct result_info r;
 			r.proto = type;
 			r.laddr = src;
 			r.lport = local_port;
 			r.raddr = dest;
 			r.rport = rem_port;
-			if (list_find_inode(l, inode)) {
-				report_finding(&r, l, ctx);
-			} else {
-				report_finding(&r, NULL, ctx);
-			}
+			report_finding(&r, index_find_inode(l, inode), ctx);
 		}
 	}
 	fclose(f);
 	return 0;
 }
 
+/* A socket reported by the kernel, see read_diag() */
+struct diag_sock {
+	unsigned char family;
+	unsigned short lport;
+	unsigned short rport;
+	uint32_t laddr[4];
+	uint32_t raddr[4];
+	unsigned long inode;
+};
+
+static int diag_dump(int family, int protocol, uint32_t states,
+		     struct diag_sock **socks, size_t *count)
+{
+	struct {
+		struct nlmsghdr nlh;
+		struct inet_diag_req_v2 req;
+	} msg;
+	struct sockaddr_nl sa;
+	struct nlmsghdr *nlh;
+	struct inet_diag_msg *diag;
+	size_t alloc = 0;
+	ssize_t len;
+	long buf[8192 / sizeof(long)];
+	int fd, ret = -1;
+
+	fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+	if (fd < 0)
+		return -1;
+
+	memset(&sa, 0, sizeof sa);
+	sa.nl_family = AF_NETLINK;
+
+	memset(&msg, 0, sizeof msg);
+	msg.nlh.nlmsg_len = sizeof msg;
+	msg.nlh.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+	msg.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+	msg.req.sdiag_family = family;
+	msg.req.sdiag_protocol = protocol;
+	msg.req.idiag_states = states;
+
+	if (sendto(fd, &msg, sizeof msg, 0, (struct sockaddr *)&sa, sizeof sa) < 0)
+		goto cleanup;
+
+	for (;;) {
+		len = recv(fd, buf, sizeof buf, 0);
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			goto cleanup;
+		}
+		if (len == 0)
+			goto cleanup;
+
+		for (nlh = (struct nlmsghdr *)buf; NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len)) {
+			if (nlh->nlmsg_type == NLMSG_DONE) {
+				ret = 0;
+				goto cleanup;
+			}
+			if (nlh->nlmsg_type == NLMSG_ERROR) {
+				/* e.g. the udp_diag module is not available */
+				goto cleanup;
+			}
+			if (nlh->nlmsg_type != SOCK_DIAG_BY_FAMILY)
+				continue;
+
+			diag = NLMSG_DATA(nlh);
+
+			if (*count == alloc) {
+				struct diag_sock *tmp;
+
+				alloc = alloc > 0 ? alloc * 2 : 64;
+				tmp = realloc(*socks, alloc * sizeof(struct diag_sock));
+				if (tmp == NULL)
+					goto cleanup;
+				*socks = tmp;
+			}
+
+			(*socks)[*count].family = diag->idiag_family;
+			(*socks)[*count].lport = ntohs(diag->id.idiag_sport);
+			(*socks)[*count].rport = ntohs(diag->id.idiag_dport);
+			memcpy((*socks)[*count].laddr, diag->id.idiag_src, sizeof(diag->id.idiag_src));
+			memcpy((*socks)[*count].raddr, diag->id.idiag_dst, sizeof(diag->id.idiag_dst));
+			(*socks)[*count].inode = diag->idiag_inode;
+			++(*count);
+		}
+	}
+cleanup:
+	close(fd);
+	return ret;
+}
+
+/*
+ * Ask the kernel for the sockets using NETLINK_SOCK_DIAG, which spares
+ * parsing the /proc/net tables. TCP sockets are filtered to the listening
+ * ones by the kernel. Returns -1 without reporting anything if the kernel
+ * can't answer, the caller then reads the /proc/net table.
+ */
+static int read_diag(const struct server_info *req, int family, int protocol, const char *type,
+		     inode_index *l, probe_ctx *ctx)
+{
+	struct diag_sock *socks = NULL;
+	size_t count = 0, i;
+	uint32_t states;
+
+	states = (protocol == IPPROTO_TCP) ? (1 << TCP_LISTEN) : ~0U;
+
+	if (diag_dump(family, protocol, states, &socks, &count) != 0) {
+		dI("Can't dump the %s sockets using netlink, reading /proc/net.", type);
+		free(socks);
+		return -1;
+	}
+
+	for (i = 0; i < count; ++i) {
+		char src[NI_MAXHOST], dest[NI_MAXHOST];
+
+		inet_ntop(socks[i].family, socks[i].laddr, src, NI_MAXHOST);
+		inet_ntop(socks[i].family, socks[i].raddr, dest, NI_MAXHOST);
+		dI("Have %s port: %s:%u", type, src, socks[i].lport);
+		if (eval_data(req, type, src, socks[i].lport)) {
+			struct result_info r;
+			r.proto = type;
+			r.laddr = src;
+			r.lport = socks[i].lport;
+			r.raddr = dest;
+			r.rport = socks[i].rport;
+			report_finding(&r, index_find_inode(l, socks[i].inode), ctx);
+		}
+	}
+
+	free(socks);
+	return 0;
+}
+
 int probe_main(probe_ctx *ctx, void *arg)
 {
         SEXP_t *object;
 	int err;
-	llist ll;
+	inode_index idx = { NULL, NULL, 0 };
+	/* the objects of a probe may be collected concurrently, keep it local */
+	struct server_info req = { NULL, NULL, NULL };
 
         object = probe_ctx_getobject(ctx);
 
@@ -572,8 +590,7 @@ int probe_main(probe_ctx *ctx, void *arg)
 	}
 
 	// Now start collecting the info
-	list_create(&ll);
-	if (collect_process_info(&ll)) {
+	if (collect_process_info(&idx) != 0) {
 		SEXP_t *msg;
 
 		msg = probe_msg_creat(OVAL_MESSAGE_LEVEL_ERROR, "Permission error.");
@@ -586,22 +603,25 @@ int probe_main(probe_ctx *ctx, void *arg)
 	}
 
 	// Now we check the tcp socket list...
-	read_tcp("/proc/net/tcp", "tcp", &ll, ctx);
-	read_tcp("/proc/net/tcp6", "tcp", &ll, ctx);
+	if (read_diag(&req, AF_INET, IPPROTO_TCP, "tcp", &idx, ctx) != 0)
+		read_tcp(&req, "/proc/net/tcp", "tcp", &idx, ctx);
+	if (read_diag(&req, AF_INET6, IPPROTO_TCP, "tcp", &idx, ctx) != 0)
+		read_tcp(&req, "/proc/net/tcp6", "tcp", &idx, ctx);
 
 	// Next udp sockets...
-	read_udp("/proc/net/udp", "udp", &ll, ctx);
-	read_udp("/proc/net/udp6", "udp", &ll, ctx);
+	if (read_diag(&req, AF_INET, IPPROTO_UDP, "udp", &idx, ctx) != 0)
+		read_udp(&req, "/proc/net/udp", "udp", &idx, ctx);
+	if (read_diag(&req, AF_INET6, IPPROTO_UDP, "udp", &idx, ctx) != 0)
+		read_udp(&req, "/proc/net/udp6", "udp", &idx, ctx);
 
 	// Next, raw sockets...not exactly part of standard yet. They
 	// can be used to send datagrams, so we will pretend they are udp
-	read_raw("/proc/net/raw", "udp", &ll, ctx);
-	read_raw("/proc/net/raw6", "udp", &ll, ctx);
-
-	list_clear(&ll);
+	read_raw(&req, "/proc/net/raw", "udp", &idx, ctx);
+	read_raw(&req, "/proc/net/raw6", "udp", &idx, ctx);
 
 	err = 0;
  cleanup:
+	index_free(&idx);
 	SEXP_vfree(req.protocol_ent, req.local_address_ent, req.local_port_ent, NULL);
 
 	return err;
@@ -56,6 +56,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
 #include <limits.h>
 #include <sys/statvfs.h>
 #include <probe-api.h>
@@ -144,38 +148,319 @@ static void add_mnt_opt(char ***mnt_opts, uint8_t mnt_ocnt, char *opt)
 	(*mnt_opts)[mnt_ocnt] = NULL;
 }
 
+/*
+ * The mounts are read once per probe: many partition objects of a content
+ * would otherwise read the whole table and look up the UUIDs again.
+ */
+struct partition_mount {
+        char *dir;
+        char *fsname;
+        char *type;
+        char *opts;
+        char *uuid; /* NULL until looked up */
+};
+
+static struct {
+        pthread_mutex_t         lock;
+        bool                    loaded;
+        int                     error; /* of the read of the table */
+        struct partition_mount *mounts;
+        size_t                  count;
+#if defined(HAVE_BLKID_GET_TAG_VALUE)
+        blkid_cache             blkcache;
+#endif
+} g_mounts = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+#define PARTITION_STATVFS_THREADS 8
+#define PARTITION_TIMEOUT_ENV     "OSCAP_PARTITION_TIMEOUT"
+#define PARTITION_TIMEOUT_DEFAULT 10 /* seconds */
+
+static int partition_mounts_read(void)
+{
+        char buffer[MTAB_LINE_MAX];
+        struct mntent mnt_ent, *mnt_entp;
+        struct partition_mount *mnt;
+        size_t size = 0;
+        FILE *mnt_fp;
+#if defined(PROC_CHECK) && defined(__linux__)
+        int   mnt_fd;
+        struct statfs stfs;
+
+        mnt_fd = open(MTAB_PATH, O_RDONLY);
+
+        if (mnt_fd < 0)
+                return (PROBE_ESYSTEM);
+
+        if (fstatfs(mnt_fd, &stfs) != 0) {
+                close(mnt_fd);
+                return (PROBE_ESYSTEM);
+        }
+
+        if (stfs.f_type != PROC_SUPER_MAGIC) {
+                close(mnt_fd);
+                return (PROBE_EFATAL);
+        }
+
+        mnt_fp = fdopen(mnt_fd, "r");
+
+        if (mnt_fp == NULL) {
+                close(mnt_fd);
+                return (PROBE_ESYSTEM);
+        }
+#else
+        mnt_fp = fopen(MTAB_PATH, "r");
+
+        if (mnt_fp == NULL)
+                return (PROBE_ESYSTEM);
+#endif
+#if defined(HAVE_BLKID_GET_TAG_VALUE)
+        if (blkid_get_cache(&g_mounts.blkcache, NULL) != 0) {
+                g_mounts.blkcache = NULL;
+                endmntent(mnt_fp);
+                return (PROBE_EUNKNOWN);
+        }
+#endif
+        while ((mnt_entp = getmntent_r(mnt_fp, &mnt_ent,
+                                       buffer, sizeof buffer)) != NULL)
+        {
+                if (strcmp(mnt_entp->mnt_type, "rootfs") == 0)
+                        continue;
+
+                if (g_mounts.count == size) {
+                        size = size == 0 ? 32 : size * 2;
+                        g_mounts.mounts = oscap_realloc(g_mounts.mounts, sizeof(struct partition_mount) * size);
+                }
+
+                mnt = &g_mounts.mounts[g_mounts.count++];
+                mnt->dir    = oscap_strdup(mnt_entp->mnt_dir);
+                mnt->fsname = oscap_strdup(mnt_entp->mnt_fsname);
+                mnt->type   = oscap_strdup(mnt_entp->mnt_type);
+                mnt->opts   = oscap_strdup(mnt_entp->mnt_opts);
+                mnt->uuid   = NULL;
+        }
+
+        endmntent(mnt_fp);
+        dI("Read %zu mounts from %s.", g_mounts.count, MTAB_PATH);
+
+        return (0);
+}
+
+/* The UUID of the device of a mount, "" if it has none */
+static const char *partition_mount_uuid(struct partition_mount *mnt)
+{
 #if defined(HAVE_BLKID_GET_TAG_VALUE)
-static int collect_item(probe_ctx *ctx, oval_schema_version_t over, struct mntent *mnt_ent, blkid_cache blkcache)
+        char *uuid;
+
+        /* the cache of blkid isn't thread-safe */
+        pthread_mutex_lock(&g_mounts.lock);
+
+        if (mnt->uuid == NULL) {
+                uuid = blkid_get_tag_value(g_mounts.blkcache, "UUID", mnt->fsname);
+                mnt->uuid = uuid != NULL ? uuid : oscap_strdup("");
+        }
+
+        pthread_mutex_unlock(&g_mounts.lock);
+
+        return (mnt->uuid);
 #else
-static int collect_item(probe_ctx *ctx, oval_schema_version_t over, struct mntent *mnt_ent)
+        return ("");
 #endif
+}
+
+/*
+ * The statvfs() calls of an object run in parallel. A hung mount, e.g. an
+ * unreachable NFS server, can't be interrupted, so the probe stops waiting
+ * for it and the thread which called it frees the job when it returns.
+ */
+struct partition_statvfs_job {
+        pthread_mutex_t lock;
+        pthread_cond_t  cond;
+        unsigned int    refs;
+        bool            abandoned;
+        size_t          count;
+        size_t          next;
+        size_t          done;
+        char          **dirs;
+        struct statvfs *stvfs;
+        int            *state; /* 0 pending, 1 done, -1 failed */
+};
+
+/* Called with the lock of the job held, releases it */
+static void partition_statvfs_job_unref(struct partition_statvfs_job *job)
 {
-        SEXP_t *item;
-        char   *uuid = "", *tok, *save = NULL, **mnt_opts = NULL;
-        uint8_t mnt_ocnt;
+        size_t i;
+
+        if (--job->refs > 0) {
+                pthread_mutex_unlock(&job->lock);
+                return;
+        }
+
+        pthread_mutex_unlock(&job->lock);
+        pthread_mutex_destroy(&job->lock);
+        pthread_cond_destroy(&job->cond);
+
+        for (i = 0; i < job->count; ++i)
+                oscap_free(job->dirs[i]);
+
+        oscap_free(job->dirs);
+        oscap_free(job->stvfs);
+        oscap_free(job->state);
+        oscap_free(job);
+}
+
+static void *partition_statvfs_thread(void *arg)
+{
+        struct partition_statvfs_job *job = arg;
         struct statvfs stvfs;
+        size_t i;
+        int    ret;
 
-        /*
-         * Get FS stats
-         */
-        if (statvfs(mnt_ent->mnt_dir, &stvfs) != 0)
-                return (-1);
+        pthread_mutex_lock(&job->lock);
+
+        while (!job->abandoned && job->next < job->count) {
+                i = job->next++;
+                pthread_mutex_unlock(&job->lock);
+
+                ret = statvfs(job->dirs[i], &stvfs);
+
+                pthread_mutex_lock(&job->lock);
+                job->stvfs[i] = stvfs;
+                job->state[i] = ret == 0 ? 1 : -1;
+                job->done++;
+                pthread_cond_signal(&job->cond);
+        }
+
+        partition_statvfs_job_unref(job);
+
+        return (NULL);
+}
+
+static time_t partition_statvfs_timeout(void)
+{
+        const char *env;
+        char *end;
+        long timeout;
+
+        env = getenv(PARTITION_TIMEOUT_ENV);
+
+        if (env == NULL || *env == '\0')
+                return (PARTITION_TIMEOUT_DEFAULT);
+
+        timeout = strtol(env, &end, 10);
+
+        if (*end != '\0' || timeout <= 0) {
+                dW("Invalid value of %s: '%s', using %d seconds.", PARTITION_TIMEOUT_ENV, env, PARTITION_TIMEOUT_DEFAULT);
+                return (PARTITION_TIMEOUT_DEFAULT);
+        }
+
+        return ((time_t)timeout);
+}
+
+/*
+ * Fills stvfs and state (1 done, -1 failed, 0 timed out) of every mount.
+ * The mounts which don't answer within the timeout since the last one
+ * that did are given up.
+ */
+static void partition_statvfs(struct partition_mount **mnts, size_t count, struct statvfs *stvfs, int *state)
+{
+        struct partition_statvfs_job *job;
+        struct timespec deadline;
+        pthread_attr_t attr;
+        pthread_t tid;
+        time_t timeout;
+        size_t i, threads, done;
+        int    err;
+
+        if (count == 0)
+                return;
+
+        job = oscap_calloc(1, sizeof(struct partition_statvfs_job));
+        pthread_mutex_init(&job->lock, NULL);
+        pthread_cond_init(&job->cond, NULL);
+        job->refs  = 1;
+        job->count = count;
+        job->dirs  = oscap_alloc(sizeof(char *) * count);
+        job->stvfs = oscap_calloc(count, sizeof(struct statvfs));
+        job->state = oscap_calloc(count, sizeof(int));
+
+        /* the job may outlive the snapshot of the mounts */
+        for (i = 0; i < count; ++i)
+                job->dirs[i] = oscap_strdup(mnts[i]->dir);
+
+        threads = count < PARTITION_STATVFS_THREADS ? count : PARTITION_STATVFS_THREADS;
+        timeout = partition_statvfs_timeout();
+
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        pthread_mutex_lock(&job->lock);
+
+        for (i = 0; i < threads; ++i) {
+                job->refs++;
+
+                if ((err = pthread_create(&tid, &attr, &partition_statvfs_thread, job)) != 0) {
+                        dW("Can't start a statvfs thread: %s.", strerror(err));
+                        job->refs--;
+                        break;
+                }
+        }
+
+        pthread_attr_destroy(&attr);
+
+        if (i == 0) {
+                /* no thread, call them here without a timeout */
+                pthread_mutex_unlock(&job->lock);
+
+                for (i = 0; i < count; ++i)
+                        state[i] = statvfs(job->dirs[i], &stvfs[i]) == 0 ? 1 : -1;
+
+                pthread_mutex_lock(&job->lock);
+                partition_statvfs_job_unref(job);
+                return;
+        }
+
+        done = 0;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += timeout;
+
+        while (job->done < count) {
+                if (pthread_cond_timedwait(&job->cond, &job->lock, &deadline) == ETIMEDOUT
+                    && job->done == done)
+                        break;
+
+                if (job->done != done) {
+                        done = job->done;
+                        clock_gettime(CLOCK_REALTIME, &deadline);
+                        deadline.tv_sec += timeout;
+                }
+        }
+
+        job->abandoned = true;
+        memcpy(stvfs, job->stvfs, sizeof(struct statvfs) * count);
+        memcpy(state, job->state, sizeof(int) * count);
+
+        partition_statvfs_job_unref(job);
+}
+
+static int collect_item(probe_ctx *ctx, oval_schema_version_t over, struct partition_mount *mnt, const struct statvfs *stvfs)
+{
+        SEXP_t *item;
+        const char *uuid, *type;
+        char   *opts, *tok, *save = NULL, **mnt_opts = NULL;
+        uint8_t mnt_ocnt;
+        int     ret;
 
         /*
          * Get UUID
          */
-#if defined(HAVE_BLKID_GET_TAG_VALUE)
-        uuid = blkid_get_tag_value(blkcache, "UUID", mnt_ent->mnt_fsname);
-        if (uuid == NULL) {
-	        uuid = "";
-        }
-#endif
+        uuid = partition_mount_uuid(mnt);
+
         /*
          * Create a NULL-terminated array from the mount options
          */
         mnt_ocnt = 0;
+        opts = oscap_strdup(mnt->opts);
 
-        tok = strtok_r(mnt_ent->mnt_opts, ",", &save);
+        tok = strtok_r(opts, ",", &save);
 
         do {
             add_mnt_opt(&mnt_opts, ++mnt_ocnt, tok);
@@ -186,13 +471,13 @@ static int collect_item(probe_ctx *ctx, oval_schema_version_t over, struct mnten
          * These options can't be found in /proc/mounts,
          * we must use flags got by statvfs().
          */
-        if (stvfs.f_flag & MS_REMOUNT) {
+        if (stvfs->f_flag & MS_REMOUNT) {
             add_mnt_opt(&mnt_opts, ++mnt_ocnt, "remount");
         }
-        if (stvfs.f_flag & MS_BIND) {
+        if (stvfs->f_flag & MS_BIND) {
             add_mnt_opt(&mnt_opts, ++mnt_ocnt, "bind");
         }
-        if (stvfs.f_flag & MS_MOVE) {
+        if (stvfs->f_flag & MS_MOVE) {
             add_mnt_opt(&mnt_opts, ++mnt_ocnt, "move");
         }
 
@@ -202,21 +487,23 @@ static int collect_item(probe_ctx *ctx, oval_schema_version_t over, struct mnten
 	 * "Correct" the type (this won't be (hopefully) needed in a later version
 	 * of OVAL)
 	 */
+        type = mnt->type;
+
         if (oval_schema_version_cmp(over, OVAL_SCHEMA_VERSION(5.10)) < 0)
-	        mnt_ent->mnt_type = (char *)correct_fstype(mnt_ent->mnt_type);
+	        type = correct_fstype(mnt->type);
 
         /*
          * Create the item
          */
         item = probe_item_create(OVAL_LINUX_PARTITION, NULL,
-                                 "mount_point",   OVAL_DATATYPE_STRING,   mnt_ent->mnt_dir,
-                                 "device",        OVAL_DATATYPE_STRING,   mnt_ent->mnt_fsname,
+                                 "mount_point",   OVAL_DATATYPE_STRING,   mnt->dir,
+                                 "device",        OVAL_DATATYPE_STRING,   mnt->fsname,
                                  "uuid",          OVAL_DATATYPE_STRING,   uuid,
-                                 "fs_type",       OVAL_DATATYPE_STRING,   mnt_ent->mnt_type,
+                                 "fs_type",       OVAL_DATATYPE_STRING,   type,
                                  "mount_options", OVAL_DATATYPE_STRING_M, mnt_opts,
-                                 "total_space",   OVAL_DATATYPE_INTEGER, (int64_t)stvfs.f_blocks,
-                                 "space_used",    OVAL_DATATYPE_INTEGER, (int64_t)(stvfs.f_blocks - stvfs.f_bfree),
-                                 "space_left",    OVAL_DATATYPE_INTEGER, (int64_t)stvfs.f_bfree,
+                                 "total_space",   OVAL_DATATYPE_INTEGER, (int64_t)stvfs->f_blocks,
+                                 "space_used",    OVAL_DATATYPE_INTEGER, (int64_t)(stvfs->f_blocks - stvfs->f_bfree),
+                                 "space_left",    OVAL_DATATYPE_INTEGER, (int64_t)stvfs->f_bfree,
                                  NULL);
 
 #if defined(HAVE_BLKID_GET_TAG_VALUE)
@@ -233,10 +520,11 @@ static int collect_item(probe_ctx *ctx, oval_schema_version_t over, struct mnten
 	probe_itement_setstatus(item, "uuid", 1, SYSCHAR_STATUS_NOT_COLLECTED);
 #endif /* HAVE_BLKID_GET_TAG_VALUE */
 
-        probe_item_collect(ctx, item);
+        ret = probe_item_collect(ctx, item);
         oscap_free(mnt_opts);
+        oscap_free(opts);
 
-        return (0);
+        return (ret == 2 ? 1 : 0);
 }
 
 void *probe_init(void)
@@ -246,53 +534,55 @@ void *probe_init(void)
 	return (NULL);
 }
 
-int probe_main(probe_ctx *ctx, void *probe_arg)
+void probe_fini(void *arg)
 {
-        int probe_ret = 0;
-        SEXP_t *mnt_entity, *mnt_opval, *mnt_entval, *probe_in;
-        char    mnt_path[PATH_MAX];
-        oval_operation_t mnt_op;
-        FILE *mnt_fp;
-        oval_schema_version_t obj_over;
-#if defined(PROC_CHECK) && defined(__linux__)
-        int   mnt_fd;
-        struct statfs stfs;
+        size_t i;
 
-        mnt_fd = open(MTAB_PATH, O_RDONLY);
-
-        if (mnt_fd < 0)
-                return (PROBE_ESYSTEM);
+        pthread_mutex_lock(&g_mounts.lock);
 
-        if (fstatfs(mnt_fd, &stfs) != 0) {
-                close(mnt_fd);
-                return (PROBE_ESYSTEM);
+        for (i = 0; i < g_mounts.count; ++i) {
+                oscap_free(g_mounts.mounts[i].dir);
+                oscap_free(g_mounts.mounts[i].fsname);
+                oscap_free(g_mounts.mounts[i].type);
+                oscap_free(g_mounts.mounts[i].opts);
+                /* allocated by blkid or by oscap_strdup(), both with malloc() */
+                free(g_mounts.mounts[i].uuid);
         }
 
-        if (stfs.f_type != PROC_SUPER_MAGIC) {
-                close(mnt_fd);
-                return (PROBE_EFATAL);
+        oscap_free(g_mounts.mounts);
+        g_mounts.mounts = NULL;
+        g_mounts.count  = 0;
+        g_mounts.loaded = false;
+#if defined(HAVE_BLKID_GET_TAG_VALUE)
+        if (g_mounts.blkcache != NULL) {
+                blkid_put_cache(g_mounts.blkcache);
+                g_mounts.blkcache = NULL;
         }
+#endif
+        pthread_mutex_unlock(&g_mounts.lock);
+}
 
-        mnt_fp = fdopen(mnt_fd, "r");
-
-        if (mnt_fp == NULL) {
-                close(mnt_fd);
-                return (PROBE_ESYSTEM);
-        }
-#else
-        mnt_fp = fopen(MTAB_PATH, "r");
+int probe_main(probe_ctx *ctx, void *probe_arg)
+{
+        int probe_ret = 0;
+        SEXP_t *mnt_entity, *mnt_opval, *mnt_entval, *probe_in;
+        char    mnt_path[PATH_MAX];
+        oval_operation_t mnt_op;
+        oval_schema_version_t obj_over;
+        struct partition_mount **matched;
+        struct statvfs *stvfs;
+        int    *state;
+        size_t  i, count;
+        pcre *re = NULL;
+        const char *estr = NULL;
+        int eoff = -1;
 
-        if (mnt_fp == NULL)
-                return (PROBE_ESYSTEM);
-#endif
         probe_in   = probe_ctx_getobject(ctx);
         obj_over   = probe_obj_get_platform_schema_version(probe_in);
         mnt_entity = probe_obj_getent(probe_in, "mount_point", 1);
 
-        if (mnt_entity == NULL) {
-                fclose(mnt_fp);
+        if (mnt_entity == NULL)
                 return (PROBE_ENOENT);
-        }
 
         mnt_opval = probe_ent_getattrval(mnt_entity, "operation");
 
@@ -307,7 +597,6 @@ int probe_main(probe_ctx *ctx, void *probe_arg)
         if (!SEXP_stringp(mnt_entval)) {
                 SEXP_free(mnt_entval);
                 SEXP_free(mnt_entity);
-		fclose(mnt_fp);
                 return (PROBE_EINVAL);
         }
 
@@ -315,81 +604,93 @@ int probe_main(probe_ctx *ctx, void *probe_arg)
         SEXP_free(mnt_entval);
         SEXP_free(mnt_entity);
 
-        if (mnt_fp != NULL) {
-                char buffer[MTAB_LINE_MAX];
-                struct mntent mnt_ent, *mnt_entp;
+        if (mnt_op == OVAL_OPERATION_PATTERN_MATCH) {
+                re = pcre_compile(mnt_path, PCRE_UTF8, &estr, &eoff, NULL);
 
-                pcre *re = NULL;
-                const char *estr = NULL;
-                int eoff = -1;
-#if defined(HAVE_BLKID_GET_TAG_VALUE)
-                blkid_cache blkcache;
+                if (re == NULL)
+                        return (PROBE_EINVAL);
+        }
 
-                if (blkid_get_cache(&blkcache, NULL) != 0) {
-                        endmntent(mnt_fp);
-                        return (PROBE_EUNKNOWN);
-                }
-#endif
-                if (mnt_op == OVAL_OPERATION_PATTERN_MATCH) {
-                        re = pcre_compile(mnt_path, PCRE_UTF8, &estr, &eoff, NULL);
+        pthread_mutex_lock(&g_mounts.lock);
 
-                        if (re == NULL) {
-                                endmntent(mnt_fp);
-                                return (PROBE_EINVAL);
+        if (!g_mounts.loaded) {
+                g_mounts.error  = partition_mounts_read();
+                g_mounts.loaded = true;
+        }
+
+        pthread_mutex_unlock(&g_mounts.lock);
+
+        if (g_mounts.error != 0) {
+                if (re != NULL)
+                        pcre_free(re);
+                return (g_mounts.error);
+        }
+
+        /* the snapshot doesn't change once read */
+        matched = oscap_alloc(sizeof(struct partition_mount *) * (g_mounts.count + 1));
+        count   = 0;
+
+        for (i = 0; i < g_mounts.count; ++i) {
+                struct partition_mount *mnt = &g_mounts.mounts[i];
+
+                if (mnt_op == OVAL_OPERATION_EQUALS) {
+                        if (strcmp(mnt->dir, mnt_path) == 0) {
+                                matched[count++] = mnt;
+                                break;
+                        }
+                } else if (mnt_op == OVAL_OPERATION_NOT_EQUAL) {
+                        if (strcmp(mnt->dir, mnt_path) != 0)
+                                matched[count++] = mnt;
+                } else if (mnt_op == OVAL_OPERATION_PATTERN_MATCH) {
+                        int rc;
+
+                        rc = pcre_exec(re, NULL, mnt->dir,
+                                       strlen(mnt->dir), 0, 0, NULL, 0);
+
+                        /* the number of the substrings, or 0 if they don't fit */
+                        if (rc >= 0) {
+                                matched[count++] = mnt;
+                        } else if (rc != PCRE_ERROR_NOMATCH) {
+                                SEXP_t *msg;
+
+                                dE("pcre_exec() failed to match '%s' with the mount point pattern, return code %d.",
+                                   mnt->dir, rc);
+                                msg = probe_msg_creatf(OVAL_MESSAGE_LEVEL_ERROR,
+                                                       "Can't match the mount point '%s' with the pattern '%s', "
+                                                       "pcre_exec() returned %d.", mnt->dir, mnt_path, rc);
+                                probe_cobj_add_msg(probe_ctx_getresult(ctx), msg);
+                                SEXP_free(msg);
+                                probe_cobj_set_flag(probe_ctx_getresult(ctx), SYSCHAR_FLAG_ERROR);
+                                break;
                         }
                 }
+        }
 
-                while ((mnt_entp = getmntent_r(mnt_fp, &mnt_ent,
-                                               buffer, sizeof buffer)) != NULL)
-                {
-			if (strcmp(mnt_entp->mnt_type, "rootfs") == 0)
-			    continue;
+        if (re != NULL)
+                pcre_free(re);
 
-                        if (mnt_op == OVAL_OPERATION_EQUALS) {
-                                if (strcmp(mnt_entp->mnt_dir, mnt_path) == 0) {
-#if defined(HAVE_BLKID_GET_TAG_VALUE)
-	                                collect_item(ctx, obj_over, mnt_entp, blkcache);
-#else
-	                                collect_item(ctx, obj_over, mnt_entp);
-#endif
-                                        break;
-                                }
-			} else if (mnt_op == OVAL_OPERATION_NOT_EQUAL) {
-				if (strcmp(mnt_entp->mnt_dir, mnt_path) != 0) {
-					if (
-#if defined(HAVE_BLKID_GET_TAG_VALUE)
-						collect_item(ctx, obj_over, mnt_entp, blkcache)
-#else
-						collect_item(ctx, obj_over, mnt_entp)
-#endif
-					!= 0)
-						break;
-                                }
-                        } else if (mnt_op == OVAL_OPERATION_PATTERN_MATCH) {
-                                int rc;
+        stvfs = oscap_alloc(sizeof(struct statvfs) * (count + 1));
+        state = oscap_calloc(count + 1, sizeof(int));
 
-                                rc = pcre_exec(re, NULL, mnt_entp->mnt_dir,
-                                               strlen(mnt_entp->mnt_dir), 0, 0, NULL, 0);
+        partition_statvfs(matched, count, stvfs, state);
 
-                                if (rc == 0) {
-	                                if (
-#if defined(HAVE_BLKID_GET_TAG_VALUE)
-		                                collect_item(ctx, obj_over, mnt_entp, blkcache)
-#else
-		                                collect_item(ctx, obj_over, mnt_entp)
-#endif
-                                        != 0)
-		                                break;
-                                }
-                                /* XXX: check for pcre_exec error */
-                        }
+        for (i = 0; i < count; ++i) {
+                if (state[i] == 0) {
+                        dW("statvfs(%s) didn't return in time, the mount is skipped.", matched[i]->dir);
+                        continue;
                 }
 
-                endmntent(mnt_fp);
+                /* a failed statvfs() ends the collection, as it always did */
+                if (state[i] < 0)
+                        break;
 
-                if (mnt_op == OVAL_OPERATION_PATTERN_MATCH)
-                        pcre_free(re);
+                if (collect_item(ctx, obj_over, matched[i], &stvfs[i]) != 0)
+                        break;
         }
 
+        oscap_free(state);
+        oscap_free(stvfs);
+        oscap_free(matched);
+
         return (probe_ret);
 }
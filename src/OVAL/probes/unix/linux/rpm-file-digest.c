@@ -0,0 +1,178 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <rpm/rpmpgp.h>
+#include <crapi/crapi.h>
+
+#include "rpm-helper.h"
+#include "rpm-file-digest.h"
+
+bool rpm_file_digest_enabled(void)
+{
+	const char *env;
+
+	env = getenv(RPM_FILE_DIGEST_ENV);
+
+	return (env != NULL && *env != '\0' && strcmp(env, "0") != 0);
+}
+
+#ifdef HAVE_RPM47
+static struct rpm_probe_global g_rpm;
+static pthread_once_t g_rpm_once = PTHREAD_ONCE_INIT;
+static bool g_rpm_ready = false;
+
+/* opened on the first use, after the probe changed its root directory */
+static void rpm_file_digest_open(void)
+{
+	addMacro(NULL, "_dbpath", NULL, getenv("OSCAP_PROBE_RPMDB_PATH"), 0);
+	rpmlogSetCallback(rpmErrorCb, NULL);
+
+	if (rpmReadConfigFiles((const char *)NULL, (const char *)NULL) != 0) {
+		dW("rpmReadConfigFiles failed, the package digests are not used.");
+		return;
+	}
+
+	g_rpm.rpmts = rpmtsCreate();
+	pthread_mutex_init(&g_rpm.mutex, NULL);
+	g_rpm_ready = true;
+}
+
+static int rpm_file_digest_alg(int pgpalgo)
+{
+	switch (pgpalgo) {
+	case PGPHASHALGO_MD5:
+		return CRAPI_DIGEST_MD5;
+	case PGPHASHALGO_SHA1:
+		return CRAPI_DIGEST_SHA1;
+	case PGPHASHALGO_SHA224:
+		return CRAPI_DIGEST_SHA224;
+	case PGPHASHALGO_SHA256:
+		return CRAPI_DIGEST_SHA256;
+	case PGPHASHALGO_SHA384:
+		return CRAPI_DIGEST_SHA384;
+	case PGPHASHALGO_SHA512:
+		return CRAPI_DIGEST_SHA512;
+	default:
+		return -1;
+	}
+}
+
+static bool rpm_file_digest_match(rpmfi fi, rpm_time_t installtime, const struct stat *st,
+				  int alg, void *dst, size_t *size)
+{
+	const unsigned char *digest;
+	size_t diglen;
+	int algo;
+
+	if (rpmfiFFlags(fi) & RPMFILE_GHOST)
+		return (false);
+
+	if ((mode_t)rpmfiFMode(fi) != st->st_mode
+	    || (off_t)rpmfiFSize(fi) != st->st_size
+	    || (time_t)rpmfiFMtime(fi) != st->st_mtime
+	    || st->st_ctime > (time_t)installtime + RPM_FILE_DIGEST_CTIME_SLACK)
+		return (false);
+
+	digest = rpmfiFDigest(fi, &algo, &diglen);
+
+	if (digest == NULL || rpm_file_digest_alg(algo) != alg || diglen > *size)
+		return (false);
+
+	memcpy(dst, digest, diglen);
+	*size = diglen;
+
+	return (true);
+}
+
+bool rpm_file_digest_get(const char *path, const struct stat *st, int alg, void *dst, size_t *size)
+{
+	rpmdbMatchIterator match;
+	rpm_time_t installtime;
+	Header pkgh;
+	rpmfi  fi;
+	bool   found = false;
+
+	if (!S_ISREG(st->st_mode))
+		return (false);
+
+	pthread_once(&g_rpm_once, &rpm_file_digest_open);
+
+	if (!g_rpm_ready)
+		return (false);
+
+	pthread_mutex_lock(&g_rpm.mutex);
+
+	/* the packages which own the path, from the index of the file names */
+	match = rpmtsInitIterator(g_rpm.rpmts, RPMTAG_BASENAMES, path, 0);
+
+	while (!found && match != NULL && (pkgh = rpmdbNextIterator(match)) != NULL) {
+		installtime = (rpm_time_t)headerGetNumber(pkgh, RPMTAG_INSTALLTIME);
+		fi = rpmfiNew(g_rpm.rpmts, pkgh, RPMTAG_BASENAMES, 1);
+
+		while (rpmfiNext(fi) != -1) {
+			if (strcmp(rpmfiFN(fi), path) == 0) {
+				found = rpm_file_digest_match(fi, installtime, st, alg, dst, size);
+				break;
+			}
+		}
+
+		rpmfiFree(fi);
+	}
+
+	if (match != NULL)
+		rpmdbFreeIterator(match);
+
+	pthread_mutex_unlock(&g_rpm.mutex);
+
+	return (found);
+}
+
+void rpm_file_digest_fini(void)
+{
+	if (!g_rpm_ready)
+		return;
+
+	rpmtsFree(g_rpm.rpmts);
+	rpmFreeCrypto();
+	rpmFreeRpmrc();
+	rpmFreeMacros(NULL);
+	rpmlogClose();
+	pthread_mutex_destroy(&g_rpm.mutex);
+	g_rpm_ready = false;
+}
+#else
+bool rpm_file_digest_get(const char *path, const struct stat *st, int alg, void *dst, size_t *size)
+{
+	/* rpmfiFDigest() is not available */
+	return (false);
+}
+
+void rpm_file_digest_fini(void)
+{
+	return;
+}
+#endif
@@ -0,0 +1,67 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __RPM_FILE_DIGEST__
+#define __RPM_FILE_DIGEST__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/stat.h>
+
+/*
+ * Digests of the package files from the rpm database
+ *
+ * Most of the files a digest is asked for are owned by a package, and the
+ * rpm database has their digests already. If OSCAP_TRUST_PACKAGE_DIGESTS
+ * is set in the environment, the digest of a regular file is taken from
+ * the header of its package, without reading the file, when:
+ *
+ *  - its mode, size and mtime are those of the header, as with
+ *    "rpm -V --nofiledigest",
+ *  - its inode didn't change after the package was installed, i.e. its
+ *    ctime is at most RPM_FILE_DIGEST_CTIME_SLACK seconds newer than the
+ *    install time of the package, and
+ *  - the header stores a digest of the requested algorithm.
+ *
+ * A file rewritten in place and given back its size and mtime gets a new
+ * ctime, which user space can't set back, so it is read. The mode trusts
+ * the rpm database, "--no-hash-cache" (strict mode) turns it off.
+ */
+#define RPM_FILE_DIGEST_ENV         "OSCAP_TRUST_PACKAGE_DIGESTS"
+#define RPM_FILE_DIGEST_CTIME_SLACK 3600
+
+bool rpm_file_digest_enabled(void);
+
+/**
+ * Look up the digest of an unmodified package file.
+ * @param path the path of the file in the scanned root
+ * @param st the stat data of the file
+ * @param alg the crapi_alg_t of the digest
+ * @param size the size of dst on input, the length of the digest on output
+ * @return true if the digest was found
+ */
+bool rpm_file_digest_get(const char *path, const struct stat *st, int alg, void *dst, size_t *size);
+
+/**
+ * Close the rpm database, if it was opened.
+ */
+void rpm_file_digest_fini(void);
+
+#endif
@@ -0,0 +1,203 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <elf.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <rpm/rpmpgp.h>
+#include <crapi/crapi.h>
+#include <crapi/digest.h>
+
+#include "oval_hash_cache.h"
+#include "rpm-hash-cache.h"
+
+#ifdef HAVE_RPM47
+static pthread_once_t crapi_once = PTHREAD_ONCE_INIT;
+static int crapi_ok = -1;
+
+static void rpm_hash_cache_crapi_init(void)
+{
+	crapi_ok = crapi_init(NULL);
+}
+
+static int rpm_hash_cache_alg(int pgpalgo)
+{
+	switch (pgpalgo) {
+	case PGPHASHALGO_MD5:
+		return CRAPI_DIGEST_MD5;
+	case PGPHASHALGO_SHA1:
+		return CRAPI_DIGEST_SHA1;
+	case PGPHASHALGO_SHA224:
+		return CRAPI_DIGEST_SHA224;
+	case PGPHASHALGO_SHA256:
+		return CRAPI_DIGEST_SHA256;
+	case PGPHASHALGO_SHA384:
+		return CRAPI_DIGEST_SHA384;
+	case PGPHASHALGO_SHA512:
+		return CRAPI_DIGEST_SHA512;
+	default:
+		return -1;
+	}
+}
+
+/*
+ * rpmVerifyFile() undoes the prelinking of an ELF file before it computes
+ * the digest if %__prelink_undo_cmd is set. The digest of the file as it
+ * is would differ, so such files are left to rpmVerifyFile() and their
+ * digests are not cached. Called with librpm, from one thread only.
+ */
+static bool rpm_hash_cache_prelinked(const char *path)
+{
+	static int prelink = -1;
+	unsigned char magic[SELFMAG];
+	ssize_t n;
+	int fd;
+
+	if (prelink < 0) {
+		char *cmd = rpmExpand("%{?__prelink_undo_cmd}", NULL);
+
+		prelink = cmd != NULL && *cmd != '\0';
+		free(cmd);
+	}
+
+	if (!prelink || (fd = open(path, O_RDONLY)) < 0)
+		return (false);
+
+	n = pread(fd, magic, sizeof magic, 0);
+	close(fd);
+
+	return (n == sizeof magic && memcmp(magic, ELFMAG, SELFMAG) == 0);
+}
+
+int rpmVerifyFileDeferDigest(const rpmts ts, rpmfi fi, rpmVerifyAttrs *res, rpmVerifyAttrs omit,
+			     const char *path, struct rpm_file_digest *dig)
+{
+	const unsigned char *digest;
+	size_t diglen;
+	int algo, alg, ret;
+
+	dig->alg = -1;
+
+	if ((omit & RPMVERIFY_MD5) || !S_ISREG(rpmfiFMode(fi)))
+		return rpmVerifyFile(ts, fi, res, omit);
+
+	digest = rpmfiFDigest(fi, &algo, &diglen);
+
+	if (digest == NULL || diglen > sizeof dig->digest || (alg = rpm_hash_cache_alg(algo)) < 0)
+		return rpmVerifyFile(ts, fi, res, omit);
+
+	pthread_once(&crapi_once, &rpm_hash_cache_crapi_init);
+
+	if (crapi_ok != 0 || rpm_hash_cache_prelinked(path))
+		return rpmVerifyFile(ts, fi, res, omit);
+
+	/* everything but the digest */
+	if ((ret = rpmVerifyFile(ts, fi, res, omit | RPMVERIFY_MD5)) != 0)
+		return (ret);
+
+	dig->path = path;
+	dig->alg  = alg;
+	dig->len  = diglen;
+	memcpy(dig->digest, digest, diglen);
+
+	return (0);
+}
+
+void rpmVerifyFileDigest(const struct rpm_file_digest *dig, rpmVerifyAttrs *res)
+{
+	uint8_t fdigest[64];
+	size_t  fdigestlen;
+	struct stat st, st_after;
+	int fd;
+
+	if (dig->alg < 0)
+		return;
+
+	fd = open(dig->path, O_RDONLY);
+
+	if (fd < 0 || fstat(fd, &st) != 0) {
+		*res |= RPMVERIFY_READFAIL | RPMVERIFY_MD5;
+		goto out;
+	}
+
+	fdigestlen = sizeof fdigest;
+
+	if (!S_ISREG(st.st_mode) || !oval_hash_cache_get(&st, dig->alg, fdigest, &fdigestlen)) {
+		fdigestlen = sizeof fdigest;
+
+		if (crapi_digest_fd(fd, dig->alg, fdigest, &fdigestlen) != 0) {
+			*res |= RPMVERIFY_READFAIL | RPMVERIFY_MD5;
+			goto out;
+		}
+
+		if (S_ISREG(st.st_mode) && fstat(fd, &st_after) == 0
+		    && !oval_hash_cache_stat_changed(&st, &st_after))
+			oval_hash_cache_put(&st, dig->alg, fdigest, fdigestlen);
+	}
+
+	if (fdigestlen != dig->len || memcmp(fdigest, dig->digest, dig->len) != 0)
+		*res |= RPMVERIFY_MD5;
+out:
+	if (fd >= 0)
+		close(fd);
+}
+
+int rpmVerifyFileHashCache(const rpmts ts, rpmfi fi, rpmVerifyAttrs *res, rpmVerifyAttrs omit)
+{
+	struct rpm_file_digest dig;
+	int ret;
+
+	if (!oval_hash_cache_enabled())
+		return rpmVerifyFile(ts, fi, res, omit);
+
+	if ((ret = rpmVerifyFileDeferDigest(ts, fi, res, omit, rpmfiFN(fi), &dig)) != 0)
+		return (ret);
+
+	rpmVerifyFileDigest(&dig, res);
+
+	return (0);
+}
+#else
+int rpmVerifyFileHashCache(const rpmts ts, rpmfi fi, rpmVerifyAttrs *res, rpmVerifyAttrs omit)
+{
+	/* rpmfiFDigest() is not available */
+	return rpmVerifyFile(ts, fi, res, omit);
+}
+
+int rpmVerifyFileDeferDigest(const rpmts ts, rpmfi fi, rpmVerifyAttrs *res, rpmVerifyAttrs omit,
+			     const char *path, struct rpm_file_digest *dig)
+{
+	dig->alg = -1;
+	return rpmVerifyFile(ts, fi, res, omit);
+}
+
+void rpmVerifyFileDigest(const struct rpm_file_digest *dig, rpmVerifyAttrs *res)
+{
+	return;
+}
+#endif
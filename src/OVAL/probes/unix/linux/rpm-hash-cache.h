@@ -0,0 +1,64 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef __RPM_HASH_CACHE__
+#define __RPM_HASH_CACHE__
+
+#include "rpm-helper.h"
+#include <rpm/rpmcli.h>
+
+/**
+ * rpmVerifyFile() which reuses the digest of an unchanged file from the
+ * hash cache (see oval_hash_cache.h) instead of reading the file, and
+ * stores the digests it computes there. Without the cache, or if the
+ * digest is omitted, this is just rpmVerifyFile().
+ *
+ * If rpm undoes the prelinking (%__prelink_undo_cmd is set), the ELF
+ * files are verified by rpmVerifyFile() and their digests aren't cached.
+ */
+int rpmVerifyFileHashCache(const rpmts ts, rpmfi fi, rpmVerifyAttrs *res, rpmVerifyAttrs omit);
+
+/**
+ * Expected digest of a file, checked by rpmVerifyFileDigest().
+ */
+struct rpm_file_digest {
+	const char *path;
+	int alg;     /**< crapi_alg_t, -1 if there is nothing to check */
+	size_t len;
+	unsigned char digest[64];
+};
+
+/**
+ * Like rpmVerifyFileHashCache(), but the digest is not checked here. If
+ * it can be checked without librpm, it is stored in dig and the caller
+ * completes *res using rpmVerifyFileDigest(), possibly in another thread.
+ * Otherwise dig->alg is set to -1 and *res is complete.
+ * @param path the file name, must be valid until the digest is checked
+ */
+int rpmVerifyFileDeferDigest(const rpmts ts, rpmfi fi, rpmVerifyAttrs *res, rpmVerifyAttrs omit,
+			     const char *path, struct rpm_file_digest *dig);
+
+/**
+ * Compute or look up the digest of dig->path and set RPMVERIFY_MD5 in
+ * *res if it differs. Doesn't use librpm, so it may be called from any
+ * thread.
+ */
+void rpmVerifyFileDigest(const struct rpm_file_digest *dig, rpmVerifyAttrs *res);
+
+#endif
@@ -0,0 +1,283 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "rpm-verify-queue.h"
+
+/* queued results per thread */
+#define RPM_VERIFY_QUEUE_DEPTH 16
+
+struct rpm_verify_job {
+	void *res;
+	rpmVerifyAttrs vflags;
+	struct rpm_file_digest dig;
+	bool done;
+};
+
+struct rpm_verify_queue {
+	pthread_mutex_t mutex;
+	pthread_cond_t  work_cond; /* a job was queued, or stop */
+	pthread_cond_t  done_cond; /* a job was done */
+
+	struct rpm_verify_job *jobs;
+	size_t   depth;
+	size_t   res_size;
+	/* sequence numbers of the jobs: emitted < head <= work <= tail */
+	uint64_t head;
+	uint64_t work;
+	uint64_t tail;
+	bool     stop;
+
+	pthread_t   *threads;
+	unsigned int nthreads;
+
+	rpm_verify_emit_t emit;
+	void (*release)(void *res);
+	void *arg;
+};
+
+unsigned int rpm_verify_threads(void)
+{
+	const char *env;
+	unsigned long n;
+	char *end;
+
+	env = getenv(RPM_VERIFY_THREADS_ENV);
+
+	if (env == NULL || *env == '\0')
+		return (0);
+
+	n = strtoul(env, &end, 10);
+
+	if (*end != '\0') {
+		dW("Invalid value of %s: '%s', using a single thread.", RPM_VERIFY_THREADS_ENV, env);
+		return (0);
+	}
+
+	return (n > RPM_VERIFY_THREADS_MAX ? RPM_VERIFY_THREADS_MAX : (unsigned int)n);
+}
+
+static void *rpm_verify_worker(void *arg)
+{
+	struct rpm_verify_queue *q = arg;
+	struct rpm_verify_job *job;
+	rpmVerifyAttrs vflags;
+
+	pthread_mutex_lock(&q->mutex);
+
+	for (;;) {
+		/* jobs done when queued may have been emitted already */
+		if (q->work < q->head)
+			q->work = q->head;
+
+		if (q->stop)
+			break;
+
+		if (q->work == q->tail) {
+			pthread_cond_wait(&q->work_cond, &q->mutex);
+			continue;
+		}
+
+		job = &q->jobs[q->work++ % q->depth];
+
+		if (job->done)
+			continue;
+
+		vflags = job->vflags;
+		pthread_mutex_unlock(&q->mutex);
+
+		rpmVerifyFileDigest(&job->dig, &vflags);
+
+		pthread_mutex_lock(&q->mutex);
+		job->vflags = vflags;
+		job->done = true;
+		pthread_cond_broadcast(&q->done_cond);
+	}
+
+	pthread_mutex_unlock(&q->mutex);
+
+	return (NULL);
+}
+
+struct rpm_verify_queue *rpm_verify_queue_new(unsigned int threads, size_t res_size,
+					      rpm_verify_emit_t emit, void (*release)(void *res), void *arg)
+{
+	struct rpm_verify_queue *q;
+	size_t i;
+	int err;
+
+	q = calloc(1, sizeof *q);
+
+	if (q == NULL)
+		return (NULL);
+
+	q->depth    = (size_t)threads * RPM_VERIFY_QUEUE_DEPTH;
+	q->res_size = res_size;
+	q->emit     = emit;
+	q->release  = release;
+	q->arg      = arg;
+	q->jobs     = calloc(q->depth, sizeof(struct rpm_verify_job));
+	q->threads  = calloc(threads, sizeof(pthread_t));
+
+	if (q->jobs == NULL || q->threads == NULL)
+		goto fail;
+
+	for (i = 0; i < q->depth; ++i) {
+		if ((q->jobs[i].res = malloc(res_size)) == NULL)
+			goto fail;
+	}
+
+	pthread_mutex_init(&q->mutex, NULL);
+	pthread_cond_init(&q->work_cond, NULL);
+	pthread_cond_init(&q->done_cond, NULL);
+
+	for (q->nthreads = 0; q->nthreads < threads; ++q->nthreads) {
+		if ((err = pthread_create(&q->threads[q->nthreads], NULL, &rpm_verify_worker, q)) != 0) {
+			dE("Can't create a verify thread: %s.", strerror(err));
+			rpm_verify_queue_free(q);
+			return (NULL);
+		}
+	}
+
+	dI("Verifying files using %u threads.", threads);
+
+	return (q);
+fail:
+	if (q->jobs != NULL) {
+		for (i = 0; i < q->depth; ++i)
+			free(q->jobs[i].res);
+	}
+	free(q->jobs);
+	free(q->threads);
+	free(q);
+
+	return (NULL);
+}
+
+/* wait for the oldest job and emit it, called with the mutex locked */
+static int rpm_verify_queue_emit(struct rpm_verify_queue *q)
+{
+	struct rpm_verify_job *job;
+	int ret;
+
+	job = &q->jobs[q->head % q->depth];
+
+	while (!job->done)
+		pthread_cond_wait(&q->done_cond, &q->mutex);
+
+	/* the slot is not reused until head moves */
+	pthread_mutex_unlock(&q->mutex);
+	ret = q->emit(q->arg, job->res, job->vflags);
+
+	if (q->release != NULL)
+		q->release(job->res);
+
+	pthread_mutex_lock(&q->mutex);
+	++q->head;
+
+	return (ret);
+}
+
+int rpm_verify_queue_push(struct rpm_verify_queue *q, const void *res, rpmVerifyAttrs vflags,
+			  const struct rpm_file_digest *dig)
+{
+	struct rpm_verify_job *job;
+	int ret = 0;
+
+	pthread_mutex_lock(&q->mutex);
+
+	if (q->tail - q->head == q->depth) {
+		if ((ret = rpm_verify_queue_emit(q)) != 0) {
+			pthread_mutex_unlock(&q->mutex);
+			return (ret);
+		}
+	}
+
+	job = &q->jobs[q->tail % q->depth];
+	memcpy(job->res, res, q->res_size);
+	job->vflags = vflags;
+	job->dig    = *dig;
+	job->done   = (dig->alg < 0);
+	++q->tail;
+
+	if (!job->done)
+		pthread_cond_signal(&q->work_cond);
+
+	pthread_mutex_unlock(&q->mutex);
+
+	return (0);
+}
+
+int rpm_verify_queue_finish(struct rpm_verify_queue *q)
+{
+	int ret = 0;
+
+	pthread_mutex_lock(&q->mutex);
+
+	while (q->head < q->tail) {
+		if ((ret = rpm_verify_queue_emit(q)) != 0)
+			break;
+	}
+
+	pthread_mutex_unlock(&q->mutex);
+
+	return (ret);
+}
+
+void rpm_verify_queue_free(struct rpm_verify_queue *q)
+{
+	size_t i;
+
+	if (q == NULL)
+		return;
+
+	pthread_mutex_lock(&q->mutex);
+	q->stop = true;
+	pthread_cond_broadcast(&q->work_cond);
+	pthread_mutex_unlock(&q->mutex);
+
+	for (i = 0; i < q->nthreads; ++i)
+		pthread_join(q->threads[i], NULL);
+
+	for (; q->head < q->tail; ++q->head) {
+		if (q->release != NULL)
+			q->release(q->jobs[q->head % q->depth].res);
+	}
+
+	for (i = 0; i < q->depth; ++i)
+		free(q->jobs[i].res);
+
+	pthread_cond_destroy(&q->work_cond);
+	pthread_cond_destroy(&q->done_cond);
+	pthread_mutex_destroy(&q->mutex);
+	free(q->jobs);
+	free(q->threads);
+	free(q);
+}
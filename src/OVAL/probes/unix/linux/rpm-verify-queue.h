@@ -0,0 +1,83 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef __RPM_VERIFY_QUEUE__
+#define __RPM_VERIFY_QUEUE__
+
+#include <stddef.h>
+#include "rpm-hash-cache.h"
+
+/*
+ * Number of threads which check the file digests for the rpmverify and
+ * rpmverifyfile probes. The files are verified one at a time if the
+ * variable isn't set or is lower than 2. The items are collected in the
+ * same order either way.
+ */
+#define RPM_VERIFY_THREADS_ENV "OSCAP_RPMVERIFY_THREADS"
+#define RPM_VERIFY_THREADS_MAX 64
+
+/*
+ * Bounded queue of file verification results. The caller verifies the
+ * attributes of a file that need librpm with rpmVerifyFileDeferDigest()
+ * and pushes the result, the digests are checked by the worker threads
+ * and the results are handed back to the emit callback in the calling
+ * thread, in the order they were pushed.
+ */
+struct rpm_verify_queue;
+
+/**
+ * Called for every result in the thread which pushes the results.
+ * @param res the copy of the result passed to rpm_verify_queue_push()
+ * @param vflags the verify flags, including the digest check
+ * @return 0 to continue, anything else to stop
+ */
+typedef int (*rpm_verify_emit_t)(void *arg, void *res, rpmVerifyAttrs vflags);
+
+/**
+ * Return the number of threads set by RPM_VERIFY_THREADS_ENV, or 0.
+ */
+unsigned int rpm_verify_threads(void);
+
+/**
+ * @param res_size size of the result structure copied by rpm_verify_queue_push()
+ * @param release called for every result after it was emitted or discarded, may be NULL
+ * @return the queue, or NULL if the threads can't be created
+ */
+struct rpm_verify_queue *rpm_verify_queue_new(unsigned int threads, size_t res_size,
+					      rpm_verify_emit_t emit, void (*release)(void *res), void *arg);
+
+/**
+ * Queue a result. If the queue is full, the oldest result is emitted first.
+ * @return 0, or the value returned by the emit callback which stopped
+ */
+int rpm_verify_queue_push(struct rpm_verify_queue *q, const void *res, rpmVerifyAttrs vflags,
+			  const struct rpm_file_digest *dig);
+
+/**
+ * Wait for and emit all queued results.
+ * @return 0, or the value returned by the emit callback which stopped
+ */
+int rpm_verify_queue_finish(struct rpm_verify_queue *q);
+
+/**
+ * Stop the threads and release the results which weren't emitted.
+ */
+void rpm_verify_queue_free(struct rpm_verify_queue *q);
+
+#endif
@@ -58,6 +58,8 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <regex.h>
+#include <stdbool.h>
+#include <stdlib.h>
 
 /* RPM headers */
 #include "rpm-helper.h"
@@ -71,6 +73,7 @@
 #include <alloc.h>
 #include <common/assume.h>
 #include "common/debug_priv.h"
+#include "OVAL/probes/oval_pkg_index.h"
 
 
 struct rpminfo_req {
@@ -87,6 +90,19 @@ struct rpminfo_rep {
         char *evr;
         char *signature_keyid;
 	char extended_name[1024];
+	unsigned int instance; /* rpmdb header instance */
+	char **files;          /* loaded on first use, see collect_rpm_files() */
+	size_t files_count;
+	bool files_loaded;
+};
+
+/*
+ * All installed packages, read once by probe_init() and sorted by name
+ * so that the objects don't have to query the rpmdb each time.
+ */
+struct rpminfo_index {
+	struct rpminfo_rep *pkgs;
+	size_t count;
 };
 
 #define RPMINFO_LOCK	RPM_MUTEX_LOCK(&g_rpm.mutex)
@@ -96,6 +112,7 @@ struct rpminfo_rep {
 static struct rpm_probe_global g_rpm;
 static const char g_keyid_regex_string[] = "Key ID [a-fA-F0-9]{16}";
 static regex_t g_keyid_regex;
+static struct rpminfo_index g_index;
 
 static void __rpminfo_rep_free (struct rpminfo_rep *ptr)
 {
@@ -106,24 +123,18 @@ static void __rpminfo_rep_free (struct rpminfo_rep *ptr)
         oscap_free (ptr->version);
         oscap_free (ptr->evr);
         oscap_free (ptr->signature_keyid);
+
+	while (ptr->files_count > 0)
+		oscap_free(ptr->files[--ptr->files_count]);
+	oscap_free(ptr->files);
 }
 
-static void pkgh2rep (Header h, struct rpminfo_rep *r)
+/* the extended name and the EVR string of a package with its name, arch, epoch, version and release set */
+static void rpminfo_rep_finish(struct rpminfo_rep *r)
 {
-        errmsg_t rpmerr;
-        char *str, *sid;
-	char *epoch_override = NULL;
-        size_t len;
-	regmatch_t keyid_match[1];
-
-        assume_d (h != NULL, /* void */);
-        assume_d (r != NULL, /* void */);
+	char *str, *epoch_override;
+	size_t len;
 
-        r->name = headerFormat (h, "%{NAME}", &rpmerr);
-        r->arch = headerFormat (h, "%{ARCH}", &rpmerr);
-        r->epoch = headerFormat (h, "%{EPOCH}", &rpmerr);
-        r->release = headerFormat (h, "%{RELEASE}", &rpmerr);
-        r->version = headerFormat (h, "%{VERSION}", &rpmerr);
 	epoch_override = oscap_streq(r->epoch, "(none)") ? "0" : r->epoch;
 	snprintf(r->extended_name, 1024, "%s-%s:%s-%s.%s", r->name, epoch_override, r->version, r->release, r->arch);
 
@@ -138,6 +149,23 @@ static void pkgh2rep (Header h, struct rpminfo_rep *r)
                   r->release);
 
         r->evr = str;
+}
+
+static void pkgh2rep (Header h, struct rpminfo_rep *r)
+{
+        errmsg_t rpmerr;
+        char *str, *sid;
+	regmatch_t keyid_match[1];
+
+        assume_d (h != NULL, /* void */);
+        assume_d (r != NULL, /* void */);
+
+        r->name = headerFormat (h, "%{NAME}", &rpmerr);
+        r->arch = headerFormat (h, "%{ARCH}", &rpmerr);
+        r->epoch = headerFormat (h, "%{EPOCH}", &rpmerr);
+        r->release = headerFormat (h, "%{RELEASE}", &rpmerr);
+        r->version = headerFormat (h, "%{VERSION}", &rpmerr);
+	rpminfo_rep_finish(r);
 
         str = headerFormat (h, "%|SIGGPG?{%{SIGGPG:pgpsig}}:{%{SIGPGP:pgpsig}}|", &rpmerr);
 
@@ -162,104 +190,203 @@ static void pkgh2rep (Header h, struct rpminfo_rep *r)
         oscap_free (str);
 }
 
-/*
- * req - Structure containing the name of the package.
- * rep - Pointer to rpminfo_rep structure pointer. An
- *       array of rpminfo_rep structures will be allocated
- *       here.
- *
- * The return value on error is -1. Otherwise the number of
- * rpminfo_rep structures allocated in *rep is returned.
- */
-static int get_rpminfo (struct rpminfo_req *req, struct rpminfo_rep **rep)
+static int rpminfo_rep_cmp(const void *a, const void *b)
+{
+	const struct rpminfo_rep *ra = a, *rb = b;
+	int cmp;
+
+	cmp = strcmp(ra->name, rb->name);
+
+	if (cmp != 0)
+		return cmp;
+
+	/* keep the rpmdb order of packages with the same name */
+	return (ra->instance > rb->instance) - (ra->instance < rb->instance);
+}
+
+static void rpminfo_index_free(struct rpminfo_index *idx)
+{
+	while (idx->count > 0)
+		__rpminfo_rep_free(&idx->pkgs[--idx->count]);
+
+	oscap_free(idx->pkgs);
+	idx->pkgs = NULL;
+}
+
+/* one package per line, in the index order */
+static int rpminfo_index_write(FILE *fp, void *arg)
+{
+	struct rpminfo_index *idx = arg;
+	struct rpminfo_rep *r;
+	size_t i;
+
+	for (i = 0; i < idx->count; ++i) {
+		r = &idx->pkgs[i];
+		fprintf(fp, "%u\t%s\t%s\t%s\t%s\t%s\t%s\n", r->instance, r->name, r->arch,
+			r->epoch, r->version, r->release, r->signature_keyid);
+	}
+
+	return ferror(fp) ? -1 : 0;
+}
+
+static int rpminfo_index_read(struct rpminfo_index *idx, FILE *fp)
+{
+	struct rpminfo_rep *r;
+	char *line = NULL, *field[7], *p;
+	size_t linesize = 0, alloc = 0;
+	ssize_t len;
+	int i;
+
+	while ((len = getline(&line, &linesize, fp)) > 0) {
+		if (line[len - 1] == '\n')
+			line[len - 1] = '\0';
+
+		for (i = 0, p = line; i < 7 && p != NULL; ++i) {
+			field[i] = p;
+			if ((p = strchr(p, '\t')) != NULL)
+				*p++ = '\0';
+		}
+
+		if (i != 7 || p != NULL) {
+			dW("Malformed line in the package index.");
+			free(line);
+			rpminfo_index_free(idx);
+			return -1;
+		}
+
+		if (idx->count == alloc) {
+			alloc = alloc > 0 ? alloc * 2 : 512;
+			idx->pkgs = oscap_realloc(idx->pkgs, sizeof(struct rpminfo_rep) * alloc);
+		}
+
+		r = &idx->pkgs[idx->count++];
+		memset(r, 0, sizeof(struct rpminfo_rep));
+		r->instance = (unsigned int)strtoul(field[0], NULL, 10);
+		r->name = oscap_strdup(field[1]);
+		r->arch = oscap_strdup(field[2]);
+		r->epoch = oscap_strdup(field[3]);
+		r->version = oscap_strdup(field[4]);
+		r->release = oscap_strdup(field[5]);
+		r->signature_keyid = oscap_strdup(field[6]);
+		rpminfo_rep_finish(r);
+	}
+
+	free(line);
+	return 0;
+}
+
+static int rpminfo_index_build(struct rpminfo_index *idx)
 {
 	rpmdbMatchIterator match;
 	Header pkgh;
-	int ret = 0, i;
+	size_t alloc = 0;
+	char stamp[OVAL_PKG_INDEX_STAMPLEN], *dbpath;
+	bool stamped = false;
+	FILE *fp;
+
+	idx->pkgs = NULL;
+	idx->count = 0;
+
+	/* another probe may have read this rpmdb already */
+	if (oval_pkg_index_enabled()) {
+		dbpath = rpmExpand("%{_dbpath}", NULL);
+		stamped = dbpath != NULL && oval_pkg_index_stamp(dbpath, stamp) == 0;
+		free(dbpath);
+
+		if (stamped && (fp = oval_pkg_index_open("rpminfo", stamp)) != NULL) {
+			int ret = rpminfo_index_read(idx, fp);
+
+			fclose(fp);
+			if (ret == 0) {
+				dI("Read %zu packages from the package index.", idx->count);
+				return 0;
+			}
+		}
+	}
 
-        RPMINFO_LOCK;
+	match = rpmtsInitIterator(g_rpm.rpmts, RPMDBI_PACKAGES, NULL, 0);
 
-        ret = -1;
+	if (match == NULL)
+		return 0;
 
-        switch (req->op) {
-        case OVAL_OPERATION_EQUALS:
-                match = rpmtsInitIterator (g_rpm.rpmts, RPMTAG_NAME, (const void *)req->name, 0);
+	while ((pkgh = rpmdbNextIterator(match)) != NULL) {
+		if (idx->count == alloc) {
+			alloc = alloc > 0 ? alloc * 2 : 512;
+			idx->pkgs = oscap_realloc(idx->pkgs, sizeof(struct rpminfo_rep) * alloc);
+		}
 
-                if (match == NULL) {
-                        ret = 0;
-                        goto ret;
-                }
+		memset(&idx->pkgs[idx->count], 0, sizeof(struct rpminfo_rep));
+		pkgh2rep(pkgh, &idx->pkgs[idx->count]);
+		idx->pkgs[idx->count].instance = rpmdbGetIteratorOffset(match);
+		++idx->count;
+	}
 
-                ret = rpmdbGetIteratorCount (match);
+	rpmdbFreeIterator(match);
 
-                break;
-	case OVAL_OPERATION_NOT_EQUAL:
-                match = rpmtsInitIterator (g_rpm.rpmts, RPMDBI_PACKAGES, NULL, 0);
-                if (match == NULL) {
-                        ret = 0;
-                        goto ret;
-                }
+	if (idx->count > 1)
+		qsort(idx->pkgs, idx->count, sizeof(struct rpminfo_rep), rpminfo_rep_cmp);
 
-                if (rpmdbSetIteratorRE (match, RPMTAG_NAME, RPMMIRE_GLOB, "*") != 0)
-                {
-                        ret = -1;
-                        goto ret;
-                }
+	dI("Indexed %zu packages.", idx->count);
 
-                break;
-        case OVAL_OPERATION_PATTERN_MATCH:
-                match = rpmtsInitIterator (g_rpm.rpmts, RPMDBI_PACKAGES, NULL, 0);
+	if (stamped)
+		oval_pkg_index_save("rpminfo", stamp, rpminfo_index_write, idx);
 
-                if (match == NULL) {
-                        ret = 0;
-                        goto ret;
-                }
+	return 0;
+}
 
-                if (rpmdbSetIteratorRE (match, RPMTAG_NAME, RPMMIRE_REGEX,
-                                        (const char *)req->name) != 0)
-                {
-                        ret = -1;
-                        goto ret;
-                }
+/*
+ * req - Structure containing the name of the package.
+ * rep - Pointer to an array of pointers to the matching packages of
+ *       the index. The array is allocated here, the packages belong
+ *       to the index.
+ *
+ * The return value on error is -1. Otherwise the number of
+ * packages stored in *rep is returned. Packages found using
+ * the pattern match or not equal operation still have to be
+ * checked using probe_entobj_match_str().
+ */
+static int get_rpminfo (struct rpminfo_req *req, struct rpminfo_rep ***rep)
+{
+	size_t lo, hi, mid, i;
 
-                break;
-        default:
-                /* not supported */
-                ret = -1;
-                goto ret;
-        }
+	switch (req->op) {
+	case OVAL_OPERATION_EQUALS:
+		lo = 0;
+		hi = g_index.count;
 
-        if (ret != -1) {
-                /*
-                 * We can allocate all memory needed now because we know the number
-                 * of results.
-                 */
-                (*rep) = oscap_realloc (*rep, sizeof (struct rpminfo_rep) * ret);
-
-                for (i = 0; i < ret; ++i) {
-                        pkgh = rpmdbNextIterator (match);
-
-                        if (pkgh != NULL)
-                                pkgh2rep (pkgh, (*rep) + i);
-                        else {
-                                /* XXX: emit warning */
-                                break;
-                        }
-                }
-        } else {
-                ret = 0;
+		while (lo < hi) {
+			mid = lo + (hi - lo) / 2;
 
-                while ((pkgh = rpmdbNextIterator (match)) != NULL) {
-                        (*rep) = oscap_realloc (*rep, sizeof (struct rpminfo_rep) * ++ret);
-                        assume_r (*rep != NULL, -1);
-                        pkgh2rep (pkgh, (*rep) + (ret - 1));
-                }
-        }
+			if (strcmp(g_index.pkgs[mid].name, req->name) < 0)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+
+		for (hi = lo; hi < g_index.count; ++hi)
+			if (strcmp(g_index.pkgs[hi].name, req->name) != 0)
+				break;
+
+		break;
+	case OVAL_OPERATION_NOT_EQUAL:
+	case OVAL_OPERATION_PATTERN_MATCH:
+		lo = 0;
+		hi = g_index.count;
+		break;
+	default:
+		/* not supported */
+		return (-1);
+	}
+
+	if (hi == lo)
+		return (0);
+
+	(*rep) = oscap_alloc(sizeof(struct rpminfo_rep *) * (hi - lo));
 
-	match = rpmdbFreeIterator (match);
-ret:
-        RPMINFO_UNLOCK;
-        return (ret);
+	for (i = lo; i < hi; ++i)
+		(*rep)[i - lo] = &g_index.pkgs[i];
+
+	return (int)(hi - lo);
 }
 
 void probe_preload ()
@@ -270,6 +397,8 @@ void probe_preload ()
 void *probe_init (void)
 {
 	probe_setoption(PROBEOPT_OFFLINE_MODE_SUPPORTED, PROBE_OFFLINE_CHROOT|PROBE_OFFLINE_RPMDB);
+	probe_setoption(PROBEOPT_RESULT_CACHING, true);
+	probe_setoption(PROBEOPT_VARREF_VECTOR, true);
 	addMacro(NULL, "_dbpath", NULL, getenv("OSCAP_PROBE_RPMDB_PATH"), 0);
 
 #ifdef HAVE_RPM46
@@ -288,6 +417,11 @@ void *probe_init (void)
 		return NULL;
 	}
 
+	if (rpminfo_index_build(&g_index) != 0) {
+		dE("Can't read the installed packages.");
+		return NULL;
+	}
+
         return ((void *)&g_rpm);
 }
 
@@ -302,44 +436,25 @@ void probe_fini (void *ptr)
         rpmlogClose();
         pthread_mutex_destroy (&(r->mutex));
 	regfree(&g_keyid_regex);
+	rpminfo_index_free(&g_index);
 
         return;
 }
 
-static int collect_rpm_files(SEXP_t *item, const struct rpminfo_rep *rep) {
-	SEXP_t *value;
+static int load_rpm_files(struct rpminfo_rep *rep)
+{
 	rpmdbMatchIterator ts;
 	Header pkgh;
 	rpmfi fi;
 	rpmTag tag[2] = { RPMTAG_BASENAMES, RPMTAG_DIRNAMES };
-	int i, ret = 0;
+	size_t alloc = 0;
+	int i;
 
-	ts = rpmtsInitIterator(g_rpm.rpmts, RPMDBI_PACKAGES, NULL, 0);
+	ts = rpmtsInitIterator(g_rpm.rpmts, RPMDBI_PACKAGES, &rep->instance, sizeof rep->instance);
 	if (ts == NULL) {
 		return -1;
 	}
 
-	if (rpmdbSetIteratorRE(ts, RPMTAG_NAME, RPMMIRE_STRCMP, rep->name) != 0) {
-		ret = -1;
-		goto cleanup;
-	}
-	if (rpmdbSetIteratorRE(ts, RPMTAG_EPOCH, RPMMIRE_STRCMP, rep->epoch) != 0) {
-		ret = -1;
-		goto cleanup;
-	}
-	if (rpmdbSetIteratorRE(ts, RPMTAG_VERSION, RPMMIRE_STRCMP, rep->version) != 0) {
-		ret = -1;
-		goto cleanup;
-	}
-	if (rpmdbSetIteratorRE(ts, RPMTAG_RELEASE, RPMMIRE_STRCMP, rep->release) != 0) {
-		ret = -1;
-		goto cleanup;
-	}
-	if (rpmdbSetIteratorRE(ts, RPMTAG_ARCH, RPMMIRE_STRCMP, rep->arch) != 0) {
-		ret = -1;
-		goto cleanup;
-	}
-
 	while ((pkgh = rpmdbNextIterator(ts)) != NULL) {
 		/*
 		 * Inspect package files & directories
@@ -348,35 +463,152 @@ static int collect_rpm_files(SEXP_t *item, const struct rpminfo_rep *rep) {
 			fi = rpmfiNew(g_rpm.rpmts, pkgh, tag[i], 1);
 
 			while (rpmfiNext(fi) != -1) {
-				const char *filepath;
-				filepath = rpmfiFN(fi);
-				value = probe_entval_from_cstr(
-						OVAL_DATATYPE_STRING,
-						filepath,
-						strlen(filepath)
-						);
-				if (value != NULL) {
-					probe_item_ent_add(item, "filepath", NULL, value);
-					SEXP_free(value);
+				if (rep->files_count == alloc) {
+					alloc = alloc > 0 ? alloc * 2 : 64;
+					rep->files = oscap_realloc(rep->files, sizeof(char *) * alloc);
 				}
+				rep->files[rep->files_count++] = oscap_strdup(rpmfiFN(fi));
 			}
 			rpmfiFree(fi);
 		}
 
 	}
-cleanup:
+
 	ts = rpmdbFreeIterator(ts);
+	rep->files_loaded = true;
+	return 0;
+}
+
+static int collect_rpm_files(SEXP_t *item, struct rpminfo_rep *rep) {
+	SEXP_t *value;
+	size_t i;
+	int ret = 0;
+
+	RPMINFO_LOCK;
+
+	if (!rep->files_loaded && load_rpm_files(rep) != 0) {
+		ret = -1;
+		goto cleanup;
+	}
+
+	for (i = 0; i < rep->files_count; ++i) {
+		value = probe_entval_from_cstr(
+				OVAL_DATATYPE_STRING,
+				rep->files[i],
+				strlen(rep->files[i])
+				);
+		if (value != NULL) {
+			probe_item_ent_add(item, "filepath", NULL, value);
+			SEXP_free(value);
+		}
+	}
+cleanup:
+	RPMINFO_UNLOCK;
 	return ret;
 }
 
-int probe_main (probe_ctx *ctx, void *arg)
+static int rpminfo_collect(probe_ctx *ctx, probe_entobj_t *ent, struct rpminfo_req *req, bool *collected)
 {
-	SEXP_t *val, *item, *ent, *probe_in;
+	SEXP_t *probe_in, *item, *name;
 	oval_schema_version_t over;
+	struct rpminfo_rep **reply_st;
 	int rpmret, i;
 
-        struct rpminfo_req request_st;
-        struct rpminfo_rep *reply_st;
+	probe_in = probe_ctx_getobject(ctx);
+	over = probe_obj_get_platform_schema_version(probe_in);
+	reply_st = NULL;
+
+	/* get info from RPM db */
+	switch (rpmret = get_rpminfo (req, &reply_st)) {
+	case 0: /* Not found */
+		dI("Package \"%s\" not found.", req->name);
+		break;
+	case -1: /* Error */
+		dI("get_rpminfo failed");
+
+		item = probe_item_create(OVAL_LINUX_RPM_INFO, NULL,
+					 "name", OVAL_DATATYPE_STRING, req->name,
+					 NULL);
+
+		probe_item_setstatus (item, SYSCHAR_STATUS_ERROR);
+		probe_item_collect(ctx, item);
+		break;
+	default: /* Ok */
+		_A(rpmret   >= 0);
+		_A(reply_st != NULL);
+
+		for (i = 0; i < rpmret; ++i) {
+			/* the package matched an other value of the name already */
+			if (collected[reply_st[i] - g_index.pkgs])
+				continue;
+
+			if (probe_entobj_match_str(ent, reply_st[i]->name) != OVAL_RESULT_TRUE)
+				continue;
+
+			name = SEXP_string_newf("%s", reply_st[i]->name);
+
+			item = probe_item_create(OVAL_LINUX_RPM_INFO, NULL,
+						 "name",    OVAL_DATATYPE_SEXP, name,
+						 "arch",    OVAL_DATATYPE_STRING, reply_st[i]->arch,
+						 "epoch",   OVAL_DATATYPE_STRING, reply_st[i]->epoch,
+						 "release", OVAL_DATATYPE_STRING, reply_st[i]->release,
+						 "version", OVAL_DATATYPE_STRING, reply_st[i]->version,
+						 "evr",     OVAL_DATATYPE_EVR_STRING, reply_st[i]->evr,
+						 "signature_keyid", OVAL_DATATYPE_STRING, reply_st[i]->signature_keyid,
+						 NULL);
+
+			/* OVAL 5.10 added extended_name and filepaths behavior */
+			if (oval_schema_version_cmp(over, OVAL_SCHEMA_VERSION(5.10)) >= 0) {
+				SEXP_t *value, *bh_value;
+				value = probe_entval_from_cstr(
+						OVAL_DATATYPE_STRING,
+						reply_st[i]->extended_name,
+						strlen(reply_st[i]->extended_name)
+				);
+				probe_item_ent_add(item, "extended_name", NULL, value);
+				SEXP_free(value);
+
+				/*
+				 * Parse behaviors
+				 */
+				value = probe_obj_getent(probe_in, "behaviors", 1);
+				if (value != NULL) {
+					bh_value = probe_ent_getattrval(value, "filepaths");
+					if (bh_value != NULL) {
+						if (SEXP_strcmp(bh_value, "true") == 0) {
+							/* collect package files */
+							collect_rpm_files(item, reply_st[i]);
+
+						}
+						SEXP_free(bh_value);
+					}
+					SEXP_free(value);
+				}
+
+			}
+
+			SEXP_free(name);
+			collected[reply_st[i] - g_index.pkgs] = true;
+
+			if (probe_item_collect(ctx, item) < 0) {
+				oscap_free(reply_st);
+				return PROBE_EUNKNOWN;
+			}
+		}
+
+		oscap_free (reply_st);
+	}
+
+	return 0;
+}
+
+int probe_main (probe_ctx *ctx, void *arg)
+{
+	SEXP_t *val, *vals, *ent, *probe_in;
+	struct rpminfo_req request_st;
+	probe_entobj_t *ent_cmp;
+	bool *collected;
+	int ret = 0;
 
 	if (g_rpm.rpmts == NULL) {
 		probe_cobj_set_flag(probe_ctx_getresult(ctx), SYSCHAR_FLAG_NOT_APPLICABLE);
@@ -387,25 +619,12 @@ int probe_main (probe_ctx *ctx, void *arg)
 	if (probe_in == NULL)
 		return PROBE_ENOOBJ;
 
-	over = probe_obj_get_platform_schema_version(probe_in);
-
         ent = probe_obj_getent (probe_in, "name", 1);
 
         if (ent == NULL) {
                 return (PROBE_ENOENT);
         }
 
-        val = probe_ent_getval (ent);
-
-        if (val == NULL) {
-                dI("%s: no value", "name");
-                SEXP_free (ent);
-                return (PROBE_ENOVAL);
-        }
-
-        request_st.name = SEXP_string_cstr (val);
-        SEXP_free (val);
-
         val = probe_ent_getattrval (ent, "operation");
 
         if (val == NULL) {
@@ -421,116 +640,57 @@ int probe_main (probe_ctx *ctx, void *arg)
                 default:
                         SEXP_free (val);
                         SEXP_free (ent);
-                        oscap_free (request_st.name);
                         return (PROBE_EOPNOTSUPP);
                 }
 
                 SEXP_free (val);
         }
 
-        if (request_st.name == NULL) {
-		SEXP_free (ent);
-                switch (errno) {
-                case EINVAL:
-                        dI("%s: invalid value type", "name");
-			return PROBE_EINVAL;
-                        break;
-                case EFAULT:
-                        dI("%s: element not found", "name");
-			return PROBE_ENOELM;
-                        break;
-		default:
-			return PROBE_EUNKNOWN;
-                }
-        }
-
-        reply_st  = NULL;
-
-        /* get info from RPM db */
-        switch (rpmret = get_rpminfo (&request_st, &reply_st)) {
-        case 0: /* Not found */
-                dI("Package \"%s\" not found.", request_st.name);
-                break;
-        case -1: /* Error */
-                dI("get_rpminfo failed");
-
-                item = probe_item_create(OVAL_LINUX_RPM_INFO, NULL,
-                                         "name", OVAL_DATATYPE_STRING, request_st.name,
-                                         NULL);
-
-                probe_item_setstatus (item, SYSCHAR_STATUS_ERROR);
-                probe_item_collect(ctx, item);
-                break;
-        default: /* Ok */
-                _A(rpmret   >= 0);
-                _A(reply_st != NULL);
-                {
-                        SEXP_t *name;
-
-                        for (i = 0; i < rpmret; ++i) {
-				name = SEXP_string_newf("%s", reply_st[i].name);
-
-				if (probe_entobj_cmp(ent, name) != OVAL_RESULT_TRUE) {
-					SEXP_free(name);
-					continue;
-				}
-
-                                item = probe_item_create(OVAL_LINUX_RPM_INFO, NULL,
-                                                         "name",    OVAL_DATATYPE_SEXP, name,
-                                                         "arch",    OVAL_DATATYPE_STRING, reply_st[i].arch,
-                                                         "epoch",   OVAL_DATATYPE_STRING, reply_st[i].epoch,
-                                                         "release", OVAL_DATATYPE_STRING, reply_st[i].release,
-                                                         "version", OVAL_DATATYPE_STRING, reply_st[i].version,
-                                                         "evr",     OVAL_DATATYPE_EVR_STRING, reply_st[i].evr,
-                                                         "signature_keyid", OVAL_DATATYPE_STRING, reply_st[i].signature_keyid,
-                                                         NULL);
-
-				/* OVAL 5.10 added extended_name and filepaths behavior */
-				if (oval_schema_version_cmp(over, OVAL_SCHEMA_VERSION(5.10)) >= 0) {
-					SEXP_t *value, *bh_value;
-					value = probe_entval_from_cstr(
-							OVAL_DATATYPE_STRING,
-							reply_st[i].extended_name,
-							strlen(reply_st[i].extended_name)
-					);
-					probe_item_ent_add(item, "extended_name", NULL, value);
-					SEXP_free(value);
-
-					/*
-					 * Parse behaviors
-					 */
-					value = probe_obj_getent(probe_in, "behaviors", 1);
-					if (value != NULL) {
-						bh_value = probe_ent_getattrval(value, "filepaths");
-						if (bh_value != NULL) {
-							if (SEXP_strcmp(bh_value, "true") == 0) {
-								/* collect package files */
-								collect_rpm_files(item, &reply_st[i]);
-
-							}
-							SEXP_free(bh_value);
-						}
-						SEXP_free(value);
-					}
-
-				}
-
-
-				SEXP_free(name);
-                                __rpminfo_rep_free (&(reply_st[i]));
+	/*
+	 * All the values of a variable the name refers to are looked up
+	 * in one run, see PROBEOPT_VARREF_VECTOR in probe_init().
+	 */
+	vals = NULL;
+	if (probe_ctx_getentvals(ctx, "name", &vals) <= 0) {
+		dI("%s: no value", "name");
+		SEXP_vfree(vals, ent, NULL);
+		return (PROBE_ENOVAL);
+	}
 
-				if (probe_item_collect(ctx, item) < 0) {
-					SEXP_vfree(ent, NULL);
-					return PROBE_EUNKNOWN;
-				}
-                        }
+	/* a package which matches more of the values is collected once */
+	collected = oscap_calloc(g_index.count + 1, sizeof(bool));
+	ent_cmp = probe_entobj_new(ent);
+
+	SEXP_list_foreach(val, vals) {
+		request_st.name = SEXP_string_cstr (val);
+
+		if (request_st.name == NULL) {
+			switch (errno) {
+			case EINVAL:
+				dI("%s: invalid value type", "name");
+				ret = PROBE_EINVAL;
+				break;
+			case EFAULT:
+				dI("%s: element not found", "name");
+				ret = PROBE_ENOELM;
+				break;
+			default:
+				ret = PROBE_EUNKNOWN;
+			}
+		} else {
+			ret = rpminfo_collect(ctx, ent_cmp, &request_st, collected);
+			oscap_free(request_st.name);
+		}
 
-                        oscap_free (reply_st);
-                }
-        }
+		if (ret != 0) {
+			SEXP_free(val);
+			break;
+		}
+	}
 
-	SEXP_vfree(ent, NULL);
-        oscap_free(request_st.name);
+	probe_entobj_free(ent_cmp);
+	oscap_free(collected);
+	SEXP_vfree(vals, ent, NULL);
 
-        return 0;
+	return ret;
 }
@@ -42,6 +42,7 @@
 #include <pcre.h>
 
 #include "rpm-helper.h"
+#include "rpm-verify-queue.h"
 
 /* Individual RPM headers */
 #include <rpm/rpmfi.h>
@@ -74,6 +75,27 @@ static struct rpm_probe_global g_rpm;
 #define RPMVERIFY_LOCK   RPM_MUTEX_LOCK(&g_rpm.mutex)
 #define RPMVERIFY_UNLOCK RPM_MUTEX_UNLOCK(&g_rpm.mutex)
 
+struct rpmverify_emit_arg {
+	probe_ctx *ctx;
+	void (*callback)(probe_ctx *, struct rpmverify_res *);
+};
+
+static int rpmverify_emit(void *arg, void *res, rpmVerifyAttrs vflags)
+{
+	struct rpmverify_emit_arg *a = arg;
+	struct rpmverify_res *r = res;
+
+	r->vflags = vflags;
+	a->callback(a->ctx, r);
+
+	return (0);
+}
+
+static void rpmverify_release(void *res)
+{
+	free(((struct rpmverify_res *)res)->file);
+}
+
 static int rpmverify_collect(probe_ctx *ctx,
                              const char *name, oval_operation_t name_op,
                              const char *file, oval_operation_t file_op,
@@ -85,6 +107,9 @@ static int rpmverify_collect(probe_ctx *ctx,
         rpmVerifyAttrs omit = (rpmVerifyAttrs)(flags & RPMVERIFY_RPMATTRMASK);
 	Header pkgh;
         pcre *re = NULL;
+	struct rpm_verify_queue *q = NULL;
+	struct rpmverify_emit_arg emit_arg = { ctx, callback };
+	unsigned int threads;
 	int  ret = -1;
 
         /* pre-compile regex if needed */
@@ -100,6 +125,11 @@ static int rpmverify_collect(probe_ctx *ctx,
                 }
         }
 
+	/* check the file digests in parallel */
+	if ((threads = rpm_verify_threads()) > 1)
+		q = rpm_verify_queue_new(threads, sizeof(struct rpmverify_res),
+					 &rpmverify_emit, &rpmverify_release, &emit_arg);
+
         RPMVERIFY_LOCK;
 
         switch (name_op) {
@@ -198,7 +228,20 @@ static int rpmverify_collect(probe_ctx *ctx,
 		    }
 		    SEXP_free(filepath_sexp);
 
-		    if (rpmVerifyFile(g_rpm.rpmts, fi, &res.vflags, omit) != 0)
+		    if (q != NULL) {
+		      struct rpm_file_digest dig;
+
+		      if (rpmVerifyFileDeferDigest(g_rpm.rpmts, fi, &res.vflags, omit, res.file, &dig) != 0) {
+			res.vflags = RPMVERIFY_FAILURES;
+			dig.alg = -1;
+		      }
+
+		      /* the queue releases res.file */
+		      rpm_verify_queue_push(q, &res, res.vflags, &dig);
+		      continue;
+		    }
+
+		    if (rpmVerifyFileHashCache(g_rpm.rpmts, fi, &res.vflags, omit) != 0)
 		      res.vflags = RPMVERIFY_FAILURES;
 
 		    callback(ctx, &res);
@@ -210,8 +253,14 @@ static int rpmverify_collect(probe_ctx *ctx,
 	}
 
 	match = rpmdbFreeIterator (match);
+
+	if (q != NULL)
+		rpm_verify_queue_finish(q);
+
         ret   = 0;
 ret:
+	rpm_verify_queue_free(q);
+
         if (re != NULL)
                 pcre_free(re);
 
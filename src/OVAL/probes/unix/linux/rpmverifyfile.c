@@ -44,6 +44,7 @@
 #include <pcre.h>
 
 #include "rpm-helper.h"
+#include "rpm-verify-queue.h"
 
 /* Individual RPM headers */
 #include <rpm/rpmfi.h>
@@ -126,6 +127,28 @@ static int adjust_filter(rpmdbMatchIterator iterator, SEXP_t *ent, rpmTag rpm_ta
 	return ret;
 }
 
+struct rpmverify_emit_arg {
+	probe_ctx *ctx;
+	int (*callback)(probe_ctx *, struct rpmverify_res *);
+};
+
+static int rpmverify_emit(void *arg, void *res, rpmVerifyAttrs vflags)
+{
+	struct rpmverify_emit_arg *a = arg;
+	struct rpmverify_res *r = res;
+	int ret;
+
+	r->vflags = vflags;
+	ret = a->callback(a->ctx, r);
+
+	return (ret);
+}
+
+static void rpmverify_release(void *res)
+{
+	oscap_free(((struct rpmverify_res *)res)->file);
+}
+
 static int rpmverify_collect(probe_ctx *ctx,
 			     const char *file, oval_operation_t file_op,
 			     SEXP_t *name_ent, SEXP_t *epoch_ent, SEXP_t *version_ent, SEXP_t *release_ent, SEXP_t *arch_ent,
@@ -136,6 +159,9 @@ static int rpmverify_collect(probe_ctx *ctx,
 	rpmVerifyAttrs omit = (rpmVerifyAttrs)(flags & RPMVERIFY_RPMATTRMASK);
 	Header pkgh;
 	pcre *re = NULL;
+	struct rpm_verify_queue *q = NULL;
+	struct rpmverify_emit_arg emit_arg = { ctx, callback };
+	unsigned int threads;
 	int  ret = -1;
 
 	/* pre-compile regex if needed */
@@ -151,6 +177,11 @@ static int rpmverify_collect(probe_ctx *ctx,
 		}
 	}
 
+	/* check the file digests in parallel */
+	if ((threads = rpm_verify_threads()) > 1)
+		q = rpm_verify_queue_new(threads, sizeof(struct rpmverify_res),
+					 &rpmverify_emit, &rpmverify_release, &emit_arg);
+
 	RPMVERIFY_LOCK;
 
 	match = rpmtsInitIterator (g_rpm.rpmts, RPMDBI_PACKAGES, NULL, 0);
@@ -279,7 +310,24 @@ static int rpmverify_collect(probe_ctx *ctx,
 		      goto ret;
 		    }
 
-		    if (rpmVerifyFile(g_rpm.rpmts, fi, &res.vflags, omit) != 0)
+		    if (q != NULL) {
+			    struct rpm_file_digest dig;
+
+			    if (rpmVerifyFileDeferDigest(g_rpm.rpmts, fi, &res.vflags, omit, res.file, &dig) != 0) {
+				    res.vflags = RPMVERIFY_FAILURES;
+				    dig.alg = -1;
+			    }
+
+			    /* the queue releases res.file once it's queued */
+			    if (rpm_verify_queue_push(q, &res, res.vflags, &dig) != 0) {
+				    ret = 0;
+				    oscap_free(res.file);
+				    goto ret;
+			    }
+			    continue;
+		    }
+
+		    if (rpmVerifyFileHashCache(g_rpm.rpmts, fi, &res.vflags, omit) != 0)
 		      res.vflags = RPMVERIFY_FAILURES;
 
 		    if (callback(ctx, &res) != 0) {
@@ -295,8 +343,14 @@ static int rpmverify_collect(probe_ctx *ctx,
 	}
 
 	match = rpmdbFreeIterator (match);
+
+	if (q != NULL)
+		rpm_verify_queue_finish(q);
+
 	ret   = 0;
 ret:
+	rpm_verify_queue_free(q);
+
 	if (re != NULL)
 		pcre_free(re);
 
@@ -44,7 +44,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdbool.h>
 #include <errno.h>
+#include <pthread.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 
@@ -52,48 +54,165 @@
 #include "probe-api.h"
 #include "probe/entcmp.h"
 #include "alloc.h"
+#include "common/debug_priv.h"
 
 #include <selinux/selinux.h>
 
+/*
+ * The booleans are read once per probe and kept sorted by name, every
+ * object is served from the table. The table is read again when the policy
+ * load sequence number of the kernel changes, which a policy load and a
+ * commit of the booleans do. Without the status page of libselinux the
+ * table is read only once.
+ */
+struct sebool {
+	char *name;
+	int   active;
+	int   pending;
+};
+
+static struct {
+	pthread_mutex_t lock;
+	bool            loaded;
+	bool            status; /* the status page is open */
+	int             seqno;  /* of the table, -1 if unknown */
+	struct sebool  *bools;
+	int             count;
+} g_sebools = { .lock = PTHREAD_MUTEX_INITIALIZER, .seqno = -1 };
+
+static int sebool_cmp(const void *a, const void *b)
+{
+	return strcmp(((const struct sebool *)a)->name, ((const struct sebool *)b)->name);
+}
+
+static int sebool_seqno(void)
+{
+#if defined(HAVE_SELINUX_STATUS_OPEN) && defined(HAVE_SELINUX_STATUS_POLICYLOAD)
+	if (!g_sebools.status) {
+		if (selinux_status_open(1) < 0)
+			return (-1);
+		g_sebools.status = true;
+	}
+	return selinux_status_policyload();
+#else
+	return (-1);
+#endif
+}
+
+static void sebools_free(void)
+{
+	int i;
+
+	for (i = 0; i < g_sebools.count; i++)
+		free(g_sebools.bools[i].name);
+	free(g_sebools.bools);
+	g_sebools.bools  = NULL;
+	g_sebools.count  = 0;
+	g_sebools.loaded = false;
+}
+
+/* called with the lock held */
+static int sebools_load(void)
+{
+	int seqno, len, i;
+	char **names;
+
+	seqno = sebool_seqno();
+	if (g_sebools.loaded && (seqno < 0 || seqno == g_sebools.seqno))
+		return (0);
+
+	sebools_free();
+
+	if (security_get_boolean_names(&names, &len) == -1)
+		return (-1);
+
+	g_sebools.bools = malloc(sizeof(struct sebool) * (len > 0 ? len : 1));
+	for (i = 0; i < len; i++) {
+		g_sebools.bools[i].name    = names[i];
+		g_sebools.bools[i].active  = security_get_boolean_active(names[i]);
+		g_sebools.bools[i].pending = security_get_boolean_pending(names[i]);
+	}
+	free(names);
+
+	qsort(g_sebools.bools, len, sizeof(struct sebool), sebool_cmp);
+	g_sebools.count  = len;
+	g_sebools.seqno  = seqno;
+	g_sebools.loaded = true;
+	dI("Read %d SELinux booleans, policy load %d.", len, seqno);
+
+	return (0);
+}
+
+static void sebool_collect(const struct sebool *b, SEXP_t *boolean, probe_ctx *ctx)
+{
+	SEXP_t *item;
+
+	item = probe_item_create(
+		OVAL_LINUX_SELINUXBOOLEAN, NULL,
+		"name", OVAL_DATATYPE_SEXP, boolean,
+		"current_status",  OVAL_DATATYPE_BOOLEAN, b->active,
+		"pending_status", OVAL_DATATYPE_BOOLEAN, b->pending,
+	      NULL);
+	probe_item_collect(ctx, item);
+}
+
 static int get_selinuxboolean(SEXP_t *ut_ent, probe_ctx *ctx)
 {
-	int err = 1, active, pending, len, i;
-	SEXP_t *boolean, *item;
-	char **booleans;
+	int err = 1, i;
+	SEXP_t *boolean, *val;
+	struct sebool key, *found;
 
 	if ( ! is_selinux_enabled()) {
 		probe_cobj_set_flag(probe_ctx_getresult(ctx), SYSCHAR_FLAG_NOT_APPLICABLE);
 		return 0;
 	}
 
-	if (security_get_boolean_names(&booleans, &len) == -1) {
+	pthread_mutex_lock(&g_sebools.lock);
+
+	if (sebools_load() != 0) {
+		pthread_mutex_unlock(&g_sebools.lock);
 		probe_cobj_set_flag(probe_ctx_getresult(ctx), SYSCHAR_FLAG_ERROR);
 		return err;
 	}
 
-	for (i = 0; i < len; i++) {
-		boolean = SEXP_string_new(booleans[i], strlen(booleans[i]));
-		if (probe_entobj_cmp(ut_ent, boolean) == OVAL_RESULT_TRUE) {
-			active = security_get_boolean_active(booleans[i]);
-			pending = security_get_boolean_pending(booleans[i]);
-			item = probe_item_create(
-				OVAL_LINUX_SELINUXBOOLEAN, NULL,
-				"name", OVAL_DATATYPE_SEXP, boolean,
-				"current_status",  OVAL_DATATYPE_BOOLEAN, active,
-				"pending_status", OVAL_DATATYPE_BOOLEAN, pending,
-			      NULL);
-			probe_item_collect(ctx, item);
+	/* a single name is looked up, the other objects are matched against every boolean */
+	if (probe_ent_getoperation(ut_ent, OVAL_OPERATION_EQUALS) == OVAL_OPERATION_EQUALS
+	    && !probe_ent_attrexists(ut_ent, "var_ref")
+	    && (val = probe_ent_getval(ut_ent)) != NULL) {
+		key.name = SEXP_string_cstr(val);
+		found = key.name == NULL ? NULL :
+			bsearch(&key, g_sebools.bools, g_sebools.count, sizeof(struct sebool), sebool_cmp);
+		if (found != NULL)
+			sebool_collect(found, val, ctx);
+		oscap_free(key.name);
+		SEXP_free(val);
+	} else {
+		for (i = 0; i < g_sebools.count; i++) {
+			boolean = SEXP_string_new(g_sebools.bools[i].name, strlen(g_sebools.bools[i].name));
+			if (probe_entobj_cmp(ut_ent, boolean) == OVAL_RESULT_TRUE)
+				sebool_collect(&g_sebools.bools[i], boolean, ctx);
+			SEXP_free(boolean);
 		}
-		SEXP_free(boolean);
 	}
 
-	for (i = 0; i < len; i++)
-		free(booleans[i]);
-        free(booleans);
+	pthread_mutex_unlock(&g_sebools.lock);
 
 	return 0;
 }
 
+void probe_fini(void *arg)
+{
+	pthread_mutex_lock(&g_sebools.lock);
+	sebools_free();
+#if defined(HAVE_SELINUX_STATUS_OPEN) && defined(HAVE_SELINUX_STATUS_POLICYLOAD)
+	if (g_sebools.status) {
+		selinux_status_close();
+		g_sebools.status = false;
+	}
+#endif
+	pthread_mutex_unlock(&g_sebools.lock);
+}
+
 int probe_main(probe_ctx *ctx, void *arg)
 {
 	SEXP_t *probe_in, *name;
@@ -53,6 +53,7 @@
 #include "oval_fts.h"
 #include "util.h"
 #include "common/debug_priv.h"
+#include "SEAP/generic/rbt/rbt.h"
 
 #define FILE_SEPARATOR '/'
 
@@ -102,16 +103,122 @@ static void split_range(const char *range, char **l_s, char **l_c, char **h_s, c
 	}
 }
 
+/*
+ * Security contexts repeat heavily across the processes and files, so the
+ * split context values are cached by the context string and shared by all
+ * the items with the same context.
+ */
+struct label {
+	SEXP_t *user;
+	SEXP_t *role;
+	SEXP_t *type;
+	SEXP_t *low_sensitivity;
+	SEXP_t *low_category;
+	SEXP_t *high_sensitivity;
+	SEXP_t *high_category;
+};
+
+static rbt_t *g_label_cache = NULL;
+
+static SEXP_t *label_string(const char *str)
+{
+	if (str == NULL)
+		return (NULL);
+
+	return SEXP_string_new(str, strlen(str));
+}
+
+static struct label *label_new(const char *con)
+{
+	struct label *label;
+	context_t context;
+	const char *range;
+	char *l_sensitivity, *l_category, *h_sensitivity, *h_category;
+
+	context = context_new(con);
+
+	if (context == NULL)
+		return (NULL);
+
+	label = calloc(1, sizeof(struct label));
+	label->user = label_string(context_user_get(context));
+	label->role = label_string(context_role_get(context));
+	label->type = label_string(context_type_get(context));
+
+	range = context_range_get(context);
+
+	if (range != NULL) {
+		split_range(range, &l_sensitivity, &l_category, &h_sensitivity, &h_category);
+
+		label->low_sensitivity  = label_string(l_sensitivity);
+		label->low_category     = label_string(l_category);
+		label->high_sensitivity = label_string(h_sensitivity);
+		label->high_category    = label_string(h_category);
+
+		free(l_sensitivity);
+		free(l_category);
+		free(h_sensitivity);
+		free(h_category);
+	}
+
+	context_free(context);
+
+	return (label);
+}
+
+static void label_free(struct label *label)
+{
+	SEXP_free(label->user);
+	SEXP_free(label->role);
+	SEXP_free(label->type);
+	SEXP_free(label->low_sensitivity);
+	SEXP_free(label->low_category);
+	SEXP_free(label->high_sensitivity);
+	SEXP_free(label->high_category);
+	free(label);
+}
+
+static const struct label *label_cache_get(const char *con)
+{
+	struct label *label = NULL, *label2 = NULL;
+	char *key;
+
+	if (rbt_str_get(g_label_cache, con, (void *)&label) == 0)
+		return (label); /* cache hit (first attempt) */
+
+	label = label_new(con);
+
+	if (label == NULL)
+		return (NULL);
+
+	key = strdup(con);
+
+	if (rbt_str_add(g_label_cache, key, label) == 0)
+		return (label); /* insert succeeded */
+
+	free(key);
+	label_free(label);
+
+	if (rbt_str_get(g_label_cache, con, (void *)&label2) == 0)
+		return (label2); /* cache hit (second attempt) */
+
+	return (NULL);
+}
+
+static void label_cache_free_cb(struct rbt_str_node *n)
+{
+	label_free(n->data);
+	free(n->key);
+}
+
 static int selinuxsecuritycontext_process_cb (SEXP_t *pid_ent, probe_ctx *ctx) {
 
 	SEXP_t *pid_sexp, *item;
 	security_context_t pid_context;
-	context_t context;
+	const struct label *label;
 	int pid_number;
 	DIR *proc;
 	struct dirent *dir_entry;
-	const char *user, *role, *type, *range;
-	char *l_sensitivity, *l_category, *h_sensitivity, *h_category;
 
 	if ((proc = opendir("/proc")) == NULL) {
 		dE("Can't open /proc dir: %s", strerror(errno));
@@ -135,38 +242,27 @@ static int selinuxsecuritycontext_process_cb (SEXP_t *pid_ent, probe_ctx *ctx) {
 				continue;
 			}
 
-			context = context_new(pid_context);
-
-			user = context_user_get(context);
-			role = context_role_get(context);
-			type = context_type_get(context);
-			range = context_range_get(context);
-			if (range != NULL) {
-				split_range(range, &l_sensitivity, &l_category, &h_sensitivity, &h_category);
-				item = probe_item_create(OVAL_LINUX_SELINUXSECURITYCONTEXT, NULL,
-					"pid",     OVAL_DATATYPE_INTEGER, (int64_t)pid_number,
-					"user",     OVAL_DATATYPE_STRING, user,
-					"role",     OVAL_DATATYPE_STRING, role,
-					"type",     OVAL_DATATYPE_STRING, type,
-					"low_sensitivity", OVAL_DATATYPE_STRING, l_sensitivity,
-					"low_category", OVAL_DATATYPE_STRING, l_category,
-					"high_sensitivity", OVAL_DATATYPE_STRING, h_sensitivity,
-					"high_category", OVAL_DATATYPE_STRING, h_category,
-					NULL);
-			}
-			else {
-				item = probe_item_create(OVAL_LINUX_SELINUXSECURITYCONTEXT, NULL,
-					"pid",     OVAL_DATATYPE_INTEGER, (int64_t)pid_number,
-					"user",     OVAL_DATATYPE_STRING, user,
-					"role",     OVAL_DATATYPE_STRING, role,
-					"type",     OVAL_DATATYPE_STRING, type,
-					NULL);
+			label = label_cache_get(pid_context);
+			freecon(pid_context);
+
+			if (label == NULL) {
+				dW("Can't parse selinux context of process %d", pid_number);
+				SEXP_free(pid_sexp);
+				continue;
 			}
 
-			probe_item_collect(ctx, item);
+			item = probe_item_create(OVAL_LINUX_SELINUXSECURITYCONTEXT, NULL,
+				"pid",     OVAL_DATATYPE_INTEGER, (int64_t)pid_number,
+				"user",     OVAL_DATATYPE_SEXP, label->user,
+				"role",     OVAL_DATATYPE_SEXP, label->role,
+				"type",     OVAL_DATATYPE_SEXP, label->type,
+				"low_sensitivity", OVAL_DATATYPE_SEXP, label->low_sensitivity,
+				"low_category", OVAL_DATATYPE_SEXP, label->low_category,
+				"high_sensitivity", OVAL_DATATYPE_SEXP, label->high_sensitivity,
+				"high_category", OVAL_DATATYPE_SEXP, label->high_category,
+				NULL);
 
-			context_free(context);
-			freecon(pid_context);
+			probe_item_collect(ctx, item);
 		}
 		SEXP_free(pid_sexp);
 	}
@@ -183,11 +279,9 @@ static int selinuxsecuritycontext_file_cb (const char *p, const char *f, probe_c
 	char   pbuf[PATH_MAX+1];
 	size_t plen, flen;
 
-	security_context_t file_context;
+	security_context_t file_context = NULL;
 	int file_context_size;
-	context_t context;
-	const char *user, *role, *type, *range;
-	char *l_sensitivity, *l_category, *h_sensitivity, *h_category;
+	const struct label *label;
 	int err = 0;
 
 	/* directory */
@@ -233,44 +327,38 @@ static int selinuxsecuritycontext_file_cb (const char *p, const char *f, probe_c
 
 	}
 	else {
-		context = context_new(file_context);
+		label = label_cache_get(file_context);
 
-		user = context_user_get(context);
-		role = context_role_get(context);
-		type = context_type_get(context);
-		range = context_range_get(context);
+		if (label == NULL) {
+			dE("Can't parse context of %s: %s", pbuf, file_context);
 
-		if (range != NULL) {
-			split_range(range, &l_sensitivity, &l_category, &h_sensitivity, &h_category);
 			item = probe_item_create(OVAL_LINUX_SELINUXSECURITYCONTEXT, NULL,
 							"filepath", OVAL_DATATYPE_STRING, pbuf,
 							"path",     OVAL_DATATYPE_STRING, p,
 							"filename", OVAL_DATATYPE_STRING, f,
-							"user",     OVAL_DATATYPE_STRING, user,
-							"role",     OVAL_DATATYPE_STRING, role,
-							"type",     OVAL_DATATYPE_STRING, type,
-							"low_sensitivity", OVAL_DATATYPE_STRING, l_sensitivity,
-							"low_category", OVAL_DATATYPE_STRING, l_category,
-							"high_sensitivity", OVAL_DATATYPE_STRING, h_sensitivity,
-							"high_category", OVAL_DATATYPE_STRING, h_category,
-							"rawlow_sensitivity", OVAL_DATATYPE_STRING, l_sensitivity,
-							"rawlow_category", OVAL_DATATYPE_STRING, l_category,
-							"rawhigh_sensitivity", OVAL_DATATYPE_STRING, h_sensitivity,
-							"rawhigh_category", OVAL_DATATYPE_STRING, h_category,
 							NULL);
-		}
-		else {
+
+			probe_item_add_msg(item, OVAL_MESSAGE_LEVEL_ERROR,
+				"Can't parse context of %s: %s\n", pbuf, file_context);
+			probe_item_setstatus(item, SYSCHAR_STATUS_ERROR);
+		} else {
 			item = probe_item_create(OVAL_LINUX_SELINUXSECURITYCONTEXT, NULL,
 							"filepath", OVAL_DATATYPE_STRING, pbuf,
 							"path",     OVAL_DATATYPE_STRING, p,
 							"filename", OVAL_DATATYPE_STRING, f,
-							"user",     OVAL_DATATYPE_STRING, user,
-							"role",     OVAL_DATATYPE_STRING, role,
-							"type",     OVAL_DATATYPE_STRING, type,
+							"user",     OVAL_DATATYPE_SEXP, label->user,
+							"role",     OVAL_DATATYPE_SEXP, label->role,
+							"type",     OVAL_DATATYPE_SEXP, label->type,
+							"low_sensitivity", OVAL_DATATYPE_SEXP, label->low_sensitivity,
+							"low_category", OVAL_DATATYPE_SEXP, label->low_category,
+							"high_sensitivity", OVAL_DATATYPE_SEXP, label->high_sensitivity,
+							"high_category", OVAL_DATATYPE_SEXP, label->high_category,
+							"rawlow_sensitivity", OVAL_DATATYPE_SEXP, label->low_sensitivity,
+							"rawlow_category", OVAL_DATATYPE_SEXP, label->low_category,
+							"rawhigh_sensitivity", OVAL_DATATYPE_SEXP, label->high_sensitivity,
+							"rawhigh_category", OVAL_DATATYPE_SEXP, label->high_category,
 							NULL);
 		}
-
-		context_free(context);
 	}
 	probe_item_collect(ctx, item);
 
@@ -280,6 +368,19 @@ static int selinuxsecuritycontext_file_cb (const char *p, const char *f, probe_c
 	return (err);
 }
 
+void *probe_init(void)
+{
+	g_label_cache = rbt_str_new();
+
+	return (NULL);
+}
+
+void probe_fini(void *arg)
+{
+	rbt_str_free_cb(g_label_cache, label_cache_free_cb);
+	g_label_cache = NULL;
+}
+
 int probe_main(probe_ctx *ctx, void *arg)
 {
 	SEXP_t *probe_in;
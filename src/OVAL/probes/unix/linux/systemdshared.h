@@ -62,31 +62,36 @@ typedef union
 	int fd;              /**< as Unix file descriptor */
 } _DBusBasicValue;
 
-static char *get_path_by_unit(DBusConnection *conn, const char *unit)
+/*
+ * Maximum number of calls the probes keep in flight on the connection.
+ * The requests are sent before waiting for any of the replies, which
+ * saves a round-trip per unit.
+ */
+#define SYSTEMD_DBUS_PIPELINE 64
+
+/*
+ * Send a method call with up to two string arguments (NULL if unused)
+ * without waiting for the reply.
+ */
+static DBusPendingCall *dbus_call_send(DBusConnection *conn, const char *path, const char *interface, const char *method, const char *arg1, const char *arg2)
 {
 	DBusMessage *msg = NULL;
 	DBusPendingCall *pending = NULL;
-	_DBusBasicValue path;
-	char *ret = NULL;
+	DBusMessageIter args;
 
-	msg = dbus_message_new_method_call(
-		"org.freedesktop.systemd1",
-		"/org/freedesktop/systemd1",
-		"org.freedesktop.systemd1.Manager",
-		// LoadUnit is similar to GetUnit except it will load the unit file
-		// if it hasn't been loaded yet.
-		"LoadUnit"
-	);
+	msg = dbus_message_new_method_call("org.freedesktop.systemd1", path, interface, method);
 	if (msg == NULL) {
 		dI("Failed to create dbus_message via dbus_message_new_method_call!");
-		goto cleanup;
+		return NULL;
 	}
 
-	DBusMessageIter args;
-
 	dbus_message_iter_init_append(msg, &args);
-	if (!dbus_message_iter_append_basic(&args, DBUS_TYPE_STRING, &unit)) {
-		dI("Failed to append unit '%s' string parameter to dbus message!", unit);
+	if (arg1 != NULL && !dbus_message_iter_append_basic(&args, DBUS_TYPE_STRING, &arg1)) {
+		dI("Failed to append '%s' string parameter to dbus message!", arg1);
+		goto cleanup;
+	}
+	if (arg2 != NULL && !dbus_message_iter_append_basic(&args, DBUS_TYPE_STRING, &arg2)) {
+		dI("Failed to append '%s' string parameter to dbus message!", arg2);
 		goto cleanup;
 	}
 
@@ -100,15 +105,52 @@ static char *get_path_by_unit(DBusConnection *conn, const char *unit)
 	}
 
 	dbus_connection_flush(conn);
-	dbus_message_unref(msg); msg = NULL;
+
+cleanup:
+	dbus_message_unref(msg);
+
+	return pending;
+}
+
+/*
+ * Wait for the reply of a call sent by dbus_call_send(). The pending call
+ * is released.
+ */
+static DBusMessage *dbus_call_reply(DBusPendingCall *pending)
+{
+	DBusMessage *msg;
+
+	if (pending == NULL)
+		return NULL;
 
 	dbus_pending_call_block(pending);
 	msg = dbus_pending_call_steal_reply(pending);
-	if (msg == NULL) {
+	dbus_pending_call_unref(pending);
+
+	if (msg == NULL)
 		dI("Failed to steal dbus pending call reply.");
-		goto cleanup;
-	}
-	dbus_pending_call_unref(pending); pending = NULL;
+
+	return msg;
+}
+
+static DBusPendingCall *load_unit_send(DBusConnection *conn, const char *unit)
+{
+	// LoadUnit is similar to GetUnit except it will load the unit file
+	// if it hasn't been loaded yet.
+	return dbus_call_send(conn, "/org/freedesktop/systemd1",
+			      "org.freedesktop.systemd1.Manager", "LoadUnit", unit, NULL);
+}
+
+static char *load_unit_reply(DBusPendingCall *pending)
+{
+	DBusMessage *msg;
+	DBusMessageIter args;
+	_DBusBasicValue path;
+	char *ret = NULL;
+
+	msg = dbus_call_reply(pending);
+	if (msg == NULL)
+		return NULL;
 
 	if (!dbus_message_iter_init(msg, &args)) {
 		dI("Failed to initialize iterator over received dbus message.");
@@ -122,18 +164,18 @@ static char *get_path_by_unit(DBusConnection *conn, const char *unit)
 
 	dbus_message_iter_get_basic(&args, &path);
 	ret = oscap_strdup(path.str);
-	dbus_message_unref(msg); msg = NULL;
 
 cleanup:
-	if (pending != NULL)
-		dbus_pending_call_unref(pending);
-
-	if (msg != NULL)
-		dbus_message_unref(msg);
+	dbus_message_unref(msg);
 
 	return ret;
 }
 
+static char *get_path_by_unit(DBusConnection *conn, const char *unit)
+{
+	return load_unit_reply(load_unit_send(conn, unit));
+}
+
 static int get_all_systemd_units(DBusConnection* conn, int(*callback)(const char *, void *), void *cbarg)
 {
 	DBusMessage *msg = NULL;
@@ -347,8 +389,23 @@ cleanup:
 
 static void disconnect_dbus(DBusConnection *conn)
 {
-	// NOOP
+	// Connections retrieved via dbus_bus_get shall not be closed,
+	// these connections are shared. Only drop our reference.
+	if (conn != NULL)
+		dbus_connection_unref(conn);
+}
 
-	// Connections retrieved via dbus_bus_get shall not be destroyed,
-	// these connections are shared.
+/*
+ * The probes connect once in probe_init() and use the connection for
+ * all of the objects. The worker threads share it.
+ */
+void *probe_init(void)
+{
+	dbus_threads_init_default();
+	return connect_dbus();
+}
+
+void probe_fini(void *probe_arg)
+{
+	disconnect_dbus((DBusConnection *)probe_arg);
 }
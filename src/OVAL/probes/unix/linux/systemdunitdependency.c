@@ -36,56 +36,21 @@
 #include "common/list.h"
 #include <string.h>
 
-static char *get_property_by_unit_path(DBusConnection *conn, const char *unit_path, const char *property)
+static DBusPendingCall *get_property_send(DBusConnection *conn, const char *unit_path, const char *property)
 {
-	DBusMessage *msg = NULL;
-	DBusPendingCall *pending = NULL;
-	char *ret = NULL;
-
-	msg = dbus_message_new_method_call(
-		"org.freedesktop.systemd1",
-		unit_path,
-		"org.freedesktop.DBus.Properties",
-		"Get"
-	);
-	if (msg == NULL) {
-		dI("Failed to create dbus_message via dbus_message_new_method_call!");
-		goto cleanup;
-	}
+	return dbus_call_send(conn, unit_path, "org.freedesktop.DBus.Properties", "Get",
+			      "org.freedesktop.systemd1.Unit", property);
+}
 
+static char *get_property_reply(DBusPendingCall *pending)
+{
+	DBusMessage *msg = NULL;
 	DBusMessageIter args, value_iter;
+	char *ret = NULL;
 
-	const char *interface = "org.freedesktop.systemd1.Unit";
-
-	dbus_message_iter_init_append(msg, &args);
-	if (!dbus_message_iter_append_basic(&args, DBUS_TYPE_STRING, &interface)) {
-		dI("Failed to append interface '%s' string parameter to dbus message!", interface);
-		goto cleanup;
-	}
-	if (!dbus_message_iter_append_basic(&args, DBUS_TYPE_STRING, &property)) {
-		dI("Failed to append property '%s' string parameter to dbus message!", property);
-		goto cleanup;
-	}
-
-	if (!dbus_connection_send_with_reply(conn, msg, &pending, -1)) {
-		dI("Failed to send message via dbus!");
-		goto cleanup;
-	}
-	if (pending == NULL) {
-		dI("Invalid dbus pending call!");
-		goto cleanup;
-	}
-
-	dbus_connection_flush(conn);
-	dbus_message_unref(msg); msg = NULL;
-
-	dbus_pending_call_block(pending);
-	msg = dbus_pending_call_steal_reply(pending);
-	if (msg == NULL) {
-		dI("Failed to steal dbus pending call reply.");
+	msg = dbus_call_reply(pending);
+	if (msg == NULL)
 		goto cleanup;
-	}
-	dbus_pending_call_unref(pending); pending = NULL;
 
 	if (!dbus_message_iter_init(msg, &args)) {
 		dI("Failed to initialize iterator over received dbus message.");
@@ -101,22 +66,43 @@ static char *get_property_by_unit_path(DBusConnection *conn, const char *unit_pa
 	dbus_message_iter_recurse(&args, &value_iter);
 	ret = dbus_value_to_string(&value_iter);
 
-	dbus_message_unref(msg); msg = NULL;
-
 cleanup:
-	if (pending != NULL)
-		dbus_pending_call_unref(pending);
-
 	if (msg != NULL)
 		dbus_message_unref(msg);
 
 	return ret;
 }
 
+/*
+ * Requires and Wants of the target units, fetched once per object. The
+ * lists are split in place, the arrays point into the strings.
+ */
+struct target_deps {
+	char *unit;
+	char *requires_s;
+	char **requires;
+	char *wants_s;
+	char **wants;
+};
+
+struct target_cache {
+	struct target_deps *targets;
+	size_t count;
+	size_t alloc;
+	size_t resolved; /* targets below this index have been fetched */
+};
+
+/* the chain of units being expanded, to stop at a dependency cycle */
+struct unit_chain {
+	const char *unit;
+	const struct unit_chain *up;
+};
+
 struct unit_callback_vars {
 	DBusConnection *dbus_conn;
 	probe_ctx *ctx;
 	SEXP_t *unit_entity;
+	struct target_cache targets;
 };
 
 static bool is_unit_name_a_target(const char *unit)
@@ -134,67 +120,170 @@ static bool is_unit_name_a_target(const char *unit)
 	return strncmp(unit + len - suffix_len, suffix, suffix_len) == 0;
 }
 
-static void get_all_dependencies_by_unit(DBusConnection *conn, const char *unit, int(*callback)(const char *, void *), void *cbarg, bool include_requires, bool include_wants)
+static struct target_deps *target_cache_find(struct target_cache *cache, const char *unit)
+{
+	for (size_t i = 0; i < cache->count; ++i) {
+		if (strcmp(cache->targets[i].unit, unit) == 0)
+			return &cache->targets[i];
+	}
+
+	return NULL;
+}
+
+static void target_cache_add(struct target_cache *cache, const char *unit)
 {
 	if (!unit || strcmp(unit, "(null)") == 0)
 		return;
 
 	// systemctl list-dependencies only recurses into target units
-	if (!is_unit_name_a_target(unit))
+	if (!is_unit_name_a_target(unit) || target_cache_find(cache, unit) != NULL)
 		return;
 
-	char *path = get_path_by_unit(conn, unit);
-
-	if (include_requires) {
-		char *requires_s = get_property_by_unit_path(conn, path, "Requires");
-		if (requires_s) {
-			char **requires = oscap_split(requires_s, ", ");
-			for (int i = 0; requires[i] != NULL; ++i) {
-				if (oscap_strcmp(requires[i], "") == 0)
-					continue;
-
-				if (callback(requires[i], cbarg) == 0) {
-					get_all_dependencies_by_unit(conn, requires[i],
-									callback, cbarg,
-									include_requires, include_wants);
-				} else {
-					oscap_free(requires);
-					oscap_free(requires_s);
-					oscap_free(path);
-					return;
-				}
-			}
-			oscap_free(requires);
-		}
-		oscap_free(requires_s);
+	if (cache->count == cache->alloc) {
+		cache->alloc = cache->alloc > 0 ? cache->alloc * 2 : 64;
+		cache->targets = oscap_realloc(cache->targets, cache->alloc * sizeof(struct target_deps));
 	}
 
-	if (include_wants) {
-		char *wants_s = get_property_by_unit_path(conn, path, "Wants");
-		if (wants_s)
-		{
-			char **wants = oscap_split(wants_s, ", ");
-			for (int i = 0; wants[i] != NULL; ++i) {
-				if (oscap_strcmp(wants[i], "") == 0)
-					continue;
-
-				if (callback(wants[i], cbarg) == 0) {
-					get_all_dependencies_by_unit(conn, wants[i],
-									callback, cbarg,
-									include_requires, include_wants);
-				} else {
-					oscap_free(wants);
-					oscap_free(wants_s);
-					oscap_free(path);
-					return;
-				}
+	memset(&cache->targets[cache->count], 0, sizeof(struct target_deps));
+	cache->targets[cache->count++].unit = oscap_strdup(unit);
+}
+
+static void target_cache_free(struct target_cache *cache)
+{
+	for (size_t i = 0; i < cache->count; ++i) {
+		oscap_free(cache->targets[i].unit);
+		oscap_free(cache->targets[i].requires);
+		oscap_free(cache->targets[i].requires_s);
+		oscap_free(cache->targets[i].wants);
+		oscap_free(cache->targets[i].wants_s);
+	}
+
+	oscap_free(cache->targets);
+}
+
+static void target_cache_add_all(struct target_cache *cache, char **units)
+{
+	for (int i = 0; units != NULL && units[i] != NULL; ++i)
+		target_cache_add(cache, units[i]);
+}
+
+/*
+ * Fetch the dependencies of all of the targets reachable from the unit,
+ * level by level. The calls for up to SYSTEMD_DBUS_PIPELINE targets are
+ * sent before waiting for the replies, instead of a round-trip per edge.
+ */
+static void target_cache_resolve(DBusConnection *conn, struct target_cache *cache, const char *unit)
+{
+	DBusPendingCall *pending[SYSTEMD_DBUS_PIPELINE][2];
+	char *paths[SYSTEMD_DBUS_PIPELINE];
+	size_t start, count, i;
+
+	target_cache_add(cache, unit);
+
+	while (cache->resolved < cache->count) {
+		start = cache->resolved;
+		count = cache->count - start;
+		if (count > SYSTEMD_DBUS_PIPELINE)
+			count = SYSTEMD_DBUS_PIPELINE;
+
+		for (i = 0; i < count; ++i)
+			pending[i][0] = load_unit_send(conn, cache->targets[start + i].unit);
+		for (i = 0; i < count; ++i)
+			paths[i] = load_unit_reply(pending[i][0]);
+
+		for (i = 0; i < count; ++i) {
+			if (paths[i] == NULL) {
+				pending[i][0] = pending[i][1] = NULL;
+				continue;
 			}
-			oscap_free(wants);
+			pending[i][0] = get_property_send(conn, paths[i], "Requires");
+			pending[i][1] = get_property_send(conn, paths[i], "Wants");
+			oscap_free(paths[i]);
 		}
-		oscap_free(wants_s);
+
+		for (i = 0; i < count; ++i) {
+			struct target_deps *t = &cache->targets[start + i];
+
+			t->requires_s = get_property_reply(pending[i][0]);
+			if (t->requires_s != NULL)
+				t->requires = oscap_split(t->requires_s, ", ");
+
+			t->wants_s = get_property_reply(pending[i][1]);
+			if (t->wants_s != NULL)
+				t->wants = oscap_split(t->wants_s, ", ");
+		}
+
+		cache->resolved = start + count;
+
+		/* may move the array, so the lists are walked after the fetch */
+		for (i = start; i < start + count; ++i) {
+			char **requires = cache->targets[i].requires;
+			char **wants = cache->targets[i].wants;
+
+			target_cache_add_all(cache, requires);
+			target_cache_add_all(cache, wants);
+		}
+	}
+}
+
+static bool unit_chain_contains(const struct unit_chain *chain, const char *unit)
+{
+	for (; chain != NULL; chain = chain->up) {
+		if (strcmp(chain->unit, unit) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+static int report_dependencies(struct target_cache *cache, char **units, const struct unit_chain *chain, int(*callback)(const char *, void *), void *cbarg);
+
+static int get_all_dependencies_by_unit(struct target_cache *cache, const char *unit, const struct unit_chain *up, int(*callback)(const char *, void *), void *cbarg, bool include_requires, bool include_wants)
+{
+	struct unit_chain chain = { unit, up };
+	struct target_deps *t;
+	char **requires, **wants;
+
+	if (!unit || strcmp(unit, "(null)") == 0)
+		return 0;
+
+	// systemctl list-dependencies only recurses into target units
+	if (!is_unit_name_a_target(unit))
+		return 0;
+
+	t = target_cache_find(cache, unit);
+	if (t == NULL)
+		return 0;
+
+	requires = t->requires;
+	wants = t->wants;
+
+	if (include_requires && report_dependencies(cache, requires, &chain, callback, cbarg) != 0)
+		return 1;
+	if (include_wants && report_dependencies(cache, wants, &chain, callback, cbarg) != 0)
+		return 1;
+
+	return 0;
+}
+
+static int report_dependencies(struct target_cache *cache, char **units, const struct unit_chain *chain, int(*callback)(const char *, void *), void *cbarg)
+{
+	for (int i = 0; units != NULL && units[i] != NULL; ++i) {
+		if (oscap_strcmp(units[i], "") == 0)
+			continue;
+
+		if (callback(units[i], cbarg) != 0)
+			return 1;
+
+		if (unit_chain_contains(chain, units[i]))
+			continue;
+
+		if (get_all_dependencies_by_unit(cache, units[i], chain,
+						 callback, cbarg, true, true) != 0)
+			return 1;
 	}
 
-	oscap_free(path);
+	return 0;
 }
 
 static int dependency_callback(const char *dependency, void *cbarg)
@@ -220,7 +309,8 @@ static int unit_callback(const char *unit, void *cbarg)
 					 "unit", OVAL_DATATYPE_SEXP, se_unit,
 					 NULL);
 
-	get_all_dependencies_by_unit(vars->dbus_conn, unit,
+	target_cache_resolve(vars->dbus_conn, &vars->targets, unit);
+	get_all_dependencies_by_unit(&vars->targets, unit, NULL,
 				     dependency_callback, item, true, true);
 
 	probe_item_collect(vars->ctx, item);
@@ -242,14 +332,9 @@ int probe_main(probe_ctx *ctx, void *probe_arg)
 		return PROBE_EOPNOTSUPP;
 	}
 
-	DBusError dbus_error;
-	DBusConnection *dbus_conn;
-
-	dbus_error_init(&dbus_error);
-	dbus_conn = connect_dbus();
+	DBusConnection *dbus_conn = (DBusConnection *)probe_arg;
 
 	if (dbus_conn == NULL) {
-		dbus_error_free(&dbus_error);
 		return PROBE_ESYSTEM;
 	}
 
@@ -257,15 +342,15 @@ int probe_main(probe_ctx *ctx, void *probe_arg)
 
 	struct unit_callback_vars vars;
 
+	memset(&vars, 0, sizeof(vars));
 	vars.dbus_conn = dbus_conn;
 	vars.ctx = ctx;
 	vars.unit_entity = unit_entity;
 
 	get_all_systemd_units(dbus_conn, unit_callback, &vars);
 
+	target_cache_free(&vars.targets);
 	SEXP_free(unit_entity);
-	dbus_error_free(&dbus_error);
-	disconnect_dbus(dbus_conn);
 
         return 0;
 }
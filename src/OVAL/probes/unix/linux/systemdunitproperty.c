@@ -35,52 +35,21 @@
 #include "probe/entcmp.h"
 #include "systemdshared.h"
 
-static int get_all_properties_by_unit_path(DBusConnection *conn, const char *unit_path, int(*callback)(const char *name, const char *value, void *arg), void *cbarg)
+static DBusPendingCall *get_all_properties_send(DBusConnection *conn, const char *unit_path)
+{
+	return dbus_call_send(conn, unit_path, "org.freedesktop.DBus.Properties", "GetAll",
+			      "org.freedesktop.systemd1.Unit", NULL);
+}
+
+static int get_all_properties_reply(DBusPendingCall *pending, int(*callback)(const char *name, const char *value, void *arg), void *cbarg)
 {
 	int ret = 1;
 	DBusMessage *msg = NULL;
-	DBusPendingCall *pending = NULL;
-
-	msg = dbus_message_new_method_call(
-		"org.freedesktop.systemd1",
-		unit_path,
-		"org.freedesktop.DBus.Properties",
-		"GetAll"
-	);
-	if (msg == NULL) {
-		dI("Failed to create dbus_message via dbus_message_new_method_call!");
-		goto cleanup;
-	}
-
 	DBusMessageIter args, property_iter;
 
-	const char *interface = "org.freedesktop.systemd1.Unit";
-
-	dbus_message_iter_init_append(msg, &args);
-	if (!dbus_message_iter_append_basic(&args, DBUS_TYPE_STRING, &interface)) {
-		dI("Failed to append interface '%s' string parameter to dbus message!", interface);
+	msg = dbus_call_reply(pending);
+	if (msg == NULL)
 		goto cleanup;
-	}
-
-	if (!dbus_connection_send_with_reply(conn, msg, &pending, -1)) {
-		dI("Failed to send message via dbus!");
-		goto cleanup;
-	}
-	if (pending == NULL) {
-		dI("Invalid dbus pending call!");
-		goto cleanup;
-	}
-
-	dbus_connection_flush(conn);
-	dbus_message_unref(msg); msg = NULL;
-
-	dbus_pending_call_block(pending);
-	msg = dbus_pending_call_steal_reply(pending);
-	if (msg == NULL) {
-		dI("Failed to steal dbus pending call reply.");
-		goto cleanup;
-	}
-	dbus_pending_call_unref(pending); pending = NULL;
 
 	if (!dbus_message_iter_init(msg, &args)) {
 		dI("Failed to initialize iterator over received dbus message.");
@@ -157,9 +126,6 @@ static int get_all_properties_by_unit_path(DBusConnection *conn, const char *uni
 	ret = 0;
 
 cleanup:
-	if (pending != NULL)
-		dbus_pending_call_unref(pending);
-
 	if (msg != NULL)
 		dbus_message_unref(msg);
 
@@ -174,6 +140,9 @@ struct unit_callback_vars {
 	SEXP_t *se_unit;
 	SEXP_t *se_property;
 	SEXP_t *item;
+	char **units; /* matching units, collected by unit_callback() */
+	size_t units_count;
+	size_t units_alloc;
 };
 
 static int property_callback(const char *property, const char *value, void *cbarg)
@@ -227,28 +196,67 @@ static int unit_callback(const char *unit, void *cbarg)
 		return 0;
 	}
 
-	vars->se_unit = se_unit;
-	vars->se_property = NULL;
-	vars->item = NULL;
-
-	char *unit_path = get_path_by_unit(vars->dbus_conn, unit);
+	SEXP_free(se_unit);
 
-	if (unit_path == NULL) {
-		return 1;
+	if (vars->units_count == vars->units_alloc) {
+		vars->units_alloc = vars->units_alloc > 0 ? vars->units_alloc * 2 : 64;
+		vars->units = oscap_realloc(vars->units, vars->units_alloc * sizeof(char *));
 	}
 
-	get_all_properties_by_unit_path(vars->dbus_conn, unit_path,
-					property_callback, vars);
+	vars->units[vars->units_count++] = oscap_strdup(unit);
+	return 0;
+}
 
-	if (vars->item != NULL) {
-		probe_item_collect(vars->ctx, vars->item);
-		vars->item = NULL;
-		SEXP_free(vars->se_property);
-		vars->se_property = NULL;
-	}
+/*
+ * Collect the properties of the matching units. The LoadUnit and GetAll
+ * calls of up to SYSTEMD_DBUS_PIPELINE units are sent before waiting for
+ * their replies.
+ */
+static void collect_units(struct unit_callback_vars *vars)
+{
+	DBusPendingCall *pending[SYSTEMD_DBUS_PIPELINE];
+	char *paths[SYSTEMD_DBUS_PIPELINE];
+	size_t start, count, i;
+
+	for (start = 0; start < vars->units_count; start += count) {
+		count = vars->units_count - start;
+		if (count > SYSTEMD_DBUS_PIPELINE)
+			count = SYSTEMD_DBUS_PIPELINE;
+
+		for (i = 0; i < count; ++i)
+			pending[i] = load_unit_send(vars->dbus_conn, vars->units[start + i]);
+		for (i = 0; i < count; ++i)
+			paths[i] = load_unit_reply(pending[i]);
+		for (i = 0; i < count; ++i)
+			pending[i] = paths[i] != NULL ? get_all_properties_send(vars->dbus_conn, paths[i]) : NULL;
+
+		for (i = 0; i < count; ++i) {
+			const char *unit = vars->units[start + i];
+
+			oscap_free(paths[i]);
+
+			if (pending[i] == NULL) {
+				dI("Can't get the properties of unit '%s'.", unit);
+				continue;
+			}
 
-	SEXP_free(se_unit);
-	return 0;
+			vars->se_unit = SEXP_string_new(unit, strlen(unit));
+			vars->se_property = NULL;
+			vars->item = NULL;
+
+			get_all_properties_reply(pending[i], property_callback, vars);
+
+			if (vars->item != NULL) {
+				probe_item_collect(vars->ctx, vars->item);
+				vars->item = NULL;
+				SEXP_free(vars->se_property);
+				vars->se_property = NULL;
+			}
+
+			SEXP_free(vars->se_unit);
+			vars->se_unit = NULL;
+		}
+	}
 }
 
 int probe_main(probe_ctx *ctx, void *probe_arg)
@@ -267,14 +275,9 @@ int probe_main(probe_ctx *ctx, void *probe_arg)
 	unit_entity = probe_obj_getent(probe_in, "unit", 1);
 	property_entity = probe_obj_getent(probe_in, "property", 1);
 
-	DBusError dbus_error;
-	DBusConnection *dbus_conn;
-
-	dbus_error_init(&dbus_error);
-	dbus_conn = connect_dbus();
+	DBusConnection *dbus_conn = (DBusConnection *)probe_arg;
 
 	if (dbus_conn == NULL) {
-		dbus_error_free(&dbus_error);
 		SEXP_free(property_entity);
 		SEXP_free(unit_entity);
 		return PROBE_ESYSTEM;
@@ -282,17 +285,21 @@ int probe_main(probe_ctx *ctx, void *probe_arg)
 
 	struct unit_callback_vars vars;
 
+	memset(&vars, 0, sizeof(vars));
 	vars.dbus_conn = dbus_conn;
 	vars.ctx = ctx;
 	vars.unit_entity = unit_entity;
 	vars.property_entity = property_entity;
 
 	get_all_systemd_units(dbus_conn, unit_callback, &vars);
+	collect_units(&vars);
+
+	while (vars.units_count > 0)
+		oscap_free(vars.units[--vars.units_count]);
+	oscap_free(vars.units);
 
 	SEXP_free(unit_entity);
 	SEXP_free(property_entity);
-	dbus_error_free(&dbus_error);
-	disconnect_dbus(dbus_conn);
 
 	return 0;
 }
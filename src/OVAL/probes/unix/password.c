@@ -97,45 +97,190 @@ static void report_finding(struct result_info *res, probe_ctx *ctx, oval_schema_
         probe_item_collect(ctx, item);
 }
 
-static int read_password(SEXP_t *un_ent, probe_ctx *ctx, oval_schema_version_t over)
+/*
+ * The user database, read once by probe_init(). The entries are kept in
+ * the order in which getpwent() returned them, byname is sorted by name
+ * so that an object with a plain "equals" username is a lookup.
+ */
+struct pw_entry {
+        char *name;
+        char *passwd;
+        uid_t uid;
+        gid_t gid;
+        char *gecos;
+        char *dir;
+        char *shell;
+};
+
+struct pw_index {
+        struct pw_entry *entries;
+        size_t *byname;
+        size_t count;
+};
+
+static struct pw_index g_index;
+
+static int pw_byname_cmp(const void *a, const void *b)
+{
+        size_t i = *(const size_t *)a, j = *(const size_t *)b;
+        int c = strcmp(g_index.entries[i].name, g_index.entries[j].name);
+
+        if (c != 0)
+                return c;
+        return (i > j) - (i < j);
+}
+
+static void pw_index_build(struct pw_index *idx)
 {
         struct passwd *pw;
+        size_t alloc = 0, i;
 
+        setpwent();
         while ((pw = getpwent())) {
-                SEXP_t *un;
+                struct pw_entry *e;
 
-                dI("Have user: %s", pw->pw_name);
-                un = SEXP_string_newf("%s", pw->pw_name);
-                if (probe_entobj_cmp(un_ent, un) == OVAL_RESULT_TRUE) {
-                        struct result_info r;
-
-                        r.username = pw->pw_name;
-                        r.password = pw->pw_passwd;
-                        r.user_id = pw->pw_uid;
-                        r.group_id = pw->pw_gid;
-                        r.gcos = pw->pw_gecos;
-                        r.home_dir = pw->pw_dir;
-                        r.login_shell = pw->pw_shell;
-                        r.last_login = -1;
-
-                        if (oval_schema_version_cmp(over, OVAL_SCHEMA_VERSION(5.10)) >= 0) {
-	                        FILE *ll_fp = fopen(_PATH_LASTLOG, "r");
-
-	                        if (ll_fp != NULL) {
-		                        struct lastlog ll;
-
-		                        if (fseeko(ll_fp, (off_t)pw->pw_uid * sizeof(ll), SEEK_SET) == 0)
-			                        if (fread((char *)&ll, sizeof(ll), 1, ll_fp) == 1)
-				                        r.last_login = (int64_t)ll.ll_time;
-		                        fclose(ll_fp);
-	                        }
-                        }
-
-                        report_finding(&r, ctx, over);
+                if (idx->count == alloc) {
+                        alloc = alloc > 0 ? alloc * 2 : 128;
+                        idx->entries = oscap_realloc(idx->entries, alloc * sizeof(struct pw_entry));
                 }
-                SEXP_free(un);
+
+                e = &idx->entries[idx->count++];
+                e->name   = oscap_strdup(pw->pw_name);
+                e->passwd = oscap_strdup(pw->pw_passwd);
+                e->uid    = pw->pw_uid;
+                e->gid    = pw->pw_gid;
+                e->gecos  = oscap_strdup(pw->pw_gecos);
+                e->dir    = oscap_strdup(pw->pw_dir);
+                e->shell  = oscap_strdup(pw->pw_shell);
         }
         endpwent();
+
+        idx->byname = oscap_alloc((idx->count > 0 ? idx->count : 1) * sizeof(size_t));
+        for (i = 0; i < idx->count; ++i)
+                idx->byname[i] = i;
+        qsort(idx->byname, idx->count, sizeof(size_t), pw_byname_cmp);
+
+        dI("Read %zu users.", idx->count);
+}
+
+static void pw_index_free(struct pw_index *idx)
+{
+        size_t i;
+
+        for (i = 0; i < idx->count; ++i) {
+                oscap_free(idx->entries[i].name);
+                oscap_free(idx->entries[i].passwd);
+                oscap_free(idx->entries[i].gecos);
+                oscap_free(idx->entries[i].dir);
+                oscap_free(idx->entries[i].shell);
+        }
+
+        oscap_free(idx->entries);
+        oscap_free(idx->byname);
+        memset(idx, 0, sizeof *idx);
+}
+
+/* the username of a plain "equals" entity, NULL for anything else */
+static char *get_equals_name(SEXP_t *un_ent)
+{
+        SEXP_t *val;
+        char *name = NULL;
+
+        if (probe_ent_attrexists(un_ent, "var_ref"))
+                return NULL;
+
+        val = probe_ent_getattrval(un_ent, "operation");
+        if (val != NULL) {
+                oval_operation_t op = (oval_operation_t) SEXP_number_geti_32(val);
+
+                SEXP_free(val);
+                if (op != OVAL_OPERATION_EQUALS)
+                        return NULL;
+        }
+
+        val = probe_ent_getval(un_ent);
+        if (val != NULL) {
+                name = SEXP_string_cstr(val);
+                SEXP_free(val);
+        }
+
+        return name;
+}
+
+static void report_entry(const struct pw_entry *pw, probe_ctx *ctx, oval_schema_version_t over)
+{
+        struct result_info r;
+
+        r.username = pw->name;
+        r.password = pw->passwd;
+        r.user_id = pw->uid;
+        r.group_id = pw->gid;
+        r.gcos = pw->gecos;
+        r.home_dir = pw->dir;
+        r.login_shell = pw->shell;
+        r.last_login = -1;
+
+        if (oval_schema_version_cmp(over, OVAL_SCHEMA_VERSION(5.10)) >= 0) {
+                FILE *ll_fp = fopen(_PATH_LASTLOG, "r");
+
+                if (ll_fp != NULL) {
+                        struct lastlog ll;
+
+                        if (fseeko(ll_fp, (off_t)pw->uid * sizeof(ll), SEEK_SET) == 0)
+                                if (fread((char *)&ll, sizeof(ll), 1, ll_fp) == 1)
+                                        r.last_login = (int64_t)ll.ll_time;
+                        fclose(ll_fp);
+                }
+        }
+
+        report_finding(&r, ctx, over);
+}
+
+static int read_password(SEXP_t *un_ent, probe_ctx *ctx, oval_schema_version_t over)
+{
+        char *name;
+        size_t i, lo, hi, mid;
+
+        name = get_equals_name(un_ent);
+
+        if (name != NULL) {
+                lo = 0;
+                hi = g_index.count;
+
+                while (lo < hi) {
+                        mid = lo + (hi - lo) / 2;
+
+                        if (strcmp(g_index.entries[g_index.byname[mid]].name, name) < 0)
+                                lo = mid + 1;
+                        else
+                                hi = mid;
+                }
+
+                for (i = lo; i < g_index.count; ++i) {
+                        const struct pw_entry *pw = &g_index.entries[g_index.byname[i]];
+
+                        if (strcmp(pw->name, name) != 0)
+                                break;
+
+                        dI("Have user: %s", pw->name);
+                        report_entry(pw, ctx, over);
+                }
+
+                oscap_free(name);
+                return 0;
+        }
+
+        for (i = 0; i < g_index.count; ++i) {
+                const struct pw_entry *pw = &g_index.entries[i];
+                SEXP_t *un;
+
+                dI("Have user: %s", pw->name);
+                un = SEXP_string_newf("%s", pw->name);
+                if (probe_entobj_cmp(un_ent, un) == OVAL_RESULT_TRUE)
+                        report_entry(pw, ctx, over);
+                SEXP_free(un);
+        }
+
         return 0;
 }
 
@@ -143,9 +288,16 @@ void *probe_init(void)
 {
 	// Intentionally commented-out, see commit message
 	// probe_setoption(PROBEOPT_OFFLINE_MODE_SUPPORTED, PROBE_OFFLINE_CHROOT);
+	pw_index_build(&g_index);
 	return (NULL);
 }
 
+void probe_fini(void *arg)
+{
+	(void)arg;
+	pw_index_free(&g_index);
+}
+
 int probe_main(probe_ctx *ctx, void *arg)
 {
 	SEXP_t *ent, *obj;
@@ -104,6 +104,7 @@ extern char const *_cap_names[];
 #include "common/debug_priv.h"
 #include <ctype.h>
 #include "common/oscap_buffer.h"
+#include "oval_proctab.h"
 
 /* Convenience structure for the results being reported */
 struct result_info {
@@ -124,27 +125,56 @@ struct result_info {
 	int session_id;
 };
 
+static probe_itemtpl_t *g_item_tpl = NULL;
+
+void *probe_init(void)
+{
+	/* in the order of the values passed by report_finding() */
+	g_item_tpl = probe_itemtpl_new(OVAL_UNIX_PROCESS58,
+	                               "command_line", OVAL_DATATYPE_STRING,
+	                               "exec_time",    OVAL_DATATYPE_STRING,
+	                               "pid",          OVAL_DATATYPE_INTEGER,
+	                               "ppid",         OVAL_DATATYPE_INTEGER,
+	                               "priority",     OVAL_DATATYPE_INTEGER,
+	                               "ruid",         OVAL_DATATYPE_INTEGER,
+	                               "scheduling_class", OVAL_DATATYPE_STRING,
+	                               "start_time",   OVAL_DATATYPE_STRING,
+	                               "tty",          OVAL_DATATYPE_STRING,
+	                               "user_id",      OVAL_DATATYPE_INTEGER,
+	                               "exec_shield",  OVAL_DATATYPE_BOOLEAN,
+	                               "loginuid",     OVAL_DATATYPE_INTEGER,
+	                               "posix_capability", OVAL_DATATYPE_STRING_M,
+	                               "selinux_domain_label", OVAL_DATATYPE_STRING,
+	                               "session_id",   OVAL_DATATYPE_INTEGER,
+	                               NULL);
+	return (NULL);
+}
+
+void probe_fini(void *arg)
+{
+	probe_itemtpl_free(g_item_tpl);
+}
+
 static void report_finding(struct result_info *res, probe_ctx *ctx)
 {
         SEXP_t *item;
 
-        item = probe_item_create(OVAL_UNIX_PROCESS58, NULL,
-                                 "command_line", OVAL_DATATYPE_STRING, res->command_line,
-                                 "exec_time",    OVAL_DATATYPE_STRING, res->exec_time,
-                                 "pid",          OVAL_DATATYPE_INTEGER, (int64_t)res->pid,
-                                 "ppid",         OVAL_DATATYPE_INTEGER, (int64_t)res->ppid,
-                                 "priority",     OVAL_DATATYPE_INTEGER, (int64_t)res->priority,
-				 "ruid",         OVAL_DATATYPE_INTEGER, (int64_t) res->ruid,
-                                 "scheduling_class", OVAL_DATATYPE_STRING, res->scheduling_class,
-                                 "start_time",   OVAL_DATATYPE_STRING, res->start_time,
-                                 "tty",          OVAL_DATATYPE_STRING, res->tty,
-                                 "user_id",      OVAL_DATATYPE_INTEGER, (int64_t)res->user_id,
-                                 "exec_shield",  OVAL_DATATYPE_BOOLEAN, (bool)res->exec_shield,
-                                 "loginuid",     OVAL_DATATYPE_INTEGER, (int64_t)res->loginuid,
-				 "posix_capability", OVAL_DATATYPE_STRING_M, res->posix_capability,
-				 "selinux_domain_label", OVAL_DATATYPE_STRING, res->selinux_domain_label,
-                                 "session_id", OVAL_DATATYPE_INTEGER, (int64_t)res->session_id,
-                                 NULL);
+        item = probe_itemtpl_item(g_item_tpl,
+                                  res->command_line,
+                                  res->exec_time,
+                                  (int64_t)res->pid,
+                                  (int64_t)res->ppid,
+                                  (int64_t)res->priority,
+                                  (int64_t)res->ruid,
+                                  res->scheduling_class,
+                                  res->start_time,
+                                  res->tty,
+                                  (int64_t)res->user_id,
+                                  (bool)res->exec_shield,
+                                  (int64_t)res->loginuid,
+                                  res->posix_capability,
+                                  res->selinux_domain_label,
+                                  (int64_t)res->session_id);
 
         probe_item_collect(ctx, item);
 }
@@ -179,31 +209,19 @@ static void get_boot_time(void)
 	fclose(sf);
 }
 
-static int get_uids(int pid, struct result_info *r)
+static int get_uids(struct oval_proc *proc, struct result_info *r)
 {
 	char buf[100];
 	FILE *sf;
+	int pid = oval_proc_pid(proc);
 
 	r->ruid = -1;
 	r->user_id = -1;
 	r->loginuid = -1;
 
-	snprintf(buf, sizeof(buf), "/proc/%d/status", pid);
-	sf = fopen(buf, "rt");
-	if (sf) {
-		int line = 0;
-		__fsetlocking(sf, FSETLOCKING_BYCALLER);
-		while (fgets(buf, sizeof(buf), sf)) {
-			if (line == 0) {
-				line++;
-				continue;
-			}
-			if (memcmp(buf, "Uid:", 4) == 0) {
-				sscanf(buf, "Uid: %d %d", &r->ruid, &r->user_id);
-				break;
-			}
-		}
-		fclose(sf);
+	if (oval_proc_uids(proc, &r->ruid, &r->user_id) != 0) {
+		r->ruid = -1;
+		r->user_id = -1;
 	}
 
 	snprintf(buf, sizeof(buf), "/proc/%d/loginuid", pid);
@@ -357,41 +375,22 @@ static int get_exec_shield_status(int pid) {
 }
 
 /**
- * Parse /proc/%d/cmdline file
- * @param filepath Path to file ~ use preallocated buffer for the path
+ * Format the content of /proc/%d/cmdline file
+ * @param proc process from the process table snapshot
  * @param buffer output buffer with non-zero size
  * @return ps-like command info or NULL
  */
-static inline bool get_process_cmdline(const char* filepath, struct oscap_buffer* const buffer){
+static inline bool get_process_cmdline(struct oval_proc *proc, struct oscap_buffer* const buffer){
 
-	int fd = open(filepath, O_RDONLY, 0);
+	size_t cmdline_len;
+	const char *cmdline = oval_proc_cmdline(proc, &cmdline_len);
 
-	if (fd < 0) {
+	if (cmdline == NULL) {
 		return false;
 	}
 
 	oscap_buffer_clear(buffer);
-
-
-
-	for(;;) {
-		static const int chunk_size = 1024;
-		char chunk[chunk_size];
-		// Read data, store to buffer
-		ssize_t read_size = read(fd, chunk, chunk_size );
-		if (read_size < 0) {
-			close(fd);
-			return false;
-		}
-		oscap_buffer_append_binary_data(buffer, chunk, read_size);
-
-		// If reach end of file, then end the loop
-		if (chunk_size != read_size) {
-			break;
-		}
-	}
-
-	close(fd);
+	oscap_buffer_append_binary_data(buffer, cmdline, cmdline_len);
 
 	int length = oscap_buffer_get_length(buffer);
 	char* buffer_mem = oscap_buffer_get_raw(buffer);
@@ -437,12 +436,12 @@ static inline char *make_defunc_str(char* const cmd_buffer){
 static int read_process(SEXP_t *cmd_ent, SEXP_t *pid_ent, probe_ctx *ctx)
 {
 	int err = 1, max_cap_id;
-	DIR *d;
-	struct dirent *ent;
+	const struct oval_proctab *proctab;
+	size_t proc_i;
 	oval_schema_version_t oval_version;
 
-	d = opendir("/proc");
-	if (d == NULL)
+	proctab = oval_proctab_get();
+	if (proctab == NULL)
 		return err;
 
 	// Get the time tick hertz
@@ -461,52 +460,37 @@ static int read_process(SEXP_t *cmd_ent, SEXP_t *pid_ent, probe_ctx *ctx)
 	char cmd_buffer[1 + 15 + 11 + 1]; // Format:" [ cmd:15 ] <defunc>"
 	cmd_buffer[0] = '[';
 
-	// Scan the directories
-	while (( ent = readdir(d) )) {
-		int fd, len;
-		char buf[256];
-		char *tmp, state, tty_dev[128];
-		int pid, ppid, pgrp, session, tty_nr, tpgid;
-		unsigned flags, sched_policy;
-		unsigned long minflt, cminflt, majflt, cmajflt, uutime, ustime;
-		long cutime, cstime, priority, cnice, nthreads, itrealvalue;
+	// Scan the processes
+	for (proc_i = 0; proc_i < proctab->count; ++proc_i) {
+		struct oval_proc *process = proctab->procs[proc_i];
+		const struct oval_proc_stat *st;
+		char tty_dev[128];
+		int pid, ppid, session, tty_nr;
+		unsigned sched_policy;
+		unsigned long uutime, ustime;
+		long priority;
 		unsigned long long start;
+		char state;
 		SEXP_t *cmd_sexp = NULL, *pid_sexp = NULL;
 
-		// Skip non-process58 dir entries
-		if(*ent->d_name<'0' || *ent->d_name>'9')
-			continue;
-		errno = 0;
-		pid = strtol(ent->d_name, NULL, 10);
-		if (errno || pid == 2) // skip err & kthreads
+		pid = oval_proc_pid(process);
+		if (pid == 2) // skip kthreads
 			continue;
 
 		// Parse up the stat file for the proc
-		snprintf(buf, 32, "/proc/%d/stat", pid);
-		fd = open(buf, O_RDONLY, 0);
-		if (fd < 0)
-			continue;
-		len = read(fd, buf, sizeof buf - 1);
-		close(fd);
-		if (len < 40)
-			continue;
-		buf[len] = 0;
-		tmp = strrchr(buf, ')');
-		if (tmp)
-			*tmp = 0;
-		else
+		st = oval_proc_stat(process);
+		if (st == NULL)
 			continue;
 		memset(cmd_buffer + 1, 0, sizeof(cmd_buffer)-1); // clear cmd after starting '['
-		sscanf(buf, "%d (%15c", &ppid, cmd_buffer + 1);
-		sscanf(tmp+2,	"%c %d %d %d %d %d "
-				"%u %lu %lu %lu %lu "
-				"%lu %lu %lu %ld %ld "
-				"%ld %ld %ld %llu",
-			&state, &ppid, &pgrp, &session, &tty_nr, &tpgid,
-			&flags, &minflt, &cminflt, &majflt, &cmajflt,
-			&uutime, &ustime, &cutime, &cstime, &priority,
-			&cnice, &nthreads, &itrealvalue, &start
-		);
+		memcpy(cmd_buffer + 1, st->comm, 15);
+		state = st->state;
+		ppid = st->ppid;
+		session = st->session;
+		tty_nr = st->tty_nr;
+		uutime = st->utime;
+		ustime = st->stime;
+		priority = st->priority;
+		start = st->start_time;
 
 		// Skip kthreads
 		if (ppid == 2)
@@ -516,8 +500,7 @@ static int read_process(SEXP_t *cmd_ent, SEXP_t *pid_ent, probe_ctx *ctx)
 		if (state == 'Z') { // zombie
 			cmd = make_defunc_str(cmd_buffer);
 		} else {
-			snprintf(buf, 32, "/proc/%d/cmdline", pid);
-			if (get_process_cmdline(buf, cmdline_buffer)) {
+			if (get_process_cmdline(process, cmdline_buffer)) {
 				cmd = oscap_buffer_get_raw(cmdline_buffer); // use full cmdline
 			} else {
 				cmd = cmd_buffer + 1;
@@ -606,7 +589,7 @@ static int read_process(SEXP_t *cmd_ent, SEXP_t *pid_ent, probe_ctx *ctx)
 
 			r.session_id = session;
 
-			get_uids(pid, &r);
+			get_uids(process, &r);
 			report_finding(&r, ctx);
 
 			if (selinux_domain_label != NULL)
@@ -622,8 +605,8 @@ static int read_process(SEXP_t *cmd_ent, SEXP_t *pid_ent, probe_ctx *ctx)
 		SEXP_free(cmd_sexp);
 		SEXP_free(pid_sexp);
 	}
-        closedir(d);
 	oscap_buffer_free(cmdline_buffer);
+	oval_proctab_put(proctab);
 	return err;
 }
 
@@ -49,6 +49,11 @@
 #include "assume.h"
 #include "debug_priv.h"
 #include "SEAP/generic/strto.h"
+#include "oval_rtnl.h"
+
+#if defined(__linux__)
+#include <linux/rtnetlink.h>
+#endif
 
 #ifndef RT_FLAGS_MAX
 #define RT_FLAGS_MAX 10
@@ -276,6 +281,66 @@ static int process_line_ip6(char *line, struct route_info *rt)
     return 0;
 }
 
+#if defined(__linux__)
+/*
+ * Collect the routes from the netlink snapshot. The flags are derived the
+ * way the kernel does for /proc/net/route and /proc/net/ipv6_route, the
+ * IPv4 routes are those of the main table.
+ */
+static void collect_rtnl(const struct oval_rtnl *rtnl, int family, struct route_info *rt, probe_ctx *ctx)
+{
+    const struct oval_rtnl_route *route;
+    const struct oval_rtnl_link *link;
+    size_t r;
+    int i;
+
+    for (r = 0; r < rtnl->routes_count; ++r) {
+        route = &rtnl->routes[r];
+
+        if (route->family != family)
+            continue;
+        if (family == AF_INET && (route->table != RT_TABLE_MAIN
+            || route->type == RTN_BROADCAST || route->type == RTN_MULTICAST))
+            continue;
+
+        inet_ntop(family, route->dst, rt->ip_dst, sizeof rt->ip_dst);
+        inet_ntop(family, route->gateway, rt->ip_gw, sizeof rt->ip_gw);
+
+        link = route->oif != 0 ? oval_rtnl_link(rtnl, route->oif) : NULL;
+        if (link != NULL)
+            strncpy(rt->if_name, link->name, IF_NAME_MAXLEN);
+        else
+            strcpy(rt->if_name, family == AF_INET ? "*" : "");
+
+        i = 0;
+        rt->rt_flags[i++] = "UP";
+        if (route->has_gateway)
+            rt->rt_flags[i++] = "GATEWAY";
+
+        if (family == AF_INET) {
+            if (route->dst_len == 32)
+                rt->rt_flags[i++] = "HOST";
+            if (route->type == RTN_UNREACHABLE || route->type == RTN_PROHIBIT)
+                rt->rt_flags[i++] = "REJECT";
+            rt->ip_version = 4;
+        } else {
+            if (route->protocol == RTPROT_RA)
+                rt->rt_flags[i++] = "ADDRCONF";
+            if (route->flags & RTM_F_CLONED)
+                rt->rt_flags[i++] = "CACHE";
+            if (route->type == RTN_UNREACHABLE || route->type == RTN_PROHIBIT
+                || route->type == RTN_BLACKHOLE || route->type == RTN_THROW)
+                rt->rt_flags[i++] = "REJECT";
+            rt->ip_version = 6;
+        }
+        rt->rt_flags[i] = NULL;
+
+        if (collect_item(rt, ctx) != 0)
+            break;
+    }
+}
+#endif
+
 int probe_main(probe_ctx *ctx, void *arg)
 {
 	SEXP_t *probe_in, *dst_ent;
@@ -284,6 +349,9 @@ int probe_main(probe_ctx *ctx, void *arg)
 	size_t line_len;
         struct route_info rt;
         int probe_ret = 0;
+#if defined(__linux__)
+	const struct oval_rtnl *rtnl;
+#endif
 
 	probe_in = probe_ctx_getobject(ctx);
 	dst_ent  = probe_obj_getent(probe_in, "destination", 1);
@@ -296,6 +364,26 @@ int probe_main(probe_ctx *ctx, void *arg)
 	line_buf = NULL;
 	fp = NULL;
 
+#if defined(__linux__)
+	rtnl = oval_rtnl_get();
+	if (rtnl != NULL) {
+	  switch(probe_ent_getdatatype(dst_ent)) {
+	    case OVAL_DATATYPE_IPV4ADDR:
+	      collect_rtnl(rtnl, AF_INET, &rt, ctx);
+	      break;
+	    case OVAL_DATATYPE_IPV6ADDR:
+	      collect_rtnl(rtnl, AF_INET6, &rt, ctx);
+	      break;
+	    default:
+	      probe_ret = EINVAL;
+	  }
+
+	  oval_rtnl_put(rtnl);
+	  SEXP_free(dst_ent);
+	  return (probe_ret);
+	}
+#endif
+
 	switch(probe_ent_getdatatype(dst_ent)) {
 	  case OVAL_DATATYPE_IPV4ADDR:
 	    fp = fopen("/proc/net/route", "r");
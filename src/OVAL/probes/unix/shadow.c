@@ -177,45 +177,178 @@ static void report_finding(struct result_info *res, probe_ctx *ctx)
         SEXP_free_r(&se_flg_mem);
 }
 
-static int read_shadow(SEXP_t *un_ent, probe_ctx *ctx)
+/*
+ * The shadow database, read once by probe_init(). The entries are kept
+ * in the order in which getspent() returned them, byname is sorted by
+ * name so that an object with a plain "equals" username is a lookup.
+ */
+struct sp_index {
+	struct spwd *entries;
+	size_t *byname;
+	size_t count;
+};
+
+static struct sp_index g_index;
+
+static int sp_byname_cmp(const void *a, const void *b)
+{
+	size_t i = *(const size_t *)a, j = *(const size_t *)b;
+	int c = strcmp(g_index.entries[i].sp_namp, g_index.entries[j].sp_namp);
+
+	if (c != 0)
+		return c;
+	return (i > j) - (i < j);
+}
+
+static void sp_index_build(struct sp_index *idx)
 {
-	int err = 1;
 	struct spwd *pw;
+	size_t alloc = 0, i;
 
+	setspent();
 	while ((pw = getspent())) {
+		struct spwd *e;
+
+		if (idx->count == alloc) {
+			alloc = alloc > 0 ? alloc * 2 : 128;
+			idx->entries = oscap_realloc(idx->entries, alloc * sizeof(struct spwd));
+		}
+
+		e = &idx->entries[idx->count++];
+		*e = *pw;
+		e->sp_namp = oscap_strdup(pw->sp_namp);
+		e->sp_pwdp = oscap_strdup(pw->sp_pwdp);
+	}
+	endspent();
+
+	idx->byname = oscap_alloc((idx->count > 0 ? idx->count : 1) * sizeof(size_t));
+	for (i = 0; i < idx->count; ++i)
+		idx->byname[i] = i;
+	qsort(idx->byname, idx->count, sizeof(size_t), sp_byname_cmp);
+
+	dI("Read %zu shadow entries.", idx->count);
+}
+
+static void sp_index_free(struct sp_index *idx)
+{
+	size_t i;
+
+	for (i = 0; i < idx->count; ++i) {
+		oscap_free(idx->entries[i].sp_namp);
+		oscap_free(idx->entries[i].sp_pwdp);
+	}
+
+	oscap_free(idx->entries);
+	oscap_free(idx->byname);
+	memset(idx, 0, sizeof *idx);
+}
+
+/* the username of a plain "equals" entity, NULL for anything else */
+static char *get_equals_name(SEXP_t *un_ent)
+{
+	SEXP_t *val;
+	char *name = NULL;
+
+	if (probe_ent_attrexists(un_ent, "var_ref"))
+		return NULL;
+
+	val = probe_ent_getattrval(un_ent, "operation");
+	if (val != NULL) {
+		oval_operation_t op = (oval_operation_t) SEXP_number_geti_32(val);
+
+		SEXP_free(val);
+		if (op != OVAL_OPERATION_EQUALS)
+			return NULL;
+	}
+
+	val = probe_ent_getval(un_ent);
+	if (val != NULL) {
+		name = SEXP_string_cstr(val);
+		SEXP_free(val);
+	}
+
+	return name;
+}
+
+static void report_entry(const struct spwd *pw, probe_ctx *ctx)
+{
+	struct result_info r;
+
+	r.username = pw->sp_namp;
+	r.password = pw->sp_pwdp;
+	r.chg_lst = pw->sp_lstchg;
+	r.chg_allow = pw->sp_min;
+	r.chg_req = pw->sp_max;
+	r.exp_warn = pw->sp_warn;
+	r.exp_inact = pw->sp_inact;
+	r.exp_date = pw->sp_expire;
+	r.flag = pw->sp_flag;
+
+	report_finding(&r, ctx);
+}
+
+static int read_shadow(SEXP_t *un_ent, probe_ctx *ctx)
+{
+	char *name;
+	size_t i, lo, hi, mid;
+
+	name = get_equals_name(un_ent);
+
+	if (name != NULL) {
+		lo = 0;
+		hi = g_index.count;
+
+		while (lo < hi) {
+			mid = lo + (hi - lo) / 2;
+
+			if (strcmp(g_index.entries[g_index.byname[mid]].sp_namp, name) < 0)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+
+		for (i = lo; i < g_index.count; ++i) {
+			const struct spwd *pw = &g_index.entries[g_index.byname[i]];
+
+			if (strcmp(pw->sp_namp, name) != 0)
+				break;
+
+			dI("Have user: %s", pw->sp_namp);
+			report_entry(pw, ctx);
+		}
+
+		oscap_free(name);
+		return g_index.count > 0 ? 0 : 1;
+	}
+
+	for (i = 0; i < g_index.count; ++i) {
+		const struct spwd *pw = &g_index.entries[i];
 		SEXP_t *un;
 
 		dI("Have user: %s", pw->sp_namp);
-		err = 0;
 		un = SEXP_string_newf("%s", pw->sp_namp);
-		if (probe_entobj_cmp(un_ent, un) == OVAL_RESULT_TRUE) {
-			struct result_info r;
-
-			r.username = pw->sp_namp;
-			r.password = pw->sp_pwdp;
-			r.chg_lst = pw->sp_lstchg;
-			r.chg_allow = pw->sp_min;
-			r.chg_req = pw->sp_max;
-			r.exp_warn = pw->sp_warn;
-			r.exp_inact = pw->sp_inact;
-			r.exp_date = pw->sp_expire;
-			r.flag = pw->sp_flag;
-
-			report_finding(&r, ctx);
-		}
+		if (probe_entobj_cmp(un_ent, un) == OVAL_RESULT_TRUE)
+			report_entry(pw, ctx);
 		SEXP_free(un);
 	}
-	endspent();
-	return err;
+
+	return g_index.count > 0 ? 0 : 1;
 }
 
 void *probe_init(void)
 {
 	// Intentionally commented-out, see commit message
 	// probe_setoption(PROBEOPT_OFFLINE_MODE_SUPPORTED, PROBE_OFFLINE_CHROOT);
+	sp_index_build(&g_index);
 	return (NULL);
 }
 
+void probe_fini(void *arg)
+{
+	(void)arg;
+	sp_index_free(&g_index);
+}
+
 int probe_main(probe_ctx *ctx, void *arg)
 {
 	SEXP_t *ent, *obj;
@@ -42,6 +42,7 @@
 
 #include <probe/probe.h>
 #include <probe/option.h>
+#include "oval_path_cache.h"
 
 static int collect_symlink(SEXP_t *ent, probe_ctx *ctx)
 {
@@ -85,7 +86,8 @@ static int collect_symlink(SEXP_t *ent, probe_ctx *ctx)
 		return 0;
 	}
 
-	linkname = realpath(pathname, NULL);
+	/* the chains through the same directories are resolved once */
+	linkname = oval_realpath(pathname);
 	if (linkname == NULL) {
 		if (errno == ENOENT) {
 			msg = probe_msg_creatf(OVAL_MESSAGE_LEVEL_ERROR,
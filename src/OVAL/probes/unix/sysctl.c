@@ -36,30 +36,309 @@
 #if defined(__linux__)
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include <errno.h>
 #include <limits.h>
-#include "oval_fts.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include "common/debug_priv.h"
 #include "common/assume.h"
 
 #define PROC_SYS_DIR "/proc/sys"
 #define PROC_SYS_MAXDEPTH 7
 
-int probe_main(probe_ctx *ctx, void *probe_arg)
+/*
+ * The MIBs under /proc/sys, collected once by probe_init() and sorted
+ * by name, so that an object doesn't have to walk the whole tree.
+ */
+struct sysctl_mib {
+	char *name; /* with '.' separators */
+	char *path;
+};
+
+struct sysctl_index {
+	struct sysctl_mib *mibs;
+	size_t count;
+	size_t alloc;
+};
+
+static struct sysctl_index g_index;
+
+static int sysctl_index_add(struct sysctl_index *idx, const char *path)
+{
+	struct sysctl_mib *mib;
+	char *p;
+
+	if (idx->count == idx->alloc) {
+		size_t alloc = idx->alloc > 0 ? idx->alloc * 2 : 1024;
+
+		mib = realloc(idx->mibs, alloc * sizeof *mib);
+		if (mib == NULL)
+			return (-1);
+		idx->mibs = mib;
+		idx->alloc = alloc;
+	}
+
+	mib = &idx->mibs[idx->count];
+	mib->path = strdup(path);
+	mib->name = strdup(path + strlen(PROC_SYS_DIR) + 1);
+
+	if (mib->path == NULL || mib->name == NULL) {
+		free(mib->path);
+		free(mib->name);
+		return (-1);
+	}
+
+	for (p = mib->name; *p != '\0'; ++p) {
+		if (*p == '/')
+			*p = '.';
+	}
+
+	++idx->count;
+	return (0);
+}
+
+static int sysctl_index_walk(struct sysctl_index *idx, const char *dir, int depth)
+{
+	char path[PATH_MAX];
+	struct dirent *ent;
+	struct stat st;
+	DIR *d;
+
+	d = opendir(dir);
+	if (d == NULL) {
+		dW("Can't open %s: %u, %s", dir, errno, strerror(errno));
+		return (0);
+	}
+
+	while ((ent = readdir(d)) != NULL) {
+		if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0)
+			continue;
+
+		snprintf(path, sizeof path, "%s/%s", dir, ent->d_name);
+
+		if (stat(path, &st) == -1) {
+			dE("Stat failed on %s: %u, %s", path, errno, strerror(errno));
+			continue;
+		}
+
+		if (S_ISDIR(st.st_mode)) {
+			if (depth < PROC_SYS_MAXDEPTH && sysctl_index_walk(idx, path, depth + 1) != 0)
+				goto fail;
+			continue;
+		}
+
+		/* Skip write-only files, eg. /proc/sys/net/ipv4/route/flush */
+		/* the sysctl utility uses same condition in sysctl.c in ReadSetting() */
+		if ((st.st_mode & S_IRUSR) == 0) {
+			dI("Skipping write-only file %s", path);
+			continue;
+		}
+
+		if (sysctl_index_add(idx, path) != 0)
+			goto fail;
+	}
+
+	closedir(d);
+	return (0);
+fail:
+	closedir(d);
+	return (-1);
+}
+
+static int sysctl_mib_cmp(const void *a, const void *b)
 {
-        OVAL_FTS    *ofts;
-        OVAL_FTSENT *ofts_ent;
+	return strcmp(((const struct sysctl_mib *)a)->name, ((const struct sysctl_mib *)b)->name);
+}
+
+static void sysctl_index_free(struct sysctl_index *idx)
+{
+	size_t i;
+
+	for (i = 0; i < idx->count; ++i) {
+		free(idx->mibs[i].name);
+		free(idx->mibs[i].path);
+	}
+
+	free(idx->mibs);
+	memset(idx, 0, sizeof *idx);
+}
+
+void *probe_init(void)
+{
+	if (sysctl_index_walk(&g_index, PROC_SYS_DIR, 1) != 0) {
+		dE("Can't index %s", PROC_SYS_DIR);
+		sysctl_index_free(&g_index);
+		return (NULL);
+	}
+
+	qsort(g_index.mibs, g_index.count, sizeof(struct sysctl_mib), sysctl_mib_cmp);
+	dI("Indexed %zu MIBs", g_index.count);
+
+	return (NULL);
+}
 
+void probe_fini(void *arg)
+{
+	(void)arg;
+	sysctl_index_free(&g_index);
+}
+
+/*
+ * Range [*lo, *hi) of the index which has to be checked against the name
+ * entity. A plain "equals" name is looked up, anything else is compared
+ * with every MIB.
+ */
+static void sysctl_index_range(SEXP_t *name_entity, size_t *lo, size_t *hi)
+{
+	SEXP_t *val;
+	char *name = NULL;
+	oval_operation_t op = OVAL_OPERATION_EQUALS;
+	size_t l, h, m;
+
+	*lo = 0;
+	*hi = g_index.count;
+
+	if (probe_ent_attrexists(name_entity, "var_ref"))
+		return;
+
+	val = probe_ent_getattrval(name_entity, "operation");
+	if (val != NULL) {
+		op = (oval_operation_t) SEXP_number_geti_32(val);
+		SEXP_free(val);
+	}
+
+	if (op != OVAL_OPERATION_EQUALS)
+		return;
+
+	val = probe_ent_getval(name_entity);
+	if (val != NULL) {
+		name = SEXP_string_cstr(val);
+		SEXP_free(val);
+	}
+
+	if (name == NULL)
+		return;
+
+	l = 0;
+	h = g_index.count;
+
+	while (l < h) {
+		m = l + (h - l) / 2;
+
+		if (strcmp(g_index.mibs[m].name, name) < 0)
+			l = m + 1;
+		else
+			h = m;
+	}
+
+	*lo = l;
+	*hi = (l < g_index.count && strcmp(g_index.mibs[l].name, name) == 0) ? l + 1 : l;
+	free(name);
+}
+
+static void sysctl_collect(probe_ctx *ctx, const struct sysctl_mib *mib, SEXP_t *se_mib, int over_cmp,
+                           char *sysval, size_t size)
+{
+	const char *ipv6_conf = "net.ipv6.conf.";
+	SEXP_t *item;
+	char   *sysvals[512];
+	ssize_t l;
+	long    i;
+	size_t  s;
+	int     fd;
+
+	/*
+	 * read sysctl value
+	 */
+	fd = open(mib->path, O_RDONLY);
+
+	if (fd < 0) {
+		dE("Can't read sysctl value from \"%s\": %u, %s",
+		   mib->path, errno, strerror(errno));
+		goto fail_item;
+	}
+
+	l = pread(fd, sysval, size - 1, 0);
+
+	if (l < 0) {
+		/* Linux 4.1.0 introduced a per-NIC IPv6 stable_secret file.
+		 * The stable_secret file cannot be read until it is set,
+		 * so we skip it when it is not readable. Otherwise we collect it.
+		 */
+		if (strncmp(mib->name, ipv6_conf, strlen(ipv6_conf)) == 0 &&
+		    strcmp(strrchr(mib->name, '.'), ".stable_secret") == 0) {
+			dI("Skippping file %s", mib->path);
+			close(fd);
+			return;
+		}
+
+		dE("An error ocured when reading from \"%s\": %u, %s",
+		   mib->path, errno, strerror(errno));
+		close(fd);
+		goto fail_item;
+	}
+
+	close(fd);
+
+	/*
+	 * sanitize the value
+	 *  - only printable and whitespace chars allowed
+	 *  - remove the last '\n'
+	 */
+	sysvals[0] = sysval;
+
+	for(s = 0, i = 0; i < l && s < sizeof sysvals/sizeof(char *) - 1; ++i) {
+		if ((!isprint(sysval[i]) && !isspace(sysval[i]))
+		    || (over_cmp >= 0 && sysval[i] == '\n' /* OVAL 5.10 and above */))
+		{
+			sysval[i] = '\0';
+			sysvals[++s] = sysval + i + 1;
+		}
+	}
+
+	if (l > 0 && sysval[l - 1] == '\n')
+		sysval[l - 1] = '\0';
+	else
+		sysval[l] = '\0';
+
+	if (strlen(sysvals[s]) == 0)
+		sysvals[s] = NULL;
+	else
+		sysvals[++s] = NULL;
+
+	if (over_cmp >= 0) {
+		/* Only in OVAL 5.10 and above */
+		item = probe_item_create(OVAL_UNIX_SYSCTL, NULL,
+		                         "name",  OVAL_DATATYPE_SEXP,   se_mib,
+		                         "value", OVAL_DATATYPE_STRING_M, sysvals,
+		                         NULL);
+	} else {
+		item = probe_item_create(OVAL_UNIX_SYSCTL, NULL,
+		                         "name",  OVAL_DATATYPE_SEXP,   se_mib,
+		                         "value", OVAL_DATATYPE_STRING, sysval,
+		                         NULL);
+	}
+
+	probe_item_collect(ctx, item);
+	return;
+fail_item:
+	item = probe_item_creat("sysctl_item", NULL, NULL);
+	probe_item_setstatus(item, SYSCHAR_STATUS_ERROR);
+	probe_item_collect(ctx, item);
+}
+
+int probe_main(probe_ctx *ctx, void *probe_arg)
+{
         SEXP_t *name_entity, *probe_in;
-        SEXP_t *r0, *r1, *r2, *r3;
-        SEXP_t *ent_attrs, *bh_entity, *path_entity, *filename_entity;
         oval_schema_version_t over;
         int over_cmp;
-
-	const char *ipv6_conf_path = "/proc/sys/net/ipv6/conf/";
-	size_t ipv6_conf_path_len = strlen(ipv6_conf_path);
+        size_t i, lo, hi;
+        char *sysval;
 
         probe_in    = probe_ctx_getobject(ctx);
         name_entity = probe_obj_getent(probe_in, "name", 1);
@@ -71,177 +350,35 @@ int probe_main(probe_ctx *ctx, void *probe_arg)
                 return (PROBE_ENOENT);
         }
 
-        /*
-         * prepare behaviors
-         */
-        ent_attrs = probe_attr_creat("max_depth",           r0 = SEXP_string_newf("%d", PROC_SYS_MAXDEPTH),
-                                     "recurse_direction",   r1 = SEXP_string_new("down", 4),
-                                     "recurse_file_system", r2 = SEXP_string_new("local", 7),
-                                     "recurse", r3 = SEXP_string_new("symlinks and directories", 24),
-                                     NULL);
-        bh_entity = probe_ent_creat1("behaviors", ent_attrs, NULL);
-        SEXP_vfree(r0, r1, r2, r3, ent_attrs, NULL);
+        /* the value buffer, reused for all of the matching MIBs */
+        sysval = malloc(8192);
 
-        /*
-         * prepare path, filename
-         */
-        ent_attrs = probe_attr_creat("operation", r0 = SEXP_number_newi(OVAL_OPERATION_EQUALS),
-                                     NULL);
-        path_entity = probe_ent_creat1("path", ent_attrs, r1 = SEXP_string_new(PROC_SYS_DIR, strlen(PROC_SYS_DIR)));
-        SEXP_vfree(r0, r1, NULL);
-
-        ent_attrs = probe_attr_creat("operation", r0 = SEXP_number_newi(OVAL_OPERATION_PATTERN_MATCH),
-                                     NULL);
-        filename_entity = probe_ent_creat1("filename", ent_attrs, r1 = SEXP_string_new(".*", 2));
-        SEXP_vfree(r0, r1, ent_attrs, NULL);
+        if (sysval == NULL) {
+                SEXP_free(name_entity);
+                return (PROBE_ENOMEM);
+        }
 
         /*
          * collect sysctls
-         *  XXX: use direct access for the "equals" op
          */
-        ofts = oval_fts_open(path_entity, filename_entity, NULL, bh_entity, probe_ctx_getresult(ctx));
-
-        if (ofts == NULL) {
-                dE("oval_fts_open(%s, %s) failed", PROC_SYS_DIR, ".\\+");
-                SEXP_vfree(path_entity, filename_entity, bh_entity, name_entity, NULL);
+        sysctl_index_range(name_entity, &lo, &hi);
 
-                return (PROBE_EFATAL);
-        }
-
-        while ((ofts_ent = oval_fts_read(ofts)) != NULL) {
+        for (i = lo; i < hi; ++i) {
+                const struct sysctl_mib *mib = &g_index.mibs[i];
                 SEXP_t *se_mib;
-                char    mibpath[PATH_MAX], *mib;
-                size_t  miblen;
-		struct stat file_stat;
-
-                snprintf(mibpath, sizeof mibpath, "%s/%s", ofts_ent->path, ofts_ent->file);
-
-		/* Skip write-only files, eg. /proc/sys/net/ipv4/route/flush */
-		if (stat(mibpath, &file_stat) == -1) {
-			dE("Stat failed on %s: %u, %s", mibpath, errno, strerror(errno));
-			oval_ftsent_free(ofts_ent);
-			continue;
-		}
-		/* the sysctl utility uses same condition in sysctl.c in ReadSetting() */
-		if ((file_stat.st_mode & S_IRUSR) == 0) {
-			dI("Skipping write-only file %s", mibpath);
-			oval_ftsent_free(ofts_ent);
-			continue;
-		}
-
-                mib    = strdup(mibpath + strlen(PROC_SYS_DIR) + 1);
-                miblen = strlen(mib);
-
-                while (miblen > 0) {
-                        if(mib[miblen - 1] == '/')
-                                mib[miblen - 1] = '.';
-                        --miblen;
-                }
 
-                dI("MIB: %s", mib);
-                se_mib = SEXP_string_new(mib, strlen(mib));
-                oscap_free(mib);
+                se_mib = SEXP_string_new(mib->name, strlen(mib->name));
 
                 if (probe_entobj_cmp(name_entity, se_mib) == OVAL_RESULT_TRUE) {
-                        FILE   *fp;
-                        SEXP_t *item;
-                        char    sysval[8192];
-                        char   *sysvals[512];
-                        long i, l;
-                        size_t s;
-
-                        dI("MIB match");
-
-                        /*
-                         * read sysctl value
-                         */
-                        fp = fopen(mibpath, "r");
-
-                        if (fp == NULL) {
-                                dE("Can't read sysctl value from \"%s\": %u, %s",
-                                   mibpath, errno, strerror(errno));
-                                goto fail_item;
-                        }
-
-                        l = fread(sysval, 1, sizeof sysval - 1, fp);
-
-                        if (ferror(fp)) {
-				/* Linux 4.1.0 introduced a per-NIC IPv6 stable_secret file.
-				 * The stable_secret file cannot be read until it is set,
-				 * so we skip it when it is not readable. Otherwise we collect it.
-				 */
-				if (strncmp(ofts_ent->path, ipv6_conf_path, ipv6_conf_path_len) == 0 &&
-						strcmp(ofts_ent->file, "stable_secret") == 0) {
-					dI("Skippping file %s", mibpath);
-					oval_ftsent_free(ofts_ent);
-					SEXP_free(se_mib);
-					fclose(fp);
-					continue;
-				} else {
-					dE("An error ocured when reading from \"%s\" (fp=%p): l=%ld, %u, %s",
-						mibpath, fp, l, errno, strerror(errno));
-					goto fail_item;
-				}
-                        }
-
-                        fclose(fp);
-
-                        /*
-                         * sanitize the value
-                         *  - only printable and whitespace chars allowed
-                         *  - remove the last '\n'
-                         */
-                        sysvals[0] = sysval;
-
-                        for(s = 0, i = 0; i < l && s < sizeof sysvals/sizeof(char *) - 1; ++i) {
-	                        if ((!isprint(sysval[i]) && !isspace(sysval[i]))
-	                            || (over_cmp >= 0 && sysval[i] == '\n' /* OVAL 5.10 and above */))
-                                {
-                                        sysval[i] = '\0';
-                                        sysvals[++s] = sysval + i + 1;
-                                }
-                        }
-
-                        if (sysval[l - 1] == '\n')
-                                sysval[l - 1] = '\0';
-                        else
-                                sysval[l] = '\0';
-
-                        if (strlen(sysvals[s]) == 0)
-                                sysvals[s] = NULL;
-                        else
-                                sysvals[++s] = NULL;
-
-                        if (over_cmp >= 0) {
-	                        /* Only in OVAL 5.10 and above */
-	                        item = probe_item_create(OVAL_UNIX_SYSCTL, NULL,
-	                                                 "name",  OVAL_DATATYPE_SEXP,   se_mib,
-	                                                 "value", OVAL_DATATYPE_STRING_M, sysvals,
-	                                                 NULL);
-                        } else {
-	                        item = probe_item_create(OVAL_UNIX_SYSCTL, NULL,
-	                                                 "name",  OVAL_DATATYPE_SEXP,   se_mib,
-	                                                 "value", OVAL_DATATYPE_STRING, sysval,
-	                                                 NULL);
-                        }
-
-                        goto add_item;
-                fail_item:
-                        if (fp != NULL)
-                                fclose(fp);
-
-                        item = probe_item_creat("sysctl_item", NULL, NULL);
-                        probe_item_setstatus(item, SYSCHAR_STATUS_ERROR);
-                add_item:
-                        probe_item_collect(ctx, item);
+                        dI("MIB match: %s", mib->name);
+                        sysctl_collect(ctx, mib, se_mib, over_cmp, sysval, 8192);
                 }
 
-                oval_ftsent_free(ofts_ent);
                 SEXP_free(se_mib);
         }
 
-        oval_fts_close(ofts);
-	SEXP_vfree(path_entity, filename_entity, bh_entity, name_entity);
+        free(sysval);
+        SEXP_free(name_entity);
 
         return (0);
 }
@@ -56,8 +56,17 @@
 
 #include "seap.h"
 #include "probe-api.h"
+#include "probe/probe.h"
+#include "probe/option.h"
 #include "alloc.h"
 
+void *probe_init(void)
+{
+	/* the result changes only after a reboot */
+	probe_setoption(PROBEOPT_RESULT_CACHING, true);
+	return NULL;
+}
+
 int probe_main(probe_ctx *ctx, void *arg)
 {
 	struct utsname buf;
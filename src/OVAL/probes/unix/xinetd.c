@@ -54,6 +54,7 @@
 #include <bfind.h>
 #include <common/debug_priv.h>
 #include <netdb.h>
+#include <pthread.h>
 #include "../SEAP/generic/rbt/rbt.h"
 
 #define PATH_SEPARATOR '/'
@@ -185,9 +186,17 @@ typedef struct {
 #define XICONF_FILE_PERSIST 0x00000002 /**< keep the file open/mmaped */
 #define XICONF_FILE_DEAD    0x00000004 /**< this item can be skipped/deleted/reused for a different file */
 
+typedef struct {
+	char   *path;  /**< path to the include directory */
+	time_t  mtime; /**< modification time of the directory */
+} xiconf_dir_t;
+
 typedef struct {
 	xiconf_file_t   **cfile; /**< */
 	size_t            count; /**< */
+	xiconf_dir_t     *cdir;  /**< include directories; a new or removed file changes their mtime */
+	size_t            dcount; /**< number of include directories */
+	unsigned int      max_depth; /**< include depth limit the configuration was parsed with */
 	rbt_t            *stree; /**< service tree */
 	rbt_t            *ttree; /**< service name & protocol to ID(s) tree */
 	xiconf_service_t *defaults; /**< parsed defaults for services */
@@ -365,6 +374,9 @@ static xiconf_t *xiconf_new(void)
 	xiconf = oscap_talloc(xiconf_t);
 	xiconf->cfile = oscap_alloc(sizeof(xiconf_file_t *));
 	xiconf->count = 0;
+	xiconf->cdir  = NULL;
+	xiconf->dcount = 0;
+	xiconf->max_depth = 0;
 	xiconf->stree = rbt_str_new();
 	xiconf->ttree = rbt_str_new();
 	xiconf->defaults = NULL;
@@ -462,6 +474,11 @@ void xiconf_free(xiconf_t *xiconf)
 
 	oscap_free(xiconf->cfile);
 
+	for (i = 0; i < xiconf->dcount; ++i)
+		oscap_free(xiconf->cdir[i].path);
+
+	oscap_free(xiconf->cdir);
+
         rbt_str_free_cb(xiconf->stree, xiconf_stree_free_cb);
         rbt_str_free_cb(xiconf->ttree, xiconf_ttree_free_cb);
 
@@ -575,6 +592,18 @@ static int xiconf_add_cfile(xiconf_t *xiconf, const char *path, int depth)
 	return (0);
 }
 
+static void xiconf_add_cdir(xiconf_t *xiconf, const char *path, DIR *dirfp)
+{
+	struct stat st;
+
+	if (fstat (dirfd (dirfp), &st) != 0)
+		st.st_mtime = 0;
+
+	xiconf->cdir = oscap_realloc(xiconf->cdir, sizeof(xiconf_dir_t) * ++xiconf->dcount);
+	xiconf->cdir[xiconf->dcount - 1].path  = strdup(path);
+	xiconf->cdir[xiconf->dcount - 1].mtime = st.st_mtime;
+}
+
 #define tmpbuf_def(size) char __tmpbuf[size]
 #define tmpbuf_get(size) (((sizeof __tmpbuf)/sizeof(char))<(size)?oscap_alloc(sizeof(char)*(size)):__tmpbuf)
 #define tmpbuf_free(ptr) do { if ((ptr) != __tmpbuf) oscap_free(ptr); (ptr) = NULL; } while(0)
@@ -595,6 +624,7 @@ xiconf_t *xiconf_parse(const char *path, unsigned int max_depth)
 	if (xiconf == NULL)
 		return (NULL);
 
+	xiconf->max_depth = max_depth;
 	xifile = xiconf_read(path, 0);
 
 	if (xifile == NULL) {
@@ -754,6 +784,8 @@ xiconf_t *xiconf_parse(const char *path, unsigned int max_depth)
 						break;
 					}
 
+					xiconf_add_cdir (xiconf, inclarg, dirfp);
+
 					strcpy (pathbuf, inclarg);
 					incllen = strlen(inclarg);
 
@@ -811,9 +843,55 @@ xiconf_t *xiconf_parse(const char *path, unsigned int max_depth)
 	return (xiconf);
 }
 
+/*
+ * Check whether any file or include directory read by the parser changed
+ */
+static bool xiconf_changed(xiconf_t *xiconf)
+{
+	struct stat st;
+	size_t i;
+
+	for (i = 0; i < xiconf->count; ++i) {
+		if (stat(xiconf->cfile[i]->cpath, &st) != 0 ||
+		    st.st_mtime != xiconf->cfile[i]->mtime ||
+		    (size_t)st.st_size != xiconf->cfile[i]->inlen)
+			return (true);
+	}
+
+	for (i = 0; i < xiconf->dcount; ++i) {
+		if (stat(xiconf->cdir[i].path, &st) != 0 ||
+		    st.st_mtime != xiconf->cdir[i].mtime)
+			return (true);
+	}
+
+	return (false);
+}
+
+/*
+ * Re-parse the configuration if it changed since it was parsed. The new
+ * parse tree replaces the contents of xiconf, so pointers to xiconf stay
+ * valid but pointers to services don't.
+ */
 int xiconf_update(xiconf_t *xiconf)
 {
-	dI("Not implemented yet.");
+	xiconf_t *xnew, xold;
+
+	if (!xiconf_changed(xiconf))
+		return (0);
+
+	dI("Configuration changed, parsing again: %s", xiconf->cfile[0]->cpath);
+
+	xnew = xiconf_parse(xiconf->cfile[0]->cpath, xiconf->max_depth);
+
+	if (xnew == NULL)
+		return (-1);
+
+	xold    = *xiconf;
+	*xiconf = *xnew;
+	*xnew   = xold;
+
+	xiconf_free(xnew);
+
 	return (0);
 }
 
@@ -1588,6 +1666,30 @@ static void xiservice_process_query(probe_ctx *ctx, SEXP_t *service_name, SEXP_t
 	SEXP_free(xres_protocol);
 }
 
+/*
+ * The parsed configuration is shared by the probe threads; the write lock
+ * is held while it's checked and parsed again.
+ */
+static pthread_rwlock_t g_xiconf_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+static bool xiservice_ent_equals(SEXP_t *ent)
+{
+	SEXP_t *val;
+	oval_operation_t op = OVAL_OPERATION_EQUALS;
+
+	if (probe_ent_attrexists(ent, "var_ref"))
+		return (false);
+
+	val = probe_ent_getattrval(ent, "operation");
+
+	if (val != NULL) {
+		op = (oval_operation_t) SEXP_number_geti_32(val);
+		SEXP_free(val);
+	}
+
+	return (op == OVAL_OPERATION_EQUALS);
+}
+
 void *probe_init(void)
 {
 	probe_setoption(PROBEOPT_OFFLINE_MODE_SUPPORTED, PROBE_OFFLINE_CHROOT);
@@ -1658,27 +1760,47 @@ int probe_main(probe_ctx *ctx, void *arg)
 
 	dI("Updating xinetd configuration cache");
 
-	if (xiconf_update(arg) != 0) {
+	pthread_rwlock_wrlock(&g_xiconf_lock);
+	err = xiconf_update(xcfg);
+	pthread_rwlock_unlock(&g_xiconf_lock);
+
+	if (err != 0) {
+		SEXP_vfree(service_name, protocol, NULL);
 		err = PROBE_EUNKNOWN;
 		goto fail;
 	}
 
-	xres = xiconf_dump(xcfg);
+	pthread_rwlock_rdlock(&g_xiconf_lock);
 
-	if (xres != NULL) {
-		register unsigned int l;
+	if (xiservice_ent_equals(service_name) && xiservice_ent_equals(protocol)) {
+		/* look up the (name, protocol) pair instead of checking every service */
+		xres = xiconf_getservice(xcfg, srv_name, srv_prot);
 
-		for (l = 0; l < xres->cnt; ++l) {
-			xsrv = xres->srv[l];
-			while (xsrv != NULL) {
-				xiservice_process_query(ctx, service_name, protocol, xsrv);
-				xsrv = xsrv->next;
-			}
+		if (xres != NULL) {
+			register unsigned int l;
+
+			for (l = 0; l < xres->cnt; ++l)
+				xiservice_process_query(ctx, service_name, protocol, xres->srv[l]);
 		}
-		oscap_free(xres->srv);
-		oscap_free(xres);
+	} else {
+		xres = xiconf_dump(xcfg);
+
+		if (xres != NULL) {
+			register unsigned int l;
 
+			for (l = 0; l < xres->cnt; ++l) {
+				xsrv = xres->srv[l];
+				while (xsrv != NULL) {
+					xiservice_process_query(ctx, service_name, protocol, xsrv);
+					xsrv = xsrv->next;
+				}
+			}
+			oscap_free(xres->srv);
+			oscap_free(xres);
+		}
 	}
+
+	pthread_rwlock_unlock(&g_xiconf_lock);
 	SEXP_vfree(service_name, protocol, NULL);
 
 	return (0);
@@ -72,6 +72,56 @@ struct oval_definition_model* oval_agent_get_definition_model(oval_agent_session
  */
 void oval_agent_set_product_name(oval_agent_session_t *, char *);
 
+/**
+ * Set the number of object queries which may be evaluated by the probes
+ * at the same time. If it is not zero, oval_agent_eval_system sends the
+ * objects which don't depend on any other objects or variables to all the
+ * probes before the first definition is evaluated, with at most the given
+ * number of queries in flight. The remaining objects are queried when
+ * their definition is evaluated. Definitions evaluated one by one with
+ * oval_agent_eval_definition only get their own objects scheduled this way.
+ * The default value is zero, which pipelines the queries of each definition
+ * separately, without a limit on the number of queries in flight.
+ */
+void oval_agent_set_jobs(oval_agent_session_t *ag_sess, unsigned int jobs);
+
+/**
+ * Send the states of the tests to the probes together with their objects,
+ * so that the probes keep only the items which decide the result of the test.
+ * It's done for the objects used by a single test with a single state, if the
+ * check and check_existence of the test give the same result on the filtered
+ * items. The system characteristics then contain only these items. It has to
+ * be enabled before the first evaluation and can't be disabled afterwards.
+ */
+void oval_agent_set_state_pushdown(oval_agent_session_t *ag_sess, bool pushdown);
+
+/**
+ * Evaluate the criteria of the definitions only until their result is known.
+ * The objects of a test are collected when the test is evaluated, the
+ * subnodes of a criteria are evaluated in the order of the estimated cost
+ * of their collection, and the evaluation stops once the operator of the
+ * criteria is decided, e.g. by the first false node of an AND. The skipped
+ * tests are reported as not evaluated, so it should be used only if the
+ * results are not exported or the directives report them with thin content.
+ * The objects aren't sent to the probes beforehand (see oval_agent_set_jobs)
+ * in this mode.
+ */
+void oval_agent_set_short_circuit(oval_agent_session_t *ag_sess, bool short_circuit);
+
+/**
+ * Free the items of an object as soon as all the tests which refer to it
+ * are evaluated, unless a set object or a variable reads them too, so that
+ * the memory used by the system characteristics stays close to what the
+ * tests being evaluated need. The results of the tests are kept, but the
+ * system characteristics can't be exported anymore, so it should be used
+ * only if the results are not exported or the directives report them with
+ * thin content. An object whose tests are evaluated again, e.g. for another
+ * variable instance, is collected again. It's ignored if OSCAP_INCREMENTAL
+ * is set, because the system characteristics are kept for the next
+ * evaluation then.
+ */
+void oval_agent_set_release_items(oval_agent_session_t *ag_sess, bool release);
+
 /**
  * Probe the system and evaluate specified definition
  * @return 0 on success; -1 error; 1 warning
@@ -95,6 +145,15 @@ struct oval_result_definition * oval_agent_get_result_definition(oval_agent_sess
  */
 int oval_agent_reset_session(oval_agent_session_t * ag_sess);
 
+/**
+ * Drop the system characteristics and the results of all the evaluations
+ * done in this agent session, so that the next evaluation collects the
+ * objects again. Unlike a new session, the definitions are not optimized
+ * and the sysinfo is not queried again, and the probes keep running.
+ * @return 0 on success, -1 if the probes couldn't be reset
+ */
+int oval_agent_clear_session(oval_agent_session_t *ag_sess);
+
 /**
  * Abort a running probe session
  */
@@ -112,6 +171,11 @@ int oval_agent_eval_system(oval_agent_session_t * ag_sess, agent_reporter cb, vo
  * Get a result model from agent session
  */
 struct oval_results_model * oval_agent_get_results_model(oval_agent_session_t * ag_sess);
+/**
+ * Get the probe session which collects the objects of the agent session,
+ * e.g. to read its statistics (see oval_probe_session_print_stats)
+ */
+oval_probe_session_t *oval_agent_get_probe_session(oval_agent_session_t *ag_sess);
 /**
  * Get a filename under which was created
  */
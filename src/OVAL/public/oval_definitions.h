@@ -623,6 +623,22 @@ struct oval_definition_model *oval_definition_model_new(void);
  */
 struct oval_definition_model *oval_definition_model_import_source(struct oscap_source *source);
 
+/**
+ * Import the content of the oscap_source into an oval_definition_model
+ * lazily. Only the IDs of the definitions, tests, objects, states and
+ * variables are read at first. An element is parsed, with everything it
+ * refers to, when its ID is looked up in the model for the first time, e.g.
+ * when oval_agent_eval_definition evaluates the definition. The iterators
+ * of the model only cover the elements parsed so far, so a model exported
+ * after evaluating a few definitions contains just those definitions.
+ * Evaluating all the definitions of the model parses the whole document.
+ * The source must not be freed before the model.
+ * @memberof oval_definition_model
+ * @param source The oscap_source to import from
+ * @returns newly build oval_definition_model, or NULL if something went wrong
+ */
+struct oval_definition_model *oval_definition_model_import_source_lazy(struct oscap_source *source);
+
 /**
  * Import the content from the file into an oval_definition_model.
  * @param file filename
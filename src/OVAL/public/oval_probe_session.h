@@ -32,9 +32,22 @@
 
 typedef struct oval_probe_session oval_probe_session_t;
 
+#include <stdio.h>
 #include "oval_probe_handler.h"
 #include "oval_system_characteristics.h"
 
+/**
+ * Statistics of the objects collected by the probes
+ */
+struct oval_probe_stats {
+	unsigned long objects;    /**< objects collected by the probes */
+	unsigned long cache_hits; /**< queries answered by the system characteristics collected before */
+	unsigned long shared;     /**< objects not collected, an object with the same content was */
+	unsigned long items;      /**< items collected */
+	unsigned long long bytes; /**< size of the replies of the probes (as S-expressions) */
+	double time;              /**< wall time of the collection in seconds */
+};
+
 /**
  * Create and initialize a new probe session
  * @param model system characteristics model
@@ -90,5 +103,36 @@ int oval_probe_session_sethandler(oval_probe_session_t *sess, oval_subtype_t typ
  */
 struct oval_syschar_model *oval_probe_session_getmodel(oval_probe_session_t *sess);
 
+/**
+ * Get the statistics of the objects of a type collected during the session.
+ * The objects sent to the probes in advance (see oval_agent_set_jobs) are
+ * timed from their sending to the conversion of the reply, so the time
+ * includes the waiting for the other objects in flight.
+ * @param sess pointer to the probe session structure
+ * @param type object type
+ * @param stats the statistics are copied here
+ * @return 0 on success, -1 if no object of the type was queried
+ */
+int oval_probe_session_get_type_stats(oval_probe_session_t *sess, oval_subtype_t type, struct oval_probe_stats *stats);
+
+/**
+ * Get the statistics of an object collected during the session.
+ * @param sess pointer to the probe session structure
+ * @param object_id id of the object
+ * @param stats the statistics are copied here
+ * @return 0 on success, -1 if the object wasn't queried
+ */
+int oval_probe_session_get_object_stats(oval_probe_session_t *sess, const char *object_id, struct oval_probe_stats *stats);
+
+/**
+ * Print the statistics of the probe types and of the most expensive objects.
+ * If the OSCAP_PROBE_STATS environment variable names a file, the totals of
+ * the probe types are added to it when the session is destroyed and they are
+ * used to estimate the cost of the objects by the next sessions.
+ * @param sess pointer to the probe session structure
+ * @param out the output stream
+ */
+void oval_probe_session_print_stats(oval_probe_session_t *sess, FILE *out);
+
 #endif /* OVAL_PROBE_SESSION */
 /// @}
@@ -156,6 +156,21 @@ void oval_results_model_set_export_system_characteristics(struct oval_results_mo
  * @memberof oval_results_model
  */
 bool oval_results_model_get_export_system_characteristics(struct oval_results_model *);
+/**
+ * Set the number of threads which evaluate the tests of the results model.
+ * If it is greater than one and the model isn't bound to a probe session
+ * (i.e. the system characteristics were imported), oval_results_model_eval
+ * evaluates the tests of the definitions in parallel before it combines
+ * their results. Tests which depend on variables that can't be computed
+ * beforehand are left to the serial evaluation. The default value is zero,
+ * which evaluates everything in the calling thread.
+ * @memberof oval_results_model
+ */
+void oval_results_model_set_jobs(struct oval_results_model *model, unsigned int jobs);
+/**
+ * @memberof oval_results_model
+ */
+unsigned int oval_results_model_get_jobs(struct oval_results_model *model);
 /**
  * Free memory allocated to a specified oval results model.
  * @param the specified oval_results model
@@ -171,6 +186,20 @@ void oval_results_model_free(struct oval_results_model *model);
  */
 int oval_results_model_export(struct oval_results_model *, struct oval_directives_model *, const char *file);
 
+/**
+ * Export the delta of the OVAL results against the results of a previous
+ * evaluation, see oscap_source_new_delta(). The delta carries the whole
+ * results if the baseline file doesn't exist.
+ * @param results_model The OVAL Results Model to export
+ * @param directives_model The Directives Model to amend the export
+ * @param baseline_file Path to the previous OVAL results
+ * @param file Path to the delta
+ * @returns 0 on success, -1 on error
+ * @memberof oval_results_model
+ */
+int oval_results_model_export_delta(struct oval_results_model *results_model, struct oval_directives_model *directives_model,
+				    const char *baseline_file, const char *file);
+
 /**
  * Export OVAL results into oscap_source
  * @param results_model The OVAL Results Model to export
@@ -270,6 +299,24 @@ struct oval_result_definition *oval_result_system_get_definition(struct oval_res
  * @memberof oval_result_system
  */
 struct oval_result_definition_iterator *oval_result_system_get_definitions(struct oval_result_system *);
+
+/**
+ * Summary of a definition result, see oval_result_system_get_definition_records().
+ * The id is owned by the definition.
+ */
+struct oval_result_definition_record {
+	const char *id;
+	oval_result_t result;
+};
+
+/**
+ * Get the summaries of all the definition results of the system in one
+ * call, for the language bindings.
+ * @param records Set to an array of the summaries, to be freed with free()
+ * @returns the number of the summaries, records is NULL if there are none
+ * @memberof oval_result_system
+ */
+size_t oval_result_system_get_definition_records(struct oval_result_system *, struct oval_result_definition_record **records);
 /**
  * @memberof oval_result_system
  */
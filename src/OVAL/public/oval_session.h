@@ -36,6 +36,7 @@
 
 #ifndef OVAL_SESSION_H_
 #define OVAL_SESSION_H_
+#include <stdio.h>
 #include "oscap_download_cb.h"
 
 /**
@@ -140,6 +141,19 @@ void oval_session_set_results_export(struct oval_session *session, const char *f
  */
 void oval_session_set_report_export(struct oval_session *session, const char *filename);
 
+/**
+ * Set the name of the file that the delta of the OVAL Results against the
+ * OVAL Results of a previous evaluation (the baseline) will be written into,
+ * see \ref oscap_source_new_delta. The delta carries the whole results if the
+ * baseline file doesn't exist.
+ *
+ * @memberof oval_session
+ * @param session an \ref oval_session
+ * @param baseline a path to the previous OVAL Results
+ * @param filename a path to a new file
+ */
+void oval_session_set_results_delta_export(struct oval_session *session, const char *baseline, const char *filename);
+
 /**
  * Set XML validation reporter.
  *
@@ -203,6 +217,34 @@ int oval_session_evaluate_id(struct oval_session *session, char *probe_root, con
  */
 int oval_session_evaluate(struct oval_session *session, char *probe_root, agent_reporter fn, void *arg);
 
+/**
+ * Evaluate the loaded OVAL Definitions on several systems, e.g. the mounted
+ * images of containers. The definitions are parsed once, by \ref
+ * oval_session_load. Every target is evaluated in a child process, with its
+ * own system characteristics and results, and its own probes with the root
+ * directory of the target; up to jobs targets are evaluated at the same
+ * time. The results of a target are exported to its results file, the HTML
+ * report and the delta are not exported.
+ *
+ * Nothing may have been evaluated in the session and in the process before,
+ * so that no probe is running; a session which was evaluated is refused.
+ *
+ * @memberof oval_session
+ * @param session an \ref oval_session
+ * @param roots the root directories of the targets
+ * @param results the results file of each target, or NULL
+ * @param count the number of the targets
+ * @param jobs the number of the targets evaluated at the same time
+ * @param statuses set to 0 for every target which was evaluated and its
+ * results exported, 1 otherwise; the errors of the targets are reported by
+ * oscap_seterr()
+ *
+ * @retval 0 if all the targets were evaluated
+ * @retval 1 otherwise
+ */
+int oval_session_evaluate_roots(struct oval_session *session, const char **roots, const char **results,
+		size_t count, unsigned int jobs, int *statuses);
+
 /**
  * Export result to a file. Results can be represented as OVAL System
  * Characteristics if analyse has been done or OVAL Results if evaluation or
@@ -212,6 +254,7 @@ int oval_session_evaluate(struct oval_session *session, char *probe_root, agent_
  * Alse see:
  * \ref oval_session_set_results_export
  * \ref oval_session_set_report_export
+ * \ref oval_session_set_results_delta_export
  *
  * @memberof oval_session
  * @param session an \ref oval_session
@@ -242,6 +285,46 @@ void oval_session_set_export_system_characteristics(struct oval_session *session
  */
 void oval_session_set_remote_resources(struct oval_session *session, bool allowed, download_progress_calllback_t callback);
 
+/**
+ * Set the number of object queries evaluated by the probes at the same time.
+ * @memberof oval_session
+ * @param session an \ref oval_session
+ * @param jobs the number of queries in flight, 0 (default) evaluates the
+ * objects of each definition in a separate batch
+ */
+void oval_session_set_jobs(struct oval_session *session, unsigned int jobs);
+
+/**
+ * Let the probes filter the collected items by the states of the tests.
+ * @memberof oval_session
+ * @param session an \ref oval_session
+ * @param pushdown true to send the states to the probes, false (default)
+ * to collect all the items of the objects
+ */
+void oval_session_set_state_pushdown(struct oval_session *session, bool pushdown);
+
+/**
+ * Stop the evaluation of criteria once their result is known, without
+ * collecting the objects of the remaining tests. It's used only if the
+ * results and the report aren't exported or the OVAL Directives report no
+ * result type with the full content; the directives and the exports have
+ * to be set before the evaluation then.
+ * @memberof oval_session
+ * @param session an \ref oval_session
+ * @param short_circuit true to skip the tests not needed for the results
+ */
+void oval_session_set_short_circuit(struct oval_session *session, bool short_circuit);
+
+/**
+ * Print the statistics of the probes collected during the evaluation,
+ * see oval_probe_session_print_stats.
+ * @memberof oval_session
+ * @param session an \ref oval_session
+ * @param out the output stream
+ * @return 0 on success, 1 if nothing was evaluated
+ */
+int oval_session_print_probe_stats(struct oval_session *session, FILE *out);
+
 /**
  * Destructor of an \ref oval_session.
  * @memberof oval_session
@@ -206,6 +206,21 @@ struct oval_syschar_model *oval_syschar_model_new(struct oval_definition_model *
  */
 int oval_syschar_model_import_source(struct oval_syschar_model *model, struct oscap_source *source);
 
+/**
+ * Import the content from the oscap_source into an oval_syschar_model
+ * lazily. The collected objects are imported at once, but the items are
+ * only located in the file. An item is parsed when it is used for the
+ * first time, e.g. when a test evaluates it, so the memory taken by the
+ * model follows the items actually needed rather than the size of the
+ * file. Sources which don't come from a plain UTF-8 XML file are imported
+ * at once. The file must not be changed before the model is freed.
+ * @param model the merge target model
+ * @param source The oscap_source to import data from.
+ * @return zero on success or non zero value if an error occurred
+ * @memberof oval_syschar_model
+ */
+int oval_syschar_model_import_source_lazy(struct oval_syschar_model *model, struct oscap_source *source);
+
 /**
  * Import the content from the file into an oval_syschar_model.
  * If imported content specifies a model entity that is already registered within the model its content is overwritten.
@@ -229,6 +244,31 @@ struct oval_syschar_model *oval_syschar_model_clone(struct oval_syschar_model *)
  * @memberof oval_syschar_model
  */
 int oval_syschar_model_export(struct oval_syschar_model *, const char *file);
+/**
+ * Export system characteristics into file in the binary format of OpenSCAP.
+ * The file holds the same data as the XML export, the names and the values
+ * repeated by the items are written once and the file is read by mapping
+ * it, which makes it a fit for collecting on a system and evaluating the
+ * results elsewhere. The binary file is imported by oval_syschar_model_import_source
+ * and it can be converted back to XML by importing and exporting it.
+ * @return zero on success or -1 if an error occurred
+ * @memberof oval_syschar_model
+ */
+int oval_syschar_model_export_binary(struct oval_syschar_model *, const char *file);
+/**
+ * Import the system characteristics from a file written by
+ * oval_syschar_model_export_binary.
+ * @param model the merge target model
+ * @param file filename
+ * @return zero on success or -1 if an error occurred
+ * @memberof oval_syschar_model
+ */
+int oval_syschar_model_import_binary(struct oval_syschar_model *model, const char *file);
+/**
+ * Tell whether the file is in the binary format of oval_syschar_model_export_binary.
+ * @memberof oval_syschar_model
+ */
+bool oval_syschar_model_is_binary(const char *file);
 /**
  * Free memory allocated to a specified syschar model.
  * @param model the specified syschar model
@@ -36,6 +36,7 @@
 #include "oval_system_characteristics.h"
 #include "common/_error.h"
 #include "common/debug_priv.h"
+#include "OVAL/oval_system_characteristics_impl.h"
 
 #include "oval_cmp_basic_impl.h"
 #include "oval_cmp_evr_string_impl.h"
@@ -161,3 +162,187 @@ oval_result_t oval_ent_cmp_str(char *state_data, oval_datatype_t state_data_type
 	const char *sys_data = oval_sysent_get_value(sysent);
 	return oval_str_cmp_str(state_data, state_data_type, sys_data, operation);
 }
+
+struct oval_cmp_value {
+	char *text;
+	oval_datatype_t datatype;
+	oval_operation_t operation;
+	bool parsed;				///< whether the value below is valid
+	union {
+		intmax_t integer;
+		double real;
+		bool boolean;
+		struct oval_evr evr;
+		struct {
+			int *fields;
+			int count;
+		} version;
+		struct oval_ipaddr ipaddr;
+		struct oval_regex *regex;
+	} value;
+};
+
+struct oval_cmp_value *oval_cmp_value_new(const char *state_data, oval_datatype_t state_data_type, oval_operation_t operation)
+{
+	struct oval_cmp_value *cmp = oscap_calloc(1, sizeof(struct oval_cmp_value));
+
+	cmp->text = oscap_strdup(state_data);
+	cmp->datatype = state_data_type;
+	cmp->operation = operation;
+
+	/* Whatever can't be prepared is compared by oval_str_cmp_str, which
+	 * reports the errors of the conversion for every item. */
+	switch (state_data_type) {
+	case OVAL_DATATYPE_STRING:
+		if (operation == OVAL_OPERATION_PATTERN_MATCH) {
+			cmp->value.regex = oval_regex_new(state_data);
+			cmp->parsed = cmp->value.regex != NULL;
+		} else {
+			/* the equalities are compared right away, the text is the value */
+			cmp->parsed = operation == OVAL_OPERATION_EQUALS
+				|| operation == OVAL_OPERATION_NOT_EQUAL
+				|| operation == OVAL_OPERATION_CASE_INSENSITIVE_EQUALS
+				|| operation == OVAL_OPERATION_CASE_INSENSITIVE_NOT_EQUAL;
+		}
+		break;
+	case OVAL_DATATYPE_INTEGER:
+		cmp->parsed = cstr_to_intmax(state_data, &cmp->value.integer);
+		break;
+	case OVAL_DATATYPE_FLOAT:
+		cmp->parsed = cstr_to_double(state_data, &cmp->value.real);
+		break;
+	case OVAL_DATATYPE_BOOLEAN:
+		cmp->value.boolean = strcmp(state_data, "true") == 0 || strcmp(state_data, "1") == 0;
+		cmp->parsed = true;
+		break;
+	case OVAL_DATATYPE_EVR_STRING:
+	case OVAL_DATATYPE_DEBIAN_EVR_STRING:
+		/* the parts point into the copy of the value */
+		oval_evr_parse(cmp->text, &cmp->value.evr);
+		cmp->parsed = true;
+		break;
+	case OVAL_DATATYPE_VERSION:
+		cmp->value.version.fields = oval_versiontype_parse(state_data, &cmp->value.version.count);
+		cmp->parsed = true;
+		break;
+	case OVAL_DATATYPE_IPV4ADDR:
+	case OVAL_DATATYPE_IPV6ADDR:
+		cmp->value.ipaddr.af = state_data_type == OVAL_DATATYPE_IPV4ADDR ? AF_INET : AF_INET6;
+		cmp->parsed = oval_ipaddr_parse(cmp->value.ipaddr.af, state_data,
+				&cmp->value.ipaddr.mask, &cmp->value.ipaddr.addr) == 0;
+		break;
+	default:
+		break;
+	}
+	return cmp;
+}
+
+void oval_cmp_value_free(struct oval_cmp_value *cmp)
+{
+	if (cmp == NULL)
+		return;
+
+	if (cmp->parsed) {
+		switch (cmp->datatype) {
+		case OVAL_DATATYPE_STRING:
+			if (cmp->operation == OVAL_OPERATION_PATTERN_MATCH)
+				oval_regex_free(cmp->value.regex);
+			break;
+		case OVAL_DATATYPE_VERSION:
+			oscap_free(cmp->value.version.fields);
+			break;
+		default:
+			break;
+		}
+	}
+	oscap_free(cmp->text);
+	oscap_free(cmp);
+}
+
+const char *oval_cmp_value_get_text(const struct oval_cmp_value *cmp)
+{
+	return cmp->text;
+}
+
+oval_result_t oval_cmp_value_cmp(struct oval_cmp_value *cmp, const char *sys_data)
+{
+	if (!cmp->parsed)
+		return oval_str_cmp_str(cmp->text, cmp->datatype, sys_data, cmp->operation);
+
+	switch (cmp->datatype) {
+	case OVAL_DATATYPE_STRING:
+		if (sys_data == NULL)
+			sys_data = "";
+		switch (cmp->operation) {
+		case OVAL_OPERATION_EQUALS:
+			return strcmp(cmp->text, sys_data) ? OVAL_RESULT_FALSE : OVAL_RESULT_TRUE;
+		case OVAL_OPERATION_NOT_EQUAL:
+			return strcmp(cmp->text, sys_data) ? OVAL_RESULT_TRUE : OVAL_RESULT_FALSE;
+		case OVAL_OPERATION_CASE_INSENSITIVE_EQUALS:
+			return strcasecmp(cmp->text, sys_data) ? OVAL_RESULT_FALSE : OVAL_RESULT_TRUE;
+		case OVAL_OPERATION_CASE_INSENSITIVE_NOT_EQUAL:
+			return strcasecmp(cmp->text, sys_data) ? OVAL_RESULT_TRUE : OVAL_RESULT_FALSE;
+		default:
+			return oval_regex_match(cmp->value.regex, sys_data);
+		}
+	case OVAL_DATATYPE_INTEGER: {
+		intmax_t syschar_val;
+
+		if (!cstr_to_intmax(sys_data, &syschar_val)) {
+			oscap_seterr(OSCAP_EFAMILY_OVAL,
+				"Conversion of the string \"%s\" to an integer (%u bits) failed: %s",
+				sys_data, sizeof(intmax_t)*8, strerror(errno));
+			return OVAL_RESULT_ERROR;
+		}
+		return oval_int_cmp(cmp->value.integer, syschar_val, cmp->operation);
+	}
+	case OVAL_DATATYPE_FLOAT: {
+		double sys_val;
+
+		if (!cstr_to_double(sys_data, &sys_val)) {
+			oscap_seterr(OSCAP_EFAMILY_OVAL,
+				"Conversion of the string \"%s\" to a floating type (double) failed: %s",
+				sys_data, strerror(errno));
+			return OVAL_RESULT_ERROR;
+		}
+		return oval_float_cmp(cmp->value.real, sys_val, cmp->operation);
+	}
+	case OVAL_DATATYPE_BOOLEAN: {
+		int sys_int = (((strcmp(sys_data, "true")) == 0) || ((strcmp(sys_data, "1")) == 0)) ? 1 : 0;
+		return oval_boolean_cmp(cmp->value.boolean, sys_int, cmp->operation);
+	}
+	case OVAL_DATATYPE_EVR_STRING:
+	case OVAL_DATATYPE_DEBIAN_EVR_STRING: {
+		struct oval_evr sys_evr;
+
+		oval_evr_parse(sys_data ? sys_data : "", &sys_evr);
+		return oval_evr_string_cmp_parsed(&cmp->value.evr, &sys_evr, cmp->operation);
+	}
+	case OVAL_DATATYPE_VERSION:
+		return oval_versiontype_cmp_parsed(cmp->value.version.fields, cmp->value.version.count,
+				sys_data, cmp->operation);
+	case OVAL_DATATYPE_IPV4ADDR:
+	case OVAL_DATATYPE_IPV6ADDR:
+		return oval_ipaddr_cmp_parsed(cmp->value.ipaddr.af, &cmp->value.ipaddr.addr,
+				cmp->value.ipaddr.mask, sys_data, cmp->operation);
+	default:
+		return oval_str_cmp_str(cmp->text, cmp->datatype, sys_data, cmp->operation);
+	}
+}
+
+oval_result_t oval_cmp_value_cmp_ent(struct oval_cmp_value *cmp, struct oval_sysent *sysent)
+{
+	if (cmp->parsed && (cmp->datatype == OVAL_DATATYPE_EVR_STRING
+			    || cmp->datatype == OVAL_DATATYPE_DEBIAN_EVR_STRING)) {
+		const struct oval_evr *sys_evr = oval_sysent_get_evr(sysent);
+		if (sys_evr != NULL)
+			return oval_evr_string_cmp_parsed(&cmp->value.evr, sys_evr, cmp->operation);
+	}
+	if (cmp->parsed && (cmp->datatype == OVAL_DATATYPE_IPV4ADDR
+			    || cmp->datatype == OVAL_DATATYPE_IPV6ADDR)) {
+		const struct oval_ipaddr *sys_addr = oval_sysent_get_ipaddr(sysent);
+		if (sys_addr != NULL && sys_addr->af == cmp->value.ipaddr.af)
+			return oval_ipaddr_cmp_addr(&cmp->value.ipaddr, sys_addr, cmp->operation);
+	}
+	return oval_cmp_value_cmp(cmp, oval_sysent_get_value(sysent));
+}
@@ -28,7 +28,7 @@
 #include <math.h>
 #include <string.h>
 #if defined USE_REGEX_PCRE
-#include <pcre.h>
+#include "common/oscap_pcre.h"
 #elif defined USE_REGEX_POSIX
 #include <regex.h>
 #endif
@@ -124,23 +124,58 @@ static int istrcmp(const char *st1, const char *st2)
 	return strcasecmp(st1, st2);
 }
 
-static oval_result_t strregcomp(const char *pattern, const char *test_str)
+struct oval_regex {
+#if defined USE_REGEX_PCRE
+	oscap_pcre_t *re;
+#elif defined USE_REGEX_POSIX
+	regex_t re;
+#endif
+};
+
+struct oval_regex *oval_regex_new(const char *pattern)
 {
-	int ret;
-	oval_result_t result = OVAL_RESULT_ERROR;
+	struct oval_regex *regex = oscap_alloc(sizeof(struct oval_regex));
 #if defined USE_REGEX_PCRE
-	pcre *re;
 	const char *err;
 	int errofs;
 
-	re = pcre_compile(pattern, PCRE_UTF8, &err, &errofs, NULL);
-	if (re == NULL) {
+	regex->re = oscap_pcre_get(pattern, PCRE_UTF8, &err, &errofs);
+	if (regex->re == NULL) {
 		dE("Unable to compile regex pattern, "
 			       "pcre_compile() returned error (offset: %d): '%s'.\n", errofs, err);
-		return OVAL_RESULT_ERROR;
+		oscap_free(regex);
+		return NULL;
+	}
+#elif defined USE_REGEX_POSIX
+	int ret = regcomp(&regex->re, pattern, REG_EXTENDED);
+	if (ret != 0) {
+		dE("Unable to compile regex pattern, "
+			       "regcomp() returned error: %d.\n", ret);
+		oscap_free(regex);
+		return NULL;
 	}
+#endif
+	return regex;
+}
+
+void oval_regex_free(struct oval_regex *regex)
+{
+	if (regex == NULL)
+		return;
+#if defined USE_REGEX_PCRE
+	oscap_pcre_put(regex->re);
+#elif defined USE_REGEX_POSIX
+	regfree(&regex->re);
+#endif
+	oscap_free(regex);
+}
 
-	ret = pcre_exec(re, NULL, test_str, strlen(test_str), 0, 0, NULL, 0);
+oval_result_t oval_regex_match(struct oval_regex *regex, const char *test_str)
+{
+	int ret;
+	oval_result_t result = OVAL_RESULT_ERROR;
+#if defined USE_REGEX_PCRE
+	ret = oscap_pcre_exec(regex->re, test_str, strlen(test_str), 0, 0, NULL, 0);
 	if (ret > -1 ) {
 		result = OVAL_RESULT_TRUE;
 	} else if (ret == -1) {
@@ -150,19 +185,8 @@ static oval_result_t strregcomp(const char *pattern, const char *test_str)
 			       "pcre_exec() returned error: %d.\n", ret);
 		result = OVAL_RESULT_ERROR;
 	}
-
-	pcre_free(re);
 #elif defined USE_REGEX_POSIX
-	regex_t re;
-
-	ret = regcomp(&re, pattern, REG_EXTENDED);
-	if (ret != 0) {
-		dE("Unable to compile regex pattern, "
-			       "regcomp() returned error: %d.\n", ret);
-		return OVAL_RESULT_ERROR;
-	}
-
-	ret = regexec(&re, test_str, 0, NULL, 0);
+	ret = regexec(&regex->re, test_str, 0, NULL, 0);
 	if (ret == 0) {
 		result = OVAL_RESULT_TRUE;
 	} else if (ret == REG_NOMATCH) {
@@ -171,12 +195,23 @@ static oval_result_t strregcomp(const char *pattern, const char *test_str)
 		dE("Unable to match regex pattern: %d.", ret);
 		result = OVAL_RESULT_ERROR;
 	}
-
-	regfree(&re);
 #endif
 	return result;
 }
 
+static oval_result_t strregcomp(const char *pattern, const char *test_str)
+{
+	struct oval_regex *regex;
+	oval_result_t result;
+
+	regex = oval_regex_new(pattern);
+	if (regex == NULL)
+		return OVAL_RESULT_ERROR;
+	result = oval_regex_match(regex, test_str);
+	oval_regex_free(regex);
+	return result;
+}
+
 oval_result_t oval_string_cmp(const char *state, const char *syschar, oval_operation_t operation)
 {
 	syschar = syschar ? syschar : "";
@@ -39,6 +39,23 @@ oval_result_t oval_string_cmp(const char *state, const char *syschar, oval_opera
 
 oval_result_t oval_binary_cmp(const char *state, const char *syschar, oval_operation_t operation);
 
+/**
+ * Compiled regular expression of the pattern match operation
+ */
+struct oval_regex;
+
+/**
+ * Compile the pattern.
+ * @returns the regular expression or NULL if the pattern is invalid
+ */
+struct oval_regex *oval_regex_new(const char *pattern);
+void oval_regex_free(struct oval_regex *regex);
+
+/**
+ * Match string captured from system against the regular expression.
+ */
+oval_result_t oval_regex_match(struct oval_regex *regex, const char *test_str);
+
 OSCAP_HIDDEN_END;
 
 #endif
@@ -38,22 +38,78 @@
 
 #ifdef HAVE_RPMVERCMP
 #include <rpm/rpmlib.h>
-#else
 #if !defined(__FreeBSD__)
 #include <alloca.h>
 #endif
-static int rpmvercmp(const char *a, const char *b);
+#else
+static int rpmvercmp_n(const char *a, size_t alen, const char *b, size_t blen);
 static int risdigit(int c) {
 	// locale independent
 	return (c >= '0' && c <= '9');
 }
 #endif
 
-static inline int rpmevrcmp(const char *a, const char *b);
-static int compare_values(const char *str1, const char *str2);
-static void parseEVR(char *evr, const char **ep, const char **vp, const char **rp);
+static int compare_values(const char *str1, size_t len1, const char *str2, size_t len2);
 
-oval_result_t oval_evr_string_cmp(const char *state, const char *sys, oval_operation_t operation)
+static inline int rpmevrcmp(const struct oval_evr *a, const struct oval_evr *b)
+{
+	/* This mimics rpmevrcmp which is not exported by rpmlib version 4.
+	 * Code inspired by rpm.labelCompare() from rpm4/python/header-py.c
+	 */
+	int result;
+
+	result = compare_values(a->epoch, a->epoch_len, b->epoch, b->epoch_len);
+	if (!result) {
+		result = compare_values(a->version, a->version_len, b->version, b->version_len);
+		if (!result)
+			result = compare_values(a->release, a->release_len, b->release, b->release_len);
+	}
+	return result;
+}
+
+void oval_evr_parse(const char *evr, struct oval_evr *parsed)
+{
+	/*
+	 * Follows parseEVR() from rpm4/lib/rpmds.c, but the parts are
+	 * only pointed to, the string isn't modified.
+	 */
+	const char *s, *se, *end;
+
+	end = evr + strlen(evr);
+	s = evr;
+	while (*s && risdigit(*s)) s++;		/* s points to epoch terminator */
+	se = strrchr(s, '-');			/* se points to version terminator */
+
+	if (*s == ':') {
+		parsed->epoch = evr;
+		parsed->epoch_len = s - evr;
+		if (parsed->epoch_len == 0) {
+			parsed->epoch = "0";
+			parsed->epoch_len = 1;
+		}
+		parsed->version = s + 1;
+	} else {
+		parsed->epoch = NULL;		/* XXX disable epoch compare if missing */
+		parsed->epoch_len = 0;
+		parsed->version = evr;
+	}
+	if (se) {
+		parsed->version_len = se - parsed->version;
+		parsed->release = se + 1;
+		parsed->release_len = end - parsed->release;
+	} else {
+		parsed->version_len = end - parsed->version;
+		parsed->release = NULL;
+		parsed->release_len = 0;
+	}
+}
+
+int oval_evr_cmp(const struct oval_evr *a, const struct oval_evr *b)
+{
+	return rpmevrcmp(a, b);
+}
+
+oval_result_t oval_evr_string_cmp_parsed(const struct oval_evr *state, const struct oval_evr *sys, oval_operation_t operation)
 {
 	int result = rpmevrcmp(sys, state);
 
@@ -75,34 +131,16 @@ oval_result_t oval_evr_string_cmp(const char *state, const char *sys, oval_opera
 	return OVAL_RESULT_ERROR;
 }
 
-static inline int rpmevrcmp(const char *a, const char *b)
+oval_result_t oval_evr_string_cmp(const char *state, const char *sys, oval_operation_t operation)
 {
-	/* This mimics rpmevrcmp which is not exported by rpmlib version 4.
-	 * Code inspired by rpm.labelCompare() from rpm4/python/header-py.c
-	 */
-	const char *a_epoch, *a_version, *a_release;
-	const char *b_epoch, *b_version, *b_release;
-	char *a_copy, *b_copy;
-	int result;
-
-	a_copy = oscap_strdup(a);
-	b_copy = oscap_strdup(b);
-	parseEVR(a_copy, &a_epoch, &a_version, &a_release);
-	parseEVR(b_copy, &b_epoch, &b_version, &b_release);
-
-	result = compare_values(a_epoch, b_epoch);
-	if (!result) {
-		result = compare_values(a_version, b_version);
-		if (!result)
-			result = compare_values(a_release, b_release);
-	}
+	struct oval_evr state_evr, sys_evr;
 
-	oscap_free(a_copy);
-	oscap_free(b_copy);
-	return result;
+	oval_evr_parse(state, &state_evr);
+	oval_evr_parse(sys, &sys_evr);
+	return oval_evr_string_cmp_parsed(&state_evr, &sys_evr, operation);
 }
 
-static int compare_values(const char *str1, const char *str2)
+static int compare_values(const char *str1, size_t len1, const char *str2, size_t len2)
 {
 	/*
 	 * Code copied from rpm4/python/header-py.c
@@ -113,85 +151,55 @@ static int compare_values(const char *str1, const char *str2)
 		return 1;
 	else if (!str1 && str2)
 		return -1;
-	return rpmvercmp(str1, str2);
-}
-
-static void parseEVR(char *evr, const char **ep, const char **vp, const char **rp)
-{
-	/*
-	 * Code copied from rpm4/lib/rpmds.c
-	 */
-	const char *epoch;
-	const char *version;			/* assume only version is present */
-	const char *release;
-	char *s, *se;
-
-	s = evr;
-	while (*s && risdigit(*s)) s++;		/* s points to epoch terminator */
-	se = strrchr(s, '-');			/* se points to version terminator */
-
-	if (*s == ':') {
-		epoch = evr;
-		*s++ = '\0';
-		version = s;
-		if (*epoch == '\0')
-			epoch = "0";
-	} else {
-		epoch = NULL;			/* XXX disable epoch compare if missing */
-		version = evr;
-	}
-	if (se) {
-		*se++ = '\0';
-		release = se;
-	} else {
-		release = NULL;
-	}
-
-	if (ep) *ep = epoch;
-	if (vp) *vp = version;
-	if (rp) *rp = release;
+#ifdef HAVE_RPMVERCMP
+	/* rpmlib needs the parts terminated */
+	char *a = alloca(len1 + 1);
+	char *b = alloca(len2 + 1);
+	memcpy(a, str1, len1);
+	a[len1] = '\0';
+	memcpy(b, str2, len2);
+	b[len2] = '\0';
+	return rpmvercmp(a, b);
+#else
+	return rpmvercmp_n(str1, len1, str2, len2);
+#endif
 }
 
 #ifndef HAVE_RPMVERCMP
 /*
  * code from http://rpm.org/api/4.4.2.2/rpmvercmp_8c-source.html
+ * changed to compare the segments in place instead of copying the strings
  */
 
 /* compare alpha and numeric segments of two versions */
 /* return 1: a is newer than b */
 /*        0: a and b are the same version */
 /*       -1: b is newer than a */
-static int rpmvercmp(const char *a, const char *b)
+static int rpmvercmp_n(const char *a, size_t alen, const char *b, size_t blen)
 {
-	char oldch1, oldch2;
-	char *str1, *str2;
-	char *one, *two;
+	const char *str1, *str2;
+	const char *one, *two;
+	const char *end1 = a + alen, *end2 = b + blen;
+	size_t len1, len2;
 	int rc;
 	int isnum;
 
 	/* easy comparison to see if versions are identical */
-	if (!strcmp(a, b))
+	if (alen == blen && !memcmp(a, b, alen))
 		return 0;
 
-	/* TODO: make new oscap_alloca */
-	str1 = alloca(strlen(a) + 1);
-	str2 = alloca(strlen(b) + 1);
-
-	strcpy(str1, a);
-	strcpy(str2, b);
-
-	one = str1;
-	two = str2;
+	one = a;
+	two = b;
 
 	/* loop through each version segment of str1 and str2 and compare them */
-	while (*one && *two) {
-		while (*one && !isalnum(*one))
+	while (one < end1 && two < end2) {
+		while (one < end1 && !isalnum(*one))
 			one++;
-		while (*two && !isalnum(*two))
+		while (two < end2 && !isalnum(*two))
 			two++;
 
 		/* If we ran to the end of either, we are finished with the loop */
-		if (!(*one && *two))
+		if (!(one < end1 && two < end2))
 			break;
 
 		str1 = one;
@@ -201,26 +209,19 @@ static int rpmvercmp(const char *a, const char *b)
 		/* leave one and two pointing to the start of the alpha or numeric */
 		/* segment and walk str1 and str2 to end of segment */
 		if (isdigit(*str1)) {
-			while (*str1 && isdigit(*str1))
+			while (str1 < end1 && isdigit(*str1))
 				str1++;
-			while (*str2 && isdigit(*str2))
+			while (str2 < end2 && isdigit(*str2))
 				str2++;
 			isnum = 1;
 		} else {
-			while (*str1 && isalpha(*str1))
+			while (str1 < end1 && isalpha(*str1))
 				str1++;
-			while (*str2 && isalpha(*str2))
+			while (str2 < end2 && isalpha(*str2))
 				str2++;
 			isnum = 0;
 		}
 
-		/* save character at the end of the alpha or numeric segment */
-		/* so that they can be restored after the comparison */
-		oldch1 = *str1;
-		*str1 = '\0';
-		oldch2 = *str2;
-		*str2 = '\0';
-
 		/* this cannot happen, as we previously tested to make sure that */
 		/* the first string has a non-null segment */
 		if (one == str1)
@@ -234,45 +235,42 @@ static int rpmvercmp(const char *a, const char *b)
 			return (isnum ? 1 : -1);
 
 		if (isnum) {
-			/* this used to be done by converting the digit segments */
-			/* to ints using atoi() - it's changed because long  */
-			/* digit segments can overflow an int - this should fix that. */
-
 			/* throw away any leading zeros - it's a number, right? */
-			while (*one == '0')
+			while (one < str1 && *one == '0')
 				one++;
-			while (*two == '0')
+			while (two < str2 && *two == '0')
 				two++;
 
 			/* whichever number has more digits wins */
-			if (strlen(one) > strlen(two))
+			if (str1 - one > str2 - two)
 				return 1;
-			if (strlen(two) > strlen(one))
+			if (str2 - two > str1 - one)
 				return -1;
 		}
 
-		/* strcmp will return which one is greater - even if the two */
+		/* compare the segments like strcmp would - even if the two */
 		/* segments are alpha or if they are numeric.  don't return  */
 		/* if they are equal because there might be more segments to */
 		/* compare */
-		rc = strcmp(one, two);
+		len1 = str1 - one;
+		len2 = str2 - two;
+		rc = memcmp(one, two, len1 < len2 ? len1 : len2);
+		if (rc == 0 && len1 != len2)
+			rc = len1 < len2 ? -1 : 1;
 		if (rc)
 			return (rc < 1 ? -1 : 1);
 
-		/* restore character that was replaced by null above */
-		*str1 = oldch1;
 		one = str1;
-		*str2 = oldch2;
 		two = str2;
 	}
 	/* this catches the case where all numeric and alpha segments have */
 	/* compared identically but the segment sepparating characters were */
 	/* different */
-	if ((!*one) && (!*two))
+	if (one == end1 && two == end2)
 		return 0;
 
 	/* whichever version still has characters left over wins */
-	if (!*one)
+	if (one == end1)
 		return -1;
 	else
 		return 1;
@@ -280,20 +278,55 @@ static int rpmvercmp(const char *a, const char *b)
 #endif
 
 
-oval_result_t oval_versiontype_cmp(const char *state, const char *syschar, oval_operation_t operation)
+int *oval_versiontype_parse(const char *version, int *count)
+{
+	int *fields = NULL;
+	int alloc = 0;
+	int idx = 0;
+
+	*count = 0;
+	while (version[idx]) {
+		if (*count == alloc) {
+			alloc = alloc ? 2 * alloc : 8;
+			fields = oscap_realloc(fields, alloc * sizeof(int));
+		}
+		fields[(*count)++] = atoi(&version[idx]);	// look at the current data field
+
+		++idx;
+		/* move to the next field within the version string (if there is one) */
+		while ((version[idx]) && (isdigit(version[idx])))
+			++idx;
+		if ((version[idx]) && (!isdigit(version[idx])))
+			++idx;
+	}
+	return fields;
+}
+
+oval_result_t oval_versiontype_cmp_parsed(const int *state_fields, int state_count, const char *syschar, oval_operation_t operation)
 {
 	int state_idx = 0;
 	int sys_idx = 0;
-	int result = -1;
-	/* int is_equal = 1; */
-	for (state_idx = 0, sys_idx = 0; (((state[state_idx]) || (syschar[sys_idx])) && (result == -1));) {	// keep going as long as there is data in either the state or sysitem
+
+	switch (operation) {
+	case OVAL_OPERATION_EQUALS:
+	case OVAL_OPERATION_NOT_EQUAL:
+	case OVAL_OPERATION_GREATER_THAN:
+	case OVAL_OPERATION_GREATER_THAN_OR_EQUAL:
+	case OVAL_OPERATION_LESS_THAN:
+	case OVAL_OPERATION_LESS_THAN_OR_EQUAL:
+		break;
+	default:
+		oscap_seterr(OSCAP_EFAMILY_OVAL, "Invalid type of operation in version comparison: %d.", operation);
+		return OVAL_RESULT_ERROR;
+	}
+
+	// keep going as long as there is data in either the state or sysitem
+	for (state_idx = 0, sys_idx = 0; state_idx < state_count || syschar[sys_idx]; ++state_idx) {
 		int tmp_state_int, tmp_sys_int;
-		tmp_state_int = atoi(&state[state_idx]);	// look at the current data field (if we're at the end, atoi should return 0)
+		// if we're at the end, the field is 0
+		tmp_state_int = state_idx < state_count ? state_fields[state_idx] : 0;
 		tmp_sys_int = atoi(&syschar[sys_idx]);
-                /* o rly?
-		if (tmp_state_int != tmp_sys_int)
-			is_equal = 0;	// we might need this later (if we don't terminate early)
-                */
+
 		if (operation == OVAL_OPERATION_EQUALS) {
 			if (tmp_state_int != tmp_sys_int)
 				return (OVAL_RESULT_FALSE);
@@ -306,25 +339,13 @@ oval_result_t oval_versiontype_cmp(const char *state, const char *syschar, oval_
 				return (OVAL_RESULT_TRUE);
 			if (tmp_sys_int < tmp_state_int)
 				return (OVAL_RESULT_FALSE);
-		} else if ((operation == OVAL_OPERATION_LESS_THAN)
-			   || (operation == OVAL_OPERATION_LESS_THAN_OR_EQUAL)) {
+		} else {
 			if (tmp_sys_int < tmp_state_int)
 				return (OVAL_RESULT_TRUE);
 			if (tmp_sys_int > tmp_state_int)
 				return (OVAL_RESULT_FALSE);
-		} else {
-			oscap_seterr(OSCAP_EFAMILY_OVAL, "Invalid type of operation in version comparison: %d.", operation);
-			return OVAL_RESULT_ERROR;
 		}
 
-		if (state[state_idx])
-			++state_idx;
-		/* move to the next field within the version string (if there is one) */
-		while ((state[state_idx]) && (isdigit(state[state_idx])))
-			++state_idx;
-		if ((state[state_idx]) && (!isdigit(state[state_idx])))
-			++state_idx;
-
 		if (syschar[sys_idx])
 			++sys_idx;
 		/* move to the next field within the version string (if there is one) */
@@ -335,20 +356,18 @@ oval_result_t oval_versiontype_cmp(const char *state, const char *syschar, oval_
 	}
 
 	// OK, we did not terminate early, and we're out of data, so we now know what to return
-	if (operation == OVAL_OPERATION_EQUALS) {
+	if (operation == OVAL_OPERATION_EQUALS
+	    || operation == OVAL_OPERATION_GREATER_THAN_OR_EQUAL
+	    || operation == OVAL_OPERATION_LESS_THAN_OR_EQUAL)
 		return (OVAL_RESULT_TRUE);
-	} else if (operation == OVAL_OPERATION_NOT_EQUAL) {
-		return (OVAL_RESULT_FALSE);
-	} else if (operation == OVAL_OPERATION_GREATER_THAN) {
-		return (OVAL_RESULT_FALSE);
-	} else if (operation == OVAL_OPERATION_GREATER_THAN_OR_EQUAL) {
-		return (OVAL_RESULT_TRUE);
-	} else if (operation == OVAL_OPERATION_LESS_THAN) {
-		return (OVAL_RESULT_FALSE);
-	} else if (operation == OVAL_OPERATION_LESS_THAN_OR_EQUAL) {
-		return (OVAL_RESULT_TRUE);
-	}		// we have already filtered out the invalid ones
-	assert(0);
-	return OVAL_RESULT_ERROR;
+	return (OVAL_RESULT_FALSE);
+}
 
+oval_result_t oval_versiontype_cmp(const char *state, const char *syschar, oval_operation_t operation)
+{
+	int count;
+	int *fields = oval_versiontype_parse(state, &count);
+	oval_result_t result = oval_versiontype_cmp_parsed(fields, count, syschar, operation);
+	oscap_free(fields);
+	return result;
 }
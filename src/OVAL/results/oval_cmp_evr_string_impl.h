@@ -30,6 +30,8 @@
 #ifndef OSCAP_OVAL_EVR_STRING_IMPL_H_
 #define OSCAP_OVAL_EVR_STRING_IMPL_H_
 
+#include <stddef.h>
+
 #include "../common/util.h"
 
 #include "oval_definitions.h"
@@ -48,8 +50,50 @@ OSCAP_HIDDEN_START;
  */
 oval_result_t oval_evr_string_cmp(const char *state, const char *sys, oval_operation_t operation);
 
+/**
+ * EVR string split into its parts. The parts point into the parsed
+ * string, which has to outlive the structure. Missing parts are NULL.
+ */
+struct oval_evr {
+	const char *epoch;
+	size_t epoch_len;
+	const char *version;
+	size_t version_len;
+	const char *release;
+	size_t release_len;
+};
+
+/**
+ * Split EVR string into its parts. Nothing is allocated.
+ */
+void oval_evr_parse(const char *evr, struct oval_evr *parsed);
+
+/**
+ * Compare two parsed EVR strings, segment by segment, like rpmvercmp().
+ * @returns 1 if a is newer than b, 0 if they are the same, -1 if b is newer
+ */
+int oval_evr_cmp(const struct oval_evr *a, const struct oval_evr *b);
+
+/**
+ * Compare parsed EVR strings of the state and of the system.
+ * @see oval_evr_string_cmp
+ */
+oval_result_t oval_evr_string_cmp_parsed(const struct oval_evr *state, const struct oval_evr *sys, oval_operation_t operation);
+
 oval_result_t oval_versiontype_cmp(const char *state, const char *syschar, oval_operation_t operation);
 
+/**
+ * Split version string into the numbers of its fields.
+ * @returns array of the fields to be freed by the caller
+ */
+int *oval_versiontype_parse(const char *version, int *count);
+
+/**
+ * Compare version string captured from system with the fields of a parsed one.
+ * @see oval_versiontype_cmp
+ */
+oval_result_t oval_versiontype_cmp_parsed(const int *state_fields, int state_count, const char *syschar, oval_operation_t operation);
+
 OSCAP_HIDDEN_END;
 
 #endif
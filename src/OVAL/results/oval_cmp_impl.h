@@ -51,6 +51,29 @@ oval_result_t oval_ent_cmp_str(char *state_data, oval_datatype_t state_data_type
  */
 oval_result_t oval_str_cmp_str(char *state_data, oval_datatype_t state_data_type, const char *sys_data, oval_operation_t operation);
 
+/**
+ * Value defined within state/entity/value or variable/value prepared for
+ * comparisons with many values collected from system: numbers, versions
+ * and addresses are converted and patterns are compiled only once.
+ */
+struct oval_cmp_value;
+
+struct oval_cmp_value *oval_cmp_value_new(const char *state_data, oval_datatype_t state_data_type, oval_operation_t operation);
+void oval_cmp_value_free(struct oval_cmp_value *cmp);
+const char *oval_cmp_value_get_text(const struct oval_cmp_value *cmp);
+
+/**
+ * Compare the prepared value to data collected from system.
+ * @returns the same result as oval_str_cmp_str
+ */
+oval_result_t oval_cmp_value_cmp(struct oval_cmp_value *cmp, const char *sys_data);
+
+/**
+ * Compare the prepared value to sysent object collected from system.
+ * EVR strings use the parts already parsed by the sysent.
+ */
+oval_result_t oval_cmp_value_cmp_ent(struct oval_cmp_value *cmp, struct oval_sysent *sysent);
+
 OSCAP_HIDDEN_END;
 
 #endif
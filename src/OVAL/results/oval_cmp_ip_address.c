@@ -79,16 +79,48 @@ static inline int ipaddr_parse(int af, const char *oval_ip_string, uint32_t *mas
 	return ipv6addr_parse(oval_ip_string, mask_out, ip_out);
 }
 
+int oval_ipaddr_parse(int af, const char *s, uint32_t *mask_out, void *addr_out)
+{
+	return ipaddr_parse(af, s, mask_out, addr_out);
+}
+
 oval_result_t oval_ipaddr_cmp(int af, const char *s1, const char *s2, oval_operation_t op)
 {
-	oval_result_t result = OVAL_RESULT_ERROR;
-	uint32_t mask1 = 0, mask2 = 0;
+	uint32_t mask1 = 0;
 	char addr1[INET6_ADDRSTRLEN];
-	char addr2[INET6_ADDRSTRLEN];
 
-	if (ipaddr_parse(af, s1, &mask1, &addr1) || ipaddr_parse(af, s2, &mask2, &addr2)) {
-		return result;
+	if (ipaddr_parse(af, s1, &mask1, &addr1)) {
+		return OVAL_RESULT_ERROR;
 	}
+	return oval_ipaddr_cmp_parsed(af, addr1, mask1, s2, op);
+}
+
+oval_result_t oval_ipaddr_cmp_parsed(int af, const void *state_addr, uint32_t mask1, const char *s2, oval_operation_t op)
+{
+	struct oval_ipaddr state, sys;
+
+	sys.af = af;
+	sys.mask = 0;
+	if (ipaddr_parse(af, s2, &sys.mask, &sys.addr)) {
+		return OVAL_RESULT_ERROR;
+	}
+	state.af = af;
+	state.mask = mask1;
+	memcpy(&state.addr, state_addr, af == AF_INET ? sizeof(struct in_addr) : sizeof(struct in6_addr));
+
+	return oval_ipaddr_cmp_addr(&state, &sys, op);
+}
+
+oval_result_t oval_ipaddr_cmp_addr(const struct oval_ipaddr *state, const struct oval_ipaddr *sys, oval_operation_t op)
+{
+	oval_result_t result = OVAL_RESULT_ERROR;
+	int af = state->af;
+	uint32_t mask1 = state->mask, mask2 = sys->mask;
+	struct in6_addr addr1, addr2;
+
+	/* the addresses are masked in place */
+	memcpy(&addr1, &state->addr, sizeof addr1);
+	memcpy(&addr2, &sys->addr, sizeof addr2);
 
 	switch (op) {
 	case OVAL_OPERATION_EQUALS:
@@ -193,18 +225,39 @@ oval_result_t oval_ipaddr_cmp(int af, const char *s1, const char *s2, oval_opera
 	return result;
 }
 
+/* the address without the netmask or prefix length, which starts at *pfx_out if any */
+static inline int ipaddr_split(const char *oval_ip_string, char *buf, size_t bufsize, const char **pfx_out)
+{
+	const char *pfx;
+	size_t len;
+
+	pfx = strchr(oval_ip_string, '/');
+	len = pfx != NULL ? (size_t)(pfx - oval_ip_string) : strlen(oval_ip_string);
+
+	/* longer than any address inet_pton() accepts */
+	if (len >= bufsize) {
+		dW("Invalid IP address: '%s'.", oval_ip_string);
+		return -1;
+	}
+
+	memcpy(buf, oval_ip_string, len);
+	buf[len] = '\0';
+	*pfx_out = pfx != NULL ? pfx + 1 : NULL;
+	return 0;
+}
+
 static inline int ipv4addr_parse(const char *oval_ipv4_string, uint32_t *netmask_out, struct in_addr *ip_out)
 {
-	char *s, *pfx;
+	char s[INET6_ADDRSTRLEN];
+	const char *pfx;
 	int result = -1;
 
-	s = strdup(oval_ipv4_string);
-	pfx = strchr(s, '/');
+	if (ipaddr_split(oval_ipv4_string, s, sizeof s, &pfx))
+		return result;
 	if (pfx) {
 		int cnt;
 		unsigned char nm[4];
 
-		*pfx++ = '\0';
 		cnt = sscanf(pfx, "%hhu.%hhu.%hhu.%hhu", &nm[0], &nm[1], &nm[2], &nm[3]);
 		if (cnt > 1) { /* netmask */
 			*netmask_out = (nm[0] << 24) + (nm[1] << 16) + (nm[2] << 8) + nm[3];
@@ -220,7 +273,6 @@ static inline int ipv4addr_parse(const char *oval_ipv4_string, uint32_t *netmask
 	else
 		result = 0;
 
-	oscap_free(s);
 	return result;
 }
 
@@ -231,13 +283,13 @@ static inline void ipv4addr_mask(struct in_addr *ip_addr, uint32_t netmask)
 
 static inline int ipv6addr_parse(const char *oval_ipv6_string, uint32_t *len_out, struct in6_addr *ip_out)
 {
-	char *s, *pfx;
+	char s[INET6_ADDRSTRLEN];
+	const char *pfx;
 	int result = -1;
 
-	s = strdup(oval_ipv6_string);
-	pfx = strchr(s, '/');
+	if (ipaddr_split(oval_ipv6_string, s, sizeof s, &pfx))
+		return result;
 	if (pfx) {
-		*pfx++ = '\0';
 		*len_out = strtol(pfx, NULL, 10);
 	} else {
 		*len_out = 128;
@@ -248,7 +300,6 @@ static inline int ipv6addr_parse(const char *oval_ipv6_string, uint32_t *len_out
 	else
 		result = 0;
 
-	oscap_free(s);
 	return result;
 }
 
@@ -31,6 +31,9 @@
 #ifndef OSCAP_OVAL_IP_ADDRESS_IMPL_H_
 #define OSCAP_OVAL_IP_ADDRESS_IMPL_H_
 
+#include <stdint.h>
+#include <netinet/in.h>
+
 #include "common/util.h"
 
 #include "oval_definitions.h"
@@ -38,6 +41,15 @@
 
 OSCAP_HIDDEN_START;
 
+/**
+ * IP address or address set (CIDR) parsed by oval_ipaddr_parse
+ */
+struct oval_ipaddr {
+	int af;			///< AF_INET or AF_INET6
+	uint32_t mask;		///< netmask (AF_INET) or prefix length (AF_INET6)
+	struct in6_addr addr;	///< or struct in_addr
+};
+
 /**
  * Compare two IP address or address sets (CIDR). The format of input string
  * shall conform to ipv4_address types from oval:SimpleDatatypeEnumeration.
@@ -50,6 +62,28 @@ OSCAP_HIDDEN_START;
  */
 oval_result_t oval_ipaddr_cmp(int af, const char *s1, const char *s2, oval_operation_t op);
 
+/**
+ * Parse IP address or address set (CIDR).
+ * @param af Internet address family (AF_INET or AF_INET6)
+ * @param s address as defined by state element
+ * @param mask_out netmask (AF_INET) or prefix length (AF_INET6)
+ * @param addr_out struct in_addr or struct in6_addr
+ * @returns 0 on success
+ */
+int oval_ipaddr_parse(int af, const char *s, uint32_t *mask_out, void *addr_out);
+
+/**
+ * Compare already parsed IP address (set) with the one captured from system.
+ * @see oval_ipaddr_cmp
+ */
+oval_result_t oval_ipaddr_cmp_parsed(int af, const void *state_addr, uint32_t mask1, const char *s2, oval_operation_t op);
+
+/**
+ * Compare two parsed IP addresses (sets) of the same family.
+ * @see oval_ipaddr_cmp
+ */
+oval_result_t oval_ipaddr_cmp_addr(const struct oval_ipaddr *state, const struct oval_ipaddr *sys, oval_operation_t op);
+
 OSCAP_HIDDEN_END;
 
 #endif
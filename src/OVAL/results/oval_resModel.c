@@ -58,6 +58,9 @@ struct oval_results_model {
 	struct oval_collection *systems;
 	struct oval_probe_session *probe_session;
 	bool   export_sys_chars;
+	unsigned int jobs;
+	bool short_circuit;
+	bool release_items;
 };
 
 struct oval_results_model *oval_results_model_new(struct oval_definition_model *definition_model,
@@ -89,6 +92,9 @@ struct oval_results_model *oval_results_model_new_with_probe_session(struct oval
 	model->directives_model = oval_directives_model_new();
 	model->probe_session = probe_session;
 	model->export_sys_chars = true;
+	model->jobs = 0;
+	model->short_circuit = false;
+	model->release_items = false;
 	return model;
 }
 
@@ -118,6 +124,36 @@ bool oval_results_model_get_export_system_characteristics(struct oval_results_mo
 	return model->export_sys_chars;
 }
 
+void oval_results_model_set_jobs(struct oval_results_model *model, unsigned int jobs)
+{
+	model->jobs = jobs;
+}
+
+unsigned int oval_results_model_get_jobs(struct oval_results_model *model)
+{
+	return model->jobs;
+}
+
+void oval_results_model_set_short_circuit(struct oval_results_model *model, bool short_circuit)
+{
+	model->short_circuit = short_circuit;
+}
+
+bool oval_results_model_get_short_circuit(struct oval_results_model *model)
+{
+	return model->short_circuit;
+}
+
+void oval_results_model_set_release_items(struct oval_results_model *model, bool release)
+{
+	model->release_items = release;
+}
+
+bool oval_results_model_get_release_items(struct oval_results_model *model)
+{
+	return model->release_items;
+}
+
 void oval_results_model_free(struct oval_results_model *model)
 {
 	__attribute__nonnull__(model);
@@ -248,7 +284,7 @@ int oval_results_model_eval(struct oval_results_model *res_model)
 
 static xmlNode *oval_results_to_dom(struct oval_results_model *results_model,
 				    struct oval_directives_model *directives_model, 
-				    xmlDocPtr doc, xmlNode * parent)
+				    xmlDocPtr doc, xmlNode * parent, struct xml_stream *stream)
 {
 	xmlNode *root_node;
 	struct oval_result_directives * dirs;
@@ -275,6 +311,7 @@ static xmlNode *oval_results_to_dom(struct oval_results_model *results_model,
 	 * directives model(if provided) */
 	dirs_model = (directives_model) ? directives_model : results_model->directives_model;
 	oval_directives_model_to_dom(dirs_model, doc, root_node);
+	xml_stream_flush(stream, root_node);
 
 	dirs = oval_directives_model_get_defdirs(dirs_model);
 
@@ -282,15 +319,18 @@ static xmlNode *oval_results_to_dom(struct oval_results_model *results_model,
 	if(oval_result_directives_get_included(dirs)) {
 		struct oval_definition_model *definition_model = oval_results_model_get_definition_model(results_model);
 		oval_definition_model_to_dom(definition_model, doc, root_node);
+		xml_stream_flush(stream, root_node);
 	}
 
 	xmlNode *results_node = xmlNewTextChild(root_node, ns_results, BAD_CAST "results", NULL);
 	struct oval_result_system_iterator *systems = oval_results_model_get_systems(results_model);
 	while (oval_result_system_iterator_has_more(systems)) {
 		struct oval_result_system *sys = oval_result_system_iterator_next(systems);
-		oval_result_system_to_dom(sys, results_model, dirs_model, doc, results_node);
+		oval_result_system_to_dom(sys, results_model, dirs_model, doc, results_node, stream);
 	}
 	oval_result_system_iterator_free(systems);
+	xml_stream_end(stream, results_node);
+	xml_stream_end(stream, root_node);
 
 	return root_node;
 }
@@ -305,7 +345,7 @@ struct oscap_source *oval_results_model_export_source(struct oval_results_model
 		return NULL;
 	}
 
-	oval_results_to_dom(results_model, directives_model, doc, NULL);
+	oval_results_to_dom(results_model, directives_model, doc, NULL, NULL);
 	return oscap_source_new_from_xmlDoc(doc, name);
 }
 
@@ -313,12 +353,29 @@ int oval_results_model_export(struct oval_results_model *results_model,
 			      struct oval_directives_model *directives_model,
 			      const char *file)
 {
-	struct oscap_source *source = oval_results_model_export_source(results_model, directives_model, file);
-	if (source == NULL) {
+	__attribute__nonnull__(results_model);
+
+	/* write the document as it is built, it doesn't fit in memory on big systems */
+	struct xml_stream *stream = xml_stream_new(file);
+	if (stream == NULL)
 		return -1;
-	}
-	int ret = oscap_source_save_as(source, NULL);
-	oscap_source_free(source);
+
+	oval_results_to_dom(results_model, directives_model, xml_stream_get_doc(stream), NULL, stream);
+	return xml_stream_close(stream);
+}
+
+int oval_results_model_export_delta(struct oval_results_model *results_model,
+				    struct oval_directives_model *directives_model,
+				    const char *baseline_file, const char *file)
+{
+	__attribute__nonnull__(results_model);
+
+	struct oscap_source *result = oval_results_model_export_source(results_model, directives_model, NULL);
+	if (result == NULL)
+		return -1;
+
+	int ret = oscap_source_save_delta_as(result, baseline_file, file);
+	oscap_source_free(result);
 	return ret;
 }
 
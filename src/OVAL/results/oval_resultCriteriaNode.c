@@ -39,6 +39,7 @@
 
 #include "oval_agent_api_impl.h"
 #include "results/oval_results_impl.h"
+#include "oval_probe_impl.h"
 #include "adt/oval_collection_impl.h"
 #include "common/util.h"
 #include "common/debug_priv.h"
@@ -332,12 +333,188 @@ oval_result_t oval_result_criteria_node_negate(struct oval_result_criteria_node
 }
 
 
+/*
+ * Estimate in milliseconds, measured by the probe session if it has
+ * collected objects of the type already (now or in a previous session),
+ * otherwise the probes which walk the file systems are the expensive ones.
+ */
+static unsigned int _oval_result_object_cost(struct oval_result_system *sys, struct oval_object *object)
+{
+	struct oval_probe_session *psess;
+	struct oval_behavior_iterator *behaviors;
+	unsigned int cost;
+	double measured;
+
+	psess = oval_results_model_get_probe_session(oval_result_system_get_results_model(sys));
+	if (psess != NULL) {
+		measured = oval_probe_session_get_cost(psess, oval_object_get_subtype(object));
+		if (measured >= 0)
+			return 1 + (unsigned int) (measured * 1000);
+	}
+
+	switch ((int) oval_object_get_subtype(object)) {
+	case OVAL_INDEPENDENT_FAMILY:
+	case OVAL_INDEPENDENT_VARIABLE:
+	case OVAL_INDEPENDENT_ENVIRONMENT_VARIABLE:
+	case OVAL_INDEPENDENT_ENVIRONMENT_VARIABLE58:
+	case OVAL_UNIX_UNAME:
+		return 1;
+	case OVAL_INDEPENDENT_FILE_MD5:
+	case OVAL_INDEPENDENT_FILE_HASH:
+	case OVAL_INDEPENDENT_FILE_HASH58:
+	case OVAL_INDEPENDENT_TEXT_FILE_CONTENT:
+	case OVAL_INDEPENDENT_TEXT_FILE_CONTENT_54:
+	case OVAL_INDEPENDENT_XML_FILE_CONTENT:
+	case OVAL_UNIX_FILE:
+	case OVAL_UNIX_FILEEXTENDEDATTRIBUTE:
+	case OVAL_LINUX_SELINUXSECURITYCONTEXT:
+	case OVAL_LINUX_RPMVERIFYFILE:
+		cost = 8;
+		break;
+	default:
+		return 4;
+	}
+
+	behaviors = oval_object_get_behaviors(object);
+	while (oval_behavior_iterator_has_more(behaviors)) {
+		struct oval_behavior *behavior = oval_behavior_iterator_next(behaviors);
+		const char *key = oval_behavior_get_key(behavior);
+		const char *value = oval_behavior_get_value(behavior);
+
+		if (key != NULL && value != NULL
+		    && strcmp(key, "recurse_direction") == 0 && strcmp(value, "none") != 0)
+			cost *= 8;
+	}
+	oval_behavior_iterator_free(behaviors);
+
+	return cost;
+}
+
+/* estimate of the collection which the evaluation of the node would start */
+static unsigned int _oval_result_criteria_node_cost(struct oval_result_criteria_node *node)
+{
+	unsigned int cost = 0;
+
+	if (node->result != OVAL_RESULT_NOT_EVALUATED)
+		return 0;
+
+	switch (node->type) {
+	case OVAL_NODETYPE_CRITERIA:{
+			struct oval_result_criteria_node_iterator *subnodes
+			    = oval_result_criteria_node_get_subnodes(node);
+			while (oval_result_criteria_node_iterator_has_more(subnodes))
+				cost += _oval_result_criteria_node_cost(oval_result_criteria_node_iterator_next(subnodes));
+			oval_result_criteria_node_iterator_free(subnodes);
+		} break;
+	case OVAL_NODETYPE_CRITERION:{
+			struct oval_result_test *rtest = oval_result_criteria_node_get_test(node);
+			struct oval_object *object = oval_test_get_object(oval_result_test_get_test(rtest));
+			struct oval_syschar_model *syschar_model = oval_result_system_get_syschar_model(node->sys);
+
+			/* objects which were collected already are for free */
+			if (object != NULL && oval_result_test_get_result(rtest) == OVAL_RESULT_NOT_EVALUATED
+			    && oval_syschar_model_get_syschar(syschar_model, oval_object_get_id(object)) == NULL)
+				cost = _oval_result_object_cost(node->sys, object);
+		} break;
+	case OVAL_NODETYPE_EXTENDDEF:{
+			struct oval_result_definition *extends = oval_result_criteria_node_get_extends(node);
+			struct oval_result_criteria_node *criteria = oval_result_definition_get_criteria(extends);
+
+			if (criteria != NULL && oval_result_definition_get_result(extends) == OVAL_RESULT_NOT_EVALUATED)
+				cost = _oval_result_criteria_node_cost(criteria);
+		} break;
+	default:
+		break;
+	}
+
+	return cost;
+}
+
+/* whether the results of the remaining subnodes can't change the result of the operator */
+static bool _oval_result_criteria_decided(struct oresults *ores, oval_operator_t operator)
+{
+	switch (operator) {
+	case OVAL_OPERATOR_AND:
+		return ores->false_cnt > 0;
+	case OVAL_OPERATOR_OR:
+		return ores->true_cnt > 0;
+	case OVAL_OPERATOR_ONE:
+		return ores->true_cnt > 1;
+	default:
+		return false;
+	}
+}
+
+struct _criteria_subnode {
+	struct oval_result_criteria_node *node;
+	unsigned int cost;
+	size_t order;
+};
+
+static int _criteria_subnode_cmp(const void *a, const void *b)
+{
+	const struct _criteria_subnode *sa = a, *sb = b;
+
+	if (sa->cost != sb->cost)
+		return sa->cost < sb->cost ? -1 : 1;
+	return sa->order < sb->order ? -1 : (sa->order > sb->order);
+}
+
+/*
+ * Evaluate the cheapest subnodes first and stop as soon as the result is
+ * known, the other subnodes stay not evaluated and their objects aren't
+ * collected at all.
+ */
+static oval_result_t _oval_result_criteria_short_circuit(struct oval_result_criteria_node *node)
+{
+	struct oval_result_criteria_node_iterator *subnodes;
+	struct _criteria_subnode *sub;
+	oval_operator_t operator = oval_result_criteria_node_get_operator(node);
+	struct oresults node_res;
+	size_t i, count = 0;
+
+	subnodes = oval_result_criteria_node_get_subnodes(node);
+	while (oval_result_criteria_node_iterator_has_more(subnodes)) {
+		oval_result_criteria_node_iterator_next(subnodes);
+		++count;
+	}
+	oval_result_criteria_node_iterator_free(subnodes);
+
+	sub = oscap_alloc(sizeof(struct _criteria_subnode) * (count > 0 ? count : 1));
+	subnodes = oval_result_criteria_node_get_subnodes(node);
+	for (i = 0; i < count; ++i) {
+		sub[i].node = oval_result_criteria_node_iterator_next(subnodes);
+		sub[i].cost = _oval_result_criteria_node_cost(sub[i].node);
+		sub[i].order = i;
+	}
+	oval_result_criteria_node_iterator_free(subnodes);
+
+	qsort(sub, count, sizeof(struct _criteria_subnode), _criteria_subnode_cmp);
+
+	ores_clear(&node_res);
+	for (i = 0; i < count; ++i) {
+		ores_add_res(&node_res, oval_result_criteria_node_eval(sub[i].node));
+		if (i + 1 < count && _oval_result_criteria_decided(&node_res, operator)) {
+			dI("Skipping %zu criteria nodes, the result doesn't depend on them.", count - i - 1);
+			break;
+		}
+	}
+	oscap_free(sub);
+
+	return ores_get_result_byopr(&node_res, operator);
+}
+
 static oval_result_t _oval_result_criteria_node_result(struct oval_result_criteria_node *node) {
 	__attribute__nonnull__(node);
 
 	oval_result_t result;
 	switch (node->type) {
 	case OVAL_NODETYPE_CRITERIA:{
+			if (oval_results_model_get_short_circuit(oval_result_system_get_results_model(node->sys))) {
+				result = _oval_result_criteria_short_circuit(node);
+				break;
+			}
+
 			struct oval_result_criteria_node_iterator *subnodes
 			    = oval_result_criteria_node_get_subnodes(node);
 			oval_operator_t operator = oval_result_criteria_node_get_operator(node);
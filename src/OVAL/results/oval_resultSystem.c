@@ -35,7 +35,9 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <string.h>
+#include <pthread.h>
 
 #include "oval_definitions.h"
 #include "oval_agent_api.h"
@@ -46,6 +48,8 @@
 #include "adt/oval_smc_iterator_impl.h"
 #include "adt/oval_string_map_impl.h"
 #include "oval_parser_impl.h"
+#include "oval_system_characteristics_impl.h"
+#include "collectVarRefs_impl.h"
 
 #include "common/debug_priv.h"
 #include "common/_error.h"
@@ -56,8 +60,45 @@ typedef struct oval_result_system {
 	struct oval_smc *definitions;			///< Map contains lists of oval_result_definition
 	struct oval_smc *tests;				///< Map contains lists of oval_result_test
 	struct oval_syschar_model *syschar_model;
+	/* The last result of each definition and test, indexed by the number of
+	 * its ID (see oval_definition_model_intern_id). A NULL slot or a result
+	 * of another definition/test only means that the maps above are asked. */
+	void **last_definitions;
+	int last_definitions_size;
+	void **last_tests;
+	int last_tests_size;
+	/* Results of comparing items with states which don't refer to any
+	 * variable, see oval_result_system_get_item_result. */
+	struct oval_item_result *item_results;
+	size_t item_results_size;
+	size_t item_results_count;
+	pthread_mutex_t item_results_lock;
+	/* object id -> struct oval_pending_tests, built when the first test is
+	 * evaluated, see oval_result_system_test_evaluated */
+	struct oval_string_map *pending;
+	pthread_mutex_t pending_lock;
 } oval_result_system_t;
 
+struct oval_pending_tests {
+	unsigned int count;	///< tests of the object not evaluated yet
+	bool pinned;		///< the items are read by a set object or a variable too
+};
+
+struct oval_item_result {
+	const struct oval_state *state;
+	const struct oval_sysitem *item;
+	oval_result_t result;
+};
+
+/* The tests evaluated by the threads of oval_result_system_eval */
+struct oval_result_test_queue {
+	struct oval_result_test **tests;
+	size_t count;
+	size_t next;
+	char *error;
+	pthread_mutex_t lock;
+};
+
 
 static void _oval_result_system_scan_criteria_for_references(struct oval_result_criteria_node *node, 
 							     struct oval_smc *testmap);
@@ -115,6 +156,16 @@ struct oval_result_system *oval_result_system_new(struct oval_results_model *mod
 	sys->definitions = oval_smc_new();
 	sys->tests = oval_smc_new();
 	sys->syschar_model = syschar_model;
+	sys->last_definitions = NULL;
+	sys->last_definitions_size = 0;
+	sys->last_tests = NULL;
+	sys->last_tests_size = 0;
+	sys->item_results = NULL;
+	sys->item_results_size = 0;
+	sys->item_results_count = 0;
+	pthread_mutex_init(&sys->item_results_lock, NULL);
+	sys->pending = NULL;
+	pthread_mutex_init(&sys->pending_lock, NULL);
 	sys->model = model;
 
 	oval_results_model_add_system(model, sys);
@@ -148,6 +199,13 @@ void oval_result_system_free(struct oval_result_system *sys)
 	sys->definitions = NULL;
 	sys->syschar_model = NULL;
 	sys->tests = NULL;
+	oscap_free(sys->last_definitions);
+	oscap_free(sys->last_tests);
+	oscap_free(sys->item_results);
+	pthread_mutex_destroy(&sys->item_results_lock);
+	if (sys->pending != NULL)
+		oval_string_map_free(sys->pending, (oscap_destruct_func) oscap_free);
+	pthread_mutex_destroy(&sys->pending_lock);
 
 	oscap_free(sys);
 }
@@ -171,6 +229,41 @@ struct oval_result_definition_iterator *oval_result_system_get_definitions(struc
 	return oval_result_definition_iterator_new(sys->definitions);
 }
 
+size_t oval_result_system_get_definition_records(struct oval_result_system *sys, struct oval_result_definition_record **records)
+{
+	struct oval_result_definition_iterator *it;
+	size_t count = 0, size = 0;
+
+	__attribute__nonnull__(sys);
+
+	*records = NULL;
+
+	it = oval_result_system_get_definitions(sys);
+	while (oval_result_definition_iterator_has_more(it)) {
+		struct oval_result_definition *def = oval_result_definition_iterator_next(it);
+		struct oval_result_definition_record *grown;
+
+		if (count == size) {
+			size = size == 0 ? 256 : size * 2;
+			grown = realloc(*records, sizeof(struct oval_result_definition_record) * size);
+			if (grown == NULL)
+				break;
+			*records = grown;
+		}
+		(*records)[count].id = oval_result_definition_get_id(def);
+		(*records)[count].result = oval_result_definition_get_result(def);
+		++count;
+	}
+	oval_result_definition_iterator_free(it);
+
+	if (count == 0) {
+		free(*records);
+		*records = NULL;
+	}
+
+	return count;
+}
+
 struct oval_result_test_iterator *oval_result_system_get_tests(struct oval_result_system *sys) {
 	__attribute__nonnull__(sys);
 
@@ -193,6 +286,30 @@ struct oval_result_test *oval_result_system_get_test(struct oval_result_system *
 	return oval_smc_get_last(sys->tests, id);
 }
 
+static void _oval_result_system_set_last(void ***last, int *size, int index, void *item)
+{
+	if (index < 0)
+		return;
+
+	if (index >= *size) {
+		int new_size = *size > 0 ? *size : 64;
+
+		while (new_size <= index)
+			new_size *= 2;
+
+		*last = oscap_realloc(*last, sizeof(void *) * new_size);
+		memset(*last + *size, 0, sizeof(void *) * (new_size - *size));
+		*size = new_size;
+	}
+
+	(*last)[index] = item;
+}
+
+static inline void *_oval_result_system_get_last(void **last, int size, int index)
+{
+	return (index >= 0 && index < size) ? last[index] : NULL;
+}
+
 struct oval_result_definition *oval_result_system_get_new_definition
     (struct oval_result_system *sys, struct oval_definition *oval_definition, int variable_instance) {
 	// This function is used from multiple different places which might not be sustainable.
@@ -203,7 +320,10 @@ struct oval_result_definition *oval_result_system_get_new_definition
 	struct oval_result_definition *rslt_definition = NULL;
 	if (oval_definition) {
 		char *id = oval_definition_get_id(oval_definition);
-		rslt_definition = oval_result_system_get_definition(sys, id);
+		rslt_definition = _oval_result_system_get_last(sys->last_definitions, sys->last_definitions_size,
+							       oval_definition_get_id_index(oval_definition));
+		if (rslt_definition == NULL || oval_result_definition_get_definition(rslt_definition) != oval_definition)
+			rslt_definition = oval_result_system_get_definition(sys, id);
 		if (rslt_definition == NULL) {
 			rslt_definition = make_result_definition_from_oval_definition(sys, oval_definition,
 				variable_instance ? variable_instance : 1);
@@ -221,7 +341,12 @@ struct oval_result_definition *oval_result_system_get_new_definition
 
 struct oval_result_test *oval_result_system_get_new_test(struct oval_result_system *sys, struct oval_test *oval_test, int variable_instance) {
 	char *id = oval_test_get_id(oval_test);
-	struct oval_result_test *rslt_testtest = oval_result_system_get_test(sys, id);
+	struct oval_result_test *rslt_testtest;
+
+	rslt_testtest = _oval_result_system_get_last(sys->last_tests, sys->last_tests_size,
+						     oval_test_get_id_index(oval_test));
+	if (rslt_testtest == NULL || oval_result_test_get_test(rslt_testtest) != oval_test)
+		rslt_testtest = oval_result_system_get_test(sys, id);
 	if (rslt_testtest == NULL) {
 		//test = oval_result_test_new(sys, id);
 		rslt_testtest = make_result_test_from_oval_test(sys, oval_test, variable_instance);
@@ -259,6 +384,11 @@ void oval_result_system_add_definition(struct oval_result_system *sys, struct ov
 	if (definition) {
 		const char *id = oval_result_definition_get_id(definition);
 		oval_smc_put_last(sys->definitions, id, definition);
+
+		struct oval_definition *oval_definition = oval_result_definition_get_definition(definition);
+		if (oval_definition != NULL)
+			_oval_result_system_set_last(&sys->last_definitions, &sys->last_definitions_size,
+						     oval_definition_get_id_index(oval_definition), definition);
 	}
 }
 
@@ -268,6 +398,11 @@ void oval_result_system_add_test(struct oval_result_system *sys, struct oval_res
 	if (test) {
 		const char *id = oval_result_test_get_id(test);
 		oval_smc_put_last(sys->tests, id, test);
+
+		struct oval_test *oval_test = oval_result_test_get_test(test);
+		if (oval_test != NULL)
+			_oval_result_system_set_last(&sys->last_tests, &sys->last_tests_size,
+						     oval_test_get_id_index(oval_test), test);
 	}
 }
 
@@ -328,14 +463,439 @@ int oval_result_system_parse_tag(xmlTextReaderPtr reader, struct oval_parser_con
 	return return_code;
 }
 
+static inline size_t _oval_item_result_hash(const struct oval_state *state, const struct oval_sysitem *item)
+{
+	uint64_t h = ((uint64_t) (uintptr_t) state * 31) ^ (uint64_t) (uintptr_t) item;
+	return (size_t) ((h * 0x9e3779b97f4a7c15ULL) >> 32);
+}
+
+static struct oval_item_result *_oval_result_system_find_item_result(struct oval_result_system *sys,
+	const struct oval_state *state, const struct oval_sysitem *item)
+{
+	size_t mask = sys->item_results_size - 1;
+	size_t i = _oval_item_result_hash(state, item) & mask;
+
+	while (sys->item_results[i].state != NULL) {
+		if (sys->item_results[i].state == state && sys->item_results[i].item == item)
+			break;
+		i = (i + 1) & mask;
+	}
+	return &sys->item_results[i];
+}
+
+bool oval_result_system_get_item_result(struct oval_result_system *sys, struct oval_state *state,
+					struct oval_sysitem *item, oval_result_t *result)
+{
+	bool found = false;
+
+	pthread_mutex_lock(&sys->item_results_lock);
+	if (sys->item_results_count > 0) {
+		struct oval_item_result *slot = _oval_result_system_find_item_result(sys, state, item);
+		if (slot->state != NULL) {
+			*result = slot->result;
+			found = true;
+		}
+	}
+	pthread_mutex_unlock(&sys->item_results_lock);
+	return found;
+}
+
+void oval_result_system_set_item_result(struct oval_result_system *sys, struct oval_state *state,
+					struct oval_sysitem *item, oval_result_t result)
+{
+	pthread_mutex_lock(&sys->item_results_lock);
+	/* keep the table at most half full */
+	if (2 * (sys->item_results_count + 1) > sys->item_results_size) {
+		struct oval_item_result *old = sys->item_results;
+		size_t old_size = sys->item_results_size;
+		size_t size = old_size ? 2 * old_size : 256;
+		struct oval_item_result *table = oscap_calloc(size, sizeof(struct oval_item_result));
+
+		if (table == NULL) {
+			/* the result is only remembered to save comparisons */
+			pthread_mutex_unlock(&sys->item_results_lock);
+			return;
+		}
+		sys->item_results = table;
+		sys->item_results_size = size;
+		for (size_t i = 0; i < old_size; ++i) {
+			if (old[i].state != NULL)
+				*_oval_result_system_find_item_result(sys, old[i].state, old[i].item) = old[i];
+		}
+		oscap_free(old);
+	}
+
+	struct oval_item_result *slot = _oval_result_system_find_item_result(sys, state, item);
+	if (slot->state == NULL) {
+		slot->state = state;
+		slot->item = item;
+		sys->item_results_count++;
+	}
+	slot->result = result;
+	pthread_mutex_unlock(&sys->item_results_lock);
+}
+
+static struct oval_pending_tests *_oval_pending_tests_get(struct oval_string_map *pending, struct oval_object *object)
+{
+	struct oval_pending_tests *p = oval_string_map_get_value(pending, oval_object_get_id(object));
+
+	if (p == NULL) {
+		p = oscap_calloc(1, sizeof(struct oval_pending_tests));
+		oval_string_map_put(pending, oval_object_get_id(object), p);
+	}
+	return p;
+}
+
+static void _oval_pending_tests_pin_set(struct oval_string_map *pending, struct oval_setobject *set)
+{
+	struct oval_setobject_iterator *subset_it;
+	struct oval_object_iterator *obj_it;
+
+	switch (oval_setobject_get_type(set)) {
+	case OVAL_SET_AGGREGATE:
+		subset_it = oval_setobject_get_subsets(set);
+		while (oval_setobject_iterator_has_more(subset_it))
+			_oval_pending_tests_pin_set(pending, oval_setobject_iterator_next(subset_it));
+		oval_setobject_iterator_free(subset_it);
+		break;
+	case OVAL_SET_COLLECTIVE:
+		obj_it = oval_setobject_get_objects(set);
+		while (oval_object_iterator_has_more(obj_it))
+			_oval_pending_tests_get(pending, oval_object_iterator_next(obj_it))->pinned = true;
+		oval_object_iterator_free(obj_it);
+		break;
+	default:
+		break;
+	}
+}
+
+static void _oval_pending_tests_pin_component(struct oval_string_map *pending, struct oval_component *component)
+{
+	struct oval_component_iterator *cmp_it;
+
+	if (component == NULL)
+		return;
+
+	if (oval_component_get_type(component) == OVAL_COMPONENT_OBJECTREF) {
+		if (oval_component_get_object(component) != NULL)
+			_oval_pending_tests_get(pending, oval_component_get_object(component))->pinned = true;
+		return;
+	}
+
+	cmp_it = oval_component_get_function_components(component);
+	while (cmp_it != NULL && oval_component_iterator_has_more(cmp_it))
+		_oval_pending_tests_pin_component(pending, oval_component_iterator_next(cmp_it));
+	if (cmp_it != NULL)
+		oval_component_iterator_free(cmp_it);
+}
+
+/* the number of the tests of every object and the objects whose items are read otherwise */
+static struct oval_string_map *_oval_pending_tests_new(struct oval_definition_model *model)
+{
+	struct oval_string_map *pending = oval_string_map_new();
+	struct oval_test_iterator *tst_it;
+	struct oval_object_iterator *obj_it;
+	struct oval_variable_iterator *var_it;
+
+	tst_it = oval_definition_model_get_tests(model);
+	while (oval_test_iterator_has_more(tst_it)) {
+		struct oval_object *object = oval_test_get_object(oval_test_iterator_next(tst_it));
+
+		if (object != NULL)
+			_oval_pending_tests_get(pending, object)->count++;
+	}
+	oval_test_iterator_free(tst_it);
+
+	obj_it = oval_definition_model_get_objects(model);
+	while (oval_object_iterator_has_more(obj_it)) {
+		struct oval_object_content_iterator *cont_it;
+
+		cont_it = oval_object_get_object_contents(oval_object_iterator_next(obj_it));
+		while (oval_object_content_iterator_has_more(cont_it)) {
+			struct oval_object_content *content = oval_object_content_iterator_next(cont_it);
+
+			if (oval_object_content_get_type(content) == OVAL_OBJECTCONTENT_SET)
+				_oval_pending_tests_pin_set(pending, oval_object_content_get_setobject(content));
+		}
+		oval_object_content_iterator_free(cont_it);
+	}
+	oval_object_iterator_free(obj_it);
+
+	var_it = oval_definition_model_get_variables(model);
+	while (oval_variable_iterator_has_more(var_it)) {
+		struct oval_variable *variable = oval_variable_iterator_next(var_it);
+
+		if (oval_variable_get_type(variable) == OVAL_VARIABLE_LOCAL)
+			_oval_pending_tests_pin_component(pending, oval_variable_get_component(variable));
+	}
+	oval_variable_iterator_free(var_it);
+
+	return pending;
+}
+
+void oval_result_system_test_evaluated(struct oval_result_system *sys, struct oval_test *test)
+{
+	struct oval_object *object = oval_test_get_object(test);
+	struct oval_pending_tests *p;
+	struct oval_syschar *syschar = NULL;
+
+	if (object == NULL || !oval_results_model_get_release_items(sys->model))
+		return;
+
+	pthread_mutex_lock(&sys->pending_lock);
+	if (sys->pending == NULL)
+		sys->pending = _oval_pending_tests_new(oval_results_model_get_definition_model(sys->model));
+
+	p = oval_string_map_get_value(sys->pending, oval_object_get_id(object));
+	/* the tests of other variable instances are evaluated again, the object is then collected again */
+	if (p != NULL && !p->pinned && p->count > 0 && --p->count == 0)
+		syschar = oval_syschar_model_get_syschar(sys->syschar_model, oval_object_get_id(object));
+	pthread_mutex_unlock(&sys->pending_lock);
+
+	if (syschar != NULL && oval_syschar_get_flag(syschar) != SYSCHAR_FLAG_UNKNOWN) {
+		dD("All the tests of object '%s' were evaluated, releasing its items.", oval_object_get_id(object));
+		oval_syschar_release(syschar);
+	}
+}
+
+static void _oval_result_test_queue_run(struct oval_result_test_queue *queue)
+{
+	for (;;) {
+		pthread_mutex_lock(&queue->lock);
+		size_t i = queue->next++;
+		pthread_mutex_unlock(&queue->lock);
+		if (i >= queue->count)
+			break;
+		oval_result_test_eval(queue->tests[i]);
+	}
+}
+
+static void *_oval_result_system_eval_worker(void *arg)
+{
+	struct oval_result_test_queue *queue = arg;
+
+	_oval_result_test_queue_run(queue);
+
+	/* the errors are kept per thread, hand them over to the caller */
+	if (oscap_err()) {
+		char *error = oscap_err_get_full_error();
+		pthread_mutex_lock(&queue->lock);
+		if (queue->error == NULL)
+			queue->error = error;
+		else
+			oscap_free(error);
+		pthread_mutex_unlock(&queue->lock);
+	}
+	return NULL;
+}
+
+/*
+ * Check that the test can be evaluated in parallel with the others, i.e. that
+ * it only reads the models. The variables of its states are computed here.
+ */
+static bool _oval_result_system_prepare_test(struct oval_result_system *sys, struct oval_result_test *rtest)
+{
+	struct oval_test *test = oval_result_test_get_test(rtest);
+	struct oval_string_map *vm = oval_string_map_new();
+	struct oval_state_iterator *ste_itr;
+	struct oval_iterator *var_itr;
+	bool ready = true;
+
+	ste_itr = oval_test_get_states(test);
+	while (oval_state_iterator_has_more(ste_itr))
+		oval_ste_collect_var_refs(oval_state_iterator_next(ste_itr), vm);
+	oval_state_iterator_free(ste_itr);
+
+	var_itr = oval_string_map_values(vm);
+	while (oval_collection_iterator_has_more(var_itr)) {
+		struct oval_variable *var = oval_collection_iterator_next(var_itr);
+
+		if (oval_syschar_model_compute_variable(sys->syschar_model, var) != 0
+		    || (oval_variable_get_type(var) == OVAL_VARIABLE_LOCAL
+			&& oval_variable_get_collection_flag(var) == SYSCHAR_FLAG_UNKNOWN))
+			ready = false;
+	}
+	oval_collection_iterator_free(var_itr);
+	oval_string_map_free(vm, NULL);
+
+	/* load the items which were imported lazily */
+	struct oval_object *object = oval_test_get_object(test);
+	struct oval_syschar *syschar = object != NULL ?
+		oval_syschar_model_get_syschar(sys->syschar_model, oval_object_get_id(object)) : NULL;
+	if (syschar != NULL) {
+		struct oval_sysitem_iterator *items_itr = oval_syschar_get_sysitem(syschar);
+		while (oval_sysitem_iterator_has_more(items_itr))
+			oval_sysitem_get_status(oval_sysitem_iterator_next(items_itr));
+		oval_sysitem_iterator_free(items_itr);
+		/* the evaluation would write them to the shared items */
+		oval_result_test_copy_masks(rtest, syschar);
+	}
+
+	return ready;
+}
+
+/*
+ * Evaluate the tests of all the definitions by the given number of threads.
+ * The definitions are evaluated afterwards from the results of their tests.
+ */
+static void _oval_result_system_eval_tests(struct oval_result_system *sys, struct oval_definition_model *definition_model,
+					   unsigned int jobs)
+{
+	struct oval_definition_iterator *definitions_itr;
+	struct oval_smc *tstmap = oval_smc_new();
+	struct oval_result_test_queue queue;
+	size_t alloc = 0;
+
+	memset(&queue, 0, sizeof(queue));
+
+	definitions_itr = oval_definition_model_get_definitions(definition_model);
+	while (oval_definition_iterator_has_more(definitions_itr)) {
+		struct oval_definition *definition = oval_definition_iterator_next(definitions_itr);
+		struct oval_result_definition *rslt_definition = oval_result_system_get_new_definition(sys, definition, 0);
+		struct oval_result_criteria_node *criteria = oval_result_definition_get_criteria(rslt_definition);
+		if (criteria != NULL)
+			_oval_result_system_scan_criteria_for_references(criteria, tstmap);
+	}
+	oval_definition_iterator_free(definitions_itr);
+
+	struct oval_smc_iterator *result_tests = oval_smc_iterator_new(tstmap);
+	while (oval_smc_iterator_has_more(result_tests)) {
+		struct oval_result_test *rtest = oval_smc_iterator_next(result_tests);
+
+		if (oval_result_test_get_result(rtest) != OVAL_RESULT_NOT_EVALUATED
+		    || !_oval_result_system_prepare_test(sys, rtest))
+			continue;
+		if (queue.count == alloc) {
+			alloc = alloc ? 2 * alloc : 64;
+			queue.tests = oscap_realloc(queue.tests, alloc * sizeof(struct oval_result_test *));
+		}
+		queue.tests[queue.count++] = rtest;
+	}
+	oval_smc_iterator_free(result_tests);
+	oval_smc_free0(tstmap);
+
+	if (jobs > queue.count)
+		jobs = queue.count;
+	dI("Evaluating %zu tests by %u threads.", queue.count, jobs);
+
+	pthread_t *threads = oscap_alloc(sizeof(pthread_t) * (jobs > 0 ? jobs : 1));
+	unsigned int started = 0;
+
+	pthread_mutex_init(&queue.lock, NULL);
+	/* the calling thread is one of the workers */
+	while (started + 1 < jobs) {
+		if (pthread_create(&threads[started], NULL, _oval_result_system_eval_worker, &queue) != 0) {
+			dW("Unable to start a thread, continuing with %u threads.", started + 1);
+			break;
+		}
+		started++;
+	}
+	_oval_result_test_queue_run(&queue);
+	for (unsigned int i = 0; i < started; ++i)
+		pthread_join(threads[i], NULL);
+	pthread_mutex_destroy(&queue.lock);
+
+	if (queue.error != NULL) {
+		oscap_seterr(OSCAP_EFAMILY_OVAL, "%s", queue.error);
+		oscap_free(queue.error);
+	}
+	oscap_free(threads);
+	oscap_free(queue.tests);
+}
+
+struct oval_package_tests {
+	struct oval_result_test **tests;
+	size_t count;
+};
+
+static void _oval_package_tests_free(struct oval_package_tests *pkg)
+{
+	oscap_free(pkg->tests);
+	oscap_free(pkg);
+}
+
+void oval_result_system_eval_packages(struct oval_result_system *sys)
+{
+	struct oval_definition_model *definition_model;
+	struct oval_definition_iterator *definitions_itr;
+	struct oval_smc *tstmap = oval_smc_new();
+	struct oval_string_map *packages = oval_string_map_new();
+	struct oval_result_test **tests = NULL;
+	size_t count = 0, npackages = 0;
+
+	definition_model = oval_results_model_get_definition_model(sys->model);
+	definitions_itr = oval_definition_model_get_definitions(definition_model);
+	while (oval_definition_iterator_has_more(definitions_itr)) {
+		struct oval_definition *definition = oval_definition_iterator_next(definitions_itr);
+		struct oval_result_definition *rslt_definition = oval_result_system_get_new_definition(sys, definition, 0);
+		struct oval_result_criteria_node *criteria = oval_result_definition_get_criteria(rslt_definition);
+		if (criteria != NULL)
+			_oval_result_system_scan_criteria_for_references(criteria, tstmap);
+	}
+	oval_definition_iterator_free(definitions_itr);
+
+	/* the index of the package tests by the package name */
+	struct oval_smc_iterator *result_tests = oval_smc_iterator_new(tstmap);
+	while (oval_smc_iterator_has_more(result_tests)) {
+		struct oval_result_test *rtest = oval_smc_iterator_next(result_tests);
+		struct oval_package_tests *pkg;
+		const char *name;
+
+		if (oval_result_test_get_result(rtest) != OVAL_RESULT_NOT_EVALUATED
+		    || (name = oval_result_test_get_package_name(rtest)) == NULL)
+			continue;
+		if ((pkg = oval_string_map_get_value(packages, name)) == NULL) {
+			pkg = oscap_calloc(1, sizeof(struct oval_package_tests));
+			oval_string_map_put(packages, name, pkg);
+			++npackages;
+		}
+		pkg->tests = oscap_realloc(pkg->tests, (pkg->count + 1) * sizeof(struct oval_result_test *));
+		pkg->tests[pkg->count++] = rtest;
+		++count;
+	}
+	oval_smc_iterator_free(result_tests);
+	oval_smc_free0(tstmap);
+
+	/* the tests of a package follow each other, so they share the compared values */
+	if (count > 0) {
+		struct oval_iterator *pkg_itr = oval_string_map_values(packages);
+		size_t n = 0;
+
+		tests = oscap_alloc(count * sizeof(struct oval_result_test *));
+		while (oval_collection_iterator_has_more(pkg_itr)) {
+			struct oval_package_tests *pkg = oval_collection_iterator_next(pkg_itr);
+
+			memcpy(tests + n, pkg->tests, pkg->count * sizeof(struct oval_result_test *));
+			n += pkg->count;
+		}
+		oval_collection_iterator_free(pkg_itr);
+
+		dI("Evaluating %zu package tests of %zu packages in one pass.", count, npackages);
+		oval_result_test_eval_packages(tests, count);
+		oscap_free(tests);
+	}
+
+	oval_string_map_free(packages, (oscap_destruct_func) _oval_package_tests_free);
+}
+
 int oval_result_system_eval(struct oval_result_system *sys)
 {
 	struct oval_results_model *res_model;
 	struct oval_definition_model *definition_model;
 	struct oval_definition_iterator *definitions_itr;
+	unsigned int jobs;
 
 	res_model = oval_result_system_get_results_model(sys);
 	definition_model = oval_results_model_get_definition_model(res_model);
+	oval_definition_model_load_all(definition_model);
+
+	oval_result_system_eval_packages(sys);
+
+	/* the system characteristics are only read if they were imported */
+	jobs = oval_results_model_get_jobs(res_model);
+	if (jobs > 1 && oval_results_model_get_probe_session(res_model) == NULL)
+		_oval_result_system_eval_tests(sys, definition_model, jobs);
+
 	definitions_itr = oval_definition_model_get_definitions(definition_model);
 
 	while (oval_definition_iterator_has_more(definitions_itr)) {
@@ -413,7 +973,7 @@ static void _oval_result_definition_to_dom_based_on_directives(struct oval_resul
 xmlNode *oval_result_system_to_dom(struct oval_result_system * sys,
 				   struct oval_results_model * results_model,
 				   struct oval_directives_model * directives_model, 
-				   xmlDocPtr doc, xmlNode * parent) {
+				   xmlDocPtr doc, xmlNode * parent, struct xml_stream *stream) {
 
 	struct oval_result_directives * directives;
 	struct oval_result_directives * class_dirs;
@@ -440,6 +1000,7 @@ xmlNode *oval_result_system_to_dom(struct oval_result_system * sys,
 			while (oval_collection_iterator_has_more(rslt_definitions_it)) {
 				struct oval_result_definition *rslt_definition = oval_collection_iterator_next(rslt_definitions_it);
 				_oval_result_definition_to_dom_based_on_directives(rslt_definition, directives, doc, definitions_node, tstmap);
+				xml_stream_flush(stream, definitions_node);
 				exported = true;
 			}
 			oval_collection_iterator_free(rslt_definitions_it);
@@ -448,10 +1009,12 @@ xmlNode *oval_result_system_to_dom(struct oval_result_system * sys,
 			struct oval_result_definition *rslt_definition = oval_result_system_get_new_definition(sys, oval_definition, 1);
 			if (rslt_definition) {
 				_oval_result_definition_to_dom_based_on_directives(rslt_definition, directives, doc, definitions_node, tstmap);
+				xml_stream_flush(stream, definitions_node);
 			}
 		}
 	}
 	oval_definition_iterator_free(oval_definitions);
+	xml_stream_end(stream, definitions_node);
 
 	struct oval_syschar_model *syschar_model = oval_result_system_get_syschar_model(sys);
 	struct oval_string_map *sysmap = oval_string_map_new();
@@ -467,6 +1030,7 @@ xmlNode *oval_result_system_to_dom(struct oval_result_system * sys,
 			struct oval_result_test *result_test = oval_smc_iterator_next(result_tests);
 			/* report the test */
 			oval_result_test_to_dom(result_test, doc, tests_node);
+			xml_stream_flush(stream, tests_node);
 			struct oval_test *oval_test = oval_result_test_get_test(result_test);
 			/* collect the objects that are referenced from reported test */
 			/* look for objects in path: test->object ...  */
@@ -501,12 +1065,14 @@ xmlNode *oval_result_system_to_dom(struct oval_result_system * sys,
 			}
 			oval_state_iterator_free(ste_itr);
 		}
+		xml_stream_end(stream, tests_node);
 	}
 	oval_smc_iterator_free(result_tests);
 
 	bool export_sys_char = oval_results_model_get_export_system_characteristics(results_model);
 	oval_syschar_model_to_dom(syschar_model, doc, system_node, 
-				  (oval_syschar_resolver *) _oval_result_system_resolve_syschar, sysmap, export_sys_char);
+				  (oval_syschar_resolver *) _oval_result_system_resolve_syschar, sysmap, export_sys_char, stream);
+	xml_stream_end(stream, system_node);
 
 	oval_string_map_free(sysmap, NULL);
 	oval_string_map_free(objmap, NULL);
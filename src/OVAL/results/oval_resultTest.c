@@ -46,6 +46,7 @@
 #include "public/oval_types.h"
 #include "common/util.h"
 #include "common/debug_priv.h"
+#include "common/oscap_trace.h"
 #include "common/_error.h"
 
 typedef struct oval_result_test {
@@ -379,55 +380,188 @@ oval_result_t ores_get_result_byopr(struct oresults *ores, oval_operator_t op)
 	return result;
 }
 
-static inline oval_result_t _evaluate_sysent_with_variable(struct oval_syschar_model *syschar_model, struct oval_entity *state_entity, struct oval_sysent *item_entity, oval_operation_t state_entity_operation, struct oval_state_content *content)
+#define OVAL_ENTITY_MEMO 64
+
+/* An entity of a state prepared for the comparison with the entities of many items */
+struct oval_entity_matcher {
+	struct oval_entity *entity;
+	struct oval_state_content *content;
+	const char *name;
+	oval_operation_t operation;
+	oval_check_t check;
+	oval_existence_t check_existence;
+	bool mask;
+	struct oval_variable *variable;		///< var_ref of the entity, if any
+	bool prepared;				///< the values below were prepared
+	bool failed;				///< the values can't be prepared
+	const char *error;			///< why, if it is to be reported
+	oval_syschar_collection_flag_t flag;	///< collection flag of the variable
+	struct oval_cmp_value **values;		///< value of the entity or values of the variable
+	int values_count;
+	bool null_value;			///< the variable has a value without text after them
+	char **sorted;				///< texts of the values in strcmp order, if they are compared as strings
+	struct {
+		const char *value;		///< interned value of an item entity
+		oval_result_t result;
+	} memo[OVAL_ENTITY_MEMO];		///< results of the distinct values of the column, see _evaluate_sysent
+};
+
+/* A state prepared for the comparison with many items, see eval_check_state */
+struct oval_state_matcher {
+	struct oval_state *state;
+	struct oval_entity_matcher *entities;
+	int count;
+	oval_operator_t operator;
+	const char *error;			///< the state is incomplete
+	bool refers_variables;
+};
+
+static int _oval_cmp_strings(const void *a, const void *b)
 {
-	oval_syschar_collection_flag_t flag;
-	oval_result_t ent_val_res;
+	return strcmp(*(char * const *) a, *(char * const *) b);
+}
 
-	struct oval_variable *state_entity_var;
-	if ((state_entity_var = oval_entity_get_variable(state_entity)) == NULL) {
-		oscap_seterr(OSCAP_EFAMILY_OVAL, "OVAL internal error: found NULL variable");
-		return -1;
+/* number of the sorted strings which are equal to the given one */
+static int _oval_sorted_count(char **sorted, int count, const char *str)
+{
+	int lo = 0, hi = count;
+
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (strcmp(sorted[mid], str) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	int first = lo;
+	hi = count;
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (strcmp(sorted[mid], str) <= 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo - first;
+}
+
+static int _oval_entity_matcher_prepare(struct oval_syschar_model *syschar_model, struct oval_entity_matcher *em)
+{
+	if (em->prepared)
+		return em->failed ? -1 : 0;
+	em->prepared = true;
+	em->failed = true;
+
+	if (em->variable == NULL) {
+		struct oval_value *state_entity_val;
+		char *state_entity_val_text;
+
+		if ((state_entity_val = oval_entity_get_value(em->entity)) == NULL) {
+			em->error = "OVAL internal error: found NULL entity value";
+			return -1;
+		}
+		if ((state_entity_val_text = oval_value_get_text(state_entity_val)) == NULL) {
+			em->error = "OVAL internal error: found NULL entity value text";
+			return -1;
+		}
+		em->values = oscap_alloc(sizeof(struct oval_cmp_value *));
+		em->values[0] = oval_cmp_value_new(state_entity_val_text,
+				oval_value_get_datatype(state_entity_val), em->operation);
+		em->values_count = 1;
+		em->failed = false;
+		return 0;
 	}
 
-	if (0 != oval_syschar_model_compute_variable(syschar_model, state_entity_var)) {
+	if (0 != oval_syschar_model_compute_variable(syschar_model, em->variable))
 		return -1;
+
+	em->flag = oval_variable_get_collection_flag(em->variable);
+	if (em->flag == SYSCHAR_FLAG_COMPLETE || em->flag == SYSCHAR_FLAG_INCOMPLETE) {
+		struct oval_value_iterator *val_itr;
+		bool strings = em->operation == OVAL_OPERATION_EQUALS;
+		int alloc = 0;
+		const char *const *texts;
+		oval_datatype_t texts_datatype;
+		int texts_count = oval_variable_get_value_texts(em->variable, &texts, &texts_datatype);
+
+		if (texts_count >= 0) {
+			/* the values of an external variable come straight from the variable model */
+			if (texts_count > 0)
+				em->values = oscap_alloc(texts_count * sizeof(struct oval_cmp_value *));
+			for (int i = 0; i < texts_count; ++i) {
+				if (texts[i] == NULL) {
+					em->null_value = true;
+					break;
+				}
+				em->values[em->values_count++] = oval_cmp_value_new(texts[i], texts_datatype, em->operation);
+			}
+			if (texts_datatype != OVAL_DATATYPE_STRING)
+				strings = false;
+		} else {
+			val_itr = oval_variable_get_values(em->variable);
+			while (oval_value_iterator_has_more(val_itr)) {
+				struct oval_value *var_val = oval_value_iterator_next(val_itr);
+				char *state_entity_val_text = oval_value_get_text(var_val);
+				oval_datatype_t datatype = oval_value_get_datatype(var_val);
+
+				if (state_entity_val_text == NULL) {
+					em->null_value = true;
+					break;
+				}
+				if (em->values_count == alloc) {
+					alloc = alloc ? 2 * alloc : 8;
+					em->values = oscap_realloc(em->values, alloc * sizeof(struct oval_cmp_value *));
+				}
+				em->values[em->values_count++] = oval_cmp_value_new(state_entity_val_text, datatype, em->operation);
+				if (datatype != OVAL_DATATYPE_STRING)
+					strings = false;
+			}
+			oval_value_iterator_free(val_itr);
+		}
+
+		/* equality of many strings is a lookup */
+		if (strings && em->values_count > 1) {
+			em->sorted = oscap_alloc(em->values_count * sizeof(char *));
+			for (int i = 0; i < em->values_count; ++i)
+				em->sorted[i] = (char *) oval_cmp_value_get_text(em->values[i]);
+			qsort(em->sorted, em->values_count, sizeof(char *), _oval_cmp_strings);
+		}
 	}
+	em->failed = false;
+	return 0;
+}
 
-	flag = oval_variable_get_collection_flag(state_entity_var);
-	switch (flag) {
+static oval_result_t _evaluate_sysent_with_variable(struct oval_entity_matcher *em, struct oval_sysent *item_entity)
+{
+	oval_result_t ent_val_res;
+
+	switch (em->flag) {
 	case SYSCHAR_FLAG_COMPLETE:
 	case SYSCHAR_FLAG_INCOMPLETE:{
 		struct oresults var_ores;
-		struct oval_value_iterator *val_itr;
+		const char *sys_data = oval_sysent_get_value(item_entity);
 
 		ores_clear(&var_ores);
 
-		val_itr = oval_variable_get_values(state_entity_var);
-		while (oval_value_iterator_has_more(val_itr)) {
-			struct oval_value *var_val;
-			char *state_entity_val_text = NULL;
+		if (em->sorted != NULL) {
+			var_ores.true_cnt = _oval_sorted_count(em->sorted, em->values_count, sys_data ? sys_data : "");
+			var_ores.false_cnt = em->values_count - var_ores.true_cnt;
+		} else for (int i = 0; i < em->values_count; ++i) {
 			oval_result_t var_val_res;
 
-			var_val = oval_value_iterator_next(val_itr);
-			state_entity_val_text = oval_value_get_text(var_val);
-			if (state_entity_val_text == NULL) {
-				dE("Found NULL variable value text.");
-				ores_add_res(&var_ores, OVAL_RESULT_ERROR);
-				break;
-			}
-			oval_datatype_t state_entity_val_datatype = oval_value_get_datatype(var_val);
-
-			var_val_res = oval_ent_cmp_str(state_entity_val_text, state_entity_val_datatype, item_entity, state_entity_operation);
+			var_val_res = oval_cmp_value_cmp_ent(em->values[i], item_entity);
 			if (var_val_res == OVAL_RESULT_ERROR) {
 				dE("Error occured when comparing a variable '%s' value '%s' with collected item entity = '%s'",
-					oval_variable_get_id(state_entity_var), state_entity_val_text, oval_sysent_get_value(item_entity));
+					oval_variable_get_id(em->variable), oval_cmp_value_get_text(em->values[i]), sys_data);
 			}
 			ores_add_res(&var_ores, var_val_res);
 		}
-		oval_value_iterator_free(val_itr);
+		if (em->null_value) {
+			dE("Found NULL variable value text.");
+			ores_add_res(&var_ores, OVAL_RESULT_ERROR);
+		}
 
-		oval_check_t var_check = oval_state_content_get_var_check(content);
+		oval_check_t var_check = oval_state_content_get_var_check(em->content);
 		ent_val_res = ores_get_result_bychk(&var_ores, var_check);
 		} break;
 	case SYSCHAR_FLAG_ERROR:
@@ -443,68 +577,76 @@ static inline oval_result_t _evaluate_sysent_with_variable(struct oval_syschar_m
 	return ent_val_res;
 }
 
-static inline oval_result_t _evaluate_sysent(struct oval_syschar_model *syschar_model, struct oval_sysent *item_entity, struct oval_entity *state_entity, oval_operation_t state_entity_operation, struct oval_state_content *content)
+/*
+ * The entities of one name of all the items of a test are a column of
+ * values, mostly interned by the model: the permissions, owners, types or
+ * versions of files and packages take few distinct values. The result of
+ * comparing the entity of the state with an interned value depends only on
+ * the value, so it is remembered by the pointer and every distinct value
+ * of the column is compared once. Errors are not remembered, so they are
+ * reported for every item as before.
+ */
+static inline oval_result_t _evaluate_sysent(struct oval_syschar_model *syschar_model, struct oval_sysent *item_entity, struct oval_entity_matcher *em)
 {
-	if (oval_sysent_get_status(item_entity) == SYSCHAR_STATUS_DOES_NOT_EXIST) {
+	const char *value = NULL;
+	oval_result_t result;
+	size_t slot = 0;
+
+	if (oval_sysent_get_status(item_entity) == SYSCHAR_STATUS_DOES_NOT_EXIST)
 		return OVAL_RESULT_FALSE;
-	} else if (oval_entity_get_varref_type(state_entity) == OVAL_ENTITY_VARREF_ATTRIBUTE) {
 
-		return _evaluate_sysent_with_variable(syschar_model,
-				state_entity, item_entity,
-				state_entity_operation, content);
-	} else {
-		struct oval_value *state_entity_val;
-		char *state_entity_val_text;
-		oval_datatype_t state_entity_val_datatype;
+	if (_oval_entity_matcher_prepare(syschar_model, em) != 0) {
+		if (em->error != NULL)
+			oscap_seterr(OSCAP_EFAMILY_OVAL, "%s", em->error);
+		return -1;
+	}
 
-		if ((state_entity_val = oval_entity_get_value(state_entity)) == NULL) {
-			oscap_seterr(OSCAP_EFAMILY_OVAL, "OVAL internal error: found NULL entity value");
-			return -1;
-		}
-		if ((state_entity_val_text = oval_value_get_text(state_entity_val)) == NULL) {
-			oscap_seterr(OSCAP_EFAMILY_OVAL, "OVAL internal error: found NULL entity value text");
-			return -1;
-		}
-		state_entity_val_datatype = oval_value_get_datatype(state_entity_val);
+	if (oval_sysent_has_shared_value(item_entity)) {
+		value = oval_sysent_get_value(item_entity);
+		slot = ((uintptr_t) value >> 3) % OVAL_ENTITY_MEMO;
+		if (value != NULL && em->memo[slot].value == value)
+			return em->memo[slot].result;
+	}
 
-		return oval_ent_cmp_str(state_entity_val_text, state_entity_val_datatype, item_entity, state_entity_operation);
+	if (em->variable != NULL)
+		result = _evaluate_sysent_with_variable(em, item_entity);
+	else
+		result = oval_cmp_value_cmp_ent(em->values[0], item_entity);
+
+	if (value != NULL && (result == OVAL_RESULT_TRUE || result == OVAL_RESULT_FALSE)) {
+		em->memo[slot].value = value;
+		em->memo[slot].result = result;
 	}
+	return result;
 }
 
-static oval_result_t eval_item(struct oval_syschar_model *syschar_model, struct oval_sysitem *cur_sysitem, struct oval_state *state)
+/* The values of the state are prepared when they are compared for the first time. */
+static struct oval_state_matcher *_oval_state_matcher_new(struct oval_state *state)
 {
+	struct oval_state_matcher *matcher = oscap_calloc(1, sizeof(struct oval_state_matcher));
 	struct oval_state_content_iterator *state_contents_itr;
-	struct oresults ste_ores;
-	oval_operator_t operator;
-	oval_result_t result = OVAL_RESULT_ERROR;
+	int alloc = 0;
 
-	ores_clear(&ste_ores);
+	matcher->state = state;
+	matcher->operator = oval_state_get_operator(state);
 
 	state_contents_itr = oval_state_get_contents(state);
 	while (oval_state_content_iterator_has_more(state_contents_itr)) {
 		struct oval_state_content *content;
 		struct oval_entity *state_entity;
 		char *state_entity_name;
-		oval_operation_t state_entity_operation;
-		oval_check_t entity_check;
-		oval_existence_t check_existence;
-		oval_result_t ste_ent_res;
-		struct oval_sysent_iterator *item_entities_itr;
-		struct oresults ent_ores;
-		struct oval_status_counter counter;
-		bool found_matching_item;
 
 		if ((content = oval_state_content_iterator_next(state_contents_itr)) == NULL) {
-			oscap_seterr(OSCAP_EFAMILY_OVAL, "OVAL internal error: found NULL state content");
-			goto fail;
+			matcher->error = "OVAL internal error: found NULL state content";
+			break;
 		}
 		if ((state_entity = oval_state_content_get_entity(content)) == NULL) {
-			oscap_seterr(OSCAP_EFAMILY_OVAL, "OVAL internal error: found NULL entity");
-			goto fail;
+			matcher->error = "OVAL internal error: found NULL entity";
+			break;
 		}
 		if ((state_entity_name = oval_entity_get_name(state_entity)) == NULL) {
-			oscap_seterr(OSCAP_EFAMILY_OVAL, "OVAL internal error: found NULL entity name");
-			goto fail;
+			matcher->error = "OVAL internal error: found NULL entity name";
+			break;
 		}
 
 		if (oscap_streq(state_entity_name, "line") &&
@@ -522,9 +664,67 @@ static oval_result_t eval_item(struct oval_syschar_model *syschar_model, struct
 			}
 		}
 
-		entity_check = oval_state_content_get_ent_check(content);
-		check_existence = oval_state_content_get_check_existence(content);
-		state_entity_operation = oval_entity_get_operation(state_entity);
+		if (matcher->count == alloc) {
+			alloc = alloc ? 2 * alloc : 8;
+			matcher->entities = oscap_realloc(matcher->entities, alloc * sizeof(struct oval_entity_matcher));
+		}
+		struct oval_entity_matcher *em = &matcher->entities[matcher->count++];
+		memset(em, 0, sizeof(*em));
+		em->entity = state_entity;
+		em->content = content;
+		em->name = state_entity_name;
+		em->operation = oval_entity_get_operation(state_entity);
+		em->check = oval_state_content_get_ent_check(content);
+		em->check_existence = oval_state_content_get_check_existence(content);
+		em->mask = oval_entity_get_mask(state_entity);
+		if (oval_entity_get_varref_type(state_entity) == OVAL_ENTITY_VARREF_ATTRIBUTE) {
+			/* the result depends on the values of the variable at the time */
+			matcher->refers_variables = true;
+			em->variable = oval_entity_get_variable(state_entity);
+			if (em->variable == NULL) {
+				em->prepared = em->failed = true;
+				em->error = "OVAL internal error: found NULL variable";
+			}
+		}
+	}
+	oval_state_content_iterator_free(state_contents_itr);
+
+	return matcher;
+}
+
+static void _oval_state_matcher_free(struct oval_state_matcher *matcher)
+{
+	for (int i = 0; i < matcher->count; ++i) {
+		struct oval_entity_matcher *em = &matcher->entities[i];
+		for (int j = 0; j < em->values_count; ++j)
+			oval_cmp_value_free(em->values[j]);
+		oscap_free(em->values);
+		oscap_free(em->sorted);
+	}
+	oscap_free(matcher->entities);
+	oscap_free(matcher);
+}
+
+static oval_result_t eval_item(struct oval_syschar_model *syschar_model, struct oval_sysitem *cur_sysitem, struct oval_state_matcher *matcher)
+{
+	struct oval_state *state = matcher->state;
+	struct oresults ste_ores;
+	oval_result_t result = OVAL_RESULT_ERROR;
+
+	if (matcher->error != NULL) {
+		oscap_seterr(OSCAP_EFAMILY_OVAL, "%s", matcher->error);
+		return OVAL_RESULT_ERROR;
+	}
+
+	ores_clear(&ste_ores);
+
+	for (int i = 0; i < matcher->count; ++i) {
+		struct oval_entity_matcher *em = &matcher->entities[i];
+		oval_result_t ste_ent_res;
+		struct oval_sysent_iterator *item_entities_itr;
+		struct oresults ent_ores;
+		struct oval_status_counter counter;
+		bool found_matching_item;
 
 		ores_clear(&ent_ores);
 		found_matching_item = false;
@@ -541,23 +741,22 @@ static oval_result_t eval_item(struct oval_syschar_model *syschar_model, struct
 			if (item_entity == NULL) {
 				oscap_seterr(OSCAP_EFAMILY_OVAL, "OVAL internal error: found NULL sysent");
 				oval_sysent_iterator_free(item_entities_itr);
-				goto fail;
+				return OVAL_RESULT_ERROR;
 			}
 			item_status = oval_sysent_get_status(item_entity);
 			oval_status_counter_add_status(&counter, item_status);
 
 			item_entity_name = oval_sysent_get_name(item_entity);
-			if (strcmp(item_entity_name, state_entity_name))
+			if (strcmp(item_entity_name, em->name))
 				continue;
 
 			found_matching_item = true;
 
 			/* copy mask attribute from state to item */
-			if (oval_entity_get_mask(state_entity))
+			if (em->mask && !oval_sysent_get_mask(item_entity))
 				oval_sysent_set_mask(item_entity,1);
 
-			ent_val_res = _evaluate_sysent(syschar_model, item_entity, state_entity,
-					state_entity_operation, content);
+			ent_val_res = _evaluate_sysent(syschar_model, item_entity, em);
 			if (ent_val_res == OVAL_RESULT_TRUE) {
 				dI("Entity '%s'='%s' of item '%s' matches corresponding entity in state '%s'.",
 						oval_sysent_get_name(item_entity),
@@ -566,7 +765,7 @@ static oval_result_t eval_item(struct oval_syschar_model *syschar_model, struct
 			}
 			if (((signed) ent_val_res) == -1) {
 				oval_sysent_iterator_free(item_entities_itr);
-				goto fail;
+				return OVAL_RESULT_ERROR;
 			}
 
 			ores_add_res(&ent_ores, ent_val_res);
@@ -575,29 +774,23 @@ static oval_result_t eval_item(struct oval_syschar_model *syschar_model, struct
 
 		if (!found_matching_item)
 			dW("Entity name '%s' from state (id: '%s') not found in item (id: '%s').",
-			   state_entity_name, oval_state_get_id(state), oval_sysitem_get_id(cur_sysitem));
+			   em->name, oval_state_get_id(state), oval_sysitem_get_id(cur_sysitem));
 
-		ste_ent_res = ores_get_result_bychk(&ent_ores, entity_check);
+		ste_ent_res = ores_get_result_bychk(&ent_ores, em->check);
 		ores_add_res(&ste_ores, ste_ent_res);
-		oval_result_t cres = oval_status_counter_get_result(&counter, check_existence);
+		oval_result_t cres = oval_status_counter_get_result(&counter, em->check_existence);
 		ores_add_res(&ste_ores, cres);
 	}
-	oval_state_content_iterator_free(state_contents_itr);
 
-	operator = oval_state_get_operator(state);
-	result = ores_get_result_byopr(&ste_ores, operator);
+	result = ores_get_result_byopr(&ste_ores, matcher->operator);
 	dI("Item '%s' compared to state '%s' with result %s.",
 			   oval_sysitem_get_id(cur_sysitem), oval_state_get_id(state),
 			   oval_result_get_text(result));
 
 	return result;
-
- fail:
-	oval_state_content_iterator_free(state_contents_itr);
-
-	return OVAL_RESULT_ERROR;
 }
 
+#define MATCHERS (struct oval_string_map   *)args[3]
 #define ITEMMAP (struct oval_string_map    *)args[2]
 #define TEST    (struct oval_result_test   *)args[1]
 #define SYSTEM  (struct oval_result_system *)args[0]
@@ -628,6 +821,11 @@ static oval_result_t eval_check_state(struct oval_test *test, void **args)
 	syschar_model = oval_result_system_get_syschar_model(SYSTEM);
 	ores_clear(&item_ores);
 
+	/* The items of imported system characteristics don't change, so the
+	 * result of comparing them with a state can be shared by the tests. */
+	struct oval_results_model *results_model = oval_result_system_get_results_model(SYSTEM);
+	bool memoize = oval_results_model_get_probe_session(results_model) == NULL;
+
 	char *state_names = oval_test_get_state_names(test);
 	if (state_names) {
 		dI("In test '%s' %s of the collected items must satisfy these states: %s.",
@@ -635,13 +833,32 @@ static oval_result_t eval_check_state(struct oval_test *test, void **args)
 		oscap_free(state_names);
 	}
 
+	/* the states are prepared once for all the items, or for all the package tests */
+	struct oval_string_map *shared = MATCHERS;
+	struct oval_state_matcher **matchers = NULL;
+	int matchers_count = 0;
+	struct oval_state_iterator *ste_itr = oval_test_get_states(test);
+	while (oval_state_iterator_has_more(ste_itr)) {
+		struct oval_state *ste = oval_state_iterator_next(ste_itr);
+		struct oval_state_matcher *matcher = shared != NULL ?
+			oval_string_map_get_value(shared, oval_state_get_id(ste)) : NULL;
+
+		if (matcher == NULL) {
+			matcher = _oval_state_matcher_new(ste);
+			if (shared != NULL)
+				oval_string_map_put(shared, oval_state_get_id(ste), matcher);
+		}
+		matchers = oscap_realloc(matchers, (matchers_count + 1) * sizeof(struct oval_state_matcher *));
+		matchers[matchers_count++] = matcher;
+	}
+	oval_state_iterator_free(ste_itr);
+
 	ritems_itr = oval_result_test_get_items(TEST);
 	while (oval_result_item_iterator_has_more(ritems_itr)) {
 		struct oval_result_item *ritem;
 		struct oval_sysitem *item;
 		oval_syschar_status_t item_status;
 		struct oresults ste_ores;
-		struct oval_state_iterator *ste_itr;
 		oval_result_t item_res;
 
 		ritem = oval_result_item_iterator_next(ritems_itr);
@@ -666,22 +883,33 @@ static oval_result_t eval_check_state(struct oval_test *test, void **args)
 
 		ores_clear(&ste_ores);
 
-		ste_itr = oval_test_get_states(test);
-		while (oval_state_iterator_has_more(ste_itr)) {
-			struct oval_state *ste;
+		for (int i = 0; i < matchers_count; ++i) {
+			struct oval_state *ste = matchers[i]->state;
 			oval_result_t ste_res;
 
-			ste = oval_state_iterator_next(ste_itr);
-			ste_res = eval_item(syschar_model, item, ste);
+			if (memoize && !matchers[i]->refers_variables) {
+				if (!oval_result_system_get_item_result(SYSTEM, ste, item, &ste_res)) {
+					ste_res = eval_item(syschar_model, item, matchers[i]);
+					oval_result_system_set_item_result(SYSTEM, ste, item, ste_res);
+				} else {
+					dI("Item '%s' compared to state '%s' with result %s (cached).",
+					   oval_sysitem_get_id(item), oval_state_get_id(ste),
+					   oval_result_get_text(ste_res));
+				}
+			} else {
+				ste_res = eval_item(syschar_model, item, matchers[i]);
+			}
 			ores_add_res(&ste_ores, ste_res);
 		}
-		oval_state_iterator_free(ste_itr);
 
 		item_res = ores_get_result_byopr(&ste_ores, ste_opr);
 		ores_add_res(&item_ores, item_res);
 		oval_result_item_set_result(ritem, item_res);
 	}
 	oval_result_item_iterator_free(ritems_itr);
+	for (int i = 0; shared == NULL && i < matchers_count; ++i)
+		_oval_state_matcher_free(matchers[i]);
+	oscap_free(matchers);
 
 	result = ores_get_result_bychk(&item_ores, ste_check);
 
@@ -981,12 +1209,18 @@ static void _oval_result_test_initialize_bindings(struct oval_result_test *rslt_
 		struct oval_variable *var;
 		struct oval_value_iterator *val_itr;
 		struct oval_variable_binding *binding;
+		const char *const *texts;
+		int count;
 
 		var = oval_collection_iterator_next(var_itr);
 		binding = oval_variable_binding_new(var, NULL);
 
-		val_itr = oval_variable_get_values(var);
-		while (oval_value_iterator_has_more(val_itr)) {
+		count = oval_variable_get_value_texts(var, &texts, NULL);
+		for (int i = 0; i < count; ++i)
+			oval_variable_binding_add_value(binding, oscap_strdup(texts[i]));
+
+		val_itr = (count < 0) ? oval_variable_get_values(var) : NULL;
+		while (val_itr != NULL && oval_value_iterator_has_more(val_itr)) {
 			struct oval_value *val;
 			char *txt;
 
@@ -995,7 +1229,8 @@ static void _oval_result_test_initialize_bindings(struct oval_result_test *rslt_
 			txt = oscap_strdup(txt);
 			oval_variable_binding_add_value(binding, txt);
 		}
-		oval_value_iterator_free(val_itr);
+		if (val_itr != NULL)
+			oval_value_iterator_free(val_itr);
 		oval_result_test_add_binding(rslt_test, binding);
 	}
 	oval_collection_iterator_free(var_itr);
@@ -1037,7 +1272,7 @@ static void _oval_result_test_initialize_bindings(struct oval_result_test *rslt_
 	rslt_test->bindings_initialized = true;
 }
 
-oval_result_t oval_result_test_eval(struct oval_result_test *rtest)
+static oval_result_t _oval_result_test_eval(struct oval_result_test *rtest, struct oval_string_map *matchers)
 {
 	__attribute__nonnull__(rtest);
 
@@ -1048,9 +1283,12 @@ oval_result_t oval_result_test_eval(struct oval_result_test *rtest)
 	dI("Evaluating %s test '%s': %s.", type, test_id, comment);
 
 	if (rtest->result == OVAL_RESULT_NOT_EVALUATED) {
+		struct oscap_trace_span span;
+
+		oscap_trace_begin(&span, "oval_result_test_eval");
 		if ((oval_independent_subtype_t)oval_test_get_subtype(oval_result_test_get_test(rtest)) != OVAL_INDEPENDENT_UNKNOWN ) {
 			struct oval_string_map *tmp_map = oval_string_map_new();
-			void *args[] = { rtest->system, rtest, tmp_map };
+			void *args[] = { rtest->system, rtest, tmp_map, matchers };
 			dIndent(1);
 			rtest->result = _oval_result_test_result(rtest, args);
 			dIndent(-1);
@@ -1059,9 +1297,11 @@ oval_result_t oval_result_test_eval(struct oval_result_test *rtest)
 			if (!rtest->bindings_initialized) {
 				_oval_result_test_initialize_bindings(rtest);
 			}
+			oval_result_system_test_evaluated(rtest->system, test);
 		}
 		else
 			rtest->result = OVAL_RESULT_UNKNOWN;
+		oscap_trace_end(&span, test_id);
 	}
 
 	dI("Test '%s' evaluated as %s.", test_id, oval_result_get_text(rtest->result));
@@ -1069,6 +1309,107 @@ oval_result_t oval_result_test_eval(struct oval_result_test *rtest)
 	return rtest->result;
 }
 
+oval_result_t oval_result_test_eval(struct oval_result_test *rtest)
+{
+	return _oval_result_test_eval(rtest, NULL);
+}
+
+void oval_result_test_copy_masks(struct oval_result_test *rtest, struct oval_syschar *syschar)
+{
+	struct oval_state_iterator *ste_itr = oval_test_get_states(oval_result_test_get_test(rtest));
+
+	while (oval_state_iterator_has_more(ste_itr)) {
+		struct oval_state_matcher *matcher = _oval_state_matcher_new(oval_state_iterator_next(ste_itr));
+		struct oval_sysitem_iterator *items_itr = oval_syschar_get_sysitem(syschar);
+
+		while (oval_sysitem_iterator_has_more(items_itr)) {
+			struct oval_sysitem *item = oval_sysitem_iterator_next(items_itr);
+
+			for (int i = 0; i < matcher->count; ++i) {
+				struct oval_entity_matcher *em = &matcher->entities[i];
+				struct oval_sysent_iterator *item_entities_itr;
+
+				if (!em->mask)
+					continue;
+				item_entities_itr = oval_sysitem_get_sysents(item);
+				while (oval_sysent_iterator_has_more(item_entities_itr)) {
+					struct oval_sysent *item_entity = oval_sysent_iterator_next(item_entities_itr);
+
+					if (item_entity != NULL && !strcmp(oval_sysent_get_name(item_entity), em->name))
+						oval_sysent_set_mask(item_entity, 1);
+				}
+				oval_sysent_iterator_free(item_entities_itr);
+			}
+		}
+		oval_sysitem_iterator_free(items_itr);
+		_oval_state_matcher_free(matcher);
+	}
+	oval_state_iterator_free(ste_itr);
+}
+
+const char *oval_result_test_get_package_name(struct oval_result_test *rtest)
+{
+	struct oval_test *test = oval_result_test_get_test(rtest);
+	oval_subtype_t subtype = oval_test_get_subtype(test);
+	struct oval_object *object = oval_test_get_object(test);
+	struct oval_object_content_iterator *cont_itr;
+	struct oval_behavior_iterator *bh_itr;
+	struct oval_state_iterator *ste_itr;
+	struct oval_string_map *vm;
+	const char *name = NULL;
+	int count = 0;
+	bool literal;
+
+	if (subtype != (oval_subtype_t) OVAL_LINUX_RPM_INFO && subtype != (oval_subtype_t) OVAL_LINUX_DPKG_INFO)
+		return NULL;
+	if (object == NULL || oval_object_get_subtype(object) != subtype
+	    || oval_test_get_existence(test) != OVAL_AT_LEAST_ONE_EXISTS)
+		return NULL;
+
+	/* the object is a single <name> equal to a literal */
+	cont_itr = oval_object_get_object_contents(object);
+	while (oval_object_content_iterator_has_more(cont_itr)) {
+		struct oval_object_content *cont = oval_object_content_iterator_next(cont_itr);
+		struct oval_entity *entity = oval_object_content_get_type(cont) == OVAL_OBJECTCONTENT_ENTITY ?
+			oval_object_content_get_entity(cont) : NULL;
+		struct oval_value *value = entity != NULL ? oval_entity_get_value(entity) : NULL;
+
+		if (++count == 1 && value != NULL && oscap_streq(oval_entity_get_name(entity), "name")
+		    && oval_entity_get_operation(entity) == OVAL_OPERATION_EQUALS
+		    && oval_entity_get_varref_type(entity) == OVAL_ENTITY_VARREF_NONE)
+			name = oval_value_get_text(value);
+	}
+	oval_object_content_iterator_free(cont_itr);
+
+	if (count != 1 || name == NULL)
+		return NULL;
+
+	bh_itr = oval_object_get_behaviors(object);
+	literal = !oval_behavior_iterator_has_more(bh_itr);
+	oval_behavior_iterator_free(bh_itr);
+
+	/* and the states compare the items with literals */
+	vm = oval_string_map_new();
+	ste_itr = oval_test_get_states(test);
+	while (oval_state_iterator_has_more(ste_itr))
+		oval_ste_collect_var_refs(oval_state_iterator_next(ste_itr), vm);
+	oval_state_iterator_free(ste_itr);
+	literal = literal && oval_string_map_is_empty(vm);
+	oval_string_map_free(vm, NULL);
+
+	return literal ? name : NULL;
+}
+
+void oval_result_test_eval_packages(struct oval_result_test **tests, size_t count)
+{
+	struct oval_string_map *matchers = oval_string_map_new();
+
+	for (size_t i = 0; i < count; ++i)
+		_oval_result_test_eval(tests[i], matchers);
+
+	oval_string_map_free(matchers, (oscap_destruct_func) _oval_state_matcher_free);
+}
+
 oval_result_t oval_result_test_get_result(struct oval_result_test * rtest)
 {
 	__attribute__nonnull__(rtest);
@@ -38,12 +38,13 @@
 #include "OVAL/adt/oval_smc_impl.h"
 
 #include "common/util.h"
+#include "common/xml_stream.h"
 #include "source/oscap_source_priv.h"
 
 OSCAP_HIDDEN_START;
 
 int oval_result_system_parse_tag(xmlTextReaderPtr, struct oval_parser_context *, void *);
-xmlNode *oval_result_system_to_dom(struct oval_result_system *, struct oval_results_model *, struct oval_directives_model *, xmlDocPtr, xmlNode *);
+xmlNode *oval_result_system_to_dom(struct oval_result_system *, struct oval_results_model *, struct oval_directives_model *, xmlDocPtr, xmlNode *, struct xml_stream *);
 
 struct oval_result_test *oval_result_system_get_new_test(struct oval_result_system *, struct oval_test *, int variable_instance);
 
@@ -76,6 +77,10 @@ struct oval_result_definition *oval_result_system_get_new_definition(struct oval
 								     struct oval_definition *,
 								     int variable_instance);
 struct oval_result_test *oval_result_system_get_test(struct oval_result_system *, char *);
+bool oval_result_system_get_item_result(struct oval_result_system *sys, struct oval_state *state,
+					struct oval_sysitem *item, oval_result_t *result);
+void oval_result_system_set_item_result(struct oval_result_system *sys, struct oval_state *state,
+					struct oval_sysitem *item, oval_result_t result);
 
 struct oresults {
 	int true_cnt;
@@ -93,6 +98,12 @@ oval_result_t ores_get_result_byopr(struct oresults *ores, oval_operator_t op);
 
 struct oval_results_model *oval_results_model_new_with_probe_session(struct oval_definition_model *definition_model, struct oval_syschar_model **syschar_models, struct oval_probe_session *probe_session);
 struct oval_probe_session *oval_results_model_get_probe_session(struct oval_results_model *model);
+/* evaluate the criteria only until their result is known, see oval_agent_set_short_circuit() */
+void oval_results_model_set_short_circuit(struct oval_results_model *model, bool short_circuit);
+bool oval_results_model_get_short_circuit(struct oval_results_model *model);
+/* release the items of the objects once their tests are evaluated, see oval_agent_set_release_items() */
+void oval_results_model_set_release_items(struct oval_results_model *model, bool release);
+bool oval_results_model_get_release_items(struct oval_results_model *model);
 void oval_results_model_add_system(struct oval_results_model *, struct oval_result_system *);
 
 struct oval_result_definition_iterator *oval_result_definition_iterator_new(struct oval_smc *mapping);
@@ -102,6 +113,32 @@ const char *oval_result_test_get_id(const struct oval_result_test *test);
 
 
 struct oval_result_definition *oval_result_system_prepare_definition(struct oval_result_system *sys, const char *id);
+/*
+ * Called when the test was evaluated. Once all the tests of an object are,
+ * its items are released if the model asks for it.
+ */
+void oval_result_system_test_evaluated(struct oval_result_system *sys, struct oval_test *test);
+/*
+ * Copy the mask attributes of the state entities to the entities of the
+ * items, as the evaluation of the test does, before the test is evaluated
+ * in parallel with others sharing the items.
+ */
+void oval_result_test_copy_masks(struct oval_result_test *rtest, struct oval_syschar *syschar);
+
+/*
+ * Package tests are the rpminfo and dpkginfo tests of vendor CVE feeds: the
+ * object names one package by a literal and the states compare its items
+ * with literals, such as "evr less than" or "signature_keyid equals".
+ * Returns the package name, or NULL if the test is of another kind.
+ */
+const char *oval_result_test_get_package_name(struct oval_result_test *rtest);
+/* evaluate the package tests with the states prepared once for all of them */
+void oval_result_test_eval_packages(struct oval_result_test **tests, size_t count);
+/*
+ * Evaluate the package tests of all the definitions in one pass over the
+ * packages, before the definitions are evaluated from the test results.
+ */
+void oval_result_system_eval_packages(struct oval_result_system *sys);
 
 OSCAP_HIDDEN_END;
 
@@ -229,6 +229,36 @@ struct sce_session* sce_parameters_get_session(struct sce_parameters* v);
  */
 void sce_parameters_allocate_session(struct sce_parameters* v);
 
+/**
+ * Sets the number of seconds a script may run before it is killed
+ *
+ * A script that times out, together with the processes it started, is killed
+ * and its check yields XCCDF_RESULT_ERROR. The default is taken from the
+ * OSCAP_SCE_TIMEOUT environment variable, 0 (no limit) if it is not set.
+ * @memberof sce_parameters
+ */
+void sce_parameters_set_timeout(struct sce_parameters* v, unsigned int seconds);
+
+/**
+ * @memberof sce_parameters
+ */
+unsigned int sce_parameters_get_timeout(struct sce_parameters* v);
+
+/**
+ * Sets the number of bytes of stdout and of stderr kept from every script
+ *
+ * The rest of the output is read and dropped, so a verbose script can't
+ * exhaust the memory. The default is taken from the OSCAP_SCE_OUTPUT_LIMIT
+ * environment variable, 1 MiB if it is not set, 0 means no limit.
+ * @memberof sce_parameters
+ */
+void sce_parameters_set_output_limit(struct sce_parameters* v, size_t bytes);
+
+/**
+ * @memberof sce_parameters
+ */
+size_t sce_parameters_get_output_limit(struct sce_parameters* v);
+
 /**
  * Internal rule evaluation callback, don't use directly
  *
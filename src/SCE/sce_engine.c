@@ -31,9 +31,11 @@
 
 #include "common/alloc.h"
 #include "common/_error.h"
+#include "common/debug_priv.h"
 #include "common/util.h"
 #include "common/list.h"
 #include "common/oscap_acquire.h"
+#include "common/oscap_string.h"
 #include "sce_engine_api.h"
 
 #include <stdlib.h>
@@ -51,6 +53,17 @@
 #include <limits.h>
 #include <unistd.h>
 #include <libgen.h>
+#include <pthread.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+
+/* the seconds a script may run before it is killed, 0 for no limit */
+#define SCE_TIMEOUT_ENV "OSCAP_SCE_TIMEOUT"
+/* the bytes of stdout and of stderr kept from a script, 0 for no limit */
+#define SCE_OUTPUT_LIMIT_ENV "OSCAP_SCE_OUTPUT_LIMIT"
+#define SCE_OUTPUT_LIMIT_DEFAULT (1024 * 1024)
 
 struct sce_check_result
 {
@@ -213,12 +226,14 @@ void sce_check_result_export(struct sce_check_result* v, const char* target_file
 struct sce_session
 {
 	struct oscap_list* results;
+	pthread_mutex_t lock; // the checks may be evaluated by several threads
 };
 
 struct sce_session* sce_session_new(void)
 {
 	struct sce_session* ret = oscap_alloc(sizeof(struct sce_session));
 	ret->results = oscap_list_new();
+	pthread_mutex_init(&ret->lock, NULL);
 
 	return ret;
 }
@@ -229,6 +244,7 @@ void sce_session_free(struct sce_session* s)
 		return;
 
 	oscap_list_free(s->results, (oscap_destruct_func) sce_check_result_free);
+	pthread_mutex_destroy(&s->lock);
 	oscap_free(s);
 }
 
@@ -240,7 +256,9 @@ void sce_session_reset(struct sce_session* s)
 
 void sce_session_add_check_result(struct sce_session* s, struct sce_check_result* result)
 {
+	pthread_mutex_lock(&s->lock);
 	oscap_list_push(s->results, result);
+	pthread_mutex_unlock(&s->lock);
 }
 
 OSCAP_ITERATOR_GEN(sce_check_result)
@@ -269,13 +287,35 @@ struct sce_parameters
 {
 	char* xccdf_directory;
 	struct sce_session* session;
+	unsigned int timeout;
+	size_t output_limit;
 };
 
+static unsigned long sce_parameters_getenv(const char *name, unsigned long def)
+{
+	const char *value = getenv(name);
+	char *end;
+
+	if (value == NULL || *value == '\0')
+		return def;
+
+	errno = 0;
+	unsigned long ret = strtoul(value, &end, 10);
+	if (errno != 0 || *end != '\0')
+	{
+		dW("Ignoring the invalid value '%s' of %s.", value, name);
+		return def;
+	}
+	return ret;
+}
+
 struct sce_parameters* sce_parameters_new(void)
 {
 	struct sce_parameters *ret = oscap_alloc(sizeof(struct sce_parameters));
 	ret->xccdf_directory = NULL;
 	ret->session = NULL;
+	ret->timeout = sce_parameters_getenv(SCE_TIMEOUT_ENV, 0);
+	ret->output_limit = sce_parameters_getenv(SCE_OUTPUT_LIMIT_ENV, SCE_OUTPUT_LIMIT_DEFAULT);
 
 	return ret;
 }
@@ -327,6 +367,137 @@ void sce_parameters_allocate_session(struct sce_parameters* v)
 	sce_parameters_set_session(v, sce_session_new());
 }
 
+void sce_parameters_set_timeout(struct sce_parameters* v, unsigned int seconds)
+{
+	v->timeout = seconds;
+}
+
+unsigned int sce_parameters_get_timeout(struct sce_parameters* v)
+{
+	return v->timeout;
+}
+
+void sce_parameters_set_output_limit(struct sce_parameters* v, size_t bytes)
+{
+	v->output_limit = bytes;
+}
+
+size_t sce_parameters_get_output_limit(struct sce_parameters* v)
+{
+	return v->output_limit;
+}
+
+struct sce_output
+{
+	int fd;
+	struct oscap_string* buffer;
+	size_t length;
+	bool truncated;
+};
+
+static void sce_output_append(struct sce_output* output, const char* data, size_t count, size_t limit)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (limit != 0 && output->length >= limit)
+		{
+			// keep draining the pipe so that the script doesn't block on it
+			output->truncated = true;
+			return;
+		}
+
+		if (data[i] == '&')
+		{
+			// & is a special case, we have to "escape" it manually
+			// (all else will eventually get handled by libxml)
+			oscap_string_append_string(output->buffer, "&amp;");
+		}
+		else
+		{
+			oscap_string_append_char(output->buffer, data[i]);
+		}
+		output->length++;
+	}
+}
+
+/*
+ * Reads stdout and stderr of the script as it produces them until it closes
+ * both of them. Returns false if the timeout (in seconds, 0 for none) expired
+ * first. The pipes are closed in both cases.
+ */
+static bool sce_output_read(struct sce_output* outputs, size_t limit, unsigned int timeout)
+{
+	struct timespec deadline, now;
+	struct pollfd fds[2];
+	char buf[4096];
+	bool ret = true;
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += timeout;
+
+	while (outputs[0].fd != -1 || outputs[1].fd != -1)
+	{
+		int wait = -1;
+
+		if (timeout > 0)
+		{
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			long long left = (deadline.tv_sec - now.tv_sec) * 1000LL + (deadline.tv_nsec - now.tv_nsec) / 1000000;
+			if (left <= 0)
+			{
+				ret = false;
+				break;
+			}
+			wait = left > INT_MAX ? INT_MAX : (int)left;
+		}
+
+		// poll ignores the negative fds of the closed pipes
+		for (int i = 0; i < 2; ++i)
+		{
+			fds[i].fd = outputs[i].fd;
+			fds[i].events = POLLIN;
+			fds[i].revents = 0;
+		}
+
+		int ready = poll(fds, 2, wait);
+		if (ready == -1)
+		{
+			if (errno == EINTR)
+				continue;
+			perror("poll");
+			break;
+		}
+
+		for (int i = 0; i < 2; ++i)
+		{
+			if (fds[i].revents == 0)
+				continue;
+
+			ssize_t count = read(outputs[i].fd, buf, sizeof(buf));
+			if (count > 0)
+			{
+				sce_output_append(&outputs[i], buf, count, limit);
+			}
+			else if (count == 0 || errno != EINTR)
+			{
+				close(outputs[i].fd);
+				outputs[i].fd = -1;
+			}
+		}
+	}
+
+	for (int i = 0; i < 2; ++i)
+	{
+		if (outputs[i].fd != -1)
+		{
+			close(outputs[i].fd);
+			outputs[i].fd = -1;
+		}
+	}
+
+	return ret;
+}
+
 xccdf_test_result_type_t sce_engine_eval_rule(struct xccdf_policy *policy, const char *rule_id, const char *id, const char *href,
 		struct xccdf_value_binding_iterator *value_binding_it,
 		struct xccdf_check_import_iterator *check_import_it,
@@ -463,10 +634,12 @@ xccdf_test_result_type_t sce_engine_eval_rule(struct xccdf_policy *policy, const
 	env_values = oscap_realloc(env_values, (env_value_count + 1) * sizeof(char*));
 	env_values[env_value_count] = NULL;
 
-	// We open a pipe for communication with the forked process
+	// We open a pipe for communication with the forked process. The pipes are
+	// closed on exec, so the scripts run by other threads at the same time
+	// don't hold them open.
 	int stdout_pipefd[2];
 	int stderr_pipefd[2];
-	if (pipe(stdout_pipefd) == -1 || pipe(stderr_pipefd) == -1)
+	if (pipe2(stdout_pipefd, O_CLOEXEC) == -1 || pipe2(stderr_pipefd, O_CLOEXEC) == -1)
 	{
 		perror("pipe");
 		// the first 9 values (0 to 8) are compiled in
@@ -502,6 +675,9 @@ xccdf_test_result_type_t sce_engine_eval_rule(struct xccdf_policy *policy, const
 			close(stdout_pipefd[1]);
 			close(stderr_pipefd[1]);
 
+			// the script and everything it starts can be killed together on timeout
+			setpgid(0, 0);
+
 			// before we execute the script, lets make sure we get SIGTERM when
 			// oscap is killed, crashes or otherwise terminates
 #ifdef PR_SET_PDEATHSIG
@@ -527,18 +703,48 @@ xccdf_test_result_type_t sce_engine_eval_rule(struct xccdf_policy *policy, const
 			close(stdout_pipefd[1]);
 			close(stderr_pipefd[1]);
 
-			char* stdout_buffer = oscap_acquire_pipe_to_string(stdout_pipefd[0]);
-			char* stderr_buffer = oscap_acquire_pipe_to_string(stderr_pipefd[0]);
+			// we are the parent process, set the group here too in case
+			// we get to kill it before the child is scheduled
+			setpgid(fork_result, fork_result);
+
+			// the output is read as the script writes it, so it never blocks
+			// on a full pipe and only the limited part of it is kept
+			struct sce_output outputs[2] = {
+				{ stdout_pipefd[0], oscap_string_new(), 0, false },
+				{ stderr_pipefd[0], oscap_string_new(), 0, false }
+			};
+			const bool finished = sce_output_read(outputs, parameters->output_limit, parameters->timeout);
+			if (!finished)
+				kill(-fork_result, SIGKILL);
 
-			// we are the parent process
 			int wstatus;
-			waitpid(fork_result, &wstatus, 0);
+			while (waitpid(fork_result, &wstatus, 0) == -1 && errno == EINTR)
+				;
+
+			for (int i = 0; i < 2; ++i)
+			{
+				if (outputs[i].truncated)
+				{
+					char* note = oscap_sprintf("\n[output truncated after %zu bytes]\n", outputs[i].length);
+					oscap_string_append_string(outputs[i].buffer, note);
+					oscap_free(note);
+				}
+			}
+			if (!finished)
+			{
+				char* note = oscap_sprintf("\nScript '%s' was killed after running for %u seconds.\n", href, parameters->timeout);
+				oscap_string_append_string(outputs[1].buffer, note);
+				oscap_free(note);
+			}
+
+			char* stdout_buffer = oscap_string_bequeath(outputs[0].buffer);
+			char* stderr_buffer = oscap_string_bequeath(outputs[1].buffer);
 
 			// we subtract 100 here to shift the exit code to xccdf_test_result_type_t enum range
 			int raw_result = WEXITSTATUS(wstatus) - 100;
-			if (raw_result <= 0 || raw_result > XCCDF_RESULT_FIXED)
+			if (!finished || !WIFEXITED(wstatus) || raw_result <= 0 || raw_result > XCCDF_RESULT_FIXED)
 			{
-				// the script returned invalid exit code, we need to safeguard us against that
+				// the script timed out or returned invalid exit code, we need to safeguard us against that
 				raw_result = XCCDF_RESULT_ERROR;
 			}
 
@@ -609,8 +815,16 @@ xccdf_test_result_type_t sce_engine_eval_rule(struct xccdf_policy *policy, const
 	}
 }
 
+static void *sce_engine_query(void *usr, xccdf_policy_engine_query_t query_type, void *query_data)
+{
+	// every check is a separate process, they can run at the same time
+	if (query_type == POLICY_ENGINE_QUERY_CONCURRENT)
+		return usr;
+	return NULL;
+}
+
 bool xccdf_policy_model_register_engine_sce(struct xccdf_policy_model * model, struct sce_parameters *parameters)
 {
 	return xccdf_policy_model_register_engine_and_query_callback(model,
-		"http://open-scap.org/page/SCE", sce_engine_eval_rule, (void*)parameters, NULL);
+		"http://open-scap.org/page/SCE", sce_engine_eval_rule, (void*)parameters, sce_engine_query);
 }
@@ -94,6 +94,14 @@ struct xccdf_benchmark *xccdf_benchmark_import_source(struct oscap_source *sourc
 	return benchmark;
 }
 
+struct xccdf_benchmark *xccdf_benchmark_import_source_lazy(struct oscap_source *source)
+{
+	oscap_text_set_lazy(true);
+	struct xccdf_benchmark *benchmark = xccdf_benchmark_import_source(source);
+	oscap_text_set_lazy(false);
+	return benchmark;
+}
+
 struct xccdf_benchmark *xccdf_benchmark_new(void)
 {
 	struct xccdf_item *bench = xccdf_item_new(XCCDF_BENCHMARK, NULL);
@@ -236,24 +244,32 @@ struct oscap_source *xccdf_benchmark_export_source(struct xccdf_benchmark *bench
 	return oscap_source_new_from_xmlDoc(doc, filename);
 }
 
+static xmlNode *_xccdf_benchmark_to_dom(struct xccdf_benchmark *benchmark, xmlDocPtr doc,
+				xmlNode *parent, struct xml_stream *stream);
+
 int xccdf_benchmark_export(struct xccdf_benchmark *benchmark, const char *file)
 {
 	__attribute__nonnull__(file);
 
 	LIBXML_TEST_VERSION;
 
-	struct oscap_source *source = xccdf_benchmark_export_source(benchmark, file);
-	if (source == NULL) {
+	struct xml_stream *stream = xml_stream_new(file);
+	if (stream == NULL)
 		return -1;
-	}
-	int ret = oscap_source_save_as(source, NULL);
-	oscap_source_free(source);;
-	return ret;
+
+	_xccdf_benchmark_to_dom(benchmark, xml_stream_get_doc(stream), NULL, stream);
+	return xml_stream_close(stream);
 }
 
-#define OSCAP_XML_XSI BAD_CAST "http://www.w3.org/XML/1998/namespace"
 xmlNode *xccdf_benchmark_to_dom(struct xccdf_benchmark *benchmark, xmlDocPtr doc,
 				xmlNode *parent, void *user_args)
+{
+	return _xccdf_benchmark_to_dom(benchmark, doc, parent, NULL);
+}
+
+#define OSCAP_XML_XSI BAD_CAST "http://www.w3.org/XML/1998/namespace"
+static xmlNode *_xccdf_benchmark_to_dom(struct xccdf_benchmark *benchmark, xmlDocPtr doc,
+				xmlNode *parent, struct xml_stream *stream)
 {
 	const struct xccdf_version_info *version_info = xccdf_benchmark_get_schema_version(benchmark);
 
@@ -353,35 +369,45 @@ xmlNode *xccdf_benchmark_to_dom(struct xccdf_benchmark *benchmark, xmlDocPtr doc
 		xmlNewProp(model_node, BAD_CAST "system", BAD_CAST xccdf_model_get_system(model));
 	}
 
+	/* the items are written one by one when streaming */
+	xml_stream_flush(stream, root_node);
+
 	struct xccdf_profile_iterator *profiles = xccdf_benchmark_get_profiles(benchmark);
 	while (xccdf_profile_iterator_has_more(profiles)) {
 		struct xccdf_profile *profile = xccdf_profile_iterator_next(profiles);
-		xccdf_item_to_dom(XITEM(profile), doc, root_node, version_info);
+		xmlNode *profile_node = xccdf_item_to_dom(XITEM(profile), doc, root_node, version_info);
+		xml_stream_end(stream, profile_node);
 	}
 	xccdf_profile_iterator_free(profiles);
 
 	struct xccdf_value_iterator *values = xccdf_benchmark_get_values(benchmark);
 	while (xccdf_value_iterator_has_more(values)) {
 		struct xccdf_value *value = xccdf_value_iterator_next(values);
-		xccdf_item_to_dom(XITEM(value), doc, root_node, version_info);
+		xmlNode *value_node = xccdf_item_to_dom(XITEM(value), doc, root_node, version_info);
+		xml_stream_end(stream, value_node);
 	}
 	xccdf_value_iterator_free(values);
 
 	struct xccdf_item_iterator *items = xccdf_benchmark_get_content(benchmark);
 	while (xccdf_item_iterator_has_more(items)) {
 		struct xccdf_item *item = xccdf_item_iterator_next(items);
-		if (XBENCHMARK(xccdf_item_get_parent(item)) == benchmark)
-			xccdf_item_to_dom(item, doc, root_node, version_info);
+		if (XBENCHMARK(xccdf_item_get_parent(item)) == benchmark) {
+			xmlNode *item_node = xccdf_item_to_stream(item, doc, root_node, version_info, stream);
+			xml_stream_end(stream, item_node);
+		}
 	}
 	xccdf_item_iterator_free(items);
 
 	struct xccdf_result_iterator *results = xccdf_benchmark_get_results(benchmark);
 	while (xccdf_result_iterator_has_more(results)) {
 		struct xccdf_result *result = xccdf_result_iterator_next(results);
-		xccdf_item_to_dom(XITEM(result), doc, root_node, version_info);
+		xmlNode *result_node = xccdf_item_to_dom(XITEM(result), doc, root_node, version_info);
+		xml_stream_end(stream, result_node);
 	}
 	xccdf_result_iterator_free(results);
 
+	xml_stream_end(stream, root_node);
+
 	return root_node;
 }
 
@@ -784,10 +810,27 @@ bool xccdf_benchmark_register_item(struct xccdf_benchmark *benchmark, struct xcc
             xccdf_benchmark_register_item(benchmark, XITEM(val));
     }
 
+	// the new item may have to be resolved
+	XITEM(benchmark)->sub.benchmark.resolve_complete = false;
+
+	// the ordinal is kept when the item is renamed or registered again
+	if ((xccdf_item_get_type(item) & XCCDF_ITEM) && item->item.ordinal == 0)
+		item->item.ordinal = ++XITEM(benchmark)->sub.benchmark.items_count;
+
 	return oscap_htable_add(xccdf_benchmark_find_target_htable(benchmark, xccdf_item_get_type(item)), xccdf_item_get_id(item), item) &&
 		_register_item_to_cluster(benchmark, item);
 }
 
+unsigned int xccdf_item_get_ordinal(const struct xccdf_item *item)
+{
+	return item->item.ordinal;
+}
+
+unsigned int xccdf_benchmark_get_items_count(const struct xccdf_benchmark *benchmark)
+{
+	return XITEM(benchmark)->sub.benchmark.items_count;
+}
+
 bool xccdf_benchmark_unregister_item(struct xccdf_item *item)
 {
 	if (item == NULL) return false;
@@ -342,6 +342,11 @@ void xccdf_texts_to_dom(struct oscap_text_iterator *texts, xmlNode *parent, cons
 }
 
 xmlNode *xccdf_item_to_dom(struct xccdf_item *item, xmlDoc *doc, xmlNode *parent, const struct xccdf_version_info *version_info)
+{
+	return xccdf_item_to_stream(item, doc, parent, version_info, NULL);
+}
+
+xmlNode *xccdf_item_to_stream(struct xccdf_item *item, xmlDoc *doc, xmlNode *parent, const struct xccdf_version_info *version_info, struct xml_stream *stream)
 {
 	/*
 	We have 2 special cases here, either we have a parent node or we don't.
@@ -484,7 +489,7 @@ xmlNode *xccdf_item_to_dom(struct xccdf_item *item, xmlDoc *doc, xmlNode *parent
 			break;
 		case XCCDF_GROUP:
 			xmlNodeSetName(item_node,BAD_CAST "Group");
-			xccdf_group_to_dom(XGROUP(item), item_node, doc, parent);
+			xccdf_group_to_dom(XGROUP(item), item_node, doc, parent, stream);
 			break;
 		case XCCDF_VALUE:
 			xmlNodeSetName(item_node,BAD_CAST "Value");
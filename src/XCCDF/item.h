@@ -86,6 +86,8 @@ struct xccdf_item_base {
 	struct xccdf_defflags defined_flags;
 
 	struct oscap_list *metadata;
+
+	unsigned int ordinal;		/* index among the xccdf:Items of the benchmark, 0 if not registered */
 };
 
 struct xccdf_rule_item {
@@ -216,6 +218,9 @@ struct xccdf_benchmark_item {
 	struct oscap_list *values;
 	struct oscap_list *content;
 	struct oscap_list *results;
+
+	unsigned int items_count;		/* ordinals given to the xccdf:Items */
+	bool resolve_complete;			/* resolved and no item registered since */
 };
 
 struct xccdf_item {
@@ -442,6 +447,9 @@ struct oscap_htable_iterator *xccdf_benchmark_get_cluster_items(struct xccdf_ben
 bool xccdf_benchmark_register_item(struct xccdf_benchmark *benchmark, struct xccdf_item *item);
 bool xccdf_benchmark_unregister_item(struct xccdf_item *item);
 bool xccdf_benchmark_rename_item(struct xccdf_item *item, const char *newid);
+/* Items get dense ordinals (1..count) when registered, for lookup tables indexed by them */
+unsigned int xccdf_item_get_ordinal(const struct xccdf_item *item);
+unsigned int xccdf_benchmark_get_items_count(const struct xccdf_benchmark *benchmark);
 char *xccdf_benchmark_gen_id(struct xccdf_benchmark *benchmark, xccdf_type_t type, const char *prefix);
 struct xccdf_profile *xccdf_benchmark_get_profile_by_id(struct xccdf_benchmark *benchmark, const char *profile_id);
 struct xccdf_result *xccdf_benchmark_get_result_by_id(struct xccdf_benchmark *benchmark, const char *testresult_id);
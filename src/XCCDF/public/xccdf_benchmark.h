@@ -717,6 +717,19 @@ OSCAP_DEPRECATED(struct xccdf_benchmark* xccdf_benchmark_import(const char *file
  */
 struct xccdf_benchmark* xccdf_benchmark_import_source(struct oscap_source *source);
 
+/**
+ * Import the content from oscap_source into a benchmark, but keep the texts
+ * with XHTML content (titles, descriptions, rationales, warnings, fixtexts,
+ * front and rear matter) as references to their elements in the DOM of the
+ * source. A text is serialized when it's asked for the first time, e.g. by
+ * the export or a report, so the evaluation doesn't pay for the prose.
+ * The source must not be freed before the benchmark.
+ * @memberof xccdf_benchmark
+ * @param source The oscap_source to import from
+ * @returns newly created benchmark element or NULL
+ */
+struct xccdf_benchmark* xccdf_benchmark_import_source_lazy(struct oscap_source *source);
+
 /**
  * Export a benchmark to an XML stream
  * @memberof xccdf_benchmark
@@ -2581,6 +2594,28 @@ struct xccdf_target_identifier_iterator *xccdf_result_get_target_id_refs(const s
 struct xccdf_setvalue_iterator *xccdf_result_get_setvalues(const struct xccdf_result *item);
 /// @memberof xccdf_result
 struct xccdf_rule_result_iterator *xccdf_result_get_rule_results(const struct xccdf_result *item);
+
+/**
+ * Summary of a rule-result, see xccdf_result_get_rule_result_records().
+ * The idref is owned by the rule-result.
+ */
+struct xccdf_rule_result_record {
+	const char *idref;
+	xccdf_test_result_type_t result;
+	xccdf_level_t severity;
+	time_t time; ///< local time of the rule-result, 0 if it has none
+};
+
+/**
+ * Get the summaries of all the rule-results of the result in one call,
+ * in the document order. It is meant for the language bindings, which
+ * would otherwise cross into the library several times per rule-result.
+ * @memberof xccdf_result
+ * @param item The result
+ * @param records Set to an array of the summaries, to be freed with free()
+ * @returns the number of the summaries, records is NULL if there are none
+ */
+size_t xccdf_result_get_rule_result_records(const struct xccdf_result *item, struct xccdf_rule_result_record **records);
 /// @memberof xccdf_result
 struct xccdf_score_iterator *xccdf_result_get_scores(const struct xccdf_result *item);
 /// @memberof xccdf_result
@@ -185,6 +185,50 @@ void xccdf_session_set_custom_oval_files(struct xccdf_session *session, char **o
  */
 void xccdf_session_set_custom_oval_eval_fn(struct xccdf_session *session, xccdf_policy_engine_eval_fn eval_fn);
 
+/**
+ * Set the number of OVAL object queries evaluated by the probes at the same
+ * time, see oval_agent_set_jobs(). The rules of the concurrent checking engines
+ * (e.g. SCE) are evaluated by as many threads, see xccdf_policy_model_set_jobs().
+ * This function shall be called before OVAL files are parsed.
+ * @memberof xccdf_session
+ * @param session XCCDF Session
+ * @param jobs the number of queries in flight, 0 for the default behaviour
+ */
+void xccdf_session_set_oval_jobs(struct xccdf_session *session, unsigned int jobs);
+
+/**
+ * Release the collected items of every OVAL test once it is evaluated, see
+ * oval_agent_set_release_items(). Only the results of the rules are kept then,
+ * so neither the OVAL results nor the ARF can be exported afterwards.
+ * This function shall be called before OVAL files are parsed.
+ * @memberof xccdf_session
+ * @param session XCCDF Session
+ * @param release true to release the items
+ */
+void xccdf_session_set_oval_release_items(struct xccdf_session *session, bool release);
+
+/**
+ * Parse only the OVAL definitions needed by the evaluated rules, see
+ * oval_definition_model_import_source_lazy(). This function shall be called
+ * before OVAL files are parsed.
+ * @memberof xccdf_session
+ * @param session XCCDF Session
+ * @param lazy true to parse the definitions on demand, false (default) to
+ * parse the whole OVAL files
+ */
+void xccdf_session_set_oval_lazy_loading(struct xccdf_session *session, bool lazy);
+
+/**
+ * Keep the XHTML texts of the benchmark in the DOM until they are needed,
+ * see xccdf_benchmark_import_source_lazy(). This function shall be called
+ * before the XCCDF file is parsed.
+ * @memberof xccdf_session
+ * @param session XCCDF Session
+ * @param lazy true to serialize the texts on demand, false (default) to
+ * serialize them when the benchmark is parsed
+ */
+void xccdf_session_set_xccdf_lazy_texts(struct xccdf_session *session, bool lazy);
+
 /**
  * Set custom product CPE name.
  * @memberof xccdf_session
@@ -244,6 +288,20 @@ bool xccdf_session_set_xccdf_export(struct xccdf_session *session, const char *x
  */
 bool xccdf_session_set_arf_export(struct xccdf_session *session, const char *arf_file);
 
+/**
+ * Set where to export the delta of the ARF file against the ARF file of
+ * a previous evaluation (the baseline), see oscap_source_new_delta(). The
+ * delta carries the whole ARF if the baseline file doesn't exist. The delta
+ * is exported together with the ARF, see xccdf_session_set_arf_export().
+ * NULL value means to not export at all.
+ * @memberof xccdf_session
+ * @param session XCCDF Session
+ * @param baseline_file path to the previous ARF file
+ * @param delta_file path to the delta
+ * @returns true on success
+ */
+bool xccdf_session_set_arf_delta_export(struct xccdf_session *session, const char *baseline_file, const char *delta_file);
+
 /**
  * Set where to export HTML Report file. NULL value means to not export at all.
  * @memberof xccdf_session
@@ -253,6 +311,16 @@ bool xccdf_session_set_arf_export(struct xccdf_session *session, const char *arf
  */
 bool xccdf_session_set_report_export(struct xccdf_session *session, const char *report_file);
 
+/**
+ * Write the HTML report by the built-in writer, straight from the results
+ * in memory, instead of applying the XSLT stylesheet to the serialized
+ * results. The built-in report can't be customized.
+ * @memberof xccdf_session
+ * @param session XCCDF Session
+ * @param native true for the built-in writer, false (default) for the stylesheet
+ */
+void xccdf_session_set_report_native(struct xccdf_session *session, bool native);
+
 /**
  * Select XCCDF Profile for evaluation.
  * @memberof xccdf_session
@@ -262,6 +330,20 @@ bool xccdf_session_set_report_export(struct xccdf_session *session, const char *
  */
 bool xccdf_session_set_profile_id(struct xccdf_session *session, const char *profile_id);
 
+/**
+ * Select more XCCDF Profiles to be evaluated by one xccdf_session_evaluate.
+ * The first profile is the selected one (see xccdf_session_set_profile_id),
+ * the others are evaluated after it over the same OVAL agents, so the objects
+ * are collected only once. Each profile gets its TestResult, and all of them
+ * are exported to the XCCDF results and the ARF. The HTML report and the
+ * remediation use the first profile.
+ * @memberof xccdf_session
+ * @param session XCCDF Session
+ * @param profile_ids NULL terminated array of the profile IDs
+ * @returns true on success, false if one of the profiles doesn't exist
+ */
+bool xccdf_session_set_profile_ids(struct xccdf_session *session, const char **profile_ids);
+
 /**
  * Retrieves ID of the profile that we will evaluate with, or NULL.
  * @memberof xccdf_session
@@ -367,6 +449,17 @@ int xccdf_session_load_tailoring(struct xccdf_session *session);
  */
 int xccdf_session_evaluate(struct xccdf_session *session);
 
+/**
+ * Drop the results of the last evaluation and the export settings, so that
+ * the session can be evaluated again, e.g. with another profile or tailoring.
+ * The loaded content, the resolved benchmark and the OVAL agents with their
+ * probes are kept, the system is scanned again by the next evaluation.
+ * @memberof xccdf_session
+ * @param session XCCDF Session
+ * @returns zero on success
+ */
+int xccdf_session_reset(struct xccdf_session *session);
+
 /**
  * Export XCCDF file.
  * @memberof xccdf_session
@@ -456,6 +549,7 @@ unsigned int xccdf_session_get_cpe_oval_agents_count(const struct xccdf_session
 
 /**
  * Query if the result of evaluation contains FAIL, ERROR, or UNKNOWN rule-result elements.
+ * The results of all the evaluated profiles are queried.
  * @memberof xccdf_session
  * @param session XCCDF Session
  * @returns Exists such rule-result r . r = FAIL | r = UNKNOWN | r = ERROR
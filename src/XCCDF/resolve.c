@@ -31,6 +31,8 @@
 #include "common/tsort.h"
 
 typedef void (*xccdf_textresolve_func)(void *child, void *parent);
+/* key of a list entry, the parent's entries are inherited unless the child has one with the same key */
+typedef const char *(*xccdf_resolve_key_func)(void *item);
 
 static void xccdf_resolve_item(struct xccdf_item *item, struct xccdf_tailoring *tailoring);
 static void xccdf_resolve_cleanup(struct xccdf_item *item);
@@ -68,6 +70,11 @@ static struct oscap_list *xccdf_benchmark_resolve_dependencies(void *itemptr, vo
 
 bool xccdf_benchmark_resolve(struct xccdf_benchmark *benchmark)
 {
+	// every policy model resolves its benchmark, there is nothing to do
+	// unless an item was registered since the last resolution
+	if (XITEM(benchmark)->sub.benchmark.resolve_complete)
+		return true;
+
 	struct oscap_list *resolve_order = NULL, *root_nodes = oscap_list_new();
 	oscap_list_add(root_nodes, benchmark);
 	bool ret = false;
@@ -83,12 +90,13 @@ bool xccdf_benchmark_resolve(struct xccdf_benchmark *benchmark)
 
     xccdf_resolve_cleanup(XITEM(benchmark));
 
+	XITEM(benchmark)->sub.benchmark.resolve_complete = ret;
 	return ret;
 }
 
 // prototypes
 static void xccdf_resolve_textlist(struct oscap_list *child_list, struct oscap_list *parent_list, xccdf_textresolve_func more);
-static void xccdf_resolve_appendlist(struct oscap_list **child_list, struct oscap_list *parent_list, oscap_cmp_func item_compare, oscap_clone_func cloner, bool prepend);
+static void xccdf_resolve_appendlist(struct oscap_list **child_list, struct oscap_list *parent_list, xccdf_resolve_key_func item_key, oscap_clone_func cloner, bool prepend);
 static void xccdf_resolve_value_instance(struct xccdf_value_instance *child, struct xccdf_value_instance *parent);
 static void xccdf_resolve_profile(struct xccdf_item *child, struct xccdf_item *parent);
 static void xccdf_resolve_group(struct xccdf_item *child, struct xccdf_item *parent);
@@ -216,35 +224,56 @@ static void xccdf_resolve_textlist(struct oscap_list *child_list, struct oscap_l
 }
 
 static void xccdf_resolve_appendlist(struct oscap_list **child_list, struct oscap_list *parent_list,
-                                                   oscap_cmp_func item_compare, oscap_clone_func cloner, bool prepend)
+                                                   xccdf_resolve_key_func item_key, oscap_clone_func cloner, bool prepend)
 {
+	// Index the keys of the child's entries, so long lists (e.g. the selects
+	// of profiles) are merged in linear time. Without a key function all the
+	// parent's entries are inherited.
+	struct oscap_htable *child_keys = oscap_htable_new();
+	bool child_null_key = false;
+	if (item_key != NULL) {
+		struct oscap_iterator *child_iter = oscap_iterator_new(*child_list);
+		while (oscap_iterator_has_more(child_iter)) {
+			void *child = oscap_iterator_next(child_iter);
+			const char *key = item_key(child);
+			if (key == NULL)
+				child_null_key = true;
+			else if (oscap_htable_get(child_keys, key) == NULL)
+				oscap_htable_add(child_keys, key, child);
+		}
+		oscap_iterator_free(child_iter);
+	}
+
 	struct oscap_iterator *parent_iter = oscap_iterator_new(parent_list);
 	struct oscap_list *to_add = oscap_list_new();
 	while (oscap_iterator_has_more(parent_iter)) {
 		void *parent = oscap_iterator_next(parent_iter);
-		struct oscap_iterator *child_iter = oscap_iterator_new(*child_list);
 		bool found = false;
-		while (oscap_iterator_has_more(child_iter))
-			if (item_compare(parent, oscap_iterator_next(child_iter)))
-				found = true;
+		if (item_key != NULL) {
+			const char *key = item_key(parent);
+			found = (key == NULL) ? child_null_key : oscap_htable_get(child_keys, key) != NULL;
+		}
 		if (!found) oscap_list_add(to_add, cloner(parent));
-		oscap_iterator_free(child_iter);
 	}
 	oscap_iterator_free(parent_iter);
+	oscap_htable_free0(child_keys);
 	*child_list = (prepend ? oscap_list_destructive_join(*child_list, to_add) : oscap_list_destructive_join(to_add, *child_list));
 }
 
-static bool xccdf_select_idcmp(void *s1, void *s2) {
-	return oscap_streq(((struct xccdf_select*)s1)->item, ((struct xccdf_select*)s2)->item);
+static const char *xccdf_select_key(void *s) {
+	return ((struct xccdf_select*)s)->item;
+}
+static const char *xccdf_setvalue_key(void *s) {
+	return ((struct xccdf_setvalue*)s)->item;
 }
-static bool xccdf_setvalue_idcmp(void *s1, void *s2) {
-	return oscap_streq(((struct xccdf_setvalue*)s1)->item, ((struct xccdf_setvalue*)s2)->item);
+static const char *xccdf_refine_rule_key(void *s) {
+	return ((struct xccdf_refine_rule*)s)->item;
 }
-static bool xccdf_refine_rule_idcmp(void *s1, void *s2) {
-	return oscap_streq(((struct xccdf_refine_rule*)s1)->item, ((struct xccdf_refine_rule*)s2)->item);
+static const char *xccdf_refine_value_key(void *s) {
+	return ((struct xccdf_refine_value*)s)->item;
 }
-static bool xccdf_refine_value_idcmp(void *s1, void *s2) {
-	return oscap_streq(((struct xccdf_refine_value*)s1)->item, ((struct xccdf_refine_value*)s2)->item);
+static const char *xccdf_string_key(void *s) {
+	return (const char *)s;
 }
 
 static void xccdf_resolve_profile(struct xccdf_item *child, struct xccdf_item *parent)
@@ -255,10 +284,10 @@ static void xccdf_resolve_profile(struct xccdf_item *child, struct xccdf_item *p
 		oscap_free(note_tag);
 	}
 
-	xccdf_resolve_appendlist(&child->sub.profile.selects,       parent->sub.profile.selects,       xccdf_select_idcmp,       (oscap_clone_func)xccdf_select_clone, false);
-	xccdf_resolve_appendlist(&child->sub.profile.setvalues,     parent->sub.profile.setvalues,     xccdf_setvalue_idcmp,     (oscap_clone_func)xccdf_setvalue_clone, false);
-	xccdf_resolve_appendlist(&child->sub.profile.refine_rules,  parent->sub.profile.refine_rules,  xccdf_refine_rule_idcmp,  (oscap_clone_func)xccdf_refine_rule_clone, false);
-	xccdf_resolve_appendlist(&child->sub.profile.refine_values, parent->sub.profile.refine_values, xccdf_refine_value_idcmp, (oscap_clone_func)xccdf_refine_value_clone, false);
+	xccdf_resolve_appendlist(&child->sub.profile.selects,       parent->sub.profile.selects,       xccdf_select_key,       (oscap_clone_func)xccdf_select_clone, false);
+	xccdf_resolve_appendlist(&child->sub.profile.setvalues,     parent->sub.profile.setvalues,     xccdf_setvalue_key,     (oscap_clone_func)xccdf_setvalue_clone, false);
+	xccdf_resolve_appendlist(&child->sub.profile.refine_rules,  parent->sub.profile.refine_rules,  xccdf_refine_rule_key,  (oscap_clone_func)xccdf_refine_rule_clone, false);
+	xccdf_resolve_appendlist(&child->sub.profile.refine_values, parent->sub.profile.refine_values, xccdf_refine_value_key, (oscap_clone_func)xccdf_refine_value_clone, false);
 }
 
 static struct xccdf_item *xccdf_resolve_copy_item(struct xccdf_item *src)
@@ -278,14 +307,13 @@ static struct xccdf_item *xccdf_resolve_copy_item(struct xccdf_item *src)
 	return clone;
 }
 
-static bool xccdf_incomparable(void *i1, void *i2) { return false; }
 //static void *xccdf_strlist_clone(void *l) { return oscap_list_clone(l, (oscap_clone_func)oscap_strdup); }
 
 static void xccdf_resolve_group(struct xccdf_item *child, struct xccdf_item *parent)
 {
 	// TODO: resolve requires properly (how?)
-	//xccdf_resolve_appendlist(&child->sub.group.requires, parent->sub.group.requires, xccdf_incomparable, xccdf_strlist_clone, false);
-	xccdf_resolve_appendlist(&child->sub.group.conflicts, parent->sub.group.conflicts, (oscap_cmp_func)oscap_strcmp, (oscap_clone_func)oscap_strdup, false);
+	//xccdf_resolve_appendlist(&child->sub.group.requires, parent->sub.group.requires, NULL, xccdf_strlist_clone, false);
+	xccdf_resolve_appendlist(&child->sub.group.conflicts, parent->sub.group.conflicts, xccdf_string_key, (oscap_clone_func)oscap_strdup, false);
 	
 	OSCAP_FOR(xccdf_item, item, xccdf_group_get_content(XGROUP(parent)))
 		xccdf_group_add_content(XGROUP(child), xccdf_resolve_copy_item(item));
@@ -293,8 +321,8 @@ static void xccdf_resolve_group(struct xccdf_item *child, struct xccdf_item *par
 		xccdf_group_add_value(XGROUP(child), xccdf_item_to_value(xccdf_resolve_copy_item(XITEM(val))));
 }
 
-static bool xccdf_ident_idcmp(void *s1, void *s2) {
-	return oscap_streq(((struct xccdf_ident*)s1)->id, ((struct xccdf_ident*)s2)->id);
+static const char *xccdf_ident_key(void *s) {
+	return ((struct xccdf_ident*)s)->id;
 }
 static void xccdf_resolve_profile_note(void *p1, void *p2) {
 	if (xccdf_profile_note_get_reftag(p1) == NULL)
@@ -312,10 +340,10 @@ static void xccdf_resolve_fixtext(struct xccdf_fixtext *t1, struct xccdf_fixtext
 static void xccdf_resolve_rule(struct xccdf_item *child, struct xccdf_item *parent)
 {
 	// TODO: resolve requires properly (how?)
-	//xccdf_resolve_appendlist(&child->sub.rule.requires, parent->sub.rule.requires, xccdf_incomparable, xccdf_strlist_clone);
-	xccdf_resolve_appendlist(&child->sub.rule.conflicts, parent->sub.rule.conflicts, (oscap_cmp_func)oscap_strcmp, (oscap_clone_func)oscap_strdup, false);
-	xccdf_resolve_appendlist(&child->sub.rule.idents, parent->sub.rule.idents, (oscap_cmp_func)xccdf_ident_idcmp, (oscap_clone_func)xccdf_ident_clone, false);
-	xccdf_resolve_appendlist(&child->sub.rule.fixes, parent->sub.rule.fixes, (oscap_cmp_func)xccdf_incomparable, (oscap_clone_func)xccdf_fix_clone, false);
+	//xccdf_resolve_appendlist(&child->sub.rule.requires, parent->sub.rule.requires, NULL, xccdf_strlist_clone);
+	xccdf_resolve_appendlist(&child->sub.rule.conflicts, parent->sub.rule.conflicts, xccdf_string_key, (oscap_clone_func)oscap_strdup, false);
+	xccdf_resolve_appendlist(&child->sub.rule.idents, parent->sub.rule.idents, xccdf_ident_key, (oscap_clone_func)xccdf_ident_clone, false);
+	xccdf_resolve_appendlist(&child->sub.rule.fixes, parent->sub.rule.fixes, NULL, (oscap_clone_func)xccdf_fix_clone, false);
 
 	if (oscap_list_get_itemcount(child->sub.rule.checks) == 0 && oscap_list_get_itemcount(parent->sub.rule.checks) > 0) {
 		oscap_list_free(child->sub.rule.checks, NULL);
@@ -125,6 +125,44 @@ XCCDF_LISTMANIP(result, target_identifier, target_id_refs)
 XCCDF_LISTMANIP_STRING(result, applicable_platform, applicable_platforms)
 XCCDF_LISTMANIP(result, setvalue, setvalues)
 XCCDF_LISTMANIP(result, rule_result, rule_results)
+
+size_t xccdf_result_get_rule_result_records(const struct xccdf_result *item, struct xccdf_rule_result_record **records)
+{
+	const struct xccdf_item *result = XITEM(item);
+	struct oscap_iterator *it;
+	struct tm tm;
+	size_t count = 0;
+
+	*records = NULL;
+	if (result->sub.result.rule_results->itemcount == 0)
+		return 0;
+
+	*records = malloc(sizeof(struct xccdf_rule_result_record) * result->sub.result.rule_results->itemcount);
+	if (*records == NULL)
+		return 0;
+
+	it = oscap_iterator_new(result->sub.result.rule_results);
+	while (oscap_iterator_has_more(it)) {
+		const struct xccdf_rule_result *rr = oscap_iterator_next(it);
+		struct xccdf_rule_result_record *rec = &(*records)[count++];
+
+		rec->idref = rr->idref;
+		rec->result = rr->result;
+		rec->severity = rr->severity;
+		rec->time = 0;
+
+		/* the format of _get_timestamp(), the offset is ignored */
+		memset(&tm, 0, sizeof tm);
+		if (rr->time != NULL && strptime(rr->time, "%Y-%m-%dT%H:%M:%S", &tm) != NULL) {
+			tm.tm_isdst = -1;
+			rec->time = mktime(&tm);
+		}
+	}
+	oscap_iterator_free(it);
+
+	return count;
+}
+
 XCCDF_LISTMANIP(result, score, scores)
 OSCAP_ITERATOR_GEN(xccdf_result)
 OSCAP_ITERATOR_REMOVE_F(xccdf_result)
@@ -54,62 +54,131 @@ struct xccdf_flat_score {
 
 };
 
-static struct xccdf_default_score * xccdf_item_get_default_score(struct xccdf_item * item, struct xccdf_result * test_result)
+/**
+ * Scores of a benchmark item in all the scoring models. The items that
+ * can't be processed (rules without a scored result, unsupported types)
+ * aren't scored and are skipped by their parents.
+ */
+struct xccdf_scoring_node {
+	struct xccdf_item *item;
+	struct xccdf_scoring_node *parent;
+	struct xccdf_scoring_node **children;
+	size_t children_count;
+	struct xccdf_rule_result *rule_result;	///< Rules only, the first rule-result of the rule
+	bool scored;
+	struct xccdf_default_score def;
+	struct xccdf_flat_score flat;
+	struct xccdf_flat_score unweighted;
+};
+
+struct xccdf_scoring {
+	struct xccdf_scoring_node *root;
+	struct oscap_htable *rules;		///< rule id -> node
+};
+
+static void xccdf_scoring_rule_update(struct xccdf_scoring_node *node)
 {
-	// Implements algorithm as described in NISTIR-7275-r4
+	// Implements algorithms as described in NISTIR-7275-r4
 	// Table 40: Default Model Algorithm Sub-Steps
-	struct xccdf_default_score *score;
-	struct xccdf_default_score *ch_score;
-	struct xccdf_rule_result *rule_result;
-	struct xccdf_item *child;
-
-	xccdf_type_t itype = xccdf_item_get_type(item);
+	// Table 41: Flat Model Algorithm Sub-Steps
+	struct xccdf_rule_result *rule_result = node->rule_result;
+
+	node->scored = false;
+	if (rule_result == NULL)
+		return;
+	if (xccdf_rule_result_get_role(rule_result) == XCCDF_ROLE_UNSCORED)
+		return;
+
+	/* Ignore these rules */
+	xccdf_test_result_type_t result = xccdf_rule_result_get_result(rule_result);
+	if ((result == XCCDF_RESULT_NOT_SELECTED) ||
+			(result == XCCDF_RESULT_NOT_APPLICABLE) ||
+			(result == XCCDF_RESULT_INFORMATIONAL) ||
+			(result == XCCDF_RESULT_NOT_CHECKED))
+		return;
+
+	node->scored = true;
+	const bool pass = (result == XCCDF_RESULT_PASS) || (result == XCCDF_RESULT_FIXED);
+	const float weight = xccdf_item_get_weight(node->item);
+
+	/* Count with this rule, if the test result is 'pass', assign the node a score of 100, otherwise assign a score of 0 */
+	node->def.count = 1;
+	node->def.score = pass ? 100.0 : 0.0;
+	node->def.accumulator = 0.0;
+	/* Default weight */
+	node->def.weight_score = node->def.score * weight;
+
+	/* max possible score = sum of weights, score = sum of weights of rules that pass */
+	node->flat.weight = weight;
+	node->flat.score = pass ? weight : 0.0;
+	node->unweighted.weight = 1.0;
+	node->unweighted.score = pass ? 1.0 : 0.0;
+}
 
-	switch (itype) {
-	case XCCDF_RULE: {
-		/* Rule */
-		const char *rule_id = xccdf_rule_get_id((const struct xccdf_rule *) item);
-		rule_result = xccdf_result_get_rule_result_by_id(test_result, rule_id);
-		if (rule_result == NULL) {
-			dE("Rule result ID(%s) not fount", rule_id);
-			return NULL;
+static void xccdf_scoring_group_update(struct xccdf_scoring_node *node)
+{
+	node->scored = true;
+	memset(&node->def, 0, sizeof(node->def));
+	memset(&node->flat, 0, sizeof(node->flat));
+	memset(&node->unweighted, 0, sizeof(node->unweighted));
+
+	for (size_t i = 0; i < node->children_count; ++i) {
+		const struct xccdf_scoring_node *child = node->children[i];
+		if (!child->scored) /* we got item that can't be processed */
+			continue;
+
+		/* If child's count value is not 0, then add the child's wighted score to this node's score */
+		if (child->def.count != 0) {
+			node->def.score += child->def.weight_score;
+			node->def.count++;
+			node->def.accumulator += xccdf_item_get_weight(child->item);
 		}
-		if (xccdf_rule_result_get_role(rule_result) == XCCDF_ROLE_UNSCORED) {
-			return NULL;
+		if (child->flat.weight != 0) {
+			node->flat.score += child->flat.score;
+			node->flat.weight += child->flat.weight;
 		}
+		if (child->unweighted.weight != 0) {
+			node->unweighted.score += child->unweighted.score;
+			node->unweighted.weight += child->unweighted.weight;
+		}
+	}
 
-		/* Ignore these rules */
-		if ((xccdf_rule_result_get_result(rule_result) == XCCDF_RESULT_NOT_SELECTED) ||
-				(xccdf_rule_result_get_result(rule_result) == XCCDF_RESULT_NOT_APPLICABLE) ||
-				(xccdf_rule_result_get_result(rule_result) == XCCDF_RESULT_INFORMATIONAL) ||
-				(xccdf_rule_result_get_result(rule_result) == XCCDF_RESULT_NOT_CHECKED))
-			return NULL;
-
-		score = oscap_alloc(sizeof(struct xccdf_default_score));
-
-		/* Count with this rule */
-		score->count = 1;
+	/* Normalize */
+	if (node->def.count && node->def.accumulator)
+		node->def.score = node->def.score / node->def.accumulator;
+	/* Default weight */
+	node->def.weight_score = node->def.score * xccdf_item_get_weight(node->item);
+}
 
-		/* If the test result is 'pass', assign the node a score of 100, otherwise assign a score of 0 */
-		if ((xccdf_rule_result_get_result(rule_result) == XCCDF_RESULT_PASS) ||
-				(xccdf_rule_result_get_result(rule_result) == XCCDF_RESULT_FIXED))
-			score->score = 100.0;
-		else
-			score->score = 0.0;
+static void xccdf_scoring_node_update(struct xccdf_scoring_node *node)
+{
+	switch (xccdf_item_get_type(node->item)) {
+	case XCCDF_RULE:
+		xccdf_scoring_rule_update(node);
+		break;
+	case XCCDF_BENCHMARK:
+	case XCCDF_GROUP:
+		xccdf_scoring_group_update(node);
+		break;
+	default:
+		node->scored = false;
+		break;
+	}
+}
 
-		/* Default weight */
-		score->weight_score = score->score * xccdf_item_get_weight(item);
-	} break;
+static struct xccdf_scoring_node *xccdf_scoring_node_new(struct xccdf_scoring *scoring, struct xccdf_item *item, struct xccdf_scoring_node *parent)
+{
+	struct xccdf_scoring_node *node = oscap_calloc(1, sizeof(struct xccdf_scoring_node));
+	node->item = item;
+	node->parent = parent;
 
+	xccdf_type_t itype = xccdf_item_get_type(item);
+	switch (itype) {
+	case XCCDF_RULE:
+		oscap_htable_add(scoring->rules, xccdf_item_get_id(item), node);
+		break;
 	case XCCDF_BENCHMARK:
 	case XCCDF_GROUP: {
-		/* Init */
-		score = oscap_alloc(sizeof(struct xccdf_default_score));
-		score->count = 0;
-		score->score = 0.0;
-		score->accumulator = 0.0;
-
-		/* Recurse */
 		struct xccdf_item_iterator * child_it;
 		if (itype == XCCDF_GROUP)
 			child_it = xccdf_group_get_content((const struct xccdf_group *)item);
@@ -117,162 +186,103 @@ static struct xccdf_default_score * xccdf_item_get_default_score(struct xccdf_it
 			child_it = xccdf_benchmark_get_content((const struct xccdf_benchmark *)item);
 
 		while (xccdf_item_iterator_has_more(child_it)) {
-			child = xccdf_item_iterator_next(child_it);
-			ch_score = xccdf_item_get_default_score(child, test_result);
-
-			if (ch_score == NULL) /* we got item that can't be processed */
-				continue;
-
-			if (ch_score->count == 0) { /* we got item that has no selected items */
-				oscap_free(ch_score);
-				continue;
-			}
-
-			/* If child's count value is not 0, then add the child's wighted score to this node's score */
-			score->score += ch_score->weight_score;
-			score->count++;
-			score->accumulator += xccdf_item_get_weight(child);
-
-			oscap_free(ch_score);
+			struct xccdf_item *child = xccdf_item_iterator_next(child_it);
+			node->children = oscap_realloc(node->children, (node->children_count + 1) * sizeof(struct xccdf_scoring_node *));
+			node->children[node->children_count++] = xccdf_scoring_node_new(scoring, child, node);
 		}
-
-		/* Normalize */
-		if (score->count && score->accumulator)
-			score->score = score->score / score->accumulator;
-		/* Default weight */
-		score->weight_score = score->score * xccdf_item_get_weight(item);
-
 		xccdf_item_iterator_free(child_it);
 	} break;
-
-	default: {
+	default:
 		dE("Unsupported item type: %d", itype);
-		score=NULL;
-	} break;
-
-	} /* switch */
-	return score;
+		break;
+	}
+	return node;
 }
 
-static struct xccdf_flat_score * xccdf_item_get_flat_score(struct xccdf_item * item, struct xccdf_result * test_result, bool unweighted)
+static void xccdf_scoring_node_free(struct xccdf_scoring_node *node)
 {
-	// Implements algorithm as described in NISTIR-7275-r4
-	// Table 41: Flat Model Algorithm Sub-Steps
-	struct xccdf_flat_score *score;
-	struct xccdf_flat_score *ch_score;
-	struct xccdf_rule_result *rule_result;
-	struct xccdf_item *child;
-
-	xccdf_type_t itype = xccdf_item_get_type(item);
-
-	switch (itype) {
-	case XCCDF_RULE:{
-		/* Rule */
-		const char *rule_id = xccdf_rule_get_id((const struct xccdf_rule *) item);
-		rule_result = xccdf_result_get_rule_result_by_id(test_result, rule_id);
-		if (rule_result == NULL) {
-			dE("Rule result ID(%s) not fount", rule_id);
-			return NULL;
-		}
-		if (xccdf_rule_result_get_role(rule_result) == XCCDF_ROLE_UNSCORED) {
-			return NULL;
-		}
-
-		/* Ignore these rules */
-		if ((xccdf_rule_result_get_result(rule_result) == XCCDF_RESULT_NOT_SELECTED) ||
-				(xccdf_rule_result_get_result(rule_result) == XCCDF_RESULT_NOT_APPLICABLE) ||
-				(xccdf_rule_result_get_result(rule_result) == XCCDF_RESULT_INFORMATIONAL) ||
-				(xccdf_rule_result_get_result(rule_result) == XCCDF_RESULT_NOT_CHECKED))
-			return NULL;
-
-		score = oscap_alloc(sizeof(struct xccdf_flat_score));
-
-		/* max possible score = sum of weights*/
-		if (unweighted)
-			score->weight = 1.0;
-		else score->weight =
-			xccdf_item_get_weight(item);
-
-		/* score = sum of weights of rules that pass */
-		if ((xccdf_rule_result_get_result(rule_result) == XCCDF_RESULT_PASS) ||
-				(xccdf_rule_result_get_result(rule_result) == XCCDF_RESULT_FIXED)) {
-			if (unweighted)
-				score->score = 1.0;
-			else
-				score->score = xccdf_item_get_weight(item);
-		} else
-			score->score = 0.0;	/* fail */
-	} break;
-	case XCCDF_BENCHMARK:
-	case XCCDF_GROUP:{
-		/* Init */
-		score = oscap_alloc(sizeof(struct xccdf_flat_score));
-		score->score = 0;
-		score->weight = 0.0;
-
-		/* Recurse */
-		struct xccdf_item_iterator * child_it;
-		if (itype == XCCDF_GROUP)
-			child_it = xccdf_group_get_content((const struct xccdf_group *)item);
-		else
-			child_it = xccdf_benchmark_get_content((const struct xccdf_benchmark *)item);
-
-		while (xccdf_item_iterator_has_more(child_it)) {
-			child = xccdf_item_iterator_next(child_it);
-			ch_score = xccdf_item_get_flat_score(child, test_result, unweighted);
+	for (size_t i = 0; i < node->children_count; ++i)
+		xccdf_scoring_node_free(node->children[i]);
+	oscap_free(node->children);
+	oscap_free(node);
+}
 
-			if (ch_score == NULL) /* we got item that can't be processed */
-				continue;
+/* the scores of all the items, children first */
+static void xccdf_scoring_node_compute(struct xccdf_scoring_node *node)
+{
+	for (size_t i = 0; i < node->children_count; ++i)
+		xccdf_scoring_node_compute(node->children[i]);
+	xccdf_scoring_node_update(node);
+}
 
-			if (ch_score->weight == 0) { /* we got item that has no selected items */
-				oscap_free(ch_score);
-				continue;
-			}
+static bool xccdf_scoring_set_rule_result(struct xccdf_scoring *scoring, struct xccdf_rule_result *rule_result, struct xccdf_scoring_node **node)
+{
+	*node = oscap_htable_get(scoring->rules, xccdf_rule_result_get_idref(rule_result));
+	if (*node == NULL)
+		return false;
+	// only the first rule-result of a rule is scored, the same as xccdf_result_get_rule_result_by_id gives
+	if ((*node)->rule_result != NULL && (*node)->rule_result != rule_result)
+		return false;
+	(*node)->rule_result = rule_result;
+	return true;
+}
 
-			/* If child's count value is not 0, then add the child's wighted score to this node's score */
-			score->score += ch_score->score;
-			score->weight += ch_score->weight;
+struct xccdf_scoring *xccdf_scoring_new(struct xccdf_item *benchmark, struct xccdf_result *test_result)
+{
+	struct xccdf_scoring *scoring = oscap_calloc(1, sizeof(struct xccdf_scoring));
+	scoring->rules = oscap_htable_new();
+	scoring->root = xccdf_scoring_node_new(scoring, benchmark, NULL);
+
+	if (test_result != NULL) {
+		struct xccdf_scoring_node *node;
+		struct xccdf_rule_result_iterator *rr_it = xccdf_result_get_rule_results(test_result);
+		while (xccdf_rule_result_iterator_has_more(rr_it))
+			xccdf_scoring_set_rule_result(scoring, xccdf_rule_result_iterator_next(rr_it), &node);
+		xccdf_rule_result_iterator_free(rr_it);
+	}
 
-			oscap_free(ch_score);
-		}
+	xccdf_scoring_node_compute(scoring->root);
+	return scoring;
+}
 
-		xccdf_item_iterator_free(child_it);
-	} break;
+void xccdf_scoring_free(struct xccdf_scoring *scoring)
+{
+	if (scoring == NULL)
+		return;
+	oscap_htable_free0(scoring->rules);
+	xccdf_scoring_node_free(scoring->root);
+	oscap_free(scoring);
+}
 
-	default: {
-		dE("Unsupported item type: %d", itype);
-		score=NULL;
-	} break;
+void xccdf_scoring_add_rule_result(struct xccdf_scoring *scoring, struct xccdf_rule_result *rule_result)
+{
+	struct xccdf_scoring_node *node;
+	if (!xccdf_scoring_set_rule_result(scoring, rule_result, &node))
+		return;
 
-	} /* switch */
-	return score;
+	// only the rule and its ancestors change
+	for (; node != NULL; node = node->parent)
+		xccdf_scoring_node_update(node);
 }
 
-struct xccdf_score *xccdf_result_calculate_score(struct xccdf_result *test_result, struct xccdf_item *benchmark, const char *score_system)
+struct xccdf_score *xccdf_scoring_get_score(const struct xccdf_scoring *scoring, const char *score_system)
 {
+	const struct xccdf_scoring_node *root = scoring->root;
 	struct xccdf_score *score = xccdf_score_new();
 	xccdf_score_set_system(score, score_system);
 	if (oscap_streq(score_system, "urn:xccdf:scoring:default")) {
-		struct xccdf_default_score * item_score = xccdf_item_get_default_score(benchmark, test_result);
-		xccdf_score_set_score(score, item_score->score);
-		oscap_free(item_score);
+		xccdf_score_set_score(score, root->def.score);
 	} else if (oscap_streq(score_system, "urn:xccdf:scoring:flat")) {
-		struct xccdf_flat_score * item_score = xccdf_item_get_flat_score(benchmark, test_result, false);
-		xccdf_score_set_maximum(score, item_score->weight);
-		xccdf_score_set_score(score, item_score->score);
-		oscap_free(item_score);
+		xccdf_score_set_maximum(score, root->flat.weight);
+		xccdf_score_set_score(score, root->flat.score);
 	} else if (oscap_streq(score_system, "urn:xccdf:scoring:flat-unweighted")) {
-		struct xccdf_flat_score * item_score = xccdf_item_get_flat_score(benchmark, test_result, true);
-		xccdf_score_set_maximum(score, item_score->weight);
-		xccdf_score_set_score(score, item_score->score);
-		oscap_free(item_score);
+		xccdf_score_set_maximum(score, root->unweighted.weight);
+		xccdf_score_set_score(score, root->unweighted.score);
 	} else if (oscap_streq(score_system, "urn:xccdf:scoring:absolute")) {
 		int absolute;
-		struct xccdf_flat_score * item_score = xccdf_item_get_flat_score(benchmark, test_result, false);
-		xccdf_score_set_maximum(score, item_score->weight);
-		absolute = (item_score->score == item_score->weight);
+		xccdf_score_set_maximum(score, root->flat.weight);
+		absolute = (root->flat.score == root->flat.weight);
 		xccdf_score_set_score(score, absolute);
-		oscap_free(item_score);
 	} else {
 		xccdf_score_free(score);
 		dE("Scoring system \"%s\" is not supported.", score_system);
@@ -281,22 +291,33 @@ struct xccdf_score *xccdf_result_calculate_score(struct xccdf_result *test_resul
 	return score;
 }
 
+struct xccdf_score *xccdf_result_calculate_score(struct xccdf_result *test_result, struct xccdf_item *benchmark, const char *score_system)
+{
+	struct xccdf_scoring *scoring = xccdf_scoring_new(benchmark, test_result);
+	struct xccdf_score *score = xccdf_scoring_get_score(scoring, score_system);
+	xccdf_scoring_free(scoring);
+	return score;
+}
+
 int xccdf_result_recalculate_scores(struct xccdf_result *result, struct xccdf_item *benchmark)
 {
+	/* all the scoring systems are read from a single computation */
+	struct xccdf_scoring *scoring = xccdf_scoring_new(benchmark, result);
 	struct oscap_list *new_scores = oscap_list_new();
 	struct xccdf_score_iterator *score_it = xccdf_result_get_scores(result);
 	while (xccdf_score_iterator_has_more(score_it)) {
 		struct xccdf_score *old = xccdf_score_iterator_next(score_it);
-		struct xccdf_score *new = xccdf_result_calculate_score(result, benchmark,
-			xccdf_score_get_system(old));
+		struct xccdf_score *new = xccdf_scoring_get_score(scoring, xccdf_score_get_system(old));
 		if (new == NULL) {
 			oscap_list_free(new_scores, (oscap_destruct_func) xccdf_score_free);
 			xccdf_score_iterator_free(score_it);
+			xccdf_scoring_free(scoring);
 			return 1;
 		}
 		oscap_list_add(new_scores, new);
 	}
 	xccdf_score_iterator_free(score_it);
+	xccdf_scoring_free(scoring);
 	oscap_list_free(((struct xccdf_item *)result)->sub.result.scores, (oscap_destruct_func) xccdf_score_free);
         ((struct xccdf_item *)result)->sub.result.scores = new_scores;
 	return 0;
@@ -42,5 +42,31 @@ OSCAP_HIDDEN_START;
  */
 struct xccdf_score *xccdf_result_calculate_score(struct xccdf_result *test_result, struct xccdf_item *benchmark, const char *score_system);
 
+/**
+ * Scores of an xccdf:TestResult in all the scoring models. They are computed
+ * in a single pass over the benchmark and then kept up to date as further
+ * rule-results are added, only the scores of the rule and its ancestors are
+ * computed again.
+ */
+struct xccdf_scoring;
+
+/**
+ * Compute the scores of the rule-results of the test result
+ * @param benchmark XCCDF Benchmark which is origin of given XCCDF TestResult
+ * @param test_result XCCDF TestResult, more rule-results may be added to it later, or NULL
+ */
+struct xccdf_scoring *xccdf_scoring_new(struct xccdf_item *benchmark, struct xccdf_result *test_result);
+void xccdf_scoring_free(struct xccdf_scoring *scoring);
+
+/**
+ * Count a new rule-result in, or update the scores after its result changed
+ */
+void xccdf_scoring_add_rule_result(struct xccdf_scoring *scoring, struct xccdf_rule_result *rule_result);
+
+/**
+ * Get the score of the test result in given scoring model, NULL if the model is not supported
+ */
+struct xccdf_score *xccdf_scoring_get_score(const struct xccdf_scoring *scoring, const char *score_system);
+
 OSCAP_HIDDEN_END;
 #endif
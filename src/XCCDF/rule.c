@@ -1025,7 +1025,7 @@ void xccdf_rule_to_dom(struct xccdf_rule *rule, xmlNode *rule_node, xmlDoc *doc,
 	xccdf_check_iterator_free(checks);
 }
 
-void xccdf_group_to_dom(struct xccdf_group *group, xmlNode *group_node, xmlDoc *doc, xmlNode *parent)
+void xccdf_group_to_dom(struct xccdf_group *group, xmlNode *group_node, xmlDoc *doc, xmlNode *parent, struct xml_stream *stream)
 {
 	const struct xccdf_version_info* version_info = xccdf_item_get_schema_version(XITEM(group));
 	xmlNs *ns_xccdf = lookup_xccdf_ns(doc, parent, version_info);
@@ -1081,11 +1081,15 @@ void xccdf_group_to_dom(struct xccdf_group *group, xmlNode *group_node, xmlDoc *
 	}
 	oscap_string_iterator_free(conflicts);
 
+	/* the group is complete up to its items, which are written one by one */
+	xml_stream_flush(stream, group_node);
+
         struct xccdf_value_iterator *values = xccdf_group_get_values(group);
 	while (xccdf_value_iterator_has_more(values)) {
 		struct xccdf_value *value = xccdf_value_iterator_next(values);
 		if (XGROUP(xccdf_value_get_parent(value)) == group) {
-			xccdf_item_to_dom((struct xccdf_item *)value, doc, group_node, version_info);
+			xmlNode *value_node = xccdf_item_to_dom((struct xccdf_item *)value, doc, group_node, version_info);
+			xml_stream_end(stream, value_node);
 		}
 	}
 	xccdf_value_iterator_free(values);
@@ -1094,7 +1098,8 @@ void xccdf_group_to_dom(struct xccdf_group *group, xmlNode *group_node, xmlDoc *
 	while (xccdf_item_iterator_has_more(items)) {
 		struct xccdf_item *item = xccdf_item_iterator_next(items);
 		if (XGROUP(xccdf_item_get_parent(item)) == group) {
-			xccdf_item_to_dom(item, doc, group_node, version_info);
+			xmlNode *item_node = xccdf_item_to_stream(item, doc, group_node, version_info, stream);
+			xml_stream_end(stream, item_node);
 		}
 	}
 	xccdf_item_iterator_free(items);
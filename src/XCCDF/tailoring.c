@@ -230,7 +230,14 @@ struct xccdf_tailoring *xccdf_tailoring_import(const char *file, struct xccdf_be
 	return tailoring;
 }
 
+static xmlNodePtr _xccdf_tailoring_to_dom(struct xccdf_tailoring *tailoring, xmlDocPtr doc, xmlNodePtr parent, const struct xccdf_version_info *version_info, struct xml_stream *stream);
+
 xmlNodePtr xccdf_tailoring_to_dom(struct xccdf_tailoring *tailoring, xmlDocPtr doc, xmlNodePtr parent, const struct xccdf_version_info *version_info)
+{
+	return _xccdf_tailoring_to_dom(tailoring, doc, parent, version_info, NULL);
+}
+
+static xmlNodePtr _xccdf_tailoring_to_dom(struct xccdf_tailoring *tailoring, xmlDocPtr doc, xmlNodePtr parent, const struct xccdf_version_info *version_info, struct xml_stream *stream)
 {
 	xmlNs *ns_tailoring = NULL;
 
@@ -344,14 +351,23 @@ xmlNodePtr xccdf_tailoring_to_dom(struct xccdf_tailoring *tailoring, xmlDocPtr d
 	}
 	oscap_string_iterator_free(metadata);
 
+	/*
+	 * The profiles are written one by one when streaming, unless the start
+	 * tag has to wait for the namespace of the 1.1 extension set below.
+	 */
+	struct xml_stream *profile_stream = ns_tailoring == ns_xccdf ? stream : NULL;
+	xml_stream_flush(profile_stream, tailoring_node);
+
 	struct xccdf_profile_iterator *profiles = xccdf_tailoring_get_profiles(tailoring);
 	while (xccdf_profile_iterator_has_more(profiles)) {
 		struct xccdf_profile *profile = xccdf_profile_iterator_next(profiles);
-		xccdf_item_to_dom(XITEM(profile), doc, tailoring_node, version_info);
+		xmlNode *profile_node = xccdf_item_to_dom(XITEM(profile), doc, tailoring_node, version_info);
+		xml_stream_end(profile_stream, profile_node);
 	}
 	xccdf_profile_iterator_free(profiles);
 
 	xmlSetNs(tailoring_node, ns_tailoring);
+	xml_stream_end(stream, tailoring_node);
 
 	return tailoring_node;
 }
@@ -362,15 +378,16 @@ int xccdf_tailoring_export(struct xccdf_tailoring *tailoring, const char *file,
 
 	LIBXML_TEST_VERSION;
 
-	xmlDocPtr doc = xmlNewDoc(BAD_CAST "1.0");
-	if (doc == NULL) {
-		oscap_setxmlerr(xmlGetLastError());
+	struct xml_stream *stream = xml_stream_new(file);
+	if (stream == NULL)
 		return -1;
-	}
 
-	xccdf_tailoring_to_dom(tailoring, doc, NULL, version_info);
+	if (_xccdf_tailoring_to_dom(tailoring, xml_stream_get_doc(stream), NULL, version_info, stream) == NULL) {
+		xml_stream_close(stream);
+		return -1;
+	}
 
-	return oscap_xml_save_filename_free(file, doc);
+	return xml_stream_close(stream) == 0 ? 1 : -1;
 }
 
 const char *xccdf_tailoring_get_id(const struct xccdf_tailoring *tailoring)
@@ -0,0 +1,330 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Built-in HTML report
+ *
+ * Written straight from the models of the session while they are walked,
+ * without serializing the results and running the XSLT stylesheet over
+ * them. The stylesheet remains the way to get a customized report.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "oval_agent_api.h"
+#include "oval_results.h"
+#include "xccdf_policy.h"
+#include "item.h"
+#include "helpers.h"
+#include "xccdf_impl.h"
+#include "common/_error.h"
+#include "common/alloc.h"
+#include "common/util.h"
+#include "common/list.h"
+
+static const char *oval_sysname = "http://oval.mitre.org/XMLSchema/oval-definitions-5";
+
+static const char *html_style =
+	"body{font-family:sans-serif;margin:2em;color:#222}"
+	"table{border-collapse:collapse;margin-bottom:1.5em}"
+	"th,td{border:1px solid #ccc;padding:.3em .6em;text-align:left;vertical-align:top}"
+	"th{background:#eee}"
+	".pass,.fixed{background:#dff0d8}"
+	".fail{background:#f2dede}"
+	".error,.unknown{background:#fcf8e3}"
+	".rule{border-top:1px solid #ccc;padding-top:.5em}"
+	".text{white-space:pre-line}"
+	"ul.oval{list-style:none;padding-left:1.2em}";
+
+/* the titles are kept escaped, as in the XML, only the other texts need this */
+static void _html_escape(FILE *f, const char *str)
+{
+	if (str == NULL)
+		return;
+
+	for (; *str != '\0'; ++str) {
+		switch (*str) {
+		case '&':
+			fputs("&amp;", f);
+			break;
+		case '<':
+			fputs("&lt;", f);
+			break;
+		case '>':
+			fputs("&gt;", f);
+			break;
+		case '"':
+			fputs("&quot;", f);
+			break;
+		default:
+			fputc(*str, f);
+		}
+	}
+}
+
+/* a row of the table of the result */
+static void _html_info_row(FILE *f, const char *name, const char *value)
+{
+	if (value == NULL)
+		return;
+
+	fprintf(f, "<tr><th>%s</th><td>", name);
+	_html_escape(f, value);
+	fputs("</td></tr>\n", f);
+}
+
+static void _html_oval_criteria(FILE *f, struct oval_result_criteria_node *node)
+{
+	const char *result = oval_result_get_text(oval_result_criteria_node_get_result(node));
+	const char *negate = oval_result_criteria_node_get_negate(node) ? "not " : "";
+
+	fprintf(f, "<li class=\"%s\">", result);
+
+	switch (oval_result_criteria_node_get_type(node)) {
+	case OVAL_NODETYPE_CRITERIA: {
+		fprintf(f, "%s%s: %s<ul class=\"oval\">\n", negate,
+			oval_operator_get_text(oval_result_criteria_node_get_operator(node)), result);
+
+		struct oval_result_criteria_node_iterator *subnodes = oval_result_criteria_node_get_subnodes(node);
+		while (oval_result_criteria_node_iterator_has_more(subnodes))
+			_html_oval_criteria(f, oval_result_criteria_node_iterator_next(subnodes));
+		oval_result_criteria_node_iterator_free(subnodes);
+
+		fputs("</ul>", f);
+		break;
+	}
+	case OVAL_NODETYPE_CRITERION: {
+		struct oval_test *test = oval_result_test_get_test(oval_result_criteria_node_get_test(node));
+
+		fprintf(f, "%stest ", negate);
+		_html_escape(f, oval_test_get_id(test));
+		fputs(" (", f);
+		_html_escape(f, oval_test_get_comment(test));
+		fprintf(f, "): %s", result);
+		break;
+	}
+	case OVAL_NODETYPE_EXTENDDEF:
+		fprintf(f, "%sdefinition ", negate);
+		_html_escape(f, oval_result_definition_get_id(oval_result_criteria_node_get_extends(node)));
+		fprintf(f, ": %s", result);
+		break;
+	default:
+		break;
+	}
+
+	fputs("</li>\n", f);
+}
+
+/* the criteria of the OVAL definition referenced by the check, if it was evaluated */
+static void _html_oval_details(FILE *f, struct xccdf_check *check, struct oval_agent_session **agents)
+{
+	if (agents == NULL || oscap_strcmp(xccdf_check_get_system(check), oval_sysname) != 0)
+		return;
+
+	struct xccdf_check_content_ref_iterator *refs = xccdf_check_get_content_refs(check);
+	while (xccdf_check_content_ref_iterator_has_more(refs)) {
+		struct xccdf_check_content_ref *ref = xccdf_check_content_ref_iterator_next(refs);
+		const char *name = xccdf_check_content_ref_get_name(ref);
+		const char *href = xccdf_check_content_ref_get_href(ref);
+
+		if (name == NULL)
+			continue;
+
+		for (int i = 0; agents[i] != NULL; ++i) {
+			if (oscap_strcmp(oval_agent_get_filename(agents[i]), href) != 0)
+				continue;
+
+			struct oval_result_system_iterator *systems =
+				oval_results_model_get_systems(oval_agent_get_results_model(agents[i]));
+			struct oval_result_definition *definition = NULL;
+			if (oval_result_system_iterator_has_more(systems))
+				definition = oval_result_system_get_definition(oval_result_system_iterator_next(systems), name);
+			oval_result_system_iterator_free(systems);
+
+			if (definition == NULL)
+				break;
+
+			fputs("<p>OVAL definition ", f);
+			_html_escape(f, name);
+			fprintf(f, ": %s</p>\n", oval_result_get_text(oval_result_definition_get_result(definition)));
+
+			struct oval_result_criteria_node *criteria = oval_result_definition_get_criteria(definition);
+			if (criteria != NULL) {
+				fputs("<ul class=\"oval\">\n", f);
+				_html_oval_criteria(f, criteria);
+				fputs("</ul>\n", f);
+			}
+			break;
+		}
+	}
+	xccdf_check_content_ref_iterator_free(refs);
+}
+
+/* the results of a multi-check rule follow each other, only the first one gets the id */
+static void _html_rule_result(FILE *f, struct xccdf_policy *policy, struct xccdf_benchmark *benchmark,
+		struct xccdf_rule_result *rule_result, struct oval_agent_session **agents, bool first)
+{
+	const char *idref = xccdf_rule_result_get_idref(rule_result);
+	const char *result = xccdf_test_result_type_get_text(xccdf_rule_result_get_result(rule_result));
+	struct xccdf_item *rule = xccdf_benchmark_get_item(benchmark, idref);
+	char *title = NULL;
+
+	fputs("<div class=\"rule\"", f);
+	if (first) {
+		fputs(" id=\"rule-", f);
+		_html_escape(f, idref);
+		fputs("\"", f);
+	}
+	fputs(">\n<h3>", f);
+	if (rule != NULL)
+		title = xccdf_policy_get_readable_item_title(policy, rule, NULL);
+	if (title != NULL && *title != '\0')
+		fputs(title, f);
+	else
+		_html_escape(f, idref);
+	oscap_free(title);
+	fputs("</h3>\n<table>\n", f);
+
+	_html_info_row(f, "Rule ID", idref);
+	fprintf(f, "<tr><th>Result</th><td class=\"%s\">%s</td></tr>\n", result, result);
+	_html_info_row(f, "Severity", oscap_enum_to_string(XCCDF_LEVEL_MAP, xccdf_rule_result_get_severity(rule_result)));
+	_html_info_row(f, "Time", xccdf_rule_result_get_time(rule_result));
+
+	struct xccdf_ident_iterator *idents = xccdf_rule_result_get_idents(rule_result);
+	while (xccdf_ident_iterator_has_more(idents)) {
+		struct xccdf_ident *ident = xccdf_ident_iterator_next(idents);
+
+		fputs("<tr><th>Identifier</th><td>", f);
+		_html_escape(f, xccdf_ident_get_id(ident));
+		fputs(" (", f);
+		_html_escape(f, xccdf_ident_get_system(ident));
+		fputs(")</td></tr>\n", f);
+	}
+	xccdf_ident_iterator_free(idents);
+
+	if (rule != NULL) {
+		char *description = xccdf_policy_get_readable_item_description(policy, rule, NULL);
+		if (description != NULL && *description != '\0') {
+			fputs("<tr><th>Description</th><td class=\"text\">", f);
+			_html_escape(f, description);
+			fputs("</td></tr>\n", f);
+		}
+		oscap_free(description);
+	}
+	fputs("</table>\n", f);
+
+	struct xccdf_check_iterator *checks = xccdf_rule_result_get_checks(rule_result);
+	while (xccdf_check_iterator_has_more(checks))
+		_html_oval_details(f, xccdf_check_iterator_next(checks), agents);
+	xccdf_check_iterator_free(checks);
+
+	fputs("</div>\n", f);
+}
+
+int xccdf_result_export_html(struct xccdf_policy *policy, struct xccdf_result *result,
+		struct oval_agent_session **agents, const char *file)
+{
+	struct xccdf_benchmark *benchmark = xccdf_policy_model_get_benchmark(xccdf_policy_get_model(policy));
+	unsigned int counts[XCCDF_RESULT_FIXED + 1] = { 0 };
+
+	FILE *f = fopen(file, "w");
+	if (f == NULL) {
+		oscap_seterr(OSCAP_EFAMILY_GLIBC, "%s '%s'", strerror(errno), file);
+		return -1;
+	}
+
+	struct oscap_text_iterator *titles = xccdf_item_get_title(XITEM(benchmark));
+	char *title = oscap_textlist_get_preferred_plaintext(titles, NULL);
+	oscap_text_iterator_free(titles);
+
+	fprintf(f, "<!DOCTYPE html>\n<html lang=\"en\">\n<head>\n<meta charset=\"utf-8\">\n"
+		"<title>OpenSCAP Evaluation Report</title>\n<style>%s</style>\n</head>\n<body>\n<h1>", html_style);
+	if (title != NULL)
+		fputs(title, f);
+	else
+		_html_escape(f, xccdf_benchmark_get_id(benchmark));
+	fputs("</h1>\n<table>\n", f);
+	oscap_free(title);
+
+	_html_info_row(f, "Benchmark", xccdf_benchmark_get_id(benchmark));
+	_html_info_row(f, "Profile", xccdf_result_get_profile(result));
+	_html_info_row(f, "Result ID", xccdf_result_get_id(result));
+	OSCAP_FOR_STR(target, xccdf_result_get_targets(result))
+		_html_info_row(f, "Target", target);
+	_html_info_row(f, "Test system", xccdf_result_get_test_system(result));
+	_html_info_row(f, "Started", xccdf_result_get_start_time(result));
+	_html_info_row(f, "Finished", xccdf_result_get_end_time(result));
+
+	struct xccdf_score_iterator *scores = xccdf_result_get_scores(result);
+	while (xccdf_score_iterator_has_more(scores)) {
+		struct xccdf_score *score = xccdf_score_iterator_next(scores);
+
+		fputs("<tr><th>Score</th><td>", f);
+		fprintf(f, "%.2f / %.2f (", xccdf_score_get_score(score), xccdf_score_get_maximum(score));
+		_html_escape(f, xccdf_score_get_system(score));
+		fputs(")</td></tr>\n", f);
+	}
+	xccdf_score_iterator_free(scores);
+	fputs("</table>\n", f);
+
+	struct xccdf_rule_result_iterator *rule_results = xccdf_result_get_rule_results(result);
+	while (xccdf_rule_result_iterator_has_more(rule_results)) {
+		xccdf_test_result_type_t type = xccdf_rule_result_get_result(xccdf_rule_result_iterator_next(rule_results));
+		if (type > 0 && type <= XCCDF_RESULT_FIXED)
+			counts[type]++;
+	}
+
+	fputs("<h2>Summary</h2>\n<table>\n<tr><th>Result</th><th>Rules</th></tr>\n", f);
+	for (int type = XCCDF_RESULT_PASS; type <= XCCDF_RESULT_FIXED; ++type) {
+		if (counts[type] > 0 && type != XCCDF_RESULT_NOT_SELECTED)
+			fprintf(f, "<tr><td class=\"%s\">%s</td><td>%u</td></tr>\n",
+				xccdf_test_result_type_get_text(type), xccdf_test_result_type_get_text(type), counts[type]);
+	}
+	fputs("</table>\n<h2>Rules</h2>\n", f);
+
+	/* the rules which weren't selected are left out, like the stylesheet does by default */
+	const char *last_idref = NULL;
+	xccdf_rule_result_iterator_reset(rule_results);
+	while (xccdf_rule_result_iterator_has_more(rule_results)) {
+		struct xccdf_rule_result *rule_result = xccdf_rule_result_iterator_next(rule_results);
+		const char *idref = xccdf_rule_result_get_idref(rule_result);
+
+		if (xccdf_rule_result_get_result(rule_result) != XCCDF_RESULT_NOT_SELECTED)
+			_html_rule_result(f, policy, benchmark, rule_result, agents, oscap_strcmp(idref, last_idref) != 0);
+		last_idref = idref;
+	}
+	xccdf_rule_result_iterator_free(rule_results);
+
+	fputs("</body>\n</html>\n", f);
+
+	int err = ferror(f);
+	if (fclose(f) != 0 || err) {
+		oscap_seterr(OSCAP_EFAMILY_GLIBC, "Could not write the report '%s'.", file);
+		return -1;
+	}
+
+	return 0;
+}
@@ -25,6 +25,7 @@
 #endif
 
 #include <libgen.h>
+#include <pthread.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -40,12 +41,14 @@
 #include "common/oscapxml.h"
 #include "common/_error.h"
 #include "common/debug_priv.h"
+#include "common/oscap_trace.h"
 #include "CPE/cpe_session_priv.h"
 #include "DS/public/scap_ds.h"
 #include "DS/public/ds_sds_session.h"
 #include "DS/ds_sds_session_priv.h"
 #include "DS/rds_priv.h"
 #include "OVAL/results/oval_results_impl.h"
+#include "source/oscap_source_priv.h"
 #include "source/xslt_priv.h"
 #include "XCCDF/xccdf_impl.h"
 #include "XCCDF_POLICY/public/xccdf_policy.h"
@@ -64,12 +67,16 @@ struct oval_content_resource {
 struct xccdf_session {
 	const char *filename;				///< File name of SCAP (SDS or XCCDF) file for this session.
 	struct oscap_source *source;                    ///< Main source assigned with the main file (SDS or XCCDF)
+	xmlDict *xml_dict;				///< Dictionary of the documents parsed by the thread of the session
 	char *temp_dir;					///< Temp directory used for decomposed component files.
 	struct {
 		struct oscap_source *source;            ///< oscap_source representing the XCCDF file
 		struct xccdf_policy_model *policy_model;///< Active policy model.
 		char *profile_id;			///< Last selected profile.
+		char **more_profile_ids;		///< Profiles evaluated with the selected one, NULL terminated.
 		struct xccdf_result *result;		///< XCCDF Result model.
+		struct xccdf_result **more_results;	///< XCCDF Result models of the more profiles.
+		bool lazy_texts;			///< Serialize the XHTML texts on demand
 		float base_score;			///< Basec score of the latest evaluation.
 		struct oscap_source *result_source;     ///< oscap_source for the exported XCCDF result
 	} xccdf;
@@ -89,11 +96,17 @@ struct xccdf_session {
 		char *product_cpe;			///< CPE of scanner product.
 		struct oscap_source* arf_report;	///< ARF report
 		struct oscap_htable *result_sources;    ///< mapping 'filepath' to oscap_source for OVAL results
+		unsigned int jobs;			///< Number of OVAL object queries in flight and of rule evaluation threads
+		bool lazy;				///< Parse OVAL definitions on demand
+		bool release_items;			///< Release the items of the evaluated tests
 	} oval;
 	struct {
 		char *arf_file;				///< Path to ARF file to export
+		char *arf_delta_file;			///< Path to the delta of the ARF file to export
+		char *arf_delta_baseline;		///< Path to the ARF file of a previous evaluation
 		char *xccdf_file;			///< Path to XCCDF file to export
 		char *report_file;			///< Path to HTML file to eport
+		bool report_native;			///< Write the report without the stylesheet
 		bool oval_results;			///< Shall be the OVAL results files exported?
 		bool oval_variables;			///< Shall be the OVAL variable files exported?
 		bool check_engine_plugins_results; ///< Shall the check engine plugins results be exported?
@@ -113,15 +126,31 @@ static int _xccdf_session_autonegotiate_tailoring_file(struct xccdf_session *ses
 static void _oval_content_resources_free(struct oval_content_resource **resources);
 static void _xccdf_session_free_oval_agents(struct xccdf_session *session);
 static void _xccdf_session_free_oval_result_sources(struct xccdf_session *session);
+static void _xccdf_session_free_more_profiles(struct xccdf_session *session);
 
 static const char *oscap_productname = "cpe:/a:open-scap:oscap";
 static const char *oval_sysname = "http://oval.mitre.org/XMLSchema/oval-definitions-5";
 
+/*
+ * The names and the short values repeat across the XCCDF, OVAL and CPE
+ * documents, the documents of the session store them in one dictionary.
+ * libxml2 doesn't lock the dictionary, so the documents parsed by the
+ * worker threads have their own.
+ */
+static struct oscap_source *_xccdf_session_source_new(struct xccdf_session *session, const char *filepath)
+{
+	struct oscap_source *source = oscap_source_new_from_file(filepath);
+
+	oscap_source_set_xml_dict(source, session->xml_dict);
+	return source;
+}
+
 struct xccdf_session *xccdf_session_new(const char *filename)
 {
 	struct xccdf_session *session = (struct xccdf_session *) oscap_calloc(1, sizeof(struct xccdf_session));
 
-	session->source = oscap_source_new_from_file(filename);
+	session->xml_dict = xmlDictCreate();
+	session->source = _xccdf_session_source_new(session, filename);
 	oscap_document_type_t document_type = oscap_source_get_scap_type(session->source);
 	if (document_type == OSCAP_DOCUMENT_UNKNOWN) {
 		xccdf_session_free(session);
@@ -182,7 +211,7 @@ static int _xccdf_session_autonegotiate_tailoring_file(struct xccdf_session *ses
 	oscap_free(original_path_cpy);
 	oscap_free(source_path);
 
-	struct oscap_source *real_source = oscap_source_new_from_file(real_source_path);
+	struct oscap_source *real_source = _xccdf_session_source_new(session, real_source_path);
 	oscap_free(real_source_path);
 
 	if (real_source == NULL) {
@@ -200,35 +229,55 @@ static int _xccdf_session_autonegotiate_tailoring_file(struct xccdf_session *ses
 
 static void xccdf_session_unload_check_engine_plugins(struct xccdf_session *session);
 
+/* the source data stream of the ARF, composed from a plain XCCDF when needed */
+static struct oscap_source *xccdf_session_get_sds_source(struct xccdf_session *session)
+{
+	if (xccdf_session_is_sds(session)) {
+		return session->source;
+	}
+
+	if (!session->temp_dir)
+		session->temp_dir = oscap_acquire_temp_dir();
+	if (session->temp_dir == NULL)
+		return NULL;
+
+	char *sds_path = malloc(PATH_MAX * sizeof(char));
+	snprintf(sds_path, PATH_MAX, "%s/sds.xml", session->temp_dir);
+	ds_sds_compose_from_xccdf(oscap_source_readable_origin(session->source), sds_path);
+	struct oscap_source *sds_source = _xccdf_session_source_new(session, sds_path);
+	free(sds_path);
+	return sds_source;
+}
+
 static struct oscap_source* xccdf_session_create_arf_source(struct xccdf_session *session)
 {
 	if (session->oval.arf_report != NULL) {
 		return session->oval.arf_report;
 	}
 
-	struct oscap_source *sds_source = NULL;
+	struct oscap_source *sds_source = xccdf_session_get_sds_source(session);
+	if (sds_source == NULL)
+		return NULL;
 
-	if (xccdf_session_is_sds(session)) {
-		sds_source = session->source;
+	session->oval.arf_report = ds_rds_create_source(sds_source, session->xccdf.result_source, session->oval.result_sources, session->export.arf_file);
+	if (!xccdf_session_is_sds(session)) {
+		oscap_source_free(sds_source);
 	}
-	else {
-		if (!session->temp_dir)
-			session->temp_dir = oscap_acquire_temp_dir();
-		if (session->temp_dir == NULL)
-			return NULL;
+	return session->oval.arf_report;
+}
 
-		char *sds_path = malloc(PATH_MAX * sizeof(char));
-		snprintf(sds_path, PATH_MAX, "%s/sds.xml", session->temp_dir);
-		ds_sds_compose_from_xccdf(oscap_source_readable_origin(session->source), sds_path);
-		sds_source = oscap_source_new_from_file(sds_path);
-		free(sds_path);
-	}
+/* write the ARF without building its DOM, the documents it is made of are already parsed */
+static int xccdf_session_stream_arf(struct xccdf_session *session)
+{
+	struct oscap_source *sds_source = xccdf_session_get_sds_source(session);
+	if (sds_source == NULL)
+		return -1;
 
-	session->oval.arf_report = ds_rds_create_source(sds_source, session->xccdf.result_source, session->oval.result_sources, session->export.arf_file);
+	int ret = ds_rds_create_stream(sds_source, session->xccdf.result_source, session->oval.result_sources, session->export.arf_file);
 	if (!xccdf_session_is_sds(session)) {
 		oscap_source_free(sds_source);
 	}
-	return session->oval.arf_report;
+	return ret;
 }
 
 void xccdf_session_free(struct xccdf_session *session)
@@ -236,9 +285,12 @@ void xccdf_session_free(struct xccdf_session *session)
 	if (session == NULL)
 		return;
 	oscap_free(session->xccdf.profile_id);
+	_xccdf_session_free_more_profiles(session);
 	oscap_free(session->export.xccdf_file);
 	oscap_free(session->export.report_file);
 	oscap_free(session->export.arf_file);
+	oscap_free(session->export.arf_delta_file);
+	oscap_free(session->export.arf_delta_baseline);
 	_xccdf_session_free_oval_result_sources(session);
 	xccdf_session_unload_check_engine_plugins(session);
 	oscap_list_free0(session->check_engine_plugins);
@@ -260,6 +312,8 @@ void xccdf_session_free(struct xccdf_session *session)
 	oscap_source_free(session->source);
 	oscap_source_free(session->tailoring.user_file);
 	oscap_free(session->tailoring.user_component_id);
+	if (session->xml_dict != NULL)
+		xmlDictFree(session->xml_dict);
 	oscap_free(session);
 }
 
@@ -328,7 +382,7 @@ void xccdf_session_set_user_tailoring_file(struct xccdf_session *session, const
 {
 	oscap_source_free(session->tailoring.user_file);
 	session->tailoring.user_file = user_tailoring_file != NULL ?
-		oscap_source_new_from_file(user_tailoring_file) : NULL;
+		_xccdf_session_source_new(session, user_tailoring_file) : NULL;
 }
 
 void xccdf_session_set_user_tailoring_cid(struct xccdf_session *session, const char *user_tailoring_cid)
@@ -342,6 +396,26 @@ void xccdf_session_set_custom_oval_eval_fn(struct xccdf_session *session, xccdf_
 	session->oval.user_eval_fn = eval_fn;
 }
 
+void xccdf_session_set_oval_jobs(struct xccdf_session *session, unsigned int jobs)
+{
+	session->oval.jobs = jobs;
+}
+
+void xccdf_session_set_oval_release_items(struct xccdf_session *session, bool release)
+{
+	session->oval.release_items = release;
+}
+
+void xccdf_session_set_oval_lazy_loading(struct xccdf_session *session, bool lazy)
+{
+	session->oval.lazy = lazy;
+}
+
+void xccdf_session_set_xccdf_lazy_texts(struct xccdf_session *session, bool lazy)
+{
+	session->xccdf.lazy_texts = lazy;
+}
+
 bool xccdf_session_set_product_cpe(struct xccdf_session *session, const char *product_cpe)
 {
 	oscap_free(session->oval.product_cpe);
@@ -376,6 +450,15 @@ bool xccdf_session_set_arf_export(struct xccdf_session *session, const char *arf
 	return true;
 }
 
+bool xccdf_session_set_arf_delta_export(struct xccdf_session *session, const char *baseline_file, const char *delta_file)
+{
+	oscap_free(session->export.arf_delta_baseline);
+	oscap_free(session->export.arf_delta_file);
+	session->export.arf_delta_baseline = oscap_strdup(baseline_file);
+	session->export.arf_delta_file = oscap_strdup(delta_file);
+	return true;
+}
+
 bool xccdf_session_set_xccdf_export(struct xccdf_session *session, const char *xccdf_file)
 {
 	oscap_free(session->export.xccdf_file);
@@ -390,12 +473,61 @@ bool xccdf_session_set_report_export(struct xccdf_session *session, const char *
 	return true;
 }
 
+void xccdf_session_set_report_native(struct xccdf_session *session, bool native)
+{
+	session->export.report_native = native;
+}
+
 bool xccdf_session_set_profile_id(struct xccdf_session *session, const char *profile_id)
 {
 	if (xccdf_policy_model_get_policy_by_id(session->xccdf.policy_model, profile_id) == NULL)
 		return false;
 	oscap_free(session->xccdf.profile_id);
 	session->xccdf.profile_id = oscap_strdup(profile_id);
+	_xccdf_session_free_more_profiles(session);
+	return true;
+}
+
+static void _xccdf_session_free_more_profiles(struct xccdf_session *session)
+{
+	if (session->xccdf.more_profile_ids != NULL) {
+		for (int i = 0; session->xccdf.more_profile_ids[i] != NULL; i++)
+			oscap_free(session->xccdf.more_profile_ids[i]);
+		oscap_free(session->xccdf.more_profile_ids);
+		session->xccdf.more_profile_ids = NULL;
+	}
+	// the results are owned by the policies
+	oscap_free(session->xccdf.more_results);
+	session->xccdf.more_results = NULL;
+}
+
+bool xccdf_session_set_profile_ids(struct xccdf_session *session, const char **profile_ids)
+{
+	int count = 0;
+
+	if (profile_ids == NULL || profile_ids[0] == NULL)
+		return xccdf_session_set_profile_id(session, NULL);
+
+	while (profile_ids[count] != NULL) {
+		if (xccdf_policy_model_get_policy_by_id(session->xccdf.policy_model, profile_ids[count]) == NULL)
+			return false;
+		count++;
+	}
+	if (!xccdf_session_set_profile_id(session, profile_ids[0]))
+		return false;
+	if (count == 1)
+		return true;
+
+	session->xccdf.more_profile_ids = oscap_calloc(count, sizeof(char *));
+	session->xccdf.more_results = oscap_calloc(count, sizeof(struct xccdf_result *));
+	for (int i = 1, n = 0; i < count; i++) {
+		// a repeated profile would give a TestResult with the same id
+		int j = 0;
+		while (j < i && strcmp(profile_ids[j], profile_ids[i]) != 0)
+			j++;
+		if (j == i)
+			session->xccdf.more_profile_ids[n++] = oscap_strdup(profile_ids[i]);
+	}
 	return true;
 }
 
@@ -490,7 +622,10 @@ static inline int _xccdf_session_load_xccdf_benchmark(struct xccdf_session *sess
 	}
 
 	/* Load XCCDF model and XCCDF Policy model */
-	struct xccdf_benchmark *benchmark = xccdf_benchmark_import_source(session->xccdf.source);
+	/* the session keeps the source until the policy model is freed */
+	struct xccdf_benchmark *benchmark = session->xccdf.lazy_texts ?
+		xccdf_benchmark_import_source_lazy(session->xccdf.source) :
+		xccdf_benchmark_import_source(session->xccdf.source);
 	if (benchmark == NULL) {
 		return 1;
 	}
@@ -536,7 +671,7 @@ static int _acquire_xccdf_checklist_from_tailoring(struct xccdf_session* session
 			*sep = '\0';
 		}
 
-		struct oscap_source *external_file = oscap_source_new_from_file(filename);
+		struct oscap_source *external_file = _xccdf_session_source_new(session, filename);
 		if (oscap_source_get_scap_type(external_file) == OSCAP_DOCUMENT_SDS) {
 			if (component_ref == NULL) {
 				oscap_seterr(OSCAP_EFAMILY_OSCAP,
@@ -626,7 +761,7 @@ int xccdf_session_load_cpe(struct xccdf_session *session)
 
 	/* Use custom CPE dict if given */
 	if (session->user_cpe != NULL) {
-		struct oscap_source *source = oscap_source_new_from_file(session->user_cpe);
+		struct oscap_source *source = _xccdf_session_source_new(session, session->user_cpe);
 		if (oscap_source_validate(source, _reporter, NULL) != 0) {
 			oscap_source_free(source);
 			return 1;
@@ -741,6 +876,34 @@ static int _xccdf_session_get_oval_from_model(struct xccdf_session *session)
 	resources[idx] = NULL;
 
 	files = xccdf_policy_model_get_systems_and_files(session->xccdf.policy_model);
+
+	// download the remote resources in parallel before loading them one by one
+	struct oscap_htable *downloads = NULL;
+	if (session->oval.fetch_remote_resources) {
+		const char **urls = malloc(sizeof(const char *));
+		size_t url_count = 0;
+
+		files_it = oscap_file_entry_list_get_files(files);
+		while (oscap_file_entry_iterator_has_more(files_it)) {
+			struct oscap_file_entry *file_entry = (struct oscap_file_entry *) oscap_file_entry_iterator_next(files_it);
+			const char *file = oscap_file_entry_get_file(file_entry);
+
+			if (strcmp(oscap_file_entry_get_system(file_entry), oval_sysname) != 0 || !oscap_acquire_url_is_supported(file))
+				continue;
+			if (xccdf_session_get_ds_sds_session(session) == NULL ||
+					ds_sds_session_get_component_by_href(xccdf_session_get_ds_sds_session(session), file) == NULL) {
+				urls[url_count++] = file;
+				urls = realloc(urls, (url_count + 1) * sizeof(const char *));
+			}
+		}
+		oscap_file_entry_iterator_free(files_it);
+		urls[url_count] = NULL;
+
+		if (url_count > 1)
+			downloads = oscap_acquire_url_download_all(urls);
+		free(urls);
+	}
+
 	files_it = oscap_file_entry_list_get_files(files);
 	while (oscap_file_entry_iterator_has_more(files_it)) {
 		struct oscap_file_entry *file_entry;
@@ -784,7 +947,7 @@ static int _xccdf_session_get_oval_from_model(struct xccdf_session *session)
 					session->oval.progress(false, "Downloading: %s ... ", printable_path);
 
 					size_t data_size;
-					char *data = oscap_acquire_url_download(printable_path, &data_size);
+					char *data = oscap_acquire_url_download_take(downloads, printable_path, &data_size);
 					if (data == NULL) {
 						session->oval.progress(false, "error\n");
 					} else {
@@ -815,6 +978,7 @@ static int _xccdf_session_get_oval_from_model(struct xccdf_session *session)
 	}
 	oscap_file_entry_iterator_free(files_it);
 	oscap_file_entry_list_free(files);
+	oscap_acquire_url_downloads_free(downloads);
 	free(xccdf_path_cpy);
 	session->oval.resources = resources;
 	return 0;
@@ -833,9 +997,98 @@ static void _xccdf_session_free_oval_agents(struct xccdf_session *session)
 	}
 }
 
+/*
+ * The OVAL documents are independent of each other, so they are parsed,
+ * validated and imported by worker threads. Every document is imported by
+ * one worker; the errors it sets on the queue of its thread are moved to
+ * the job and set again by the caller in the order of the documents.
+ */
+struct _oval_import_job {
+	struct oval_content_resource *content;
+	struct oval_definition_model *model;
+	bool invalid;				///< The validation failed.
+	char *error;				///< The errors of the worker thread.
+};
+
+struct _oval_import_queue {
+	struct _oval_import_job *jobs;
+	int count;
+	int next;				///< The next job to take.
+	bool validate;
+	bool lazy;
+	bool threaded;
+	xmlDict *dict;				///< The dictionary of the session.
+};
+
+static void *_xccdf_session_oval_import_worker(void *arg)
+{
+	struct _oval_import_queue *queue = arg;
+	int idx;
+
+	while ((idx = __atomic_fetch_add(&queue->next, 1, __ATOMIC_RELAXED)) < queue->count) {
+		struct _oval_import_job *job = &queue->jobs[idx];
+		struct oscap_source *source = job->content->source;
+
+		if (queue->validate && oscap_source_validate(source, _reporter, NULL) != 0)
+			job->invalid = true;
+		else
+			job->model = queue->lazy ?
+				oval_definition_model_import_source_lazy(source) :
+				oval_definition_model_import_source(source);
+
+		if (queue->threaded && oscap_err())
+			job->error = oscap_err_get_full_error();
+	}
+	return NULL;
+}
+
+static void _xccdf_session_import_oval(struct _oval_import_queue *queue)
+{
+	long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	int nthreads = ncpus < queue->count ? (int) ncpus : queue->count;
+	pthread_t *threads;
+	int started = 0;
+
+	/*
+	 * The components of a data stream are subtrees moved out of the DOM of
+	 * the data stream when they are asked for, which can't be done by more
+	 * threads at once. Take them and detect the document types here, the
+	 * workers then only read the sources they share.
+	 */
+	for (int idx = 0; idx < queue->count; idx++) {
+		struct oscap_source *source = queue->jobs[idx].content->source;
+		if (!queue->jobs[idx].content->source_owned)
+			oscap_source_get_xmlDoc(source);
+		else if (nthreads <= 1)
+			oscap_source_set_xml_dict(source, queue->dict);
+		oscap_source_get_schema_version(source);
+	}
+
+	if (nthreads > 1) {
+		threads = oscap_calloc(nthreads, sizeof(pthread_t));
+		queue->threaded = true;
+		for (int i = 0; i < nthreads; i++) {
+			if (pthread_create(&threads[started], NULL, _xccdf_session_oval_import_worker, queue) == 0)
+				started++;
+		}
+		// the calling thread takes the jobs left when no worker could start
+		if (started == 0)
+			queue->threaded = false;
+		dI("Importing %d OVAL documents by %d threads.", queue->count, started);
+	}
+	if (started == 0)
+		_xccdf_session_oval_import_worker(queue);
+	for (int i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+	if (nthreads > 1)
+		oscap_free(threads);
+}
+
 int xccdf_session_load_oval(struct xccdf_session *session)
 {
 	struct oval_content_resource **contents = NULL;
+	struct _oval_import_queue queue = { 0 };
+	int ret = 0;
 
 	_xccdf_session_free_oval_agents(session);
 
@@ -848,28 +1101,50 @@ int xccdf_session_load_oval(struct xccdf_session *session)
 
 	contents = session->oval.custom_resources != NULL ? session->oval.custom_resources : session->oval.resources;
 
+	while (contents[queue.count])
+		queue.count++;
+	queue.jobs = oscap_calloc(queue.count + 1, sizeof(struct _oval_import_job));
+	for (int idx = 0; idx < queue.count; idx++)
+		queue.jobs[idx].content = contents[idx];
 	/* Validate OVAL files. Only validate if the file doesn't come from a datastream
 	 * or if full validation was explicitly requested.
 	 */
-	if (session->validate && (!xccdf_session_is_sds(session) || session->full_validation)) {
-		for (int idx=0; contents[idx]; idx++) {
-			if (oscap_source_validate(contents[idx]->source, _reporter, NULL) != 0) {
-				oscap_seterr(OSCAP_EFAMILY_OSCAP, "Invalid %s (%s) content in %s",
-						oscap_document_type_to_string(oscap_source_get_scap_type(session->source)),
-						oscap_source_get_schema_version(session->source),
-						contents[idx]->href);
-				return 1;
-			}
+	queue.validate = session->validate && (!xccdf_session_is_sds(session) || session->full_validation);
+	queue.lazy = session->oval.lazy;
+	queue.dict = session->xml_dict;
+
+	_xccdf_session_import_oval(&queue);
+
+	for (int idx = 0; idx < queue.count; idx++) {
+		struct _oval_import_job *job = &queue.jobs[idx];
+
+		if (ret != 0) {
+			/* the documents after a failed one are dropped */
+			if (job->model != NULL)
+				oval_definition_model_free(job->model);
+			oscap_free(job->error);
+			continue;
+		}
+		if (job->error != NULL)
+			oscap_seterr(OSCAP_EFAMILY_OSCAP, "%s", job->error);
+		oscap_free(job->error);
+
+		if (job->invalid) {
+			oscap_seterr(OSCAP_EFAMILY_OSCAP, "Invalid %s (%s) content in %s",
+					oscap_document_type_to_string(oscap_source_get_scap_type(session->source)),
+					oscap_source_get_schema_version(session->source),
+					contents[idx]->href);
+			ret = 1;
+			continue;
 		}
-	}
 
-	for (int idx=0; contents[idx]; idx++) {
 		/* file -> def_model */
-		struct oval_definition_model *tmp_def_model = oval_definition_model_import_source(contents[idx]->source);
+		struct oval_definition_model *tmp_def_model = job->model;
 		if (tmp_def_model == NULL) {
 			oscap_seterr(OSCAP_EFAMILY_OSCAP, "Failed to create OVAL definition model from: '%s'.",
 				oscap_source_readable_origin(contents[idx]->source));
-			return 1;
+			ret = 1;
+			continue;
 		}
 
 		/* def_model -> session */
@@ -877,12 +1152,15 @@ int xccdf_session_load_oval(struct xccdf_session *session)
 		if (tmp_sess == NULL) {
 			oscap_seterr(OSCAP_EFAMILY_OSCAP, "Failed to create new OVAL agent session for: '%s'.", contents[idx]->href);
 			oval_definition_model_free(tmp_def_model);
-			return 2;
+			ret = 2;
+			continue;
 		}
 
 		/* store our name in the generated documents */
 		oval_agent_set_product_name(tmp_sess, session->oval.product_cpe != NULL ?
 				session->oval.product_cpe : (char *) oscap_productname);
+		oval_agent_set_jobs(tmp_sess, session->oval.jobs);
+		oval_agent_set_release_items(tmp_sess, session->oval.release_items);
 
 		/* remember sessions */
 		session->oval.agents = realloc(session->oval.agents, (idx + 2) * sizeof(struct oval_agent_session *));
@@ -897,7 +1175,8 @@ int xccdf_session_load_oval(struct xccdf_session *session)
 		else
 			xccdf_policy_model_register_engine_oval(session->xccdf.policy_model, tmp_sess);
 	}
-	return 0;
+	oscap_free(queue.jobs);
+	return ret;
 }
 
 int xccdf_session_load_check_engine_plugin(struct xccdf_session *session, const char *plugin_name)
@@ -1008,44 +1287,132 @@ int xccdf_session_load_tailoring(struct xccdf_session *session)
 	return xccdf_policy_model_set_tailoring(session->xccdf.policy_model, tailoring) ? 0 : 1;
 }
 
-int xccdf_session_evaluate(struct xccdf_session *session)
+static struct xccdf_result *_xccdf_session_evaluate_policy(struct xccdf_session *session, struct xccdf_policy *policy, float *base_score)
 {
-	struct xccdf_policy *policy = xccdf_session_get_xccdf_policy(session);
-	if (policy == NULL) {
-		oscap_seterr(OSCAP_EFAMILY_OSCAP, "Cannot build xccdf_policy.");
-		return 1;
-	}
-
-	session->xccdf.result = xccdf_policy_evaluate(policy);
-	if (session->xccdf.result == NULL)
-		return 1;
+	struct xccdf_result *result = xccdf_policy_evaluate(policy);
+	if (result == NULL)
+		return NULL;
 
 	/* Write results into XCCDF Test Result model */
-	xccdf_result_set_benchmark_uri(session->xccdf.result, oscap_source_readable_origin(session->source));
+	xccdf_result_set_benchmark_uri(result, oscap_source_readable_origin(session->source));
 	struct oscap_text *title = oscap_text_new();
 	oscap_text_set_text(title, "OSCAP Scan Result");
-	xccdf_result_add_title(session->xccdf.result, title);
+	xccdf_result_add_title(result, title);
 	struct xccdf_benchmark *benchmark = xccdf_policy_get_benchmark(policy);
-	xccdf_result_set_version(session->xccdf.result,
+	xccdf_result_set_version(result,
 			benchmark != NULL ? xccdf_benchmark_get_version(benchmark) : NULL);
 
-	xccdf_result_fill_sysinfo(session->xccdf.result);
+	xccdf_result_fill_sysinfo(result);
 
 	struct xccdf_model_iterator *model_it = xccdf_benchmark_get_models(xccdf_policy_model_get_benchmark(session->xccdf.policy_model));
 	while (xccdf_model_iterator_has_more(model_it)) {
 		struct xccdf_model *model = xccdf_model_iterator_next(model_it);
 		const char *score_model = xccdf_model_get_system(model);
-		struct xccdf_score *score = xccdf_policy_get_score(policy, session->xccdf.result, score_model);
-		xccdf_result_add_score(session->xccdf.result, score);
+		struct xccdf_score *score = xccdf_policy_get_score(policy, result, score_model);
+		xccdf_result_add_score(result, score);
 
 		/* record default base score for later use */
-		if (!strcmp(score_model, "urn:xccdf:scoring:default"))
-			session->xccdf.base_score = xccdf_score_get_score(score);
+		if (base_score != NULL && !strcmp(score_model, "urn:xccdf:scoring:default"))
+			*base_score = xccdf_score_get_score(score);
 	}
 	xccdf_model_iterator_free(model_it);
+	return result;
+}
+
+int xccdf_session_evaluate(struct xccdf_session *session)
+{
+	struct xccdf_policy *policy = xccdf_session_get_xccdf_policy(session);
+	if (policy == NULL) {
+		oscap_seterr(OSCAP_EFAMILY_OSCAP, "Cannot build xccdf_policy.");
+		return 1;
+	}
+
+	xccdf_policy_model_set_jobs(session->xccdf.policy_model, session->oval.jobs);
+	session->xccdf.result = _xccdf_session_evaluate_policy(session, policy, &session->xccdf.base_score);
+	if (session->xccdf.result == NULL)
+		return 1;
+
+	/* The OVAL agents and their collected objects are shared by the policies,
+	 * so the more profiles only evaluate the definitions they don't share
+	 * with the ones evaluated before. */
+	for (int i = 0; session->xccdf.more_profile_ids != NULL && session->xccdf.more_profile_ids[i] != NULL; i++) {
+		policy = xccdf_policy_model_get_policy_by_id(session->xccdf.policy_model, session->xccdf.more_profile_ids[i]);
+		if (policy == NULL) {
+			oscap_seterr(OSCAP_EFAMILY_OSCAP, "Cannot build xccdf_policy for profile '%s'.", session->xccdf.more_profile_ids[i]);
+			return 1;
+		}
+		session->xccdf.more_results[i] = _xccdf_session_evaluate_policy(session, policy, NULL);
+		if (session->xccdf.more_results[i] == NULL)
+			return 1;
+	}
 	return 0;
 }
 
+/* remove the result from its policy and the copy added to the benchmark by the export */
+static void _xccdf_session_remove_result(struct xccdf_session *session, struct xccdf_result *result)
+{
+	const char *id = xccdf_result_get_id(result);
+	struct xccdf_result_iterator *result_it = xccdf_benchmark_get_results(xccdf_policy_model_get_benchmark(session->xccdf.policy_model));
+	while (xccdf_result_iterator_has_more(result_it)) {
+		if (oscap_streq(xccdf_result_get_id(xccdf_result_iterator_next(result_it)), id))
+			xccdf_result_iterator_remove(result_it);
+	}
+	xccdf_result_iterator_free(result_it);
+
+	struct xccdf_policy_iterator *policy_it = xccdf_policy_model_get_policies(session->xccdf.policy_model);
+	while (xccdf_policy_iterator_has_more(policy_it)) {
+		result_it = xccdf_policy_get_results(xccdf_policy_iterator_next(policy_it));
+		while (xccdf_result_iterator_has_more(result_it)) {
+			if (xccdf_result_iterator_next(result_it) == result)
+				xccdf_result_iterator_remove(result_it);
+		}
+		xccdf_result_iterator_free(result_it);
+	}
+	xccdf_policy_iterator_free(policy_it);
+}
+
+int xccdf_session_reset(struct xccdf_session *session)
+{
+	int ret = 0;
+
+	if (session->xccdf.result != NULL) {
+		_xccdf_session_remove_result(session, session->xccdf.result);
+		session->xccdf.result = NULL;
+	}
+	for (int i = 0; session->xccdf.more_profile_ids != NULL && session->xccdf.more_profile_ids[i] != NULL; i++) {
+		if (session->xccdf.more_results[i] != NULL) {
+			_xccdf_session_remove_result(session, session->xccdf.more_results[i]);
+			session->xccdf.more_results[i] = NULL;
+		}
+	}
+	session->xccdf.base_score = 0;
+
+	oscap_source_free(session->xccdf.result_source);
+	session->xccdf.result_source = NULL;
+	oscap_source_free(session->oval.arf_report);
+	session->oval.arf_report = NULL;
+	_xccdf_session_free_oval_result_sources(session);
+
+	oscap_free(session->export.xccdf_file);
+	oscap_free(session->export.report_file);
+	oscap_free(session->export.arf_file);
+	oscap_free(session->export.arf_delta_file);
+	oscap_free(session->export.arf_delta_baseline);
+	session->export.xccdf_file = NULL;
+	session->export.report_file = NULL;
+	session->export.arf_file = NULL;
+	session->export.arf_delta_file = NULL;
+	session->export.arf_delta_baseline = NULL;
+
+	if (session->oval.agents != NULL) {
+		for (int i = 0; session->oval.agents[i]; i++) {
+			if (oval_agent_clear_session(session->oval.agents[i]) != 0)
+				ret = 1;
+		}
+	}
+	return ret;
+}
+
 static size_t _paramlist_size(const char **p) { size_t s = 0; if (!p) return s; while (p[s]) s += 2; return s; }
 
 static size_t _paramlist_cpy(const char **to, const char **p) {
@@ -1096,7 +1463,8 @@ static int _build_xccdf_result_source(struct xccdf_session *session)
 	}
 
 	/* Build oscap_source of XCCDF TestResult only when needed */
-	if (session->export.xccdf_file != NULL || session->export.report_file != NULL || session->export.arf_file != NULL) {
+	if (session->export.xccdf_file != NULL || session->export.arf_file != NULL ||
+	    (session->export.report_file != NULL && !session->export.report_native)) {
 		if (session->xccdf.result == NULL) {
 			// Attempt to export session before evaluation
 			oscap_seterr(OSCAP_EFAMILY_OSCAP, "No XCCDF results to export.");
@@ -1104,6 +1472,12 @@ static int _build_xccdf_result_source(struct xccdf_session *session)
 		}
 		xccdf_benchmark_add_result(xccdf_policy_model_get_benchmark(session->xccdf.policy_model),
 				xccdf_result_clone(session->xccdf.result));
+		// every TestResult becomes a report of the ARF
+		for (int i = 0; session->xccdf.more_profile_ids != NULL && session->xccdf.more_profile_ids[i] != NULL; i++) {
+			if (session->xccdf.more_results[i] != NULL)
+				xccdf_benchmark_add_result(xccdf_policy_model_get_benchmark(session->xccdf.policy_model),
+						xccdf_result_clone(session->xccdf.more_results[i]));
+		}
 		session->xccdf.result_source = xccdf_benchmark_export_source(
 				xccdf_policy_model_get_benchmark(session->xccdf.policy_model), session->export.xccdf_file);
 
@@ -1128,7 +1502,20 @@ static int _build_xccdf_result_source(struct xccdf_session *session)
 	return 0;
 }
 
-int xccdf_session_export_xccdf(struct xccdf_session *session)
+static int _xccdf_session_export_traced(struct xccdf_session *session, const char *name,
+					int (*export)(struct xccdf_session *))
+{
+	struct oscap_trace_span span;
+	int ret;
+
+	oscap_trace_begin(&span, name);
+	ret = export(session);
+	oscap_trace_end(&span, NULL);
+
+	return ret;
+}
+
+static int _xccdf_session_export_xccdf(struct xccdf_session *session)
 {
 	if (_build_xccdf_result_source(session)) {
 		return 1;
@@ -1137,6 +1524,15 @@ int xccdf_session_export_xccdf(struct xccdf_session *session)
 	if (session->export.report_file == NULL)
 		return 0;
 
+	if (session->export.report_native) {
+		if (session->xccdf.result == NULL) {
+			oscap_seterr(OSCAP_EFAMILY_OSCAP, "No XCCDF results to export.");
+			return 1;
+		}
+		return xccdf_result_export_html(xccdf_session_get_xccdf_policy(session),
+				session->xccdf.result, session->oval.agents, session->export.report_file) == 0 ? 0 : 1;
+	}
+
 	struct oscap_source* results = session->xccdf.result_source;
 	struct oscap_source* arf = NULL;
 	if (session->export.oval_results) {
@@ -1159,6 +1555,11 @@ int xccdf_session_export_xccdf(struct xccdf_session *session)
 	return 0;
 }
 
+int xccdf_session_export_xccdf(struct xccdf_session *session)
+{
+	return _xccdf_session_export_traced(session, "xccdf_session_export_xccdf", &_xccdf_session_export_xccdf);
+}
+
 static void _xccdf_session_free_oval_result_sources(struct xccdf_session *session)
 {
 	if (session->oval.result_sources != NULL) {
@@ -1327,7 +1728,7 @@ static int _build_oval_result_sources(struct xccdf_session *session)
 	return 0;
 }
 
-int xccdf_session_export_oval(struct xccdf_session *session)
+static int _xccdf_session_export_oval(struct xccdf_session *session)
 {
 	if ((session->export.oval_results || session->export.arf_file != NULL) && session->oval.agents) {
 		if (_build_oval_result_sources(session) != 0) {
@@ -1380,7 +1781,12 @@ int xccdf_session_export_oval(struct xccdf_session *session)
 	return 0;
 }
 
-int xccdf_session_export_check_engine_plugins(struct xccdf_session *session)
+int xccdf_session_export_oval(struct xccdf_session *session)
+{
+	return _xccdf_session_export_traced(session, "xccdf_session_export_oval", &_xccdf_session_export_oval);
+}
+
+static int _xccdf_session_export_check_engine_plugins(struct xccdf_session *session)
 {
 	if (!session->export.check_engine_plugins_results)
 		return 0;
@@ -1404,14 +1810,38 @@ int xccdf_session_export_check_engine_plugins(struct xccdf_session *session)
 	return ret;
 }
 
+int xccdf_session_export_check_engine_plugins(struct xccdf_session *session)
+{
+	return _xccdf_session_export_traced(session, "xccdf_session_export_check_engine_plugins", &_xccdf_session_export_check_engine_plugins);
+}
+
 int xccdf_session_export_sce(struct xccdf_session *session)
 {
 	return xccdf_session_export_check_engine_plugins(session);
 }
 
-int xccdf_session_export_arf(struct xccdf_session *session)
+static int _xccdf_session_export_arf_delta(struct xccdf_session *session)
+{
+	if (session->export.arf_delta_file == NULL)
+		return 0;
+
+	/* the ARF may have been streamed to the file without building its DOM */
+	struct oscap_source *arf = oscap_source_new_from_file(session->export.arf_file);
+	int ret = oscap_source_save_delta_as(arf, session->export.arf_delta_baseline, session->export.arf_delta_file);
+	oscap_source_free(arf);
+	return ret == 0 ? 0 : 1;
+}
+
+static int _xccdf_session_export_arf(struct xccdf_session *session)
 {
 	if (session->export.arf_file != NULL) {
+		/* the validation needs the DOM, so does the HTML report that may have built it already */
+		if (session->oval.arf_report == NULL && !session->full_validation) {
+			if (xccdf_session_stream_arf(session) != 0)
+				return 1;
+			return _xccdf_session_export_arf_delta(session);
+		}
+
 		struct oscap_source* arf_source = xccdf_session_create_arf_source(session);
 		if (arf_source == NULL) {
 			return 1;
@@ -1428,10 +1858,16 @@ int xccdf_session_export_arf(struct xccdf_session *session)
 				return 1;
 			}
 		}
+		return _xccdf_session_export_arf_delta(session);
 	}
 	return 0;
 }
 
+int xccdf_session_export_arf(struct xccdf_session *session)
+{
+	return _xccdf_session_export_traced(session, "xccdf_session_export_arf", &_xccdf_session_export_arf);
+}
+
 OSCAP_GENERIC_GETTER(struct xccdf_policy_model *, xccdf_session, policy_model, xccdf.policy_model)
 OSCAP_GENERIC_GETTER(float, xccdf_session, base_score, xccdf.base_score);
 
@@ -1471,9 +1907,9 @@ unsigned int xccdf_session_get_cpe_oval_agents_count(const struct xccdf_session
 	return i;
 }
 
-bool xccdf_session_contains_fail_result(const struct xccdf_session *session)
+static bool _xccdf_result_contains_fail(struct xccdf_result *result)
 {
-	struct xccdf_rule_result_iterator *res_it = xccdf_result_get_rule_results(session->xccdf.result);
+	struct xccdf_rule_result_iterator *res_it = xccdf_result_get_rule_results(result);
 	while (xccdf_rule_result_iterator_has_more(res_it)) {
 		struct xccdf_rule_result *res = xccdf_rule_result_iterator_next(res_it);
 		xccdf_test_result_type_t rule_result = xccdf_rule_result_get_result(res);
@@ -1488,6 +1924,17 @@ bool xccdf_session_contains_fail_result(const struct xccdf_session *session)
 	return false;
 }
 
+bool xccdf_session_contains_fail_result(const struct xccdf_session *session)
+{
+	if (_xccdf_result_contains_fail(session->xccdf.result))
+		return true;
+	for (int i = 0; session->xccdf.more_profile_ids != NULL && session->xccdf.more_profile_ids[i] != NULL; i++) {
+		if (session->xccdf.more_results[i] != NULL && _xccdf_result_contains_fail(session->xccdf.more_results[i]))
+			return true;
+	}
+	return false;
+}
+
 int xccdf_session_remediate(struct xccdf_session *session)
 {
 	int res = 0;
@@ -69,8 +69,21 @@ struct xccdf_policy_iterator;
  */
 typedef enum {
 	POLICY_ENGINE_QUERY_NAMES_FOR_HREF = 1,		/// Considering xccdf:check-content-ref, what are possible @name attributes for given href?
+	POLICY_ENGINE_QUERY_PREFETCH = 2,		/// Start collecting what the check-content-refs of the selected rules need, before they are evaluated.
+	POLICY_ENGINE_QUERY_CONCURRENT = 3,		/// May the eval function be called by several threads at the same time?
+	POLICY_ENGINE_QUERY_SUBMIT = 4,			/// Evaluate the check of a selected rule asynchronously.
+	POLICY_ENGINE_QUERY_ASYNC = 5,			/// May the checks be submitted to the engine (see POLICY_ENGINE_QUERY_SUBMIT)?
 } xccdf_policy_engine_query_t;
 
+/**
+ * The check-content-refs with the same href of all the selected rules,
+ * the data of the POLICY_ENGINE_QUERY_PREFETCH query.
+ */
+struct xccdf_policy_prefetch {
+	const char *href;                ///< check-content-ref/@href
+	struct oscap_stringlist *names;  ///< check-content-ref/@name attributes, NULL if the whole content is referenced
+};
+
 /**
  * Type of function which implements queries defined within xccdf_policy_engine_query_t.
  *
@@ -80,13 +93,64 @@ typedef enum {
  * is always user data as registered. Second argument defines the query. Third argument is
  * dependent on query and defined as follows:
  *  - (const char *)href -- for POLICY_ENGINE_QUERY_NAMES_FOR_HREF
+ *  - (struct xccdf_policy_prefetch *) -- for POLICY_ENGINE_QUERY_PREFETCH
+ *  - NULL -- for POLICY_ENGINE_QUERY_CONCURRENT
+ *  - (struct xccdf_policy_async_check *) -- for POLICY_ENGINE_QUERY_SUBMIT
+ *  - NULL -- for POLICY_ENGINE_QUERY_ASYNC
  *
  * Expected return type depends also on query as follows:
  *  - (struct oscap_stringlists *) -- for POLICY_ENGINE_QUERY_NAMES_FOR_HREF
+ *  - NULL -- for POLICY_ENGINE_QUERY_PREFETCH, the engine collects what it can and the rules are evaluated as usual
+ *  - any non-NULL pointer (not freed) -- for POLICY_ENGINE_QUERY_CONCURRENT, if the eval function is reentrant
+ *    and uses the policy read-only, see xccdf_policy_model_set_jobs()
+ *  - any non-NULL pointer (not freed) -- for POLICY_ENGINE_QUERY_SUBMIT, if the engine took the check
+ *    over and will call xccdf_policy_async_check_complete() for it
+ *  - any non-NULL pointer (not freed) -- for POLICY_ENGINE_QUERY_ASYNC, if the engine takes checks over,
+ *    only such engines get the POLICY_ENGINE_QUERY_SUBMIT query
  *  - NULL shall be returned if the function doesn't understand the query.
  */
 typedef void *(*xccdf_policy_engine_query_fn) (void *, xccdf_policy_engine_query_t, void *);
 
+/**
+ * @struct xccdf_policy_async_check
+ * The simple check of a selected rule, the data of the POLICY_ENGINE_QUERY_SUBMIT query.
+ *
+ * Before the rules are evaluated, the checks of the selected rules are offered to the
+ * engines of their checking systems one by one, so an engine which takes them over
+ * learns all of them up front and may run them in any order and in parallel. The engine
+ * calls xccdf_policy_async_check_complete() exactly once for every check it took, from
+ * any thread and possibly before the query returns; the check is valid until then. The
+ * engine may read the policy while the rules are evaluated, but must not modify it.
+ * The rules are still reported in the document order, the evaluation of a rule waits
+ * for its check. A check completed as XCCDF_RESULT_NOT_CHECKED is evaluated again the
+ * usual way, by the eval functions of all the engines of its system.
+ */
+struct xccdf_policy_async_check;
+
+/// @memberof xccdf_policy_async_check
+struct xccdf_policy *xccdf_policy_async_check_get_policy(const struct xccdf_policy_async_check *check);
+/// @memberof xccdf_policy_async_check
+const char *xccdf_policy_async_check_get_rule_id(const struct xccdf_policy_async_check *check);
+/// check-content-ref/@name, NULL if the whole content is referenced
+/// @memberof xccdf_policy_async_check
+const char *xccdf_policy_async_check_get_name(const struct xccdf_policy_async_check *check);
+/// check-content-ref/@href
+/// @memberof xccdf_policy_async_check
+const char *xccdf_policy_async_check_get_href(const struct xccdf_policy_async_check *check);
+/// the values exported to the check, the iterator is freed by the caller
+/// @memberof xccdf_policy_async_check
+struct xccdf_value_binding_iterator *xccdf_policy_async_check_get_value_bindings(const struct xccdf_policy_async_check *check);
+/// the check-imports to be filled by the engine, the iterator is freed by the caller
+/// @memberof xccdf_policy_async_check
+struct xccdf_check_import_iterator *xccdf_policy_async_check_get_imports(const struct xccdf_policy_async_check *check);
+
+/**
+ * Report the result of a check taken over by an engine (see POLICY_ENGINE_QUERY_SUBMIT).
+ * The check must not be used by the engine anymore.
+ * @memberof xccdf_policy_async_check
+ */
+void xccdf_policy_async_check_complete(struct xccdf_policy_async_check *check, xccdf_test_result_type_t result);
+
 /**
  * Type of function which implements OpenSCAP checking engine.
  *
@@ -265,6 +329,19 @@ OSCAP_DEPRECATED(bool xccdf_policy_model_register_engine_callback(struct xccdf_p
  */
 bool xccdf_policy_model_register_engine_and_query_callback(struct xccdf_policy_model *model, char *sys, xccdf_policy_engine_eval_fn eval_fn, void *usr, xccdf_policy_engine_query_fn query_fn);
 
+/**
+ * Set the number of threads evaluating the rules of the concurrent checking engines
+ * (see POLICY_ENGINE_QUERY_CONCURRENT) during xccdf_policy_evaluate(). Such rules are
+ * evaluated ahead while the other rules are evaluated in the document order. The
+ * rule-results are added in the document order anyway, and the start and output
+ * callbacks are always called by the thread calling xccdf_policy_evaluate(), so they
+ * don't need to be thread-safe.
+ * @param model XCCDF Policy Model
+ * @param jobs the number of threads, 0 or 1 to evaluate all the rules in place
+ * @memberof xccdf_policy_model
+ */
+void xccdf_policy_model_set_jobs(struct xccdf_policy_model *model, unsigned int jobs);
+
 typedef int (*policy_reporter_output)(struct xccdf_rule_result *, void *);
 
 /**
@@ -545,6 +622,20 @@ bool xccdf_policy_resolve(struct xccdf_policy * policy);
  */
 int xccdf_policy_generate_fix(struct xccdf_policy *policy, struct xccdf_result *result, const char *sys, int output_fd);
 
+/**
+ * Generate remediation prescriptions of several profiles at once.
+ * The prescriptions are written one after another, each with its own header.
+ * The policies are built from the same policy model, so the benchmark is
+ * resolved and the rule applicability is evaluated only once for all of them.
+ * @memberof xccdf_policy_model
+ * @param model XCCDF Policy Model
+ * @param profile_ids NULL-terminated array of IDs of the profiles
+ * @param sys Consider only those fixes that have @system attribute equal to sys
+ * @param output_fd write prescriptions to this file descriptor
+ * @returns zero on success, non-zero indicate partial (incomplete) output.
+ */
+int xccdf_policy_model_generate_fix(struct xccdf_policy_model *model, const char **profile_ids, const char *sys, int output_fd);
+
 /**
  * Clone the item and tailor it against given policy (profile)
  * @param policy Policy with profile
@@ -702,6 +793,17 @@ void xccdf_value_binding_iterator_reset(struct xccdf_value_binding_iterator *it)
  */
 struct xccdf_score * xccdf_policy_get_score(struct xccdf_policy * policy, struct xccdf_result * test_result, const char * system);
 
+/**
+ * Get score of the Test Result being evaluated by xccdf_policy_evaluate
+ * The score counts the rules reported so far, so it may be queried from the
+ * output callbacks to follow the progress. After the evaluation it is the
+ * score of the latest Test Result of the policy.
+ * @param policy XCCDF Policy
+ * @param system Score system
+ * @return XCCDF Score or NULL if the policy wasn't evaluated
+ */
+struct xccdf_score *xccdf_policy_get_current_score(struct xccdf_policy *policy, const char *system);
+
 /**
  * Get value of given value item in context of given policy
  * @memberof xccdf_policy
@@ -27,6 +27,7 @@
 #include <config.h>
 #endif
 
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 #include <libgen.h>
@@ -50,6 +51,7 @@
 #include "common/_error.h"
 #include "common/debug_priv.h"
 #include "common/assume.h"
+#include "common/oscap_trace.h"
 #include "common/text_priv.h"
 #include "XCCDF/result_scoring_priv.h"
 #include "xccdf_policy_resolve.h"
@@ -150,6 +152,9 @@ char *xccdf_policy_get_readable_item_description(struct xccdf_policy *policy, st
 	if (!unresolved_text)
 		return oscap_strdup("");
 	const char *unresolved = oscap_text_get_text(unresolved_text);
+	/* Without <xccdf:sub> elements the plain text of the description is kept by it */
+	if (unresolved != NULL && xccdf_policy_text_is_literal(policy, unresolved))
+		return oscap_text_get_plaintext(unresolved_text);
 	/* Resolve <xccdf:sub> elements */
 	const char *resolved = xccdf_policy_substitute(unresolved, policy);
 	/* Get a rid of xhtml elements */
@@ -355,6 +360,10 @@ static void xccdf_policy_resolve_item(struct xccdf_policy * policy, struct xccdf
 	}
 
 	assume_ex(oscap_htable_add(policy->selected_final, xccdf_item_get_id(item), result ? &TRUE0 : &FALSE0), NULL);
+
+	struct xccdf_policy_item_entry *entry = xccdf_policy_get_item_entry(policy, item, true);
+	if (entry != NULL)
+		entry->selected = result ? 2 : 1;
 }
 
 /**
@@ -599,6 +608,35 @@ xccdf_policy_is_item_selected(struct xccdf_policy *policy, const char *id)
 	return *tmp;
 }
 
+struct xccdf_policy_item_entry *xccdf_policy_get_item_entry(struct xccdf_policy *policy, const struct xccdf_item *item, bool create)
+{
+	const unsigned int ordinal = xccdf_item_get_ordinal(item);
+	if (ordinal == 0)
+		return NULL;
+
+	if (ordinal >= policy->item_table_size) {
+		if (!create)
+			return NULL;
+		// one allocation for all the items known now, the later ones grow it again
+		unsigned int size = xccdf_benchmark_get_items_count(xccdf_policy_get_benchmark(policy)) + 1;
+		if (size <= ordinal)
+			size = ordinal + 1;
+		policy->item_table = oscap_realloc(policy->item_table, size * sizeof(struct xccdf_policy_item_entry));
+		memset(policy->item_table + policy->item_table_size, 0,
+		       (size - policy->item_table_size) * sizeof(struct xccdf_policy_item_entry));
+		policy->item_table_size = size;
+	}
+	return &policy->item_table[ordinal];
+}
+
+bool xccdf_policy_get_item_selected(struct xccdf_policy *policy, const struct xccdf_item *item)
+{
+	const struct xccdf_policy_item_entry *entry = xccdf_policy_get_item_entry(policy, item, false);
+	if (entry != NULL && entry->selected != 0)
+		return entry->selected == 2;
+	return xccdf_policy_is_item_selected(policy, xccdf_item_get_id(item));
+}
+
 int xccdf_policy_get_selected_rules_count(struct xccdf_policy *policy)
 {
 	int ret = 0;
@@ -636,9 +674,8 @@ static struct xccdf_rule_result * _xccdf_rule_result_new_from_rule(const struct
 								  xccdf_test_result_type_t eval_result,
 								  const char *message)
 {
-	const char* rule_id = xccdf_rule_get_id(rule);
 	struct xccdf_rule_result *rule_ritem = xccdf_rule_result_new();
-	struct xccdf_refine_rule_internal* r_rule = oscap_htable_get(policy->refine_rules_internal, rule_id);
+	struct xccdf_refine_rule_internal* r_rule = xccdf_policy_get_refine_rule_by_item((struct xccdf_policy *) policy, (struct xccdf_item *) rule);
 
 	/* --Set rule-- */
 	xccdf_rule_result_set_result(rule_ritem, eval_result);
@@ -685,6 +722,24 @@ static struct xccdf_rule_result * _xccdf_rule_result_new_from_rule(const struct
 	return rule_ritem;
 }
 
+/* keep the scores of the result up to date while it is being evaluated */
+static void _xccdf_policy_scoring_reset(struct xccdf_policy *policy, struct xccdf_result *result)
+{
+	xccdf_scoring_free(policy->scoring);
+	policy->scoring = NULL;
+	policy->scoring_result = result;
+	if (result != NULL) {
+		struct xccdf_benchmark *benchmark = xccdf_policy_model_get_benchmark(xccdf_policy_get_model(policy));
+		policy->scoring = xccdf_scoring_new((struct xccdf_item *) benchmark, result);
+	}
+}
+
+void xccdf_policy_rescore_rule_result(struct xccdf_policy *policy, struct xccdf_result *result, struct xccdf_rule_result *rule_result)
+{
+	if (policy->scoring != NULL && policy->scoring_result == result)
+		xccdf_scoring_add_rule_result(policy->scoring, rule_result);
+}
+
 static int _xccdf_policy_report_rule_result(struct xccdf_policy *policy,
 					    struct xccdf_result *result,
 					    const struct xccdf_rule *rule,
@@ -703,6 +758,7 @@ static int _xccdf_policy_report_rule_result(struct xccdf_policy *policy,
 		/* TODO: instance */
 		rule_result = _xccdf_rule_result_new_from_rule(policy, rule, check, res, message);
 		xccdf_result_add_rule_result(result, rule_result);
+		xccdf_policy_rescore_rule_result(policy, result, rule_result);
 	} else
 		xccdf_check_free(check);
 
@@ -768,9 +824,16 @@ static bool _xccdf_policy_cpe_check_cb(const char* sys, const char* href, const
 	struct xccdf_policy_model* model = cb_usr->model;
 
 	char* prefixed_href = _cpe_get_oval_href(cb_usr->dict, cb_usr->lang_model, href);
+	// a result kept by a previous scan of the same host saves the probes
+	const int cached = cpe_session_get_check_result(model->cpe, prefixed_href, name);
+	if (cached != -1) {
+		oscap_free(prefixed_href);
+		return cached;
+	}
+
 	struct oval_agent_session *session = cpe_session_lookup_oval_session(model->cpe, prefixed_href);
-	oscap_free(prefixed_href);
 	if (session == NULL) {
+		oscap_free(prefixed_href);
 		return false;
 	}
 
@@ -781,6 +844,10 @@ static bool _xccdf_policy_cpe_check_cb(const char* sys, const char* href, const
 		// error message should already be set in the function
 	}
 
+	if (result == OVAL_RESULT_TRUE || result == OVAL_RESULT_FALSE)
+		cpe_session_set_check_result(model->cpe, prefixed_href, name, result == OVAL_RESULT_TRUE);
+	oscap_free(prefixed_href);
+
 	return result == OVAL_RESULT_TRUE;
 }
 
@@ -812,146 +879,563 @@ static bool _xccdf_policy_cpe_dict_cb(struct cpe_name* name, void* usr)
 	return ret;
 }
 
-static bool xccdf_policy_model_platforms_are_applicable_dict(struct xccdf_policy_model *model, struct cpe_dict_model *dict, struct oscap_string_iterator *platforms)
+static bool xccdf_policy_model_platform_is_applicable_dict(struct xccdf_policy_model *model, struct cpe_dict_model *dict, const char *platform)
 {
-	// at this point we know that the item has 1 or more platforms specified
-	bool ret = false;
-
-	while (oscap_string_iterator_has_more(platforms))
-	{
-		const char* platform = oscap_string_iterator_next(platforms);
-		// Platform could be a reference to CPE2 platform, skip the ones
-		// that aren't valid CPE names.
-		if (!cpe_name_check(platform))
-			continue;
-
-		struct cpe_name* name = cpe_name_new(platform);
+	// Platform could be a reference to CPE2 platform, skip the ones
+	// that aren't valid CPE names.
+	if (!cpe_name_check(platform))
+		return false;
 
-		struct cpe_check_cb_usr* usr = oscap_alloc(sizeof(struct cpe_check_cb_usr));
-		usr->model = model;
-		usr->dict = dict;
-		usr->lang_model = NULL;
-		const bool applicable = cpe_name_applicable_dict(name, dict, (cpe_check_fn) _xccdf_policy_cpe_check_cb, usr);
-		oscap_free(usr);
+	struct cpe_name* name = cpe_name_new(platform);
 
-		cpe_name_free(name);
+	struct cpe_check_cb_usr* usr = oscap_alloc(sizeof(struct cpe_check_cb_usr));
+	usr->model = model;
+	usr->dict = dict;
+	usr->lang_model = NULL;
+	const bool applicable = cpe_name_applicable_dict(name, dict, (cpe_check_fn) _xccdf_policy_cpe_check_cb, usr);
+	oscap_free(usr);
 
-		if (applicable)
-		{
-			ret = true;
+	cpe_name_free(name);
 
-			if (oscap_htable_get(model->cpe->applicable_platforms, platform) == NULL) {
-				oscap_htable_add(model->cpe->applicable_platforms, platform, 0);
-			}
-		}
-	}
-	oscap_string_iterator_reset(platforms);
-
-	return ret;
+	return applicable;
 }
 
-static bool xccdf_policy_model_platforms_are_applicable_lang_model(struct xccdf_policy_model *model, struct cpe_lang_model *lang_model, struct oscap_string_iterator *platforms)
+static bool xccdf_policy_model_platform_is_applicable_lang_model(struct xccdf_policy_model *model, struct cpe_lang_model *lang_model, const char *platform)
 {
-	// at this point we know that the item has 1 or more platforms specified
-	bool ret = false;
+	// Specification says that platform should begin with "#" if it is
+	// a reference to a CPE2 platform. However content exists where this
+	// is not strictly followed so we support both with and without "#"
+	// references.
 
-	while (oscap_string_iterator_has_more(platforms))
+	const char* platform_shifted = platform;
+	if (strlen(platform_shifted) >= 1 && *platform_shifted == '#')
 	{
-		const char* platform = oscap_string_iterator_next(platforms);
-		// Specification says that platform should begin with "#" if it is
-		// a reference to a CPE2 platform. However content exists where this
-		// is not strictly followed so we support both with and without "#"
-		// references.
-
-		const char* platform_shifted = platform;
-		if (strlen(platform_shifted) >= 1 && *platform_shifted == '#')
-		{
-			// skip the "#" character
-			platform_shifted++;
-		}
-
-		struct cpe_check_cb_usr* usr = oscap_alloc(sizeof(struct cpe_check_cb_usr));
-		usr->model = model;
-		usr->dict = NULL;
-		usr->lang_model = lang_model;
-		const bool applicable = cpe_platform_applicable_lang_model(platform_shifted, lang_model, (cpe_check_fn)_xccdf_policy_cpe_check_cb, (cpe_dict_fn)_xccdf_policy_cpe_dict_cb, usr);
-		oscap_free(usr);
-
-		if (applicable)
-		{
-			ret = true;
-
-			if (oscap_htable_get(model->cpe->applicable_platforms, platform) == NULL) {
-				oscap_htable_add(model->cpe->applicable_platforms, platform, 0);
-			}
-		}
+		// skip the "#" character
+		platform_shifted++;
 	}
-	oscap_string_iterator_reset(platforms);
 
-	return ret;
+	struct cpe_check_cb_usr* usr = oscap_alloc(sizeof(struct cpe_check_cb_usr));
+	usr->model = model;
+	usr->dict = NULL;
+	usr->lang_model = lang_model;
+	const bool applicable = cpe_platform_applicable_lang_model(platform_shifted, lang_model, (cpe_check_fn)_xccdf_policy_cpe_check_cb, (cpe_dict_fn)_xccdf_policy_cpe_dict_cb, usr);
+	oscap_free(usr);
+
+	return applicable;
 }
 
-bool xccdf_policy_model_platforms_are_applicable(struct xccdf_policy_model *model, struct oscap_string_iterator *platforms)
+static bool xccdf_policy_model_platform_is_applicable(struct xccdf_policy_model *model, const char *platform)
 {
-	// we have to check whether the item has any platforms at all, if it has none
-	// it should be applicable to all platforms
-	if (!oscap_string_iterator_has_more(platforms))
-		return true;
+	// The decision is remembered, many items share the same platforms and
+	// each decision may take CPE OVAL evaluations.
+	const int memo = cpe_session_get_platform_result(model->cpe, platform);
+	if (memo != -1)
+		return memo;
 
 	bool ret = false;
-	// We do not check whether the platform entries are valid platform refs
-	// or CPE names. We let the policy_model methods do that instead.
+	// We do not check whether the platform entry is a valid platform ref
+	// or CPE name. We let the policy_model methods do that instead.
 	// Therefore we check all 4 (!) places where a platform may match.
 	// CPE2 takes precedence over CPE1 in this implementation. This is not
 	// dictated by the specification, it's an arbitrary choice.
 	struct xccdf_benchmark* benchmark = xccdf_policy_model_get_benchmark(model);
 	struct cpe_lang_model *embedded_lang_model = xccdf_benchmark_get_cpe_lang_model(benchmark);
-	if (embedded_lang_model != NULL) {
-		if (xccdf_policy_model_platforms_are_applicable_lang_model(model, embedded_lang_model, platforms))
-			ret = true;
-	}
+	if (embedded_lang_model != NULL)
+		ret = xccdf_policy_model_platform_is_applicable_lang_model(model, embedded_lang_model, platform);
 
 	struct oscap_iterator *lang_models = oscap_iterator_new(model->cpe->lang_models);
-	while (oscap_iterator_has_more(lang_models)) {
+	while (!ret && oscap_iterator_has_more(lang_models)) {
 		struct cpe_lang_model *lang_model = (struct cpe_lang_model *) oscap_iterator_next(lang_models);
-		if (xccdf_policy_model_platforms_are_applicable_lang_model(model, lang_model, platforms))
-			ret = true;
+		ret = xccdf_policy_model_platform_is_applicable_lang_model(model, lang_model, platform);
 	}
 	oscap_iterator_free(lang_models);
 
 	struct cpe_dict_model *embedded_dict = xccdf_benchmark_get_cpe_list(benchmark);
-	if (embedded_dict != NULL) {
-		if (xccdf_policy_model_platforms_are_applicable_dict(model, embedded_dict, platforms))
-			ret = true;
-	}
+	if (!ret && embedded_dict != NULL)
+		ret = xccdf_policy_model_platform_is_applicable_dict(model, embedded_dict, platform);
 
 	struct oscap_iterator *dicts = oscap_iterator_new(model->cpe->dicts);
-	while (oscap_iterator_has_more(dicts)) {
+	while (!ret && oscap_iterator_has_more(dicts)) {
 		struct cpe_dict_model *dict = (struct cpe_dict_model *) oscap_iterator_next(dicts);
-		if (xccdf_policy_model_platforms_are_applicable_dict(model, dict, platforms))
-			ret = true;
+		ret = xccdf_policy_model_platform_is_applicable_dict(model, dict, platform);
 	}
 	oscap_iterator_free(dicts);
 
+	if (ret && oscap_htable_get(model->cpe->applicable_platforms, platform) == NULL) {
+		oscap_htable_add(model->cpe->applicable_platforms, platform, 0);
+	}
+	cpe_session_set_platform_result(model->cpe, platform, ret);
+
+	return ret;
+}
+
+bool xccdf_policy_model_platforms_are_applicable(struct xccdf_policy_model *model, struct oscap_string_iterator *platforms)
+{
+	// we have to check whether the item has any platforms at all, if it has none
+	// it should be applicable to all platforms
+	if (!oscap_string_iterator_has_more(platforms))
+		return true;
+
+	// all the platforms are decided, the applicable ones are reported in the results
+	bool ret = false;
+	while (oscap_string_iterator_has_more(platforms)) {
+		const char *platform = oscap_string_iterator_next(platforms);
+		if (xccdf_policy_model_platform_is_applicable(model, platform))
+			ret = true;
+	}
+	oscap_string_iterator_reset(platforms);
+
 	return ret;
 }
 
 bool xccdf_policy_model_item_is_applicable(struct xccdf_policy_model *model, struct xccdf_item *item)
 {
+	const char *id = xccdf_item_get_id(item);
+	const int memo = cpe_session_get_item_result(model->cpe, id);
+	if (memo != -1)
+		return memo;
+
+	// the parents are decided first, the whole subtree of an inapplicable group is inapplicable
+	bool ret = false;
 	struct xccdf_item* parent = xccdf_item_get_parent(item);
 	if (!parent || xccdf_policy_model_item_is_applicable(model, parent))
 	{
 		struct oscap_string_iterator* platforms = xccdf_item_get_platforms(item);
-		bool ret = xccdf_policy_model_platforms_are_applicable(model, platforms);
+		ret = xccdf_policy_model_platforms_are_applicable(model, platforms);
 		oscap_string_iterator_free(platforms);
+	}
+
+	cpe_session_set_item_result(model->cpe, id, ret);
+	return ret;
+}
+
+/**
+ * A rule evaluated ahead by a worker thread, see xccdf_policy_model_set_jobs.
+ * The rules are still walked in the document order; the walk takes the result
+ * over when it gets to the rule, so the rule-results and the output callbacks
+ * keep the document order and the callbacks are called from one thread.
+ */
+struct xccdf_policy_job {
+	struct xccdf_check *check;      ///< clone of the applicable check of the rule
+	int result;
+	const char *message;
+	oscap_errfamily_t err_family;
+	char *err;                      ///< errors of the evaluation, raised again by the walk
+	struct xccdf_policy_async_check *async; ///< the check taken over by an engine, see POLICY_ENGINE_QUERY_SUBMIT
+	bool started;
+	bool done;
+};
+
+struct xccdf_policy_async_check {
+	struct xccdf_policy_jobs *jobs;
+	struct xccdf_policy_job *job;
+	const char *rule_id;
+	struct xccdf_check_content_ref *content; ///< the first content-ref of the check of the job
+	struct oscap_list *bindings;
+};
+
+struct xccdf_policy_jobs {
+	struct xccdf_policy *policy;
+	struct oscap_htable *by_rule;   ///< rule id -> struct xccdf_policy_job
+	struct xccdf_policy_job **queue; ///< the jobs in the document order
+	size_t count;
+	size_t next;
+	size_t submitted;               ///< checks taken over by the engines
+	size_t pending;                 ///< checks taken over by the engines and not completed yet
+	bool threaded;                  ///< the rules of the concurrent engines are evaluated by the threads
+	bool cancel;
+	pthread_mutex_t lock;
+	pthread_cond_t done;
+	pthread_t *threads;
+	unsigned int nthreads;
+};
 
-		return ret;
+static void xccdf_policy_job_free(struct xccdf_policy_job *job)
+{
+	if (job == NULL)
+		return;
+	if (job->async != NULL) {
+		oscap_list_free(job->async->bindings, (oscap_destruct_func) xccdf_value_binding_free);
+		oscap_free(job->async);
 	}
-	else
-	{
-		// parent is not applicable
+	xccdf_check_free(job->check);
+	oscap_free(job->err);
+	oscap_free(job);
+}
+
+struct xccdf_policy *xccdf_policy_async_check_get_policy(const struct xccdf_policy_async_check *check)
+{
+	return check->jobs->policy;
+}
+
+const char *xccdf_policy_async_check_get_rule_id(const struct xccdf_policy_async_check *check)
+{
+	return check->rule_id;
+}
+
+const char *xccdf_policy_async_check_get_name(const struct xccdf_policy_async_check *check)
+{
+	return xccdf_check_content_ref_get_name(check->content);
+}
+
+const char *xccdf_policy_async_check_get_href(const struct xccdf_policy_async_check *check)
+{
+	return xccdf_check_content_ref_get_href(check->content);
+}
+
+struct xccdf_value_binding_iterator *xccdf_policy_async_check_get_value_bindings(const struct xccdf_policy_async_check *check)
+{
+	return (struct xccdf_value_binding_iterator *) oscap_iterator_new(check->bindings);
+}
+
+struct xccdf_check_import_iterator *xccdf_policy_async_check_get_imports(const struct xccdf_policy_async_check *check)
+{
+	return xccdf_check_get_imports(check->job->check);
+}
+
+void xccdf_policy_async_check_complete(struct xccdf_policy_async_check *check, xccdf_test_result_type_t result)
+{
+	struct xccdf_policy_jobs *jobs = check->jobs;
+
+	pthread_mutex_lock(&jobs->lock);
+	check->job->result = result;
+	check->job->done = true;
+	--jobs->pending;
+	pthread_cond_broadcast(&jobs->done);
+	pthread_mutex_unlock(&jobs->lock);
+}
+
+/* some engine of the checking system, or of any if NULL, evaluates checks asynchronously */
+static bool _xccdf_policy_engines_take_checks(struct xccdf_policy *policy, const char *sysname)
+{
+	bool take = false;
+	struct oscap_iterator *cb_it = sysname != NULL ?
+		_xccdf_policy_get_engines_by_sysname(policy, sysname) : oscap_iterator_new(policy->model->engines);
+	while (oscap_iterator_has_more(cb_it) && !take) {
+		struct xccdf_policy_engine *engine = (struct xccdf_policy_engine *) oscap_iterator_next(cb_it);
+		take = xccdf_policy_engine_query(engine, POLICY_ENGINE_QUERY_ASYNC, NULL) != NULL;
+	}
+	oscap_iterator_free(cb_it);
+	return take;
+}
+
+/*
+ * Offer the first content-ref of the check of the job to the engines of its
+ * system which take checks, false if none of them took it over.
+ */
+static bool _xccdf_policy_job_submit(struct xccdf_policy_jobs *jobs, struct xccdf_policy_job *job, const char *rule_id)
+{
+	struct xccdf_policy *policy = jobs->policy;
+	struct xccdf_check_content_ref *content = NULL;
+	bool taken = false;
+
+	struct xccdf_check_content_ref_iterator *content_it = xccdf_check_get_content_refs(job->check);
+	if (xccdf_check_content_ref_iterator_has_more(content_it))
+		content = xccdf_check_content_ref_iterator_next(content_it);
+	xccdf_check_content_ref_iterator_free(content_it);
+	if (content == NULL)
 		return false;
+
+	struct oscap_list *bindings = xccdf_policy_check_get_value_bindings(policy, xccdf_check_get_exports(job->check));
+	if (bindings == NULL)
+		return false;
+
+	struct xccdf_policy_async_check *check = oscap_calloc(1, sizeof(struct xccdf_policy_async_check));
+	check->jobs = jobs;
+	check->job = job;
+	check->rule_id = rule_id;
+	check->content = content;
+	check->bindings = bindings;
+	job->async = check;
+	job->started = true;
+
+	// the engine may complete the check before the query returns
+	pthread_mutex_lock(&jobs->lock);
+	++jobs->pending;
+	pthread_mutex_unlock(&jobs->lock);
+
+	struct oscap_iterator *cb_it = _xccdf_policy_get_engines_by_sysname(policy, xccdf_check_get_system(job->check));
+	while (oscap_iterator_has_more(cb_it) && !taken) {
+		struct xccdf_policy_engine *engine = (struct xccdf_policy_engine *) oscap_iterator_next(cb_it);
+		if (xccdf_policy_engine_query(engine, POLICY_ENGINE_QUERY_ASYNC, NULL) != NULL)
+			taken = xccdf_policy_engine_query(engine, POLICY_ENGINE_QUERY_SUBMIT, check) != NULL;
 	}
+	oscap_iterator_free(cb_it);
+
+	if (!taken) {
+		pthread_mutex_lock(&jobs->lock);
+		--jobs->pending;
+		pthread_mutex_unlock(&jobs->lock);
+		job->async = NULL;
+		job->started = false;
+		oscap_list_free(bindings, (oscap_destruct_func) xccdf_value_binding_free);
+		oscap_free(check);
+	} else
+		++jobs->submitted;
+	return taken;
+}
+
+/* all the engines of the checking system evaluate checks concurrently */
+static bool _xccdf_policy_engines_are_concurrent(struct xccdf_policy *policy, const char *sysname)
+{
+	bool concurrent = false;
+	struct oscap_iterator *cb_it = _xccdf_policy_get_engines_by_sysname(policy, sysname);
+	while (oscap_iterator_has_more(cb_it)) {
+		struct xccdf_policy_engine *engine = (struct xccdf_policy_engine *) oscap_iterator_next(cb_it);
+		concurrent = xccdf_policy_engine_query(engine, POLICY_ENGINE_QUERY_CONCURRENT, NULL) != NULL;
+		if (!concurrent)
+			break;
+	}
+	oscap_iterator_free(cb_it);
+	return concurrent;
+}
+
+/* the content-refs of a simple check are alternatives, the first resolvable one is evaluated */
+static int _xccdf_policy_check_evaluate_content_refs(struct xccdf_policy *policy, struct xccdf_check *check, struct oscap_list *bindings)
+{
+	int ret = XCCDF_RESULT_NOT_CHECKED;
+	const char *system_name = xccdf_check_get_system(check);
+	struct xccdf_check_content_ref_iterator *content_it = xccdf_check_get_content_refs(check);
+	while (xccdf_check_content_ref_iterator_has_more(content_it)) {
+		struct xccdf_check_content_ref *content = xccdf_check_content_ref_iterator_next(content_it);
+		struct xccdf_check_import_iterator *check_import_it = xccdf_check_get_imports(check);
+		ret = xccdf_policy_evaluate_cb(policy, system_name, xccdf_check_content_ref_get_name(content),
+				xccdf_check_content_ref_get_href(content), bindings, check_import_it);
+		xccdf_check_import_iterator_free(check_import_it);
+		if ((xccdf_test_result_type_t) ret != XCCDF_RESULT_NOT_CHECKED) {
+			xccdf_check_inject_content_ref(check, content, NULL);
+			break;
+		}
+	}
+	xccdf_check_content_ref_iterator_free(content_it);
+	return ret;
+}
+
+static void _xccdf_policy_job_run(struct xccdf_policy *policy, struct xccdf_policy_job *job)
+{
+	struct oscap_list *bindings = xccdf_policy_check_get_value_bindings(policy, xccdf_check_get_exports(job->check));
+	if (bindings == NULL) {
+		job->result = XCCDF_RESULT_UNKNOWN;
+		job->message = "Value bindings not found.";
+	} else {
+		job->result = _xccdf_policy_check_evaluate_content_refs(policy, job->check, bindings);
+		oscap_list_free(bindings, (oscap_destruct_func) xccdf_value_binding_free);
+	}
+	if (oscap_err()) {
+		job->err_family = oscap_err_family();
+		job->err = oscap_err_get_full_error();
+	}
+}
+
+static void *_xccdf_policy_jobs_worker(void *arg)
+{
+	struct xccdf_policy_jobs *jobs = (struct xccdf_policy_jobs *) arg;
+
+	for (;;) {
+		struct xccdf_policy_job *job = NULL;
+
+		pthread_mutex_lock(&jobs->lock);
+		while (!jobs->cancel && jobs->next < jobs->count && job == NULL) {
+			job = jobs->queue[jobs->next++];
+			if (job->started)
+				job = NULL;
+			else
+				job->started = true;
+		}
+		pthread_mutex_unlock(&jobs->lock);
+
+		if (job == NULL)
+			return NULL;
+
+		_xccdf_policy_job_run(jobs->policy, job);
+
+		pthread_mutex_lock(&jobs->lock);
+		job->done = true;
+		pthread_cond_broadcast(&jobs->done);
+		pthread_mutex_unlock(&jobs->lock);
+	}
+}
+
+static void _xccdf_policy_jobs_add_item(struct xccdf_policy_jobs *jobs, struct xccdf_item *item)
+{
+	struct xccdf_policy *policy = jobs->policy;
+
+	switch (xccdf_item_get_type(item)) {
+	case XCCDF_RULE:{
+		if (!xccdf_policy_get_item_selected(policy, item))
+			return;
+		struct xccdf_refine_rule_internal *r_rule = xccdf_policy_get_refine_rule_by_item(policy, item);
+		if (xccdf_get_final_role((struct xccdf_rule *) item, r_rule) == XCCDF_ROLE_UNCHECKED)
+			return;
+		if (!xccdf_policy_model_item_is_applicable(policy->model, item))
+			return;
+		const struct xccdf_check *check = _xccdf_policy_rule_get_applicable_check(policy, item);
+		if (check == NULL || xccdf_check_get_complex(check))
+			return;
+		if (oscap_htable_get(jobs->by_rule, xccdf_item_get_id(item)) != NULL)
+			return;
+		// The names of a @multi-check are known only to the engine, such rules are evaluated in place.
+		bool multi = false;
+		struct xccdf_check_content_ref_iterator *content_it = xccdf_check_get_content_refs(check);
+		while (xccdf_check_content_ref_iterator_has_more(content_it)) {
+			struct xccdf_check_content_ref *content = xccdf_check_content_ref_iterator_next(content_it);
+			if (xccdf_check_content_ref_get_name(content) == NULL && xccdf_check_get_multicheck(check))
+				multi = true;
+		}
+		xccdf_check_content_ref_iterator_free(content_it);
+		if (multi)
+			return;
+		const char *sysname = xccdf_check_get_system(check);
+		bool submit = _xccdf_policy_engines_take_checks(policy, sysname);
+		bool concurrent = jobs->threaded && _xccdf_policy_engines_are_concurrent(policy, sysname);
+		if (!submit && !concurrent)
+			return;
+
+		struct xccdf_policy_job *job = oscap_calloc(1, sizeof(struct xccdf_policy_job));
+		job->check = xccdf_check_clone(check);
+		if (!oscap_htable_add(jobs->by_rule, xccdf_item_get_id(item), job)) {
+			xccdf_policy_job_free(job);
+			return;
+		}
+		if (submit && _xccdf_policy_job_submit(jobs, job, xccdf_item_get_id(item)))
+			return;
+		if (!concurrent) {
+			xccdf_policy_job_free(oscap_htable_detach(jobs->by_rule, xccdf_item_get_id(item)));
+			return;
+		}
+		jobs->queue = oscap_realloc(jobs->queue, (jobs->count + 1) * sizeof(struct xccdf_policy_job *));
+		jobs->queue[jobs->count++] = job;
+	} break;
+	case XCCDF_GROUP:{
+		struct xccdf_item_iterator *child_it = xccdf_group_get_content(xccdf_item_to_group(item));
+		while (xccdf_item_iterator_has_more(child_it))
+			_xccdf_policy_jobs_add_item(jobs, xccdf_item_iterator_next(child_it));
+		xccdf_item_iterator_free(child_it);
+	} break;
+	default:
+		break;
+	}
+}
+
+static void _xccdf_policy_jobs_finish(struct xccdf_policy_jobs *jobs);
+
+/**
+ * Hand the checks of the selected rules over to the engines which evaluate
+ * them asynchronously (see POLICY_ENGINE_QUERY_SUBMIT) and start evaluating
+ * the rules of the concurrent checking engines (see POLICY_ENGINE_QUERY_CONCURRENT)
+ * by worker threads, e.g. the SCE scripts run in parallel with each other and
+ * with the OVAL rules evaluated in place. NULL when there is nothing to
+ * evaluate ahead.
+ */
+static struct xccdf_policy_jobs *_xccdf_policy_jobs_start(struct xccdf_policy *policy, struct xccdf_benchmark *benchmark)
+{
+	unsigned int nthreads = policy->model->jobs;
+	if (nthreads < 2 && !_xccdf_policy_engines_take_checks(policy, NULL))
+		return NULL;
+
+	struct xccdf_policy_jobs *jobs = oscap_calloc(1, sizeof(struct xccdf_policy_jobs));
+	jobs->policy = policy;
+	jobs->by_rule = oscap_htable_new();
+	jobs->threaded = nthreads >= 2;
+	pthread_mutex_init(&jobs->lock, NULL);
+	pthread_cond_init(&jobs->done, NULL);
+
+	struct xccdf_item_iterator *item_it = xccdf_benchmark_get_content(benchmark);
+	while (xccdf_item_iterator_has_more(item_it))
+		_xccdf_policy_jobs_add_item(jobs, xccdf_item_iterator_next(item_it));
+	xccdf_item_iterator_free(item_it);
+
+	if (jobs->count == 0 && jobs->submitted == 0) {
+		_xccdf_policy_jobs_finish(jobs);
+		return NULL;
+	}
+
+	if (nthreads > jobs->count)
+		nthreads = jobs->count;
+	jobs->threads = oscap_alloc(sizeof(pthread_t) * (nthreads + 1));
+	for (jobs->nthreads = 0; jobs->nthreads < nthreads; ++jobs->nthreads) {
+		if (pthread_create(&jobs->threads[jobs->nthreads], NULL, _xccdf_policy_jobs_worker, jobs) != 0) {
+			dW("Can't start a rule evaluation thread, the rules are evaluated by %u threads.", jobs->nthreads);
+			break;
+		}
+	}
+	dI("Evaluating %zu rules by %u threads ahead, %zu rules by the engines.", jobs->count, jobs->nthreads, jobs->submitted);
+
+	return jobs;
+}
+
+/**
+ * Take the job of the rule over, NULL if the rule is evaluated in place.
+ * A job which is not running yet is run by the calling thread.
+ */
+static struct xccdf_policy_job *_xccdf_policy_jobs_take(struct xccdf_policy_jobs *jobs, const char *rule_id)
+{
+	if (jobs == NULL)
+		return NULL;
+
+	struct xccdf_policy_job *job = oscap_htable_get(jobs->by_rule, rule_id);
+	if (job == NULL)
+		return NULL;
+
+	pthread_mutex_lock(&jobs->lock);
+	bool run = !job->started;
+	job->started = true;
+	while (!run && !job->done)
+		pthread_cond_wait(&jobs->done, &jobs->lock);
+	pthread_mutex_unlock(&jobs->lock);
+
+	if (job->async != NULL) {
+		// the engine gave it up, the check is evaluated as usual
+		if ((xccdf_test_result_type_t) job->result == XCCDF_RESULT_NOT_CHECKED)
+			run = true;
+		else
+			xccdf_check_inject_content_ref(job->check, job->async->content, NULL);
+	}
+	if (run)
+		_xccdf_policy_job_run(jobs->policy, job);
+	if (job->err != NULL)
+		oscap_seterr(job->err_family, "%s", job->err);
+	return job;
+}
+
+static void _xccdf_policy_jobs_finish(struct xccdf_policy_jobs *jobs)
+{
+	if (jobs == NULL)
+		return;
+
+	pthread_mutex_lock(&jobs->lock);
+	jobs->cancel = true;
+	// the engines may still use the checks they took over
+	while (jobs->pending > 0)
+		pthread_cond_wait(&jobs->done, &jobs->lock);
+	pthread_mutex_unlock(&jobs->lock);
+	for (unsigned int i = 0; i < jobs->nthreads; ++i)
+		pthread_join(jobs->threads[i], NULL);
+
+	pthread_cond_destroy(&jobs->done);
+	pthread_mutex_destroy(&jobs->lock);
+	oscap_free(jobs->threads);
+	oscap_free(jobs->queue);
+	oscap_htable_free(jobs->by_rule, (oscap_destruct_func) xccdf_policy_job_free);
+	oscap_free(jobs);
+}
+
+/**
+ * Report the result of the simple check of the rule given by the checking engine.
+ */
+static int _xccdf_policy_rule_report_check(struct xccdf_policy *policy, struct xccdf_result *result,
+					   const struct xccdf_rule *rule, struct xccdf_check *check,
+					   xccdf_role_t role, int ret, const char *message)
+{
+	if ((xccdf_test_result_type_t) ret == XCCDF_RESULT_NOT_CHECKED)
+		message = "None of the check-content-ref elements was resolvable.";
+
+	if (role == XCCDF_ROLE_UNSCORED)
+		ret = XCCDF_RESULT_INFORMATIONAL;
+
+	/* Negate only once */
+	ret = _resolve_negate(ret, check);
+	return _xccdf_policy_report_rule_result(policy, result, rule, check, ret, message);
 }
 
 /**
@@ -964,14 +1448,14 @@ static inline int
 _xccdf_policy_rule_evaluate(struct xccdf_policy * policy, const struct xccdf_rule *rule, struct xccdf_result *result)
 {
 	const char* rule_id = xccdf_rule_get_id(rule);
-	const bool is_selected = xccdf_policy_is_item_selected(policy, rule_id);
+	const bool is_selected = xccdf_policy_get_item_selected(policy, (const struct xccdf_item *) rule);
 	const char *message = NULL;
 
 	int report = xccdf_policy_report_cb(policy, XCCDF_POLICY_OUTCB_START, (void *) rule);
 	if (report)
 		return report;
 
-	struct xccdf_refine_rule_internal* r_rule = oscap_htable_get(policy->refine_rules_internal, rule_id);
+	struct xccdf_refine_rule_internal* r_rule = xccdf_policy_get_refine_rule_by_item(policy, (struct xccdf_item *) rule);
 
 	xccdf_role_t role = xccdf_get_final_role(rule, r_rule);
 	if (!is_selected) {
@@ -993,6 +1477,16 @@ _xccdf_policy_rule_evaluate(struct xccdf_policy * policy, const struct xccdf_rul
 		// No candidate or applicable check found.
 		return _xccdf_policy_report_rule_result(policy, result, rule, NULL, XCCDF_RESULT_NOT_CHECKED, "No candidate or applicable check found.");
 
+	// The check might have been evaluated ahead by a concurrent checking engine.
+	struct xccdf_policy_job *job = _xccdf_policy_jobs_take(policy->jobs, rule_id);
+	if (job != NULL) {
+		struct xccdf_check *job_check = job->check;
+		job->check = NULL;
+		if (job->message != NULL)
+			return _xccdf_policy_report_rule_result(policy, result, rule, job_check, job->result, job->message);
+		return _xccdf_policy_rule_report_check(policy, result, rule, job_check, role, job->result, NULL);
+	}
+
 	// we need to clone the check to avoid changing the original content
 	struct xccdf_check *check = xccdf_check_clone(orig_check);
 	if (xccdf_check_get_complex(check))
@@ -1077,17 +1571,9 @@ _xccdf_policy_rule_evaluate(struct xccdf_policy * policy, const struct xccdf_rul
 			break;
 		}
 	}
-	if ((xccdf_test_result_type_t) ret == XCCDF_RESULT_NOT_CHECKED)
-		message = "None of the check-content-ref elements was resolvable.";
-
-	if (role == XCCDF_ROLE_UNSCORED)
-		ret = XCCDF_RESULT_INFORMATIONAL;
-
 	xccdf_check_content_ref_iterator_free(content_it);
 	oscap_list_free(bindings, (oscap_destruct_func) xccdf_value_binding_free);
-	/* Negate only once */
-	ret = _resolve_negate(ret, check);
-	return _xccdf_policy_report_rule_result(policy, result, rule, check, ret, message);
+	return _xccdf_policy_rule_report_check(policy, result, rule, check, role, ret, message);
 }
 
 /** 
@@ -1589,6 +2075,12 @@ void xccdf_policy_model_unregister_engines(struct xccdf_policy_model *model, con
 	}
 }
 
+void xccdf_policy_model_set_jobs(struct xccdf_policy_model *model, unsigned int jobs)
+{
+	__attribute__nonnull__(model);
+	model->jobs = jobs;
+}
+
 bool xccdf_policy_model_register_start_callback(struct xccdf_policy_model * model, policy_reporter_start func, void * usr)
 {
 
@@ -1651,6 +2143,8 @@ struct xccdf_policy_model * xccdf_policy_model_new(struct xccdf_benchmark * benc
 	model->engines = oscap_list_new();
 
 	model->cpe = cpe_session_new();
+	model->templates = NULL;
+	pthread_mutex_init(&model->templates_lock, NULL);
 
         /* Resolve document */
         xccdf_benchmark_resolve(benchmark);
@@ -1674,7 +2168,7 @@ _xccdf_policy_add_selector_internal(struct xccdf_policy *policy, struct xccdf_be
 			we have to consider the parent selected even though it is not in
 			the final selected hashmap. XCCDF Benchmark can't be unselected. */
 			xccdf_policy_resolve_item(policy, item, (parent == NULL || xccdf_item_get_type(parent) == XCCDF_BENCHMARK) ?
-				true : xccdf_policy_is_item_selected(policy, xccdf_item_get_id(parent)));
+				true : xccdf_policy_get_item_selected(policy, parent));
 		}
 		return result;
 	}
@@ -1706,7 +2200,7 @@ _xccdf_policy_add_selector_internal(struct xccdf_policy *policy, struct xccdf_be
 				continue;
 			const struct xccdf_item *parent = xccdf_item_get_parent(item);
 			xccdf_policy_resolve_item(policy, item, (parent == NULL || xccdf_item_get_type(parent) == XCCDF_BENCHMARK) ?
-				true : xccdf_policy_is_item_selected(policy, xccdf_item_get_id(parent)));
+				true : xccdf_policy_get_item_selected(policy, parent));
 		}
 	}
 	oscap_htable_iterator_free(hit);
@@ -1978,6 +2472,125 @@ static void xccdf_policy_add_final_setvalues(struct xccdf_policy *policy, struct
 	}
 }
 
+/*
+ * The check-content-refs with the same system and href, see
+ * _xccdf_policy_prefetch.
+ */
+struct xccdf_policy_prefetch_ref {
+	char *sysname;
+	char *href;
+	struct xccdf_policy_prefetch data;
+};
+
+static void xccdf_policy_prefetch_ref_free(struct xccdf_policy_prefetch_ref *ref)
+{
+	if (ref == NULL)
+		return;
+	oscap_free(ref->sysname);
+	oscap_free(ref->href);
+	oscap_stringlist_free(ref->data.names);
+	oscap_free(ref);
+}
+
+static void _xccdf_policy_prefetch_check(struct oscap_htable *refs, const struct xccdf_check *check)
+{
+	if (xccdf_check_get_complex(check)) {
+		struct xccdf_check_iterator *child_it = xccdf_check_get_children(check);
+		while (xccdf_check_iterator_has_more(child_it))
+			_xccdf_policy_prefetch_check(refs, xccdf_check_iterator_next(child_it));
+		xccdf_check_iterator_free(child_it);
+		return;
+	}
+
+	const char *sysname = xccdf_check_get_system(check);
+	struct xccdf_check_content_ref_iterator *content_it = xccdf_check_get_content_refs(check);
+	while (xccdf_check_content_ref_iterator_has_more(content_it)) {
+		struct xccdf_check_content_ref *content = xccdf_check_content_ref_iterator_next(content_it);
+		const char *href = xccdf_check_content_ref_get_href(content);
+		const char *name = xccdf_check_content_ref_get_name(content);
+
+		if (sysname == NULL || href == NULL)
+			continue;
+
+		char *key = oscap_sprintf("%s %s", sysname, href);
+		struct xccdf_policy_prefetch_ref *ref = oscap_htable_get(refs, key);
+		if (ref == NULL) {
+			ref = oscap_calloc(1, sizeof(struct xccdf_policy_prefetch_ref));
+			ref->sysname = oscap_strdup(sysname);
+			ref->href = oscap_strdup(href);
+			ref->data.href = ref->href;
+			ref->data.names = oscap_stringlist_new();
+			oscap_htable_add(refs, key, ref);
+		}
+		oscap_free(key);
+
+		// the content-refs are alternatives, the engine skips the names it doesn't know
+		if (name == NULL) {
+			oscap_stringlist_free(ref->data.names);
+			ref->data.names = NULL;
+		} else if (ref->data.names != NULL)
+			oscap_stringlist_add_string(ref->data.names, name);
+	}
+	xccdf_check_content_ref_iterator_free(content_it);
+}
+
+static void _xccdf_policy_prefetch_item(struct xccdf_policy *policy, struct xccdf_item *item, struct oscap_htable *refs)
+{
+	switch (xccdf_item_get_type(item)) {
+	case XCCDF_RULE:{
+		if (!xccdf_policy_get_item_selected(policy, item))
+			return;
+		struct xccdf_refine_rule_internal *r_rule = xccdf_policy_get_refine_rule_by_item(policy, item);
+		if (xccdf_get_final_role((struct xccdf_rule *) item, r_rule) == XCCDF_ROLE_UNCHECKED)
+			return;
+		if (!xccdf_policy_model_item_is_applicable(policy->model, item))
+			return;
+		const struct xccdf_check *check = _xccdf_policy_rule_get_applicable_check(policy, item);
+		if (check != NULL)
+			_xccdf_policy_prefetch_check(refs, check);
+	} break;
+	case XCCDF_GROUP:{
+		struct xccdf_item_iterator *child_it = xccdf_group_get_content(xccdf_item_to_group(item));
+		while (xccdf_item_iterator_has_more(child_it))
+			_xccdf_policy_prefetch_item(policy, xccdf_item_iterator_next(child_it), refs);
+		xccdf_item_iterator_free(child_it);
+	} break;
+	default:
+		break;
+	}
+}
+
+/**
+ * Planning phase of the evaluation: the check-content-refs of all the selected
+ * rules are gathered per checking system and href and handed to the checking
+ * engines, so they can collect what the rules need in one go (e.g. the OVAL
+ * engine sends the objects to the probes in parallel) instead of being asked
+ * one small check at a time. The value bindings aren't known until the rules
+ * are evaluated, the engines collect only what doesn't depend on them.
+ */
+static void _xccdf_policy_prefetch(struct xccdf_policy *policy, struct xccdf_benchmark *benchmark)
+{
+	struct oscap_htable *refs = oscap_htable_new();
+
+	struct xccdf_item_iterator *item_it = xccdf_benchmark_get_content(benchmark);
+	while (xccdf_item_iterator_has_more(item_it))
+		_xccdf_policy_prefetch_item(policy, xccdf_item_iterator_next(item_it), refs);
+	xccdf_item_iterator_free(item_it);
+
+	struct oscap_htable_iterator *ref_it = oscap_htable_iterator_new(refs);
+	while (oscap_htable_iterator_has_more(ref_it)) {
+		struct xccdf_policy_prefetch_ref *ref = oscap_htable_iterator_next_value(ref_it);
+		struct oscap_iterator *cb_it = _xccdf_policy_get_engines_by_sysname(policy, ref->sysname);
+		while (oscap_iterator_has_more(cb_it)) {
+			struct xccdf_policy_engine *engine = (struct xccdf_policy_engine *) oscap_iterator_next(cb_it);
+			oscap_stringlist_free(xccdf_policy_engine_query(engine, POLICY_ENGINE_QUERY_PREFETCH, &ref->data));
+		}
+		oscap_iterator_free(cb_it);
+	}
+	oscap_htable_iterator_free(ref_it);
+	oscap_htable_free(refs, (oscap_destruct_func) xccdf_policy_prefetch_ref_free);
+}
+
 /**
  * Evaluate XCCDF Policy
  * Iterate through Benchmark items and evalute one by one by calling 
@@ -1985,7 +2598,7 @@ static void xccdf_policy_add_final_setvalues(struct xccdf_policy *policy, struct
  * Callbacks for checking systems have to be defined before calling this function, otherwise 
  * rules would not be evaluated and process ends with error.
  */
-struct xccdf_result * xccdf_policy_evaluate(struct xccdf_policy * policy)
+static struct xccdf_result *_xccdf_policy_evaluate(struct xccdf_policy * policy)
 {
     struct xccdf_benchmark          * benchmark;
     int                               ret       = -1;
@@ -2038,6 +2651,10 @@ struct xccdf_result * xccdf_policy_evaluate(struct xccdf_policy * policy)
 
     oscap_free(id);
 
+	_xccdf_policy_prefetch(policy, benchmark);
+	_xccdf_policy_scoring_reset(policy, result);
+	policy->jobs = _xccdf_policy_jobs_start(policy, benchmark);
+
 	/** We need to process document top-down order.
 	 * See conflicts/requires and Item Processing Algorithm */
 	struct xccdf_item_iterator *item_it = xccdf_benchmark_get_content(benchmark);
@@ -2046,6 +2663,9 @@ struct xccdf_result * xccdf_policy_evaluate(struct xccdf_policy * policy)
 		ret = xccdf_policy_item_evaluate(policy, item, result);
 		if (ret == -1) {
 			xccdf_item_iterator_free(item_it);
+			_xccdf_policy_jobs_finish(policy->jobs);
+			policy->jobs = NULL;
+			_xccdf_policy_scoring_reset(policy, NULL);
 			xccdf_result_free(result);
 			return NULL;
 		}
@@ -2053,6 +2673,8 @@ struct xccdf_result * xccdf_policy_evaluate(struct xccdf_policy * policy)
 			break;
 	}
 	xccdf_item_iterator_free(item_it);
+	_xccdf_policy_jobs_finish(policy->jobs);
+	policy->jobs = NULL;
 
 	xccdf_policy_add_final_setvalues(policy, xccdf_benchmark_to_item(benchmark), result);
 
@@ -2070,12 +2692,34 @@ struct xccdf_result * xccdf_policy_evaluate(struct xccdf_policy * policy)
     return result;
 }
 
+struct xccdf_result * xccdf_policy_evaluate(struct xccdf_policy * policy)
+{
+	struct oscap_trace_span span;
+	struct xccdf_result *result;
+
+	oscap_trace_begin(&span, "xccdf_policy_evaluate");
+	result = _xccdf_policy_evaluate(policy);
+	oscap_trace_end(&span, result != NULL ? xccdf_result_get_id(result) : NULL);
+
+	return result;
+}
+
 struct xccdf_score * xccdf_policy_get_score(struct xccdf_policy * policy, struct xccdf_result * test_result, const char * scsystem)
 {
+	if (policy->scoring != NULL && policy->scoring_result == test_result)
+		return xccdf_scoring_get_score(policy->scoring, scsystem);
+
     struct xccdf_benchmark * benchmark = xccdf_policy_model_get_benchmark(xccdf_policy_get_model(policy));
 	return xccdf_result_calculate_score(test_result, (struct xccdf_item *) benchmark, scsystem);
 }
 
+struct xccdf_score *xccdf_policy_get_current_score(struct xccdf_policy *policy, const char *system)
+{
+	if (policy->scoring == NULL)
+		return NULL;
+	return xccdf_scoring_get_score(policy->scoring, system);
+}
+
 
 const char *xccdf_policy_get_value_of_item(struct xccdf_policy * policy, struct xccdf_item * item)
 {
@@ -2238,6 +2882,9 @@ void xccdf_policy_model_free(struct xccdf_policy_model * model) {
 	xccdf_tailoring_free(model->tailoring);
         xccdf_benchmark_free(model->benchmark);
 	cpe_session_free(model->cpe);
+	if (model->templates != NULL)
+		xccdf_substitution_templates_free(model->templates);
+	pthread_mutex_destroy(&model->templates_lock);
         oscap_free(model);
 }
 
@@ -2258,6 +2905,8 @@ void xccdf_policy_free(struct xccdf_policy * policy) {
 	oscap_htable_free0(policy->selected_internal);
 	oscap_htable_free0(policy->selected_final);
 	oscap_htable_free(policy->refine_rules_internal, (oscap_destruct_func) xccdf_refine_rule_internal_free);
+	oscap_free(policy->item_table);
+	xccdf_scoring_free(policy->scoring);
         oscap_free(policy);
 }
 
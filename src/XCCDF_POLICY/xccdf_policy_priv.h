@@ -25,6 +25,7 @@
 #ifndef _OSCAP_XCCDF_POLICY_PRIV_H
 #define _OSCAP_XCCDF_POLICY_PRIV_H
 
+#include <pthread.h>
 #include "common/util.h"
 #include "public/xccdf_policy.h"
 
@@ -43,8 +44,13 @@ struct xccdf_policy_model {
 	struct oscap_list       * policies;     ///< List of xccdf_policy structures
 	struct oscap_list       * callbacks;    ///< Callbacks for output callbacks (see callback_out_t)
 	struct oscap_list       * engines;      ///< Callbacks for checking engines (see xccdf_policy_engine)
+	unsigned int              jobs;         ///< Threads evaluating the rules of concurrent checking engines
 
 	struct cpe_session *cpe;
+	/** Parsed texts with substitutions (fixes, descriptions) indexed by the text,
+	 * see xccdf_policy_substitute */
+	struct oscap_htable       * templates;
+	pthread_mutex_t             templates_lock;
 };
 
 /**
@@ -55,6 +61,11 @@ struct xccdf_policy_model {
  * these lists from the benchmark file. Can be modified temporaly
  * so changes can be discarded or saved to the existing model.
  */
+struct xccdf_policy_item_entry {
+	unsigned char selected;		///< 0 if not resolved yet, 1 unselected, 2 selected
+	struct xccdf_refine_rule_internal *refine_rule; ///< owned by refine_rules_internal
+};
+
 struct xccdf_policy {
 
 	struct xccdf_policy_model   * model;    ///< XCCDF Policy model
@@ -70,6 +81,17 @@ struct xccdf_policy {
 	struct oscap_htable		*selected_final;
 	/* The hash-table contains the latest refine-rule for specified item-id. */
 	struct oscap_htable		*refine_rules_internal;
+	/** The final selection and the refine-rule of the items indexed by their
+	 * ordinals (see xccdf_item_get_ordinal), the hashes are not queried by the
+	 * evaluation. */
+	struct xccdf_policy_item_entry	*item_table;
+	unsigned int			item_table_size;
+	/** Scores of the TestResult of the latest xccdf_policy_evaluate, kept
+	 * up to date as its rule-results are reported and remediated */
+	struct xccdf_scoring		*scoring;
+	struct xccdf_result		*scoring_result;
+	/** Rules evaluated ahead by worker threads during xccdf_policy_evaluate */
+	struct xccdf_policy_jobs	*jobs;
 };
 
 
@@ -86,6 +108,18 @@ struct xccdf_policy {
  */
 int xccdf_policy_resolve_fix_substitution(struct xccdf_policy *policy, struct xccdf_fix *fix, struct xccdf_rule_result *rule_result, struct xccdf_result *test_result);
 
+/**
+ * Free the parsed texts of a policy model.
+ * @param templates xccdf_policy_model::templates
+ */
+void xccdf_substitution_templates_free(struct oscap_htable *templates);
+
+/**
+ * Whether the text has nothing to be substituted, so xccdf_policy_substitute
+ * would only serialize it again.
+ */
+bool xccdf_policy_text_is_literal(struct xccdf_policy *policy, const char *text);
+
 /**
  * Execute fix element for a given rule-result. Or find suitable (most appropriate) fix
  * in the policy, assign it to the rule-result and execute.
@@ -108,6 +142,11 @@ int xccdf_policy_rule_result_remediate(struct xccdf_policy *policy, struct xccdf
  */
 int xccdf_policy_check_evaluate(struct xccdf_policy * policy, struct xccdf_check * check);
 
+/**
+ * If set, xccdf_policy_remediate runs consecutive shell fixes by one shell.
+ */
+#define XCCDF_POLICY_REMEDIATE_BATCH_ENV "OSCAP_REMEDIATE_BATCH"
+
 /**
  * Remediate all rule-results in the given result, with settings of given policy.
  * @memberof xccdf_policy
@@ -134,6 +173,29 @@ int xccdf_policy_report_cb(struct xccdf_policy *policy, const char *sysname, voi
  */
 struct xccdf_benchmark *xccdf_policy_get_benchmark(const struct xccdf_policy *policy);
 
+/**
+ * Get the entry of an item in the item table of the policy
+ * @memberof xccdf_policy
+ * @param policy XCCDF Policy
+ * @param item xccdf:Item of the benchmark of the policy
+ * @param create grow the table if the item is beyond it
+ * @returns the entry or NULL if the item has no ordinal or is beyond the table
+ */
+struct xccdf_policy_item_entry *xccdf_policy_get_item_entry(struct xccdf_policy *policy, const struct xccdf_item *item, bool create);
+
+/**
+ * Same as xccdf_policy_is_item_selected, for the item itself rather than its id
+ * @memberof xccdf_policy
+ */
+bool xccdf_policy_get_item_selected(struct xccdf_policy *policy, const struct xccdf_item *item);
+
+/**
+ * Update the scores of the TestResult being evaluated after the rule-result
+ * was added to it or its result changed. Other TestResults are ignored.
+ * @memberof xccdf_policy
+ */
+void xccdf_policy_rescore_rule_result(struct xccdf_policy *policy, struct xccdf_result *result, struct xccdf_rule_result *rule_result);
+
 OSCAP_HIDDEN_END;
 
 #endif
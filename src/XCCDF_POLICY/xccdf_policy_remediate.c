@@ -21,8 +21,10 @@
 #include <config.h>
 #endif
 
+#include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <time.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
 #include <unistd.h>
@@ -34,6 +36,7 @@
 #include "common/assume.h"
 #include "common/debug_priv.h"
 #include "common/oscap_acquire.h"
+#include "common/oscap_string.h"
 #include "xccdf_policy_priv.h"
 #include "xccdf_policy_model_priv.h"
 #include "public/xccdf_policy.h"
@@ -80,47 +83,89 @@ static int _write_text_to_fd(int output_fd, const char* text) {
 
 }
 
-static int _write_text_to_fd_and_free(int output_fd, const char *text)
+/*
+ * The generated fixes are collected in a buffer and written to the output
+ * in large chunks, not by a write per line of every fix.
+ */
+#define _FIX_OUTPUT_BUFSZ 65536
+
+struct _fix_output {
+	int fd;
+	size_t len;
+	char buf[_FIX_OUTPUT_BUFSZ];
+};
+
+static int _fix_output_flush(struct _fix_output *out)
 {
-	int ret = _write_text_to_fd(output_fd, text);
-	oscap_free(text);
-	return ret;
+	size_t written = 0;
+
+	while (written < out->len) {
+		ssize_t w = write(out->fd, out->buf + written, out->len - written);
+		if (w < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		written += w;
+	}
+
+	if (written != out->len)
+		return 1;
+	out->len = 0;
+	return 0;
 }
 
-static int _write_remediation_to_fd_and_free(int output_fd, const char* template, char* text)
+static int _fix_output_write(struct _fix_output *out, const char *text, size_t length)
 {
-	if (oscap_streq(template, "urn:xccdf:fix:script:ansible")) {
-		// Add required indentation in front of every single line
+	while (length > 0) {
+		if (out->len == sizeof(out->buf) && _fix_output_flush(out) != 0)
+			return 1;
 
-		const char *delim = "\n";
-		const char *indentation = "\n    "; // we add indentation using replacement "\n" => "\n    "
+		size_t n = sizeof(out->buf) - out->len;
+		if (n > length)
+			n = length;
+		memcpy(out->buf + out->len, text, n);
+		out->len += n;
+		text += n;
+		length -= n;
+	}
+	return 0;
+}
 
-		char *token = strtok(text, delim);
-		while (token != NULL) {
+static inline int _fix_output_puts(struct _fix_output *out, const char *text)
+{
+	return _fix_output_write(out, text, strlen(text));
+}
 
-			// write indentation
-			if (_write_text_to_fd(output_fd, indentation) != 0) {
-				oscap_free(text);
-				return 1;
-			}
+static int _write_remediation_to_output_and_free(struct _fix_output *out, const char* template, char* text)
+{
+	int ret = 0;
 
-			// write rest of line
-			if (_write_text_to_fd(output_fd, token) != 0) {
-				oscap_free(text);
-				return 1;
+	if (oscap_streq(template, "urn:xccdf:fix:script:ansible")) {
+		// Add required indentation in front of every single non-empty line
+		const char *line = text;
+
+		while (*line != '\0' && ret == 0) {
+			size_t length = strcspn(line, "\n");
+			if (length > 0) {
+				ret = _fix_output_write(out, "\n    ", 5) ||
+					_fix_output_write(out, line, length);
 			}
-
-			token = strtok(NULL, delim);
+			line += length;
+			if (*line == '\n')
+				++line;
 		}
-
-		oscap_free(text);
-		return _write_text_to_fd(output_fd, "\n");
-
+		if (ret == 0)
+			ret = _fix_output_write(out, "\n", 1);
 	} else {
 		// no extra processing is needed
-		return _write_text_to_fd_and_free(output_fd, text);
+		ret = _fix_output_puts(out, text);
 	}
+
+	oscap_free(text);
+	return ret;
 }
+
 struct _interpret_map {
 	const char *sys;
 	const char *interpret;
@@ -312,27 +357,22 @@ static inline int _xccdf_fix_decode_xml(struct xccdf_fix *fix, char **result)
 	return 0;
 }
 
-static inline int _xccdf_fix_execute(struct xccdf_rule_result *rr, struct xccdf_fix *fix)
+/*
+ * Run the script by the interpreter. The standard and the error output of
+ * the script are returned in `output' and its exit code in `status'.
+ * Returns 0 if the script was run, otherwise `error' describes the problem
+ * (if known).
+ */
+static int _xccdf_fix_run(const char *interpret, const char *script, char **output, int *status, char **error)
 {
-	const char *interpret = NULL;
 	char *temp_dir = NULL;
 	char *temp_file = NULL;
-	char *fix_text = NULL;
 	int fd;
 	int result = 1;
-	if (fix == NULL || rr == NULL || oscap_streq(xccdf_fix_get_content(fix), NULL))
-		return 1;
-
-	if ((interpret = _get_supported_interpret(xccdf_fix_get_system(fix), NULL)) == NULL) {
-		_rule_add_info_message(rr, "Not supported xccdf:fix/@system='%s' or missing interpreter.",
-				xccdf_fix_get_system(fix) == NULL ? "" : xccdf_fix_get_system(fix));
-		return 1;
-	}
 
-	if (_xccdf_fix_decode_xml(fix, &fix_text) != 0) {
-		_rule_add_info_message(rr, "Fix element contains unresolved child elements.");
-		return 1;
-	}
+	*output = NULL;
+	*status = 0;
+	*error = NULL;
 
 	temp_dir = oscap_acquire_temp_dir();
 	if (temp_dir == NULL)
@@ -342,22 +382,22 @@ static inline int _xccdf_fix_execute(struct xccdf_rule_result *rr, struct xccdf_
 	// and become basically unconfined.
 	fd = oscap_acquire_temp_file(temp_dir, "fix-XXXXXXXX", &temp_file);
 	if (fd == -1) {
-		_rule_add_info_message(rr, "mkstemp failed: %s", strerror(errno));
+		*error = oscap_sprintf("mkstemp failed: %s", strerror(errno));
 		goto cleanup;
 	}
 
-	if (_write_text_to_fd_and_free(fd, fix_text) != 0) {
-		_rule_add_info_message(rr, "Could not write to the temp file: %s", strerror(errno));
+	if (_write_text_to_fd(fd, script) != 0) {
+		*error = oscap_sprintf("Could not write to the temp file: %s", strerror(errno));
 		(void) close(fd);
 		goto cleanup;
 	}
 
 	if (close(fd) != 0)
-		_rule_add_info_message(rr, "Could not close temp file: %s", strerror(errno));
+		dW("Could not close temp file: %s", strerror(errno));
 
 	int pipefd[2];
 	if (pipe(pipefd) == -1) {
-		_rule_add_info_message(rr, "Could not create pipe: %s", strerror(errno));
+		*error = oscap_sprintf("Could not create pipe: %s", strerror(errno));
 		goto cleanup;
 	}
 
@@ -389,30 +429,81 @@ static inline int _xccdf_fix_execute(struct xccdf_rule_result *rr, struct xccdf_
 			printf("Error while executing fix script: execve returned: %s\n", strerror(errno));
 			exit(42);
 		} else {
-			oscap_free(temp_file);
 			close(pipefd[1]);
-			const char *stdout_buff = oscap_acquire_pipe_to_string(pipefd[0]);
+			*output = oscap_acquire_pipe_to_string(pipefd[0]);
 			int wstatus;
 			waitpid(fork_result, &wstatus, 0);
-			_rule_add_info_message(rr, "Fix execution completed and returned: %d", WEXITSTATUS(wstatus));
-			if (stdout_buff != NULL && stdout_buff[0] != '\0')
-				_rule_add_info_message(rr, stdout_buff);
-			oscap_free(stdout_buff);
+			*status = WEXITSTATUS(wstatus);
 			/* We return zero to indicate success. Rather than returning the exit code. */
 			result = 0;
 		}
 	} else {
-		_rule_add_info_message(rr, "Failed to fork. %s", strerror(errno));
-		oscap_free(temp_file);
+		*error = oscap_sprintf("Failed to fork. %s", strerror(errno));
+		close(pipefd[0]);
+		close(pipefd[1]);
 	}
 
 cleanup:
+	oscap_free(temp_file);
 	oscap_acquire_cleanup_dir(&temp_dir);
 	return result;
 }
 
-int xccdf_policy_rule_result_remediate(struct xccdf_policy *policy, struct xccdf_rule_result *rr, struct xccdf_fix *fix, struct xccdf_result *test_result)
+static void _rule_add_fix_output(struct xccdf_rule_result *rr, int status, const char *output)
+{
+	_rule_add_info_message(rr, "Fix execution completed and returned: %d", status);
+	if (output != NULL && output[0] != '\0')
+		_rule_add_info_message(rr, output);
+}
+
+/*
+ * Check that the fix can be executed and decode its script. Returns 0
+ * on success, otherwise the reason is added to the rule-result.
+ */
+static inline int _xccdf_fix_prepare(struct xccdf_rule_result *rr, struct xccdf_fix *fix, const char **interpret, char **fix_text)
 {
+	if (fix == NULL || rr == NULL || oscap_streq(xccdf_fix_get_content(fix), NULL))
+		return 1;
+
+	if ((*interpret = _get_supported_interpret(xccdf_fix_get_system(fix), NULL)) == NULL) {
+		_rule_add_info_message(rr, "Not supported xccdf:fix/@system='%s' or missing interpreter.",
+				xccdf_fix_get_system(fix) == NULL ? "" : xccdf_fix_get_system(fix));
+		return 1;
+	}
+
+	if (_xccdf_fix_decode_xml(fix, fix_text) != 0) {
+		_rule_add_info_message(rr, "Fix element contains unresolved child elements.");
+		return 1;
+	}
+	return 0;
+}
+
+static inline int _xccdf_fix_execute(struct xccdf_rule_result *rr, const char *interpret, const char *fix_text)
+{
+	char *output = NULL;
+	char *error = NULL;
+	int status;
+
+	int result = _xccdf_fix_run(interpret, fix_text, &output, &status, &error);
+	if (result == 0)
+		_rule_add_fix_output(rr, status, output);
+	else if (error != NULL)
+		_rule_add_info_message(rr, error);
+	oscap_free(output);
+	oscap_free(error);
+	return result;
+}
+
+/*
+ * Find the fix of the rule-result (unless given), resolve its substitutions
+ * and decode it. Returns 0 and sets `fix_text' if there is a fix to execute,
+ * otherwise returns what xccdf_policy_rule_result_remediate shall return and
+ * leaves `fix_text' NULL.
+ */
+static int _xccdf_policy_rule_result_fix_prepare(struct xccdf_policy *policy, struct xccdf_rule_result *rr, struct xccdf_fix *fix, struct xccdf_result *test_result,
+		struct xccdf_check **check_out, const char **interpret, char **fix_text)
+{
+	*fix_text = NULL;
 	if (policy == NULL || rr == NULL)
 		return 1;
 	if (xccdf_rule_result_get_result(rr) != XCCDF_RESULT_FAIL)
@@ -433,6 +524,7 @@ int xccdf_policy_rule_result_remediate(struct xccdf_policy *policy, struct xccdf
 	if (check != NULL && xccdf_check_get_multicheck(check))
 		// Do not try to apply fix for multi-check.
 		return 0;
+	*check_out = check;
 
 	/* Initialize the fix. */
 	struct xccdf_fix *cfix = xccdf_fix_clone(fix);
@@ -443,13 +535,17 @@ int xccdf_policy_rule_result_remediate(struct xccdf_policy *policy, struct xccdf
 		return res;
 	}
 
-	/* Execute the fix. */
-	res = _xccdf_fix_execute(rr, cfix);
+	res = _xccdf_fix_prepare(rr, cfix, interpret, fix_text);
 	if (res != 0) {
 		_rule_add_info_message(rr, "Fix was not executed. Execution was aborted.");
 		return res;
 	}
+	return 0;
+}
 
+/* Report the executed fix and verify it by evaluating the check again. */
+static int _xccdf_policy_rule_result_fix_verify(struct xccdf_policy *policy, struct xccdf_rule_result *rr, struct xccdf_check *check, struct xccdf_result *test_result)
+{
 	/* We report rule during remediation only when the fix was actually executed */
 	int report = 0;
 	struct xccdf_rule *rule = _lookup_rule_by_rule_result(policy, rr);
@@ -477,20 +573,216 @@ int xccdf_policy_rule_result_remediate(struct xccdf_policy *policy, struct xccdf
 				new_result <= 0 ? "internal error" : xccdf_test_result_type_get_text(new_result));
 		}
 	}
+	xccdf_policy_rescore_rule_result(policy, test_result, rr);
 
 	xccdf_rule_result_set_time_current(rr);
 	return rule == NULL ? 0 : xccdf_policy_report_cb(policy, XCCDF_POLICY_OUTCB_END, (void *) rr);
 }
 
-int xccdf_policy_remediate(struct xccdf_policy *policy, struct xccdf_result *result)
+int xccdf_policy_rule_result_remediate(struct xccdf_policy *policy, struct xccdf_rule_result *rr, struct xccdf_fix *fix, struct xccdf_result *test_result)
 {
-	__attribute__nonnull__(result);
+	struct xccdf_check *check = NULL;
+	const char *interpret = NULL;
+	char *fix_text = NULL;
+
+	int res = _xccdf_policy_rule_result_fix_prepare(policy, rr, fix, test_result, &check, &interpret, &fix_text);
+	if (fix_text == NULL)
+		return res;
+
+	/* Execute the fix. */
+	res = _xccdf_fix_execute(rr, interpret, fix_text);
+	oscap_free(fix_text);
+	if (res != 0) {
+		_rule_add_info_message(rr, "Fix was not executed. Execution was aborted.");
+		return res;
+	}
+
+	return _xccdf_policy_rule_result_fix_verify(policy, rr, check, test_result);
+}
+
+/*
+ * Batched remediation (see XCCDF_POLICY_REMEDIATE_BATCH_ENV)
+ *
+ * The fixes are prepared first. Runs of consecutive fixes for the shell
+ * are then concatenated into one script, every fix in a subshell of its
+ * own so that its exit, options and variables don't affect the others,
+ * framed by marker lines which carry the index and the exit status of the
+ * fix. The output between the markers is attributed to the rule-result
+ * of the fix. The fixes for other interpreters are run one by one. The
+ * fixes are verified when all of them were executed.
+ */
+struct _xccdf_fix_job {
+	struct xccdf_rule_result *rr;
+	struct xccdf_check *check;
+	const char *interpret;
+	char *fix_text;
+	bool executed;
+};
+
+#define _FIX_BATCH_INTERPRET "/bin/bash"
+
+static char *_xccdf_fix_batch_script(struct _xccdf_fix_job *jobs, size_t count, const char *mark)
+{
+	struct oscap_string *script = oscap_string_new();
+
+	for (size_t i = 0; i < count; ++i) {
+		char *frame = oscap_sprintf("printf '%%s begin %zu\\n' '%s'\n(\n", i, mark);
+		oscap_string_append_string(script, frame);
+		oscap_free(frame);
+		oscap_string_append_string(script, jobs[i].fix_text);
+		// The output of the fix may not end by a new line, the one before the marker is dropped.
+		frame = oscap_sprintf("\n)\nprintf '\\n%%s end %zu %%d\\n' '%s' $?\n", i, mark);
+		oscap_string_append_string(script, frame);
+		oscap_free(frame);
+	}
+	return oscap_string_bequeath(script);
+}
+
+/* Find the marker line "<mark> <what> <index>" in the output, returns its start. */
+static char *_xccdf_fix_batch_find(char *output, const char *mark, const char *what, size_t index, char **line_end)
+{
+	char *line = oscap_sprintf("%s %s %zu", mark, what, index);
+	size_t len = strlen(line);
+	char *p = output;
+
+	while ((p = strstr(p, line)) != NULL) {
+		if ((p == output || p[-1] == '\n') && (p[len] == '\n' || p[len] == ' ')) {
+			*line_end = strchr(p + len, '\n');
+			if (*line_end == NULL)
+				*line_end = p + strlen(p);
+			break;
+		}
+		p += len;
+	}
+	oscap_free(line);
+	return p;
+}
+
+/*
+ * Execute the fixes by one interpreter. Returns the number of the jobs
+ * processed, at least one: if a fix ends the whole script (e.g. by a syntax
+ * error), it's attributed the rest of the output and the exit code of the
+ * script, and the fixes after it are left for the next batch.
+ */
+static size_t _xccdf_fix_batch_execute(struct _xccdf_fix_job *jobs, size_t count)
+{
+	char *mark = oscap_sprintf("oscap-fix-%ld-%lx", (long) getpid(), (unsigned long) time(NULL) ^ (unsigned long) random());
+	char *script = _xccdf_fix_batch_script(jobs, count, mark);
+	char *output = NULL;
+	char *error = NULL;
+	int status;
+	size_t done = 0;
+
+	dI("Executing %zu fixes by one %s.", count, jobs[0].interpret);
+
+	if (_xccdf_fix_run(jobs[0].interpret, script, &output, &status, &error) != 0) {
+		for (size_t i = 0; i < count; ++i) {
+			if (error != NULL)
+				_rule_add_info_message(jobs[i].rr, error);
+			_rule_add_info_message(jobs[i].rr, "Fix was not executed. Execution was aborted.");
+		}
+		done = count;
+		goto cleanup;
+	}
+
+	for (; done < count; ++done) {
+		char *begin_end, *end_end;
+		char *begin = _xccdf_fix_batch_find(output != NULL ? output : "", mark, "begin", done, &begin_end);
+		if (begin == NULL) {
+			// The script ended before the fix, unless it's the first one, try again.
+			if (done == 0) {
+				_rule_add_fix_output(jobs[0].rr, status, output);
+				jobs[0].executed = true;
+				done = 1;
+			}
+			break;
+		}
+
+		char *fix_output = *begin_end == '\0' ? begin_end : begin_end + 1;
+		char *end = _xccdf_fix_batch_find(fix_output, mark, "end", done, &end_end);
+		if (end == NULL) {
+			// The fix ended the script.
+			_rule_add_fix_output(jobs[done].rr, status, fix_output);
+			jobs[done].executed = true;
+			++done;
+			break;
+		}
+
+		// "<mark> end <index> <status>"
+		int fix_status = 0;
+		char *status_str = strchr(end + strlen(mark) + strlen(" end "), ' ');
+		if (status_str != NULL)
+			fix_status = atoi(status_str + 1);
+		if (end > fix_output && end[-1] == '\n')
+			--end;
+		char *text = strndup(fix_output, end - fix_output);
+		_rule_add_fix_output(jobs[done].rr, fix_status, text);
+		free(text);
+		jobs[done].executed = true;
+	}
+
+cleanup:
+	oscap_free(mark);
+	oscap_free(script);
+	oscap_free(output);
+	oscap_free(error);
+	return done;
+}
+
+static void _xccdf_policy_remediate_batch(struct xccdf_policy *policy, struct xccdf_result *result)
+{
+	struct _xccdf_fix_job *jobs = NULL;
+	size_t count = 0;
+
 	struct xccdf_rule_result_iterator *rr_it = xccdf_result_get_rule_results(result);
 	while (xccdf_rule_result_iterator_has_more(rr_it)) {
 		struct xccdf_rule_result *rr = xccdf_rule_result_iterator_next(rr_it);
-		xccdf_policy_rule_result_remediate(policy, rr, NULL, result);
+		struct _xccdf_fix_job job = { rr, NULL, NULL, NULL, false };
+
+		_xccdf_policy_rule_result_fix_prepare(policy, rr, NULL, result, &job.check, &job.interpret, &job.fix_text);
+		if (job.fix_text == NULL)
+			continue;
+		jobs = oscap_realloc(jobs, sizeof(struct _xccdf_fix_job) * (count + 1));
+		jobs[count++] = job;
 	}
 	xccdf_rule_result_iterator_free(rr_it);
+
+	for (size_t i = 0; i < count; ) {
+		size_t n = 1;
+		if (oscap_streq(jobs[i].interpret, _FIX_BATCH_INTERPRET)) {
+			while (i + n < count && oscap_streq(jobs[i + n].interpret, _FIX_BATCH_INTERPRET))
+				++n;
+			i += _xccdf_fix_batch_execute(jobs + i, n);
+		} else {
+			if (_xccdf_fix_execute(jobs[i].rr, jobs[i].interpret, jobs[i].fix_text) == 0)
+				jobs[i].executed = true;
+			else
+				_rule_add_info_message(jobs[i].rr, "Fix was not executed. Execution was aborted.");
+			++i;
+		}
+	}
+
+	for (size_t i = 0; i < count; ++i) {
+		if (jobs[i].executed)
+			_xccdf_policy_rule_result_fix_verify(policy, jobs[i].rr, jobs[i].check, result);
+		oscap_free(jobs[i].fix_text);
+	}
+	oscap_free(jobs);
+}
+
+int xccdf_policy_remediate(struct xccdf_policy *policy, struct xccdf_result *result)
+{
+	__attribute__nonnull__(result);
+	if (getenv(XCCDF_POLICY_REMEDIATE_BATCH_ENV) != NULL) {
+		_xccdf_policy_remediate_batch(policy, result);
+	} else {
+		struct xccdf_rule_result_iterator *rr_it = xccdf_result_get_rule_results(result);
+		while (xccdf_rule_result_iterator_has_more(rr_it)) {
+			struct xccdf_rule_result *rr = xccdf_rule_result_iterator_next(rr_it);
+			xccdf_policy_rule_result_remediate(policy, rr, NULL, result);
+		}
+		xccdf_rule_result_iterator_free(rr_it);
+	}
 	xccdf_result_set_end_time_current(result);
 	return 0;
 }
@@ -514,10 +806,10 @@ static const struct xccdf_fix *_find_fix_for_template(struct xccdf_policy *polic
 	return fix;
 }
 
-static inline int _xccdf_policy_rule_generate_fix(struct xccdf_policy *policy, struct xccdf_rule *rule, const char *template, int output_fd)
+static inline int _xccdf_policy_rule_generate_fix(struct xccdf_policy *policy, struct xccdf_rule *rule, const char *template, struct _fix_output *out)
 {
 	// Ensure that given Rule is selected and applicable (CPE).
-	const bool is_selected = xccdf_policy_is_item_selected(policy, xccdf_rule_get_id(rule));
+	const bool is_selected = xccdf_policy_get_item_selected(policy, (const struct xccdf_item *) rule);
 	if (!is_selected) {
 		dI("Skipping unselected Rule/@id=\"%s\"", xccdf_rule_get_id(rule));
 		return 0;
@@ -554,15 +846,15 @@ static inline int _xccdf_policy_rule_generate_fix(struct xccdf_policy *policy, s
 	}
 	xccdf_fix_free(cfix);
 
-	// Print-out the fix to the output_fd
-	if (_write_remediation_to_fd_and_free(output_fd, template, fix_text) != 0) {
-		oscap_seterr(OSCAP_EFAMILY_OSCAP, "write of the fix to fd=%d failed: %s", output_fd, strerror(errno));
+	// Print-out the fix to the output
+	if (_write_remediation_to_output_and_free(out, template, fix_text) != 0) {
+		oscap_seterr(OSCAP_EFAMILY_OSCAP, "write of the fix to fd=%d failed: %s", out->fd, strerror(errno));
 		return 1;
 	}
 	return 0;
 }
 
-static int _xccdf_policy_item_generate_fix(struct xccdf_policy *policy, struct xccdf_item *item, const char *template, int output_fd)
+static int _xccdf_policy_item_generate_fix(struct xccdf_policy *policy, struct xccdf_item *item, const char *template, struct _fix_output *out)
 {
 	int ret = 0;
 	switch (xccdf_item_get_type(item)) {
@@ -570,14 +862,14 @@ static int _xccdf_policy_item_generate_fix(struct xccdf_policy *policy, struct x
 		struct xccdf_item_iterator *child_it = xccdf_group_get_content((struct xccdf_group *) item);
 		while (xccdf_item_iterator_has_more(child_it)) {
 			struct xccdf_item *child = xccdf_item_iterator_next(child_it);
-			ret = _xccdf_policy_item_generate_fix(policy, child, template, output_fd);
+			ret = _xccdf_policy_item_generate_fix(policy, child, template, out);
 			if (ret != 0)
 				break;
 		}
 		xccdf_item_iterator_free(child_it);
 		} break;
 	case XCCDF_RULE:{
-		ret = _xccdf_policy_rule_generate_fix(policy, (struct xccdf_rule *) item, template, output_fd);
+		ret = _xccdf_policy_rule_generate_fix(policy, (struct xccdf_rule *) item, template, out);
 		} break;
 	default:
 		assert(false);
@@ -586,7 +878,7 @@ static int _xccdf_policy_item_generate_fix(struct xccdf_policy *policy, struct x
 	return ret;
 }
 
-static int _write_script_header_to_fd(const char *sys, int output_fd)
+static int _write_script_header_to_output(const char *sys, struct _fix_output *out)
 {
 	if (oscap_streq(sys, "urn:xccdf:fix:script:ansible")) {
 
@@ -595,7 +887,7 @@ static int _write_script_header_to_fd(const char *sys, int output_fd)
 			"# - hosts: localhost # set required host\n"
 			"   tasks:\n";
 
-		return _write_text_to_fd(output_fd, ansible_header);
+		return _fix_output_puts(out, ansible_header);
 
 	} else {
 		// no header required
@@ -603,31 +895,46 @@ static int _write_script_header_to_fd(const char *sys, int output_fd)
 	}
 }
 
+static int _xccdf_policy_generate_fix_to_output(struct xccdf_policy *policy, const char *sys, struct _fix_output *out)
+{
+	dI("Generating fixes for policy(profile/@id=%s)", xccdf_policy_get_id(policy));
+	int ret = 0;
+	struct xccdf_benchmark *benchmark = xccdf_policy_get_benchmark(policy);
+	if (benchmark == NULL) {
+		oscap_seterr(OSCAP_EFAMILY_OSCAP, "Could not find benchmark model for policy id='%s' when generating fixes.", xccdf_policy_get_id(policy));
+		return 1;
+	}
+
+	if (_write_script_header_to_output(sys, out) != 0)
+		return 1;
+
+	struct xccdf_item_iterator *item_it = xccdf_benchmark_get_content(benchmark);
+	while (xccdf_item_iterator_has_more(item_it)) {
+		struct xccdf_item *item = xccdf_item_iterator_next(item_it);
+		ret = _xccdf_policy_item_generate_fix(policy, item, sys, out);
+		if (ret != 0)
+			break;
+	}
+	xccdf_item_iterator_free(item_it);
+	return ret;
+}
+
 int xccdf_policy_generate_fix(struct xccdf_policy *policy, struct xccdf_result *result, const char *sys, int output_fd)
 {
 	__attribute__nonnull__(policy);
 
 	if (result == NULL) {
 		// No TestResult is available. Generate fix from the stock profile.
-		dI("Generating fixes for policy(profile/@id=%s)", xccdf_policy_get_id(policy));
-		int ret = 0;
-		struct xccdf_benchmark *benchmark = xccdf_policy_get_benchmark(policy);
-		if (benchmark == NULL) {
-			oscap_seterr(OSCAP_EFAMILY_OSCAP, "Could not find benchmark model for policy id='%s' when generating fixes.", xccdf_policy_get_id(policy));
-			return 1;
-		}
-
-		if (_write_script_header_to_fd(sys, output_fd) != 0)
-			return 1;
-
-		struct xccdf_item_iterator *item_it = xccdf_benchmark_get_content(benchmark);
-		while (xccdf_item_iterator_has_more(item_it)) {
-			struct xccdf_item *item = xccdf_item_iterator_next(item_it);
-			ret = _xccdf_policy_item_generate_fix(policy, item, sys, output_fd);
-			if (ret != 0)
-				break;
+		struct _fix_output *out = oscap_talloc(struct _fix_output);
+		out->fd = output_fd;
+		out->len = 0;
+
+		int ret = _xccdf_policy_generate_fix_to_output(policy, sys, out);
+		if (_fix_output_flush(out) != 0) {
+			oscap_seterr(OSCAP_EFAMILY_OSCAP, "write of the fixes to fd=%d failed: %s", output_fd, strerror(errno));
+			ret = 1;
 		}
-		xccdf_item_iterator_free(item_it);
+		oscap_free(out);
 		return ret;
 	}
 	else {
@@ -635,3 +942,33 @@ int xccdf_policy_generate_fix(struct xccdf_policy *policy, struct xccdf_result *
 		return 1;
 	}
 }
+
+int xccdf_policy_model_generate_fix(struct xccdf_policy_model *model, const char **profile_ids, const char *sys, int output_fd)
+{
+	__attribute__nonnull__(model);
+	__attribute__nonnull__(profile_ids);
+
+	int ret = 0;
+	struct _fix_output *out = oscap_talloc(struct _fix_output);
+	out->fd = output_fd;
+	out->len = 0;
+
+	// The policies share the model, the benchmark is resolved and the
+	// applicability and the substitution templates are cached only once.
+	for (size_t i = 0; profile_ids[i] != NULL && ret == 0; ++i) {
+		struct xccdf_policy *policy = xccdf_policy_model_get_policy_by_id(model, profile_ids[i]);
+		if (policy == NULL) {
+			oscap_seterr(OSCAP_EFAMILY_OSCAP, "Could not find Profile/@id=\"%s\" to generate fixes.", profile_ids[i]);
+			ret = 1;
+			break;
+		}
+		ret = _xccdf_policy_generate_fix_to_output(policy, sys, out);
+	}
+
+	if (_fix_output_flush(out) != 0) {
+		oscap_seterr(OSCAP_EFAMILY_OSCAP, "write of the fixes to fd=%d failed: %s", output_fd, strerror(errno));
+		ret = 1;
+	}
+	oscap_free(out);
+	return ret;
+}
@@ -88,6 +88,10 @@ static inline struct xccdf_refine_rule_internal* _xccdf_refine_rule_internal_new
 
 struct xccdf_refine_rule_internal* xccdf_policy_get_refine_rule_by_item(struct xccdf_policy* policy, struct xccdf_item* rule)
 {
+	const struct xccdf_policy_item_entry *entry = xccdf_policy_get_item_entry(policy, rule, false);
+	if (entry != NULL)
+		return entry->refine_rule;
+
 	const char* item_id = xccdf_item_get_id(rule);
 	return oscap_htable_get(policy->refine_rules_internal, item_id);
 }
@@ -128,19 +132,25 @@ xccdf_level_t xccdf_get_final_severity(const struct xccdf_rule* rule, const stru
 }
 
 /**
- * Put refine-rule into hash table with item_id as key. Refine-rules are with same key are merged.
- * @param refine_rules_internal hash table
+ * Put refine-rule into hash table with item_id as key and into the item table
+ * of the policy. Refine-rules are with same key are merged.
+ * @param policy XCCDF policy
  * @param new_rr refine-rule to add
- * @param item_id key to hash table
+ * @param item refined item
  */
-static void _add_refine_rule(struct oscap_htable* refine_rules_internal, const struct xccdf_refine_rule* new_rr, const char* item_id)
+static void _add_refine_rule(struct xccdf_policy* policy, const struct xccdf_refine_rule* new_rr, struct xccdf_item* item)
 {
-	struct xccdf_refine_rule_internal* old = oscap_htable_get(refine_rules_internal, item_id);
+	const char* item_id = xccdf_item_get_id(item);
+	struct xccdf_refine_rule_internal* old = oscap_htable_get(policy->refine_rules_internal, item_id);
 	if (old != NULL) { // modify refine-rule in hash-table
 		_merge_refine_rules(old, new_rr);
 	} else { // add new refine-rule to hash-table
 		struct xccdf_refine_rule_internal* new_internal_rr = _xccdf_refine_rule_internal_new_from_refine_rule(new_rr);
-		oscap_htable_add(refine_rules_internal, item_id, new_internal_rr);
+		oscap_htable_add(policy->refine_rules_internal, item_id, new_internal_rr);
+
+		struct xccdf_policy_item_entry *entry = xccdf_policy_get_item_entry(policy, item, true);
+		if (entry != NULL)
+			entry->refine_rule = new_internal_rr;
 	}
 }
 
@@ -155,7 +165,7 @@ static inline void _xccdf_policy_add_xccdf_refine_rule_internal(struct xccdf_pol
 	const char* rr_item_id = xccdf_refine_rule_get_item(refine_rule);
 	struct xccdf_item* item = xccdf_benchmark_get_member(benchmark, XCCDF_ITEM, rr_item_id);
 	if (item != NULL) { // get item by id
-		_add_refine_rule(policy->refine_rules_internal, refine_rule, rr_item_id);
+		_add_refine_rule(policy, refine_rule, item);
 		return;
 	}
 
@@ -167,12 +177,12 @@ static inline void _xccdf_policy_add_xccdf_refine_rule_internal(struct xccdf_pol
 	}
 
 	while (oscap_htable_iterator_has_more(hit)) { // iterate through every item in cluster
-		const char* item_id = oscap_htable_iterator_next_key(hit);
-		if (item_id == NULL) {
-			assert(item_id != NULL);
+		struct xccdf_item* cluster_item = oscap_htable_iterator_next_value(hit);
+		if (cluster_item == NULL) {
+			assert(cluster_item != NULL);
 			continue;
 		}
-		_add_refine_rule(policy->refine_rules_internal,refine_rule, item_id);
+		_add_refine_rule(policy, refine_rule, cluster_item);
 	}
 	oscap_htable_iterator_free(hit);
 }
@@ -22,10 +22,13 @@
 #endif
 
 #include <string.h>
+#include <pthread.h>
 #include <libxml/tree.h>
+#include <libxml/parser.h>
 
 #include "util.h"
-#include "xml_iterate.h"
+#include "list.h"
+#include "oscap_string.h"
 #include "debug_priv.h"
 #include "assume.h"
 #include "_error.h"
@@ -46,129 +49,334 @@ struct _xccdf_text_substitution_data {
 	// TODO: This shall carry also xccdf:TestResult for xccdf:fact resolution
 };
 
+/*
+ * A text with substitutions is parsed once into a template: the serialized
+ * XML between the substituted elements and a slot for every substituted
+ * element, in document order. The templates are kept by the policy model
+ * keyed by the text, so resolving the same fix or description again (for
+ * another rule-result, profile or output) is a linear fill of the slots.
+ */
+enum _xccdf_slot_type {
+	_SLOT_SUB,		// xccdf:sub
+	_SLOT_SUB_NOIDREF,	// xccdf:sub without @idref
+	_SLOT_VALUE,		// xhtml:object/@data="#xccdf:value:..."
+	_SLOT_TITLE,		// xhtml:object/@data="#xccdf:title:..."
+	_SLOT_INSTANCE		// xccdf:instance
+};
+
+struct _xccdf_slot {
+	enum _xccdf_slot_type type;
+	char *idref;
+	char *use;		// xccdf:sub/@use
+};
+
+struct xccdf_substitution_template {
+	size_t count;		// number of slots
+	struct _xccdf_slot *slots;
+	char **literals;	// count + 1 segments around the slots
+	bool valid;		// false if the text isn't a well-formed fragment
+};
+
+// The slots are marked in the serialized fragment by this processing instruction
+#define _SLOT_MARK_NAME "oscap-substitution-slot"
+#define _SLOT_MARK "<?" _SLOT_MARK_NAME "?>"
+
 static bool _xhtml_is_supported_namespace(xmlNs *ns)
 {
 	return ns != NULL && oscap_streq((const char *) ns->href, (const char *) XCCDF_XHTML_NAMESPACE);
 }
 
-static int _xccdf_text_substitution_cb(xmlNode **node, void *user_data)
+static void _xccdf_slot_add(struct xccdf_substitution_template *tmpl, enum _xccdf_slot_type type, char *idref, char *use)
 {
-	struct _xccdf_text_substitution_data *data = (struct _xccdf_text_substitution_data *) user_data;
-	if (node == NULL || *node == NULL || data == NULL)
-		return 1;
+	tmpl->slots = oscap_realloc(tmpl->slots, sizeof(struct _xccdf_slot) * (tmpl->count + 1));
+	tmpl->slots[tmpl->count].type = type;
+	tmpl->slots[tmpl->count].idref = idref;
+	tmpl->slots[tmpl->count].use = use;
+	tmpl->count++;
+}
+
+/*
+ * Record the slot of the node if it's substituted. Returns true if the
+ * node is replaced by the slot, its children aren't substituted then.
+ */
+static bool _xccdf_slot_of_node(struct xccdf_substitution_template *tmpl, xmlNode *node)
+{
+	if (node->type != XML_ELEMENT_NODE)
+		return false;
 
-	if (oscap_streq((const char *) (*node)->name, "sub") && xccdf_is_supported_namespace((*node)->ns)) {
-		if ((*node)->children != NULL)
+	if (oscap_streq((const char *) node->name, "sub") && xccdf_is_supported_namespace(node->ns)) {
+		if (node->children != NULL)
 			dW("The xccdf:sub element SHALL NOT have any content.");
-		char *sub_idref = (char *) xmlGetProp(*node, BAD_CAST "idref");
+		char *sub_idref = (char *) xmlGetProp(node, BAD_CAST "idref");
 		if (oscap_streq(sub_idref, NULL)) {
-			oscap_seterr(OSCAP_EFAMILY_XCCDF, "The xccdf:sub MUST have a single @idref attribute.");
 			free(sub_idref); // It may be an empty string.
-			return 2;
+			_xccdf_slot_add(tmpl, _SLOT_SUB_NOIDREF, NULL, NULL);
+		} else {
+			_xccdf_slot_add(tmpl, _SLOT_SUB, sub_idref, (char *) xmlGetProp(node, BAD_CAST "use"));
 		}
-		// Sub element may refer to xccdf:Value or to xccdf:plain-text
+		return true;
+	} else if (oscap_streq((const char *) node->name, "object") && _xhtml_is_supported_namespace(node->ns)) {
+		char *object_data = (char *) xmlGetProp(node, BAD_CAST "data");
+		if (object_data == NULL || strncmp(object_data, "#xccdf:", strlen("#xccdf:")) != 0) {
+			free(object_data);
+			return false; // Not an error, unless it shall be resolved by XCCDF
+		}
+
+		if (strncmp(object_data, "#xccdf:value:", strlen("#xccdf:value:")) == 0) {
+			_xccdf_slot_add(tmpl, _SLOT_VALUE, oscap_strdup(object_data + strlen("#xccdf:value:")), NULL);
+		} else if (strncmp(object_data, "#xccdf:title:", strlen("#xccdf:title:")) == 0) {
+			_xccdf_slot_add(tmpl, _SLOT_TITLE, oscap_strdup(object_data + strlen("#xccdf:title:")), NULL);
+		} else {
+			// Let's not consider this as an error. Since in similar cases NISTIR-7275r4
+			// suggests to retain the <object> element.
+			dW("Unsupported XCCDF uri: xhtml:object/@data='%s'", object_data);
+			free(object_data);
+			return false;
+		}
+		free(object_data);
+		return true;
+	} else if (oscap_streq((const char *) node->name, "instance") && xccdf_is_supported_namespace(node->ns)) {
+		// <instance> elements
+		if (node->children != NULL)
+			dW("The xccdf:instance element SHALL NOT have any content.");
+		_xccdf_slot_add(tmpl, _SLOT_INSTANCE, NULL, NULL);
+		return true;
+	}
+	return false;
+}
+
+static void _xccdf_slots_mark(struct xccdf_substitution_template *tmpl, xmlDoc *doc, xmlNode *node)
+{
+	xmlNode *child = node->children;
+	while (child != NULL) {
+		xmlNode *next = child->next;
+		if (_xccdf_slot_of_node(tmpl, child)) {
+			xmlNode *mark = xmlNewDocPI(doc, BAD_CAST _SLOT_MARK_NAME, NULL);
+			xmlReplaceNode(child, mark);
+			xmlFreeNode(child);
+		} else {
+			_xccdf_slots_mark(tmpl, doc, child);
+		}
+		child = next;
+	}
+}
+
+static struct xccdf_substitution_template *_xccdf_substitution_template_new(const char *text)
+{
+	struct xccdf_substitution_template *tmpl = oscap_calloc(1, sizeof(struct xccdf_substitution_template));
+
+	// A text without markup, references and characters escaped by xmlNodeDump
+	// is its own serialization, spare the parsing.
+	if (strpbrk(text, "<>&\r") == NULL) {
+		tmpl->literals = oscap_alloc(sizeof(char *));
+		tmpl->literals[0] = oscap_strdup(text);
+		tmpl->valid = true;
+		return tmpl;
+	}
+
+	if (strstr(text, _SLOT_MARK_NAME) != NULL) {
+		dW("Text contains the reserved processing instruction '%s'.", _SLOT_MARK_NAME);
+		return tmpl;
+	}
+
+	char *input_document = oscap_sprintf("<x xmlns='http://www.w3.org/1999/xhtml'>%s</x>", text);
+	xmlDoc *doc = xmlParseMemory(input_document, strlen(input_document));
+	if (doc == NULL) {
+		dW("Could not xmlParseMemory: '%s'", input_document);
+		free(input_document);
+		return tmpl;
+	}
+	free(input_document);
+	xmlNode *root = xmlDocGetRootElement(doc);
+
+	_xccdf_slots_mark(tmpl, doc, root);
+
+	// We cannot simply xmlDumpMemory, because we need to skip the upper <x/> element.
+	xmlBuffer *buff = xmlBufferCreate();
+	for (xmlNode *child = root->children; child != NULL; child = child->next)
+		xmlNodeDump(buff, doc, child, 0, 0);
+
+	tmpl->literals = oscap_alloc(sizeof(char *) * (tmpl->count + 1));
+	const char *seg = (const char *) xmlBufferContent(buff);
+	for (size_t i = 0; i < tmpl->count; ++i) {
+		const char *mark = strstr(seg, _SLOT_MARK);
+		if (mark == NULL) {
+			// Cannot happen, every slot was replaced by a mark.
+			tmpl->literals[i] = oscap_strdup("");
+			continue;
+		}
+		tmpl->literals[i] = strndup(seg, mark - seg);
+		seg = mark + strlen(_SLOT_MARK);
+	}
+	tmpl->literals[tmpl->count] = oscap_strdup(seg);
+	tmpl->valid = true;
+
+	xmlBufferFree(buff);
+	xmlFreeDoc(doc);
+	return tmpl;
+}
+
+static void _xccdf_substitution_template_free(struct xccdf_substitution_template *tmpl)
+{
+	if (tmpl == NULL)
+		return;
+	for (size_t i = 0; i < tmpl->count; ++i) {
+		free(tmpl->slots[i].idref);
+		free(tmpl->slots[i].use);
+	}
+	if (tmpl->literals != NULL) {
+		for (size_t i = 0; i <= tmpl->count; ++i)
+			oscap_free(tmpl->literals[i]);
+	}
+	oscap_free(tmpl->literals);
+	oscap_free(tmpl->slots);
+	oscap_free(tmpl);
+}
+
+void xccdf_substitution_templates_free(struct oscap_htable *templates)
+{
+	oscap_htable_free(templates, (oscap_destruct_func) _xccdf_substitution_template_free);
+}
+
+static const struct xccdf_substitution_template *_xccdf_substitution_template_get(struct xccdf_policy *policy, const char *text)
+{
+	struct xccdf_policy_model *model = xccdf_policy_get_model(policy);
+	struct xccdf_substitution_template *tmpl;
 
-		struct xccdf_benchmark *benchmark = xccdf_policy_get_benchmark(data->policy);
+	pthread_mutex_lock(&model->templates_lock);
+	if (model->templates == NULL)
+		model->templates = oscap_htable_new();
+	tmpl = oscap_htable_get(model->templates, text);
+	pthread_mutex_unlock(&model->templates_lock);
+
+	if (tmpl != NULL)
+		return tmpl;
+
+	struct xccdf_substitution_template *new_tmpl = _xccdf_substitution_template_new(text);
+
+	pthread_mutex_lock(&model->templates_lock);
+	// Another thread may have added it meanwhile.
+	tmpl = oscap_htable_get(model->templates, text);
+	if (tmpl == NULL) {
+		oscap_htable_add(model->templates, text, new_tmpl);
+		tmpl = new_tmpl;
+		new_tmpl = NULL;
+	}
+	pthread_mutex_unlock(&model->templates_lock);
+
+	_xccdf_substitution_template_free(new_tmpl);
+	return tmpl;
+}
+
+/* The substituted text is serialized the way xmlNodeDump serializes a text node. */
+static void _xccdf_append_escaped(struct oscap_string *out, const char *text)
+{
+	for (; *text != '\0'; ++text) {
+		switch (*text) {
+		case '<':
+			oscap_string_append_string(out, "&lt;");
+			break;
+		case '>':
+			oscap_string_append_string(out, "&gt;");
+			break;
+		case '&':
+			oscap_string_append_string(out, "&amp;");
+			break;
+		case '\r':
+			oscap_string_append_string(out, "&#13;");
+			break;
+		default:
+			oscap_string_append_char(out, *text);
+		}
+	}
+}
+
+static const char *_xccdf_item_first_title(struct xccdf_item *item)
+{
+	const char *result = NULL;
+	// TODO: @xml:lang
+	struct oscap_text_iterator *title_it = xccdf_item_get_title(item);
+	if (oscap_text_iterator_has_more(title_it))
+		result = oscap_text_get_text(oscap_text_iterator_next(title_it));
+	oscap_text_iterator_free(title_it);
+	return result;
+}
+
+/*
+ * Resolve the text of a slot. Returns 0 on success, 1 on failure which stops
+ * the substitution and 2 on failure after which the other slots are still
+ * resolved.
+ */
+static int _xccdf_slot_resolve(const struct _xccdf_slot *slot, struct _xccdf_text_substitution_data *data, const char **out)
+{
+	struct xccdf_benchmark *benchmark;
+	struct xccdf_item *item;
+	const char *result = NULL;
+
+	*out = NULL;
+
+	switch (slot->type) {
+	case _SLOT_SUB_NOIDREF:
+		oscap_seterr(OSCAP_EFAMILY_XCCDF, "The xccdf:sub MUST have a single @idref attribute.");
+		return 2;
+	case _SLOT_SUB:
+		// Sub element may refer to xccdf:Value or to xccdf:plain-text
+		benchmark = xccdf_policy_get_benchmark(data->policy);
 		if (benchmark == NULL)
 			return 1;
-		struct xccdf_item *value = xccdf_benchmark_get_item(benchmark, sub_idref);
+		item = xccdf_benchmark_get_item(benchmark, slot->idref);
 
-		const char *result = NULL;
-		if (value != NULL && xccdf_item_get_type(value) == XCCDF_VALUE) {
+		if (item != NULL && xccdf_item_get_type(item) == XCCDF_VALUE) {
 			// When the <xccdf:sub> element's @idref attribute holds the id of an <xccdf:Value>
 			// element, the <xccdf:sub> element's @use attribute MUST be consulted.
-			const char *sub_use = (const char *) xmlGetProp(*node, BAD_CAST "use");
+			const char *sub_use = slot->use;
 			if (oscap_streq(sub_use, NULL) || oscap_streq(sub_use, "legacy")) {
 				// If the value of the @use attribute is "legacy", then during Tailoring,
 				// process the <xccdf:sub> element as if @use was set to "title". but
 				// during Document Generation or Assessment, process the <xccdf:sub>
 				// element as if @use was set to "value".
-				sub_use = strdup((data->processing_type & _TAILORING_TYPE) ? "title" : "value");
+				sub_use = (data->processing_type & _TAILORING_TYPE) ? "title" : "value";
 			}
 
 			if (oscap_streq(sub_use, "title")) {
-				// TODO: @xml:lang
-				struct oscap_text_iterator *title_it = xccdf_item_get_title(value);
-				if (oscap_text_iterator_has_more(title_it))
-					result = oscap_text_get_text(oscap_text_iterator_next(title_it));
-				oscap_text_iterator_free(title_it);
+				result = _xccdf_item_first_title(item);
 			} else {
 				if (!oscap_streq(sub_use, "value"))
-					dW("xccdf:sub/@idref='%s' has incorrect @use='%s'! Using @use='value' instead.", sub_idref, sub_use);
-				result = xccdf_policy_get_value_of_item(data->policy, value);
+					dW("xccdf:sub/@idref='%s' has incorrect @use='%s'! Using @use='value' instead.", slot->idref, sub_use);
+				result = xccdf_policy_get_value_of_item(data->policy, item);
 			}
-			oscap_free(sub_use);
 		} else { // This xccdf:sub probably refers to the xccdf:plain-text
-			result = xccdf_benchmark_get_plain_text(benchmark, sub_idref);
+			result = xccdf_benchmark_get_plain_text(benchmark, slot->idref);
 		}
 
 		if (result == NULL) {
-			oscap_seterr(OSCAP_EFAMILY_XCCDF, "Could not resolve xccdf:sub/@idref='%s'!", sub_idref);
-			oscap_free(sub_idref);
+			oscap_seterr(OSCAP_EFAMILY_XCCDF, "Could not resolve xccdf:sub/@idref='%s'!", slot->idref);
 			return 2;
 		}
-		oscap_free(sub_idref);
-
-		xmlNode *new_node = xmlNewText(BAD_CAST result);
-		xmlReplaceNode(*node, new_node);
-		xmlFreeNode(*node);
-		*node = new_node;
-		return 0;
-	} else if (oscap_streq((const char *) (*node)->name, "object") && _xhtml_is_supported_namespace((*node)->ns)) {
-		char *object_data = (char *) xmlGetProp(*node, BAD_CAST "data");
-		if (object_data == NULL || strncmp(object_data, "#xccdf:", strlen("#xccdf:")) != 0) {
-			free(object_data);
-			return 0; // Not an error, unless it shall be resolved by XCCDF
-		}
-
-		struct xccdf_benchmark *benchmark = xccdf_policy_get_benchmark(data->policy);
+		break;
+	case _SLOT_VALUE:
+		benchmark = xccdf_policy_get_benchmark(data->policy);
 		if (benchmark == NULL)
 			return 1;
-
-		const char *result = NULL;
-		if (strncmp(object_data, "#xccdf:value:", strlen("#xccdf:value:")) == 0) {
-			const char *value_id = object_data + strlen("#xccdf:value:");
-
-			struct xccdf_item *item = xccdf_benchmark_get_item(benchmark, value_id);
-			if (item != NULL && xccdf_item_get_type(item) == XCCDF_VALUE) {
-				result = xccdf_policy_get_value_of_item(data->policy, item);
-			} else {
-				result = xccdf_benchmark_get_plain_text(benchmark, value_id);
-				if (result == NULL) {
-					dW("Text substitution for xccdf:fact is not supported!"); // TODO.
-				}
+		item = xccdf_benchmark_get_item(benchmark, slot->idref);
+		if (item != NULL && xccdf_item_get_type(item) == XCCDF_VALUE) {
+			result = xccdf_policy_get_value_of_item(data->policy, item);
+		} else {
+			result = xccdf_benchmark_get_plain_text(benchmark, slot->idref);
+			if (result == NULL) {
+				dW("Text substitution for xccdf:fact is not supported!"); // TODO.
 			}
 		}
-		else if (strncmp(object_data, "#xccdf:title:", strlen("#xccdf:title:")) == 0) {
-			const char *title_id = object_data + strlen("#xccdf:title:");
-
-			struct xccdf_item *item = xccdf_benchmark_get_item(benchmark, title_id);
-			if (item != NULL) {
-				// TODO: @xml:lang
-				struct oscap_text_iterator *title_it = xccdf_item_get_title(item);
-				if (oscap_text_iterator_has_more(title_it))
-					result = oscap_text_get_text(oscap_text_iterator_next(title_it));
-				oscap_text_iterator_free(title_it);
-			}
-		}
-		else {
-			// Let's not consider this as an error. Since in similar cases NISTIR-7275r4
-			// suggests to retain the <object> element.
-			dW("Unsupported XCCDF uri: xhtml:object/@data='%s'", object_data);
-			free(object_data);
-			return 0;
-		}
-		free(object_data);
-		xmlNode *new_node = xmlNewText(BAD_CAST result);
-		xmlReplaceNode(*node, new_node);
-		xmlFreeNode(*node);
-		*node = new_node;
-		return 0;
-	} else if (oscap_streq((const char *) (*node)->name, "instance") && xccdf_is_supported_namespace((*node)->ns)) {
-		const char *result;
-		// <instance> elements
-		if ((*node)->children != NULL)
-			dW("The xccdf:instance element SHALL NOT have any content.");
+		break;
+	case _SLOT_TITLE:
+		benchmark = xccdf_policy_get_benchmark(data->policy);
+		if (benchmark == NULL)
+			return 1;
+		item = xccdf_benchmark_get_item(benchmark, slot->idref);
+		if (item != NULL)
+			result = _xccdf_item_first_title(item);
+		break;
+	case _SLOT_INSTANCE:
 		if (data->rule_result == NULL)
 			return 1;
 		struct xccdf_instance_iterator *instances = xccdf_rule_result_get_instances(data->rule_result);
@@ -182,14 +390,43 @@ static int _xccdf_text_substitution_cb(xmlNode **node, void *user_data)
 			dW("The xccdf:rule-result/xccdf:instance element was not found.");
 			return 1;
 		}
-		xmlNode *new_node = xmlNewText(BAD_CAST result);
-		xmlReplaceNode(*node, new_node);
-		xmlFreeNode(*node);
-		*node = new_node;
-		return 0;
-	} else {
-		return 0;
+		break;
 	}
+
+	*out = result;
+	return 0;
+}
+
+/*
+ * Returns 0 on success, 1 on failure and 2 if some of the slots couldn't
+ * be resolved. The text is returned also in the last case.
+ */
+static int _xccdf_substitute(const char *text, char **output_text, struct _xccdf_text_substitution_data *data)
+{
+	const struct xccdf_substitution_template *tmpl = _xccdf_substitution_template_get(data->policy, text);
+	int res = 0;
+
+	*output_text = NULL;
+	if (!tmpl->valid)
+		return 1;
+
+	struct oscap_string *out = oscap_string_new();
+	oscap_string_append_string(out, tmpl->literals[0]);
+	for (size_t i = 0; i < tmpl->count; ++i) {
+		const char *result;
+		int r = _xccdf_slot_resolve(&tmpl->slots[i], data, &result);
+		if (r == 1) {
+			oscap_string_free(out);
+			return 1;
+		}
+		if (res == 0)
+			res = r;
+		if (result != NULL)
+			_xccdf_append_escaped(out, result);
+		oscap_string_append_string(out, tmpl->literals[i + 1]);
+	}
+	*output_text = oscap_string_bequeath(out);
+	return res;
 }
 
 int xccdf_policy_resolve_fix_substitution(struct xccdf_policy *policy, struct xccdf_fix *fix, struct xccdf_rule_result *rule_result, struct xccdf_result *test_result)
@@ -200,13 +437,19 @@ int xccdf_policy_resolve_fix_substitution(struct xccdf_policy *policy, struct xc
 	data.rule_result = rule_result;
 
 	char *result = NULL;
-	int res = xml_iterate_dfs(xccdf_fix_get_content(fix), &result, _xccdf_text_substitution_cb, &data);
+	int res = _xccdf_substitute(xccdf_fix_get_content(fix), &result, &data);
 	if (res == 0)
 		xccdf_fix_set_content(fix, result);
 	oscap_free(result);
 	return res;
 }
 
+bool xccdf_policy_text_is_literal(struct xccdf_policy *policy, const char *text)
+{
+	const struct xccdf_substitution_template *tmpl = _xccdf_substitution_template_get(policy, text);
+	return tmpl->valid && tmpl->count == 0;
+}
+
 char* xccdf_policy_substitute(const char *text, struct xccdf_policy *policy) {
 	struct _xccdf_text_substitution_data data;
 	data.policy = policy;
@@ -215,7 +458,7 @@ char* xccdf_policy_substitute(const char *text, struct xccdf_policy *policy) {
 	data.processing_type = _DOCUMENT_GENERATION_TYPE | _ASSESSMENT_TYPE;
 
 	char *resolved_text = NULL;
-	if (xml_iterate_dfs(text, &resolved_text, _xccdf_text_substitution_cb, &data) != 0) {
+	if (_xccdf_substitute(text, &resolved_text, &data) != 0) {
 		// Either warning or error occured. Since prototype of this function
 		// does not make possible warning notification -> We better scratch that.
 		free(resolved_text);
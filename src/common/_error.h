@@ -39,13 +39,21 @@ void __oscap_setxmlerr(const char *file, uint32_t line, const char *func, xmlErr
 
 struct oscap_err_t {
 	oscap_errfamily_t family;
-	char *desc;
+	char *msg;              ///< the message as given
+	char *desc;             ///< the message with its location, made when first asked for
+	unsigned int repeats;   ///< how many times the error came again right after itself
 	const char *func;
 	const char *file;
 	uint32_t line;
 	struct oscap_err_t *next;
 };
 
+/**
+ * Get the description of the error, the message followed by the location
+ * it was set at and the number of its repeats.
+ */
+const char *oscap_err_get_desc(struct oscap_err_t *err);
+
 /**
  * __oscap_seterr() wrapper function
  */
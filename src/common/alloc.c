@@ -25,12 +25,18 @@
 #include <config.h>
 #endif
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <libxml/xmlmemory.h>
 
 #include "alloc.h"
 #include "_error.h"
 #include "assume.h"
+#include "memusage.h"
+#include "public/oscap.h"
 
 static void __oscap_err_check(void *m);
 
@@ -41,12 +47,208 @@ static void __oscap_err_check(void *m)
 		oscap_seterr(OSCAP_EFAMILY_GLIBC, strerror(errno));
 }
 
+/*
+ * Accounting
+ *
+ * Every thread counts its allocations and frees in a block of its own,
+ * the report adds up the blocks. A block of a thread which has exited is
+ * taken over by the next new thread, so the counts of the exited threads
+ * are kept. The sizes are the usable sizes of the chunks, the same for the
+ * allocation and the free. The free is counted by the subsystem freeing
+ * the memory, which isn't always the one which allocated it.
+ */
+
+struct oscap_memory_counters {
+	size_t objects;
+	size_t bytes;
+	size_t freed_objects;
+	size_t freed_bytes;
+};
+
+struct oscap_memory_block {
+	struct oscap_memory_counters counters[OSCAP_MEMORY_TAGS];
+	bool dead;
+	struct oscap_memory_block *next;
+};
+
+static const char *const __memory_tag_names[OSCAP_MEMORY_TAGS] = {
+	[OSCAP_MEMORY_OTHER]   = "other",
+	[OSCAP_MEMORY_XCCDF]   = "xccdf",
+	[OSCAP_MEMORY_OVAL]    = "oval",
+	[OSCAP_MEMORY_SYSCHAR] = "syschar",
+	[OSCAP_MEMORY_SEXP]    = "sexp",
+	[OSCAP_MEMORY_XML]     = "libxml2"
+};
+
+bool __oscap_memory_accounting = false;
+static pthread_mutex_t __memory_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t __memory_key;
+static struct oscap_memory_block *__memory_blocks = NULL;
+static __thread struct oscap_memory_block *__thread_block = NULL;
+
+static void __oscap_memory_block_release(void *arg)
+{
+	__atomic_store_n(&((struct oscap_memory_block *)arg)->dead, true, __ATOMIC_RELEASE);
+}
+
+static struct oscap_memory_block *__oscap_memory_block_get(void)
+{
+	struct oscap_memory_block *b = __thread_block;
+
+	if (b != NULL)
+		return b;
+
+	pthread_mutex_lock(&__memory_mutex);
+	for (b = __memory_blocks; b != NULL; b = b->next) {
+		if (__atomic_load_n(&b->dead, __ATOMIC_ACQUIRE)) {
+			b->dead = false;
+			break;
+		}
+	}
+	/* not counted, the counters come from malloc itself */
+	if (b == NULL && (b = calloc(1, sizeof(struct oscap_memory_block))) != NULL) {
+		b->next = __memory_blocks;
+		__memory_blocks = b;
+	}
+	pthread_mutex_unlock(&__memory_mutex);
+
+	if (b != NULL) {
+		pthread_setspecific(__memory_key, b);
+		__thread_block = b;
+	}
+	return b;
+}
+
+size_t __oscap_memory_size(void *p)
+{
+	return p != NULL ? malloc_usable_size(p) : 0;
+}
+
+void __oscap_memory_count_alloc(oscap_memory_tag_t tag, void *m)
+{
+	struct oscap_memory_block *b;
+
+	if (m == NULL || (b = __oscap_memory_block_get()) == NULL)
+		return;
+	b->counters[tag].objects++;
+	b->counters[tag].bytes += malloc_usable_size(m);
+}
+
+void __oscap_memory_count_realloc(oscap_memory_tag_t tag, size_t old_size, void *m)
+{
+	struct oscap_memory_block *b;
+	size_t size;
+
+	if (m == NULL || (b = __oscap_memory_block_get()) == NULL)
+		return;
+	size = malloc_usable_size(m);
+	if (old_size == 0)
+		b->counters[tag].objects++;
+	/* a shrunk chunk counts as freed bytes */
+	if (size >= old_size)
+		b->counters[tag].bytes += size - old_size;
+	else
+		b->counters[tag].freed_bytes += old_size - size;
+}
+
+void __oscap_memory_count_free(oscap_memory_tag_t tag, void *p)
+{
+	struct oscap_memory_block *b;
+
+	if (p == NULL || (b = __oscap_memory_block_get()) == NULL)
+		return;
+	b->counters[tag].freed_objects++;
+	b->counters[tag].freed_bytes += malloc_usable_size(p);
+}
+
+/* the memory of libxml2, see oscap_memory_accounting_enable */
+static void *__oscap_xml_malloc(size_t s)
+{
+	void *m = malloc(s);
+	__oscap_memory_count_alloc(OSCAP_MEMORY_XML, m);
+	return m;
+}
+
+static void *__oscap_xml_realloc(void *p, size_t s)
+{
+	size_t old_size = __oscap_memory_size(p);
+	void *m = realloc(p, s);
+	if (m != NULL)
+		__oscap_memory_count_realloc(OSCAP_MEMORY_XML, old_size, m);
+	return m;
+}
+
+static void __oscap_xml_free(void *p)
+{
+	__oscap_memory_count_free(OSCAP_MEMORY_XML, p);
+	free(p);
+}
+
+static char *__oscap_xml_strdup(const char *s)
+{
+	char *m = strdup(s);
+	__oscap_memory_count_alloc(OSCAP_MEMORY_XML, m);
+	return m;
+}
+
+void oscap_memory_accounting_enable(void)
+{
+	if (__oscap_memory_accounting)
+		return;
+	if (pthread_key_create(&__memory_key, __oscap_memory_block_release) != 0)
+		return;
+	/* libxml2 takes the functions only before it allocates anything */
+	xmlMemSetup(__oscap_xml_free, __oscap_xml_malloc, __oscap_xml_realloc, __oscap_xml_strdup);
+	__atomic_store_n(&__oscap_memory_accounting, true, __ATOMIC_RELEASE);
+}
+
+void oscap_memory_report(FILE *stream)
+{
+	struct oscap_memory_counters sum[OSCAP_MEMORY_TAGS], total;
+	struct oscap_memory_block *b;
+	struct proc_memusage mu;
+	int i;
+
+	if (!__oscap_memory_accounting)
+		return;
+
+	memset(sum, 0, sizeof sum);
+	memset(&total, 0, sizeof total);
+
+	/* the counters of the running threads are read as they are */
+	pthread_mutex_lock(&__memory_mutex);
+	for (b = __memory_blocks; b != NULL; b = b->next) {
+		for (i = 0; i < OSCAP_MEMORY_TAGS; ++i) {
+			sum[i].objects += __atomic_load_n(&b->counters[i].objects, __ATOMIC_RELAXED);
+			sum[i].bytes += __atomic_load_n(&b->counters[i].bytes, __ATOMIC_RELAXED);
+			sum[i].freed_objects += __atomic_load_n(&b->counters[i].freed_objects, __ATOMIC_RELAXED);
+			sum[i].freed_bytes += __atomic_load_n(&b->counters[i].freed_bytes, __ATOMIC_RELAXED);
+		}
+	}
+	pthread_mutex_unlock(&__memory_mutex);
+
+	fprintf(stream, "%-10s %14s %16s %14s %16s\n", "subsystem", "allocations", "allocated_bytes", "frees", "freed_bytes");
+	for (i = 0; i < OSCAP_MEMORY_TAGS; ++i) {
+		fprintf(stream, "%-10s %14zu %16zu %14zu %16zu\n", __memory_tag_names[i],
+			sum[i].objects, sum[i].bytes, sum[i].freed_objects, sum[i].freed_bytes);
+		total.objects += sum[i].objects;
+		total.bytes += sum[i].bytes;
+		total.freed_objects += sum[i].freed_objects;
+		total.freed_bytes += sum[i].freed_bytes;
+	}
+	fprintf(stream, "%-10s %14zu %16zu %14zu %16zu\n", "total",
+		total.objects, total.bytes, total.freed_objects, total.freed_bytes);
+
+	if (oscap_proc_memusage(&mu) == 0)
+		fprintf(stream, "Resident set: %zu kB, peak %zu kB\n", mu.mu_rss, mu.mu_hwm);
+}
+
 #if defined(NDEBUG)
 /*
  * Normal
  */
 
-void *__oscap_alloc(size_t s)
+void *__oscap_alloc_t(size_t s, oscap_memory_tag_t t)
 {
 	void *m;
 	m = malloc(s);
@@ -55,10 +257,17 @@ void *__oscap_alloc(size_t s)
 	if (m == NULL)
 		exit(ENOMEM);
 #endif
+	if (__oscap_memory_accounting)
+		__oscap_memory_count_alloc(t, m);
 	return (m);
 }
 
-void *__oscap_calloc(size_t n, size_t s)
+void *__oscap_alloc(size_t s)
+{
+	return __oscap_alloc_t(s, OSCAP_MEMORY_OTHER);
+}
+
+void *__oscap_calloc_t(size_t n, size_t s, oscap_memory_tag_t t)
 {
 	void *m;
 #if defined(OSCAP_ALLOC_STRICT)
@@ -71,12 +280,20 @@ void *__oscap_calloc(size_t n, size_t s)
 	if (m == NULL)
 		exit(ENOMEM);
 #endif
+	if (__oscap_memory_accounting)
+		__oscap_memory_count_alloc(t, m);
 	return (m);
 }
 
-void *__oscap_realloc(void *p, size_t s)
+void *__oscap_calloc(size_t n, size_t s)
+{
+	return __oscap_calloc_t(n, s, OSCAP_MEMORY_OTHER);
+}
+
+void *__oscap_realloc_t(void *p, size_t s, oscap_memory_tag_t t)
 {
 	void *m;
+	size_t old_size = __oscap_memory_accounting ? __oscap_memory_size(p) : 0;
 
 	m = realloc(p, s);
 	__oscap_err_check(m);
@@ -84,40 +301,63 @@ void *__oscap_realloc(void *p, size_t s)
 	if (m == NULL && s > 0)
 		exit(ENOMEM);
 #endif
+	if (__oscap_memory_accounting && m != NULL)
+		__oscap_memory_count_realloc(t, old_size, m);
 	return (m);
 }
 
-void *__oscap_reallocf(void *p, size_t s)
+void *__oscap_realloc(void *p, size_t s)
+{
+	return __oscap_realloc_t(p, s, OSCAP_MEMORY_OTHER);
+}
+
+void *__oscap_reallocf_t(void *p, size_t s, oscap_memory_tag_t t)
 {
 	void *m;
+	size_t old_size = __oscap_memory_accounting ? __oscap_memory_size(p) : 0;
 
 	m = realloc(p, s);
 	__oscap_err_check(m);
 	if (m == NULL && s > 0) {
-		oscap_free(p);
+		__oscap_free_t(p, t);
 #if defined(OSCAP_ALLOC_EXIT)
 		exit(ENOMEM);
 #endif
+	} else if (__oscap_memory_accounting && m != NULL) {
+		__oscap_memory_count_realloc(t, old_size, m);
 	}
 	return (m);
 }
 
-void __oscap_free(void *p)
+void *__oscap_reallocf(void *p, size_t s)
+{
+	return __oscap_reallocf_t(p, s, OSCAP_MEMORY_OTHER);
+}
+
+void __oscap_free_t(void *p, oscap_memory_tag_t t)
 {
 #if defined(OSCAP_ALLOC_STRICT)
 	assume_d (p != NULL, /* void */);
 #endif
-	if (p != NULL)
+	if (p != NULL) {
+		if (__oscap_memory_accounting)
+			__oscap_memory_count_free(t, p);
 		free(p);
+	}
 	return;
 }
 
+void __oscap_free(void *p)
+{
+	__oscap_free_t(p, OSCAP_MEMORY_OTHER);
+}
+
 #else
 /*
  * Debug
  */
 
-void *__oscap_alloc_dbg(size_t s, const char *func, size_t line)
+void *__oscap_alloc_dbg_t(size_t s, oscap_memory_tag_t t, const char *func, size_t line)
 {
 	void *m;
 #if defined(OSCAP_ALLOC_STRICT)
@@ -129,10 +369,17 @@ void *__oscap_alloc_dbg(size_t s, const char *func, size_t line)
 	if (m == NULL)
 		exit(ENOMEM);
 #endif
+	if (__oscap_memory_accounting)
+		__oscap_memory_count_alloc(t, m);
 	return (m);
 }
 
-void *__oscap_calloc_dbg(size_t n, size_t s, const char *f, size_t l)
+void *__oscap_alloc_dbg(size_t s, const char *func, size_t line)
+{
+	return __oscap_alloc_dbg_t(s, OSCAP_MEMORY_OTHER, func, line);
+}
+
+void *__oscap_calloc_dbg_t(size_t n, size_t s, oscap_memory_tag_t t, const char *f, size_t l)
 {
 	void *m;
 #if defined(OSCAP_ALLOC_STRICT)
@@ -145,42 +392,69 @@ void *__oscap_calloc_dbg(size_t n, size_t s, const char *f, size_t l)
 	if (m == NULL)
 		exit(ENOMEM);
 #endif
+	if (__oscap_memory_accounting)
+		__oscap_memory_count_alloc(t, m);
 	return (m);
 }
 
-void *__oscap_realloc_dbg(void *p, size_t s, const char *f, size_t l)
+void *__oscap_calloc_dbg(size_t n, size_t s, const char *f, size_t l)
+{
+	return __oscap_calloc_dbg_t(n, s, OSCAP_MEMORY_OTHER, f, l);
+}
+
+void *__oscap_realloc_dbg_t(void *p, size_t s, oscap_memory_tag_t t, const char *f, size_t l)
 {
 	void *m;
+	size_t old_size = __oscap_memory_accounting ? __oscap_memory_size(p) : 0;
+
 	m = realloc(p, s);
 	__oscap_err_check(m);
 #if defined(OSCAP_ALLOC_EXIT)
 	if (m == NULL && s > 0)
 		exit(ENOMEM);
 #endif
+	if (__oscap_memory_accounting && m != NULL)
+		__oscap_memory_count_realloc(t, old_size, m);
 	return (m);
 }
 
-void *__oscap_reallocf_dbg(void *p, size_t s, const char *f, size_t l)
+void *__oscap_realloc_dbg(void *p, size_t s, const char *f, size_t l)
+{
+	return __oscap_realloc_dbg_t(p, s, OSCAP_MEMORY_OTHER, f, l);
+}
+
+void *__oscap_reallocf_dbg_t(void *p, size_t s, oscap_memory_tag_t t, const char *f, size_t l)
 {
 	void *m;
+	size_t old_size = __oscap_memory_accounting ? __oscap_memory_size(p) : 0;
+
 	m = realloc(p, s);
 	__oscap_err_check(m);
 	if (m == NULL && s > 0) {
-		oscap_free(p);
+		__oscap_free_dbg_t(&p, t, f, l);
 #if defined(OSCAP_ALLOC_EXIT)
 		exit(ENOMEM);
 #endif
+	} else if (__oscap_memory_accounting && m != NULL) {
+		__oscap_memory_count_realloc(t, old_size, m);
 	}
 	return (m);
 }
 
-void __oscap_free_dbg(void **p, const char *f, size_t l)
+void *__oscap_reallocf_dbg(void *p, size_t s, const char *f, size_t l)
+{
+	return __oscap_reallocf_dbg_t(p, s, OSCAP_MEMORY_OTHER, f, l);
+}
+
+void __oscap_free_dbg_t(void **p, oscap_memory_tag_t t, const char *f, size_t l)
 {
 	assume_d (p != NULL, /* void */);
 #if defined(OSCAP_ALLOC_STRICT)
 	assume_d (*p != NULL, /* void */);
 #endif
 	if (*p != NULL) {
+		if (__oscap_memory_accounting)
+			__oscap_memory_count_free(t, *p);
 		free(*p);
 #if defined(OSCAP_ALLOC_RESET)
 		*p = NULL;
@@ -188,4 +462,9 @@ void __oscap_free_dbg(void **p, const char *f, size_t l)
 	}
 	return;
 }
+
+void __oscap_free_dbg(void **p, const char *f, size_t l)
+{
+	__oscap_free_dbg_t(p, OSCAP_MEMORY_OTHER, f, l);
+}
 #endif
@@ -39,117 +39,126 @@
 #define OSCAP_ALLOC_H
 
 #include <stdlib.h>
+#include <stdbool.h>
 
 /// @cond
 #define __ATTRIB __attribute__ ((unused)) static
 /// @endcond
 
+/**
+ * Subsystems the memory is counted by, see oscap_memory_accounting_enable.
+ * The allocations of a source file are counted by its OSCAP_MEMORY_TAG,
+ * defined for the directories of the libraries by the makefiles and
+ * redefined by the files of the system characteristics.
+ */
+typedef enum {
+	OSCAP_MEMORY_OTHER = 0,
+	OSCAP_MEMORY_XCCDF,
+	OSCAP_MEMORY_OVAL,
+	OSCAP_MEMORY_SYSCHAR,
+	OSCAP_MEMORY_SEXP,
+	OSCAP_MEMORY_XML,
+	OSCAP_MEMORY_TAGS
+} oscap_memory_tag_t;
+
+#ifndef OSCAP_MEMORY_TAG
+# define OSCAP_MEMORY_TAG OSCAP_MEMORY_OTHER
+#endif
+
+/// @cond
+extern bool __oscap_memory_accounting;
+void __oscap_memory_count_alloc(oscap_memory_tag_t tag, void *m);
+void __oscap_memory_count_realloc(oscap_memory_tag_t tag, size_t old_size, void *m);
+void __oscap_memory_count_free(oscap_memory_tag_t tag, void *p);
+size_t __oscap_memory_size(void *p);
+/// @endcond
+
 #if defined(NDEBUG)
 /// @cond
 void *__oscap_alloc(size_t s);
+void *__oscap_alloc_t(size_t s, oscap_memory_tag_t t);
 __ATTRIB void *oscap_alloc(size_t s)
 {
-	return __oscap_alloc(s);
+	return __oscap_alloc_t(s, OSCAP_MEMORY_TAG);
 }
 
 void *__oscap_calloc(size_t n, size_t s);
+void *__oscap_calloc_t(size_t n, size_t s, oscap_memory_tag_t t);
 __ATTRIB void *oscap_calloc(size_t n, size_t s)
 {
-	return __oscap_calloc(n, s);
+	return __oscap_calloc_t(n, s, OSCAP_MEMORY_TAG);
 }
 
 void *__oscap_realloc(void *p, size_t s);
+void *__oscap_realloc_t(void *p, size_t s, oscap_memory_tag_t t);
 __ATTRIB void *oscap_realloc(void *p, size_t s)
 {
-	return __oscap_realloc(p, s);
+	return __oscap_realloc_t(p, s, OSCAP_MEMORY_TAG);
 }
 
 void *__oscap_reallocf(void *p, size_t s);
+void *__oscap_reallocf_t(void *p, size_t s, oscap_memory_tag_t t);
 __ATTRIB void *oscap_reallocf(void *p, size_t s)
 {
-	return __oscap_reallocf(p, s);
+	return __oscap_reallocf_t(p, s, OSCAP_MEMORY_TAG);
 }
 
 void __oscap_free(void *p);
+void __oscap_free_t(void *p, oscap_memory_tag_t t);
 __ATTRIB void oscap_free(void *p)
 {
-	__oscap_free(p);
+	__oscap_free_t(p, OSCAP_MEMORY_TAG);
 }
 /// @endcond
 
-/**
- * void *malloc(size_t size)  wrapper
- */
-# define oscap_alloc(s)       __oscap_alloc (s)
-/**
- * void *calloc(size_t nmemb, size_t size) wrapper
- */
-# define oscap_calloc(n, s)   __oscap_calloc (n, s);
-/**
- * void *realloc(void *ptr, size_t size) wrapper
- */
-# define oscap_realloc(p, s)  __oscap_realloc ((void *)(p), s)
-/**
- * void *realloc(void *ptr, size_t size) wrapper freeing old memory on failure
- */
-# define oscap_reallocf(p, s) __oscap_reallocf((void *)(p), s)
-/**
- * void free(void *ptr) wrapper
- */
-# define oscap_free(p)        __oscap_free ((void *)(p))
+# define oscap_alloc(s)       __oscap_alloc_t (s, OSCAP_MEMORY_TAG)
+# define oscap_calloc(n, s)   __oscap_calloc_t (n, s, OSCAP_MEMORY_TAG);
+# define oscap_realloc(p, s)  __oscap_realloc_t ((void *)(p), s, OSCAP_MEMORY_TAG)
+# define oscap_reallocf(p, s) __oscap_reallocf_t((void *)(p), s, OSCAP_MEMORY_TAG)
+# define oscap_free(p)        __oscap_free_t ((void *)(p), OSCAP_MEMORY_TAG)
 
 #else
 void *__oscap_alloc_dbg(size_t s, const char *f, size_t l);
+void *__oscap_alloc_dbg_t(size_t s, oscap_memory_tag_t t, const char *f, size_t l);
 __ATTRIB void *oscap_alloc(size_t s)
 {
-	return __oscap_alloc_dbg(s, __FUNCTION__, 0);
+	return __oscap_alloc_dbg_t(s, OSCAP_MEMORY_TAG, __FUNCTION__, 0);
 }
 
 void *__oscap_calloc_dbg(size_t n, size_t s, const char *f, size_t l);
+void *__oscap_calloc_dbg_t(size_t n, size_t s, oscap_memory_tag_t t, const char *f, size_t l);
 __ATTRIB void *oscap_calloc(size_t n, size_t s)
 {
-	return __oscap_calloc_dbg(n, s, __FUNCTION__, 0);
+	return __oscap_calloc_dbg_t(n, s, OSCAP_MEMORY_TAG, __FUNCTION__, 0);
 }
 
 void *__oscap_realloc_dbg(void *p, size_t s, const char *f, size_t l);
+void *__oscap_realloc_dbg_t(void *p, size_t s, oscap_memory_tag_t t, const char *f, size_t l);
 __ATTRIB void *oscap_realloc(void *p, size_t s)
 {
-	return __oscap_realloc_dbg(p, s, __FUNCTION__, 0);
+	return __oscap_realloc_dbg_t(p, s, OSCAP_MEMORY_TAG, __FUNCTION__, 0);
 }
 
 void *__oscap_reallocf_dbg(void *p, size_t s, const char *f, size_t l);
+void *__oscap_reallocf_dbg_t(void *p, size_t s, oscap_memory_tag_t t, const char *f, size_t l);
 __ATTRIB void *oscap_reallocf(void *p, size_t s)
 {
-	return __oscap_reallocf_dbg(p, s, __FUNCTION__, 0);
+	return __oscap_reallocf_dbg_t(p, s, OSCAP_MEMORY_TAG, __FUNCTION__, 0);
 }
 
 void __oscap_free_dbg(void **p, const char *f, size_t l);
+void __oscap_free_dbg_t(void **p, oscap_memory_tag_t t, const char *f, size_t l);
 __ATTRIB void oscap_free(void *p)
 {
-	__oscap_free_dbg(&p, __FUNCTION__, 0);
+	__oscap_free_dbg_t(&p, OSCAP_MEMORY_TAG, __FUNCTION__, 0);
 }
 
 
-/**
- * malloc wrapper
- */
-# define oscap_alloc(s)       __oscap_alloc_dbg (s, __PRETTY_FUNCTION__, __LINE__)
-/**
- * calloc wrapper
- */
-# define oscap_calloc(n, s)   __oscap_calloc_dbg (n, s, __PRETTY_FUNCTION__, __LINE__)
-/**
- * realloc wrapper
- */
-# define oscap_realloc(p, s)  __oscap_realloc_dbg ((void *)(p), s, __PRETTY_FUNCTION__, __LINE__)
-/**
- * realloc wrapper freeing old memory on failure
- */
-# define oscap_reallocf(p, s) __oscap_reallocf_dbg ((void *)(p), s, __PRETTY_FUNCTION__, __LINE__)
-/**
- * free wrapper
- */
-# define oscap_free(p)        __oscap_free_dbg ((void **)((void *)&(p)), __PRETTY_FUNCTION__, __LINE__)
+# define oscap_alloc(s)       __oscap_alloc_dbg_t (s, OSCAP_MEMORY_TAG, __PRETTY_FUNCTION__, __LINE__)
+# define oscap_calloc(n, s)   __oscap_calloc_dbg_t (n, s, OSCAP_MEMORY_TAG, __PRETTY_FUNCTION__, __LINE__)
+# define oscap_realloc(p, s)  __oscap_realloc_dbg_t ((void *)(p), s, OSCAP_MEMORY_TAG, __PRETTY_FUNCTION__, __LINE__)
+# define oscap_reallocf(p, s) __oscap_reallocf_dbg_t ((void *)(p), s, OSCAP_MEMORY_TAG, __PRETTY_FUNCTION__, __LINE__)
+# define oscap_free(p)        __oscap_free_dbg_t ((void **)((void *)&(p)), OSCAP_MEMORY_TAG, __PRETTY_FUNCTION__, __LINE__)
 #endif
 
 /// @cond
@@ -34,6 +34,7 @@
 # include <unistd.h>
 # include <time.h>
 # include <errno.h>
+# include <sys/uio.h>
 
 # include <sexp.h>
 # include <sexp-output.h>
@@ -57,26 +58,237 @@ static const struct oscap_string_map OSCAP_VERBOSITY_LEVELS[] = {
 
 #  if defined(OSCAP_THREAD_SAFE)
 #   include <pthread.h>
-static pthread_mutex_t __debuglog_mutex = PTHREAD_MUTEX_INITIALIZER;
+#   include <sched.h>
 #  endif
 FILE *__debuglog_fp = NULL;
 oscap_verbosity_levels __debuglog_level = DBG_UNKNOWN;
 
+#define THREAD_NAME_LEN 16
+
+/* messages up to this length are formatted without an allocation */
+#define DEBUG_MSG_LEN 1024
+
+struct debug_msg {
+	char  *buf;
+	size_t len;
+	size_t size;
+	char   local[DEBUG_MSG_LEN];
+};
+
 #if defined(OSCAP_THREAD_SAFE)
-# define __LOCK_FP    do { if (pthread_mutex_lock   (&__debuglog_mutex) != 0) abort(); } while(0)
-# define __UNLOCK_FP  do { if (pthread_mutex_unlock (&__debuglog_mutex) != 0) abort(); } while(0)
-#else
-# define __LOCK_FP   while(0)
-# define __UNLOCK_FP while(0)
-#endif
+/*
+ * Asynchronous mode: every thread appends its formatted messages to its own
+ * ring buffer, which only that thread writes to and only the writer thread
+ * reads from, so no lock is taken per message. The writer thread drains all
+ * the rings with one writev(2) per ring every DEBUG_WRITER_PERIOD_MS, or
+ * sooner when a ring gets half full. Messages of a thread keep their order,
+ * messages of different threads are only ordered within a batch.
+ */
+#define DEBUG_RING_SIZE (64 * 1024)
+#define DEBUG_WRITER_PERIOD_MS 50
 
-#define THREAD_NAME_LEN 16
+struct debug_ring {
+	char   buf[DEBUG_RING_SIZE];
+	size_t head;               /**< bytes produced, written by the thread */
+	size_t tail;               /**< bytes consumed, written by the writer */
+	bool   dead;               /**< the thread has exited */
+	struct debug_ring *next;
+};
+
+static bool __debuglog_async = false;
+static pthread_t __writer_thread;
+static pthread_mutex_t __writer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  __writer_cond  = PTHREAD_COND_INITIALIZER;
+static bool __writer_stop = false;
+static struct debug_ring *__rings = NULL;
+static pthread_key_t __ring_key;
+static __thread struct debug_ring *__thread_ring = NULL;
+#endif
 
 static void __oscap_debuglog_close(void)
 {
         fclose(__debuglog_fp);
 }
 
+#if defined(OSCAP_THREAD_SAFE)
+/* write the messages of the ring available now, called by the writer with the writer mutex held */
+static void debug_ring_drain(int fd, struct debug_ring *r)
+{
+	struct iovec iov[2];
+	size_t head, tail, pos, len;
+	int cnt = 1;
+
+	head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+	tail = r->tail;
+
+	if (head == tail)
+		return;
+
+	len = head - tail;
+	pos = tail % DEBUG_RING_SIZE;
+	iov[0].iov_base = r->buf + pos;
+	iov[0].iov_len  = len;
+
+	if (pos + len > DEBUG_RING_SIZE) {
+		iov[0].iov_len  = DEBUG_RING_SIZE - pos;
+		iov[1].iov_base = r->buf;
+		iov[1].iov_len  = len - iov[0].iov_len;
+		cnt = 2;
+	}
+
+	/* a failed write drops the messages, there is nowhere to report it */
+	if (writev(fd, iov, cnt) < 0) {
+		/* ignore */
+	}
+
+	__atomic_store_n(&r->tail, head, __ATOMIC_RELEASE);
+}
+
+static void debug_rings_drain(void)
+{
+	struct debug_ring **rp, *r;
+	int fd = fileno(__debuglog_fp);
+
+	for (rp = &__rings; (r = *rp) != NULL; ) {
+		bool dead = __atomic_load_n(&r->dead, __ATOMIC_ACQUIRE);
+
+		debug_ring_drain(fd, r);
+
+		if (dead) {
+			*rp = r->next;
+			free(r);
+		} else {
+			rp = &r->next;
+		}
+	}
+}
+
+static void *debug_writer(void *arg)
+{
+	struct timespec ts;
+
+	pthread_mutex_lock(&__writer_mutex);
+
+	while (!__writer_stop) {
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_nsec += DEBUG_WRITER_PERIOD_MS * 1000000L;
+		if (ts.tv_nsec >= 1000000000L) {
+			ts.tv_sec  += 1;
+			ts.tv_nsec -= 1000000000L;
+		}
+		pthread_cond_timedwait(&__writer_cond, &__writer_mutex, &ts);
+		debug_rings_drain();
+	}
+
+	debug_rings_drain();
+	pthread_mutex_unlock(&__writer_mutex);
+
+	return NULL;
+}
+
+static void debug_ring_release(void *arg)
+{
+	__atomic_store_n(&((struct debug_ring *)arg)->dead, true, __ATOMIC_RELEASE);
+}
+
+static struct debug_ring *debug_ring_get(void)
+{
+	struct debug_ring *r = __thread_ring;
+
+	if (r != NULL)
+		return r;
+
+	r = calloc(1, sizeof(struct debug_ring));
+	if (r == NULL)
+		return NULL;
+
+	pthread_mutex_lock(&__writer_mutex);
+	r->next = __rings;
+	__rings = r;
+	pthread_mutex_unlock(&__writer_mutex);
+
+	pthread_setspecific(__ring_key, r);
+	__thread_ring = r;
+
+	return r;
+}
+
+/* append a whole message to the ring of the thread, false if it has to be written directly */
+static bool debug_ring_put(const char *msg, size_t len)
+{
+	struct debug_ring *r;
+	size_t head, pos, chunk;
+
+	if (!__atomic_load_n(&__debuglog_async, __ATOMIC_ACQUIRE) || len > DEBUG_RING_SIZE / 2)
+		return false;
+	if ((r = debug_ring_get()) == NULL)
+		return false;
+
+	head = r->head;
+
+	while (head + len - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) > DEBUG_RING_SIZE) {
+		if (!__atomic_load_n(&__debuglog_async, __ATOMIC_ACQUIRE))
+			return false;
+		pthread_cond_signal(&__writer_cond);
+		sched_yield();
+	}
+
+	pos   = head % DEBUG_RING_SIZE;
+	chunk = len < DEBUG_RING_SIZE - pos ? len : DEBUG_RING_SIZE - pos;
+	memcpy(r->buf + pos, msg, chunk);
+	memcpy(r->buf, msg + chunk, len - chunk);
+	__atomic_store_n(&r->head, head + len, __ATOMIC_RELEASE);
+
+	if (head + len - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) > DEBUG_RING_SIZE / 2)
+		pthread_cond_signal(&__writer_cond);
+
+	return true;
+}
+
+static void debug_async_stop(void)
+{
+	if (!__atomic_load_n(&__debuglog_async, __ATOMIC_ACQUIRE))
+		return;
+
+	/* new messages are written directly, the rings are drained one last time */
+	__atomic_store_n(&__debuglog_async, false, __ATOMIC_RELEASE);
+
+	pthread_mutex_lock(&__writer_mutex);
+	__writer_stop = true;
+	pthread_cond_signal(&__writer_cond);
+	pthread_mutex_unlock(&__writer_mutex);
+
+	pthread_join(__writer_thread, NULL);
+}
+
+/* a forked child has no writer thread */
+static void debug_async_atfork_child(void)
+{
+	__atomic_store_n(&__debuglog_async, false, __ATOMIC_RELEASE);
+}
+
+static void debug_async_start(void)
+{
+	const char *async = getenv("OSCAP_VERBOSE_ASYNC");
+
+	if (async == NULL || *async == '\0' || strcmp(async, "0") == 0)
+		return;
+	if (__atomic_load_n(&__debuglog_async, __ATOMIC_ACQUIRE))
+		return;
+	if (pthread_key_create(&__ring_key, debug_ring_release) != 0)
+		return;
+
+	__writer_stop = false;
+	if (pthread_create(&__writer_thread, NULL, debug_writer, NULL) != 0)
+		return;
+
+	pthread_atfork(NULL, NULL, debug_async_atfork_child);
+	__atomic_store_n(&__debuglog_async, true, __ATOMIC_RELEASE);
+	/* registered after the log file is closed, so it runs before that */
+	atexit(&debug_async_stop);
+}
+#endif
+
 oscap_verbosity_levels oscap_verbosity_level_from_cstr(const char *level_name)
 {
 	return oscap_string_to_enum(OSCAP_VERBOSITY_LEVELS, level_name);
@@ -96,6 +308,9 @@ bool oscap_set_verbose(const char *verbosity_level, const char *filename, bool i
 	}
 	if (filename == NULL) {
 		__debuglog_fp = stderr;
+#if defined(OSCAP_THREAD_SAFE)
+		debug_async_start();
+#endif
 		return true;
 	}
 	int fd;
@@ -124,6 +339,9 @@ bool oscap_set_verbose(const char *verbosity_level, const char *filename, bool i
 	}
 	setbuf(__debuglog_fp, NULL);
 	atexit(&__oscap_debuglog_close);
+#if defined(OSCAP_THREAD_SAFE)
+	debug_async_start();
+#endif
 	return true;
 }
 
@@ -138,21 +356,52 @@ static const char *__oscap_path_rstrip(const char *path)
 	return (path);
 }
 
-
-static void debug_message_start(int level, int indent)
+static void debug_msg_vappend(struct debug_msg *m, const char *fmt, va_list ap)
 {
-	char  l;
+	va_list aq;
+	int n;
 
-	__LOCK_FP;
-#if defined(__SVR4) && defined (__sun)
-	if (lockf(fileno(__debuglog_fp), F_LOCK, 0L) == -1) {
-#else
-	if (flock(fileno(__debuglog_fp), LOCK_EX) == -1) {
-#endif
-		__UNLOCK_FP;
+	va_copy(aq, ap);
+	n = vsnprintf(m->buf + m->len, m->size - m->len, fmt, aq);
+	va_end(aq);
+
+	if (n < 0)
 		return;
+
+	if ((size_t)n >= m->size - m->len) {
+		size_t size = m->len + n + 1 + DEBUG_MSG_LEN;
+		char *buf = m->buf == m->local ? malloc(size) : realloc(m->buf, size);
+
+		if (buf == NULL)
+			return;
+		if (m->buf == m->local)
+			memcpy(buf, m->local, m->len);
+		m->buf  = buf;
+		m->size = size;
+		vsnprintf(m->buf + m->len, m->size - m->len, fmt, ap);
 	}
 
+	m->len += n;
+}
+
+static void debug_msg_append(struct debug_msg *m, const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	debug_msg_vappend(m, fmt, ap);
+	va_end(ap);
+}
+
+static void debug_message_start(struct debug_msg *m, int level, int indent)
+{
+	char  l;
+
+	m->buf  = m->local;
+	m->len  = 0;
+	m->size = sizeof m->local;
+	m->buf[0] = '\0';
+
 	switch (level) {
 	case DBG_E:
 		l = 'E';
@@ -169,52 +418,64 @@ static void debug_message_start(int level, int indent)
 	default:
 		l = '0';
 	}
-	fprintf(__debuglog_fp, "%c: %s: ", l, program_invocation_short_name);
+	debug_msg_append(m, "%c: %s: ", l, program_invocation_short_name);
 	for (int i = 0; i < indent; i++) {
-		fprintf(__debuglog_fp, "  ");
+		debug_msg_append(m, "  ");
 	}
 }
 
-static void debug_message_devel_metadata(const char *file, const char *fn, size_t line)
+static void debug_message_devel_metadata(struct debug_msg *m, const char *file, const char *fn, size_t line)
 {
 	const char *f = __oscap_path_rstrip(file);
 #if defined(OSCAP_THREAD_SAFE)
-	char thread_name[THREAD_NAME_LEN];
+	/* the name is read from /proc, do it only once per thread */
+	static __thread char thread_name[THREAD_NAME_LEN] = "";
 	pthread_t thread = pthread_self();
+	if (thread_name[0] == '\0') {
 #if defined(HAVE_PTHREAD_GETNAME_NP)
-	pthread_getname_np(thread, thread_name, THREAD_NAME_LEN);
+		pthread_getname_np(thread, thread_name, THREAD_NAME_LEN);
 #else
-	snprintf(thread_name, THREAD_NAME_LEN, "unknown");
+		snprintf(thread_name, THREAD_NAME_LEN, "unknown");
 #endif
+	}
 	/* XXX: non-portable usage of pthread_t */
-	fprintf(__debuglog_fp, " [%s(%ld):%s(%llx):%s:%zu:%s]",
+	debug_msg_append(m, " [%s(%ld):%s(%llx):%s:%zu:%s]",
 		program_invocation_short_name, (long) getpid(), thread_name,
 		(unsigned long long) thread, f, line, fn);
 #else
-	fprintf(__debuglog_fp, " [%ld:%s:%zu:%s]", (long) getpid(),
+	debug_msg_append(m, " [%ld:%s:%zu:%s]", (long) getpid(),
 		f, line, fn);
 #endif
 }
 
-static void debug_message_end()
+/*
+ * The whole message is written by a single write(2) in the append mode,
+ * so the messages of concurrent threads and processes don't interleave.
+ */
+static void debug_message_end(struct debug_msg *m)
 {
-	fputc('\n', __debuglog_fp);
-#if defined(__SVR4) && defined (__sun)
-	if (lockf(fileno(__debuglog_fp), F_ULOCK, 0L) == -1) {
-#else
-	if (flock(fileno(__debuglog_fp), LOCK_UN) == -1) {
+	debug_msg_append(m, "\n");
+#if defined(OSCAP_THREAD_SAFE)
+	if (!debug_ring_put(m->buf, m->len))
 #endif
-		/* __UNLOCK_FP; */
-		abort();
+	{
+		if (write(fileno(__debuglog_fp), m->buf, m->len) < 0) {
+			/* ignore */
+		}
 	}
-
-	__UNLOCK_FP;
-	return;
+	if (m->buf != m->local)
+		free(m->buf);
 }
 
 void __oscap_dlprintf(int level, const char *file, const char *fn, size_t line, int delta_indent, const char *fmt, ...)
 {
+#if defined(OSCAP_THREAD_SAFE)
+	/* the tests may be evaluated by several threads, see oval_results_model_set_jobs */
+	static __thread int indent = 0;
+#else
 	static int indent = 0;
+#endif
+	struct debug_msg m;
 	va_list ap;
 
 	if (__debuglog_fp == NULL) {
@@ -228,31 +489,42 @@ void __oscap_dlprintf(int level, const char *file, const char *fn, size_t line,
 		return;
 	}
 	va_start(ap, fmt);
-	debug_message_start(level, indent);
-	vfprintf(__debuglog_fp, fmt, ap);
+	debug_message_start(&m, level, indent);
+	debug_msg_vappend(&m, fmt, ap);
 	if (__debuglog_level == DBG_D) {
-		debug_message_devel_metadata(file, fn, line);
+		debug_message_devel_metadata(&m, file, fn, line);
 	}
-	debug_message_end();
+	debug_message_end(&m);
 	va_end(ap);
 }
 
 void __oscap_debuglog_object (const char *file, const char *fn, size_t line, int objtype, void *obj)
 {
+	struct debug_msg m;
+	char *str = NULL;
+	size_t len = 0;
+	FILE *fp;
+
 	if (__debuglog_fp == NULL) {
 		return;
 	}
 	if (__debuglog_level < DBG_D) {
 		return;
 	}
-	debug_message_start(DBG_D, 0);
+	debug_message_start(&m, DBG_D, 0);
 	switch (objtype) {
 	case OSCAP_DEBUGOBJ_SEXP:
-		SEXP_fprintfa(__debuglog_fp, (SEXP_t *)obj);
+		fp = open_memstream(&str, &len);
+		if (fp != NULL) {
+			SEXP_fprintfa(fp, (SEXP_t *)obj);
+			fclose(fp);
+			debug_msg_append(&m, "%s", str);
+			free(str);
+		}
 		break;
 	default:
-		fprintf(__debuglog_fp, "Attempt to dump a not supported object.");
+		debug_msg_append(&m, "Attempt to dump a not supported object.");
 	}
-	debug_message_devel_metadata(file, fn, line);
-	debug_message_end();
+	debug_message_devel_metadata(&m, file, fn, line);
+	debug_message_end(&m);
 }
@@ -36,6 +36,13 @@
 #include "util.h"
 #include "public/oscap_debug.h"
 
+/*
+ * The verbosity level set by oscap_set_verbose, DBG_UNKNOWN if logging is off.
+ * It isn't hidden: the probes carry their own copy, which has to be the one
+ * the library code running in them reads, so there is one level per process.
+ */
+extern oscap_verbosity_levels __debuglog_level;
+
 OSCAP_HIDDEN_START;
 
 #define OSCAP_DEBUGOBJ_SEXP 1
@@ -44,8 +51,9 @@ OSCAP_HIDDEN_START;
 #define _A(x) assert(x)
 #endif
 
-
-# define __dlprintf_wrapper(l, ...) __oscap_dlprintf (l, __FILE__, __PRETTY_FUNCTION__, __LINE__, 0, __VA_ARGS__)
+/* a message above the verbosity level costs a comparison, its arguments aren't evaluated */
+# define __dlprintf_wrapper(l, ...) \
+	((__debuglog_level >= (l)) ? __oscap_dlprintf (l, __FILE__, __PRETTY_FUNCTION__, __LINE__, 0, __VA_ARGS__) : (void)0)
 
 /**
  * Version of the oscap_dprintf function with support for debug level.
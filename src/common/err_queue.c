@@ -23,13 +23,17 @@
 #endif
 
 #include "_error.h"
+#include "alloc.h"
 #include "err_queue.h"
+#include "util.h"
 #include <stdlib.h>
 #include <string.h>
 
 struct err_queue {
 	struct oscap_err_t *first;
 	struct oscap_err_t *last;
+	size_t count;
+	size_t dropped;
 };
 
 struct err_queue *err_queue_new(void)
@@ -43,7 +47,10 @@ bool err_queue_push(struct err_queue *q, struct oscap_err_t *error)
 		assert(false);
 		return false;
 	}
+	if (!err_queue_reserve(q))
+		return false;
 	error->next = NULL;
+	q->count++;
 
 	if (q->last == NULL) {
 		q->first = error;
@@ -56,6 +63,14 @@ bool err_queue_push(struct err_queue *q, struct oscap_err_t *error)
 	return true;
 }
 
+bool err_queue_reserve(struct err_queue *q)
+{
+	if (q->count < ERR_QUEUE_MAX)
+		return true;
+	q->dropped++;
+	return false;
+}
+
 bool err_queue_is_empty(struct err_queue *q)
 {
 	if (q == NULL) {
@@ -76,6 +91,7 @@ struct oscap_err_t *err_queue_pop_first(struct err_queue *q)
 	q->first = pom->next;
 	if (q->last == pom)
 		q->last = NULL;
+	q->count--;
 	return pom;
 }
 
@@ -109,21 +125,29 @@ int err_queue_to_string(struct err_queue *q, char **result)
 	size_t size = 0;
 	struct oscap_err_t *err = q->first;
 	while (err != NULL) {
-		if (err->desc != NULL) {
-			int pom = strlen(err->desc);
+		const char *desc = oscap_err_get_desc(err);
+		if (desc != NULL) {
+			int pom = strlen(desc);
 			if (pom != 0)
 				size += pom + 1;
 		}
 		err = err->next;
 	}
+	char *dropped = NULL;
+	if (q->dropped != 0) {
+		dropped = oscap_sprintf("%zu more errors were dropped.", q->dropped);
+		size += strlen(dropped) + 1;
+	}
 	if (size == 0) {
 		*result = NULL;
 		return 0;
 	}
 
 	*result = (char *) malloc(size + 1);
-	if (*result == NULL)
+	if (*result == NULL) {
+		oscap_free(dropped);
 		return 1;
+	}
 	char *pos = *result;
 	pos[0] = '\0';
 	err = q->first;
@@ -134,6 +158,11 @@ int err_queue_to_string(struct err_queue *q, char **result)
 		}
 		err = err->next;
 	}
+	if (dropped != NULL) {
+		pos = stpcpy(pos, dropped);
+		pos = stpcpy(pos, "\n");
+		oscap_free(dropped);
+	}
 	(*result)[size-1] = '\0';
 	return 0;
 }
@@ -35,6 +35,12 @@ OSCAP_HIDDEN_START;
  */
 struct err_queue;
 
+/**
+ * The most errors a queue keeps, a loop failing on every item of a large
+ * content mustn't queue (nor format) millions of them.
+ */
+#define ERR_QUEUE_MAX 1000
+
 /**
  * Initialize new error_queue.
  * @memberof err_queue
@@ -51,6 +57,15 @@ struct err_queue *err_queue_new(void);
  */
 bool err_queue_push(struct err_queue *q, struct oscap_err_t *error);
 
+/**
+ * Query if there is room for another error in the queue, the error is
+ * counted as dropped if there isn't.
+ * @memberof err_queue
+ * @param q Internal Error Queue
+ * @returns true if another error can be pushed
+ */
+bool err_queue_reserve(struct err_queue *q);
+
 /**
  * Query if the queue is empty
  * @meberof err_queue
@@ -87,7 +102,8 @@ const struct oscap_err_t *err_queue_get_last(struct err_queue *q);
 void err_queue_free(struct err_queue *q, oscap_destruct_func destructor);
 
 /**
- * Get all the errors in the queue as a single string.
+ * Get all the errors in the queue as a single string, followed by the
+ * number of the dropped ones.
  * @memberof err_queue
  * @param q Internal Error Queue
  * @param result pointer, where to store the resulting string. Newly
@@ -37,36 +37,56 @@
 static pthread_key_t __key;
 static pthread_once_t __once = PTHREAD_ONCE_INIT;
 
-static void oscap_errkey_init(void)
-{
-	(void)pthread_key_create(&__key, NULL);
-}
-
-static struct oscap_err_t *oscap_err_new(oscap_errfamily_t family, const char *desc,
+/* takes the message */
+static struct oscap_err_t *oscap_err_new(oscap_errfamily_t family, char *msg,
 					 const char *func, uint32_t line, const char *file)
 {
 	struct oscap_err_t *err;
 
 	err = oscap_talloc(struct oscap_err_t);
 	err->family = family;
-	err->desc = oscap_sprintf("%s [%s:%d]", desc, file, line);
+	err->msg = msg;
+	err->desc = NULL;
+	err->repeats = 0;
 	err->func = func;
 	err->line = line;
 	err->file = file;
 
-	dE("\(%s:%d:%s\()) %s", file, line, func, desc);
+	dE("\(%s:%d:%s\()) %s", file, line, func, msg);
 
 	return (err);
 }
 
 static void oscap_err_free(struct oscap_err_t *err)
 {
-	if (err->desc != NULL)
-		oscap_free(err->desc);
+	oscap_free(err->msg);
+	oscap_free(err->desc);
 	oscap_free(err);
 }
 
-static inline void _push_err(struct oscap_err_t *err)
+const char *oscap_err_get_desc(struct oscap_err_t *err)
+{
+	if (err->desc == NULL) {
+		if (err->repeats == 0)
+			err->desc = oscap_sprintf("%s [%s:%d]", err->msg, err->file, err->line);
+		else
+			err->desc = oscap_sprintf("%s [%s:%d] (repeated %u times)", err->msg, err->file, err->line, err->repeats);
+	}
+	return err->desc;
+}
+
+/* the errors of a thread which exits are freed with its queue */
+static void oscap_errkey_free(void *q)
+{
+	err_queue_free(q, (oscap_destruct_func) oscap_err_free);
+}
+
+static void oscap_errkey_init(void)
+{
+	(void)pthread_key_create(&__key, oscap_errkey_free);
+}
+
+static inline struct err_queue *_get_queue(void)
 {
 	struct err_queue *q = pthread_getspecific(__key);
 	if (q == NULL) {
@@ -74,7 +94,27 @@ static inline void _push_err(struct oscap_err_t *err)
 		assert(q != NULL);
 		(void)pthread_setspecific(__key, q);
 	}
-	(void)err_queue_push(q, err);
+	return q;
+}
+
+/* The error repeating the last one, e.g. in a loop, only counts the repeat. */
+static inline void _push_err(struct oscap_err_t *err)
+{
+	struct err_queue *q = _get_queue();
+
+	if (!err_queue_is_empty(q)) {
+		struct oscap_err_t *last = (struct oscap_err_t *) err_queue_get_last(q);
+		if (last->line == err->line && last->family == err->family &&
+		    oscap_streq(last->file, err->file) && oscap_streq(last->msg, err->msg)) {
+			last->repeats++;
+			oscap_free(last->desc);
+			last->desc = NULL;
+			oscap_err_free(err);
+			return;
+		}
+	}
+	if (!err_queue_push(q, err))
+		oscap_err_free(err);
 }
 
 void __oscap_setxmlerr(const char *file, uint32_t line, const char *func, xmlErrorPtr error)
@@ -83,25 +123,22 @@ void __oscap_setxmlerr(const char *file, uint32_t line, const char *func, xmlErr
 	if (error == NULL)
 		return;
 
-	struct oscap_err_t *err;
+	char *msg;
 	(void)pthread_once(&__once, oscap_errkey_init);
 
+	if (!err_queue_reserve(_get_queue()))
+		return;
+
 	/* get rid of a newline that was pass by xmlGetLastError() */
 	int len = strlen(error->message);
 	if (len != 0 && error->message[len - 1] == '\n')
 		error->message[len-1] = 0;
-	if (error->file != NULL) {
-		char *msg = oscap_sprintf("%s [%s:%d]", error->message, error->file, error->line);
-		if (msg != NULL) {
-			err = oscap_err_new(OSCAP_EFAMILY_XML, msg, func, line, file);
-			oscap_free(msg);
-			_push_err(err);
-			return;
-		}
-	}
+	if (error->file != NULL)
+		msg = oscap_sprintf("%s [%s:%d]", error->message, error->file, error->line);
+	else
+		msg = oscap_strdup(error->message);
 
-	err = oscap_err_new(OSCAP_EFAMILY_XML, error->message, func, line, file);
-	_push_err(err);
+	_push_err(oscap_err_new(OSCAP_EFAMILY_XML, msg, func, line, file));
 }
 
 void __oscap_seterr(const char *file, uint32_t line, const char *func, oscap_errfamily_t family, ...)
@@ -113,14 +150,16 @@ void __oscap_seterr(const char *file, uint32_t line, const char *func, oscap_err
 
 	(void)pthread_once(&__once, oscap_errkey_init);
 
+	/* the message isn't even formatted once the queue is full */
+	if (!err_queue_reserve(_get_queue()))
+		return;
+
 	va_start(ap, family);
 	fmt = va_arg(ap, const char *);
 	msg = oscap_vsprintf(fmt, ap);
 	va_end(ap);
 
 	err = oscap_err_new(family, msg, func, line, file);
-
-	oscap_free(msg);
 	_push_err(err);
 }
 
@@ -163,7 +202,7 @@ const char *oscap_err_desc(void)
 
 	if (q == NULL || err_queue_is_empty(q))
 		return 0;
-	return (const char *) err_queue_get_last(q)->desc;
+	return oscap_err_get_desc((struct oscap_err_t *) err_queue_get_last(q));
 }
 
 char *oscap_err_get_full_error(void)
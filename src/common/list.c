@@ -372,14 +372,66 @@ OSCAP_ITERATOR_REMOVE(oscap_stringlist, oscap_stringlist_free)
     /*OSCAP_ITERATOR_RESET(oscap_string)*/
 
 
-#define OSCAP_DEFAULT_HSIZE 389
-static inline unsigned int oscap_htable_hash(const char *str, size_t htable_size)
+#define OSCAP_DEFAULT_HSIZE 8
+
+/* the key of the slots of detached items, lookups probe past them */
+static char oscap_htable_tombstone[1];
+
+static inline bool oscap_htable_slot_used(const struct oscap_htable_item *item)
+{
+	return item->key != NULL && item->key != oscap_htable_tombstone;
+}
+
+/* FNV-1a with a final mix, the index is taken from the low bits */
+static inline uint32_t oscap_htable_hash(const char *str)
+{
+	uint32_t h = 2166136261u;
+	const unsigned char *p;
+	for (p = (const unsigned char *)str; *p != '\0'; p++) {
+		h ^= *p;
+		h *= 16777619u;
+	}
+	h ^= h >> 16;
+	h *= 0x85ebca6bu;
+	h ^= h >> 13;
+	return h;
+}
+
+/* number of slots for `count' items */
+static size_t oscap_htable_slots(size_t count)
+{
+	size_t n = 8;
+	while (n / 4 * 3 < count + 1)
+		n <<= 1;
+	return n;
+}
+
+/* the first free slot for the hash, the table mustn't contain the key */
+static struct oscap_htable_item *oscap_htable_slot(struct oscap_htable_item *table, size_t hsize, uint32_t hash)
 {
-	unsigned h = 0;
-	unsigned char *p;
-	for (p = (unsigned char *)str; *p != '\0'; p++)
-		h = (97 * h) + *p;
-	return h % htable_size;
+	size_t mask = hsize - 1, i;
+	for (i = hash & mask; oscap_htable_slot_used(&table[i]); i = (i + 1) & mask)
+		;
+	return &table[i];
+}
+
+static bool oscap_htable_resize(struct oscap_htable *htable, size_t hsize)
+{
+	struct oscap_htable_item *table;
+	size_t i;
+
+	table = oscap_calloc(hsize, sizeof(struct oscap_htable_item));
+	if (table == NULL)
+		return false;
+	for (i = 0; i < htable->hsize; ++i) {
+		if (oscap_htable_slot_used(&htable->table[i]))
+			*oscap_htable_slot(table, hsize, htable->table[i].hash) = htable->table[i];
+	}
+	free(htable->table);
+	htable->table = table;
+	htable->hsize = hsize;
+	htable->deleted = 0;
+	return true;
 }
 
 struct oscap_htable *oscap_htable_new1(oscap_compare_func cmp, size_t hsize)
@@ -391,9 +443,10 @@ struct oscap_htable *oscap_htable_new1(oscap_compare_func cmp, size_t hsize)
 	t = oscap_alloc(sizeof(struct oscap_htable));
 	if (t == NULL)
 		return NULL;
-	t->hsize = hsize;
+	t->hsize = oscap_htable_slots(hsize);
 	t->itemcount = 0;
-	t->table = oscap_calloc(hsize, sizeof(struct oscap_list_item *));
+	t->deleted = 0;
+	t->table = oscap_calloc(t->hsize, sizeof(struct oscap_htable_item));
 	if (t->table == NULL) {
 		free(t);
 		return NULL;
@@ -402,35 +455,44 @@ struct oscap_htable *oscap_htable_new1(oscap_compare_func cmp, size_t hsize)
 	return t;
 }
 
+static int oscap_htable_cmp(const char *s1, const char *s2)
+{
+	if (s1 == NULL)
+		return -1;
+	if (s2 == NULL)
+		return 1;
+	return strcmp(s1, s2);
+}
+
 struct oscap_htable * oscap_htable_clone(const struct oscap_htable * table, oscap_clone_func cloner)
 {
-	struct oscap_htable *t = oscap_htable_new();
+	struct oscap_htable *t = oscap_htable_new1(oscap_htable_cmp, table->itemcount + 1);
 	if (t == NULL)
 		return NULL;
 
 	for (size_t i = 0; i < table->hsize; ++i) {
-		struct oscap_htable_item *item = table->table[i];
-		while (item != NULL) {
+		struct oscap_htable_item *item = &table->table[i];
+		if (oscap_htable_slot_used(item))
 			oscap_htable_add(t, item->key, (void *) cloner(item->value));
-			item = item->next;
-		}
 	}
 	
 	return t;
 }
 
-static int oscap_htable_cmp(const char *s1, const char *s2)
+struct oscap_htable *oscap_htable_new(void)
 {
-	if (s1 == NULL)
-		return -1;
-	if (s2 == NULL)
-		return 1;
-	return strcmp(s1, s2);
+	return oscap_htable_new1(oscap_htable_cmp, OSCAP_DEFAULT_HSIZE);
 }
 
-struct oscap_htable *oscap_htable_new(void)
+static struct oscap_htable_item *oscap_htable_lookup_hash(struct oscap_htable *htable, const char *key, uint32_t hash)
 {
-	return oscap_htable_new1(oscap_htable_cmp, OSCAP_DEFAULT_HSIZE);
+	size_t mask = htable->hsize - 1, i;
+	for (i = hash & mask; htable->table[i].key != NULL; i = (i + 1) & mask) {
+		struct oscap_htable_item *htitem = &htable->table[i];
+		if (htitem->hash == hash && htitem->key != oscap_htable_tombstone && htable->cmp(htitem->key, key) == 0)
+			return htitem;
+	}
+	return NULL;
 }
 
 static struct oscap_htable_item *oscap_htable_lookup(struct oscap_htable *htable, const char *key)
@@ -438,39 +500,27 @@ static struct oscap_htable_item *oscap_htable_lookup(struct oscap_htable *htable
 	__attribute__nonnull__(htable);
 	if (key == NULL)
 		return NULL;
-	unsigned int hashcode = oscap_htable_hash(key, htable->hsize);
-	struct oscap_htable_item *htitem = htable->table[hashcode];
-	while (htitem != NULL) {
-		if (htable->cmp(htitem->key, key) == 0)
-			return htitem;
-		htitem = htitem->next;
-	}
-	return NULL;
+	return oscap_htable_lookup_hash(htable, key, oscap_htable_hash(key));
 }
 
 bool oscap_htable_add(struct oscap_htable * htable, const char *key, void *item)
 {
 	__attribute__nonnull__(htable);
-	/*
-	   unsigned int hashcode = oscap_htable_hash(key, htable->hsize);
-	   struct oscap_htable_item* htitem = htable->table[hashcode];
-	   while(htitem != NULL)
-	   {
-	   if( (*(htable->cmp))(htitem->key, key) == 0) return false;
-	   if(htitem->next == NULL) break;
-	   htitem = htitem->next;
-	   }
-	   // htitem points to the last item
-	 */
-	if (oscap_htable_lookup(htable, key) != NULL)
+	uint32_t hash = oscap_htable_hash(key);
+	if (oscap_htable_lookup_hash(htable, key, hash) != NULL)
 		return false;
-	unsigned int hashcode = oscap_htable_hash(key, htable->hsize);
-	struct oscap_htable_item *newhtitem;
-	newhtitem = oscap_alloc(sizeof(struct oscap_htable_item));
+	if (htable->itemcount + htable->deleted + 1 > htable->hsize / 4 * 3) {
+		/* double if mostly full of items, otherwise just drop the detached ones */
+		size_t hsize = htable->itemcount + 1 > htable->hsize / 2 ? htable->hsize * 2 : htable->hsize;
+		if (!oscap_htable_resize(htable, hsize))
+			return false;
+	}
+	struct oscap_htable_item *newhtitem = oscap_htable_slot(htable->table, htable->hsize, hash);
+	if (newhtitem->key == oscap_htable_tombstone)
+		htable->deleted--;
 	newhtitem->key = strdup(key);
 	newhtitem->value = item;
-	newhtitem->next = htable->table[hashcode];
-	htable->table[hashcode] = newhtitem;
+	newhtitem->hash = hash;
 	htable->itemcount++;
 	return true;
 }
@@ -481,9 +531,10 @@ void *oscap_htable_detach(struct oscap_htable *htable, const char *key)
 	if (htitem) {
 		void *val = htitem->value;
 		free(htitem->key);
-		htitem->key = NULL;
+		htitem->key = oscap_htable_tombstone;
 		htitem->value = NULL;
 		htable->itemcount--;
+		htable->deleted++;
 		return val;
 	}
 	return NULL;
@@ -507,12 +558,11 @@ void oscap_htable_dump(struct oscap_htable *htable, oscap_dump_func dumper, int
 	printf(" (hash table, %u item%s)\n", (unsigned)htable->itemcount, (htable->itemcount == 1 ? "" : "s"));
 	int i;
 	for (i = 0; i < (int)htable->hsize; ++i) {
-		struct oscap_htable_item *item = htable->table[i];
-		while (item) {
+		struct oscap_htable_item *item = &htable->table[i];
+		if (oscap_htable_slot_used(item)) {
 			oscap_print_depth(depth);
 			printf("'%s':\n", item->key);
 			dumper(item->value, depth + 1);
-			item = item->next;
 		}
 	}
 }
@@ -521,17 +571,14 @@ void oscap_htable_free(struct oscap_htable *htable, oscap_destruct_func destruct
 {
 	if (htable) {
 		size_t ht;
-		struct oscap_htable_item *cur, *next;
+		struct oscap_htable_item *cur;
 
 		for (ht = 0; ht < htable->hsize; ++ht) {
-			cur = htable->table[ht];
-			while (cur) {
-				next = cur->next;
+			cur = &htable->table[ht];
+			if (oscap_htable_slot_used(cur)) {
 				free(cur->key);
 				if (destructor)
 					destructor(cur->value);
-				free(cur);
-				cur = next;
 			}
 		}
 
@@ -547,8 +594,7 @@ void oscap_htable_free0(struct oscap_htable *htable)
 
 struct oscap_htable_iterator {
 	struct oscap_htable *htable;	// Table we iterate through
-	struct oscap_htable_item *cur;	// The current item
-	size_t hpos;			// Line on which we are now
+	size_t hpos;			// Slot of the next item
 };
 
 struct oscap_htable_iterator *
@@ -556,7 +602,6 @@ oscap_htable_iterator_new(struct oscap_htable *htable)
 {
 	struct oscap_htable_iterator *hit = oscap_calloc(1, sizeof(struct oscap_htable_iterator));
 	hit->htable = htable;
-	hit->cur = NULL;
 	hit->hpos = 0;
 	return hit;
 }
@@ -567,48 +612,20 @@ oscap_htable_iterator_has_more(struct oscap_htable_iterator *hit)
 	__attribute__nonnull__(hit);
 	if (hit->htable == NULL)
 		return false;
-	size_t i = hit->hpos;
-	if (hit->cur != NULL) {
-		if (hit->cur->next != NULL)
-			return true;
-		if (i + 1 >= hit->htable->hsize)
-			return false;
-		i++;
-	}
-	for (; i < hit->htable->hsize; i++) {
-		if (hit->htable->table[i] == NULL)
-			continue;
-		if (i != hit->hpos)
-			hit->hpos = i - 1;
-		return true;
-	}
-	hit->hpos = i;
-	return false;
+	while (hit->hpos < hit->htable->hsize && !oscap_htable_slot_used(&hit->htable->table[hit->hpos]))
+		hit->hpos++;
+	return hit->hpos < hit->htable->hsize;
 }
 
 const struct oscap_htable_item *
 oscap_htable_iterator_next(struct oscap_htable_iterator *hit)
 {
 	__attribute__nonnull__(hit);
-	if (hit->cur != NULL) {
-		if (hit->cur->next != NULL) {
-			hit->cur = hit->cur->next;
-			return hit->cur;
-		}
-		if (hit->hpos + 1 >= hit->htable->hsize) {
-			assert(false);
-			return NULL;
-		}
-		hit->hpos++;
-	}
-	for (; hit->hpos < hit->htable->hsize; hit->hpos++) {
-		if (hit->htable->table[hit->hpos] == NULL)
-			continue;
-		hit->cur = hit->htable->table[hit->hpos];
-		return hit->cur;
+	if (!oscap_htable_iterator_has_more(hit)) {
+		assert(false); // no more item found
+		return NULL;
 	}
-	assert(false); // no more item found
-	return NULL;
+	return &hit->htable->table[hit->hpos++];
 }
 
 const char *
@@ -639,7 +656,6 @@ void
 oscap_htable_iterator_reset(struct oscap_htable_iterator *hit)
 {
 	__attribute__nonnull__(hit);
-	hit->cur = NULL;
 	hit->hpos = 0;
 }
 
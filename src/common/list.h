@@ -30,6 +30,7 @@
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "util.h"
 #include "public/oscap.h"
@@ -174,23 +175,25 @@ void *oscap_list_find(struct oscap_list *list, void *what, oscap_cmp_func compar
 typedef int (*oscap_compare_func) (const char *, const char *);
 // Hash table item.
 struct oscap_htable_item {
-	struct oscap_htable_item *next;	// Next item.
-	char *key;		// Item key.
+	char *key;		// Item key, NULL if the slot is empty.
 	void *value;		// Item value.
+	uint32_t hash;		// Cached hash of the key.
 };
 
-// Hash table.
+// Hash table, open addressing with linear probing. It grows to keep the
+// slots at most 3/4 full, counting the ones of the detached items.
 struct oscap_htable {
-	size_t hsize;		// Size of the hash table.
+	size_t hsize;		// Number of slots, a power of two.
 	size_t itemcount;	// Number of elements in the hash table.
-	struct oscap_htable_item **table;	// The table itself.
+	size_t deleted;		// Number of slots of detached items.
+	struct oscap_htable_item *table;	// The table itself.
 	oscap_compare_func cmp;	// Funcion used to compare keys (e.g. strcmp).
 };
 
 /*
  * Create a new hash table.
- * @param cmp Pointer to a function used as the key comparator.
- * @hsize Size of the hash table.
+ * @param cmp Pointer to a function used as the key comparator, keys equal by it have to be equal strings.
+ * @hsize Expected number of items, the table grows past it.
  * @internal
  * @return new hash table
  */
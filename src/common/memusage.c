@@ -31,6 +31,7 @@
 #include <ctype.h>
 #include <errno.h>
 #include <stdint.h>
+#include <stdlib.h>
 
 #include "debug_priv.h"
 #include "memusage.h"
@@ -194,6 +195,54 @@ int oscap_sys_memusage(struct sys_memusage *mu)
 	return 0;
 }
 
+#if defined(__linux__)
+/* a number of bytes, or "max" for no limit */
+static int read_cgroup_value(const char *path, size_t *kb)
+{
+	FILE *fp;
+	char buf[32];
+	int ret = -1;
+
+	fp = fopen(path, "r");
+
+	if (fp == NULL)
+		return (-1);
+
+	if (fgets(buf, sizeof buf, fp) != NULL) {
+		if (strncmp(buf, "max", 3) == 0) {
+			*kb = SIZE_MAX;
+			ret = 0;
+		} else if (isdigit(buf[0])) {
+			*kb = (size_t)(strtoull(buf, NULL, 10) / 1024);
+			ret = 0;
+		}
+	}
+
+	fclose(fp);
+	return (ret);
+}
+#endif
+
+int oscap_cgroup_memusage(struct cgroup_memusage *mu)
+{
+	if (mu == NULL)
+		return -1;
+#if defined(__linux__)
+	if (read_cgroup_value("/sys/fs/cgroup/memory.max", &mu->mu_limit) != 0
+	    || read_cgroup_value("/sys/fs/cgroup/memory.current", &mu->mu_usage) != 0) {
+		if (read_cgroup_value("/sys/fs/cgroup/memory/memory.limit_in_bytes", &mu->mu_limit) != 0
+		    || read_cgroup_value("/sys/fs/cgroup/memory/memory.usage_in_bytes", &mu->mu_usage) != 0)
+			return -1;
+	}
+
+	/* cgroup v1 reports no limit as a huge number, which is no limit for the callers either */
+	return mu->mu_limit == SIZE_MAX ? 1 : 0;
+#else
+	errno = EOPNOTSUPP;
+	return -1;
+#endif
+}
+
 int oscap_proc_memusage(struct proc_memusage *mu)
 {
 	if (mu == NULL)
@@ -28,7 +28,21 @@ struct sys_memusage {
 	size_t mu_inactive;
 };
 
+/* memory limit and usage of the cgroup of the process, in kB */
+struct cgroup_memusage {
+	size_t mu_limit;
+	size_t mu_usage;
+};
+
 int oscap_proc_memusage(struct proc_memusage *mu);
 int oscap_sys_memusage(struct sys_memusage *mu);
 
+/**
+ * Read the memory limit of the cgroup of the process (cgroup v2, or the
+ * memory controller of cgroup v1).
+ * @return 0 if the cgroup has a memory limit, 1 if it has none and -1
+ *         if the cgroup filesystem can't be read
+ */
+int oscap_cgroup_memusage(struct cgroup_memusage *mu);
+
 #endif /* MEMUSAGE_H */
@@ -24,10 +24,14 @@
 
 #include <stdio.h> // for P_tmpdir macro
 #include <string.h>
+#include <strings.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <limits.h>
+#include <sys/stat.h>
 
 #include <curl/curl.h>
 #include <curl/easy.h>
@@ -39,6 +43,8 @@
 #include "common/util.h"
 #include "common/oscap_buffer.h"
 #include "common/_error.h"
+#include "common/debug_priv.h"
+#include "common/list.h"
 #include "oscap_string.h"
 
 #ifndef P_tmpdir
@@ -143,36 +149,392 @@ oscap_acquire_url_to_filename(const char *url)
 	return filename;
 }
 
-char* oscap_acquire_url_download(const char *url, size_t* memory_size)
-{
+/*
+ * A download of one url. If the download cache is enabled, the body and
+ * the validators (ETag, Last-Modified) of every successful response are
+ * kept in the cache and the next download of the url is a conditional
+ * request; the cached body is used when the server answers 304.
+ */
+struct oscap_download {
 	CURL *curl;
-	curl = curl_easy_init();
-	if (curl == NULL) {
+	char *url;
+	char *cache_path;               ///< NULL if the cache isn't used
+	struct curl_slist *headers;
+	struct oscap_buffer *buffer;
+	char *etag;
+	char *last_modified;
+};
+
+struct oscap_download_entry {
+	struct oscap_download *dl;      ///< until the download is finished
+	char *data;
+	size_t size;
+};
+
+static const char *oscap_download_cache_dir(void)
+{
+	const char *dir;
+	struct stat st;
+
+	dir = getenv(OSCAP_DOWNLOAD_CACHE_ENV);
+
+	if (dir == NULL || *dir == '\0')
+		return NULL;
+
+	if (stat(dir, &st) != 0 || !S_ISDIR(st.st_mode) || st.st_uid != geteuid() || (st.st_mode & 077) != 0) {
+		dW("Not using the download cache '%s': it must be a directory "
+		   "owned by the user and not accessible by others.", dir);
+		return NULL;
+	}
+
+	return dir;
+}
+
+static char *oscap_download_cache_path(const char *dir, const char *url)
+{
+	/* FNV-1a, the url itself may be longer than a file name */
+	uint64_t hash = 0xcbf29ce484222325ULL;
+
+	for (const char *c = url; *c != '\0'; ++c) {
+		hash ^= (unsigned char) *c;
+		hash *= 0x100000001b3ULL;
+	}
+
+	return oscap_sprintf("%s/%016llx", dir, (unsigned long long) hash);
+}
+
+static char *oscap_download_read_file(const char *path, size_t *size)
+{
+	struct stat st;
+	char *data = NULL;
+	size_t done = 0;
+	int fd;
+
+	fd = open(path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+	if (fd < 0)
+		return NULL;
+
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+		goto fail;
+
+	data = malloc(st.st_size + 1);
+	while (done < (size_t) st.st_size) {
+		ssize_t r = read(fd, data + done, st.st_size - done);
+		if (r < 0 && errno == EINTR)
+			continue;
+		if (r <= 0)
+			goto fail;
+		done += r;
+	}
+	data[done] = '\0';
+	close(fd);
+
+	*size = done;
+	return data;
+fail:
+	free(data);
+	close(fd);
+	return NULL;
+}
+
+static int oscap_download_write_file(const char *path, const char *data, size_t size)
+{
+	char *temp_path = oscap_sprintf("%s.XXXXXX", path);
+	size_t done = 0;
+	int fd;
+
+	fd = mkstemp(temp_path);
+	if (fd < 0)
+		goto fail;
+
+	while (done < size) {
+		ssize_t w = write(fd, data + done, size - done);
+		if (w < 0 && errno == EINTR)
+			continue;
+		if (w <= 0) {
+			close(fd);
+			goto fail;
+		}
+		done += w;
+	}
+
+	if (close(fd) != 0 || rename(temp_path, path) != 0)
+		goto fail;
+
+	free(temp_path);
+	return 0;
+fail:
+	dW("Can't write the download cache file '%s': %s.", path, strerror(errno));
+	unlink(temp_path);
+	free(temp_path);
+	return -1;
+}
+
+/* the validators of the cached body, the meta file holds the ETag and the Last-Modified lines */
+static void oscap_download_add_validators(struct oscap_download *dl)
+{
+	char *meta_path = oscap_sprintf("%s.meta", dl->cache_path);
+	size_t size;
+	char *meta = oscap_download_read_file(meta_path, &size);
+	free(meta_path);
+
+	if (meta == NULL || access(dl->cache_path, R_OK) != 0) {
+		free(meta);
+		return;
+	}
+
+	char *last_modified = strchr(meta, '\n');
+	if (last_modified != NULL) {
+		*last_modified++ = '\0';
+		last_modified[strcspn(last_modified, "\n")] = '\0';
+
+		if (*meta != '\0') {
+			char *header = oscap_sprintf("If-None-Match: %s", meta);
+			dl->headers = curl_slist_append(dl->headers, header);
+			free(header);
+		}
+		if (*last_modified != '\0') {
+			char *header = oscap_sprintf("If-Modified-Since: %s", last_modified);
+			dl->headers = curl_slist_append(dl->headers, header);
+			free(header);
+		}
+		curl_easy_setopt(dl->curl, CURLOPT_HTTPHEADER, dl->headers);
+	}
+	free(meta);
+}
+
+static char *oscap_download_header_value(const char *line, size_t length, const char *name)
+{
+	size_t name_length = strlen(name);
+
+	if (length <= name_length || strncasecmp(line, name, name_length) != 0)
+		return NULL;
+
+	line += name_length;
+	length -= name_length;
+	while (length > 0 && (*line == ' ' || *line == '\t')) {
+		++line;
+		--length;
+	}
+	while (length > 0 && (line[length - 1] == '\r' || line[length - 1] == '\n' || line[length - 1] == ' '))
+		--length;
+
+	return strndup(line, length);
+}
+
+static size_t oscap_download_header_callback(char *ptr, size_t size, size_t nmemb, void *userdata)
+{
+	struct oscap_download *dl = userdata;
+	size_t length = size * nmemb;
+	char *value;
+
+	if (length >= 5 && strncmp(ptr, "HTTP/", 5) == 0) {
+		// a new response (e.g. after a redirect), forget the headers of the previous one
+		free(dl->etag);
+		free(dl->last_modified);
+		dl->etag = NULL;
+		dl->last_modified = NULL;
+	} else if ((value = oscap_download_header_value(ptr, length, "ETag:")) != NULL) {
+		free(dl->etag);
+		dl->etag = value;
+	} else if ((value = oscap_download_header_value(ptr, length, "Last-Modified:")) != NULL) {
+		free(dl->last_modified);
+		dl->last_modified = value;
+	}
+
+	return length;
+}
+
+static void oscap_download_free(struct oscap_download *dl)
+{
+	if (dl == NULL)
+		return;
+	if (dl->curl != NULL)
+		curl_easy_cleanup(dl->curl);
+	curl_slist_free_all(dl->headers);
+	oscap_buffer_free(dl->buffer);
+	free(dl->url);
+	free(dl->cache_path);
+	free(dl->etag);
+	free(dl->last_modified);
+	free(dl);
+}
+
+static struct oscap_download *oscap_download_new(const char *url)
+{
+	struct oscap_download *dl = calloc(1, sizeof(struct oscap_download));
+
+	dl->curl = curl_easy_init();
+	if (dl->curl == NULL) {
 		oscap_seterr(OSCAP_EFAMILY_NET, "Failed to initialize libcurl.");
+		oscap_download_free(dl);
 		return NULL;
 	}
 
-	struct oscap_buffer* buffer = oscap_buffer_new();
+	dl->url = strdup(url);
+	dl->buffer = oscap_buffer_new();
+
+	curl_easy_setopt(dl->curl, CURLOPT_URL, url);
+	curl_easy_setopt(dl->curl, CURLOPT_WRITEFUNCTION, write_to_memory_callback);
+	curl_easy_setopt(dl->curl, CURLOPT_WRITEDATA, dl->buffer);
+	curl_easy_setopt(dl->curl, CURLOPT_FOLLOWLOCATION, true);
+	curl_easy_setopt(dl->curl, CURLOPT_PRIVATE, dl);
+
+	const char *cache_dir = oscap_download_cache_dir();
+	if (cache_dir != NULL) {
+		dl->cache_path = oscap_download_cache_path(cache_dir, url);
+		curl_easy_setopt(dl->curl, CURLOPT_HEADERFUNCTION, oscap_download_header_callback);
+		curl_easy_setopt(dl->curl, CURLOPT_HEADERDATA, dl);
+		oscap_download_add_validators(dl);
+	}
 
-	curl_easy_setopt(curl, CURLOPT_URL, url);
-	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_to_memory_callback);
-	curl_easy_setopt(curl, CURLOPT_WRITEDATA, buffer);
-	curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, true);
+	return dl;
+}
 
-	CURLcode res = curl_easy_perform(curl);
-	curl_easy_cleanup(curl);
+/* `quiet' doesn't report the errors, the download is going to be repeated */
+static char *oscap_download_finish(struct oscap_download *dl, CURLcode res, size_t *memory_size, bool quiet)
+{
+	long code = 0;
 
-	if (res != 0) {
-		oscap_seterr(OSCAP_EFAMILY_NET, "Download failed: %s", curl_easy_strerror(res));
-		oscap_buffer_free(buffer);
+	if (res != CURLE_OK) {
+		if (!quiet)
+			oscap_seterr(OSCAP_EFAMILY_NET, "Download failed: %s", curl_easy_strerror(res));
 		return NULL;
 	}
 
-	*memory_size = oscap_buffer_get_length(buffer);
-	char* data = oscap_buffer_bequeath(buffer); // get data and free buffer struct
+	curl_easy_getinfo(dl->curl, CURLINFO_RESPONSE_CODE, &code);
+
+	if (dl->cache_path != NULL && code == 304) {
+		char *data = oscap_download_read_file(dl->cache_path, memory_size);
+		if (data == NULL && !quiet)
+			oscap_seterr(OSCAP_EFAMILY_NET, "Download of %s failed: the cached copy is gone.", dl->url);
+		else if (data != NULL)
+			dI("Using the cached copy of %s.", dl->url);
+		return data;
+	}
+
+	*memory_size = oscap_buffer_get_length(dl->buffer);
+	char *data = oscap_buffer_bequeath(dl->buffer); // get data and free buffer struct
+	dl->buffer = NULL;
+
+	if (dl->cache_path != NULL && code == 200 && (dl->etag != NULL || dl->last_modified != NULL)) {
+		if (oscap_download_write_file(dl->cache_path, data, *memory_size) == 0) {
+			char *meta_path = oscap_sprintf("%s.meta", dl->cache_path);
+			char *meta = oscap_sprintf("%s\n%s\n", dl->etag != NULL ? dl->etag : "",
+					dl->last_modified != NULL ? dl->last_modified : "");
+			oscap_download_write_file(meta_path, meta, strlen(meta));
+			free(meta);
+			free(meta_path);
+		}
+	}
+
+	return data;
+}
+
+char* oscap_acquire_url_download(const char *url, size_t* memory_size)
+{
+	struct oscap_download *dl = oscap_download_new(url);
+	if (dl == NULL)
+		return NULL;
+
+	CURLcode res = curl_easy_perform(dl->curl);
+	char *data = oscap_download_finish(dl, res, memory_size, false);
+	oscap_download_free(dl);
 	return data;
 }
 
+static void oscap_download_entry_free(void *ptr)
+{
+	struct oscap_download_entry *entry = ptr;
+	free(entry->data);
+	free(entry);
+}
+
+struct oscap_htable *oscap_acquire_url_download_all(const char **urls)
+{
+	struct oscap_htable *downloads = oscap_htable_new();
+	CURLM *multi = curl_multi_init();
+	int running = 0;
+
+	if (multi == NULL) {
+		dW("Failed to initialize libcurl, the resources are going to be downloaded one by one.");
+		return downloads;
+	}
+	curl_multi_setopt(multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, (long) OSCAP_DOWNLOAD_PARALLEL);
+
+	for (size_t i = 0; urls[i] != NULL; ++i) {
+		if (oscap_htable_get(downloads, urls[i]) != NULL)
+			continue;
+		struct oscap_download_entry *entry = calloc(1, sizeof(struct oscap_download_entry));
+		entry->dl = oscap_download_new(urls[i]);
+		if (entry->dl == NULL) {
+			free(entry);
+			continue;
+		}
+		oscap_htable_add(downloads, urls[i], entry);
+		curl_multi_add_handle(multi, entry->dl->curl);
+	}
+
+	do {
+		CURLMcode mres = curl_multi_perform(multi, &running);
+		if (mres == CURLM_OK && running > 0)
+			mres = curl_multi_wait(multi, NULL, 0, 1000, NULL);
+		if (mres != CURLM_OK) {
+			dW("Parallel download failed: %s", curl_multi_strerror(mres));
+			running = 0;
+		}
+
+		CURLMsg *msg;
+		int queued;
+		while ((msg = curl_multi_info_read(multi, &queued)) != NULL) {
+			if (msg->msg != CURLMSG_DONE)
+				continue;
+
+			struct oscap_download *dl = NULL;
+			curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **) &dl);
+			struct oscap_download_entry *entry = oscap_htable_get(downloads, dl->url);
+			entry->data = oscap_download_finish(dl, msg->data.result, &entry->size, true);
+
+			curl_multi_remove_handle(multi, dl->curl);
+			oscap_download_free(dl);
+			entry->dl = NULL;
+		}
+	} while (running > 0);
+
+	// the failed downloads are repeated and reported by oscap_acquire_url_download_take()
+	for (size_t i = 0; urls[i] != NULL; ++i) {
+		struct oscap_download_entry *entry = oscap_htable_get(downloads, urls[i]);
+		if (entry == NULL || entry->data != NULL)
+			continue;
+		if (entry->dl != NULL) {
+			curl_multi_remove_handle(multi, entry->dl->curl);
+			oscap_download_free(entry->dl);
+		}
+		free(oscap_htable_detach(downloads, urls[i]));
+	}
+	curl_multi_cleanup(multi);
+
+	return downloads;
+}
+
+char *oscap_acquire_url_download_take(struct oscap_htable *downloads, const char *url, size_t *memory_size)
+{
+	struct oscap_download_entry *entry = downloads != NULL ? oscap_htable_detach(downloads, url) : NULL;
+
+	if (entry == NULL)
+		return oscap_acquire_url_download(url, memory_size);
+
+	char *data = entry->data;
+	*memory_size = entry->size;
+	free(entry);
+	return data;
+}
+
+void oscap_acquire_url_downloads_free(struct oscap_htable *downloads)
+{
+	oscap_htable_free(downloads, oscap_download_entry_free);
+}
+
 size_t write_to_memory_callback(char *ptr, size_t size, size_t nmemb, void *userdata)
 {
 	size_t new_received_size = size * nmemb; // total size of newly received data
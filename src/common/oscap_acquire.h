@@ -26,6 +26,17 @@
 
 OSCAP_HIDDEN_START;
 
+/*
+ * Directory in which the downloaded resources are kept with their ETag and
+ * Last-Modified, the next download of a resource is a conditional request.
+ */
+#define OSCAP_DOWNLOAD_CACHE_ENV "OSCAP_DOWNLOAD_CACHE"
+
+/* connections used by oscap_acquire_url_download_all() */
+#define OSCAP_DOWNLOAD_PARALLEL 8
+
+struct oscap_htable;
+
 /**
  * Create an oscap temp dir. (While ideally all the operations are being
  * made on unliked files using file descriptors, this is bordeline impossible
@@ -76,6 +87,30 @@ char *oscap_acquire_url_to_filename(const char *url);
 char *
 oscap_acquire_url_download(const char *url, size_t* memory_size);
 
+/**
+ * Download the given urls to memory in parallel. The failed downloads
+ * are left out of the result, they are reported when they are taken.
+ * @param urls NULL-terminated array of urls to acquire
+ * @return the downloads which shall be taken by oscap_acquire_url_download_take()
+ * and freed by oscap_acquire_url_downloads_free()
+ */
+struct oscap_htable *oscap_acquire_url_download_all(const char **urls);
+
+/**
+ * Take the data of the url from the result of oscap_acquire_url_download_all().
+ * The url is downloaded now if it isn't there.
+ * @param downloads result of oscap_acquire_url_download_all() or NULL
+ * @param url The url to acquire
+ * @param memory_size Size of memory. If NULL is returned, variable is not modified.
+ * @return the pointer to memory with downloaded data or NULL on error
+ */
+char *oscap_acquire_url_download_take(struct oscap_htable *downloads, const char *url, size_t *memory_size);
+
+/**
+ * Free the downloads which weren't taken.
+ */
+void oscap_acquire_url_downloads_free(struct oscap_htable *downloads);
+
 /**
  * Guess how the realpath of given file may look like. Do your best!
  * Unlike realpath() this works for non-existent files.
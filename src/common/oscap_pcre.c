@@ -0,0 +1,222 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "alloc.h"
+#include "list.h"
+#include "util.h"
+#include "debug_priv.h"
+#include "oscap_pcre.h"
+
+#if defined(PCRE_STUDY_JIT_COMPILE)
+# define OSCAP_PCRE_STUDY_OPTS PCRE_STUDY_JIT_COMPILE
+#else
+# define OSCAP_PCRE_STUDY_OPTS 0
+#endif
+
+static pthread_mutex_t __cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct oscap_htable *__cache = NULL;
+static char *__cache_keys[OSCAP_PCRE_CACHE_MAX]; /* in the order of insertion */
+static size_t __cache_count = 0;
+static size_t __cache_next = 0;
+
+static void oscap_pcre_free(oscap_pcre_t *re)
+{
+	if (re->extra != NULL)
+		pcre_free_study(re->extra);
+	pcre_free(re->re);
+	oscap_free(re);
+}
+
+static oscap_pcre_t *oscap_pcre_compile(const char *pattern, int options, const char **errptr, int *erroffset)
+{
+	oscap_pcre_t *re;
+	const char *err = NULL;
+	int errofs = 0;
+
+	re = oscap_talloc(oscap_pcre_t);
+	re->re = pcre_compile(pattern, options, &err, &errofs, NULL);
+
+	if (re->re == NULL) {
+		if (errptr != NULL)
+			*errptr = err;
+		if (erroffset != NULL)
+			*erroffset = errofs;
+		oscap_free(re);
+		return (NULL);
+	}
+
+	/*
+	 * The study data is an optimization only, the pattern is usable
+	 * without it.
+	 */
+	re->extra = pcre_study(re->re, OSCAP_PCRE_STUDY_OPTS, &err);
+
+	if (re->extra == NULL && err != NULL)
+		dW("pcre_study() failed for pattern '%s': %s", pattern, err);
+
+	re->cached = false;
+	re->refs   = 1;
+	return (re);
+}
+
+/* make room for a new pattern, called with the lock held */
+static void oscap_pcre_evict(void)
+{
+	oscap_pcre_t *old;
+	char *key = __cache_keys[__cache_next];
+
+	old = oscap_htable_detach(__cache, key);
+	oscap_free(key);
+	__cache_keys[__cache_next] = NULL;
+	--__cache_count;
+
+	if (old != NULL) {
+		old->cached = false;
+		if (old->refs == 0)
+			oscap_pcre_free(old);
+	}
+}
+
+oscap_pcre_t *oscap_pcre_get(const char *pattern, int options, const char **errptr, int *erroffset)
+{
+	oscap_pcre_t *re, *prev;
+	char *key;
+
+	key = oscap_sprintf("%x:%s", (unsigned int)options, pattern);
+
+	pthread_mutex_lock(&__cache_lock);
+	re = __cache != NULL ? oscap_htable_get(__cache, key) : NULL;
+	if (re != NULL)
+		++re->refs;
+	pthread_mutex_unlock(&__cache_lock);
+
+	if (re != NULL) {
+		oscap_free(key);
+		return (re);
+	}
+
+	/*
+	 * Compile without holding the lock. If another thread was faster,
+	 * use its copy and throw ours away.
+	 */
+	re = oscap_pcre_compile(pattern, options, errptr, erroffset);
+
+	if (re == NULL) {
+		oscap_free(key);
+		return (NULL);
+	}
+
+	pthread_mutex_lock(&__cache_lock);
+
+	if (__cache == NULL)
+		__cache = oscap_htable_new();
+
+	prev = oscap_htable_get(__cache, key);
+
+	if (prev != NULL) {
+		oscap_pcre_free(re);
+		re = prev;
+		++re->refs;
+		oscap_free(key);
+	} else {
+		if (__cache_count == OSCAP_PCRE_CACHE_MAX)
+			oscap_pcre_evict();
+		re->cached = true;
+		oscap_htable_add(__cache, key, re);
+		__cache_keys[__cache_next] = key;
+		__cache_next = (__cache_next + 1) % OSCAP_PCRE_CACHE_MAX;
+		++__cache_count;
+	}
+
+	pthread_mutex_unlock(&__cache_lock);
+
+	return (re);
+}
+
+void oscap_pcre_put(oscap_pcre_t *re)
+{
+	bool drop;
+
+	if (re == NULL)
+		return;
+
+	pthread_mutex_lock(&__cache_lock);
+	drop = --re->refs == 0 && !re->cached;
+	pthread_mutex_unlock(&__cache_lock);
+
+	if (drop)
+		oscap_pcre_free(re);
+}
+
+int oscap_pcre_exec(const oscap_pcre_t *re, const char *subject, int length,
+		int startoffset, int options, int *ovector, int ovecsize)
+{
+	int ret;
+
+	ret = pcre_exec(re->re, re->extra, subject, length, startoffset, options, ovector, ovecsize);
+
+#if defined(PCRE_ERROR_JIT_STACKLIMIT) && defined(PCRE_EXTRA_EXECUTABLE_JIT)
+	if (ret == PCRE_ERROR_JIT_STACKLIMIT && re->extra != NULL) {
+		/*
+		 * The default JIT stack is small and a shared one would need
+		 * locking. The interpreter uses the machine stack, so retry
+		 * with a private copy of the study data with JIT disabled.
+		 */
+		pcre_extra extra;
+
+		memcpy(&extra, re->extra, sizeof extra);
+		extra.flags &= ~PCRE_EXTRA_EXECUTABLE_JIT;
+
+		ret = pcre_exec(re->re, &extra, subject, length, startoffset, options, ovector, ovecsize);
+	}
+#endif
+	return (ret);
+}
+
+static void oscap_pcre_free_cb(void *ptr)
+{
+	oscap_pcre_free((oscap_pcre_t *)ptr);
+}
+
+void oscap_pcre_cache_clear(void)
+{
+	pthread_mutex_lock(&__cache_lock);
+
+	if (__cache != NULL) {
+		oscap_htable_free(__cache, oscap_pcre_free_cb);
+		__cache = NULL;
+		__cache_count = 0;
+		__cache_next = 0;
+
+		for (size_t i = 0; i < OSCAP_PCRE_CACHE_MAX; ++i) {
+			oscap_free(__cache_keys[i]);
+			__cache_keys[i] = NULL;
+		}
+	}
+
+	pthread_mutex_unlock(&__cache_lock);
+}
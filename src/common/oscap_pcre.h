@@ -0,0 +1,74 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef OSCAP_PCRE_H_
+#define OSCAP_PCRE_H_
+
+#include <stdbool.h>
+#include <pcre.h>
+
+/*
+ * Process-wide cache of compiled regular expressions
+ *
+ * OVAL content tends to use the same few patterns over and over, for every
+ * object, item and path component. The patterns are compiled and studied
+ * (with JIT when available) only once per process and the result is shared
+ * by all threads; pcre_exec() doesn't modify the compiled pattern, so this
+ * is safe. The cache is bounded by OSCAP_PCRE_CACHE_MAX entries; once it
+ * is full, the oldest pattern is dropped for a new one. A dropped pattern
+ * which is still in use is released by the last oscap_pcre_put().
+ */
+#define OSCAP_PCRE_CACHE_MAX 1024
+
+typedef struct oscap_pcre {
+	pcre        *re;
+	pcre_extra  *extra;
+	bool         cached;
+	unsigned int refs; /**< oscap_pcre_get() calls not matched by oscap_pcre_put() yet */
+} oscap_pcre_t;
+
+/**
+ * Get a compiled pattern from the cache, compiling it if needed.
+ * @param pattern regular expression
+ * @param options pcre_compile() options, part of the cache key
+ * @param errptr where to store the pcre_compile() error message (may be NULL)
+ * @param erroffset where to store the pcre_compile() error offset (may be NULL)
+ * @return the compiled pattern or NULL if it can't be compiled
+ */
+oscap_pcre_t *oscap_pcre_get(const char *pattern, int options, const char **errptr, int *erroffset);
+
+/**
+ * Return a pattern obtained by oscap_pcre_get().
+ */
+void oscap_pcre_put(oscap_pcre_t *re);
+
+/**
+ * Wrapper around pcre_exec() which uses the study data of the pattern and
+ * falls back to the interpreter if the JIT code runs out of stack.
+ */
+int oscap_pcre_exec(const oscap_pcre_t *re, const char *subject, int length,
+		int startoffset, int options, int *ovector, int ovecsize);
+
+/**
+ * Drop all cached patterns. No pattern obtained from the cache may be in
+ * use when this is called.
+ */
+void oscap_pcre_cache_clear(void);
+
+#endif /* OSCAP_PCRE_H_ */
@@ -0,0 +1,216 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "debug_priv.h"
+#include "oscap_trace.h"
+
+#define OSCAP_TRACE_NAMES   64  /* distinct span names with a histogram */
+#define OSCAP_TRACE_BUCKETS 32  /* powers of two of microseconds */
+#define OSCAP_TRACE_ARGMAX  256 /* longer arguments are truncated */
+
+struct oscap_trace_hist {
+	const char *name;
+	uint64_t count;
+	uint64_t total;
+	uint64_t max;
+	uint64_t buckets[OSCAP_TRACE_BUCKETS];
+};
+
+int __oscap_trace_state = 0;
+
+static int __trace_fd = -1;
+static pthread_once_t __trace_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t __trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct oscap_trace_hist __trace_hist[OSCAP_TRACE_NAMES];
+
+static uint64_t oscap_trace_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static long oscap_trace_tid(void)
+{
+	return (long)syscall(SYS_gettid);
+}
+
+static void oscap_trace_write(const char *buf, size_t len)
+{
+	ssize_t w;
+
+	/* O_APPEND makes every event a single append, even from other processes */
+	do {
+		w = write(__trace_fd, buf, len);
+	} while (w < 0 && errno == EINTR);
+}
+
+static void oscap_trace_histograms(void)
+{
+	char buf[2048];
+	size_t i, b;
+	int len;
+
+	pthread_mutex_lock(&__trace_lock);
+
+	for (i = 0; i < OSCAP_TRACE_NAMES && __trace_hist[i].name != NULL; ++i) {
+		const struct oscap_trace_hist *h = &__trace_hist[i];
+
+		len = snprintf(buf, sizeof buf,
+			       "{\"name\":\"%s latency\",\"cat\":\"oscap\",\"ph\":\"i\",\"s\":\"p\",\"ts\":%llu,"
+			       "\"pid\":%ld,\"tid\":%ld,\"args\":{\"count\":%llu,\"total_us\":%llu,\"max_us\":%llu,"
+			       "\"buckets_us\":{",
+			       h->name, (unsigned long long)oscap_trace_now(), (long)getpid(), oscap_trace_tid(),
+			       (unsigned long long)h->count, (unsigned long long)h->total, (unsigned long long)h->max);
+
+		/* the upper bound of every non-empty bucket */
+		for (b = 0; b < OSCAP_TRACE_BUCKETS && len < (int)sizeof buf - 64; ++b) {
+			if (h->buckets[b] == 0)
+				continue;
+			len += snprintf(buf + len, sizeof buf - len, "%s\"%llu\":%llu", buf[len - 1] == '{' ? "" : ",",
+					1ULL << b, (unsigned long long)h->buckets[b]);
+		}
+
+		len += snprintf(buf + len, sizeof buf - len, "}}},\n");
+		oscap_trace_write(buf, (size_t)len);
+	}
+
+	pthread_mutex_unlock(&__trace_lock);
+}
+
+static void oscap_trace_open(void)
+{
+	const char *path;
+	int fd;
+
+	path = getenv(OSCAP_TRACE_ENV);
+
+	if (path == NULL || *path == '\0') {
+		__atomic_store_n(&__oscap_trace_state, -1, __ATOMIC_RELEASE);
+		return;
+	}
+
+	fd = open(path, O_WRONLY | O_APPEND | O_CLOEXEC);
+
+	if (fd < 0) {
+		dW("Can't open the profile file '%s': %s.", path, strerror(errno));
+		__atomic_store_n(&__oscap_trace_state, -1, __ATOMIC_RELEASE);
+		return;
+	}
+
+	__trace_fd = fd;
+	atexit(&oscap_trace_histograms);
+	__atomic_store_n(&__oscap_trace_state, 1, __ATOMIC_RELEASE);
+}
+
+void oscap_trace_init(void)
+{
+	pthread_once(&__trace_once, &oscap_trace_open);
+}
+
+void __oscap_trace_begin(struct oscap_trace_span *span, const char *name)
+{
+	span->name  = name;
+	span->start = oscap_trace_now();
+}
+
+static void oscap_trace_hist_add(const char *name, uint64_t dur)
+{
+	struct oscap_trace_hist *h = NULL;
+	size_t i, b;
+
+	pthread_mutex_lock(&__trace_lock);
+
+	/* the names are string literals, so most lookups match by the pointer */
+	for (i = 0; i < OSCAP_TRACE_NAMES; ++i) {
+		if (__trace_hist[i].name == NULL) {
+			__trace_hist[i].name = name;
+			h = &__trace_hist[i];
+			break;
+		}
+		if (__trace_hist[i].name == name || strcmp(__trace_hist[i].name, name) == 0) {
+			h = &__trace_hist[i];
+			break;
+		}
+	}
+
+	if (h != NULL) {
+		for (b = 0; b < OSCAP_TRACE_BUCKETS - 1 && (1ULL << b) < dur; ++b)
+			;
+		h->count++;
+		h->total += dur;
+		h->buckets[b]++;
+		if (dur > h->max)
+			h->max = dur;
+	}
+
+	pthread_mutex_unlock(&__trace_lock);
+}
+
+void __oscap_trace_end(struct oscap_trace_span *span, const char *arg)
+{
+	char buf[512 + OSCAP_TRACE_ARGMAX * 2], *p;
+	uint64_t dur;
+	size_t i;
+	int len;
+
+	dur = oscap_trace_now() - span->start;
+	len = snprintf(buf, sizeof buf,
+		       "{\"name\":\"%s\",\"cat\":\"oscap\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%llu,\"pid\":%ld,\"tid\":%ld",
+		       span->name, (unsigned long long)span->start, (unsigned long long)dur,
+		       (long)getpid(), oscap_trace_tid());
+
+	if (arg != NULL) {
+		p = buf + len;
+		p += sprintf(p, ",\"args\":{\"id\":\"");
+		/* the argument is an id or a path, escape what JSON doesn't allow in a string */
+		for (i = 0; arg[i] != '\0' && i < OSCAP_TRACE_ARGMAX; ++i) {
+			unsigned char c = (unsigned char)arg[i];
+
+			if (c == '"' || c == '\\') {
+				*p++ = '\\';
+				*p++ = (char)c;
+			} else if (c >= 0x20) {
+				*p++ = (char)c;
+			}
+		}
+		p += sprintf(p, "\"}");
+		len = (int)(p - buf);
+	}
+
+	len += snprintf(buf + len, sizeof buf - len, "},\n");
+	oscap_trace_write(buf, (size_t)len);
+	oscap_trace_hist_add(span->name, dur);
+}
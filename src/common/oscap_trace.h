@@ -0,0 +1,76 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef OSCAP_TRACE_H
+#define OSCAP_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Timeline of a scan
+ *
+ * If OSCAP_PROFILE_RUN names a file, the spans marked by oscap_trace_begin
+ * and oscap_trace_end are appended to it by the oscap process and by the
+ * probes as complete events ("ph":"X") of the JSON array format of the
+ * Chrome trace event format, which chrome://tracing and Perfetto load even
+ * though the array is never closed. The file has to be created with the
+ * opening bracket (see oscap xccdf eval --profile-run). When a process
+ * exits, it appends the latency histogram of every span name it recorded
+ * as an instant event.
+ */
+#define OSCAP_TRACE_ENV "OSCAP_PROFILE_RUN"
+
+struct oscap_trace_span {
+	const char *name; /* NULL if tracing is disabled */
+	uint64_t start;   /* microseconds of CLOCK_MONOTONIC */
+};
+
+extern int __oscap_trace_state; /* 0 unknown, 1 enabled, -1 disabled */
+
+/* open the file, called by the probes before they change the root directory */
+void oscap_trace_init(void);
+
+static inline bool oscap_trace_enabled(void)
+{
+	if (__atomic_load_n(&__oscap_trace_state, __ATOMIC_ACQUIRE) == 0)
+		oscap_trace_init();
+	return __oscap_trace_state > 0;
+}
+
+void __oscap_trace_begin(struct oscap_trace_span *span, const char *name);
+void __oscap_trace_end(struct oscap_trace_span *span, const char *arg);
+
+/* `name' has to be a string literal */
+static inline void oscap_trace_begin(struct oscap_trace_span *span, const char *name)
+{
+	if (oscap_trace_enabled())
+		__oscap_trace_begin(span, name);
+	else
+		span->name = NULL;
+}
+
+/* `arg' is an optional detail of the span, e.g. the id of the object */
+static inline void oscap_trace_end(struct oscap_trace_span *span, const char *arg)
+{
+	if (span->name != NULL)
+		__oscap_trace_end(span, arg);
+}
+
+#endif /* OSCAP_TRACE_H */
@@ -45,6 +45,7 @@
 #include "debug_priv.h"
 #include "oscap_source.h"
 #include "oscapxml.h"
+#include "oscap_pcre.h"
 #include "source/schematron_priv.h"
 #include "source/validate_priv.h"
 #include "source/xslt_priv.h"
@@ -110,6 +111,9 @@ void oscap_init(void)
 void oscap_cleanup(void)
 {
 	oscap_clearerr();
+	oscap_pcre_cache_clear();
+	oscap_xslt_cache_clear();
+	oscap_schema_cache_clear();
 	xsltCleanupGlobals();
 	xmlCleanupParser();
 }
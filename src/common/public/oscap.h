@@ -33,6 +33,7 @@
 #ifndef OSCAP_H_
 #define OSCAP_H_
 #include <stdbool.h>
+#include <stdio.h>
 #include <wchar.h>
 
 #include "oscap_text.h"
@@ -70,6 +71,20 @@ void oscap_init(void);
  */
 void oscap_cleanup(void);
 
+/**
+ * Count the memory allocated and freed by the library from now on, by
+ * subsystem: XCCDF, OVAL, system characteristics, S-expressions, libxml2
+ * and the rest. It has to be called before oscap_init() for the memory of
+ * libxml2 to be counted, and before any other thread is started.
+ */
+void oscap_memory_accounting_enable(void);
+
+/**
+ * Print the memory counted since oscap_memory_accounting_enable() and the
+ * resident set of the process to the stream.
+ */
+void oscap_memory_report(FILE *stream);
+
 /// Get version of the OpenSCAP library
 const char *oscap_get_version(void);
 
@@ -0,0 +1,141 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "debug_priv.h"
+#include "ratelimit.h"
+
+struct oscap_ratelimit_bucket {
+	uint64_t rate;   /* tokens per second, 0 if unlimited */
+	double   tokens; /* negative while the takers sleep off a debt */
+	uint64_t last;   /* nanoseconds of the last refill */
+};
+
+int __oscap_ratelimit_state = 0;
+
+static pthread_once_t __ratelimit_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t __ratelimit_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct oscap_ratelimit_bucket __ratelimit_bucket[2];
+
+static uint64_t oscap_ratelimit_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t oscap_ratelimit_parse(const char *name)
+{
+	const char *str;
+	char *end;
+	unsigned long long rate;
+
+	str = getenv(name);
+
+	if (str == NULL || *str == '\0')
+		return 0;
+
+	errno = 0;
+	rate  = strtoull(str, &end, 10);
+
+	switch (*end) {
+	case 'G': case 'g': rate <<= 10; /* FALLTHROUGH */
+	case 'M': case 'm': rate <<= 10; /* FALLTHROUGH */
+	case 'K': case 'k': rate <<= 10; ++end;
+	}
+
+	if (errno != 0 || *end != '\0' || end == str) {
+		dW("Invalid value of %s: '%s', the rate is not limited.", name, str);
+		return 0;
+	}
+
+	return (uint64_t)rate;
+}
+
+static void oscap_ratelimit_setup(void)
+{
+	uint64_t now = oscap_ratelimit_now();
+	size_t i;
+
+	__ratelimit_bucket[OSCAP_RATELIMIT_READ].rate = oscap_ratelimit_parse(OSCAP_RATELIMIT_READ_ENV);
+	__ratelimit_bucket[OSCAP_RATELIMIT_STAT].rate = oscap_ratelimit_parse(OSCAP_RATELIMIT_STAT_ENV);
+
+	for (i = 0; i < 2; ++i) {
+		__ratelimit_bucket[i].tokens = (double)__ratelimit_bucket[i].rate;
+		__ratelimit_bucket[i].last   = now;
+	}
+
+	__atomic_store_n(&__oscap_ratelimit_state,
+			 __ratelimit_bucket[OSCAP_RATELIMIT_READ].rate > 0 ||
+			 __ratelimit_bucket[OSCAP_RATELIMIT_STAT].rate > 0 ? 1 : -1, __ATOMIC_RELEASE);
+}
+
+void oscap_ratelimit_init(void)
+{
+	pthread_once(&__ratelimit_once, &oscap_ratelimit_setup);
+}
+
+void __oscap_ratelimit_take(oscap_ratelimit_t kind, uint64_t amount)
+{
+	struct oscap_ratelimit_bucket *b = &__ratelimit_bucket[kind];
+	struct timespec ts;
+	uint64_t now, wait = 0;
+
+	if (b->rate == 0)
+		return;
+
+	pthread_mutex_lock(&__ratelimit_lock);
+
+	now = oscap_ratelimit_now();
+	b->tokens += (double)(now - b->last) * b->rate / 1e9;
+	b->last    = now;
+
+	/* a burst of at most one second */
+	if (b->tokens > (double)b->rate)
+		b->tokens = (double)b->rate;
+
+	/*
+	 * The tokens go into debt, so that a read larger than the bucket
+	 * proceeds too; the debt delays this thread and the following ones.
+	 */
+	b->tokens -= (double)amount;
+
+	if (b->tokens < 0)
+		wait = (uint64_t)(-b->tokens * 1e9 / b->rate);
+
+	pthread_mutex_unlock(&__ratelimit_lock);
+
+	if (wait > 0) {
+		ts.tv_sec  = wait / 1000000000;
+		ts.tv_nsec = wait % 1000000000;
+
+		while (nanosleep(&ts, &ts) != 0 && errno == EINTR)
+			;
+	}
+}
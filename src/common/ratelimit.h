@@ -0,0 +1,58 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef OSCAP_RATELIMIT_H
+#define OSCAP_RATELIMIT_H
+
+#include <stdint.h>
+
+/*
+ * Rate limits of a probe
+ *
+ * OSCAP_PROBE_READ_RATE limits the bytes of the files read by a probe per
+ * second (the k, M and G suffixes multiply by 1024), OSCAP_PROBE_STAT_RATE
+ * the files it visits per second. Every probe process has its own token
+ * buckets, which hold at most one second of the rate; a thread which takes
+ * more than there is sleeps until the bucket is refilled.
+ */
+#define OSCAP_RATELIMIT_READ_ENV "OSCAP_PROBE_READ_RATE"
+#define OSCAP_RATELIMIT_STAT_ENV "OSCAP_PROBE_STAT_RATE"
+
+typedef enum {
+	OSCAP_RATELIMIT_READ = 0, /* bytes read */
+	OSCAP_RATELIMIT_STAT = 1  /* files visited */
+} oscap_ratelimit_t;
+
+extern int __oscap_ratelimit_state; /* 0 unknown, 1 enabled, -1 disabled */
+
+/* read the limits from the environment */
+void oscap_ratelimit_init(void);
+
+void __oscap_ratelimit_take(oscap_ratelimit_t kind, uint64_t amount);
+
+/* take `amount' tokens, sleep if the bucket doesn't hold them */
+static inline void oscap_ratelimit_take(oscap_ratelimit_t kind, uint64_t amount)
+{
+	if (__atomic_load_n(&__oscap_ratelimit_state, __ATOMIC_ACQUIRE) == 0)
+		oscap_ratelimit_init();
+	if (__oscap_ratelimit_state > 0)
+		__oscap_ratelimit_take(kind, amount);
+}
+
+#endif /* OSCAP_RATELIMIT_H */
@@ -34,6 +34,7 @@
 
 #include <string.h>
 #include <stdio.h>
+#include <pthread.h>
 
 #include "text_priv.h"
 #include "util.h"
@@ -47,7 +48,6 @@ const struct oscap_text_traits OSCAP_TEXT_TRAITS_PLAIN = { .html = false };
 const struct oscap_text_traits OSCAP_TEXT_TRAITS_HTML  = { .html = true };
 
 
-OSCAP_ACCESSOR_STRING(oscap_text, text)
 OSCAP_ACCESSOR_STRING(oscap_text, lang)
 OSCAP_GENERIC_GETTER(bool, oscap_text, is_html, traits.html)
 OSCAP_GENERIC_GETTER(bool, oscap_text, can_substitute, traits.can_substitute)
@@ -58,6 +58,62 @@ OSCAP_ITERATOR_GEN_T(struct oscap_text *, oscap_text)
 OSCAP_ITERATOR_REMOVE_T(struct oscap_text *, oscap_text, oscap_text_free)
 
 
+static __thread bool __text_lazy = false;
+static pthread_mutex_t __text_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void oscap_text_set_lazy(bool lazy)
+{
+	__text_lazy = lazy;
+}
+
+/* the same string as xmlTextReaderReadInnerXml gives for the element */
+static char *oscap_text_inner_xml(xmlNode *element)
+{
+	xmlBuffer *buff = xmlBufferCreate();
+
+	for (xmlNode *cur = element->children; cur != NULL; cur = cur->next) {
+		xmlNode *node = xmlDocCopyNode(cur, element->doc, 1);
+		xmlNodeDump(buff, element->doc, node, 0, 0);
+		xmlFreeNode(node);
+	}
+
+	char *xml = oscap_strdup((const char *) xmlBufferContent(buff));
+	xmlBufferFree(buff);
+	return xml;
+}
+
+/* the texts are read by the rule evaluation threads too */
+static const char *oscap_text_load(const struct oscap_text *text)
+{
+	struct oscap_text *t = (struct oscap_text *) text;
+
+	if (__atomic_load_n(&t->node, __ATOMIC_ACQUIRE) == NULL)
+		return t->text;
+
+	pthread_mutex_lock(&__text_lock);
+	if (t->node != NULL) {
+		t->text = oscap_text_inner_xml(t->node);
+		__atomic_store_n(&t->node, NULL, __ATOMIC_RELEASE);
+	}
+	pthread_mutex_unlock(&__text_lock);
+	return t->text;
+}
+
+const char *oscap_text_get_text(const struct oscap_text *text)
+{
+	return oscap_text_load(text);
+}
+
+bool oscap_text_set_text(struct oscap_text *text, const char *string)
+{
+	__atomic_store_n(&text->node, NULL, __ATOMIC_RELEASE);
+	free(text->text);
+	text->text = oscap_strdup(string);
+	oscap_free(text->plain);
+	text->plain = NULL;
+	return true;
+}
+
 bool oscap_text_set_overrides(struct oscap_text *text, bool overrides)
 {
 	text->traits.overrides = overrides;
@@ -69,6 +125,7 @@ void oscap_text_free(struct oscap_text *text)
     if (text != NULL) {
         oscap_free(text->lang);
         oscap_free(text->text);
+        oscap_free(text->plain);
         free(text);
     }
 }
@@ -90,7 +147,7 @@ struct oscap_text *oscap_text_new(void)
 
 struct oscap_text * oscap_text_clone(const struct oscap_text * text)
 {
-    return oscap_text_new_full(text->traits, text->text, text->lang);   
+    return oscap_text_new_full(text->traits, oscap_text_load(text), text->lang);
 }
 
 struct oscap_text *oscap_text_new_html(void)
@@ -119,7 +176,9 @@ struct oscap_text *oscap_text_new_parse(struct oscap_text_traits traits, xmlText
     xmlTextReaderMoveToElement(reader);
 
     // extract content
-    if (text->traits.html || text->traits.can_substitute)
+    if ((text->traits.html || text->traits.can_substitute) && __text_lazy)
+		text->node = xmlTextReaderCurrentNode(reader);
+    else if (text->traits.html || text->traits.can_substitute)
 		text->text = oscap_get_xml(reader);
     else text->text = oscap_element_string_copy(reader);
 
@@ -133,13 +192,13 @@ xmlNode *oscap_text_to_dom(struct oscap_text *text, xmlNode *parent, const char
 	xmlNode *text_node = NULL;
 
 	if (text->traits.html || text->traits.can_substitute) {
-		text_node = oscap_xmlstr_to_dom(parent, elname, text->text);
+		text_node = oscap_xmlstr_to_dom(parent, elname, oscap_text_load(text));
 		// make sure we use parent's namespace
 		xmlSetNs(text_node, parent->ns);
 	}
 	else {
 		// NULL as ns here means that namespace is inherited from parent
-		text_node = xmlNewTextChild(parent, NULL, BAD_CAST elname, BAD_CAST text->text);
+		text_node = xmlNewTextChild(parent, NULL, BAD_CAST elname, BAD_CAST oscap_text_load(text));
 	}
 
 	if (text_node == NULL) return NULL;
@@ -165,7 +224,7 @@ bool oscap_text_export(struct oscap_text *text, xmlTextWriter *writer, const cha
 		xmlTextWriterWriteAttribute(writer, BAD_CAST "override", BAD_CAST "true");
 
 	if (text->traits.html || text->traits.can_substitute)
-		xmlTextWriterWriteRaw(writer, BAD_CAST text->text);
+		xmlTextWriterWriteRaw(writer, BAD_CAST oscap_text_load(text));
 	else xmlTextWriterWriteString(writer, BAD_CAST text->text);
 
 	if (elname) xmlTextWriterEndElement(writer);
@@ -175,6 +234,11 @@ bool oscap_text_export(struct oscap_text *text, xmlTextWriter *writer, const cha
 
 char *_xhtml_to_plaintext(const char *xhtml_in)
 {
+	// Without markup, references and carriage returns the text is its own
+	// content, most titles and many descriptions are such.
+	if (xhtml_in != NULL && strpbrk(xhtml_in, "<&\r") == NULL)
+		return oscap_strdup(xhtml_in);
+
 	char *out = NULL;
 	char *str = oscap_sprintf("<x xmlns='http://www.w3.org/1999/xhtml'>%s</x>", xhtml_in);
 	xmlDoc *doc = xmlParseMemory(str, strlen(str));
@@ -196,13 +260,36 @@ char *_xhtml_to_plaintext(const char *xhtml_in)
 	return out;
 }
 
+/* the conversion of an XHTML text is kept, the texts are read by many threads */
+static const char *oscap_text_plain(const struct oscap_text *text)
+{
+	struct oscap_text *t = (struct oscap_text *) text;
+	char *plain = __atomic_load_n(&t->plain, __ATOMIC_ACQUIRE);
+
+	if (plain != NULL)
+		return plain;
+
+	plain = _xhtml_to_plaintext(oscap_text_load(text));
+	if (plain == NULL)
+		return NULL;
+
+	pthread_mutex_lock(&__text_lock);
+	if (t->plain == NULL) {
+		__atomic_store_n(&t->plain, plain, __ATOMIC_RELEASE);
+		plain = NULL;
+	}
+	pthread_mutex_unlock(&__text_lock);
+	oscap_free(plain);
+	return t->plain;
+}
+
 char *oscap_text_get_plaintext(const struct oscap_text *text)
 {
     if (text == NULL) return NULL;
 
     if (!text->traits.html) return oscap_strdup(text->text);
 
-	return _xhtml_to_plaintext(text->text);
+	return oscap_strdup(oscap_text_plain(text));
 }
 
 bool oscap_textlist_export(struct oscap_text_iterator *texts, xmlTextWriter *writer, const char *elname)
@@ -220,33 +307,24 @@ struct oscap_text *oscap_textlist_get_preferred_text(struct oscap_text_iterator
 	if (preferred_lang == NULL)
 		preferred_lang = OSCAP_LANG_DEFAULT;
 
-	oscap_text_iterator_reset(texts);
+	// In one walk: the exact match in preferred language, else the first
+	// text without language (implicit match), else the first text.
+	struct oscap_text *implicit = NULL, *first = NULL;
 
-	while (oscap_text_iterator_has_more(texts)) {
-		struct oscap_text *text = oscap_text_iterator_next(texts);
-		const char *lang = oscap_text_get_lang(text);
-		if (lang && strcmp(lang, preferred_lang) == 0)
-			return text;
-	}
-
-	// not found as exact match in preferred language, try to find implicit match
 	oscap_text_iterator_reset(texts);
 	while (oscap_text_iterator_has_more(texts)) {
 		struct oscap_text *text = oscap_text_iterator_next(texts);
-		const char *lang = oscap_text_get_lang(text);
-		if (lang == NULL)
+		if (text->lang == NULL) {
+			if (implicit == NULL)
+				implicit = text;
+		} else if (strcmp(text->lang, preferred_lang) == 0) {
 			return text;
+		}
+		if (first == NULL)
+			first = text;
 	}
 
-	// fallback to any language
-	oscap_text_iterator_reset(texts);
-	while (oscap_text_iterator_has_more(texts)) {
-		struct oscap_text *text = oscap_text_iterator_next(texts);
-		return text;
-	}
-
-	// nothing found
-	return NULL;
+	return implicit != NULL ? implicit : first;
 }
 
 char *oscap_textlist_get_preferred_plaintext(struct oscap_text_iterator *texts, const char *preferred_lang)
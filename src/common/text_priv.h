@@ -47,6 +47,8 @@ struct oscap_text_traits {
 struct oscap_text {
 	char *lang;
 	char *text;
+	xmlNode *node; ///< the element of a lazily loaded text, NULL once it's serialized
+	char *plain;   ///< the plain text of an XHTML text, made when first asked for
     struct oscap_text_traits traits;
 };
 
@@ -70,6 +72,14 @@ struct oscap_text *oscap_text_new_full(struct oscap_text_traits traits, const ch
  */
 struct oscap_text *oscap_text_new_parse(struct oscap_text_traits traits, xmlTextReaderPtr reader);
 
+/**
+ * Load the XHTML texts parsed by the calling thread lazily. Such a text
+ * only points to its element and is serialized when its content is asked
+ * for the first time, so the reader has to walk a DOM which outlives the
+ * texts (see xmlReaderWalker).
+ */
+void oscap_text_set_lazy(bool lazy);
+
 xmlNode *oscap_text_to_dom(struct oscap_text *text, xmlNode *parent, const char *elname);
 bool oscap_text_export(struct oscap_text *text, xmlTextWriter *writer, const char *elname);
 bool oscap_textlist_export(struct oscap_text_iterator *texts, xmlTextWriter *writer, const char *elname);
@@ -54,7 +54,7 @@ const char *oscap_enum_to_string(const struct oscap_string_map *map, int val)
 	return map->string;
 }
 
-char *oscap_strdup(const char *str)
+char *__oscap_strdup_t(const char *str, oscap_memory_tag_t tag)
 {
 
 	char *m;
@@ -66,10 +66,17 @@ char *oscap_strdup(const char *str)
 
 	if (m == NULL)
 		oscap_seterr(OSCAP_EFAMILY_GLIBC, strerror(errno));
+	else if (__oscap_memory_accounting)
+		__oscap_memory_count_alloc(tag, m);
 
 	return m;
 }
 
+char *(oscap_strdup)(const char *str)
+{
+	return __oscap_strdup_t(str, OSCAP_MEMORY_OTHER);
+}
+
 float oscap_strtol(const char *str, char **endptr, int base){
     if (str == NULL) {
         return NAN;
@@ -332,6 +332,10 @@ const char *oscap_enum_to_string(const struct oscap_string_map *map, int val);
  * @param str String we want to duplicate
  */
 char *oscap_strdup(const char *str);
+/// @cond
+char *__oscap_strdup_t(const char *str, oscap_memory_tag_t tag);
+/// @endcond
+#define oscap_strdup(str) __oscap_strdup_t((str), OSCAP_MEMORY_TAG)
 
 /**
  * Use strtol on string, if string is NULL, return NaN
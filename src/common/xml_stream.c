@@ -0,0 +1,237 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <libxml/xmlwriter.h>
+
+#include "alloc.h"
+#include "_error.h"
+#include "debug_priv.h"
+#include "xml_stream.h"
+
+/* neither the elements of the OVAL documents nor the groups of XCCDF benchmarks nest any deeper */
+#define XML_STREAM_MAX_DEPTH 32
+
+struct xml_stream {
+	xmlTextWriterPtr writer;
+	xmlDocPtr doc;                            ///< scratch document
+	xmlBufferPtr buffer;                      ///< a serialized child
+	xmlNodePtr open[XML_STREAM_MAX_DEPTH];    ///< elements whose start tag was written
+	bool content[XML_STREAM_MAX_DEPTH];       ///< whether any child was written into them
+	int depth;
+	int fd;
+	bool error;
+};
+
+static void _xml_stream_check(struct xml_stream *stream, int ret)
+{
+	if (ret < 0)
+		stream->error = true;
+}
+
+static void _xml_stream_indent(struct xml_stream *stream, int level)
+{
+	char indent[2 * XML_STREAM_MAX_DEPTH + 2];
+
+	indent[0] = '\n';
+	memset(indent + 1, ' ', 2 * level);
+	indent[2 * level + 1] = '\0';
+	_xml_stream_check(stream, xmlTextWriterWriteRaw(stream->writer, BAD_CAST indent));
+}
+
+static int _xml_stream_find(struct xml_stream *stream, xmlNode *node)
+{
+	for (int i = stream->depth - 1; i >= 0; --i) {
+		if (stream->open[i] == node)
+			return i;
+	}
+	return -1;
+}
+
+static void _xml_stream_open(struct xml_stream *stream, xmlNode *node)
+{
+	if (_xml_stream_find(stream, node) >= 0)
+		return;
+
+	xmlNode *parent = node->parent;
+	if (parent != NULL && parent->type == XML_ELEMENT_NODE)
+		_xml_stream_open(stream, parent);
+	else
+		parent = NULL;
+
+	/* the previous sibling has to be ended already */
+	xmlNode *top = stream->depth > 0 ? stream->open[stream->depth - 1] : NULL;
+	if (top != parent || stream->depth == XML_STREAM_MAX_DEPTH) {
+		dE("Element '%s' can't be written at this point of the stream.", node->name);
+		stream->error = true;
+		return;
+	}
+
+	if (stream->depth > 0) {
+		_xml_stream_indent(stream, stream->depth);
+		stream->content[stream->depth - 1] = true;
+	}
+
+	_xml_stream_check(stream, xmlTextWriterStartElementNS(stream->writer,
+			node->ns != NULL ? node->ns->prefix : NULL, node->name, NULL));
+
+	for (xmlNs *ns = node->nsDef; ns != NULL; ns = ns->next) {
+		if (ns->prefix != NULL)
+			_xml_stream_check(stream, xmlTextWriterWriteAttributeNS(stream->writer,
+					BAD_CAST "xmlns", ns->prefix, NULL, ns->href));
+		else
+			_xml_stream_check(stream, xmlTextWriterWriteAttribute(stream->writer,
+					BAD_CAST "xmlns", ns->href));
+	}
+
+	for (xmlAttr *attr = node->properties; attr != NULL; attr = attr->next) {
+		xmlChar *value = xmlNodeGetContent((xmlNode *) attr);
+		_xml_stream_check(stream, xmlTextWriterWriteAttributeNS(stream->writer,
+				attr->ns != NULL ? attr->ns->prefix : NULL, attr->name, NULL,
+				value != NULL ? value : BAD_CAST ""));
+		xmlFree(value);
+	}
+
+	stream->open[stream->depth] = node;
+	stream->content[stream->depth] = false;
+	stream->depth++;
+}
+
+struct xml_stream *xml_stream_new(const char *filename)
+{
+	xmlOutputBufferPtr output;
+	int fd = -1;
+
+	if (strcmp(filename, "-") == 0) {
+		output = xmlOutputBufferCreateFile(stdout, NULL);
+	} else {
+		fd = open(filename, O_CREAT|O_TRUNC|O_WRONLY,
+				S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP|S_IROTH|S_IWOTH);
+		if (fd < 0) {
+			oscap_seterr(OSCAP_EFAMILY_GLIBC, "%s '%s'", strerror(errno), filename);
+			return NULL;
+		}
+		output = xmlOutputBufferCreateFd(fd, NULL);
+	}
+	if (output == NULL) {
+		oscap_setxmlerr(xmlGetLastError());
+		if (fd >= 0)
+			close(fd);
+		return NULL;
+	}
+
+	struct xml_stream *stream = oscap_calloc(1, sizeof(struct xml_stream));
+	stream->fd = fd;
+	stream->writer = xmlNewTextWriter(output);
+	stream->doc = xmlNewDoc(BAD_CAST "1.0");
+	/* keep the characters which aren't ASCII as they are */
+	stream->doc->encoding = xmlStrdup(BAD_CAST "UTF-8");
+	stream->buffer = xmlBufferCreate();
+
+	_xml_stream_check(stream, xmlTextWriterStartDocument(stream->writer, NULL, "UTF-8", NULL));
+	return stream;
+}
+
+xmlDoc *xml_stream_get_doc(struct xml_stream *stream)
+{
+	return stream->doc;
+}
+
+void xml_stream_flush(struct xml_stream *stream, xmlNode *node)
+{
+	if (stream == NULL)
+		return;
+
+	_xml_stream_open(stream, node);
+
+	xmlNode *child = node->children;
+	while (child != NULL) {
+		xmlNode *next = child->next;
+
+		xmlBufferEmpty(stream->buffer);
+		if (xmlNodeDump(stream->buffer, stream->doc, child, stream->depth, 1) < 0) {
+			stream->error = true;
+		} else {
+			_xml_stream_indent(stream, stream->depth);
+			_xml_stream_check(stream, xmlTextWriterWriteRaw(stream->writer, xmlBufferContent(stream->buffer)));
+		}
+		stream->content[stream->depth - 1] = true;
+
+		xmlUnlinkNode(child);
+		xmlFreeNode(child);
+		child = next;
+	}
+}
+
+void xml_stream_end(struct xml_stream *stream, xmlNode *node)
+{
+	if (stream == NULL)
+		return;
+
+	xml_stream_flush(stream, node);
+
+	if (_xml_stream_find(stream, node) != stream->depth - 1) {
+		dE("Element '%s' isn't the last open element of the stream.", node->name);
+		stream->error = true;
+		return;
+	}
+
+	stream->depth--;
+	if (stream->content[stream->depth])
+		_xml_stream_indent(stream, stream->depth);
+	_xml_stream_check(stream, xmlTextWriterEndElement(stream->writer));
+
+	xmlUnlinkNode(node);
+	xmlFreeNode(node);
+}
+
+int xml_stream_close(struct xml_stream *stream)
+{
+	int ret = 0;
+
+	if (stream->depth > 0) {
+		dE("The stream was closed with %d elements open.", stream->depth);
+		stream->error = true;
+	}
+
+	_xml_stream_check(stream, xmlTextWriterEndDocument(stream->writer));
+	xmlFreeTextWriter(stream->writer);
+	if (stream->fd >= 0 && close(stream->fd) != 0)
+		stream->error = true;
+
+	if (stream->error) {
+		oscap_seterr(OSCAP_EFAMILY_XML, "Unable to write the streamed XML document.");
+		ret = -1;
+	}
+
+	xmlBufferFree(stream->buffer);
+	xmlFreeDoc(stream->doc);
+	oscap_free(stream);
+	return ret;
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#pragma once
+#ifndef _OSCAP_XML_STREAM_H
+#define _OSCAP_XML_STREAM_H
+
+#include "util.h"
+#include <libxml/tree.h>
+
+OSCAP_HIDDEN_START;
+
+/**
+ * Writer of a document which is too big to be kept in memory as a whole.
+ *
+ * The usual *_to_dom functions build the document in the scratch document
+ * of the stream. The caller flushes an element once it has appended some
+ * children to it: the start tag of the element is written (when it hasn't
+ * been yet) followed by the children, which are then freed. Ending an
+ * element writes its end tag and frees it as well, the next sibling can be
+ * started only afterwards. Attributes and namespace declarations have to
+ * be set before the element is flushed for the first time.
+ *
+ * All the functions except xml_stream_new accept a NULL stream and do
+ * nothing then, so the same code can build the whole tree or stream it.
+ */
+struct xml_stream;
+
+/**
+ * Start writing a document.
+ * @param filename the file to write to, "-" stands for the standard output
+ * @returns the stream or NULL on error
+ */
+struct xml_stream *xml_stream_new(const char *filename);
+
+/**
+ * Get the scratch document in which the elements are built.
+ */
+xmlDoc *xml_stream_get_doc(struct xml_stream *stream);
+
+/**
+ * Write the children of the element and free them.
+ */
+void xml_stream_flush(struct xml_stream *stream, xmlNode *node);
+
+/**
+ * Write the rest of the element and free it.
+ */
+void xml_stream_end(struct xml_stream *stream, xmlNode *node);
+
+/**
+ * Finish the document and free the stream.
+ * @returns 0 on success, -1 if anything could not be written
+ */
+int xml_stream_close(struct xml_stream *stream);
+
+OSCAP_HIDDEN_END;
+
+#endif
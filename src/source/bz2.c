@@ -26,88 +26,36 @@
 #endif
 
 #include <libxml/tree.h>
+#include <errno.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
 #include "bz2_priv.h"
+#include "oscap_source_priv.h"
 #include "common/_error.h"
 
 #ifdef HAVE_BZ2
 
 #include <bzlib.h>
+#include <pthread.h>
+#include <sys/stat.h>
 
-struct bz2_file {
-	FILE *f;
-	BZFILE *file;
-	bool eof;
-};
-
-static struct bz2_file *bz2_fd_open(int fd)
-{
-	struct bz2_file *b = NULL;
-	FILE* f;
-	int bzerror;
-
-	f = fdopen (fd, "r" );
-	if (f) {
-		b = malloc(sizeof(struct bz2_file));
-		b->f = f;
-		b->file = BZ2_bzReadOpen(&bzerror, f, 0, 0, NULL, 0);
-		b->eof = false;
-		if (bzerror != BZ_OK) {
-			oscap_seterr(OSCAP_EFAMILY_OSCAP, "Could not build BZ2FILE from %s: %s",
-					BZ2_bzerror(b->file, &bzerror));
-			BZ2_bzReadClose(&bzerror, b->file);
-			free(b);
-			b = NULL;
-		}
-	}
-	return b;
-}
+#include "common/alloc.h"
+#include "common/debug_priv.h"
 
-//xmlInputReadCallback
-static int bz2_file_read(struct bz2_file *bzfile, char *buffer, int len)
-{
-	int bzerror;
-	if (bzfile->eof) {
-		// If we run bzRead on closed file we will get SEQUENCE_ERROR
-		return 0;
-	}
-	int size = BZ2_bzRead(&bzerror, (bzfile)->file, buffer, len);
-	if (bzerror == BZ_STREAM_END) {
-		bzfile->eof = true;
-	}
-	if (bzerror == BZ_OK || bzerror == BZ_STREAM_END)
-		return size;
-	else {
-		oscap_seterr(OSCAP_EFAMILY_OSCAP, "Could not read from bZ2FILE: %s",
-				BZ2_bzerror(bzfile->file, &bzerror));
-		return -1;
-	}
-}
-
-// xmlInputCloseCallback
-static int bz2_file_close(void *bzfile)
-{
-	int bzerror;
-	BZ2_bzReadClose(&bzerror, ((struct bz2_file *)bzfile)->file);
-	fclose(((struct bz2_file *)bzfile)->f);
-	oscap_free(bzfile);
-	return bzerror == BZ_OK ? 0 : -1;
-}
-
-xmlDoc *bz2_fd_read_doc(int fd)
-{
-	struct bz2_file *bzfile = bz2_fd_open(fd);
-	if (bzfile == NULL) {
-		return NULL;
-	}
-	return xmlReadIO((xmlInputReadCallback) bz2_file_read, bz2_file_close, bzfile, "url", NULL, XML_PARSE_PEDANTIC);
-}
+/*
+ * Parallel tools (pbzip2, lbzip2) write a bzip2 stream per chunk of the
+ * input and concatenate them. Such streams are decompressed in parallel,
+ * a few streams ahead of the parser which gets their output in order.
+ * A single stream is decompressed as it is parsed.
+ */
+#define BZ2_PARALLEL_MIN_STREAMS 2
 
 struct bz2_mem {
 	bz_stream *stream;
+	const char *buffer;
+	size_t size;
 	bool eof;
 };
 
@@ -121,6 +69,8 @@ static struct bz2_mem *bz2_mem_open(const char *buffer, size_t size)
 {
 	struct bz2_mem *b = oscap_calloc(sizeof(struct bz2_mem), 1);
 	b->stream = oscap_calloc(sizeof(bz_stream), 1);
+	b->buffer = buffer;
+	b->size = size;
 	// next_in should point at the compressed data
 	b->stream->next_in = (char *) buffer;
 	// and avail_in should indicate how many bytes the library may read
@@ -151,7 +101,19 @@ static int bz2_mem_read(struct bz2_mem *bzmem, char *buffer, int len)
 	bzmem->stream->avail_out = len;
 	int bzerror = BZ2_bzDecompress(bzmem->stream);
 	if (bzerror == BZ_STREAM_END) {
-		bzmem->eof = true;
+		if (bzmem->stream->avail_in > 0) {
+			// another stream follows, continue with it
+			char *next_in = bzmem->stream->next_in;
+			unsigned int avail_in = bzmem->stream->avail_in;
+			BZ2_bzDecompressEnd(bzmem->stream);
+			memset(bzmem->stream, 0, sizeof(bz_stream));
+			bzmem->stream->next_in = next_in;
+			bzmem->stream->avail_in = avail_in;
+			bzerror = BZ2_bzDecompressInit(bzmem->stream, 0, 0);
+		} else {
+			bzmem->eof = true;
+			bzerror = BZ_STREAM_END;
+		}
 	}
 	if (bzerror == BZ_OK || bzerror == BZ_STREAM_END)
 		return (len - bzmem->stream->avail_out);
@@ -171,13 +133,248 @@ static int bz2_mem_close(void *bzmem) {
 	return bzerror == BZ_OK ? 0 : -1;
 }
 
-xmlDoc *bz2_mem_read_doc(const char *buffer, size_t size)
+enum bz2_chunk_state {
+	BZ2_CHUNK_PENDING = 0,
+	BZ2_CHUNK_DONE,
+	BZ2_CHUNK_FAILED
+};
+
+struct bz2_chunk {
+	const char *in;
+	size_t in_size;
+	char *out;
+	size_t out_size;
+	enum bz2_chunk_state state;
+};
+
+struct bz2_par {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct bz2_chunk *chunks;
+	size_t count;
+	size_t next;            ///< next chunk to be decompressed
+	size_t current;         ///< chunk being read by the parser
+	size_t offset;          ///< read position in the current chunk
+	size_t window;          ///< how far the decompression may get ahead of the parser
+	bool stop;
+	pthread_t *threads;
+	int nthreads;
+};
+
+/* offsets of the streams, a stream header is "BZh[1-9]" followed by the magic of a block or of the end */
+static size_t bz2_mem_find_streams(const char *buffer, size_t size, size_t **offsets)
+{
+	static const char block_magic[] = "\x31\x41\x59\x26\x53\x59";
+	static const char end_magic[] = "\x17\x72\x45\x38\x50\x90";
+	size_t count = 0, alloc = 16;
+
+	*offsets = oscap_alloc(alloc * sizeof(size_t));
+	for (size_t i = 0; i + 10 <= size; ++i) {
+		if (buffer[i] != 'B' || buffer[i + 1] != 'Z' || buffer[i + 2] != 'h' ||
+		    buffer[i + 3] < '1' || buffer[i + 3] > '9')
+			continue;
+		if (memcmp(buffer + i + 4, block_magic, 6) != 0 && memcmp(buffer + i + 4, end_magic, 6) != 0)
+			continue;
+		if (count == alloc) {
+			alloc *= 2;
+			*offsets = oscap_realloc(*offsets, alloc * sizeof(size_t));
+		}
+		(*offsets)[count++] = i;
+	}
+	return count;
+}
+
+static bool bz2_chunk_decompress(struct bz2_chunk *chunk)
 {
+	bz_stream stream;
+	size_t alloc = chunk->in_size * 4 + 4096;
+
+	memset(&stream, 0, sizeof(stream));
+	if (BZ2_bzDecompressInit(&stream, 0, 0) != BZ_OK)
+		return false;
+
+	chunk->out = oscap_alloc(alloc);
+	chunk->out_size = 0;
+	stream.next_in = (char *) chunk->in;
+	stream.avail_in = chunk->in_size;
+
+	int bzerror;
+	do {
+		if (chunk->out_size == alloc) {
+			alloc *= 2;
+			chunk->out = oscap_realloc(chunk->out, alloc);
+		}
+		stream.next_out = chunk->out + chunk->out_size;
+		stream.avail_out = alloc - chunk->out_size;
+		bzerror = BZ2_bzDecompress(&stream);
+		chunk->out_size = alloc - stream.avail_out;
+	} while (bzerror == BZ_OK && (stream.avail_in > 0 || stream.avail_out == 0));
+	BZ2_bzDecompressEnd(&stream);
+
+	// a false stream header splits a stream, its parts fail here
+	return bzerror == BZ_STREAM_END && stream.avail_in == 0;
+}
+
+static void *bz2_par_worker(void *arg)
+{
+	struct bz2_par *par = arg;
+
+	pthread_mutex_lock(&par->lock);
+	for (;;) {
+		while (!par->stop && par->next < par->count && par->next >= par->current + par->window)
+			pthread_cond_wait(&par->cond, &par->lock);
+		if (par->stop || par->next >= par->count)
+			break;
+
+		struct bz2_chunk *chunk = &par->chunks[par->next++];
+		pthread_mutex_unlock(&par->lock);
+
+		bool ok = bz2_chunk_decompress(chunk);
+
+		pthread_mutex_lock(&par->lock);
+		chunk->state = ok ? BZ2_CHUNK_DONE : BZ2_CHUNK_FAILED;
+		pthread_cond_broadcast(&par->cond);
+	}
+	pthread_mutex_unlock(&par->lock);
+	return NULL;
+}
+
+// xmlInputReadCallback
+static int bz2_par_read(struct bz2_par *par, char *buffer, int len)
+{
+	int ret = 0;
+
+	pthread_mutex_lock(&par->lock);
+	while (ret < len && par->current < par->count) {
+		struct bz2_chunk *chunk = &par->chunks[par->current];
+
+		while (chunk->state == BZ2_CHUNK_PENDING)
+			pthread_cond_wait(&par->cond, &par->lock);
+		if (chunk->state == BZ2_CHUNK_FAILED) {
+			ret = -1;
+			break;
+		}
+
+		size_t n = chunk->out_size - par->offset;
+		if (n > (size_t) (len - ret))
+			n = len - ret;
+		memcpy(buffer + ret, chunk->out + par->offset, n);
+		ret += n;
+		par->offset += n;
+
+		if (par->offset == chunk->out_size) {
+			oscap_free(chunk->out);
+			chunk->out = NULL;
+			par->offset = 0;
+			par->current++;
+			pthread_cond_broadcast(&par->cond);
+		}
+	}
+	pthread_mutex_unlock(&par->lock);
+	return ret;
+}
+
+// xmlInputCloseCallback
+static int bz2_par_close(void *arg)
+{
+	struct bz2_par *par = arg;
+
+	pthread_mutex_lock(&par->lock);
+	par->stop = true;
+	pthread_cond_broadcast(&par->cond);
+	pthread_mutex_unlock(&par->lock);
+
+	for (int i = 0; i < par->nthreads; ++i)
+		pthread_join(par->threads[i], NULL);
+
+	for (size_t i = 0; i < par->count; ++i)
+		oscap_free(par->chunks[i].out);
+	oscap_free(par->chunks);
+	oscap_free(par->threads);
+	pthread_cond_destroy(&par->cond);
+	pthread_mutex_destroy(&par->lock);
+	oscap_free(par);
+	return 0;
+}
+
+static xmlDoc *bz2_par_read_doc(xmlParserCtxt *ctxt, const char *buffer, size_t size, const size_t *offsets, size_t count, int nthreads)
+{
+	struct bz2_par *par = oscap_calloc(1, sizeof(struct bz2_par));
+
+	pthread_mutex_init(&par->lock, NULL);
+	pthread_cond_init(&par->cond, NULL);
+	par->count = count;
+	par->window = nthreads * 2;
+	par->chunks = oscap_calloc(count, sizeof(struct bz2_chunk));
+	for (size_t i = 0; i < count; ++i) {
+		par->chunks[i].in = buffer + offsets[i];
+		par->chunks[i].in_size = (i + 1 < count ? offsets[i + 1] : size) - offsets[i];
+	}
+
+	par->threads = oscap_calloc(nthreads, sizeof(pthread_t));
+	for (int i = 0; i < nthreads; ++i) {
+		if (pthread_create(&par->threads[par->nthreads], NULL, bz2_par_worker, par) == 0)
+			par->nthreads++;
+	}
+	if (par->nthreads == 0) {
+		bz2_par_close(par);
+		return NULL;
+	}
+
+	return xmlCtxtReadIO(ctxt, (xmlInputReadCallback) bz2_par_read, bz2_par_close, par, "url", NULL, XML_PARSE_PEDANTIC | OSCAP_SOURCE_XML_OPTIONS);
+}
+
+xmlDoc *bz2_mem_read_doc(xmlParserCtxt *ctxt, const char *buffer, size_t size)
+{
+	size_t *offsets;
+	size_t count = bz2_mem_find_streams(buffer, size, &offsets);
+	long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (count >= BZ2_PARALLEL_MIN_STREAMS && ncpus > 1 && offsets[0] == 0) {
+		int nthreads = ncpus < (long) count ? (int) ncpus : (int) count;
+		xmlDoc *doc = bz2_par_read_doc(ctxt, buffer, size, offsets, count, nthreads);
+		if (doc != NULL) {
+			oscap_free(offsets);
+			return doc;
+		}
+		dI("Parallel decompression of bzip2 streams failed, decompressing sequentially.");
+	}
+	oscap_free(offsets);
+
 	struct bz2_mem *bzmem = bz2_mem_open(buffer, size);
 	if (bzmem == NULL) {
 		return NULL;
 	}
-	return xmlReadIO((xmlInputReadCallback) bz2_mem_read, bz2_mem_close, bzmem, "url", NULL, XML_PARSE_PEDANTIC);
+	return xmlCtxtReadIO(ctxt, (xmlInputReadCallback) bz2_mem_read, bz2_mem_close, bzmem, "url", NULL, XML_PARSE_PEDANTIC | OSCAP_SOURCE_XML_OPTIONS);
+}
+
+xmlDoc *bz2_fd_read_doc(xmlParserCtxt *ctxt, int fd)
+{
+	// the compressed file is small, read it at once and share the memory path
+	struct stat st;
+	size_t alloc = (fstat(fd, &st) == 0 && st.st_size > 0) ? (size_t) st.st_size : 65536;
+	size_t size = 0;
+	char *buffer = oscap_alloc(alloc);
+
+	for (;;) {
+		if (size == alloc) {
+			alloc *= 2;
+			buffer = oscap_realloc(buffer, alloc);
+		}
+		ssize_t n = read(fd, buffer + size, alloc - size);
+		if (n < 0) {
+			oscap_seterr(OSCAP_EFAMILY_GLIBC, "Could not read bzip2 file: %s", strerror(errno));
+			oscap_free(buffer);
+			return NULL;
+		}
+		if (n == 0)
+			break;
+		size += n;
+	}
+
+	xmlDoc *doc = bz2_mem_read_doc(ctxt, buffer, size);
+	oscap_free(buffer);
+	return doc;
 }
 
 #endif
@@ -35,18 +35,20 @@ OSCAP_HIDDEN_START;
 
 /**
  * Parse *.xml.bz2 file to XML DOM
+ * @param ctxt The parser context reporting the XML errors
  * @param fd The file descriptor to bz2 file
  * @returns DOM representation of the file
  */
-xmlDoc *bz2_fd_read_doc(int fd);
+xmlDoc *bz2_fd_read_doc(xmlParserCtxt *ctxt, int fd);
 
 /**
  * Parse bzip2ed memory to XML DOM.
+ * @param ctxt The parser context reporting the XML errors
  * @param buffer data in memory to process (contains bzip2ed XML)
  * @param size length of data
  * @returns DOM representation of the data
  */
-xmlDoc *bz2_mem_read_doc(const char *buffer, size_t size);
+xmlDoc *bz2_mem_read_doc(xmlParserCtxt *ctxt, const char *buffer, size_t size);
 
 #endif // HAVE_BZ2
 
@@ -0,0 +1,720 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <libxml/parser.h>
+#include <libxml/tree.h>
+
+#include "common/_error.h"
+#include "common/alloc.h"
+#include "common/debug_priv.h"
+#include "common/list.h"
+#include "common/util.h"
+#include "oscap.h"
+#include "oscap_source.h"
+#include "source/oscap_source_priv.h"
+
+/*
+ * The delta of a result against its baseline. The elements of both documents
+ * are matched by a key built of the local name, the identifying attribute and
+ * the position among the siblings with the same name and identifier:
+ *
+ * <delta:delta baseline="hash" result="hash">
+ *   <delta:node key="root">                 the matched element differs
+ *     <delta:attributes><root a="new"/></delta:attributes>
+ *     <delta:unset name="b" ns="href"/>
+ *     <delta:remove key="child@id1"/>
+ *     <delta:node key="child@id2">...</delta:node>
+ *     <delta:replace key="child@id3"><child id="id3">text</child></delta:replace>
+ *     <delta:insert key="child@id4" after="child@id2"><child id="id4"/></delta:insert>
+ *   </delta:node>
+ * </delta:delta>
+ *
+ * The elements with text are replaced as a whole. The hashes cover the names,
+ * the attributes, the text and the child elements, not the whitespace between
+ * the elements, nor the comments.
+ */
+#define DELTA_XMLNS  "http://open-scap.org/page/Results_delta"
+#define DELTA_PREFIX "delta"
+
+/* the attributes identifying an element among its siblings */
+static const char *_delta_key_attrs[] = {
+	"id", "idref", "definition_id", "test_id", "item_id", "variable_id", "item_ref", "test_ref", NULL
+};
+
+/* FNV-1a */
+static uint64_t _delta_hash_buf(uint64_t h, const void *data, size_t len)
+{
+	const uint8_t *p = (const uint8_t *)data;
+
+	while (len-- > 0) {
+		h ^= *p++;
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
+static uint64_t _delta_hash_str(uint64_t h, const xmlChar *str)
+{
+	if (str != NULL)
+		h = _delta_hash_buf(h, str, strlen((const char *)str));
+	/* the terminator keeps "ab" "c" apart from "a" "bc" */
+	return _delta_hash_buf(h, "", 1);
+}
+
+static bool _delta_is_text(const xmlNode *node)
+{
+	return (node->type == XML_TEXT_NODE || node->type == XML_CDATA_SECTION_NODE) && !xmlIsBlankNode(node);
+}
+
+static size_t _delta_count_elements(const xmlNode *node)
+{
+	size_t count = 1;
+
+	for (const xmlNode *child = node->children; child != NULL; child = child->next)
+		if (child->type == XML_ELEMENT_NODE)
+			count += _delta_count_elements(child);
+	return count;
+}
+
+/*
+ * The hash of an element covers the hashes of its child elements. If `slots'
+ * isn't NULL, the hash of every element is stored in the next slot and the
+ * _private pointer of the element points to it.
+ */
+static uint64_t _delta_hash(xmlNode *node, uint64_t **slots)
+{
+	uint64_t h = 0xcbf29ce484222325ULL, attrs = 0;
+	uint8_t buf[8];
+
+	h = _delta_hash_str(h, node->ns != NULL ? node->ns->href : NULL);
+	h = _delta_hash_str(h, node->name);
+
+	/* the sum doesn't depend on the order of the attributes */
+	for (const xmlAttr *attr = node->properties; attr != NULL; attr = attr->next) {
+		xmlChar *value = xmlNodeGetContent((const xmlNode *)attr);
+		uint64_t ah = 0xcbf29ce484222325ULL;
+
+		ah = _delta_hash_str(ah, attr->ns != NULL ? attr->ns->href : NULL);
+		ah = _delta_hash_str(ah, attr->name);
+		ah = _delta_hash_str(ah, value);
+		attrs += ah;
+		xmlFree(value);
+	}
+	/* byte by byte, the delta may be applied on another architecture */
+	for (int i = 0; i < 8; ++i)
+		buf[i] = (uint8_t)(attrs >> (8 * i));
+	h = _delta_hash_buf(h, "A", 1);
+	h = _delta_hash_buf(h, buf, sizeof buf);
+
+	for (xmlNode *child = node->children; child != NULL; child = child->next) {
+		if (child->type == XML_ELEMENT_NODE) {
+			uint64_t ch = _delta_hash(child, slots);
+
+			for (int i = 0; i < 8; ++i)
+				buf[i] = (uint8_t)(ch >> (8 * i));
+			h = _delta_hash_buf(h, "E", 1);
+			h = _delta_hash_buf(h, buf, sizeof buf);
+		} else if (_delta_is_text(child)) {
+			h = _delta_hash_buf(h, "T", 1);
+			h = _delta_hash_str(h, child->content);
+		}
+	}
+
+	if (slots != NULL) {
+		**slots = h;
+		node->_private = *slots;
+		++(*slots);
+	}
+	return h;
+}
+
+uint64_t oscap_xml_node_hash(xmlNode *node)
+{
+	return _delta_hash(node, NULL);
+}
+
+static char *_delta_hash_root(xmlDoc *doc)
+{
+	return oscap_sprintf("%016" PRIx64, _delta_hash(xmlDocGetRootElement(doc), NULL));
+}
+
+/* the hashes of all the elements, freed by the caller */
+static uint64_t *_delta_hash_all(xmlDoc *doc)
+{
+	xmlNode *root = xmlDocGetRootElement(doc);
+	uint64_t *hashes = oscap_calloc(_delta_count_elements(root), sizeof(uint64_t));
+	uint64_t *slots = hashes;
+
+	_delta_hash(root, &slots);
+	return hashes;
+}
+
+static uint64_t _delta_hash_of(const xmlNode *node)
+{
+	return *(const uint64_t *)node->_private;
+}
+
+/* the key without the position */
+static char *_delta_key_base(const xmlNode *node)
+{
+	xmlChar *value = NULL, *instance;
+	char *key;
+
+	for (int i = 0; _delta_key_attrs[i] != NULL && value == NULL; ++i)
+		value = xmlGetNoNsProp(node, BAD_CAST _delta_key_attrs[i]);
+
+	if (value == NULL)
+		return oscap_strdup((const char *)node->name);
+
+	/* the OVAL results list the definitions, tests and objects once per variable instance */
+	instance = xmlGetNoNsProp(node, BAD_CAST "variable_instance");
+	key = oscap_sprintf("%s@%s%s%s", node->name, value,
+			instance != NULL ? "/" : "", instance != NULL ? (const char *)instance : "");
+	xmlFree(instance);
+	xmlFree(value);
+	return key;
+}
+
+/* the child elements by their keys */
+struct delta_children {
+	size_t count;
+	xmlNode **nodes;
+	char **keys;
+	struct oscap_htable *index;	///< key -> node
+};
+
+static void _delta_children_free(struct delta_children *children)
+{
+	if (children == NULL)
+		return;
+
+	for (size_t i = 0; i < children->count; ++i)
+		oscap_free(children->keys[i]);
+	oscap_free(children->keys);
+	oscap_free(children->nodes);
+	oscap_htable_free(children->index, NULL);
+	oscap_free(children);
+}
+
+/* NULL if two children end up with the same key */
+static struct delta_children *_delta_children_new(xmlNode *parent)
+{
+	struct delta_children *children = oscap_calloc(1, sizeof(struct delta_children));
+	struct oscap_htable *seen = oscap_htable_new();
+	size_t size = 0;
+
+	children->index = oscap_htable_new();
+
+	for (xmlNode *child = parent->children; child != NULL; child = child->next) {
+		char *base, *key;
+		size_t *count;
+
+		if (child->type != XML_ELEMENT_NODE)
+			continue;
+
+		base = _delta_key_base(child);
+		count = oscap_htable_get(seen, base);
+		if (count == NULL) {
+			count = oscap_calloc(1, sizeof(size_t));
+			oscap_htable_add(seen, base, count);
+			key = base;
+		} else {
+			key = oscap_sprintf("%s#%zu", base, *count);
+			oscap_free(base);
+		}
+		++(*count);
+
+		if (children->count == size) {
+			size = size == 0 ? 16 : size * 2;
+			children->nodes = oscap_realloc(children->nodes, size * sizeof(xmlNode *));
+			children->keys = oscap_realloc(children->keys, size * sizeof(char *));
+		}
+		children->nodes[children->count] = child;
+		children->keys[children->count] = key;
+		children->count++;
+
+		if (!oscap_htable_add(children->index, key, child)) {
+			/* an identifier looking like the position of another one */
+			oscap_htable_free(seen, (oscap_destruct_func) oscap_free);
+			_delta_children_free(children);
+			return NULL;
+		}
+	}
+
+	oscap_htable_free(seen, (oscap_destruct_func) oscap_free);
+	return children;
+}
+
+static bool _delta_has_text(const xmlNode *node)
+{
+	for (const xmlNode *child = node->children; child != NULL; child = child->next)
+		if (_delta_is_text(child))
+			return true;
+	return false;
+}
+
+static xmlNode *_delta_op_new(xmlNode *parent, const char *name, const char *key)
+{
+	xmlNode *op = xmlNewChild(parent, parent->ns, BAD_CAST name, NULL);
+
+	if (key != NULL)
+		xmlNewProp(op, BAD_CAST "key", BAD_CAST key);
+	return op;
+}
+
+static void _delta_op_copy(xmlNode *op, xmlNode *node)
+{
+	xmlAddChild(op, xmlDocCopyNode(node, op->doc, 1));
+}
+
+static xmlChar *_delta_get_prop(xmlNode *node, const xmlAttr *attr)
+{
+	return attr->ns != NULL ? xmlGetNsProp(node, attr->name, attr->ns->href) : xmlGetNoNsProp(node, attr->name);
+}
+
+/* the changed and the added attributes, the removed ones */
+static void _delta_diff_attributes(xmlNode *out, xmlNode *base, xmlNode *res)
+{
+	/* the element without its children, then without the attributes which didn't change */
+	xmlNode *copy = xmlDocCopyNode(res, out->doc, 2);
+	xmlAttr *attr, *next;
+
+	for (attr = copy->properties; attr != NULL; attr = next) {
+		xmlChar *value = xmlNodeGetContent((xmlNode *)attr);
+		xmlChar *prev = _delta_get_prop(base, attr);
+
+		next = attr->next;
+		if (prev != NULL && xmlStrEqual(value, prev))
+			xmlRemoveProp(attr);
+		xmlFree(prev);
+		xmlFree(value);
+	}
+
+	if (copy->properties != NULL)
+		xmlAddChild(_delta_op_new(out, "attributes", NULL), copy);
+	else
+		xmlFreeNode(copy);
+
+	for (attr = base->properties; attr != NULL; attr = attr->next) {
+		xmlChar *value = _delta_get_prop(res, attr);
+
+		if (value == NULL) {
+			xmlNode *op = _delta_op_new(out, "unset", NULL);
+
+			xmlNewProp(op, BAD_CAST "name", attr->name);
+			if (attr->ns != NULL)
+				xmlNewProp(op, BAD_CAST "ns", attr->ns->href);
+		}
+		xmlFree(value);
+	}
+}
+
+/* the keys of both lists in the same order, the elements only moved are replaced */
+static bool _delta_same_order(const struct delta_children *base, const struct delta_children *res)
+{
+	size_t b = 0;
+
+	for (size_t r = 0; r < res->count; ++r) {
+		xmlNode *node = oscap_htable_get(base->index, res->keys[r]);
+
+		if (node == NULL)
+			continue;
+		while (b < base->count && base->nodes[b] != node)
+			++b;
+		if (b == base->count)
+			return false;
+	}
+	return true;
+}
+
+/* append the operations turning the baseline element into the result one */
+static void _delta_diff(xmlNode *out, xmlNode *base, xmlNode *res, const char *key)
+{
+	struct delta_children *bc = NULL, *rc = NULL;
+	xmlNode *node;
+	const char *prev = NULL;
+
+	if (_delta_hash_of(base) == _delta_hash_of(res))
+		return;
+
+	if (!xmlStrEqual(base->name, res->name)
+	    || !xmlStrEqual(base->ns != NULL ? base->ns->href : NULL, res->ns != NULL ? res->ns->href : NULL)
+	    || _delta_has_text(base) || _delta_has_text(res)
+	    || (bc = _delta_children_new(base)) == NULL || (rc = _delta_children_new(res)) == NULL
+	    || !_delta_same_order(bc, rc)) {
+		_delta_op_copy(_delta_op_new(out, "replace", key), res);
+		goto cleanup;
+	}
+
+	node = _delta_op_new(out, "node", key);
+	_delta_diff_attributes(node, base, res);
+
+	for (size_t i = 0; i < bc->count; ++i)
+		if (oscap_htable_get(rc->index, bc->keys[i]) == NULL)
+			_delta_op_new(node, "remove", bc->keys[i]);
+
+	for (size_t i = 0; i < rc->count; ++i) {
+		xmlNode *match = oscap_htable_get(bc->index, rc->keys[i]);
+
+		if (match != NULL) {
+			_delta_diff(node, match, rc->nodes[i], rc->keys[i]);
+		} else {
+			xmlNode *op = _delta_op_new(node, "insert", rc->keys[i]);
+
+			if (prev != NULL)
+				xmlNewProp(op, BAD_CAST "after", BAD_CAST prev);
+			_delta_op_copy(op, rc->nodes[i]);
+		}
+		prev = rc->keys[i];
+	}
+
+	/* e.g. only the whitespace of the text differs */
+	if (node->children == NULL) {
+		xmlUnlinkNode(node);
+		xmlFreeNode(node);
+	}
+
+cleanup:
+	_delta_children_free(bc);
+	_delta_children_free(rc);
+}
+
+/* the document without the blank text between the elements */
+static xmlDoc *_delta_read(struct oscap_source *source)
+{
+	char *buffer = NULL;
+	size_t size = 0;
+	xmlDoc *doc;
+
+	if (oscap_source_get_raw_memory(source, &buffer, &size) != 0)
+		return NULL;
+
+	doc = xmlReadMemory(buffer, size, oscap_source_readable_origin(source), NULL,
+			    XML_PARSE_NOBLANKS | XML_PARSE_HUGE | XML_PARSE_NONET);
+	free(buffer);
+
+	if (doc == NULL || xmlDocGetRootElement(doc) == NULL) {
+		oscap_seterr(OSCAP_EFAMILY_OSCAP, "Could not parse '%s'.", oscap_source_readable_origin(source));
+		xmlFreeDoc(doc);
+		return NULL;
+	}
+	return doc;
+}
+
+struct oscap_source *oscap_source_new_delta(struct oscap_source *baseline, struct oscap_source *result, const char *filepath)
+{
+	xmlDoc *bdoc = NULL, *rdoc, *delta;
+	uint64_t *bhashes = NULL, *rhashes;
+	xmlNode *root, *broot, *rroot;
+	char *hash, *bkey = NULL, *rkey;
+
+	if ((rdoc = _delta_read(result)) == NULL)
+		return NULL;
+	if (baseline != NULL && (bdoc = _delta_read(baseline)) == NULL) {
+		xmlFreeDoc(rdoc);
+		return NULL;
+	}
+
+	delta = xmlNewDoc(BAD_CAST "1.0");
+	root = xmlNewNode(NULL, BAD_CAST "delta");
+	xmlSetNs(root, xmlNewNs(root, BAD_CAST DELTA_XMLNS, BAD_CAST DELTA_PREFIX));
+	xmlDocSetRootElement(delta, root);
+
+	rroot = xmlDocGetRootElement(rdoc);
+	rhashes = _delta_hash_all(rdoc);
+	hash = oscap_sprintf("%016" PRIx64, _delta_hash_of(rroot));
+	xmlNewProp(root, BAD_CAST "result", BAD_CAST hash);
+	oscap_free(hash);
+	rkey = _delta_key_base(rroot);
+
+	if (bdoc != NULL) {
+		broot = xmlDocGetRootElement(bdoc);
+		bhashes = _delta_hash_all(bdoc);
+		hash = oscap_sprintf("%016" PRIx64, _delta_hash_of(broot));
+		xmlNewProp(root, BAD_CAST "baseline", BAD_CAST hash);
+		oscap_free(hash);
+		bkey = _delta_key_base(broot);
+	}
+
+	/* without a baseline, the delta carries the whole result */
+	if (bkey != NULL && strcmp(bkey, rkey) == 0)
+		_delta_diff(root, broot, rroot, rkey);
+	else
+		_delta_op_copy(_delta_op_new(root, "replace", NULL), rroot);
+
+	oscap_free(bkey);
+	oscap_free(rkey);
+	oscap_free(bhashes);
+	oscap_free(rhashes);
+	xmlFreeDoc(bdoc);
+	xmlFreeDoc(rdoc);
+
+	return oscap_source_new_from_xmlDoc(delta, filepath);
+}
+
+static bool _delta_is_op(const xmlNode *node, const char *name)
+{
+	return node->type == XML_ELEMENT_NODE && xmlStrEqual(node->name, BAD_CAST name)
+		&& node->ns != NULL && xmlStrEqual(node->ns->href, BAD_CAST DELTA_XMLNS);
+}
+
+static xmlNode *_delta_op_content(const xmlNode *op)
+{
+	for (xmlNode *child = op->children; child != NULL; child = child->next)
+		if (child->type == XML_ELEMENT_NODE)
+			return child;
+	return NULL;
+}
+
+static void _delta_apply_attributes(xmlNode *target, const xmlNode *copy)
+{
+	for (xmlAttr *attr = copy->properties; attr != NULL; attr = attr->next) {
+		xmlChar *value = xmlNodeGetContent((xmlNode *)attr);
+		xmlNs *ns = NULL;
+
+		if (attr->ns != NULL) {
+			ns = xmlSearchNsByHref(target->doc, target, attr->ns->href);
+			if (ns == NULL)
+				ns = xmlNewNs(target, attr->ns->href, attr->ns->prefix);
+		}
+		xmlSetNsProp(target, ns, attr->name, value);
+		xmlFree(value);
+	}
+}
+
+static void _delta_apply_unset(xmlNode *target, xmlNode *op)
+{
+	xmlChar *name = xmlGetNoNsProp(op, BAD_CAST "name");
+	xmlChar *href = xmlGetNoNsProp(op, BAD_CAST "ns");
+	xmlAttr *attr = name != NULL ? xmlHasNsProp(target, name, href) : NULL;
+
+	if (attr != NULL)
+		xmlRemoveProp(attr);
+	xmlFree(href);
+	xmlFree(name);
+}
+
+static xmlNode *_delta_apply_copy(xmlNode *target, xmlNode *op)
+{
+	xmlNode *content = _delta_op_content(op);
+
+	return content != NULL ? xmlDocCopyNode(content, target->doc, 1) : NULL;
+}
+
+/* apply the operations of the delta element `ops' to the matching element `target' */
+static int _delta_apply(xmlNode *ops, xmlNode *target)
+{
+	struct delta_children *children = _delta_children_new(target);
+	int ret = 0;
+
+	if (children == NULL) {
+		oscap_seterr(OSCAP_EFAMILY_OSCAP, "The children of element '%s' can't be told apart.", target->name);
+		return -1;
+	}
+
+	for (xmlNode *op = ops->children; op != NULL && ret == 0; op = op->next) {
+		xmlChar *key = NULL, *after = NULL;
+		xmlNode *node = NULL, *copy;
+
+		if (op->type != XML_ELEMENT_NODE)
+			continue;
+
+		if (_delta_is_op(op, "attributes")) {
+			if (_delta_op_content(op) != NULL)
+				_delta_apply_attributes(target, _delta_op_content(op));
+			continue;
+		}
+		if (_delta_is_op(op, "unset")) {
+			_delta_apply_unset(target, op);
+			continue;
+		}
+
+		key = xmlGetNoNsProp(op, BAD_CAST "key");
+		if (key != NULL)
+			node = oscap_htable_get(children->index, (const char *)key);
+
+		if (_delta_is_op(op, "insert")) {
+			after = xmlGetNoNsProp(op, BAD_CAST "after");
+			copy = _delta_apply_copy(target, op);
+
+			if (copy == NULL || key == NULL || node != NULL) {
+				ret = -1;
+			} else if (after != NULL) {
+				xmlNode *prev = oscap_htable_get(children->index, (const char *)after);
+
+				if (prev == NULL)
+					ret = -1;
+				else
+					xmlAddNextSibling(prev, copy);
+			} else {
+				xmlNode *first = target->children;
+
+				while (first != NULL && first->type != XML_ELEMENT_NODE)
+					first = first->next;
+				if (first != NULL)
+					xmlAddPrevSibling(first, copy);
+				else
+					xmlAddChild(target, copy);
+			}
+
+			if (ret == 0)
+				oscap_htable_add(children->index, (const char *)key, copy);
+			else
+				xmlFreeNode(copy);
+		} else if (node == NULL) {
+			ret = -1;
+		} else if (_delta_is_op(op, "node")) {
+			ret = _delta_apply(op, node);
+		} else if (_delta_is_op(op, "replace")) {
+			copy = _delta_apply_copy(target, op);
+
+			if (copy == NULL) {
+				ret = -1;
+			} else {
+				xmlReplaceNode(node, copy);
+				xmlFreeNode(node);
+				oscap_htable_detach(children->index, (const char *)key);
+				oscap_htable_add(children->index, (const char *)key, copy);
+			}
+		} else if (_delta_is_op(op, "remove")) {
+			xmlUnlinkNode(node);
+			xmlFreeNode(node);
+			oscap_htable_detach(children->index, (const char *)key);
+		} else {
+			ret = -1;
+		}
+
+		if (ret != 0 && !oscap_err())
+			oscap_seterr(OSCAP_EFAMILY_OSCAP, "Could not apply the '%s' operation of element '%s' to element '%s'.",
+					op->name, key != NULL ? (const char *)key : "", target->name);
+		xmlFree(after);
+		xmlFree(key);
+	}
+
+	_delta_children_free(children);
+	return ret;
+}
+
+struct oscap_source *oscap_source_new_from_delta(struct oscap_source *baseline, struct oscap_source *delta, const char *filepath)
+{
+	xmlDoc *ddoc, *doc = NULL;
+	xmlNode *droot, *root;
+	xmlChar *expected = NULL;
+	char *hash = NULL;
+	int ret = -1;
+
+	if ((ddoc = _delta_read(delta)) == NULL)
+		return NULL;
+
+	droot = xmlDocGetRootElement(ddoc);
+	if (!_delta_is_op(droot, "delta")) {
+		oscap_seterr(OSCAP_EFAMILY_OSCAP, "'%s' is not a delta of results.", oscap_source_readable_origin(delta));
+		goto cleanup;
+	}
+
+	expected = xmlGetNoNsProp(droot, BAD_CAST "baseline");
+	if (expected != NULL) {
+		if (baseline == NULL) {
+			oscap_seterr(OSCAP_EFAMILY_OSCAP, "The delta '%s' needs its baseline.", oscap_source_readable_origin(delta));
+			goto cleanup;
+		}
+		if ((doc = _delta_read(baseline)) == NULL)
+			goto cleanup;
+
+		hash = _delta_hash_root(doc);
+		if (strcmp(hash, (const char *)expected) != 0) {
+			oscap_seterr(OSCAP_EFAMILY_OSCAP, "The delta '%s' wasn't made against the baseline '%s'.",
+					oscap_source_readable_origin(delta), oscap_source_readable_origin(baseline));
+			goto cleanup;
+		}
+		oscap_free(hash);
+		hash = NULL;
+	} else {
+		doc = xmlNewDoc(BAD_CAST "1.0");
+	}
+
+	for (xmlNode *op = droot->children; op != NULL; op = op->next) {
+		if (op->type != XML_ELEMENT_NODE)
+			continue;
+
+		root = xmlDocGetRootElement(doc);
+		if (_delta_is_op(op, "replace") && _delta_op_content(op) != NULL) {
+			xmlNode *copy = xmlDocCopyNode(_delta_op_content(op), doc, 1);
+
+			xmlDocSetRootElement(doc, copy);
+			xmlFreeNode(root);
+		} else if (_delta_is_op(op, "node") && root != NULL) {
+			if (_delta_apply(op, root) != 0)
+				goto cleanup;
+		} else {
+			oscap_seterr(OSCAP_EFAMILY_OSCAP, "Could not apply the '%s' operation of the delta '%s'.",
+					op->name, oscap_source_readable_origin(delta));
+			goto cleanup;
+		}
+	}
+
+	xmlFree(expected);
+	expected = xmlGetNoNsProp(droot, BAD_CAST "result");
+	if (xmlDocGetRootElement(doc) == NULL || expected == NULL
+	    || strcmp(hash = _delta_hash_root(doc), (const char *)expected) != 0) {
+		oscap_seterr(OSCAP_EFAMILY_OSCAP, "The result rebuilt from the delta '%s' doesn't match its hash.",
+				oscap_source_readable_origin(delta));
+		goto cleanup;
+	}
+	ret = 0;
+
+cleanup:
+	oscap_free(hash);
+	xmlFree(expected);
+	xmlFreeDoc(ddoc);
+	if (ret != 0) {
+		xmlFreeDoc(doc);
+		return NULL;
+	}
+	return oscap_source_new_from_xmlDoc(doc, filepath);
+}
+
+int oscap_source_save_delta_as(struct oscap_source *result, const char *baseline_file, const char *filename)
+{
+	struct oscap_source *baseline = NULL, *delta;
+	int ret;
+
+	if (access(baseline_file, F_OK) == 0)
+		baseline = oscap_source_new_from_file(baseline_file);
+	else
+		dI("The baseline '%s' doesn't exist, the delta carries the whole result.", baseline_file);
+
+	delta = oscap_source_new_delta(baseline, result, filename);
+	ret = delta != NULL ? oscap_source_save_as(delta, NULL) : -1;
+
+	oscap_source_free(delta);
+	oscap_source_free(baseline);
+	return ret == 0 ? 0 : -1;
+}
@@ -0,0 +1,631 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <libxml/hash.h>
+#include <libxml/tree.h>
+#include <libxml/xmlversion.h>
+
+#include "common/debug_priv.h"
+#include "common/oscap_buffer.h"
+#include "common/util.h"
+#include "doc_cache_priv.h"
+
+#define OSCAP_DOC_CACHE_MAGIC   "OSCAPXD"
+#define OSCAP_DOC_CACHE_VERSION 1
+
+/* strings shorter than this are stored once */
+#define OSCAP_DOC_CACHE_SHARED_STRLEN 64
+
+/*
+ * The file holds the header, the nodes in document order as 32-bit words
+ * and the strings. The first word of a node is its type and line number,
+ * strings are referred to by their offset, 0 stands for NULL.
+ *
+ * element: name, ns prefix, ns href, n, n * (prefix, href) of the
+ *          namespace declarations, n, n * (name, ns prefix, ns href, value)
+ *          of the attributes, the children, END
+ * text, CDATA, comment: content
+ * PI: name, content
+ *
+ * The children of the document end with END as well.
+ */
+struct oscap_doc_cache_hdr {
+	char     magic[8];
+	uint32_t version;
+	uint32_t xml_version;
+	uint64_t source_size;
+	uint64_t source_hash;
+	uint32_t words;
+	uint32_t strings_size;
+	uint32_t doc_version;
+	uint32_t doc_encoding;
+	int32_t  doc_standalone;
+	uint32_t pad;
+};
+
+enum {
+	DOC_CACHE_END = 0,
+	DOC_CACHE_ELEMENT,
+	DOC_CACHE_TEXT,
+	DOC_CACHE_CDATA,
+	DOC_CACHE_COMMENT,
+	DOC_CACHE_PI
+};
+
+/* FNV-1a */
+static uint64_t oscap_doc_cache_hash(const char *data, size_t len)
+{
+	const uint8_t *p = (const uint8_t *)data;
+	uint64_t h = 0xcbf29ce484222325ULL;
+
+	while (len-- > 0) {
+		h ^= *p++;
+		h *= 0x100000001b3ULL;
+	}
+
+	return (h);
+}
+
+static bool oscap_doc_cache_private(const struct stat *st)
+{
+	return (st->st_uid == geteuid() && (st->st_mode & 077) == 0);
+}
+
+static const char *oscap_doc_cache_dir(void)
+{
+	const char *dir;
+	struct stat st;
+
+	dir = getenv(OSCAP_DOC_CACHE_ENV);
+
+	if (dir == NULL || *dir == '\0')
+		return (NULL);
+
+	if (stat(dir, &st) != 0 || !S_ISDIR(st.st_mode) || !oscap_doc_cache_private(&st)) {
+		dW("Not using the document cache '%s': it must be a directory "
+		   "owned by the user and not accessible by others.", dir);
+		return (NULL);
+	}
+
+	return (dir);
+}
+
+bool oscap_doc_cache_enabled(void)
+{
+	const char *dir = getenv(OSCAP_DOC_CACHE_ENV);
+	return (dir != NULL && *dir != '\0');
+}
+
+static char *oscap_doc_cache_path(const char *dir, uint64_t hash, size_t size)
+{
+	return (oscap_sprintf("%s/%016llx-%llx", dir,
+			      (unsigned long long)hash, (unsigned long long)size));
+}
+
+/*
+ * Reading
+ */
+
+struct oscap_doc_cache_reader {
+	const uint32_t *words;
+	uint32_t count;
+	uint32_t next;
+	const char *strings;
+	uint32_t strings_size;
+	bool error;
+};
+
+static uint32_t oscap_doc_cache_word(struct oscap_doc_cache_reader *r)
+{
+	if (r->next >= r->count) {
+		r->error = true;
+		return (DOC_CACHE_END);
+	}
+
+	return (r->words[r->next++]);
+}
+
+/* the string table ends with a NUL, so any offset in it is a string */
+static const xmlChar *oscap_doc_cache_string(struct oscap_doc_cache_reader *r)
+{
+	uint32_t off = oscap_doc_cache_word(r);
+
+	if (off == 0)
+		return (NULL);
+
+	if (off >= r->strings_size) {
+		r->error = true;
+		return (NULL);
+	}
+
+	return (BAD_CAST (r->strings + off));
+}
+
+static void oscap_doc_cache_link(xmlNode *parent, xmlNode *node)
+{
+	node->parent = parent;
+
+	if (parent->last != NULL) {
+		parent->last->next = node;
+		node->prev = parent->last;
+	} else {
+		parent->children = node;
+	}
+
+	parent->last = node;
+}
+
+/* the namespace the parser bound the prefix to */
+static xmlNs *oscap_doc_cache_ns(xmlDoc *doc, xmlNode *node, const xmlChar *prefix, const xmlChar *href)
+{
+	xmlNs *ns;
+
+	if (href == NULL)
+		return (NULL);
+
+	ns = xmlSearchNs(doc, node, prefix);
+
+	return ((ns != NULL && xmlStrEqual(ns->href, href)) ? ns : NULL);
+}
+
+static int oscap_doc_cache_read_element(struct oscap_doc_cache_reader *r, xmlDoc *doc, xmlNode *parent, xmlNode **element)
+{
+	const xmlChar *name, *prefix, *href, *value;
+	xmlNode *node;
+	uint32_t i, n;
+
+	name   = oscap_doc_cache_string(r);
+	prefix = oscap_doc_cache_string(r);
+	href   = oscap_doc_cache_string(r);
+
+	if (r->error || name == NULL)
+		return (-1);
+
+	node = xmlNewDocNode(doc, NULL, name, NULL);
+	if (node == NULL)
+		return (-1);
+	oscap_doc_cache_link(parent, node);
+
+	n = oscap_doc_cache_word(r);
+	for (i = 0; i < n && !r->error; ++i) {
+		const xmlChar *ns_prefix = oscap_doc_cache_string(r);
+		const xmlChar *ns_href   = oscap_doc_cache_string(r);
+
+		if (r->error || xmlNewNs(node, ns_href, ns_prefix) == NULL)
+			return (-1);
+	}
+
+	if (href != NULL && (node->ns = oscap_doc_cache_ns(doc, node, prefix, href)) == NULL)
+		return (-1);
+
+	n = oscap_doc_cache_word(r);
+	for (i = 0; i < n && !r->error; ++i) {
+		xmlNs *ns = NULL;
+
+		name   = oscap_doc_cache_string(r);
+		prefix = oscap_doc_cache_string(r);
+		href   = oscap_doc_cache_string(r);
+		value  = oscap_doc_cache_string(r);
+
+		if (r->error || name == NULL)
+			return (-1);
+		if (href != NULL && (ns = oscap_doc_cache_ns(doc, node, prefix, href)) == NULL)
+			return (-1);
+		if (xmlNewNsProp(node, ns, name, value) == NULL)
+			return (-1);
+	}
+
+	*element = node;
+
+	return (r->error ? -1 : 0);
+}
+
+static xmlDoc *oscap_doc_cache_read(const struct oscap_doc_cache_hdr *hdr, const void *map)
+{
+	struct oscap_doc_cache_reader r;
+	xmlNode *parent, *node;
+	xmlDoc *doc;
+
+	r.words = (const uint32_t *)((const uint8_t *)map + sizeof *hdr);
+	r.count = hdr->words;
+	r.next  = 0;
+	r.strings = (const char *)(r.words + hdr->words);
+	r.strings_size = hdr->strings_size;
+	r.error = false;
+
+	if (hdr->strings_size == 0 || r.strings[hdr->strings_size - 1] != '\0'
+	    || hdr->doc_version >= hdr->strings_size || hdr->doc_encoding >= hdr->strings_size)
+		return (NULL);
+
+	doc = xmlNewDoc(hdr->doc_version != 0 ? BAD_CAST (r.strings + hdr->doc_version) : NULL);
+	if (doc == NULL)
+		return (NULL);
+
+	doc->dict = xmlDictCreate();
+	if (hdr->doc_encoding != 0)
+		doc->encoding = xmlStrdup(BAD_CAST (r.strings + hdr->doc_encoding));
+	doc->standalone = hdr->doc_standalone;
+	doc->properties = XML_DOC_WELLFORMED | XML_DOC_NSVALID;
+
+	parent = (xmlNode *)doc;
+
+	while (!r.error) {
+		uint32_t word = oscap_doc_cache_word(&r);
+		const xmlChar *name, *content;
+
+		node = NULL;
+
+		switch (word & 0xff) {
+		case DOC_CACHE_END:
+			if (parent == (xmlNode *)doc) {
+				if (r.next != r.count)
+					r.error = true;
+				goto done;
+			}
+			parent = parent->parent;
+			continue;
+		case DOC_CACHE_ELEMENT:
+			if (oscap_doc_cache_read_element(&r, doc, parent, &node) != 0) {
+				r.error = true;
+				continue;
+			}
+			node->line = (unsigned short)(word >> 16);
+			if (parent == (xmlNode *)doc && doc->children == node)
+				xmlDocSetRootElement(doc, node);
+			parent = node;
+			continue;
+		case DOC_CACHE_TEXT:
+			content = oscap_doc_cache_string(&r);
+			node = xmlNewDocText(doc, content);
+			break;
+		case DOC_CACHE_CDATA:
+			content = oscap_doc_cache_string(&r);
+			node = xmlNewCDataBlock(doc, content, content != NULL ? xmlStrlen(content) : 0);
+			break;
+		case DOC_CACHE_COMMENT:
+			content = oscap_doc_cache_string(&r);
+			node = xmlNewDocComment(doc, content);
+			break;
+		case DOC_CACHE_PI:
+			name = oscap_doc_cache_string(&r);
+			content = oscap_doc_cache_string(&r);
+			node = name != NULL ? xmlNewDocPI(doc, name, content) : NULL;
+			break;
+		default:
+			r.error = true;
+			continue;
+		}
+
+		if (node == NULL) {
+			r.error = true;
+			continue;
+		}
+
+		node->line = (unsigned short)(word >> 16);
+		oscap_doc_cache_link(parent, node);
+	}
+
+done:
+	if (r.error || xmlDocGetRootElement(doc) == NULL) {
+		xmlFreeDoc(doc);
+		return (NULL);
+	}
+
+	return (doc);
+}
+
+xmlDoc *oscap_doc_cache_get(const char *buffer, size_t size)
+{
+	const struct oscap_doc_cache_hdr *hdr;
+	const char *dir;
+	char *path;
+	struct stat st;
+	uint64_t hash;
+	xmlDoc *doc = NULL;
+	void *map;
+	int fd;
+
+	if ((dir = oscap_doc_cache_dir()) == NULL)
+		return (NULL);
+
+	hash = oscap_doc_cache_hash(buffer, size);
+
+	if ((path = oscap_doc_cache_path(dir, hash, size)) == NULL)
+		return (NULL);
+
+	fd = open(path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+	if (fd < 0) {
+		free(path);
+		return (NULL);
+	}
+
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || !oscap_doc_cache_private(&st)
+	    || (size_t)st.st_size < sizeof *hdr) {
+		close(fd);
+		free(path);
+		return (NULL);
+	}
+
+	map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (map == MAP_FAILED) {
+		free(path);
+		return (NULL);
+	}
+
+	hdr = (const struct oscap_doc_cache_hdr *)map;
+
+	if (memcmp(hdr->magic, OSCAP_DOC_CACHE_MAGIC, sizeof hdr->magic) == 0
+	    && hdr->version == OSCAP_DOC_CACHE_VERSION
+	    && hdr->xml_version == LIBXML_VERSION
+	    && hdr->source_size == size && hdr->source_hash == hash
+	    && (uint64_t)st.st_size == sizeof *hdr + (uint64_t)hdr->words * sizeof(uint32_t) + hdr->strings_size) {
+		doc = oscap_doc_cache_read(hdr, map);
+	}
+
+	munmap(map, (size_t)st.st_size);
+
+	if (doc != NULL)
+		dI("Loaded the parsed document from the cache '%s'.", path);
+	else
+		dW("Ignoring the invalid document cache entry '%s'.", path);
+
+	free(path);
+
+	return (doc);
+}
+
+/*
+ * Writing
+ */
+
+struct oscap_doc_cache_writer {
+	struct oscap_buffer *words;
+	struct oscap_buffer *strings;
+	xmlHashTable *shared;
+	bool error;
+};
+
+static void oscap_doc_cache_put_word(struct oscap_doc_cache_writer *w, uint32_t word)
+{
+	oscap_buffer_append_binary_data(w->words, (const char *)&word, sizeof word);
+}
+
+static void oscap_doc_cache_put_string(struct oscap_doc_cache_writer *w, const xmlChar *str)
+{
+	size_t off, len;
+	void *shared;
+
+	if (str == NULL) {
+		oscap_doc_cache_put_word(w, 0);
+		return;
+	}
+
+	len = (size_t)xmlStrlen(str);
+
+	if (len < OSCAP_DOC_CACHE_SHARED_STRLEN) {
+		shared = xmlHashLookup(w->shared, str);
+		if (shared != NULL) {
+			oscap_doc_cache_put_word(w, (uint32_t)(uintptr_t)shared);
+			return;
+		}
+	}
+
+	off = oscap_buffer_get_length(w->strings);
+	if (off + len + 1 > UINT32_MAX) {
+		w->error = true;
+		return;
+	}
+
+	oscap_buffer_append_binary_data(w->strings, (const char *)str, len + 1);
+	oscap_doc_cache_put_word(w, (uint32_t)off);
+
+	if (len < OSCAP_DOC_CACHE_SHARED_STRLEN)
+		xmlHashAddEntry(w->shared, str, (void *)(uintptr_t)off);
+}
+
+static void oscap_doc_cache_write_nodes(struct oscap_doc_cache_writer *w, xmlNode *node)
+{
+	for (; node != NULL && !w->error; node = node->next) {
+		uint32_t line = (uint32_t)node->line << 16;
+
+		switch (node->type) {
+		case XML_ELEMENT_NODE: {
+			uint32_t n;
+			xmlNs *ns;
+			xmlAttr *attr;
+
+			oscap_doc_cache_put_word(w, DOC_CACHE_ELEMENT | line);
+			oscap_doc_cache_put_string(w, node->name);
+			oscap_doc_cache_put_string(w, node->ns != NULL ? node->ns->prefix : NULL);
+			oscap_doc_cache_put_string(w, node->ns != NULL ? node->ns->href : NULL);
+
+			for (n = 0, ns = node->nsDef; ns != NULL; ns = ns->next, ++n);
+			oscap_doc_cache_put_word(w, n);
+			for (ns = node->nsDef; ns != NULL; ns = ns->next) {
+				oscap_doc_cache_put_string(w, ns->prefix);
+				oscap_doc_cache_put_string(w, ns->href);
+			}
+
+			for (n = 0, attr = node->properties; attr != NULL; attr = attr->next, ++n);
+			oscap_doc_cache_put_word(w, n);
+			for (attr = node->properties; attr != NULL; attr = attr->next) {
+				xmlNode *value = attr->children;
+
+				/* without a DTD, the value is a single text node */
+				if (value != NULL && (value->type != XML_TEXT_NODE || value->next != NULL)) {
+					w->error = true;
+					return;
+				}
+
+				oscap_doc_cache_put_string(w, attr->name);
+				oscap_doc_cache_put_string(w, attr->ns != NULL ? attr->ns->prefix : NULL);
+				oscap_doc_cache_put_string(w, attr->ns != NULL ? attr->ns->href : NULL);
+				oscap_doc_cache_put_string(w, value != NULL ? value->content : BAD_CAST "");
+			}
+
+			oscap_doc_cache_write_nodes(w, node->children);
+			oscap_doc_cache_put_word(w, DOC_CACHE_END);
+			break;
+		}
+		case XML_TEXT_NODE:
+			oscap_doc_cache_put_word(w, DOC_CACHE_TEXT | line);
+			oscap_doc_cache_put_string(w, node->content);
+			break;
+		case XML_CDATA_SECTION_NODE:
+			oscap_doc_cache_put_word(w, DOC_CACHE_CDATA | line);
+			oscap_doc_cache_put_string(w, node->content);
+			break;
+		case XML_COMMENT_NODE:
+			oscap_doc_cache_put_word(w, DOC_CACHE_COMMENT | line);
+			oscap_doc_cache_put_string(w, node->content);
+			break;
+		case XML_PI_NODE:
+			oscap_doc_cache_put_word(w, DOC_CACHE_PI | line);
+			oscap_doc_cache_put_string(w, node->name);
+			oscap_doc_cache_put_string(w, node->content);
+			break;
+		default:
+			/* entity references, DTDs, ... */
+			w->error = true;
+			return;
+		}
+	}
+}
+
+static int oscap_doc_cache_write_all(int fd, const void *data, size_t len)
+{
+	const uint8_t *p = (const uint8_t *)data;
+
+	while (len > 0) {
+		ssize_t ret = write(fd, p, len);
+
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return (-1);
+		}
+
+		p   += ret;
+		len -= (size_t)ret;
+	}
+
+	return (0);
+}
+
+void oscap_doc_cache_put(const char *buffer, size_t size, xmlDoc *doc)
+{
+	struct oscap_doc_cache_writer w;
+	struct oscap_doc_cache_hdr hdr;
+	const char *dir;
+	char *path, *tmp;
+	size_t words_len, strings_len;
+	int fd;
+
+	if (doc->intSubset != NULL || doc->extSubset != NULL)
+		return;
+
+	if ((dir = oscap_doc_cache_dir()) == NULL)
+		return;
+
+	w.words   = oscap_buffer_new();
+	w.strings = oscap_buffer_new();
+	w.shared  = xmlHashCreate(1024);
+	w.error   = false;
+
+	/* offset 0 stands for NULL */
+	oscap_buffer_append_binary_data(w.strings, "", 1);
+
+	memset(&hdr, 0, sizeof hdr);
+	memcpy(hdr.magic, OSCAP_DOC_CACHE_MAGIC, sizeof hdr.magic);
+	hdr.version     = OSCAP_DOC_CACHE_VERSION;
+	hdr.xml_version = LIBXML_VERSION;
+	hdr.source_size = size;
+	hdr.source_hash = oscap_doc_cache_hash(buffer, size);
+	hdr.doc_standalone = doc->standalone;
+
+	oscap_doc_cache_write_nodes(&w, doc->children);
+	oscap_doc_cache_put_word(&w, DOC_CACHE_END);
+
+	/* the header refers to these as well */
+	if (doc->version != NULL) {
+		hdr.doc_version = (uint32_t)oscap_buffer_get_length(w.strings);
+		oscap_buffer_append_binary_data(w.strings, (const char *)doc->version, xmlStrlen(doc->version) + 1);
+	}
+	if (doc->encoding != NULL) {
+		hdr.doc_encoding = (uint32_t)oscap_buffer_get_length(w.strings);
+		oscap_buffer_append_binary_data(w.strings, (const char *)doc->encoding, xmlStrlen(doc->encoding) + 1);
+	}
+
+	words_len   = oscap_buffer_get_length(w.words);
+	strings_len = oscap_buffer_get_length(w.strings);
+
+	if (w.error || words_len / sizeof(uint32_t) > UINT32_MAX || strings_len > UINT32_MAX)
+		goto cleanup;
+
+	hdr.words        = (uint32_t)(words_len / sizeof(uint32_t));
+	hdr.strings_size = (uint32_t)strings_len;
+
+	path = oscap_doc_cache_path(dir, hdr.source_hash, size);
+	if (path == NULL)
+		goto cleanup;
+
+	if ((tmp = oscap_sprintf("%s/.tmp-XXXXXX", dir)) == NULL) {
+		free(path);
+		goto cleanup;
+	}
+
+	/* write a private file and rename it, readers never see a partial entry */
+	fd = mkstemp(tmp);
+	if (fd >= 0) {
+		if (oscap_doc_cache_write_all(fd, &hdr, sizeof hdr) == 0
+		    && oscap_doc_cache_write_all(fd, oscap_buffer_get_raw(w.words), words_len) == 0
+		    && oscap_doc_cache_write_all(fd, oscap_buffer_get_raw(w.strings), strings_len) == 0
+		    && close(fd) == 0 && rename(tmp, path) == 0) {
+			dI("Stored the parsed document in the cache '%s'.", path);
+		} else {
+			dW("Can't write the document cache entry '%s': %s.", path, strerror(errno));
+			close(fd);
+			unlink(tmp);
+		}
+	}
+
+	free(tmp);
+	free(path);
+cleanup:
+	xmlHashFree(w.shared, NULL);
+	oscap_buffer_free(w.words);
+	oscap_buffer_free(w.strings);
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef OSCAP_SOURCE_DOC_CACHE_H
+#define OSCAP_SOURCE_DOC_CACHE_H
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <libxml/tree.h>
+
+#include "common/util.h"
+
+OSCAP_HIDDEN_START;
+
+/*
+ * Cache of parsed documents
+ *
+ * If the OSCAP_DOC_CACHE environment variable names a directory, the trees
+ * of the parsed XML documents are stored there in a binary form, one file
+ * per document, named after the hash of the document's content. Reading
+ * the same content again (the same data stream evaluated on many hosts
+ * from a shared copy of the cache, or on one host every day) rebuilds the
+ * tree from the mapped file instead of parsing the XML: names are interned
+ * once per distinct string and the text is copied without being decoded
+ * or checked again. All the models (data streams, XCCDF, OVAL, CPE) are
+ * built from these trees, so they all benefit.
+ *
+ * An entry is used only if the size and the hash of the content, the
+ * format version and the libxml2 version match. Documents with a DTD are
+ * not cached. The directory must be owned by the user and not accessible
+ * by others, otherwise the cache is not used.
+ */
+#define OSCAP_DOC_CACHE_ENV "OSCAP_DOC_CACHE"
+
+/**
+ * Check whether the cache is enabled.
+ */
+bool oscap_doc_cache_enabled(void);
+
+/**
+ * Build the tree of the document with the given content from the cache.
+ * @returns the tree or NULL if it isn't in the cache
+ */
+xmlDoc *oscap_doc_cache_get(const char *buffer, size_t size);
+
+/**
+ * Store the tree parsed from the given content in the cache.
+ */
+void oscap_doc_cache_put(const char *buffer, size_t size, xmlDoc *doc);
+
+OSCAP_HIDDEN_END;
+
+#endif
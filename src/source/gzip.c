@@ -0,0 +1,173 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <libxml/tree.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "gzip_priv.h"
+#include "oscap_source_priv.h"
+#include "common/_error.h"
+
+#ifdef HAVE_ZLIB
+
+#include <zlib.h>
+
+#include "common/alloc.h"
+
+struct gzip_mem {
+	z_stream stream;
+	bool eof;
+};
+
+static struct gzip_mem *gzip_mem_open(const char *buffer, size_t size)
+{
+	struct gzip_mem *g = oscap_calloc(sizeof(struct gzip_mem), 1);
+	g->stream.next_in = (Bytef *) buffer;
+	g->stream.avail_in = size;
+	// 16 + MAX_WBITS accepts the gzip header only
+	int zerror = inflateInit2(&g->stream, 16 + MAX_WBITS);
+	if (zerror != Z_OK) {
+		oscap_seterr(OSCAP_EFAMILY_OSCAP, "Could not build z_stream from memory buffer: inflateInit2 returns %d", zerror);
+		oscap_free(g);
+		return NULL;
+	}
+	return g;
+}
+
+// xmlInputReadCallback
+static int gzip_mem_read(struct gzip_mem *gzmem, char *buffer, int len)
+{
+	if (len < 1 || gzmem->eof) {
+		return 0;
+	}
+	gzmem->stream.next_out = (Bytef *) buffer;
+	gzmem->stream.avail_out = len;
+	int zerror = inflate(&gzmem->stream, Z_NO_FLUSH);
+	if (zerror == Z_STREAM_END) {
+		if (gzmem->stream.avail_in > 0) {
+			// concatenated gzip members (pigz, cat a.gz b.gz) make one file
+			zerror = inflateReset(&gzmem->stream);
+		} else {
+			gzmem->eof = true;
+			zerror = Z_OK;
+		}
+	}
+	if (zerror == Z_OK || zerror == Z_BUF_ERROR)
+		return (len - gzmem->stream.avail_out);
+	else {
+		oscap_seterr(OSCAP_EFAMILY_OSCAP, "Could not read from z_stream: inflate returns %d", zerror);
+		return -1;
+	}
+}
+
+// xmlInputCloseCallback
+static int gzip_mem_close(void *gzmem)
+{
+	int zerror = inflateEnd(&((struct gzip_mem *)gzmem)->stream);
+	oscap_free(gzmem);
+	if (zerror != Z_OK) {
+		oscap_seterr(OSCAP_EFAMILY_OSCAP, "Could not close z_stream: inflateEnd returns %d", zerror);
+	}
+	return zerror == Z_OK ? 0 : -1;
+}
+
+xmlDoc *gzip_mem_read_doc(xmlParserCtxt *ctxt, const char *buffer, size_t size)
+{
+	struct gzip_mem *gzmem = gzip_mem_open(buffer, size);
+	if (gzmem == NULL) {
+		return NULL;
+	}
+	return xmlCtxtReadIO(ctxt, (xmlInputReadCallback) gzip_mem_read, gzip_mem_close, gzmem, "url", NULL, XML_PARSE_PEDANTIC | OSCAP_SOURCE_XML_OPTIONS);
+}
+
+struct gzip_file {
+	gzFile file;
+};
+
+// xmlInputReadCallback
+static int gzip_file_read(struct gzip_file *gzfile, char *buffer, int len)
+{
+	int ret = gzread(gzfile->file, buffer, len);
+	if (ret < 0) {
+		int zerror;
+		oscap_seterr(OSCAP_EFAMILY_OSCAP, "Could not read from gzip file: %s", gzerror(gzfile->file, &zerror));
+		return -1;
+	}
+	return ret;
+}
+
+// xmlInputCloseCallback
+static int gzip_file_close(void *gzfile)
+{
+	int zerror = gzclose(((struct gzip_file *)gzfile)->file);
+	oscap_free(gzfile);
+	if (zerror != Z_OK) {
+		oscap_seterr(OSCAP_EFAMILY_OSCAP, "Could not close gzip file: gzclose returns %d", zerror);
+	}
+	return zerror == Z_OK ? 0 : -1;
+}
+
+xmlDoc *gzip_fd_read_doc(xmlParserCtxt *ctxt, int fd)
+{
+	// gzclose closes the descriptor, the caller closes its own
+	int fd_dup = dup(fd);
+	if (fd_dup == -1) {
+		oscap_seterr(OSCAP_EFAMILY_GLIBC, "Could not open gzip file: %s", strerror(errno));
+		return NULL;
+	}
+	gzFile file = gzdopen(fd_dup, "rb");
+	if (file == NULL) {
+		close(fd_dup);
+		oscap_seterr(OSCAP_EFAMILY_OSCAP, "Could not open gzip file");
+		return NULL;
+	}
+	struct gzip_file *gzfile = oscap_calloc(sizeof(struct gzip_file), 1);
+	gzfile->file = file;
+	return xmlCtxtReadIO(ctxt, (xmlInputReadCallback) gzip_file_read, gzip_file_close, gzfile, "url", NULL, XML_PARSE_PEDANTIC | OSCAP_SOURCE_XML_OPTIONS);
+}
+
+#endif
+
+static const unsigned char magic_number[] = {0x1f, 0x8b};
+
+bool gzip_memory_is_gzip(const char* memory, const size_t size)
+{
+	if (size < 2) {
+		return false; // Cannot read magic number
+	}
+
+	// compare memory header with reference magic_number of gzip
+	return ((unsigned char) memory[0] == magic_number[0]) && ((unsigned char) memory[1] == magic_number[1]);
+}
+
+bool gzip_fd_is_gzip(int fd)
+{
+	unsigned char header[2];
+	bool is_gzip = (pread(fd, header, sizeof(header), 0) == sizeof(header)) &&
+		header[0] == magic_number[0] && header[1] == magic_number[1];
+	return is_gzip;
+}
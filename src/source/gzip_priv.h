@@ -0,0 +1,73 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef OSCAP_SOURCE_GZIP_H
+#define OSCAP_SOURCE_GZIP_H
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "common/public/oscap.h"
+#include "common/util.h"
+#include <libxml/tree.h>
+
+OSCAP_HIDDEN_START;
+
+#ifdef HAVE_ZLIB
+
+/**
+ * Parse *.xml.gz file to XML DOM
+ * @param ctxt The parser context reporting the XML errors
+ * @param fd The file descriptor to gzip file
+ * @returns DOM representation of the file
+ */
+xmlDoc *gzip_fd_read_doc(xmlParserCtxt *ctxt, int fd);
+
+/**
+ * Parse gzipped memory to XML DOM.
+ * @param ctxt The parser context reporting the XML errors
+ * @param buffer data in memory to process (contains gzipped XML)
+ * @param size length of data
+ * @returns DOM representation of the data
+ */
+xmlDoc *gzip_mem_read_doc(xmlParserCtxt *ctxt, const char *buffer, size_t size);
+
+#endif // HAVE_ZLIB
+
+/**
+ * Recognize whether the file can be parsed by this
+ * gzip parser. Do not close the file.
+ * @param file descriptor to opened file
+ * @returns true if can be parsed.
+ */
+bool gzip_fd_is_gzip(int fd);
+
+/**
+ * Recognize whether the memory can be parsed by this
+ * gzip parser.
+ * @param memory data in memory
+ * @param size length of data
+ * @returns true if can be parsed.
+ */
+bool gzip_memory_is_gzip(const char* memory, const size_t size);
+
+OSCAP_HIDDEN_END;
+
+#endif
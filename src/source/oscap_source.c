@@ -24,15 +24,21 @@
 #include <config.h>
 #endif
 
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
 #include <string.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <libxml/parser.h>
 #include <libxml/xmlreader.h>
 #include <libxml/xmlerror.h>
 
 #include "common/alloc.h"
 #include "common/elements.h"
+#include "common/list.h"
 #include "common/_error.h"
 #include "common/debug_priv.h"
 #include "common/public/oscap.h"
@@ -43,10 +49,13 @@
 #include "doc_type_priv.h"
 #include "oscap_source.h"
 #include "common/oscap_string.h"
+#include "common/oscap_trace.h"
 #include "oscap_source_priv.h"
 #include "OVAL/oval_parser_impl.h"
 #include "OVAL/public/oval_definitions.h"
 #include "source/bz2_priv.h"
+#include "source/gzip_priv.h"
+#include "source/doc_cache_priv.h"
 #include "source/schematron_priv.h"
 #include "source/validate_priv.h"
 #include "XCCDF/elements.h"
@@ -67,10 +76,22 @@ struct oscap_source {
 		char *filepath;                         ///< Filepath (if originated from file)
 		char *memory;                           ///< Memory buffer (if originated from memory)
 		size_t memory_size;                     ///< Size of the memory buffer (if originated from memory)
+		char *mapping;                          ///< The file mapped to memory (if originated from file)
+		size_t mapping_size;                    ///< Size of the mapping
+		bool mapping_tried;                     ///< Has the file been mapped already?
 	} origin;                                       ///
 	struct {
 		xmlDoc *doc;                            /// DOM
+		xmlDict *dict;                          ///< Dictionary shared with other sources (if any)
 	} xml;
+	struct {
+		struct oscap_source *owner;             ///< Source the subtree is borrowed from (if any)
+		xmlNode *node;                          ///< Root of the borrowed subtree
+		xmlNode *parent;                        ///< Parent of the subtree in the owner's DOM
+		xmlNode *prev;                          ///< Previous sibling of the subtree in the owner's DOM
+		bool held;                              ///< Is the subtree in our DOM or in the owner's?
+		struct oscap_list *borrowers;           ///< Sources borrowing subtrees of our DOM
+	} lent;
 };
 
 struct oscap_source *oscap_source_new_from_file(const char *filepath)
@@ -123,14 +144,133 @@ struct oscap_source *oscap_source_new_from_xmlDoc(xmlDoc *doc, const char *filep
 	return source;
 }
 
+/*
+ * Borrowed subtrees. A component of a data stream is used as a document of
+ * its own, but it's moved between the DOM of the data stream and the DOM of
+ * the component instead of being copied: xmlDOMWrapAdoptNode only re-points
+ * the nodes, both documents share the dictionary of the names. The subtree
+ * is where it was last asked for, the owner takes all of them back when its
+ * whole DOM is asked for (to be exported or validated).
+ */
+static int _oscap_source_take_subtree(struct oscap_source *source)
+{
+	xmlDoc *owner_doc = source->lent.owner->xml.doc;
+	xmlNode *node = source->lent.node;
+
+	source->lent.parent = node->parent;
+	source->lent.prev = node->prev;
+
+	xmlDOMWrapCtxtPtr wrap_ctxt = xmlDOMWrapNewCtxt();
+	if (xmlDOMWrapAdoptNode(wrap_ctxt, owner_doc, node, source->xml.doc, NULL, 0) != 0) {
+		oscap_seterr(OSCAP_EFAMILY_XML, "Could not adopt node '%s' from '%s'.",
+				node->name, oscap_source_readable_origin(source->lent.owner));
+		xmlDOMWrapFreeCtxt(wrap_ctxt);
+		return -1;
+	}
+	xmlDocSetRootElement(source->xml.doc, node);
+	if (xmlDOMWrapReconcileNamespaces(wrap_ctxt, node, 0) != 0) {
+		oscap_seterr(OSCAP_EFAMILY_XML, "Internal libxml error when reconciling namespaces "
+				"for node '%s' of '%s'.", node->name, oscap_source_readable_origin(source->lent.owner));
+	}
+	xmlDOMWrapFreeCtxt(wrap_ctxt);
+	source->lent.held = true;
+	return 0;
+}
+
+static void _oscap_source_give_back_subtree(struct oscap_source *source)
+{
+	xmlNode *node = source->lent.node;
+	xmlNode *parent = source->lent.parent;
+
+	xmlDOMWrapCtxtPtr wrap_ctxt = xmlDOMWrapNewCtxt();
+	xmlDOMWrapAdoptNode(wrap_ctxt, source->xml.doc, node, source->lent.owner->xml.doc, parent, 0);
+	xmlDOMWrapFreeCtxt(wrap_ctxt);
+
+	if (source->lent.prev != NULL)
+		xmlAddNextSibling(source->lent.prev, node);
+	else if (parent->children != NULL)
+		xmlAddPrevSibling(parent->children, node);
+	else
+		xmlAddChild(parent, node);
+	source->lent.held = false;
+}
+
+struct oscap_source *oscap_source_new_from_xmlNode(struct oscap_source *owner, xmlNode *node, const char *filepath)
+{
+	xmlDoc *owner_doc = owner->xml.doc;
+	xmlDoc *doc = xmlNewDoc(BAD_CAST "1.0");
+	if (owner_doc->dict != NULL) {
+		doc->dict = owner_doc->dict;
+		xmlDictReference(doc->dict);
+	}
+
+	struct oscap_source *source = oscap_source_new_from_xmlDoc(doc, filepath);
+	source->lent.owner = owner;
+	source->lent.node = node;
+	source->lent.parent = node->parent;
+	source->lent.prev = node->prev;
+
+	if (owner->lent.borrowers == NULL)
+		owner->lent.borrowers = oscap_list_new();
+	oscap_list_add(owner->lent.borrowers, source);
+	return source;
+}
+
+xmlDoc *oscap_source_peek_xmlDoc(struct oscap_source *source)
+{
+	if (source->lent.borrowers == NULL || source->xml.doc == NULL)
+		return oscap_source_get_xmlDoc(source);
+	return source->xml.doc;
+}
+
+void oscap_source_reclaim_subtrees(struct oscap_source *source, const xmlNode *parent)
+{
+	if (source->lent.borrowers == NULL)
+		return;
+
+	struct oscap_iterator *it = oscap_iterator_new(source->lent.borrowers);
+	while (oscap_iterator_has_more(it)) {
+		struct oscap_source *borrower = oscap_iterator_next(it);
+		if (borrower->lent.held && (parent == NULL || borrower->lent.parent == parent))
+			_oscap_source_give_back_subtree(borrower);
+	}
+	oscap_iterator_free(it);
+}
+
+static bool _oscap_source_eq(void *a, void *b)
+{
+	return a == b;
+}
+
 void oscap_source_free(struct oscap_source *source)
 {
 	if (source != NULL) {
+		if (source->lent.borrowers != NULL) {
+			// the borrowers keep their subtrees for good
+			struct oscap_iterator *it = oscap_iterator_new(source->lent.borrowers);
+			while (oscap_iterator_has_more(it)) {
+				struct oscap_source *borrower = oscap_iterator_next(it);
+				if (!borrower->lent.held)
+					_oscap_source_take_subtree(borrower);
+				borrower->lent.owner = NULL;
+			}
+			oscap_iterator_free(it);
+			oscap_list_free(source->lent.borrowers, NULL);
+		}
+		if (source->lent.owner != NULL) {
+			if (source->lent.held)
+				_oscap_source_give_back_subtree(source);
+			oscap_list_remove(source->lent.owner->lent.borrowers, source, _oscap_source_eq, NULL);
+		}
 		oscap_free(source->origin.filepath);
 		oscap_free(source->origin.memory);
+		if (source->origin.mapping != NULL)
+			munmap(source->origin.mapping, source->origin.mapping_size);
 		if (source->xml.doc != NULL) {
 			xmlFreeDoc(source->xml.doc);
 		}
+		if (source->xml.dict != NULL)
+			xmlDictFree(source->xml.dict);
 		oscap_free(source->origin.version);
 		oscap_free(source);
 	}
@@ -160,8 +300,117 @@ xmlTextReader *oscap_source_get_xmlTextReader(struct oscap_source *source)
 	return reader;
 }
 
+void oscap_source_set_xml_dict(struct oscap_source *source, xmlDict *dict)
+{
+	if (dict != NULL)
+		xmlDictReference(dict);
+	if (source->xml.dict != NULL)
+		xmlDictFree(source->xml.dict);
+	source->xml.dict = dict;
+}
+
+const char *oscap_source_get_filepath(const struct oscap_source *source)
+{
+	return source->origin.type == OSCAP_SRC_FROM_USER_XML_FILE ? source->origin.filepath : NULL;
+}
+
+static void _oscap_source_ignore_xml_errors(void *user, xmlErrorPtr error)
+{
+	// the document is parsed again with the errors reported when needed
+}
+
+/*
+ * Map a regular file of the source to memory. The parsers, the type detection
+ * and the version sniffing then share the mapping instead of reading the file
+ * again, and it stays until the source is freed. Returns the mapping or NULL
+ * for the files which can't be mapped (pipes, empty or too large for libxml2).
+ */
+static const char *_oscap_source_map(struct oscap_source *source, size_t *size)
+{
+	if (!source->origin.mapping_tried && source->origin.type == OSCAP_SRC_FROM_USER_XML_FILE) {
+		source->origin.mapping_tried = true;
+
+		int fd = open(source->origin.filepath, O_RDONLY);
+		if (fd != -1) {
+			struct stat st;
+			if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 && st.st_size <= INT_MAX) {
+				void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (map != MAP_FAILED) {
+					source->origin.mapping = map;
+					source->origin.mapping_size = st.st_size;
+				}
+			}
+			close(fd);
+		}
+	}
+	*size = source->origin.mapping_size;
+	return source->origin.mapping;
+}
+
+static int _oscap_source_fd_read(void *context, char *buffer, int len)
+{
+	ssize_t ret;
+
+	do {
+		ret = read((int) (intptr_t) context, buffer, len);
+	} while (ret == -1 && errno == EINTR);
+	return ret;
+}
+
+static int _oscap_source_fd_close(void *context)
+{
+	return close((int) (intptr_t) context);
+}
+
+xmlTextReader *oscap_source_get_streaming_xmlTextReader(struct oscap_source *source)
+{
+	const char *mapping;
+	size_t mapping_size;
+
+	xmlTextReader *reader = NULL;
+
+	if (source->xml.doc != NULL || source->lent.owner != NULL) {
+		// no point in parsing what is in memory already
+		return oscap_source_get_xmlTextReader(source);
+	}
+
+	if (source->origin.memory != NULL) {
+		if (!bz2_memory_is_bzip(source->origin.memory, source->origin.memory_size) &&
+		    !gzip_memory_is_gzip(source->origin.memory, source->origin.memory_size))
+			reader = xmlReaderForMemory(source->origin.memory, source->origin.memory_size, NULL, NULL, OSCAP_SOURCE_XML_OPTIONS);
+	} else if ((mapping = _oscap_source_map(source, &mapping_size)) != NULL) {
+		if (!bz2_memory_is_bzip(mapping, mapping_size) && !gzip_memory_is_gzip(mapping, mapping_size))
+			reader = xmlReaderForMemory(mapping, mapping_size, NULL, NULL, OSCAP_SOURCE_XML_OPTIONS);
+	} else {
+		int fd = open(source->origin.filepath, O_RDONLY);
+		if (fd != -1) {
+			if (!bz2_fd_is_bzip(fd) && !gzip_fd_is_gzip(fd))
+				// the reader closes the fd when it's freed
+				reader = xmlReaderForIO(_oscap_source_fd_read, _oscap_source_fd_close, (void *) (intptr_t) fd,
+					source->origin.filepath, NULL, OSCAP_SOURCE_XML_OPTIONS);
+			else
+				close(fd);
+		}
+	}
+	if (reader == NULL) {
+		// compressed or an error which the DOM parser will report properly
+		return oscap_source_get_xmlTextReader(source);
+	}
+	xmlTextReaderSetStructuredErrorHandler(reader, _oscap_source_ignore_xml_errors, NULL);
+	return reader;
+}
+
 oscap_document_type_t oscap_source_get_scap_type(struct oscap_source *source)
 {
+	if (source->scap_type == OSCAP_DOCUMENT_UNKNOWN && source->xml.doc == NULL) {
+		// The type is in the root element, it's found without the DOM
+		xmlTextReader *reader = oscap_source_get_streaming_xmlTextReader(source);
+		if (reader != NULL) {
+			if (oscap_determine_document_type_reader(reader, &(source->scap_type)) == -1)
+				source->scap_type = OSCAP_DOCUMENT_UNKNOWN;
+			xmlFreeTextReader(reader);
+		}
+	}
 	if (source->scap_type == OSCAP_DOCUMENT_UNKNOWN) {
 		xmlTextReader *reader = oscap_source_get_xmlTextReader(source);
 		if (reader == NULL) {
@@ -178,16 +427,39 @@ oscap_document_type_t oscap_source_get_scap_type(struct oscap_source *source)
 	return source->scap_type;
 }
 
-static void xmlErrorCb(struct oscap_string *buffer, const char * format, ...)
+/*
+ * The errors are collected by the parser context of the call, not by the
+ * generic error handler of libxml2, so the handler of the application is
+ * kept and the sessions parsing on other threads don't interfere.
+ */
+static void _oscap_source_xml_error(void *user, xmlErrorPtr error)
 {
-	va_list ap;
-	va_start(ap, format);
+	struct oscap_string *buffer = ((xmlParserCtxt *) user)->_private;
 
-	char* error_msg = oscap_vsprintf(format, ap);
+	char *error_msg = oscap_sprintf("%s:%d: %s", error->file != NULL ? error->file : "(memory)",
+					error->line, error->message != NULL ? error->message : "\n");
 	oscap_string_append_string(buffer, error_msg);
 	oscap_free(error_msg);
+}
+
+static xmlParserCtxt *_oscap_source_new_parser_ctxt(struct oscap_string *xml_error_string, xmlDict *dict)
+{
+	xmlParserCtxt *ctxt = xmlNewParserCtxt();
 
-	va_end(ap);
+	if (ctxt == NULL)
+		return NULL;
+	ctxt->_private = xml_error_string;
+	ctxt->sax->serror = _oscap_source_xml_error;
+	if (dict != NULL) {
+		/* the parser compares the names to these by the pointer */
+		xmlDictFree(ctxt->dict);
+		ctxt->dict = dict;
+		xmlDictReference(dict);
+		ctxt->str_xml = xmlDictLookup(dict, BAD_CAST "xml", 3);
+		ctxt->str_xmlns = xmlDictLookup(dict, BAD_CAST "xmlns", 5);
+		ctxt->str_xml_ns = xmlDictLookup(dict, XML_XML_NAMESPACE, 36);
+	}
+	return ctxt;
 }
 
 static bool fd_file_is_executable(int fd)
@@ -228,36 +500,108 @@ static bool memory_file_is_executable(const char* memory, const size_t size)
 	return true;
 }
 
+static xmlDoc *_read_memory_cached(xmlParserCtxt *ctxt, const char *buffer, size_t size)
+{
+	xmlDoc *doc = oscap_doc_cache_get(buffer, size);
+
+	if (doc == NULL) {
+		doc = xmlCtxtReadMemory(ctxt, buffer, size, NULL, NULL, OSCAP_SOURCE_XML_OPTIONS);
+		if (doc != NULL)
+			oscap_doc_cache_put(buffer, size, doc);
+	}
+	return doc;
+}
+
+static xmlDoc *_read_fd_cached(xmlParserCtxt *ctxt, int fd)
+{
+	struct stat st;
+	void *map;
+	xmlDoc *doc;
+
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0 || st.st_size > INT_MAX)
+		return xmlCtxtReadFd(ctxt, fd, NULL, NULL, OSCAP_SOURCE_XML_OPTIONS);
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED)
+		return xmlCtxtReadFd(ctxt, fd, NULL, NULL, OSCAP_SOURCE_XML_OPTIONS);
+
+	doc = _read_memory_cached(ctxt, map, st.st_size);
+	munmap(map, st.st_size);
+	return doc;
+}
+
+static xmlDoc *_oscap_source_read_memory(struct oscap_source *source, xmlParserCtxt *ctxt, const char *memory, size_t size,
+					  struct oscap_string *xml_error_string)
+{
+	xmlDoc *doc = NULL;
+
+	if (bz2_memory_is_bzip(memory, size)) {
+#ifdef HAVE_BZ2
+		doc = bz2_mem_read_doc(ctxt, memory, size);
+#else
+		oscap_seterr(OSCAP_EFAMILY_OSCAP, "Unable to unpack bz2 from '%s'. Please compile OpenSCAP with bz2 support.", oscap_source_readable_origin(source));
+#endif
+	} else if (gzip_memory_is_gzip(memory, size)) {
+#ifdef HAVE_ZLIB
+		doc = gzip_mem_read_doc(ctxt, memory, size);
+#else
+		oscap_seterr(OSCAP_EFAMILY_OSCAP, "Unable to unpack gzip from '%s'. Please compile OpenSCAP with zlib support.", oscap_source_readable_origin(source));
+#endif
+	} else {
+		if (oscap_doc_cache_enabled())
+			doc = _read_memory_cached(ctxt, memory, size);
+		else
+			doc = xmlCtxtReadMemory(ctxt, memory, size, NULL, NULL, OSCAP_SOURCE_XML_OPTIONS);
+		if (doc == NULL) {
+			if (memory_file_is_executable(memory, size)) {
+				dI("oscap-source '%s' was detected as executable file. Skipped XML parsing", oscap_source_readable_origin(source));
+				oscap_string_clear(xml_error_string);
+			} else {
+				oscap_setxmlerr(xmlCtxtGetLastError(ctxt));
+				const char *error_msg = oscap_string_get_cstr(xml_error_string);
+				if (source->origin.memory != NULL)
+					oscap_seterr(OSCAP_EFAMILY_XML, "%sUnable to parse XML from user memory buffer", error_msg);
+				else
+					oscap_seterr(OSCAP_EFAMILY_XML, "%sUnable to parse XML at: '%s'", error_msg, oscap_source_readable_origin(source));
+				oscap_string_clear(xml_error_string);
+			}
+		}
+	}
+	return doc;
+}
+
 xmlDoc *oscap_source_get_xmlDoc(struct oscap_source *source)
 {
+	if (source->lent.owner != NULL) {
+		if (!source->lent.held && _oscap_source_take_subtree(source) != 0)
+			return NULL;
+		return source->xml.doc;
+	}
+	oscap_source_reclaim_subtrees(source, NULL);
+
 	// We check origin.memory first because even with it being non-NULL
 	// filepath will be non-NULL, it will contain the filepath hint.
 	struct oscap_string *xml_error_string = oscap_string_new();
-	xmlSetGenericErrorFunc(xml_error_string, (xmlGenericErrorFunc)xmlErrorCb);
 
 	if (source->xml.doc == NULL) {
+		struct oscap_trace_span span;
+		const char *mapping;
+		size_t mapping_size;
+		xmlParserCtxt *ctxt = _oscap_source_new_parser_ctxt(xml_error_string, source->xml.dict);
+
+		if (ctxt == NULL) {
+			oscap_seterr(OSCAP_EFAMILY_XML, "Unable to create the XML parser context for '%s'", oscap_source_readable_origin(source));
+			oscap_string_free(xml_error_string);
+			return NULL;
+		}
+
+		oscap_trace_begin(&span, "xml_parse");
+
 		if (source->origin.memory != NULL) {
-			if (bz2_memory_is_bzip(source->origin.memory, source->origin.memory_size)) {
-#ifdef HAVE_BZ2
-				source->xml.doc = bz2_mem_read_doc(source->origin.memory, source->origin.memory_size);
-#else
-				oscap_seterr(OSCAP_EFAMILY_OSCAP, "Unable to unpack bz2 from buffer memory '%s'. Please compile OpenSCAP with bz2 support.", oscap_source_readable_origin(source));
-#endif
-			} else
-			{
-				source->xml.doc = xmlReadMemory(source->origin.memory, source->origin.memory_size, NULL, NULL, 0);
-				if (source->xml.doc == NULL) {
-					if (memory_file_is_executable(source->origin.memory, source->origin.memory_size)) {
-						dI("oscap-source in memory was detected as executable file. Skipped XML parsing", oscap_source_readable_origin(source));
-						oscap_string_clear(xml_error_string);
-					} else {
-						oscap_setxmlerr(xmlGetLastError());
-						const char *error_msg = oscap_string_get_cstr(xml_error_string);
-						oscap_seterr(OSCAP_EFAMILY_XML, "%sUnable to parse XML from user memory buffer", error_msg);
-						oscap_string_clear(xml_error_string);
-					}
-				}
-			}
+			source->xml.doc = _oscap_source_read_memory(source, ctxt, source->origin.memory, source->origin.memory_size, xml_error_string);
+		}
+		else if ((mapping = _oscap_source_map(source, &mapping_size)) != NULL) {
+			source->xml.doc = _oscap_source_read_memory(source, ctxt, mapping, mapping_size, xml_error_string);
 		}
 		else {
 			int fd = open(source->origin.filepath, O_RDONLY);
@@ -267,20 +611,30 @@ xmlDoc *oscap_source_get_xmlDoc(struct oscap_source *source)
 			} else {
 				if (bz2_fd_is_bzip(fd)) {
 #ifdef HAVE_BZ2
-					source->xml.doc = bz2_fd_read_doc(fd);
+					source->xml.doc = bz2_fd_read_doc(ctxt, fd);
 #else
 					source->xml.doc = NULL;
 					oscap_seterr(OSCAP_EFAMILY_OSCAP, "Unable to unpack bz2 file '%s'. Please compile OpenSCAP with bz2 support.", oscap_source_readable_origin(source));
+#endif
+				} else if (gzip_fd_is_gzip(fd)) {
+#ifdef HAVE_ZLIB
+					source->xml.doc = gzip_fd_read_doc(ctxt, fd);
+#else
+					source->xml.doc = NULL;
+					oscap_seterr(OSCAP_EFAMILY_OSCAP, "Unable to unpack gzip file '%s'. Please compile OpenSCAP with zlib support.", oscap_source_readable_origin(source));
 #endif
 				} else
 				{
-					source->xml.doc = xmlReadFd(fd, NULL, NULL, 0);
+					if (oscap_doc_cache_enabled())
+						source->xml.doc = _read_fd_cached(ctxt, fd);
+					else
+						source->xml.doc = xmlCtxtReadFd(ctxt, fd, NULL, NULL, OSCAP_SOURCE_XML_OPTIONS);
 					if (source->xml.doc == NULL) {
 						if (fd_file_is_executable(fd)) {
 							dI("oscap-source file was detected as executable file. Skipped XML parsing", oscap_source_readable_origin(source));
 							oscap_string_clear(xml_error_string);
 						} else {
-							oscap_setxmlerr(xmlGetLastError());
+							oscap_setxmlerr(xmlCtxtGetLastError(ctxt));
 							const char *error_msg = oscap_string_get_cstr(xml_error_string);
 							oscap_seterr(OSCAP_EFAMILY_XML, "%sUnable to parse XML at: '%s'", error_msg, oscap_source_readable_origin(source));
 							oscap_string_clear(xml_error_string);
@@ -290,10 +644,10 @@ xmlDoc *oscap_source_get_xmlDoc(struct oscap_source *source)
 				close(fd);
 			}
 		}
+		oscap_trace_end(&span, oscap_source_readable_origin(source));
+		xmlFreeParserCtxt(ctxt);
 	}
 
-	xmlSetGenericErrorFunc(stderr, NULL);
-
 	if (!oscap_string_empty(xml_error_string)) {
 		const char *error_msg = oscap_string_get_cstr(xml_error_string);
 		oscap_seterr(OSCAP_EFAMILY_XML, "%sFound xml error.", error_msg);
@@ -303,7 +657,7 @@ xmlDoc *oscap_source_get_xmlDoc(struct oscap_source *source)
 	return source->xml.doc;
 }
 
-int oscap_source_validate(struct oscap_source *source, xml_reporter reporter, void *user)
+static int _oscap_source_validate(struct oscap_source *source, bool stream, xml_reporter reporter, void *user)
 {
 	int ret;
 	oscap_document_type_t scap_type = oscap_source_get_scap_type(source);
@@ -319,7 +673,10 @@ int oscap_source_validate(struct oscap_source *source, xml_reporter reporter, vo
 		const char *type_name = oscap_document_type_to_string(scap_type);
 		const char *origin = oscap_source_readable_origin(source);
 		dD("Validating %s (%s) document from %s.", type_name, schema_version, origin);
-		ret = oscap_source_validate_priv(source, scap_type, schema_version, reporter, user);
+		if (stream)
+			ret = oscap_source_validate_stream_priv(source, scap_type, schema_version, reporter, user);
+		else
+			ret = oscap_source_validate_priv(source, scap_type, schema_version, reporter, user);
 		if (ret != 0) {
 			oscap_seterr(OSCAP_EFAMILY_OSCAP, "Invalid %s (%s) content in %s.", type_name, schema_version, origin);
 		}
@@ -327,6 +684,16 @@ int oscap_source_validate(struct oscap_source *source, xml_reporter reporter, vo
 	return ret;
 }
 
+int oscap_source_validate(struct oscap_source *source, xml_reporter reporter, void *user)
+{
+	return _oscap_source_validate(source, false, reporter, user);
+}
+
+int oscap_source_validate_stream(struct oscap_source *source, xml_reporter reporter, void *user)
+{
+	return _oscap_source_validate(source, true, reporter, user);
+}
+
 int oscap_source_validate_schematron(struct oscap_source *source, const char *outfile)
 {
 	return oscap_source_validate_schematron_priv(source, oscap_source_get_scap_type(source),
@@ -336,11 +703,12 @@ int oscap_source_validate_schematron(struct oscap_source *source, const char *ou
 const char *oscap_source_get_schema_version(struct oscap_source *source)
 {
 	if (source->origin.version == NULL) {
-		xmlTextReader *reader = oscap_source_get_xmlTextReader(source);
+		oscap_document_type_t scap_type = oscap_source_get_scap_type(source);
+		xmlTextReader *reader = oscap_source_get_streaming_xmlTextReader(source);
 		if (reader == NULL) {
 			return NULL;
 		}
-		switch (oscap_source_get_scap_type(source)) {
+		switch (scap_type) {
 			case OSCAP_DOCUMENT_SDS:
 				source->origin.version = strdup("1.2");
 				break;
@@ -403,6 +771,15 @@ int oscap_source_get_raw_memory(struct oscap_source *source, char **buffer, size
 		*size = source->origin.memory_size;
 		return 0;
 	}
+	else if (source->xml.doc == NULL && source->lent.owner == NULL &&
+		 _oscap_source_map(source, size) != NULL &&
+		 !bz2_memory_is_bzip(source->origin.mapping, *size) &&
+		 !gzip_memory_is_gzip(source->origin.mapping, *size)) {
+		// the file as it is, no need to parse and serialize it
+		*buffer = malloc(*size);
+		memcpy(*buffer, source->origin.mapping, *size);
+		return 0;
+	}
 	else {
 		xmlDoc *doc = oscap_source_get_xmlDoc(source);
 
@@ -26,6 +26,7 @@
 #include <config.h>
 #endif
 
+#include <stdint.h>
 #include <libxml/parser.h>
 #include <libxml/xmlreader.h>
 
@@ -35,6 +36,14 @@
 
 OSCAP_HIDDEN_START;
 
+/*
+ * The options of the parser of the SCAP documents. The compact text nodes
+ * save an allocation per short value, the huge documents lift the limits
+ * on the size of the text nodes which the large data streams and results
+ * exceed.
+ */
+#define OSCAP_SOURCE_XML_OPTIONS (XML_PARSE_COMPACT | XML_PARSE_HUGE)
+
 /**
  * Create new oscap_source from raw memory. The memory can contain \0 bytes
  * and they are not considered NULL-terminations! Always pass the correct
@@ -59,6 +68,55 @@ struct oscap_source *oscap_source_new_take_memory(char *buffer, size_t size, con
  */
 struct oscap_source *oscap_source_new_from_xmlDoc(xmlDoc *doc, const char *filepath);
 
+/**
+ * Build new oscap_source from a subtree of the DOM of another oscap_source
+ * without copying it. The subtree is moved to the DOM of the new source
+ * when that is asked for and back when the owner's whole DOM is asked for
+ * or when the new source is freed. The owner must have its DOM built.
+ * @memberof oscap_source
+ * @param owner Resource the subtree belongs to
+ * @param node Root element of the subtree
+ * @param filepath Suggested filename for the file or NULL
+ * @returns newly created oscap_source
+ */
+struct oscap_source *oscap_source_new_from_xmlNode(struct oscap_source *owner, xmlNode *node, const char *filepath);
+
+/**
+ * Get the DOM of this resource without taking back the subtrees borrowed
+ * by other sources, these are missing from it. Meant for navigating the
+ * parts of the document which are never borrowed.
+ * @memberof oscap_source
+ * @param source Resource to build DOM representation from
+ * @returns xmlDoc structure to read the content
+ */
+xmlDoc *oscap_source_peek_xmlDoc(struct oscap_source *source);
+
+/**
+ * Take back the borrowed subtrees of the given parent, all of them if
+ * the parent is NULL. The borrowers take them again when needed.
+ * @memberof oscap_source
+ */
+void oscap_source_reclaim_subtrees(struct oscap_source *source, const xmlNode *parent);
+
+/**
+ * Parse the resource with the given dictionary of libxml2, so the names
+ * and the short values of the documents of a session are stored once. The
+ * resource takes a reference of the dictionary, NULL parses with a
+ * dictionary of its own.
+ * @memberof oscap_source
+ * @param source Resource
+ * @param dict Dictionary shared with other resources
+ */
+void oscap_source_set_xml_dict(struct oscap_source *source, xmlDict *dict);
+
+/**
+ * Get the path of the file the resource was created from.
+ * @memberof oscap_source
+ * @param source Resource
+ * @returns the path or NULL if the resource doesn't originate from a file
+ */
+const char *oscap_source_get_filepath(const struct oscap_source *source);
+
 /**
  * Get an xmlTextReader assigned with this resource. The reader needs to be
  * disposed by caller.
@@ -68,6 +126,17 @@ struct oscap_source *oscap_source_new_from_xmlDoc(xmlDoc *doc, const char *filep
  */
 xmlTextReader *oscap_source_get_xmlTextReader(struct oscap_source *source);
 
+/**
+ * Get an xmlTextReader which parses this resource as it reads, without
+ * building the DOM, if the DOM isn't built yet. Falls back to
+ * oscap_source_get_xmlTextReader otherwise. The parser errors are not
+ * reported. The reader needs to be disposed by caller.
+ * @memberof oscap_source
+ * @param source Resource to read the content
+ * @returns xmlTextReader structure to read the content
+ */
+xmlTextReader *oscap_source_get_streaming_xmlTextReader(struct oscap_source *source);
+
 /**
  * Get a DOM representation of this resource. The document ins still owned
  * by oscap_source.
@@ -77,6 +146,27 @@ xmlTextReader *oscap_source_get_xmlTextReader(struct oscap_source *source);
  */
 xmlDoc *oscap_source_get_xmlDoc(struct oscap_source *source);
 
+/**
+ * Save the delta of the result against the baseline file, see
+ * oscap_source_new_delta(). The delta carries the whole result if there
+ * is no baseline file yet, e.g. on the first evaluation.
+ * @memberof oscap_source
+ * @param result The current result
+ * @param baseline_file Path to the previous result
+ * @param filename Path to the delta
+ * @returns 0 on success, -1 on error
+ */
+int oscap_source_save_delta_as(struct oscap_source *result, const char *baseline_file, const char *filename);
+
+/**
+ * Hash of the element the deltas are checked by. It covers the names, the
+ * attributes, the text and the child elements, not the order of the
+ * attributes, the whitespace between the elements nor the comments.
+ * @param node The element
+ * @returns the hash
+ */
+uint64_t oscap_xml_node_hash(xmlNode *node);
+
 OSCAP_HIDDEN_END;
 
 #endif
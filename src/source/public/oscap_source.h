@@ -114,6 +114,18 @@ const char *oscap_source_get_schema_version(struct oscap_source *source);
  */
 int oscap_source_validate(struct oscap_source *source, xml_reporter reporter, void *user);
 
+/**
+ * Validate the SCAP document against particular XML schema definition while
+ * it is being parsed. Unless the DOM of the document is already built, it is
+ * never built, the memory needed doesn't grow with the size of the document.
+ * Meant for large documents which are only to be validated.
+ * @memberof oscap_source
+ * @param source The oscap_source to validate
+ * @note The held resource has to be XML for this function to work.
+ * @returns 0 on pass; 1 on fail, and -1 on internal error
+ */
+int oscap_source_validate_stream(struct oscap_source *source, xml_reporter reporter, void *user);
+
 /**
  * Validate the SCAP document against schematron assertions
  * @memberof oscap_source
@@ -156,4 +168,29 @@ int oscap_source_save_as(struct oscap_source *source, const char *filename);
  */
 int oscap_source_get_raw_memory(struct oscap_source *source, char **buffer, size_t *size);
 
+/**
+ * Build the delta of a result against its baseline, the result of a previous
+ * evaluation of the same content (e.g. ARF or OVAL results). The delta lists
+ * the elements which are not in the baseline or differ from it, the elements
+ * are matched by their ids. The baseline and the result are identified by the
+ * hashes of their content, see oscap_source_new_from_delta().
+ * @memberof oscap_source
+ * @param baseline The previous result or NULL, the delta carries the whole result then
+ * @param result The current result
+ * @param filepath Suggested filename for the delta or NULL
+ * @returns newly created oscap_source or NULL on error
+ */
+struct oscap_source *oscap_source_new_delta(struct oscap_source *baseline, struct oscap_source *result, const char *filepath);
+
+/**
+ * Rebuild the result from its baseline and its delta, see oscap_source_new_delta().
+ * @memberof oscap_source
+ * @param baseline The previous result the delta was built against
+ * @param delta The delta
+ * @param filepath Suggested filename for the result or NULL
+ * @returns newly created oscap_source or NULL if the baseline isn't the one
+ * of the delta or if the rebuilt result doesn't match its hash
+ */
+struct oscap_source *oscap_source_new_from_delta(struct oscap_source *baseline, struct oscap_source *delta, const char *filepath);
+
 #endif
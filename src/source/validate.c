@@ -24,11 +24,14 @@
 
 #include <libxml/parser.h>
 #include <libxml/xmlerror.h>
+#include <libxml/xmlreader.h>
 #include <libxml/xmlschemas.h>
+#include <pthread.h>
 #include <string.h>
 #include <unistd.h>
 
 #include "common/_error.h"
+#include "common/list.h"
 #include "common/util.h"
 #include "oscap.h"
 #include "oscap_source.h"
@@ -78,10 +81,91 @@ static void oscap_xml_validity_handler(void *user, xmlErrorPtr error)
 	context->reporter(file, error->line, error->message, context->arg);
 }
 
-static inline int oscap_validate_xml(struct oscap_source *source, const char *schemafile, xml_reporter reporter, void *arg)
+/* parsed schemas by path, they are only read by the validations */
+static pthread_mutex_t __cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct oscap_htable *__cache = NULL;
+
+static xmlSchemaPtr oscap_schema_get(const char *schemapath, struct ctxt *context)
+{
+	xmlSchemaPtr schema, prev;
+
+	pthread_mutex_lock(&__cache_lock);
+	schema = __cache != NULL ? oscap_htable_get(__cache, schemapath) : NULL;
+	pthread_mutex_unlock(&__cache_lock);
+
+	if (schema != NULL)
+		return schema;
+
+	xmlSchemaParserCtxtPtr parser_ctxt = xmlSchemaNewParserCtxt(schemapath);
+	if (parser_ctxt == NULL) {
+		oscap_seterr(OSCAP_EFAMILY_XML, "Could not create parser context for validation");
+		return NULL;
+	}
+
+	xmlSchemaSetParserStructuredErrors(parser_ctxt, oscap_xml_validity_handler, context);
+
+	/*
+	 * Parse without holding the lock. If another thread was faster,
+	 * use its copy and throw ours away.
+	 */
+	schema = xmlSchemaParse(parser_ctxt);
+	xmlSchemaFreeParserCtxt(parser_ctxt);
+	if (schema == NULL) {
+		oscap_seterr(OSCAP_EFAMILY_XML, "Could not parse XML schema");
+		return NULL;
+	}
+
+	pthread_mutex_lock(&__cache_lock);
+	if (__cache == NULL)
+		__cache = oscap_htable_new();
+
+	prev = oscap_htable_get(__cache, schemapath);
+	if (prev != NULL) {
+		xmlSchemaFree(schema);
+		schema = prev;
+	} else {
+		oscap_htable_add(__cache, schemapath, schema);
+	}
+	pthread_mutex_unlock(&__cache_lock);
+
+	return schema;
+}
+
+void oscap_schema_cache_clear(void)
+{
+	pthread_mutex_lock(&__cache_lock);
+	oscap_htable_free(__cache, (oscap_destruct_func) xmlSchemaFree);
+	__cache = NULL;
+	pthread_mutex_unlock(&__cache_lock);
+}
+
+/* validate the document as it is parsed, the memory depends only on the depth of the document */
+static int oscap_validate_xml_reader(struct oscap_source *source, xmlSchemaValidCtxtPtr ctxt, struct ctxt *context)
+{
+	xmlTextReader *reader = oscap_source_get_streaming_xmlTextReader(source);
+	if (reader == NULL)
+		return -1;
+
+	// report what is not well-formed too
+	xmlTextReaderSetStructuredErrorHandler(reader, oscap_xml_validity_handler, context);
+	if (xmlTextReaderSchemaValidateCtxt(reader, ctxt, 0) != 0) {
+		oscap_seterr(OSCAP_EFAMILY_XML, "Could not set up validation of '%s'", context->filename);
+		xmlFreeTextReader(reader);
+		return -1;
+	}
+
+	int ret;
+	while ((ret = xmlTextReaderRead(reader)) == 1)
+		;
+
+	int result = (ret == 0 && xmlTextReaderIsValid(reader) == 1) ? 0 : 1;
+	xmlFreeTextReader(reader);
+	return result;
+}
+
+static inline int oscap_validate_xml(struct oscap_source *source, const char *schemafile, bool stream, xml_reporter reporter, void *arg)
 {
 	int result = -1;
-	xmlSchemaParserCtxtPtr parser_ctxt = NULL;
 	xmlSchemaPtr schema = NULL;
 	xmlSchemaValidCtxtPtr ctxt = NULL;
 	xmlDocPtr doc = NULL;
@@ -100,19 +184,9 @@ static inline int oscap_validate_xml(struct oscap_source *source, const char *sc
 		goto cleanup;
 	}
 
-	parser_ctxt = xmlSchemaNewParserCtxt(schemapath);
-	if (parser_ctxt == NULL) {
-		oscap_seterr(OSCAP_EFAMILY_XML, "Could not create parser context for validation");
+	schema = oscap_schema_get(schemapath, &context);
+	if (schema == NULL)
 		goto cleanup;
-	}
-
-	xmlSchemaSetParserStructuredErrors(parser_ctxt, oscap_xml_validity_handler, &context);
-
-	schema = xmlSchemaParse(parser_ctxt);
-	if (schema == NULL) {
-		oscap_seterr(OSCAP_EFAMILY_XML, "Could not parse XML schema");
-		goto cleanup;
-	}
 
 	ctxt = xmlSchemaNewValidCtxt(schema);
 	if (ctxt == NULL) {
@@ -122,6 +196,11 @@ static inline int oscap_validate_xml(struct oscap_source *source, const char *sc
 
 	xmlSchemaSetValidStructuredErrors(ctxt, oscap_xml_validity_handler, &context);
 
+	if (stream) {
+		result = oscap_validate_xml_reader(source, ctxt, &context);
+		goto cleanup;
+	}
+
 	doc = oscap_source_get_xmlDoc(source);
 	if (!doc)
 		goto cleanup;
@@ -143,10 +222,6 @@ static inline int oscap_validate_xml(struct oscap_source *source, const char *sc
 cleanup:
 	if (ctxt)
 		xmlSchemaFreeValidCtxt(ctxt);
-	if (schema)
-		xmlSchemaFree(schema);
-	if (parser_ctxt)
-		xmlSchemaFreeParserCtxt(parser_ctxt);
 	oscap_free(schemapath);
 
 	return result;
@@ -225,7 +300,7 @@ struct oscap_schema_table_entry OSCAP_SCHEMAS_TABLE[] = {
 	{0, NULL, NULL }
 };
 
-int oscap_source_validate_priv(struct oscap_source *source, oscap_document_type_t doc_type, const char *version, xml_reporter reporter, void *user)
+static int oscap_source_validate_schema(struct oscap_source *source, oscap_document_type_t doc_type, const char *version, bool stream, xml_reporter reporter, void *user)
 {
 	if (version == NULL) {
 		oscap_seterr(OSCAP_EFAMILY_OSCAP, "Could not determine version for file: %s", oscap_source_readable_origin(source));
@@ -237,9 +312,19 @@ int oscap_source_validate_priv(struct oscap_source *source, oscap_document_type_
 		if (entry->doc_type != doc_type || strcmp(entry->schema_version, version))
 			continue;
 
-		return oscap_validate_xml(source, entry->schema_path, reporter, user);
+		return oscap_validate_xml(source, entry->schema_path, stream, reporter, user);
 	}
 
 	oscap_seterr(OSCAP_EFAMILY_OSCAP, "Schema file not found when trying to validate '%s'", oscap_source_readable_origin(source));
 	return -1;
 }
+
+int oscap_source_validate_priv(struct oscap_source *source, oscap_document_type_t doc_type, const char *version, xml_reporter reporter, void *user)
+{
+	return oscap_source_validate_schema(source, doc_type, version, false, reporter, user);
+}
+
+int oscap_source_validate_stream_priv(struct oscap_source *source, oscap_document_type_t doc_type, const char *version, xml_reporter reporter, void *user)
+{
+	return oscap_source_validate_schema(source, doc_type, version, true, reporter, user);
+}
@@ -43,5 +43,18 @@ struct oscap_schema_table_entry {
  */
 int oscap_source_validate_priv(struct oscap_source *source, oscap_document_type_t doc_type, const char *version, xml_reporter reporter, void *user);
 
+/**
+ * validate given XML file while parsing it, without building the DOM
+ * @return 0 on pass; -1 error; 1 fail
+ */
+int oscap_source_validate_stream_priv(struct oscap_source *source, oscap_document_type_t doc_type, const char *version, xml_reporter reporter, void *user);
+
+/**
+ * Drop all the parsed schemas. The schemas are parsed once per path and
+ * kept for the next validations, which may run in parallel. No validation
+ * may be running when this is called.
+ */
+void oscap_schema_cache_clear(void);
+
 OSCAP_HIDDEN_END;
 #endif
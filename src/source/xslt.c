@@ -28,10 +28,12 @@
 #include <libxslt/transform.h>
 #include <libxslt/xsltutils.h>
 #include <libexslt/exslt.h>
+#include <pthread.h>
 #include <string.h>
 #include <unistd.h>
 
 #include "common/_error.h"
+#include "common/list.h"
 #include "common/util.h"
 #include "oscap.h"
 #include "oscap_source.h"
@@ -41,6 +43,53 @@
 #define XCCDF11_NS "http://checklists.nist.gov/xccdf/1.1"
 #define XCCDF12_NS "http://checklists.nist.gov/xccdf/1.2"
 
+/* compiled stylesheets by path, they are only read by the transformations */
+static pthread_mutex_t __cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct oscap_htable *__cache = NULL;
+
+static xsltStylesheet *oscap_xslt_get(const char *xsltpath)
+{
+	xsltStylesheet *stylesheet, *prev;
+
+	pthread_mutex_lock(&__cache_lock);
+	stylesheet = __cache != NULL ? oscap_htable_get(__cache, xsltpath) : NULL;
+	pthread_mutex_unlock(&__cache_lock);
+
+	if (stylesheet != NULL)
+		return stylesheet;
+
+	/*
+	 * Compile without holding the lock. If another thread was faster,
+	 * use its copy and throw ours away.
+	 */
+	stylesheet = xsltParseStylesheetFile(BAD_CAST xsltpath);
+	if (stylesheet == NULL)
+		return NULL;
+
+	pthread_mutex_lock(&__cache_lock);
+	if (__cache == NULL)
+		__cache = oscap_htable_new();
+
+	prev = oscap_htable_get(__cache, xsltpath);
+	if (prev != NULL) {
+		xsltFreeStylesheet(stylesheet);
+		stylesheet = prev;
+	} else {
+		oscap_htable_add(__cache, xsltpath, stylesheet);
+	}
+	pthread_mutex_unlock(&__cache_lock);
+
+	return stylesheet;
+}
+
+void oscap_xslt_cache_clear(void)
+{
+	pthread_mutex_lock(&__cache_lock);
+	oscap_htable_free(__cache, (oscap_destruct_func) xsltFreeStylesheet);
+	__cache = NULL;
+	pthread_mutex_unlock(&__cache_lock);
+}
+
 /*
  * Goes through the tree (DFS) and changes namespace of all XCCDF 1.1 elements
  * to XCCDF 1.2 namespace URI. This ensures that the XCCDF works fine with
@@ -97,9 +146,8 @@ static inline int save_stylesheet_result_to_file(xmlDoc *resulting_doc, xsltStyl
 	return ret;
 }
 
-static xmlDoc *apply_xslt_path_internal(struct oscap_source *source, const char *xsltfile, const char **params, const char *path_to_xslt, xsltStylesheet **stylesheet)
+static xmlDoc *apply_xslt_path_internal(xmlDoc *doc, const char *origin, const char *xsltfile, const char **params, const char *path_to_xslt, xsltStylesheet **stylesheet)
 {
-	xmlDoc *doc = oscap_source_get_xmlDoc(source);
 	if (doc == NULL || stylesheet == NULL) {
 		return NULL;
 	}
@@ -121,7 +169,7 @@ static xmlDoc *apply_xslt_path_internal(struct oscap_source *source, const char
 		xsltpath = strdup(xsltfile);
 		if (access(xsltpath, R_OK)) {
 			oscap_seterr(OSCAP_EFAMILY_OSCAP, "XSLT file '%s' not found when trying to transform '%s'",
-				xsltfile, oscap_source_readable_origin(source));
+				xsltfile, origin);
 			oscap_free(xsltpath);
 			return NULL;
 		}
@@ -130,7 +178,7 @@ static xmlDoc *apply_xslt_path_internal(struct oscap_source *source, const char
 		xsltpath = oscap_sprintf("%s%s%s", path_to_xslt, "/", xsltfile);
 		if (access(xsltpath, R_OK)) {
 			oscap_seterr(OSCAP_EFAMILY_OSCAP, "XSLT file '%s' not found in path '%s' when trying to transform '%s'",
-				xsltfile, path_to_xslt, oscap_source_readable_origin(source));
+				xsltfile, path_to_xslt, origin);
 			oscap_free(xsltpath);
 			return NULL;
 		}
@@ -141,7 +189,7 @@ static xmlDoc *apply_xslt_path_internal(struct oscap_source *source, const char
 			ns_workaround = true;
 	}
 
-	*stylesheet = xsltParseStylesheetFile(BAD_CAST xsltpath);
+	*stylesheet = oscap_xslt_get(xsltpath);
 	if (*stylesheet == NULL) {
 		oscap_seterr(OSCAP_EFAMILY_OSCAP, "Could not parse XSLT file '%s'", xsltpath);
 		oscap_free(xsltpath);
@@ -151,9 +199,8 @@ static xmlDoc *apply_xslt_path_internal(struct oscap_source *source, const char
 	if (ns_workaround) {
 		if (xccdf_ns_xslt_workaround(doc, xmlDocGetRootElement(doc)) != 0) {
 			oscap_seterr(OSCAP_EFAMILY_OSCAP, "Had problems employing XCCDF XSLT namespace workaround for XML document '%s'",
-				oscap_source_readable_origin(source));
+				origin);
 			oscap_free(xsltpath);
-			xsltFreeStylesheet(*stylesheet);
 			*stylesheet = NULL;
 			return NULL;
 		}
@@ -170,9 +217,8 @@ static xmlDoc *apply_xslt_path_internal(struct oscap_source *source, const char
 	}
 	if (transformed == NULL) {
 		oscap_seterr(OSCAP_EFAMILY_OSCAP, "Could not apply XSLT %s to XML file: %s", xsltpath,
-			oscap_source_readable_origin(source));
+			origin);
 		oscap_free(xsltpath);
-		xsltFreeStylesheet(*stylesheet);
 		*stylesheet = NULL;
 		return NULL;
 	}
@@ -181,15 +227,28 @@ static xmlDoc *apply_xslt_path_internal(struct oscap_source *source, const char
 
 }
 
+int oscap_xml_doc_apply_xslt_path(xmlDoc *doc, const char *xsltfile, const char *outfile, const char **params, const char *path_to_xslt)
+{
+	xsltStylesheet *stylesheet = NULL;
+	const char *origin = (doc != NULL && doc->URL != NULL) ? (const char *) doc->URL : "in-memory document";
+	xmlDocPtr transformed = apply_xslt_path_internal(doc, origin, xsltfile, params, path_to_xslt, &stylesheet);
+	if (transformed == NULL) {
+		return -1;
+	}
+	int ret = save_stylesheet_result_to_file(transformed, stylesheet, outfile);
+	xmlFreeDoc(transformed);
+	return ret;
+}
+
 int oscap_source_apply_xslt_path(struct oscap_source *source, const char *xsltfile, const char *outfile, const char **params, const char *path_to_xslt)
 {
 	xsltStylesheet *stylesheet = NULL;
-	xmlDocPtr transformed = apply_xslt_path_internal(source, xsltfile, params, path_to_xslt, &stylesheet);
+	xmlDocPtr transformed = apply_xslt_path_internal(oscap_source_get_xmlDoc(source), oscap_source_readable_origin(source),
+			xsltfile, params, path_to_xslt, &stylesheet);
 	if (transformed == NULL) {
 		return -1;
 	}
 	int ret = save_stylesheet_result_to_file(transformed, stylesheet, outfile);
-	xsltFreeStylesheet(stylesheet);
 	xmlFreeDoc(transformed);
 	return ret;
 }
@@ -197,7 +256,8 @@ int oscap_source_apply_xslt_path(struct oscap_source *source, const char *xsltfi
 char *oscap_source_apply_xslt_path_mem(struct oscap_source *source, const char *xsltfile, const char **params, const char *path_to_xslt)
 {
 	xsltStylesheet *stylesheet = NULL;
-	xmlDocPtr transformed = apply_xslt_path_internal(source, xsltfile, params, path_to_xslt, &stylesheet);
+	xmlDocPtr transformed = apply_xslt_path_internal(oscap_source_get_xmlDoc(source), oscap_source_readable_origin(source),
+			xsltfile, params, path_to_xslt, &stylesheet);
 	if (transformed == NULL) {
 		return NULL;
 	}
@@ -209,5 +269,6 @@ char *oscap_source_apply_xslt_path_mem(struct oscap_source *source, const char *
 		oscap_free(result);
 		result = NULL;
 	}
+	xmlFreeDoc(transformed);
 	return (char *)result;
 }
@@ -25,6 +25,8 @@
 #include <config.h>
 #endif
 
+#include <libxml/tree.h>
+
 #include "common/public/oscap.h"
 #include "common/util.h"
 #include "source/public/oscap_source.h"
@@ -56,5 +58,25 @@ int oscap_source_apply_xslt_path(struct oscap_source *source, const char *xsltfi
  */
 char *oscap_source_apply_xslt_path_mem(struct oscap_source *source, const char *xsltfile, const char **params, const char *path_to_xslt);
 
+/**
+ * Apply stylesheet on an XML document which is already in memory, no
+ * oscap_source is needed. If xsltfile is an absolute path to the
+ * stylesheet, path_to_xslt will not be used.
+ * @param doc document to transform, the XCCDF namespace workaround may modify it
+ * @param xsltfile absolute path to the stylesheet document or relative given the path_to_xslt
+ * @param outfile output filename, stdout if NULL
+ * @param params external params for xsl transformation
+ * @param path_to_xslt optional path to xsl transformations
+ * @returns 0 on success
+ */
+int oscap_xml_doc_apply_xslt_path(xmlDoc *doc, const char *xsltfile, const char *outfile, const char **params, const char *path_to_xslt);
+
+/**
+ * Drop all the compiled stylesheets. The stylesheets are compiled once per
+ * path and kept for the next transformations. No transformation may be
+ * running when this is called.
+ */
+void oscap_xslt_cache_clear(void);
+
 OSCAP_HIDDEN_END;
 #endif
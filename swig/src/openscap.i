@@ -555,5 +555,74 @@ char * oscap_text_xccdf_substitute_py(const char *text, PyObject *func, PyObject
     return oscap_text_xccdf_substitute(text, sub_callback_wrapper, (void *)new_usrdata);
 }
 
+/*
+ * The summaries of all the rule-results as (ids, data): a tuple of the
+ * rule ids and a bytes object of native int64 rows (result, severity,
+ * time), e.g. numpy.frombuffer(data, dtype=numpy.int64).reshape(-1, 3).
+ */
+PyObject *xccdf_result_get_rule_result_records_py(struct xccdf_result *result) {
+    struct xccdf_rule_result_record *records;
+    PyObject *ids, *data, *ret;
+    int64_t *rows;
+    size_t count, i;
+
+    count = xccdf_result_get_rule_result_records(result, &records);
+    ids = PyTuple_New(count);
+    data = PyBytes_FromStringAndSize(NULL, count * 3 * sizeof(int64_t));
+    if (ids == NULL || data == NULL) {
+        Py_XDECREF(ids);
+        Py_XDECREF(data);
+        free(records);
+        return NULL;
+    }
+
+    rows = (int64_t *) PyBytes_AsString(data);
+    for (i = 0; i < count; i++) {
+        PyTuple_SET_ITEM(ids, i, SWIG_FromCharPtr(records[i].idref));
+        rows[i * 3]     = records[i].result;
+        rows[i * 3 + 1] = records[i].severity;
+        rows[i * 3 + 2] = records[i].time;
+    }
+    free(records);
+
+    ret = PyTuple_Pack(2, ids, data);
+    Py_DECREF(ids);
+    Py_DECREF(data);
+    return ret;
+}
+
+/*
+ * The summaries of all the definition results as (ids, data): a tuple of
+ * the definition ids and a bytes object of their results as native int64.
+ */
+PyObject *oval_result_system_get_definition_records_py(struct oval_result_system *sys) {
+    struct oval_result_definition_record *records;
+    PyObject *ids, *data, *ret;
+    int64_t *rows;
+    size_t count, i;
+
+    count = oval_result_system_get_definition_records(sys, &records);
+    ids = PyTuple_New(count);
+    data = PyBytes_FromStringAndSize(NULL, count * sizeof(int64_t));
+    if (ids == NULL || data == NULL) {
+        Py_XDECREF(ids);
+        Py_XDECREF(data);
+        free(records);
+        return NULL;
+    }
+
+    rows = (int64_t *) PyBytes_AsString(data);
+    for (i = 0; i < count; i++) {
+        PyTuple_SET_ITEM(ids, i, SWIG_FromCharPtr(records[i].id));
+        rows[i] = records[i].result;
+    }
+    free(records);
+
+    ret = PyTuple_Pack(2, ids, data);
+    Py_DECREF(ids);
+    Py_DECREF(data);
+    return ret;
+}
+
 %}
 #endif
@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
+#include <stdint.h>
 #include <cvss_score.h>
 
 static void print_score(float s)
@@ -12,10 +13,130 @@ static void print_score(float s)
     else printf("/%.1f", s);
 }
 
+static int print_packed(const char *vector)
+{
+    uint64_t packed;
+    float s;
+
+    if (!cvss_vector_pack(vector, &packed)) {
+        printf("NULL");
+        return 0;
+    }
+
+    cvss_packed_scores(&packed, 1, CVSS_BASE, &s);
+    print_score(s);
+    cvss_packed_scores(&packed, 1, CVSS_TEMPORAL, &s);
+    print_score(s);
+    cvss_packed_scores(&packed, 1, CVSS_ENVIRONMENTAL, &s);
+    print_score(s);
+    printf("/\n");
+
+    return 0;
+}
+
+static const char *AV[] = { "L", "A", "N", NULL };
+static const char *AC[] = { "H", "M", "L", NULL };
+static const char *AU[] = { "M", "S", "N", NULL };
+static const char *CIA[] = { "N", "P", "C", NULL };
+static const char *E[] = { "U", "POC", "F", "H", "ND", NULL };
+static const char *RL[] = { "OF", "TF", "W", "U", "ND", NULL };
+static const char *RC[] = { "UC", "UR", "C", "ND", NULL };
+static const char *CDP[] = { "N", "L", "LM", "MH", "H", "ND", NULL };
+static const char *TD[] = { "N", "L", "M", "H", "ND", NULL };
+static const char *REQ[] = { "L", "M", "H", "ND", NULL };
+
+#define SAME_SCORE(a, b) ((isnan(a) && isnan(b)) || (a) == (b))
+
+// score the vectors both ways, the packed ones in one array
+static int check_packed(char **vectors, size_t count)
+{
+    static const enum cvss_category categories[] = { CVSS_BASE, CVSS_TEMPORAL, CVSS_ENVIRONMENTAL };
+    uint64_t *packed = malloc(count * sizeof(uint64_t));
+    float *scores = malloc(count * sizeof(float));
+    size_t i, c;
+    int ret = 0;
+
+    for (i = 0; i < count; ++i) {
+        struct cvss_impact *imp = cvss_impact_new_from_vector(vectors[i]);
+        if (imp == NULL || !cvss_vector_pack(vectors[i], &packed[i]) || cvss_impact_pack(imp) != packed[i]) {
+            fprintf(stderr, "%s: packing failed\n", vectors[i]);
+            ret = 1;
+        }
+        cvss_impact_free(imp);
+    }
+
+    for (c = 0; c < sizeof(categories) / sizeof(categories[0]); ++c) {
+        cvss_packed_scores(packed, count, categories[c], scores);
+        for (i = 0; i < count; ++i) {
+            struct cvss_impact *imp = cvss_impact_new_from_vector(vectors[i]);
+            float s = NAN;
+            if (imp == NULL) continue;
+            switch (categories[c]) {
+                case CVSS_BASE:          s = cvss_impact_base_score(imp); break;
+                case CVSS_TEMPORAL:      s = cvss_impact_temporal_score(imp); break;
+                case CVSS_ENVIRONMENTAL: s = cvss_impact_environmental_score(imp); break;
+                default: break;
+            }
+            if (!SAME_SCORE(s, scores[i])) {
+                fprintf(stderr, "%s: packed score %.1f, score %.1f\n", vectors[i], scores[i], s);
+                ret = 1;
+            }
+            cvss_impact_free(imp);
+        }
+    }
+
+    free(scores);
+    free(packed);
+    return ret;
+}
+
+/*
+ * Every base vector, alone, with every temporal suffix, and with the
+ * environmental suffixes after a fixed temporal one. The requirements
+ * take every value, but not in every combination.
+ */
+static int check_packed_all(void)
+{
+    const char **av, **ac, **au, **c, **i, **a, **e, **rl, **rc, **cdp, **td;
+    char **vectors = malloc(sizeof(char *) * 729 * (1 + 100 + 120));
+    char base[32], buf[128];
+    size_t count = 0, n;
+    int ret;
+
+    for (av = AV; *av; ++av) for (ac = AC; *ac; ++ac) for (au = AU; *au; ++au)
+    for (c = CIA; *c; ++c) for (i = CIA; *i; ++i) for (a = CIA; *a; ++a) {
+        snprintf(base, sizeof(base), "AV:%s/AC:%s/Au:%s/C:%s/I:%s/A:%s", *av, *ac, *au, *c, *i, *a);
+        vectors[count++] = strdup(base);
+        for (e = E; *e; ++e) for (rl = RL; *rl; ++rl) for (rc = RC; *rc; ++rc) {
+            snprintf(buf, sizeof(buf), "%s/E:%s/RL:%s/RC:%s", base, *e, *rl, *rc);
+            vectors[count++] = strdup(buf);
+        }
+        for (cdp = CDP; *cdp; ++cdp) for (td = TD; *td; ++td) for (n = 0; n < 4; ++n) {
+            snprintf(buf, sizeof(buf), "%s/E:F/RL:W/RC:UR/CDP:%s/TD:%s/CR:%s/IR:%s/AR:%s",
+                     base, *cdp, *td, REQ[n], REQ[(n + 1) % 4], REQ[(n + 2) % 4]);
+            vectors[count++] = strdup(buf);
+        }
+    }
+
+    ret = check_packed(vectors, count);
+    printf("%zu vectors\n", count);
+
+    for (n = 0; n < count; ++n)
+        free(vectors[n]);
+    free(vectors);
+    return ret;
+}
+
 int main(int argc, char *argv[])
 {
+    if (argc == 2 && strcmp(argv[1], "--packed-all") == 0)
+        return check_packed_all();
+
+    if (argc == 3 && strcmp(argv[1], "--packed") == 0)
+        return print_packed(argv[2]);
+
     if (argc != 2) {
-        fprintf(stderr, "Usage: %s cvss_vector\n", argv[0]);
+        fprintf(stderr, "Usage: %s [--packed] cvss_vector | --packed-all\n", argv[0]);
         return -1;
     }
 
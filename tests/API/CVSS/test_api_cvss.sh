@@ -31,11 +31,28 @@ function test_api_cvss_vector {
     return $ret
 }
 
+# check packed vectors against expected value and the unpacked scores
+function test_api_cvss_packed {
+    local ret vector value v
+    ret=0
+
+    while read vector value; do
+        v=`./test_api_cvss --packed $vector`
+        [ "$value" != "$v" ] && ret=1
+        echo "$vector --> $v ($value)"
+    done <vectors.txt
+
+    ./test_api_cvss --packed-all || ret=1
+
+    return $ret
+}
+
 # Testing.
 
 test_init "test_api_cvss.log"
 
 test_run "test_api_cvss_vector" test_api_cvss_vector
+test_run "test_api_cvss_packed" test_api_cvss_packed
 
 test_exit 
 
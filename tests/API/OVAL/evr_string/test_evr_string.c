@@ -0,0 +1,120 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "OVAL/results/oval_cmp_evr_string_impl.h"
+
+/* Test vectors: expected result of comparing a with b */
+struct evr_test {
+	const char *a;
+	const char *b;
+	int result;
+};
+
+static const struct evr_test tests[] = {
+	{ "1.0-1", "1.0-1", 0 },
+	{ "1.0-2", "1.0-10", -1 },
+	{ "10-1", "9-1", 1 },
+	{ "1.01-1", "1.1-1", 0 },
+	{ "1.0-1", "1_0-1", 0 },
+	{ "1.a-1", "1.1-1", -1 },
+	{ "1.0a-1", "1.0-1", 1 },
+	/* epoch */
+	{ "1:1.0-1", "2.0-1", 1 },
+	{ "1:1.0-1", "2:0.1-1", -1 },
+	{ "0:1.0-1", "1.0-1", 1 },
+	{ ":1.0-1", "0:1.0-1", 0 },
+	{ "007:1.0-1", "7:1.0-1", 0 },
+	/* release */
+	{ "1.0", "1.0-1", -1 },
+	{ "1.0-1.el7", "1.0-1", 1 },
+	{ "1.0-1a", "1.0-1", 1 },
+	{ "1.0-0.1-1", "1.0-0.1-2", -1 },
+	/* version must not run into the release */
+	{ "1.0-1", "1.0.1-1", -1 },
+	{ "1.0-9", "1.0.0-1", -1 },
+	/* tilde */
+	{ "1.0~rc1-1", "1.0~rc1-1", 0 },
+	{ "1.0~rc1-1", "1.0~rc2-1", -1 },
+#ifdef HAVE_RPMVERCMP
+	{ "1.0~rc1-1", "1.0-1", -1 },
+#else
+	/* the bundled rpmvercmp() treats tilde as a separator */
+	{ "1.0~rc1-1", "1.0-1", 1 },
+#endif
+};
+
+#define COUNT (sizeof(tests) / sizeof(tests[0]))
+
+/* Test vectors of the operations: state, sys, operation, result */
+struct evr_op_test {
+	const char *state;
+	const char *sys;
+	oval_operation_t operation;
+	oval_result_t result;
+};
+
+static const struct evr_op_test op_tests[] = {
+	{ "1.0-1", "1.0-2", OVAL_OPERATION_EQUALS, OVAL_RESULT_FALSE },
+	{ "1.0-1", "1.0-2", OVAL_OPERATION_NOT_EQUAL, OVAL_RESULT_TRUE },
+	{ "1.0-1", "1.0-2", OVAL_OPERATION_GREATER_THAN, OVAL_RESULT_TRUE },
+	{ "1.0-1", "1.0-2", OVAL_OPERATION_LESS_THAN, OVAL_RESULT_FALSE },
+	{ "1.0-1", "1.0-1", OVAL_OPERATION_GREATER_THAN_OR_EQUAL, OVAL_RESULT_TRUE },
+	{ "1.0-1", "1.0-1", OVAL_OPERATION_LESS_THAN_OR_EQUAL, OVAL_RESULT_TRUE },
+	{ "1:1.0-1", "2.0-1", OVAL_OPERATION_LESS_THAN, OVAL_RESULT_TRUE },
+	{ "1.0-1", "1.0-1", OVAL_OPERATION_PATTERN_MATCH, OVAL_RESULT_ERROR },
+};
+
+#define OP_COUNT (sizeof(op_tests) / sizeof(op_tests[0]))
+
+static int test_evr_cmp(const struct evr_test *t)
+{
+	struct oval_evr a, b;
+	int result, reverse;
+
+	oval_evr_parse(t->a, &a);
+	oval_evr_parse(t->b, &b);
+	result = oval_evr_cmp(&a, &b);
+	reverse = oval_evr_cmp(&b, &a);
+	if (result != t->result || reverse != -t->result) {
+		printf("\tFAIL\t%s\t%s\t%d\t%d\t%d\n", t->a, t->b, result, reverse, t->result);
+		return 0;
+	}
+	printf("\tPASS\t%s\t%s\t%d\t%d\t%d\n", t->a, t->b, result, reverse, t->result);
+	return 1;
+}
+
+static int test_evr_string_cmp(const struct evr_op_test *t)
+{
+	oval_result_t result;
+
+	result = oval_evr_string_cmp(t->state, t->sys, t->operation);
+	if (result != t->result) {
+		printf("\tFAIL\t%s\t%s\t%d\t%d\t%d\n", t->state, t->sys, t->operation, result, t->result);
+		return 0;
+	}
+	printf("\tPASS\t%s\t%s\t%d\t%d\t%d\n", t->state, t->sys, t->operation, result, t->result);
+	return 1;
+}
+
+int main(int argc, char *argv[])
+{
+	size_t i;
+	int retval = 0;
+
+	printf("Result\tA\tB\tA<=>B\tB<=>A\tExpected\n");
+	for (i = 0; i < COUNT; i++) {
+		if (!test_evr_cmp(&tests[i]))
+			retval = 1;
+	}
+	printf("Result\tState\tSys\tOperation\tOutput\tExpected\n");
+	for (i = 0; i < OP_COUNT; i++) {
+		if (!test_evr_string_cmp(&op_tests[i]))
+			retval = 1;
+	}
+
+	return retval;
+}
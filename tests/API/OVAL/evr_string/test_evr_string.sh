@@ -0,0 +1,19 @@
+#!/usr/bin/env bash
+
+# OpenScap Test Suite
+#
+# Compare EVR strings the way rpminfo and dpkginfo states do.
+
+. ../../../test_common.sh
+
+# Test cases.
+
+function test_evr_string {
+    ./test_evr_string
+}
+
+# Testing.
+
+test_init "test_evr_string.log"
+test_run "test_evr_string" test_evr_string
+test_exit
@@ -0,0 +1,90 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "oval_agent_api.h"
+#include "oval_results.h"
+#include "oval_system_characteristics.h"
+#include "oscap.h"
+#include "oscap_error.h"
+#include "oscap_source.h"
+
+/*
+ * Evaluates the definitions of argv[1] in the modes given by the following
+ * arguments, prints the result of every definition and exports the system
+ * characteristics to argv[2]. The modes which leave the results thin can't
+ * be tested by oscap oval eval, it doesn't export the items then.
+ */
+static int report(const struct oval_result_definition *res_def, void *arg)
+{
+	printf("Definition %s: %s\n",
+	       oval_result_definition_get_id(res_def),
+	       oval_result_get_text(oval_result_definition_get_result(res_def)));
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	struct oval_definition_model *model;
+	struct oval_result_system_iterator *systems;
+	struct oval_syschar_model *syschar = NULL;
+	oval_agent_session_t *session;
+	struct oscap_source *source;
+	int i, ret = 1;
+
+	if (argc < 3) {
+		fprintf(stderr, "Usage: %s <oval> <syschar> [short-circuit|release-items]...\n", argv[0]);
+		return 2;
+	}
+
+	source = oscap_source_new_from_file(argv[1]);
+	model = oval_definition_model_import_source(source);
+	oscap_source_free(source);
+	if (model == NULL)
+		return 1;
+
+	session = oval_agent_new_session(model, "eval_modes");
+	if (session == NULL) {
+		oval_definition_model_free(model);
+		return 1;
+	}
+
+	for (i = 3; i < argc; ++i) {
+		if (strcmp(argv[i], "short-circuit") == 0) {
+			oval_agent_set_short_circuit(session, true);
+		} else if (strcmp(argv[i], "release-items") == 0) {
+			oval_agent_set_release_items(session, true);
+		} else {
+			fprintf(stderr, "Unknown mode '%s'\n", argv[i]);
+			goto cleanup;
+		}
+	}
+
+	if (oval_agent_eval_system(session, report, NULL) != 0)
+		goto cleanup;
+
+	systems = oval_results_model_get_systems(oval_agent_get_results_model(session));
+	if (oval_result_system_iterator_has_more(systems))
+		syschar = oval_result_system_get_syschar_model(oval_result_system_iterator_next(systems));
+	oval_result_system_iterator_free(systems);
+
+	if (syschar != NULL && oval_syschar_model_export(syschar, argv[2]) >= 0)
+		ret = 0;
+
+cleanup:
+	if (oscap_err()) {
+		char *err = oscap_err_get_full_error();
+		fprintf(stderr, "%s\n", err);
+		free(err);
+	}
+
+	oval_agent_destroy_session(session);
+	oval_definition_model_free(model);
+	oscap_cleanup();
+
+	return ret;
+}
@@ -25,6 +25,13 @@ function test_api_oval_syschar {
 	$srcdir/system-characteristics.xml
 }
 
+function test_api_oval_syschar_binary {
+    ./test_api_syschar_binary $srcdir/composed-oval.xml \
+	$srcdir/system-characteristics.xml \
+	exported-syschar.xml exported-syschar-binary.xml
+    cmp exported-syschar.xml exported-syschar-binary.xml
+}
+
 function test_api_oval_results {
     ./test_api_results $srcdir/results.xml exported-results.xml
     cmp $srcdir/results-good.xml exported-results.xml
@@ -35,13 +42,87 @@ function test_api_oval_directives {
     cmp $srcdir/directives.xml exported-directives.xml
 }
 
+# the sessions of one process with different roots don't share the probes
+function test_api_oval_probe_roots {
+    local first=$(mktemp -d -t probe_roots.XXXXXX)
+    local second=$(mktemp -d -t probe_roots.XXXXXX)
+    local ret=0
+
+    touch $second/flag
+    ./test_api_probe_roots $srcdir/probe_roots.xml oval:moc.elpmaxe.www:def:1 \
+	$first $second > probe_roots.out || ret=1
+    [ "$(cat probe_roots.out)" == "$(printf 'false\ntrue')" ] || ret=1
+
+    rm -rf $first $second
+    return $ret
+}
+
+# the short-circuit evaluation gives the results of the complete one, it
+# only leaves out the objects which aren't needed
+function test_api_oval_short_circuit {
+    local dir=$(mktemp -d -t short_circuit.XXXXXX)
+    local objects="oval:x:obj:1 oval:x:obj:2 oval:x:obj:4"
+    local ret=0
+
+    mkdir $dir/files $dir/files/d
+    echo "line 1" > $dir/files/f1
+    touch $dir/files/f2 $dir/files/d/f3
+    sed "s|@DIR@|$dir/files|" $srcdir/short_circuit.xml > $dir/short_circuit.xml
+
+    ./test_api_eval_modes $dir/short_circuit.xml $dir/syschar.xml > $dir/out || ret=1
+    ./test_api_eval_modes $dir/short_circuit.xml $dir/syschar_short.xml short-circuit > $dir/out_short || ret=1
+    diff $dir/out $dir/out_short || ret=1
+    grep -q "^Definition oval:x:def:4: true$" $dir/out_short || ret=1
+
+    # the walk of the directory is left out
+    [ "$($XPATH $dir/syschar.xml 'count(//collected_objects/object[@id="oval:x:obj:3"])' 2>/dev/null)" == "1" ] || ret=1
+    [ "$($XPATH $dir/syschar_short.xml 'count(//collected_objects/object[@id="oval:x:obj:3"])' 2>/dev/null)" == "0" ] || ret=1
+    [ "$(oval_items $dir/syschar.xml $objects)" == "$(oval_items $dir/syschar_short.xml $objects)" ] || ret=1
+
+    rm -rf $dir
+    return $ret
+}
+
+# the released items leave the results of the complete evaluation, the
+# objects read by a set object or a variable keep their items
+function test_api_oval_release_items {
+    local dir=$(mktemp -d -t release_items.XXXXXX)
+    local obj ret=0
+
+    mkdir $dir/files
+    touch $dir/files/f1 $dir/files/f4 $dir/files/f5
+    echo "value=abc" > $dir/files/f2
+    echo "abc" > $dir/files/f3
+    sed "s|@DIR@|$dir/files|" $srcdir/release_items.xml > $dir/release_items.xml
+
+    ./test_api_eval_modes $dir/release_items.xml $dir/syschar.xml > $dir/out || ret=1
+    ./test_api_eval_modes $dir/release_items.xml $dir/syschar_released.xml release-items > $dir/out_released || ret=1
+    diff $dir/out $dir/out_released || ret=1
+    [ "$(grep -c ': true$' $dir/out_released)" == "3" ] || ret=1
+
+    # obj:5 shares its item with the released set object obj:6
+    [ "$(oval_items $dir/syschar.xml oval:x:obj:2 oval:x:obj:5)" == \
+      "$(oval_items $dir/syschar_released.xml oval:x:obj:2 oval:x:obj:5)" ] || ret=1
+    for obj in oval:x:obj:1 oval:x:obj:3 oval:x:obj:6 oval:x:obj:7; do
+        [ "$($XPATH $dir/syschar.xml 'count(//collected_objects/object[@id="'$obj'"])' 2>/dev/null)" == "1" ] || ret=1
+        [ "$($XPATH $dir/syschar_released.xml 'count(//collected_objects/object[@id="'$obj'"])' 2>/dev/null)" == "0" ] || ret=1
+    done
+
+    rm -rf $dir
+    return $ret
+}
+
 # Testing.
 
 test_init "test_api_oval.log"
 
 test_run "test_api_oval_definition" test_api_oval_definition
 test_run "test_api_oval_syschar" test_api_oval_syschar
+test_run "test_api_oval_syschar_binary" test_api_oval_syschar_binary
 test_run "test_api_oval_results" test_api_oval_results
 test_run "test_api_oval_directives" test_api_oval_directives
+test_run "test_api_oval_probe_roots" test_api_oval_probe_roots
+test_run "test_api_oval_short_circuit" test_api_oval_short_circuit
+test_run "test_api_oval_release_items" test_api_oval_release_items
 
 test_exit
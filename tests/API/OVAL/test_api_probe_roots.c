@@ -0,0 +1,75 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "oval_agent_api.h"
+#include "oval_results.h"
+#include "oscap.h"
+#include "oscap_error.h"
+#include "oscap_source.h"
+
+/*
+ * Evaluates the definition argv[2] of argv[1] in the root argv[3], then in
+ * the root argv[4] by a second session while the first one is still open,
+ * and prints both results. The sessions mustn't share the probes.
+ */
+static oval_agent_session_t *evaluate(struct oval_definition_model *model, const char *root, const char *id)
+{
+	oval_agent_session_t *session;
+	oval_result_t result = OVAL_RESULT_NOT_EVALUATED;
+
+	if (setenv("OSCAP_PROBE_ROOT", root, 1) != 0)
+		return NULL;
+
+	session = oval_agent_new_session(model, root);
+	if (session == NULL)
+		return NULL;
+
+	if (oval_agent_eval_definition(session, id) == -1
+	    || oval_agent_get_definition_result(session, id, &result) != 0) {
+		oval_agent_destroy_session(session);
+		return NULL;
+	}
+
+	printf("%s\n", oval_result_get_text(result));
+	return session;
+}
+
+int main(int argc, char **argv)
+{
+	struct oval_definition_model *model;
+	oval_agent_session_t *first, *second;
+	struct oscap_source *source;
+
+	if (argc != 5) {
+		fprintf(stderr, "Usage: %s <oval> <definition> <root> <root>\n", argv[0]);
+		return 2;
+	}
+
+	source = oscap_source_new_from_file(argv[1]);
+	model = oval_definition_model_import_source(source);
+	oscap_source_free(source);
+	if (model == NULL)
+		return 1;
+
+	first = evaluate(model, argv[3], argv[2]);
+	second = first != NULL ? evaluate(model, argv[4], argv[2]) : NULL;
+
+	if (oscap_err()) {
+		char *err = oscap_err_get_full_error();
+		fprintf(stderr, "%s\n", err);
+		free(err);
+	}
+
+	if (second != NULL)
+		oval_agent_destroy_session(second);
+	if (first != NULL)
+		oval_agent_destroy_session(first);
+	oval_definition_model_free(model);
+	oscap_cleanup();
+
+	return second != NULL ? 0 : 1;
+}
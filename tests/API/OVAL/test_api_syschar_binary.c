@@ -0,0 +1,198 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Converts system characteristics from XML to the binary format and back,
+ * the XML exports of both models are compared by test_api_oval.sh. Every
+ * truncated copy of the binary file has to be refused, and the corrupted
+ * copies have to be either refused or imported, without crashing.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include "oval_agent_api.h"
+#include "oscap.h"
+#include "oscap_error.h"
+#include "oscap_source.h"
+
+#define BINARY_FILE "syschar-binary.bin"
+#define DAMAGED_FILE "syschar-binary-damaged.bin"
+
+static double _elapsed(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static long _file_size(const char *file)
+{
+	struct stat st;
+
+	return stat(file, &st) == 0 ? (long) st.st_size : -1;
+}
+
+static int _write_file(const char *file, const char *data, size_t size)
+{
+	FILE *fp = fopen(file, "wb");
+
+	if (fp == NULL)
+		return -1;
+	if (fwrite(data, 1, size, fp) != size) {
+		fclose(fp);
+		return -1;
+	}
+	return fclose(fp);
+}
+
+static int _import_damaged(struct oval_definition_model *def_model, const char *data, size_t size)
+{
+	struct oval_syschar_model *model;
+	int ret;
+
+	if (_write_file(DAMAGED_FILE, data, size) != 0) {
+		fprintf(stderr, "Can't write '%s'.\n", DAMAGED_FILE);
+		exit(1);
+	}
+	model = oval_syschar_model_new(def_model);
+	ret = oval_syschar_model_import_binary(model, DAMAGED_FILE);
+	oval_syschar_model_free(model);
+	oscap_clearerr();
+	return ret;
+}
+
+int main(int argc, char **argv)
+{
+	struct oval_definition_model *def_model;
+	struct oval_syschar_model *model;
+	struct oscap_source *source;
+	struct timespec start;
+	double xml_time, bin_time;
+	char *data;
+	size_t size, i, step;
+	FILE *fp;
+	int ret = 0;
+
+	if (argc != 5) {
+		printf("USAGE: %s <oval_definitions.xml> <system_characteristics.xml> <exported.xml> <roundtrip.xml>\n", argv[0]);
+		return 1;
+	}
+
+	source = oscap_source_new_from_file(argv[1]);
+	def_model = oval_definition_model_import_source(source);
+	oscap_source_free(source);
+	if (def_model == NULL) {
+		fprintf(stderr, "Can't import '%s': %s\n", argv[1], oscap_err_desc());
+		return 1;
+	}
+
+	/* XML to binary */
+	model = oval_syschar_model_new(def_model);
+	source = oscap_source_new_from_file(argv[2]);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if (oval_syschar_model_import_source(model, source) != 0) {
+		fprintf(stderr, "Can't import '%s': %s\n", argv[2], oscap_err_desc());
+		return 1;
+	}
+	xml_time = _elapsed(&start);
+	oscap_source_free(source);
+	if (oval_syschar_model_export(model, argv[3]) < 0) {
+		fprintf(stderr, "Can't export '%s': %s\n", argv[3], oscap_err_desc());
+		return 1;
+	}
+	if (oval_syschar_model_export_binary(model, BINARY_FILE) != 0) {
+		fprintf(stderr, "Can't export '%s': %s\n", BINARY_FILE, oscap_err_desc());
+		return 1;
+	}
+	oval_syschar_model_free(model);
+
+	if (!oval_syschar_model_is_binary(BINARY_FILE) || oval_syschar_model_is_binary(argv[2])) {
+		fprintf(stderr, "The format of the files isn't recognized.\n");
+		return 1;
+	}
+
+	/* binary to XML */
+	model = oval_syschar_model_new(def_model);
+	source = oscap_source_new_from_file(BINARY_FILE);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if (oval_syschar_model_import_source(model, source) != 0) {
+		fprintf(stderr, "Can't import '%s': %s\n", BINARY_FILE, oscap_err_desc());
+		return 1;
+	}
+	bin_time = _elapsed(&start);
+	oscap_source_free(source);
+	if (oval_syschar_model_export(model, argv[4]) < 0) {
+		fprintf(stderr, "Can't export '%s': %s\n", argv[4], oscap_err_desc());
+		return 1;
+	}
+	oval_syschar_model_free(model);
+
+	printf("XML: %ld bytes, imported in %.3f ms\n", _file_size(argv[2]), xml_time * 1000);
+	printf("binary: %ld bytes, imported in %.3f ms\n", _file_size(BINARY_FILE), bin_time * 1000);
+
+	fp = fopen(BINARY_FILE, "rb");
+	size = (size_t) _file_size(BINARY_FILE);
+	data = malloc(size);
+	if (fp == NULL || data == NULL || fread(data, 1, size, fp) != size) {
+		fprintf(stderr, "Can't read '%s'.\n", BINARY_FILE);
+		return 1;
+	}
+	fclose(fp);
+
+	/* the format ends by a tag, so every prefix lacks it */
+	step = size / 512 + 1;
+	for (i = 0; i < size; i += (i < 256 ? 1 : step)) {
+		if (_import_damaged(def_model, data, i) == 0) {
+			fprintf(stderr, "The binary file truncated to %zu bytes was imported.\n", i);
+			ret = 1;
+		}
+	}
+
+	/* the damaged bytes may still give a valid file, but must not crash the reader */
+	for (i = 0; i < size; i += (i < 256 ? 1 : step)) {
+		static const char patterns[] = { 0x00, 0x7f, (char) 0x80, (char) 0xff };
+
+		for (size_t j = 0; j < sizeof(patterns); ++j) {
+			char orig = data[i];
+
+			data[i] = patterns[j];
+			_import_damaged(def_model, data, size);
+			data[i] = orig;
+		}
+	}
+
+	/* damaged magic and version */
+	data[0] ^= 0xff;
+	if (_import_damaged(def_model, data, size) == 0) {
+		fprintf(stderr, "The binary file with damaged magic was imported.\n");
+		ret = 1;
+	}
+
+	remove(DAMAGED_FILE);
+	remove(BINARY_FILE);
+	free(data);
+	oval_definition_model_free(def_model);
+	oscap_cleanup();
+	return ret;
+}
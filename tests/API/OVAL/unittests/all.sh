@@ -34,4 +34,7 @@ test_run "test platform schema version" $srcdir/test_platform_version.sh
 test_run "state entity check_existence attribute" $srcdir/test_state_check_existence.sh
 test_run "skip validation" $srcdir/test_skip_valid.sh
 test_run "object component data type evaluation" $srcdir/test_object_component_type.sh
+test_run "scheduling of independent objects (--jobs)" $srcdir/test_jobs.sh
+test_run "evaluation of the tests by several threads (analyse --jobs)" $srcdir/test_analyse_jobs.sh
+test_run "incremental collection (OSCAP_INCREMENTAL)" $srcdir/test_incremental.sh
 test_exit
@@ -0,0 +1,31 @@
+#!/bin/bash
+
+set -e -o pipefail
+
+name=$(basename $0 .sh)
+result=$(mktemp ${name}.out.XXXXXX)
+result_jobs=$(mktemp ${name}.out.XXXXXX)
+stderr=$(mktemp ${name}.err.XXXXXX)
+
+# The states of the odd tests mask the values of the items shared with others
+$OSCAP oval analyse --jobs 1 --results $result $srcdir/$name.oval.xml $srcdir/$name.syschar.xml 2> $stderr
+[ ! -s $stderr ]
+sed -i 's|<oval:timestamp>[^<]*</oval:timestamp>||' $result
+
+# The tests evaluated by several threads give the same results
+for jobs in 2 8; do
+	$OSCAP oval analyse --jobs $jobs --results $result_jobs $srcdir/$name.oval.xml $srcdir/$name.syschar.xml 2> $stderr
+	[ ! -s $stderr ]
+	sed -i 's|<oval:timestamp>[^<]*</oval:timestamp>||' $result_jobs
+	diff $result $result_jobs
+done
+
+for def in 1 2 4 5 7 8; do
+	assert_exists 1 '/oval_results/results/system/definitions/definition[@definition_id="oval:x:def:'$def'"][@result="true"]'
+done
+for def in 3 6; do
+	assert_exists 1 '/oval_results/results/system/definitions/definition[@definition_id="oval:x:def:'$def'"][@result="false"]'
+done
+assert_exists 5 '/oval_results/results/system/oval_system_characteristics/system_data/*/*[local-name()="value"][@mask="true"]'
+
+rm $result $result_jobs $stderr
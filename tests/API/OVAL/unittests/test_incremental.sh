@@ -0,0 +1,38 @@
+#!/bin/bash
+
+# The objects reused by OSCAP_INCREMENTAL give the results and the items of
+# a complete collection, a changed input is collected again.
+
+set -e
+set -o pipefail
+
+name=$(basename $0 .sh)
+dir=$(mktemp -d)
+objects="oval:x:obj:1 oval:x:obj:2 oval:x:obj:3 oval:x:obj:4"
+
+mkdir $dir/files $dir/state
+touch $dir/files/f1
+echo "value=a" > $dir/files/f2
+echo "value=1" > $dir/files/f3
+sed "s|@DIR@|$dir/files|" $srcdir/$name.oval.xml > $dir/$name.oval.xml
+# the inputs changed in the second the evaluation started aren't stamped
+sleep 1
+
+OSCAP_INCREMENTAL=$dir/state $OSCAP oval eval --results $dir/incr1.xml $dir/$name.oval.xml > $dir/incr1.out
+$OSCAP oval eval --results $dir/full1.xml $dir/$name.oval.xml > $dir/full1.out
+diff $dir/full1.out $dir/incr1.out
+[ "$(oval_items $dir/full1.xml $objects)" == "$(oval_items $dir/incr1.xml $objects)" ]
+
+echo "value=2" > $dir/files/f3
+OSCAP_INCREMENTAL=$dir/state $OSCAP oval eval --verbose INFO --verbose-log-file $dir/incr2.log \
+	--results $dir/incr2.xml $dir/$name.oval.xml > $dir/incr2.out
+grep -q "Reusing the system characteristics of object 'oval:x:obj:1'" $dir/incr2.log
+grep -q "Reusing the system characteristics of object 'oval:x:obj:2'" $dir/incr2.log
+grep -q "Object 'oval:x:obj:4' has to be collected again" $dir/incr2.log
+
+$OSCAP oval eval --results $dir/full2.xml $dir/$name.oval.xml > $dir/full2.out
+diff $dir/full2.out $dir/incr2.out
+grep -q "^Definition oval:x:def:2: false$" $dir/incr2.out
+[ "$(oval_items $dir/full2.xml $objects)" == "$(oval_items $dir/incr2.xml $objects)" ]
+
+rm -rf $dir
@@ -0,0 +1,33 @@
+#!/bin/bash
+
+result=`mktemp`
+stdout=`mktemp`
+stdout_jobs=`mktemp`
+stderr=`mktemp`
+
+set -e
+set -o pipefail
+
+$OSCAP oval eval --results $result $srcdir/test_jobs.oval.xml > $stdout
+
+# The definitions evaluate the same way when the objects are scheduled at once
+for jobs in 1 2 16; do
+	$OSCAP oval eval --jobs $jobs --results $result $srcdir/test_jobs.oval.xml > $stdout_jobs
+	diff $stdout $stdout_jobs
+
+	assert_exists 1 '/oval_results/results/system/definitions/definition[@definition_id="oval:x:def:1"][@result="true"]'
+	assert_exists 1 '/oval_results/results/system/definitions/definition[@definition_id="oval:x:def:2"][@result="true"]'
+	assert_exists 1 '/oval_results/results/system/definitions/definition[@definition_id="oval:x:def:3"][@result="false"]'
+	assert_exists 5 '/oval_results/results/system/oval_system_characteristics/collected_objects/object'
+	assert_exists 1 '/oval_results/results/system/oval_system_characteristics/collected_objects/object[@id="oval:x:obj:5"][@flag="does not exist"]'
+done
+
+# The number of jobs has to be a positive integer
+for jobs in 0 x; do
+	ret=0
+	$OSCAP oval eval --jobs $jobs $srcdir/test_jobs.oval.xml 2> $stderr || ret=$?
+	[ $ret -ne 0 ]
+	grep -q "Invalid number of jobs '$jobs'" $stderr
+done
+
+rm $result $stdout $stdout_jobs $stderr
@@ -460,6 +460,20 @@ function test_api_seap_split {
     ./test_api_seap_parser '(' '-' '.' '3' '4' 'e' '3)' 
     ret_val=$[$ret_val+$?]
 
+    echo '-- mark11 ---'
+    ./test_api_seap_parser '("te' 'st")'
+    ret_val=$[$ret_val+$?]
+    ./test_api_seap_parser '("' 'test")'
+    ret_val=$[$ret_val+$?]
+    ./test_api_seap_parser '("a" 1)("b' 'cd" 2)'
+    ret_val=$[$ret_val+$?]
+    ./test_api_seap_parser '("a\"b' 'c" ("d' 'e" 1))'
+    ret_val=$[$ret_val+$?]
+    ./test_api_seap_parser "('te" "st')"
+    ret_val=$[$ret_val+$?]
+    ./test_api_seap_parser "(a 'b" "c' d)"
+    ret_val=$[$ret_val+$?]
+
     return $ret_val
 }
 
@@ -493,6 +507,8 @@ test_run "test_api_seap_list"                 ./test_api_seap_list
 test_run "test_api_seap_number_expression"    ./test_api_seap_number
 test_run "test_api_seap_string_expression"    ./test_api_seap_string
 test_run "test_api_SEXP_deepcmp"              ./test_api_SEXP_deepcmp
+test_run "test_api_sexp_ID_track"             ./test_api_sexp_ID_track
+test_run "test_api_seap_binary"               ./test_api_seap_binary
 test_run "test_api_strto"                     ./test_api_strto
 
 test_exit
@@ -0,0 +1,266 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strbuf.h>
+#include <sexp.h>
+
+#include "OVAL/probes/SEAP/_sexp-binary.h"
+
+static char *to_text(SEXP_t *s_exp)
+{
+	strbuf_t *sb;
+	char *str;
+
+	sb  = strbuf_new(64);
+	SEXP_sbprintf_t(s_exp, sb);
+	str = calloc(strbuf_size(sb) + 1, sizeof(char));
+	strbuf_copy(sb, str, strbuf_size(sb));
+	strbuf_free(sb);
+
+	return (str);
+}
+
+static int roundtrip(const char *input)
+{
+	SEXP_psetup_t *psetup;
+	SEXP_pstate_t *pstate = NULL;
+	SEXP_t *s_exp, *d_exp;
+	strbuf_t *sb;
+	char *frame, *t1, *t2;
+	size_t len, i;
+	int ret = 0;
+
+	psetup = SEXP_psetup_new();
+	s_exp  = SEXP_parse(psetup, input, strlen(input), &pstate);
+	SEXP_psetup_free(psetup);
+
+	if (s_exp == NULL) {
+		printf("can't parse: %s\n", input);
+		return (1);
+	}
+
+	sb = strbuf_new(16);
+
+	if (SEXP_sbprintf_b(s_exp, sb) != 0) {
+		printf("can't encode: %s\n", input);
+		return (1);
+	}
+
+	len   = strbuf_size(sb);
+	frame = malloc(len);
+	strbuf_copy(sb, frame, len);
+	strbuf_free(sb);
+
+	/* incomplete frames */
+	for (i = 1; i < len; ++i) {
+		if (SEXP_binary_framelen(frame, i) == (ssize_t)i) {
+			printf("invalid frame length: %s, %zu\n", input, i);
+			ret = 1;
+		}
+	}
+
+	if (SEXP_binary_framelen(frame, len) != (ssize_t)len) {
+		printf("invalid frame length: %s\n", input);
+		ret = 1;
+	}
+
+	d_exp = SEXP_parse_binary(frame, len);
+
+	if (d_exp == NULL) {
+		printf("can't decode: %s\n", input);
+		ret = 1;
+	} else {
+		t1 = to_text(s_exp);
+		t2 = to_text(d_exp);
+
+		if (strcmp(t1, t2) != 0) {
+			printf("mismatch: %s != %s\n", t1, t2);
+			ret = 1;
+		}
+
+		free(t1);
+		free(t2);
+		SEXP_free(d_exp);
+	}
+
+	/* malformed frames */
+	if (len > SEXP_BINARY_HDRSZ) {
+		frame[len - 1] ^= 0x7f;
+		d_exp = SEXP_parse_binary(frame, len - 1);
+
+		if (d_exp != NULL) {
+			printf("truncated frame decoded: %s\n", input);
+			SEXP_free(d_exp);
+			ret = 1;
+		}
+	}
+
+	free(frame);
+	SEXP_free(s_exp);
+
+	return (ret);
+}
+
+/* the number types too, SEXP_deepcmp() doesn't tell the integers apart */
+static bool same_types(const SEXP_t *a, const SEXP_t *b)
+{
+	SEXP_t *ma, *mb;
+	uint32_t i;
+	bool ret = true;
+
+	if (SEXP_typeof(a) != SEXP_typeof(b))
+		return (false);
+	if (SEXP_numberp(a))
+		return (SEXP_number_type(a) == SEXP_number_type(b));
+	if (!SEXP_listp(a))
+		return (true);
+	if (SEXP_list_length(a) != SEXP_list_length(b))
+		return (false);
+
+	for (i = 1; ret && i <= SEXP_list_length(a); ++i) {
+		ma  = SEXP_list_nth(a, i);
+		mb  = SEXP_list_nth(b, i);
+		ret = same_types(ma, mb);
+		SEXP_free(ma);
+		SEXP_free(mb);
+	}
+
+	return (ret);
+}
+
+/* decode `s_exp' from the text and the binary format, the results have to be the same */
+static int both_formats(SEXP_t *s_exp)
+{
+	SEXP_psetup_t *psetup;
+	SEXP_pstate_t *pstate = NULL;
+	SEXP_t *parsed, *t_exp, *b_exp;
+	strbuf_t *sb;
+	char *text, *frame, *t1, *t2;
+	size_t len;
+	int ret = 0;
+
+	/* the parser returns the list of the S-exps read */
+	text   = to_text(s_exp);
+	psetup = SEXP_psetup_new();
+	parsed = SEXP_parse(psetup, text, strlen(text), &pstate);
+	SEXP_psetup_free(psetup);
+	t_exp  = parsed != NULL ? SEXP_list_first(parsed) : NULL;
+	SEXP_free(parsed);
+
+	sb = strbuf_new(16);
+	SEXP_sbprintf_b(s_exp, sb);
+	len   = strbuf_size(sb);
+	frame = malloc(len);
+	strbuf_copy(sb, frame, len);
+	strbuf_free(sb);
+	b_exp = SEXP_parse_binary(frame, len);
+
+	if (t_exp == NULL || b_exp == NULL) {
+		printf("can't decode: %s\n", text);
+		ret = 1;
+	} else {
+		t1 = to_text(t_exp);
+		t2 = to_text(b_exp);
+
+		if (strcmp(t1, t2) != 0 || !SEXP_deepcmp(t_exp, b_exp) || !same_types(t_exp, b_exp)) {
+			printf("formats differ: %s != %s\n", t1, t2);
+			ret = 1;
+		}
+
+		free(t1);
+		free(t2);
+	}
+
+	SEXP_free(t_exp);
+	SEXP_free(b_exp);
+	free(frame);
+	free(text);
+
+	return (ret);
+}
+
+int main(void)
+{
+	const char *samples[] = {
+		"0", "255", "256", "65536", "4294967296", "18446744073709551615",
+		"-1", "-128", "-129", "-32769", "-2147483649", "-9223372036854775807",
+		"1.5", "-0.125", "1e12", "abc", "\"\"", "\"(a b c)\"",
+		"()", "(())", "(a (b (c (d))) \"\" 1 -1)",
+		"[INT8]123", "[url]\"http://example.com\"", "[asdf](1 2 3 4)",
+		"(msg :id 123 :hash [md5]|PNeg23b/ncpIl54kw5tAjA==| (test 123 \"asdf\" [wtf]\"dlskflskdf\"))",
+		NULL
+	};
+	SEXP_t *list, *memb;
+	char buf[32];
+	int i, ret = 0;
+
+	setbuf(stdout, NULL);
+
+	for (i = 0; samples[i] != NULL; ++i)
+		ret += roundtrip(samples[i]);
+
+	/* a list spanning several list blocks and strbuf blocks */
+	list = SEXP_list_new(NULL);
+
+	for (i = 0; i < 4096; ++i) {
+		snprintf(buf, sizeof buf, "item%d", i);
+		memb = SEXP_string_newf("%s", buf);
+		SEXP_list_add(list, memb);
+		SEXP_free(memb);
+	}
+
+	{
+		strbuf_t *sb = strbuf_new(16);
+		size_t len;
+		char *frame;
+
+		SEXP_sbprintf_b(list, sb);
+		len   = strbuf_size(sb);
+		frame = malloc(len);
+		strbuf_copy(sb, frame, len);
+		strbuf_free(sb);
+
+		memb = SEXP_parse_binary(frame, len);
+
+		if (memb == NULL || SEXP_deepcmp(list, memb) != true) {
+			printf("long list mismatch\n");
+			++ret;
+		}
+
+		SEXP_free(memb);
+		free(frame);
+	}
+
+	SEXP_free(list);
+
+	/* doubles, integral ones as counted by xmlfilecontent */
+	{
+		const double doubles[] = {
+			4.0, 0.0, -0.0, -4.0, 300.0, -200.0, 100000.0, 4.5, -0.125,
+			3.14159265358979, 1e20, -1e-20, 123456789.0
+		};
+		size_t j;
+
+		list = SEXP_list_new(NULL);
+
+		for (j = 0; j < sizeof doubles / sizeof doubles[0]; ++j) {
+			memb = SEXP_number_newf(doubles[j]);
+			ret += both_formats(memb);
+			SEXP_list_add(list, memb);
+			SEXP_free(memb);
+		}
+
+		memb = SEXP_string_newf("count");
+		SEXP_list_add(list, memb);
+		SEXP_free(memb);
+		ret += both_formats(list);
+		SEXP_free(list);
+	}
+
+	return (ret != 0);
+}
@@ -6,6 +6,7 @@
 #include <sexp.h>
 #include <string.h>
 #include <inttypes.h>
+#include <stdio.h>
 
 int main (void)
 {
@@ -459,5 +460,29 @@ int main (void)
 		SEXP_vfree (r0, r1, r3, NULL);
         }
 
+        /* pop all members of a list, one by one */
+        {
+                SEXP_t  *m;
+                uint32_t n;
+
+                i1   = SEXP_string_newf ("abc");
+                i2   = SEXP_number_newu_8 (123);
+                list = SEXP_list_new (i1, i2, i1, NULL);
+                SEXP_vfree (i1, i2, NULL);
+
+                for (n = 0; (m = SEXP_list_pop (list)) != NULL; ++n) {
+                        SEXP_fprintfa (stdout, m);
+                        fputc ('\n', stdout);
+                        SEXP_free (m);
+                }
+
+                SEXP_free (list);
+
+                if (n != 3) {
+                        printf ("popped %u members instead of 3\n", n);
+                        return (1);
+                }
+        }
+
         return (0);
 }
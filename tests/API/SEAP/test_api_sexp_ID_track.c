@@ -0,0 +1,90 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <sexp.h>
+
+#define CHECK_ID(a, b) do {						\
+		SEXP_ID_t __a = SEXP_ID_v(a), __b = SEXP_ID_v(b);	\
+		if (__a != __b) {					\
+			printf("%d: ID mismatch: 0x%"PRIx64" != 0x%"PRIx64"\n", \
+			       __LINE__, __a, __b);			\
+			return (1);					\
+		}							\
+	} while(0)
+
+static SEXP_t *make_entity(const char *name, const char *value)
+{
+	SEXP_t *n, *v, *e;
+
+	n = SEXP_string_newf("%s", name);
+	v = SEXP_string_newf("%s", value);
+	e = SEXP_list_new(n, v, NULL);
+	SEXP_vfree(n, v, NULL);
+
+	return (e);
+}
+
+int main (void)
+{
+	SEXP_t *tracked, *plain, *e1, *e2, *e3, *ref, *old, *num;
+	int i;
+
+	setbuf (stdout, NULL);
+
+	e1 = make_entity("path", "/etc");
+	e2 = make_entity("filename", "passwd");
+	e3 = make_entity("filename", "shadow");
+
+	tracked = SEXP_list_new(e1, NULL);
+	plain   = SEXP_list_new(e1, NULL);
+
+	if (SEXP_ID_track(tracked) != 0)
+		return (1);
+
+	/* incremental updates */
+	SEXP_list_add(tracked, e2);
+	SEXP_list_add(plain, e2);
+	CHECK_ID(tracked, plain);
+
+	for (i = 0; i < 64; ++i) {
+		num = SEXP_number_newi_32(i);
+		SEXP_list_add(tracked, num);
+		SEXP_list_add(plain, num);
+		SEXP_free(num);
+	}
+	CHECK_ID(tracked, plain);
+
+	/* modification through a reference drops the cached value */
+	ref = SEXP_listref_nth(tracked, 2);
+	old = SEXP_list_replace(ref, 2, e3);
+	SEXP_vfree(ref, old, NULL);
+
+	ref = SEXP_listref_nth(plain, 2);
+	old = SEXP_list_replace(ref, 2, e3);
+	SEXP_vfree(ref, old, NULL);
+
+	CHECK_ID(tracked, plain);
+
+	/* replace & copy-on-write */
+	old = SEXP_list_replace(tracked, 1, e3);
+	SEXP_free(old);
+	old = SEXP_list_replace(plain, 1, e3);
+	SEXP_free(old);
+	CHECK_ID(tracked, plain);
+
+	ref = SEXP_ref(tracked);
+	SEXP_list_add(tracked, e1);
+	SEXP_list_add(plain, e1);
+	CHECK_ID(tracked, plain);
+
+	if (SEXP_ID_v(ref) == SEXP_ID_v(tracked))
+		return (1);
+
+	SEXP_vfree(tracked, plain, ref, e1, e2, e3, NULL);
+
+	return (0);
+}
@@ -12,6 +12,7 @@ test_run "xccdf:complex-check -- NAND is working properly" ./test_xccdf_shall_pa
 test_run "xccdf:complex-check -- single negation" ./test_xccdf_shall_pass $srcdir/test_xccdf_complex_check_single_negate.xccdf.xml
 test_run "Certain id's of xccdf_items may overlap" ./test_xccdf_shall_pass $srcdir/test_xccdf_overlaping_IDs.xccdf.xml
 test_run "Test Abstract data types." ./test_oscap_common
+test_run "Checks submitted to an asynchronous engine" ./test_xccdf_async_check $srcdir/test_xccdf_async_check.xccdf.xml
 test_run "xccdf_rule_result_override" $srcdir/test_xccdf_overrides.sh
 
 test_run "Assert for environment" [ ! -x $srcdir/not_executable ]
@@ -59,6 +60,7 @@ test_run "test xccdf resolve" $srcdir/test_xccdf_resolve.sh
 test_run "Exported arf results from xccdf without reference to oval" $srcdir/test_xccdf_results_arf_no_oval.sh
 test_run "XCCDF Substitute within Title" $srcdir/test_xccdf_sub_title.sh
 test_run "TestResult element should contain test-system attribute" $srcdir/test_xccdf_test_system.sh
+test_run "oscap xccdf serve evaluates the loaded content on requests" $srcdir/test_xccdf_serve.sh
 
 test_run "libxml errors handled correctly" $srcdir/test_unfinished.sh
 
@@ -93,6 +95,7 @@ test_run "XCCDF Remediate + perl fix" $srcdir/test_remediate_perl.sh
 test_run 'generate report: xccdf:check/@selector=""' $srcdir/test_report_check_with_empty_selector.sh
 test_run "generate report: missing xsl shall not segfault" $srcdir/test_report_without_xsl_fails_gracefully.sh
 test_run "generate report: avoid warnings from libxml" $srcdir/test_report_without_oval_poses_no_errors.sh
+test_run "generate report: built-in writer" $srcdir/test_report_native.sh
 test_run "generate fix: just as the anaconda does" $srcdir/test_report_anaconda_fixes.sh
 test_run "generate fix: just as the anaconda does + DataStream" $srcdir/test_report_anaconda_fixes_ds.sh
 test_run "generate fix: ensure filtering drop fixes" $srcdir/test_fix_filtering.sh
@@ -0,0 +1,50 @@
+#!/bin/bash
+
+set -e
+set -o pipefail
+
+name=$(basename $0 .sh)
+
+result=$(mktemp -t ${name}.out.XXXXXX)
+report=$(mktemp -t ${name}.out.XXXXXX)
+stderr=$(mktemp -t ${name}.out.XXXXXX)
+
+$OSCAP xccdf eval --results $result --report $report --report-native $srcdir/${name}.xccdf.xml 2> $stderr || [ $? == 2 ]
+
+echo "Stderr file = $stderr"
+echo "Result file = $result"
+echo "Report file = $report"
+[ -f $stderr ]; [ ! -s $stderr ]
+
+# well-formed, with unique ids
+xmllint --html --noout $report 2> $stderr
+[ ! -s $stderr ]; rm $stderr
+
+assert_exists 6 '//rule-result'
+assert_exists 1 '//rule-result[result="notselected"]'
+
+# a section for every evaluated result, in the order of the results
+[ "$(grep -c '^<div class="rule"' $report)" == 5 ]
+[ "$(grep -o '<tr><th>Result</th><td class="[a-z]*">' $report | sed 's/.*class="\([a-z]*\)">/\1/' | tr '\n' ' ')" == \
+  "$($XPATH $result '//rule-result[result!="notselected"]/result/text()' | tr '\n' ' ')" ]
+
+# the summary counts the results
+for type in pass fail; do
+	count=$($XPATH $result 'count(//rule-result[result="'$type'"])')
+	[ $count == 0 ] || grep -q "^<tr><td class=\"$type\">$type</td><td>$count</td></tr>$" $report
+done
+
+# the id once per rule, texts escaped, the rule without a title by its id
+grep -q '^<h1>Report &lt;native&gt; &amp; co</h1>$' $report
+[ "$(grep -c 'id="rule-xccdf_moc.elpmaxe.www_rule_1"' $report)" == 1 ]
+[ "$(grep -c '^<h3>Permissions &lt;&amp;&gt; "quoted"</h3>$' $report)" == 4 ]
+grep -q '^<tr><th>Description</th><td class="text">Checks the permissions of &lt;not_executable&gt;.</td></tr>$' $report
+grep -q '^<tr><th>Identifier</th><td>CCE-1234-5 (http://cce.mitre.org)</td></tr>$' $report
+grep -q '^<h3>xccdf_moc.elpmaxe.www_rule_2</h3>$' $report
+! grep -q 'rule_3\|Not selected' $report || exit 1
+
+# the OVAL criteria of every check
+[ "$(grep -c '^<p>OVAL definition oval:moc.elpmaxe.www:def:[0-9]: \(true\|false\)</p>$' $report)" == 5 ]
+[ "$(grep -c '^<li class="[a-z]*">test oval:moc.elpmaxe.www:tst:[0-9] (Testing permissions on ./not_executable): [a-z]*</li>$' $report)" == 5 ]
+
+rm $result $report
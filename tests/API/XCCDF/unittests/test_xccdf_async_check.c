@@ -0,0 +1,154 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * The checks of the async engine are taken over by the POLICY_ENGINE_QUERY_SUBMIT
+ * query and completed from other threads, or before the query returns. The rule
+ * results have to be those given to xccdf_policy_async_check_complete(), in the
+ * document order, and the eval function has to be called only for the checks
+ * refused or completed as notchecked.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <xccdf_benchmark.h>
+#include <xccdf_policy.h>
+
+#include "unit_helper.h"
+#include <../../../assume.h>
+
+#define ASYNC_SYSTEM "http://check-engine.test/async"
+#define MAX_CHECKS 8
+
+struct async_engine {
+	pthread_t threads[MAX_CHECKS];
+	int nthreads;
+	int submitted;
+	int evaluated;
+};
+
+struct async_job {
+	struct xccdf_policy_async_check *check;
+	xccdf_test_result_type_t result;
+};
+
+static void *_complete_later(void *arg)
+{
+	struct async_job *job = arg;
+
+	usleep(10000);
+	xccdf_policy_async_check_complete(job->check, job->result);
+	free(job);
+	return NULL;
+}
+
+static void *_async_query(void *usr, xccdf_policy_engine_query_t query_type, void *query_data)
+{
+	struct async_engine *engine = usr;
+	static int taken;
+
+	if (query_type == POLICY_ENGINE_QUERY_ASYNC) {
+		assume(query_data == NULL);
+		return &taken;
+	}
+	if (query_type != POLICY_ENGINE_QUERY_SUBMIT)
+		return NULL;
+
+	struct xccdf_policy_async_check *check = query_data;
+	assume(check != NULL);
+	assume(xccdf_policy_async_check_get_policy(check) != NULL);
+	assume(strcmp(xccdf_policy_async_check_get_href(check), "async-file") == 0);
+
+	const char *name = xccdf_policy_async_check_get_name(check);
+	const char *rule_id = xccdf_policy_async_check_get_rule_id(check);
+	assume(strncmp(rule_id, "rule-", 5) == 0 && strcmp(rule_id + 5, name) == 0);
+	engine->submitted++;
+
+	if (strcmp(name, "refused") == 0)
+		return NULL;
+	if (strcmp(name, "fail") == 0) {
+		/* completed before the query returns */
+		xccdf_policy_async_check_complete(check, XCCDF_RESULT_FAIL);
+		return &taken;
+	}
+
+	struct async_job *job = malloc(sizeof(struct async_job));
+	job->check = check;
+	job->result = strcmp(name, "pass") == 0 ? XCCDF_RESULT_PASS : XCCDF_RESULT_NOT_CHECKED;
+	assume(engine->nthreads < MAX_CHECKS);
+	assume(pthread_create(&engine->threads[engine->nthreads++], NULL, _complete_later, job) == 0);
+	return &taken;
+}
+
+static xccdf_test_result_type_t _async_eval(struct xccdf_policy *policy, const char *rule_id, const char *id, const char *href,
+		struct xccdf_value_binding_iterator *value_binding_it, struct xccdf_check_import_iterator *check_imports_it, void *usr)
+{
+	struct async_engine *engine = usr;
+
+	assume(strcmp(id, "notchecked") == 0 || strcmp(id, "refused") == 0);
+	engine->evaluated++;
+	return XCCDF_RESULT_INFORMATIONAL;
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct {
+		const char *idref;
+		xccdf_test_result_type_t result;
+	} expected[] = {
+		{ "rule-pass", XCCDF_RESULT_PASS },
+		{ "rule-fail", XCCDF_RESULT_FAIL },
+		{ "rule-notchecked", XCCDF_RESULT_INFORMATIONAL },
+		{ "rule-refused", XCCDF_RESULT_INFORMATIONAL },
+		{ "rule-sync", XCCDF_RESULT_PASS },
+	};
+	struct async_engine engine;
+	int i = 0;
+
+	assume(argc == 2);
+	memset(&engine, 0, sizeof(engine));
+	struct xccdf_policy_model *policy_model = uh_load_xccdf(argv[1]);
+	struct xccdf_policy *policy = uh_get_default_policy(policy_model);
+	uh_register_simple_engines(policy_model);
+	xccdf_policy_model_register_engine_and_query_callback(policy_model, ASYNC_SYSTEM, _async_eval, &engine, _async_query);
+
+	struct xccdf_result *ritem = xccdf_policy_evaluate(policy);
+	assume(ritem != NULL);
+
+	struct xccdf_rule_result_iterator *rr_it = xccdf_result_get_rule_results(ritem);
+	while (xccdf_rule_result_iterator_has_more(rr_it)) {
+		struct xccdf_rule_result *rr = xccdf_rule_result_iterator_next(rr_it);
+		assume(i < (int) (sizeof(expected) / sizeof(expected[0])));
+		printf("%s: %s\n", xccdf_rule_result_get_idref(rr), xccdf_test_result_type_get_text(xccdf_rule_result_get_result(rr)));
+		assume(strcmp(xccdf_rule_result_get_idref(rr), expected[i].idref) == 0);
+		assume(xccdf_rule_result_get_result(rr) == expected[i].result);
+		i++;
+	}
+	xccdf_rule_result_iterator_free(rr_it);
+	assume(i == (int) (sizeof(expected) / sizeof(expected[0])));
+
+	for (i = 0; i < engine.nthreads; i++)
+		pthread_join(engine.threads[i], NULL);
+	assume(engine.submitted == 4);
+	assume(engine.evaluated == 2);
+
+	xccdf_policy_model_free(policy_model);
+	return 0;
+}
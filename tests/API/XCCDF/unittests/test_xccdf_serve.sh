@@ -0,0 +1,115 @@
+#!/bin/bash
+
+# The content is loaded once by oscap xccdf serve and evaluated on the
+# requests sent to its socket. Every request has to scan the system again,
+# give the results of oscap xccdf eval and be isolated from the profile and
+# the tailoring of the previous ones.
+
+set -e -o pipefail
+set -x
+
+name=$(basename $0 .sh)
+dir=$(mktemp -d -t ${name}.XXXXXX)
+sock=$dir/sock
+flag=xccdf_moc.elpmaxe.www_rule_flag
+definitions=xccdf_moc.elpmaxe.www_rule_definitions
+
+# a process whose environment the server reads
+TEST_XCCDF_SERVE=1 sleep 600 &
+sleeper=$!
+
+sed -e "s|@DIR@|$dir|" -e "s|@PID@|$sleeper|" $srcdir/$name.oval.xml > $dir/$name.oval.xml
+cp $srcdir/$name.xccdf.xml $srcdir/$name.tailoring.xml $dir/
+
+# reads the request from stdin, prints the reply
+function request {
+	perl -MIO::Socket::UNIX -e '
+		my $s = IO::Socket::UNIX->new(Peer => $ARGV[0]) or die "$ARGV[0]: $!\n";
+		print $s join("", <STDIN>);
+		print while <$s>;' $sock
+}
+
+# $1 results, $2 rule
+function rule_result {
+	$XPATH $1 "string(//rule-result[@idref=\"$2\"]/result)" 2>/dev/null
+}
+
+( cd $dir; exec $OSCAP xccdf serve --socket $sock $dir/$name.xccdf.xml 2> $dir/stderr ) &
+server=$!
+# don't leave the server behind a failed check
+trap 'kill $server $sleeper 2> /dev/null || true' EXIT
+for i in $(seq 100); do
+	[ -S $sock ] && break
+	sleep 0.1
+done
+[ -S $sock ]
+[ -z "$(find $sock -perm /077)" ]
+
+# the flag is checked again by every request
+printf 'results %s\n\n' $dir/r1.xml | request > $dir/reply1
+[ "$(cat $dir/reply1)" == "result 2" ]
+[ "$(rule_result $dir/r1.xml $flag)" == "fail" ]
+[ "$(rule_result $dir/r1.xml $definitions)" == "notselected" ]
+
+touch $dir/flag
+printf 'results %s\n\n' $dir/r2.xml | request > $dir/reply2
+[ "$(cat $dir/reply2)" == "result 0" ]
+[ "$(rule_result $dir/r2.xml $flag)" == "pass" ]
+
+# as given by oscap xccdf eval
+( cd $dir; $OSCAP xccdf eval --results $dir/eval.xml $name.xccdf.xml > /dev/null )
+for rule in $flag $definitions; do
+	[ "$(rule_result $dir/r2.xml $rule)" == "$(rule_result $dir/eval.xml $rule)" ]
+done
+
+# the profile and every output of a request
+rm $dir/flag
+printf 'profile xccdf_moc.elpmaxe.www_profile_definitions\nresults %s\nresults-arf %s\nreport %s\noval-results 1\n\n' \
+	$dir/r3.xml $dir/arf3.xml $dir/report3.html | request > $dir/reply3
+[ "$(cat $dir/reply3)" == "result 0" ]
+[ "$(rule_result $dir/r3.xml $flag)" == "notselected" ]
+[ "$(rule_result $dir/r3.xml $definitions)" == "pass" ]
+$OSCAP ds rds-validate $dir/arf3.xml
+grep -q $definitions $dir/report3.html
+[ -s $dir/$name.oval.xml.result.xml ]
+
+# the outputs aren't written again by the next request
+rm $dir/$name.oval.xml.result.xml
+printf 'results %s\n\n' $dir/r4.xml | request > $dir/reply4
+[ "$(cat $dir/reply4)" == "result 2" ]
+[ ! -f $dir/$name.oval.xml.result.xml ]
+[ "$(rule_result $dir/r4.xml $definitions)" == "notselected" ]
+
+# the tailoring lasts for its request only
+printf 'tailoring-file %s\nprofile xccdf_moc.elpmaxe.www_profile_tailored\nresults %s\n\n' \
+	$dir/$name.tailoring.xml $dir/r5.xml | request > $dir/reply5
+[ "$(cat $dir/reply5)" == "result 2" ]
+[ "$(rule_result $dir/r5.xml $flag)" == "fail" ]
+[ "$(rule_result $dir/r5.xml $definitions)" == "pass" ]
+
+printf 'profile xccdf_moc.elpmaxe.www_profile_tailored\nresults %s\n\n' $dir/r6.xml | request > $dir/reply6
+head -n 1 $dir/reply6 | grep -q '^result 1$'
+grep -q '^error Profile was not found\.$' $dir/reply6
+[ ! -f $dir/r6.xml ]
+
+# invalid requests are refused, the server keeps serving
+printf 'unknown 1\n\n' | request > $dir/reply7
+head -n 1 $dir/reply7 | grep -q '^result 1$'
+grep -q '^error Invalid request\.$' $dir/reply7
+printf 'results %s\n\n' $dir/r8.xml | request > $dir/reply8
+[ "$(cat $dir/reply8)" == "result 2" ]
+
+# the processes are listed again by every request
+printf 'profile xccdf_moc.elpmaxe.www_profile_process\nresults %s\n\n' $dir/r9.xml | request > $dir/reply9
+[ "$(cat $dir/reply9)" == "result 0" ]
+kill $sleeper
+wait $sleeper || true
+printf 'profile xccdf_moc.elpmaxe.www_profile_process\nresults %s\n\n' $dir/r10.xml | request > $dir/reply10
+[ "$(cat $dir/reply10)" == "result 2" ]
+[ "$(rule_result $dir/r10.xml xccdf_moc.elpmaxe.www_rule_process)" == "fail" ]
+
+kill -TERM $server
+wait $server
+[ ! -s $dir/stderr ]
+
+rm -rf $dir
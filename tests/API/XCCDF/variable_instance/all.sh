@@ -464,25 +464,25 @@ function xccdf_eval_2_multiset(){
 	assert_exists 1 '/oval_results/results/system/oval_system_characteristics/generator'
 	assert_exists 1 '/oval_results/results/system/oval_system_characteristics/system_info'
 	assert_exists 1 '/oval_results/results/system/oval_system_characteristics/system_data'
-	assert_exists 2 '/oval_results/results/system/oval_system_characteristics/system_data/ind-sys:xmlfilecontent_item'
-	assert_exists 2 '/oval_results/results/system/oval_system_characteristics/system_data/ind-sys:xmlfilecontent_item[count(*) = 5]'
-	assert_exists 2 '/oval_results/results/system/oval_system_characteristics/system_data/ind-sys:xmlfilecontent_item/ind-sys:filepath'
-	assert_exists 2 '/oval_results/results/system/oval_system_characteristics/system_data/ind-sys:xmlfilecontent_item/ind-sys:path'
-	assert_exists 2 '/oval_results/results/system/oval_system_characteristics/system_data/ind-sys:xmlfilecontent_item/ind-sys:filename'
-	assert_exists 2 '/oval_results/results/system/oval_system_characteristics/system_data/ind-sys:xmlfilecontent_item/ind-sys:xpath'
-	assert_exists 2 '/oval_results/results/system/oval_system_characteristics/system_data/ind-sys:xmlfilecontent_item/ind-sys:value_of'
-	assert_exists 2 '/oval_results/results/system/oval_system_characteristics/system_data/ind-sys:xmlfilecontent_item/ind-sys:value_of[text()="300"]'
+	assert_exists 1 '/oval_results/results/system/oval_system_characteristics/system_data/ind-sys:xmlfilecontent_item'
+	assert_exists 1 '/oval_results/results/system/oval_system_characteristics/system_data/ind-sys:xmlfilecontent_item[count(*) = 5]'
+	assert_exists 1 '/oval_results/results/system/oval_system_characteristics/system_data/ind-sys:xmlfilecontent_item/ind-sys:filepath'
+	assert_exists 1 '/oval_results/results/system/oval_system_characteristics/system_data/ind-sys:xmlfilecontent_item/ind-sys:path'
+	assert_exists 1 '/oval_results/results/system/oval_system_characteristics/system_data/ind-sys:xmlfilecontent_item/ind-sys:filename'
+	assert_exists 1 '/oval_results/results/system/oval_system_characteristics/system_data/ind-sys:xmlfilecontent_item/ind-sys:xpath'
+	assert_exists 1 '/oval_results/results/system/oval_system_characteristics/system_data/ind-sys:xmlfilecontent_item/ind-sys:value_of'
+	assert_exists 1 '/oval_results/results/system/oval_system_characteristics/system_data/ind-sys:xmlfilecontent_item/ind-sys:value_of[text()="300"]'
+	# obj:1 doesn't refer to var:1, it's collected once for both instances
 	assert_exists 1 '/oval_results/results/system/oval_system_characteristics/collected_objects'
-	assert_exists 2 '/oval_results/results/system/oval_system_characteristics/collected_objects/object'
-	assert_exists 2 '/oval_results/results/system/oval_system_characteristics/collected_objects/object[count(@*) = 4]'
-	assert_exists 2 '/oval_results/results/system/oval_system_characteristics/collected_objects/object[@id="oval:com.example.www:obj:1"]'
-	assert_exists 2 '/oval_results/results/system/oval_system_characteristics/collected_objects/object[@version="1"]'
-	assert_exists 2 '/oval_results/results/system/oval_system_characteristics/collected_objects/object[@flag="complete"]'
-	assert_exists 2 '/oval_results/results/system/oval_system_characteristics/collected_objects/object[reference]'
-	assert_exists 2 '/oval_results/results/system/oval_system_characteristics/collected_objects/object[count(reference/@*) = 1]'
-	assert_exists 2 '/oval_results/results/system/oval_system_characteristics/collected_objects/object[reference/@item_ref]'
-	assert_exists 1 '/oval_results/results/system/oval_system_characteristics/collected_objects/object[@variable_instance="1"]'
-	assert_exists 1 '/oval_results/results/system/oval_system_characteristics/collected_objects/object[@variable_instance="2"]'
+	assert_exists 1 '/oval_results/results/system/oval_system_characteristics/collected_objects/object'
+	assert_exists 1 '/oval_results/results/system/oval_system_characteristics/collected_objects/object[count(@*) = 3]'
+	assert_exists 1 '/oval_results/results/system/oval_system_characteristics/collected_objects/object[@id="oval:com.example.www:obj:1"]'
+	assert_exists 1 '/oval_results/results/system/oval_system_characteristics/collected_objects/object[@version="1"]'
+	assert_exists 1 '/oval_results/results/system/oval_system_characteristics/collected_objects/object[@flag="complete"]'
+	assert_exists 1 '/oval_results/results/system/oval_system_characteristics/collected_objects/object[reference]'
+	assert_exists 1 '/oval_results/results/system/oval_system_characteristics/collected_objects/object[count(reference/@*) = 1]'
+	assert_exists 1 '/oval_results/results/system/oval_system_characteristics/collected_objects/object[reference/@item_ref]'
+	assert_exists 1 '/oval_results/results/system/oval_system_characteristics/collected_objects/object[not(@variable_instance)]'
 	assert_exists 4 '/oval_results/results/system/oval_system_characteristics/*'
 	assert_exists 1 '/oval_results/results/system/tests'
 	assert_exists 3 '/oval_results/results/system/tests/test'
@@ -502,6 +502,7 @@ function xccdf_eval_2_multiset(){
 	assert_exists 2 '/oval_results/results/system/tests/test/tested_item'
 	assert_exists 4 '/oval_results/results/system/tests/test/tested_item/@*'
 	assert_exists 2 '/oval_results/results/system/tests/test/tested_item/@item_id'
+	assert_exists 2 '/oval_results/results/system/tests/test/tested_item[@item_id = /oval_results/results/system/oval_system_characteristics/collected_objects/object/reference/@item_ref]'
 	assert_exists 1 '/oval_results/results/system/tests/test/tested_item[@result="true"]'
 	assert_exists 1 '/oval_results/results/system/tests/test/tested_item[@result="false"]'
 	assert_exists 2 '/oval_results/results/system/tests/test/tested_variable'
@@ -621,6 +622,13 @@ function xccdf_eval_1_multiset_syschar(){
 	assert_exists 2 '/oval_results/results/system/oval_system_characteristics/system_data/ind-sys:xmlfilecontent_item/ind-sys:value_of'
 	assert_exists 1 '/oval_results/results/system/oval_system_characteristics/system_data/ind-sys:xmlfilecontent_item/ind-sys:value_of[text()="300"]'
 	assert_exists 1 '/oval_results/results/system/oval_system_characteristics/system_data/ind-sys:xmlfilecontent_item/ind-sys:value_of[text()="600"]'
+	# obj:2 refers to var:2, it's collected again for the instance 2
+	assert_exists 2 '/oval_results/results/system/oval_system_characteristics/collected_objects/object'
+	assert_exists 2 '/oval_results/results/system/oval_system_characteristics/collected_objects/object[@id="oval:com.example.www:obj:2"]'
+	assert_exists 1 '/oval_results/results/system/oval_system_characteristics/collected_objects/object[@id="oval:com.example.www:obj:2" and @variable_instance="1"]'
+	assert_exists 1 '/oval_results/results/system/oval_system_characteristics/collected_objects/object[@id="oval:com.example.www:obj:2" and @variable_instance="2"]'
+	assert_exists 1 '/oval_results/results/system/oval_system_characteristics/collected_objects/object[@variable_instance="1"]/reference[@item_ref = /oval_results/results/system/oval_system_characteristics/system_data/*[ind-sys:filename="'$file300'"]/@id]'
+	assert_exists 1 '/oval_results/results/system/oval_system_characteristics/collected_objects/object[@variable_instance="2"]/reference[@item_ref = /oval_results/results/system/oval_system_characteristics/system_data/*[ind-sys:filename="'$file600'"]/@id]'
 	assert_exists 1 '/oval_results/results/system/tests'
 	assert_exists 3 '/oval_results/results/system/tests/test'
 	assert_exists 3 '/oval_results/results/system/tests/test[@version="1"]'
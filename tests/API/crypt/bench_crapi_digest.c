@@ -0,0 +1,118 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Throughput of the digest contexts for a range of message sizes. Run it
+ * once as is and once with CRAPI_SHAEXT_DISABLE=1 set in the environment
+ * to compare the CPU instructions with the crypto library.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <crapi/crapi.h>
+#include <crapi/digest.h>
+#include <crapi/shaext.h>
+
+#define BENCH_BYTES (64 * 1024 * 1024)
+
+static const struct {
+        const char  *name;
+        crapi_alg_t  alg;
+        void *(*init)  (void *, void *);
+        int   (*update)(void *, void *, size_t);
+        int   (*fini)  (void *);
+} bench_algs[] = {
+        { "md5",    CRAPI_DIGEST_MD5,    &crapi_md5_init,    &crapi_md5_update,    &crapi_md5_fini    },
+        { "sha1",   CRAPI_DIGEST_SHA1,   &crapi_sha1_init,   &crapi_sha1_update,   &crapi_sha1_fini   },
+        { "sha224", CRAPI_DIGEST_SHA224, &crapi_sha224_init, &crapi_sha224_update, &crapi_sha224_fini },
+        { "sha256", CRAPI_DIGEST_SHA256, &crapi_sha256_init, &crapi_sha256_update, &crapi_sha256_fini },
+        { "sha384", CRAPI_DIGEST_SHA384, &crapi_sha384_init, &crapi_sha384_update, &crapi_sha384_fini },
+        { "sha512", CRAPI_DIGEST_SHA512, &crapi_sha512_init, &crapi_sha512_update, &crapi_sha512_fini }
+};
+
+static const size_t bench_sizes[] = { 64, 512, 4096, 65536, 1048576 };
+
+static double now (void)
+{
+        struct timespec ts;
+
+        clock_gettime (CLOCK_MONOTONIC, &ts);
+        return (ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+int main (int argc, char *argv[])
+{
+        uint8_t *buf, dst[64];
+        size_t   dstlen, i, j, n, k;
+        double   start, secs;
+        void    *ctx;
+
+        if (crapi_init (NULL) != 0) {
+                fprintf (stderr, "crapi_init() != 0\n");
+                return (1);
+        }
+
+        buf = malloc (bench_sizes[sizeof bench_sizes / sizeof bench_sizes[0] - 1]);
+
+        if (buf == NULL)
+                return (1);
+
+        for (i = 0; i < bench_sizes[sizeof bench_sizes / sizeof bench_sizes[0] - 1]; ++i)
+                buf[i] = (uint8_t)(i * 31 + 7);
+
+        printf ("%-8s %-8s %10s %12s\n", "alg", "backend", "size", "MB/s");
+
+        for (i = 0; i < sizeof bench_algs / sizeof bench_algs[0]; ++i) {
+                for (j = 0; j < sizeof bench_sizes / sizeof bench_sizes[0]; ++j) {
+                        n = BENCH_BYTES / bench_sizes[j];
+                        start = now ();
+
+                        for (k = 0; k < n; ++k) {
+                                dstlen = sizeof dst;
+
+                                if ((ctx = bench_algs[i].init (dst, &dstlen)) == NULL)
+                                        break;
+
+                                bench_algs[i].update (ctx, buf, bench_sizes[j]);
+                                bench_algs[i].fini (ctx);
+                        }
+
+                        if (k < n) {
+                                printf ("%-8s %-8s %10zu %12s\n", bench_algs[i].name, "-", bench_sizes[j], "n/a");
+                                continue;
+                        }
+
+                        secs = now () - start;
+                        printf ("%-8s %-8s %10zu %12.1f\n", bench_algs[i].name,
+                                crapi_shaext_supported (bench_algs[i].alg) ? "cpu" : "library",
+                                bench_sizes[j], (double)BENCH_BYTES / secs / (1024 * 1024));
+                }
+        }
+
+        free (buf);
+
+        return (0);
+}
@@ -72,6 +72,8 @@ function test_crapi_mdigest {
         fi
 
         ./test_crapi_mdigest "${TEMPDIR}/${file}" "$sum_md5" "$sum_sha1" "$sum_sha256" || return 1
+        # the crypto library, in case the CPU SHA instructions were used above
+        CRAPI_SHAEXT_DISABLE=1 ./test_crapi_mdigest "${TEMPDIR}/${file}" "$sum_md5" "$sum_sha1" "$sum_sha256" || return 1
         #echo "$file: ret $?, 5: $sum_md5, 1: $sum_sha1"
     done
 
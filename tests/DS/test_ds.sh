@@ -332,6 +332,117 @@ function test_rds_split {
     return 0
 }
 
+# $1 the results without the blank text between the elements, canonical
+function results_canonical {
+	xmllint --noblanks $1 | xmllint --c14n -
+}
+
+function test_rds_delta {
+	require "xmllint" || return 255
+
+	local name=${FUNCNAME}
+	local dir=$(mktemp -d -t ${name}.XXXXXX)
+	local stderr=$dir/stderr
+	local ret=0
+
+	# without the baseline, the delta carries the whole ARF
+	$OSCAP xccdf eval --results-arf $dir/arf1.xml --results-arf-delta $dir/delta1.xml \
+		--delta-baseline $dir/missing.xml $srcdir/eval_simple/sds.xml > /dev/null 2> $stderr || ret=$?
+	[ $ret == 0 ] || [ $ret == 2 ]
+	[ ! -s $stderr ]
+	$OSCAP ds rds-apply-delta $dir/missing.xml $dir/delta1.xml $dir/rebuilt1.xml
+	diff <(results_canonical $dir/arf1.xml) <(results_canonical $dir/rebuilt1.xml)
+
+	# the next one lists the changes only
+	$OSCAP xccdf eval --results-arf $dir/arf2.xml --results-arf-delta $dir/delta2.xml \
+		--delta-baseline $dir/arf1.xml $srcdir/eval_simple/sds.xml > /dev/null 2> $stderr || ret=$?
+	[ $ret == 0 ] || [ $ret == 2 ]
+	[ ! -s $stderr ]
+	[ $(stat -c %s $dir/delta2.xml) -lt $(( $(stat -c %s $dir/arf2.xml) / 10 )) ]
+	$OSCAP ds rds-apply-delta $dir/arf1.xml $dir/delta2.xml $dir/rebuilt2.xml
+	diff <(results_canonical $dir/arf2.xml) <(results_canonical $dir/rebuilt2.xml)
+	$OSCAP ds rds-validate $dir/rebuilt2.xml
+
+	# a delta against another baseline is refused
+	! $OSCAP ds rds-apply-delta $dir/arf2.xml $dir/delta2.xml $dir/wrong.xml || return 1
+	[ ! -f $dir/wrong.xml ]
+
+	# so is a delta whose result doesn't match its hash
+	sed '0,/ time="[^"]*"/s// time="2000-01-01T00:00:00"/' $dir/delta2.xml > $dir/tampered.xml
+	! cmp -s $dir/delta2.xml $dir/tampered.xml || return 1
+	! $OSCAP ds rds-apply-delta $dir/arf1.xml $dir/tampered.xml $dir/wrong.xml || return 1
+	[ ! -f $dir/wrong.xml ]
+
+	# the OVAL results
+	$OSCAP oval eval --results $dir/oval1.xml --results-delta $dir/oval-delta1.xml \
+		--delta-baseline $dir/missing.xml $srcdir/eval_just_oval/sds.xml > /dev/null
+	$OSCAP oval eval --results $dir/oval2.xml --results-delta $dir/oval-delta2.xml \
+		--delta-baseline $dir/oval1.xml $srcdir/eval_just_oval/sds.xml > /dev/null
+	$OSCAP ds rds-apply-delta $dir/oval1.xml $dir/oval-delta2.xml $dir/oval-rebuilt2.xml
+	diff <(results_canonical $dir/oval2.xml) <(results_canonical $dir/oval-rebuilt2.xml)
+
+	rm -r $dir
+}
+
+# $1 the ARF, $2 the host name of its asset, $3 the result of its rule
+function rds_for_host {
+	sed -e "s|<ai:fqdn>[^<]*</ai:fqdn>|<ai:fqdn>$2.example.com</ai:fqdn>|" \
+		-e "s|<ai:hostname>[^<]*</ai:hostname>|<ai:hostname>$2</ai:hostname>|" \
+		-e "s|<result>pass</result>|<result>$3</result>|" $1
+}
+
+function test_rds_store {
+	local name=${FUNCNAME}
+	local dir=$(mktemp -d -t ${name}.XXXXXX)
+	local rule=xccdf_moc.elpmaxe.www_rule_second
+	local result=$dir/merged.xml
+
+	$OSCAP xccdf eval --results-arf $dir/arf.xml --datastream-id scap_org.open-scap_datastream_tst2 \
+		--xccdf-id scap_org.open-scap_cref_second-xccdf.xml2 --profile xccdf_moc.elpmaxe.www_profile_2 \
+		$srcdir/eval_xccdf_id/sds-complex.xml > /dev/null
+	rds_for_host $dir/arf.xml host-a pass > $dir/host-a.xml
+	rds_for_host $dir/arf.xml host-b fail > $dir/host-b.xml
+	rds_for_host $dir/arf.xml host-c pass > $dir/host-c.xml
+	grep -q '<result>fail</result>' $dir/host-b.xml
+
+	# the assets share the report request of the same content
+	$OSCAP ds rds-merge $result $dir/host-a.xml $dir/host-b.xml $dir/host-c.xml
+	$OSCAP ds rds-validate $result
+	assert_exists 3 '//assets/asset'
+	assert_exists 6 '//reports/report'
+	assert_exists 1 '//report-requests/report-request'
+	assert_exists 6 '//relationships/relationship'
+	assert_exists 0 '//reports/report[@id = preceding-sibling::report/@id]'
+	assert_exists 0 '//relationship[not(@subject = //reports/report/@id)]'
+	assert_exists 0 '//relationship/ref[not(. = //assets/asset/@id) and not(. = //report-requests/report-request/@id)]'
+	assert_exists 0 '//target-id-ref[not(@name = //assets/asset/@id)]'
+	assert_exists 0 '//@href[starts-with(., "#") and not(substring(., 2) = //@id)]'
+
+	# the assets are found by the results of their rules
+	[ "$($OSCAP ds rds-query --rule $rule $result | cut -f2)" == "host-b.example.com" ]
+	[ "$($OSCAP ds rds-query --rule $rule --result pass $result | cut -f2 | sort | tr '\n' ' ')" \
+		== "host-a.example.com host-c.example.com " ]
+	[ -z "$($OSCAP ds rds-query --rule $rule --result error $result)" ]
+
+	# merged stores are merged again, other content gets its own request
+	$OSCAP xccdf eval --results-arf $dir/other.xml --datastream-id scap_org.open-scap_datastream_tst \
+		--xccdf-id scap_org.open-scap_cref_second-xccdf.xml $srcdir/eval_xccdf_id/sds.xml > /dev/null
+	rds_for_host $dir/other.xml host-d pass > $dir/host-d.xml
+	$OSCAP ds rds-merge $dir/remerged.xml $result $dir/host-d.xml
+	$OSCAP ds rds-validate $dir/remerged.xml
+	result=$dir/remerged.xml
+	assert_exists 4 '//assets/asset'
+	assert_exists 8 '//reports/report'
+	assert_exists 2 '//report-requests/report-request'
+	assert_exists 0 '//relationship[not(@subject = //reports/report/@id)]'
+	assert_exists 0 '//@href[starts-with(., "#") and not(substring(., 2) = //@id)]'
+	[ "$($OSCAP ds rds-query --rule $rule $result | cut -f2)" == "host-b.example.com" ]
+	[ "$($OSCAP ds rds-query --rule $rule --result pass $result | cut -f2 | sort | tr '\n' ' ')" \
+		== "host-a.example.com host-c.example.com host-d.example.com " ]
+
+	rm -r $dir
+}
+
 function test_sds_external_xccdf {
     local SDS_FILE="${srcdir}/$2"
     local XCCDF="$3"
@@ -405,6 +516,8 @@ test_run "rds_simple" test_rds rds_simple/sds.xml rds_simple/results-xccdf.xml r
 test_run "rds_testresult" test_rds rds_testresult/sds.xml rds_testresult/results-xccdf.xml rds_testresult/results-oval.xml
 test_run "rds_index_simple" test_rds_index rds_index_simple/arf.xml "asset0 asset1" "report0" "collection0"
 test_run "rds_split_simple" test_rds_split rds_split_simple report-request.xml report.xml 0
+test_run "rds_delta" test_rds_delta
+test_run "rds_store" test_rds_store
 
 test_run "test_eval_complex" test_eval_complex
 test_run "sds_add_multiple_oval_twice_in_row" sds_add_multiple_twice
@@ -0,0 +1,201 @@
+#!/usr/bin/env bash
+
+# Copyright 2016 Red Hat Inc., Durham, North Carolina.
+# All Rights Reserved.
+#
+# OpenScap Benchmarks.
+#
+# Times the S-exp encodings and the probes over synthetic systems and
+# content and appends one JSON object per benchmark to $BENCH_OUTPUT
+# (bench.json by default). The size of the generated data is multiplied
+# by $BENCH_SCALE (1 by default). If $SSG_DS names a SCAP source data
+# stream, the evaluation of its $SSG_PROFILE is timed too.
+
+. ../test_common.sh
+
+set -e -o pipefail
+
+BENCH_SCALE=${BENCH_SCALE:-1}
+BENCH_OUTPUT=${BENCH_OUTPUT:-bench.json}
+BENCH_DIR=$(mktemp -d -t oscap_bench.XXXXXX)
+BENCH_PIDS=""
+
+function bench_cleanup {
+    [ -z "$BENCH_PIDS" ] || kill $BENCH_PIDS 2>/dev/null || true
+    rm -rf "$BENCH_DIR"
+}
+trap bench_cleanup EXIT
+
+function now {
+    date +%s.%N
+}
+
+# bench_report <name> <items> <start> <end>
+function bench_report {
+    awk -v n="$1" -v i="$2" -v s="$3" -v e="$4" 'BEGIN {
+        t = e - s
+        printf "{\"benchmark\":\"%s\",\"items\":%d,\"seconds\":%.6f,\"items_per_second\":%.0f}\n",
+               n, i, t, t > 0 ? i / t : 0
+    }' | tee -a "$BENCH_OUTPUT"
+}
+
+# bench_eval <name> <items> <content>
+function bench_eval {
+    local start end
+
+    start=$(now)
+    $OSCAP oval eval --results "$BENCH_DIR/$1.results.xml" "$3" >/dev/null
+    end=$(now)
+
+    bench_report "$1" "$2" "$start" "$end"
+}
+
+# gen_tree <dir> <directories> <files per directory>
+function gen_tree {
+    local d f
+
+    for d in $(seq 1 $2); do
+        mkdir -p "$1/d$((d % 16))/d$d"
+        for f in $(seq 1 $3); do
+            printf 'key%d = value%d\nsetting = %d\n' $f $d $f > "$1/d$((d % 16))/d$d/f$f.conf"
+        done
+    done
+}
+
+# gen_oval <file> <count> <test> <object>
+#
+# Writes <count> definitions, each with an existence test of the
+# <test> type on its own copy of the <object> body. The body is the
+# inside of the object element and the test is "ns:name", e.g.
+# "unix-def:file".
+function gen_oval {
+    local i ns=${3%%:*} name=${3#*:}
+
+    {
+        cat <<EOF
+<?xml version="1.0"?>
+<oval_definitions xmlns:oval="http://oval.mitre.org/XMLSchema/oval-common-5" xmlns:ind-def="http://oval.mitre.org/XMLSchema/oval-definitions-5#independent" xmlns:unix-def="http://oval.mitre.org/XMLSchema/oval-definitions-5#unix" xmlns:linux-def="http://oval.mitre.org/XMLSchema/oval-definitions-5#linux" xmlns="http://oval.mitre.org/XMLSchema/oval-definitions-5">
+  <generator>
+    <oval:product_name>bench</oval:product_name>
+    <oval:schema_version>5.11</oval:schema_version>
+    <oval:timestamp>2016-01-01T00:00:00-00:00</oval:timestamp>
+  </generator>
+  <definitions>
+EOF
+        for i in $(seq 1 $2); do
+            cat <<EOF
+    <definition class="compliance" version="1" id="oval:x:def:$i">
+      <metadata><title>$name $i</title><description>bench</description></metadata>
+      <criteria><criterion test_ref="oval:x:tst:$i"/></criteria>
+    </definition>
+EOF
+        done
+        echo "  </definitions>"
+        echo "  <tests>"
+        for i in $(seq 1 $2); do
+            cat <<EOF
+    <$ns:${name}_test check="all" check_existence="at_least_one_exists" comment="$name $i" id="oval:x:tst:$i" version="1">
+      <$ns:object object_ref="oval:x:obj:$i"/>
+    </$ns:${name}_test>
+EOF
+        done
+        echo "  </tests>"
+        echo "  <objects>"
+        for i in $(seq 1 $2); do
+            echo "    <$ns:${name}_object id=\"oval:x:obj:$i\" version=\"1\">"
+            echo "      ${4//@N@/$i}"
+            echo "    </$ns:${name}_object>"
+        done
+        echo "  </objects>"
+        echo "</oval_definitions>"
+    } > "$1"
+}
+
+function bench_sexp {
+    ./bench_sexp $((100000 * BENCH_SCALE)) 5 | tee -a "$BENCH_OUTPUT"
+}
+
+function bench_probes_files {
+    local dirs=$((500 * BENCH_SCALE)) files=20 tree="$BENCH_DIR/tree"
+    local items=$((dirs * files))
+
+    gen_tree "$tree" $dirs $files
+
+    probecheck "file" && {
+        gen_oval "$BENCH_DIR/file.xml" 1 unix-def:file \
+            "<unix-def:path operation=\"pattern match\">^$tree/.*</unix-def:path><unix-def:filename operation=\"pattern match\">\\.conf\$</unix-def:filename>"
+        bench_eval probe_file $items "$BENCH_DIR/file.xml"
+    }
+
+    probecheck "textfilecontent54" && {
+        gen_oval "$BENCH_DIR/tfc54.xml" 1 ind-def:textfilecontent54 \
+            "<ind-def:path operation=\"pattern match\">^$tree/.*</ind-def:path><ind-def:filename operation=\"pattern match\">\\.conf\$</ind-def:filename><ind-def:pattern operation=\"pattern match\">^key[0-9]+ = (.*)\$</ind-def:pattern><ind-def:instance datatype=\"int\" operation=\"greater than or equal\">1</ind-def:instance>"
+        bench_eval probe_textfilecontent54 $items "$BENCH_DIR/tfc54.xml"
+    }
+
+    probecheck "filehash58" && {
+        gen_oval "$BENCH_DIR/filehash58.xml" 1 ind-def:filehash58 \
+            "<ind-def:path operation=\"pattern match\">^$tree/.*</ind-def:path><ind-def:filename operation=\"pattern match\">\\.conf\$</ind-def:filename><ind-def:hash_type>SHA-256</ind-def:hash_type>"
+        bench_eval probe_filehash58 $items "$BENCH_DIR/filehash58.xml"
+    }
+
+    # large content: the overhead of many small objects over the same file
+    probecheck "textfilecontent54" && {
+        gen_oval "$BENCH_DIR/content.xml" $((2000 * BENCH_SCALE)) ind-def:textfilecontent54 \
+            "<ind-def:filepath>$tree/d1/d1/f1.conf</ind-def:filepath><ind-def:pattern operation=\"pattern match\">^setting = @N@\$</ind-def:pattern><ind-def:instance datatype=\"int\">1</ind-def:instance>"
+        bench_eval oval_content $((2000 * BENCH_SCALE)) "$BENCH_DIR/content.xml"
+    }
+
+    return 0
+}
+
+function bench_probes_processes {
+    local count=$((200 * BENCH_SCALE)) i
+
+    probecheck "process58" || return 0
+
+    for i in $(seq 1 $count); do
+        sleep 3600 &
+        BENCH_PIDS="$BENCH_PIDS $!"
+    done
+
+    gen_oval "$BENCH_DIR/process58.xml" 1 unix-def:process58 \
+        "<unix-def:command_line operation=\"pattern match\">^sleep 3600\$</unix-def:command_line><unix-def:pid datatype=\"int\" operation=\"greater than\">0</unix-def:pid>"
+    bench_eval probe_process58 $count "$BENCH_DIR/process58.xml"
+
+    kill $BENCH_PIDS 2>/dev/null || true
+    BENCH_PIDS=""
+}
+
+# the packages of the host, a synthetic rpm database would need rpmbuild
+function bench_probes_packages {
+    local count
+
+    probecheck "rpminfo" || return 0
+    count=$(rpm -qa 2>/dev/null | wc -l) || return 0
+    [ "$count" -gt 0 ] || return 0
+
+    gen_oval "$BENCH_DIR/rpminfo.xml" 1 linux-def:rpminfo \
+        "<linux-def:name operation=\"pattern match\">.*</linux-def:name>"
+    bench_eval probe_rpminfo $count "$BENCH_DIR/rpminfo.xml"
+}
+
+function bench_ssg {
+    local start end rules
+
+    [ -n "$SSG_DS" ] || return 0
+
+    start=$(now)
+    $OSCAP xccdf eval ${SSG_PROFILE:+--profile "$SSG_PROFILE"} \
+        --results "$BENCH_DIR/ssg.results.xml" "$SSG_DS" >/dev/null || [ $? -eq 2 ]
+    end=$(now)
+
+    rules=$($XPATH "$BENCH_DIR/ssg.results.xml" 'count(//*[local-name()="rule-result"])' 2>/dev/null)
+    bench_report ssg_profile "${rules:-0}" "$start" "$end"
+}
+
+bench_sexp
+bench_probes_files
+bench_probes_processes
+bench_probes_packages
+bench_ssg
@@ -0,0 +1,248 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Throughput of the S-exp operations on the path of every collected item:
+ * building the items, the text and the binary encodings used by SEAP and
+ * their parsers, and of the parser of the atoms written by hand, e.g. in
+ * the templates. Prints one JSON object per benchmark, the best of the
+ * rounds.
+ *
+ * Usage: bench_sexp [items [rounds]]
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <strbuf.h>
+#include <sexp.h>
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *name, size_t items, size_t bytes, double seconds)
+{
+	printf("{\"benchmark\":\"%s\",\"items\":%zu,\"bytes\":%zu,\"seconds\":%.6f,\"items_per_second\":%.0f}\n",
+	       name, items, bytes, seconds, seconds > 0 ? items / seconds : 0);
+}
+
+static void add_entity(SEXP_t *item, const char *name, SEXP_t *value)
+{
+	SEXP_t *s_name, *entity;
+
+	s_name = SEXP_string_new(name, strlen(name));
+	entity = SEXP_list_new(s_name, value, NULL);
+	SEXP_list_add(item, entity);
+	SEXP_free(entity);
+	SEXP_free(s_name);
+	SEXP_free(value);
+}
+
+/* a collected object with `count' items shaped like file_item */
+static SEXP_t *build_cobj(size_t count)
+{
+	SEXP_t *items, *item, *head, *flags, *cobj;
+	SEXP_t *s_name, *s_attr, *s_id;
+	size_t i;
+
+	items = SEXP_list_new(NULL);
+
+	for (i = 0; i < count; ++i) {
+		s_name = SEXP_string_newf("file_item");
+		s_attr = SEXP_string_newf(":id");
+		s_id   = SEXP_string_newf("1%05zu", i);
+		head   = SEXP_list_new(s_name, s_attr, s_id, NULL);
+		item   = SEXP_list_new(head, NULL);
+		SEXP_free(head);
+		SEXP_free(s_id);
+		SEXP_free(s_attr);
+		SEXP_free(s_name);
+
+		add_entity(item, "path", SEXP_string_newf("/bench/dir%zu", i / 100));
+		add_entity(item, "filename", SEXP_string_newf("file%zu", i));
+		add_entity(item, "type", SEXP_string_newf("regular"));
+		add_entity(item, "size", SEXP_number_newu_64(4096 + i));
+		add_entity(item, "m_time", SEXP_number_newu_64(1400000000 + i));
+
+		SEXP_list_add(items, item);
+		SEXP_free(item);
+	}
+
+	flags = SEXP_number_newu(0);
+	head  = SEXP_list_new(NULL);
+	cobj  = SEXP_list_new(flags, head, items, head, NULL);
+	SEXP_free(head);
+	SEXP_free(flags);
+	SEXP_free(items);
+
+	return (cobj);
+}
+
+/* a list of `count' unquoted and quoted paths */
+static char *build_atoms(size_t count, size_t *len)
+{
+	size_t i, cap = count * 96 + 3;
+	char *buf;
+	int n;
+
+	buf  = malloc(cap);
+	*len = 0;
+	buf[(*len)++] = '(';
+
+	for (i = 0; i < count; ++i) {
+		n = snprintf(buf + *len, cap - *len, i % 2 == 0 ?
+			     "/usr/share/doc/package%zu/examples/README.configuration " :
+			     "\"/etc/sysconfig/network-scripts/ifcfg-eth%zu.backup\" ", i);
+		*len += (size_t)n;
+	}
+
+	buf[(*len)++] = ')';
+	buf[*len] = '\0';
+
+	return (buf);
+}
+
+static char *sb_cstr(strbuf_t *sb, size_t *len)
+{
+	char *buf;
+
+	*len = strbuf_length(sb);
+	buf  = malloc(*len + 1);
+	strbuf_copy(sb, buf, *len);
+	buf[*len] = '\0';
+
+	return (buf);
+}
+
+int main(int argc, char *argv[])
+{
+	size_t items = 100000, rounds = 5, r, len_t = 0, len_b = 0, len_a = 0;
+	double t, best[7] = { 1e9, 1e9, 1e9, 1e9, 1e9, 1e9, 1e9 };
+	char *text = NULL, *bin = NULL, *atoms;
+
+	if (argc > 1)
+		items = strtoul(argv[1], NULL, 10);
+	if (argc > 2)
+		rounds = strtoul(argv[2], NULL, 10);
+
+	for (r = 0; r < rounds; ++r) {
+		SEXP_psetup_t *psetup;
+		SEXP_pstate_t *pstate = NULL;
+		SEXP_t *cobj, *parsed;
+		strbuf_t *sb;
+
+		t = now();
+		cobj = build_cobj(items);
+		t = now() - t;
+		best[0] = t < best[0] ? t : best[0];
+
+		sb = strbuf_new(SEAP_STRBUF_MAX);
+		t = now();
+		SEXP_sbprintf_t(cobj, sb);
+		t = now() - t;
+		best[1] = t < best[1] ? t : best[1];
+		free(text);
+		text = sb_cstr(sb, &len_t);
+		strbuf_free(sb);
+
+		psetup = SEXP_psetup_new();
+		t = now();
+		parsed = SEXP_parse(psetup, text, len_t, &pstate);
+		t = now() - t;
+		best[2] = t < best[2] ? t : best[2];
+		SEXP_psetup_free(psetup);
+		if (pstate != NULL)
+			SEXP_pstate_free(pstate);
+
+		/* the parser returns the list of the top-level expressions */
+		if (parsed == NULL || SEXP_list_length(parsed) != 1) {
+			fprintf(stderr, "Can't parse the text encoding.\n");
+			return (1);
+		}
+		SEXP_free(parsed);
+
+		sb = strbuf_new(SEAP_STRBUF_MAX);
+		t = now();
+		SEXP_sbprintf_b(cobj, sb);
+		t = now() - t;
+		best[3] = t < best[3] ? t : best[3];
+		free(bin);
+		bin = sb_cstr(sb, &len_b);
+		strbuf_free(sb);
+
+		t = now();
+		parsed = SEXP_parse_binary(bin, len_b);
+		t = now() - t;
+		best[4] = t < best[4] ? t : best[4];
+
+		if (parsed == NULL) {
+			fprintf(stderr, "Can't parse the binary encoding.\n");
+			return (1);
+		}
+
+		t = now();
+		SEXP_free(parsed);
+		SEXP_free(cobj);
+		t = now() - t;
+		best[5] = t < best[5] ? t : best[5];
+
+		/* the parser frees the buffer with the state */
+		atoms  = build_atoms(items, &len_a);
+		psetup = SEXP_psetup_new();
+		SEXP_psetup_setflags(psetup, SEXP_PFLAG_FREEBUF);
+		pstate = NULL;
+		t = now();
+		parsed = SEXP_parse(psetup, atoms, len_a, &pstate);
+		t = now() - t;
+		best[6] = t < best[6] ? t : best[6];
+		SEXP_psetup_free(psetup);
+		if (pstate != NULL)
+			SEXP_pstate_free(pstate);
+
+		if (parsed == NULL) {
+			fprintf(stderr, "Can't parse the atoms.\n");
+			return (1);
+		}
+		SEXP_free(parsed);
+	}
+
+	report("sexp_build", items, 0, best[0]);
+	report("sexp_print_text", items, len_t, best[1]);
+	report("sexp_parse_text", items, len_t, best[2]);
+	report("sexp_print_binary", items, len_b, best[3]);
+	report("sexp_parse_binary", items, len_b, best[4]);
+	report("sexp_free", items * 2, 0, best[5]);
+	report("sexp_parse_atoms", items, len_a, best[6]);
+
+	free(text);
+	free(bin);
+
+	return (0);
+}
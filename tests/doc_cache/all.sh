@@ -0,0 +1,11 @@
+#!/bin/bash
+
+set -e -o pipefail
+
+. ../test_common.sh
+
+test_init "test_doc_cache.log"
+
+test_run "Evaluation with the document cache" $srcdir/test_doc_cache.sh
+
+test_exit
@@ -0,0 +1,103 @@
+#!/bin/bash
+
+# The data stream is evaluated with the document cache empty, filled,
+# with the content changed, with the entries damaged and with the cache
+# accessible by others. The results have to be those of the evaluation
+# without the cache, the cache has to be used only when it's valid.
+
+set -e -o pipefail
+set -x
+
+name=$(basename $0 .sh)
+dir=$(mktemp -d -t ${name}.XXXXXX)
+cache=$dir/cache
+mkdir -m 700 $cache
+cp $srcdir/../DS/sds_multiple_oval/*.xml $dir/
+sds=$dir/sds.xml
+( cd $dir; $OSCAP ds sds-compose multiple-oval-xccdf.xml $sds )
+
+function strip_times {
+	sed 's/[0-9]\{4\}-[0-9][0-9]-[0-9][0-9]T[0-9][0-9]:[0-9][0-9]:[0-9][0-9][^"<]*//g' $1
+}
+
+# $1 name of the run, $2 content, the results are checked against ref
+function eval_cached {
+	OSCAP_DOC_CACHE=$cache $OSCAP xccdf eval --verbose INFO --verbose-log-file $dir/$1.log \
+		--results $dir/$1.xml $2 > $dir/$1.out 2> $dir/$1.err || [ $? == 2 ]
+	[ ! -s $dir/$1.err ]
+	diff $dir/ref.out $dir/$1.out
+	diff <(strip_times $dir/ref.xml) <(strip_times $dir/$1.xml)
+}
+
+function loaded {
+	grep -c "Loaded the parsed document from the cache" $dir/$1.log || true
+}
+
+function stored {
+	grep -c "Stored the parsed document in the cache" $dir/$1.log || true
+}
+
+$OSCAP xccdf eval --results $dir/ref.xml $sds > $dir/ref.out || [ $? == 2 ]
+grep -q '^Result.*fail$' $dir/ref.out
+
+# empty cache
+eval_cached cold $sds
+[ $(loaded cold) == 0 ]
+[ $(stored cold) -gt 0 ]
+entries=$(ls $cache | wc -l)
+[ $entries == $(stored cold) ]
+[ -z "$(find $cache -type f -perm /077)" ]
+
+# filled cache
+eval_cached warm $sds
+[ $(loaded warm) == $entries ]
+[ $(stored warm) == 0 ]
+[ $(ls $cache | wc -l) == $entries ]
+
+# changed content isn't taken from the entries of the original one
+sed 's/Ensure that \/tmp has its own partition/Ensure that \/var has its own partition/' $sds > $dir/sds-changed.xml
+OSCAP_DOC_CACHE=$cache $OSCAP xccdf eval --verbose INFO --verbose-log-file $dir/changed.log \
+	$dir/sds-changed.xml > $dir/changed.out || [ $? == 2 ]
+[ $(grep -c '^Title.*Ensure that /var has its own partition' $dir/changed.out) == 2 ]
+[ $(loaded changed) == 0 ]
+[ $(stored changed) -gt 0 ]
+[ $(ls $cache | wc -l) -gt $entries ]
+eval_cached warm-again $sds
+[ $(loaded warm-again) == $entries ]
+
+# truncated entries are ignored and replaced
+rm $cache/*
+eval_cached refill $sds
+for entry in $cache/*; do
+	truncate -s $(( $(stat -c %s $entry) / 2 )) $entry
+done
+eval_cached truncated $sds
+[ $(grep -c "Ignoring the invalid document cache entry" $dir/truncated.log) == $entries ]
+[ $(loaded truncated) == 0 ]
+[ $(stored truncated) == $entries ]
+eval_cached replaced $sds
+[ $(loaded replaced) == $entries ]
+
+# entries of another format version are ignored
+for entry in $cache/*; do
+	printf '\377' | dd of=$entry bs=1 seek=8 conv=notrunc
+done
+eval_cached version $sds
+[ $(grep -c "Ignoring the invalid document cache entry" $dir/version.log) == $entries ]
+[ $(loaded version) == 0 ]
+
+# entries accessible by others aren't used
+chmod 644 $cache/*
+eval_cached public-entry $sds
+[ $(loaded public-entry) == 0 ]
+chmod 600 $cache/*
+
+# nor is a cache directory accessible by others
+chmod 755 $cache
+eval_cached public-dir $sds
+grep -q "Not using the document cache" $dir/public-dir.log
+[ $(loaded public-dir) == 0 ]
+[ $(stored public-dir) == 0 ]
+chmod 700 $cache
+
+rm -rf $dir
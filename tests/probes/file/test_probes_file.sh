@@ -120,6 +120,214 @@ function test_probes_file_invalid_utf8 {
 	return $ret_val
 }
 
+function test_probes_file_threads {
+
+	probecheck "file" || return 255
+
+	local ret_val=0
+	local DF="$srcdir/test_probes_file_threads.xml"
+	files_dir=$(mktemp -d)
+	DF_INJECTED=$(mktemp)
+
+	echo "Files dir:	${files_dir}"
+	echo "Content file:	${DF_INJECTED}"
+
+	# a tree wide enough to be split between the threads, with a
+	# symlink back to its root
+	for a in 1 2 3 4; do
+		for b in 1 2 3 4; do
+			for c in 1 2 3; do
+				mkdir -p "$files_dir/d$a/e$b/g$c"
+				touch "$files_dir/d$a/e$b/g$c/x" "$files_dir/d$a/e$b/g$c/y"
+			done
+			touch "$files_dir/d$a/e$b/x"
+		done
+	done
+	ln -s "$files_dir" "$files_dir/d1/loop"
+
+	sed "s;<!--injected-path -->;${files_dir};" "$DF" > $DF_INJECTED
+
+	# the threaded walk has to find exactly what the serial one finds
+	OSCAP_FTS_THREADS=1 $OSCAP oval eval --results results_serial.xml $DF_INJECTED || ret_val=1
+	OSCAP_FTS_THREADS=4 $OSCAP oval eval --results results_threads.xml $DF_INJECTED || ret_val=1
+	$OSCAP oval validate results_threads.xml || ret_val=1
+
+	for f in results_serial.xml results_threads.xml; do
+		grep -o '<unix-sys:\(path\|filepath\)>[^<]*' $f | sort > $f.items
+	done
+
+	[ -s results_serial.xml.items ] || ret_val=1
+	diff results_serial.xml.items results_threads.xml.items || ret_val=1
+
+	rm $DF_INJECTED results_serial.xml* results_threads.xml*
+	rm -rf "$files_dir"
+
+	return $ret_val
+}
+
+function test_probes_file_cache {
+
+	probecheck "file" || return 255
+
+	local ret_val=0
+	local DF="$srcdir/test_probes_file_threads.xml"
+	files_dir=$(mktemp -d)
+	DF_INJECTED=$(mktemp)
+
+	echo "Files dir:	${files_dir}"
+	echo "Content file:	${DF_INJECTED}"
+
+	for a in 1 2 3; do
+		for b in 1 2 3; do
+			mkdir -p "$files_dir/d$a/e$b"
+			touch "$files_dir/d$a/e$b/x" "$files_dir/d$a/e$b/y"
+		done
+		touch "$files_dir/d$a/x"
+	done
+
+	sed "s;<!--injected-path -->;${files_dir};" "$DF" > $DF_INJECTED
+
+	# objects walking the same tree are served from the walk cache
+	OSCAP_FTS_CACHE=0 $OSCAP oval eval --results results_nocache.xml $DF_INJECTED || ret_val=1
+	$OSCAP oval eval --verbose INFO --verbose-log-file verbose_cache \
+		--results results_cache.xml $DF_INJECTED || ret_val=1
+	$OSCAP oval validate results_cache.xml || ret_val=1
+
+	grep -q "Replaying the cached walk of '${files_dir}'" verbose_cache || ret_val=1
+
+	for f in results_nocache.xml results_cache.xml; do
+		grep -o '<unix-sys:\(path\|filepath\)>[^<]*' $f | sort > $f.items
+	done
+
+	[ -s results_nocache.xml.items ] || ret_val=1
+	diff results_nocache.xml.items results_cache.xml.items || ret_val=1
+
+	rm $DF_INJECTED results_nocache.xml* results_cache.xml* verbose_cache
+	rm -rf "$files_dir"
+
+	return $ret_val
+}
+
+# the walks cut short by the deadline of their object aren't cached
+function test_probes_file_cache_timeout {
+
+	probecheck "file" || return 255
+
+	local ret_val=0
+	local DF="$srcdir/test_probes_file_threads.xml"
+	files_dir=$(mktemp -d)
+	DF_INJECTED=$(mktemp)
+
+	for a in $(seq 10); do
+		mkdir "$files_dir/d$a"
+		for b in $(seq 20); do
+			touch "$files_dir/d$a/f$b"
+		done
+	done
+
+	sed "s;<!--injected-path -->;${files_dir};" "$DF" > $DF_INJECTED
+
+	# every walk takes 10 seconds, each object gets 1
+	OSCAP_PROBE_STAT_RATE=20 OSCAP_PROBE_TIMEOUT=1 \
+		$OSCAP oval eval --verbose INFO --verbose-log-file verbose_timeout \
+		--results results_timeout.xml $DF_INJECTED || ret_val=1
+
+	[ "$(grep -c '<object [^>]*flag="incomplete"' results_timeout.xml)" == "4" ] || ret_val=1
+	! grep -q "Cached [0-9]* entries of walk" verbose_timeout || ret_val=1
+
+	rm $DF_INJECTED results_timeout.xml verbose_timeout
+	rm -rf "$files_dir"
+
+	return $ret_val
+}
+
+# the probes forked from the zygotes give the results of the probes started
+# the usual way
+function test_probes_file_zygote {
+
+	probecheck "file" || return 255
+
+	local ret_val=0
+	local DF="$srcdir/test_probes_file_threads.xml"
+	files_dir=$(mktemp -d)
+	DF_INJECTED=$(mktemp)
+
+	for a in 1 2 3; do
+		for b in 1 2 3; do
+			mkdir -p "$files_dir/d$a/e$b"
+			touch "$files_dir/d$a/e$b/x" "$files_dir/d$a/e$b/y"
+		done
+		touch "$files_dir/d$a/x"
+	done
+
+	sed "s;<!--injected-path -->;${files_dir};" "$DF" > $DF_INJECTED
+
+	$OSCAP oval eval --results results_exec.xml $DF_INJECTED > stdout_exec || ret_val=1
+	OSCAP_PROBE_ZYGOTE=1 $OSCAP oval eval --verbose INFO --verbose-log-file verbose_zygote \
+		--results results_zygote.xml $DF_INJECTED > stdout_zygote || ret_val=1
+	$OSCAP oval validate results_zygote.xml || ret_val=1
+
+	grep -q "Started the zygote of .*probe_file" verbose_zygote || ret_val=1
+	! grep -q "The zygote of .* failed" verbose_zygote || ret_val=1
+	diff stdout_exec stdout_zygote || ret_val=1
+
+	for f in results_exec.xml results_zygote.xml; do
+		grep -o '<unix-sys:\(path\|filepath\)>[^<]*\|<object [^>]*flag="[a-z_]*"' $f | sort > $f.items
+	done
+
+	[ -s results_exec.xml.items ] || ret_val=1
+	diff results_exec.xml.items results_zygote.xml.items || ret_val=1
+
+	rm $DF_INJECTED results_exec.xml* results_zygote.xml* stdout_exec stdout_zygote verbose_zygote
+	rm -rf "$files_dir"
+
+	return $ret_val
+}
+
+# the items sent in chunks by the probe are all in the collected object, the
+# same ones as of the objects small enough to be sent at once
+function test_probes_file_chunks {
+
+	probecheck "file" || return 255
+
+	local ret_val=0
+	local DF="$srcdir/test_probes_file_chunks.xml"
+	files_dir=$(mktemp -d)
+	DF_INJECTED=$(mktemp)
+
+	# 2700 files in the tree, 900 in every directory; a chunk has 1024
+	for a in 1 2 3; do
+		mkdir "$files_dir/d$a"
+		( cd "$files_dir/d$a" && seq -f "f%g" 900 | xargs touch )
+	done
+
+	sed "s;<!--injected-path -->;${files_dir};" "$DF" > $DF_INJECTED
+
+	$OSCAP oval eval --verbose INFO --verbose-log-file verbose_chunks \
+		--results results_chunks.xml $DF_INJECTED || ret_val=1
+	$OSCAP oval validate results_chunks.xml || ret_val=1
+
+	# the items are flushed once the cache holds a chunk, it may hold more then
+	grep -q "[0-9]* items sent in 2 chunks" verbose_chunks || ret_val=1
+	[ "$(grep -c '<definition [^>]*result="true"' results_chunks.xml)" == "2" ] || ret_val=1
+
+	# the references to the items of an object
+	for obj in 1 2 3 4; do
+		awk -v obj="oval:1:obj:$obj" '
+			/<object / { o = index($0, "id=\"" obj "\"") > 0 }
+			o && /<reference / { print }
+			/<\/object>/ { o = 0 }' results_chunks.xml | sort > results_chunks.xml.obj$obj
+	done
+
+	[ "$(wc -l < results_chunks.xml.obj1)" == "2700" ] || ret_val=1
+	sort results_chunks.xml.obj[234] | diff results_chunks.xml.obj1 - || ret_val=1
+
+	rm $DF_INJECTED results_chunks.xml* verbose_chunks
+	rm -rf "$files_dir"
+
+	return $ret_val
+}
+
 # Testing.
 
 test_init "test_probes_file.log"
@@ -128,5 +336,10 @@ test_run "test_probes_file with verbose mode" test_probes_file verbose
 test_run "test_probes_file" test_probes_file
 test_run "test_probes_file_filenames" test_probes_file_filenames
 test_run "test_probes_file_invalid_utf8" test_probes_file_invalid_utf8
+test_run "test_probes_file_threads" test_probes_file_threads
+test_run "test_probes_file_cache" test_probes_file_cache
+test_run "test_probes_file_cache_timeout" test_probes_file_cache_timeout
+test_run "test_probes_file_zygote" test_probes_file_zygote
+test_run "test_probes_file_chunks" test_probes_file_chunks
 
 test_exit
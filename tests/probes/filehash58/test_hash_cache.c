@@ -0,0 +1,127 @@
+/*
+ * Copyright 2016 Red Hat Inc., Durham, North Carolina.
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * "put" stores a digest in the hash cache named by OSCAP_HASH_CACHE, "get"
+ * finds it from another process and checks that a change of the device,
+ * inode, size, mtime, ctime or algorithm misses it. "off" checks that the
+ * cache isn't used.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+#include <sys/stat.h>
+#include "../../assume.h"
+#include "crapi/digest.h"
+#include "oval_hash_cache.h"
+
+static void hash_cache_stat(struct stat *st)
+{
+	memset(st, 0, sizeof *st);
+	st->st_dev = 8;
+	st->st_ino = 1234;
+	st->st_size = 4096;
+	st->st_mtim.tv_sec = 1450000000;
+	st->st_mtim.tv_nsec = 1000;
+	st->st_ctim.tv_sec = 1450000001;
+	st->st_ctim.tv_nsec = 2000;
+}
+
+static bool hash_cache_found(const struct stat *st, int alg)
+{
+	unsigned char digest[OVAL_HASH_CACHE_DSTMAX];
+	size_t len = sizeof digest;
+
+	return oval_hash_cache_get(st, alg, digest, &len);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned char digest[20], found[OVAL_HASH_CACHE_DSTMAX];
+	struct stat st, other;
+	size_t len;
+	size_t i;
+
+	assume(argc == 2);
+
+	for (i = 0; i < sizeof digest; ++i)
+		digest[i] = (unsigned char)i;
+	hash_cache_stat(&st);
+
+	if (strcmp(argv[1], "off") == 0) {
+		oval_hash_cache_put(&st, CRAPI_DIGEST_SHA1, digest, sizeof digest);
+		assume(!oval_hash_cache_enabled());
+		assume(!hash_cache_found(&st, CRAPI_DIGEST_SHA1));
+		return 0;
+	}
+
+	assume(oval_hash_cache_enabled());
+
+	if (strcmp(argv[1], "put") == 0) {
+		assume(!hash_cache_found(&st, CRAPI_DIGEST_SHA1));
+		oval_hash_cache_put(&st, CRAPI_DIGEST_SHA1, digest, sizeof digest);
+		assume(hash_cache_found(&st, CRAPI_DIGEST_SHA1));
+		return 0;
+	}
+
+	assume(strcmp(argv[1], "get") == 0);
+
+	len = sizeof found;
+	assume(oval_hash_cache_get(&st, CRAPI_DIGEST_SHA1, found, &len));
+	assume(len == sizeof digest && memcmp(found, digest, len) == 0);
+
+	/* the digest doesn't fit */
+	len = sizeof digest - 1;
+	assume(!oval_hash_cache_get(&st, CRAPI_DIGEST_SHA1, found, &len));
+
+	assume(!hash_cache_found(&st, CRAPI_DIGEST_SHA256));
+
+	other = st;
+	other.st_dev++;
+	assume(!hash_cache_found(&other, CRAPI_DIGEST_SHA1));
+
+	other = st;
+	other.st_ino++;
+	assume(!hash_cache_found(&other, CRAPI_DIGEST_SHA1));
+
+	other = st;
+	other.st_size++;
+	assume(!hash_cache_found(&other, CRAPI_DIGEST_SHA1));
+
+	other = st;
+	other.st_mtim.tv_nsec++;
+	assume(!hash_cache_found(&other, CRAPI_DIGEST_SHA1));
+	assume(oval_hash_cache_stat_changed(&st, &other));
+
+	/* a file modified in place, its mtime set back */
+	other = st;
+	other.st_ctim.tv_sec++;
+	assume(!hash_cache_found(&other, CRAPI_DIGEST_SHA1));
+	assume(oval_hash_cache_stat_changed(&st, &other));
+
+	other = st;
+	other.st_atim.tv_sec++;
+	assume(!oval_hash_cache_stat_changed(&st, &other));
+
+	return 0;
+}
@@ -43,10 +43,79 @@ function test_probes_filehash58 {
     return $ret_val
 }
 
+# the digests of the hash cache, from another process
+function test_probes_filehash58_cache_api {
+
+    local ret_val=0
+    local cache=$(mktemp -u)
+
+    OSCAP_HASH_CACHE=$cache ./test_hash_cache put || ret_val=1
+    OSCAP_HASH_CACHE=$cache ./test_hash_cache get || ret_val=1
+    [ -z "$(find $cache -perm /077)" ] || ret_val=1
+
+    # not used if others may access it
+    chmod 644 $cache
+    OSCAP_HASH_CACHE=$cache ./test_hash_cache off || ret_val=1
+    OSCAP_HASH_CACHE= ./test_hash_cache off || ret_val=1
+
+    rm -f $cache
+    return $ret_val
+}
+
+# the probe computes the digest of a changed file again
+function test_probes_filehash58_cache {
+
+    probecheck "filehash58" || return 255
+    require "sha1sum" || return 255
+    require "sha256sum" || return 255
+
+    local ret_val=0
+    local DF="test_probes_filehash58_cache.xml"
+    local dir=$(mktemp -d)
+    local cache=$(mktemp -u)
+    local f old
+
+    echo "first" > $dir/f1
+    echo "second" > $dir/f2
+    bash ${srcdir}/test_probes_filehash58_cache.xml.sh $dir > $DF
+
+    OSCAP_HASH_CACHE=$cache $OSCAP oval eval --results results_cache1.xml $DF || ret_val=1
+    [ -s $cache ] || ret_val=1
+
+    # the same size and mtime, only the ctime differs
+    old=$(sha256sum $dir/f1 | cut -d ' ' -f 1)
+    grep -q "$old" results_cache1.xml || ret_val=1
+    echo "FIRST" > $dir/f1.new
+    touch -r $dir/f1 $dir/f1.new
+    cat $dir/f1.new > $dir/f1
+    touch -r $dir/f1.new $dir/f1
+
+    OSCAP_HASH_CACHE=$cache $OSCAP oval eval --results results_cache2.xml $DF || ret_val=1
+    for f in f1 f2; do
+        grep -q "$(sha1sum $dir/$f | cut -d ' ' -f 1)" results_cache2.xml || ret_val=1
+        grep -q "$(sha256sum $dir/$f | cut -d ' ' -f 1)" results_cache2.xml || ret_val=1
+    done
+    ! grep -q "$old" results_cache2.xml || ret_val=1
+
+    # --no-hash-cache doesn't create nor read it
+    rm $cache
+    OSCAP_HASH_CACHE=$cache $OSCAP oval eval --no-hash-cache --results results_cache3.xml $DF || ret_val=1
+    [ ! -e $cache ] || ret_val=1
+    for f in f1 f2; do
+        grep -q "$(sha256sum $dir/$f | cut -d ' ' -f 1)" results_cache3.xml || ret_val=1
+    done
+
+    rm -rf $dir $DF results_cache1.xml results_cache2.xml results_cache3.xml
+    rm -f $cache
+    return $ret_val
+}
+
 # Testing.
 
 test_init "test_probes_filehash58.log"
 
 test_run "test_probes_filehash58" test_probes_filehash58
+test_run "test_probes_filehash58_cache_api" test_probes_filehash58_cache_api
+test_run "test_probes_filehash58_cache" test_probes_filehash58_cache
 
 test_exit
@@ -0,0 +1,52 @@
+#!/usr/bin/env bash
+
+# $1 the directory of the hashed files
+
+cat <<EOF
+<?xml version="1.0"?>
+<oval_definitions xmlns:oval="http://oval.mitre.org/XMLSchema/oval-common-5" xmlns="http://oval.mitre.org/XMLSchema/oval-definitions-5" xmlns:ind-def="http://oval.mitre.org/XMLSchema/oval-definitions-5#independent">
+
+      <generator>
+            <oval:product_name>filehash58</oval:product_name>
+            <oval:product_version>1.0</oval:product_version>
+            <oval:schema_version>5.8</oval:schema_version>
+            <oval:timestamp>2016-03-01T00:00:00-00:00</oval:timestamp>
+      </generator>
+
+  <definitions>
+    <definition class="compliance" version="1" id="oval:1:def:1">
+      <metadata>
+        <title></title>
+        <description></description>
+      </metadata>
+      <criteria operator="AND">
+        <criterion test_ref="oval:1:tst:1"/>
+        <criterion test_ref="oval:1:tst:2"/>
+      </criteria>
+    </definition>
+  </definitions>
+
+  <tests>
+    <ind-def:filehash58_test version="1" id="oval:1:tst:1" check="all" comment="true">
+      <ind-def:object object_ref="oval:1:obj:1"/>
+    </ind-def:filehash58_test>
+    <ind-def:filehash58_test version="1" id="oval:1:tst:2" check="all" comment="true">
+      <ind-def:object object_ref="oval:1:obj:2"/>
+    </ind-def:filehash58_test>
+  </tests>
+
+  <objects>
+    <ind-def:filehash58_object version="1" id="oval:1:obj:1">
+      <ind-def:path>$1</ind-def:path>
+      <ind-def:filename operation="pattern match">^f</ind-def:filename>
+      <ind-def:hash_type>SHA-1</ind-def:hash_type>
+    </ind-def:filehash58_object>
+    <ind-def:filehash58_object version="1" id="oval:1:obj:2">
+      <ind-def:path>$1</ind-def:path>
+      <ind-def:filename operation="pattern match">^f</ind-def:filename>
+      <ind-def:hash_type>SHA-256</ind-def:hash_type>
+    </ind-def:filehash58_object>
+  </objects>
+
+</oval_definitions>
+EOF
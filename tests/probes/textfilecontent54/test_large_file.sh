@@ -0,0 +1,38 @@
+#!/usr/bin/env bash
+
+# Copyright 2016 Red Hat Inc., Durham, North Carolina.
+# All Rights Reserved.
+#
+# OpenScap Probes Test Suite.
+
+. ../../test_common.sh
+
+set -e -o pipefail
+
+function test_large_file {
+
+    probecheck "textfilecontent54" || return 255
+
+    local DF="${srcdir}/test_large_file.xml"
+    local RF="large_file.results.xml"
+    local FILE="/tmp/test_probes_textfilecontent54_large.tmp_file"
+
+    [ -f $RF ] && rm -f $RF
+
+    # large enough to be mapped into memory rather than read
+    seq -f "line %g" 1 100000 > "$FILE"
+    echo "UPPER_CASE_LINE" >> "$FILE"
+    echo "last_line = 100000" >> "$FILE"
+
+    $OSCAP oval eval --results $RF $DF
+
+    result=$RF
+    assert_exists 1 '/oval_results/results/system/definitions/definition[@definition_id="oval:x:def:1"][@result="true"]'
+    assert_exists 1 '/oval_results/results/system/definitions/definition[@definition_id="oval:x:def:2"][@result="true"]'
+    assert_exists 1 '/oval_results/results/system/definitions/definition[@definition_id="oval:x:def:3"][@result="true"]'
+    assert_exists 1 '/oval_results/results/system/definitions/definition[@definition_id="oval:x:def:4"][@result="true"]'
+
+    rm -f $FILE $RF
+}
+
+test_large_file
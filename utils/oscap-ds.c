@@ -48,6 +48,9 @@ int app_ds_sds_validate(const struct oscap_action *action);
 int app_ds_rds_split(const struct oscap_action *action);
 int app_ds_rds_create(const struct oscap_action *action);
 int app_ds_rds_validate(const struct oscap_action *action);
+int app_ds_rds_apply_delta(const struct oscap_action *action);
+int app_ds_rds_merge(const struct oscap_action *action);
+int app_ds_rds_query(const struct oscap_action *action);
 
 struct oscap_module OSCAP_DS_MODULE = {
 	.name = "ds",
@@ -140,6 +143,48 @@ static struct oscap_module DS_RDS_VALIDATE_MODULE = {
 	.func = app_ds_rds_validate
 };
 
+static struct oscap_module DS_RDS_APPLY_DELTA_MODULE = {
+	.name = "rds-apply-delta",
+	.parent = &OSCAP_DS_MODULE,
+	.summary = "Rebuild a ResultDataStream (or OVAL results) from its baseline and its delta",
+	.usage = "baseline.xml delta.xml target.xml",
+	.help =	"baseline.xml - The results of the previous evaluation the delta was made against.\n"
+		"delta.xml - The delta written by --results-arf-delta or --results-delta.\n"
+		"target.xml - The rebuilt results.\n",
+	.opt_parser = getopt_ds,
+	.func = app_ds_rds_apply_delta
+};
+
+static struct oscap_module DS_RDS_MERGE_MODULE = {
+	.name = "rds-merge",
+	.parent = &OSCAP_DS_MODULE,
+	.summary = "Merge the ResultDataStreams of many assets into one",
+	.usage = "[options] target-arf.xml arf1.xml [arf2.xml ...]",
+	.help =	"The report requests which are the same in several of the ResultDataStreams\n"
+		"are stored once, the assets and reports are renumbered.\n"
+		"\n"
+		"Options:\n"
+		"   --skip-valid \r\t\t\t\t - Skips validating of given ResultDataStreams.\n",
+	.opt_parser = getopt_ds,
+	.func = app_ds_rds_merge
+};
+
+static struct oscap_module DS_RDS_QUERY_MODULE = {
+	.name = "rds-query",
+	.parent = &OSCAP_DS_MODULE,
+	.summary = "List the assets with the given result of a rule in the ResultDataStreams",
+	.usage = "--rule <id> [options] arf1.xml [arf2.xml ...]",
+	.help =	"Prints the id and the name of every matching asset of the ResultDataStreams\n"
+		"merged as by rds-merge.\n"
+		"\n"
+		"Options:\n"
+		"   --rule <id> \r\t\t\t\t - ID of the XCCDF Rule.\n"
+		"   --result <result> \r\t\t\t\t - The result of the rule, \"fail\" by default.\n"
+		"   --skip-valid \r\t\t\t\t - Skips validating of given ResultDataStreams.\n",
+	.opt_parser = getopt_ds,
+	.func = app_ds_rds_query
+};
+
 static struct oscap_module* DS_SUBMODULES[] = {
 	&DS_SDS_SPLIT_MODULE,
 	&DS_SDS_COMPOSE_MODULE,
@@ -148,6 +193,9 @@ static struct oscap_module* DS_SUBMODULES[] = {
 	&DS_RDS_SPLIT_MODULE,
 	&DS_RDS_CREATE_MODULE,
 	&DS_RDS_VALIDATE_MODULE,
+	&DS_RDS_APPLY_DELTA_MODULE,
+	&DS_RDS_MERGE_MODULE,
+	&DS_RDS_QUERY_MODULE,
 	NULL
 };
 
@@ -155,6 +203,8 @@ enum ds_opt {
 	DS_OPT_DATASTREAM_ID = 1,
 	DS_OPT_XCCDF_ID,
 	DS_OPT_REPORT_ID,
+	DS_OPT_RULE,
+	DS_OPT_RESULT,
 };
 
 bool getopt_ds(int argc, char **argv, struct oscap_action *action) {
@@ -167,11 +217,14 @@ bool getopt_ds(int argc, char **argv, struct oscap_action *action) {
 		{"datastream-id",		required_argument, NULL, DS_OPT_DATASTREAM_ID},
 		{"xccdf-id",		required_argument, NULL, DS_OPT_XCCDF_ID},
 		{"report-id",		required_argument, NULL, DS_OPT_REPORT_ID},
+		{"rule",		required_argument, NULL, DS_OPT_RULE},
+		{"result",		required_argument, NULL, DS_OPT_RESULT},
 		{"fetch-remote-resources", no_argument, &action->remote_resources, 1},
 	// end
 		{0, 0, 0, 0}
 	};
 
+	const char *rule_id = NULL, *rule_result = "fail";
 	int c;
 	while ((c = getopt_long(argc, argv, "o:i:", long_options, NULL)) != -1) {
 
@@ -179,6 +232,8 @@ bool getopt_ds(int argc, char **argv, struct oscap_action *action) {
 		case DS_OPT_DATASTREAM_ID:	action->f_datastream_id = optarg;	break;
 		case DS_OPT_XCCDF_ID:	action->f_xccdf_id = optarg; break;
 		case DS_OPT_REPORT_ID:	action->f_report_id = optarg; break;
+		case DS_OPT_RULE:	rule_id = optarg; break;
+		case DS_OPT_RESULT:	rule_result = optarg; break;
 		case 0: break;
 		default: return oscap_module_usage(action->module, stderr, NULL);
 		}
@@ -248,6 +303,37 @@ bool getopt_ds(int argc, char **argv, struct oscap_action *action) {
 		action->ds_action = malloc(sizeof(struct ds_action));
 		action->ds_action->file = argv[3];
 	}
+	else if (action->module == &DS_RDS_APPLY_DELTA_MODULE) {
+		if (optind + 3 != argc) {
+			oscap_module_usage(action->module, stderr, "Wrong number of parameters.\n");
+			return false;
+		}
+		action->ds_action = malloc(sizeof(struct ds_action));
+		action->ds_action->file = argv[optind];
+		action->ds_action->delta = argv[optind + 1];
+		action->ds_action->target = argv[optind + 2];
+	}
+	else if (action->module == &DS_RDS_MERGE_MODULE) {
+		if (argc - optind < 2) {
+			oscap_module_usage(action->module, stderr, "Wrong number of parameters.\n");
+			return false;
+		}
+		action->ds_action = malloc(sizeof(struct ds_action));
+		action->ds_action->target = argv[optind];
+		action->ds_action->files = &argv[optind + 1];
+		action->ds_action->file_count = argc - optind - 1;
+	}
+	else if (action->module == &DS_RDS_QUERY_MODULE) {
+		if (argc - optind < 1 || rule_id == NULL) {
+			oscap_module_usage(action->module, stderr, "The --rule option and at least one ResultDataStream are required.\n");
+			return false;
+		}
+		action->ds_action = malloc(sizeof(struct ds_action));
+		action->ds_action->files = &argv[optind];
+		action->ds_action->file_count = argc - optind;
+		action->ds_action->rule_id = (char *) rule_id;
+		action->ds_action->rule_result = (char *) rule_result;
+	}
 	return true;
 }
 
@@ -511,7 +597,7 @@ int app_ds_rds_validate(const struct oscap_action *action) {
 	int ret = OSCAP_ERROR;
 
 	struct oscap_source *rds = oscap_source_new_from_file(action->ds_action->file);
-	if (oscap_source_validate(rds, reporter, (void *) action) != 0) {
+	if (oscap_source_validate_stream(rds, reporter, (void *) action) != 0) {
 		oscap_source_free(rds);
 		goto cleanup;
 	}
@@ -525,3 +611,100 @@ cleanup:
 	free(action->ds_action);
 	return ret;
 }
+
+int app_ds_rds_apply_delta(const struct oscap_action *action) {
+	int ret = OSCAP_ERROR;
+
+	struct oscap_source *baseline = oscap_source_new_from_file(action->ds_action->file);
+	struct oscap_source *delta = oscap_source_new_from_file(action->ds_action->delta);
+	/* the result is checked against the hash in the delta */
+	struct oscap_source *result = oscap_source_new_from_delta(baseline, delta, action->ds_action->target);
+
+	if (result == NULL || oscap_source_save_as(result, NULL) != 0) {
+		fprintf(stdout, "Failed to apply the delta '%s' to '%s'.\n", action->ds_action->delta, action->ds_action->file);
+		goto cleanup;
+	}
+
+	ret = OSCAP_OK;
+
+cleanup:
+	oscap_print_error();
+
+	oscap_source_free(result);
+	oscap_source_free(delta);
+	oscap_source_free(baseline);
+	free(action->ds_action);
+
+	return ret;
+}
+
+static struct rds_store *_ds_rds_store_load(const struct oscap_action *action)
+{
+	struct rds_store *store = rds_store_new();
+
+	for (size_t i = 0; i < action->ds_action->file_count; ++i) {
+		struct oscap_source *source = oscap_source_new_from_file(action->ds_action->files[i]);
+
+		if ((action->validate && oscap_source_validate(source, reporter, (void *) action) != 0)
+				|| rds_store_add_source(store, source) != 0) {
+			fprintf(stdout, "Failed to merge result datastream '%s'.\n", action->ds_action->files[i]);
+			oscap_source_free(source);
+			rds_store_free(store);
+			return NULL;
+		}
+		oscap_source_free(source);
+	}
+	return store;
+}
+
+int app_ds_rds_merge(const struct oscap_action *action) {
+	int ret = OSCAP_ERROR;
+
+	struct rds_store *store = _ds_rds_store_load(action);
+	if (store == NULL)
+		goto cleanup;
+
+	if (rds_store_export(store, action->ds_action->target) != 0) {
+		fprintf(stdout, "Failed to save the merged result datastream '%s'.\n", action->ds_action->target);
+		goto cleanup;
+	}
+
+	ret = OSCAP_OK;
+
+cleanup:
+	oscap_print_error();
+
+	rds_store_free(store);
+	free(action->ds_action);
+	return ret;
+}
+
+int app_ds_rds_query(const struct oscap_action *action) {
+	int ret = OSCAP_ERROR;
+	struct oscap_stringlist *assets = NULL;
+
+	struct rds_store *store = _ds_rds_store_load(action);
+	if (store == NULL)
+		goto cleanup;
+
+	assets = rds_store_get_assets_by_rule_result(store, action->ds_action->rule_id, action->ds_action->rule_result);
+	if (assets == NULL)
+		goto cleanup;
+
+	struct oscap_string_iterator *it = oscap_stringlist_get_strings(assets);
+	while (oscap_string_iterator_has_more(it)) {
+		const char *asset_id = oscap_string_iterator_next(it);
+		printf("%s\t%s\n", asset_id, rds_store_get_asset_name(store, asset_id));
+	}
+	oscap_string_iterator_free(it);
+
+	ret = OSCAP_OK;
+
+cleanup:
+	oscap_print_error();
+
+	oscap_stringlist_free(assets);
+	rds_store_free(store);
+	free(action->ds_action);
+	return ret;
+}
@@ -141,6 +141,39 @@ static inline void _print_xccdf_benchmark(struct xccdf_benchmark *bench, const c
 	// xccdf_benchmark_free not needed, it si already freed by the policy!
 }
 
+/* the same as _print_xccdf_benchmark, from the index of the datastream */
+static inline void _print_ds_benchmark_index(struct ds_benchmark_index *bench_idx, const char *prefix)
+{
+	_print_xccdf_status(ds_benchmark_index_get_status_current(bench_idx), prefix);
+	printf("%sResolved: %s\n", prefix, ds_benchmark_index_get_resolved(bench_idx) ? "true" : "false");
+
+	printf("%sProfiles:\n", prefix);
+	struct ds_profile_index_iterator *prof_it = ds_benchmark_index_get_profiles(bench_idx);
+	while (ds_profile_index_iterator_has_more(prof_it)) {
+		struct ds_profile_index *prof = ds_profile_index_iterator_next(prof_it);
+		printf("%s\t%s%s\n", prefix,
+			ds_profile_index_get_abstract(prof) ? "(abstract) " : "",
+			ds_profile_index_get_id(prof));
+	}
+	ds_profile_index_iterator_free(prof_it);
+
+	printf("%sReferenced check files:\n", prefix);
+	struct ds_check_file_index_iterator *files_it = ds_benchmark_index_get_check_files(bench_idx);
+	while (ds_check_file_index_iterator_has_more(files_it)) {
+		struct ds_check_file_index *file = ds_check_file_index_iterator_next(files_it);
+		printf("%s\t%s\n", prefix, ds_check_file_index_get_href(file));
+		printf("%s\t\tsystem: %s\n", prefix, ds_check_file_index_get_system(file));
+	}
+	ds_check_file_index_iterator_free(files_it);
+
+	struct oscap_string_iterator *res_it = ds_benchmark_index_get_test_results(bench_idx);
+	if (oscap_string_iterator_has_more(res_it))
+		printf("%sTest Results:\n", prefix);
+	while (oscap_string_iterator_has_more(res_it))
+		printf("%s\t%s\n", prefix, oscap_string_iterator_next(res_it));
+	oscap_string_iterator_free(res_it);
+}
+
 static inline void _print_xccdf_tailoring(struct oscap_source *source, const char *prefix)
 {
 	struct xccdf_tailoring *tailoring = xccdf_tailoring_import_source(source, NULL);
@@ -266,8 +299,9 @@ static int app_info(const struct oscap_action *action)
 
 		ds_sds_session_set_remote_resources(session, action->remote_resources, download_reporting_callback);
 
-		/* get collection */
-		struct ds_sds_index *sds = ds_sds_session_get_sds_idx(session);
+		/* get collection, the session loads the datastream only for the checklists
+		 * the index doesn't describe */
+		struct ds_sds_index *sds = ds_sds_index_import_source(source);
 		if (!sds) {
 			ds_sds_session_free(session);
 			goto cleanup;
@@ -287,21 +321,30 @@ static int app_info(const struct oscap_action *action)
 				const char * id = oscap_string_iterator_next(checklist_it);
 				printf("\tRef-Id: %s\n", id);
 
+				const char *prefix = "\t\t";
+				const char *component_id = ds_stream_index_get_component_id(stream, id);
+				struct ds_benchmark_index *bench_idx = component_id ? ds_sds_index_get_benchmark(sds, component_id) : NULL;
+				if (bench_idx != NULL) {
+					_print_ds_benchmark_index(bench_idx, prefix);
+					continue;
+				}
+
 				/* decompose */
 				struct oscap_source *xccdf_source = ds_sds_session_select_checklist(session, ds_stream_index_get_id(stream), id, NULL);
 				if (xccdf_source == NULL) {
 					oscap_string_iterator_free(checklist_it);
 					ds_stream_index_iterator_free(sds_it);
+					ds_sds_index_free(sds);
 					ds_sds_session_free(session);
 					goto cleanup;
 				}
 
-				const char *prefix = "\t\t";
 				if (oscap_source_get_scap_type(xccdf_source) == OSCAP_DOCUMENT_XCCDF) {
 					struct xccdf_benchmark* bench = xccdf_benchmark_import_source(xccdf_source);
 					if(!bench) {
 						oscap_string_iterator_free(checklist_it);
 						ds_stream_index_iterator_free(sds_it);
+						ds_sds_index_free(sds);
 						ds_sds_session_free(session);
 						goto cleanup;
 					}
@@ -333,6 +376,7 @@ static int app_info(const struct oscap_action *action)
 			oscap_string_iterator_free(dict_it);
 		}
 		ds_stream_index_iterator_free(sds_it);
+		ds_sds_index_free(sds);
 		ds_sds_session_free(session);
 	}
 	break;
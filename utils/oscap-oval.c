@@ -34,7 +34,9 @@
 #include <oval_variables.h>
 #include <ds_sds_session.h>
 #include <assert.h>
+#include <errno.h>
 #include <limits.h>
+#include <unistd.h>
 
 #include "oscap-tool.h"
 #include "scap_ds.h"
@@ -44,6 +46,7 @@ static int app_collect_oval(const struct oscap_action *action);
 static int app_evaluate_oval(const struct oscap_action *action);
 static int app_oval_validate(const struct oscap_action *action);
 static int app_oval_xslt(const struct oscap_action *action);
+static int app_oval_gen_syschar(const struct oscap_action *action);
 static int app_oval_list_probes(const struct oscap_action *action);
 static int app_analyse_oval(const struct oscap_action *action);
 
@@ -53,6 +56,7 @@ static bool getopt_oval_analyse(int argc, char **argv, struct oscap_action *acti
 static bool getopt_oval_list_probes(int argc, char **argv, struct oscap_action *action);
 static bool getopt_oval_validate(int argc, char **argv, struct oscap_action *action);
 static bool getopt_oval_report(int argc, char **argv, struct oscap_action *action);
+static bool getopt_oval_gen_syschar(int argc, char **argv, struct oscap_action *action);
 
 
 static bool valid_inputs(const struct oscap_action *action);
@@ -112,12 +116,25 @@ static struct oscap_module OVAL_EVAL = {
         "   --without-syschar \r\t\t\t\t - Don't provide system characteristic in result file.\n"
         "   --results <file>\r\t\t\t\t - Write OVAL Results into file.\n"
         "   --report <file>\r\t\t\t\t - Create human readable (HTML) report from OVAL Results.\n"
+        "   --results-delta <file>\r\t\t\t\t - Write the changes of the OVAL Results since the baseline into file.\n"
+        "   --delta-baseline <file>\r\t\t\t\t - OVAL Results of a previous evaluation, the baseline of the delta.\n"
         "   --skip-valid\r\t\t\t\t - Skip validation.\n"
         "   --datastream-id <id> \r\t\t\t\t - ID of the datastream in the collection to use.\n"
         "                        \r\t\t\t\t   (only applicable for source datastreams)\n"
         "   --oval-id <id> \r\t\t\t\t - ID of the OVAL component ref in the datastream to use.\n"
         "                  \r\t\t\t\t   (only applicable for source datastreams)\n"
 	"   --probe-root <dir>\r\t\t\t\t - Change the root directory before scanning the system.\n"
+	"   --targets <file>\r\t\t\t\t - Evaluate the definitions on every \"name root-directory\" line of file, see --results-dir.\n"
+	"   --results-dir <dir>\r\t\t\t\t - Write the OVAL Results of every target into dir/name.xml.\n"
+	"   --target-jobs <n>\r\t\t\t\t - Evaluate up to n targets at the same time, the number of CPUs by default.\n"
+	"   --jobs <n>\r\t\t\t\t - Let the probes evaluate up to n objects at the same time.\n"
+	"   --no-hash-cache\r\t\t\t\t - Compute every file digest, don't use the OSCAP_HASH_CACHE file or the digests of the packages.\n"
+	"   --push-down-states\r\t\t\t\t - Let the probes collect only the items deciding the tests.\n"
+	"   --short-circuit\r\t\t\t\t - Skip the tests which can't change the result of a definition.\n"
+	"   --stats\r\t\t\t\t - Print the time and the items of the probes and objects.\n"
+	"   --probe-priority idle|<nice>\r\t\t\t\t - Run the probes at the idle CPU and I/O priority or at the nice value.\n"
+	"   --probe-read-rate <bytes>\r\t\t\t\t - Let every probe read at most so many bytes of files per second.\n"
+	"   --probe-stat-rate <files>\r\t\t\t\t - Let every probe visit at most so many files per second.\n"
 	"   --verbose <verbosity_level>\r\t\t\t\t - Turn on verbose mode at specified verbosity level.\n"
 	"   --verbose-log-file <file>\r\t\t\t\t - Write verbose information into file.\n",
     .opt_parser = getopt_oval_eval,
@@ -133,6 +150,7 @@ static struct oscap_module OVAL_COLLECT = {
 	"Options:\n"
 	"   --id <object>\r\t\t\t\t - Collect system characteristics ONLY for specified OVAL Object.\n"
         "   --syschar <file>\r\t\t\t\t - Write OVAL System Characteristic into file.\n"
+	"   --syschar-binary\r\t\t\t\t - Write the System Characteristics in the binary format, see generate syschar.\n"
 	"   --variables <file>\r\t\t\t\t - Provide external variables expected by OVAL Definitions.\n"
         "   --skip-valid\r\t\t\t\t - Skip validation.\n"
 	"   --verbose <verbosity_level>\r\t\t\t\t - Turn on verbose mode at specified verbosity level.\n"
@@ -145,12 +163,14 @@ static struct oscap_module OVAL_ANALYSE = {
     .name = "analyse",
     .parent = &OSCAP_OVAL_MODULE,
     .summary = "Evaluate provided system characteristics file",
-    .usage = "[options] --results FILE oval-definitions.xml system-characteristics.xml" ,
+    .usage = "[options] --results FILE oval-definitions.xml system-characteristics-file" ,
     .help =
 	"Options:\n"
 	"   --variables <file>\r\t\t\t\t - Provide external variables expected by OVAL Definitions.\n"
         "   --directives <file>\r\t\t\t\t - Use OVAL Directives content to specify desired results content.\n"
         "   --skip-valid\r\t\t\t\t - Skip validation.\n"
+	"   --lazy-syschar\r\t\t\t\t - Parse the system data items only when they are evaluated.\n"
+	"   --jobs <n>\r\t\t\t\t - Evaluate the tests by n threads.\n"
 	"   --verbose <verbosity_level>\r\t\t\t\t - Turn on verbose mode at specified verbosity level.\n"
 	"   --verbose-log-file <file>\r\t\t\t\t - Write verbose information into file.\n",
     .opt_parser = getopt_oval_analyse,
@@ -178,6 +198,20 @@ static struct oscap_module OVAL_REPORT = {
     .func = app_oval_xslt
 };
 
+static struct oscap_module OVAL_GEN_SYSCHAR = {
+    .name = "syschar",
+    .parent = &OVAL_GENERATE,
+    .summary = "Convert system characteristics between XML and the binary format",
+    .usage = "[options] --output FILE system-characteristics-file",
+    .help =
+        "Options:\n"
+        "   --output <file>\r\t\t\t\t - Write the System Characteristics into file.\n"
+        "   --binary\r\t\t\t\t - Write the binary format, the default for an XML input.\n"
+        "   --xml\r\t\t\t\t - Write XML, the default for a binary input.",
+    .opt_parser = getopt_oval_gen_syschar,
+    .func = app_oval_gen_syschar
+};
+
 static struct oscap_module OVAL_LIST_PROBES = {
     .name = "list-probes",
     .parent = &OSCAP_OVAL_MODULE,
@@ -193,6 +227,7 @@ static struct oscap_module OVAL_LIST_PROBES = {
 
 static struct oscap_module* OVAL_GEN_SUBMODULES[] = {
     &OVAL_REPORT,
+    &OVAL_GEN_SYSCHAR,
     NULL
 };
 static struct oscap_module* OVAL_SUBMODULES[] = {
@@ -312,10 +347,15 @@ int app_collect_oval(const struct oscap_action *action)
 	/* output */
 	if (action->f_syschar != NULL) {
 		/* export OVAL System Characteristics */
-		oval_syschar_model_export(sys_model, action->f_syschar);
+		if (action->syschar_binary) {
+			if (oval_syschar_model_export_binary(sys_model, action->f_syschar) != 0)
+				goto cleanup;
+		} else {
+			oval_syschar_model_export(sys_model, action->f_syschar);
+		}
 
 		/* validate OVAL System Characteristics */
-		if (action->validate && full_validation) {
+		if (action->validate && full_validation && !action->syschar_binary) {
 			struct oscap_source *syschar_source = oscap_source_new_from_file(action->f_syschar);
 			if (oscap_source_validate(syschar_source, reporter, (void *)action)) {
 				oscap_source_free(syschar_source);
@@ -340,6 +380,110 @@ cleanup:
 	return ret;
 }
 
+/* the "name root-directory" lines of the --targets file, parsed into lines */
+static size_t app_read_targets(FILE *fp, char ***lines, const char ***names, const char ***roots)
+{
+	char *line = NULL, *name, *root, *end;
+	size_t size = 0, count = 0, alloc = 0;
+
+	*lines = NULL;
+	*names = *roots = NULL;
+
+	while (getline(&line, &size, fp) != -1) {
+		name = line + strspn(line, " \t");
+		if (*name == '#' || *name == '\n' || *name == '\0')
+			continue;
+		root = name + strcspn(name, " \t\n");
+		if (*root == '\n' || *root == '\0') {
+			fprintf(stderr, "The target '%.*s' has no root directory.\n", (int)(root - name), name);
+			continue;
+		}
+		*root++ = '\0';
+		root += strspn(root, " \t");
+		for (end = root + strlen(root); end > root && (end[-1] == '\n' || end[-1] == ' ' || end[-1] == '\t'); --end)
+			;
+		*end = '\0';
+		if (*root == '\0' || strchr(name, '/') != NULL) {
+			fprintf(stderr, "Invalid target '%s'.\n", name);
+			continue;
+		}
+
+		if (count == alloc) {
+			alloc = alloc == 0 ? 16 : alloc * 2;
+			*lines = realloc(*lines, alloc * sizeof(char *));
+			*names = realloc(*names, alloc * sizeof(char *));
+			*roots = realloc(*roots, alloc * sizeof(char *));
+		}
+		(*lines)[count] = line;
+		(*names)[count] = name;
+		(*roots)[count] = root;
+		count++;
+
+		/* the names and roots point into the line */
+		line = NULL;
+		size = 0;
+	}
+
+	free(line);
+	return count;
+}
+
+static int app_evaluate_oval_targets(const struct oscap_action *action, struct oval_session *session)
+{
+	const char **names, **roots, **results;
+	char **lines;
+	int *statuses, ret = OSCAP_ERROR;
+	size_t count, i;
+	unsigned int jobs;
+	FILE *fp;
+
+	if ((fp = fopen(action->f_targets, "r")) == NULL) {
+		fprintf(stderr, "Can't open the targets file '%s': %s\n", action->f_targets, strerror(errno));
+		return OSCAP_ERROR;
+	}
+	count = app_read_targets(fp, &lines, &names, &roots);
+	fclose(fp);
+
+	if (count == 0) {
+		fprintf(stderr, "No targets in '%s'.\n", action->f_targets);
+		return OSCAP_ERROR;
+	}
+
+	results = calloc(count, sizeof(char *));
+	statuses = calloc(count, sizeof(int));
+	for (i = 0; i < count; ++i) {
+		char *path = malloc(strlen(action->f_results_dir) + strlen(names[i]) + 6);
+
+		sprintf(path, "%s/%s.xml", action->f_results_dir, names[i]);
+		results[i] = path;
+	}
+
+	jobs = action->target_jobs;
+	if (jobs == 0) {
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+		jobs = cpus > 0 ? (unsigned int)cpus : 1;
+	}
+
+	oval_session_set_export_system_characteristics(session, !action->without_sys_chars);
+	if (oval_session_evaluate_roots(session, roots, results, count, jobs, statuses) == 0)
+		ret = OSCAP_OK;
+
+	for (i = 0; i < count; ++i) {
+		printf("Target %s: %s\n", names[i], statuses[i] == 0 ? "evaluated" : "error");
+		free((char *)results[i]);
+		free(lines[i]);
+	}
+	printf("Evaluation done.\n");
+
+	free(results);
+	free(statuses);
+	free(lines);
+	free(names);
+	free(roots);
+	return ret;
+}
+
 int app_evaluate_oval(const struct oscap_action *action)
 {
 	struct oval_session *session = NULL;
@@ -371,10 +515,28 @@ int app_evaluate_oval(const struct oscap_action *action)
 	oval_session_set_variables(session, action->f_variables);
 
 	oval_session_set_remote_resources(session, action->remote_resources, download_reporting_callback);
+	oval_session_set_jobs(session, action->jobs);
+	oval_session_set_state_pushdown(session, action->state_pushdown);
+	oval_session_set_short_circuit(session, action->short_circuit);
+	/* the results have to be known before the evaluation, see oval_session_set_short_circuit */
+	oval_session_set_directives(session, action->f_directives);
+	oval_session_set_results_export(session, action->f_results);
+	oval_session_set_report_export(session, action->f_report);
+	oval_session_set_results_delta_export(session, action->f_delta_baseline, action->f_results_delta);
+	if (action->no_hash_cache) {
+		unsetenv("OSCAP_HASH_CACHE");
+		unsetenv("OSCAP_TRUST_PACKAGE_DIGESTS");
+	}
 	/* load all necesary OVAL Definitions and bind OVAL Variables if provided */
 	if ((oval_session_load(session)) != 0)
 		goto cleanup;
 
+	if (action->f_targets != NULL) {
+		if (app_evaluate_oval_targets(action, session) == OSCAP_OK)
+			ret = OSCAP_OK;
+		goto cleanup;
+	}
+
 	/* evaluation */
 	if (action->id) {
 		if ((oval_session_evaluate_id(session, action->probe_root, action->id, &eval_result)) != 0)
@@ -388,9 +550,9 @@ int app_evaluate_oval(const struct oscap_action *action)
 
 	printf("Evaluation done.\n");
 
-	oval_session_set_directives(session, action->f_directives);
-	oval_session_set_results_export(session, action->f_results);
-	oval_session_set_report_export(session, action->f_report);
+	if (action->probe_stats)
+		oval_session_print_probe_stats(session, stdout);
+
 	oval_session_set_export_system_characteristics(session, !action->without_sys_chars);
 	if (oval_session_export(session) != 0)
 		goto cleanup;
@@ -453,7 +615,10 @@ static int app_analyse_oval(const struct oscap_action *action) {
 	/* load system characteristics */
 	sys_model = oval_syschar_model_new(def_model);
 	source = oscap_source_new_from_file(action->f_syschar);
-	if (oval_syschar_model_import_source(sys_model, source) ==  -1 ) {
+	int import_ret = action->lazy_syschar ?
+		oval_syschar_model_import_source_lazy(sys_model, source) :
+		oval_syschar_model_import_source(sys_model, source);
+	if (import_ret == -1) {
                 fprintf(stderr, "Failed to import the System Characteristics from '%s'.\n", action->f_syschar);
 		oscap_source_free(source);
                 goto cleanup;
@@ -470,6 +635,7 @@ static int app_analyse_oval(const struct oscap_action *action) {
         oval_generator_set_product_name(generator, OSCAP_PRODUCTNAME);
 	oval_generator_set_product_version(generator, oscap_get_version());
 
+	oval_results_model_set_jobs(res_model, action->jobs);
 	oval_results_model_eval(res_model);
 
 	/* export results */
@@ -520,6 +686,41 @@ static int app_oval_xslt(const struct oscap_action *action)
     return app_xslt(action->f_oval, action->module->user, action->f_results, NULL);
 }
 
+static int app_oval_gen_syschar(const struct oscap_action *action)
+{
+	struct oval_definition_model *def_model;
+	struct oval_syschar_model *sys_model;
+	struct oscap_source *source;
+	bool binary = action->syschar_binary == -1 ?
+		!oval_syschar_model_is_binary(action->f_syschar) : action->syschar_binary;
+	int ret = OSCAP_ERROR;
+
+	/* the objects of the file are enough to write it back */
+	def_model = oval_definition_model_new();
+	sys_model = oval_syschar_model_new(def_model);
+
+	source = oscap_source_new_from_file(action->f_syschar);
+	if (oval_syschar_model_import_source(sys_model, source) != 0) {
+		fprintf(stderr, "Failed to import the System Characteristics from '%s'.\n", action->f_syschar);
+		goto cleanup;
+	}
+
+	if ((binary ? oval_syschar_model_export_binary(sys_model, action->f_results) :
+			oval_syschar_model_export(sys_model, action->f_results)) < 0) {
+		fprintf(stderr, "Failed to write the System Characteristics into '%s'.\n", action->f_results);
+		goto cleanup;
+	}
+
+	ret = OSCAP_OK;
+
+cleanup:
+	oscap_print_error();
+	oscap_source_free(source);
+	oval_syschar_model_free(sys_model);
+	oval_definition_model_free(def_model);
+	return ret;
+}
+
 static int app_oval_list_probes(const struct oscap_action *action)
 {
     int flags = 0;
@@ -545,7 +746,16 @@ enum oval_opt {
     OVAL_OPT_OUTPUT = 'o',
 	OVAL_OPT_PROBE_ROOT,
 	OVAL_OPT_VERBOSE,
-	OVAL_OPT_VERBOSE_LOG_FILE
+	OVAL_OPT_VERBOSE_LOG_FILE,
+	OVAL_OPT_JOBS,
+	OVAL_OPT_RESULT_FILE_DELTA,
+	OVAL_OPT_DELTA_BASELINE,
+	OVAL_OPT_PROBE_PRIORITY,
+	OVAL_OPT_PROBE_READ_RATE,
+	OVAL_OPT_PROBE_STAT_RATE,
+	OVAL_OPT_TARGETS,
+	OVAL_OPT_RESULTS_DIR,
+	OVAL_OPT_TARGET_JOBS
 };
 
 bool getopt_oval_eval(int argc, char **argv, struct oscap_action *action)
@@ -557,6 +767,8 @@ bool getopt_oval_eval(int argc, char **argv, struct oscap_action *action)
 	struct option long_options[] = {
 		{ "results", 	required_argument, NULL, OVAL_OPT_RESULT_FILE  },
 		{ "report",  	required_argument, NULL, OVAL_OPT_REPORT_FILE  },
+		{ "results-delta", required_argument, NULL, OVAL_OPT_RESULT_FILE_DELTA },
+		{ "delta-baseline", required_argument, NULL, OVAL_OPT_DELTA_BASELINE },
 		{ "id",        	required_argument, NULL, OVAL_OPT_ID           },
 		{ "variables",	required_argument, NULL, OVAL_OPT_VARIABLES    },
 		{ "directives",	required_argument, NULL, OVAL_OPT_DIRECTIVES   },
@@ -567,7 +779,18 @@ bool getopt_oval_eval(int argc, char **argv, struct oscap_action *action)
 		{ "probe-root", required_argument, NULL, OVAL_OPT_PROBE_ROOT},
 		{ "verbose", required_argument, NULL, OVAL_OPT_VERBOSE },
 		{ "verbose-log-file", required_argument, NULL, OVAL_OPT_VERBOSE_LOG_FILE },
+		{ "jobs", required_argument, NULL, OVAL_OPT_JOBS },
 		{ "fetch-remote-resources", no_argument, &action->remote_resources, 1},
+		{ "no-hash-cache", no_argument, &action->no_hash_cache, 1},
+		{ "push-down-states", no_argument, &action->state_pushdown, 1},
+		{ "short-circuit", no_argument, &action->short_circuit, 1},
+		{ "stats", no_argument, &action->probe_stats, 1},
+		{ "probe-priority", required_argument, NULL, OVAL_OPT_PROBE_PRIORITY },
+		{ "probe-read-rate", required_argument, NULL, OVAL_OPT_PROBE_READ_RATE },
+		{ "probe-stat-rate", required_argument, NULL, OVAL_OPT_PROBE_STAT_RATE },
+		{ "targets", required_argument, NULL, OVAL_OPT_TARGETS },
+		{ "results-dir", required_argument, NULL, OVAL_OPT_RESULTS_DIR },
+		{ "target-jobs", required_argument, NULL, OVAL_OPT_TARGET_JOBS },
 		{ 0, 0, 0, 0 }
 	};
 
@@ -576,6 +799,8 @@ bool getopt_oval_eval(int argc, char **argv, struct oscap_action *action)
 		switch (c) {
 		case OVAL_OPT_RESULT_FILE: action->f_results = optarg; break;
 		case OVAL_OPT_REPORT_FILE: action->f_report  = optarg; break;
+		case OVAL_OPT_RESULT_FILE_DELTA: action->f_results_delta = optarg; break;
+		case OVAL_OPT_DELTA_BASELINE: action->f_delta_baseline = optarg; break;
 		case OVAL_OPT_ID: action->id = optarg; break;
 		case OVAL_OPT_VARIABLES: action->f_variables = optarg; break;
 		case OVAL_OPT_DIRECTIVES: action->f_directives = optarg; break;
@@ -588,6 +813,34 @@ bool getopt_oval_eval(int argc, char **argv, struct oscap_action *action)
 		case OVAL_OPT_VERBOSE_LOG_FILE:
 			action->f_verbose_log = optarg;
 			break;
+		case OVAL_OPT_JOBS:
+			if (!parse_jobs_option(action, optarg))
+				return false;
+			break;
+		case OVAL_OPT_PROBE_PRIORITY:
+			if (!parse_probe_priority_option(action, optarg))
+				return false;
+			break;
+		case OVAL_OPT_PROBE_READ_RATE:
+			if (!parse_probe_rate_option(action, "OSCAP_PROBE_READ_RATE", optarg))
+				return false;
+			break;
+		case OVAL_OPT_PROBE_STAT_RATE:
+			if (!parse_probe_rate_option(action, "OSCAP_PROBE_STAT_RATE", optarg))
+				return false;
+			break;
+		case OVAL_OPT_TARGETS: action->f_targets = optarg; break;
+		case OVAL_OPT_RESULTS_DIR: action->f_results_dir = optarg; break;
+		case OVAL_OPT_TARGET_JOBS: {
+			/* parse_jobs_option() checks the number and reports the errors */
+			unsigned int jobs = action->jobs;
+
+			if (!parse_jobs_option(action, optarg))
+				return false;
+			action->target_jobs = action->jobs;
+			action->jobs = jobs;
+			break;
+		}
 		case 0: break;
 		default: return oscap_module_usage(action->module, stderr, NULL);
 		}
@@ -596,6 +849,17 @@ bool getopt_oval_eval(int argc, char **argv, struct oscap_action *action)
 		return false;
 	}
 
+	if ((action->f_results_delta == NULL) != (action->f_delta_baseline == NULL))
+		return oscap_module_usage(action->module, stderr, "The --results-delta and --delta-baseline options go together!");
+
+	if ((action->f_targets == NULL) != (action->f_results_dir == NULL))
+		return oscap_module_usage(action->module, stderr, "The --targets and --results-dir options go together!");
+
+	if (action->f_targets != NULL && (action->id != NULL || action->probe_root != NULL || action->f_results != NULL
+			|| action->f_report != NULL || action->f_results_delta != NULL))
+		return oscap_module_usage(action->module, stderr,
+			"The --targets option can't be combined with --id, --probe-root, --results, --report and --results-delta!");
+
 	/* We should have Definitions file here */
 	if (optind >= argc)
 		return oscap_module_usage(action->module, stderr, "Definitions file is not specified!");
@@ -613,6 +877,7 @@ bool getopt_oval_collect(int argc, char **argv, struct oscap_action *action)
 		{ "id",        	required_argument, NULL, OVAL_OPT_ID           },
 		{ "variables",	required_argument, NULL, OVAL_OPT_VARIABLES    },
 		{ "syschar",	required_argument, NULL, OVAL_OPT_SYSCHAR      },
+		{ "syschar-binary", no_argument, &action->syschar_binary, 1 },
 		{ "skip-valid",	no_argument, &action->validate, 0 },
 		{ "verbose", required_argument, NULL, OVAL_OPT_VERBOSE },
 		{ "verbose-log-file", required_argument, NULL, OVAL_OPT_VERBOSE_LOG_FILE },
@@ -657,6 +922,8 @@ bool getopt_oval_analyse(int argc, char **argv, struct oscap_action *action)
 		{ "variables",	required_argument, NULL, OVAL_OPT_VARIABLES    },
 		{ "directives",	required_argument, NULL, OVAL_OPT_DIRECTIVES   },
 		{ "skip-valid",	no_argument, &action->validate, 0 },
+		{ "lazy-syschar", no_argument, &action->lazy_syschar, 1 },
+		{ "jobs", required_argument, NULL, OVAL_OPT_JOBS },
 		{ "verbose", required_argument, NULL, OVAL_OPT_VERBOSE },
 		{ "verbose-log-file", required_argument, NULL, OVAL_OPT_VERBOSE_LOG_FILE },
 		{ 0, 0, 0, 0 }
@@ -668,6 +935,10 @@ bool getopt_oval_analyse(int argc, char **argv, struct oscap_action *action)
 		case OVAL_OPT_RESULT_FILE: action->f_results = optarg; break;
 		case OVAL_OPT_VARIABLES: action->f_variables = optarg; break;
 		case OVAL_OPT_DIRECTIVES: action->f_directives = optarg; break;
+		case OVAL_OPT_JOBS:
+			if (!parse_jobs_option(action, optarg))
+				return false;
+			break;
 		case OVAL_OPT_VERBOSE:
 			action->verbosity_level = optarg;
 			break;
@@ -732,6 +1003,38 @@ bool getopt_oval_report(int argc, char **argv, struct oscap_action *action)
 	return true;
 }
 
+bool getopt_oval_gen_syschar(int argc, char **argv, struct oscap_action *action)
+{
+	action->doctype = OSCAP_DOCUMENT_OVAL_SYSCHAR;
+	/* the format is the other one than the input's, unless an option says */
+	action->syschar_binary = -1;
+
+	struct option long_options[] = {
+		{ "output",	required_argument, NULL, OVAL_OPT_OUTPUT },
+		{ "binary",	no_argument, &action->syschar_binary, 1 },
+		{ "xml",	no_argument, &action->syschar_binary, 0 },
+		{ 0, 0, 0, 0 }
+	};
+
+	int c;
+	while ((c = getopt_long(argc, argv, "o:", long_options, NULL)) != -1) {
+		switch (c) {
+		case OVAL_OPT_OUTPUT: action->f_results = optarg; break;
+		case 0: break;
+		default: return oscap_module_usage(action->module, stderr, NULL);
+		}
+	}
+
+	if (optind >= argc)
+		return oscap_module_usage(action->module, stderr, "System characteristics file is not specified!");
+	action->f_syschar = argv[optind];
+
+	if (action->f_results == NULL)
+		return oscap_module_usage(action->module, stderr, "Output file is not specified (--output parameter)!");
+
+	return true;
+}
+
 bool getopt_oval_list_probes(int argc, char **argv, struct oscap_action *action)
 {
 #define PROBE_LIST_STATIC  0
@@ -842,7 +1145,8 @@ static bool valid_inputs(const struct oscap_action *action) {
 		oscap_source_free(directives_source);
 	}
 
-	if (action->module == &OVAL_ANALYSE && action->f_syschar) {
+	/* the binary system characteristics have no schema */
+	if (action->module == &OVAL_ANALYSE && action->f_syschar && !oval_syschar_model_is_binary(action->f_syschar)) {
 		struct oscap_source *syschar_source = oscap_source_new_from_file(action->f_syschar);
 		if (oscap_source_get_scap_type(syschar_source) != OSCAP_DOCUMENT_OVAL_SYSCHAR) {
 			fprintf(stderr, "Type mismatch: %s. Expecting OVAL System Characteristic, but found %s.\n",
@@ -26,6 +26,7 @@
 
 #include "oscap-tool.h"
 #include <assert.h>
+#include <ctype.h>
 #include <getopt.h>
 #include <string.h>
 #include <sys/types.h>
@@ -57,6 +58,7 @@ static void oscap_action_release(struct oscap_action *action)
 {
 	assert(action != NULL);
 	free(action->f_ovals);
+	free(action->profiles);
 	cvss_impact_free(action->cvss_impact);
 }
 
@@ -392,6 +394,63 @@ bool check_verbose_options(struct oscap_action *action)
 	return true;
 }
 
+bool parse_jobs_option(struct oscap_action *action, const char *arg)
+{
+	char *end;
+	unsigned long jobs;
+
+	errno = 0;
+	jobs = strtoul(arg, &end, 10);
+	if (errno != 0 || end == arg || *end != '\0' || jobs == 0 || jobs > UINT_MAX) {
+		oscap_module_usage(action->module, stderr,
+			"Invalid number of jobs '%s'! The number of jobs must be a positive integer.", arg);
+		return false;
+	}
+	action->jobs = (unsigned int)jobs;
+	return true;
+}
+
+bool parse_probe_priority_option(struct oscap_action *action, const char *arg)
+{
+	char *end;
+	long nice;
+
+	/* the lowest CPU and I/O priority */
+	if (strcmp(arg, "idle") == 0) {
+		setenv("OSCAP_PROBE_NICE", "19", 1);
+		setenv("OSCAP_PROBE_IONICE", "idle", 1);
+		return true;
+	}
+
+	/* the kernel derives the best-effort I/O priority from the nice value */
+	errno = 0;
+	nice = strtol(arg, &end, 10);
+	if (errno != 0 || end == arg || *end != '\0' || nice < -20 || nice > 19) {
+		oscap_module_usage(action->module, stderr,
+			"Invalid probe priority '%s'! The priority must be 'idle' or a nice value from -20 to 19.", arg);
+		return false;
+	}
+	setenv("OSCAP_PROBE_NICE", arg, 1);
+	return true;
+}
+
+bool parse_probe_rate_option(struct oscap_action *action, const char *env, const char *arg)
+{
+	char *end;
+
+	errno = 0;
+	(void)strtoull(arg, &end, 10);
+	if (*end != '\0' && strchr("kKmMgG", *end) != NULL)
+		++end;
+	if (errno != 0 || end == arg || *end != '\0' || !isdigit((unsigned char)*arg)) {
+		oscap_module_usage(action->module, stderr,
+			"Invalid rate '%s'! The rate must be a positive integer, optionally followed by k, M or G.", arg);
+		return false;
+	}
+	setenv(env, arg, 1);
+	return true;
+}
+
 void download_reporting_callback(bool warning, const char *format, ...)
 {
 	FILE *dest = stderr;
@@ -86,6 +86,11 @@ struct ds_action {
 	char* xccdf_result;
 	char** oval_results;
 	size_t oval_result_count;
+	char* delta;
+	char** files;
+	size_t file_count;
+	char* rule_id;
+	char* rule_result;
 };
 
 struct cpe_action {
@@ -113,11 +118,14 @@ struct oscap_action {
 	char *f_directives;
         char *f_results;
 	char *f_results_arf;
+	char *f_results_delta;
+	char *f_delta_baseline;
         char *f_report;
 	char *f_variables;
 	char *f_verbose_log;
 	/* others */
         char *profile;
+        char **profiles;
         char *show;
         char *format;
         const char *tmpl;
@@ -152,6 +160,22 @@ struct oscap_action {
         int list_dynamic;
 	char *probe_root;
 	char *verbosity_level;
+	unsigned int jobs;
+	int no_hash_cache;
+	int recheck_platform;
+	int state_pushdown;
+	int short_circuit;
+	int probe_stats;
+	int lazy_oval;
+	int lazy_texts;
+	int report_native;
+	int lazy_syschar;
+	int syschar_binary;
+	char *f_targets;
+	char *f_results_dir;
+	unsigned int target_jobs;
+	char *f_profile_run;
+	char *f_socket;
 };
 
 int app_xslt(const char *infile, const char *xsltfile, const char *outfile, const char **params);
@@ -163,6 +187,9 @@ int oscap_module_call(struct oscap_action *action);
 
 void oscap_print_error(void);
 bool check_verbose_options(struct oscap_action *action);
+bool parse_jobs_option(struct oscap_action *action, const char *arg);
+bool parse_probe_priority_option(struct oscap_action *action, const char *arg);
+bool parse_probe_rate_option(struct oscap_action *action, const char *env, const char *arg);
 void download_reporting_callback(bool warning, const char *format, ...);
 
 extern struct oscap_module OSCAP_ROOT_MODULE;
@@ -43,6 +43,9 @@
 #include <limits.h>
 #include <unistd.h>
 #include <syslog.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 #include "oscap-tool.h"
 #include "oscap.h"
@@ -54,6 +57,7 @@ static int app_xccdf_validate(const struct oscap_action *action);
 static int app_xccdf_resolve(const struct oscap_action *action);
 static int app_xccdf_export_oval_variables(const struct oscap_action *action);
 static int app_xccdf_remediate(const struct oscap_action *action);
+static int app_xccdf_serve(const struct oscap_action *action);
 static bool getopt_xccdf(int argc, char **argv, struct oscap_action *action);
 static bool getopt_generate(int argc, char **argv, struct oscap_action *action);
 static int app_xccdf_xslt(const struct oscap_action *action);
@@ -138,6 +142,7 @@ static struct oscap_module XCCDF_EVAL = {
 		"INPUT_FILE - XCCDF file or a source data stream file\n\n"
         "Options:\n"
         "   --profile <name>\r\t\t\t\t - The name of Profile to be evaluated.\n"
+        "                   \r\t\t\t\t   May be repeated to evaluate more profiles in one scan.\n"
         "   --tailoring-file <file>\r\t\t\t\t - Use given XCCDF Tailoring file.\n"
         "   --tailoring-id <component-id>\r\t\t\t\t - Use given DS component as XCCDF Tailoring file.\n"
         "   --cpe <name>\r\t\t\t\t - Use given CPE dictionary or language (autodetected)\n"
@@ -148,7 +153,10 @@ static struct oscap_module XCCDF_EVAL = {
         "   --export-variables\r\t\t\t\t - Export OVAL external variables provided by XCCDF.\n"
         "   --results <file>\r\t\t\t\t - Write XCCDF Results into file.\n"
         "   --results-arf <file>\r\t\t\t\t - Write ARF (result data stream) into file.\n"
+        "   --results-arf-delta <file>\r\t\t\t\t - Write the changes of the ARF since the baseline into file.\n"
+        "   --delta-baseline <file>\r\t\t\t\t - ARF file of a previous evaluation, the baseline of the delta.\n"
         "   --report <file>\r\t\t\t\t - Write HTML report into file.\n"
+        "   --report-native\r\t\t\t\t - Write the HTML report by the built-in writer instead of the XSLT.\n"
         "   --skip-valid \r\t\t\t\t - Skip validation.\n"
 	"   --fetch-remote-resources \r\t\t\t\t - Download remote content referenced by XCCDF.\n"
 	"   --progress \r\t\t\t\t - Switch to sparse output suitable for progress reporting.\n"
@@ -162,12 +170,55 @@ static struct oscap_module XCCDF_EVAL = {
 	"                   \r\t\t\t\t   (only applicable when datastream-id AND xccdf-id are not specified)\n"
 	"   --remediate \r\t\t\t\t - Automatically execute XCCDF fix elements for failed rules.\n"
 	"               \r\t\t\t\t   Use of this option is always at your own risk.\n"
+	"   --jobs <n>\r\t\t\t\t - Let the probes evaluate up to n OVAL objects and run up to n SCE checks at the same time.\n"
+	"   --no-hash-cache\r\t\t\t\t - Compute every file digest, don't use the OSCAP_HASH_CACHE file or the digests of the packages.\n"
+	"   --recheck-platform\r\t\t\t\t - Evaluate the CPE checks again, don't use the OSCAP_CPE_CACHE results.\n"
+	"   --lazy-oval\r\t\t\t\t - Parse only the OVAL definitions needed by the evaluated rules.\n"
+	"   --lazy-texts\r\t\t\t\t - Read the XHTML texts of the benchmark only for the results and the report.\n"
+	"   --profile-run <file>\r\t\t\t\t - Write a timeline of the evaluation in the Chrome trace event format into file.\n"
+	"   --probe-priority idle|<nice>\r\t\t\t\t - Run the probes at the idle CPU and I/O priority or at the nice value.\n"
+	"   --probe-read-rate <bytes>\r\t\t\t\t - Let every probe read at most so many bytes of files per second.\n"
+	"   --probe-stat-rate <files>\r\t\t\t\t - Let every probe visit at most so many files per second.\n"
 	"   --verbose <verbosity_level>\r\t\t\t\t - Turn on verbose mode at specified verbosity level.\n"
 	"   --verbose-log-file <file>\r\t\t\t\t - Write verbose informations into file.\n",
     .opt_parser = getopt_xccdf,
     .func = app_evaluate_xccdf
 };
 
+static struct oscap_module XCCDF_SERVE = {
+    .name = "serve",
+    .parent = &OSCAP_XCCDF_MODULE,
+    .summary = "Evaluate the content loaded once on requests from a UNIX socket",
+    .usage = "[options] --socket <file> INPUT_FILE",
+    .help =
+		"INPUT_FILE - XCCDF file or a source data stream file\n\n"
+		"The content is loaded and the probes are started once, every request\n"
+		"is an evaluation of the same content which scans the system again.\n"
+		"A request is a sequence of \"<option> <value>\" lines ended by an empty\n"
+		"line, where the options are profile, tailoring-file, results,\n"
+		"results-arf, report and oval-results (with value 1). The reply is\n"
+		"the line \"result <exit code of oscap xccdf eval>\" followed by the\n"
+		"lines \"error <message>\" of the errors. The files are written by the\n"
+		"server, relative to its working directory.\n\n"
+		"Options:\n"
+		"   --socket <file>\r\t\t\t\t - Listen on this UNIX socket, it is accessible only by the user.\n"
+		"   --profile <name>\r\t\t\t\t - The profile of the requests which don't select one.\n"
+		"   --tailoring-file <file>\r\t\t\t\t - Use given XCCDF Tailoring file.\n"
+		"   --tailoring-id <component-id>\r\t\t\t\t - Use given DS component as XCCDF Tailoring file.\n"
+		"   --cpe <name>\r\t\t\t\t - Use given CPE dictionary or language (autodetected)\n"
+		"               \r\t\t\t\t   for applicability checks.\n"
+		"   --skip-valid \r\t\t\t\t - Skip validation.\n"
+		"   --fetch-remote-resources \r\t\t\t\t - Download remote content referenced by XCCDF.\n"
+		"   --datastream-id <id> \r\t\t\t\t - ID of the datastream in the collection to use.\n"
+		"   --xccdf-id <id> \r\t\t\t\t - ID of component-ref with XCCDF in the datastream that should be evaluated.\n"
+		"   --benchmark-id <id> \r\t\t\t\t - ID of XCCDF Benchmark in some component in the datastream that should be evaluated.\n"
+		"   --jobs <n>\r\t\t\t\t - Let the probes evaluate up to n OVAL objects and run up to n SCE checks at the same time.\n"
+		"   --verbose <verbosity_level>\r\t\t\t\t - Turn on verbose mode at specified verbosity level.\n"
+		"   --verbose-log-file <file>\r\t\t\t\t - Write verbose informations into file.\n",
+    .opt_parser = getopt_xccdf,
+    .func = app_xccdf_serve
+};
+
 static struct oscap_module XCCDF_REMEDIATE = {
 	.name =		"remediate",
 	.parent =	&OSCAP_XCCDF_MODULE,
@@ -249,6 +300,7 @@ static struct oscap_module XCCDF_GEN_FIX = {
     .help = GEN_OPTS
         "\nFix Options:\n"
         "   --output <file>\r\t\t\t\t - Write the script into file.\n"
+        "   --profile <profile-id>\r\t\t\t\t - May be repeated to write the scripts of more profiles one after another.\n"
         "   --result-id <id>\r\t\t\t\t - Fixes will be generated for failed rule-results of the specified TestResult.\n"
         "   --template <id|filename>\r\t\t\t\t - Fix template. (default: bash)\n",
     .opt_parser = getopt_xccdf,
@@ -286,6 +338,7 @@ static struct oscap_module* XCCDF_SUBMODULES[] = {
     &XCCDF_EXPORT_OVAL_VARIABLES,
     &XCCDF_GENERATE,
 	&XCCDF_REMEDIATE,
+	&XCCDF_SERVE,
     NULL
 };
 
@@ -429,11 +482,40 @@ static void _register_progress_callback(struct xccdf_session *session, bool prog
 	/* xccdf_policy_model_register_output_callback(policy_model, callback_syslog_result, NULL); */
 }
 
-static void report_missing_profile(const struct oscap_action *action)
+static void report_missing_profile(struct xccdf_session *session, const struct oscap_action *action)
 {
+	const char *profile = action->profile;
+
+	// the first of the repeated --profile options which doesn't exist
+	for (int i = 0; action->profiles != NULL && action->profiles[i] != NULL; i++) {
+		if (xccdf_policy_model_get_policy_by_id(xccdf_session_get_policy_model(session), action->profiles[i]) == NULL) {
+			profile = action->profiles[i];
+			break;
+		}
+	}
 	fprintf(stderr,
 		"Profile \"%s\" was not found. Get available profiles using:\n"
-		"$ oscap info \"%s\"\n", action->profile, action->f_xccdf);
+		"$ oscap info \"%s\"\n", profile, action->f_xccdf);
+}
+
+/*
+ * Create the timeline file and let the library and the probes append their
+ * events to it. The probes run in another working directory, hence the
+ * absolute path.
+ */
+static bool start_profile_run(const char *path)
+{
+	char abs_path[PATH_MAX];
+	FILE *fp;
+
+	fp = fopen(path, "w");
+	if (fp == NULL || fputs("[\n", fp) == EOF || fclose(fp) != 0 || realpath(path, abs_path) == NULL) {
+		fprintf(stderr, "Can't create the profile file '%s': %s\n", path, strerror(errno));
+		return false;
+	}
+
+	setenv("OSCAP_PROFILE_RUN", abs_path, 1);
+	return true;
 }
 
 /**
@@ -451,6 +533,9 @@ int app_evaluate_xccdf(const struct oscap_action *action)
 		goto cleanup;
 	}
 
+	if (action->f_profile_run != NULL && !start_profile_run(action->f_profile_run))
+		goto cleanup;
+
 	/* syslog message */
 	syslog(priority, "Evaluation started. Content: %s, Profile: %s.", action->f_xccdf, action->profile);
 
@@ -473,14 +558,25 @@ int app_evaluate_xccdf(const struct oscap_action *action)
 	xccdf_session_set_remote_resources(session, action->remote_resources, download_reporting_callback);
 	xccdf_session_set_custom_oval_files(session, action->f_ovals);
 	xccdf_session_set_product_cpe(session, OSCAP_PRODUCTNAME);
+	xccdf_session_set_oval_jobs(session, action->jobs);
+	xccdf_session_set_oval_release_items(session, !action->oval_results && action->f_results_arf == NULL);
+	xccdf_session_set_oval_lazy_loading(session, action->lazy_oval);
+	xccdf_session_set_xccdf_lazy_texts(session, action->lazy_texts);
+	if (action->no_hash_cache) {
+		unsetenv("OSCAP_HASH_CACHE");
+		unsetenv("OSCAP_TRUST_PACKAGE_DIGESTS");
+	}
+	/* the results of the CPE OVAL checks are exported only if they are evaluated */
+	if (action->recheck_platform || action->oval_results || action->f_results_arf != NULL)
+		setenv("OSCAP_CPE_CACHE_RECHECK", "1", 1);
 
 	if (xccdf_session_load(session) != 0)
 		goto cleanup;
 
-	/* Select profile */
-	if (!xccdf_session_set_profile_id(session, action->profile)) {
+	/* Select profiles, the objects are collected once for all of them */
+	if (!xccdf_session_set_profile_ids(session, (const char **) action->profiles)) {
 		if (action->profile != NULL)
-			report_missing_profile(action);
+			report_missing_profile(session, action);
 		else
 			fprintf(stderr, "No Policy was found for default profile.\n");
 		goto cleanup;
@@ -495,6 +591,7 @@ int app_evaluate_xccdf(const struct oscap_action *action)
 	xccdf_session_set_oval_results_export(session, action->oval_results);
 	xccdf_session_set_oval_variables_export(session, action->export_variables);
 	xccdf_session_set_arf_export(session, action->f_results_arf);
+	xccdf_session_set_arf_delta_export(session, action->f_delta_baseline, action->f_results_delta);
 
 	if (xccdf_session_export_oval(session) != 0)
 		goto cleanup;
@@ -514,6 +611,7 @@ int app_evaluate_xccdf(const struct oscap_action *action)
 
 	xccdf_session_set_xccdf_export(session, action->f_results);
 	xccdf_session_set_report_export(session, action->f_report);
+	xccdf_session_set_report_native(session, action->report_native);
 	if (xccdf_session_export_xccdf(session) != 0)
 		goto cleanup;
 	else if (action->validate && getenv("OSCAP_FULL_VALIDATION") != NULL &&
@@ -541,6 +639,271 @@ cleanup:
 	return result;
 }
 
+/*
+ * oscap xccdf serve
+ */
+
+#define SERVE_REQUEST_MAX 65536
+
+struct serve_request {
+	const char *profile;
+	const char *tailoring_file;
+	const char *results;
+	const char *results_arf;
+	const char *report;
+	bool oval_results;
+};
+
+static volatile sig_atomic_t serve_stop = 0;
+
+static void serve_signal_handler(int sig)
+{
+	serve_stop = 1;
+}
+
+/* read the lines of the request up to the empty line, `buf' holds the values */
+static bool serve_read_request(int fd, char *buf, size_t size, struct serve_request *req)
+{
+	size_t len = 0;
+
+	while (len < size - 1 && (len < 2 || strstr(buf, "\n\n") == NULL)) {
+		ssize_t r = read(fd, buf + len, size - 1 - len);
+		if (r < 0 && errno == EINTR && !serve_stop)
+			continue;
+		if (r <= 0)
+			break;
+		len += r;
+		buf[len] = '\0';
+	}
+	buf[len] = '\0';
+
+	memset(req, 0, sizeof(*req));
+	for (char *line = buf, *next; *line != '\0' && *line != '\n'; line = next) {
+		next = line + strcspn(line, "\n");
+		if (*next == '\n')
+			*next++ = '\0';
+
+		char *value = strchr(line, ' ');
+		if (value == NULL)
+			return false;
+		*value++ = '\0';
+
+		if (!strcmp(line, "profile"))
+			req->profile = value;
+		else if (!strcmp(line, "tailoring-file"))
+			req->tailoring_file = value;
+		else if (!strcmp(line, "results"))
+			req->results = value;
+		else if (!strcmp(line, "results-arf"))
+			req->results_arf = value;
+		else if (!strcmp(line, "report"))
+			req->report = value;
+		else if (!strcmp(line, "oval-results"))
+			req->oval_results = !strcmp(value, "1");
+		else
+			return false;
+	}
+	return true;
+}
+
+/* `msg' is an error of the server, the errors of the library follow it */
+static void serve_reply(int fd, int result, const char *msg)
+{
+	char *err = oscap_err() ? oscap_err_get_full_error() : NULL;
+	FILE *fp = fdopen(dup(fd), "w");
+
+	if (fp == NULL) {
+		free(err);
+		return;
+	}
+
+	fprintf(fp, "result %d\n", result);
+	if (msg != NULL)
+		fprintf(fp, "error %s\n", msg);
+	// one line per message
+	for (char *line = err, *next; line != NULL && *line != '\0'; line = next) {
+		next = line + strcspn(line, "\n");
+		if (*next == '\n')
+			*next++ = '\0';
+		fprintf(fp, "error %s\n", line);
+	}
+	fclose(fp);
+	free(err);
+}
+
+static int serve_evaluate(const struct oscap_action *action, struct xccdf_session *session,
+			  const struct serve_request *req, bool *tailored, const char **msg)
+{
+	int result = OSCAP_ERROR;
+	const char *profile = req->profile != NULL ? req->profile : action->profile;
+
+	/* a tailoring of the request replaces the tailoring of the server until the next request */
+	if (req->tailoring_file != NULL || *tailored) {
+		xccdf_session_set_user_tailoring_file(session, req->tailoring_file != NULL ? req->tailoring_file : action->tailoring_file);
+		if (req->tailoring_file == NULL && action->tailoring_file == NULL && action->tailoring_id == NULL)
+			xccdf_policy_model_set_tailoring(xccdf_session_get_policy_model(session), NULL);
+		else if (xccdf_session_load_tailoring(session) != 0)
+			goto cleanup;
+		*tailored = req->tailoring_file != NULL;
+	}
+
+	if (!xccdf_session_set_profile_id(session, profile)) {
+		*msg = profile != NULL ? "Profile was not found." : "No Policy was found for default profile.";
+		goto cleanup;
+	}
+
+	syslog(LOG_NOTICE, "Evaluation started. Content: %s, Profile: %s.", action->f_xccdf, profile);
+
+	if (xccdf_session_evaluate(session) != 0)
+		goto cleanup;
+
+	xccdf_session_set_oval_results_export(session, req->oval_results);
+	xccdf_session_set_arf_export(session, req->results_arf);
+	if (xccdf_session_export_oval(session) != 0)
+		goto cleanup;
+
+	xccdf_session_set_xccdf_export(session, req->results);
+	xccdf_session_set_report_export(session, req->report);
+	if (xccdf_session_export_xccdf(session) != 0)
+		goto cleanup;
+	if (xccdf_session_export_arf(session) != 0)
+		goto cleanup;
+
+	result = xccdf_session_contains_fail_result(session) ? OSCAP_FAIL : OSCAP_OK;
+
+	syslog(LOG_NOTICE, "Evaluation finished. Return code: %d, Base score %f.", result,
+		xccdf_session_get_base_score(session));
+cleanup:
+	return result;
+}
+
+static int serve_listen(const char *path)
+{
+	struct sockaddr_un addr;
+	struct stat st;
+	int fd;
+
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "The socket path '%s' is too long.\n", path);
+		return -1;
+	}
+
+	/* a socket left by a previous server */
+	if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode))
+		unlink(path);
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		fprintf(stderr, "Can't create the socket: %s\n", strerror(errno));
+		return -1;
+	}
+
+	/* the requests choose the files the server writes, keep them to the user */
+	mode_t mask = umask(077);
+	int ret = bind(fd, (struct sockaddr *) &addr, sizeof(addr));
+	umask(mask);
+
+	if (ret != 0 || listen(fd, 16) != 0) {
+		fprintf(stderr, "Can't listen on '%s': %s\n", path, strerror(errno));
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+int app_xccdf_serve(const struct oscap_action *action)
+{
+	struct xccdf_session *session = NULL;
+	char *buf = NULL;
+	int listen_fd = -1;
+	int result = OSCAP_ERROR;
+	bool tailored = false;
+
+	if (!oscap_set_verbose(action->verbosity_level, action->f_verbose_log, false))
+		goto cleanup;
+
+	session = xccdf_session_new(action->f_xccdf);
+	if (session == NULL)
+		goto cleanup;
+	xccdf_session_set_validation(session, action->validate, getenv("OSCAP_FULL_VALIDATION") != NULL);
+
+	if (xccdf_session_is_sds(session)) {
+		xccdf_session_set_datastream_id(session, action->f_datastream_id);
+		xccdf_session_set_component_id(session, action->f_xccdf_id);
+		xccdf_session_set_benchmark_id(session, action->f_benchmark_id);
+	}
+	xccdf_session_set_user_cpe(session, action->cpe);
+	if (action->tailoring_file != NULL)
+		xccdf_session_set_user_tailoring_file(session, action->tailoring_file);
+	xccdf_session_set_user_tailoring_cid(session, action->tailoring_id);
+	xccdf_session_set_remote_resources(session, action->remote_resources, download_reporting_callback);
+	xccdf_session_set_product_cpe(session, OSCAP_PRODUCTNAME);
+	xccdf_session_set_oval_jobs(session, action->jobs);
+
+	/* parse the content and start the probes once for all the requests */
+	if (xccdf_session_load(session) != 0)
+		goto cleanup;
+
+	if ((listen_fd = serve_listen(action->f_socket)) < 0)
+		goto cleanup;
+
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = serve_signal_handler;
+	sigemptyset(&sa.sa_mask);
+	/* no SA_RESTART, the signals have to interrupt accept() */
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	buf = malloc(SERVE_REQUEST_MAX);
+	syslog(LOG_NOTICE, "Serving %s on %s.", action->f_xccdf, action->f_socket);
+
+	while (!serve_stop) {
+		struct serve_request req;
+		int fd = accept(listen_fd, NULL, NULL);
+
+		if (fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			fprintf(stderr, "Can't accept a request: %s\n", strerror(errno));
+			goto cleanup;
+		}
+		fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+		if (!serve_read_request(fd, buf, SERVE_REQUEST_MAX, &req)) {
+			serve_reply(fd, OSCAP_ERROR, "Invalid request.");
+		} else {
+			const char *msg = NULL;
+			int ret = serve_evaluate(action, session, &req, &tailored, &msg);
+			serve_reply(fd, ret, msg);
+		}
+		close(fd);
+
+		/* the next request scans the system again */
+		if (xccdf_session_reset(session) != 0) {
+			oscap_print_error();
+			goto cleanup;
+		}
+		oscap_clearerr();
+	}
+	result = OSCAP_OK;
+
+cleanup:
+	oscap_print_error();
+	free(buf);
+	if (listen_fd >= 0) {
+		close(listen_fd);
+		unlink(action->f_socket);
+	}
+	xccdf_session_free(session);
+	return result;
+}
+
 static xccdf_test_result_type_t resolve_variables_wrapper(struct xccdf_policy *policy, const char *rule_id,
 	const char *id, const char *href, struct xccdf_value_binding_iterator *bnd_itr,
 	struct xccdf_check_import_iterator *check_import_it, void *usr)
@@ -581,7 +944,7 @@ static int app_xccdf_export_oval_variables(const struct oscap_action *action)
 	policy = xccdf_policy_model_get_policy_by_id(xccdf_session_get_policy_model(session), action->profile);
 	if (policy == NULL) {
 		if (action->profile != NULL)
-			report_missing_profile(action);
+			report_missing_profile(session, action);
 		else
 			fprintf(stderr, "No Policy was found for default profile.\n");
 		goto cleanup;
@@ -631,6 +994,7 @@ int app_xccdf_remediate(const struct oscap_action *action)
 	xccdf_session_set_arf_export(session, action->f_results_arf);
 	xccdf_session_set_xccdf_export(session, action->f_results);
 	xccdf_session_set_report_export(session, action->f_report);
+	xccdf_session_set_report_native(session, action->report_native);
 
 	if (xccdf_session_export_oval(session) != 0)
 		goto cleanup;
@@ -802,12 +1166,12 @@ int app_generate_fix(const struct oscap_action *action)
 	if (xccdf_session_load_tailoring(session) != 0)
 		goto cleanup;
 
-	if (!xccdf_session_set_profile_id(session, action->profile)) {
-		report_missing_profile(action);
+	bool more_profiles = action->profiles != NULL && action->profiles[0] != NULL && action->profiles[1] != NULL;
+	if (!more_profiles && !xccdf_session_set_profile_id(session, action->profile)) {
+		report_missing_profile(session, action);
 		goto cleanup;
 	}
 
-	struct xccdf_policy *policy = xccdf_session_get_xccdf_policy(session);
 	int output_fd = STDOUT_FILENO;
 	if (action->f_results != NULL) {
 		if ((output_fd = open(action->f_results, O_CREAT|O_TRUNC|O_NOFOLLOW|O_WRONLY, 0700)) < 0) {
@@ -815,8 +1179,16 @@ int app_generate_fix(const struct oscap_action *action)
 			goto cleanup;
 		}
 	}
-	if (xccdf_policy_generate_fix(policy, NULL, action->tmpl, output_fd) == 0)
-		ret = OSCAP_OK;
+	if (more_profiles) {
+		// one run for all the profiles, the benchmark is resolved only once
+		struct xccdf_policy_model *model = xccdf_session_get_policy_model(session);
+		if (xccdf_policy_model_generate_fix(model, (const char **) action->profiles, action->tmpl, output_fd) == 0)
+			ret = OSCAP_OK;
+	} else {
+		struct xccdf_policy *policy = xccdf_session_get_xccdf_policy(session);
+		if (xccdf_policy_generate_fix(policy, NULL, action->tmpl, output_fd) == 0)
+			ret = OSCAP_OK;
+	}
 
 	if (output_fd != STDOUT_FILENO)
 		close(output_fd);
@@ -904,10 +1276,18 @@ enum oval_opt {
 	XCCDF_OPT_TAILORING_ID,
     XCCDF_OPT_CPE,
     XCCDF_OPT_CPE_DICT,
+    XCCDF_OPT_RESULT_FILE_DELTA,
+    XCCDF_OPT_DELTA_BASELINE,
+    XCCDF_OPT_PROBE_PRIORITY,
+    XCCDF_OPT_PROBE_READ_RATE,
+    XCCDF_OPT_PROBE_STAT_RATE,
     XCCDF_OPT_OUTPUT = 'o',
     XCCDF_OPT_RESULT_ID = 'i',
 	XCCDF_OPT_VERBOSE,
-	XCCDF_OPT_VERBOSE_LOG_FILE
+	XCCDF_OPT_VERBOSE_LOG_FILE,
+	XCCDF_OPT_JOBS,
+	XCCDF_OPT_PROFILE_RUN,
+	XCCDF_OPT_SOCKET
 };
 
 bool getopt_xccdf(int argc, char **argv, struct oscap_action *action)
@@ -922,6 +1302,8 @@ bool getopt_xccdf(int argc, char **argv, struct oscap_action *action)
 		{"output",		required_argument, NULL, XCCDF_OPT_OUTPUT},
 		{"results", 		required_argument, NULL, XCCDF_OPT_RESULT_FILE},
 		{"results-arf",		required_argument, NULL, XCCDF_OPT_RESULT_FILE_ARF},
+		{"results-arf-delta",	required_argument, NULL, XCCDF_OPT_RESULT_FILE_DELTA},
+		{"delta-baseline",	required_argument, NULL, XCCDF_OPT_DELTA_BASELINE},
 		{"datastream-id",		required_argument, NULL, XCCDF_OPT_DATASTREAM_ID},
 		{"xccdf-id",		required_argument, NULL, XCCDF_OPT_XCCDF_ID},
 		{"benchmark-id",		required_argument, NULL, XCCDF_OPT_BENCHMARK_ID},
@@ -939,6 +1321,12 @@ bool getopt_xccdf(int argc, char **argv, struct oscap_action *action)
 		{"sce-template", 	required_argument, NULL, XCCDF_OPT_SCE_TEMPLATE},
 		{ "verbose", required_argument, NULL, XCCDF_OPT_VERBOSE },
 		{ "verbose-log-file", required_argument, NULL, XCCDF_OPT_VERBOSE_LOG_FILE },
+		{ "jobs", required_argument, NULL, XCCDF_OPT_JOBS },
+		{ "profile-run", required_argument, NULL, XCCDF_OPT_PROFILE_RUN },
+		{ "probe-priority", required_argument, NULL, XCCDF_OPT_PROBE_PRIORITY },
+		{ "probe-read-rate", required_argument, NULL, XCCDF_OPT_PROBE_READ_RATE },
+		{ "probe-stat-rate", required_argument, NULL, XCCDF_OPT_PROBE_STAT_RATE },
+		{ "socket", required_argument, NULL, XCCDF_OPT_SOCKET },
 	// flags
 		{"force",		no_argument, &action->force, 1},
 		{"oval-results",	no_argument, &action->oval_results, 1},
@@ -948,6 +1336,11 @@ bool getopt_xccdf(int argc, char **argv, struct oscap_action *action)
 		{"fetch-remote-resources", no_argument, &action->remote_resources, 1},
 		{"progress", no_argument, &action->progress, 1},
 		{"remediate", no_argument, &action->remediate, 1},
+		{"no-hash-cache", no_argument, &action->no_hash_cache, 1},
+		{"recheck-platform", no_argument, &action->recheck_platform, 1},
+		{"lazy-oval", no_argument, &action->lazy_oval, 1},
+		{"lazy-texts", no_argument, &action->lazy_texts, 1},
+		{"report-native", no_argument, &action->report_native, 1},
 		{"hide-profile-info",	no_argument, &action->hide_profile_info, 1},
 		{"export-variables",	no_argument, &action->export_variables, 1},
 		{"schematron",          no_argument, &action->schematron, 1},
@@ -962,10 +1355,21 @@ bool getopt_xccdf(int argc, char **argv, struct oscap_action *action)
 		case XCCDF_OPT_OUTPUT:
 		case XCCDF_OPT_RESULT_FILE:	action->f_results = optarg;	break;
 		case XCCDF_OPT_RESULT_FILE_ARF:	action->f_results_arf = optarg;	break;
+		case XCCDF_OPT_RESULT_FILE_DELTA:	action->f_results_delta = optarg;	break;
+		case XCCDF_OPT_DELTA_BASELINE:	action->f_delta_baseline = optarg;	break;
 		case XCCDF_OPT_DATASTREAM_ID:	action->f_datastream_id = optarg;	break;
 		case XCCDF_OPT_XCCDF_ID:	action->f_xccdf_id = optarg; break;
 		case XCCDF_OPT_BENCHMARK_ID:	action->f_benchmark_id = optarg; break;
-		case XCCDF_OPT_PROFILE:		action->profile = optarg;	break;
+		case XCCDF_OPT_PROFILE: {
+			// every occurrence is kept for the modules which accept more profiles
+			size_t count = 0;
+			while (action->profiles != NULL && action->profiles[count] != NULL)
+				++count;
+			action->profiles = realloc(action->profiles, (count + 2) * sizeof(char *));
+			action->profiles[count] = optarg;
+			action->profiles[count + 1] = NULL;
+			action->profile = optarg;
+		} break;
 		case XCCDF_OPT_RESULT_ID:	action->id = optarg;		break;
 		case XCCDF_OPT_REPORT_FILE:	action->f_report = optarg; 	break;
 		case XCCDF_OPT_SHOW:		action->show = optarg;		break;
@@ -989,6 +1393,28 @@ bool getopt_xccdf(int argc, char **argv, struct oscap_action *action)
 		case XCCDF_OPT_VERBOSE_LOG_FILE:
 			action->f_verbose_log = optarg;
 			break;
+		case XCCDF_OPT_JOBS:
+			if (!parse_jobs_option(action, optarg))
+				return false;
+			break;
+		case XCCDF_OPT_PROFILE_RUN:
+			action->f_profile_run = optarg;
+			break;
+		case XCCDF_OPT_PROBE_PRIORITY:
+			if (!parse_probe_priority_option(action, optarg))
+				return false;
+			break;
+		case XCCDF_OPT_PROBE_READ_RATE:
+			if (!parse_probe_rate_option(action, "OSCAP_PROBE_READ_RATE", optarg))
+				return false;
+			break;
+		case XCCDF_OPT_PROBE_STAT_RATE:
+			if (!parse_probe_rate_option(action, "OSCAP_PROBE_STAT_RATE", optarg))
+				return false;
+			break;
+		case XCCDF_OPT_SOCKET:
+			action->f_socket = optarg;
+			break;
 		case 0: break;
 		default: return oscap_module_usage(action->module, stderr, NULL);
 		}
@@ -1003,6 +1429,10 @@ bool getopt_xccdf(int argc, char **argv, struct oscap_action *action)
 			/* TODO */
 			return oscap_module_usage(action->module, stderr, "XCCDF file need to be specified!");
 		}
+		if ((action->f_results_delta == NULL) != (action->f_delta_baseline == NULL))
+			return oscap_module_usage(action->module, stderr, "The --results-arf-delta and --delta-baseline options go together!");
+		if (action->f_results_delta != NULL && action->f_results_arf == NULL)
+			return oscap_module_usage(action->module, stderr, "The delta needs the ARF, use --results-arf!");
 
                 action->f_xccdf = argv[optind];
                 if (argc > (optind+1)) {
@@ -1016,6 +1446,12 @@ bool getopt_xccdf(int argc, char **argv, struct oscap_action *action)
                 } else {
                     action->f_ovals = NULL;
                 }
+	} else if (action->module == &XCCDF_SERVE) {
+		if (action->f_socket == NULL)
+			return oscap_module_usage(action->module, stderr, "The socket needs to be specified!");
+		if (optind >= argc)
+			return oscap_module_usage(action->module, stderr, "XCCDF file needs to be specified!");
+		action->f_xccdf = argv[optind];
 	} else if (action->module == &XCCDF_GEN_CUSTOM) {
 		if (!action->stylesheet) {
 			return oscap_module_usage(action->module, stderr, "XSLT Stylesheet needs to be specified!");
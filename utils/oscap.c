@@ -62,6 +62,7 @@ struct oscap_module OSCAP_ROOT_MODULE = {
 		"oscap options:\n"
 		"   -h --help\r\t\t\t\t - show this help\n"
 		"   -q --quiet\r\t\t\t\t - quiet mode\n"
+		"   --memory-report\r\t\t\t\t - print the memory used by every subsystem to stderr\n"
 		"   -V --version\r\t\t\t\t - print info about supported SCAP versions",
     .opt_parser = getopt_root,
     .submodules = OSCAP_ROOT_SUBMODULES
@@ -74,10 +75,31 @@ struct oscap_module OSCAP_VERSION_MODULE = {
     .func = print_versions
 };
 
+/* the accounting has to be enabled before libxml2 is initialized */
+static bool memory_report_requested(int argc, char **argv)
+{
+	const char *env = getenv("OSCAP_MEMORY_REPORT");
+
+	if (env != NULL && *env != '\0' && strcmp(env, "0") != 0)
+		return true;
+
+	for (int i = 1; i < argc && argv[i][0] == '-'; ++i) {
+		if (strcmp(argv[i], "--memory-report") == 0)
+			return true;
+	}
+	return false;
+}
+
 int main(int argc, char **argv)
 {
+    bool memory_report = memory_report_requested(argc, argv);
+
+    if (memory_report)
+        oscap_memory_accounting_enable();
     oscap_init();
     int ret = oscap_module_process(&OSCAP_ROOT_MODULE, argc, argv);
+    if (memory_report)
+        oscap_memory_report(stderr);
     oscap_cleanup();
     return ret;
 }
@@ -88,6 +110,7 @@ bool getopt_root(int argc, char **argv, struct oscap_action *action)
 		static struct option long_options[] = {
 			{"quiet", 0, 0, 'q'},
 			{"version", 0, 0, 'V'},
+			{"memory-report", 0, 0, 'M'},
 			{0, 0, 0, 0}
 		};
 
@@ -99,6 +122,7 @@ bool getopt_root(int argc, char **argv, struct oscap_action *action)
 			printf("Warning: '-q' is obsoleted option, please use '#oscap ... >/dev/null 2>&1' instead\n");
 		break;
 		case 'V': action->module = &OSCAP_VERSION_MODULE; break;
+		case 'M': break; /* handled by main() */
         case '?': return oscap_module_usage(action->module, stderr, NULL);
 		}
 	}
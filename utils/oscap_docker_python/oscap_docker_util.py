@@ -22,6 +22,9 @@ import tempfile
 import subprocess
 import platform
 import shutil
+import hashlib
+import json
+import tarfile
 from oscap_docker_python.get_cve_input import getInputCVE
 import sys
 
@@ -74,6 +77,8 @@ class OscapHelpers(object):
 
     def __init__(self, cve_input_dir):
         self.cve_input_dir = cve_input_dir
+        # False when the chroot comes from the layer cache
+        self.mounted = True
 
     @staticmethod
     def _mk_tmp_dir(tmp_dir):
@@ -142,6 +147,41 @@ class OscapHelpers(object):
             (os.path.join(self.cve_input_dir, cve_input),)
         return self.oscap_chroot("foo", "bar", chroot, *tmp_tuple)
 
+    def _scan_cve_targets(self, targets, dist, scan_args, results_dir):
+        '''
+        Scan several chroots of the same dist for cves, the definitions
+        are loaded once and the chroots are evaluated in parallel
+        '''
+        targets_file = os.path.join(results_dir, "targets")
+        with open(targets_file, "w") as f:
+            for name, chroot in targets:
+                f.write("{0} {1}\n".format(name, chroot))
+
+        cve_input = getInputCVE.dist_cve_name.format(dist)
+        cmd = ['oscap', 'oval', 'eval', '--targets', targets_file,
+               '--results-dir', results_dir] + list(scan_args) + \
+            [os.path.join(self.cve_input_dir, cve_input)]
+        # the chroots are cleaned up by the caller, a failed target
+        # is reported by the missing results file
+        oscap_process = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+        oscap_stdout, oscap_stderr = oscap_process.communicate()
+        if oscap_process.returncode not in [0, 2]:
+            sys.stderr.write("\nCommand: {0} failed!\n".format(" ".join(cmd)))
+            sys.stderr.write(oscap_stderr.decode("utf-8") + "\n")
+        return oscap_stdout.decode("utf-8")
+
+    @staticmethod
+    def _true_definitions(results_file):
+        '''
+        IDs of the definitions with the result true in an OVAL Results file
+        '''
+        import xml.etree.ElementTree as ET
+
+        ns = "{http://oval.mitre.org/XMLSchema/oval-results-5}"
+        tree = ET.parse(results_file)
+        return [d.get("definition_id") for d in
+                tree.iter(ns + "definition") if d.get("result") == "true"]
+
     def _scan(self, chroot, scan_args):
         '''
         Scan a container or image
@@ -162,6 +202,9 @@ class OscapHelpers(object):
         Cleans up the mounted chroot by umounting it and
         removing the temporary directory
         '''
+        if not self.mounted:
+            return
+
         # Sometimes when this def is called, path will have 'rootfs'
         # appended.  If it does, strip it and proceed
 
@@ -177,13 +220,195 @@ class OscapHelpers(object):
         os.rmdir(_no_rootfs)
 
 
+class LayerCache(object):
+    '''
+    Extracted layers of docker images. Every layer is extracted once into
+    a directory named by its digest and the root filesystem of an image is
+    assembled from hard links to the files of its layers, so no container
+    and no mount is needed. The files of a base layer are the same inodes
+    in all the images built on it, so the digests computed by the probes
+    are kept in a hash cache next to the layers and reused by the scans
+    of the other images.
+    '''
+    WHITEOUT = ".wh."
+    OPAQUE = ".wh..wh..opq"
+
+    def __init__(self, cache_dir):
+        self.cache_dir = cache_dir
+        self.layers_dir = os.path.join(cache_dir, "layers")
+        self.rootfs_dir = os.path.join(cache_dir, "rootfs")
+        self.hash_cache = os.path.join(cache_dir, "hash-cache")
+        self.package_index = os.path.join(cache_dir, "package-index")
+
+        for path in (self.layers_dir, self.rootfs_dir, self.package_index):
+            if not os.path.isdir(path):
+                os.makedirs(path, 0o700)
+
+    @staticmethod
+    def _digest_dir(digest):
+        '''
+        Directory name of a layer digest like "sha256:<hex>"
+        '''
+        return digest.replace(":", "-")
+
+    @staticmethod
+    def _remove(path):
+        if os.path.isdir(path) and not os.path.islink(path):
+            shutil.rmtree(path)
+        elif os.path.lexists(path):
+            os.unlink(path)
+
+    @staticmethod
+    def _safe_members(tar):
+        '''
+        Members of a layer which stay inside the extraction directory
+        '''
+        for member in tar:
+            names = [member.name]
+            if member.islnk():
+                names.append(member.linkname)
+            unsafe = False
+            for name in names:
+                name = os.path.normpath(name)
+                if os.path.isabs(name) or name == ".." or \
+                        name.startswith("../"):
+                    unsafe = True
+            if not unsafe:
+                yield member
+
+    def _extract_layer(self, tar, layer, digest, tmp_dir):
+        dest = os.path.join(self.layers_dir, self._digest_dir(digest))
+        if os.path.isdir(dest):
+            return
+
+        extract_dir = tempfile.mkdtemp(dir=tmp_dir)
+        layer_tar = tarfile.open(fileobj=tar.extractfile(layer))
+        try:
+            layer_tar.extractall(extract_dir,
+                                 members=self._safe_members(layer_tar))
+        finally:
+            layer_tar.close()
+        os.rename(extract_dir, dest)
+
+    def _apply_layer(self, layer_dir, rootfs):
+        '''
+        Link the files of a layer into rootfs, which has the layers below
+        it applied already, and remove the files whited out by the layer
+        '''
+        for dirpath, dirnames, filenames in os.walk(layer_dir):
+            target_dir = os.path.normpath(
+                os.path.join(rootfs, os.path.relpath(dirpath, layer_dir)))
+
+            if self.OPAQUE in filenames:
+                for name in os.listdir(target_dir):
+                    self._remove(os.path.join(target_dir, name))
+
+            for name in dirnames + filenames:
+                src = os.path.join(dirpath, name)
+                dst = os.path.join(target_dir, name)
+
+                if name == self.OPAQUE:
+                    continue
+                if name.startswith(self.WHITEOUT):
+                    self._remove(os.path.join(target_dir,
+                                              name[len(self.WHITEOUT):]))
+                    continue
+
+                st = os.lstat(src)
+                if os.path.isdir(src) and not os.path.islink(src):
+                    if os.path.islink(dst) or \
+                            (os.path.lexists(dst) and not os.path.isdir(dst)):
+                        self._remove(dst)
+                    if not os.path.lexists(dst):
+                        os.mkdir(dst)
+                    shutil.copystat(src, dst)
+                    os.chown(dst, st.st_uid, st.st_gid)
+                elif os.path.islink(src):
+                    self._remove(dst)
+                    os.symlink(os.readlink(src), dst)
+                    os.lchown(dst, st.st_uid, st.st_gid)
+                else:
+                    self._remove(dst)
+                    os.link(src, dst)
+
+    def _assemble(self, diff_ids):
+        chain = hashlib.sha256(" ".join(diff_ids).encode("utf-8")).hexdigest()
+        rootfs = os.path.join(self.rootfs_dir, chain)
+        if os.path.isdir(rootfs):
+            return rootfs
+
+        tmp_rootfs = tempfile.mkdtemp(dir=self.rootfs_dir)
+        os.chmod(tmp_rootfs, 0o755)
+        try:
+            for digest in diff_ids:
+                self._apply_layer(
+                    os.path.join(self.layers_dir, self._digest_dir(digest)),
+                    tmp_rootfs)
+            os.rename(tmp_rootfs, rootfs)
+        except OSError:
+            # a concurrent scan of the same image may have been faster
+            shutil.rmtree(tmp_rootfs)
+            if not os.path.isdir(rootfs):
+                raise
+        return rootfs
+
+    def get_rootfs(self, image):
+        '''
+        Returns the root filesystem of the image, extracting the layers
+        which aren't in the cache yet
+        '''
+        import docker
+
+        tmp_dir = tempfile.mkdtemp(dir=self.cache_dir)
+        try:
+            archive = os.path.join(tmp_dir, "image.tar")
+            with open(archive, "wb") as f:
+                shutil.copyfileobj(docker.Client().get_image(image), f)
+
+            tar = tarfile.open(archive)
+            try:
+                manifest = json.loads(
+                    tar.extractfile("manifest.json").read().decode("utf-8"))[0]
+                config = json.loads(
+                    tar.extractfile(manifest["Config"]).read().decode("utf-8"))
+                diff_ids = config["rootfs"]["diff_ids"]
+
+                for digest, layer in zip(diff_ids, manifest["Layers"]):
+                    self._extract_layer(tar, layer, digest, tmp_dir)
+            finally:
+                tar.close()
+        finally:
+            shutil.rmtree(tmp_dir)
+
+        return self._assemble(diff_ids)
+
+
 class OscapScan(object):
     def __init__(self, tmp_dir=tempfile.gettempdir(), mnt_dir=None,
-                 hours_old=2):
+                 hours_old=2, layer_cache=None):
         self.tmp_dir = tmp_dir
         self.helper = OscapHelpers(tmp_dir)
         self.mnt_dir = mnt_dir
         self.hours_old = hours_old
+        self.layer_cache = layer_cache
+
+    def _cached_rootfs(self, image):
+        '''
+        Root filesystem of the image from the layer cache, None on error
+        '''
+        try:
+            chroot = self.layer_cache.get_rootfs(image)
+        except Exception as e:
+            sys.stderr.write("Can't unpack the layers of {0}: {1}\n"
+                             .format(image, e))
+            return None
+
+        self.helper.mounted = False
+        if "OSCAP_HASH_CACHE" not in os.environ:
+            os.environ["OSCAP_HASH_CACHE"] = self.layer_cache.hash_cache
+        if "OSCAP_PACKAGE_INDEX" not in os.environ:
+            os.environ["OSCAP_PACKAGE_INDEX"] = self.layer_cache.package_index
+        return chroot
 
     def _ensure_mnt_dir(self):
         '''
@@ -206,6 +431,11 @@ class OscapScan(object):
         '''
         Wrapper function for scanning a container or image
         '''
+        if self.layer_cache is not None:
+            chroot = self._cached_rootfs(image)
+            if chroot is None:
+                return None
+            return self._scan_cve_chroot(image, chroot, scan_args)
 
         mnt_dir = self._ensure_mnt_dir()
 
@@ -222,30 +452,97 @@ class OscapScan(object):
 
 
         try:
-            # Figure out which RHEL dist is in the chroot
-            dist = self.helper._get_dist(chroot)
-
-            if dist is None:
-                sys.stderr.write("{0} is not based on RHEL\n".format(image))
-                return None
-
-            # Fetch the CVE input data for the dist
-            fetch = getInputCVE(self.tmp_dir)
-            fetch._fetch_single(dist)
-
-            # Scan the chroot
-            sys.stdout.write(self.helper._scan_cve(chroot, dist, scan_args))
+            return self._scan_cve_chroot(image, chroot, scan_args)
 
         finally:
             # Clean up
             self.helper._cleanup_by_path(_tmp_mnt_dir)
             self._remove_mnt_dir(mnt_dir)
 
+    def _scan_cve_chroot(self, image, chroot, scan_args):
+        # Figure out which RHEL dist is in the chroot
+        dist = self.helper._get_dist(chroot)
+
+        if dist is None:
+            sys.stderr.write("{0} is not based on RHEL\n".format(image))
+            return None
+
+        # Fetch the CVE input data for the dist
+        fetch = getInputCVE(self.tmp_dir)
+        fetch._fetch_single(dist)
+
+        # Scan the chroot
+        sys.stdout.write(self.helper._scan_cve(chroot, dist, scan_args))
+
+    def scan_cve_images(self, images, scan_args):
+        '''
+        Scan several containers or images for known vulnerabilities. The
+        images of a dist are scanned by one oscap process, which parses
+        the CVE definitions of the dist only once.
+        '''
+        mounts = []
+        dists = {}
+        mnt_dir = None
+        results_dir = tempfile.mkdtemp()
+
+        try:
+            for i, image in enumerate(images):
+                if self.layer_cache is not None:
+                    chroot = self._cached_rootfs(image)
+                    if chroot is None:
+                        continue
+                else:
+                    if mnt_dir is None:
+                        mnt_dir = self._ensure_mnt_dir()
+                    DM = DockerMount(mnt_dir, mnt_mkdir=True)
+                    try:
+                        _tmp_mnt_dir = DM.mount(image)
+                    except MountError as e:
+                        sys.stderr.write(str(e) + "\n")
+                        continue
+                    mounts.append(_tmp_mnt_dir)
+                    chroot = os.path.join(_tmp_mnt_dir, 'rootfs')
+
+                dist = self.helper._get_dist(chroot)
+                if dist is None:
+                    sys.stderr.write("{0} is not based on RHEL\n".format(image))
+                    continue
+                # the name of the results file of the image
+                dists.setdefault(dist, []).append(("image{0}".format(i), chroot))
+
+            fetch = getInputCVE(self.tmp_dir)
+            for dist, targets in dists.items():
+                fetch._fetch_single(dist)
+                self.helper._scan_cve_targets(targets, dist, scan_args,
+                                              results_dir)
+
+                for name, chroot in targets:
+                    image = images[int(name[len("image"):])]
+                    results_file = os.path.join(results_dir, name + ".xml")
+                    if not os.path.exists(results_file):
+                        sys.stderr.write("{0} was not scanned\n".format(image))
+                        continue
+                    sys.stdout.write("{0}:\n".format(image))
+                    for definition in self.helper._true_definitions(results_file):
+                        sys.stdout.write("Definition {0}: true\n".format(definition))
+
+        finally:
+            shutil.rmtree(results_dir)
+            for _tmp_mnt_dir in mounts:
+                self.helper._cleanup_by_path(_tmp_mnt_dir)
+            if mnt_dir is not None:
+                self._remove_mnt_dir(mnt_dir)
+
     def scan(self, image, scan_args):
         '''
         Wrapper function for basic security scans using
         openscap
         '''
+        if self.layer_cache is not None:
+            chroot = self._cached_rootfs(image)
+            if chroot is not None:
+                sys.stdout.write(self.helper._scan(chroot, scan_args))
+            return None
 
         mnt_dir = self._ensure_mnt_dir()
 